@@ -0,0 +1,313 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+/**
+ * @file
+
+  The \c babe-bench microbenchmark harness.
+
+  @author Greg McCreath
+  @since 0.0.10
+
+ * Runs each benchmark of the \c Bench java corpus (see \c bench/java/Bench.java) through #bvm_main and reports
+ * the operations per second along with their spread over the measured iterations.
+ *
+ * The VM cannot be started twice in one process, so each benchmark is run in a forked child process with its
+ * standard output piped back to the harness.  The java side prints a line when it is ready and another at the end of
+ * each iteration - the harness times the interval between lines.  Timing is done here rather than in java as
+ * \c System.nanoTime() is only as good as the VM's millisecond clock.  The first \c -warmup iterations are run and
+ * discarded, then the next \c -iterations are measured.  As all iterations of a benchmark happen in the same VM the
+ * warm-up also covers anything the VM does lazily (class loading, JIT compilation, heap growth).
+ *
+ * Usage:
+ *
+ * <pre>
+ * babe-bench [-warmup n] [-iterations n] [-ops n] [-cp dir] [-Xbootclasspath path] [benchmark ...] [-- vm option ...]
+ * </pre>
+ *
+ * All benchmarks are run if none are named.  Options after \c -- are passed to the VM ahead of the main class, for
+ * example <code>-- -heap 16m</code>.  POSIX only.
+ */
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "../../src/h/bvm.h"
+
+#ifndef BVM_BENCH_CLASSPATH
+#define BVM_BENCH_CLASSPATH "bench"
+#endif
+
+#ifndef BVM_BENCH_BOOT_CLASSPATH
+#define BVM_BENCH_BOOT_CLASSPATH "lib/rt-0.6.0.jar"
+#endif
+
+/** The most VM options that may follow \c -- */
+#define BENCH_MAX_VM_OPTIONS 32
+
+/** The most iterations that may be measured */
+#define BENCH_MAX_ITERATIONS 1000
+
+/** The most benchmarks that may be named on the command line */
+#define BENCH_MAX_NAMES 32
+
+/** The line prefix the java side uses */
+#define BENCH_PREFIX "bench: "
+
+/**
+ * A benchmark of the java corpus and the number of ops its iterations perform by default.  The defaults are
+ * scaled so an iteration takes roughly the same time for each.
+ */
+typedef struct _benchdefinitionstruct {
+	const char *name;
+	long ops;
+} bench_definition_t;
+
+static const bench_definition_t bench_definitions[] = {
+	{ "calls",		2000000 },
+	{ "fields",		2000000 },
+	{ "alloc",		1000000 },
+	{ "arrays",		2000000 },
+	{ "strings",	100000 },
+	{ "exceptions",	100000 },
+	{ "monitors",	1000000 },
+	{ "interfaces",	2000000 },
+	{ "gc",			500000 },
+	{ NULL, 0 }
+};
+
+static int bench_warmup = 3;
+static int bench_iterations = 10;
+static long bench_ops = 0;
+static char *bench_classpath = BVM_BENCH_CLASSPATH;
+static char *bench_boot_classpath = BVM_BENCH_BOOT_CLASSPATH;
+static char *bench_vm_options[BENCH_MAX_VM_OPTIONS];
+static int bench_vm_option_count = 0;
+
+/**
+ * Returns the current time in seconds.
+ */
+static double bench_now() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (double) tv.tv_sec + (double) tv.tv_usec / 1000000.0;
+}
+
+/**
+ * Run the VM in this (child) process with the given benchmark.  Does not return.
+ */
+static void bench_child(const char *name, long ops) {
+
+	char *argv[BENCH_MAX_VM_OPTIONS + 10];
+	char iterations[16], opsbuf[24];
+	int argc = 0, i;
+
+	sprintf(iterations, "%d", bench_warmup + bench_iterations);
+	sprintf(opsbuf, "%ld", ops);
+
+	argv[argc++] = "-Xbootclasspath";
+	argv[argc++] = bench_boot_classpath;
+	argv[argc++] = "-cp";
+	argv[argc++] = bench_classpath;
+	for (i = 0; i < bench_vm_option_count; i++) argv[argc++] = bench_vm_options[i];
+	argv[argc++] = "Bench";
+	argv[argc++] = (char *) name;
+	argv[argc++] = iterations;
+	argv[argc++] = opsbuf;
+	argv[argc] = NULL;
+
+	i = bvm_main(argc, argv);
+	fflush(stdout);
+	_exit(i);
+}
+
+/**
+ * Run a benchmark and print its line of the report.
+ *
+ * @return \c 0 if it ran ok, non zero otherwise.
+ */
+static int bench_run(const char *name, long ops) {
+
+	static double times[BENCH_MAX_ITERATIONS];
+
+	char line[256];
+	int fds[2], status, count = -1;
+	double last = 0, mean = 0, variance = 0, min = 0, max = 0;
+	pid_t pid;
+	FILE *in;
+	int i;
+
+	fflush(stdout);
+
+	if (pipe(fds) != 0) {
+		perror("pipe");
+		return 1;
+	}
+
+	pid = fork();
+
+	if (pid < 0) {
+		perror("fork");
+		return 1;
+	}
+
+	if (pid == 0) {
+		close(fds[0]);
+		dup2(fds[1], STDOUT_FILENO);
+		close(fds[1]);
+		bench_child(name, ops);
+	}
+
+	close(fds[1]);
+	in = fdopen(fds[0], "r");
+
+	/* 'count' is -1 until the ready line, and then the number of iterations timed so far */
+	while (fgets(line, sizeof(line), in) != NULL) {
+		double now = bench_now();
+		if (strncmp(line, BENCH_PREFIX, sizeof(BENCH_PREFIX) - 1) != 0) continue;
+		if (count >= bench_warmup) times[count - bench_warmup] = now - last;
+		count++;
+		last = now;
+	}
+
+	fclose(in);
+	waitpid(pid, &status, 0);
+
+	count -= bench_warmup;
+
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || count != bench_iterations) {
+		printf("%-12s failed (exit status %d, %d of %d iterations measured)\n", name,
+				WIFEXITED(status) ? WEXITSTATUS(status) : -1, (count < 0) ? 0 : count, bench_iterations);
+		return 1;
+	}
+
+	/* ops/sec per iteration, then their mean and (sample) variance */
+	for (i = 0; i < count; i++) {
+		times[i] = (times[i] > 0) ? (double) ops / times[i] : 0;
+		mean += times[i];
+		if (i == 0 || times[i] < min) min = times[i];
+		if (i == 0 || times[i] > max) max = times[i];
+	}
+	mean /= count;
+
+	for (i = 0; i < count; i++) variance += (times[i] - mean) * (times[i] - mean);
+	if (count > 1) variance /= (count - 1);
+
+	printf("%-12s %14.0f %12.0f %7.2f%% %14.0f %14.0f %10ld\n", name, mean, sqrt(variance),
+			(mean > 0) ? 100.0 * sqrt(variance) / mean : 0.0, min, max, ops);
+
+	return 0;
+}
+
+static void bench_usage() {
+	const bench_definition_t *def;
+	printf("usage: babe-bench [-warmup n] [-iterations n] [-ops n] [-cp dir] [-Xbootclasspath path] [benchmark ...] [-- vm option ...]\n");
+	printf("benchmarks:");
+	for (def = bench_definitions; def->name != NULL; def++) printf(" %s", def->name);
+	printf("\n");
+}
+
+static const bench_definition_t *bench_find(const char *name) {
+	const bench_definition_t *def;
+	for (def = bench_definitions; def->name != NULL; def++) {
+		if (strcmp(def->name, name) == 0) return def;
+	}
+	return NULL;
+}
+
+/**
+ * Main entry point for the benchmark harness.
+ *
+ * @param argc the argument count
+ * @param argv the arguments
+ *
+ * @return \c 0 if all benchmarks ran, \c 1 if any failed or the arguments were bad.
+ */
+int main(int argc, char *argv[]) {
+
+	const char *names[BENCH_MAX_NAMES];
+	int name_count = 0, failures = 0, i;
+
+	/* move past the 'C' executable name */
+	argv+=1;
+	argc-=1;
+
+	while (argc > 0) {
+		if (strcmp(argv[0], "--") == 0) {
+			argv++;
+			argc--;
+			while (argc > 0 && bench_vm_option_count < BENCH_MAX_VM_OPTIONS) {
+				bench_vm_options[bench_vm_option_count++] = argv[0];
+				argv++;
+				argc--;
+			}
+			break;
+		}
+		else if (argc > 1 && strcmp(argv[0], "-warmup") == 0) {
+			bench_warmup = atoi(argv[1]);
+		}
+		else if (argc > 1 && strcmp(argv[0], "-iterations") == 0) {
+			bench_iterations = atoi(argv[1]);
+		}
+		else if (argc > 1 && strcmp(argv[0], "-ops") == 0) {
+			bench_ops = atol(argv[1]);
+		}
+		else if (argc > 1 && strcmp(argv[0], "-cp") == 0) {
+			bench_classpath = argv[1];
+		}
+		else if (argc > 1 && strcmp(argv[0], "-Xbootclasspath") == 0) {
+			bench_boot_classpath = argv[1];
+		}
+		else if (argv[0][0] != '-' && bench_find(argv[0]) != NULL && name_count < BENCH_MAX_NAMES) {
+			names[name_count++] = argv[0];
+			argv++;
+			argc--;
+			continue;
+		}
+		else {
+			bench_usage();
+			return 1;
+		}
+		argv+=2;
+		argc-=2;
+	}
+
+	if (bench_warmup < 0 || bench_iterations < 1 || bench_iterations > BENCH_MAX_ITERATIONS || bench_ops < 0) {
+		bench_usage();
+		return 1;
+	}
+
+	printf("# %d warm-up and %d measured iterations per benchmark\n", bench_warmup, bench_iterations);
+	printf("%-12s %14s %12s %8s %14s %14s %10s\n", "# benchmark", "ops/sec", "stddev", "cv", "min", "max", "ops/iter");
+
+	if (name_count == 0) {
+		const bench_definition_t *def;
+		for (def = bench_definitions; def->name != NULL; def++) {
+			failures += bench_run(def->name, (bench_ops > 0) ? bench_ops : def->ops);
+		}
+	} else {
+		for (i = 0; i < name_count; i++) {
+			failures += bench_run(names[i], (bench_ops > 0) ? bench_ops : bench_find(names[i])->ops);
+		}
+	}
+
+	return (failures == 0) ? 0 : 1;
+}
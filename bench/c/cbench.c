@@ -0,0 +1,427 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+/**
+ * @file
+
+  The \c babe-cbench C-level microbenchmarks.
+
+  @author Greg McCreath
+  @since 0.0.10
+
+ * Initialises a VM with #bvm_vm_init and then times calls straight into its internals - no interpreter involved:
+ *
+ * @li \c heap_alloc / \c heap_free : #bvm_heap_alloc and #bvm_heap_free over a ring of live chunks, with sizes in a
+ * mix weighted towards small objects but with a tail of large ones.
+ * @li \c utfstring_hit / \c utfstring_miss : #bvm_utfstring_pool_get for every string in the pool, and for strings
+ * that are not.
+ * @li \c clazz_hit / \c clazz_miss : #bvm_clazz_pool_get for every class in the pool (through the system class loader
+ * so the lookup walks the loader chain, as most do), and for classes that are not.
+ * @li \c zip_buffer_file : #bvm_zip_buffer_file_from_jar for every file in a jar, with #BVM_JAR_DIRECTORY_INDEX_ENABLE.
+ *
+ * Every call is timed on its own with the monotonic clock and the p50, p99, mean and max latency reported.  The
+ * \c timer line is the cost of reading the clock, which is included in every other line.  Lookups are made with
+ * fresh (unhashed) utfstrings so the hash is part of each, as when a class file is being parsed.  All classes in the
+ * boot class path jar are loaded first so the pools are the size they are in a large program.
+ *
+ * Usage:
+ *
+ * <pre>
+ * babe-cbench [-ops n] [-jar file] [vm option ...] [timer|heap|utfstring|clazz|zip ...]
+ * </pre>
+ *
+ * All benchmarks are run if none are named.  The VM options are those of #bvm_main, for example \c -heap.  \c -jar
+ * is the jar to load files out of, by default the boot class path jar.  POSIX only.
+ */
+
+#include <time.h>
+
+#include "../../src/h/bvm.h"
+
+#ifndef BVM_BENCH_BOOT_CLASSPATH
+#define BVM_BENCH_BOOT_CLASSPATH "lib/rt-0.6.0.jar"
+#endif
+
+/** The number of chunks kept allocated by the heap benchmark */
+#define CBENCH_HEAP_LIVE 4096
+
+/** The most arguments given to the VM */
+#define CBENCH_MAX_ARGS 64
+
+static long cbench_ops = 200000;
+static char default_jar[] = BVM_BENCH_BOOT_CLASSPATH;
+static char *cbench_jar = default_jar;
+static bvm_uint32_t cbench_random = 12345;
+
+/** Latencies of the current benchmark, in nanoseconds */
+static double *cbench_times = NULL;
+static long cbench_count = 0;
+
+/** The names of the files in the jar */
+static char **cbench_files = NULL;
+static long cbench_file_count = 0;
+
+static double cbench_now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+/** A small LCG - the same sequence every run */
+static bvm_uint32_t cbench_next_random() {
+	cbench_random = cbench_random * 1103515245 + 12345;
+	return (cbench_random >> 8);
+}
+
+static int cbench_compare(const void *a, const void *b) {
+	double x = *(const double *) a, y = *(const double *) b;
+	return (x < y) ? -1 : (x > y);
+}
+
+/** Start a benchmark of up to \c ops timings */
+static void cbench_begin(long ops) {
+	free(cbench_times);
+	cbench_times = malloc(sizeof(double) * ((ops > 0) ? ops : 1));
+	cbench_count = 0;
+}
+
+#define CBENCH_TIME(__call) {								\
+	double cbench_start = cbench_now();						\
+	__call;													\
+	cbench_times[cbench_count++] = cbench_now() - cbench_start;	\
+}
+
+/** Print the line of the report for the benchmark just timed */
+static void cbench_report(const char *name) {
+
+	double mean = 0;
+	long i;
+
+	if (cbench_count == 0) {
+		printf("%-16s %10s\n", name, "-");
+		return;
+	}
+
+	for (i = 0; i < cbench_count; i++) mean += cbench_times[i];
+	mean /= cbench_count;
+
+	qsort(cbench_times, cbench_count, sizeof(double), cbench_compare);
+
+	printf("%-16s %10ld %10.0f %10.0f %10.0f %12.0f\n", name, cbench_count,
+			cbench_times[cbench_count / 2], cbench_times[(cbench_count * 99) / 100], mean, cbench_times[cbench_count - 1]);
+}
+
+static void cbench_timer() {
+	long i;
+	cbench_begin(cbench_ops);
+	for (i = 0; i < cbench_ops; i++) CBENCH_TIME( {} );
+	cbench_report("timer");
+}
+
+/**
+ * A chunk size from a mix weighted to small objects: 60% 16-64 bytes, 25% 64-256, 10% 256-1k, 4% 1k-8k and 1%
+ * 8k-32k.
+ */
+static size_t cbench_heap_size() {
+	bvm_uint32_t r = cbench_next_random();
+	bvm_uint32_t pick = r % 100;
+	r >>= 7;
+	if (pick < 60) return 16 + (r % 48);
+	if (pick < 85) return 64 + (r % 192);
+	if (pick < 95) return 256 + (r % 768);
+	if (pick < 99) return 1024 + (r % 7168);
+	return 8192 + (r % 24576);
+}
+
+static void cbench_heap() {
+
+	static void *live[CBENCH_HEAP_LIVE];
+	double *alloc_times;
+	long i;
+
+	/* fill the ring before timing anything */
+	for (i = 0; i < CBENCH_HEAP_LIVE; i++) live[i] = bvm_heap_alloc(cbench_heap_size(), BVM_ALLOC_TYPE_STATIC);
+
+	alloc_times = malloc(sizeof(double) * cbench_ops);
+	cbench_begin(cbench_ops);
+
+	/* replace a random member of the ring with each op, timing the free and the alloc separately */
+	for (i = 0; i < cbench_ops; i++) {
+		bvm_uint32_t slot = cbench_next_random() % CBENCH_HEAP_LIVE;
+		size_t size = cbench_heap_size();
+		double start;
+		CBENCH_TIME( bvm_heap_free(live[slot]) );
+		start = cbench_now();
+		live[slot] = bvm_heap_alloc(size, BVM_ALLOC_TYPE_STATIC);
+		alloc_times[i] = cbench_now() - start;
+	}
+
+	cbench_report("heap_free");
+
+	memcpy(cbench_times, alloc_times, sizeof(double) * cbench_ops);
+	free(alloc_times);
+	cbench_report("heap_alloc");
+
+	for (i = 0; i < CBENCH_HEAP_LIVE; i++) bvm_heap_free(live[i]);
+}
+
+/**
+ * Look up each of \c count utfstrings (and a changed copy of each, to miss) in the utfstring pool or the clazz pool
+ * until \c cbench_ops lookups are done.
+ */
+static void cbench_lookups(bvm_utfstring_t **strings, long count, bvm_bool_t clazzes) {
+
+	char **misses = malloc(sizeof(char *) * count);
+	bvm_utfstring_t str;
+	long i;
+	int pass;
+
+	/* the misses are the strings with a trailing '~', which no class or member name has */
+	for (i = 0; i < count; i++) {
+		misses[i] = malloc(strings[i]->length + 2);
+		memcpy(misses[i], strings[i]->data, strings[i]->length);
+		misses[i][strings[i]->length] = '~';
+		misses[i][strings[i]->length + 1] = '\0';
+	}
+
+	for (pass = 0; pass < 2; pass++) {
+
+		cbench_begin(cbench_ops);
+
+		for (i = 0; i < cbench_ops; i++) {
+
+			bvm_utfstring_t *s = strings[i % count];
+
+			str.length = (bvm_uint16_t) (s->length + pass);
+			str.data = (pass == 0) ? s->data : (bvm_uint8_t *) misses[i % count];
+			str.hash = 0;
+			str.next = NULL;
+
+			if (clazzes) {
+				CBENCH_TIME( bvm_clazz_pool_get(BVM_SYSTEM_CLASSLOADER_OBJ, &str) );
+			} else {
+				CBENCH_TIME( bvm_utfstring_pool_get(&str, BVM_FALSE) );
+			}
+		}
+
+		if (clazzes)
+			cbench_report( (pass == 0) ? "clazz_hit" : "clazz_miss");
+		else
+			cbench_report( (pass == 0) ? "utfstring_hit" : "utfstring_miss");
+	}
+
+	for (i = 0; i < count; i++) free(misses[i]);
+	free(misses);
+}
+
+static void cbench_utfstring_pool() {
+
+	bvm_utfstring_t **strings, *s;
+	long count = 0;
+	int i;
+
+	for (i = 0; i < bvm_gl_utfstring_pool_bucketcount; i++)
+		for (s = bvm_gl_utfstring_pool[i]; s != NULL; s = s->next) count++;
+
+	strings = malloc(sizeof(bvm_utfstring_t *) * count);
+	count = 0;
+
+	for (i = 0; i < bvm_gl_utfstring_pool_bucketcount; i++)
+		for (s = bvm_gl_utfstring_pool[i]; s != NULL; s = s->next) strings[count++] = s;
+
+	cbench_lookups(strings, count, BVM_FALSE);
+	free(strings);
+}
+
+static void cbench_clazz_pool() {
+
+	bvm_utfstring_t **names;
+	bvm_clazz_t *clazz;
+	long count = 0;
+	int i;
+
+	for (i = 0; i < bvm_gl_clazz_pool_bucketcount; i++)
+		for (clazz = bvm_gl_clazz_pool[i]; clazz != NULL; clazz = clazz->next) count++;
+
+	names = malloc(sizeof(bvm_utfstring_t *) * count);
+	count = 0;
+
+	for (i = 0; i < bvm_gl_clazz_pool_bucketcount; i++)
+		for (clazz = bvm_gl_clazz_pool[i]; clazz != NULL; clazz = clazz->next) names[count++] = clazz->name;
+
+	cbench_lookups(names, count, BVM_TRUE);
+	free(names);
+}
+
+#if BVM_JAR_DIRECTORY_INDEX_ENABLE
+
+/** #bvm_zip_for_each_file callback to collect the names of the (non-directory) files in the jar */
+static void cbench_collect_file(bvm_uint8_t *name, bvm_uint32_t length, void *data) {
+
+	UNUSED(data);
+
+	if (length == 0 || name[length - 1] == '/') return;
+
+	cbench_files = realloc(cbench_files, sizeof(char *) * (cbench_file_count + 1));
+	cbench_files[cbench_file_count] = malloc(length + 1);
+	memcpy(cbench_files[cbench_file_count], name, length);
+	cbench_files[cbench_file_count][length] = '\0';
+	cbench_file_count++;
+}
+
+static void cbench_free_files() {
+	long i;
+	for (i = 0; i < cbench_file_count; i++) free(cbench_files[i]);
+	free(cbench_files);
+	cbench_files = NULL;
+	cbench_file_count = 0;
+}
+
+/** Load every class in the jar (those that fail to load are skipped) so the pools are populated */
+static void cbench_load_clazzes() {
+
+	long i;
+
+	for (i = 0; i < cbench_file_count; i++) {
+
+		size_t length = strlen(cbench_files[i]);
+		bvm_utfstring_t name;
+
+		if (length <= 6 || strcmp(cbench_files[i] + length - 6, ".class") != 0) continue;
+
+		name.length = (bvm_uint16_t) (length - 6);
+		name.data = (bvm_uint8_t *) cbench_files[i];
+		name.hash = 0;
+		name.next = NULL;
+
+		BVM_TRY {
+			bvm_clazz_get(BVM_BOOTSTRAP_CLASSLOADER_OBJ, &name);
+		} BVM_CATCH(e) {
+			UNUSED(e);
+		} BVM_END_CATCH
+	}
+}
+
+static void cbench_zip() {
+
+	long i;
+
+	cbench_begin(cbench_ops);
+
+	for (i = 0; i < cbench_ops; i++) {
+
+		/* in a transient block like the class loader's, as roots made while inflating are not all unmade */
+		BVM_BEGIN_TRANSIENT_BLOCK {
+			bvm_filebuffer_t *buffer;
+			CBENCH_TIME( buffer = bvm_zip_buffer_file_from_jar(cbench_jar, cbench_files[i % cbench_file_count]) );
+			if (buffer != NULL) bvm_heap_free(buffer);
+		} BVM_END_TRANSIENT_BLOCK
+	}
+
+	cbench_report("zip_buffer_file");
+}
+
+#endif
+
+/**
+ * Main entry point for the C microbenchmarks.
+ *
+ * @param argc the argument count
+ * @param argv the arguments
+ *
+ * @return \c 0 if the benchmarks ran, otherwise a VM exit code or \c 1 if the arguments were bad.
+ */
+int main(int argc, char *argv[]) {
+
+	char *vm_argv[CBENCH_MAX_ARGS];
+	char **av = vm_argv;
+	int ac = 0, i, exit_code = 0;
+
+	/* defaults first - the same options given later override them.  The heap holds the heap benchmark's live ring
+	 * and the permanent roots every loaded boot class */
+	vm_argv[ac++] = "-Xbootclasspath";
+	vm_argv[ac++] = default_jar;
+	vm_argv[ac++] = "-heap";
+	vm_argv[ac++] = "16m";
+	vm_argv[ac++] = "-sr";
+	vm_argv[ac++] = "500";
+
+	for (i = 1; i < argc && ac < CBENCH_MAX_ARGS; i++) {
+		if (i + 1 < argc && strcmp(argv[i], "-ops") == 0) {
+			cbench_ops = atol(argv[++i]);
+		} else if (i + 1 < argc && strcmp(argv[i], "-jar") == 0) {
+			cbench_jar = argv[++i];
+		} else {
+			vm_argv[ac++] = argv[i];
+		}
+	}
+
+	if (cbench_ops < 1) {
+		printf("usage: babe-cbench [-ops n] [-jar file] [vm option ...] [timer|heap|utfstring|clazz|zip ...]\n");
+		return 1;
+	}
+
+#if BVM_VM_INSTANCES_ENABLE
+	bvm_init_exception_stack();
+#endif
+
+	BVM_TRY {
+
+		BVM_VM_TRY {
+
+			bvm_vm_init(&ac, &av);
+
+			/* without a -jar, use the first segment of the boot class path the VM ended up with */
+			if (cbench_jar == default_jar) cbench_jar = bvm_gl_boot_classpath_segments[0];
+
+#if BVM_JAR_DIRECTORY_INDEX_ENABLE
+			/* load all the boot classes, then list the files of the jar the zip benchmark reads */
+			bvm_zip_for_each_file(bvm_gl_boot_classpath_segments[0], cbench_collect_file, NULL);
+			cbench_load_clazzes();
+			cbench_free_files();
+			bvm_zip_for_each_file(cbench_jar, cbench_collect_file, NULL);
+#endif
+
+			printf("# %ld ops per benchmark, latencies in nanoseconds\n", cbench_ops);
+			printf("%-16s %10s %10s %10s %10s %12s\n", "# benchmark", "ops", "p50", "p99", "mean", "max");
+
+			for (i = 0; i < (ac == 0 ? 1 : ac); i++) {
+
+				const char *name = (ac == 0) ? NULL : av[i];
+
+				if (name == NULL || strcmp(name, "timer") == 0) cbench_timer();
+				if (name == NULL || strcmp(name, "heap") == 0) cbench_heap();
+				if (name == NULL || strcmp(name, "utfstring") == 0) cbench_utfstring_pool();
+				if (name == NULL || strcmp(name, "clazz") == 0) cbench_clazz_pool();
+#if BVM_JAR_DIRECTORY_INDEX_ENABLE
+				if ( (name == NULL || strcmp(name, "zip") == 0) && cbench_file_count > 0) cbench_zip();
+#endif
+			}
+
+		} BVM_VM_CATCH(code, msg) {
+			if (msg != NULL) printf("%s\n", msg);
+			exit_code = code;
+		} BVM_VM_END_CATCH
+
+	} BVM_CATCH(e) {
+		printf("uncaught exception %s\n", e->clazz->name->data);
+		exit_code = BVM_FATAL_ERR_UNCAUGHT_EXCEPTION;
+	} BVM_END_CATCH
+
+	return exit_code;
+}
@@ -0,0 +1,276 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+/**
+ * The benchmark corpus run by the <code>babe-bench</code> harness.
+ * <p>
+ * Usage is <code>Bench &lt;name&gt; &lt;iterations&gt; &lt;ops&gt;</code>.  The named benchmark is set up, a
+ * <code>bench: ready</code> line is printed, and then the benchmark is run <code>iterations</code> times with each
+ * iteration performing <code>ops</code> operations and printing a <code>bench: &lt;checksum&gt;</code> line when it
+ * is done.  The harness times the interval between lines, so nothing here reads a clock.  The checksum keeps the work
+ * observable and is the same on every VM for a given iteration.
+ * <p>
+ * Only classes in the BabeVM runtime jar are used.
+ */
+public class Bench {
+
+	/* ---------- method calls ---------- */
+
+	private int calls;
+
+	private static int staticCall(int a, int b) {
+		return a + b;
+	}
+
+	private int virtualCall(int a) {
+		return calls += a;
+	}
+
+	static int calls(int ops) {
+		Bench b = new Bench();
+		int sum = 0;
+		for (int i = 0; i < ops; i++) {
+			sum = staticCall(sum, i);
+			b.virtualCall(i & 7);
+		}
+		return sum + b.calls;
+	}
+
+	/* ---------- field access ---------- */
+
+	private static int staticField;
+
+	private int a, b;
+
+	private long c;
+
+	static int fields(int ops) {
+		Bench o = new Bench();
+		for (int i = 0; i < ops; i++) {
+			o.a += i;
+			o.b ^= o.a;
+			o.c += o.b;
+			staticField += o.a & 0xFF;
+		}
+		return o.a + o.b + (int) o.c + staticField;
+	}
+
+	/* ---------- allocation ---------- */
+
+	private static final class Point {
+		int x, y;
+		Point next;
+
+		Point(int x, int y, Point next) {
+			this.x = x;
+			this.y = y;
+			this.next = next;
+		}
+	}
+
+	static int alloc(int ops) {
+		Point p = null;
+		int sum = 0;
+		for (int i = 0; i < ops; i++) {
+			/* keep a short chain alive so it is not all garbage as soon as it is made */
+			p = new Point(i, -i, ((i & 15) == 0) ? null : p);
+			sum += p.x;
+		}
+		return sum;
+	}
+
+	/* ---------- arrays ---------- */
+
+	private static final int[] ints = new int[1024];
+
+	private static final byte[] bytes = new byte[1024];
+
+	static int arrays(int ops) {
+		int sum = 0;
+		for (int i = 0; i < ops; i++) {
+			int j = i & 1023;
+			ints[j] = ints[1023 - j] + i;
+			bytes[j] = (byte) ints[j];
+			sum += bytes[j];
+			if (j == 1023) System.arraycopy(ints, 0, ints, 512, 512);
+		}
+		return sum;
+	}
+
+	/* ---------- strings ---------- */
+
+	static int strings(int ops) {
+		int sum = 0;
+		for (int i = 0; i < ops; i++) {
+			StringBuilder sb = new StringBuilder();
+			sb.append("item").append(i).append(':').append(i & 0xFF);
+			String s = sb.toString();
+			sum += s.hashCode() + s.indexOf(':') + (s.equals("item0:0") ? 1 : 0);
+		}
+		return sum;
+	}
+
+	/* ---------- exceptions ---------- */
+
+	private static final class BenchException extends RuntimeException {
+		final int value;
+
+		BenchException(int value) {
+			super("bench");
+			this.value = value;
+		}
+	}
+
+	private static int thrower(int i, int depth) {
+		if (depth == 0) throw new BenchException(i);
+		return thrower(i, depth - 1) + 1;
+	}
+
+	static int exceptions(int ops) {
+		int sum = 0;
+		for (int i = 0; i < ops; i++) {
+			try {
+				sum += thrower(i, i & 3);
+			} catch (BenchException e) {
+				sum += e.value;
+			}
+		}
+		return sum;
+	}
+
+	/* ---------- monitors ---------- */
+
+	private static final Object lock = new Object();
+
+	private int counter;
+
+	private synchronized void increment() {
+		counter++;
+	}
+
+	static int monitors(int ops) {
+		Bench o = new Bench();
+		int sum = 0;
+		for (int i = 0; i < ops; i++) {
+			synchronized (lock) {
+				sum += i;
+			}
+			o.increment();
+		}
+		return sum + o.counter;
+	}
+
+	/* ---------- interface dispatch ---------- */
+
+	private interface Shape {
+		int area();
+	}
+
+	private static final class Square implements Shape {
+		private final int side;
+
+		Square(int side) {
+			this.side = side;
+		}
+
+		public int area() {
+			return side * side;
+		}
+	}
+
+	private static final class Rect implements Shape {
+		private final int w, h;
+
+		Rect(int w, int h) {
+			this.w = w;
+			this.h = h;
+		}
+
+		public int area() {
+			return w * h;
+		}
+	}
+
+	private static final class Triangle implements Shape {
+		private final int b, h;
+
+		Triangle(int b, int h) {
+			this.b = b;
+			this.h = h;
+		}
+
+		public int area() {
+			return (b * h) >> 1;
+		}
+	}
+
+	private static final Shape[] shapes = { new Square(3), new Rect(2, 5), new Triangle(4, 6), new Square(7) };
+
+	static int interfaces(int ops) {
+		int sum = 0;
+		for (int i = 0; i < ops; i++) {
+			sum += shapes[i & 3].area();
+		}
+		return sum;
+	}
+
+	/* ---------- GC churn ---------- */
+
+	private static final Object[] survivors = new Object[256];
+
+	static int gc(int ops) {
+		int sum = 0;
+		for (int i = 0; i < ops; i++) {
+			/* mostly garbage, with one in sixteen replacing an older survivor */
+			byte[] b = new byte[64 + (i & 255)];
+			b[0] = (byte) i;
+			sum += b.length;
+			if ((i & 15) == 0) survivors[(i >> 4) & 255] = b;
+		}
+		return sum;
+	}
+
+	/* ---------- driver ---------- */
+
+	private static int run(String name, int ops) {
+		if (name.equals("calls")) return calls(ops);
+		if (name.equals("fields")) return fields(ops);
+		if (name.equals("alloc")) return alloc(ops);
+		if (name.equals("arrays")) return arrays(ops);
+		if (name.equals("strings")) return strings(ops);
+		if (name.equals("exceptions")) return exceptions(ops);
+		if (name.equals("monitors")) return monitors(ops);
+		if (name.equals("interfaces")) return interfaces(ops);
+		if (name.equals("gc")) return gc(ops);
+		throw new IllegalArgumentException("unknown benchmark: " + name);
+	}
+
+	public static void main(String[] args) {
+		String name = args[0];
+		int iterations = Integer.parseInt(args[1]);
+		int ops = Integer.parseInt(args[2]);
+
+		/* one op to load and initialise everything the benchmark touches */
+		run(name, 1);
+
+		System.out.println("bench: ready");
+		for (int i = 0; i < iterations; i++) {
+			System.out.println("bench: " + run(name, ops));
+		}
+	}
+}
@@ -0,0 +1,852 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#include "../h/bvm.h"
+
+/**
+
+ @file
+
+ Ahead-of-time bytecode to C translator.
+
+ @section aot-ov Overview
+
+ With #BVM_AOT_ENABLE the methods of selected classes can be translated to C when the VM is built, and the C linked
+ into the VM binary.  It is for platforms where the JIT cannot run - no x86-64, or no executable memory - and
+ for code that is known ahead of time to matter.
+
+ Translation is done by the VM itself, on a training run.  A VM started with \c -aotwrite \c &lt;file&gt; keeps a copy
+ of the bytecode of each method of each class it loads whose name starts with one of the comma separated prefixes
+ given by \c -aotclasses (all classes if there is no \c -aotclasses), and writes a C file translating them when it
+ exits.  The bytecode is copied as the class is loaded, before the interpreter has quickened or fused any of it.  The
+ file includes the VM headers as the VM sources do, so is written into \c src/c, and is linked into the VM by giving
+ it to the build - \c cmake \c -DBVM_AOT_SOURCE=src/c/&lt;file&gt;.
+
+ The generated file has one C function for each method, and a #bvm_aot_register_methods that registers each
+ function in the native method pool with #bvm_native_method_pool_register_aot, just as the VM natives are
+ registered.  When a class is loaded each of its methods is looked up in the pool, and a method that has a
+ translation is linked to it - but only if a hash of its bytecode is the same as that of the bytecode it was
+ translated from.  A class that has changed since the translation is simply interpreted.
+
+ @section aot-model Execution model
+
+ Translated methods are not natives.  A native frame is only scanned by the GC over its arguments, and a native
+ that throws leaves the interpreter no pc to find a handler from, so C code that kept Java values in C locals and
+ called back into the VM would need its own GC maps and exception tables.  Instead, a translated method is run as
+ the JIT runs compiled code (see jit.c).  The method still has its bytecode and its ordinary interpreter frame,
+ and the C function works directly on that frame's locals and operand stack, so at the start of each instruction
+ the frame is exactly what the interpreter would have at that pc.  The function takes the bytecode offset to start
+ at - it is a \c switch on it - and returns the offset the interpreter should carry on from:
+
+ @li the interpreter goes into the translation of the current method wherever the JIT would - after the frame push
+ for an invocation, at a backwards \c goto, after a return to the method, and when a thread switch resumes it.
+ @li the translation stops at any instruction it does not translate, and at any it does translate where the
+ interpreter would throw - a \c null array, an index out of bounds, a zero divisor.  The interpreter runs the
+ instruction and throws in the usual way.
+
+ So translated code never allocates, never calls out to the VM and never throws, and the GC, exception handling,
+ stack traces and the debugger know nothing of it.  As with the JIT, each backwards branch counts towards the thread
+ timeslice (or with #BVM_THREAD_TIMER_PREEMPTION_ENABLE looks at the switch request) and stops at its target when
+ it is time to switch threads, and no translated code is run while a debugger session is open.
+
+ What is translated is what can be done without resolving anything: the constants, loads and stores of all types,
+ \c iinc, stack manipulation, int and long arithmetic, shifts, logic and compares, the int and long conversions,
+ all conditional and unconditional branches, \c tableswitch and \c lookupswitch, \c arraylength, and the loads and
+ stores of int, long, byte, char and short arrays.  Unlike the JIT the generated C is compiled by the platform's own
+ compiler, so it is optimised within each run of translated instructions and is the same on every platform.
+
+ The generated code is written in the \c BVM_AOT_ macros of aot.h, so the VM decides how each operation is done on
+ its frames.  A translation is only valid for VM builds with the same cell and array layout as the VM that wrote
+ it - it must be written again with any VM that changes them.
+
+ @author Greg McCreath
+ @since 0.0.10
+
+*/
+
+#if BVM_AOT_ENABLE
+
+/** The C file to write translations to at VM exit.  Set with the \c -aotwrite command line option. */
+BVM_VM_LOCAL char *bvm_gl_aot_write_filename = NULL;
+
+/** The comma separated class name prefixes to translate.  Set with the \c -aotclasses command line option.  \c NULL
+ * translates all classes. */
+BVM_VM_LOCAL char *bvm_gl_aot_classes = NULL;
+
+/** The number of translated methods registered - no method is looked up if there are none */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_aot_method_count = 0;
+
+/**
+ * The bytecode of a method to be translated, recorded as its class is loaded.
+ */
+typedef struct _aotrecordstruct {
+
+	/** the next record - in the order the methods were loaded */
+	struct _aotrecordstruct *next;
+
+	/** the hash of the bytecode */
+	bvm_uint32_t hash;
+
+	/** the length of the bytecode */
+	bvm_uint32_t code_length;
+
+	/** the lengths of the class name, method name and method descriptor */
+	bvm_uint16_t clazzname_length;
+	bvm_uint16_t name_length;
+	bvm_uint16_t desc_length;
+
+	/** the class name, method name and descriptor, and then the bytecode */
+	bvm_uint8_t data[1];
+
+} aot_record_t;
+
+/** The recorded methods */
+static BVM_VM_LOCAL aot_record_t *aot_records = NULL;
+
+/** The last method recorded */
+static BVM_VM_LOCAL aot_record_t *aot_records_last = NULL;
+
+/**
+ * Where the C is being written, and whether it has been written so far without error.
+ */
+typedef struct _aotwriterstruct {
+
+	/** the file handle */
+	void *handle;
+
+	/** cleared by the first failed write */
+	bvm_bool_t ok;
+
+} aot_writer_t;
+
+/* the flags kept for each bytecode offset as a method is translated */
+#define AOT_INSTRUCTION 	1
+#define AOT_TRANSLATED 		2
+#define AOT_TARGET 			4
+
+/** The fewest instructions in a row worth translating.  Going into a translation costs a call and a \c switch, so
+ * a shorter run of translatable instructions is left to the interpreter. */
+#define AOT_MIN_RUN 		4
+
+/**
+ * The FNV-1a hash of some bytecode.  It is written with each translation and compared with the bytecode of the
+ * method when it is loaded.
+ *
+ * @param code the bytecode
+ * @param code_length its length
+ *
+ * @return the hash
+ */
+static bvm_uint32_t aot_hash(bvm_uint8_t *code, bvm_uint32_t code_length) {
+
+	bvm_uint32_t hash = 2166136261U;
+	bvm_uint32_t lc;
+
+	for (lc = 0; lc < code_length; lc++) {
+		hash ^= code[lc];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+/**
+ * Register the translated methods at VM startup.  Called before any class is loaded.
+ */
+void bvm_aot_init() {
+	bvm_gl_aot_method_count = 0;
+	bvm_aot_register_methods();
+}
+
+#if (!BVM_AOT_METHODS_LINKED)
+
+/**
+ * Register the translated methods linked into the VM.  This one is used when there are none - the generated file
+ * given to the build with \c BVM_AOT_SOURCE has the real one.
+ */
+void bvm_aot_register_methods() {
+}
+
+#endif
+
+/**
+ * Whether the methods of a class are to be translated, by its name and the prefixes of \c -aotclasses.  A prefix
+ * may use '.' or '/' as the package separator.
+ *
+ * @param clazzname the internal name of the class
+ *
+ * @return #BVM_TRUE if the class is selected
+ */
+static bvm_bool_t aot_is_selected(bvm_utfstring_t *clazzname) {
+
+	char *prefix = bvm_gl_aot_classes;
+
+	if (prefix == NULL) return BVM_TRUE;
+
+	while (*prefix != '\0') {
+
+		bvm_uint32_t lc = 0;
+
+		while ( (prefix[lc] != '\0') && (prefix[lc] != ',') && (lc < clazzname->length) &&
+				( (prefix[lc] == (char) clazzname->data[lc]) || ( (prefix[lc] == '.') && (clazzname->data[lc] == '/') ) ) )
+			lc++;
+
+		if ( (lc > 0) && ( (prefix[lc] == '\0') || (prefix[lc] == ',') ) ) return BVM_TRUE;
+
+		/* on to the next prefix */
+		while ( (*prefix != '\0') && (*prefix++ != ',') );
+	}
+
+	return BVM_FALSE;
+}
+
+/**
+ * Keep a copy of the bytecode of a method to be translated.  The copy is from #bvm_pd_memory_alloc and takes nothing
+ * from the heap.  A method that cannot be recorded is simply not translated.
+ *
+ * @param method the method
+ * @param code its bytecode
+ * @param code_length the length of its bytecode
+ * @param hash the hash of its bytecode
+ */
+static void aot_record(bvm_method_t *method, bvm_uint8_t *code, bvm_uint32_t code_length, bvm_uint32_t hash) {
+
+	bvm_utfstring_t *clazzname = method->clazz->name;
+	aot_record_t *record = bvm_pd_memory_alloc(sizeof(aot_record_t) + clazzname->length + method->name->length +
+											   method->jni_signature->length + code_length);
+
+	if (record == NULL) return;
+
+	record->next = NULL;
+	record->hash = hash;
+	record->code_length = code_length;
+	record->clazzname_length = clazzname->length;
+	record->name_length = method->name->length;
+	record->desc_length = method->jni_signature->length;
+
+	memcpy(record->data, clazzname->data, clazzname->length);
+	memcpy(record->data + record->clazzname_length, method->name->data, record->name_length);
+	memcpy(record->data + record->clazzname_length + record->name_length, method->jni_signature->data, record->desc_length);
+	memcpy(record->data + record->clazzname_length + record->name_length + record->desc_length, code, code_length);
+
+	if (aot_records_last == NULL)
+		aot_records = record;
+	else
+		aot_records_last->next = record;
+
+	aot_records_last = record;
+}
+
+/**
+ * Link a method being loaded to its translation, if there is one and it was translated from the same bytecode, and
+ * record the method for translation if translations are being written.  Called as the bytecode is loaded, before it
+ * is changed in any way.
+ *
+ * @param method the method
+ * @param code its bytecode
+ * @param code_length the length of its bytecode
+ */
+void bvm_aot_link(bvm_method_t *method, bvm_uint8_t *code, bvm_uint32_t code_length) {
+
+	bvm_bool_t is_write = (bvm_gl_aot_write_filename != NULL) && aot_is_selected(method->clazz->name);
+	bvm_uint32_t hash;
+
+	if ( (bvm_gl_aot_method_count == 0) && !is_write) return;
+
+	hash = aot_hash(code, code_length);
+
+	if (bvm_gl_aot_method_count > 0) {
+
+		bvm_native_method_desc_t *method_desc = bvm_native_method_pool_get(method->clazz->name, method->name, method->jni_signature);
+
+		if ( (method_desc != NULL) && (method_desc->aot_method != NULL) && (method_desc->aot_hash == hash) )
+			method->aot_code = method_desc->aot_method;
+	}
+
+	if (is_write) aot_record(method, code, code_length, hash);
+}
+
+/**
+ * Run the translation of a method from a given pc until it stops.
+ *
+ * @param method the translated method
+ * @param locals the locals of the current frame
+ * @param sp the stack pointer of the current frame - updated when the translation stops
+ * @param pc the pc to start at
+ *
+ * @return the pc to carry on interpreting from
+ */
+bvm_uint8_t *bvm_aot_run(bvm_method_t *method, bvm_cell_t *locals, bvm_cell_t **sp, bvm_uint8_t *pc) {
+	return method->code.bytecode + method->aot_code(locals, sp, (bvm_int32_t) (pc - method->code.bytecode));
+}
+
+/**
+ * Write some formatted text.  Only ever given short formats and numbers.
+ *
+ * @param writer the writer
+ * @param format the \c printf format
+ */
+static void aot_out(aot_writer_t *writer, const char *format, ...) {
+
+	char line[256];
+	size_t length;
+	va_list args;
+
+	if (!writer->ok) return;
+
+	va_start(args, format);
+	length = (size_t) vsprintf(line, format, args);
+	va_end(args);
+
+	writer->ok = (bvm_pd_file_write(line, length, writer->handle) == length);
+}
+
+/**
+ * Write some utf8 as a C string literal.  Anything but letters, digits and the few characters of class names and
+ * descriptors is written as an octal escape.
+ *
+ * @param writer the writer
+ * @param data the utf8
+ * @param length its length in bytes
+ */
+static void aot_out_string(aot_writer_t *writer, bvm_uint8_t *data, bvm_uint32_t length) {
+
+	bvm_uint32_t lc;
+
+	aot_out(writer, "\"");
+
+	for (lc = 0; lc < length; lc++) {
+		bvm_uint8_t c = data[lc];
+		if ( ( (c >= 'a') && (c <= 'z') ) || ( (c >= 'A') && (c <= 'Z') ) || ( (c >= '0') && (c <= '9') ) ||
+			 ( (c != '\0') && (strchr("/$_<>;()[.-", c) != NULL) ) )
+			aot_out(writer, "%c", c);
+		else
+			aot_out(writer, "\\%03o", c);
+	}
+
+	aot_out(writer, "\"");
+}
+
+/**
+ * The \c BVM_AOT_ macro of an opcode that needs nothing but the frame.
+ *
+ * @param opcode the opcode
+ *
+ * @return the macro, or \c NULL if the opcode is not one of them
+ */
+static const char *aot_simple_macro(bvm_uint8_t opcode) {
+
+	switch (opcode) {
+		case OPCODE_nop:			return ";";
+		case OPCODE_aconst_null:	return "BVM_AOT_ACONST_NULL";
+		case OPCODE_lconst_0:		return "BVM_AOT_LCONST(0)";
+		case OPCODE_lconst_1:		return "BVM_AOT_LCONST(1)";
+		case OPCODE_pop:			return "BVM_AOT_POP";
+		case OPCODE_pop2:			return "BVM_AOT_POP2";
+		case OPCODE_dup:			return "BVM_AOT_DUP";
+		case OPCODE_dup_x1:			return "BVM_AOT_DUP_X1";
+		case OPCODE_dup_x2:			return "BVM_AOT_DUP_X2";
+		case OPCODE_dup2:			return "BVM_AOT_DUP2";
+		case OPCODE_dup2_x1:		return "BVM_AOT_DUP2_X1";
+		case OPCODE_dup2_x2:		return "BVM_AOT_DUP2_X2";
+		case OPCODE_swap:			return "BVM_AOT_SWAP";
+		case OPCODE_iadd:			return "BVM_AOT_IARITH(+)";
+		case OPCODE_isub:			return "BVM_AOT_IARITH(-)";
+		case OPCODE_imul:			return "BVM_AOT_IARITH(*)";
+		case OPCODE_iand:			return "BVM_AOT_IARITH(&)";
+		case OPCODE_ior:			return "BVM_AOT_IARITH(|)";
+		case OPCODE_ixor:			return "BVM_AOT_IARITH(^)";
+		case OPCODE_ineg:			return "BVM_AOT_INEG";
+		case OPCODE_ishl:			return "BVM_AOT_ISHL";
+		case OPCODE_ishr:			return "BVM_AOT_ISHR";
+		case OPCODE_iushr:			return "BVM_AOT_IUSHR";
+		case OPCODE_ladd:			return "BVM_AOT_LADD";
+		case OPCODE_lsub:			return "BVM_AOT_LSUB";
+		case OPCODE_lmul:			return "BVM_AOT_LMUL";
+		case OPCODE_land:			return "BVM_AOT_LLOGIC(&=)";
+		case OPCODE_lor:			return "BVM_AOT_LLOGIC(|=)";
+		case OPCODE_lxor:			return "BVM_AOT_LLOGIC(^=)";
+		case OPCODE_lneg:			return "BVM_AOT_LNEG";
+		case OPCODE_lshl:			return "BVM_AOT_LSHIFT(BVM_INT64_shl)";
+		case OPCODE_lshr:			return "BVM_AOT_LSHIFT(BVM_INT64_shr)";
+		case OPCODE_lushr:			return "BVM_AOT_LSHIFT(BVM_INT64_ushr)";
+		case OPCODE_lcmp:			return "BVM_AOT_LCMP";
+		case OPCODE_i2l:			return "BVM_AOT_I2L";
+		case OPCODE_l2i:			return "BVM_AOT_L2I";
+		case OPCODE_i2b:			return "BVM_AOT_I2B";
+		case OPCODE_i2c:			return "BVM_AOT_I2C";
+		case OPCODE_i2s:			return "BVM_AOT_I2S";
+	}
+
+	return NULL;
+}
+
+/**
+ * The \c BVM_AOT_ macro of an opcode that stops at its own pc where the interpreter would throw.
+ *
+ * @param opcode the opcode
+ *
+ * @return the macro name, or \c NULL if the opcode is not one of them
+ */
+static const char *aot_checked_macro(bvm_uint8_t opcode) {
+
+	switch (opcode) {
+		case OPCODE_idiv:			return "BVM_AOT_IDIV";
+		case OPCODE_irem:			return "BVM_AOT_IREM";
+		case OPCODE_ldiv:			return "BVM_AOT_LDIV";
+		case OPCODE_lrem:			return "BVM_AOT_LREM";
+		case OPCODE_arraylength:	return "BVM_AOT_ARRAYLENGTH";
+		case OPCODE_iaload:			return "BVM_AOT_IALOAD";
+		case OPCODE_laload:			return "BVM_AOT_LALOAD";
+		case OPCODE_baload:			return "BVM_AOT_BALOAD";
+		case OPCODE_caload:			return "BVM_AOT_CALOAD";
+		case OPCODE_saload:			return "BVM_AOT_SALOAD";
+		case OPCODE_iastore:		return "BVM_AOT_IASTORE";
+		case OPCODE_lastore:		return "BVM_AOT_LASTORE";
+		case OPCODE_bastore:		return "BVM_AOT_BASTORE";
+		case OPCODE_castore:		return "BVM_AOT_CASTORE";
+		case OPCODE_sastore:		return "BVM_AOT_SASTORE";
+	}
+
+	return NULL;
+}
+
+/**
+ * The C condition of a conditional branch opcode.
+ *
+ * @param opcode the opcode
+ *
+ * @return the condition, or \c NULL if the opcode is not a conditional branch
+ */
+static const char *aot_condition(bvm_uint8_t opcode) {
+
+	switch (opcode) {
+		case OPCODE_ifeq:			return "BVM_AOT_IF(==)";
+		case OPCODE_ifne:			return "BVM_AOT_IF(!=)";
+		case OPCODE_iflt:			return "BVM_AOT_IF(<)";
+		case OPCODE_ifge:			return "BVM_AOT_IF(>=)";
+		case OPCODE_ifgt:			return "BVM_AOT_IF(>)";
+		case OPCODE_ifle:			return "BVM_AOT_IF(<=)";
+		case OPCODE_if_icmpeq:		return "BVM_AOT_IF_ICMP(==)";
+		case OPCODE_if_icmpne:		return "BVM_AOT_IF_ICMP(!=)";
+		case OPCODE_if_icmplt:		return "BVM_AOT_IF_ICMP(<)";
+		case OPCODE_if_icmpge:		return "BVM_AOT_IF_ICMP(>=)";
+		case OPCODE_if_icmpgt:		return "BVM_AOT_IF_ICMP(>)";
+		case OPCODE_if_icmple:		return "BVM_AOT_IF_ICMP(<=)";
+		case OPCODE_if_acmpeq:		return "BVM_AOT_IF_ACMP(==)";
+		case OPCODE_if_acmpne:		return "BVM_AOT_IF_ACMP(!=)";
+		case OPCODE_ifnull:			return "BVM_AOT_IFNULL(==)";
+		case OPCODE_ifnonnull:		return "BVM_AOT_IFNULL(!=)";
+	}
+
+	return NULL;
+}
+
+/**
+ * Whether an opcode is translated.
+ *
+ * @param opcode the opcode
+ *
+ * @return #BVM_TRUE if it is
+ */
+static bvm_bool_t aot_is_translated(bvm_uint8_t opcode) {
+
+	if ( (aot_simple_macro(opcode) != NULL) || (aot_checked_macro(opcode) != NULL) || (aot_condition(opcode) != NULL) )
+		return BVM_TRUE;
+
+	return ( (opcode >= OPCODE_iconst_m1) && (opcode <= OPCODE_iconst_5) ) ||
+		   (opcode == OPCODE_bipush) || (opcode == OPCODE_sipush) ||
+		   ( (opcode >= OPCODE_iload) && (opcode <= OPCODE_aload_3) ) ||
+		   ( (opcode >= OPCODE_istore) && (opcode <= OPCODE_astore_3) ) ||
+		   (opcode == OPCODE_iinc) || (opcode == OPCODE_goto) || (opcode == OPCODE_goto_w) ||
+		   (opcode == OPCODE_tableswitch) || (opcode == OPCODE_lookupswitch);
+}
+
+/**
+ * The number of cells taken by the local loaded or stored by a load or store opcode.
+ *
+ * @param opcode a load or store opcode in the range \c iload to \c aload_3 or \c istore to \c astore_3
+ *
+ * @return \c 2 for a long or double, \c 1 otherwise
+ */
+static int aot_local_width(bvm_uint8_t opcode) {
+
+	if ( (opcode == OPCODE_lload) || (opcode == OPCODE_dload) || (opcode == OPCODE_lstore) || (opcode == OPCODE_dstore) )
+		return 2;
+
+	if ( (opcode >= OPCODE_lload_0) && (opcode <= OPCODE_lload_3) ) return 2;
+	if ( (opcode >= OPCODE_dload_0) && (opcode <= OPCODE_dload_3) ) return 2;
+	if ( (opcode >= OPCODE_lstore_0) && (opcode <= OPCODE_lstore_3) ) return 2;
+	if ( (opcode >= OPCODE_dstore_0) && (opcode <= OPCODE_dstore_3) ) return 2;
+
+	return 1;
+}
+
+/**
+ * The local index of a load or store opcode.
+ *
+ * @param code the bytecode
+ * @param pc_index the offset of the instruction
+ *
+ * @return the local index
+ */
+static bvm_uint32_t aot_local_index(bvm_uint8_t *code, bvm_uint32_t pc_index) {
+
+	bvm_uint8_t opcode = code[pc_index];
+
+	if (opcode <= OPCODE_aload) return code[pc_index + 1];
+	if (opcode < OPCODE_iaload) return (opcode - OPCODE_iload_0) & 3;
+	if (opcode <= OPCODE_astore) return code[pc_index + 1];
+
+	return (opcode - OPCODE_istore_0) & 3;
+}
+
+/**
+ * Write a branch from one instruction to another.  A backwards branch checks for a thread switch.
+ *
+ * @param writer the writer
+ * @param pc_index the offset of the branch instruction
+ * @param target the offset of the instruction branched to
+ */
+static void aot_out_branch(aot_writer_t *writer, bvm_uint32_t pc_index, bvm_int32_t target) {
+	aot_out(writer, (target <= (bvm_int32_t) pc_index) ? "BVM_AOT_BACK(%ld)" : "BVM_AOT_GOTO(%ld)", (long) target);
+}
+
+/**
+ * Write a \c case of a switch.  The most negative int is written so that it is an int to any C compiler.
+ *
+ * @param writer the writer
+ * @param key the key of the case
+ */
+static void aot_out_case(aot_writer_t *writer, bvm_int32_t key) {
+
+	if (key == BVM_MIN_INT)
+		aot_out(writer, "\t\tcase (-2147483647 - 1): ");
+	else
+		aot_out(writer, "\t\tcase %ld: ", (long) key);
+}
+
+/**
+ * Mark, or write the \c case of, each target of the branch or switch instruction at an offset.
+ *
+ * @param code the bytecode
+ * @param pc_index the offset of the instruction
+ * @param flags the offset flags to mark targets in, or \c NULL to write the \c case of each target of a switch
+ * @param writer the writer to write the \c cases with
+ */
+static void aot_targets(bvm_uint8_t *code, bvm_uint32_t pc_index, bvm_uint8_t *flags, aot_writer_t *writer) {
+
+	bvm_uint8_t opcode = code[pc_index];
+
+	if ( (opcode == OPCODE_tableswitch) || (opcode == OPCODE_lookupswitch) ) {
+
+		bvm_uint8_t *operands = code + pc_index + 1 + (3 - (pc_index & 3));
+		bvm_int32_t target = (bvm_int32_t) pc_index + BVM_VM2INT32(operands);
+		bvm_int32_t count, lc;
+
+		if (flags != NULL) flags[target] |= AOT_TARGET;
+
+		if (opcode == OPCODE_tableswitch) {
+
+			bvm_int32_t low = BVM_VM2INT32(operands + 4);
+			count = BVM_VM2INT32(operands + 8) - low + 1;
+
+			for (lc = 0; lc < count; lc++) {
+				target = (bvm_int32_t) pc_index + BVM_VM2INT32(operands + 12 + (lc * 4));
+				if (flags != NULL) {
+					flags[target] |= AOT_TARGET;
+				} else {
+					aot_out_case(writer, low + lc);
+					aot_out_branch(writer, pc_index, target);
+					aot_out(writer, "\n");
+				}
+			}
+		} else {
+
+			count = BVM_VM2INT32(operands + 4);
+
+			for (lc = 0; lc < count; lc++) {
+				target = (bvm_int32_t) pc_index + BVM_VM2INT32(operands + 12 + (lc * 8));
+				if (flags != NULL) {
+					flags[target] |= AOT_TARGET;
+				} else {
+					aot_out_case(writer, BVM_VM2INT32(operands + 8 + (lc * 8)));
+					aot_out_branch(writer, pc_index, target);
+					aot_out(writer, "\n");
+				}
+			}
+		}
+
+		if (flags == NULL) {
+			aot_out(writer, "\t\tdefault: ");
+			aot_out_branch(writer, pc_index, (bvm_int32_t) pc_index + BVM_VM2INT32(operands));
+			aot_out(writer, "\n");
+		}
+	}
+	else if (opcode == OPCODE_goto_w) {
+		if (flags != NULL) flags[(bvm_int32_t) pc_index + BVM_VM2INT32(code + pc_index + 1)] |= AOT_TARGET;
+	}
+	else if ( (opcode == OPCODE_goto) || (aot_condition(opcode) != NULL) ) {
+		if (flags != NULL) flags[(bvm_int32_t) pc_index + BVM_VM2INT16(code + pc_index + 1)] |= AOT_TARGET;
+	}
+}
+
+/**
+ * Write the C of a translated instruction.
+ *
+ * @param writer the writer
+ * @param code the bytecode
+ * @param pc_index the offset of the instruction
+ */
+static void aot_out_instruction(aot_writer_t *writer, bvm_uint8_t *code, bvm_uint32_t pc_index) {
+
+	bvm_uint8_t opcode = code[pc_index];
+	const char *macro;
+
+	if ( (macro = aot_simple_macro(opcode)) != NULL) {
+		aot_out(writer, "%s", macro);
+	}
+	else if ( (macro = aot_checked_macro(opcode)) != NULL) {
+		aot_out(writer, "%s(%lu)", macro, (unsigned long) pc_index);
+	}
+	else if ( (macro = aot_condition(opcode)) != NULL) {
+		aot_out(writer, "if %s ", macro);
+		aot_out_branch(writer, pc_index, (bvm_int32_t) pc_index + BVM_VM2INT16(code + pc_index + 1));
+	}
+	else if ( (opcode >= OPCODE_iconst_m1) && (opcode <= OPCODE_iconst_5) ) {
+		aot_out(writer, "BVM_AOT_ICONST(%d)", (int) opcode - OPCODE_iconst_0);
+	}
+	else if (opcode == OPCODE_bipush) {
+		aot_out(writer, "BVM_AOT_ICONST(%d)", (int) (bvm_int8_t) code[pc_index + 1]);
+	}
+	else if (opcode == OPCODE_sipush) {
+		aot_out(writer, "BVM_AOT_ICONST(%d)", (int) BVM_VM2INT16(code + pc_index + 1));
+	}
+	else if ( (opcode >= OPCODE_iload) && (opcode <= OPCODE_aload_3) ) {
+		aot_out(writer, (aot_local_width(opcode) == 2) ? "BVM_AOT_LOAD2(%lu)" : "BVM_AOT_LOAD(%lu)",
+				(unsigned long) aot_local_index(code, pc_index));
+	}
+	else if ( (opcode >= OPCODE_istore) && (opcode <= OPCODE_astore_3) ) {
+		aot_out(writer, (aot_local_width(opcode) == 2) ? "BVM_AOT_STORE2(%lu)" : "BVM_AOT_STORE(%lu)",
+				(unsigned long) aot_local_index(code, pc_index));
+	}
+	else if (opcode == OPCODE_iinc) {
+		aot_out(writer, "BVM_AOT_IINC(%u, %d)", (unsigned) code[pc_index + 1], (int) (bvm_int8_t) code[pc_index + 2]);
+	}
+	else if (opcode == OPCODE_goto) {
+		aot_out_branch(writer, pc_index, (bvm_int32_t) pc_index + BVM_VM2INT16(code + pc_index + 1));
+	}
+	else if (opcode == OPCODE_goto_w) {
+		aot_out_branch(writer, pc_index, (bvm_int32_t) pc_index + BVM_VM2INT32(code + pc_index + 1));
+	}
+	else if ( (opcode == OPCODE_tableswitch) || (opcode == OPCODE_lookupswitch) ) {
+		aot_out(writer, "switch (BVM_AOT_SWITCH) {\n");
+		aot_targets(code, pc_index, NULL, writer);
+		aot_out(writer, "\t\t}");
+	}
+}
+
+/**
+ * Write the C function translating a recorded method.  Nothing is written for a method with no instruction that is
+ * translated.
+ *
+ * @param writer the writer
+ * @param record the recorded method
+ * @param id the number of the function
+ *
+ * @return #BVM_TRUE if a function was written
+ */
+static bvm_bool_t aot_out_method(aot_writer_t *writer, aot_record_t *record, bvm_uint32_t id) {
+
+	bvm_uint8_t *code = record->data + record->clazzname_length + record->name_length + record->desc_length;
+	bvm_uint32_t code_length = record->code_length;
+	bvm_uint32_t pc_index, length, run_start = 0, run_length = 0, translated = 0;
+	bvm_bool_t falls_through = BVM_FALSE;
+	bvm_uint8_t *flags = bvm_pd_memory_alloc(code_length + 1);
+
+	if (flags == NULL) return BVM_FALSE;
+
+	memset(flags, 0, code_length + 1);
+
+	/* first, find the instructions and which of them can be translated */
+	for (pc_index = 0; pc_index < code_length; pc_index += length) {
+
+		bvm_uint8_t opcode = code[pc_index];
+
+		length = bvm_exec_instruction_length(code, pc_index, opcode);
+
+		/* being defensive - give up on anything that runs off the end of the method */
+		if ( (length == 0) || (length > code_length - pc_index) ) {
+			bvm_pd_memory_free(flags);
+			return BVM_FALSE;
+		}
+
+		flags[pc_index] |= AOT_INSTRUCTION;
+
+		if (aot_is_translated(opcode)) flags[pc_index] |= AOT_TRANSLATED;
+	}
+
+	/* then leave runs too short to be worth it to the interpreter.  The extra offset at the end ends the last run. */
+	flags[code_length] = AOT_INSTRUCTION;
+
+	for (pc_index = 0; pc_index <= code_length; pc_index++) {
+
+		if ( (flags[pc_index] & AOT_INSTRUCTION) == 0) continue;
+
+		if (flags[pc_index] & AOT_TRANSLATED) {
+			if (run_length++ == 0) run_start = pc_index;
+			continue;
+		}
+
+		if (run_length >= AOT_MIN_RUN)
+			translated += run_length;
+		else if (run_length > 0)
+			for (; run_start < pc_index; run_start++) flags[run_start] &= ~AOT_TRANSLATED;
+
+		run_length = 0;
+	}
+
+	/* and mark the targets of the branches that are left */
+	for (pc_index = 0; pc_index < code_length; pc_index++)
+		if (flags[pc_index] & AOT_TRANSLATED) aot_targets(code, pc_index, flags, NULL);
+
+	if (translated == 0) {
+		bvm_pd_memory_free(flags);
+		return BVM_FALSE;
+	}
+
+	aot_out(writer, "\n/* ");
+	aot_out_string(writer, record->data, record->clazzname_length);
+	aot_out(writer, " ");
+	aot_out_string(writer, record->data + record->clazzname_length, record->name_length);
+	aot_out(writer, " ");
+	aot_out_string(writer, record->data + record->clazzname_length + record->name_length, record->desc_length);
+	aot_out(writer, " */\nstatic bvm_int32_t aot_method_%lu(bvm_cell_t *l, bvm_cell_t **sp, bvm_int32_t pc) {\n", (unsigned long) id);
+	aot_out(writer, "\tBVM_AOT_ENTER\n\tswitch (pc) {\n\t\tdefault: BVM_AOT_STOP(pc)\n");
+
+	/* then write each translated instruction as a case, and a stop for each that is not but may be reached */
+	for (pc_index = 0; pc_index < code_length; pc_index++) {
+
+		bvm_uint8_t opcode;
+
+		if ( (flags[pc_index] & AOT_INSTRUCTION) == 0) continue;
+
+		opcode = code[pc_index];
+
+		if (flags[pc_index] & AOT_TRANSLATED) {
+
+			aot_out(writer, "\t\tcase %lu: ", (unsigned long) pc_index);
+			if (flags[pc_index] & AOT_TARGET) aot_out(writer, "L%lu: ", (unsigned long) pc_index);
+			aot_out_instruction(writer, code, pc_index);
+			aot_out(writer, "\n");
+
+			falls_through = (opcode != OPCODE_goto) && (opcode != OPCODE_goto_w) &&
+							(opcode != OPCODE_tableswitch) && (opcode != OPCODE_lookupswitch);
+		}
+		else if (falls_through || (flags[pc_index] & AOT_TARGET) ) {
+
+			aot_out(writer, "\t\t");
+			if (flags[pc_index] & AOT_TARGET) aot_out(writer, "L%lu: ", (unsigned long) pc_index);
+			aot_out(writer, "BVM_AOT_STOP(%lu)\n", (unsigned long) pc_index);
+
+			falls_through = BVM_FALSE;
+		}
+	}
+
+	aot_out(writer, "\t}\n\tBVM_AOT_STOP(pc)\n}\n");
+
+	bvm_pd_memory_free(flags);
+
+	return BVM_TRUE;
+}
+
+/**
+ * Write the translations of the recorded methods to a C file.  An existing file is overwritten.
+ *
+ * @param filename the name of the C file
+ *
+ * @return #BVM_TRUE if the file was written, #BVM_FALSE if it could not be opened or written
+ */
+bvm_bool_t bvm_aot_write(const char *filename) {
+
+	aot_writer_t writer;
+	aot_record_t *record;
+	bvm_uint32_t id = 0, count = 0;
+	bvm_uint8_t *written;
+
+	writer.handle = bvm_pd_file_open(filename, BVM_FILE_O_WRONLY | BVM_FILE_O_TRUNC);
+	writer.ok = (writer.handle != NULL);
+
+	if (!writer.ok) return BVM_FALSE;
+
+	for (record = aot_records; record != NULL; record = record->next) count++;
+
+	/* which records had a function written */
+	written = bvm_pd_memory_alloc(count + 1);
+	if (written == NULL) {
+		bvm_pd_file_close(writer.handle);
+		return BVM_FALSE;
+	}
+
+	aot_out(&writer, "/* Methods translated to C by the BabeVM -aotwrite option.  Link into the VM with -DBVM_AOT_SOURCE.\n");
+	aot_out(&writer, " * Generated - do not edit.  Write it again whenever the classes or the VM change. */\n\n");
+	aot_out(&writer, "#include \"../h/bvm.h\"\n\n#if BVM_AOT_ENABLE\n");
+
+	for (record = aot_records; writer.ok && (record != NULL); record = record->next, id++)
+		written[id] = aot_out_method(&writer, record, id);
+
+	aot_out(&writer, "\nvoid bvm_aot_register_methods() {\n");
+
+	for (id = 0, record = aot_records; writer.ok && (record != NULL); record = record->next, id++) {
+
+		if (!written[id]) continue;
+
+		aot_out(&writer, "\tbvm_native_method_pool_register_aot(");
+		aot_out_string(&writer, record->data, record->clazzname_length);
+		aot_out(&writer, ", ");
+		aot_out_string(&writer, record->data + record->clazzname_length, record->name_length);
+		aot_out(&writer, ", ");
+		aot_out_string(&writer, record->data + record->clazzname_length + record->name_length, record->desc_length);
+		aot_out(&writer, ", aot_method_%lu, 0x%08lXU);\n", (unsigned long) id, (unsigned long) record->hash);
+	}
+
+	aot_out(&writer, "}\n\n#endif\n");
+
+	bvm_pd_memory_free(written);
+
+	if (bvm_pd_file_close(writer.handle) == BVM_ERR) writer.ok = BVM_FALSE;
+
+	return writer.ok;
+}
+
+/**
+ * Free the recorded methods at VM exit.
+ */
+void bvm_aot_release() {
+
+	aot_record_t *record;
+
+	while ( (record = aot_records) != NULL) {
+		aot_records = record->next;
+		bvm_pd_memory_free(record);
+	}
+
+	aot_records_last = NULL;
+}
+
+#endif
@@ -0,0 +1,377 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#include "../h/bvm.h"
+
+/**
+
+ @file
+
+ Classpath lookup caching.
+
+ @section ov Overview
+
+ To find a class file a class loader tries each segment of its classpath in turn - opening a file for a directory
+ segment, or looking in the directory of a jar segment - after first delegating to its parent loader.  Looking for a
+ class that is not there costs all of that every time, and it is common enough - optional feature probes with
+ \c Class.forName() and the parent delegation misses of every class a user class loader loads.  When
+ #BVM_CLASSPATH_INDEX_ENABLE is set two things make those lookups cheap.
+
+ @section index Boot Classpath Index
+
+ The first time the bootstrap class loader looks for a class it builds one hash table of the classes in all the jars
+ on the boot classpath, giving for each class name the first jar segment it is in.  From then on the bootstrap
+ loader need only look in the jar the index names for a class (if any), and in the boot classpath segments that are
+ not indexed (directories, and jars that could not be opened).  A class that is in none of the jars is not looked
+ for in any of them.  The names in the index point into the in-memory central directories of the jars (see
+ #BVM_JAR_DIRECTORY_INDEX_ENABLE, without which there is no index), so the index is just a few words per class.
+
+ @section missing Missing Classes
+
+ Each class loader (including the bootstrap loader) remembers the names of the classes it did not find on its own
+ classpath.  A class loader does not look for a remembered class on its classpath again - it goes straight to
+ reporting the class as not found (or to the next loader in the delegation chain).  A class the bootstrap loader knows
+ is missing from the boot classpath index alone is not remembered - it is no quicker to find missing a second time.
+ The class path of a loader is taken as fixed for the life of the loader - a user loader's missing classes are
+ remembered against its classpath array as well as the loader itself - and a class file that appears in a directory
+ on a classpath after it was looked for is not seen.
+
+ There may be at most #BVM_CLASSPATH_MISSING_MAX missing classes remembered.  When there are that many, all are
+ forgotten and remembering starts again.  The missing classes of a class loader are forgotten when the class loader is
+ found to be unreachable by the garbage collector.
+
+ The index and the missing classes are held in memory from #bvm_pd_memory_alloc, not the heap.
+
+ @author Greg McCreath
+ @since 0.0.10
+
+*/
+
+#if BVM_CLASSPATH_INDEX_ENABLE
+
+/** The number of hash buckets of missing classes */
+#define CP_MISSING_BUCKETCOUNT	64
+
+/**
+ * A class in a jar on the boot classpath.
+ */
+typedef struct _cpindexentrystruct {
+
+	/** the internal name of the class (without ".class") - points into the central directory of the jar. \c NULL for
+	 * an empty slot. */
+	bvm_uint8_t *name;
+
+	/** the hash of the name */
+	bvm_uint32_t hash;
+
+	/** the length of the name */
+	bvm_uint16_t length;
+
+	/** the boot classpath segment of the jar */
+	bvm_uint16_t segment;
+
+} cp_index_entry_t;
+
+/**
+ * A class not found on the classpath of a class loader.
+ */
+typedef struct _cpmissingstruct {
+
+	/** the next missing class in the same hash bucket */
+	struct _cpmissingstruct *next;
+
+	/** the class loader - \c NULL for the bootstrap class loader */
+	bvm_classloader_obj_t *classloader_obj;
+
+	/** the classpath of the class loader when the class was not found - \c NULL for the bootstrap class loader */
+	struct _bvminstancearraystruct *paths_array;
+
+	/** the hash of the class name */
+	bvm_uint32_t hash;
+
+	/** the length of the class name */
+	bvm_uint16_t length;
+
+	/** the class name.  The actual size of the array is determined at runtime */
+	bvm_uint8_t name[1];
+
+} cp_missing_t;
+
+/** The boot classpath index - an open addressed hash table of the classes in the boot classpath jars */
+static BVM_VM_LOCAL cp_index_entry_t *cp_boot_index = NULL;
+
+/** The number of slots in #cp_boot_index less one - the slot count is a power of two */
+static BVM_VM_LOCAL bvm_uint32_t cp_boot_index_mask = 0;
+
+/** Whether the boot classpath index has been built (or an attempt made to) */
+static BVM_VM_LOCAL bvm_bool_t cp_boot_index_built = BVM_FALSE;
+
+/** Whether each boot classpath segment is a jar in the boot classpath index */
+static BVM_VM_LOCAL bvm_bool_t cp_boot_indexed[BVM_MAX_CLASSPATH_SEGMENTS];
+
+/** Hash buckets of missing classes */
+static BVM_VM_LOCAL cp_missing_t *cp_missing[CP_MISSING_BUCKETCOUNT];
+
+/** The number of missing classes remembered */
+static BVM_VM_LOCAL bvm_uint32_t cp_missing_count = 0;
+
+#if BVM_JAR_DIRECTORY_INDEX_ENABLE
+
+/** The length of a class name within a jar file path name of a class file, or zero if it is not a class file */
+#define CP_CLASS_NAME_LENGTH(p, l)	( ( ((l) > 6) && (memcmp((p) + (l) - 6, ".class", 6) == 0) ) ? (l) - 6 : 0 )
+
+/**
+ * Jar file callback to count the class files in a jar.
+ *
+ * @param pathname the path name of a file in the jar
+ * @param pathlen the length of the path name
+ * @param data points to the count
+ */
+static void cp_count_class(bvm_uint8_t *pathname, bvm_uint32_t pathlen, void *data) {
+	if (CP_CLASS_NAME_LENGTH(pathname, pathlen) > 0) (*(bvm_uint32_t *) data)++;
+}
+
+/**
+ * Jar file callback to add a class file to the boot classpath index.  A class already in the index (from an earlier
+ * segment) is left as is - the bootstrap loader would find it there first.
+ *
+ * @param pathname the path name of a file in the jar
+ * @param pathlen the length of the path name
+ * @param data points to the boot classpath segment of the jar
+ */
+static void cp_index_class(bvm_uint8_t *pathname, bvm_uint32_t pathlen, void *data) {
+
+	bvm_uint32_t length, hash, slot;
+	cp_index_entry_t *entry;
+
+	if ( (length = CP_CLASS_NAME_LENGTH(pathname, pathlen)) == 0) return;
+
+	hash = bvm_calchash(pathname, length);
+
+	for (slot = hash & cp_boot_index_mask; (entry = &cp_boot_index[slot])->name != NULL; slot = (slot + 1) & cp_boot_index_mask) {
+		if ( (entry->hash == hash) && (entry->length == length) && (memcmp(entry->name, pathname, length) == 0) ) return;
+	}
+
+	entry->name = pathname;
+	entry->hash = hash;
+	entry->length = (bvm_uint16_t) length;
+	entry->segment = *(bvm_uint16_t *) data;
+}
+
+/**
+ * Is a boot classpath segment a jar (it ends with ".jar")?
+ */
+static bvm_bool_t cp_is_jar(const char *segment) {
+	size_t len = strlen(segment);
+	return ( (len > 4) && (strcmp(segment + len - 4, ".jar") == 0) );
+}
+
+#endif
+
+/**
+ * Build the boot classpath index.  The index is built from the jars on the boot classpath in two passes - one to
+ * count the classes, and one to add them to the index.  The segments are only marked as indexed when the index is
+ * complete.  If the index cannot be built (no memory, or an exception opening a jar) no segment is indexed and the
+ * bootstrap class loader looks in every segment as usual.
+ */
+static void cp_build_boot_index() {
+
+#if BVM_JAR_DIRECTORY_INDEX_ENABLE
+
+	bvm_bool_t indexed[BVM_MAX_CLASSPATH_SEGMENTS];
+	bvm_uint32_t count = 0, slots, lc;
+	bvm_uint16_t segment;
+	char *path;
+
+	/* only the one go at it */
+	cp_boot_index_built = BVM_TRUE;
+
+	for (lc = 0; (lc < BVM_MAX_CLASSPATH_SEGMENTS) && ( (path = bvm_gl_boot_classpath_segments[lc]) != NULL); lc++)
+		indexed[lc] = (cp_is_jar(path) && bvm_zip_for_each_file(path, cp_count_class, &count));
+
+	/* at least twice as many slots as classes keeps the probe chains short */
+	for (slots = 16; slots < count * 2; slots <<= 1);
+
+	if ( (cp_boot_index = bvm_pd_memory_alloc(slots * sizeof(cp_index_entry_t))) == NULL) return;
+
+	memset(cp_boot_index, 0, slots * sizeof(cp_index_entry_t));
+	cp_boot_index_mask = slots - 1;
+
+	for (segment = 0; segment < lc; segment++) {
+		if (indexed[segment]) bvm_zip_for_each_file(bvm_gl_boot_classpath_segments[segment], cp_index_class, &segment);
+	}
+
+	memcpy(cp_boot_indexed, indexed, lc * sizeof(bvm_bool_t));
+
+#else
+	cp_boot_index_built = BVM_TRUE;
+#endif
+}
+
+/**
+ * Find the boot classpath jar segment of a class.  The boot classpath index is built the first time this is called.
+ *
+ * @param clazzname the internal name of the class
+ *
+ * @return the first boot classpath jar segment with the class in it, or #BVM_CLASSPATH_NO_SEGMENT if it is in no
+ * indexed jar.
+ */
+int bvm_classpath_boot_segment(bvm_utfstring_t *clazzname) {
+
+	bvm_uint32_t hash, slot;
+	cp_index_entry_t *entry;
+
+	if (!cp_boot_index_built) cp_build_boot_index();
+
+	if (cp_boot_index == NULL) return BVM_CLASSPATH_NO_SEGMENT;
+
+	hash = BVM_UTFSTRING_HASH(clazzname);
+
+	for (slot = hash & cp_boot_index_mask; (entry = &cp_boot_index[slot])->name != NULL; slot = (slot + 1) & cp_boot_index_mask) {
+		if ( (entry->hash == hash) && (entry->length == clazzname->length) && (memcmp(entry->name, clazzname->data, entry->length) == 0) )
+			return entry->segment;
+	}
+
+	return BVM_CLASSPATH_NO_SEGMENT;
+}
+
+/**
+ * Is a boot classpath segment a jar in the boot classpath index?  If so, the bootstrap class loader need only
+ * look for a class in it if #bvm_classpath_boot_segment gives the segment for the class.
+ *
+ * @param segment the boot classpath segment index
+ */
+bvm_bool_t bvm_classpath_boot_is_indexed(bvm_uint32_t segment) {
+	return (cp_boot_index != NULL) && cp_boot_indexed[segment];
+}
+
+/**
+ * Has a class been remembered as not on the classpath of a class loader?
+ *
+ * @param classloader_obj the class loader
+ * @param clazzname the internal name of the class
+ */
+bvm_bool_t bvm_classpath_is_missing(bvm_classloader_obj_t *classloader_obj, bvm_utfstring_t *clazzname) {
+
+	cp_missing_t *missing;
+	bvm_uint32_t hash = BVM_UTFSTRING_HASH(clazzname);
+
+	struct _bvminstancearraystruct *paths_array =
+		(classloader_obj == BVM_BOOTSTRAP_CLASSLOADER_OBJ) ? NULL : classloader_obj->paths_array;
+
+	for (missing = cp_missing[hash % CP_MISSING_BUCKETCOUNT]; missing != NULL; missing = missing->next) {
+		if ( (missing->hash == hash) &&
+			 (missing->classloader_obj == classloader_obj) &&
+			 (missing->paths_array == paths_array) &&
+			 (missing->length == clazzname->length) &&
+			 (memcmp(missing->name, clazzname->data, missing->length) == 0) ) return BVM_TRUE;
+	}
+
+	return BVM_FALSE;
+}
+
+/**
+ * Forget all the missing classes.
+ */
+static void cp_clear_missing() {
+
+	bvm_uint32_t lc;
+
+	for (lc = 0; lc < CP_MISSING_BUCKETCOUNT; lc++) {
+		while (cp_missing[lc] != NULL) {
+			cp_missing_t *next = cp_missing[lc]->next;
+			bvm_pd_memory_free(cp_missing[lc]);
+			cp_missing[lc] = next;
+		}
+	}
+
+	cp_missing_count = 0;
+}
+
+/**
+ * Remember a class as not on the classpath of a class loader.  If there is no memory for it, it is just not
+ * remembered.
+ *
+ * @param classloader_obj the class loader
+ * @param clazzname the internal name of the class
+ */
+void bvm_classpath_add_missing(bvm_classloader_obj_t *classloader_obj, bvm_utfstring_t *clazzname) {
+
+	cp_missing_t *missing;
+	bvm_uint32_t bucket;
+
+	if (cp_missing_count >= BVM_CLASSPATH_MISSING_MAX) cp_clear_missing();
+
+	if ( (missing = bvm_pd_memory_alloc(sizeof(cp_missing_t) + clazzname->length)) == NULL) return;
+
+	missing->classloader_obj = classloader_obj;
+	missing->paths_array = (classloader_obj == BVM_BOOTSTRAP_CLASSLOADER_OBJ) ? NULL : classloader_obj->paths_array;
+	missing->hash = BVM_UTFSTRING_HASH(clazzname);
+	missing->length = clazzname->length;
+	memcpy(missing->name, clazzname->data, clazzname->length);
+
+	bucket = missing->hash % CP_MISSING_BUCKETCOUNT;
+	missing->next = cp_missing[bucket];
+	cp_missing[bucket] = missing;
+
+	cp_missing_count++;
+}
+
+/**
+ * Forget the missing classes of class loaders that have not been marked by a GC.  Called by the garbage collector
+ * after marking and before sweeping.  The missing classes of the bootstrap loader are never forgotten this way.
+ */
+void bvm_classpath_purge_missing() {
+
+	bvm_uint32_t lc;
+
+	for (lc = 0; lc < CP_MISSING_BUCKETCOUNT; lc++) {
+
+		cp_missing_t **link = &cp_missing[lc];
+
+		while (*link != NULL) {
+
+			cp_missing_t *missing = *link;
+
+			if ( (missing->classloader_obj != BVM_BOOTSTRAP_CLASSLOADER_OBJ) &&
+				 (BVM_CHUNK_GetColour(BVM_CHUNK_GetPointerChunk(missing->classloader_obj)) == BVM_GC_COLOUR_WHITE) ) {
+				*link = missing->next;
+				bvm_pd_memory_free(missing);
+				cp_missing_count--;
+			} else
+				link = &missing->next;
+		}
+	}
+}
+
+/**
+ * Free the boot classpath index and the missing classes.
+ */
+void bvm_classpath_release() {
+
+	cp_clear_missing();
+
+	if (cp_boot_index != NULL) {
+		bvm_pd_memory_free(cp_boot_index);
+		cp_boot_index = NULL;
+	}
+
+	cp_boot_index_built = BVM_FALSE;
+}
+
+#endif
@@ -188,6 +188,16 @@ typedef struct _clazzfilebufferstruct {
 	bvm_filebuffer_t *buffer;
 } classfilebuffer_t;
 
+#if BVM_CLAZZ_MEMBER_INDEX_ENABLE
+
+/**
+ * The hash of a member name and signature for the clazz member indexes.  Both are pointers into the utfstring pool,
+ * so it is the pointers that are hashed, not the strings.  The low bits of a heap pointer are always zero.
+ */
+#define CLAZZ_MEMBER_HASH(n, s) ( (bvm_uint32_t) ( ( ((bvm_native_ulong_t) (n)) >> 3) * 31 + ( ((bvm_native_ulong_t) (s)) >> 3) ) )
+
+#endif
+
 /**
  * Find a method for a class.
  *
@@ -231,6 +241,24 @@ bvm_method_t *bvm_clazz_method_get(bvm_instance_clazz_t *clazz, bvm_utfstring_t
 		/* first search methods defined by the given class */
 		if ( (mode & BVM_METHOD_SEARCH_CLAZZ) > 0) {
 
+#if BVM_CLAZZ_MEMBER_INDEX_ENABLE
+			if (clazz->method_index != NULL) {
+
+				bvm_uint32_t slot = CLAZZ_MEMBER_HASH(name, jni_signature) & clazz->method_index_mask;
+
+				/* probe until the method or an empty slot is found */
+				while ( (lc = clazz->method_index[slot]) != 0) {
+
+					method = &clazz->methods[lc-1];
+
+					if ( (name == method->name) && (jni_signature == method->jni_signature) ) {
+						return method;
+					}
+
+					slot = (slot + 1) & clazz->method_index_mask;
+				}
+			} else
+#endif
 			for (lc = clazz->methods_count; lc--;) {
 
 				method = &clazz->methods[lc];
@@ -339,7 +367,7 @@ static void clazz_load_cp(bvm_instance_clazz_t *clazz, bvm_filebuffer_t *buffer)
 	 * an integer operation each time we access one.  We'll (smartly) use the first
 	 * constant to hold the number of constants (so the space is not wasted) */
 
-	clazz->constant_pool = bvm_heap_calloc( (count+1) * (sizeof(bvm_clazzconstant_t) + sizeof(bvm_uint8_t)), BVM_ALLOC_TYPE_STATIC);
+	clazz->constant_pool = bvm_heap_calloc( (count+1) * (sizeof(bvm_clazzconstant_t) + sizeof(bvm_uint8_t)), BVM_ALLOC_TYPE_CLAZZ_METADATA(clazz));
 
 	/* the 0'th constant's value holds the number of constants */
 	clazz->constant_pool[0].data.value.int_value = count;
@@ -361,26 +389,9 @@ static void clazz_load_cp(bvm_instance_clazz_t *clazz, bvm_filebuffer_t *buffer)
 		switch (tag) {
 			case BVM_CONSTANT_Utf8: {
 
-				bvm_utfstring_t *str, *pooled_str;
-
-				/* utf8string get resolved immediately - they are added to the utfstring pool if they are not there
-				 * straight away */
-				str = bvm_file_read_utfstring(buffer, BVM_ALLOC_TYPE_STATIC);
-
-				/* Now we'll check to see if this new string is actually already contained in the
-				 * utfstring pool.  If it is we'll use the one in the pool and discard this newly
-				 * created one - if not, the BVM_TRUE param here will ensure it is added to the pool.
-				 */
-				pooled_str = bvm_utfstring_pool_get(str, BVM_TRUE);
-
-				/* If the pointer we get back is not the one we passed in there must have already
-				 * been a string in the pool, so we'll free the one just created.  */
-				if (pooled_str != str) {
-					bvm_heap_free(str);
-					constant->data.value.ptr_value = pooled_str;
-				} else {
-					constant->data.value.ptr_value = str;
-				}
+				/* utf8string get resolved immediately - the pooled string for the chars is used, and it is only
+				 * created (and added to the utfstring pool) if it is not there already */
+				constant->data.value.ptr_value = bvm_file_read_pooled_utfstring(buffer);
 
 				break;
 			}
@@ -558,6 +569,38 @@ bvm_utfstring_t *bvm_clazz_cp_ref_sig(bvm_instance_clazz_t *clazz, bvm_uint16_t
 }
 
 
+#if BVM_EXEC_ACCESSOR_INLINING_ENABLE
+
+/**
+ * Is a method a trivial getter or setter of a field of its own object?  A getter is exactly \c aload_0,
+ * \c getfield and a single cell return.  A setter is exactly \c aload_0, a single cell load of the first argument,
+ * \c putfield and \c return.  Static and synchronized methods are never accessors.
+ *
+ * @param method the method, with its bytecode loaded
+ * @param code_length the length of its bytecode
+ *
+ * @return the kind of accessor, or #BVM_METHOD_ACCESSOR_NONE.
+ */
+static bvm_uint8_t clazz_method_accessor(bvm_method_t *method, bvm_uint32_t code_length) {
+
+	bvm_uint8_t *code = method->code.bytecode;
+
+	if (BVM_METHOD_IsStatic(method) || BVM_METHOD_IsSynchronized(method) || (code[0] != OPCODE_aload_0))
+		return BVM_METHOD_ACCESSOR_NONE;
+
+	if ( (code_length == 5) && (code[1] == OPCODE_getfield) &&
+		 ( (code[4] == OPCODE_ireturn) || (code[4] == OPCODE_freturn) || (code[4] == OPCODE_areturn) ) )
+		return BVM_METHOD_ACCESSOR_GETTER;
+
+	if ( (code_length == 6) && (code[2] == OPCODE_putfield) && (code[5] == OPCODE_return) &&
+		 ( (code[1] == OPCODE_iload_1) || (code[1] == OPCODE_fload_1) || (code[1] == OPCODE_aload_1) ) )
+		return BVM_METHOD_ACCESSOR_SETTER;
+
+	return BVM_METHOD_ACCESSOR_NONE;
+}
+
+#endif
+
 /**
  * Parse and load direct superinterfaces for a given clazz.  Note this will have the effect
  * of recursing up and loading all superinterfaces and their parents and so on.
@@ -578,7 +621,7 @@ static void clazz_load_interfaces(bvm_instance_clazz_t *clazz, bvm_filebuffer_t
 	if (interfaces_count > 0) {
 
 		/* allocate memory for the array of interfaces */
-		clazz->interfaces = bvm_heap_calloc(interfaces_count * sizeof(bvm_instance_clazz_t *), BVM_ALLOC_TYPE_STATIC);
+		clazz->interfaces = bvm_heap_calloc(interfaces_count * sizeof(bvm_instance_clazz_t *), BVM_ALLOC_TYPE_CLAZZ_METADATA(clazz));
 
 		/* for each direct superinterface of the class */
 		for (lc = 0; lc < interfaces_count; lc ++) {
@@ -606,6 +649,119 @@ static void clazz_load_interfaces(bvm_instance_clazz_t *clazz, bvm_filebuffer_t
 	}
 }
 
+/**
+ * Build the flattened list of instance reference field offsets for a clazz - the offsets of the superclass list
+ * followed by those of the reference fields declared in the clazz itself.  The superclass must already be loaded
+ * and the clazz fields must already be sorted into statics then virtuals.
+ *
+ * @param clazz the clazz
+ */
+static void clazz_build_ref_field_offsets(bvm_instance_clazz_t *clazz) {
+
+	bvm_instance_clazz_t *super_clazz = clazz->super_clazz;
+	bvm_uint16_t super_count = (super_clazz != NULL) ? super_clazz->ref_fields_count : 0;
+	bvm_uint16_t count = super_count;
+	bvm_uint16_t lc;
+
+	/* count the reference fields declared in this class */
+	for (lc = clazz->virtual_field_offset; lc < clazz->fields_count; lc++) {
+		if (BVM_FIELD_IsReference(&clazz->fields[lc])) count++;
+	}
+
+	clazz->ref_fields_count = count;
+
+	if (count == 0) return;
+
+	clazz->ref_field_offsets = bvm_heap_alloc(count * sizeof(bvm_uint16_t), BVM_ALLOC_TYPE_CLAZZ_METADATA(clazz));
+
+	/* inherited offsets first */
+	if (super_count > 0)
+		memcpy(clazz->ref_field_offsets, super_clazz->ref_field_offsets, super_count * sizeof(bvm_uint16_t));
+
+	count = super_count;
+
+	for (lc = clazz->virtual_field_offset; lc < clazz->fields_count; lc++) {
+		bvm_field_t *field = &clazz->fields[lc];
+		if (BVM_FIELD_IsReference(field))
+			clazz->ref_field_offsets[count++] = (bvm_uint16_t) field->value.offset;
+	}
+}
+
+#if BVM_FIELD_PACKING_ENABLE
+
+/** Are the primitive instance fields of the clazz packed?  Not for the bootstrap classloader - see
+ * #BVM_FIELD_PACKING_ENABLE */
+#define CLAZZ_PacksFields(c) ((c)->classloader_obj != BVM_BOOTSTRAP_CLASSLOADER_OBJ)
+
+/**
+ * The width in bytes of a packed field.
+ */
+static bvm_uint32_t clazz_packed_width(bvm_field_t *field) {
+	switch (field->packed_type) {
+		case 'J':
+		case 'D':
+			return 8;
+		case 'C':
+		case 'S':
+			return 2;
+		case 'B':
+		case 'Z':
+			return 1;
+		default:
+			return 4;
+	}
+}
+
+/**
+ * Lay out the primitive instance fields declared in a clazz whose fields are packed.  By now the inherited fields and
+ * the reference fields declared by the clazz have a cell each.  The primitive fields follow them, widest first so
+ * each is naturally aligned, and the lot is rounded up to whole cells.  A long or double is kept as its two 32 bit
+ * halves, so needs no more than 4 byte alignment on a 32 bit host.
+ *
+ * The offset of a field is 16 bits, so a clazz whose packed fields would reach beyond that (a lot of fields) is given
+ * its cells after all.
+ *
+ * @param clazz the clazz
+ */
+static void clazz_pack_fields(bvm_instance_clazz_t *clazz) {
+
+	bvm_uint32_t offset = clazz->instance_fields_count * sizeof(bvm_cell_t);
+	bvm_uint32_t width, lc;
+	bvm_bool_t fits;
+
+	for (lc = 0; lc < clazz->fields_count; lc++) {
+		bvm_field_t *field = &clazz->fields[lc];
+		if (!BVM_FIELD_IsStatic(field) && !BVM_FIELD_IsReference(field)) offset += clazz_packed_width(field);
+	}
+
+	fits = (offset <= 0xFFFF);
+
+	offset = clazz->instance_fields_count * sizeof(bvm_cell_t);
+
+	for (width = 8; width > 0; width >>= 1) {
+		for (lc = 0; lc < clazz->fields_count; lc++) {
+
+			bvm_field_t *field = &clazz->fields[lc];
+
+			if (BVM_FIELD_IsStatic(field) || BVM_FIELD_IsReference(field) || (clazz_packed_width(field) != width))
+				continue;
+
+			if (fits) {
+				field->access_flags |= BVM_FIELD_ACCESS_FLAG_PACKED;
+				field->value.offset = (bvm_uint16_t) offset;
+				offset += width;
+			} else {
+				field->value.offset = clazz->instance_fields_count;
+				clazz->instance_fields_count += BVM_FIELD_IsLong(field) ? 2 : 1;
+			}
+		}
+	}
+
+	if (fits) clazz->instance_fields_count = (bvm_uint16_t) ((offset + sizeof(bvm_cell_t) - 1) / sizeof(bvm_cell_t));
+}
+
+#endif
+
 /**
  * Load class fields.  Resultant fields in the \c clazz->fields array will be sorted with the static fields
  * first, and the virtual fields last.  The first virtual field will start
@@ -626,6 +782,11 @@ static void clazz_load_interfaces(bvm_instance_clazz_t *clazz, bvm_filebuffer_t
  * Static final (constant) fields have their values resolved at this point.  Constant longs have their value stored
  * in that list with the clazz.
  *
+ * With #BVM_FIELD_PACKING_ENABLE the primitive instance fields of a non-bootstrap clazz are then packed by width
+ * after its reference fields - see #clazz_pack_fields.
+ *
+ * Lastly, the list of instance reference field offsets used by the GC is built - see #clazz_build_ref_field_offsets.
+ *
  * @param clazz the clazz
  * @param buffer the buffer that the class is being read from
  */
@@ -650,7 +811,7 @@ static void clazz_load_fields(bvm_instance_clazz_t *clazz, bvm_filebuffer_t *buf
 	if (fields_count > 0) {
 
 		/* allocate the class space for the class fields array */
-		clazz->fields = bvm_heap_calloc(fields_count * sizeof(bvm_field_t), BVM_ALLOC_TYPE_STATIC);
+		clazz->fields = bvm_heap_calloc(fields_count * sizeof(bvm_field_t), BVM_ALLOC_TYPE_CLAZZ_METADATA(clazz));
 
 		/* for each field in the class ... */
 		for (lc = 0; lc < fields_count; lc ++) {
@@ -673,12 +834,26 @@ static void clazz_load_fields(bvm_instance_clazz_t *clazz, bvm_filebuffer_t *buf
 				if (BVM_FIELD_IsStatic(field)) staticlongcount++;
 			}
 
+			/* likewise note reference fields.  Arrays field descriptors will begin with '[' and
+			 * reference field descriptors will begin with 'L' */
+			if ( (field->jni_signature->data[0] == '[') || (field->jni_signature->data[0] == 'L') )
+				field->access_flags |= BVM_FIELD_ACCESS_FLAG_REFERENCE;
+
 			/* Keep a count of non-static fields.  We use the number of non-static fields to calculate
 			 * the size of an (object) instance of this class.  We also use the accumulated number of fields
 			 * to create an offset into an instance's fields that this field will occupy. */
 			if (!BVM_FIELD_IsStatic(field)) {
-				field->value.offset = clazz->instance_fields_count;
-				clazz->instance_fields_count += BVM_FIELD_IsLong(field) ? 2 : 1;  /* two for a long */
+#if BVM_FIELD_PACKING_ENABLE
+				/* the primitive fields of a packed class are laid out once they are all known - see
+				 * #clazz_pack_fields */
+				if (CLAZZ_PacksFields(clazz) && !BVM_FIELD_IsReference(field)) {
+					field->packed_type = field->jni_signature->data[0];
+				} else
+#endif
+				{
+					field->value.offset = clazz->instance_fields_count;
+					clazz->instance_fields_count += BVM_FIELD_IsLong(field) ? 2 : 1;  /* two for a long */
+				}
 			} else {
 				/* field is static, so increment the variable we use to give us an offset to
 				 * the instance fields */
@@ -741,7 +916,7 @@ static void clazz_load_fields(bvm_instance_clazz_t *clazz, bvm_filebuffer_t *buf
 
 		/* if there are static long fields, create the space for them, and attach it to the class struct */
 		if (staticlongcount != 0) {
-			int64_ptr = bvm_heap_calloc(staticlongcount * sizeof(bvm_int64_t), BVM_ALLOC_TYPE_STATIC);
+			int64_ptr = bvm_heap_calloc(staticlongcount * sizeof(bvm_int64_t), BVM_ALLOC_TYPE_CLAZZ_METADATA(clazz));
 			clazz->static_longs = int64_ptr;
 		}
 
@@ -757,7 +932,7 @@ static void clazz_load_fields(bvm_instance_clazz_t *clazz, bvm_filebuffer_t *buf
 			int index;
 
 			/* allocate some temporary space for sorting the fields */
-			tempfieldlist = bvm_heap_calloc(fields_count * sizeof(bvm_field_t), BVM_ALLOC_TYPE_STATIC);
+			tempfieldlist = bvm_heap_calloc(fields_count * sizeof(bvm_field_t), BVM_ALLOC_TYPE_CLAZZ_METADATA(clazz));
 
 			for (lc = 0; lc < fields_count; lc ++) {
 
@@ -804,6 +979,12 @@ static void clazz_load_fields(bvm_instance_clazz_t *clazz, bvm_filebuffer_t *buf
 			clazz->virtual_field_offset = virtualfieldoffset;
 		}
 	}
+
+#if BVM_FIELD_PACKING_ENABLE
+	if (CLAZZ_PacksFields(clazz)) clazz_pack_fields(clazz);
+#endif
+
+	clazz_build_ref_field_offsets(clazz);
 }
 
 /**
@@ -829,6 +1010,19 @@ bvm_field_t *bvm_clazz_field_get(bvm_instance_clazz_t *clazz, bvm_utfstring_t *n
 
 	while (BVM_TRUE) {
 
+#if BVM_CLAZZ_MEMBER_INDEX_ENABLE
+		if (search_clazz->field_index != NULL) {
+
+			bvm_uint32_t slot = CLAZZ_MEMBER_HASH(name, jni_signature) & search_clazz->field_index_mask;
+
+			/* probe until the field or an empty slot is found */
+			while ( (lc = search_clazz->field_index[slot]) != 0) {
+				field = (bvm_field_t *) &search_clazz->fields[lc-1];
+				if ( (field->name == name) && (field->jni_signature == jni_signature) ) return field;
+				slot = (slot + 1) & search_clazz->field_index_mask;
+			}
+		} else
+#endif
 		for (lc = search_clazz->fields_count; lc--;) {
 			field = (bvm_field_t *) &search_clazz->fields[lc];
 			if ( (field->name != name) || (field->jni_signature != jni_signature) ) continue;
@@ -1153,7 +1347,7 @@ static void clazz_load_attributes(bvm_instance_clazz_t *clazz, bvm_filebuffer_t
 #if BVM_DEBUGGER_JSR045_ENABLE
 		/* is this the 'SourceDebugExtension' class attribute? */
 		if (strncmp((char *) attr_name->data, "SourceDebugExtension", 20) == 0) {
-			clazz->source_debug_extension = bvm_str_new_utfstring(attr_length, BVM_ALLOC_TYPE_STATIC);
+			clazz->source_debug_extension = bvm_str_new_utfstring(attr_length, BVM_ALLOC_TYPE_CLAZZ_METADATA(clazz));
 			bvm_file_read_bytes_into(buffer, attr_length, &(clazz->source_debug_extension->data));
 			continue;
 		}
@@ -1173,6 +1367,245 @@ static void clazz_load_attributes(bvm_instance_clazz_t *clazz, bvm_filebuffer_t
 	}
 }
 
+#if BVM_EXEC_HANDLER_INDEX_ENABLE
+
+/**
+ * A \c qsort comparison of two handler range pcs - the lower first.
+ */
+static int clazz_compare_pcs(const void *a, const void *b) {
+	return (int) *((const bvm_uint16_t *) a) - (int) *((const bvm_uint16_t *) b);
+}
+
+/**
+ * Gives the position of a pc in the sorted, distinct range pcs of a handler index.  The pc must be one of them.
+ *
+ * @param starts the sorted range pcs
+ * @param nr_starts how many there are
+ * @param pc the pc to find
+ *
+ * @return the position of the pc in \c starts.
+ */
+static bvm_uint32_t clazz_exception_index_position(bvm_uint16_t *starts, bvm_uint32_t nr_starts, bvm_uint16_t pc) {
+
+	bvm_uint32_t lo = 0, hi = nr_starts - 1;
+
+	while (lo < hi) {
+		bvm_uint32_t mid = (lo + hi) / 2;
+		if (starts[mid] < pc) lo = mid + 1; else hi = mid;
+	}
+
+	return lo;
+}
+
+/**
+ * Builds the index by pc range of a method's exception handlers - see #BVM_EXEC_HANDLER_INDEX_ENABLE.  Methods with
+ * fewer than #BVM_EXEC_HANDLER_INDEX_MIN handlers, or whose ranges nest too deeply, are left without one.
+ *
+ * @param method the method, with its exception table loaded
+ */
+static void clazz_build_exception_index(bvm_method_t *method) {
+
+	bvm_uint32_t nr_exceptions = method->exceptions_count;
+	bvm_uint32_t nr_starts, total, lc, lc2;
+	bvm_uint16_t *pcs;
+	bvm_exception_index_t *index;
+
+	if (nr_exceptions < BVM_EXEC_HANDLER_INDEX_MIN) return;
+
+	/* every range start and end pc, sorted with the duplicates dropped, bounds the intervals */
+	pcs = bvm_heap_alloc(nr_exceptions * 2 * sizeof(bvm_uint16_t), BVM_ALLOC_TYPE_STATIC);
+
+	for (lc = 0; lc < nr_exceptions; lc++) {
+		pcs[lc * 2]     = method->exceptions[lc].start_pc;
+		pcs[lc * 2 + 1] = method->exceptions[lc].end_pc;
+	}
+
+	qsort(pcs, nr_exceptions * 2, sizeof(bvm_uint16_t), clazz_compare_pcs);
+
+	for (nr_starts = 1, lc = 1; lc < nr_exceptions * 2; lc++) {
+		if (pcs[lc] != pcs[nr_starts - 1]) pcs[nr_starts++] = pcs[lc];
+	}
+
+	/* how many interval entries the handlers make between them - deeply nested ranges are not worth it */
+	for (total = 0, lc = 0; lc < nr_exceptions; lc++) {
+		bvm_exception_t *exp = &method->exceptions[lc];
+		if (exp->start_pc < exp->end_pc)
+			total += clazz_exception_index_position(pcs, nr_starts, exp->end_pc) -
+					 clazz_exception_index_position(pcs, nr_starts, exp->start_pc);
+	}
+
+	if ( (nr_starts < 2) || (total > nr_exceptions * 4) ) {
+		bvm_heap_free(pcs);
+		return;
+	}
+
+	index = bvm_heap_calloc(sizeof(bvm_exception_index_t) + (nr_starts * sizeof(bvm_uint32_t)) +
+							(nr_starts * sizeof(bvm_uint16_t)) + (total * sizeof(bvm_uint16_t)),
+							BVM_ALLOC_TYPE_CLAZZ_METADATA(method->clazz));
+
+	index->count    = (bvm_uint16_t) (nr_starts - 1);
+	index->first    = (bvm_uint32_t *) (index + 1);
+	index->starts   = (bvm_uint16_t *) (index->first + nr_starts);
+	index->handlers = index->starts + nr_starts;
+
+	memcpy(index->starts, pcs, nr_starts * sizeof(bvm_uint16_t));
+	bvm_heap_free(pcs);
+
+	/* count the handlers of each interval, then turn the counts into the position of each interval's list */
+	for (lc = 0; lc < nr_exceptions; lc++) {
+		bvm_exception_t *exp = &method->exceptions[lc];
+		if (exp->start_pc < exp->end_pc) {
+			bvm_uint32_t end = clazz_exception_index_position(index->starts, nr_starts, exp->end_pc);
+			for (lc2 = clazz_exception_index_position(index->starts, nr_starts, exp->start_pc); lc2 < end; lc2++)
+				index->first[lc2 + 1]++;
+		}
+	}
+
+	for (lc = 0; lc < index->count; lc++) index->first[lc + 1] += index->first[lc];
+
+	/* fill the lists in table order, using the start of each list as its cursor and putting them back after */
+	for (lc = 0; lc < nr_exceptions; lc++) {
+		bvm_exception_t *exp = &method->exceptions[lc];
+		if (exp->start_pc < exp->end_pc) {
+			bvm_uint32_t end = clazz_exception_index_position(index->starts, nr_starts, exp->end_pc);
+			for (lc2 = clazz_exception_index_position(index->starts, nr_starts, exp->start_pc); lc2 < end; lc2++)
+				index->handlers[index->first[lc2]++] = (bvm_uint16_t) lc;
+		}
+	}
+
+	for (lc = index->count; lc > 0; lc--) index->first[lc] = index->first[lc - 1];
+	index->first[0] = 0;
+
+	method->exception_index = index;
+}
+
+#endif
+
+/**
+ * Parse the exception table and code attributes of a method's 'Code' attribute - they follow its bytecode.
+ *
+ * @param method the method
+ * @param buffer the buffer positioned at the exception table
+ */
+static void clazz_load_code_tables(bvm_method_t *method, bvm_filebuffer_t *buffer) {
+
+	bvm_uint16_t lc3, code_attrcount;
+
+	/* process the method's exception table - starting with 'how many are there?' */
+	method->exceptions_count = bvm_file_read_uint16(buffer);
+	if (method->exceptions_count > 0) {
+
+		/* allocate memory for the exception table */
+		method->exceptions = bvm_heap_calloc(method->exceptions_count * sizeof(bvm_exception_t), BVM_ALLOC_TYPE_CLAZZ_METADATA(method->clazz));
+
+		/* for each exception, populate an bvm_exception_t in the method's exception array */
+		for (lc3=0; lc3 < method->exceptions_count; lc3++) {
+			bvm_uint16_t catchtype_index;
+			bvm_exception_t *exception = &method->exceptions[lc3];
+			exception->start_pc   = bvm_file_read_uint16(buffer);
+			exception->end_pc     = bvm_file_read_uint16(buffer);
+			exception->handler_pc = bvm_file_read_uint16(buffer);
+
+			catchtype_index = bvm_file_read_uint16(buffer);
+
+			/* a catch type index of zero is a 'finally'. A non-zero catch type is a class - we do not
+			 * resolve the clazz as yet, we just store the handle to the name of the class */
+			if (catchtype_index != 0)
+				exception->catch_type = bvm_clazz_cp_utfstring_from_index(method->clazz, catchtype_index);
+			else
+				exception->catch_type = NULL;
+		}
+
+#if BVM_EXEC_HANDLER_INDEX_ENABLE
+		clazz_build_exception_index(method);
+#endif
+	}
+
+	/* number of code attributes */
+	code_attrcount= bvm_file_read_uint16(buffer);
+
+	/* for each code attribute */
+	for (lc3 = 0; lc3 < code_attrcount; lc3++) {
+		bvm_uint32_t codeattrlen;
+
+		bvm_utfstring_t *codeAttrName = bvm_clazz_cp_utfstring_from_index(method->clazz, bvm_file_read_uint16(buffer));
+
+		codeattrlen = bvm_file_read_uint32(buffer);
+
+#if (BVM_LINE_NUMBERS_ENABLE || BVM_DEBUGGER_ENABLE)
+
+		/* keep a reference to the line numbers if they are there. */
+		if (strncmp((char *) codeAttrName->data, "LineNumberTable", 15) == 0) {
+			method->line_number_count = bvm_file_read_uint16(buffer);
+
+			if (method->line_number_count > 0) {
+				bvm_uint16_t lc4;
+
+				method->line_numbers = bvm_heap_calloc(method->line_number_count * sizeof(bvm_linenumber_t), BVM_ALLOC_TYPE_CLAZZ_METADATA(method->clazz));
+
+				for (lc4=0; lc4 < method->line_number_count; lc4++) {
+					bvm_linenumber_t *line_number = &method->line_numbers[lc4];
+					line_number->start_pc = bvm_file_read_uint16(buffer);
+					line_number->line_nr  = bvm_file_read_uint16(buffer);
+				}
+			}
+
+		} else
+#endif
+
+#if BVM_DEBUGGER_ENABLE
+		/* load the local variable attribute table if it is there. */
+		if (strncmp((char *) codeAttrName->data, "LocalVariableTable", 18) == 0) {
+			method->local_variable_count = bvm_file_read_uint16(buffer);
+
+			if (method->local_variable_count > 0) {
+				bvm_uint16_t lc5;
+
+				method->local_variables = bvm_heap_calloc(method->local_variable_count * sizeof(bvm_local_variable_t), BVM_ALLOC_TYPE_CLAZZ_METADATA(method->clazz));
+
+				for (lc5=0; lc5 < method->local_variable_count; lc5++) {
+					bvm_local_variable_t *local_variable = &method->local_variables[lc5];
+					local_variable->start_pc = bvm_file_read_uint16(buffer);
+					local_variable->length = bvm_file_read_uint16(buffer);
+					local_variable->name = bvm_clazz_cp_utfstring_from_index(method->clazz, bvm_file_read_uint16(buffer));
+					local_variable->desc = bvm_clazz_cp_utfstring_from_index(method->clazz, bvm_file_read_uint16(buffer));
+					local_variable->index  = bvm_file_read_uint16(buffer);
+				}
+			}
+
+		} else
+#endif
+			bvm_file_skip_bytes(buffer, codeattrlen);
+	}
+}
+
+#if BVM_CLAZZ_LAZY_CODE_TABLES_ENABLE
+
+/**
+ * Parse the exception table and line numbers (and local variables, if debugging) of a method from the rest of its
+ * 'Code' attribute kept with its bytecode.  Called the first time any of them is needed - use
+ * #BVM_METHOD_LoadCodeTables to only call it if they have not been parsed yet.
+ *
+ * @param method a non-native method
+ */
+void bvm_clazz_method_load_code_tables(bvm_method_t *method) {
+
+	bvm_filebuffer_t *code_buffer = BVM_METHOD_CodeBuffer(method);
+	bvm_int32_t position = code_buffer->position;
+
+	BVM_TRY {
+		clazz_load_code_tables(method, code_buffer);
+	} BVM_CATCH(e) {
+		/* parsing allocates - if it runs out of memory it starts again from the top next time */
+		code_buffer->position = position;
+		BVM_THROW(e);
+	} BVM_END_CATCH
+
+	method->access_flags &= ~BVM_METHOD_ACCESS_FLAG_LAZY_TABLES;
+}
+
+#endif
+
 /**
  * Parse the methods of the class file creating a #bvm_method_t structure for each one.
  *
@@ -1181,7 +1614,7 @@ static void clazz_load_attributes(bvm_instance_clazz_t *clazz, bvm_filebuffer_t
  */
 static void clazz_load_methods(bvm_instance_clazz_t *clazz, bvm_filebuffer_t *buffer) {
 
-	bvm_uint16_t lc, lc2, lc3, methods_count, attr_count;
+	bvm_uint16_t lc, lc2, methods_count, attr_count;
 	char return_char;
 
 	/* the method count */
@@ -1193,7 +1626,7 @@ static void clazz_load_methods(bvm_instance_clazz_t *clazz, bvm_filebuffer_t *bu
 	if (methods_count > 0) {
 
 		/* allocate memory for the array of bvm_method_t structures. */
-		clazz->methods = bvm_heap_calloc(methods_count * sizeof(bvm_method_t), BVM_ALLOC_TYPE_STATIC);
+		clazz->methods = bvm_heap_calloc(methods_count * sizeof(bvm_method_t), BVM_ALLOC_TYPE_CLAZZ_METADATA(clazz));
 
 		/* for each method ... */
 		for (lc = 0; lc < methods_count; lc ++) {
@@ -1210,10 +1643,12 @@ static void clazz_load_methods(bvm_instance_clazz_t *clazz, bvm_filebuffer_t *bu
 
 			/* if the method returns a value, distinguish between a long/double return and a
 			 * normal one. The method 'returns value' int is used both as a counter of the number
-			 * of cells to return and as a boolean - Java void is returns_value = zero. */
+			 * of cells to return and as a boolean - Java void is returns_value = zero.  A 'J' or 'D' is
+			 * only a long/double if it is the whole return type - '[J' is a (one cell) long array. */
 			return_char = method->jni_signature->data[method->jni_signature->length - 1];
 			if (return_char != 'V') {  /* not 'void' */
-				if ( (return_char == 'J') || (return_char == 'D'))
+				if ( ( (return_char == 'J') || (return_char == 'D') ) &&
+					 (method->jni_signature->data[method->jni_signature->length - 2] == ')') )
 					method->returns_value = 2;
 				else
 					method->returns_value = 1;
@@ -1222,6 +1657,19 @@ static void clazz_load_methods(bvm_instance_clazz_t *clazz, bvm_filebuffer_t *bu
 			/* the number of attributes for the method */
 			attr_count = bvm_file_read_uint16(buffer);
 
+#if BVM_NATIVE_REPLACEMENT_ENABLE
+			/* a bootstrap class method that has a replacement native registered for it is linked as a native, just as
+			 * if the class had declared it so.  Reflection will see it as native. */
+			if ( !BVM_METHOD_IsNative(method) && !BVM_METHOD_IsAbstract(method) &&
+				 (clazz->classloader_obj == BVM_BOOTSTRAP_CLASSLOADER_OBJ) ) {
+
+				bvm_native_method_desc_t *method_desc = bvm_native_method_pool_get(clazz->name, method->name, method->jni_signature);
+
+				if ( (method_desc != NULL) && method_desc->is_replacement)
+					method->access_flags |= BVM_METHOD_ACCESS_NATIVE;
+			}
+#endif
+
 			/* if the method is native, resolve the native method right now. */
 			if (BVM_METHOD_IsNative(method)) {
 
@@ -1236,6 +1684,18 @@ static void clazz_load_methods(bvm_instance_clazz_t *clazz, bvm_filebuffer_t *bu
 				 * load native methods dynamically, so the failure actually occurs when it is
 				 * to be used, not here.*/
 				method->code.nativemethod = (method_desc == NULL) ? NULL : method_desc->method;
+
+#if BVM_NATIVE_LEAF_CALLS_ENABLE
+				/* a leaf native may be called without a frame - unless it must hold a monitor while it runs */
+				if ( (method_desc != NULL) && method_desc->is_leaf && !BVM_METHOD_IsSynchronized(method) )
+					method->access_flags |= BVM_METHOD_ACCESS_FLAG_LEAF;
+#endif
+
+#if BVM_EXEC_INTRINSICS_ENABLE
+				/* a linked native may also be one the interpreter can do inline */
+				if (method_desc != NULL)
+					method->intrinsic = bvm_exec_intrinsic_get(method);
+#endif
 			}
 
 			/* for each attribute of the method. */
@@ -1257,105 +1717,62 @@ static void clazz_load_methods(bvm_instance_clazz_t *clazz, bvm_filebuffer_t *bu
 					continue;
 				}
 #endif
-				/* is this the 'Code' attribute? */
+				/* is this the 'Code' attribute?  A replaced method is native and its bytecode is skipped. */
+#if BVM_NATIVE_REPLACEMENT_ENABLE
+				if ( (strncmp((char *) attr_name->data, "Code", 4) == 0) && !BVM_METHOD_IsNative(method) ) {
+#else
 				if (strncmp((char *) attr_name->data, "Code", 4) == 0) {
+#endif
 
-					bvm_uint16_t code_attrcount;
 					bvm_uint32_t code_length;
+#if BVM_CLAZZ_LAZY_CODE_TABLES_ENABLE
+					bvm_filebuffer_t *code_buffer;
+#endif
 
 					/* populate the method descriptor */
 					method->max_stack  = bvm_file_read_uint16(buffer);
 					method->max_locals = bvm_file_read_uint16(buffer);
 
 					code_length = bvm_file_read_uint32(buffer);
-					method->code.bytecode = bvm_file_read_bytes(buffer, code_length, BVM_ALLOC_TYPE_STATIC);
-
-#if BVM_DEBUGGER_ENABLE
-					/* for the debugger, we need to store the total number of bytecodes */
-					method->code_length = code_length;
-#endif
-					/* process the method's exception table - starting with 'how many are there?' */
-					method->exceptions_count = bvm_file_read_uint16(buffer);
-					if (method->exceptions_count > 0) {
-
-						/* allocate memory for the exception table */
-						method->exceptions = bvm_heap_calloc(method->exceptions_count * sizeof(bvm_exception_t), BVM_ALLOC_TYPE_STATIC);
-
-						/* for each exception, populate an bvm_exception_t in the method's exception array */
-						for (lc3=0; lc3 < method->exceptions_count; lc3++) {
-							bvm_uint16_t catchtype_index;
-							bvm_exception_t *exception = &method->exceptions[lc3];
-							exception->start_pc   = bvm_file_read_uint16(buffer);
-							exception->end_pc     = bvm_file_read_uint16(buffer);
-							exception->handler_pc = bvm_file_read_uint16(buffer);
-
-							catchtype_index = bvm_file_read_uint16(buffer);
-
-							/* a catch type index of zero is a 'finally'. A non-zero catch type is a class - we do not
-							 * resolve the clazz as yet, we just store the handle to the name of the class */
-							if (catchtype_index != 0)
-								exception->catch_type = bvm_clazz_cp_utfstring_from_index(clazz, catchtype_index);
-							else
-								exception->catch_type = NULL;
-						}
-					}
-
-					/* number of code attributes */
-					code_attrcount= bvm_file_read_uint16(buffer);
-
-					/* for each code attribute */
-					for (lc3 = 0; lc3 < code_attrcount; lc3++) {
-						bvm_uint32_t codeattrlen;
-
-						bvm_utfstring_t *codeAttrName = bvm_clazz_cp_utfstring_from_index(clazz, bvm_file_read_uint16(buffer));
-
-						codeattrlen = bvm_file_read_uint32(buffer);
 
-#if (BVM_LINE_NUMBERS_ENABLE || BVM_DEBUGGER_ENABLE)
-
-						/* keep a reference to the line numbers if they are there. */
-						if (strncmp((char *) codeAttrName->data, "LineNumberTable", 15) == 0) {
-							method->line_number_count = bvm_file_read_uint16(buffer);
-
-							if (method->line_number_count > 0) {
-								bvm_uint16_t lc4;
-
-								method->line_numbers = bvm_heap_calloc(method->line_number_count * sizeof(bvm_linenumber_t), BVM_ALLOC_TYPE_STATIC);
+#if BVM_CLAZZ_LAZY_CODE_TABLES_ENABLE
+					/* keep the rest of the 'Code' attribute with the bytecode - the exception table and code
+					 * attributes follow it.  The position of the buffer marks where they start. */
+					code_buffer = bvm_create_buffer(attr_length - 8, BVM_ALLOC_TYPE_CLAZZ_METADATA(clazz));
+					memcpy(code_buffer->data, &buffer->data[buffer->position], attr_length - 8);
+					code_buffer->position = code_length;
+					bvm_file_skip_bytes(buffer, code_length);
 
-								for (lc4=0; lc4 < method->line_number_count; lc4++) {
-									bvm_linenumber_t *line_number = &method->line_numbers[lc4];
-									line_number->start_pc = bvm_file_read_uint16(buffer);
-									line_number->line_nr  = bvm_file_read_uint16(buffer);
-								}
-							}
-
-						} else
+					method->code.bytecode = code_buffer->data;
+					method->access_flags |= BVM_METHOD_ACCESS_FLAG_LAZY_TABLES;
+#else
+					method->code.bytecode = bvm_file_read_bytes(buffer, code_length, BVM_ALLOC_TYPE_CLAZZ_METADATA(clazz));
 #endif
 
-#if BVM_DEBUGGER_ENABLE
-						/* load the local variable attribute table if it is there. */
-						if (strncmp((char *) codeAttrName->data, "LocalVariableTable", 18) == 0) {
-							method->local_variable_count = bvm_file_read_uint16(buffer);
-
-							if (method->local_variable_count > 0) {
-								bvm_uint16_t lc5;
+#if BVM_EXEC_ACCESSOR_INLINING_ENABLE
+					/* before the bytecode is changed by fusing superinstructions */
+					method->accessor = clazz_method_accessor(method, code_length);
+#endif
 
-								method->local_variables = bvm_heap_calloc(method->local_variable_count * sizeof(bvm_local_variable_t), BVM_ALLOC_TYPE_STATIC);
+#if BVM_AOT_ENABLE
+					/* link (or record for translation) by the bytecode as it is in the class file */
+					bvm_aot_link(method, method->code.bytecode, code_length);
+#endif
 
-								for (lc5=0; lc5 < method->local_variable_count; lc5++) {
-									bvm_local_variable_t *local_variable = &method->local_variables[lc5];
-									local_variable->start_pc = bvm_file_read_uint16(buffer);
-									local_variable->length = bvm_file_read_uint16(buffer);
-									local_variable->name = bvm_clazz_cp_utfstring_from_index(clazz, bvm_file_read_uint16(buffer));
-									local_variable->desc = bvm_clazz_cp_utfstring_from_index(clazz, bvm_file_read_uint16(buffer));
-									local_variable->index  = bvm_file_read_uint16(buffer);
-								}
-							}
+#if BVM_EXEC_SUPERINSTRUCTIONS
+					bvm_exec_fuse_superinstructions(method->code.bytecode, code_length);
+#endif
 
-						} else
+#if (BVM_DEBUGGER_ENABLE || BVM_JIT_ENABLE || BVM_GC_STACK_MAPS_ENABLE || BVM_EXEC_REGISTER_IR_ENABLE)
+					/* the debugger, the JIT, the stack maps and the register code need the total number of bytecodes */
+					method->code_length = code_length;
+#endif
+#if BVM_CLAZZ_LAZY_CODE_TABLES_ENABLE
+					/* the exception table and code attributes are parsed from the code buffer when first needed */
+					bvm_file_skip_bytes(buffer, attr_length - 8 - code_length);
+#else
+					clazz_load_code_tables(method, buffer);
 #endif
-							bvm_file_skip_bytes(buffer, codeattrlen);
-					}
 				} else
 					bvm_file_skip_bytes(buffer, attr_length);
 			}
@@ -1453,18 +1870,20 @@ static bvm_class_obj_t *clazz_create_class(bvm_clazz_t *clazz) {
 			} BVM_END_TRANSIENT_BLOCK
 
 			/* copy the current array contents (Class objects) into the new array */
-			memcpy(new_array->data, array->data, length * sizeof(bvm_obj_t *));
+			memcpy(new_array->data, array->data, length * sizeof(bvm_ref_t));
 
 			/* set the classloader's array to the new array.  The old array will be
 			 * GC'd at the next GC run. */
 			clazz->classloader_obj->class_array = new_array;
+			BVM_GC_WRITE_BARRIER(clazz->classloader_obj, new_array);
 
 			/* set the local working array */
 			array = new_array;
 		}
 
 		/* store the new Class object into the classes array instance in the classloader */
-		array->data[clazz->classloader_obj->nr_classes.int_value++] = (bvm_class_obj_t *) class_obj;
+		array->data[clazz->classloader_obj->nr_classes.int_value++] = BVM_REF_Encode((bvm_class_obj_t *) class_obj);
+		BVM_GC_WRITE_BARRIER(array, class_obj);
 	}
 
 	return class_obj;
@@ -1474,7 +1893,7 @@ static bvm_class_obj_t *clazz_create_class(bvm_clazz_t *clazz) {
 
 /**
  * Copies a utfstring instance class name to a JNI signature utfstring.  The new
- * utfstring is allocated a #BVM_ALLOC_TYPE_STATIC.  A JNI signature is created from a
+ * utfstring is allocated a #BVM_ALLOC_TYPE_METADATA.  A JNI signature is created from a
  * class name by inserting an 'L' at the front and appending a ';' at the end.
  *
  * @param instance_clazzname the name of an instance clazz.
@@ -1488,7 +1907,7 @@ static bvm_utfstring_t *clazz_create_jnisignature(bvm_utfstring_t *instance_claz
 	/* get the length of the string */
 	length = instance_clazzname->length + 2;
 
-	str = bvm_str_new_utfstring(length, BVM_ALLOC_TYPE_STATIC);
+	str = bvm_str_new_utfstring(length, BVM_ALLOC_TYPE_METADATA);
 
 	str->data[0] = 'L';
 	memcpy(&str->data[1], instance_clazzname->data, instance_clazzname->length);
@@ -1502,29 +1921,522 @@ static bvm_utfstring_t *clazz_create_jnisignature(bvm_utfstring_t *instance_claz
 
 #endif
 
+#if BVM_CLAZZ_DISPATCH_TABLES_ENABLE
+
 /**
- * Create an instance clazz structure by reading a Java class file contents from a buffer.  The given
- * class loader is the starting point for class loading.
- *
- * @param classloader_obj the initiating classloader.
- * @param buffer the buffer to load the class from.
+ * Is a method one that takes a vtable slot? Static and private methods and constructors are never dispatched
+ * virtually.
+ */
+#define CLAZZ_IsVirtualMethod(m) \
+	( !BVM_METHOD_IsStatic(m) && !BVM_METHOD_IsPrivate(m) && ((m)->name->data[0] != '<') )
+
+/**
+ * Does a method override the method in a given vtable slot?  It does if it has the same name and signature and the
+ * slot method is accessible from the method's clazz - so a package private method is not overridden by a method of
+ * the same name in another package.
+ */
+static bvm_bool_t clazz_vtable_overrides(bvm_method_t *method, bvm_method_t *slot_method) {
+	return (method->name == slot_method->name) &&
+		   (method->jni_signature == slot_method->jni_signature) &&
+		   (BVM_METHOD_IsPublic(slot_method) ||
+			bvm_clazz_is_member_accessible(BVM_METHOD_AccessFlags(slot_method), method->clazz, slot_method->clazz));
+}
+
+/**
+ * Build the vtable for a clazz.  The vtable starts as a copy of the superclazz vtable.  Each virtual method declared
+ * in the clazz then replaces every slot it overrides, or is given a new slot at the end if it overrides none.  Each
+ * method records the first slot it took in its \c vtable_index.  The superclazz must already be loaded.
  *
- * @return a pointer to an #bvm_instance_clazz_t.
+ * @param clazz the clazz
  */
-static bvm_instance_clazz_t *clazz_load_instance_clazz(bvm_classloader_obj_t *classloader_obj, bvm_filebuffer_t *buffer) {
+static void clazz_build_vtable(bvm_instance_clazz_t *clazz) {
 
-	/* the loaded class */
-	bvm_instance_clazz_t *clazz = NULL;
+	bvm_instance_clazz_t *super_clazz = clazz->super_clazz;
+	bvm_uint16_t super_count = (super_clazz != NULL) ? super_clazz->vtable_count : 0;
+	bvm_uint32_t count = super_count;
+	bvm_uint16_t lc, lc2;
+	bvm_bool_t overrides;
 
-	bvm_uint16_t superindex;
+	/* first pass - count the new slots */
+	for (lc = 0; lc < clazz->methods_count; lc++) {
 
-	/* Do some house keeping and check that the contents of the buffer has the JVMS 0xCAFEBABE magic number
-	 * and then proceed to load the class by scanning through it and creating pointer structures to its
-	 * internals.  JVMS - throw a ClassFormatError if it is not there. */
-	if (bvm_file_read_uint32(buffer) != BVM_MAGIC_NUMBER)
-		bvm_throw_exception(BVM_ERR_CLASS_FORMAT_ERROR, NULL);
+		bvm_method_t *method = &clazz->methods[lc];
 
-	/* allocate memory for the new clazz structure */
+		if (!CLAZZ_IsVirtualMethod(method)) continue;
+
+		overrides = BVM_FALSE;
+
+		for (lc2 = 0; lc2 < super_count && !overrides; lc2++)
+			overrides = clazz_vtable_overrides(method, super_clazz->vtable[lc2]);
+
+		if (!overrides) count++;
+	}
+
+	if (count >= BVM_METHOD_NO_VTABLE_INDEX)
+		bvm_throw_exception(BVM_ERR_CLASS_FORMAT_ERROR, "too many virtual methods");
+
+	if (count == 0) return;
+
+	clazz->vtable = bvm_heap_alloc(count * sizeof(bvm_method_t *), BVM_ALLOC_TYPE_CLAZZ_METADATA(clazz));
+
+	/* inherited slots first */
+	if (super_count > 0)
+		memcpy(clazz->vtable, super_clazz->vtable, super_count * sizeof(bvm_method_t *));
+
+	count = super_count;
+
+	/* second pass - override and append */
+	for (lc = 0; lc < clazz->methods_count; lc++) {
+
+		bvm_method_t *method = &clazz->methods[lc];
+
+		if (!CLAZZ_IsVirtualMethod(method)) continue;
+
+		for (lc2 = 0; lc2 < super_count; lc2++) {
+			if (clazz_vtable_overrides(method, super_clazz->vtable[lc2])) {
+				clazz->vtable[lc2] = method;
+				if (method->vtable_index == BVM_METHOD_NO_VTABLE_INDEX) method->vtable_index = lc2;
+			}
+		}
+
+		if (method->vtable_index == BVM_METHOD_NO_VTABLE_INDEX) {
+			method->vtable_index = (bvm_uint16_t) count;
+			clazz->vtable[count++] = method;
+		}
+	}
+
+	clazz->vtable_count = (bvm_uint16_t) count;
+}
+
+/**
+ * Add an interface and all its superinterfaces to a list of interfaces, skipping those already in the list and
+ * those with no methods.  If \c list is \c NULL the interfaces are only counted, without skipping duplicates,
+ * to give an upper bound for the list size.
+ *
+ * @param interface_clazz the interface to add
+ * @param list the list to add to, or \c NULL
+ * @param count the number of interfaces in the list, updated as interfaces are added
+ */
+static void clazz_itable_add_interface(bvm_instance_clazz_t *interface_clazz, bvm_itable_entry_t *list, bvm_uint32_t *count) {
+
+	bvm_uint32_t lc;
+
+	if (list != NULL) {
+
+		for (lc = 0; lc < *count; lc++) {
+			if (list[lc].interface_clazz == interface_clazz) return;
+		}
+
+		if (interface_clazz->methods_count > 0)
+			list[(*count)++].interface_clazz = interface_clazz;
+
+	} else {
+		(*count)++;
+	}
+
+	for (lc = 0; lc < interface_clazz->interfaces_count; lc++)
+		clazz_itable_add_interface(interface_clazz->interfaces[lc], list, count);
+}
+
+/**
+ * Build the itable for a clazz.  The itable has an entry for each interface the superclazz implements and each
+ * interface (and superinterface) the clazz itself declares.  The implementing method for each interface method
+ * is the one found by searching the clazz and its superclazzes - exactly what a full \c invokeinterface method
+ * search would find.
+ *
+ * @param clazz the clazz
+ */
+static void clazz_build_itable(bvm_instance_clazz_t *clazz) {
+
+	bvm_instance_clazz_t *super_clazz = clazz->super_clazz;
+	bvm_itable_entry_t *itable;
+	bvm_method_t **methods;
+	bvm_uint32_t count = 0, methods_count = 0, lc;
+	bvm_uint16_t lc2;
+
+	/* an upper bound for the number of interfaces */
+	if (super_clazz != NULL) count = super_clazz->itable_count;
+
+	for (lc = 0; lc < clazz->interfaces_count; lc++)
+		clazz_itable_add_interface(clazz->interfaces[lc], NULL, &count);
+
+	if (count == 0) return;
+
+	itable = bvm_heap_calloc(count * sizeof(bvm_itable_entry_t), BVM_ALLOC_TYPE_CLAZZ_METADATA(clazz));
+	clazz->itable = itable;
+
+	count = 0;
+
+	if (super_clazz != NULL) {
+		for (lc = 0; lc < super_clazz->itable_count; lc++)
+			itable[count++].interface_clazz = super_clazz->itable[lc].interface_clazz;
+	}
+
+	for (lc = 0; lc < clazz->interfaces_count; lc++)
+		clazz_itable_add_interface(clazz->interfaces[lc], itable, &count);
+
+	/* only marker interfaces */
+	if (count == 0) {
+		clazz->itable = NULL;
+		bvm_heap_free(itable);
+		return;
+	}
+
+	for (lc = 0; lc < count; lc++)
+		methods_count += itable[lc].interface_clazz->methods_count;
+
+	/* the method lists of all entries share one allocation - it is freed with the first entry's list */
+	methods = bvm_heap_calloc(methods_count * sizeof(bvm_method_t *), BVM_ALLOC_TYPE_CLAZZ_METADATA(clazz));
+
+	for (lc = 0; lc < count; lc++) {
+
+		bvm_instance_clazz_t *interface_clazz = itable[lc].interface_clazz;
+
+		itable[lc].methods = methods;
+
+		for (lc2 = 0; lc2 < interface_clazz->methods_count; lc2++) {
+
+			bvm_method_t *interface_method = &interface_clazz->methods[lc2];
+
+			if (!BVM_METHOD_IsStatic(interface_method))
+				methods[lc2] = bvm_clazz_method_get(clazz, interface_method->name, interface_method->jni_signature,
+						(BVM_METHOD_SEARCH_CLAZZ | BVM_METHOD_SEARCH_SUPERS));
+		}
+
+		methods += interface_clazz->methods_count;
+	}
+
+	clazz->itable_count = (bvm_uint16_t) count;
+}
+
+/**
+ * Build the vtable and itable of a newly loaded clazz.  Interfaces have neither - they are never the clazz of a
+ * receiver object.
+ *
+ * @param clazz the clazz
+ */
+static void clazz_build_dispatch_tables(bvm_instance_clazz_t *clazz) {
+
+	bvm_uint16_t lc;
+
+	for (lc = clazz->methods_count; lc--;)
+		clazz->methods[lc].vtable_index = BVM_METHOD_NO_VTABLE_INDEX;
+
+	if (BVM_CLAZZ_IsInterface(clazz)) return;
+
+	clazz_build_vtable(clazz);
+	clazz_build_itable(clazz);
+}
+
+/**
+ * Finds the method to invoke for a resolved method on a receiver of a given clazz using the clazz's dispatch
+ * tables.  Interface methods are looked up in the itable, other methods are indexed in the vtable.
+ *
+ * @param clazz the clazz of the receiver object
+ * @param resolved_method the resolved method
+ *
+ * @return the method, or \c NULL if the dispatch tables do not hold it - the caller must then fall back to
+ * searching the clazz hierarchy.
+ */
+bvm_method_t *bvm_clazz_virtual_method_get(bvm_instance_clazz_t *clazz, bvm_method_t *resolved_method) {
+
+	bvm_instance_clazz_t *resolved_clazz = resolved_method->clazz;
+	int lc;
+
+	if (BVM_CLAZZ_IsInterface(resolved_clazz)) {
+
+		for (lc = clazz->itable_count; lc--;) {
+			if (clazz->itable[lc].interface_clazz == resolved_clazz)
+				return clazz->itable[lc].methods[resolved_method - resolved_clazz->methods];
+		}
+
+		return NULL;
+	}
+
+	if (resolved_method->vtable_index < clazz->vtable_count)
+		return clazz->vtable[resolved_method->vtable_index];
+
+	return NULL;
+}
+
+#endif
+
+#if BVM_CLAZZ_TYPE_DISPLAYS_ENABLE
+
+/** The most words the interface id bitmap may grow to - an #bvm_instance_clazz_t interface_id is 16 bits */
+#define CLAZZ_INTERFACE_IDS_MAX_WORDS (65536 / 32)
+
+/** A bitmap of the interface ids in use.  Id zero is never given out - it means 'no id'. */
+static BVM_VM_LOCAL bvm_uint32_t *clazz_interface_ids = NULL;
+
+/** The number of words in #clazz_interface_ids */
+static BVM_VM_LOCAL bvm_uint32_t clazz_interface_ids_words = 0;
+
+/**
+ * Takes an unused interface id.  Ids of freed interfaces are reused so the interface bitmaps of clazzes stay as
+ * short as the number of interfaces loaded at any one time allows.
+ *
+ * @return the id, or zero if all ids are taken.
+ */
+static bvm_uint16_t clazz_interface_id_alloc() {
+
+	bvm_uint32_t lc, bit, words, *ids;
+
+	for (lc = 0; lc < clazz_interface_ids_words; lc++) {
+
+		if (clazz_interface_ids[lc] == 0xFFFFFFFF) continue;
+
+		for (bit = 0; bit < 32; bit++) {
+			if ( (clazz_interface_ids[lc] & ((bvm_uint32_t) 1 << bit)) == 0) {
+				clazz_interface_ids[lc] |= ((bvm_uint32_t) 1 << bit);
+				return (bvm_uint16_t) ((lc << 5) + bit);
+			}
+		}
+	}
+
+	if (clazz_interface_ids_words == CLAZZ_INTERFACE_IDS_MAX_WORDS) return 0;
+
+	/* no free ids - double the bitmap.  The allocation may collect garbage and free interfaces, so the old bitmap is
+	 * copied only after it. */
+	words = (clazz_interface_ids_words == 0) ? 4 : clazz_interface_ids_words * 2;
+	ids = bvm_heap_calloc(words * sizeof(bvm_uint32_t), BVM_ALLOC_TYPE_METADATA);
+
+	if (clazz_interface_ids != NULL) {
+		memcpy(ids, clazz_interface_ids, clazz_interface_ids_words * sizeof(bvm_uint32_t));
+		bvm_heap_free(clazz_interface_ids);
+	} else {
+		/* reserve id zero */
+		ids[0] = 1;
+	}
+
+	/* the first new word is all free */
+	lc = clazz_interface_ids_words;
+	bit = (lc == 0) ? 1 : 0;
+	ids[lc] |= ((bvm_uint32_t) 1 << bit);
+
+	clazz_interface_ids = ids;
+	clazz_interface_ids_words = words;
+
+	return (bvm_uint16_t) ((lc << 5) + bit);
+}
+
+/**
+ * Gives back the interface id of a clazz being freed, if it has one.  No live clazz can still have the id in its
+ * interface bitmap - a clazz keeps the interfaces it implements reachable.
+ *
+ * @param clazz the clazz
+ */
+void bvm_clazz_interface_id_release(bvm_instance_clazz_t *clazz) {
+
+	bvm_uint16_t id = clazz->interface_id;
+
+	if (id != 0)
+		clazz_interface_ids[id >> 5] &= ~((bvm_uint32_t) 1 << (id & 31));
+}
+
+#if BVM_VM_SNAPSHOT_ENABLE
+
+/**
+ * Map the interface id bitmap for a VM snapshot being written - it holds no pointers.  See #bvm_snapshot_map_data.
+ */
+void bvm_clazz_snapshot_map() {
+	bvm_snapshot_map_data(clazz_interface_ids);
+}
+
+#endif
+
+/**
+ * Build the superclass display of a newly loaded clazz - the display of its superclazz with the clazz itself added at
+ * the end.  The superclazz must already be loaded.
+ *
+ * @param clazz the clazz
+ */
+static void clazz_build_super_display(bvm_instance_clazz_t *clazz) {
+
+	bvm_instance_clazz_t *super_clazz = clazz->super_clazz;
+	bvm_uint16_t depth = (super_clazz != NULL) ? super_clazz->super_depth + 1 : 0;
+
+	clazz->super_display = bvm_heap_alloc( (depth + 1) * sizeof(bvm_instance_clazz_t *), BVM_ALLOC_TYPE_CLAZZ_METADATA(clazz));
+
+	if (super_clazz != NULL)
+		memcpy(clazz->super_display, super_clazz->super_display, depth * sizeof(bvm_instance_clazz_t *));
+
+	clazz->super_display[depth] = clazz;
+	clazz->super_depth = depth;
+}
+
+/**
+ * Build the interface bitmap of a newly loaded clazz - the union of the bitmaps of its superclazz and its direct
+ * superinterfaces, plus its own id if it is an interface.  These must all already be loaded.
+ *
+ * @param clazz the clazz
+ */
+static void clazz_build_interface_set(bvm_instance_clazz_t *clazz) {
+
+	bvm_instance_clazz_t *super_clazz = clazz->super_clazz;
+	bvm_uint32_t *set;
+	bvm_uint16_t words = 0, lc, lc2;
+
+	if (BVM_CLAZZ_IsInterface(clazz)) {
+		clazz->interface_id = clazz_interface_id_alloc();
+		if (clazz->interface_id != 0) words = (clazz->interface_id >> 5) + 1;
+	}
+
+	if ( (super_clazz != NULL) && (super_clazz->interface_set_words > words))
+		words = super_clazz->interface_set_words;
+
+	for (lc = clazz->interfaces_count; lc--;) {
+		if (clazz->interfaces[lc]->interface_set_words > words)
+			words = clazz->interfaces[lc]->interface_set_words;
+	}
+
+	if (words == 0) return;
+
+	set = bvm_heap_calloc(words * sizeof(bvm_uint32_t), BVM_ALLOC_TYPE_CLAZZ_METADATA(clazz));
+
+	if (super_clazz != NULL) {
+		for (lc2 = super_clazz->interface_set_words; lc2--;)
+			set[lc2] |= super_clazz->interface_set[lc2];
+	}
+
+	for (lc = clazz->interfaces_count; lc--;) {
+		bvm_instance_clazz_t *interface_clazz = clazz->interfaces[lc];
+		for (lc2 = interface_clazz->interface_set_words; lc2--;)
+			set[lc2] |= interface_clazz->interface_set[lc2];
+	}
+
+	if (clazz->interface_id != 0)
+		set[clazz->interface_id >> 5] |= ((bvm_uint32_t) 1 << (clazz->interface_id & 31));
+
+	clazz->interface_set = set;
+	clazz->interface_set_words = words;
+}
+
+#endif
+
+#if BVM_CLAZZ_MEMBER_INDEX_ENABLE
+
+/**
+ * Allocate an empty member index for a given number of members.  The index has the smallest power of two slots that
+ * is at least twice the member count, so probes stay short.
+ *
+ * @param clazz the clazz the index is for
+ * @param count the number of members
+ * @param mask returns the number of slots less one
+ *
+ * @return the index
+ */
+static bvm_uint16_t *clazz_alloc_member_index(bvm_instance_clazz_t *clazz, bvm_uint16_t count, bvm_uint32_t *mask) {
+
+	bvm_uint32_t size = 1;
+
+	while (size < (bvm_uint32_t) count * 2) size <<= 1;
+
+	*mask = size - 1;
+
+	return bvm_heap_calloc(size * sizeof(bvm_uint16_t), BVM_ALLOC_TYPE_CLAZZ_METADATA(clazz));
+}
+
+/**
+ * Build the method and field indexes of a newly loaded clazz - see #BVM_CLAZZ_MEMBER_INDEX_ENABLE.  Clazzes with
+ * fewer than #BVM_CLAZZ_MEMBER_INDEX_MIN methods (or fields) do not get an index for them.  Its methods and fields
+ * must already be loaded.
+ *
+ * @param clazz the clazz
+ */
+static void clazz_build_member_indexes(bvm_instance_clazz_t *clazz) {
+
+	bvm_uint32_t slot;
+	bvm_uint16_t lc;
+
+	if (clazz->methods_count >= BVM_CLAZZ_MEMBER_INDEX_MIN) {
+
+		clazz->method_index = clazz_alloc_member_index(clazz, clazz->methods_count, &clazz->method_index_mask);
+
+		for (lc = 0; lc < clazz->methods_count; lc++) {
+			bvm_method_t *method = &clazz->methods[lc];
+
+			slot = CLAZZ_MEMBER_HASH(method->name, method->jni_signature) & clazz->method_index_mask;
+			while (clazz->method_index[slot] != 0) slot = (slot + 1) & clazz->method_index_mask;
+
+			clazz->method_index[slot] = lc + 1;
+		}
+	}
+
+	if (clazz->fields_count >= BVM_CLAZZ_MEMBER_INDEX_MIN) {
+
+		clazz->field_index = clazz_alloc_member_index(clazz, clazz->fields_count, &clazz->field_index_mask);
+
+		for (lc = 0; lc < clazz->fields_count; lc++) {
+			bvm_field_t *field = &clazz->fields[lc];
+
+			slot = CLAZZ_MEMBER_HASH(field->name, field->jni_signature) & clazz->field_index_mask;
+			while (clazz->field_index[slot] != 0) slot = (slot + 1) & clazz->field_index_mask;
+
+			clazz->field_index[slot] = lc + 1;
+		}
+	}
+}
+
+#endif
+
+#if BVM_HEAP_METADATA_ARENA_ENABLE
+
+/**
+ * Find the metadata arena for a clazz being loaded by the given class loader, and hold it for the clazz.  The
+ * bootstrap and system loaders are never unloaded so their clazzes use the default arena.  Any other loader shares
+ * one arena between its clazzes - the arena of a clazz it has already loaded, or a new one for its first.  The whole
+ * arena is given back in one go when the last of them is unloaded.
+ *
+ * @param classloader_obj the class loader of the clazz.
+ *
+ * @return the arena, or \c NULL for the default arena.
+ */
+static bvm_heap_metadata_arena_t *clazz_metadata_arena(bvm_classloader_obj_t *classloader_obj) {
+
+	bvm_heap_metadata_arena_t *arena = NULL;
+	bvm_int32_t lc;
+
+	if ( (classloader_obj == BVM_BOOTSTRAP_CLASSLOADER_OBJ) || (classloader_obj == BVM_SYSTEM_CLASSLOADER_OBJ) )
+		return NULL;
+
+	for (lc = 0; (arena == NULL) && (lc < classloader_obj->nr_classes.int_value); lc++) {
+		bvm_clazz_t *loaded = ((bvm_class_obj_t *) BVM_REF_Decode(classloader_obj->class_array->data[lc]))->refers_to_clazz;
+		if (BVM_CLAZZ_IsInstanceClazz(loaded)) arena = ((bvm_instance_clazz_t *) loaded)->metadata_arena;
+	}
+
+	if (arena == NULL) arena = bvm_heap_metadata_arena_new();
+
+	bvm_heap_metadata_arena_hold(arena);
+
+	return arena;
+}
+
+#endif
+
+/**
+ * Create an instance clazz structure by reading a Java class file contents from a buffer.  The given
+ * class loader is the starting point for class loading.
+ *
+ * @param classloader_obj the initiating classloader.
+ * @param buffer the buffer to load the class from.
+ *
+ * @return a pointer to an #bvm_instance_clazz_t.
+ */
+static bvm_instance_clazz_t *clazz_load_instance_clazz(bvm_classloader_obj_t *classloader_obj, bvm_filebuffer_t *buffer) {
+
+	/* the loaded class */
+	bvm_instance_clazz_t *clazz = NULL;
+
+	bvm_uint16_t superindex;
+
+	/* Do some house keeping and check that the contents of the buffer has the JVMS 0xCAFEBABE magic number
+	 * and then proceed to load the class by scanning through it and creating pointer structures to its
+	 * internals.  JVMS - throw a ClassFormatError if it is not there. */
+	if (bvm_file_read_uint32(buffer) != BVM_MAGIC_NUMBER)
+		bvm_throw_exception(BVM_ERR_CLASS_FORMAT_ERROR, NULL);
+
+	/* allocate memory for the new clazz structure */
 	clazz = bvm_heap_calloc(sizeof(bvm_instance_clazz_t), BVM_ALLOC_TYPE_INSTANCE_CLAZZ);
 
 	/* identify the memory as being a clazz - GC uses this signature to help
@@ -1545,6 +2457,11 @@ static bvm_instance_clazz_t *clazz_load_instance_clazz(bvm_classloader_obj_t *cl
 			/* .. and set the classloader of this new class to the initiating classloader */
 			clazz->classloader_obj = classloader_obj;
 
+#if BVM_HEAP_METADATA_ARENA_ENABLE
+			/* .. and the arena its metadata comes from */
+			clazz->metadata_arena = clazz_metadata_arena(classloader_obj);
+#endif
+
 #if BVM_DEBUGGER_ENABLE
 			clazz->minor_version = bvm_file_read_uint16(buffer);
 			clazz->major_version = bvm_file_read_uint16(buffer);
@@ -1612,17 +2529,44 @@ static bvm_instance_clazz_t *clazz_load_instance_clazz(bvm_classloader_obj_t *cl
 				 * this read this class's fields, this count is increased to accommodate fields declared in this class.
 				 * This field count is used to determine the memory requirements of an instance of this class */
 				clazz->instance_fields_count = clazz->super_clazz->instance_fields_count;
+
+#if BVM_STACKTRACE_ENABLE
+				/* a throwable class excluded from stack traces takes its subclasses with it */
+				if (BVM_CLAZZ_IsNoStackTrace(clazz->super_clazz))
+					clazz->access_flags |= BVM_CLASS_ACCESS_FLAG_NO_STACKTRACE;
+#endif
 			}
 
+#if BVM_STACKTRACE_ENABLE
+			if (bvm_stacktrace_is_excluded(clazz->name))
+				clazz->access_flags |= BVM_CLASS_ACCESS_FLAG_NO_STACKTRACE;
+#endif
+
+#if BVM_CLAZZ_TYPE_DISPLAYS_ENABLE
+			clazz_build_super_display(clazz);
+#endif
+
 			/* load interfaces */
 			clazz_load_interfaces(clazz, buffer);
 
+#if BVM_CLAZZ_TYPE_DISPLAYS_ENABLE
+			clazz_build_interface_set(clazz);
+#endif
+
 			/* load fields */
 			clazz_load_fields(clazz, buffer);
 
 			/* load methods */
 			clazz_load_methods(clazz, buffer);
 
+#if BVM_CLAZZ_MEMBER_INDEX_ENABLE
+			clazz_build_member_indexes(clazz);
+#endif
+
+#if BVM_CLAZZ_DISPATCH_TABLES_ENABLE
+			clazz_build_dispatch_tables(clazz);
+#endif
+
 #if (BVM_LINE_NUMBERS_ENABLE || BVM_DEBUGGER_ENABLE)
 			/* load class attributes */
 			clazz_load_attributes(clazz, buffer);
@@ -1695,7 +2639,7 @@ bvm_primitive_clazz_t *clazz_load_primitive_clazz(bvm_utfstring_t *clazzname) {
 			 * primitive signature is not the same as its name.  The name may be
 			 * (say) "boolean", but the signature is "Z". Long is 'J. The rest
 			 * use the fist char from the primitive name. */
-			signature = bvm_str_new_utfstring(1,BVM_ALLOC_TYPE_STATIC);
+			signature = bvm_str_new_utfstring(1,BVM_ALLOC_TYPE_METADATA);
 			s = newname->data[0];
 			if (s == 'b') {
 				s = (newname->data[1] == 'y') ? 'B' : 'Z';
@@ -1807,6 +2751,7 @@ static bvm_array_clazz_t *clazz_load_array_clazz(bvm_classloader_obj_t *classloa
 		if (clazz->component_jtype == BVM_T_ARRAY) {
 			bvm_utfstring_t s;
 			s.length = newname->length-1;
+			s.hash = 0;
 			s.data = &newname->data[1];
 
 			/* get the class of the array's component class. This has the happy side effect of
@@ -1832,6 +2777,7 @@ static bvm_array_clazz_t *clazz_load_array_clazz(bvm_classloader_obj_t *classloa
 			 * determine the name of the element type */
 			bvm_utfstring_t s;
 			s.length = newname->length-3;
+			s.hash = 0;
 			s.data = &newname->data[2];
 			clazz->component_clazz = bvm_clazz_get(classloader_obj, &s);
 
@@ -1882,6 +2828,8 @@ bvm_int32_t bvm_clazz_get_source_line(bvm_method_t *method, bvm_uint8_t *pc) {
 
 	int lc, current_pc;
 
+	BVM_METHOD_LoadCodeTables(method);
+
 	/* the current rx_pc can be calculated as the offset of the given pc less the address of
 	 * the start of the method bytecode. */
 	current_pc = (int) (pc - method->code.bytecode);
@@ -1913,6 +2861,15 @@ bvm_bool_t bvm_clazz_implements_interface(bvm_instance_clazz_t *clazz, bvm_insta
 
 	int lc;
 
+#if BVM_CLAZZ_TYPE_DISPLAYS_ENABLE
+	bvm_uint16_t id = interface->interface_id;
+
+	/* an interface with an id is in the bitmap of every clazz that implements it - no need to search */
+	if (id != 0)
+		return ( ((id >> 5) < clazz->interface_set_words) &&
+				 ((clazz->interface_set[id >> 5] & ((bvm_uint32_t) 1 << (id & 31))) != 0) );
+#endif
+
 	/* The same?  No need to check any further */
 	if (clazz == interface)
 		return BVM_TRUE;
@@ -2033,6 +2990,14 @@ bvm_bool_t bvm_clazz_is_assignable_from(bvm_clazz_t *from_clazz, bvm_clazz_t *to
 				bvm_instance_clazz_t *from_iclazz = (bvm_instance_clazz_t *) from_clazz;
 				bvm_instance_clazz_t *to_iclazz   = (bvm_instance_clazz_t *) to_clazz;
 
+#if BVM_CLAZZ_TYPE_DISPLAYS_ENABLE
+				/* a superclazz is at its own depth in the display of its subclazzes */
+				if (!BVM_CLAZZ_IsInstanceClazz(from_clazz) || !BVM_CLAZZ_IsInstanceClazz(to_clazz))
+					return BVM_FALSE;
+
+				return ( (from_iclazz->super_depth > to_iclazz->super_depth) &&
+						 (from_iclazz->super_display[to_iclazz->super_depth] == to_iclazz) );
+#else
 				/* check for 'superness'. */
 				while (from_iclazz != BVM_OBJECT_CLAZZ) {
 					from_iclazz = from_iclazz->super_clazz;
@@ -2041,6 +3006,7 @@ bvm_bool_t bvm_clazz_is_assignable_from(bvm_clazz_t *from_clazz, bvm_clazz_t *to
 					}
 				}
 				return BVM_FALSE;
+#endif
 			}
 		}
 	}
@@ -2131,6 +3097,18 @@ bvm_bool_t bvm_clazz_initialise(bvm_instance_clazz_t *clazz) {
  */
 bvm_bool_t bvm_clazz_is_subclass_of(bvm_clazz_t *sub_clazz, bvm_clazz_t *super_clazz) {
 
+#if BVM_CLAZZ_TYPE_DISPLAYS_ENABLE
+	if ( (sub_clazz != NULL) && (super_clazz != NULL) &&
+		 BVM_CLAZZ_IsInstanceClazz(sub_clazz) && BVM_CLAZZ_IsInstanceClazz(super_clazz)) {
+
+		bvm_instance_clazz_t *sub_iclazz   = (bvm_instance_clazz_t *) sub_clazz;
+		bvm_instance_clazz_t *super_iclazz = (bvm_instance_clazz_t *) super_clazz;
+
+		return ( (sub_iclazz->super_depth >= super_iclazz->super_depth) &&
+				 (sub_iclazz->super_display[super_iclazz->super_depth] == super_iclazz) );
+	}
+#endif
+
 	while (sub_clazz != NULL) {
 		if (sub_clazz == super_clazz)
 			return BVM_TRUE;
@@ -2241,7 +3219,15 @@ static bvm_filebuffer_t *clazz_buffer_class_file(bvm_utfstring_t *clazzname, bvm
 			pname = bvm_str_utfstring_to_cstring(pathname);
 			BVM_MAKE_TRANSIENT_ROOT(pname);
 
+#if BVM_CLAZZ_PRELOAD_ENABLE
+			/* a class file read ahead from a preload profile need not be read from the jar */
+			if ( (buffer = bvm_preload_buffer_file(pname, fullpath)) == NULL) {
+				buffer = bvm_zip_buffer_file_from_jar(pname, fullpath);
+				if (buffer != NULL) bvm_preload_record(pname, fullpath);
+			}
+#else
 			buffer = bvm_zip_buffer_file_from_jar(pname, fullpath);
+#endif
 
 			bvm_heap_free(pname);
 			bvm_heap_free(fullpath);
@@ -2313,6 +3299,10 @@ static bvm_filebuffer_t *clazz_buffer_class_file(bvm_utfstring_t *clazzname, bvm
 static classfilebuffer_t clazz_get_buffered_class(bvm_classloader_obj_t *classloader_obj, bvm_utfstring_t *clazzname) {
 
 	bvm_uint32_t lc;
+#if BVM_CLASSPATH_INDEX_ENABLE
+	int indexed_segment;
+	bvm_bool_t probed = BVM_FALSE;
+#endif
 
 	classfilebuffer_t classbuffer;
 	bvm_utfstring_t temppath;
@@ -2328,10 +3318,26 @@ static classfilebuffer_t clazz_get_buffered_class(bvm_classloader_obj_t *classlo
 	/* if the class was not loaded by any parent (or there is no parent). */
 	if (classbuffer.buffer == NULL) {
 
+#if BVM_CLASSPATH_INDEX_ENABLE
+		/* a class already not found on this loader's own classpath is not looked for again */
+		if (bvm_classpath_is_missing(classloader_obj, clazzname)) return classbuffer;
+#endif
+
 		/* If we are at the bootstrap classloader then use the bootstrap classpath
 		 * to attempt to locate and load the requested class */
 		if (classloader_obj == BVM_BOOTSTRAP_CLASSLOADER_OBJ) {
 
+#if BVM_CLAZZ_IMAGE_ENABLE
+			/* a class in the boot class image need not be looked for on the boot classpath */
+			classbuffer.classloader_obj = BVM_BOOTSTRAP_CLASSLOADER_OBJ;
+			classbuffer.buffer = bvm_clazzimage_buffer_class(clazzname);
+#endif
+
+#if BVM_CLASSPATH_INDEX_ENABLE
+			/* the boot classpath jar with the class in it (if any) */
+			indexed_segment = (classbuffer.buffer == NULL) ? bvm_classpath_boot_segment(clazzname) : BVM_CLASSPATH_NO_SEGMENT;
+#endif
+
 			/* cycle through the classpath elements attempting to buffer the class */
 			for (lc=0; (lc < BVM_MAX_CLASSPATH_SEGMENTS) && (classbuffer.buffer == NULL); lc++) {
 
@@ -2340,12 +3346,23 @@ static classfilebuffer_t clazz_get_buffered_class(bvm_classloader_obj_t *classlo
 				char *segment;
 				if ( (segment = bvm_gl_boot_classpath_segments[lc]) == NULL) break;
 
+#if BVM_CLASSPATH_INDEX_ENABLE
+				/* an indexed jar need only be looked in if the index has the class in it */
+				if ( bvm_classpath_boot_is_indexed(lc) && (indexed_segment != (int) lc) ) continue;
+				probed = BVM_TRUE;
+#endif
+
 				temppath.length = (bvm_uint16_t) strlen(segment);
+				temppath.hash = 0;
 				temppath.data = (bvm_uint8_t *) segment;
 				classbuffer.classloader_obj = BVM_BOOTSTRAP_CLASSLOADER_OBJ;
 				classbuffer.buffer = clazz_buffer_class_file(clazzname, &temppath);
 			}
 
+#if BVM_CLAZZ_IMAGE_ENABLE
+			if (classbuffer.buffer != NULL) bvm_clazzimage_record(clazzname, classbuffer.buffer);
+#endif
+
 		} else {
 
 			/* ... so we are not using the bootstrap classloader.  Present impl is that a non-bootstrap
@@ -2357,7 +3374,7 @@ static classfilebuffer_t clazz_get_buffered_class(bvm_classloader_obj_t *classlo
 			for (lc=0; (classbuffer.buffer == NULL) && (lc < classloader_obj->paths_array->length.int_value); lc++ ) {
 
 				/* get the String classpath segment */
-				bvm_string_obj_t *path_string = (bvm_string_obj_t *) classloader_obj->paths_array->data[lc];
+				bvm_string_obj_t *path_string = (bvm_string_obj_t *) BVM_REF_Decode(classloader_obj->paths_array->data[lc]);
 
 				/* as the classpath of a user classloader may be set programmatically it is
 				 * possible a path segment may be NULL, yet still followed by valid path segment - unlike
@@ -2365,6 +3382,10 @@ static classfilebuffer_t clazz_get_buffered_class(bvm_classloader_obj_t *classlo
 				 * classpath segments list ... */
 				if (path_string == NULL) continue;
 
+#if BVM_CLASSPATH_INDEX_ENABLE
+				probed = BVM_TRUE;
+#endif
+
 				/* The class path String unicode is first converted to utf and *that* is used as the file
 				 * name. So file names can only be utf chars ... */
 				BVM_BEGIN_TRANSIENT_BLOCK {
@@ -2380,6 +3401,11 @@ static classfilebuffer_t clazz_get_buffered_class(bvm_classloader_obj_t *classlo
 			}
 		}
 
+#if BVM_CLASSPATH_INDEX_ENABLE
+		/* a class not found without looking on the classpath at all (the boot classpath index says it is not there)
+		 * is as quick to not find again - it need not be remembered */
+		if ( (classbuffer.buffer == NULL) && probed) bvm_classpath_add_missing(classloader_obj, clazzname);
+#endif
 	}
 
 	return classbuffer;
@@ -2426,6 +3452,10 @@ static bvm_clazz_t *clazz_find(bvm_classloader_obj_t *classloader_obj, bvm_utfst
 
 		int i;
 
+#if BVM_PROFILER_STARTUP_TRACE_ENABLE
+		bvm_uint32_t load_mark, read_micros = 0, inflate_micros = 0;
+#endif
+
 		/* Check for a primitive type.  If it is then return
 		 * a primitive class.  Yes, a developer could write Class.forName("byte")
 		 * and get a class back. The Java SE does not have this behaviour. */
@@ -2456,9 +3486,22 @@ static bvm_clazz_t *clazz_find(bvm_classloader_obj_t *classloader_obj, bvm_utfst
 
 		/* okay, so ... we're ready to attempt to load the instance class.*/
 
+#if BVM_PROFILER_STARTUP_TRACE_ENABLE
+		/* time the read (and inflate) of the class file apart from the load as a whole */
+		BVM_PROFILER_STARTUP_MARK(load_mark);
+		inflate_micros = bvm_gl_profiler_startup_inflate_micros;
+#endif
+
 		/* delegate the locating and buffering of the class for the given loader ... */
 		classbuffer = clazz_get_buffered_class(classloader_obj, clazzname);
 
+#if BVM_PROFILER_STARTUP_TRACE_ENABLE
+		if (BVM_PROFILER_STARTUP_TRACING()) {
+			read_micros = bvm_pd_system_time_micros() - load_mark;
+			inflate_micros = bvm_gl_profiler_startup_inflate_micros - inflate_micros;
+		}
+#endif
+
 		/* unable to find and buffer the class file?  Throw an exception ... */
 		if (classbuffer.buffer == NULL) {
 
@@ -2521,6 +3564,11 @@ static bvm_clazz_t *clazz_find(bvm_classloader_obj_t *classloader_obj, bvm_utfst
 				/* and load the instance clazz. */
 				clazz = (bvm_clazz_t *) clazz_load_instance_clazz(classbuffer.classloader_obj, classbuffer.buffer);
 
+#if BVM_PROFILER_STARTUP_TRACE_ENABLE
+				if (BVM_PROFILER_STARTUP_TRACING())
+					bvm_profiler_startup_load_event(clazz, load_mark, read_micros, inflate_micros, classbuffer.buffer->length);
+#endif
+
 				/* well, we know we're not using this any more so we'll free it manually.  If an
 				 * exception was thrown during load_instance_clazz, we'll not reach this line of code,
 				 * but the memory will be freed up in the next GC anyways */
@@ -2562,6 +3610,144 @@ bvm_clazz_t *bvm_clazz_get_by_reflection(bvm_classloader_obj_t *classloader_obj,
 bvm_clazz_t *bvm_clazz_get_c(bvm_classloader_obj_t *classloader_obj, const char *clazzname) {
 	bvm_utfstring_t str;
 	str.length = strlen(clazzname);
+	str.hash = 0;
 	str.data = (bvm_uint8_t *) clazzname;
 	return clazz_find(classloader_obj, &str, BVM_FALSE);
 }
+
+#if BVM_CLAZZ_FORNAME_CACHE_ENABLE
+
+/**
+ * An entry of the \c Class.forName cache.
+ */
+typedef struct _bvmclazzfornamecachestruct {
+
+	/** The class loader the clazz was asked of */
+	bvm_classloader_obj_t *classloader_obj;
+
+	/** The clazz, or \c NULL if the entry is empty */
+	bvm_clazz_t *clazz;
+
+	/** The Java \c String.hashCode() of the name the clazz was asked by */
+	bvm_uint32_t hash;
+
+} bvm_clazz_forname_cache_t;
+
+static BVM_VM_LOCAL bvm_clazz_forname_cache_t clazz_forname_cache[BVM_CLAZZ_FORNAME_CACHE_SIZE];
+
+/* whether the cache has had a clazz put in it since it was last flushed */
+static BVM_VM_LOCAL bvm_bool_t clazz_forname_cache_in_use = BVM_FALSE;
+
+/**
+ * Empties the \c Class.forName cache.  Called as a clazz is unloaded - it may be in the cache, and its class loader
+ * may be about to be freed too.
+ */
+void bvm_clazz_forname_cache_flush() {
+	if (clazz_forname_cache_in_use) {
+		memset(clazz_forname_cache, 0, sizeof(clazz_forname_cache));
+		clazz_forname_cache_in_use = BVM_FALSE;
+	}
+}
+
+/**
+ * Determine if a clazz name is some chars of a Java class name, with the chars' '.'s as '/'s.  The utf bytes of the
+ * clazz name are decoded as they are compared.
+ *
+ * @param clazzname the clazz name
+ * @param chars the chars
+ * @param len the number of chars
+ *
+ * @return #BVM_TRUE if the clazz name is the chars, #BVM_FALSE otherwise.
+ */
+static bvm_bool_t clazz_name_is_chars(bvm_utfstring_t *clazzname, const bvm_uint16_t *chars, bvm_int32_t len) {
+
+	bvm_uint8_t *bytes = clazzname->data;
+	bvm_uint32_t i;
+	bvm_int32_t count = 0;
+
+	for (i = 0; i < clazzname->length; i++, count++) {
+
+		bvm_uint16_t ch = bytes[i];
+
+		/* as for bvm_str_decode_utf8_to_unicode */
+		if ((ch & 0xE0) == 0xC0) {
+			ch = ((ch & 0x1f) << 6) + (bytes[i+1] & 0x3f);
+			i++;
+		} else if ((ch & 0xF0) == 0xE0) {
+			ch = ((ch & 0xf) << 12) + ((bytes[i+1] & 0x3f) << 6) + (bytes[i+2] & 0x3f);
+			i += 2;
+		}
+
+		if ( (count == len) || (ch != ((chars[count] == '.') ? '/' : chars[count])) ) return BVM_FALSE;
+	}
+
+	return (count == len);
+}
+
+#endif
+
+/**
+ * Get a clazz reflectively by a Java class name String, as \c Class.forName does.  The '.'s of the name are taken as
+ * '/'s.  When #BVM_CLAZZ_FORNAME_CACHE_ENABLE is set a clazz found before is had from the \c Class.forName cache
+ * without allocating.
+ *
+ * @param classloader_obj the class loader
+ * @param name_obj the name of the class
+ *
+ * @return the loaded class - note this function will not return if the class cannot be loaded.  An
+ *  exception will have been thrown.
+ */
+bvm_clazz_t *bvm_clazz_get_by_name_string(bvm_classloader_obj_t *classloader_obj, bvm_string_obj_t *name_obj) {
+
+	bvm_clazz_t *clazz;
+	bvm_utfstring_t *utfstring;
+
+#if BVM_CLAZZ_FORNAME_CACHE_ENABLE
+	const bvm_uint16_t *chars = name_obj->chars->data + name_obj->offset.int_value;
+	bvm_int32_t len = name_obj->length.int_value;
+	bvm_uint32_t hash = (bvm_uint32_t) bvm_string_hash_chars(chars, len);
+	bvm_uint32_t slot = hash ^ (bvm_uint32_t) (((size_t) classloader_obj) >> 3);
+	bvm_clazz_forname_cache_t *cache;
+
+	slot = (slot ^ (slot >> 16)) & (BVM_CLAZZ_FORNAME_CACHE_SIZE - 1);
+	cache = &clazz_forname_cache[slot];
+
+	if ( (cache->clazz != NULL) && (cache->hash == hash) && (cache->classloader_obj == classloader_obj) &&
+		 clazz_name_is_chars(cache->clazz->name, chars, len) )
+		return cache->clazz;
+#endif
+
+	BVM_BEGIN_TRANSIENT_BLOCK {
+
+		/* copy the char array to the utfstring - space allocated from the heap*/
+		utfstring = bvm_str_unicode_to_utfstring(name_obj->chars->data, name_obj->offset.int_value, name_obj->length.int_value);
+		BVM_MAKE_TRANSIENT_ROOT(utfstring);
+
+		/* replace '.'s in class name with '/'s - turn a class name into an
+		 * internalised class name. */
+		bvm_str_replace_char( (char *) utfstring->data, utfstring->length, '.', '/');
+
+		/* get the clazz reflectively */
+		clazz = bvm_clazz_get_by_reflection(classloader_obj, utfstring);
+
+		/* free up the temp memory we have used.  If get_clazz_by_reflection throws an exception
+		 * and we don't get free it now, the temp string 'utfstring' will be freed in the next GC */
+		bvm_heap_free(utfstring);
+
+	} BVM_END_TRANSIENT_BLOCK
+
+#if BVM_CLAZZ_FORNAME_CACHE_ENABLE
+	/* Only a clazz of the loader asked, or of the bootstrap loader, is cached.  The class loader is not marked by the
+	 * cache, so it may be freed and its address taken by another.  The clazzes a loader defines are unloaded with it,
+	 * flushing the cache, but those it has from its parents are not.  Any loader will have the same bootstrap
+	 * clazzes. */
+	if ( (clazz->classloader_obj == classloader_obj) || (clazz->classloader_obj == BVM_BOOTSTRAP_CLASSLOADER_OBJ) ) {
+		cache->classloader_obj = classloader_obj;
+		cache->clazz = clazz;
+		cache->hash = hash;
+		clazz_forname_cache_in_use = BVM_TRUE;
+	}
+#endif
+
+	return clazz;
+}
@@ -0,0 +1,476 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#include "../h/bvm.h"
+
+/**
+
+ @file
+
+ Boot class images.
+
+ @section ov Overview
+
+ Most of the time taken to start the VM is spent loading the bootstrap classes - and most of that is spent finding
+ each class file in the runtime jar and inflating it.  A class image is a file holding the already inflated class
+ files of the classes loaded by the bootstrap class loader on an earlier run, so a VM started with it can skip the jar
+ for those classes altogether.
+
+ A VM started with \c -imagewrite records the bytes of each class file the bootstrap class loader loads and writes
+ them to the given file when the VM exits.  A VM started with \c -image reads the whole image into memory once
+ during initialisation and builds a hash index of the class names in it.  When the bootstrap class loader goes to
+ load a class it looks in the image first, and only goes to the boot classpath if the class is not there.  Classes
+ are still parsed, linked and initialised as usual - an image only saves the reading and inflating.
+
+ The image and its index are held in memory from #bvm_pd_memory_alloc, not the heap, so they take nothing from
+ the Java program.  Each class served from an image is copied into a heap buffer, just as if it had been read from
+ the jar, so the class loading code need not know where its class file came from.
+
+ An image records the boot classpath it was made with, and the size of each file on it.  If either is
+ different when the image is loaded the image is not used - all classes come from the boot classpath as usual.  An
+ image must be made again whenever the runtime classes change.
+
+ The image file is made of (all integers are big endian):
+
+ @li a header - the magic number #BVM_CLAZZ_IMAGE_MAGIC, the version #BVM_CLAZZ_IMAGE_VERSION, and the number of
+ boot classpath segments.
+ @li for each boot classpath segment, its length (u2), its name, and the size of its file (u4).
+ @li the number of classes (u4).
+ @li for each class, the length of its name (u2), its internal name, the length of its class file (u4), and its
+ class file bytes.
+
+ @author Greg McCreath
+ @since 0.0.10
+
+*/
+
+#if BVM_CLAZZ_IMAGE_ENABLE
+
+/** The size of a boot classpath segment file that could not be opened */
+#define CI_NO_FILE_SIZE		0xFFFFFFFF
+
+/**
+ * A class in a loaded image.  The name and bytes point into #ci_image.
+ */
+typedef struct _ciclassstruct {
+
+	/** the internal name of the class */
+	bvm_utfstring_t name;
+
+	/** the length of the class file bytes */
+	bvm_uint32_t length;
+
+	/** the class file bytes */
+	bvm_uint8_t *data;
+
+} ci_class_t;
+
+/**
+ * A class recorded for writing to an image.  The name bytes are followed by the class file bytes.
+ */
+typedef struct _cirecordstruct {
+
+	/** the next recorded class */
+	struct _cirecordstruct *next;
+
+	/** the length of the class name */
+	bvm_uint16_t name_length;
+
+	/** the length of the class file bytes */
+	bvm_uint32_t length;
+
+	/** the class name bytes, then the class file bytes */
+	bvm_uint8_t data[1];
+
+} ci_record_t;
+
+/** The image to load at VM startup.  Set with the \c -image command line option. */
+BVM_VM_LOCAL char *bvm_gl_clazzimage_filename = NULL;
+
+/** The image to write at VM exit.  Set with the \c -imagewrite command line option. */
+BVM_VM_LOCAL char *bvm_gl_clazzimage_write_filename = NULL;
+
+/** The bytes of the loaded image file, or \c NULL if no image is being used */
+static BVM_VM_LOCAL bvm_uint8_t *ci_image = NULL;
+
+/** The classes in the loaded image */
+static BVM_VM_LOCAL ci_class_t *ci_classes = NULL;
+
+/** The hash index of #ci_classes.  Each slot holds the index of a class plus one, or zero if empty. */
+static BVM_VM_LOCAL bvm_uint32_t *ci_index = NULL;
+
+/** The number of slots in #ci_index less one - the slot count is a power of two */
+static BVM_VM_LOCAL bvm_uint32_t ci_index_mask;
+
+/** The first class recorded for writing */
+static BVM_VM_LOCAL ci_record_t *ci_records = NULL;
+
+/** The last class recorded for writing - classes are written in the order they were loaded */
+static BVM_VM_LOCAL ci_record_t *ci_records_last = NULL;
+
+/**
+ * Reports the size of a file on the boot classpath.  The file is opened just as the class loader would open it.
+ *
+ * @param segment - the boot classpath segment.
+ * @return the size of the file, or #CI_NO_FILE_SIZE if it could not be opened.
+ */
+static bvm_uint32_t ci_segment_size(const char *segment) {
+
+	bvm_uint32_t size;
+	BVM_FILE file = bvm_file_open(bvm_gl_filetype_md, segment, BVM_FILE_O_RDONLY);
+
+	if (file == BVM_ERR) return CI_NO_FILE_SIZE;
+
+	size = (bvm_uint32_t) bvm_file_sizeof(file);
+	bvm_file_close(file);
+
+	return size;
+}
+
+/**
+ * Read a big endian u2 from an image being loaded.  Nothing is read if it would go past the end of the image.
+ *
+ * @param position - the position to read at.  Moved past the u2.
+ * @param length - the length of the image.
+ * @param value - where to put the u2.
+ * @return #BVM_TRUE if it was read, #BVM_FALSE if not.
+ */
+static bvm_bool_t ci_read_uint16(bvm_uint32_t *position, bvm_uint32_t length, bvm_uint16_t *value) {
+
+	if (length - *position < 2) return BVM_FALSE;
+
+	*value = (bvm_uint16_t) ((ci_image[*position] << 8) | ci_image[*position+1]);
+	*position += 2;
+
+	return BVM_TRUE;
+}
+
+/**
+ * Read a big endian u4 from an image being loaded.  Nothing is read if it would go past the end of the image.
+ *
+ * @param position - the position to read at.  Moved past the u4.
+ * @param length - the length of the image.
+ * @param value - where to put the u4.
+ * @return #BVM_TRUE if it was read, #BVM_FALSE if not.
+ */
+static bvm_bool_t ci_read_uint32(bvm_uint32_t *position, bvm_uint32_t length, bvm_uint32_t *value) {
+
+	bvm_uint8_t *p = ci_image + *position;
+
+	if (length - *position < 4) return BVM_FALSE;
+
+	*value = ((bvm_uint32_t) p[0] << 24) | ((bvm_uint32_t) p[1] << 16) | ((bvm_uint32_t) p[2] << 8) | p[3];
+	*position += 4;
+
+	return BVM_TRUE;
+}
+
+/**
+ * Check the header and boot classpath segments of an image being loaded against the boot classpath of this VM.
+ *
+ * @param position - the start of the image.  Moved past the segments.
+ * @param length - the length of the image.
+ * @return #BVM_TRUE if the image was made with this boot classpath, #BVM_FALSE if not.
+ */
+static bvm_bool_t ci_check_header(bvm_uint32_t *position, bvm_uint32_t length) {
+
+	bvm_uint32_t magic, version, count, size, lc;
+	bvm_uint16_t segment_length;
+	char *segment;
+
+	if (!ci_read_uint32(position, length, &magic) || (magic != BVM_CLAZZ_IMAGE_MAGIC) ||
+		!ci_read_uint32(position, length, &version) || (version != BVM_CLAZZ_IMAGE_VERSION) ||
+		!ci_read_uint32(position, length, &count) || (count > BVM_MAX_CLASSPATH_SEGMENTS) )
+		return BVM_FALSE;
+
+	for (lc = 0; lc < count; lc++) {
+
+		if ( (segment = bvm_gl_boot_classpath_segments[lc]) == NULL) return BVM_FALSE;
+
+		if (!ci_read_uint16(position, length, &segment_length) ||
+			(segment_length != strlen(segment)) ||
+			(length - *position < segment_length) ||
+			(memcmp(ci_image + *position, segment, segment_length) != 0) )
+			return BVM_FALSE;
+
+		*position += segment_length;
+
+		if (!ci_read_uint32(position, length, &size) || (size != ci_segment_size(segment)) )
+			return BVM_FALSE;
+	}
+
+	/* the image must have all of the boot classpath */
+	return ( (count == BVM_MAX_CLASSPATH_SEGMENTS) || (bvm_gl_boot_classpath_segments[count] == NULL) );
+}
+
+/**
+ * Find the classes in an image being loaded and build the hash index of them.
+ *
+ * @param position - the position of the class count.
+ * @param length - the length of the image.
+ * @return #BVM_TRUE if the classes were indexed, #BVM_FALSE if the image is not well formed or there was no
+ * memory for the index.
+ */
+static bvm_bool_t ci_index_classes(bvm_uint32_t position, bvm_uint32_t length) {
+
+	bvm_uint32_t count, slots, lc, slot;
+	bvm_uint16_t name_length;
+
+	/* each class takes at least 6 bytes - the count cannot be more than that */
+	if (!ci_read_uint32(&position, length, &count) || (count > (length - position) / 6) ) return BVM_FALSE;
+
+	/* at least twice as many slots as classes keeps the probe chains short */
+	for (slots = 16; slots < count * 2; slots <<= 1);
+
+	ci_classes = bvm_pd_memory_alloc( (count + 1) * sizeof(ci_class_t));
+	ci_index = bvm_pd_memory_alloc(slots * sizeof(bvm_uint32_t));
+
+	if ( (ci_classes == NULL) || (ci_index == NULL) ) return BVM_FALSE;
+
+	memset(ci_index, 0, slots * sizeof(bvm_uint32_t));
+	ci_index_mask = slots - 1;
+
+	for (lc = 0; lc < count; lc++) {
+
+		ci_class_t *clazz = &ci_classes[lc];
+
+		if (!ci_read_uint16(&position, length, &name_length) || (length - position < name_length) ) return BVM_FALSE;
+
+		clazz->name.length = name_length;
+		clazz->name.hash = 0;
+		clazz->name.data = ci_image + position;
+		position += name_length;
+
+		if (!ci_read_uint32(&position, length, &clazz->length) || (length - position < clazz->length) ) return BVM_FALSE;
+
+		clazz->data = ci_image + position;
+		position += clazz->length;
+
+		/* the first of any duplicates is the one found */
+		slot = bvm_calchash(clazz->name.data, name_length) & ci_index_mask;
+		while (ci_index[slot] != 0) slot = (slot + 1) & ci_index_mask;
+		ci_index[slot] = lc + 1;
+	}
+
+	return BVM_TRUE;
+}
+
+/**
+ * Load a class image.  The image is only used if it is well formed and was made with the boot classpath of this VM
+ * - otherwise the boot classpath is used as if no image had been given.  The boot classpath must have been set.
+ *
+ * @param filename - the name of the image file.
+ * @return #BVM_TRUE if the image is being used, #BVM_FALSE if not.
+ */
+bvm_bool_t bvm_clazzimage_load(const char *filename) {
+
+	bvm_uint32_t length, position = 0;
+	bvm_bool_t is_loaded = BVM_FALSE;
+	void *handle = bvm_pd_file_open(filename, BVM_FILE_O_RDONLY);
+
+	if (handle == NULL) return BVM_FALSE;
+
+	length = (bvm_uint32_t) bvm_pd_file_sizeof(handle);
+
+	if ( (length > 0) && ( (ci_image = bvm_pd_memory_alloc(length)) != NULL) ) {
+
+		is_loaded = (bvm_pd_file_read(ci_image, length, handle) == length) &&
+					ci_check_header(&position, length) &&
+					ci_index_classes(position, length);
+	}
+
+	bvm_pd_file_close(handle);
+
+	if (!is_loaded) {
+#if BVM_CONSOLE_ENABLE
+		bvm_pd_console_out("Class image %s is not valid for this boot classpath - not used.\n", filename);
+#endif
+		bvm_clazzimage_release();
+	}
+
+	return is_loaded;
+}
+
+/**
+ * Buffer a class file from the loaded image.  The buffer is allocated from the heap as #BVM_ALLOC_TYPE_DATA, just
+ * as a class file buffered from the boot classpath is.
+ *
+ * @param clazzname - the internal name of the class.
+ * @return a buffer of the class file, or \c NULL if no image is being used or the class is not in it.
+ */
+bvm_filebuffer_t *bvm_clazzimage_buffer_class(bvm_utfstring_t *clazzname) {
+
+	bvm_uint32_t slot, index;
+	bvm_filebuffer_t *buffer;
+
+	if (ci_index == NULL) return NULL;
+
+	slot = BVM_UTFSTRING_HASH(clazzname) & ci_index_mask;
+
+	while ( (index = ci_index[slot]) != 0) {
+
+		ci_class_t *clazz = &ci_classes[index-1];
+
+		if ( (clazz->name.length == clazzname->length) &&
+			 (memcmp(clazz->name.data, clazzname->data, clazzname->length) == 0) ) {
+
+			buffer = bvm_create_buffer(clazz->length, BVM_ALLOC_TYPE_DATA);
+			memcpy(buffer->data, clazz->data, clazz->length);
+			return buffer;
+		}
+
+		slot = (slot + 1) & ci_index_mask;
+	}
+
+	return NULL;
+}
+
+/**
+ * Record a class file loaded by the bootstrap class loader so it is written to the image at VM exit.  Does nothing
+ * if no image is to be written.  A class that there is no memory to record is left out of the image.
+ *
+ * @param clazzname - the internal name of the class.
+ * @param buffer - the buffer of its class file.
+ */
+void bvm_clazzimage_record(bvm_utfstring_t *clazzname, bvm_filebuffer_t *buffer) {
+
+	ci_record_t *record;
+
+	if (bvm_gl_clazzimage_write_filename == NULL) return;
+
+	record = bvm_pd_memory_alloc(sizeof(ci_record_t) + clazzname->length + buffer->length);
+	if (record == NULL) return;
+
+	record->next = NULL;
+	record->name_length = clazzname->length;
+	record->length = buffer->length;
+	memcpy(record->data, clazzname->data, clazzname->length);
+	memcpy(record->data + clazzname->length, buffer->data, buffer->length);
+
+	if (ci_records_last == NULL)
+		ci_records = record;
+	else
+		ci_records_last->next = record;
+
+	ci_records_last = record;
+}
+
+/**
+ * Write a big endian u2 to an image file.
+ *
+ * @param value - the value
+ * @param handle - the file handle.
+ * @return #BVM_TRUE if written, #BVM_FALSE if not.
+ */
+static bvm_bool_t ci_write_uint16(bvm_uint16_t value, void *handle) {
+
+	bvm_uint8_t bytes[2];
+
+	bytes[0] = (bvm_uint8_t) (value >> 8);
+	bytes[1] = (bvm_uint8_t) value;
+
+	return (bvm_pd_file_write(bytes, 2, handle) == 2);
+}
+
+/**
+ * Write a big endian u4 to an image file.
+ *
+ * @param value - the value
+ * @param handle - the file handle.
+ * @return #BVM_TRUE if written, #BVM_FALSE if not.
+ */
+static bvm_bool_t ci_write_uint32(bvm_uint32_t value, void *handle) {
+
+	bvm_uint8_t bytes[4];
+
+	bytes[0] = (bvm_uint8_t) (value >> 24);
+	bytes[1] = (bvm_uint8_t) (value >> 16);
+	bytes[2] = (bvm_uint8_t) (value >> 8);
+	bytes[3] = (bvm_uint8_t) value;
+
+	return (bvm_pd_file_write(bytes, 4, handle) == 4);
+}
+
+/**
+ * Write the recorded classes to an image file.  An existing file is overwritten.
+ *
+ * @param filename - the name of the image file.
+ * @return #BVM_TRUE if the image was written, #BVM_FALSE if the file could not be opened or written.
+ */
+bvm_bool_t bvm_clazzimage_write(const char *filename) {
+
+	bvm_uint32_t count, lc;
+	bvm_bool_t result;
+	ci_record_t *record;
+	char *segment;
+	void *handle = bvm_pd_file_open(filename, BVM_FILE_O_WRONLY | BVM_FILE_O_TRUNC);
+
+	if (handle == NULL) return BVM_FALSE;
+
+	for (count = 0; (count < BVM_MAX_CLASSPATH_SEGMENTS) && (bvm_gl_boot_classpath_segments[count] != NULL); count++);
+
+	result = ci_write_uint32(BVM_CLAZZ_IMAGE_MAGIC, handle) &&
+			 ci_write_uint32(BVM_CLAZZ_IMAGE_VERSION, handle) &&
+			 ci_write_uint32(count, handle);
+
+	for (lc = 0; result && (lc < count); lc++) {
+		segment = bvm_gl_boot_classpath_segments[lc];
+		result = ci_write_uint16( (bvm_uint16_t) strlen(segment), handle) &&
+				 (bvm_pd_file_write(segment, strlen(segment), handle) == strlen(segment)) &&
+				 ci_write_uint32(ci_segment_size(segment), handle);
+	}
+
+	for (count = 0, record = ci_records; record != NULL; record = record->next) count++;
+
+	result = result && ci_write_uint32(count, handle);
+
+	for (record = ci_records; result && (record != NULL); record = record->next) {
+		result = ci_write_uint16(record->name_length, handle) &&
+				 (bvm_pd_file_write(record->data, record->name_length, handle) == record->name_length) &&
+				 ci_write_uint32(record->length, handle) &&
+				 (bvm_pd_file_write(record->data + record->name_length, record->length, handle) == record->length);
+	}
+
+	if (bvm_pd_file_close(handle) == BVM_ERR) result = BVM_FALSE;
+
+	return result;
+}
+
+/**
+ * Free the loaded image and any recorded classes.
+ */
+void bvm_clazzimage_release() {
+
+	ci_record_t *record;
+
+	while ( (record = ci_records) != NULL) {
+		ci_records = record->next;
+		bvm_pd_memory_free(record);
+	}
+	ci_records_last = NULL;
+
+	if (ci_index != NULL) bvm_pd_memory_free(ci_index);
+	if (ci_classes != NULL) bvm_pd_memory_free(ci_classes);
+	if (ci_image != NULL) bvm_pd_memory_free(ci_image);
+
+	ci_index = NULL;
+	ci_classes = NULL;
+	ci_image = NULL;
+}
+
+#endif
@@ -26,10 +26,10 @@
 
  @section ov Overview
 
- The collector is implemented as a mark-and-sweep collector.  Tri-colour marking is used to keep
- the door open for a later implementation of incremental GC.
+ The collector is implemented as a mark-and-sweep collector.  Tri-colour marking is used so that marking may
+ optionally be done incrementally - see below.
 
- Nothing controversial about the algorithm in use.  The first stage recursively marks each known root heap chunk
+ Nothing controversial about the algorithm in use.  The first stage marks each known root heap chunk
  and its children and then the heap is swept to free those chunks that were not marked.
 
  The allocator marks each chuck #BVM_GC_COLOUR_WHITE as it created.  During GC, as each memory structure is
@@ -62,6 +62,11 @@
  if so it is considered a root and is recursively marked.  Stack data is reused so it could have junk in it from
  a previous usage - hence the 'test to see if it is a valid pointer'.
 
+ With #BVM_GC_STACK_MAPS_ENABLE a frame waiting on a call it made is instead marked using the reference map of its call
+ site (see stackmap.c) - only the cells that hold a reference at that point in the method are marked.  The top frame
+ of each thread may be part way through any instruction, so it is always scanned as above, as are native frames and
+ the frames of methods the maps cannot be worked out for.
+
  The other two root sources, the transient and permanent root stack, are slightly different.  Each is also a stack, albeit
  far simpler than a thread stack.  Each of these stacks has an associated counter to mark the current top of the stack.
 
@@ -138,7 +143,8 @@
 
  It is important to note that interned String constants and pooled UTF strings for a clazz will NOT
  be freed when the clazz that they came from is freed.  Once a string is interned or a utf string pooled, it is there for
- the lifetime of the executing VM.
+ the lifetime of the executing VM.  Interned strings (and their char arrays) are therefore allocated as STATIC and
+ the collector does not mark them at all.
 
  @section bvm_gc-cm Weak References
 
@@ -157,12 +163,172 @@
  a 'referent' object that a weak reference object points to is going to be swept in this GC cycle, the referent
  object field of the weak reference object is set to \c NULL.  Simple.
 
+ @section bvm_gc-soft Soft References
+
+ A \c java.lang.ref.SoftReference is allocated as a #BVM_ALLOC_TYPE_OBJECT and has its type changed to
+ #BVM_ALLOC_TYPE_SOFT_REFERENCE by the native method #java_lang_ref_SoftReference_makesoft as for a weak reference.  A
+ soft reference is stamped with the tick of a soft reference clock (#bvm_gl_gc_soft_clock) as it is made and each
+ time its referent is got (by the native #java_lang_ref_SoftReference_get).
+
+ Normally the marker treats the referent of a soft reference as a strong one - caches made of soft references
+ survive collections while there is memory to spare.  When the allocator is about to fail (after a GC, and after
+ trying to grow the heap) it calls #bvm_gc_clear_soft_references.  This does a full GC in which the older half of the
+ soft references (by the age of their timestamp) are treated as weak references.  It is called again and again -
+ each time clearing the least recently used half of those left - until the allocation fits or there are no more
+ soft references holding a referent.  So all soft references are cleared before an \c OutOfMemoryError is thrown.
+
+ Any fields a subclass of \c SoftReference adds are marked as the fields of a plain object are - only the referent
+ gets the soft treatment.
+
+ @section ephemeron Ephemerons
+
+ A \c java.lang.ref.Ephemeron is a reference that also holds a value.  It is made a #BVM_ALLOC_TYPE_EPHEMERON by
+ the native method #java_lang_ref_Ephemeron_makeephemeron.  Its value is kept only while its key (the referent) is
+ reachable other than through the ephemeron - so a weak keyed map built of ephemerons may have values that refer back to
+ their own keys and still be collected.
+
+ The marker does not trace the key or the value of an ephemeron (a subclass's own fields are traced as for any object).
+ If the key is already marked the value is marked straight away, otherwise the ephemeron is added to a list of
+ ephemerons for this GC.  Once the main marking is done #gc_visit_ephemerons goes through the list again and again,
+ marking the value of each ephemeron whose key has since been marked (and whatever that reaches), until a pass marks
+ nothing new.  The key and value of each ephemeron whose key is still unmarked are then set to \c NULL - before the
+ weak references are cleared, so a weak reference to something reachable only through the value of a live ephemeron
+ is not cleared.
+
+ @section gen Generational Collection
+
+ If #BVM_GC_GENERATIONAL_ENABLE is set the collector is generational.  Chunks cannot be moved (thread stacks are
+ scanned conservatively) so there is no separate nursery space - instead the generations are told apart by colour.  The
+ sweep of a generational collector does not colour the survivors back to #BVM_GC_COLOUR_WHITE - they stay
+ #BVM_GC_COLOUR_BLACK and are 'old'.  Chunks allocated since the last collection are white and are 'new'.
+
+ A minor collection (#bvm_gc) marks from the roots as normal, but as marking only ever follows white chunks it stops at
+ old ones - they are taken to be live.  An old chunk that has had a reference to a new chunk stored into it since the last
+ collection is the only way a new chunk may be reachable through an old one.  Such stores are caught by the
+ #BVM_GC_WRITE_BARRIER macro which puts the old chunk into a 'remembered set' (and colours it #BVM_GC_COLOUR_REMEMBERED).
+ The interpreter uses the barrier for \c putfield, \c putstatic and \c aastore, and the VM and native code use it
+ wherever they store a reference into an existing object.  Each remembered chunk is marked as a root by the next minor
+ collection.  The VM's own roots are few and are always scanned by a minor collection - old or not.  As a convenience to
+ VM code, each old transient root is remembered after each collection so an object under construction needs no barrier.
+ The sweep only frees white chunks, so a minor collection frees only new garbage.
+
+ If a minor collection leaves less than #BVM_GC_FULL_PERCENT of the heap free a full collection (#bvm_gc_full)
+ follows.  If the remembered set overflows the next collection is a full one.  A full collection colours every chunk
+ white again first so the whole heap may be collected.  Classes are only ever unloaded by a full collection.
+
+ @section inc Incremental Marking
+
+ If #BVM_GC_INCREMENTAL_ENABLE is set marking may be spread across thread switches to keep pauses short.
+ #bvm_gc_mark_slice is called at each thread switch.  When less than #BVM_GC_INCREMENTAL_START_PERCENT of the heap
+ is free it starts a cycle by colouring the roots grey and pushing them onto the mark stack - nothing is scanned.  Each
+ following slice pops and scans up to #bvm_gl_gc_slice_budget grey chunks.
+
+ While a cycle is in progress the mutator keeps running.  A reference stored into a black chunk would be missed by the
+ marker, so #BVM_GC_WRITE_BARRIER colours the stored chunk grey (if it is white).  The interpreter uses the barrier for
+ \c putfield, \c putstatic and \c aastore, and the VM and native code use it wherever they store a reference into an
+ existing object.  Thread stacks and the VM's own roots are not covered by the barrier - instead they are all marked
+ again when the cycle finishes.  At the end of each slice any black transient roots are coloured grey again so an
+ object still being built by the VM needs no barrier.  New chunks are allocated white and are found by the final
+ marking if they are reachable.
+
+ When a slice empties the mark stack the cycle is finished by #bvm_gc in a single pause - the roots are marked again
+ (most of what they reach is already black) and the heap is swept.  If memory runs out during a cycle the allocator's
+ #bvm_gc finishes the cycle in the same way.
+
+ @section budget Allocation Budget
+
+ Without #BVM_GC_BUDGET_ENABLE a GC only happens when the allocator cannot find a free chunk - so every collection runs
+ with the heap full, and it happens in the middle of whatever allocation ran out.  With it set #bvm_gc_check_budget is
+ called at each thread switch and starts a GC early if either the bytes allocated since the last GC
+ (#bvm_gl_heap_allocated) have exceeded #bvm_gl_gc_alloc_budget, or less than #bvm_gl_gc_budget_free_percent of the
+ heap is free.  The free space trigger only fires if at least half the threshold has been allocated since the last GC,
+ so a heap that is mostly live is not collected over and over.  An allocation that fails still collects as before.
+
+ @section idle Idle Collection
+
+ With #BVM_GC_IDLE_ENABLE set, when no thread is runnable and none is due to wake for at least
+ #bvm_gl_gc_idle_min_time milliseconds the thread scheduler calls #bvm_gc_idle, which does a full GC (sweep included)
+ there and then - as long as #BVM_GC_IDLE_MIN_PERCENT of the heap has been allocated since the last GC, or an
+ incremental marking cycle is under way.  The pause falls while nothing is waiting on the VM, and the work that
+ follows starts with a collected heap.
+
+ @section lazy Lazy Sweeping
+
+ If #BVM_GC_LAZY_SWEEP_ENABLE is set the heap is not swept at the end of a GC.  Instead the sweep position is set to the
+ start of the first region and the heap is swept a step at a time (see #BVM_GC_LAZY_SWEEP_STEP) by #bvm_gc_sweep_step
+ - called by the allocator when the free list has no chunk big enough.  Only when the whole heap has been swept and
+ memory is still short does the allocator do another GC.  The pause of a GC is then just its marking.
+
+ While a sweep is pending a chunk allocated where the sweeper is yet to reach is coloured #BVM_GC_COLOUR_BLACK so the
+ sweeper whitens it rather than freeing it.  Chunks allocated behind the sweeper are white as normal.  Free chunks are
+ never coalesced across the sweep position so it always falls at the start of a chunk.  Any pending sweep is finished
+ before the next marking starts, and #bvm_gc_full (as used by \c Runtime.gc()) sweeps the whole heap before returning.
+ The heap regions are adjusted when the sweep is finished, not at the end of the GC.
+
+ @section compact Compaction
+
+ If #BVM_GC_COMPACTION_ENABLE is set, a GC that leaves the largest free chunk smaller than
+ #BVM_GC_COMPACT_FRAGMENTATION_PERCENT of the free space flags the heap to be compacted.  #bvm_gc_compact is then called by
+ the interpreter at its next thread switch - between bytecodes, when no VM 'C' code holds a pointer into the heap.  It
+ does a full GC and then slides arrays down towards the start of their region to close up the free space between chunks.
+ Only arrays are moved.  Other chunks are referred to by VM structures that cannot easily be found.
+
+ The thread stacks are scanned conservatively - a cell that looks like a reference may not be one and cannot be updated -
+ so any array found from a stack or a VM root is pinned where it is.  The new address of each moved array is kept in a
+ fixed size table (see #BVM_GC_COMPACT_TABLE_SIZE) that also bounds the work of a compaction.  Before anything is moved,
+ the fields of every object, the elements of every object array, the static fields of every clazz and the objects of the
+ VM's monitors and threads are updated to the new addresses, as is the table of arrays that have been given an identity
+ hash (see #bvm_object_identity_hash).  Nothing is compacted while a debugger is attached, as it
+ knows objects by their address.  Nor is anything compacted while a native holds an array with
+ #NI_GetPrimitiveArrayCritical - the compaction stays pending until it is released.
+
+ @section dedup String Deduplication
+
+ If #BVM_GC_STRING_DEDUP_ENABLE is set, equal Strings are made to share a char array as they are marked.  A String that
+ uses the whole of an unmarked array has the array hashed by content and looked up in a fixed size table (see
+ #BVM_GC_STRING_DEDUP_TABLE_SIZE) of the arrays marked so far by the GC.  If an equal array is there the String is given
+ it, and its own is not marked - the sweep frees it unless something else (a StringBuffer it was shared with, say) marks
+ it.  Otherwise its array goes into the table.  Strings are immutable, so which of the equal arrays a String has is not
+ seen by Java code.  The table is cleared when marking is done.
+
+ @section parallel Parallel Marking
+
+ If #BVM_GC_PARALLEL_MARK_ENABLE is set the marking of a GC may be shared between the VM thread and some host OS
+ threads (see #bvm_gl_gc_mark_threads).  The Java threads are all stopped for the whole of the GC so, unlike incremental
+ marking, nothing changes under the markers and no write barrier is needed.  The VM thread finds the roots as usual, but
+ only colours them grey and pushes them onto the mark stack.  When the stack fills, or all the roots have been found,
+ #gc_mark_drain starts the other markers and the VM thread becomes the first of them.  Each marker pops and scans grey
+ chunks from a mark stack of its own.  A white chunk is claimed by whichever marker turns it grey with an atomic
+ compare-and-swap of its header (#gc_marker_push), so each chunk is scanned by only one of them.  A marker with nothing
+ left takes chunks from a shared pool, and a busy marker that sees another waiting moves half its stack into the pool.
+ Marking is done when every marker is waiting and the pool is empty.
+
+ A marker with a full stack that cannot move any of it into the pool leaves the chunk grey and unpushed - as for the
+ serial marker, it is found by #gc_rescan_heap.  Weak references are added to the one list under the pool's lock, and
+ each marker counts the soft references it marks for the VM thread to add up afterwards.  A GC with less than
+ #BVM_GC_PARALLEL_MARK_MIN_USED of the heap in use is marked by the VM thread alone.
+
+ @section concurrent Concurrent Sweeping
+
+ If #BVM_GC_CONCURRENT_SWEEP_ENABLE is set the sweep of a GC is done by a host OS thread while the interpreter runs on.
+ Large object regions are swept in the pause and the free list is emptied - everything else is free again only once
+ the sweeper thread has handed it back.  The sweeper joins each run of free and unreachable chunks into one free chunk
+ and hands the chunks back every #BVM_GC_CONCURRENT_SWEEP_STEP bytes, always just after a live chunk.  As for the lazy
+ sweep, the allocator takes them into the free list with #bvm_gc_sweep_step when it runs short, and waits for the
+ sweeper if it has nothing new.  Nothing ahead of the sweep position is coalesced by the VM thread, and a chunk freed
+ there by #bvm_heap_free is held until the sweep is done.
+
+ The sweeper changes the headers of live chunks it passes (whitening them and setting their P bit) while the interpreter
+ may be changing their alloc type, so both do so with an atomic compare-and-swap, and thin lock headers are not used.
+ Unreachable clazzes are taken out of the clazz pool in the pause, but are unloaded by the VM thread once the sweep is
+ done, as unloading frees other memory and flushes VM caches.  The heap regions are adjusted then too.  With a debugger
+ attached the heap is swept in the pause as usual.
+
  @section future Future notes:
 
- The current algorithm does not limit recursion depth so, in theory, it could crash the VM if it does not have enough 'C'
- stack space.  This is bad.  The collector really ought to be able to make it way through a collection without the possibility
- of crashing the VM.  Perhaps the same collection could be used to limit the recursion depth by stopping recursion
- at a given level.
+ Marking does not recurse.  Grey chunks are pushed onto a fixed size mark stack (see #BVM_GC_MARK_STACK_DEPTH) that lives
+ outside the heap and are scanned as they are popped.  If the stack fills, further grey chunks are left grey and unpushed and
+ the heap is later walked to find and mark them.  Marking therefore uses a bounded amount of 'C' stack for any object graph.
 
   @author Greg McCreath
   @since 0.0.10
@@ -170,39 +336,426 @@
 */
 
 /** The permanent roots stack */
-bvm_cell_t *bvm_gl_gc_permanent_roots = NULL;
+BVM_VM_LOCAL bvm_cell_t *bvm_gl_gc_permanent_roots = NULL;
 
 /** The current top of the permanent root stack */
-bvm_uint32_t bvm_gl_gc_permanent_roots_top;
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_gc_permanent_roots_top;
 
 /** The transient roots stack */
-bvm_cell_t *bvm_gl_gc_transient_roots = NULL;
+BVM_VM_LOCAL bvm_cell_t *bvm_gl_gc_transient_roots = NULL;
 
 /** The current top of the transient root stack */
-bvm_uint32_t bvm_gl_gc_transient_roots_top;
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_gc_transient_roots_top;
 
 /**
  * The default transient root stack depth (actual depth, not in BVM_KB). Defaults to #BVM_GC_TRANSIENT_ROOTS_DEPTH.
  */
-bvm_uint32_t bvm_gl_gc_transient_roots_depth = BVM_GC_TRANSIENT_ROOTS_DEPTH;
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_gc_transient_roots_depth = BVM_GC_TRANSIENT_ROOTS_DEPTH;
 
 /**
  * The permanent root stack depth (actual depth, not in BVM_KB).  Defaults to #BVM_GC_PERMANENT_ROOTS_DEPTH.
  */
-bvm_uint32_t bvm_gl_gc_permanent_roots_depth = BVM_GC_PERMANENT_ROOTS_DEPTH;
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_gc_permanent_roots_depth = BVM_GC_PERMANENT_ROOTS_DEPTH;
 
 /** Handle to head of weak references found during marking phase */
-static bvm_weak_reference_obj_t *weak_refs = NULL;
+static BVM_VM_LOCAL bvm_weak_reference_obj_t *weak_refs = NULL;
+
+/** Handle to the last of the weak references found during marking phase - its \c next is \c NULL */
+static BVM_VM_LOCAL bvm_weak_reference_obj_t *weak_refs_tail = NULL;
+
+/** Handle to head of the ephemerons found during marking phase with a key that was not marked at the time */
+static BVM_VM_LOCAL bvm_weak_reference_obj_t *ephemerons = NULL;
+
+/** Handle to the last of the ephemerons found during marking phase - its \c next is \c NULL */
+static BVM_VM_LOCAL bvm_weak_reference_obj_t *ephemerons_tail = NULL;
+
+/** The soft reference clock.  Ticks each time a soft reference is made or got - soft references are cleared
+ * least recently used first by comparing their timestamps against it. */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_gc_soft_clock = 0;
+
+/** Set while a GC is clearing soft references for #bvm_gc_clear_soft_references */
+static BVM_VM_LOCAL bvm_bool_t gc_soft_clearing = BVM_FALSE;
+
+/** While #gc_soft_clearing, soft references at least this old (by #bvm_gl_gc_soft_clock) are treated as weak */
+static BVM_VM_LOCAL bvm_uint32_t gc_soft_clear_age;
+
+/** The number of soft references with a referent marked by the GC in progress */
+static BVM_VM_LOCAL bvm_uint32_t gc_soft_marked = 0;
+
+/** The age of the oldest soft reference with a referent marked by the GC in progress */
+static BVM_VM_LOCAL bvm_uint32_t gc_soft_marked_age = 0;
+
+/** #gc_soft_marked as at the end of the last GC's marking */
+static BVM_VM_LOCAL bvm_uint32_t gc_soft_live = 0;
+
+/** #gc_soft_marked_age as at the end of the last GC's marking */
+static BVM_VM_LOCAL bvm_uint32_t gc_soft_live_age = 0;
+
+/** The mark stack of grey chunks waiting to be scanned */
+static BVM_VM_LOCAL bvm_chunk_t *gc_mark_stack[BVM_GC_MARK_STACK_DEPTH];
+
+/** The current top of the mark stack */
+static BVM_VM_LOCAL bvm_uint32_t gc_mark_stack_top = 0;
+
+/** Set if a grey chunk could not be pushed because the mark stack was full */
+static BVM_VM_LOCAL bvm_bool_t gc_mark_stack_overflowed = BVM_FALSE;
+
+#if BVM_GC_PARALLEL_MARK_ENABLE
+
+/** The number of markers that share the marking of a GC, the VM thread included.  Defaults to #BVM_GC_MARK_THREADS. */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_gc_mark_threads = BVM_GC_MARK_THREADS;
+
+/**
+ * One of the markers of a parallel marking - the VM thread or a host thread.
+ */
+typedef struct _gcmarkerstruct {
+
+	/** The grey chunks this marker has claimed but not yet scanned */
+	bvm_chunk_t **stack;
+
+	/** The current top of the marker's stack */
+	bvm_uint32_t top;
+
+	/** Set if a grey chunk could not be pushed because the marker's stack and the pool were both full */
+	bvm_bool_t overflowed;
+
+	/** The number of soft references with a referent marked by this marker */
+	bvm_uint32_t soft_marked;
+
+	/** The age of the oldest soft reference with a referent marked by this marker */
+	bvm_uint32_t soft_marked_age;
+
+	/** The host thread the marker runs on, or \c NULL for the VM thread */
+	void *thread;
+
+} gc_marker_t;
+
+/**
+ * The work shared between the markers of a parallel marking.  All but \c lock are only touched while holding \c lock.
+ */
+typedef struct _gcmarkpoolstruct {
+
+	/** The lock the markers share, or \c NULL if the VM thread is marking alone */
+	void *lock;
+
+	/** Grey chunks given up by a busy marker for an idle one to take */
+	bvm_chunk_t **chunks;
+
+	/** The number of chunks the pool has room for */
+	bvm_uint32_t size;
+
+	/** The number of chunks in the pool */
+	bvm_uint32_t count;
+
+	/** The number of markers running */
+	bvm_uint32_t markers;
+
+	/** The number of markers waiting for work.  Read without the lock by a busy marker as a hint that it should
+	 * share. */
+	bvm_uint32_t idle;
+
+} gc_mark_pool_t;
+
+/** The pool of the parallel marking in progress */
+static BVM_VM_LOCAL gc_mark_pool_t gc_mark_pool;
+
+/** The marker of the calling thread during a parallel marking, \c NULL otherwise */
+static BVM_PD_THREAD_LOCAL gc_marker_t *gc_marker = NULL;
+
+/** Take the pool lock, if there is one */
+#define GC_MARK_POOL_LOCK() {										\
+	if (gc_mark_pool.lock != NULL) bvm_pd_system_lock(gc_mark_pool.lock);	\
+}
+
+/** Let go of the pool lock, if there is one */
+#define GC_MARK_POOL_UNLOCK() {										\
+	if (gc_mark_pool.lock != NULL) bvm_pd_system_unlock(gc_mark_pool.lock);	\
+}
+
+static void gc_marker_push(bvm_chunk_t *chunk);
+
+#endif
+
+#if BVM_GC_GENERATIONAL_ENABLE
+
+/** The remembered set - old chunks that have had a reference to a new chunk stored into them since the last collection */
+static BVM_VM_LOCAL bvm_chunk_t *gc_remembered_set[BVM_GC_REMEMBERED_SET_SIZE];
+
+/** The current top of the remembered set */
+static BVM_VM_LOCAL bvm_uint32_t gc_remembered_set_top = 0;
+
+/** Set if a chunk could not be added to the remembered set because it was full.  Forces the next collection to be full. */
+static BVM_VM_LOCAL bvm_bool_t gc_remembered_set_overflowed = BVM_FALSE;
+
+#endif
+
+#if BVM_GC_INCREMENTAL_ENABLE
+
+/** Set while an incremental marking cycle is in progress - between its first slice and the end of its sweep */
+BVM_VM_LOCAL bvm_bool_t bvm_gl_gc_is_marking = BVM_FALSE;
+
+/** The number of chunks scanned by each slice of incremental marking.  Defaults to #BVM_GC_INCREMENTAL_SLICE_BUDGET. */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_gc_slice_budget = BVM_GC_INCREMENTAL_SLICE_BUDGET;
+
+/** Set while the roots are being greyed at the start of an incremental cycle - they are pushed, but not yet scanned */
+static BVM_VM_LOCAL bvm_bool_t gc_defer_marking = BVM_FALSE;
+
+#endif
+
+#if BVM_GC_BUDGET_ENABLE
+
+/** The bytes that may be allocated after a GC before one is started at a thread switch.  Defaults to
+ * #BVM_GC_ALLOC_BUDGET. */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_gc_alloc_budget = BVM_GC_ALLOC_BUDGET;
+
+/** A GC is started at a thread switch when less than this percentage of the heap is free.  Defaults to
+ * #BVM_GC_BUDGET_FREE_PERCENT. */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_gc_budget_free_percent = BVM_GC_BUDGET_FREE_PERCENT;
+
+#endif
+
+#if BVM_GC_IDLE_ENABLE
+
+/** The shortest time in milliseconds the VM must expect to be idle for a GC to be done in it.  Defaults to
+ * #BVM_GC_IDLE_MIN_TIME. */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_gc_idle_min_time = BVM_GC_IDLE_MIN_TIME;
+
+#endif
+
+#if BVM_GC_COMPACTION_ENABLE
+
+/** Set after a GC that left the heap fragmented */
+BVM_VM_LOCAL bvm_bool_t bvm_gl_gc_compact_pending = BVM_FALSE;
+
+/**
+ * An entry in the compaction table.  An array that is pinned (it may not be moved) has a \c to of \c NULL.
+ */
+typedef struct _gccompactentrystruct {
+
+	/** The chunk (at its current address) */
+	bvm_chunk_t *from;
+
+	/** Where the chunk is to be moved to, or \c NULL if it is pinned */
+	bvm_chunk_t *to;
+
+	/** The size of the chunk once moved - it may grow to take up a gap too small to be a free chunk */
+	bvm_uint32_t size;
+
+} gc_compact_entry_t;
+
+/** The number of slots in the compaction hash table - kept at most half full */
+#define GC_COMPACT_TABLE_SLOTS	(BVM_GC_COMPACT_TABLE_SIZE * 2)
+
+/** The compaction table - an open addressed hash table of the arrays pinned or moved by a compaction */
+static BVM_VM_LOCAL gc_compact_entry_t gc_compact_table[GC_COMPACT_TABLE_SLOTS];
+
+/** The number of entries in the compaction table */
+static BVM_VM_LOCAL bvm_uint32_t gc_compact_table_count = 0;
+
+/** Set if an array could not be pinned because the compaction table was full - the compaction is abandoned */
+static BVM_VM_LOCAL bvm_bool_t gc_compact_overflowed = BVM_FALSE;
+
+/** Set while marking for a compaction - arrays found by the root scan are pinned */
+static BVM_VM_LOCAL bvm_bool_t gc_pinning = BVM_FALSE;
+
+/** Can a compaction move the given chunk?  Only arrays are ever moved. */
+#define GC_IsMovable(c) ( (BVM_CHUNK_GetType(c) == BVM_ALLOC_TYPE_ARRAY_OF_PRIMITIVE) ||		\
+						  (BVM_CHUNK_GetType(c) == BVM_ALLOC_TYPE_ARRAY_OF_OBJECT) )
+
+static void gc_compact_pin(bvm_chunk_t *chunk);
+static void gc_check_fragmentation();
+
+#endif
+
+#if BVM_GC_STRING_DEDUP_ENABLE
+
+/** The number of slots in the String deduplication table - kept at most half full */
+#define GC_DEDUP_TABLE_SLOTS	(BVM_GC_STRING_DEDUP_TABLE_SIZE * 2)
+
+/** The String deduplication table - an open addressed hash table of the String char arrays marked by this GC */
+static BVM_VM_LOCAL bvm_jchar_array_obj_t *gc_dedup_table[GC_DEDUP_TABLE_SLOTS];
+
+/** The number of arrays in the String deduplication table */
+static BVM_VM_LOCAL bvm_uint32_t gc_dedup_table_count = 0;
+
+/** The number of Strings given another char array by this GC */
+static BVM_VM_LOCAL bvm_uint32_t gc_dedup_strings = 0;
+
+#endif
+
+#if BVM_GC_STATS_ENABLE
+
+/** If #BVM_TRUE each GC is logged to the console.  Set with the \c -verbose:gc command line option. */
+BVM_VM_LOCAL bvm_bool_t bvm_gl_gc_verbose = BVM_FALSE;
+
+/** The statistics kept by the collector - see #bvm_gc_get_stats */
+static BVM_VM_LOCAL bvm_gc_stats_t gc_stats;
+
+/** The name of each alloc type used for GC logging, indexed by alloc type */
+static const char *gc_stats_type_names[BVM_ALLOC_MAX_TYPE + 1] = {
+	"object", "primitive_array", "object_array", "string", "weak_reference", "soft_reference", "ephemeron", "data",
+	"array_clazz", "primitive_clazz", "instance_clazz", "static", "backtrace"
+};
+
+static void gc_stats_log();
+
+/** Count a chunk of the given alloc type and size as reclaimed by the current GC */
+#define GC_STATS_RECLAIMED(t, s) {																\
+	gc_stats.last_reclaimed_by_type[t] += (s);													\
+	gc_stats.last_reclaimed += (s);																\
+}
+
+#else
+#define GC_STATS_RECLAIMED(t, s) {}
+#endif
+
+/**
+ * Colour the given chunk #BVM_GC_COLOUR_GREY and push it onto the mark stack to be scanned.  If the mark
+ * stack is full the chunk is left grey (but not pushed) and the overflow is noted - it will be found by #gc_rescan_heap.
+ */
+#define GC_PUSH_GREY(c) {											\
+	BVM_CHUNK_SetColour(c, BVM_GC_COLOUR_GREY);						\
+	if (gc_mark_stack_top < BVM_GC_MARK_STACK_DEPTH)				\
+		gc_mark_stack[gc_mark_stack_top++] = (c);					\
+	else															\
+		gc_mark_stack_overflowed = BVM_TRUE;						\
+}
+
+/**
+ * If the given chunk is white push it onto the mark stack as for #GC_PUSH_GREY.
+ */
+#if BVM_GC_PARALLEL_MARK_ENABLE
+#define GC_MARK_GREY(c) {											\
+	if (BVM_CHUNK_GetColour(c) == BVM_GC_COLOUR_WHITE)				\
+		gc_marker_push(c);											\
+}
+#else
+#define GC_MARK_GREY(c) {											\
+	if (BVM_CHUNK_GetColour(c) == BVM_GC_COLOUR_WHITE)				\
+		GC_PUSH_GREY(c)												\
+}
+#endif
+
+/**
+ * Add a weak reference (or an ephemeron) to the head of a list of them - #weak_refs or #ephemerons.  A chunk may be
+ * scanned more than once in a cycle (a root that is scanned again, for example) so it is only added if it is not
+ * already in the list.
+ */
+#if BVM_GC_PARALLEL_MARK_ENABLE
+#define GC_ADD_REFERENCE(r, list, tail) {									\
+	bvm_weak_reference_obj_t *_wr = (r);									\
+	GC_MARK_POOL_LOCK();													\
+	if ( (_wr->next == NULL) && (_wr != tail) ) {							\
+		if (list == NULL) tail = _wr;										\
+		_wr->next = list;													\
+		list = _wr;															\
+	}																		\
+	GC_MARK_POOL_UNLOCK();													\
+}
+#else
+#define GC_ADD_REFERENCE(r, list, tail) {									\
+	bvm_weak_reference_obj_t *_wr = (r);									\
+	if ( (_wr->next == NULL) && (_wr != tail) ) {							\
+		if (list == NULL) tail = _wr;										\
+		_wr->next = list;													\
+		list = _wr;															\
+	}																		\
+}
+#endif
+
+/** Add a weak reference to the #weak_refs list */
+#define GC_ADD_WEAK_REFERENCE(r) GC_ADD_REFERENCE(r, weak_refs, weak_refs_tail)
+
+/** Add an ephemeron to the #ephemerons list */
+#define GC_ADD_EPHEMERON(r) GC_ADD_REFERENCE((bvm_weak_reference_obj_t *) (r), ephemerons, ephemerons_tail)
+
+/** The number of fields of an ephemeron that are not traced by the marker - its key, its \c next and its value */
+#define GC_EPHEMERON_OWN_FIELDS ( (bvm_uint16_t) ((sizeof(bvm_ephemeron_obj_t) - BVM_OBJECT_HEADER_SIZE) / sizeof(bvm_cell_t)) )
+
+/** The number of fields of a soft reference that are not traced by the marker - its referent, its \c next and its
+ * timestamp */
+#define GC_SOFT_REFERENCE_OWN_FIELDS ( (bvm_uint16_t) ((sizeof(bvm_soft_reference_obj_t) - BVM_OBJECT_HEADER_SIZE) / sizeof(bvm_cell_t)) )
+
+/**
+ * Count a soft reference of the given age whose referent is marked.  For parallel marking the count is the calling
+ * marker's own.
+ */
+#if BVM_GC_PARALLEL_MARK_ENABLE
+#define GC_COUNT_SOFT_MARKED(a) {											\
+	gc_marker->soft_marked++;												\
+	if ((a) > gc_marker->soft_marked_age) gc_marker->soft_marked_age = (a);	\
+}
+#else
+#define GC_COUNT_SOFT_MARKED(a) {											\
+	gc_soft_marked++;														\
+	if ((a) > gc_soft_marked_age) gc_soft_marked_age = (a);					\
+}
+#endif
+
+#if BVM_GC_STRING_DEDUP_ENABLE
 
 /**
- * For a given memory chunk perform a mark on its contents.  The heap allocation type of the
- * chunk determines its structure and therefore how it is marked.  This function is recursive where
- * it needs to be.  Before recursing, the chunk colour will be set to #BVM_GC_COLOUR_GREY - we use the
- * grey colour to indicate that the chunk's marking is in progress.
+ * Give the char array a String should use - an equal array already marked by this GC, or its own.  If its own is
+ * used it is remembered (if there is room) for the Strings that follow.
  *
- * @param chunk the chunk to mark
+ * @param chars - the as yet unmarked char array of a String that uses all of it.
+ * @return the char array for the String.
  */
-static void gc_mark_chunk(bvm_chunk_t *chunk) {
+static bvm_jchar_array_obj_t *gc_dedup_chars(bvm_jchar_array_obj_t *chars) {
+
+	bvm_uint32_t length = chars->length.int_value;
+	bvm_uint32_t hash = length;
+	bvm_uint32_t i;
+	bvm_jchar_array_obj_t *other;
+
+	for (i = 0; i < length; i++)
+		hash = (31 * hash) + chars->data[i];
+
+	hash ^= (hash >> 16);
+
+	for (i = hash & (GC_DEDUP_TABLE_SLOTS - 1); (other = gc_dedup_table[i]) != NULL; i = (i + 1) & (GC_DEDUP_TABLE_SLOTS - 1)) {
+		if ( ((bvm_uint32_t) other->length.int_value == length) &&
+			 (memcmp(other->data, chars->data, length * sizeof(bvm_uint16_t)) == 0) ) {
+			gc_dedup_strings++;
+			return other;
+		}
+	}
+
+	if (gc_dedup_table_count < BVM_GC_STRING_DEDUP_TABLE_SIZE) {
+		gc_dedup_table[i] = chars;
+		gc_dedup_table_count++;
+	}
+
+	return chars;
+}
+
+/**
+ * Forget the String char arrays of this GC.  Called once marking is done - the arrays may be freed or moved after it.
+ */
+static void gc_dedup_reset() {
+
+#if BVM_GC_STATS_ENABLE
+	gc_stats.last_deduplicated = gc_dedup_strings;
+#endif
+	gc_dedup_strings = 0;
+
+	if (gc_dedup_table_count > 0) {
+		memset(gc_dedup_table, 0, sizeof(gc_dedup_table));
+		gc_dedup_table_count = 0;
+	}
+}
+
+#endif
+
+/**
+ * For a given memory chunk perform a scan of its contents.  The heap allocation type of the
+ * chunk determines its structure and therefore how it is scanned.  Each white chunk referenced by the chunk is
+ * coloured #BVM_GC_COLOUR_GREY and pushed onto the mark stack - we use the grey colour to indicate that the chunk's
+ * marking is in progress.  Nothing here recurses.
+ *
+ * @param chunk the chunk to scan
+ */
+static void gc_scan_chunk(bvm_chunk_t *chunk) {
 
 
 	int type = BVM_CHUNK_GetType(chunk);
@@ -211,52 +764,30 @@ static void gc_mark_chunk(bvm_chunk_t *chunk) {
 
 		case BVM_ALLOC_TYPE_OBJECT: {
 
-			/* For an object chunk we loop through every non-static reference field (object/array) defined for
-			 * that object's class and all its superclasses.
-			 *
-			 * Note that clazz field definitions are sorted with all static fields first followed by
-			 * all non-static ( .. or 'virtual') fields.  The virtual fields start at the
-			 * 'virtual_field_offset' value stored with the clazz.
+			/* For an object chunk we loop through the offsets of every non-static reference field (object/array)
+			 * defined for that object's class and all its superclasses.  The offsets are pre-calculated
+			 * as the class is loaded so we need not look at the field definitions at all.
 			 */
 
 			bvm_obj_t *obj = BVM_CHUNK_GetUserData(chunk);
 			bvm_instance_clazz_t *clazz = (bvm_instance_clazz_t *) obj->clazz;
-
-			/* default the start and end of the loop to use virtual fields */
+			bvm_uint16_t *offsets = clazz->ref_field_offsets;
 			int i;
 
-			while (clazz != NULL) {
-
-				/* search all the virtual fields of the object */
-				for (i=clazz->virtual_field_offset; i < clazz->fields_count; i++) {
-					bvm_chunk_t *field_chunk;
-					bvm_obj_t *ptr;
-					bvm_field_t *field = &clazz->fields[i];
-
-					/* Deal only with array or object fields.  Arrays field descriptors will begin with '[' and
-					 * reference field descriptors will begin with 'L' */
-					if ( (field->jni_signature->data[0] == '[') || (field->jni_signature->data[0] == 'L')) {
+			for (i = clazz->ref_fields_count; i--;) {
 
-						/* get a handle to the reference field value */
-						ptr = obj->fields[field->value.offset].ref_value;
+				/* get a handle to the reference field value */
+				bvm_obj_t *ptr = obj->fields[offsets[i]].ref_value;
 
-						/* if the field does not have a null value we'll check it out */
-						if (ptr != NULL) {
+				/* if the field does not have a null value we'll check it out */
+				if (ptr != NULL) {
 
-							/* get the chunk that the value of the field is housed in */
-							field_chunk = BVM_CHUNK_GetPointerChunk(ptr);
+					/* get the chunk that the value of the field is housed in */
+					bvm_chunk_t *field_chunk = BVM_CHUNK_GetPointerChunk(ptr);
 
-							/* if we've not yet marked this chunk, set about doing it */
-							if (BVM_CHUNK_GetColour(field_chunk) == BVM_GC_COLOUR_WHITE)  {
-								BVM_CHUNK_SetColour(field_chunk, BVM_GC_COLOUR_GREY);
-								gc_mark_chunk(field_chunk);
-							}
-						}
-					}
+					/* if we've not yet marked this chunk, push it */
+					GC_MARK_GREY(field_chunk);
 				}
-
-				/* okay, done all this class's virtual fields, so go to it's superclass */
-				clazz = clazz->super_clazz;
 			}
 
 			break;
@@ -266,7 +797,7 @@ static void gc_mark_chunk(bvm_chunk_t *chunk) {
 			break;
 		case BVM_ALLOC_TYPE_ARRAY_OF_OBJECT: {
 
-			/* If we have an array of objects we'll recurse on each of them individually. */
+			/* If we have an array of objects we'll push each of them individually. */
 			bvm_instance_array_obj_t *array = (bvm_instance_array_obj_t *) BVM_CHUNK_GetUserData(chunk);
 			bvm_uint32_t i;
 
@@ -274,7 +805,7 @@ static void gc_mark_chunk(bvm_chunk_t *chunk) {
 			for (i=array->length.int_value; i--;) {
 
 				/* get the object at array element 'i'. */
-				bvm_obj_t *obj = (bvm_obj_t *) array->data[i];
+				bvm_obj_t *obj = BVM_REF_Decode(array->data[i]);
 
 				/* if the object has a value */
 				if (obj != NULL) {
@@ -282,15 +813,8 @@ static void gc_mark_chunk(bvm_chunk_t *chunk) {
 					/* get the object's chunk */
 					bvm_chunk_t *obj_chunk = BVM_CHUNK_GetPointerChunk(obj);
 
-					/* if we have not already marked the object's chunk, do so */
-					if (BVM_CHUNK_GetColour(obj_chunk) == BVM_GC_COLOUR_WHITE) {
-						BVM_CHUNK_SetColour(obj_chunk, BVM_GC_COLOUR_GREY);
-						gc_mark_chunk(obj_chunk);
-					}
-
-					/* set the colour of the object to black - having arrived here means all
-					 * its children have been marked / recursed. */
-					BVM_CHUNK_SetColour(obj_chunk, BVM_GC_COLOUR_BLACK);
+					/* if we have not already marked the object's chunk, push it */
+					GC_MARK_GREY(obj_chunk);
 				}
 			}
 
@@ -305,6 +829,16 @@ static void gc_mark_chunk(bvm_chunk_t *chunk) {
 			 * with StringBuffer objects and other String objects, but we'll not check if a char
 			 * array has already been marked - we'll just mark it regardless.  */
 			bvm_string_obj_t *string = (bvm_string_obj_t *) BVM_CHUNK_GetUserData(chunk);
+
+#if BVM_GC_STRING_DEDUP_ENABLE
+			/* a String that uses all of an array no one has marked yet may share an equal one instead.  Its own is
+			 * then left white for the sweep - unless something else marks it. */
+			if ( (string->chars != NULL) && (string->offset.int_value == 0) &&
+				 (string->length.int_value == string->chars->length.int_value) &&
+				 (BVM_CHUNK_GetColour(BVM_CHUNK_GetPointerChunk(string->chars)) == BVM_GC_COLOUR_WHITE) )
+				string->chars = gc_dedup_chars(string->chars);
+#endif
+
 			if (string->chars != NULL)
 				BVM_CHUNK_SetColour(BVM_CHUNK_GetPointerChunk(string->chars), BVM_GC_COLOUR_BLACK);
 
@@ -316,10 +850,77 @@ static void gc_mark_chunk(bvm_chunk_t *chunk) {
 			 * last thing before a sweep.  Any weak refs that have not had their referent objects marked have it
 			 * set to NULL - we do not mark them here. The WeakReference object however, will be marked black. */
 
-			bvm_weak_reference_obj_t *weak_reference = (bvm_weak_reference_obj_t *) BVM_CHUNK_GetUserData(chunk);
+			GC_ADD_WEAK_REFERENCE( (bvm_weak_reference_obj_t *) BVM_CHUNK_GetUserData(chunk));
+
+			break;
+		}
+		case BVM_ALLOC_TYPE_SOFT_REFERENCE: {
+
+			/* a soft reference is strong unless soft references are being cleared and it is old enough to go - in
+			 * which case it is just a weak reference. */
+
+			bvm_soft_reference_obj_t *soft_reference = (bvm_soft_reference_obj_t *) BVM_CHUNK_GetUserData(chunk);
+			bvm_instance_clazz_t *clazz = (bvm_instance_clazz_t *) soft_reference->clazz;
+			bvm_uint16_t *offsets = clazz->ref_field_offsets;
+			bvm_uint32_t age = bvm_gl_gc_soft_clock - (bvm_uint32_t) soft_reference->timestamp.int_value;
+			int i;
+
+			/* any fields of a subclass are marked as for an object */
+			for (i = clazz->ref_fields_count; i--;) {
+
+				bvm_obj_t *ptr;
+
+				if (offsets[i] < GC_SOFT_REFERENCE_OWN_FIELDS) continue;
+
+				ptr = ((bvm_obj_t *) soft_reference)->fields[offsets[i]].ref_value;
+
+				if (ptr != NULL) GC_MARK_GREY(BVM_CHUNK_GetPointerChunk(ptr));
+			}
+
+			if (soft_reference->referent == NULL) break;
+
+			if (gc_soft_clearing && (age >= gc_soft_clear_age)) {
+				GC_ADD_WEAK_REFERENCE( (bvm_weak_reference_obj_t *) soft_reference);
+			} else {
+
+				/* a chunk may be scanned more than once in a cycle - the counts are only a guide */
+				GC_COUNT_SOFT_MARKED(age);
+
+				GC_MARK_GREY(BVM_CHUNK_GetPointerChunk(soft_reference->referent));
+			}
+
+			break;
+		}
+		case BVM_ALLOC_TYPE_EPHEMERON: {
+
+			/* the value of an ephemeron is marked only if its key is marked.  If the key is not marked yet the
+			 * ephemeron is looked at again once the rest of marking is done - see gc_visit_ephemerons. */
+
+			bvm_ephemeron_obj_t *ephemeron = (bvm_ephemeron_obj_t *) BVM_CHUNK_GetUserData(chunk);
+			bvm_instance_clazz_t *clazz = (bvm_instance_clazz_t *) ephemeron->clazz;
+			bvm_uint16_t *offsets = clazz->ref_field_offsets;
+			int i;
+
+			/* any fields of a subclass are marked as for an object */
+			for (i = clazz->ref_fields_count; i--;) {
+
+				bvm_obj_t *ptr;
+
+				if (offsets[i] < GC_EPHEMERON_OWN_FIELDS) continue;
+
+				ptr = ((bvm_obj_t *) ephemeron)->fields[offsets[i]].ref_value;
 
-			weak_reference->next = weak_refs;
-			weak_refs = weak_reference;
+				if (ptr != NULL) GC_MARK_GREY(BVM_CHUNK_GetPointerChunk(ptr));
+			}
+
+			if (ephemeron->value == NULL) break;
+
+			if ( (ephemeron->referent == NULL) ||
+				 (BVM_CHUNK_GetColour(BVM_CHUNK_GetPointerChunk(ephemeron->referent)) != BVM_GC_COLOUR_WHITE) ) {
+				GC_MARK_GREY(BVM_CHUNK_GetPointerChunk(ephemeron->value));
+			} else {
+				GC_ADD_EPHEMERON(ephemeron);
+			}
 
 			break;
 		}
@@ -338,10 +939,7 @@ static void gc_mark_chunk(bvm_chunk_t *chunk) {
 			if (classloader_obj != NULL) {
 				bvm_chunk_t* loader_chunk = BVM_CHUNK_GetPointerChunk(classloader_obj);
 
-				if (BVM_CHUNK_GetColour(loader_chunk) == BVM_GC_COLOUR_WHITE) {
-					BVM_CHUNK_SetColour(loader_chunk, BVM_GC_COLOUR_GREY);
-					gc_mark_chunk(loader_chunk);
-				}
+				GC_MARK_GREY(loader_chunk);
 			}
 
 			break;
@@ -363,10 +961,7 @@ static void gc_mark_chunk(bvm_chunk_t *chunk) {
 				if (clazz->classloader_obj != NULL) {
 					bvm_chunk_t* loader_chunk = BVM_CHUNK_GetPointerChunk(clazz->classloader_obj);
 
-					if (BVM_CHUNK_GetColour(loader_chunk) == BVM_GC_COLOUR_WHITE) {
-						BVM_CHUNK_SetColour(loader_chunk, BVM_GC_COLOUR_GREY);
-						gc_mark_chunk(loader_chunk);
-					}
+					GC_MARK_GREY(loader_chunk);
 				}
 
 				/* search all the static fields of the clazz */
@@ -390,11 +985,8 @@ static void gc_mark_chunk(bvm_chunk_t *chunk) {
 							/* get the chunk that the value of the field is housed in */
 							field_chunk = BVM_CHUNK_GetPointerChunk(ptr);
 
-							/* if we've not yet marked this chunk, set about doing it */
-							if (BVM_CHUNK_GetColour(field_chunk) == BVM_GC_COLOUR_WHITE) {
-								BVM_CHUNK_SetColour(field_chunk, BVM_GC_COLOUR_GREY);
-								gc_mark_chunk(field_chunk);
-							}
+							/* if we've not yet marked this chunk, push it */
+							GC_MARK_GREY(field_chunk);
 						}
 					}
 
@@ -414,81 +1006,341 @@ static void gc_mark_chunk(bvm_chunk_t *chunk) {
 		case BVM_ALLOC_TYPE_STATIC:
 			/* Ignore.  Mark Black.  Will not be freed. */
 			break;
+#if (BVM_STACKTRACE_ENABLE && BVM_STACKTRACE_LAZY_ENABLE)
+		case BVM_ALLOC_TYPE_BACKTRACE: {
+
+			/* A compact backtrace holds method pointers that are resolved to names and line numbers
+			 * later.  Mark the clazz of each method so it is not unloaded before then. */
+			bvm_stack_backtrace_t *backtrace = (bvm_stack_backtrace_t *) BVM_CHUNK_GetUserData(chunk);
+			int i;
+
+			for (i = backtrace->depth; i--;) {
+				GC_MARK_GREY(BVM_CHUNK_GetPointerChunk(backtrace->frames[i].method->clazz));
+			}
+
+			break;
+		}
+#endif
 	}
 
 	/* set the chunk's colour to black to say we have fully scanned it */
 	BVM_CHUNK_SetColour(chunk, BVM_GC_COLOUR_BLACK);
 }
 
+#if BVM_GC_PARALLEL_MARK_ENABLE
+
 /**
- * Mark the String objects contained in the interned string pool as black.  Interned String objects are
- * not garbage collected.
+ * Move half of a marker's stack into the pool for an idle marker to take - as much as the pool has room for.
+ *
+ * @param marker - the calling marker.
  */
-static void gc_mark_interned_strings() {
+static void gc_marker_share(gc_marker_t *marker) {
 
-	int i;
-	bvm_internstring_obj_t *string;
-	bvm_chunk_t *chunk;
+	bvm_uint32_t count;
 
-#if BVM_DEBUG_HEAP_GC_ON_ALLOC
-	/* When doing a GC before each alloc (for debugging) it is possible we can GC before the
-	 * intern string pool is alloc'd.  So we check. */
-	if (bvm_gl_internstring_pool == NULL) return;
-#endif
+	GC_MARK_POOL_LOCK();
 
-	/* loop through array for the hash pool (backwards - is slightly faster) */
-	for (i = bvm_gl_internstring_pool_bucketcount; i--;) {
+	count = marker->top / 2;
+	if (count > gc_mark_pool.size - gc_mark_pool.count) count = gc_mark_pool.size - gc_mark_pool.count;
+
+	marker->top -= count;
+	memcpy(&gc_mark_pool.chunks[gc_mark_pool.count], &marker->stack[marker->top], count * sizeof(bvm_chunk_t *));
+	gc_mark_pool.count += count;
+
+	GC_MARK_POOL_UNLOCK();
+}
 
-		/* get the string entry at hash bucket */
-		string = bvm_gl_internstring_pool[i];
+/**
+ * Claim a white chunk for the calling marker by colouring it grey, and push it onto the marker's stack.  The colour
+ * is changed with a compare-and-swap of the chunk header, so if another marker gets there first the chunk is left to
+ * it.  If the stack is full half of it is moved to the pool first - if the pool is full too the chunk is left grey
+ * and unpushed for #gc_rescan_heap.
+ *
+ * @param chunk - the chunk to claim.
+ */
+static void gc_marker_push(bvm_chunk_t *chunk) {
 
-		/* for each interned string in the bucket */
-		while (string != NULL)  {
+	gc_marker_t *marker = gc_marker;
+	bvm_chunk_header_t header;
 
-			chunk = BVM_CHUNK_GetPointerChunk(string);
+	do {
+		header = chunk->header;
+		if ( ((header & CHUNK_COLOUR_MASK) >> BVM_CHUNK_COLOUR_SHIFT) != BVM_GC_COLOUR_WHITE) return;
+	} while (!BVM_PD_ATOMIC_CAS(&chunk->header, header,
+			(header & ~CHUNK_COLOUR_MASK) | (BVM_GC_COLOUR_GREY << BVM_CHUNK_COLOUR_SHIFT)));
 
-			/* if the string is white, colour it and its char array black */
-			if (BVM_CHUNK_GetColour(chunk) == BVM_GC_COLOUR_WHITE) {
-				BVM_CHUNK_SetColour(chunk, BVM_GC_COLOUR_BLACK);
-				if (string->chars != NULL) {
-					BVM_CHUNK_SetColour(BVM_CHUNK_GetPointerChunk(string->chars), BVM_GC_COLOUR_BLACK);
-				}
-			}
+	if (marker->top == BVM_GC_MARK_STACK_DEPTH) gc_marker_share(marker);
 
-			string = string->next;
-		}
-	}
+	if (marker->top < BVM_GC_MARK_STACK_DEPTH)
+		marker->stack[marker->top++] = chunk;
+	else
+		marker->overflowed = BVM_TRUE;
 }
 
 /**
- * Mark a range of cell roots.  Each cell is ASSUMED to be a valid heap pointer so no
- * pointer checking is required.  Why?  Because this is used to scan structures that are maintained by
- * the VM - and it is only putting heap references into these structures.
+ * Give a marker that has run out of work some chunks from the pool, waiting for another marker to share some if it
+ * is empty.  Gives up once every marker is waiting.
  *
- * @param cells - the address of the first cell to scan.
- * @param count - the number of cells to scan.
+ * @param marker - the calling marker - its stack is empty.
+ * @return #BVM_TRUE if the marker was given chunks, #BVM_FALSE if marking is done.
  */
-static void gc_mark_cell_range(bvm_cell_t *cells, bvm_uint32_t count) {
+static bvm_bool_t gc_marker_take(gc_marker_t *marker) {
 
-	bvm_chunk_t *chunk;
+	bvm_bool_t taken = BVM_FALSE;
+	bvm_uint32_t count;
 
-	/* loop through cell range backwards - is slightly faster */
-	for (;count--;) {
+	GC_MARK_POOL_LOCK();
 
-		bvm_obj_t *obj = cells[count].ref_value;
+	gc_mark_pool.idle++;
 
-		if (obj != NULL) {
+	for (;;) {
 
-			/* get the chunk associated with the reference the cell points to */
-			chunk = BVM_CHUNK_GetPointerChunk(obj);
+		if (gc_mark_pool.count > 0) {
 
-			if (BVM_CHUNK_GetColour(chunk) == BVM_GC_COLOUR_WHITE) {
-				BVM_CHUNK_SetColour(chunk, BVM_GC_COLOUR_GREY);
-				gc_mark_chunk(chunk);
-			}
+			/* leave some for the others */
+			count = (gc_mark_pool.count + 1) / 2;
+			if (count > BVM_GC_MARK_STACK_DEPTH) count = BVM_GC_MARK_STACK_DEPTH;
+
+			gc_mark_pool.count -= count;
+			memcpy(marker->stack, &gc_mark_pool.chunks[gc_mark_pool.count], count * sizeof(bvm_chunk_t *));
+			marker->top = count;
+
+			gc_mark_pool.idle--;
+			taken = BVM_TRUE;
+			break;
 		}
+
+		/* nobody is left with work to share */
+		if (gc_mark_pool.idle == gc_mark_pool.markers) break;
+
+		GC_MARK_POOL_UNLOCK();
+		bvm_pd_system_thread_yield();
+		GC_MARK_POOL_LOCK();
 	}
-}
+
+	GC_MARK_POOL_UNLOCK();
+
+	return taken;
+}
+
+/**
+ * Scan the chunks of a marker's stack, and those it takes from the pool, until marking is done.
+ *
+ * @param marker - the marker of the calling thread.
+ */
+static void gc_marker_run(gc_marker_t *marker) {
+
+	gc_marker = marker;
+
+	do {
+		while (marker->top > 0) {
+
+			gc_scan_chunk(marker->stack[--marker->top]);
+
+			/* another marker has run dry - give it some of ours */
+			if ( (gc_mark_pool.idle > 0) && (marker->top > 1) ) gc_marker_share(marker);
+		}
+	} while (gc_marker_take(marker));
+
+	gc_marker = NULL;
+}
+
+/**
+ * The host thread of a marker.
+ *
+ * @param data - the #gc_marker_t of the thread.
+ */
+static void gc_marker_thread_run(void *data) {
+	gc_marker_run(data);
+}
+
+/**
+ * Scan everything on the mark stack and everything reachable from it, sharing the work with host threads if there is
+ * enough of the heap in use.  If the threads cannot be had the VM thread marks alone.
+ */
+static void gc_mark_drain() {
+
+	gc_marker_t vm_marker;
+	gc_marker_t *markers = NULL;
+	bvm_uint32_t count = 0;
+	bvm_uint32_t i;
+
+	if (gc_mark_stack_top == 0) return;
+
+	memset(&vm_marker, 0, sizeof(vm_marker));
+	vm_marker.stack = gc_mark_stack;
+	vm_marker.top = gc_mark_stack_top;
+
+	memset(&gc_mark_pool, 0, sizeof(gc_mark_pool));
+
+	if ( (bvm_gl_gc_mark_threads > 1) && ((bvm_gl_heap_size - bvm_gl_heap_free) >= BVM_GC_PARALLEL_MARK_MIN_USED) ) {
+
+		count = bvm_gl_gc_mark_threads - 1;
+
+		/* the markers, then a stack for each, then the pool - room for as much as all the stacks hold */
+		markers = bvm_pd_memory_alloc( (count * sizeof(gc_marker_t)) +
+				((count + count + 1) * BVM_GC_MARK_STACK_DEPTH * sizeof(bvm_chunk_t *)) );
+
+		if (markers != NULL) gc_mark_pool.lock = bvm_pd_system_lock_create();
+
+		if (gc_mark_pool.lock == NULL) count = 0;
+	}
+
+	gc_mark_pool.markers = 1;
+
+	if (count > 0) {
+
+		bvm_chunk_t **stacks = (bvm_chunk_t **) &markers[count];
+
+		gc_mark_pool.chunks = &stacks[count * BVM_GC_MARK_STACK_DEPTH];
+		gc_mark_pool.size = (count + 1) * BVM_GC_MARK_STACK_DEPTH;
+
+		/* the markers wait on the lock until all have been started - so they know how many of them there are */
+		bvm_pd_system_lock(gc_mark_pool.lock);
+
+		for (i = 0; i < count; i++) {
+			memset(&markers[i], 0, sizeof(gc_marker_t));
+			markers[i].stack = &stacks[i * BVM_GC_MARK_STACK_DEPTH];
+			markers[i].thread = bvm_pd_system_thread_start(gc_marker_thread_run, &markers[i]);
+			if (markers[i].thread != NULL) gc_mark_pool.markers++;
+		}
+
+		bvm_pd_system_unlock(gc_mark_pool.lock);
+	}
+
+	gc_marker_run(&vm_marker);
+
+	gc_mark_stack_top = 0;
+	if (vm_marker.overflowed) gc_mark_stack_overflowed = BVM_TRUE;
+	gc_soft_marked += vm_marker.soft_marked;
+	if (vm_marker.soft_marked_age > gc_soft_marked_age) gc_soft_marked_age = vm_marker.soft_marked_age;
+
+	for (i = 0; i < count; i++) {
+
+		if (markers[i].thread == NULL) continue;
+
+		bvm_pd_system_thread_join(markers[i].thread);
+
+		if (markers[i].overflowed) gc_mark_stack_overflowed = BVM_TRUE;
+		gc_soft_marked += markers[i].soft_marked;
+		if (markers[i].soft_marked_age > gc_soft_marked_age) gc_soft_marked_age = markers[i].soft_marked_age;
+	}
+
+	if (gc_mark_pool.lock != NULL) bvm_pd_system_lock_destroy(gc_mark_pool.lock);
+	if (markers != NULL) bvm_pd_memory_free(markers);
+
+	gc_mark_pool.lock = NULL;
+}
+
+/**
+ * Grey a chunk and push it onto the mark stack.  With parallel marking nothing is scanned until the mark stack is
+ * drained by #gc_mark_drain - when it fills, and once all the roots have been pushed.
+ *
+ * @param chunk the chunk to mark
+ */
+static void gc_mark_chunk(bvm_chunk_t *chunk) {
+
+	if (gc_mark_stack_top == BVM_GC_MARK_STACK_DEPTH) gc_mark_drain();
+
+	GC_PUSH_GREY(chunk);
+}
+
+#else
+
+/**
+ * Mark a chunk and everything reachable from it.  The chunk is scanned, and then each chunk pushed onto the mark
+ * stack is popped and scanned in turn until the stack is empty.  C stack depth is therefore bounded regardless of the
+ * shape of the object graph.
+ *
+ * @param chunk the chunk to mark
+ */
+static void gc_mark_chunk(bvm_chunk_t *chunk) {
+
+#if BVM_GC_INCREMENTAL_ENABLE
+	/* roots found at the start of an incremental cycle are only pushed - the mark stack is drained a slice at a time */
+	if (gc_defer_marking) {
+		GC_PUSH_GREY(chunk);
+		return;
+	}
+#endif
+
+	gc_scan_chunk(chunk);
+
+	while (gc_mark_stack_top > 0)
+		gc_scan_chunk(gc_mark_stack[--gc_mark_stack_top]);
+}
+
+#endif
+
+/**
+ * If the mark stack overflowed during marking there will be grey chunks in the heap that were never scanned.  Walk
+ * the heap and mark each such chunk.  As this may overflow the stack again, keep going until a walk completes without an
+ * overflow.
+ */
+static void gc_rescan_heap() {
+
+	bvm_heap_region_t *region;
+	bvm_chunk_t *chunk;
+
+	while (gc_mark_stack_overflowed) {
+
+		gc_mark_stack_overflowed = BVM_FALSE;
+
+		for (region = bvm_gl_heap_regions; region != NULL; region = region->next) {
+
+			for (chunk = (bvm_chunk_t *) region->start; chunk < (bvm_chunk_t *) region->end; chunk = BVM_CHUNK_GetNextChunk(chunk)) {
+
+				if (BVM_CHUNK_IsInuse(chunk) && (BVM_CHUNK_GetColour(chunk) == BVM_GC_COLOUR_GREY))
+					gc_mark_chunk(chunk);
+			}
+		}
+
+#if BVM_GC_PARALLEL_MARK_ENABLE
+		gc_mark_drain();
+#endif
+	}
+}
+
+/**
+ * Mark a range of cell roots.  Each cell is ASSUMED to be a valid heap pointer so no
+ * pointer checking is required.  Why?  Because this is used to scan structures that are maintained by
+ * the VM - and it is only putting heap references into these structures.
+ *
+ * @param cells - the address of the first cell to scan.
+ * @param count - the number of cells to scan.
+ */
+static void gc_mark_cell_range(bvm_cell_t *cells, bvm_uint32_t count) {
+
+	bvm_chunk_t *chunk;
+
+	/* loop through cell range backwards - is slightly faster */
+	for (;count--;) {
+
+		bvm_obj_t *obj = cells[count].ref_value;
+
+		if (obj != NULL) {
+
+			/* get the chunk associated with the reference the cell points to */
+			chunk = BVM_CHUNK_GetPointerChunk(obj);
+
+#if BVM_GC_COMPACTION_ENABLE
+			/* the VM may hold a root in a C variable as well - it cannot be moved */
+			if (gc_pinning) gc_compact_pin(chunk);
+#endif
+
+#if (BVM_GC_GENERATIONAL_ENABLE || BVM_GC_INCREMENTAL_ENABLE)
+			/* the VM itself may store references into these roots without a write barrier, so ones that are
+			 * already black are scanned again.  There are not many of them. */
+			if (BVM_CHUNK_GetColour(chunk) != BVM_GC_COLOUR_GREY) {
+#else
+			if (BVM_CHUNK_GetColour(chunk) == BVM_GC_COLOUR_WHITE) {
+#endif
+				BVM_CHUNK_SetColour(chunk, BVM_GC_COLOUR_GREY);
+				gc_mark_chunk(chunk);
+			}
+		}
+	}
+}
 
 /**
  * Mark the roots that have been pushed onto the transient roots stack.
@@ -545,153 +1397,933 @@ static void gc_pend_clazz_unload(bvm_clazz_t *clazz) {
 	bvmd_event_park_unloaded_clazz(clazz);
 }
 
+#if BVM_DEBUGGER_ID_MAP_RESIZE_ENABLE
+
+/**
+ * Reports if the sweep following the mark will free the chunk of a given address.  These are the chunks
+ * #gc_sweep_chunk and #gc_sweep_large_region free that are not clazzes.  Clazzes are removed from the debugger id
+ * map as they are unloaded.
+ *
+ * @param addr the address of a chunk's user data.
+ *
+ * @return #BVM_TRUE if the chunk is to be freed, #BVM_FALSE otherwise.
+ */
+static bvm_bool_t gc_is_unreachable_chunk(void *addr) {
+
+	bvm_chunk_t *chunk = BVM_CHUNK_GetPointerChunk(addr);
+
+	if ( (!BVM_CHUNK_IsInuse(chunk)) || (BVM_CHUNK_GetColour(chunk) != BVM_GC_COLOUR_WHITE) ) return BVM_FALSE;
+
+	switch (BVM_CHUNK_GetType(chunk)) {
+		case BVM_ALLOC_TYPE_OBJECT:
+		case BVM_ALLOC_TYPE_ARRAY_OF_PRIMITIVE:
+		case BVM_ALLOC_TYPE_ARRAY_OF_OBJECT:
+		case BVM_ALLOC_TYPE_STRING:
+		case BVM_ALLOC_TYPE_WEAK_REFERENCE:
+		case BVM_ALLOC_TYPE_SOFT_REFERENCE:
+		case BVM_ALLOC_TYPE_EPHEMERON:
+		case BVM_ALLOC_TYPE_DATA:
+		case BVM_ALLOC_TYPE_BACKTRACE:
+			return BVM_TRUE;
+	}
+
+	return BVM_FALSE;
+}
+
+#endif
+
 #endif
 
 /**
- * Sweep the heap.  After the marking, any chunks in the heap that are not in use and are
- * coloured #BVM_GC_COLOUR_WHITE and are freed, everything else is marked #BVM_GC_COLOUR_WHITE.
+ * Sweep a single chunk.  If the chunk is in use but is coloured #BVM_GC_COLOUR_WHITE (unreachable) it is freed, otherwise
+ * it is coloured #BVM_GC_COLOUR_WHITE.  For the generational collector the survivors are left #BVM_GC_COLOUR_BLACK - they
+ * are now old.
+ *
+ * @param chunk - the chunk to sweep
+ * @param dbg - #BVM_TRUE if a debugger session is open.
+ * @return the chunk the sweep continues after - this may be different to the given chunk if it was freed and coalesced
+ * with its neighbours.
  */
-static void gc_sweep() {
+static bvm_chunk_t *gc_sweep_chunk(bvm_chunk_t *chunk, bvm_bool_t dbg) {
 
-	/* start at the heap start! */
-	bvm_chunk_t *chunk = (bvm_chunk_t *) bvm_gl_heap_start;
+#if !BVM_DEBUGGER_ENABLE
+	UNUSED(dbg);
+#endif
 
-#if BVM_DEBUGGER_ENABLE
-	bvm_bool_t dbg = bvmd_is_session_open();
+	/* if the chunk is marked as being used but is white (unreachable), free it. */
+	if ( (BVM_CHUNK_IsInuse(chunk)) && (BVM_CHUNK_GetColour(chunk) == BVM_GC_COLOUR_WHITE)) {
+
+		int type = BVM_CHUNK_GetType(chunk);
+		bvm_uint32_t size = BVM_CHUNK_GetSize(chunk);
+
+		switch (type) {
+			case BVM_ALLOC_TYPE_OBJECT:
+			case BVM_ALLOC_TYPE_ARRAY_OF_PRIMITIVE:
+			case BVM_ALLOC_TYPE_ARRAY_OF_OBJECT:
+			case BVM_ALLOC_TYPE_STRING:
+			case BVM_ALLOC_TYPE_WEAK_REFERENCE:
+			case BVM_ALLOC_TYPE_SOFT_REFERENCE:
+			case BVM_ALLOC_TYPE_EPHEMERON:
+			case BVM_ALLOC_TYPE_DATA:
+			case BVM_ALLOC_TYPE_BACKTRACE:
+
+#if BVM_DEBUGGER_ENABLE && !BVM_DEBUGGER_ID_MAP_RESIZE_ENABLE
+				/* if we have a debugger session going, remove it from id cache (if it
+				 * is there).  Yes, a bit brute force, but until a better way is implemented, this
+				 * will have to do. */
+				if (dbg) bvmd_id_remove_addr(BVM_CHUNK_GetUserData(chunk));
 #endif
 
-	/* scan until heap end */
-	while ( chunk < (bvm_chunk_t *) bvm_gl_heap_end ) {
+				GC_STATS_RECLAIMED(type, size);
+				chunk = bvm_heap_free_chunk(chunk);
+				break;
+			case BVM_ALLOC_TYPE_ARRAY_CLAZZ:
+			case BVM_ALLOC_TYPE_PRIMITIVE_CLAZZ: {
 
-		/* if the chunk is marked as being used but is white (unreachable), free it. */
-		if ( (BVM_CHUNK_IsInuse(chunk)) && (BVM_CHUNK_GetColour(chunk) == BVM_GC_COLOUR_WHITE)) {
+				/* where we unload classes */
+				bvm_clazz_t *clazz = (bvm_clazz_t *) BVM_CHUNK_GetUserData(chunk);
 
-			int type = BVM_CHUNK_GetType(chunk);
+				bvm_clazz_pool_remove(clazz);
 
-			switch (type) {
-				case BVM_ALLOC_TYPE_OBJECT:
-				case BVM_ALLOC_TYPE_ARRAY_OF_PRIMITIVE:
-				case BVM_ALLOC_TYPE_ARRAY_OF_OBJECT:
-				case BVM_ALLOC_TYPE_STRING:
-				case BVM_ALLOC_TYPE_WEAK_REFERENCE:
-				case BVM_ALLOC_TYPE_DATA:
+#if BVM_EXEC_TYPE_CACHE_ENABLE
+				/* type checks may have cached this clazz */
+				bvm_exec_type_cache_flush();
+#endif
 
-#if BVM_DEBUGGER_ENABLE
-					/* if we have a debugger session going, remove it from id cache (if it
-					 * is there).  Yes, a bit brute force, but until a better way is implemented, this
-					 * will have to do. */
-					if (dbg) bvmd_id_remove_addr(BVM_CHUNK_GetUserData(chunk));
+#if BVM_CLAZZ_FORNAME_CACHE_ENABLE
+				bvm_clazz_forname_cache_flush();
 #endif
 
-					chunk = bvm_heap_free_chunk(chunk);
+				// the class name for the array types is allocated from the heap
+				// as a _copy_ of the name.
+				bvm_heap_free(clazz->name);
+
+#if BVM_DEBUGGER_ENABLE
+				if (dbg) {
+					gc_pend_clazz_unload(clazz);
 					break;
-				case BVM_ALLOC_TYPE_ARRAY_CLAZZ:
-				case BVM_ALLOC_TYPE_PRIMITIVE_CLAZZ: {
+				}
+#endif
+				GC_STATS_RECLAIMED(type, size);
+				chunk = bvm_heap_free_chunk(chunk);
+				break;
+			}
+			case BVM_ALLOC_TYPE_INSTANCE_CLAZZ: {
+				int i;
+				bvm_instance_clazz_t *clazz = (bvm_instance_clazz_t *) BVM_CHUNK_GetUserData(chunk);
+#if BVM_HEAP_METADATA_ARENA_ENABLE
+				/* metadata in the arena of a class loader is not freed bit by bit - it goes with the arena */
+				bvm_bool_t own = (clazz->metadata_arena == NULL);
+#else
+				bvm_bool_t own = BVM_TRUE;
+#endif
 
-					/* where we unload classes */
-					bvm_clazz_t *clazz = (bvm_clazz_t *) BVM_CHUNK_GetUserData(chunk);
+				if (clazz->state > BVM_CLAZZ_STATE_ERROR)
+					bvm_clazz_pool_remove( (bvm_clazz_t *) clazz);
 
-					bvm_clazz_pool_remove(clazz);
-					// the class name for the array types is allocated from the heap
-					// as a _copy_ of the name.
-					bvm_heap_free(clazz->name);
+#if BVM_EXEC_INLINE_CACHE_ENABLE
+				/* call sites may have cached this clazz or its methods, or be in its bytecode */
+				bvm_exec_inline_cache_flush();
+#endif
 
-#if BVM_DEBUGGER_ENABLE
-					if (dbg) {
-						gc_pend_clazz_unload(clazz);
-						break;
-					}
+#if BVM_EXEC_TYPE_CACHE_ENABLE
+				/* type checks may have cached this clazz, or be in its bytecode */
+				bvm_exec_type_cache_flush();
 #endif
-					chunk = bvm_heap_free_chunk(chunk);
-					break;
-				}
-				case BVM_ALLOC_TYPE_INSTANCE_CLAZZ: {
-					int i;
-					bvm_instance_clazz_t *clazz = (bvm_instance_clazz_t *) BVM_CHUNK_GetUserData(chunk);
 
-					if (clazz->state > BVM_CLAZZ_STATE_ERROR)
-						bvm_clazz_pool_remove( (bvm_clazz_t *) clazz);
+#if BVM_CLAZZ_FORNAME_CACHE_ENABLE
+				bvm_clazz_forname_cache_flush();
+#endif
 
-					if (clazz->constant_pool != NULL)
-						bvm_heap_free(clazz->constant_pool);
+				if (own && (clazz->constant_pool != NULL))
+					bvm_heap_free(clazz->constant_pool);
 
-					if (clazz->fields != NULL)
-						bvm_heap_free(clazz->fields);
+				if (own && (clazz->fields != NULL))
+					bvm_heap_free(clazz->fields);
 
-					if (clazz->interfaces != NULL)
-						bvm_heap_free(clazz->interfaces);
+				if (own && (clazz->interfaces != NULL))
+					bvm_heap_free(clazz->interfaces);
 
-					if (clazz->static_longs != NULL)
-						bvm_heap_free(clazz->static_longs);
+				if (own && (clazz->static_longs != NULL))
+					bvm_heap_free(clazz->static_longs);
 
-					for (i = clazz->methods_count; i--;) {
+				if (own && (clazz->ref_field_offsets != NULL))
+					bvm_heap_free(clazz->ref_field_offsets);
 
-						bvm_method_t *method = &clazz->methods[i];
+#if BVM_CLAZZ_MEMBER_INDEX_ENABLE
+				if (own && (clazz->method_index != NULL))
+					bvm_heap_free(clazz->method_index);
 
-						if (!BVM_METHOD_IsNative(method) && (method->code.bytecode != NULL) )
-							bvm_heap_free(method->code.bytecode);
+				if (own && (clazz->field_index != NULL))
+					bvm_heap_free(clazz->field_index);
+#endif
 
-						if (method->exceptions != NULL)
-							bvm_heap_free(method->exceptions);
+#if BVM_CLAZZ_DISPATCH_TABLES_ENABLE
+				if (own && (clazz->vtable != NULL))
+					bvm_heap_free(clazz->vtable);
 
-#if (BVM_LINE_NUMBERS_ENABLE || BVM_DEBUGGER_ENABLE)
+				if (own && (clazz->itable != NULL)) {
+					/* all entries' method lists are in the first entry's allocation */
+					if (clazz->itable[0].methods != NULL)
+						bvm_heap_free(clazz->itable[0].methods);
+					bvm_heap_free(clazz->itable);
+				}
+#endif
 
-						if (method->line_numbers != NULL)
-							bvm_heap_free(method->line_numbers);
+#if BVM_CLAZZ_TYPE_DISPLAYS_ENABLE
+				if (own && (clazz->super_display != NULL))
+					bvm_heap_free(clazz->super_display);
 
+				if (own && (clazz->interface_set != NULL))
+					bvm_heap_free(clazz->interface_set);
+
+				bvm_clazz_interface_id_release(clazz);
 #endif
 
-#if BVM_DEBUGGER_ENABLE
-						if (method->local_variables != NULL)
-							bvm_heap_free(method->local_variables);
+				for (i = clazz->methods_count; i--;) {
+
+					bvm_method_t *method = &clazz->methods[i];
+
+					if (own && !BVM_METHOD_IsNative(method) && (method->code.bytecode != NULL) ) {
+#if BVM_CLAZZ_LAZY_CODE_TABLES_ENABLE
+						bvm_heap_free(BVM_METHOD_CodeBuffer(method));
+#else
+						bvm_heap_free(method->code.bytecode);
 #endif
 					}
 
-					if (clazz->methods != NULL)
-						bvm_heap_free(clazz->methods);
+					if (own && (method->exceptions != NULL))
+						bvm_heap_free(method->exceptions);
+
+#if BVM_EXEC_HANDLER_INDEX_ENABLE
+					if (own && (method->exception_index != NULL))
+						bvm_heap_free(method->exception_index);
+#endif
+
+#if (BVM_LINE_NUMBERS_ENABLE || BVM_DEBUGGER_ENABLE)
+
+					if (own && (method->line_numbers != NULL))
+						bvm_heap_free(method->line_numbers);
+
+#endif
 
 #if BVM_DEBUGGER_ENABLE
+					if (own && (method->local_variables != NULL))
+						bvm_heap_free(method->local_variables);
+#endif
 
-#if BVM_DEBUGGER_JSR045_ENABLE
-					if (clazz->source_debug_extension != NULL) {
-						bvm_heap_free(clazz->source_debug_extension);
-					}
+#if BVM_GC_STACK_MAPS_ENABLE
+					bvm_stackmap_free(method);
 #endif
-					if (dbg) {
-						gc_pend_clazz_unload( (bvm_clazz_t *) clazz);
-						break;
-					}
+
+#if BVM_EXEC_SWITCH_TABLES_ENABLE
+					bvm_exec_switch_tables_free(method);
 #endif
-					chunk = bvm_heap_free_chunk(chunk);
 
-					break;
+#if BVM_EXEC_STRING_CONCAT_ENABLE
+					bvm_exec_concats_free(method);
+#endif
+
+#if BVM_EXEC_REGISTER_IR_ENABLE
+					bvm_ir_free(method);
+#endif
+				}
+
+				if (own && (clazz->methods != NULL))
+					bvm_heap_free(clazz->methods);
+
+#if BVM_HEAP_METADATA_ARENA_ENABLE
+				if (!own) bvm_heap_metadata_arena_release(clazz->metadata_arena);
+#endif
+
+#if BVM_DEBUGGER_ENABLE
+
+#if BVM_DEBUGGER_JSR045_ENABLE
+				if (own && (clazz->source_debug_extension != NULL)) {
+					bvm_heap_free(clazz->source_debug_extension);
 				}
-				case BVM_ALLOC_TYPE_STATIC:
+#endif
+				if (dbg) {
+					gc_pend_clazz_unload( (bvm_clazz_t *) clazz);
 					break;
-				default :
-					BVM_VM_EXIT(BVM_FATAL_ERR_INVALID_MEMORY_CHUNK, NULL);
+				}
+#endif
+				GC_STATS_RECLAIMED(type, size);
+				chunk = bvm_heap_free_chunk(chunk);
+
+				break;
 			}
-		} else {
-			BVM_CHUNK_SetColour(chunk, BVM_GC_COLOUR_WHITE);
+			case BVM_ALLOC_TYPE_STATIC:
+				break;
+			default :
+				BVM_VM_EXIT(BVM_FATAL_ERR_INVALID_MEMORY_CHUNK, NULL);
 		}
-
-		/* go to the next chunk */
-		chunk = BVM_CHUNK_GetNextChunk(chunk);
 	}
+#if !BVM_GC_GENERATIONAL_ENABLE
+	else {
+		BVM_CHUNK_SetColour(chunk, BVM_GC_COLOUR_WHITE);
+	}
+#endif
+
+	return chunk;
 }
 
+#if BVM_HEAP_LARGE_OBJECT_ENABLE
+
 /**
- * Traverse a stack thread from top to bottom marking the range for each frame from the first
- * local var to the current top of the operand stack for the frame.  Each cell in a frame is
- * examined to determine whether it is an object pointer or not.
+ * Sweep a large object region.  If its array is unreachable the whole region is given back to the platform,
+ * otherwise the array is coloured as for #gc_sweep_chunk.
  *
- * When examining a cell value, all are first *assumed* to be object pointers.  If the pointer address is outside
- * the heap range then it is not a pointer at all - it is something else.  Having determined that the cell pointer
- * address is in the heap (and assuming it is an object), its #bvm_clazz_t pointer is also checked to make sure that is
- * in the heap.  If it is, and the clazz header contains the java magic number at the right place, we are almost
- * certain we have an object.
+ * @param region - the large object region to sweep.
+ * @param dbg - #BVM_TRUE if a debugger session is open.
+ */
+static void gc_sweep_large_region(bvm_heap_region_t *region, bvm_bool_t dbg) {
+
+	bvm_chunk_t *chunk = (bvm_chunk_t *) region->start;
+
+#if !BVM_DEBUGGER_ENABLE
+	UNUSED(dbg);
+#endif
+
+	if (BVM_CHUNK_GetColour(chunk) == BVM_GC_COLOUR_WHITE) {
+
+#if BVM_DEBUGGER_ENABLE && !BVM_DEBUGGER_ID_MAP_RESIZE_ENABLE
+		if (dbg) bvmd_id_remove_addr(BVM_CHUNK_GetUserData(chunk));
+#endif
+
+		GC_STATS_RECLAIMED(BVM_ALLOC_TYPE_ARRAY_OF_PRIMITIVE, BVM_CHUNK_GetSize(chunk));
+		bvm_heap_release_large_region(region);
+	}
+#if !BVM_GC_GENERATIONAL_ENABLE
+	else {
+		BVM_CHUNK_SetColour(chunk, BVM_GC_COLOUR_WHITE);
+	}
+#endif
+}
+
+#endif
+
+#if !BVM_GC_LAZY_SWEEP_ENABLE
+
+/**
+ * Sweep the heap.  After the marking, any chunks in the heap that are not in use and are
+ * coloured #BVM_GC_COLOUR_WHITE and are freed, everything else is marked #BVM_GC_COLOUR_WHITE.  For the generational
+ * collector the survivors are left #BVM_GC_COLOUR_BLACK - they are now old.
+ */
+static void gc_sweep() {
+
+	bvm_heap_region_t *region, *next;
+	bvm_chunk_t *chunk;
+	bvm_bool_t dbg = BVM_FALSE;
+
+#if BVM_DEBUGGER_ENABLE
+	dbg = bvmd_is_session_open();
+#endif
+
+	/* each region is swept from its start up to (but not including) its fence chunk */
+	for (region = bvm_gl_heap_regions; region != NULL; region = next) {
+
+		/* the region may be given back as it is swept */
+		next = region->next;
+
+#if BVM_HEAP_LARGE_OBJECT_ENABLE
+		if (region->is_large) {
+			gc_sweep_large_region(region, dbg);
+			continue;
+		}
+#endif
+
+		/* scan from region start until region end */
+		for (chunk = (bvm_chunk_t *) region->start; chunk < (bvm_chunk_t *) region->end; chunk = BVM_CHUNK_GetNextChunk(chunk))
+			chunk = gc_sweep_chunk(chunk, dbg);
+	}
+}
+
+#endif
+
+#if BVM_GC_LAZY_SWEEP_ENABLE
+
+/**
+ * Sweep the next step of the heap after a GC - from the sweep position (see #bvm_gl_heap_sweep_chunk) for at least
+ * #BVM_GC_LAZY_SWEEP_STEP bytes or to the end of the region being swept.  Called by the allocator when it cannot
+ * find a free chunk.  When the last region has been swept the heap regions are adjusted as they would be after an
+ * eager sweep.
  *
- * Next, however, we check the object's chunk it is in use and that the memory allocation type is indeed
+ * @return #BVM_TRUE if a step was swept, or #BVM_FALSE if there was nothing left to sweep.
+ */
+bvm_bool_t bvm_gc_sweep_step() {
+
+	bvm_heap_region_t *region = bvm_gl_heap_sweep_region;
+	bvm_chunk_t *chunk = bvm_gl_heap_sweep_chunk;
+	bvm_uint8_t *limit;
+	bvm_bool_t dbg = BVM_FALSE;
+
+	if (region == NULL) return BVM_FALSE;
+
+#if BVM_DEBUGGER_ENABLE
+	dbg = bvmd_is_session_open();
+#endif
+
+#if BVM_HEAP_TLAB_ENABLE
+	/* the buffer remainder may be right at the sweep position - give it back while it may still be coalesced */
+	bvm_heap_tlab_retire();
+#endif
+
+	/* while sweeping, free chunks may be coalesced anywhere */
+	bvm_gl_heap_sweep_chunk = NULL;
+
+#if BVM_HEAP_LARGE_OBJECT_ENABLE
+	/* a large object region is swept in one step - and may be given back */
+	if (region->is_large) {
+		bvm_heap_region_t *next = region->next;
+		gc_sweep_large_region(region, dbg);
+		region = next;
+		chunk = (region != NULL) ? (bvm_chunk_t *) region->start : NULL;
+	} else
+#endif
+	{
+		limit = BVM_CHUNK_AsBytePtr(chunk) + BVM_GC_LAZY_SWEEP_STEP;
+
+		while ( (chunk < (bvm_chunk_t *) region->end) && (BVM_CHUNK_AsBytePtr(chunk) < limit) ) {
+			chunk = gc_sweep_chunk(chunk, dbg);
+			chunk = BVM_CHUNK_GetNextChunk(chunk);
+		}
+
+		/* onto the next region? */
+		if (chunk >= (bvm_chunk_t *) region->end) {
+			region = region->next;
+			chunk = (region != NULL) ? (bvm_chunk_t *) region->start : NULL;
+		}
+	}
+
+	bvm_gl_heap_sweep_region = region;
+	bvm_gl_heap_sweep_chunk = chunk;
+
+	/* all swept - give back idle regions, or grow the heap if too little was recovered */
+	if (region == NULL) {
+		bvm_heap_adjust_regions();
+#if BVM_GC_COMPACTION_ENABLE
+		gc_check_fragmentation();
+#endif
+#if BVM_GC_STATS_ENABLE
+		gc_stats_log();
+#endif
+	}
+
+	return BVM_TRUE;
+}
+
+#endif
+
+#if BVM_GC_CONCURRENT_SWEEP_ENABLE
+
+/**
+ * The concurrent sweep in progress.  All but \c lock, \c thread and \c regions are only touched while holding
+ * \c lock.
+ */
+typedef struct _gcsweeperstruct {
+
+	/** The lock the sweeper thread and the VM thread share */
+	void *lock;
+
+	/** The sweeper thread */
+	void *thread;
+
+	/** The regions to sweep, in the order of the region list - large object regions are not among them */
+	bvm_heap_region_t **regions;
+
+	/** The number of regions to sweep */
+	bvm_uint32_t region_count;
+
+	/** Free chunks swept but not yet handed back to the allocator, linked through their \c next_free_chunk */
+	bvm_chunk_t *chunks;
+
+	/** The bytes of the free chunks not yet handed back, including those too small for the free list */
+	bvm_uint32_t free;
+
+	/** The index in \c regions of the region of \c position */
+	bvm_uint32_t region;
+
+	/** The first chunk not yet handed back */
+	bvm_chunk_t *position;
+
+	/** Unreachable clazzes passed over by the sweeper, linked through their \c next - unloaded by the VM thread once
+	 * the sweep is done */
+	bvm_clazz_t *clazzes;
+
+	/** Set when the whole heap has been swept */
+	bvm_bool_t done;
+
+#if BVM_GC_STATS_ENABLE
+	/** The bytes freed of each alloc type - added to the GC stats once the sweep is done */
+	bvm_uint32_t reclaimed_by_type[BVM_ALLOC_MAX_TYPE + 1];
+#endif
+
+} gc_sweeper_t;
+
+/** The concurrent sweep in progress - only valid while #bvm_gl_heap_sweep_region is not \c NULL */
+static BVM_VM_LOCAL gc_sweeper_t gc_sweeper;
+
+/**
+ * Hand back the free chunks the sweeper has swept since it last did so.
+ *
+ * @param chunks - the free chunks, linked through their \c next_free_chunk.
+ * @param tail - the last of the free chunks.
+ * @param free - the bytes of the free chunks.
+ * @param region - the index of the region of \c position.
+ * @param position - the first chunk the sweeper has not swept, or \c NULL if the sweep is done.
+ */
+static void gc_sweeper_hand_back(bvm_chunk_t *chunks, bvm_chunk_t *tail, bvm_uint32_t free, bvm_uint32_t region,
+								 bvm_chunk_t *position) {
+
+	bvm_pd_system_lock(gc_sweeper.lock);
+
+	if (chunks != NULL) {
+		tail->next_free_chunk = gc_sweeper.chunks;
+		gc_sweeper.chunks = chunks;
+	}
+
+	gc_sweeper.free += free;
+
+	if (position != NULL) {
+		gc_sweeper.region = region;
+		gc_sweeper.position = position;
+	} else {
+		gc_sweeper.done = BVM_TRUE;
+	}
+
+	bvm_pd_system_unlock(gc_sweeper.lock);
+}
+
+/**
+ * Colour a live chunk passed over by the sweeper white, and set its P bit if the sweeper has just made a free chunk of
+ * what is before it.  The interpreter may be changing the chunk's alloc type at the same time, so the header is
+ * changed with a compare-and-swap.
+ *
+ * @param chunk - the chunk.
+ * @param prev_free - #BVM_TRUE if the chunk before is free.
+ */
+static void gc_sweeper_keep_chunk(bvm_chunk_t *chunk, bvm_bool_t prev_free) {
+
+	bvm_chunk_header_t header, keep;
+
+	do {
+		header = chunk->header;
+
+		keep = (header & ~CHUNK_COLOUR_MASK) | ((bvm_chunk_header_t) BVM_GC_COLOUR_WHITE << BVM_CHUNK_COLOUR_SHIFT);
+		if (prev_free) keep |= BVM_CHUNK_PREV_FREE_MASK;
+
+		if (keep == header) return;
+
+	} while (!BVM_PD_ATOMIC_CAS(&chunk->header, header, keep));
+}
+
+/**
+ * The sweeper thread.  Walks each region, joining runs of free and unreachable chunks into single free chunks.  These
+ * are handed back to the allocator every #BVM_GC_CONCURRENT_SWEEP_STEP bytes - at the first live chunk after that
+ * many bytes, so a free chunk handed back always has a live chunk (or the region fence) after it.  The sweeper does not
+ * touch the free list, the clazz pool or anything else the VM thread uses - an unreachable clazz is left in the heap
+ * for the VM thread to unload once the sweep is done.
+ *
+ * @param data - not used.
+ */
+static void gc_sweeper_run(void *data) {
+
+	bvm_chunk_t *chunks = NULL, *tail = NULL;
+	bvm_uint32_t free = 0, swept = 0;
+	bvm_clazz_t *clazzes = NULL;
+	bvm_uint32_t r;
+
+	UNUSED(data);
+
+	for (r = 0; r < gc_sweeper.region_count; r++) {
+
+		bvm_heap_region_t *region = gc_sweeper.regions[r];
+		bvm_chunk_t *chunk, *next;
+		bvm_chunk_t *run = NULL;
+
+		for (chunk = (bvm_chunk_t *) region->start; chunk < (bvm_chunk_t *) region->end; chunk = next) {
+
+			bvm_uint32_t size = BVM_CHUNK_GetSize(chunk);
+			int type = BVM_CHUNK_GetType(chunk);
+
+			next = (bvm_chunk_t *) (BVM_CHUNK_AsBytePtr(chunk) + size);
+			swept += size;
+
+			if (!BVM_CHUNK_IsInuse(chunk)) {
+				if (run == NULL) run = chunk;
+				continue;
+			}
+
+			if (BVM_CHUNK_GetColour(chunk) == BVM_GC_COLOUR_WHITE) {
+
+				switch (type) {
+					case BVM_ALLOC_TYPE_OBJECT:
+					case BVM_ALLOC_TYPE_ARRAY_OF_PRIMITIVE:
+					case BVM_ALLOC_TYPE_ARRAY_OF_OBJECT:
+					case BVM_ALLOC_TYPE_STRING:
+					case BVM_ALLOC_TYPE_WEAK_REFERENCE:
+					case BVM_ALLOC_TYPE_SOFT_REFERENCE:
+					case BVM_ALLOC_TYPE_EPHEMERON:
+					case BVM_ALLOC_TYPE_DATA:
+					case BVM_ALLOC_TYPE_BACKTRACE:
+#if BVM_GC_STATS_ENABLE
+						gc_sweeper.reclaimed_by_type[type] += size;
+#endif
+#if BVM_DEBUG_HEAP_ZERO_ON_FREE
+						memset(BVM_CHUNK_GetUserData(chunk), 0, size - BVM_CHUNK_OVERHEAD);
+#endif
+						if (run == NULL) run = chunk;
+						continue;
+					case BVM_ALLOC_TYPE_ARRAY_CLAZZ:
+					case BVM_ALLOC_TYPE_PRIMITIVE_CLAZZ:
+					case BVM_ALLOC_TYPE_INSTANCE_CLAZZ: {
+						/* it is out of the clazz pool, so its link is free for the unload list */
+						bvm_clazz_t *clazz = (bvm_clazz_t *) BVM_CHUNK_GetUserData(chunk);
+						clazz->next = clazzes;
+						clazzes = clazz;
+						break;
+					}
+				}
+			}
+
+			/* a chunk that stays - what is before it becomes one free chunk */
+			if (run != NULL) {
+
+				bvm_uint32_t run_size = (bvm_uint32_t) (BVM_CHUNK_AsBytePtr(chunk) - BVM_CHUNK_AsBytePtr(run));
+
+				bvm_heap_format_free_chunk(run, run_size);
+				free += run_size;
+
+				/* a chunk too small for the free list is taken back when a neighbour is freed */
+				if (run_size >= BVM_CHUNK_MIN_SIZE) {
+					run->next_free_chunk = chunks;
+					if (chunks == NULL) tail = run;
+					chunks = run;
+				}
+			}
+
+			gc_sweeper_keep_chunk(chunk, run != NULL);
+			run = NULL;
+
+			/* enough for a step - hand back everything up to and including this live chunk */
+			if ( (swept >= BVM_GC_CONCURRENT_SWEEP_STEP) && (next < (bvm_chunk_t *) region->end) ) {
+				gc_sweeper_hand_back(chunks, tail, free, r, next);
+				chunks = NULL;
+				free = 0;
+				swept = 0;
+			}
+		}
+
+		/* the rest of the region is free - the fence follows it */
+		if (run != NULL) {
+
+			bvm_uint32_t run_size = (bvm_uint32_t) (region->end - BVM_CHUNK_AsBytePtr(run));
+
+			bvm_heap_format_free_chunk(run, run_size);
+			free += run_size;
+
+			if (run_size >= BVM_CHUNK_MIN_SIZE) {
+				run->next_free_chunk = chunks;
+				if (chunks == NULL) tail = run;
+				chunks = run;
+			}
+
+			gc_sweeper_keep_chunk((bvm_chunk_t *) region->end, BVM_TRUE);
+		}
+
+		/* a region is always handed back when it is done */
+		if (r + 1 < gc_sweeper.region_count) {
+			gc_sweeper_hand_back(chunks, tail, free, r + 1, (bvm_chunk_t *) gc_sweeper.regions[r + 1]->start);
+			chunks = NULL;
+			free = 0;
+			swept = 0;
+		}
+	}
+
+	/* the clazzes go over with the last of the free chunks */
+	bvm_pd_system_lock(gc_sweeper.lock);
+	gc_sweeper.clazzes = clazzes;
+	bvm_pd_system_unlock(gc_sweeper.lock);
+
+	gc_sweeper_hand_back(chunks, tail, free, r, NULL);
+}
+
+/**
+ * Start the concurrent sweep of the heap after marking.  Large object regions are swept straight away - they are a
+ * single chunk each, and may be given back.  The free list is emptied and a sweeper thread (see #gc_sweeper_run) is
+ * started to sweep the other regions.  If a debugger is attached, or the thread cannot be had, the heap is swept here
+ * as usual.
+ */
+static void gc_sweep_start() {
+
+	bvm_heap_region_t *region, *next;
+	bvm_uint32_t count = 0;
+	bvm_bool_t dbg = BVM_FALSE;
+	bvm_bool_t eager;
+
+#if BVM_DEBUGGER_ENABLE
+	dbg = bvmd_is_session_open();
+#endif
+
+	eager = dbg;
+
+#if (BVM_PROFILER_ALLOCATION_SITES_ENABLE && BVM_HEAP_DUMP_ENABLE)
+	/* the sites of sampled objects are forgotten as they are freed - not something the sweeper thread can do */
+	if (bvm_gl_profiler_allocation_object_count > 0) eager = BVM_TRUE;
+#endif
+
+	memset(&gc_sweeper, 0, sizeof(gc_sweeper));
+
+	for (region = bvm_gl_heap_regions; region != NULL; region = region->next) {
+#if BVM_HEAP_LARGE_OBJECT_ENABLE
+		if (region->is_large) continue;
+#endif
+		count++;
+	}
+
+	if (!eager) gc_sweeper.regions = bvm_pd_memory_alloc(count * sizeof(bvm_heap_region_t *));
+
+	if (gc_sweeper.regions != NULL) {
+
+		count = 0;
+
+		for (region = bvm_gl_heap_regions; region != NULL; region = region->next) {
+#if BVM_HEAP_LARGE_OBJECT_ENABLE
+			if (region->is_large) continue;
+#endif
+			gc_sweeper.regions[count++] = region;
+		}
+
+		gc_sweeper.region_count = count;
+		gc_sweeper.position = (bvm_chunk_t *) gc_sweeper.regions[0]->start;
+
+		gc_sweeper.lock = bvm_pd_system_lock_create();
+		if (gc_sweeper.lock != NULL) gc_sweeper.thread = bvm_pd_system_thread_start(gc_sweeper_run, NULL);
+	}
+
+	/* no thread - sweep it all now */
+	if (gc_sweeper.thread == NULL) {
+
+		if (gc_sweeper.lock != NULL) bvm_pd_system_lock_destroy(gc_sweeper.lock);
+		if (gc_sweeper.regions != NULL) bvm_pd_memory_free(gc_sweeper.regions);
+
+		gc_sweep();
+		return;
+	}
+
+	/* the sweeper works from the regions it was given - the region list is the VM thread's */
+#if BVM_HEAP_LARGE_OBJECT_ENABLE
+	for (region = bvm_gl_heap_regions; region != NULL; region = next) {
+		next = region->next;
+		if (region->is_large) gc_sweep_large_region(region, dbg);
+	}
+#else
+	UNUSED(next);
+#endif
+
+	bvm_heap_empty_free_list();
+
+	bvm_gl_heap_sweep_region = gc_sweeper.regions[0];
+	bvm_gl_heap_sweep_chunk = gc_sweeper.position;
+}
+
+/**
+ * Wait for the sweeper thread to finish and let go of what it used.
+ */
+static void gc_sweeper_stop() {
+
+	bvm_pd_system_thread_join(gc_sweeper.thread);
+	bvm_pd_system_lock_destroy(gc_sweeper.lock);
+	bvm_pd_memory_free(gc_sweeper.regions);
+
+	bvm_gl_heap_sweep_region = NULL;
+	bvm_gl_heap_sweep_chunk = NULL;
+}
+
+/**
+ * Take what the sweeper thread has swept since last asked into the free list, waiting for it if it has nothing yet.
+ * Called by the allocator when it cannot find a free chunk.  Once the whole heap is swept the sweeper thread is
+ * joined, the clazzes it passed over are unloaded, the chunks held by #bvm_heap_free are freed, and the heap regions
+ * are adjusted as they would be after an eager sweep.
+ *
+ * @return #BVM_TRUE if more of the heap was swept, or #BVM_FALSE if there was nothing left to sweep.
+ */
+bvm_bool_t bvm_gc_sweep_step() {
+
+	bvm_chunk_t *chunks;
+	bvm_chunk_t *position;
+	bvm_uint32_t free, r;
+	bvm_clazz_t *clazzes;
+	bvm_bool_t done;
+	bvm_bool_t dbg = BVM_FALSE;
+
+	if (bvm_gl_heap_sweep_region == NULL) return BVM_FALSE;
+
+	for (;;) {
+
+		bvm_pd_system_lock(gc_sweeper.lock);
+
+		chunks = gc_sweeper.chunks;
+		free = gc_sweeper.free;
+		r = gc_sweeper.region;
+		position = gc_sweeper.position;
+		clazzes = gc_sweeper.clazzes;
+		done = gc_sweeper.done;
+
+		gc_sweeper.chunks = NULL;
+		gc_sweeper.free = 0;
+
+		bvm_pd_system_unlock(gc_sweeper.lock);
+
+		if (done || (position != bvm_gl_heap_sweep_chunk)) break;
+
+		/* nothing new yet */
+		bvm_pd_system_thread_yield();
+	}
+
+	bvm_heap_add_swept_chunks(chunks, free);
+
+	if (!done) {
+		bvm_gl_heap_sweep_region = gc_sweeper.regions[r];
+		bvm_gl_heap_sweep_chunk = position;
+		return BVM_TRUE;
+	}
+
+	gc_sweeper_stop();
+
+#if BVM_DEBUGGER_ENABLE
+	dbg = bvmd_is_session_open();
+#endif
+
+	/* the whole heap is in the free list again - the clazzes may be unloaded, and freed as usual */
+	while (clazzes != NULL) {
+		bvm_clazz_t *next = clazzes->next;
+		gc_sweep_chunk(BVM_CHUNK_GetPointerChunk(clazzes), dbg);
+		clazzes = next;
+	}
+
+	bvm_heap_free_held_chunks();
+
+#if BVM_GC_STATS_ENABLE
+	for (r = BVM_ALLOC_MAX_TYPE + 1; r--;) {
+		gc_stats.last_reclaimed_by_type[r] += gc_sweeper.reclaimed_by_type[r];
+		gc_stats.last_reclaimed += gc_sweeper.reclaimed_by_type[r];
+	}
+#endif
+
+	bvm_heap_adjust_regions();
+
+#if BVM_GC_STATS_ENABLE
+	gc_stats_log();
+#endif
+
+	return BVM_TRUE;
+}
+
+/**
+ * Wait for the sweeper thread to be done with the heap, without handing anything back.  Called before the heap is
+ * given back to the platform at VM exit.
+ */
+void bvm_gc_sweep_stop() {
+	if (bvm_gl_heap_sweep_region != NULL) gc_sweeper_stop();
+}
+
+#endif
+
+#if (BVM_GC_LAZY_SWEEP_ENABLE || BVM_GC_CONCURRENT_SWEEP_ENABLE)
+
+/**
+ * Remove each unreachable clazz from the clazz pool straight after marking.  The clazz itself is only freed when it
+ * is swept, but until then it must not be found by a clazz lookup and put back into use.
+ */
+static void gc_unpool_unreachable_clazzes() {
+
+	bvm_uint32_t i;
+
+	/* a GC may occur before the clazz pool is alloc'd */
+	if (bvm_gl_clazz_pool == NULL) return;
+
+	for (i = bvm_gl_clazz_pool_bucketcount; i--;) {
+
+		bvm_clazz_t *clazz = bvm_gl_clazz_pool[i];
+
+		while (clazz != NULL) {
+
+			bvm_clazz_t *next = clazz->next;
+
+			if (BVM_CHUNK_GetColour(BVM_CHUNK_GetPointerChunk(clazz)) == BVM_GC_COLOUR_WHITE)
+				bvm_clazz_pool_remove(clazz);
+
+			clazz = next;
+		}
+	}
+}
+
+/**
+ * Sweep whatever is left of the heap from the last GC.
+ */
+static void gc_sweep_finish() {
+	while (bvm_gc_sweep_step());
+}
+
+#endif
+
+#if BVM_GC_STACK_MAPS_ENABLE
+
+/**
+ * Gives the reference map for the frame below a given frame on a thread stack - the frame of the method that
+ * called it.  There is only a map if the frame is waiting on a call it made with an invoke, as the interpreter
+ * leaves it.  A frame below one the VM pushed itself can be anywhere in its method, so has no map - the VM pushes
+ * frames for the callback wedge, for natives that push frames for Java methods, and for class initialisation (which
+ * may be above an invoke that has not popped its arguments yet - the stack depth then does not match the map).  No
+ * maps are used while a debugger is attached, as it may change the bytecode and the values of locals.
+ *
+ * @param callee_method the method of the frame above
+ * @param callee_locals the locals of the frame above
+ *
+ * @return the bits of the map for the calling frame, or \c NULL if it must be scanned conservatively.
+ */
+static bvm_uint8_t *gc_stack_map(bvm_method_t *callee_method, bvm_cell_t *callee_locals) {
+
+	bvm_method_t *method = callee_locals[BVM_FRAME_METHOD_OFFSET].ptr_value;
+	bvm_cell_t *locals, *sp;
+	bvm_uint8_t *pc, opcode;
+
+#if BVM_DEBUGGER_ENABLE
+	if (bvmd_is_session_open()) return NULL;
+#endif
+
+	if ( (callee_method == BVM_METHOD_CALLBACKWEDGE) || (callee_method == BVM_METHOD_NOOP) ||
+		 (callee_method == BVM_METHOD_NOOP_RET) || (method == BVM_METHOD_CALLBACKWEDGE) ||
+		 (method == NULL) || BVM_METHOD_IsNative(method) ) return NULL;
+
+	locals = callee_locals[BVM_FRAME_LOCALS_OFFSET].ptr_value;
+	sp = callee_locals[BVM_FRAME_SP_OFFSET].ptr_value;
+	pc = callee_locals[BVM_FRAME_PPC_OFFSET].ptr_value;
+
+	opcode = bvm_exec_unquickened_opcode(*pc);
+
+	if ( (opcode < OPCODE_invokevirtual) || (opcode > OPCODE_invokeinterface) || (sp < locals + method->max_locals) )
+		return NULL;
+
+	return bvm_stackmap_get(method, (bvm_uint32_t) (pc - method->code.bytecode), (bvm_uint32_t) (sp - (locals + method->max_locals)));
+}
+
+#endif
+
+/**
+ * Traverse a stack thread from top to bottom marking the range for each frame from the first
+ * local var to the current top of the operand stack for the frame.  Each cell in a frame is
+ * examined to determine whether it is an object pointer or not.
+ *
+ * When examining a cell value, all are first *assumed* to be object pointers.  If the pointer address is outside
+ * the heap range then it is not a pointer at all - it is something else.  Having determined that the cell pointer
+ * address is in the heap (and assuming it is an object), its #bvm_clazz_t pointer is also checked to make sure that is
+ * in the heap.  If it is, and the clazz header contains the java magic number at the right place, we are almost
+ * certain we have an object.
+ *
+ * Next, however, we check the object's chunk it is in use and that the memory allocation type is indeed
  * for an object.  After all that, we can be 100% sure it is a live java object.
  *
  * Note that stack frames are not zeroed before use.  This means that there may be cells in the frame locals and frame stack
@@ -710,290 +2342,1384 @@ static void gc_sweep() {
  * Scanning a thread stack finishes when the callback method for thread termination (which represents the
  * thread stack base) is reached.
  *
- * @param vmthread - the VM thread to scan and mark.
+ * With #BVM_GC_STACK_MAPS_ENABLE a frame that is waiting on a call it made with an invoke is marked using the
+ * reference map of the call site (see #gc_stack_map) - only the cells the map says hold references are marked, and
+ * none of the above checks are needed.  All other frames are scanned as above.
+ *
+ * @param vmthread - the VM thread to scan and mark.
+ */
+static void gc_mark_thread_stack(bvm_vmthread_t *vmthread) {
+
+	bvm_cell_t *frame_locals, *cell_ptr, *frame_top;
+	bvm_stacksegment_t *temp_frame_stack;
+	bvm_obj_t *obj_ptr;
+	bvm_chunk_t *chunk;
+	bvm_method_t *frame_method;
+#if BVM_GC_STACK_MAPS_ENABLE
+	/* the reference map of the frame, or NULL to scan it conservatively.  The top frame may be anywhere in its
+	 * method, so it has none. */
+	bvm_uint8_t *frame_map = NULL;
+#endif
+
+	/* get the method the frame is for */
+	frame_method = vmthread->rx_method;
+
+	/* start at the base of the uppermost frame on the VM stack */
+	frame_locals = vmthread->rx_locals;
+
+	/* The top of our first cell range is one cell past the top of the current method's stack.  This is NOT
+	 * inclusive.  */
+	frame_top = vmthread->rx_sp;
+
+	/* truncate the stack list a few spare segments past the current stack segment so that all further segments
+	 * in the stack list are severed and will be pooled or GC'd */
+	{
+		bvm_uint32_t spares = BVM_THREAD_STACK_SPARE_SEGMENTS;
+		bvm_stacksegment_t *trimmed;
+
+		temp_frame_stack = vmthread->rx_stack;
+		while ( (spares-- > 0) && (temp_frame_stack->next != NULL) )
+			temp_frame_stack = temp_frame_stack->next;
+
+		trimmed = temp_frame_stack->next;
+		temp_frame_stack->next = NULL;
+
+		while (trimmed != NULL) {
+			bvm_stacksegment_t *next = trimmed->next;
+			bvm_thread_pool_stack(trimmed);
+			trimmed = next;
+		}
+	}
+
+	/* mark each of the remaining stacks in the stack list */
+	temp_frame_stack = vmthread->stack_list;
+	while (temp_frame_stack != NULL) {
+		BVM_CHUNK_SetColour(BVM_CHUNK_GetPointerChunk(temp_frame_stack), BVM_GC_COLOUR_BLACK);
+		temp_frame_stack = temp_frame_stack->next;
+	}
+
+	/* for each locals/operand-stack section of a frame (which we delimit with frame_locals/frame_top),
+	 * attempt to mark each cell if it is a valid heap pointer */
+	while (  !( (frame_method == BVM_METHOD_CALLBACKWEDGE) &&
+		        (frame_locals[1].callback == bvm_thread_terminated_callback) )) {
+
+		if (!BVM_METHOD_IsNative(frame_method)) {
+
+			/* cell ptr is a moving ptr that we used to traverse the cell in the frame.  For a non-native
+			 * method the range is from the 'locals' to the current stack pointer in the frame. */
+			cell_ptr = frame_locals;
+
+		} else {
+
+			/* cell ptr is a moving ptr that we used to traverse the range
+			 * defined by frame_locals/frame_top.  Note the special calculation here for a
+			 * native method.  Native methods do not use the stack like a non-native method, and the
+			 * method call arguments are not copied into the frame locals areas like a
+			 * non-native method.  A native method's arguments are actually located at the stop of the stack
+			 * in the *calling* frame - so when determining where to start our cell scan, we point it to
+			 * the stack pointer in the previous frame.  The top of the cell scan is that position plus the number
+			 * of arguments the method has + 'this' if the method is not static. */
+			cell_ptr = frame_locals[BVM_FRAME_SP_OFFSET].ptr_value;
+
+			frame_top = cell_ptr + frame_method->num_args + ( BVM_METHOD_IsStatic(frame_method) ? 0 : 1);
+		}
+
+#if BVM_GC_STACK_MAPS_ENABLE
+		if (frame_map != NULL) {
+
+			bvm_uint32_t lc;
+
+			/* each cell the map has as a reference holds a reference, or NULL - nothing else */
+			for (lc = 0; cell_ptr < frame_top; lc++, cell_ptr++) {
+
+				/* a byte of bits with no references passes over eight cells at a time */
+				if ( ((lc & 7) == 0) && (frame_map[lc >> 3] == 0) ) {
+					lc += 7;
+					cell_ptr += 7;
+					continue;
+				}
+
+				if (!BVM_STACKMAP_IsRef(frame_map, lc)) continue;
+
+				obj_ptr = cell_ptr->ref_value;
+
+				if (BVM_HEAP_IsHeapAddress(obj_ptr)) {
+
+					chunk = BVM_CHUNK_GetPointerChunk(obj_ptr);
+
+#if BVM_GC_COMPACTION_ENABLE
+					/* stack cells are not updated by the compactor, so the chunk is pinned as before */
+					if (gc_pinning) gc_compact_pin(chunk);
+#endif
+					/* objects the VM allocates as static (like the String constants) are never collected */
+					if ( (BVM_CHUNK_GetType(chunk) <= BVM_ALLOC_MAX_OBJECT) &&
+						 (BVM_CHUNK_GetColour(chunk) == BVM_GC_COLOUR_WHITE) ) {
+						BVM_CHUNK_SetColour(chunk, BVM_GC_COLOUR_GREY);
+						gc_mark_chunk(chunk);
+					}
+				}
+			}
+		}
+#endif
+
+		/* for each cell in the locals/stack part of the current frame ... */
+		while (cell_ptr < frame_top) {
+
+			/* assume everything is a java object reference pointer, and then attempt to
+			 * prove it otherwise */
+			obj_ptr = (bvm_obj_t *) cell_ptr->ptr_value;
+
+			/* it will not be an object pointer if it lies outside the heap regions.  Note this expression also
+			 * excludes NULLs. */
+			if (BVM_HEAP_IsHeapAddress(obj_ptr)) {
+
+				/* get the bvm_clazz_t pointer of the candidate 'object' - if it is also within the heap then we can
+				 * be more confident the 'object' is a real java object. */
+				bvm_clazz_t *heap_ptr_clazz = obj_ptr->clazz;
+
+				if (BVM_HEAP_IsHeapAddress(heap_ptr_clazz)) {
+
+					/* more confident now .... more tests though, each bvm_clazz_t stores the magic number '0xCAFEBABE'.  If the
+					 * bvm_clazz_t pointer for the candidate java object is equal to that magic number, we are more confident
+					 * it is a real object reference we are dealing with. */
+
+					if (heap_ptr_clazz->magic_number == BVM_MAGIC_NUMBER) {
+
+						/* okay, object has a class pointer in the heap and the magic number of the class
+						 * at that pointer is correct.  We are almost sure it is a real object.  BUT, we make some final
+						 * checks to  make sure it is in use, not been marked, and the chunk type is really for
+						 * an object type. */
+
+						/* get the chunk for the object pointer  */
+						chunk = BVM_CHUNK_GetPointerChunk(obj_ptr);
+
+#if BVM_GC_COMPACTION_ENABLE
+						/* the cell may not be a reference at all, so it cannot be updated - the chunk cannot be moved */
+						if (gc_pinning && BVM_CHUNK_IsInuse(chunk)) gc_compact_pin(chunk);
+#endif
+
+						/* If it is in use, is an object type, and has not been coloured yet, colour it
+						 * grey and proceed to mark it. */
+						if ( (BVM_CHUNK_IsInuse(chunk)) &&
+							 (BVM_CHUNK_GetType(chunk) <= BVM_ALLOC_MAX_OBJECT) &&
+							 (BVM_CHUNK_GetColour(chunk) == BVM_GC_COLOUR_WHITE) &&
+							 (bvm_heap_is_chunk_valid(chunk)) ) {
+
+							BVM_CHUNK_SetColour(chunk, BVM_GC_COLOUR_GREY);
+							gc_mark_chunk(chunk);
+						}
+					}
+				}
+			}
+
+			/* continue on up the cell range defined by frame_locals/frame_top */
+			cell_ptr++;
+		}
+
+#if BVM_GC_STACK_MAPS_ENABLE
+		frame_map = gc_stack_map(frame_method, frame_locals);
+#endif
+
+		/* move down the VM stack to the previous frame.  Kind of like a pop_frame() but without any
+		 * real popping */
+		frame_method = frame_locals[BVM_FRAME_METHOD_OFFSET].ptr_value;
+		frame_top    = frame_locals[BVM_FRAME_SP_OFFSET].ptr_value;
+		frame_locals = frame_locals[BVM_FRAME_LOCALS_OFFSET].ptr_value;
+	}
+}
+
+/**
+ *  Scan the global VM threads list and mark all non-terminated threads.
+ */
+static void gc_mark_threads() {
+
+	bvm_vmthread_t *vmthread;
+	bvm_chunk_t *thread_chunk;
+
+#if BVM_DEBUG_HEAP_GC_ON_ALLOC
+	if (bvm_gl_threads == NULL) return;
+#endif
+
+	/* force the current gl registers back into the current thread registers */
+	bvm_thread_store_registers(bvm_gl_thread_current);
+
+	/* recalc the start of the threads list by finding the first un-terminated thread */
+	while ( (bvm_gl_threads != NULL) && (bvm_gl_threads->status == BVM_THREAD_STATUS_TERMINATED))
+		bvm_gl_threads = bvm_gl_threads->next;
+
+	/* init our loop var to the (possibly newly recalculated - above) start of the threads list */
+	vmthread = bvm_gl_threads;
+
+	while (vmthread != NULL) {
+
+		if (vmthread->status != BVM_THREAD_STATUS_TERMINATED) {
+
+			/* colour the vm thread black */
+			thread_chunk = BVM_CHUNK_GetPointerChunk(vmthread);
+			BVM_CHUNK_SetColour(thread_chunk, BVM_GC_COLOUR_BLACK);
+
+			/* mark the java thread object */
+			gc_mark_chunk(BVM_CHUNK_GetPointerChunk(vmthread->thread_obj));
+
+			/* only mark the thread stack if it exists.  Also, no need to scan the
+			 * stack if the thread is NEW - it will have a stack (which may have multiple segments) - but it will
+			 * not have anything on it to do. */
+			if ( (vmthread->stack_list != NULL) ) {
+				if (vmthread->status == BVM_THREAD_STATUS_NEW) {
+					/* loop through the stack segments.  It is *possible* that there may be more than one
+					 * for a NEW thread.  For example, the 'run' method may be very large and
+					 * exceed the default stack size (after the callback wedge is placed into the stack) and therefore have a
+					 * new larger one appended. */
+					bvm_stacksegment_t *stack = vmthread->stack_list;
+					while (stack != NULL) {
+						BVM_CHUNK_SetColour(BVM_CHUNK_GetPointerChunk(stack), BVM_GC_COLOUR_BLACK);
+						stack = stack->next;
+					}
+				}
+				else {
+					gc_mark_thread_stack(vmthread);
+				}
+			}
+
+			/* If the thread has a pending exception, mark the exception */
+			if (vmthread->pending_exception != NULL) {
+				bvm_chunk_t *ex_chunk;
+				ex_chunk = BVM_CHUNK_GetPointerChunk(vmthread->pending_exception);
+				BVM_CHUNK_SetColour(ex_chunk, BVM_GC_COLOUR_GREY);
+				gc_mark_chunk(ex_chunk);
+			}
+
+			if (vmthread->exception_location.throwable != NULL) {
+				bvm_chunk_t *ex_chunk;
+				ex_chunk = BVM_CHUNK_GetPointerChunk(vmthread->exception_location.throwable);
+				BVM_CHUNK_SetColour(ex_chunk, BVM_GC_COLOUR_GREY);
+				gc_mark_chunk(ex_chunk);
+			}
+
+#if BVM_NATIVE_ACCESS_CONTEXT_CACHE_ENABLE
+			if (vmthread->access_context != NULL)
+				gc_mark_chunk(BVM_CHUNK_GetPointerChunk(vmthread->access_context));
+#endif
+		}
+
+		/* if the next threads in the list are terminated, skip them.  Note that the actual real
+		 * gl thread list is amended here to exclude the terminated threads. */
+		while ( (vmthread->next != NULL) && (vmthread->next->status == BVM_THREAD_STATUS_TERMINATED) )
+			vmthread->next = vmthread->next->next;
+
+		vmthread = vmthread->next;
+	}
+
+#if BVM_THREAD_TASKS_ENABLE
+	/* the VM threads of ended tasks are out of the thread list now - they may be pooled for new tasks */
+	while (bvm_gl_thread_task_retired != NULL) {
+		vmthread = bvm_gl_thread_task_retired;
+		bvm_gl_thread_task_retired = vmthread->next_in_list;
+		vmthread->next_in_list = bvm_gl_thread_task_pool;
+		bvm_gl_thread_task_pool = vmthread;
+	}
+
+	/* pooled VM threads, and the stack segment each kept, are not reachable from any thread */
+	for (vmthread = bvm_gl_thread_task_pool; vmthread != NULL; vmthread = vmthread->next_in_list) {
+		BVM_CHUNK_SetColour(BVM_CHUNK_GetPointerChunk(vmthread), BVM_GC_COLOUR_BLACK);
+		BVM_CHUNK_SetColour(BVM_CHUNK_GetPointerChunk(vmthread->stack_list), BVM_GC_COLOUR_BLACK);
+	}
+#endif
+
+#if (BVM_THREAD_STACK_POOL_SIZE > 0)
+	/* pooled stack segments are not reachable from any thread, but are kept for reuse */
+	{
+		bvm_stacksegment_t *stack = bvm_gl_thread_stack_pool;
+		while (stack != NULL) {
+			BVM_CHUNK_SetColour(BVM_CHUNK_GetPointerChunk(stack), BVM_GC_COLOUR_BLACK);
+			stack = stack->next;
+		}
+	}
+#endif
+}
+
+#if BVM_DEBUGGER_ENABLE
+
+/**
+ * Mark objects in the JDWP debugger root map.  Objects in this map have put there as a consequence
+ * of the JDWP command ObjectReference.DisableCollection.
+ */
+void gc_mark_debug_roots() {
+
+
+	int i = BVMD_ROOTMAP_SIZE;
+	bvm_chunk_t *chunk;
+
+	while (i--) {
+
+		bvmd_root_t *root = bvmd_root_map[i];
+
+		while (root != NULL) {
+
+			chunk = BVM_CHUNK_GetPointerChunk(root->addr);
+
+			/* If it is in use, and has not been coloured yet, colour it and mark it. */
+			if ( (BVM_CHUNK_IsInuse(chunk)) &&
+				 (BVM_CHUNK_GetColour(chunk) == BVM_GC_COLOUR_WHITE) ) {
+
+				BVM_CHUNK_SetColour(chunk, BVM_GC_COLOUR_GREY);
+				gc_mark_chunk(chunk);
+			}
+
+			root = root->next;
+		}
+	}
+}
+
+#endif
+
+
+/**
+ * Finish the marking of the ephemerons found with an unmarked key.  The list is gone through again and again - each
+ * ephemeron whose key has now been marked has its value marked, and everything reachable from that - until a pass
+ * marks nothing new.  The key and value of every ephemeron whose key is still unmarked are then set to \c NULL.  Must be
+ * called once all other marking is done, and before #gc_visit_weakrefs.  The #ephemerons header will be \c NULL after
+ * this, as will the \c next of each ephemeron.
+ */
+static void gc_visit_ephemerons() {
+
+	bvm_weak_reference_obj_t *list;
+	bvm_bool_t marked = BVM_TRUE;
+
+	while (marked) {
+
+		marked = BVM_FALSE;
+
+		/* marking a value may add more ephemerons to the head of the list - they are picked up by the next pass */
+		for (list = ephemerons; list != NULL; list = list->next) {
+
+			bvm_ephemeron_obj_t *ephemeron = (bvm_ephemeron_obj_t *) list;
+			bvm_chunk_t *chunk;
+
+			/* the key may have been cleared since the ephemeron was scanned (by incremental marking) */
+			if ( (ephemeron->value == NULL) || ( (ephemeron->referent != NULL) &&
+				 (BVM_CHUNK_GetColour(BVM_CHUNK_GetPointerChunk(ephemeron->referent)) == BVM_GC_COLOUR_WHITE) ) )
+				continue;
+
+			chunk = BVM_CHUNK_GetPointerChunk(ephemeron->value);
+
+			if (BVM_CHUNK_GetColour(chunk) == BVM_GC_COLOUR_WHITE) {
+				BVM_CHUNK_SetColour(chunk, BVM_GC_COLOUR_GREY);
+				gc_mark_chunk(chunk);
+				marked = BVM_TRUE;
+			}
+		}
+
+#if BVM_GC_PARALLEL_MARK_ENABLE
+		gc_mark_drain();
+#endif
+
+		gc_rescan_heap();
+	}
+
+	while (ephemerons != NULL) {
+
+		bvm_ephemeron_obj_t *ephemeron = (bvm_ephemeron_obj_t *) ephemerons;
+
+		ephemerons = ephemerons->next;
+
+		if ( (ephemeron->referent != NULL) &&
+			 (BVM_CHUNK_GetColour(BVM_CHUNK_GetPointerChunk(ephemeron->referent)) == BVM_GC_COLOUR_WHITE) ) {
+			ephemeron->referent = NULL;
+			ephemeron->value = NULL;
+		}
+
+		ephemeron->next = NULL;
+	}
+
+	ephemerons_tail = NULL;
+}
+
+/**
+ * Scan the weak references list and set to \c NULL the referent object reference for any objects
+ * that will be GC'd in the sweep.  The #weak_refs header will be \c NULL after this, as will the \c next
+ * of each weak reference.
+ */
+static void gc_visit_weakrefs() {
+
+	while (weak_refs != NULL) {
+
+		bvm_weak_reference_obj_t *next = weak_refs->next;
+
+		if (weak_refs->referent != NULL) {
+			bvm_chunk_t *chunk = BVM_CHUNK_GetPointerChunk(weak_refs->referent);
+			if (BVM_CHUNK_GetColour(chunk) == BVM_GC_COLOUR_WHITE) {
+				weak_refs->referent = NULL;
+			}
+		}
+
+		weak_refs->next = NULL;
+		weak_refs = next;
+	}
+
+	weak_refs_tail = NULL;
+}
+
+#if BVM_SCOPED_MEMORY_ENABLE
+
+/**
+ * Mark from each object in each entered scope.  Scoped objects are always black, so are never marked from a reference to
+ * them, but the heap objects they refer to must be kept.  See scope.c.
+ */
+static void gc_mark_scopes() {
+
+	bvm_scope_t *scope;
+	bvm_chunk_t *chunk;
+
+	for (scope = bvm_gl_scopes_entered; scope != NULL; scope = scope->next) {
+		for (chunk = (bvm_chunk_t *) scope->start; chunk < (bvm_chunk_t *) scope->top; chunk = BVM_CHUNK_GetNextChunk(chunk))
+			gc_mark_chunk(chunk);
+	}
+}
+
+#endif
+
+/**
+ * Mark from each of the roots.
+ */
+static void gc_mark_roots() {
+
+	/* scan transient root stack */
+	gc_mark_transient_roots();
+
+	/* scan system root stack */
+	gc_mark_permanent_roots();
+
+	/* mark each thread */
+	gc_mark_threads();
+
+#if BVM_SCOPED_MEMORY_ENABLE
+	/* mark from the objects in scopes */
+	gc_mark_scopes();
+#endif
+
+#if BVM_DEBUGGER_ENABLE
+	/* mark the debug root, if any */
+	if (bvmd_is_session_open()) gc_mark_debug_roots();
+#endif
+}
+
+#if BVM_GC_GENERATIONAL_ENABLE
+
+/**
+ * Add an old chunk to the remembered set.  Called by #BVM_GC_WRITE_BARRIER when a reference to a new chunk is stored
+ * into it.  The chunk is coloured #BVM_GC_COLOUR_REMEMBERED so it is not added twice.  If the set is full, the
+ * next collection will be a full collection.
+ *
+ * @param ptr - a pointer to the user data of the old chunk to remember.
+ */
+void bvm_gc_remember(void *ptr) {
+
+	bvm_chunk_t *chunk = BVM_CHUNK_GetPointerChunk(ptr);
+
+	BVM_CHUNK_SetColour(chunk, BVM_GC_COLOUR_REMEMBERED);
+
+	if (gc_remembered_set_top < BVM_GC_REMEMBERED_SET_SIZE)
+		gc_remembered_set[gc_remembered_set_top++] = chunk;
+	else
+		gc_remembered_set_overflowed = BVM_TRUE;
+}
+
+/**
+ * Mark from each chunk in the remembered set.  These are old chunks that new chunks may only be reachable through.
+ */
+static void gc_mark_remembered_set() {
+
+	bvm_uint32_t i;
+
+	for (i = gc_remembered_set_top; i--;) {
+
+		bvm_chunk_t *chunk = gc_remembered_set[i];
+
+		/* may have already been scanned as a root, which colours it black */
+		if (BVM_CHUNK_IsInuse(chunk) && (BVM_CHUNK_GetColour(chunk) == BVM_GC_COLOUR_REMEMBERED)) {
+			BVM_CHUNK_SetColour(chunk, BVM_GC_COLOUR_GREY);
+			gc_mark_chunk(chunk);
+		}
+	}
+
+	gc_remembered_set_top = 0;
+}
+
+/**
+ * Remember each old transient root for the next collection.  An object that is still being constructed by the VM
+ * (and is therefore a transient root) may survive a collection and then have new objects stored into it without a
+ * write barrier.
+ */
+static void gc_remember_transient_roots() {
+
+	bvm_uint32_t i;
+
+#if BVM_DEBUG_HEAP_GC_ON_ALLOC
+	if (bvm_gl_gc_transient_roots == NULL) return;
+#endif
+
+	for (i = bvm_gl_gc_transient_roots_top; i--;) {
+
+		bvm_obj_t *obj = bvm_gl_gc_transient_roots[i].ref_value;
+
+		if ( (obj != NULL) && (BVM_CHUNK_GetColour(BVM_CHUNK_GetPointerChunk(obj)) == BVM_GC_COLOUR_BLACK) )
+			bvm_gc_remember(obj);
+	}
+}
+
+/**
+ * Make every chunk in the heap new again by colouring it #BVM_GC_COLOUR_WHITE.  Done before a full collection.  The
+ * remembered set is emptied as everything will be marked anyway.
+ */
+static void gc_reset_generations() {
+
+	bvm_heap_region_t *region;
+	bvm_chunk_t *chunk;
+
+	for (region = bvm_gl_heap_regions; region != NULL; region = region->next) {
+
+		for (chunk = (bvm_chunk_t *) region->start; chunk < (bvm_chunk_t *) region->end; chunk = BVM_CHUNK_GetNextChunk(chunk)) {
+
+			if (BVM_CHUNK_IsInuse(chunk))
+				BVM_CHUNK_SetColour(chunk, BVM_GC_COLOUR_WHITE);
+		}
+	}
+
+	gc_remembered_set_top = 0;
+	gc_remembered_set_overflowed = BVM_FALSE;
+}
+
+#endif
+
+#if BVM_GC_INCREMENTAL_ENABLE
+
+/**
+ * Colour a chunk #BVM_GC_COLOUR_GREY and push it onto the mark stack.  Called by #BVM_GC_WRITE_BARRIER during an
+ * incremental marking cycle.
+ *
+ * @param ptr - a pointer to the user data of the chunk to shade.
+ */
+void bvm_gc_shade(void *ptr) {
+
+	bvm_chunk_t *chunk = BVM_CHUNK_GetPointerChunk(ptr);
+
+	GC_PUSH_GREY(chunk);
+}
+
+/**
+ * Colour each black transient root grey again.  An object that is still being constructed by the VM (and is therefore
+ * a transient root) may have already been marked and then have objects stored into it without a write barrier.
+ */
+static void gc_regrey_transient_roots() {
+
+	bvm_uint32_t i;
+
+	for (i = bvm_gl_gc_transient_roots_top; i--;) {
+
+		bvm_obj_t *obj = bvm_gl_gc_transient_roots[i].ref_value;
+
+		if (obj != NULL) {
+			bvm_chunk_t *chunk = BVM_CHUNK_GetPointerChunk(obj);
+
+			if (BVM_CHUNK_GetColour(chunk) == BVM_GC_COLOUR_BLACK)
+				GC_PUSH_GREY(chunk);
+		}
+	}
+}
+
+/**
+ * Do a slice of incremental marking.  Called at each thread switch.  If a marking cycle is not in progress and the heap
+ * is short of free space (see #BVM_GC_INCREMENTAL_START_PERCENT) a cycle is started by greying the roots.  Otherwise up
+ * to #bvm_gl_gc_slice_budget grey chunks are scanned.  When there are no grey chunks left the cycle is finished with
+ * #bvm_gc - which re-marks the roots (most of what they reach is already black) and sweeps.
+ */
+void bvm_gc_mark_slice() {
+
+	bvm_uint32_t budget = bvm_gl_gc_slice_budget;
+
+	if (!bvm_gl_gc_is_marking) {
+
+#if BVM_DEBUG_HEAP_GC_ON_ALLOC
+		if (bvm_gl_gc_transient_roots == NULL) return;
+#endif
+
+#if BVM_GC_LAZY_SWEEP_ENABLE
+		/* the free total does not count what is yet to be swept - wait for the sweep to finish */
+		if (bvm_gl_heap_sweep_region != NULL) return;
+#endif
+
+		/* plenty of room yet */
+		if ( (bvm_gl_heap_free / BVM_GC_INCREMENTAL_START_PERCENT) >= (bvm_gl_heap_size / 100) ) return;
+
+		bvm_gl_gc_is_marking = BVM_TRUE;
+
+		gc_defer_marking = BVM_TRUE;
+		gc_mark_roots();
+		gc_defer_marking = BVM_FALSE;
+
+		return;
+	}
+
+	while ( (gc_mark_stack_top > 0) && (budget-- > 0) ) {
+
+		bvm_chunk_t *chunk = gc_mark_stack[--gc_mark_stack_top];
+
+		/* it may have been pushed more than once */
+		if (BVM_CHUNK_GetColour(chunk) == BVM_GC_COLOUR_GREY)
+			gc_scan_chunk(chunk);
+	}
+
+	if (gc_mark_stack_top == 0)
+		bvm_gc();
+	else
+		gc_regrey_transient_roots();
+}
+
+#endif
+
+#if (BVM_GC_GENERATIONAL_ENABLE || BVM_GC_INCREMENTAL_ENABLE)
+
+/**
+ * Remove a chunk from the collector's working sets before it is freed by #bvm_heap_free - the mark stack for the
+ * incremental collector, or the remembered set for the generational collector.  Only called for a chunk that is
+ * grey or remembered.  Rare enough that a linear search does not matter.
+ *
+ * @param ptr - a pointer to the user data of the chunk about to be freed.
+ */
+void bvm_gc_forget(void *ptr) {
+
+	bvm_chunk_t *chunk = BVM_CHUNK_GetPointerChunk(ptr);
+	bvm_uint32_t i;
+
+#if BVM_GC_INCREMENTAL_ENABLE
+	for (i = gc_mark_stack_top; i--;) {
+		if (gc_mark_stack[i] == chunk)
+			gc_mark_stack[i] = gc_mark_stack[--gc_mark_stack_top];
+	}
+#else
+	for (i = gc_remembered_set_top; i--;) {
+		if (gc_remembered_set[i] == chunk)
+			gc_remembered_set[i] = gc_remembered_set[--gc_remembered_set_top];
+	}
+#endif
+}
+
+#endif
+
+#if BVM_GC_STATS_ENABLE
+
+/**
+ * Give the milliseconds elapsed since the given system time.
+ *
+ * @param since - a time as given by #bvm_pd_system_time.
+ * @return the milliseconds since \c since.
+ */
+static bvm_uint32_t gc_stats_elapsed(bvm_int64_t since) {
+
+	bvm_int64_t now = bvm_pd_system_time();
+	bvm_uint32_t elapsed;
+
+	BVM_INT64_decrease(now, since);
+	BVM_INT64_int64_to_uint32(now, elapsed);
+
+	return elapsed;
+}
+
+/**
+ * Log the last GC to the console if \c -verbose:gc was given.  The log line is a set of \c name=value pairs - the
+ * times of the GC, the bytes it reclaimed of each alloc type (only types with bytes reclaimed are given), and the heap and
+ * free list afterwards.  For the lazy sweeper this is called when the heap has been swept.
+ */
+static void gc_stats_log() {
+
+#if BVM_CONSOLE_ENABLE
+	int i;
+
+	if (!bvm_gl_gc_verbose) return;
+
+	bvm_pd_console_out("[GC %d mark=%dms sweep=%dms pause=%dms reclaimed=%d",
+			(int) gc_stats.collections, (int) gc_stats.last_mark_time, (int) gc_stats.last_sweep_time,
+			(int) gc_stats.last_pause_time, (int) gc_stats.last_reclaimed);
+
+	for (i = 0; i <= BVM_ALLOC_MAX_TYPE; i++) {
+		if (gc_stats.last_reclaimed_by_type[i] > 0)
+			bvm_pd_console_out(" %s=%d", gc_stats_type_names[i], (int) gc_stats.last_reclaimed_by_type[i]);
+	}
+
+#if BVM_GC_STRING_DEDUP_ENABLE
+	if (gc_stats.last_deduplicated > 0)
+		bvm_pd_console_out(" deduplicated=%d", (int) gc_stats.last_deduplicated);
+#endif
+
+	bvm_pd_console_out(" heap=%d free=%d largest_free=%d free_chunks=%d",
+			(int) bvm_gl_heap_size, (int) bvm_gl_heap_free, (int) bvm_heap_largest_free(), (int) bvm_gl_heap_free_chunks);
+
+#if BVM_HEAP_METADATA_ARENA_ENABLE
+	bvm_pd_console_out(" metadata=%d/%d", (int) bvm_gl_heap_metadata_used, (int) bvm_gl_heap_metadata_size);
+#endif
+
+	bvm_pd_console_out("]\n");
+#endif
+}
+
+/**
+ * Give the collector statistics.  As well as the statistics of the GCs so far, the largest free chunk and length of the
+ * free list are given as they are now.
+ *
+ * @param stats - the stats struct to fill in.
+ */
+void bvm_gc_get_stats(bvm_gc_stats_t *stats) {
+
+	*stats = gc_stats;
+
+	stats->largest_free = bvm_heap_largest_free();
+	stats->free_chunks = bvm_gl_heap_free_chunks;
+}
+
+#endif
+
+/**
+ * Perform a single mark and sweep.  For the generational collector, a minor collection marks and frees only new
+ * chunks - old chunks are taken as live and the remembered set stands in for their references to new chunks.
+ *
+ * @param full - for the generational collector, \c BVM_TRUE for a full collection of the whole heap, or
+ * \c BVM_FALSE for a minor collection.  Ignored otherwise - every collection is full.
+ */
+static void gc_collect(bvm_bool_t full) {
+
+#if BVM_GC_STATS_ENABLE
+	bvm_int64_t start_time;
+#endif
+
+#if (BVM_GC_LAZY_SWEEP_ENABLE || BVM_GC_CONCURRENT_SWEEP_ENABLE)
+	/* marking needs every chunk white - finish off the sweep of the last GC */
+	gc_sweep_finish();
+#endif
+
+#if BVM_GC_STATS_ENABLE
+	gc_stats.collections++;
+	gc_stats.last_reclaimed = 0;
+	memset(gc_stats.last_reclaimed_by_type, 0, sizeof(gc_stats.last_reclaimed_by_type));
+	start_time = bvm_pd_system_time();
+#endif
+
+#if BVM_HEAP_TLAB_ENABLE
+	/* give the unused part of the thread allocation buffer back to the heap before we start */
+	bvm_heap_tlab_retire();
+#endif
+
+#if BVM_GC_GENERATIONAL_ENABLE
+	if (full) gc_reset_generations();
+#else
+	UNUSED(full);
+#endif
+
+#if BVM_METRICS_ENABLE
+	bvm_gl_metrics.allocated += bvm_gl_heap_allocated;
+#endif
+
+	/* the allocation budget starts again */
+	bvm_gl_heap_allocated = 0;
+
+	/* mark everything reachable from the roots */
+	gc_mark_roots();
+
+#if BVM_GC_INCREMENTAL_ENABLE
+	/* scan anything left on the mark stack by an unfinished incremental cycle */
+	while (gc_mark_stack_top > 0)
+		gc_scan_chunk(gc_mark_stack[--gc_mark_stack_top]);
+#endif
+
+#if BVM_GC_GENERATIONAL_ENABLE
+	/* mark new chunks reachable from old ones */
+	gc_mark_remembered_set();
+#endif
+
+#if BVM_GC_PARALLEL_MARK_ENABLE
+	/* the roots have all been pushed - now mark from them */
+	gc_mark_drain();
+#endif
+
+	/* pick up any grey chunks left behind by a mark stack overflow */
+	gc_rescan_heap();
+
+	/* mark the values of ephemerons with marked keys, and clear the rest */
+	gc_visit_ephemerons();
+
+	/* before doing the sweep, set all found weak references referent object to NULL. */
+	gc_visit_weakrefs();
+
+#if BVM_GC_STRING_DEDUP_ENABLE
+	/* marking is done - the arrays in the dedup table may be freed from here */
+	gc_dedup_reset();
+#endif
+
+	/* remember what soft references are left for bvm_gc_clear_soft_references */
+	gc_soft_live = gc_soft_marked;
+	gc_soft_live_age = gc_soft_marked_age;
+	gc_soft_marked = 0;
+	gc_soft_marked_age = 0;
+
+#if BVM_DEBUGGER_ENABLE && BVM_DEBUGGER_ID_MAP_RESIZE_ENABLE
+	/* the sweep will free every chunk still white - drop their debugger ids in one pass now.  With a debugger
+	 * session open the whole heap is swept before the VM carries on. */
+	if (bvmd_is_session_open()) bvmd_id_remove_if(gc_is_unreachable_chunk);
+#endif
+
+#if BVM_GC_STATS_ENABLE
+	gc_stats.last_mark_time = gc_stats_elapsed(start_time);
+#endif
+
+#if BVM_GC_LAZY_SWEEP_ENABLE
+	/* and finally ... leave the heap to be swept as the allocator needs memory */
+	gc_unpool_unreachable_clazzes();
+
+#if BVM_CLASSPATH_INDEX_ENABLE
+	bvm_classpath_purge_missing();
+#endif
+
+	bvm_gl_heap_sweep_region = bvm_gl_heap_regions;
+	bvm_gl_heap_sweep_chunk = (bvm_chunk_t *) bvm_gl_heap_regions->start;
+
+#if BVM_DEBUGGER_ENABLE
+	/* the debugger's id cache holds unmarked objects until they are swept - sweep it all now */
+	if (bvmd_is_session_open()) gc_sweep_finish();
+#endif
+
+#elif BVM_GC_CONCURRENT_SWEEP_ENABLE
+	/* unreachable clazzes are unloaded once the sweep is done - but must not be found before then */
+	gc_unpool_unreachable_clazzes();
+
+#if BVM_CLASSPATH_INDEX_ENABLE
+	bvm_classpath_purge_missing();
+#endif
+
+	/* and finally ... have the heap swept while the interpreter carries on */
+	gc_sweep_start();
+
+#else
+#if BVM_CLASSPATH_INDEX_ENABLE
+	bvm_classpath_purge_missing();
+#endif
+
+	/* and finally sweep the heap */
+	gc_sweep();
+#endif
+
+#if BVM_GC_STATS_ENABLE
+	gc_stats.last_pause_time = gc_stats_elapsed(start_time);
+	gc_stats.last_sweep_time = gc_stats.last_pause_time - gc_stats.last_mark_time;
+	gc_stats.total_pause_time += gc_stats.last_pause_time;
+	if (gc_stats.last_pause_time > gc_stats.max_pause_time) gc_stats.max_pause_time = gc_stats.last_pause_time;
+#if BVM_METRICS_ENABLE
+	bvm_metrics_gc_pause(gc_stats.last_pause_time);
+#endif
+#if BVM_GC_CONCURRENT_SWEEP_ENABLE
+	/* logged when the sweep is done - unless it was done in the pause */
+	if (bvm_gl_heap_sweep_region == NULL) gc_stats_log();
+#elif !BVM_GC_LAZY_SWEEP_ENABLE
+	gc_stats_log();
+#endif
+#endif
+
+#if BVM_GC_GENERATIONAL_ENABLE
+	gc_remember_transient_roots();
+#endif
+
+#if BVM_GC_INCREMENTAL_ENABLE
+	bvm_gl_gc_is_marking = BVM_FALSE;
+#endif
+}
+
+/**
+ * Perform a garbage collection cycle.  A detailed explanation is at the top of
+ * this source file.  For the generational collector this is a minor collection, followed by a full
+ * collection if the minor one did not free enough of the heap (see #BVM_GC_FULL_PERCENT).
+ */
+void bvm_gc() {
+
+#if BVM_GC_GENERATIONAL_ENABLE
+	gc_collect(gc_remembered_set_overflowed);
+
+	if ( (bvm_gl_heap_free / BVM_GC_FULL_PERCENT) < (bvm_gl_heap_size / 100) )
+		gc_collect(BVM_TRUE);
+#else
+	gc_collect(BVM_TRUE);
+#endif
+
+#if !BVM_GC_LAZY_SWEEP_ENABLE
+	/* give back idle regions, or grow the heap if too little was recovered.  For the lazy sweep this is
+	 * done when the sweep is finished - and for the concurrent sweep too, unless it was done in the pause. */
+#if BVM_GC_CONCURRENT_SWEEP_ENABLE
+	if (bvm_gl_heap_sweep_region == NULL)
+#endif
+	bvm_heap_adjust_regions();
+
+#if BVM_GC_COMPACTION_ENABLE
+	gc_check_fragmentation();
+#endif
+
+#endif
+}
+
+/**
+ * Perform a full garbage collection cycle - for the generational collector every chunk in the heap is a
+ * candidate for collection, not just new ones.  For the lazy and concurrent sweeps the whole heap is swept before
+ * returning.
+ * Otherwise, the same as #bvm_gc.
+ */
+void bvm_gc_full() {
+
+	gc_collect(BVM_TRUE);
+
+#if BVM_GC_LAZY_SWEEP_ENABLE
+	gc_sweep_finish();
+#elif BVM_GC_CONCURRENT_SWEEP_ENABLE
+	/* the regions are adjusted when the sweep is done */
+	if (bvm_gl_heap_sweep_region != NULL)
+		gc_sweep_finish();
+	else
+		bvm_heap_adjust_regions();
+#else
+	bvm_heap_adjust_regions();
+#endif
+}
+
+#if BVM_GC_BUDGET_ENABLE
+
+/**
+ * Start a GC if the allocation budget has been spent, or the heap is short of free space.  Called at each thread switch.
+ * See #BVM_GC_BUDGET_ENABLE.
+ */
+void bvm_gc_check_budget() {
+
+	bvm_uint32_t low_water;
+
+#if BVM_GC_INCREMENTAL_ENABLE
+	/* a marking cycle in progress will finish by itself */
+	if (bvm_gl_gc_is_marking) return;
+#endif
+
+#if (BVM_GC_LAZY_SWEEP_ENABLE || BVM_GC_CONCURRENT_SWEEP_ENABLE)
+	/* the free total does not count what is yet to be swept - wait for the sweep to finish */
+	if (bvm_gl_heap_sweep_region != NULL) return;
+#endif
+
+	if ( (bvm_gl_gc_alloc_budget > 0) && (bvm_gl_heap_allocated >= bvm_gl_gc_alloc_budget) ) {
+		bvm_gc();
+		return;
+	}
+
+	low_water = (bvm_gl_heap_size / 100) * bvm_gl_gc_budget_free_percent;
+
+	/* only if enough has been allocated since the last GC for another to be worth it */
+	if ( (bvm_gl_heap_free < low_water) && (bvm_gl_heap_allocated >= (low_water / 2)) )
+		bvm_gc();
+}
+
+#endif
+
+#if BVM_GC_IDLE_ENABLE
+
+/**
+ * Do a full GC while the VM is idle - if enough has been allocated since the last GC, or an incremental marking cycle
+ * is under way.  Called when no thread is runnable and none is due for at least #bvm_gl_gc_idle_min_time milliseconds.
+ * See #BVM_GC_IDLE_ENABLE.
+ *
+ * @return #BVM_TRUE if a GC was done, #BVM_FALSE if not.
+ */
+bvm_bool_t bvm_gc_idle() {
+
+#if BVM_GC_INCREMENTAL_ENABLE
+	/* a marking cycle is better finished now than in slices once the VM is busy again */
+	if (!bvm_gl_gc_is_marking)
+#endif
+	if ( (bvm_gl_heap_allocated == 0) ||
+		 (bvm_gl_heap_allocated < (bvm_gl_heap_size / 100) * BVM_GC_IDLE_MIN_PERCENT) )
+		return BVM_FALSE;
+
+	bvm_gc_full();
+
+	return BVM_TRUE;
+}
+
+#endif
+
+/**
+ * Clear some soft references.  Called by the allocator when it is about to fail.  The older half (by
+ * #bvm_gl_gc_soft_clock) of the soft references the last GC found holding a referent are treated as weak by a full GC -
+ * so each call clears the least recently used of those left.  When they all have the same age they are all cleared.
+ *
+ * @return #BVM_TRUE if a GC was done, #BVM_FALSE if the last GC found no soft references to clear.
+ */
+bvm_bool_t bvm_gc_clear_soft_references() {
+
+	if (gc_soft_live == 0) return BVM_FALSE;
+
+	gc_soft_clear_age = (gc_soft_live_age / 2) + (gc_soft_live_age & 1);
+
+	gc_soft_clearing = BVM_TRUE;
+	bvm_gc_full();
+	gc_soft_clearing = BVM_FALSE;
+
+	return BVM_TRUE;
+}
+
+#if BVM_GC_COMPACTION_ENABLE
+
+/**
+ * Find the compaction table slot for the given chunk.  The slot is either the chunk's entry or the empty slot where its
+ * entry would go.
+ *
+ * @param chunk - the chunk to look for.
+ * @return the chunk's slot in the compaction table.
+ */
+static gc_compact_entry_t *gc_compact_slot(bvm_chunk_t *chunk) {
+
+	bvm_uint32_t i = (bvm_uint32_t) ( ((size_t) chunk / BVM_CHUNK_ALIGN_SIZE) % GC_COMPACT_TABLE_SLOTS);
+
+	while ( (gc_compact_table[i].from != NULL) && (gc_compact_table[i].from != chunk) )
+		i = (i + 1) % GC_COMPACT_TABLE_SLOTS;
+
+	return &gc_compact_table[i];
+}
+
+/**
+ * Add an entry for the given chunk to the compaction table (if it does not already have one).
+ *
+ * @param chunk - the chunk.
+ * @return the chunk's entry, or \c NULL if the table is full.
+ */
+static gc_compact_entry_t *gc_compact_add(bvm_chunk_t *chunk) {
+
+	gc_compact_entry_t *entry = gc_compact_slot(chunk);
+
+	if (entry->from == NULL) {
+
+		if (gc_compact_table_count == BVM_GC_COMPACT_TABLE_SIZE) return NULL;
+
+		gc_compact_table_count++;
+		entry->from = chunk;
+		entry->to = NULL;
+	}
+
+	return entry;
+}
+
+/**
+ * Pin an array so a compaction will not move it.  Called for each chunk found by the root scan of a compaction.
+ *
+ * @param chunk - the chunk to pin.  Anything other than an array is ignored.
  */
-static void gc_mark_thread_stack(bvm_vmthread_t *vmthread) {
-
-	bvm_cell_t *frame_locals, *cell_ptr, *frame_top;
-	bvm_stacksegment_t *temp_frame_stack;
-	bvm_obj_t *obj_ptr;
-	bvm_chunk_t *chunk;
-	bvm_method_t *frame_method;
+static void gc_compact_pin(bvm_chunk_t *chunk) {
 
-	/* get the method the frame is for */
-	frame_method = vmthread->rx_method;
+	if (GC_IsMovable(chunk) && (gc_compact_add(chunk) == NULL))
+		gc_compact_overflowed = BVM_TRUE;
+}
 
-	/* start at the base of the uppermost frame on the VM stack */
-	frame_locals = vmthread->rx_locals;
+/**
+ * Give the new address of a reference after compaction.
+ *
+ * @param obj - a reference (may be \c NULL).
+ * @return the address the referenced object is being moved to, or the reference as given if it is not being moved.
+ */
+static bvm_obj_t *gc_compact_forward(bvm_obj_t *obj) {
 
-	/* The top of our first cell range is one cell past the top of the current method's stack.  This is NOT
-	 * inclusive.  */
-	frame_top = vmthread->rx_sp;
+	gc_compact_entry_t *entry;
 
-	/* truncate the stack list at the current stack segment so that all further segments in the stack
-	 * list are severed and will be GC'd */
-	vmthread->rx_stack->next = NULL;
+	if (obj == NULL) return NULL;
 
-	/* mark each of the remaining stacks in the stack list */
-	temp_frame_stack = vmthread->stack_list;
-	while (temp_frame_stack != NULL) {
-		BVM_CHUNK_SetColour(BVM_CHUNK_GetPointerChunk(temp_frame_stack), BVM_GC_COLOUR_BLACK);
-		temp_frame_stack = temp_frame_stack->next;
-	}
+	entry = gc_compact_slot(BVM_CHUNK_GetPointerChunk(obj));
 
-	/* for each locals/operand-stack section of a frame (which we delimit with frame_locals/frame_top),
-	 * attempt to mark each cell if it is a valid heap pointer */
-	while (  !( (frame_method == BVM_METHOD_CALLBACKWEDGE) &&
-		        (frame_locals[1].callback == bvm_thread_terminated_callback) )) {
+	return (entry->to != NULL) ? BVM_CHUNK_GetUserData(entry->to) : obj;
+}
 
-		if (!BVM_METHOD_IsNative(frame_method)) {
+/**
+ * Set the new address of each array that can be moved.  Each region is walked from its start.  Every array that is not
+ * pinned is slid down to just after the chunk before it that stays in use - closing up the free gap between them.  Moves
+ * stop when the compaction table is full.  A gap left before a chunk that does not move is given to the array moved just
+ * before it if it is too small to be a free chunk.
+ *
+ * @return the number of arrays to be moved.
+ */
+static bvm_uint32_t gc_compact_plan() {
 
-			/* cell ptr is a moving ptr that we used to traverse the cell in the frame.  For a non-native
-			 * method the range is from the 'locals' to the current stack pointer in the frame. */
-			cell_ptr = frame_locals;
+	bvm_heap_region_t *region;
+	bvm_uint32_t moved = 0;
 
-		} else {
+	for (region = bvm_gl_heap_regions; region != NULL; region = region->next) {
 
-			/* cell ptr is a moving ptr that we used to traverse the range
-			 * defined by frame_locals/frame_top.  Note the special calculation here for a
-			 * native method.  Native methods do not use the stack like a non-native method, and the
-			 * method call arguments are not copied into the frame locals areas like a
-			 * non-native method.  A native method's arguments are actually located at the stop of the stack
-			 * in the *calling* frame - so when determining where to start our cell scan, we point it to
-			 * the stack pointer in the previous frame.  The top of the cell scan is that position plus the number
-			 * of arguments the method has + 'this' if the method is not static. */
-			cell_ptr = frame_locals[BVM_FRAME_SP_OFFSET].ptr_value;
+		/* where the next moved chunk goes */
+		bvm_uint8_t *dest = region->start;
 
-			frame_top = cell_ptr + frame_method->num_args + ( BVM_METHOD_IsStatic(frame_method) ? 0 : 1);
-		}
+		/* the last array moved since a chunk that stays in place */
+		gc_compact_entry_t *last = NULL;
 
-		/* for each cell in the locals/stack part of the current frame ... */
-		while (cell_ptr < frame_top) {
+		bvm_chunk_t *chunk = (bvm_chunk_t *) region->start;
 
-			/* assume everything is a java object reference pointer, and then attempt to
-			 * prove it otherwise */
-			obj_ptr = (bvm_obj_t *) cell_ptr->ptr_value;
+		while (BVM_TRUE) {
 
-			/* it will not be an object pointer if it lies outside the heap range.  bvm_gl_heap_start is
-			 * inclusive, bvm_gl_heap_end is exclusive.  Note this expression also excludes NULLs. */
-			if ( ( (bvm_uint8_t *) obj_ptr >= bvm_gl_heap_start) &&
-				 ( (bvm_uint8_t *) obj_ptr < bvm_gl_heap_end) ) {
+			bvm_uint8_t *at = BVM_CHUNK_AsBytePtr(chunk);
 
-				/* get the bvm_clazz_t pointer of the candidate 'object' - if it is also within the heap then we can
-				 * be more confident the 'object' is a real java object. */
-				bvm_clazz_t *heap_ptr_clazz = obj_ptr->clazz;
+			/* the fence chunk at the end of the region never moves */
+			bvm_bool_t end = (chunk >= (bvm_chunk_t *) region->end);
 
-				if ( ( (bvm_uint8_t *) heap_ptr_clazz >= bvm_gl_heap_start) &&
-					 ( (bvm_uint8_t *) heap_ptr_clazz < bvm_gl_heap_end) ) {
+			if (!end && !BVM_CHUNK_IsInuse(chunk)) {
+				chunk = BVM_CHUNK_GetNextChunk(chunk);
+				continue;
+			}
 
-					/* more confident now .... more tests though, each bvm_clazz_t stores the magic number '0xCAFEBABE'.  If the
-					 * bvm_clazz_t pointer for the candidate java object is equal to that magic number, we are more confident
-					 * it is a real object reference we are dealing with. */
+			if ( !end && (dest < at) && GC_IsMovable(chunk) ) {
 
-					if (heap_ptr_clazz->magic_number == BVM_MAGIC_NUMBER) {
+				gc_compact_entry_t *entry = gc_compact_slot(chunk);
 
-						/* okay, object has a class pointer in the heap and the magic number of the class
-						 * at that pointer is correct.  We are almost sure it is a real object.  BUT, we make some final
-						 * checks to  make sure it is in use, not been marked, and the chunk type is really for
-						 * an object type. */
+				/* not pinned?  Give it a new home if there is room in the table */
+				if ( (entry->from == NULL) && ((entry = gc_compact_add(chunk)) != NULL) ) {
 
-						/* get the chunk for the object pointer  */
-						chunk = BVM_CHUNK_GetPointerChunk(obj_ptr);
+					entry->to = (bvm_chunk_t *) dest;
+					entry->size = BVM_CHUNK_GetSize(chunk);
 
-						/* If it is in use, is an object type, and has not been coloured yet, colour it
-						 * grey and proceed to mark it. */
-						if ( (BVM_CHUNK_IsInuse(chunk)) &&
-							 (BVM_CHUNK_GetType(chunk) <= BVM_ALLOC_MAX_OBJECT) &&
-							 (BVM_CHUNK_GetColour(chunk) == BVM_GC_COLOUR_WHITE) &&
-							 (bvm_heap_is_chunk_valid(chunk)) ) {
+					dest += entry->size;
+					last = entry;
+					moved++;
 
-							BVM_CHUNK_SetColour(chunk, BVM_GC_COLOUR_GREY);
-							gc_mark_chunk(chunk);
-						}
-					}
+					chunk = BVM_CHUNK_GetNextChunk(chunk);
+					continue;
 				}
 			}
 
-			/* continue on up the cell range defined by frame_locals/frame_top */
-			cell_ptr++;
-		}
+			/* this one stays where it is.  Any gap before it becomes a free chunk, unless it is too small */
+			if ( (last != NULL) && ((bvm_uint32_t) (at - dest) < BVM_CHUNK_MIN_SIZE) )
+				last->size += (bvm_uint32_t) (at - dest);
 
-		/* move down the VM stack to the previous frame.  Kind of like a pop_frame() but without any
-		 * real popping */
-		frame_method = frame_locals[BVM_FRAME_METHOD_OFFSET].ptr_value;
-		frame_top    = frame_locals[BVM_FRAME_SP_OFFSET].ptr_value;
-		frame_locals = frame_locals[BVM_FRAME_LOCALS_OFFSET].ptr_value;
+			if (end) break;
+
+			last = NULL;
+			dest = at + BVM_CHUNK_GetSize(chunk);
+			chunk = BVM_CHUNK_GetNextChunk(chunk);
+		}
 	}
+
+	return moved;
 }
 
 /**
- *  Scan the global VM threads list and mark all non-terminated threads.
+ * Update every reference to an array that is being moved.  The references are in the fields of objects, the elements of
+ * object arrays, the static fields of clazzes and the VM's monitors and threads.  Nothing has been moved yet.
  */
-static void gc_mark_threads() {
+static void gc_compact_fixup() {
 
+	bvm_heap_region_t *region;
+	bvm_chunk_t *chunk;
+	bvm_monitor_t *monitor;
 	bvm_vmthread_t *vmthread;
-	bvm_chunk_t *thread_chunk;
-
-#if BVM_DEBUG_HEAP_GC_ON_ALLOC
-	if (bvm_gl_threads == NULL) return;
-#endif
 
-	/* force the current gl registers back into the current thread registers */
-	bvm_thread_store_registers(bvm_gl_thread_current);
+	for (region = bvm_gl_heap_regions; region != NULL; region = region->next) {
 
-	/* recalc the start of the threads list by finding the first un-terminated thread */
-	while ( (bvm_gl_threads != NULL) && (bvm_gl_threads->status == BVM_THREAD_STATUS_TERMINATED))
-		bvm_gl_threads = bvm_gl_threads->next;
+		for (chunk = (bvm_chunk_t *) region->start; chunk < (bvm_chunk_t *) region->end; chunk = BVM_CHUNK_GetNextChunk(chunk)) {
 
-	/* init our loop var to the (possibly newly recalculated - above) start of the threads list */
-	vmthread = bvm_gl_threads;
+			if (!BVM_CHUNK_IsInuse(chunk)) continue;
 
-	while (vmthread != NULL) {
+			switch (BVM_CHUNK_GetType(chunk)) {
 
-		if (vmthread->status != BVM_THREAD_STATUS_TERMINATED) {
+				case BVM_ALLOC_TYPE_OBJECT:
+				case BVM_ALLOC_TYPE_STRING:
+				case BVM_ALLOC_TYPE_WEAK_REFERENCE:
+				case BVM_ALLOC_TYPE_SOFT_REFERENCE:
+				case BVM_ALLOC_TYPE_EPHEMERON: {
 
-			/* colour the vm thread black */
-			thread_chunk = BVM_CHUNK_GetPointerChunk(vmthread);
-			BVM_CHUNK_SetColour(thread_chunk, BVM_GC_COLOUR_BLACK);
+					bvm_obj_t *obj = BVM_CHUNK_GetUserData(chunk);
+					bvm_instance_clazz_t *clazz = (bvm_instance_clazz_t *) obj->clazz;
+					int i;
 
-			/* mark the java thread object */
-			gc_mark_chunk(BVM_CHUNK_GetPointerChunk(vmthread->thread_obj));
+					if (clazz == NULL) break;
 
-			/* only mark the thread stack if it exists.  Also, no need to scan the
-			 * stack if the thread is NEW - it will have a stack (which may have multiple segments) - but it will
-			 * not have anything on it to do. */
-			if ( (vmthread->stack_list != NULL) ) {
-				if (vmthread->status == BVM_THREAD_STATUS_NEW) {
-					/* loop through the stack segments.  It is *possible* that there may be more than one
-					 * for a NEW thread.  For example, the 'run' method may be very large and
-					 * exceed the default stack size (after the callback wedge is placed into the stack) and therefore have a
-					 * new larger one appended. */
-					bvm_stacksegment_t *stack = vmthread->stack_list;
-					while (stack != NULL) {
-						BVM_CHUNK_SetColour(BVM_CHUNK_GetPointerChunk(stack), BVM_GC_COLOUR_BLACK);
-						stack = stack->next;
+					for (i = clazz->ref_fields_count; i--;) {
+						bvm_cell_t *field = &obj->fields[clazz->ref_field_offsets[i]];
+						field->ref_value = gc_compact_forward(field->ref_value);
 					}
+
+					break;
 				}
-				else {
-					gc_mark_thread_stack(vmthread);
+				case BVM_ALLOC_TYPE_ARRAY_OF_OBJECT: {
+
+					bvm_instance_array_obj_t *array = BVM_CHUNK_GetUserData(chunk);
+					bvm_uint32_t i;
+
+					for (i = array->length.int_value; i--;)
+						array->data[i] = BVM_REF_Encode(gc_compact_forward(BVM_REF_Decode(array->data[i])));
+
+					break;
 				}
-			}
+				case BVM_ALLOC_TYPE_INSTANCE_CLAZZ: {
 
-			/* If the thread has a pending exception, mark the exception */
-			if (vmthread->pending_exception != NULL) {
-				bvm_chunk_t *ex_chunk;
-				ex_chunk = BVM_CHUNK_GetPointerChunk(vmthread->pending_exception);
-				BVM_CHUNK_SetColour(ex_chunk, BVM_GC_COLOUR_GREY);
-				gc_mark_chunk(ex_chunk);
-			}
+					bvm_instance_clazz_t *clazz = BVM_CHUNK_GetUserData(chunk);
+					int i;
 
-			if (vmthread->exception_location.throwable != NULL) {
-				bvm_chunk_t *ex_chunk;
-				ex_chunk = BVM_CHUNK_GetPointerChunk(vmthread->exception_location.throwable);
-				BVM_CHUNK_SetColour(ex_chunk, BVM_GC_COLOUR_GREY);
-				gc_mark_chunk(ex_chunk);
+					if (clazz->fields == NULL) break;
+
+					/* only the clazz's own static fields - inherited ones belong to the super clazz */
+					for (i = clazz->virtual_field_offset; i--;) {
+
+						bvm_field_t *field = &clazz->fields[i];
+						char c = field->jni_signature->data[0];
+
+						if ( (c == '[') || (c == 'L') )
+							field->value.static_value.ref_value = gc_compact_forward(field->value.static_value.ref_value);
+					}
+
+					break;
+				}
 			}
 		}
+	}
 
-		/* if the next thread in the list is terminated, skip it.  Note that the actual real
-		 * gl thread list is amended here to exclude the terminated thread.
-		 * TODO - would be better to spin here until a non-terminated one is found? */
-		if ( (vmthread->next != NULL) && (vmthread->next->status == BVM_THREAD_STATUS_TERMINATED) )
-			vmthread->next = vmthread->next->next;
-
-		vmthread = vmthread->next;
+	for (monitor = bvm_gl_thread_monitor_list; monitor != NULL; monitor = monitor->next) {
+		if (monitor->in_use)
+			monitor->owner_object = gc_compact_forward(monitor->owner_object);
 	}
-}
 
-#if BVM_DEBUGGER_ENABLE
+	/* monitors are hashed by owner object address */
+	bvm_thread_monitor_rehash();
+
+	for (vmthread = bvm_gl_threads; vmthread != NULL; vmthread = vmthread->next)
+		vmthread->waiting_on_object = gc_compact_forward(vmthread->waiting_on_object);
+
+#if BVM_PROFILER_ALLOCATION_SITES_ENABLE && BVM_HEAP_DUMP_ENABLE
+	/* the profiler remembers sampled objects by address */
+	bvm_profiler_allocation_forward(gc_compact_forward);
+#endif
+
+#if BVM_OBJECT_IDENTITY_HASH_ENABLE
+	/* so does the table of arrays with an identity hash */
+	bvm_object_hash_forward(gc_compact_forward);
+#endif
+}
 
 /**
- * Mark objects in the JDWP debugger root map.  Objects in this map have put there as a consequence
- * of the JDWP command ObjectReference.DisableCollection.
+ * Give a gap between chunks back to the free list as a single free chunk.
+ *
+ * @param start - the start of the gap.
+ * @param chunk - the in-use chunk that follows the gap.
  */
-void gc_mark_debug_roots() {
+static void gc_compact_free_gap(bvm_uint8_t *start, bvm_chunk_t *chunk) {
 
+	bvm_uint32_t size = (bvm_uint32_t) (BVM_CHUNK_AsBytePtr(chunk) - start);
 
-	int i = BVMD_ROOTMAP_SIZE;
-	bvm_chunk_t *chunk;
+	/* the chunk after the gap will have its P bit set again if there is a gap */
+	chunk->header &= ~BVM_CHUNK_PREV_FREE_MASK;
 
-	while (i--) {
+	if (size > 0) {
+		bvm_chunk_t *gap = (bvm_chunk_t *) start;
+		gap->header = BVM_CHUNK_SizeHeader(size) | (BVM_ALLOC_TYPE_DATA << BVM_CHUNK_TYPE_SHIFT) | BVM_CHUNK_INUSE_MASK;
+		bvm_heap_free_chunk(gap);
+	}
+}
 
-		bvmd_root_t *root = bvmd_root_map[i];
+/**
+ * Move each array as planned by #gc_compact_plan.  Each region is walked in address order and as arrays only ever move
+ * down, the walk never reaches memory that has been moved over.  Every free chunk found is taken out of the free list,
+ * and each gap left in front of a chunk that stays where it is is freed as one chunk.
+ */
+static void gc_compact_move() {
 
-		while (root != NULL) {
+	bvm_heap_region_t *region;
 
-			chunk = BVM_CHUNK_GetPointerChunk(root->addr);
+	for (region = bvm_gl_heap_regions; region != NULL; region = region->next) {
 
-			/* If it is in use, and has not been coloured yet, colour it and mark it. */
-			if ( (BVM_CHUNK_IsInuse(chunk)) &&
-				 (BVM_CHUNK_GetColour(chunk) == BVM_GC_COLOUR_WHITE) ) {
+		bvm_uint8_t *dest = region->start;
+		bvm_chunk_t *chunk = (bvm_chunk_t *) region->start;
 
-				BVM_CHUNK_SetColour(chunk, BVM_GC_COLOUR_GREY);
-				gc_mark_chunk(chunk);
-			}
+		while (chunk < (bvm_chunk_t *) region->end) {
 
-			root = root->next;
-		}
-	}
-}
+			bvm_chunk_header_t header = chunk->header;
+			bvm_chunk_t *next = BVM_CHUNK_GetNextChunk(chunk);
 
-#endif
+			if (!BVM_CHUNK_IsInuse(chunk)) {
+				bvm_heap_take_free_chunk(chunk);
+			} else {
 
+				gc_compact_entry_t *entry = GC_IsMovable(chunk) ? gc_compact_slot(chunk) : NULL;
 
-/**
- * Scan the weak references list and set to \c NULL the referent object reference for any objects
- * that will be GC'd in the sweep.  The #weak_refs header will be \c NULL after this.
- */
-static void gc_visit_weakrefs() {
+				if ( (entry != NULL) && (entry->to != NULL) ) {
 
-	while (weak_refs != NULL) {
+					/* the new home may overlap the old one */
+					memmove(entry->to, chunk, BVM_CHUNK_GetSize(chunk));
 
-		if (weak_refs->referent != NULL) {
-			bvm_chunk_t *chunk = BVM_CHUNK_GetPointerChunk(weak_refs->referent);
-			if (BVM_CHUNK_GetColour(chunk) == BVM_GC_COLOUR_WHITE) {
-				weak_refs->referent = NULL;
+					entry->to->header = BVM_CHUNK_SizeHeader(entry->size) |
+							(header & (BVM_CHUNK_TYPE_MASK | CHUNK_COLOUR_MASK | BVM_CHUNK_INUSE_MASK | BVM_CHUNK_LOCKWORD_MASK));
+
+					dest = BVM_CHUNK_AsBytePtr(entry->to) + entry->size;
+				} else {
+					gc_compact_free_gap(dest, chunk);
+					dest = BVM_CHUNK_AsBytePtr(next);
+				}
 			}
+
+			chunk = next;
 		}
 
-		weak_refs = weak_refs->next;
+		/* and the gap before the region fence */
+		gc_compact_free_gap(dest, chunk);
 	}
 }
 
 /**
- * Perform a garbage collection cycle.  A detailed explanation is at the top of
- * this source file.
+ * Decide whether the heap is now fragmented enough to be compacted at the next thread switch - if the largest free
+ * chunk is less than #BVM_GC_COMPACT_FRAGMENTATION_PERCENT of all free space.
  */
-void bvm_gc() {
+static void gc_check_fragmentation() {
 
-	weak_refs = NULL;
+	if ( bvm_heap_largest_free() < ((bvm_gl_heap_free / 100) * BVM_GC_COMPACT_FRAGMENTATION_PERCENT) )
+		bvm_gl_gc_compact_pending = BVM_TRUE;
+}
 
-	/* scan interned strings */
-	/* TODO - could interned string be marked as STATIC when created and therefore avoid doing this
-	 * each time ? */
-	gc_mark_interned_strings();
+/**
+ * Perform a full garbage collection and then compact the heap.  Arrays are moved to close up the free space between
+ * chunks and the references to them are updated.  Arrays found from a thread stack or a VM root are pinned in place.
+ *
+ * This must only be called when no VM code is holding a pointer to an array in a 'C' variable - the interpreter calls
+ * it between bytecodes, at a thread switch, when #bvm_gl_gc_compact_pending is set.
+ */
+void bvm_gc_compact() {
 
-	/* scan transient root stack */
-	gc_mark_transient_roots();
+#if BVM_DEBUGGER_ENABLE
+	/* the debugger knows objects by their address */
+	if (bvmd_is_session_open()) {
+		bvm_gl_gc_compact_pending = BVM_FALSE;
+		return;
+	}
+#endif
 
-	/* scan system root stack */
-	gc_mark_permanent_roots();
+	/* a native holds the data of an array - stay pending and compact at a later switch */
+	if (bvm_gl_ni_critical_count > 0) return;
 
-	/* mark each thread */
-	gc_mark_threads();
+	memset(gc_compact_table, 0, sizeof(gc_compact_table));
+	gc_compact_table_count = 0;
+	gc_compact_overflowed = BVM_FALSE;
 
-#if BVM_DEBUGGER_ENABLE
-	/* mark the debug root, if any */
-	if (bvmd_is_session_open()) gc_mark_debug_roots();
+	/* mark, pinning anything the roots refer to, and sweep */
+	gc_pinning = BVM_TRUE;
+	gc_collect(BVM_TRUE);
+	gc_pinning = BVM_FALSE;
+
+#if BVM_GC_LAZY_SWEEP_ENABLE
+	gc_sweep_finish();
 #endif
 
-	/* before doing the sweep, set all found weak references referent object to NULL. */
-	gc_visit_weakrefs();
+	if (!gc_compact_overflowed && (gc_compact_plan() > 0) ) {
+		gc_compact_fixup();
+		gc_compact_move();
+	}
 
-	/* and finally sweep the heap */
-	gc_sweep();
+	bvm_heap_adjust_regions();
+
+	bvm_gl_gc_compact_pending = BVM_FALSE;
 }
 
+#endif
+
 #if BVM_DEBUG_CLEAR_HEAP_ON_EXIT
 
 static void clear_utfsstring_pool() {
@@ -1060,14 +3786,35 @@ static void clear_threads() {
 	}
 
 	bvm_gl_threads = NULL;
+
+#if (BVM_THREAD_STACK_POOL_SIZE > 0)
+	while (bvm_gl_thread_stack_pool != NULL) {
+		bvm_stacksegment_t *next = bvm_gl_thread_stack_pool->next;
+		bvm_heap_free(bvm_gl_thread_stack_pool);
+		bvm_gl_thread_stack_pool = next;
+	}
+	bvm_gl_thread_stack_pool_count = 0;
+#endif
 }
 
 static void clear_intern_string_pool() {
 
 	int i;
 
-	/* intern strings are not STATIC, so they will be cleaned up in a GC */
+	bvm_internstring_obj_t *current, *next;
+
+	/* intern strings are STATIC, so they are never cleaned up by a GC */
 	for (i = bvm_gl_internstring_pool_bucketcount; i--;) {
+
+		current = bvm_gl_internstring_pool[i];
+
+		while (current != NULL)  {
+			next = current->next;
+			bvm_heap_free(current->chars);
+			bvm_heap_free(current);
+			current = next;
+		}
+
 		bvm_gl_internstring_pool[i] = NULL;
 	}
 }
@@ -1087,7 +3834,7 @@ void bvm_debug_clear_heap() {
 
 	bvm_uint32_t leak_size;
 
-	bvm_gc();
+	bvm_gc_full();
 
 #if BVM_CONSOLE_ENABLE
 	bvm_pd_console_out("\n");
@@ -1111,7 +3858,7 @@ void bvm_debug_clear_heap() {
 	/* give back memory for threads */
 	clear_threads();
 
-	bvm_gc();
+	bvm_gc_full();
 
 	/* clear UTF string pool after GC (names are used to clean up classes during GC) */
 	clear_utfsstring_pool();
@@ -1122,6 +3869,13 @@ void bvm_debug_clear_heap() {
 	/* thread monitors are allocated as static */
 	clear_thread_monitors();
 
+	bvm_heap_free(bvm_gl_thread_timers);
+
+#if BVM_SOCKETS_ENABLE
+	bvm_heap_free(bvm_gl_thread_io_polls);
+	bvm_heap_free(bvm_gl_thread_io_threads);
+#endif
+
 	bvm_heap_free(bvm_gl_clazz_pool);
 	bvm_heap_free(bvm_gl_utfstring_pool);
 	bvm_heap_free(bvm_gl_internstring_pool);
@@ -80,7 +80,7 @@ static void dbg_fields(bvmd_instream_t* in, bvmd_outstream_t* out, bvm_bool_t do
 			bvmd_out_writestring(out, (char *) field->jni_signature->data);	/* JNI signature of the field */
 		} else {
 			/* write out native fields as INT */
-			bvm_utfstring_t utfstring = {1, (bvm_uint8_t *) "I", NULL};
+			bvm_utfstring_t utfstring = {1, 0, (bvm_uint8_t *) "I", NULL};
 			bvmd_out_writeutfstring(out, &utfstring);
 		}
 
@@ -97,6 +97,7 @@ static void dbg_fields(bvmd_instream_t* in, bvmd_outstream_t* out, bvm_bool_t do
 		flags = field->access_flags & ~BVM_FIELD_ACCESS_FLAG_CONST;
 		flags &= ~BVM_FIELD_ACCESS_FLAG_LONG;
 		flags &= ~BVM_FIELD_ACCESS_FLAG_NATIVE;
+		flags &= ~BVM_FIELD_ACCESS_FLAG_REFERENCE;
 
 		bvmd_out_writeint32(out, flags);				/* modBits */
 
@@ -155,7 +156,7 @@ static void dbg_methods(bvmd_instream_t* in, bvmd_outstream_t* out, bvm_bool_t d
 			bvmd_out_writestring(out, NULL);			/* output NULL (not supported) */
 #endif
 		}
-		bvmd_out_writeint32(out, method->access_flags);				/* modBits */
+		bvmd_out_writeint32(out, (method->access_flags & ~(BVM_METHOD_ACCESS_FLAG_LEAF | BVM_METHOD_ACCESS_FLAG_LAZY_TABLES)));	/* modBits */
 
 	}
 }
@@ -230,6 +231,7 @@ void bvmd_ch_RT_Modifiers(bvmd_instream_t* in, bvmd_outstream_t* out) {
 	flags = clazz->access_flags & ~BVM_CLASS_ACCESS_FLAG_ARRAY;
 	flags &= ~BVM_CLASS_ACCESS_FLAG_INSTANCE;
 	flags &= ~BVM_CLASS_ACCESS_FLAG_PRIMITIVE;
+	flags &= ~BVM_CLASS_ACCESS_FLAG_NO_STACKTRACE;
 
 	bvmd_out_writeint32(out, flags);
 }
@@ -315,6 +317,7 @@ void bvmd_RT_GetSetValues(bvmd_instream_t* in, bvmd_outstream_t* out, bvm_bool_t
                 bvmd_in_raw64(in, value_ptr);
 		    } else {
                 bvmd_in_readcell(in, tagtype, value_ptr);
+                if (BVM_FIELD_IsReference(field)) BVM_GC_WRITE_BARRIER(field->clazz, value_ptr->ref_value);
             }
 		else
 		    if (is_raw64) {
@@ -49,6 +49,8 @@ void bvmd_ch_M_LineTable(bvmd_instream_t* in, bvmd_outstream_t* out) {
 		bvmd_out_writeint64(out, 0, (bvm_uint32_t) -1);
 		bvmd_out_writeint32(out, 0);
 	} else {
+		BVM_METHOD_LoadCodeTables(method);
+
 		/* if there is bytecode, but there are no lines ... absent info ...*/
 		if ( (method->line_number_count == 0) && (method->code_length != 0))  {
 			out->error = JDWP_Error_ABSENT_INFORMATION;
@@ -93,6 +95,8 @@ static void do_variable_table(bvmd_instream_t* in, bvmd_outstream_t* out, bvm_bo
 	/* and likewise with the method */
 	if ( (method = bvmd_readcheck_method(in, out)) == NULL) return;
 
+	BVM_METHOD_LoadCodeTables(method);
+
 	if (method->local_variables == NULL) {
 		/* missing info on locals ? */
 		out->error = JDWP_Error_ABSENT_INFORMATION;
@@ -137,9 +141,14 @@ void bvmd_ch_M_VariableTable(bvmd_instream_t* in, bvmd_outstream_t* out) {
 	do_variable_table(in, out, BVM_FALSE);
 }
 
+#if BVM_DEBUGGER_BYTECODES_ENABLE
+
 /**
  * JDWP Command handler for Method/Bytecodes.
  *
+ * The bytecode is given as it was loaded, not as the VM has changed it.  Breakpoints are replaced by the opcodes they
+ * displaced, and fast opcodes by the standard opcodes they were substituted for - see #bvm_exec_unquickened_opcode.
+ *
  * @param in the request input stream
  * @param out the response output stream
  */
@@ -147,14 +156,41 @@ void bvmd_ch_M_Bytecodes(bvmd_instream_t* in, bvmd_outstream_t* out) {
 
 	bvm_instance_clazz_t *clazz;
 	bvm_method_t *method;
+	bvm_uint32_t pc_index = 0;
 
 	if ( (clazz = (bvm_instance_clazz_t *) bvmd_readcheck_reftype(in, out)) == NULL) return;
 	if ( (method = bvmd_readcheck_method(in, out)) == NULL) return;
 
 	bvmd_out_writeint32(out, method->code_length);
-	bvmd_out_writebytes(out, method->code.bytecode, method->code_length);
+
+	while (pc_index < method->code_length) {
+
+		bvm_uint8_t opcode = method->code.bytecode[pc_index];
+		bvm_uint32_t length;
+
+		if (opcode == OPCODE_breakpoint) {
+			bvmd_location_t location;
+			location.clazz = (bvm_clazz_t *) clazz;
+			location.method = method;
+			location.pc_index = pc_index;
+			bvmd_breakpoint_opcode_for_location(&location, &opcode);
+		}
+
+		opcode = bvm_exec_unquickened_opcode(opcode);
+		length = bvm_exec_instruction_length(method->code.bytecode, pc_index, opcode);
+
+		/* being defensive - never write past the end of the method */
+		if (pc_index + length > method->code_length) length = method->code_length - pc_index;
+
+		bvmd_out_writebyte(out, opcode);
+		bvmd_out_writebytes(out, method->code.bytecode + pc_index + 1, length - 1);
+
+		pc_index += length;
+	}
 }
 
+#endif
+
 
 /**
  * JDWP Command handler for Method/VariableTableWithGeneric.
@@ -85,6 +85,9 @@ void dbg_ObjectReference_GetSetValues(bvmd_instream_t* in, bvmd_outstream_t* out
 	bvm_uint32_t fields_nr, i;
 	bvm_uint8_t tagtype;
 	bvm_cell_t *value_cell;
+#if BVM_FIELD_PACKING_ENABLE
+	bvm_cell_t packed_cells[2];
+#endif
 
 	if (obj == NULL) {
 		out->error = JDWP_Error_INVALID_OBJECT;
@@ -110,7 +113,14 @@ void dbg_ObjectReference_GetSetValues(bvmd_instream_t* in, bvmd_outstream_t* out
 			return;
 		}
 
-		/* get a pointer to the bvm_cell_t that holds the field's value */
+		/* get a pointer to the bvm_cell_t that holds the field's value.  A packed field is read into cells of
+		 * its own first */
+#if BVM_FIELD_PACKING_ENABLE
+		if (BVM_FIELD_IsPacked(field)) {
+			value_cell = packed_cells;
+			bvm_object_get_packed_field(obj, field, value_cell);
+		} else
+#endif
 		value_cell = &(obj->fields[field->value.offset]);
 
 		/* if native, treat value as an INT */
@@ -126,9 +136,13 @@ void dbg_ObjectReference_GetSetValues(bvmd_instream_t* in, bvmd_outstream_t* out
 
 		if (do_set) {
 			/* only modify field if it is not native */
-			if (!BVM_FIELD_IsNative(field))
+			if (!BVM_FIELD_IsNative(field)) {
 				bvmd_in_readcell(in, tagtype, value_cell);
-			else
+				if (BVM_FIELD_IsReference(field)) BVM_GC_WRITE_BARRIER(obj, value_cell->ref_value);
+#if BVM_FIELD_PACKING_ENABLE
+				if (BVM_FIELD_IsPacked(field)) bvm_object_put_packed_field(obj, field, value_cell);
+#endif
+			} else
 				out->error = JDWP_Error_INVALID_FIELDID;
 		} else {
 			bvmd_out_writecell(out, tagtype, value_cell);
@@ -184,7 +198,8 @@ void bvmd_ch_OR_MonitorInfo(bvmd_instream_t* in, bvmd_outstream_t* out) {
 		return;
 	}
 
-	monitor = get_monitor_for_obj(obj);
+	/* a thin lock is reported as a monitor */
+	monitor = bvm_thread_monitor_inflate(obj);
 
 	if (monitor != NULL) {
 
@@ -118,7 +118,8 @@ static void dbg_read_array_value(bvmd_instream_t* in, bvm_uint8_t tagtype, bvm_j
 		case (JDWP_Tag_CLASS_LOADER):
 		case (JDWP_Tag_STRING):
 		case (JDWP_Tag_THREAD): {
-			( (bvm_instance_array_obj_t *) array_obj)->data[index] =  bvmd_in_readobject(in);
+			( (bvm_instance_array_obj_t *) array_obj)->data[index] =  BVM_REF_Encode((bvm_obj_t *) bvmd_in_readobject(in));
+			BVM_GC_WRITE_BARRIER(array_obj, BVM_REF_Decode(( (bvm_instance_array_obj_t *) array_obj)->data[index]));
 			break;
 		}
 	}
@@ -180,7 +181,7 @@ static void dbg_write_array_value(bvmd_outstream_t* out, bvm_uint8_t tagtype, bv
 			break;
 		}
 		case (JDWP_Tag_OBJECT): {
-			bvm_obj_t *obj = ( (bvm_instance_array_obj_t *) array_obj)->data[index];
+			bvm_obj_t *obj = BVM_REF_Decode(( (bvm_instance_array_obj_t *) array_obj)->data[index]);
 			bvmd_out_writebyte(out, bvmd_get_jdwptag_from_object(obj));
 			bvmd_out_writeobject(out, obj);
 			break;
@@ -192,7 +193,7 @@ static void dbg_write_array_value(bvmd_outstream_t* out, bvm_uint8_t tagtype, bv
 		case (JDWP_Tag_CLASS_LOADER):
 		case (JDWP_Tag_STRING):
 		case (JDWP_Tag_THREAD): {
-			bvm_obj_t *obj = ( (bvm_instance_array_obj_t *) array_obj)->data[index];
+			bvm_obj_t *obj = BVM_REF_Decode(( (bvm_instance_array_obj_t *) array_obj)->data[index]);
 			bvmd_out_writebyte(out, tagtype);
 			bvmd_out_writeobject(out, obj);
 			break;
@@ -66,7 +66,7 @@ void bvmd_ch_CLR_VisibleClasses(bvmd_instream_t* in, bvmd_outstream_t* out) {
 
 		while (length--) {
 
-			class_obj = clarray->data[length];
+			class_obj = (bvm_class_obj_t *) BVM_REF_Decode(clarray->data[length]);
 
 			if (class_obj != NULL) {
 				clazzes_nr++;
@@ -31,13 +31,17 @@
   An Event Definition (or 'eventdef') is a #bvmd_eventdef_t structure instance that holds information about a particular
   event request made by the debugger.  Each eventdef has a JDWP 'eventkind'.
 
-  Each new eventdef is placed into a global linked list (#bvmd_gl_eventdefs).
+  Each new eventdef is placed into a global linked list (#bvmd_gl_eventdefs).  It is also placed into a list of
+  eventdefs of its own eventkind (#bvmd_gl_eventdefs_by_kind), and a breakpoint eventdef into a list of
+  breakpoints hashed by location (#bvmd_gl_breakpoints).  Events are matched against these smaller lists only, so the
+  cost of an event does not grow with the number of eventdefs of other kinds or breakpoints at other locations.
 
   As each eventdef is received and processed, its eventkind is also registered into a single consolidated bvm_int32_t
   (#bvmd_gl_registered_events).  Each JDWP eventkind is translated to a 'DBG eventkind' that can be applied as a simple mask
   on the \c bvmd_gl_registered_events bvm_int32_t to set a bit and help quickly determine whether a given eventkind is registered.
   Notice each JDWP eventkind has a corresponding DBG eventkind.  The JDWP eventkinds numbers are not amenable to any kind
-  of quick lookup structure, so this simple translation is effective.
+  of quick lookup structure, so this simple translation is effective.  The bit number of a DBG eventkind (see
+  #bvmd_eventkind_index) is also the index of the list of eventdefs of that kind.
 
   As eventdefs are cleared by the debugger, the \c bvmd_gl_registered_events bvm_int32_t is recalculated to make sure it only contains
   those eventkinds that are actually still registered.
@@ -91,16 +95,24 @@
 /**
  * Global holder of registered event kinds.  One DBG event kind per bit is stored in this bvm_uint32_t.
  */
-bvm_uint32_t bvmd_gl_registered_events = 0;
+BVM_VM_LOCAL bvm_uint32_t bvmd_gl_registered_events = 0;
 
 /** Head of a global linked list of #bvmd_eventdef_t event definitions */
-bvmd_eventdef_t *bvmd_gl_eventdefs = NULL;
+BVM_VM_LOCAL bvmd_eventdef_t *bvmd_gl_eventdefs = NULL;
+
+/** Heads of the lists of event definitions of each eventkind, linked by \c next_of_kind and indexed by
+ * #bvmd_eventkind_index */
+BVM_VM_LOCAL bvmd_eventdef_t *bvmd_gl_eventdefs_by_kind[BVMD_EVENTKIND_COUNT];
+
+/** Heads of the lists of breakpoint event definitions, linked by \c next_at_location and indexed by
+ * #BVMD_BREAKPOINT_HASH of their location */
+BVM_VM_LOCAL bvmd_eventdef_t *bvmd_gl_breakpoints[BVMD_BREAKPOINT_HASH_SIZE];
 
 /** Head of a list of clazzes unloaded during GC awaiting their CLASS_UNLOAD event being sent. Clazzes
  * here are no longer in the clazz pool, and have had all their internal structures already freed.  Only
  * the bvm_clazz_t struct remains, and any pointers it may have into permanent things like the
  * uftstring pool. */
-bvm_clazz_t *bvmd_gl_unloaded_clazzes = NULL;
+BVM_VM_LOCAL bvm_clazz_t *bvmd_gl_unloaded_clazzes = NULL;
 
 
 /**
@@ -161,6 +173,48 @@ static bvm_uint8_t dbg_breakpoint_set(bvmd_location_t *location) {
 	return opcode;
 }
 
+/**
+ * For a given JDWP eventkind, give the bit number of its DBG eventkind.  The DBG eventkind is a mask of that bit, and the
+ * bit number is the index of the list of eventdefs of that kind in #bvmd_gl_eventdefs_by_kind.
+ *
+ * @param jdwp_eventkind a given JDWP eventkind
+ *
+ * @return the bit number of the DBG eventkind, or -1 if the JDWP eventkind is not supported.
+ */
+int bvmd_eventkind_index(bvm_uint8_t jdwp_eventkind) {
+
+	/* the bit number of each BVMD_EventKind_XXX mask - those commented out are not supported */
+	switch (jdwp_eventkind) {
+
+		case (JDWP_EventKind_SINGLE_STEP): return 0;
+		case (JDWP_EventKind_BREAKPOINT): return 1;
+		/*case (JDWP_EventKind_FRAME_POP): return 2;*/
+		case (JDWP_EventKind_EXCEPTION): return 3;
+		/*case (JDWP_EventKind_USER_DEFINED): return 4;*/
+		case (JDWP_EventKind_THREAD_START): return 5;
+		case (JDWP_EventKind_THREAD_DEATH): return 6;
+		case (JDWP_EventKind_CLASS_PREPARE): return 7;
+		case (JDWP_EventKind_CLASS_UNLOAD): return 8;
+		case (JDWP_EventKind_CLASS_LOAD): return 9;
+		/*case (JDWP_EventKind_FIELD_ACCESS): return 10;*/
+		/*case (JDWP_EventKind_FIELD_MODIFICATION): return 11;*/
+		case (JDWP_EventKind_EXCEPTION_CATCH): return 12;
+		/*case (JDWP_EventKind_METHOD_ENTRY): return 13;*/
+		/*case (JDWP_EventKind_METHOD_EXIT): return 14;*/
+		/*case (JDWP_EventKind_METHOD_EXIT_WITH_RETURN_VALUE): return 15;*/
+		/*case (JDWP_EventKind_MONITOR_CONTENDED_ENTER): return 16;*/
+		/*case (JDWP_EventKind_MONITOR_CONTENDED_ENTERED): return 17;*/
+		/*case (JDWP_EventKind_MONITOR_WAIT): return 18;*/
+		/*case (JDWP_EventKind_MONITOR_WAITED): return 19;*/
+		case (JDWP_EventKind_VM_START): return 20;
+		case (JDWP_EventKind_VM_DEATH): return 21;
+		/*case (JDWP_EventKind_VM_DISCONNECTED): return 22;*/
+		default : {
+			return -1;
+		}
+	}
+}
+
 /**
  * For a given JDWP eventkind, translate it to a DBG eventkind and 'or' it in the
  * bvmd_gl_registered_events bitmap.
@@ -171,87 +225,75 @@ static bvm_uint8_t dbg_breakpoint_set(bvmd_location_t *location) {
  */
 static bvm_bool_t dbg_eventkind_register(bvm_uint8_t jdwp_eventkind) {
 
-	bvm_int32_t dbg_eventkind = BVMD_EventKind_NONE;
+	int index = bvmd_eventkind_index(jdwp_eventkind);
 
-	switch (jdwp_eventkind) {
+	if (index < 0) return BVM_FALSE;
 
-		case (JDWP_EventKind_SINGLE_STEP):
-			dbg_eventkind = BVMD_EventKind_SINGLE_STEP;
-			break;
-		case (JDWP_EventKind_BREAKPOINT):
-			dbg_eventkind = BVMD_EventKind_BREAKPOINT;
-			break;
-		/*case (JDWP_EventKind_FRAME_POP):
-			dbg_eventkind = BVMD_EventKind_FRAME_POP;
-			break;*/
-		case (JDWP_EventKind_EXCEPTION):
-			dbg_eventkind = BVMD_EventKind_EXCEPTION;
-			break;
-		/*case (JDWP_EventKind_USER_DEFINED):
-			dbg_eventkind = BVMD_EventKind_USER_DEFINED;
-			break;*/
-		case (JDWP_EventKind_THREAD_START):
-			dbg_eventkind = BVMD_EventKind_THREAD_START;
-			break;
-		case (JDWP_EventKind_THREAD_DEATH):
-			dbg_eventkind = BVMD_EventKind_THREAD_DEATH;
-			break;
-		case (JDWP_EventKind_CLASS_PREPARE):
-			dbg_eventkind = BVMD_EventKind_CLASS_PREPARE;
-			break;
-		case (JDWP_EventKind_CLASS_UNLOAD):
-			dbg_eventkind = BVMD_EventKind_CLASS_UNLOAD;
-			break;
-		case (JDWP_EventKind_CLASS_LOAD):
-			dbg_eventkind = BVMD_EventKind_CLASS_LOAD;
-			break;
-		/*case (JDWP_EventKind_FIELD_ACCESS):
-			dbg_eventkind = BVMD_EventKind_FIELD_ACCESS;
-			break;
-		case (JDWP_EventKind_FIELD_MODIFICATION):
-			dbg_eventkind = BVMD_EventKind_FIELD_MODIFICATION;
-			break;*/
-		case (JDWP_EventKind_EXCEPTION_CATCH):
-			dbg_eventkind = BVMD_EventKind_EXCEPTION_CATCH;
-			break;
-		/*case (JDWP_EventKind_METHOD_ENTRY):
-			dbg_eventkind = BVMD_EventKind_METHOD_ENTRY;
-			break;
-		case (JDWP_EventKind_METHOD_EXIT):
-			dbg_eventkind = BVMD_EventKind_METHOD_EXIT;
-			break;
-		case (JDWP_EventKind_METHOD_EXIT_WITH_RETURN_VALUE):
-			dbg_eventkind = BVMD_EventKind_METHOD_EXIT_WITH_RETURN_VALUE;
-			break;
-		case (JDWP_EventKind_MONITOR_CONTENDED_ENTER):
-			dbg_eventkind = BVMD_EventKind_MONITOR_CONTENDED_ENTER;
-			break;
-		case (JDWP_EventKind_MONITOR_CONTENDED_ENTERED):
-			dbg_eventkind = BVMD_EventKind_MONITOR_CONTENDED_ENTERED;
-			break;
-		case (JDWP_EventKind_MONITOR_WAIT):
-			dbg_eventkind = BVMD_EventKind_MONITOR_WAIT;
-			break;
-		case (JDWP_EventKind_MONITOR_WAITED):
-			dbg_eventkind = BVMD_EventKind_MONITOR_WAITED;
-			break;*/
-		case (JDWP_EventKind_VM_START):
-			dbg_eventkind = BVMD_EventKind_VM_START;
-			break;
-		case (JDWP_EventKind_VM_DEATH):
-			dbg_eventkind = BVMD_EventKind_VM_DEATH;
-			break;
-		/*case (JDWP_EventKind_VM_DISCONNECTED):
-			dbg_eventkind = BVMD_EventKind_VM_DISCONNECTED;
-			break;*/
-		default : {
-			return BVM_FALSE;
+	bvmd_gl_registered_events |= ((bvm_uint32_t) 1 << index);
+
+	return BVM_TRUE;
+}
+
+/**
+ * Places an eventdef in the global eventdefs list, in the list of eventdefs of its eventkind, and, if it is a breakpoint
+ * with a location, in the list of breakpoints for that location.
+ *
+ * @param eventdef the eventdef to place
+ */
+static void dbg_eventdef_link(bvmd_eventdef_t *eventdef) {
+
+	int index = bvmd_eventkind_index(eventdef->eventkind);
+
+	/* place the eventdef at the head of the events list ... */
+	eventdef->next = bvmd_gl_eventdefs;
+	bvmd_gl_eventdefs = eventdef;
+
+	/* ... and at the head of the list of its kind - only registered eventkinds get this far */
+	eventdef->next_of_kind = bvmd_gl_eventdefs_by_kind[index];
+	bvmd_gl_eventdefs_by_kind[index] = eventdef;
+
+	/* a breakpoint is found by where it is.  A duplicate breakpoint has no location and is never hit. */
+	if (eventdef->eventkind == JDWP_EventKind_BREAKPOINT) {
+
+		int i = eventdef->modifier_count;
+
+		while (i--) {
+
+			bvmd_event_modifier_t *modifier = &(eventdef->modifiers[i]);
+
+			if ( (modifier->modkind == JDWP_EventRequest_Set_Out_modifiers_Modifier_LocationOnly) && (modifier->in_use) ) {
+
+				int hash = BVMD_BREAKPOINT_HASH(modifier->u.locationonly.method, modifier->u.locationonly.pc_index);
+
+				eventdef->breakpoint_location = &(modifier->u.locationonly);
+				eventdef->next_at_location = bvmd_gl_breakpoints[hash];
+				bvmd_gl_breakpoints[hash] = eventdef;
+				break;
+			}
 		}
 	}
+}
 
-	bvmd_gl_registered_events |= dbg_eventkind;
+/**
+ * Takes an eventdef out of the list of eventdefs of its eventkind and out of the list of breakpoints for its location.
+ * It is not taken out of the global eventdefs list.
+ *
+ * @param eventdef the eventdef to take out
+ */
+static void dbg_eventdef_unlink(bvmd_eventdef_t *eventdef) {
 
-	return BVM_TRUE;
+	bvmd_eventdef_t **link = &(bvmd_gl_eventdefs_by_kind[bvmd_eventkind_index(eventdef->eventkind)]);
+
+	while ( (*link != NULL) && (*link != eventdef) ) link = &((*link)->next_of_kind);
+	if (*link != NULL) *link = eventdef->next_of_kind;
+
+	if (eventdef->breakpoint_location != NULL) {
+
+		link = &(bvmd_gl_breakpoints[BVMD_BREAKPOINT_HASH(eventdef->breakpoint_location->method, eventdef->breakpoint_location->pc_index)]);
+
+		while ( (*link != NULL) && (*link != eventdef) ) link = &((*link)->next_at_location);
+		if (*link != NULL) *link = eventdef->next_at_location;
+	}
 }
 
 /**
@@ -283,6 +325,8 @@ static bvmd_eventdef_t *dbg_eventdef_remove(bvm_uint8_t jdwp_eventkind, bvm_int3
 				prev->next = def->next;
 			}
 
+			dbg_eventdef_unlink(def);
+
 			return def;
 		}
 
@@ -496,8 +540,9 @@ void bvmd_ch_ER_Set(bvmd_instream_t* in, bvmd_outstream_t* out) {
 					 * size. */
 					vmthread->dbg_step.position = bvmd_step_get_position(vmthread->dbg_step.size, vmthread->rx_method, vmthread->rx_pc);
 
-					/* and record the stack depth also .. */
-					vmthread->dbg_step.stack_depth = bvm_stack_get_depth(bvm_gl_thread_current);
+					/* and record the stack depth also - as the frame count register, which is what stepping compares
+					 * against */
+					vmthread->dbg_step.stack_depth = vmthread->rx_depth;
 				}
 
 				break;
@@ -533,9 +578,8 @@ void bvmd_ch_ER_Set(bvmd_instream_t* in, bvmd_outstream_t* out) {
 
 	if (out->error == JDWP_Error_NONE) {
 
-		/* place the new eventdef at the head of the events list */
-		eventdef->next = bvmd_gl_eventdefs;
-		bvmd_gl_eventdefs = eventdef;
+		/* place the new eventdef at the head of the events lists */
+		dbg_eventdef_link(eventdef);
 
 		bvmd_out_writeint32(out, eventdef->id);
 	} else {
@@ -638,8 +682,10 @@ void bvmd_eventdef_clearall() {
 		eventdef = next;
 	}
 
-	/* NULL the head of the eventdef list */
+	/* NULL the head of the eventdef lists */
 	bvmd_gl_eventdefs = NULL;
+	memset(bvmd_gl_eventdefs_by_kind, 0, sizeof(bvmd_gl_eventdefs_by_kind));
+	memset(bvmd_gl_breakpoints, 0, sizeof(bvmd_gl_breakpoints));
 
 	/* .. and make sure no eventkinds are registered anymore */
 	bvmd_gl_registered_events = 0;
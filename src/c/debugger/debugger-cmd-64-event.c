@@ -54,6 +54,7 @@ bvm_native_ulong_t bvmd_step_get_position(int step_size, bvm_method_t *method, b
 		 position = *(bvm_native_ulong_t *) bvm_gl_rx_pc;
 	 }
 	 else {
+		 BVM_METHOD_LoadCodeTables(method);
 		 if (method->line_numbers != NULL) position = bvm_clazz_get_source_line(method, pc);
 	 }
 
@@ -206,17 +207,22 @@ void bvmd_send_parked_events(bvm_vmthread_t *vmthread) {
 }
 
 /**
- * Creates a new output stream configured as a debuggee command for #JDWP_Event and
- * #JDWP_Event_Composite as long as the debugger has registered for events of the given
- * event kind.
+ * Reports whether the debugger has registered for events of a given DBG event kind.  This is the quick test made
+ * before the eventdefs are looked at.
  *
  * @param eventkind a given eventkind.
+ *
+ * @return #BVM_TRUE if a debugger session is open and the eventkind is registered, #BVM_FALSE otherwise.
  */
-static bvmd_packetstream_t *dbg_commandstream_new(bvm_uint32_t eventkind) {
-
-	if (!BVMD_IS_EVENTKIND_REGISTERED(eventkind) || !bvmd_is_session_open())
-		return NULL;
+static bvm_bool_t dbg_is_eventkind_wanted(bvm_uint32_t eventkind) {
+	return (BVMD_IS_EVENTKIND_REGISTERED(eventkind) && bvmd_is_session_open());
+}
 
+/**
+ * Creates a new output stream configured as a debuggee command for #JDWP_Event and
+ * #JDWP_Event_Composite.  Only made once some eventdef has matched an event.
+ */
+static bvmd_packetstream_t *dbg_commandstream_new() {
 	return bvmd_new_commandstream(JDWP_Event, JDWP_Event_Composite);
 }
 
@@ -389,21 +395,37 @@ static bvm_bool_t dbg_are_modifiers_valid(bvmd_eventdef_t *eventdef, bvmd_eventc
 	return BVM_TRUE;
 }
 
+/**
+ * Finds the eventdefs that match a given event context, linking them by their \c nextvalid field.  Only the
+ * eventdefs of the context's eventkind are looked at - for a breakpoint, only those at the context location.
+ *
+ * @param context a given event context.
+ * @param suspendPolicy holds the highest suspend policy of the matching eventdefs.
+ * @param listcount holds the number of matching eventdefs.
+ * @param head holds the first matching eventdef.
+ *
+ * @return #BVM_TRUE if any eventdef matched, #BVM_FALSE otherwise.
+ */
 static bvm_bool_t dbg_get_filtered_eventdefs(bvmd_eventcontext_t *context, bvm_uint8_t *suspendPolicy, int *listcount, bvmd_eventdef_t **head) {
 
 	bvmd_eventdef_t *eventdef_list = NULL;
-
-	/* start searching at the eventdef list head */
-	bvmd_eventdef_t *eventdef = bvmd_gl_eventdefs;
+	bvmd_eventdef_t *eventdef;
+	bvm_bool_t is_breakpoint = (context->eventkind == JDWP_EventKind_BREAKPOINT);
+	int index = bvmd_eventkind_index(context->eventkind);
 
 	/* default hit-counter to zero */
 	*listcount = 0;
 
-	/* no eventdefs registered?  Out. */
-	if (eventdef == NULL)
+	/* not an eventkind that can be registered?  Out. */
+	if (index < 0)
 		return BVM_FALSE;
 
-	do {
+	/* start searching at the head of the list for the eventkind, or for a breakpoint, for the location */
+	eventdef = is_breakpoint ?
+			bvmd_gl_breakpoints[BVMD_BREAKPOINT_HASH(context->location.method, context->location.pc_index)] :
+			bvmd_gl_eventdefs_by_kind[index];
+
+	for (; eventdef != NULL; eventdef = is_breakpoint ? eventdef->next_at_location : eventdef->next_of_kind) {
 
 		/* the 'nextvalid' field of the eventdef type is used to link together those eventdefs that satisfy
 		 * the filters for the given context.  As we go though the eventdefs we'll NULL this field here and, when
@@ -415,36 +437,38 @@ static bvm_bool_t dbg_get_filtered_eventdefs(bvmd_eventcontext_t *context, bvm_u
 		if (!eventdef->in_use)
 			continue;
 
-		/* we only match on eventkind */
-		if (eventdef->eventkind == context->eventkind) {
+		/* breakpoints elsewhere that share the location list are passed over before their modifiers are
+		 * looked at - a count modifier counts down as it is tested */
+		if ( is_breakpoint &&
+			 ( (eventdef->breakpoint_location->method != context->location.method) ||
+			   (eventdef->breakpoint_location->pc_index != context->location.pc_index) ) )
+			continue;
 
-			/* no modifiers, or all modifiers satisfied mean 'cool - we found a matching eventdef */
-			if ((eventdef->modifier_count == 0) || dbg_are_modifiers_valid(eventdef, context)) {
+		/* no modifiers, or all modifiers satisfied mean 'cool - we found a matching eventdef */
+		if ((eventdef->modifier_count == 0) || dbg_are_modifiers_valid(eventdef, context)) {
 
-				/* inform the calling function that we have found one (by way of incrementing this
-				 * passed-in counter) */
-				(*listcount)++;
+			/* inform the calling function that we have found one (by way of incrementing this
+			 * passed-in counter) */
+			(*listcount)++;
 
-				/* keep the highest suspend policy we come across for matching eventdefs.  Multiple matching
-				 * eventdefs may have different suspend policies - we go for the top */
-				if (eventdef->suspend_policy > *suspendPolicy) {
-					*suspendPolicy = eventdef->suspend_policy;
-				}
+			/* keep the highest suspend policy we come across for matching eventdefs.  Multiple matching
+			 * eventdefs may have different suspend policies - we go for the top */
+			if (eventdef->suspend_policy > *suspendPolicy) {
+				*suspendPolicy = eventdef->suspend_policy;
+			}
 
-				/* link this eventdefs into the list of found eventdefs. */
-				if (eventdef_list == NULL) {
-					/* first eventdef in chain */
-					*head = eventdef;
-					eventdef_list = eventdef;
-				} else {
-					/* not the first in the chain */
-					eventdef_list->nextvalid = eventdef;
-					eventdef_list = eventdef;
-				}
+			/* link this eventdefs into the list of found eventdefs. */
+			if (eventdef_list == NULL) {
+				/* first eventdef in chain */
+				*head = eventdef;
+				eventdef_list = eventdef;
+			} else {
+				/* not the first in the chain */
+				eventdef_list->nextvalid = eventdef;
+				eventdef_list = eventdef;
 			}
 		}
-
-	} while ((eventdef = eventdef->next));
+	}
 
 	return (eventdef_list != NULL);
 }
@@ -464,44 +488,24 @@ static void dbg_do_suspend(bvm_uint8_t policy, bvm_vmthread_t *vmthread) {
 }
 
 bvm_bool_t bvmd_breakpoint_opcode_for_location(bvmd_location_t *location, bvm_uint8_t *opcode) {
-	bvmd_eventdef_t *eventdef = bvmd_gl_eventdefs;
-
-	if (eventdef == NULL)
-		return BVM_FALSE;
-
-	do {
-
-		/* note that we are searching also for event eventdefs that are in_use = false.  Why?  If a breakpoint
-		 * has a counter, we mark it as not in use when the counter is reached - but we still want to
-		 * find it. */
-
-		/* we only match on breakpoint eventkind */
-		if (eventdef->eventkind == JDWP_EventKind_BREAKPOINT) {
-
-			/* ... now, get the locationonly modifier from the breakpoint */
-
-			int i = eventdef->modifier_count;
-
-			/* for each eventdef modifier */
-			while (i--) {
 
-				bvmd_event_modifier_t *modifier = &(eventdef->modifiers[i]);
+	/* only the breakpoints that hash to the same location are looked at */
+	bvmd_eventdef_t *eventdef = bvmd_gl_breakpoints[BVMD_BREAKPOINT_HASH(location->method, location->pc_index)];
 
-				if (modifier->modkind == JDWP_EventRequest_Set_Out_modifiers_Modifier_LocationOnly) {
+	/* note that we are searching also for event eventdefs that are in_use = false.  Why?  If a breakpoint
+	 * has a counter, we mark it as not in use when the counter is reached - but we still want to
+	 * find it. */
+	for (; eventdef != NULL; eventdef = eventdef->next_at_location) {
 
-					if ( (location->clazz == modifier->u.locationonly.clazz) &&
-						 (location->method == modifier->u.locationonly.method) &&
-						 (location->pc_index == modifier->u.locationonly.pc_index) ) {
+		if ( (location->clazz == eventdef->breakpoint_location->clazz) &&
+			 (location->method == eventdef->breakpoint_location->method) &&
+			 (location->pc_index == eventdef->breakpoint_location->pc_index) ) {
 
-						*opcode = eventdef->breakpoint_opcode;
+			*opcode = eventdef->breakpoint_opcode;
 
-						return BVM_TRUE;
-					}
-				}
-			}
+			return BVM_TRUE;
 		}
-
-	} while ((eventdef = eventdef->next));
+	}
 
 	return BVM_FALSE;
 }
@@ -515,7 +519,7 @@ void bvmd_event_Breakpoint(bvmd_location_t *location) {
 	bvm_uint8_t suspendpolicy = JDWP_SuspendPolicy_NONE;
 	bvmd_eventcontext_t context;
 
-	if ((out = dbg_commandstream_new(BVMD_EventKind_BREAKPOINT)) == NULL) return;
+	if (!dbg_is_eventkind_wanted(BVMD_EventKind_BREAKPOINT)) return;
 
 	memset(&context, 0, sizeof(context));
 	context.vmthread = bvm_gl_thread_current;
@@ -524,6 +528,8 @@ void bvmd_event_Breakpoint(bvmd_location_t *location) {
 
 	if (dbg_get_filtered_eventdefs(&context, &suspendpolicy, &listcount, &eventdef)) {
 
+		out = dbg_commandstream_new();
+
 		bvmd_out_writebyte(out, suspendpolicy);
 		bvmd_out_writeint32(out, listcount);
 
@@ -549,11 +555,13 @@ void bvmd_event_Exception(bvmd_eventcontext_t *context) {
 	int listcount = 0;
 	bvm_uint8_t suspendpolicy = JDWP_SuspendPolicy_NONE;
 
-	if ((out = dbg_commandstream_new(BVMD_EventKind_EXCEPTION)) == NULL)
+	if (!dbg_is_eventkind_wanted(BVMD_EventKind_EXCEPTION))
 		return;
 
 	if (dbg_get_filtered_eventdefs(context, &suspendpolicy, &listcount, &eventdef)) {
 
+		out = dbg_commandstream_new();
+
 		bvmd_out_writebyte(out, suspendpolicy);
 		bvmd_out_writeint32(out, listcount);
 
@@ -586,11 +594,13 @@ void bvmd_event_Thread(bvmd_eventcontext_t *context) {
 
 	dbgeventkind = (context->eventkind == JDWP_EventKind_THREAD_START) ? BVMD_EventKind_THREAD_START : BVMD_EventKind_THREAD_DEATH;
 
-	if ((out = dbg_commandstream_new(dbgeventkind)) == NULL)
+	if (!dbg_is_eventkind_wanted(dbgeventkind))
 		return;
 
 	if (dbg_get_filtered_eventdefs(context, &suspendpolicy, &listcount, &eventdef)) {
 
+		out = dbg_commandstream_new();
+
 		bvmd_out_writebyte(out, suspendpolicy);
 		bvmd_out_writeint32(out, listcount);
 
@@ -619,11 +629,13 @@ void bvmd_event_ClassPrepare(bvmd_eventcontext_t *context) {
 	if (BVM_CLAZZ_IsPrimitiveClazz(clazz) || (clazz->state < BVM_CLAZZ_STATE_LOADED))
 		return;
 
-	if ((out = dbg_commandstream_new(BVMD_EventKind_CLASS_PREPARE)) == NULL)
+	if (!dbg_is_eventkind_wanted(BVMD_EventKind_CLASS_PREPARE))
 		return;
 
 	if (dbg_get_filtered_eventdefs(context, &suspendpolicy, &listcount, &eventdef)) {
 
+		out = dbg_commandstream_new();
+
 		bvmd_out_writebyte(out, suspendpolicy);
 		bvmd_out_writeint32(out, listcount);
 
@@ -766,11 +778,13 @@ static void dbg_event_ClassUnload(bvmd_eventcontext_t *context) {
 
 	if 	(context->location.clazz->state < BVM_CLAZZ_STATE_LOADED) return;
 
-	if ((out = dbg_commandstream_new(BVMD_EventKind_CLASS_UNLOAD)) == NULL)
+	if (!dbg_is_eventkind_wanted(BVMD_EventKind_CLASS_UNLOAD))
 		return;
 
 	if (dbg_get_filtered_eventdefs(context, &suspendpolicy, &listcount, &eventdef)) {
 
+		out = dbg_commandstream_new();
+
 		bvmd_out_writebyte(out, suspendpolicy);
 		bvmd_out_writeint32(out, listcount);
 
@@ -32,7 +32,9 @@
   added and removed from both.
 
   The garbage collector removes addresses from here as it returns memory to the heap - hence the
-  lookup by address.
+  lookup by address.  With #BVM_DEBUGGER_ID_MAP_RESIZE_ENABLE the collector instead removes all of the unreachable
+  addresses in a single pass (see #bvmd_id_remove_if) before it sweeps, and the maps double their bucket counts
+  as they fill.
 
   This addr/ID mapping is only actually valid when a debug session is active.  The session startup creates
   the map, and the session shutdown frees it up.
@@ -44,11 +46,39 @@
 
 #if BVM_DEBUGGER_ENABLE
 
+#if BVM_DEBUGGER_ID_MAP_RESIZE_ENABLE
+
+/**
+ * Initial number of buckets in each array.  Must be a power of two.
+ */
+#define DBG_IDMAP_INITIAL_SIZE 64
+
+/**
+ * The map grows when it holds more than this many entries per bucket.
+ */
+#define DBG_IDMAP_LOAD_FACTOR 2
+
+/* the current number of buckets in each array, and the number of entries in the maps */
+static BVM_VM_LOCAL bvm_uint32_t dbg_idmap_size;
+static BVM_VM_LOCAL bvm_uint32_t dbg_idmap_count;
+
+#define DBG_IDMAP_BUCKETS dbg_idmap_size
+#define DBG_ID_HASH(id) ( (bvm_uint32_t) (id) & (dbg_idmap_size - 1))
+#define DBG_ADDR_HASH(addr) dbg_addr_hash(addr, dbg_idmap_size)
+
+#else
+
 /**
  * Number of buckets in each array.
  */
 #define DBG_IDMAP_SIZE 250
 
+#define DBG_IDMAP_BUCKETS DBG_IDMAP_SIZE
+#define DBG_ID_HASH(id) calc_hash(id)
+#define DBG_ADDR_HASH(addr) calc_hash_for_ptr(addr, DBG_IDMAP_SIZE)
+
+#endif
+
 /**
  * Struct to hold ID/address pairs in the each array.
  */
@@ -62,12 +92,12 @@ typedef struct _dbgidstruct {
 /**
  * An array of #dbg_id_t pointers for use as the ID map.
  */
-dbg_id_t **dbg_id_map;
+BVM_VM_LOCAL dbg_id_t **dbg_id_map;
 
 /**
  * An array of #dbg_id_t pointers for use as the address map.
  */
-dbg_id_t **dbg_addr_map;
+BVM_VM_LOCAL dbg_id_t **dbg_addr_map;
 
 /**
  * Calculates a hash of the address to find the right bucket.
@@ -76,10 +106,28 @@ bvm_uint32_t calc_hash_for_ptr(void* addr, int bucket_count) {
     return (bvm_uint32_t) (*(bvm_native_ulong_t *) addr) % (bucket_count-1);
 }
 
+#if BVM_DEBUGGER_ID_MAP_RESIZE_ENABLE
+
+/**
+ * Calculates a hash of the address value itself to find the right bucket.  Heap addresses are at least 8 byte
+ * aligned, so the low bits carry nothing.
+ *
+ * @param addr a given address
+ * @param bucket_count the number of buckets - a power of two.
+ */
+static bvm_uint32_t dbg_addr_hash(void *addr, bvm_uint32_t bucket_count) {
+	bvm_native_ulong_t x = (bvm_native_ulong_t) addr >> 3;
+	return (bvm_uint32_t) (x ^ (x >> 11)) & (bucket_count - 1);
+}
+
+#else
+
 static bvm_uint32_t calc_hash(bvm_uint32_t x) {
     return ( ( (bvm_uint32_t) x) % (DBG_IDMAP_SIZE-1));
 }
 
+#endif
+
 /**
  * Retrieves the ID of a given address, or zero if the address is not registered.
  *
@@ -89,7 +137,7 @@ static bvm_uint32_t calc_hash(bvm_uint32_t x) {
  */
 bvm_int32_t bvmd_id_get_by_address(void *addr) {
 
-    bvm_uint32_t hash = calc_hash_for_ptr(addr, DBG_IDMAP_SIZE);
+    bvm_uint32_t hash = DBG_ADDR_HASH(addr);
 
 	dbg_id_t *dbg_id = dbg_addr_map[hash];
 
@@ -114,7 +162,7 @@ bvm_int32_t bvmd_id_get_by_address(void *addr) {
  */
 void *bvmd_id_get_by_id(bvm_int32_t id) {
 
-	bvm_uint32_t hash = calc_hash(id);
+	bvm_uint32_t hash = DBG_ID_HASH(id);
 
 	dbg_id_t *dbg_id = dbg_id_map[hash];
 
@@ -133,7 +181,14 @@ void *bvmd_id_get_by_id(bvm_int32_t id) {
  */
 void bvmd_id_init() {
 
-	size_t size = DBG_IDMAP_SIZE * sizeof(dbg_id_t*);
+	size_t size;
+
+#if BVM_DEBUGGER_ID_MAP_RESIZE_ENABLE
+	dbg_idmap_size = DBG_IDMAP_INITIAL_SIZE;
+	dbg_idmap_count = 0;
+#endif
+
+	size = DBG_IDMAP_BUCKETS * sizeof(dbg_id_t*);
 
 	dbg_id_map = bvm_heap_calloc(size, BVM_ALLOC_TYPE_STATIC);
 	dbg_addr_map = bvm_heap_calloc(size, BVM_ALLOC_TYPE_STATIC);
@@ -144,7 +199,7 @@ void bvmd_id_init() {
  */
 void bvmd_id_free() {
 
-	bvm_uint32_t i = DBG_IDMAP_SIZE;
+	bvm_uint32_t i = DBG_IDMAP_BUCKETS;
 
 	while (i--) {
 
@@ -177,7 +232,7 @@ void bvmd_id_free() {
  */
 static dbg_id_t *remove_from_addrmap(void *addr) {
 
-    bvm_uint32_t hash = calc_hash_for_ptr(addr, DBG_IDMAP_SIZE);
+    bvm_uint32_t hash = DBG_ADDR_HASH(addr);
 
 	dbg_id_t *dbg_id, *prev_dbg_id;
 
@@ -216,7 +271,7 @@ static dbg_id_t *remove_from_addrmap(void *addr) {
  */
 static dbg_id_t *remove_from_idmap(bvm_int32_t id) {
 
-	bvm_uint32_t hash = calc_hash(id);
+	bvm_uint32_t hash = DBG_ID_HASH(id);
 
 	dbg_id_t *dbg_id, *prev_dbg_id;
 
@@ -255,6 +310,9 @@ void bvmd_id_remove_addr(void *addr) {
 	if (dbg_id != NULL) {
 		remove_from_idmap(dbg_id->id);
 		bvm_heap_free(dbg_id);
+#if BVM_DEBUGGER_ID_MAP_RESIZE_ENABLE
+		dbg_idmap_count--;
+#endif
 	}
 }
 
@@ -268,6 +326,9 @@ void bvmd_id_remove_id(bvm_int32_t id) {
 	if (dbg_id != NULL) {
 		remove_from_addrmap(dbg_id->addr);
 		bvm_heap_free(dbg_id);
+#if BVM_DEBUGGER_ID_MAP_RESIZE_ENABLE
+		dbg_idmap_count--;
+#endif
 	}
 }
 
@@ -279,8 +340,8 @@ void bvmd_id_remove_id(bvm_int32_t id) {
  */
 static void add_to_maps(dbg_id_t *dbg_id) {
 
-    bvm_uint32_t idhash = calc_hash(dbg_id->id);
-    bvm_uint32_t addrhash = calc_hash_for_ptr(dbg_id->addr, DBG_IDMAP_SIZE);
+    bvm_uint32_t idhash = DBG_ID_HASH(dbg_id->id);
+    bvm_uint32_t addrhash = DBG_ADDR_HASH(dbg_id->addr);
 
 	dbg_id->next_id = dbg_id_map[idhash];
 	dbg_id_map[idhash] = dbg_id;
@@ -289,6 +350,72 @@ static void add_to_maps(dbg_id_t *dbg_id) {
 	dbg_addr_map[addrhash] = dbg_id;
 }
 
+#if BVM_DEBUGGER_ID_MAP_RESIZE_ENABLE
+
+/**
+ * Doubles the number of buckets in both maps and rehashes every entry into them.
+ */
+static void dbg_idmap_grow() {
+
+	dbg_id_t **old_id_map = dbg_id_map;
+	bvm_uint32_t i = dbg_idmap_size;
+	size_t size = 2 * dbg_idmap_size * sizeof(dbg_id_t*);
+
+	/* allocate both before touching the maps - a GC during the allocation may remove from them */
+	dbg_id_t **id_map = bvm_heap_calloc(size, BVM_ALLOC_TYPE_STATIC);
+	dbg_id_t **addr_map = bvm_heap_calloc(size, BVM_ALLOC_TYPE_STATIC);
+
+	bvm_heap_free(dbg_addr_map);
+
+	dbg_id_map = id_map;
+	dbg_addr_map = addr_map;
+	dbg_idmap_size *= 2;
+
+	/* every entry is in the old id map exactly once */
+	while (i--) {
+		dbg_id_t *dbg_id = old_id_map[i];
+		while (dbg_id != NULL) {
+			dbg_id_t *next = dbg_id->next_id;
+			add_to_maps(dbg_id);
+			dbg_id = next;
+		}
+	}
+
+	bvm_heap_free(old_id_map);
+}
+
+/**
+ * Removes every address (and its ID) for which the given function reports #BVM_TRUE.  Used by the garbage
+ * collector to drop the IDs of all the objects it is about to free in one pass.
+ *
+ * @param is_removed a function reporting whether a given address is to be removed.
+ */
+void bvmd_id_remove_if(bvm_bool_t (*is_removed)(void *addr)) {
+
+	bvm_uint32_t i = dbg_idmap_size;
+
+	while (i--) {
+
+		dbg_id_t **link = &dbg_id_map[i];
+
+		while (*link != NULL) {
+
+			dbg_id_t *dbg_id = *link;
+
+			if (is_removed(dbg_id->addr)) {
+				*link = dbg_id->next_id;
+				remove_from_addrmap(dbg_id->addr);
+				bvm_heap_free(dbg_id);
+				dbg_idmap_count--;
+			} else {
+				link = &dbg_id->next_id;
+			}
+		}
+	}
+}
+
+#endif
+
 /**
  * Puts a given address into the ID map and returns its associated ID.  If the address is already
  * registered, its existing ID is returned.
@@ -316,6 +443,10 @@ bvm_int32_t bvmd_id_put(void *addr) {
 	/* put the new dbg_id into both the id and addr maps. */
 	add_to_maps(dbg_id);
 
+#if BVM_DEBUGGER_ID_MAP_RESIZE_ENABLE
+	if (++dbg_idmap_count > dbg_idmap_size * DBG_IDMAP_LOAD_FACTOR) dbg_idmap_grow();
+#endif
+
 	return dbg_id->id;
 }
 
@@ -222,6 +222,7 @@ void bvmd_in_readutfstring(bvmd_instream_t *in, bvm_utfstring_t *utfstring) {
 	bvm_int32_t length = bvmd_in_readint32(in);
 
 	utfstring->length = length;
+	utfstring->hash = 0;
 	utfstring->data = bvm_heap_alloc(length+1, BVM_ALLOC_TYPE_STATIC);
 
     bvmd_in_readbytes(in, utfstring->data, utfstring->length);
@@ -41,6 +41,15 @@ static void extend_outstream(bvmd_outstream_t *out) {
 	/* get the current segment (if any) */
 	bvmd_packetdata_t *current_segment = out->segment;
 
+#if BVM_DEBUGGER_BATCHED_IO_ENABLE
+	/* create a new packetdata twice the size of the current one, up to the maximum segment size */
+	bvmd_packetdata_t *packetdata = bvmd_new_packetdata( (current_segment == NULL) ? BVM_DEBUGGER_PACKETDATA_SIZE :
+			BVM_MIN(current_segment->capacity * 2, BVM_DEBUGGER_PACKETDATA_MAX_SIZE));
+
+	out->segment = packetdata;
+	out->index = 0;
+	out->left = packetdata->capacity;
+#else
 	/* create a new packetdata */
 	bvmd_packetdata_t *packetdata = bvm_heap_calloc(sizeof(bvmd_packetdata_t), BVM_ALLOC_TYPE_STATIC);
 	packetdata->length = 0;
@@ -48,6 +57,7 @@ static void extend_outstream(bvmd_outstream_t *out) {
 	out->segment = packetdata;
 	out->index = 0;
 	out->left = BVM_DEBUGGER_PACKETDATA_SIZE;
+#endif
 
 	/* if there is an exiting one, make its 'next' point to the new one, otherwise make it
 	 * the start of the list*/
@@ -30,10 +30,10 @@
 
 #if BVM_DEBUGGER_ENABLE
 
-static int bvmd_debugger_socket = -1;
-static int bvmd_server_socket = -1;
+static BVM_VM_LOCAL int bvmd_debugger_socket = -1;
+static BVM_VM_LOCAL int bvmd_server_socket = -1;
 
-char *last_error = NULL;
+BVM_VM_LOCAL char *last_error = NULL;
 
 #if BVM_CONSOLE_ENABLE
 static char *HANDSHAKE_READ_ERROR="Unable to read JDWP handshake";
@@ -136,9 +136,21 @@ static bvmd_transport_error_t dbg_socket_writebytes(const void *src, size_t size
 	if (!dbg_sockets_is_open())
 		return dbg_socket_transport_error(BVMD_TRANSPORT_ERROR_ILLEGAL_STATE, NULL, BVM_FALSE);
 
+#if BVM_DEBUGGER_BATCHED_IO_ENABLE
+	/* packets arrive here in large batches - keep sending until it all has gone */
+	while (size > 0) {
+		if ( (nbytes = bvm_pd_socket_write(bvmd_debugger_socket, src, size)) <= 0)
+			return dbg_socket_transport_error(BVMD_TRANSPORT_ERROR_IO_ERROR, NULL, BVM_TRUE);
+		src = (const char *) src + nbytes;
+		size -= nbytes;
+	}
+
+	return BVMD_TRANSPORT_ERROR_NONE;
+#else
 	nbytes = bvm_pd_socket_write(bvmd_debugger_socket, src, size);
 
 	return (nbytes < size) ? dbg_socket_transport_error(BVMD_TRANSPORT_ERROR_IO_ERROR, NULL, BVM_TRUE) : BVMD_TRANSPORT_ERROR_NONE;
+#endif
 }
 
 /**
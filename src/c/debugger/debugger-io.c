@@ -33,22 +33,22 @@
 /**
  * Global interface to debug transport.
  */
-bvmd_transport_t bvmd_gl_transport;
+BVM_VM_LOCAL bvmd_transport_t bvmd_gl_transport;
 
 /**
  * Global debug transport capabilities.
  */
-bvmd_transport_capabilities_t bvmd_gl_transport_capabilities;
+BVM_VM_LOCAL bvmd_transport_capabilities_t bvmd_gl_transport_capabilities;
 
 /**
  * Flag to report is the VM is in server mode and is actually listening.
  */
-bvm_bool_t dbg_server_is_listening = BVM_FALSE;
+BVM_VM_LOCAL bvm_bool_t dbg_server_is_listening = BVM_FALSE;
 
 /**
  * Flag to report is a debug session is currently open
  */
-bvm_bool_t is_session_open = BVM_FALSE;
+BVM_VM_LOCAL bvm_bool_t is_session_open = BVM_FALSE;
 
 /**
  * Reports if a given packet is a reply packet.
@@ -80,6 +80,53 @@ static bvmd_transport_error_t dbg_read_packet(bvmd_packet_t *packet) {
 	bvm_int32_t i;
 	bvmd_transport_error_t error;
 
+#if BVM_DEBUGGER_BATCHED_IO_ENABLE
+
+	/* the 11 byte packet header is read in one go - command and reply headers are the same size */
+	bvm_uint8_t header[11];
+	bvm_int32_t nleft;
+
+	if ( (error = bvmd_gl_transport.read_bytes(header, sizeof(header)))) {
+		return error;
+	}
+
+	/* length and id, endian-safe */
+	memcpy(&i, &header[0], sizeof(i));
+	packet->type.cmd.length = bvm_htonl(i);
+	memcpy(&i, &header[4], sizeof(i));
+	packet->type.cmd.id = bvm_htonl(i);
+
+	packet->type.cmd.flags = header[8];
+
+	/* if it is a reply, get the error code, otherwise get the command set and command */
+	if (packet->type.cmd.flags & BVMD_TRANSPORT_FLAGS_REPLY) {
+		bvm_int16_t s;
+		memcpy(&s, &header[9], sizeof(s));
+		packet->type.reply.error_code = bvm_htons(s);
+	} else {
+		packet->type.cmd.cmdset = header[9];
+		packet->type.cmd.cmd = header[10];
+	}
+
+	/* the data portion of the packet (if any) is read as one segment */
+	nleft = packet->type.cmd.length - 11;
+
+	if (nleft > 0) {
+
+		bvmd_packetdata_t *packetdata = bvmd_new_packetdata(nleft);
+
+		packet->type.cmd.packetdata = packetdata;
+		packetdata->length = nleft;
+
+		if ( (error = bvmd_gl_transport.read_bytes(packetdata->bytes, nleft))) {
+			return error;
+		}
+	}
+
+	return BVMD_TRANSPORT_ERROR_NONE;
+
+#else
+
 	/* read the length of the packet and copy it as endian-safe to the packet */
 	if ( (error = bvmd_gl_transport.read_bytes(&i, sizeof(i)))) {
 		return error;
@@ -167,8 +214,60 @@ static bvmd_transport_error_t dbg_read_packet(bvmd_packet_t *packet) {
 	}
 
 	return BVMD_TRANSPORT_ERROR_NONE;
+#endif
+}
+
+#if BVM_DEBUGGER_BATCHED_IO_ENABLE
+
+/* packets are assembled here before being written to the transport */
+static BVM_VM_LOCAL bvm_uint8_t dbg_write_buffer[BVM_DEBUGGER_WRITE_BUFFER_SIZE];
+static BVM_VM_LOCAL size_t dbg_write_buffer_length;
+
+/**
+ * Writes any bytes in the packet write buffer to the debug transport interface and empties it.
+ *
+ * @return BVMD_TRANSPORT_ERROR_NONE if all okay, or otherwise any error from the debug interface byte
+ * writing function.
+ */
+static bvmd_transport_error_t dbg_write_flush() {
+
+	size_t length = dbg_write_buffer_length;
+
+	dbg_write_buffer_length = 0;
+
+	return (length > 0) ? bvmd_gl_transport.write_bytes(dbg_write_buffer, length) : BVMD_TRANSPORT_ERROR_NONE;
 }
 
+/**
+ * Adds bytes to the packet write buffer, writing the buffer to the debug transport interface when it fills.
+ * Data too large for the buffer is written directly after the buffer is flushed.
+ *
+ * @param src the bytes to write
+ * @param size the number of bytes to write
+ *
+ * @return BVMD_TRANSPORT_ERROR_NONE if all okay, or otherwise any error from the debug interface byte
+ * writing function.
+ */
+static bvmd_transport_error_t dbg_write_buffered(const void *src, size_t size) {
+
+	bvmd_transport_error_t error;
+
+	if (dbg_write_buffer_length + size > BVM_DEBUGGER_WRITE_BUFFER_SIZE) {
+
+		if ( (error = dbg_write_flush())) return error;
+
+		if (size > BVM_DEBUGGER_WRITE_BUFFER_SIZE)
+			return bvmd_gl_transport.write_bytes(src, size);
+	}
+
+	memcpy(&dbg_write_buffer[dbg_write_buffer_length], src, size);
+	dbg_write_buffer_length += size;
+
+	return BVMD_TRANSPORT_ERROR_NONE;
+}
+
+#endif
+
 /**
  * Write a given packet to the debug transport interface.
  *
@@ -181,6 +280,40 @@ static bvmd_transport_error_t dbg_write_packet(const bvmd_packet_t* packet){
 
 	bvmd_transport_error_t error;
 	bvm_int32_t i;
+
+#if BVM_DEBUGGER_BATCHED_IO_ENABLE
+
+	/* the 11 byte packet header, then the packet data, through the write buffer */
+	bvm_uint8_t header[11];
+	bvmd_packetdata_t *packetdata = packet->type.reply.packetdata;
+
+	i = bvm_ntohl(packet->type.reply.length);
+	memcpy(&header[0], &i, sizeof(i));
+	i = bvm_ntohl(packet->type.reply.id);
+	memcpy(&header[4], &i, sizeof(i));
+
+	header[8] = packet->type.reply.flags;
+
+	if (dbg_is_reply_packet(packet)) {
+		bvm_int16_t reply_err = bvm_ntohs(packet->type.reply.error_code);
+		memcpy(&header[9], &reply_err, sizeof(reply_err));
+	} else {
+		header[9] = packet->type.cmd.cmdset;
+		header[10] = packet->type.cmd.cmd;
+	}
+
+	dbg_write_buffer_length = 0;
+
+	if ( (error = dbg_write_buffered(header, sizeof(header)))) return error;
+
+	while (packetdata != NULL) {
+		if ( (error = dbg_write_buffered(packetdata->bytes, packetdata->length))) return error;
+		packetdata = packetdata->next;
+	}
+
+	return dbg_write_flush();
+
+#else
 	bvm_uint8_t b;
 
 	/* write out length after converting it to network order */
@@ -220,6 +353,7 @@ static bvmd_transport_error_t dbg_write_packet(const bvmd_packet_t* packet){
 	}
 
 	return BVMD_TRANSPORT_ERROR_NONE;
+#endif
 }
 
 /**
@@ -250,6 +384,32 @@ bvmd_packetstream_t *bvmd_new_commandstream(int cmdset, int cmd) {
 	return stream;
 }
 
+#if BVM_DEBUGGER_BATCHED_IO_ENABLE
+
+/**
+ * Creates a new, empty packetdata segment able to hold the given number of bytes.  A segment always holds at
+ * least #BVM_DEBUGGER_PACKETDATA_SIZE bytes.
+ *
+ * @param capacity the number of bytes the segment is to hold.
+ *
+ * @return a new packetdata
+ */
+bvmd_packetdata_t *bvmd_new_packetdata(bvm_int32_t capacity) {
+
+	bvmd_packetdata_t *packetdata;
+
+	if (capacity < BVM_DEBUGGER_PACKETDATA_SIZE) capacity = BVM_DEBUGGER_PACKETDATA_SIZE;
+
+	/* the bytes array at the end of the struct is extended past its declared size */
+	packetdata = bvm_heap_calloc(sizeof(bvmd_packetdata_t) - BVM_DEBUGGER_PACKETDATA_SIZE + capacity,
+								 BVM_ALLOC_TYPE_STATIC);
+	packetdata->capacity = capacity;
+
+	return packetdata;
+}
+
+#endif
+
 /**
  * Frees a packetstream and also frees all associated packet and packetdata memory back to the heap as well.
  *
@@ -557,6 +717,9 @@ void bvmd_session_open() {
 
 	} BVM_END_TRANSIENT_BLOCK
 
+	/* locks taken before now may be thin - the debugger only knows of monitors */
+	bvmd_thread_inflate_thin_locks();
+
 	is_session_open = BVM_TRUE;
 }
 
@@ -42,7 +42,7 @@
 /**
  * An array of #bvmd_root_t pointers.  This is the map buckets.
  */
-bvmd_root_t **bvmd_root_map = NULL;
+BVM_VM_LOCAL bvmd_root_t **bvmd_root_map = NULL;
 
 /**
  * Create the #bvmd_root_map map with #BVMD_ROOTMAP_SIZE buckets.
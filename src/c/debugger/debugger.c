@@ -616,48 +616,48 @@
  * Enable debug at startup.  This variable is only inspected as the VM start to see if debug should be
  * enabled, and during shutdown to see if cleanup should be done.  Can be set with command line option -Xdebug.
  */
-bvm_bool_t bvmd_gl_enabledebug = BVM_FALSE;
+BVM_VM_LOCAL bvm_bool_t bvmd_gl_enabledebug = BVM_FALSE;
 
 /**
  * Specifies whether the VM is in debug server mode (which means it listens for a connection from a debugger).
  * Set using the server=y/n setting on the \c Xrunjdwp command line option.
  */
-bvm_bool_t bvmd_gl_server = BVM_FALSE;
+BVM_VM_LOCAL bvm_bool_t bvmd_gl_server = BVM_FALSE;
 
 /**
  * Flag to determine if the VM suspends all thread on startup pending connection with a debugger.
  * Can be set on command line as the suspend=y/n setting of the \c Xrunjdwp option.  Only valid
  * if \c server=y setting on the \c Xrunjdwp option.
  */
-bvm_bool_t bvmd_gl_suspendonstart = BVM_FALSE;
+BVM_VM_LOCAL bvm_bool_t bvmd_gl_suspendonstart = BVM_FALSE;
 
 /**
  * Flag telling whether all threads are currently in a suspended state.  Not for use by developers.  As a
  * thread is suspended or terminated or resumed this flag is reset.
  */
-bvm_bool_t bvmd_gl_all_suspended = BVM_FALSE;
+BVM_VM_LOCAL bvm_bool_t bvmd_gl_all_suspended = BVM_FALSE;
 
 /**
  * Default timeout for connections to/from debugger.  Can be set with command line -dbg_timeout.  Defaults to
  * compile-time variable #BVM_DEBUGGER_TIMEOUT.
  */
-bvm_uint32_t bvmd_gl_timeout = BVM_DEBUGGER_TIMEOUT;
+BVM_VM_LOCAL bvm_uint32_t bvmd_gl_timeout = BVM_DEBUGGER_TIMEOUT;
 
 /**
  * Flag indicating whether the debugger has requested suspension of all events from the VM to the debugger.  The
  * VM considers this as a 'suspension' and cause the entire VM to suspend waiting for the debugger to
  * resume event sending again.
  */
-bvm_bool_t bvmd_gl_holdevents = BVM_FALSE;
+BVM_VM_LOCAL bvm_bool_t bvmd_gl_holdevents = BVM_FALSE;
 
 /**
  * The address a debugger transport (#bvmd_transport_t) will use to connect or listen.  Can be set using command
  * line \c -Xrunjdwp as the 'address'.  The address may mean different things depending on whether the VM is attaching
  * to the debugger, or listening for a connection.
  */
-char *bvmd_gl_address = NULL;
+BVM_VM_LOCAL char *bvmd_gl_address = NULL;
 
-bvm_string_obj_t *bvmd_nosupp_tostring_obj = NULL;
+BVM_VM_LOCAL bvm_string_obj_t *bvmd_nosupp_tostring_obj = NULL;
 
 /**
  * Provides an ID to identify objects and packets.  Counting starts at 1.
@@ -666,7 +666,7 @@ bvm_string_obj_t *bvmd_nosupp_tostring_obj = NULL;
  */
 int bvmd_nextid() {
 
-	static int counter = 1;
+	static BVM_VM_LOCAL int counter = 1;
 
 	return counter++;
 }
@@ -59,6 +59,11 @@
  * passes to the same code (in \c OPCODE_athrow) that handles normal bytecode exceptions - but after handling
  * the native exception, control passes to above the \c BVM_TRY to reenter it.
  *
+ * With #BVM_EXEC_FAST_THROW_ENABLE, the runtime exceptions the interpreter raises itself (\c NullPointerException,
+ * \c ArithmeticException and so on) are not thrown natively at all.  \c EXEC_THROW creates the exception and goes
+ * directly to the \c athrow handling with it - as if the bytecode had thrown it - so no \c longjmp is done and the
+ * \c BVM_TRY need not be re-entered.  Exceptions raised from deeper within the VM are still thrown natively.
+ *
  * The VM supports the Java 5 \c uncaughtExceptionHandler mechanism for threads.  Control will be passed to a
  * thread's default exception handler if an exception is not caught for that thread.
  *
@@ -75,6 +80,17 @@
  * Nothing is pushed onto the stack for the OPCODE_pop_to_exception to work with.  All the info about an exception and its
  * handler locations is held in the current thread in the #bvm_find_exception_callback_data \c exception_location struct.
  *
+ * @section exec-call Calls From Native Code
+ *
+ * With #BVM_NI_CALLS_ENABLE a native method may call a Java method with #bvm_exec_call (as the NI \c NI_CallTYPEMethod
+ * functions do).  A callback wedge frame is pushed above the native's frame, the called method is pushed above that, and
+ * #bvm_exec_run is entered again from 'C'.  When the method returns to the wedge, or an exception reaches it (the
+ * search for a handler stops at the wedge of a call), the wedge callback makes the nested #bvm_exec_run return to
+ * #bvm_exec_call, which pops the wedge and hands back the result or the exception.
+ *
+ * Other threads are scheduled by the nested loop as normal while the call runs.  As each nested loop must return to
+ * the 'C' code that entered it, only one thread at a time may be making calls - although they may be nested.
+ *
  * @section exec-fastbytecode Fast Bytecode Substitution
  *
  * Some non-Java (Babe VM specific) opcodes have been used to help speed up some things.  These new opcode names end
@@ -92,8 +108,55 @@
  * does not mean that every (say) opcode \c OPCODE_getfield will now use \c OPCODE_getfield_fast.  The opcode
  * substitution is only performed to a particular opcode in a particular method in a particular class.
  *
- * Fast bytecode substitution is disabled if the #BVM_DEBUGGER_ENABLE compile-time option is enabled.  During
- * debugging, the OPCODE_BREAKPOINT bytecode substitution takes place to facilitate debugger breakpoints.
+ * Fast bytecode substitution is also used when the #BVM_DEBUGGER_ENABLE compile-time option is enabled, so a debuggable
+ * VM runs as fast as any other when no debugger is attached.  During debugging, the OPCODE_BREAKPOINT bytecode
+ * substitution takes place to facilitate debugger breakpoints.  A breakpoint on a fast opcode simply displaces the
+ * fast opcode, and a location is never quickened while a breakpoint is set there.  Where the debugger needs to show
+ * the bytecode it maps fast opcodes back to the originals with #bvm_exec_unquickened_opcode.
+ *
+ * @section exec-superinstructions Superinstructions
+ *
+ * Some short bytecode sequences are very common - \c aload_0 then \c getfield to read a field of \c this, two
+ * \c iload then an \c if_icmp<cond> to test a loop counter, \c aload then \c arraylength.  With
+ * #BVM_EXEC_SUPERINSTRUCTIONS these are found as each method is loaded (see #bvm_exec_fuse_superinstructions) and the
+ * first opcode of each is replaced by a superinstruction opcode that does the whole sequence in one dispatch.  The later
+ * instructions are left as they are, and each time it runs the superinstruction checks they are still what it expects
+ * (a \c getfield must have become \c getfield_fast, and none may be a breakpoint).  If not it does only its first
+ * instruction and the rest are dispatched as normal.
+ *
+ * @section exec-inlinecache Inline Caches
+ *
+ * An \c invokevirtual or \c invokeinterface whose receiver is not of the resolved method's clazz must search the
+ * receiver's clazz hierarchy for the method to invoke.  With #BVM_EXEC_INLINE_CACHE_ENABLE each such call site caches
+ * the receiver clazzes it has seen and the methods found for them, so the search is done only once per receiver
+ * clazz per call site.  Most call sites only ever see one receiver clazz, so a hit is usually a single compare.  The
+ * caches are kept in a side table keyed by the address of the call site's opcode rather than in the bytecode itself, so
+ * they work whether fast bytecode substitution is used or not.  The table is emptied whenever a clazz is unloaded.
+ *
+ * With #BVM_CLAZZ_DISPATCH_TABLES_ENABLE an \c invokevirtual of a method with a vtable slot does not need the cache - the
+ * method is simply indexed from the receiver clazz's vtable.  The cache then saves \c invokeinterface the scan of
+ * the receiver clazz's itable.
+ *
+ * \c checkcast and \c instanceof get the same treatment with #BVM_EXEC_TYPE_CACHE_ENABLE.  Each caches the clazz it
+ * names and the object clazzes it has found compatible with it, so a repeat check is a compare with no clazz lookup
+ * and no hierarchy search.
+ *
+ * @section exec-jit Compiled Code
+ *
+ * With #BVM_JIT_ENABLE each method counts its invocations and backwards branches - a \c goto or a taken conditional
+ * branch - and when the count reaches #BVM_JIT_THRESHOLD the method is compiled (see jit.c).  Compiled code works on
+ * the same frame as the interpreter and stops at any instruction it does not do, so the interpreter goes into the
+ * compiled code of the current method wherever it can - after a frame push for an invocation, at a backwards branch,
+ * after a return to the method, and when a thread switch resumes it - and carries on from wherever the compiled code
+ * stops.  There is nothing to replace on the stack for a method that becomes hot part way through a long loop: the
+ * live frame is already the frame the compiled code runs in, so the loop goes on in compiled code from its next
+ * backwards branch.
+ *
+ * With #BVM_AOT_ENABLE a method translated to C ahead of time (see aot.c) is run in just the same way, from the same
+ * places, with the translation taking the place of the compiled code.
+ *
+ * With #BVM_EXEC_REGISTER_IR_ENABLE the same places go into the register code of the method (see ir.c), translated
+ * from the bytecode the first time each part of the method runs.
  *
  * @section exec-registers Using Registers
  *
@@ -159,6 +222,469 @@
 #	define OPCODE_DISPATCH_END }
 #endif
 
+/*
+ * With direct threading, the debugger hooks are reached through a separate dispatch table while a debugger
+ * session is open, so the plain dispatch has no debugger overhead.
+ */
+#if (BVM_DEBUGGER_ENABLE && BVM_DIRECT_THREADING_ENABLE && BVM_EXEC_DEBUG_DISPATCH_ENABLE)
+#	define EXEC_DEBUG_DISPATCH 1
+#	define EXEC_DEBUG_DISPATCH_SELECT dispatch_labels = bvmd_is_session_open() ? exec_debug_labels : opcode_labels;
+#else
+#	define EXEC_DEBUG_DISPATCH 0
+#endif
+
+/*
+ * With timer preemption, ordinary opcodes skip the thread switch check and go straight to the next opcode.  Only
+ * the opcodes ending with OPCODE_NEXT_PREEMPT (branches and returns), and the explicit jumps to the top of
+ * the interpreter loop (which include all method invocations and wherever a thread may block) look for a thread
+ * switch.
+ */
+#if BVM_THREAD_TIMER_PREEMPTION_ENABLE
+#	undef OPCODE_NEXT
+#	define OPCODE_NEXT goto next_opcode;
+#	define OPCODE_NEXT_PREEMPT goto top_of_interpreter_loop;
+#else
+#	define OPCODE_NEXT_PREEMPT OPCODE_NEXT
+#endif
+
+/*
+ * Substitute a fast opcode for the opcode at the current pc.  With debugger support a breakpoint's displaced opcode is
+ * executed with the breakpoint still in place, so that location is not quickened - the breakpoint would be lost.  It
+ * will be quickened the next time it runs after the breakpoint is cleared.
+ */
+#if BVM_DEBUGGER_ENABLE
+#define EXEC_QUICKEN(op) if (*bvm_gl_rx_pc != OPCODE_breakpoint) *bvm_gl_rx_pc = (op)
+#else
+#define EXEC_QUICKEN(op) *bvm_gl_rx_pc = (op)
+#endif
+
+/*
+ * Substitute a fast opcode for a static field access, a static invocation or a \c new only once the clazz it depends
+ * on is initialised.  The fast opcodes never check initialisation - the unquickened instruction is the barrier.  While
+ * a thread is running the <clinit> of the clazz it may use the clazz, but other threads must still wait for it, so the
+ * instruction is left as it is and is patched the first time it runs after the initialisation has completed.
+ */
+#define EXEC_QUICKEN_INITIALISED(c, op) if ((c)->state == BVM_CLAZZ_STATE_INITIALISED) EXEC_QUICKEN(op)
+
+/*
+ * Whether the opcode \c n bytes on from the current pc is (still) \c op, so a superinstruction may do the rest of its
+ * sequence.  If not - because it is a breakpoint, or not yet quickened - the superinstruction does only its first
+ * instruction.  A thread that is being stepped by a debugger must see every instruction, so it never does the rest.
+ */
+#if BVM_DEBUGGER_ENABLE
+#define EXEC_SUPER_FOLLOWS(n, op) ( (bvm_gl_rx_pc[n] == (op)) && !bvm_gl_thread_current->dbg_is_stepping )
+#else
+#define EXEC_SUPER_FOLLOWS(n, op) (bvm_gl_rx_pc[n] == (op))
+#endif
+
+/*
+ * With #BVM_USE_REGISTERS the pc, sp and locals registers are local variables of #bvm_exec_run (within it the
+ * \c bvm_gl_rx_pc, \c bvm_gl_rx_sp and \c bvm_gl_rx_locals names refer to the locals).  EXEC_STORE_REGISTERS writes them
+ * back to the globals before calling anything that may use the globals - anything that may allocate, throw, resolve,
+ * switch threads or talk to the debugger.  EXEC_LOAD_REGISTERS reads them back after calling anything that may change
+ * them.  Without #BVM_USE_REGISTERS both do nothing.
+ */
+#if BVM_USE_REGISTERS
+#define EXEC_STORE_REGISTERS (*exec_gl_pc = rx_pc, *exec_gl_sp = rx_sp, *exec_gl_locals = rx_locals)
+#define EXEC_LOAD_REGISTERS  (rx_pc = *exec_gl_pc, rx_sp = *exec_gl_sp, rx_locals = *exec_gl_locals)
+#else
+#define EXEC_STORE_REGISTERS ((void) 0)
+#define EXEC_LOAD_REGISTERS  ((void) 0)
+#endif
+
+/*
+ * With #BVM_AOT_ENABLE, EXEC_AOT_ENTER goes into the C translation of a method that has one, and EXEC_AOT_RESUME
+ * into that of the current method.  As with compiled code, no translation is run while a debugger session is open.
+ */
+#if BVM_AOT_ENABLE
+
+#if BVM_DEBUGGER_ENABLE
+#define EXEC_AOT_ALLOWED (!bvmd_is_session_open())
+#else
+#define EXEC_AOT_ALLOWED BVM_TRUE
+#endif
+
+#define EXEC_AOT_ENTER(m) if ( ((m)->aot_code != NULL) && EXEC_AOT_ALLOWED ) goto exec_aot_run
+
+#define EXEC_AOT_RESUME if (bvm_gl_rx_method != NULL) EXEC_AOT_ENTER(bvm_gl_rx_method)
+
+#else
+#define EXEC_AOT_ENTER(m) ((void) 0)
+#define EXEC_AOT_RESUME ((void) 0)
+#endif
+
+/*
+ * With #BVM_EXEC_REGISTER_IR_ENABLE, EXEC_IR_ENTER goes into the register code of a method at the current pc unless
+ * the method is known to have none there, and EXEC_IR_RESUME into that of the current method after a return to it.
+ * EXEC_IR_SWITCHED goes into the register code of the current method after a thread switch only if some has already
+ * been translated from the current pc - a switch may come at any bytecode, and translating from each would only break
+ * the register code into small pieces.  As with compiled code, no register code is run while a debugger session is
+ * open.
+ */
+#if BVM_EXEC_REGISTER_IR_ENABLE
+
+#if BVM_DEBUGGER_ENABLE
+#define EXEC_IR_ALLOWED (!bvmd_is_session_open())
+#else
+#define EXEC_IR_ALLOWED BVM_TRUE
+#endif
+
+#define EXEC_IR_ENTER(m) if ( BVM_IR_MayRun(m, bvm_gl_rx_pc) && EXEC_IR_ALLOWED ) goto exec_ir_run
+
+#define EXEC_IR_RESUME 																						\
+	if ( (bvm_gl_rx_method != NULL) && !BVM_METHOD_IsNative(bvm_gl_rx_method) ) EXEC_IR_ENTER(bvm_gl_rx_method)
+
+#define EXEC_IR_SWITCHED 																					\
+	if ( (bvm_gl_rx_method != NULL) && !BVM_METHOD_IsNative(bvm_gl_rx_method) &&								\
+		 BVM_IR_HasCode(bvm_gl_rx_method, bvm_gl_rx_pc) && EXEC_IR_ALLOWED ) goto exec_ir_run
+
+#else
+#define EXEC_IR_ENTER(m) ((void) 0)
+#define EXEC_IR_RESUME ((void) 0)
+#define EXEC_IR_SWITCHED ((void) 0)
+#endif
+
+/*
+ * With #BVM_JIT_ENABLE, EXEC_JIT_HOT counts an invocation of, or a backwards branch in, a method and is true if the
+ * method has compiled code to run - compiling it if it has just become hot.  EXEC_JIT_RESUME goes into the compiled code
+ * of the current method, if it has some.  No compiled code is run while a debugger session is open.  EXEC_GOTO moves
+ * the pc by the offset of a \c goto or a taken conditional branch, and goes into the translation, or the compiled
+ * code, of the method if the branch loops back in a method that has one or in a hot method.
+ */
+#if BVM_JIT_ENABLE
+
+#if BVM_DEBUGGER_ENABLE
+#define EXEC_JIT_ALLOWED (!bvmd_is_session_open())
+#else
+#define EXEC_JIT_ALLOWED BVM_TRUE
+#endif
+
+#define EXEC_JIT_HOT(m) ( EXEC_JIT_ALLOWED && 																\
+		( ((m)->jit_code != NULL) || ((++(m)->jit_counter == BVM_JIT_THRESHOLD) && bvm_jit_compile(m)) ) )
+
+#define EXEC_JIT_RESUME 																						\
+	if ( (bvm_gl_rx_method != NULL) && (bvm_gl_rx_method->jit_code != NULL) && EXEC_JIT_ALLOWED ) goto exec_jit_run
+
+#define EXEC_GOTO(offset) do {																				\
+	bvm_int32_t goto_offset = (offset);																		\
+	bvm_gl_rx_pc += goto_offset;																			\
+	if (goto_offset < 0) {																					\
+		EXEC_AOT_ENTER(bvm_gl_rx_method);																	\
+		if (EXEC_JIT_HOT(bvm_gl_rx_method)) goto exec_jit_run;												\
+		EXEC_IR_ENTER(bvm_gl_rx_method);																	\
+	}																										\
+} while (0)
+
+#else
+#define EXEC_JIT_RESUME ((void) 0)
+#if (BVM_AOT_ENABLE || BVM_EXEC_REGISTER_IR_ENABLE)
+#define EXEC_GOTO(offset) do {																				\
+	bvm_int32_t goto_offset = (offset);																		\
+	bvm_gl_rx_pc += goto_offset;																			\
+	if (goto_offset < 0) {																					\
+		EXEC_AOT_ENTER(bvm_gl_rx_method);																	\
+		EXEC_IR_ENTER(bvm_gl_rx_method);																	\
+	}																										\
+} while (0)
+#else
+#define EXEC_GOTO(offset) bvm_gl_rx_pc += (offset)
+#endif
+#endif
+
+/*
+ * With #BVM_EXEC_ACCESSOR_INLINING_ENABLE, EXEC_ACCESSOR_INLINING_ALLOWED is true if a call to an accessor method may
+ * be done inline.  It may not while a debugger session is open - the debugger must be able to step into the method and
+ * stop at breakpoints in it.  EXEC_ACCESSOR_FIELD gives the field a getter or setter accesses, or \c NULL if the
+ * method's access to it has not yet been resolved.
+ */
+#if BVM_EXEC_ACCESSOR_INLINING_ENABLE
+
+#if BVM_DEBUGGER_ENABLE
+#define EXEC_ACCESSOR_INLINING_ALLOWED (!bvmd_is_session_open())
+#else
+#define EXEC_ACCESSOR_INLINING_ALLOWED BVM_TRUE
+#endif
+
+#define EXEC_ACCESSOR_FIELD_INDEX(m) 																		\
+	BVM_VM2UINT16((m)->code.bytecode + (((m)->accessor == BVM_METHOD_ACCESSOR_GETTER) ? 2 : 3))
+
+#define EXEC_ACCESSOR_FIELD(m) 																				\
+	( BVM_CONSTANT_IsOptimised((m)->clazz, EXEC_ACCESSOR_FIELD_INDEX(m)) ?									\
+	  (bvm_field_t *) (m)->clazz->constant_pool[EXEC_ACCESSOR_FIELD_INDEX(m)].resolved_ptr : NULL )
+
+#endif
+
+/*
+ * With #BVM_EXEC_CONSTANT_FOLDING_ENABLE, EXEC_STATIC_IS_CONSTANT is true if the value of a resolved static field may be
+ * folded into the constant pool entry of a \c getstatic of it once its class has finished initialising - it is a final
+ * single cell primitive, and no debugger session is open to set it.
+ */
+#if BVM_EXEC_CONSTANT_FOLDING_ENABLE
+
+#if BVM_DEBUGGER_ENABLE
+#define EXEC_CONSTANT_FOLDING_ALLOWED (!bvmd_is_session_open())
+#else
+#define EXEC_CONSTANT_FOLDING_ALLOWED BVM_TRUE
+#endif
+
+#define EXEC_STATIC_IS_CONSTANT(f) 																			\
+	( BVM_FIELD_IsFinal(f) && !BVM_FIELD_IsReference(f) && !BVM_FIELD_IsLong(f) && EXEC_CONSTANT_FOLDING_ALLOWED )
+
+#endif
+
+/*
+ * With #BVM_PROFILER_ALLOCATION_SITES_ENABLE, count the bytes of an object allocated inline by EXEC_NEW_OBJECT towards
+ * the next allocation sample.  The sample looks at the pc, so the registers are stored first.
+ */
+#if BVM_PROFILER_ALLOCATION_SITES_ENABLE
+#define EXEC_SAMPLE_ALLOCATION(o, s) {																		\
+	if ( (bvm_gl_profiler_allocation_countdown -= (bvm_int32_t) (s)) <= 0) {								\
+		EXEC_STORE_REGISTERS;																				\
+		bvm_profiler_allocation_sample((o), (s), BVM_ALLOC_TYPE_OBJECT);									\
+	}																										\
+}
+#else
+#define EXEC_SAMPLE_ALLOCATION(o, s) {}
+#endif
+
+/*
+ * The allocation functions of the bytecodes that create objects and arrays.  With #BVM_SCOPED_MEMORY_ENABLE objects and
+ * arrays are created in the scope the current thread is in, if any (see scope.c).
+ */
+#if BVM_SCOPED_MEMORY_ENABLE
+#define EXEC_IN_SCOPE BVM_SCOPE_IsAllocating()
+#define EXEC_ALLOC_OBJECT(cl) 						\
+	(EXEC_IN_SCOPE ? bvm_scope_alloc_object(cl) : bvm_object_alloc(cl))
+#define EXEC_ALLOC_ARRAY_PRIMITIVE(l, t) 			\
+	(EXEC_IN_SCOPE ? bvm_scope_alloc_array_primitive(l, t) : bvm_object_alloc_array_primitive(l, t))
+#define EXEC_ALLOC_ARRAY_REFERENCE(l, cl) 			\
+	(EXEC_IN_SCOPE ? bvm_scope_alloc_array_reference(l, cl) : bvm_object_alloc_array_reference(l, cl))
+#define EXEC_ALLOC_ARRAY_MULTI(cl, d, l) 			\
+	(EXEC_IN_SCOPE ? bvm_scope_alloc_array_multi(cl, d, l) : bvm_object_alloc_array_multi(cl, d, l))
+#else
+#define EXEC_IN_SCOPE BVM_FALSE
+#define EXEC_ALLOC_OBJECT(cl) bvm_object_alloc(cl)
+#define EXEC_ALLOC_ARRAY_PRIMITIVE(l, t) bvm_object_alloc_array_primitive(l, t)
+#define EXEC_ALLOC_ARRAY_REFERENCE(l, cl) bvm_object_alloc_array_reference(l, cl)
+#define EXEC_ALLOC_ARRAY_MULTI(cl, d, l) bvm_object_alloc_array_multi(cl, d, l)
+#endif
+
+/*
+ * Allocate a new object of instance clazz \c cl into \c o.  The inline thread allocation buffer fast path is tried first, falling
+ * back to #bvm_object_alloc.  Strings have their own alloc type and always go the long way, as does everything created in a
+ * scope.  Memory from the buffer is already zeroed.
+ */
+#define EXEC_NEW_OBJECT(o, cl) {																			\
+	(o) = NULL;																								\
+	if ( ((cl) != BVM_STRING_CLAZZ) && !EXEC_IN_SCOPE )														\
+		BVM_HEAP_TLAB_TRY_ALLOC(o, BVM_OBJECT_SIZE(cl), BVM_ALLOC_TYPE_OBJECT);							\
+	if ((o) != NULL) {																						\
+		(o)->clazz = (bvm_clazz_t *) (cl);																	\
+		BVM_PROFILER_COUNT_ALLOCATION();																	\
+		EXEC_SAMPLE_ALLOCATION(o, BVM_OBJECT_SIZE(cl))														\
+	} else {																									\
+		EXEC_STORE_REGISTERS;																				\
+		(o) = EXEC_ALLOC_OBJECT(cl);																		\
+	}																										\
+}
+
+
+#if BVM_NI_CALLS_ENABLE
+
+/**
+ * The result of a call made by #bvm_exec_call.  Lives on the 'C' stack of the call.
+ */
+typedef struct _bvmexeccallstruct {
+
+	/** The two cells at the top of the stack when the called method returned */
+	bvm_cell_t res1;
+	bvm_cell_t res2;
+
+	/** The throwable that ended the call, or \c NULL if it returned normally */
+	bvm_throwable_obj_t *exception;
+
+	/** Set once the call has returned or thrown */
+	bvm_bool_t is_done;
+} exec_call_t;
+
+/** The thread making calls with #bvm_exec_call, or \c NULL if none are in progress */
+static BVM_VM_LOCAL bvm_vmthread_t *exec_call_thread = NULL;
+
+/** The number of calls in progress on #exec_call_thread */
+static BVM_VM_LOCAL bvm_uint32_t exec_call_depth = 0;
+
+/** Set by #exec_call_callback to have the innermost #bvm_exec_run return to its #bvm_exec_call */
+static BVM_VM_LOCAL bvm_bool_t exec_call_returned = BVM_FALSE;
+
+/**
+ * The callback of the wedge pushed by #bvm_exec_call.  Records the result of the call and asks the nested interpreter
+ * loop to return.
+ *
+ * @param res1 the top cell of the returned value, or the throwable if \c is_exception
+ * @param res2 the cell before the top cell of the returned value
+ * @param is_exception whether the call ended with an exception
+ * @param data the call's #exec_call_t
+ *
+ * @return \c NULL
+ */
+static bvm_obj_t *exec_call_callback(bvm_cell_t *res1, bvm_cell_t *res2, bvm_bool_t is_exception, void *data) {
+
+	exec_call_t *call = data;
+
+	if (is_exception) {
+		call->exception = (bvm_throwable_obj_t *) res1->ref_value;
+	} else {
+		call->res1 = *res1;
+		call->res2 = *res2;
+	}
+
+	call->is_done = BVM_TRUE;
+	exec_call_returned = BVM_TRUE;
+
+	return NULL;
+}
+
+#endif
+
+#if BVM_VM_SLICE_ENABLE
+
+/** Set while #bvm_exec_run_slice runs the interpreter loop - the loop returns at a thread switch once the slice is spent */
+BVM_VM_LOCAL bvm_bool_t bvm_gl_exec_slice_active = BVM_FALSE;
+
+/** Set by #bvm_thread_switch when it finds no runnable thread during a slice - it returns instead of sleeping */
+BVM_VM_LOCAL bvm_bool_t bvm_gl_exec_slice_idle = BVM_FALSE;
+
+/** The bytecodes the current slice may still run, or zero if it has no bytecode budget */
+static BVM_VM_LOCAL bvm_uint32_t exec_slice_bytecodes;
+
+/** The timeslice given to the current thread from the slice's bytecodes at the last thread switch */
+static BVM_VM_LOCAL bvm_uint32_t exec_slice_granted;
+
+/** The time the current slice started, and the microseconds it may run for, or zero if it has no time budget */
+static BVM_VM_LOCAL bvm_uint32_t exec_slice_start;
+static BVM_VM_LOCAL bvm_uint32_t exec_slice_micros;
+
+/**
+ * Cut the timeslice of the current thread down to the bytecodes left in the slice.  Without timer preemption the
+ * timeslice counter counts bytecodes (and the branches of translated and compiled code), so the slice ends at the
+ * first thread switch after its bytecodes are spent.  With timer preemption the counter counts ticks and only the
+ * time budget is kept.
+ */
+static void exec_slice_grant() {
+
+#if !BVM_THREAD_TIMER_PREEMPTION_ENABLE
+	if (exec_slice_bytecodes != 0) {
+		if ((bvm_uint32_t) bvm_gl_thread_timeslice_counter > exec_slice_bytecodes)
+			bvm_gl_thread_timeslice_counter = exec_slice_bytecodes;
+		exec_slice_granted = bvm_gl_thread_timeslice_counter;
+#if BVM_THREAD_ACCOUNTING_ENABLE
+		bvm_gl_thread_timeslice_start = bvm_gl_thread_timeslice_counter;
+#endif
+	}
+#endif
+}
+
+/**
+ * Called at a thread switch during a slice.  Takes the timeslice just ended from the slice's bytecodes - all of it,
+ * even if the thread gave it up early, so a slice never runs more than it was given.
+ *
+ * @return \c BVM_TRUE if the slice is spent.
+ */
+static bvm_bool_t exec_slice_is_spent() {
+
+#if !BVM_THREAD_TIMER_PREEMPTION_ENABLE
+	if (exec_slice_bytecodes != 0) {
+		if (exec_slice_granted >= exec_slice_bytecodes) return BVM_TRUE;
+		exec_slice_bytecodes -= exec_slice_granted;
+	}
+#endif
+
+	return (exec_slice_micros != 0) && ((bvm_pd_system_time_micros() - exec_slice_start) >= exec_slice_micros);
+}
+
+/**
+ * Run the interpreter loop for one slice.  The slice starts with a thread switch, so timers and sockets are looked at
+ * after the time spent in the host, and ends at the first thread switch after \c max_bytecodes bytecodes have run or
+ * \c max_micros microseconds have passed - the switch itself is left for the next slice.  A slice also ends if the
+ * switch finds every thread waiting.
+ *
+ * A call made into Java by #bvm_exec_call during a slice runs to its end before the slice may.
+ *
+ * As for #bvm_exec_run, the caller must be within a BVM_TRY and a #BVM_VM_TRY block.
+ *
+ * @param max_bytecodes the bytecodes the slice may run, or zero for no limit.
+ * @param max_micros the microseconds the slice may run for, or zero for no limit.
+ *
+ * @return \c BVM_TRUE if the VM has threads left to run, \c BVM_FALSE if the last non-daemon thread has ended.
+ */
+bvm_bool_t bvm_exec_run_slice(bvm_uint32_t max_bytecodes, bvm_uint32_t max_micros) {
+
+	exec_slice_bytecodes = max_bytecodes;
+	exec_slice_micros = max_micros;
+	if (max_micros != 0) exec_slice_start = bvm_pd_system_time_micros();
+
+	bvm_gl_exec_slice_idle = BVM_FALSE;
+	bvm_gl_exec_slice_active = BVM_TRUE;
+
+#if BVM_THREAD_ACCOUNTING_ENABLE
+	/* the time spent in the host since the last slice is no thread's */
+	bvm_gl_thread_run_start = bvm_pd_system_time_micros();
+#endif
+
+	bvm_thread_switch();
+
+	if (!bvm_gl_exec_slice_idle) {
+		exec_slice_grant();
+		bvm_exec_run();
+	}
+
+#if BVM_THREAD_ACCOUNTING_ENABLE
+	bvm_thread_account_run();
+#endif
+
+	bvm_gl_exec_slice_active = BVM_FALSE;
+
+	return (bvm_gl_thread_nondaemon_count != 0);
+}
+
+#endif
+
+/**
+ * Reports whether an exception handler catches a thrown object - it does if it is a 'finally' or its catch clazz is
+ * the clazz of the object or one of its superclazzes.
+ *
+ * @param method the method of the handler
+ * @param exp the handler
+ * @param throwable the thrown object
+ *
+ * @return \c BVM_TRUE if the handler catches the object, \c BVM_FALSE otherwise.
+ */
+static bvm_bool_t exec_handler_catches(bvm_method_t *method, bvm_exception_t *exp, bvm_throwable_obj_t *throwable) {
+
+	bvm_clazz_t *ex_clazz;
+
+	/* catch type contains the class name, or NULL for a 'finally' */
+	bvm_utfstring_t *ct = exp->catch_type;
+
+	if (ct == NULL) return BVM_TRUE;
+
+	/* not at a 'finally', so get the clazz of the exception at the catch. */
+#if BVM_EXEC_FAST_THROW_ENABLE
+	/* the catch clazz is loaded by the method's own classloader, so lives as long as the method does */
+	if (exp->catch_clazz == NULL)
+		exp->catch_clazz = bvm_clazz_get(method->clazz->classloader_obj, ct);
+	ex_clazz = exp->catch_clazz;
+#else
+	ex_clazz = bvm_clazz_get(method->clazz->classloader_obj, ct);
+#endif
+
+	/* a catch type is a Throwable clazz, so the superclass display settles it without the general assignability
+	 * test - a class file that names an interface gets the general test */
+	if (!BVM_CLAZZ_IsInterface(ex_clazz))
+		return bvm_clazz_is_subclass_of(throwable->clazz, ex_clazz);
+
+	return bvm_clazz_is_assignable_from(throwable->clazz, ex_clazz);
+}
 
 /**
  * Stack visit callback for checking if a method catches a given exception.  If it does, the param
@@ -183,6 +709,16 @@ static bvm_bool_t exec_find_exception_callback(bvm_stack_frame_info_t *stackinfo
 	 * depth if the exception in uncaught */
 	location_data->depth = stackinfo->depth;
 
+#if BVM_NI_CALLS_ENABLE
+	/* an exception is not passed down below a call from native code - the call ends with it */
+	if ( (method == BVM_METHOD_CALLBACKWEDGE) && (stackinfo->locals[1].callback == exec_call_callback) ) {
+		location_data->caught = BVM_TRUE;
+		location_data->method = method;
+		location_data->handler_pc = 0;
+		return BVM_FALSE;
+	}
+#endif
+
 	/* "if the method of the current frame is a synchronized method and the current thread
 	 * is not the owner of the monitor acquired or reentered on invocation of the method,
 	 * athrow throws an IllegalMonitorStateException instead of the
@@ -192,53 +728,69 @@ static bvm_bool_t exec_find_exception_callback(bvm_stack_frame_info_t *stackinfo
 	 */
 	if (BVM_METHOD_IsSynchronized(method)) {
 		bvm_obj_t *sync_obj = (stackinfo->locals[BVM_FRAME_SYNCOBJ_OFFSET].ref_value);
-		bvm_monitor_t *monitor = get_monitor_for_obj(sync_obj);
 
-		if (monitor->owner_thread != stackinfo->vmthread) {
+		if (!bvm_thread_monitor_is_owner(sync_obj, stackinfo->vmthread)) {
 			location_data->throwable = bvm_create_exception_c(BVM_ERR_ILLEGAL_MONITOR_STATE_EXCEPTION, NULL);
 		}
 	}
 
 	/* number of exceptions for the method's code.  If native, then none. */
+	BVM_METHOD_LoadCodeTables(method);
 	nrexc = BVM_METHOD_IsNative(method) ? 0 : method->exceptions_count;
 
 	/* the pc in the method is the current pc address less the
 	 * start address of the method's bytecode */
 	pcoffset = (int) (throw_pc - method->code.bytecode);
 
-	/* ok, look at each exception - there may be none */
-	for (lc=0; lc < nrexc; lc++) {
+#if BVM_EXEC_HANDLER_INDEX_ENABLE
+	/* an indexed method only looks at the handlers covering the interval the pc is in */
+	if ( (nrexc > 0) && (method->exception_index != NULL) ) {
 
-		/* get a handle to the exception from the method's exceptions array */
-		bvm_exception_t *exp = &(method->exceptions[lc]);
+		bvm_exception_index_t *index = method->exception_index;
+		bvm_uint32_t lo = 0, hi = index->count;
 
-		/* if the current offset is within the offset range as specific by the exception */
-		if ( (pcoffset >= exp->start_pc) && (pcoffset < exp->end_pc)) {
+		if ( (pcoffset < index->starts[0]) || (pcoffset >= index->starts[hi]) ) return BVM_TRUE;
 
-			/* within range, so let's check the clazz - default to NULL stops
-			 * compiler complaining */
-			bvm_clazz_t *ex_clazz = NULL;
+		/* the last interval starting at or before the pc */
+		while (hi - lo > 1) {
+			bvm_uint32_t mid = (lo + hi) / 2;
+			if (index->starts[mid] <= pcoffset) lo = mid; else hi = mid;
+		}
 
-			/* catch type contains the class name, or NULL for a 'finally' */
-			bvm_utfstring_t *ct = exp->catch_type;
+		for (lc = index->first[lo]; lc < (int) index->first[lo + 1]; lc++) {
 
-			/* if we are not at a 'finally' get the clazz of the exception at the catch. */
-			if (ct != NULL) {
-				ex_clazz = bvm_clazz_get(method->clazz->classloader_obj, ct);
-			}
+			bvm_exception_t *exp = &(method->exceptions[index->handlers[lc]]);
 
-			/* Have we found one?  We have if we have reached a 'finally' or
-			 * found a catch that has a class that is compatible with the
-			 * thrown object. */
-			if ((ct == NULL) || (bvm_clazz_is_assignable_from(location_data->throwable->clazz, ex_clazz))) {
+			if (exec_handler_catches(method, exp, location_data->throwable)) {
 				location_data->caught = BVM_TRUE;
 				location_data->method = stackinfo->method;
 				location_data->handler_pc = exp->handler_pc;
-
-				/* found, return false to have stack visit stop */
 				return BVM_FALSE;
 			}
 		}
+
+		return BVM_TRUE;
+	}
+#endif
+
+	/* ok, look at each exception - there may be none */
+	for (lc=0; lc < nrexc; lc++) {
+
+		/* get a handle to the exception from the method's exceptions array */
+		bvm_exception_t *exp = &(method->exceptions[lc]);
+
+		/* Have we found one?  We have if the current offset is within the offset range as specified by the
+		 * exception and we have reached a 'finally' or found a catch that has a class that is compatible with the
+		 * thrown object. */
+		if ( (pcoffset >= exp->start_pc) && (pcoffset < exp->end_pc) &&
+			 exec_handler_catches(method, exp, location_data->throwable) ) {
+			location_data->caught = BVM_TRUE;
+			location_data->method = stackinfo->method;
+			location_data->handler_pc = exp->handler_pc;
+
+			/* found, return false to have stack visit stop */
+			return BVM_FALSE;
+		}
 	}
 
 	/* not found, return true to have stack visit keep going */
@@ -246,65 +798,1066 @@ static bvm_bool_t exec_find_exception_callback(bvm_stack_frame_info_t *stackinfo
 }
 
 /**
- * Finds the virtual implementation of a given method from a given clazz as a starting point for
- * the search.  Searches the class hierarchy looking for a method that matches the name and
- * JNI signature of the given methods and satisfies visibility and access restrictions.
+ * Finds the virtual implementation of a given method from a given clazz as a starting point for
+ * the search.  Searches the class hierarchy looking for a method that matches the name and
+ * JNI signature of the given methods and satisfies visibility and access restrictions.
+ *
+ * @param search_clazz the starting instance clazz for the search
+ * @param resolved_method a method to search for a match.
+ *
+ * @return the bvm_method_t method if one if found, or NULL otherwise.
+ */
+static bvm_method_t *locate_virtual_method(bvm_instance_clazz_t *search_clazz, bvm_method_t *resolved_method) {
+
+	bvm_utfstring_t *method_name = resolved_method->name;
+	bvm_utfstring_t *method_sig  = resolved_method->jni_signature;
+
+	bvm_method_t *virtual_method;
+
+#if BVM_CLAZZ_DISPATCH_TABLES_ENABLE
+	/* the dispatch tables hold almost every method - only fall back to the search if they do not */
+	virtual_method = bvm_clazz_virtual_method_get(search_clazz, resolved_method);
+	if (virtual_method != NULL) return virtual_method;
+#endif
+
+	/* JVMS invokevirtual opcode docs: "Let C be the class of ref_value. If C contains a
+	 * declaration for an instance method with the same name and desc as the
+	 * resolved method, and the resolved method is accessible from C, then this is
+	 * the method to be invoked, and the lookup procedure terminates". */
+
+	do {
+
+		virtual_method = bvm_clazz_method_get(search_clazz, method_name, method_sig, (BVM_METHOD_SEARCH_CLAZZ | BVM_METHOD_SEARCH_SUPERS) );
+
+		/* we have found a matching method - note that this method may actually not be in
+		 * the search_clazz, it may have been found in one of its superclasses ....*/
+		if (virtual_method != NULL) {
+
+			/* if the resolved method is visible to the found invoke method (which
+			 * implies it is an override) we have found our method.  The 'public' check here is
+			 * redundant - it is also checked in bvm_clazz_is_member_accessible - but it is just to
+			 * avoid the function call overhead as most methods are public ..*/
+			if (BVM_ACCESS_IsPublic(BVM_METHOD_AccessFlags(resolved_method)) ||
+					bvm_clazz_is_member_accessible(BVM_METHOD_AccessFlags(resolved_method), virtual_method->clazz, (bvm_instance_clazz_t *) resolved_method->clazz)) {
+				return virtual_method;
+			}
+
+			/* ... otherwise, try the superclazz - note we are trying the superclazz of the clazz the
+			 * found invoke method was located in, not the superclazz of the last clazz searched. */
+			search_clazz = virtual_method->clazz->super_clazz;
+		}
+
+	} while (search_clazz != NULL && virtual_method != NULL);
+
+	bvm_throw_exception(BVM_ERR_NO_SUCH_METHOD_ERROR, (char *) method_name->data);
+
+	/* never reached */
+	return NULL;
+}
+
+#if BVM_EXEC_INLINE_CACHE_ENABLE
+
+/**
+ * An inline cache for a single \c invokevirtual or \c invokeinterface call site.  Each way holds a receiver
+ * clazz and the method that a call on a receiver of that clazz dispatches to.  Ways are filled from the front and
+ * unused ways have a \c NULL clazz.
+ */
+typedef struct _bvminlinecachestruct {
+
+	/** the address of the call site's opcode, or \c NULL if this cache is unused */
+	bvm_uint8_t *pc;
+
+	/** the receiver clazzes seen at the call site, most recently added first */
+	bvm_instance_clazz_t *clazz[BVM_EXEC_INLINE_CACHE_WAYS];
+
+	/** the dispatched method for each receiver clazz */
+	bvm_method_t *method[BVM_EXEC_INLINE_CACHE_WAYS];
+
+} bvm_inline_cache_t;
+
+/** The inline cache side table, hashed by call site address */
+static BVM_VM_LOCAL bvm_inline_cache_t inline_cache_table[BVM_EXEC_INLINE_CACHE_SIZE];
+
+/** Set when any call site has been cached since the table was last flushed */
+static BVM_VM_LOCAL bvm_bool_t inline_cache_in_use = BVM_FALSE;
+
+#define INLINE_CACHE_HASH(pc) \
+	( (bvm_uint32_t) ( ( ((size_t) (pc)) ^ (((size_t) (pc)) >> 8) ) & (BVM_EXEC_INLINE_CACHE_SIZE - 1) ) )
+
+/**
+ * Empties the inline cache side table.  The collector calls this whenever it frees a clazz - after that point a
+ * cache could hold a clazz or method that no longer exists, or be keyed by bytecode that has been freed and whose
+ * memory may be reused for other bytecode.
+ */
+void bvm_exec_inline_cache_flush() {
+	if (inline_cache_in_use) {
+		memset(inline_cache_table, 0, sizeof(inline_cache_table));
+		inline_cache_in_use = BVM_FALSE;
+	}
+}
+
+/**
+ * Finds the virtual implementation of a method for a receiver clazz at a given call site, first looking in the call
+ * site's inline cache and falling back to #locate_virtual_method on a miss.  A miss adds the receiver clazz and the
+ * found method to the front of the cache, dropping the oldest way if the cache is full.  A call site that hashes to
+ * a slot held by another call site takes the slot over.
+ *
+ * @param pc the address of the call site opcode
+ * @param search_clazz the clazz of the receiver object
+ * @param resolved_method the method resolved from the call site's constant pool entry
+ *
+ * @return the bvm_method_t to invoke.
+ */
+static bvm_method_t *locate_cached_virtual_method(bvm_uint8_t *pc, bvm_instance_clazz_t *search_clazz, bvm_method_t *resolved_method) {
+
+	bvm_inline_cache_t *cache = &inline_cache_table[INLINE_CACHE_HASH(pc)];
+	bvm_method_t *virtual_method;
+	int i;
+
+	if (cache->pc == pc) {
+		for (i = 0; i < BVM_EXEC_INLINE_CACHE_WAYS; i++) {
+			if (cache->clazz[i] == search_clazz) return cache->method[i];
+		}
+	}
+
+	virtual_method = locate_virtual_method(search_clazz, resolved_method);
+
+	if (cache->pc != pc) {
+		memset(cache, 0, sizeof(bvm_inline_cache_t));
+		cache->pc = pc;
+	}
+
+	for (i = BVM_EXEC_INLINE_CACHE_WAYS - 1; i > 0; i--) {
+		cache->clazz[i]  = cache->clazz[i-1];
+		cache->method[i] = cache->method[i-1];
+	}
+
+	cache->clazz[0]  = search_clazz;
+	cache->method[0] = virtual_method;
+
+	inline_cache_in_use = BVM_TRUE;
+
+	return virtual_method;
+}
+
+#define LOCATE_VIRTUAL_METHOD(c, m) locate_cached_virtual_method(bvm_gl_rx_pc, (c), (m))
+
+#else
+
+#define LOCATE_VIRTUAL_METHOD(c, m) locate_virtual_method((c), (m))
+
+#endif
+
+#if BVM_EXEC_TYPE_CACHE_ENABLE
+
+/**
+ * A type check cache for a single \c checkcast or \c instanceof.  It holds the clazz the instruction names and the
+ * object clazzes it has found to be compatible with it.  Ways are filled from the front and unused ways have a \c NULL
+ * clazz.  Incompatible clazzes are not cached - a failed \c checkcast throws anyway.
+ */
+typedef struct _bvmtypecachestruct {
+
+	/** the address of the instruction's opcode, or \c NULL if this cache is unused */
+	bvm_uint8_t *pc;
+
+	/** the clazz named by the instruction */
+	bvm_clazz_t *target_clazz;
+
+	/** the object clazzes found compatible with the target clazz, most recently added first */
+	bvm_clazz_t *clazz[BVM_EXEC_TYPE_CACHE_WAYS];
+
+} bvm_type_cache_t;
+
+/** The type check cache side table, hashed by instruction address */
+static BVM_VM_LOCAL bvm_type_cache_t type_cache_table[BVM_EXEC_TYPE_CACHE_SIZE];
+
+/** Set when any instruction has been cached since the table was last flushed */
+static BVM_VM_LOCAL bvm_bool_t type_cache_in_use = BVM_FALSE;
+
+#define TYPE_CACHE_HASH(pc) \
+	( (bvm_uint32_t) ( ( ((size_t) (pc)) ^ (((size_t) (pc)) >> 8) ) & (BVM_EXEC_TYPE_CACHE_SIZE - 1) ) )
+
+/**
+ * Empties the type check cache side table.  The collector calls this whenever it frees a clazz, for the same reasons
+ * as #bvm_exec_inline_cache_flush.
+ */
+void bvm_exec_type_cache_flush() {
+	if (type_cache_in_use) {
+		memset(type_cache_table, 0, sizeof(type_cache_table));
+		type_cache_in_use = BVM_FALSE;
+	}
+}
+
+/**
+ * Is an object clazz already known to be compatible at a cached instruction?
+ *
+ * @param cache the instruction's cache
+ * @param clazz the clazz of the object being checked
+ *
+ * @return #BVM_TRUE if the clazz is cached as compatible.
+ */
+static bvm_bool_t type_cache_is_compatible(bvm_type_cache_t *cache, bvm_clazz_t *clazz) {
+
+	int i;
+
+	for (i = 0; i < BVM_EXEC_TYPE_CACHE_WAYS; i++) {
+		if (cache->clazz[i] == clazz) return BVM_TRUE;
+	}
+
+	return BVM_FALSE;
+}
+
+/**
+ * Records an object clazz as compatible at an instruction, at the front of the instruction's cache, dropping the oldest
+ * way if the cache is full.  An instruction that hashes to a slot held by another takes the slot over.
+ *
+ * @param pc the address of the instruction's opcode
+ * @param target_clazz the clazz named by the instruction
+ * @param clazz the compatible object clazz
+ */
+static void type_cache_add(bvm_uint8_t *pc, bvm_clazz_t *target_clazz, bvm_clazz_t *clazz) {
+
+	bvm_type_cache_t *cache = &type_cache_table[TYPE_CACHE_HASH(pc)];
+	int i;
+
+	if (cache->pc != pc) {
+		memset(cache, 0, sizeof(bvm_type_cache_t));
+		cache->pc = pc;
+		cache->target_clazz = target_clazz;
+	}
+
+	for (i = BVM_EXEC_TYPE_CACHE_WAYS - 1; i > 0; i--)
+		cache->clazz[i] = cache->clazz[i-1];
+
+	cache->clazz[0] = clazz;
+
+	type_cache_in_use = BVM_TRUE;
+}
+
+#endif
+
+#if BVM_EXEC_SWITCH_TABLES_ENABLE
+
+/**
+ * The decoded operands of a \c tableswitch or \c lookupswitch.  A direct table has one branch offset for each key from
+ * \c low, and \c entries holds the \c count offsets.  A keyed table holds the \c count keys in order and then the
+ * \c count offsets, one for each key.  Offsets are from the switch opcode, as in the bytecode.
+ */
+typedef struct _bvmswitchtablestruct {
+
+	/** the next table of the same method */
+	struct _bvmswitchtablestruct *next;
+
+	/** the offset of the switch opcode in the method bytecode */
+	bvm_uint32_t pc_index;
+
+	/** the number of offsets */
+	bvm_uint32_t count;
+
+	/** whether the table holds keys to search, rather than being indexed directly */
+	bvm_bool_t is_keyed;
+
+	/** the key of the first offset of a direct table */
+	bvm_int32_t low;
+
+	/** the branch offset for a key not in the table */
+	bvm_int32_t default_offset;
+
+	/** the offsets, or the keys and then the offsets */
+	bvm_int32_t entries[1];
+
+} bvm_switch_table_t;
+
+/**
+ * Decodes the operands of the switch instruction at a given pc into a new table, and places the table at the head of
+ * the method's list of tables.  The table is from the heap, so this may GC.
+ *
+ * @param method the method
+ * @param pc the address of the \c tableswitch or \c lookupswitch opcode
+ */
+static void exec_switch_table_build(bvm_method_t *method, bvm_uint8_t *pc) {
+
+	bvm_uint32_t pc_index = (bvm_uint32_t) (pc - method->code.bytecode);
+
+	/* the operands are 4 byte aligned from the start of the bytecode */
+	bvm_uint8_t *operands = method->code.bytecode + ((pc_index + 4) & ~3);
+	bvm_switch_table_t *table;
+	bvm_uint32_t count, range, lc;
+	bvm_bool_t is_keyed = BVM_FALSE;
+	bvm_int32_t low;
+
+	if (*pc == OPCODE_tableswitch) {
+		low = BVM_VM2INT32(operands+4);
+		count = (BVM_VM2INT32(operands+8) < low) ? 0 : (bvm_uint32_t) BVM_VM2INT32(operands+8) - (bvm_uint32_t) low + 1;
+		range = count;
+	} else {
+		count = BVM_VM2UINT32(operands+4);
+		low = (count > 0) ? BVM_VM2INT32(operands+8) : 0;
+
+		/* keys are sorted, so the range is from the first to the last.  Key sets that would leave more than half of
+		 * a direct table empty are searched instead - as is one that covers every int, whose range wraps to zero. */
+		range = (count > 0) ? (bvm_uint32_t) BVM_VM2INT32(operands+8+(count-1)*8) - (bvm_uint32_t) low + 1 : 0;
+		is_keyed = (count > 0) && ( (range == 0) || (range / 2 > count) );
+	}
+
+	lc = is_keyed ? count * 2 : range;
+
+	table = bvm_heap_alloc(sizeof(bvm_switch_table_t) + ((lc > 0) ? lc - 1 : 0) * sizeof(bvm_int32_t), BVM_ALLOC_TYPE_METADATA);
+	table->pc_index = pc_index;
+	table->count = is_keyed ? count : range;
+	table->is_keyed = is_keyed;
+	table->low = low;
+	table->default_offset = BVM_VM2INT32(operands);
+
+	if (*pc == OPCODE_tableswitch) {
+		for (lc = 0; lc < count; lc++)
+			table->entries[lc] = BVM_VM2INT32(operands+12+lc*4);
+	} else if (is_keyed) {
+		for (lc = 0; lc < count; lc++) {
+			table->entries[lc] = BVM_VM2INT32(operands+8+lc*8);
+			table->entries[count+lc] = BVM_VM2INT32(operands+12+lc*8);
+		}
+	} else {
+		/* the keys missing from the range go to the default */
+		for (lc = 0; lc < range; lc++)
+			table->entries[lc] = table->default_offset;
+
+		for (lc = 0; lc < count; lc++)
+			table->entries[(bvm_uint32_t) BVM_VM2INT32(operands+8+lc*8) - (bvm_uint32_t) low] = BVM_VM2INT32(operands+12+lc*8);
+	}
+
+	table->next = method->switch_tables;
+	method->switch_tables = table;
+}
+
+/**
+ * Gives the branch offset for a given key at the quickened switch at a given pc.
+ *
+ * @param method the method
+ * @param pc the address of the switch opcode
+ * @param key the key popped by the switch
+ *
+ * @return the offset from the switch opcode to branch to
+ */
+static bvm_int32_t exec_switch_table_offset(bvm_method_t *method, bvm_uint8_t *pc, bvm_int32_t key) {
+
+	bvm_uint32_t pc_index = (bvm_uint32_t) (pc - method->code.bytecode);
+	bvm_switch_table_t *table = method->switch_tables;
+	bvm_uint32_t low, high, mid;
+
+	/* methods seldom have more than a switch or two */
+	while (table->pc_index != pc_index) table = table->next;
+
+	if (!table->is_keyed) {
+		/* a key below 'low' wraps around to a large index */
+		mid = (bvm_uint32_t) key - (bvm_uint32_t) table->low;
+		return (mid < table->count) ? table->entries[mid] : table->default_offset;
+	}
+
+	low = 0;
+	high = table->count;
+
+	while (low < high) {
+
+		mid = (low + high) / 2;
+
+		if (table->entries[mid] == key) return table->entries[table->count + mid];
+
+		if (table->entries[mid] < key)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return table->default_offset;
+}
+
+/**
+ * Frees the switch tables of a method.  Called as its clazz is unloaded.
+ *
+ * @param method the method
+ */
+void bvm_exec_switch_tables_free(bvm_method_t *method) {
+
+	bvm_switch_table_t *table = method->switch_tables;
+	bvm_switch_table_t *next;
+
+	while (table != NULL) {
+		next = table->next;
+		bvm_heap_free(table);
+		table = next;
+	}
+
+	method->switch_tables = NULL;
+}
+
+#endif
+
+#if BVM_EXEC_STRING_CONCAT_ENABLE
+
+/* the most values a recognised string concatenation may have */
+#define EXEC_CONCAT_MAX_VALUES 16
+
+/* where a value of a recognised string concatenation comes from */
+#define EXEC_CONCAT_FROM_LOCAL 		0
+#define EXEC_CONCAT_FROM_CONSTANT 	1
+#define EXEC_CONCAT_FROM_LITERAL 	2
+
+/**
+ * A string concatenation recognised at a \c new of a \c StringBuilder or \c StringBuffer - see
+ * #BVM_EXEC_STRING_CONCAT_ENABLE.
+ */
+typedef struct _bvmconcatstruct {
+
+	/** the next concatenation of the same method */
+	struct _bvmconcatstruct *next;
+
+	/** the offset of the \c new opcode in the method bytecode */
+	bvm_uint32_t pc_index;
+
+	/** the number of bytes from the \c new to the instruction after the \c toString() */
+	bvm_uint32_t length;
+
+	/** the number of values */
+	bvm_uint32_t count;
+
+	/** where each value comes from - an \c EXEC_CONCAT_FROM_xxx value */
+	bvm_uint8_t sources[EXEC_CONCAT_MAX_VALUES];
+
+	/** the type of each value, as given to #bvm_string_concat */
+	bvm_uint8_t types[EXEC_CONCAT_MAX_VALUES];
+
+	/** the local variable index, constant pool index, or the int itself, of each value */
+	bvm_int32_t operands[EXEC_CONCAT_MAX_VALUES];
+
+} bvm_concat_t;
+
+/**
+ * Whether the instruction at a given pc invokes a given method of a given clazz.  The method descriptor need only
+ * start with \c desc.
+ *
+ * @param clazz the clazz of the method the instruction is in
+ * @param pc the address of the instruction
+ * @param opcode the (unquickened) invoke opcode expected
+ * @param clazzname the clazz of the method expected
+ * @param name the name of the method expected
+ * @param desc the start of the descriptor of the method expected
+ *
+ * @return #BVM_TRUE if so, #BVM_FALSE otherwise
+ */
+static bvm_bool_t exec_concat_is_invoke(bvm_instance_clazz_t *clazz, bvm_uint8_t *pc, bvm_uint8_t opcode,
+										bvm_utfstring_t *clazzname, char *name, char *desc) {
+
+	bvm_uint16_t index = BVM_VM2UINT16(pc+1);
+	bvm_utfstring_t name_str = bvm_str_wrap_utfstring(name);
+	bvm_utfstring_t *sig;
+	size_t desc_length = strlen(desc);
+
+	if (bvm_exec_unquickened_opcode(*pc) != opcode) return BVM_FALSE;
+
+	/* the names of a method ref are kept when it is resolved */
+	sig = bvm_clazz_cp_ref_sig(clazz, index);
+
+	return (bvm_str_utfstringcmp(bvm_clazz_cp_ref_clazzname(clazz, index), clazzname) == 0) &&
+		   (bvm_str_utfstringcmp(bvm_clazz_cp_ref_name(clazz, index), &name_str) == 0) &&
+		   (sig->length >= desc_length) && (memcmp(sig->data, desc, desc_length) == 0);
+}
+
+/**
+ * Tries to recognise the string concatenation idiom that javac compiles \c a+b+c to, at the \c new of a
+ * \c StringBuilder or \c StringBuffer:
+ *
+ * <pre>
+ *    new, dup, invokespecial &lt;init&gt;()V,
+ *    (a single load, invokevirtual append(...))...,
+ *    invokevirtual toString()
+ * </pre>
+ *
+ * If it is recognised, a concatenation is placed at the head of the method's list of them.  The concatenation is
+ * from the heap, so this may GC.
+ *
+ * @param method the method
+ * @param pc the address of the \c new opcode
+ * @param new_clazz the clazz the \c new creates
+ *
+ * @return #BVM_TRUE if the idiom was recognised, #BVM_FALSE otherwise.
+ */
+static bvm_bool_t exec_concat_build(bvm_method_t *method, bvm_uint8_t *pc, bvm_instance_clazz_t *new_clazz) {
+
+	bvm_utfstring_t builder = bvm_str_wrap_utfstring("java/lang/StringBuilder");
+	bvm_utfstring_t buffer = bvm_str_wrap_utfstring("java/lang/StringBuffer");
+	bvm_instance_clazz_t *clazz = method->clazz;
+	bvm_utfstring_t *clazzname = new_clazz->name;
+	bvm_uint8_t *code = pc + 7;
+	bvm_concat_t concat, *copy;
+	bvm_uint8_t opcode;
+	bvm_uint16_t index;
+	bvm_bool_t is_string;
+
+	if ( (bvm_str_utfstringcmp(clazzname, &builder) != 0) && (bvm_str_utfstringcmp(clazzname, &buffer) != 0) )
+		return BVM_FALSE;
+
+	if ( (bvm_exec_unquickened_opcode(pc[3]) != OPCODE_dup) ||
+		 !exec_concat_is_invoke(clazz, pc+4, OPCODE_invokespecial, clazzname, "<init>", "()V") )
+		return BVM_FALSE;
+
+	concat.count = 0;
+
+	while (!exec_concat_is_invoke(clazz, code, OPCODE_invokevirtual, clazzname, "toString", "()Ljava/lang/String;")) {
+
+		if (concat.count == EXEC_CONCAT_MAX_VALUES) return BVM_FALSE;
+
+		opcode = bvm_exec_unquickened_opcode(*code);
+		is_string = BVM_FALSE;
+
+		switch (opcode) {
+			case OPCODE_aload:
+				is_string = BVM_TRUE;
+				/* no break */
+			case OPCODE_iload:
+				concat.sources[concat.count] = EXEC_CONCAT_FROM_LOCAL;
+				concat.operands[concat.count] = code[1];
+				code += 2;
+				break;
+			case OPCODE_aload_0:
+			case OPCODE_aload_1:
+			case OPCODE_aload_2:
+			case OPCODE_aload_3:
+				is_string = BVM_TRUE;
+				concat.sources[concat.count] = EXEC_CONCAT_FROM_LOCAL;
+				concat.operands[concat.count] = opcode - OPCODE_aload_0;
+				code++;
+				break;
+			case OPCODE_iload_0:
+			case OPCODE_iload_1:
+			case OPCODE_iload_2:
+			case OPCODE_iload_3:
+				concat.sources[concat.count] = EXEC_CONCAT_FROM_LOCAL;
+				concat.operands[concat.count] = opcode - OPCODE_iload_0;
+				code++;
+				break;
+			case OPCODE_iconst_m1:
+			case OPCODE_iconst_0:
+			case OPCODE_iconst_1:
+			case OPCODE_iconst_2:
+			case OPCODE_iconst_3:
+			case OPCODE_iconst_4:
+			case OPCODE_iconst_5:
+				concat.sources[concat.count] = EXEC_CONCAT_FROM_LITERAL;
+				concat.operands[concat.count] = opcode - OPCODE_iconst_0;
+				code++;
+				break;
+			case OPCODE_bipush:
+				concat.sources[concat.count] = EXEC_CONCAT_FROM_LITERAL;
+				concat.operands[concat.count] = (bvm_int8_t) code[1];
+				code += 2;
+				break;
+			case OPCODE_sipush:
+				concat.sources[concat.count] = EXEC_CONCAT_FROM_LITERAL;
+				concat.operands[concat.count] = BVM_VM2INT16(code+1);
+				code += 3;
+				break;
+			case OPCODE_ldc:
+			case OPCODE_ldc_w:
+				index = (opcode == OPCODE_ldc) ? code[1] : BVM_VM2UINT16(code+1);
+				/* a constant String or int - they are in the constant pool from when the clazz was loaded */
+				if (BVM_CONSTANT_Tag(clazz, index) == BVM_CONSTANT_String)
+					is_string = BVM_TRUE;
+				else if (BVM_CONSTANT_Tag(clazz, index) != BVM_CONSTANT_Integer)
+					return BVM_FALSE;
+				concat.sources[concat.count] = EXEC_CONCAT_FROM_CONSTANT;
+				concat.operands[concat.count] = index;
+				code += (opcode == OPCODE_ldc) ? 2 : 3;
+				break;
+			default:
+				return BVM_FALSE;
+		}
+
+		/* the append() overload must suit what was loaded */
+		if (is_string) {
+			if (!exec_concat_is_invoke(clazz, code, OPCODE_invokevirtual, clazzname, "append", "(Ljava/lang/String;)"))
+				return BVM_FALSE;
+			concat.types[concat.count] = BVM_T_OBJECT;
+		} else if (exec_concat_is_invoke(clazz, code, OPCODE_invokevirtual, clazzname, "append", "(I)")) {
+			concat.types[concat.count] = BVM_T_INT;
+		} else if (exec_concat_is_invoke(clazz, code, OPCODE_invokevirtual, clazzname, "append", "(C)")) {
+			concat.types[concat.count] = BVM_T_CHAR;
+		} else if (exec_concat_is_invoke(clazz, code, OPCODE_invokevirtual, clazzname, "append", "(Z)")) {
+			concat.types[concat.count] = BVM_T_BOOLEAN;
+		} else {
+			return BVM_FALSE;
+		}
+
+		code += 3;
+		concat.count++;
+	}
+
+	/* nothing to concatenate - not what javac gives */
+	if (concat.count == 0) return BVM_FALSE;
+
+	concat.pc_index = (bvm_uint32_t) (pc - method->code.bytecode);
+	concat.length = (bvm_uint32_t) (code + 3 - pc);
+
+	copy = bvm_heap_alloc(sizeof(bvm_concat_t), BVM_ALLOC_TYPE_METADATA);
+	memcpy(copy, &concat, sizeof(bvm_concat_t));
+
+	copy->next = method->concats;
+	method->concats = copy;
+
+	return BVM_TRUE;
+}
+
+/**
+ * Gives the recognised string concatenation at a given pc.
+ *
+ * @param method the method
+ * @param pc the address of the \c new opcode
+ *
+ * @return the concatenation
+ */
+static bvm_concat_t *exec_concat_get(bvm_method_t *method, bvm_uint8_t *pc) {
+
+	bvm_uint32_t pc_index = (bvm_uint32_t) (pc - method->code.bytecode);
+	bvm_concat_t *concat = method->concats;
+
+	while (concat->pc_index != pc_index) concat = concat->next;
+
+	return concat;
+}
+
+/**
+ * Runs a recognised string concatenation.
+ *
+ * @param concat the concatenation
+ * @param clazz the clazz of the method it is in
+ * @param locals the local variables of the method
+ *
+ * @return the String that the \c toString() would have given
+ */
+static bvm_string_obj_t *exec_concat_run(bvm_concat_t *concat, bvm_instance_clazz_t *clazz, bvm_cell_t *locals) {
+
+	bvm_cell_t values[EXEC_CONCAT_MAX_VALUES];
+	bvm_uint32_t lc;
+
+	for (lc = 0; lc < concat->count; lc++) {
+		switch (concat->sources[lc]) {
+			case EXEC_CONCAT_FROM_LOCAL:
+				values[lc] = locals[concat->operands[lc]];
+				break;
+			case EXEC_CONCAT_FROM_CONSTANT:
+				values[lc] = clazz->constant_pool[concat->operands[lc]].data.value;
+				break;
+			default:
+				values[lc].int_value = concat->operands[lc];
+		}
+	}
+
+	return bvm_string_concat(values, concat->types, concat->count);
+}
+
+/**
+ * Frees the recognised string concatenations of a method.  Called as its clazz is unloaded.
+ *
+ * @param method the method
+ */
+void bvm_exec_concats_free(bvm_method_t *method) {
+
+	bvm_concat_t *concat = method->concats;
+	bvm_concat_t *next;
+
+	while (concat != NULL) {
+		next = concat->next;
+		bvm_heap_free(concat);
+		concat = next;
+	}
+
+	method->concats = NULL;
+}
+
+/*
+ * Whether a recognised string concatenation may be run in one go.  A debugger must see every instruction of a thread
+ * it is stepping, and every breakpoint - a breakpoint on any byte of the idiom, even an operand that happens to have
+ * the same value as the opcode, has it run as bytecode.
+ */
+#if BVM_DEBUGGER_ENABLE
+#define EXEC_CONCAT_IS_WHOLE(c) \
+	( !bvm_gl_thread_current->dbg_is_stepping && (memchr(bvm_gl_rx_pc + 1, OPCODE_breakpoint, (c)->length - 1) == NULL) )
+#else
+#define EXEC_CONCAT_IS_WHOLE(c) BVM_TRUE
+#endif
+
+#endif
+
+#if (BVM_VM_SNAPSHOT_ENABLE && (BVM_EXEC_SWITCH_TABLES_ENABLE || BVM_EXEC_STRING_CONCAT_ENABLE))
+
+/**
+ * Map the switch tables and string concatenations of a method for a VM snapshot being written - each holds just the
+ * link to the next.  See #bvm_snapshot_map_data.
+ *
+ * @param method the method
+ */
+void bvm_exec_snapshot_map(bvm_method_t *method) {
+
+#if BVM_EXEC_SWITCH_TABLES_ENABLE
+	bvm_switch_table_t *table;
+#endif
+#if BVM_EXEC_STRING_CONCAT_ENABLE
+	bvm_concat_t *concat;
+#endif
+
+#if BVM_EXEC_SWITCH_TABLES_ENABLE
+	for (table = method->switch_tables; table != NULL; table = table->next) {
+		bvm_snapshot_map_data(table);
+		bvm_snapshot_map_pointer(&table->next);
+	}
+#endif
+
+#if BVM_EXEC_STRING_CONCAT_ENABLE
+	for (concat = method->concats; concat != NULL; concat = concat->next) {
+		bvm_snapshot_map_data(concat);
+		bvm_snapshot_map_pointer(&concat->next);
+	}
+#endif
+}
+
+#endif
+
+#if BVM_EXEC_INTRINSICS_ENABLE
+
+/**
+ * A native method that the interpreter runs inline.
+ */
+typedef struct _bvmexecintrinsicstruct {
+
+	/** the name of the clazz of the method */
+	char *clazzname;
+
+	/** the name of the method */
+	char *name;
+
+	/** the JNI signature of the method */
+	char *desc;
+
+	/** the \c BVM_EXEC_INTRINSIC_ value of the method */
+	bvm_uint8_t intrinsic;
+
+} bvm_exec_intrinsic_t;
+
+/** The intrinsic methods */
+static const bvm_exec_intrinsic_t exec_intrinsics[] = {
+	{ "java/lang/String", "charAt",    "(I)C",                  BVM_EXEC_INTRINSIC_STRING_CHARAT },
+	{ "java/lang/String", "hashCode",  "()I",                   BVM_EXEC_INTRINSIC_STRING_HASHCODE },
+	{ "java/lang/String", "equals",    "(Ljava/lang/Object;)Z", BVM_EXEC_INTRINSIC_STRING_EQUALS },
+#if BVM_FLOAT_ENABLE
+	{ "java/lang/Math",   "sqrt",      "(D)D",                  BVM_EXEC_INTRINSIC_MATH_SQRT },
+#endif
+	{ "java/lang/System", "arraycopy", "(Ljava/lang/Object;ILjava/lang/Object;II)V", BVM_EXEC_INTRINSIC_SYSTEM_ARRAYCOPY },
+#if BVM_NATIVE_BOX_CACHE_ENABLE
+	{ "java/lang/Integer",   "valueOf", "(I)Ljava/lang/Integer;",   BVM_EXEC_INTRINSIC_INTEGER_VALUEOF },
+	{ "java/lang/Character", "valueOf", "(C)Ljava/lang/Character;", BVM_EXEC_INTRINSIC_CHARACTER_VALUEOF }
+#endif
+};
+
+/**
+ * Gives the intrinsic of a native method, if it is one.  Called as the method is linked.  A call site that resolves
+ * to an intrinsic method is quickened to \c invokestatic_intrinsic or \c invokevirtual_intrinsic.  These run the
+ * method inline in the interpreter loop with no native method frame.
+ *
+ * @param method the native method
+ *
+ * @return the method's \c BVM_EXEC_INTRINSIC_ value, or #BVM_EXEC_INTRINSIC_NONE.
+ */
+bvm_uint8_t bvm_exec_intrinsic_get(bvm_method_t *method) {
+
+	bvm_utfstring_t clazzname, name, desc;
+	int lc;
+
+	for (lc = sizeof(exec_intrinsics) / sizeof(bvm_exec_intrinsic_t); lc--;) {
+
+		clazzname = bvm_str_wrap_utfstring(exec_intrinsics[lc].clazzname);
+		name = bvm_str_wrap_utfstring(exec_intrinsics[lc].name);
+		desc = bvm_str_wrap_utfstring(exec_intrinsics[lc].desc);
+
+		if ( (bvm_str_utfstringcmp(&name, method->name) == 0) &&
+			 (bvm_str_utfstringcmp(&desc, method->jni_signature) == 0) &&
+			 (bvm_str_utfstringcmp(&clazzname, method->clazz->name) == 0) )
+			return exec_intrinsics[lc].intrinsic;
+	}
+
+	return BVM_EXEC_INTRINSIC_NONE;
+}
+
+#endif
+
+/**
+ * Gives the standard Java opcode that a fast opcode was substituted for.  Any other opcode is returned as is.
+ *
+ * @param opcode the opcode
+ *
+ * @return the original opcode
+ */
+bvm_uint8_t bvm_exec_unquickened_opcode(bvm_uint8_t opcode) {
+
+	switch (opcode) {
+		case OPCODE_ldc_fast_1:
+		case OPCODE_ldc_fast_2:
+			return OPCODE_ldc;
+		case OPCODE_ldc_w_fast_1:
+		case OPCODE_ldc_w_fast_2:
+			return OPCODE_ldc_w;
+		case OPCODE_getstatic_fast:
+		case OPCODE_getstatic_fast_long:
+		case OPCODE_245_getstatic_fast_constant:
+			return OPCODE_getstatic;
+		case OPCODE_putstatic_fast:
+		case OPCODE_putstatic_fast_long:
+			return OPCODE_putstatic;
+		case OPCODE_getfield_fast:
+		case OPCODE_getfield_fast_long:
+		case OPCODE_243_getfield_fast_packed:
+			return OPCODE_getfield;
+		case OPCODE_putfield_fast:
+		case OPCODE_putfield_fast_long:
+		case OPCODE_244_putfield_fast_packed:
+			return OPCODE_putfield;
+		case OPCODE_new_fast:
+		case OPCODE_248_new_concat:
+			return OPCODE_new;
+		case OPCODE_229_invokestatic_fast:
+			return OPCODE_invokestatic;
+		case OPCODE_230_invokespecial_fast:
+			return OPCODE_invokespecial;
+		case OPCODE_231_invokeinterface_fast:
+			return OPCODE_invokeinterface;
+		case OPCODE_232_invokevirtual_fast:
+			return OPCODE_invokevirtual;
+		case OPCODE_233_aload_0_getfield:
+			return OPCODE_aload_0;
+		case OPCODE_234_iload_iload:
+		case OPCODE_235_iload_iload_if_icmp:
+			return OPCODE_iload;
+		case OPCODE_236_aload_arraylength:
+			return OPCODE_aload;
+		case OPCODE_237_invokestatic_intrinsic:
+			return OPCODE_invokestatic;
+		case OPCODE_238_invokevirtual_intrinsic:
+		case OPCODE_239_invokevirtual_getter:
+		case OPCODE_240_invokevirtual_setter:
+			return OPCODE_invokevirtual;
+		case OPCODE_241_invokespecial_getter:
+		case OPCODE_242_invokespecial_setter:
+			return OPCODE_invokespecial;
+		case OPCODE_246_tableswitch_fast:
+			return OPCODE_tableswitch;
+		case OPCODE_247_lookupswitch_fast:
+			return OPCODE_lookupswitch;
+	}
+
+	return opcode;
+}
+
+#if (BVM_EXEC_SUPERINSTRUCTIONS || BVM_DEBUGGER_BYTECODES_ENABLE || BVM_JIT_ENABLE || BVM_AOT_ENABLE || BVM_GC_STACK_MAPS_ENABLE || \
+	 BVM_EXEC_REGISTER_IR_ENABLE)
+
+/**
+ * The length in bytes of each standard Java opcode up to \c jsr_w, including operands.  Zero for the variable length
+ * \c tableswitch, \c lookupswitch and \c wide opcodes.
+ */
+static const bvm_uint8_t exec_opcode_lengths[OPCODE_jsr_w + 1] = {
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,		/*   0 - 15  */
+	2, 3, 2, 3, 3, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1,		/*  16 - 31  */
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,		/*  32 - 47  */
+	1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1,		/*  48 - 63  */
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,		/*  64 - 79  */
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,		/*  80 - 95  */
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,		/*  96 - 111 */
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,		/* 112 - 127 */
+	1, 1, 1, 1, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,		/* 128 - 143 */
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 3, 3, 3, 3, 3, 3, 3,		/* 144 - 159 */
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 2, 0, 0, 1, 1, 1, 1,		/* 160 - 175 */
+	1, 1, 3, 3, 3, 3, 3, 3, 3, 5, 5, 3, 2, 3, 1, 1,		/* 176 - 191 */
+	3, 3, 1, 1, 0, 4, 3, 3, 5, 5						/* 192 - 201 */
+};
+
+/**
+ * Gives the length in bytes of the instruction at a given offset in some bytecode.
+ *
+ * @param code the bytecode
+ * @param pc_index the offset of the instruction
+ * @param opcode the standard Java opcode of the instruction
+ *
+ * @return the instruction length
+ */
+bvm_uint32_t bvm_exec_instruction_length(bvm_uint8_t *code, bvm_uint32_t pc_index, bvm_uint8_t opcode) {
+
+	/* switch operands are aligned to 4 bytes from the method start */
+	bvm_uint32_t pad = 3 - (pc_index & 3);
+	bvm_uint8_t *operands = code + pc_index + 1 + pad;
+
+	switch (opcode) {
+		case OPCODE_tableswitch:
+			return 1 + pad + 12 + 4 * (BVM_VM2INT32(operands+8) - BVM_VM2INT32(operands+4) + 1);
+		case OPCODE_lookupswitch:
+			return 1 + pad + 8 + 8 * BVM_VM2INT32(operands+4);
+		case OPCODE_wide:
+			return (code[pc_index+1] == OPCODE_iinc) ? 6 : 4;
+	}
+
+	return (opcode <= OPCODE_jsr_w) ? exec_opcode_lengths[opcode] : 1;
+}
+
+#endif
+
+#if BVM_EXEC_SUPERINSTRUCTIONS
+
+/**
+ * Rewrites the first opcode of each bytecode sequence selected by #BVM_EXEC_SUPERINSTRUCTIONS to the superinstruction
+ * opcode that does the whole sequence.  Called as a method's bytecode is loaded, before any of it has been executed,
+ * so all opcodes are still the standard ones.  Only the first opcode is touched - the others keep their opcode and
+ * operands, so a branch to them, a breakpoint on them, or fast substitution of them all still work.
+ *
+ * @param code the method bytecode
+ * @param code_length the length of the bytecode
+ */
+void bvm_exec_fuse_superinstructions(bvm_uint8_t *code, bvm_uint32_t code_length) {
+
+	bvm_uint32_t pc_index = 0;
+
+	while (pc_index < code_length) {
+
+		bvm_uint8_t opcode = code[pc_index];
+		bvm_uint32_t length = bvm_exec_instruction_length(code, pc_index, opcode);
+		bvm_uint32_t next_index;
+		bvm_uint8_t next_opcode;
+
+		/* being defensive - stop on anything that runs off the end of the method */
+		if ( (length == 0) || (length >= code_length - pc_index) ) break;
+
+		next_index = pc_index + length;
+
+		next_opcode = code[next_index];
+
+		switch (opcode) {
+#if (BVM_EXEC_SUPERINSTRUCTIONS & BVM_EXEC_SUPERINSTRUCTION_ALOAD_0_GETFIELD)
+			case OPCODE_aload_0:
+				if (next_opcode == OPCODE_getfield) code[pc_index] = OPCODE_233_aload_0_getfield;
+				break;
+#endif
+#if (BVM_EXEC_SUPERINSTRUCTIONS & (BVM_EXEC_SUPERINSTRUCTION_ILOAD_ILOAD | BVM_EXEC_SUPERINSTRUCTION_ILOAD_ILOAD_IF_ICMP))
+			case OPCODE_iload:
+				if (next_opcode == OPCODE_iload) {
+#if (BVM_EXEC_SUPERINSTRUCTIONS & BVM_EXEC_SUPERINSTRUCTION_ILOAD_ILOAD_IF_ICMP)
+					if ( (next_index + 2 < code_length) &&
+						 (code[next_index+2] >= OPCODE_if_icmpeq) &&
+						 (code[next_index+2] <= OPCODE_if_icmple) ) {
+						code[pc_index] = OPCODE_235_iload_iload_if_icmp;
+						break;
+					}
+#endif
+#if (BVM_EXEC_SUPERINSTRUCTIONS & BVM_EXEC_SUPERINSTRUCTION_ILOAD_ILOAD)
+					code[pc_index] = OPCODE_234_iload_iload;
+#endif
+				}
+				break;
+#endif
+#if (BVM_EXEC_SUPERINSTRUCTIONS & BVM_EXEC_SUPERINSTRUCTION_ALOAD_ARRAYLENGTH)
+			case OPCODE_aload:
+				if (next_opcode == OPCODE_arraylength) code[pc_index] = OPCODE_236_aload_arraylength;
+				break;
+#endif
+		}
+
+		pc_index = next_index;
+	}
+}
+
+#endif
+
+#if BVM_EXEC_FAST_THROW_ENABLE
+
+/**
+ * Creates a runtime exception raised by the interpreter loop itself.  It is created like any other VM exception, but is
+ * handed straight to the \c athrow handling rather than being thrown, so it is not marked as needing the interpreter's
+ * native try block to be reset.
  *
- * @param search_clazz the starting instance clazz for the search
- * @param resolved_method a method to search for a match.
+ * @param exception_clazz_name the class name of the exception to create.
+ * @param msg the message text for the exception.  May be \c NULL.
  *
- * @return the bvm_method_t method if one if found, or NULL otherwise.
+ * @return a new throwable object
+ *
+ * @throw any exception to do with class loading and object creation.
  */
-static bvm_method_t *locate_virtual_method(bvm_instance_clazz_t *search_clazz, bvm_method_t *resolved_method) {
+static bvm_throwable_obj_t *exec_create_exception(const char *exception_clazz_name, const char *msg) {
+	bvm_throwable_obj_t *throwable = bvm_create_exception_c(exception_clazz_name, msg);
+	throwable->needs_native_try_reset.int_value = BVM_FALSE;
+	return throwable;
+}
 
-	bvm_utfstring_t *method_name = resolved_method->name;
-	bvm_utfstring_t *method_sig  = resolved_method->jni_signature;
+#else
 
-	bvm_method_t *virtual_method;
+static void throw_array_index_bounds_exception() {
+    bvm_throw_exception(BVM_ERR_ARRAY_INDEX_OUT_OF_BOUNDS_EXCEPTION, NULL);
+}
 
-	/* JVMS invokevirtual opcode docs: "Let C be the class of ref_value. If C contains a
-	 * declaration for an instance method with the same name and desc as the
-	 * resolved method, and the resolved method is accessible from C, then this is
-	 * the method to be invoked, and the lookup procedure terminates". */
+static void throw_null_pointer_exception() {
+    bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+}
 
-	do {
+#endif
 
-		virtual_method = bvm_clazz_method_get(search_clazz, method_name, method_sig, (BVM_METHOD_SEARCH_CLAZZ | BVM_METHOD_SEARCH_SUPERS) );
+#if BVM_EXEC_IMPLICIT_NULL_CHECKS_ENABLE
 
-		/* we have found a matching method - note that this method may actually not be in
-		 * the search_clazz, it may have been found in one of its superclasses ....*/
-		if (virtual_method != NULL) {
+/**
+ * Where the interpreter is while it reads the first word of an object that may be null - see EXEC_NULL_CHECK.  The
+ * \c pc is \c NULL at any other time, so a fault elsewhere is not taken for a null dereference.
+ */
+typedef struct _bvmexecnulltrapstruct {
 
-			/* if the resolved method is visible to the found invoke method (which
-			 * implies it is an override) we have found our method.  The 'public' check here is
-			 * redundant - it is also checked in bvm_clazz_is_member_accessible - but it is just to
-			 * avoid the function call overhead as most methods are public ..*/
-			if (BVM_ACCESS_IsPublic(BVM_METHOD_AccessFlags(resolved_method)) ||
-					bvm_clazz_is_member_accessible(BVM_METHOD_AccessFlags(resolved_method), virtual_method->clazz, (bvm_instance_clazz_t *) resolved_method->clazz)) {
-				return virtual_method;
-			}
+	/** the pc of the bytecode reading the object */
+	bvm_uint8_t *pc;
 
-			/* ... otherwise, try the superclazz - note we are trying the superclazz of the clazz the
-			 * found invoke method was located in, not the superclazz of the last clazz searched. */
-			search_clazz = virtual_method->clazz->super_clazz;
-		}
+	/** the stack pointer at the bytecode */
+	bvm_cell_t *sp;
 
-	} while (search_clazz != NULL && virtual_method != NULL);
+} bvm_exec_null_trap_t;
 
-	bvm_throw_exception(BVM_ERR_NO_SUCH_METHOD_ERROR, (char *) method_name->data);
+static BVM_VM_LOCAL volatile bvm_exec_null_trap_t exec_null_trap = { NULL, NULL };
 
-	/* never reached */
-	return NULL;
+/**
+ * Called by the platform fault handler for a fault on the first page of memory.  If the interpreter was reading an
+ * object that may be null, the registers are set back to the bytecode that read it and a \c NullPointerException is
+ * thrown from there.  The fault is synchronous and happens between bytecodes' worth of plain loads and stores, so the
+ * VM is in the same state as if the bytecode had tested the reference itself.
+ */
+static void exec_null_trap_fault() {
+
+	if (exec_null_trap.pc == NULL) return;
+
+	bvm_gl_rx_pc = exec_null_trap.pc;
+	bvm_gl_rx_sp = exec_null_trap.sp;
+	exec_null_trap.pc = NULL;
+
+	bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
 }
 
-static void throw_array_index_bounds_exception() {
-    bvm_throw_exception(BVM_ERR_ARRAY_INDEX_OUT_OF_BOUNDS_EXCEPTION, NULL);
+/**
+ * Installs the platform fault handler that turns null dereferences by the interpreter into exceptions.  The VM exits
+ * if it cannot be installed - the quickened opcodes do not test for null themselves.
+ */
+void bvm_exec_null_trap_start() {
+	if (!bvm_pd_system_null_trap_start(exec_null_trap_fault))
+		BVM_VM_EXIT(BVM_FATAL_ERR_NULL_TRAP_NOT_INSTALLED, NULL);
 }
 
-static void throw_null_pointer_exception() {
-    bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+/**
+ * Removes the platform fault handler installed by #bvm_exec_null_trap_start.
+ */
+void bvm_exec_null_trap_stop() {
+	bvm_pd_system_null_trap_stop();
 }
 
+#endif
+
 static void throw_unsupported_feature_exception_float() {
     bvm_throw_exception(BVM_ERR_INTERNAL_ERROR, "float not supported");
 }
@@ -332,6 +1885,70 @@ void bvm_exec_run() {
 	bvm_uint8_t opcode;
 #endif
 
+#if BVM_NI_LOCAL_ARENA_ENABLE
+	/* the NI local memory arena of a native called from this loop is released back to here */
+	bvm_ni_arena_t * const ni_arena_mark = bvm_gl_ni_arena;
+#endif
+
+#if BVM_USE_REGISTERS
+	/* the local registers, and where the global ones are */
+	bvm_uint8_t *rx_pc;
+	bvm_cell_t *rx_sp;
+	bvm_cell_t *rx_locals;
+	bvm_uint8_t **exec_gl_pc = &bvm_gl_rx_pc;
+	bvm_cell_t **exec_gl_sp = &bvm_gl_rx_sp;
+	bvm_cell_t **exec_gl_locals = &bvm_gl_rx_locals;
+
+	/* from here to the end of the function the register names are the local registers */
+#define bvm_gl_rx_pc rx_pc
+#define bvm_gl_rx_sp rx_sp
+#define bvm_gl_rx_locals rx_locals
+
+	/* exceptions are thrown from the globals */
+#define throw_null_pointer_exception() (EXEC_STORE_REGISTERS, (throw_null_pointer_exception)())
+#define throw_array_index_bounds_exception() (EXEC_STORE_REGISTERS, (throw_array_index_bounds_exception)())
+#define throw_unsupported_feature_exception() (EXEC_STORE_REGISTERS, (throw_unsupported_feature_exception)())
+#define throw_unsupported_feature_exception_float() (EXEC_STORE_REGISTERS, (throw_unsupported_feature_exception_float)())
+#define bvm_throw_exception(e, m) (EXEC_STORE_REGISTERS, (bvm_throw_exception)(e, m))
+#endif
+
+	/* With BVM_EXEC_FAST_THROW_ENABLE, EXEC_THROW raises a runtime exception by going straight to the athrow
+	 * handling with it, otherwise it throws it natively */
+#if BVM_EXEC_FAST_THROW_ENABLE
+#define EXEC_THROW(e, m) { EXEC_STORE_REGISTERS; throwable = exec_create_exception(e, m); goto opcode_athrow; }
+#undef throw_null_pointer_exception
+#undef throw_array_index_bounds_exception
+#define throw_null_pointer_exception() EXEC_THROW(BVM_ERR_NULL_POINTER_EXCEPTION, NULL)
+#define throw_array_index_bounds_exception() EXEC_THROW(BVM_ERR_ARRAY_INDEX_OUT_OF_BOUNDS_EXCEPTION, NULL)
+#else
+#define EXEC_THROW(e, m) bvm_throw_exception(e, m)
+#endif
+
+	/* With BVM_SCOPED_MEMORY_ENABLE, EXEC_CHECK_SCOPED_STORE throws before a reference v is stored into h if that would
+	 * let an object outlive its scope (see scope.c) */
+#if BVM_SCOPED_MEMORY_ENABLE
+#define EXEC_CHECK_SCOPED_STORE(h, v) { 														\
+	if (BVM_SCOPE_IsEscape(h, v)) EXEC_THROW(BVM_ERR_ILLEGAL_STATE_EXCEPTION, "scoped object would escape its scope"); 	\
+}
+#else
+#define EXEC_CHECK_SCOPED_STORE(h, v) {}
+#endif
+
+	/* EXEC_NULL_CHECK throws a NullPointerException if an object reference o is null.  With
+	 * BVM_EXEC_IMPLICIT_NULL_CHECKS_ENABLE it does not test o - it reads the first word of the object with the registers
+	 * noted, and a null o faults (see exec_null_trap_fault).  The read is volatile, as are the notes, so that neither
+	 * may be moved past the other. */
+#if BVM_EXEC_IMPLICIT_NULL_CHECKS_ENABLE
+#define EXEC_NULL_CHECK(o) do {																	\
+	exec_null_trap.sp = bvm_gl_rx_sp;															\
+	exec_null_trap.pc = bvm_gl_rx_pc;															\
+	(void) *((void * volatile *) (o));															\
+	exec_null_trap.pc = NULL;																	\
+} while (0)
+#else
+#define EXEC_NULL_CHECK(o) do { if ((o) == NULL) throw_null_pointer_exception(); } while (0)
+#endif
+
 #if BVM_DIRECT_THREADING_ENABLE
 	void *opcode_labels[] = {
 			&&OPCODE_nop_label,
@@ -567,22 +2184,22 @@ void bvm_exec_run() {
 			&&OPCODE_230_invokespecial_fast_label,
 			&&OPCODE_231_invokeinterface_fast_label,
 			&&OPCODE_232_invokevirtual_fast_label,
-			&&OPCODE_233_label,
-			&&OPCODE_234_label,
-			&&OPCODE_235_label,
-			&&OPCODE_236_label,
-			&&OPCODE_237_label,
-			&&OPCODE_238_label,
-			&&OPCODE_239_label,
-			&&OPCODE_240_label,
-			&&OPCODE_241_label,
-			&&OPCODE_242_label,
-			&&OPCODE_243_label,
-			&&OPCODE_244_label,
-			&&OPCODE_245_label,
-			&&OPCODE_246_label,
-			&&OPCODE_247_label,
-			&&OPCODE_248_label,
+			&&OPCODE_233_aload_0_getfield_label,
+			&&OPCODE_234_iload_iload_label,
+			&&OPCODE_235_iload_iload_if_icmp_label,
+			&&OPCODE_236_aload_arraylength_label,
+			&&OPCODE_237_invokestatic_intrinsic_label,
+			&&OPCODE_238_invokevirtual_intrinsic_label,
+			&&OPCODE_239_invokevirtual_getter_label,
+			&&OPCODE_240_invokevirtual_setter_label,
+			&&OPCODE_241_invokespecial_getter_label,
+			&&OPCODE_242_invokespecial_setter_label,
+			&&OPCODE_243_getfield_fast_packed_label,
+			&&OPCODE_244_putfield_fast_packed_label,
+			&&OPCODE_245_getstatic_fast_constant_label,
+			&&OPCODE_246_tableswitch_fast_label,
+			&&OPCODE_247_lookupswitch_fast_label,
+			&&OPCODE_248_new_concat_label,
 			&&OPCODE_249_label,
 			&&OPCODE_250_label,
 			&&OPCODE_251_label,
@@ -592,8 +2209,27 @@ void bvm_exec_run() {
 			&&OPCODE_impdep2_label
 	};
 
+#if EXEC_DEBUG_DISPATCH
+	/* the dispatch table while a debugger session is open - every opcode leads to the debugger hook */
+	static BVM_VM_LOCAL void *exec_debug_labels[256];
+
+	/* the dispatch table in use, either the above or the plain opcode labels */
+	void **dispatch_labels;
+	int label_index;
+#endif
+
 #endif
 
+#if EXEC_DEBUG_DISPATCH
+	if (exec_debug_labels[0] == NULL) {
+		for (label_index = 0; label_index < 256; label_index++)
+			exec_debug_labels[label_index] = &&debugger_hook_label;
+	}
+#endif
+
+	/* start from the registers of the current thread */
+	EXEC_LOAD_REGISTERS;
+
 	/* we'll come back to this label after a native exception has been thrown and a handler PC located
 	 * for it. Coming back to this label means entering a new BVM_TRY block ready to catch
 	 * another native exception should one occur. */
@@ -601,6 +2237,11 @@ void bvm_exec_run() {
 
 	if (throwable != NULL) throwable->needs_native_try_reset.int_value = BVM_FALSE;
 
+#if EXEC_DEBUG_DISPATCH
+	/* a local that a native exception may have left stale - select it afresh */
+	EXEC_DEBUG_DISPATCH_SELECT
+#endif
+
 	BVM_TRY {
 
 		/* we'll come back to this label after a non-native exception has been dealt with - no need to
@@ -613,18 +2254,86 @@ void bvm_exec_run() {
 
 			top_of_interpreter_loop:
 
+#if BVM_THREAD_TIMER_PREEMPTION_ENABLE
+			/* a timer tick (or a forced switch) counts down the timeslice.  If the timeslice is spent, a thread
+			 * switch takes place */
+			if (bvm_gl_thread_switch_requested) {
+				bvm_gl_thread_switch_requested = BVM_FALSE;
+				if (--bvm_gl_thread_timeslice_counter <= 0) {
+					EXEC_STORE_REGISTERS;
+#if BVM_VM_SLICE_ENABLE
+					/* a spent slice returns to the host - the switch is made when the next slice starts */
+					if (bvm_gl_exec_slice_active && exec_slice_is_spent()) return;
+#endif
+#if BVM_GC_COMPACTION_ENABLE
+					if (bvm_gl_gc_compact_pending) bvm_gc_compact();
+#endif
+					bvm_thread_switch();
+#if BVM_VM_SLICE_ENABLE
+					/* with every thread waiting the slice returns to the host rather than sleep */
+					if (bvm_gl_exec_slice_active) {
+						if (bvm_gl_exec_slice_idle) return;
+						exec_slice_grant();
+					}
+#endif
+					EXEC_LOAD_REGISTERS;
+				}
+
+				/* the compiled code may have stopped to look at the switch request */
+				EXEC_AOT_RESUME;
+				EXEC_JIT_RESUME;
+				EXEC_IR_SWITCHED;
+			}
+
+			next_opcode:
+#else
 			/* the thread switch counter check.  If the counter is zero, a thread switch takes place */
 			if (bvm_gl_thread_timeslice_counter-- == 0) {
+				EXEC_STORE_REGISTERS;
+#if BVM_VM_SLICE_ENABLE
+				/* a spent slice returns to the host - the switch is made when the next slice starts */
+				if (bvm_gl_exec_slice_active && exec_slice_is_spent()) return;
+#endif
+#if BVM_GC_COMPACTION_ENABLE
+				/* between bytecodes no VM 'C' code holds a heap pointer - arrays may be moved */
+				if (bvm_gl_gc_compact_pending) bvm_gc_compact();
+#endif
 				bvm_thread_switch();
+#if BVM_VM_SLICE_ENABLE
+				/* with every thread waiting the slice returns to the host rather than sleep */
+				if (bvm_gl_exec_slice_active) {
+					if (bvm_gl_exec_slice_idle) return;
+					exec_slice_grant();
+				}
+#endif
+				EXEC_LOAD_REGISTERS;
+
+				/* the thread switched to may be in a translated or compiled method */
+				EXEC_AOT_RESUME;
+				EXEC_JIT_RESUME;
+				EXEC_IR_SWITCHED;
 			}
+#endif
+
+			BVM_PROFILER_COUNT_BYTECODE(bvm_gl_rx_method);
+			BVM_PROFILER_COUNT_OPCODE(*bvm_gl_rx_pc)
 
 #if BVM_DEBUGGER_ENABLE
 
 			/* exec loop debugger support. */
 
+#if EXEC_DEBUG_DISPATCH
+			/* with no debugger session this goes straight to the opcode, otherwise to the debugger hook */
+			goto *dispatch_labels[opcode = *bvm_gl_rx_pc];
+
+			debugger_hook_label:
+#endif
+
 			/* only be concerned with debugger stuff in the exec loop if we are actually attached to a debugger */
 			if (bvmd_is_session_open()) {
 
+				EXEC_STORE_REGISTERS;
+
 				/* if the current thread was just at a breakpoint, reset the next opcode to be the
 				 * one the debug breakpoint opcode has displaced. */
 				if (bvm_gl_thread_current->dbg_is_at_breakpoint) {
@@ -653,8 +2362,9 @@ void bvm_exec_run() {
 						/* boolean to hold whether we should do a step event or not - set in the following code */
 						bvm_bool_t do_step_event = BVM_FALSE;
 
-						/* calculate the change in the stack depth from the last stepped-to bytecode  */
-						int stack_depth_delta = bvm_stack_get_depth(bvm_gl_thread_current) - bvm_gl_thread_current->dbg_step.stack_depth;
+						/* calculate the change in the stack depth from the last stepped-to bytecode - the frame count
+						 * register is kept by frame push/pop, so there is no need to walk the stack to get it */
+						int stack_depth_delta = (int) bvm_gl_rx_depth - (int) bvm_gl_thread_current->dbg_step.stack_depth;
 
 						switch (bvm_gl_thread_current->dbg_step.depth) {
 
@@ -709,6 +2419,8 @@ void bvm_exec_run() {
 							 * return value informs us if we actually sent an event.  */
 							bvm_bool_t stepped = bvmd_event_SingleStep(context, at_breakpoint);
 
+							EXEC_LOAD_REGISTERS;
+
 							if (at_breakpoint) {
 
 								/* if we have single stepped and we are actually at a breakpoint opcode we
@@ -735,6 +2447,10 @@ void bvm_exec_run() {
 					opcode = *bvm_gl_rx_pc;
 				}
 			} else {
+#if EXEC_DEBUG_DISPATCH
+				/* the session has closed - no more debugger hooks */
+				dispatch_labels = opcode_labels;
+#endif
 				opcode = *bvm_gl_rx_pc;
 			}
 
@@ -858,16 +2574,14 @@ void bvm_exec_run() {
 
 					if (BVM_CONSTANT_Tag(bvm_gl_rx_clazz, index) != BVM_CONSTANT_Class) {
 						bvm_gl_rx_sp[0] = bvm_gl_rx_clazz->constant_pool[index].data.value;
-#if (!BVM_DEBUGGER_ENABLE)
 						/* substitute a go-faster opcode */
-						*bvm_gl_rx_pc = OPCODE_ldc_fast_1;
-#endif
+						EXEC_QUICKEN(OPCODE_ldc_fast_1);
 					} else {
+						EXEC_STORE_REGISTERS;
 						bvm_gl_rx_sp[0].ref_value = (bvm_obj_t *) bvm_clazz_resolve_cp_clazz(bvm_gl_rx_clazz, index)->class_obj;
-#if (!BVM_DEBUGGER_ENABLE)
+						EXEC_LOAD_REGISTERS;
 						/* substitute a go-faster opcode */
-						*bvm_gl_rx_pc = OPCODE_ldc_fast_2;
-#endif
+						EXEC_QUICKEN(OPCODE_ldc_fast_2);
 					}
 					bvm_gl_rx_sp++;
 					bvm_gl_rx_pc += 2;
@@ -879,16 +2593,14 @@ void bvm_exec_run() {
 
 					if (BVM_CONSTANT_Tag(bvm_gl_rx_clazz, index) != BVM_CONSTANT_Class) {
 						bvm_gl_rx_sp[0] = bvm_gl_rx_clazz->constant_pool[index].data.value;
-#if (!BVM_DEBUGGER_ENABLE)
 						/* substitute a go-faster opcode */
-						*bvm_gl_rx_pc = OPCODE_ldc_w_fast_1;
-#endif
+						EXEC_QUICKEN(OPCODE_ldc_w_fast_1);
 					} else {
+						EXEC_STORE_REGISTERS;
 						bvm_gl_rx_sp[0].ref_value = (bvm_obj_t *) bvm_clazz_resolve_cp_clazz(bvm_gl_rx_clazz, index)->class_obj;
-#if (!BVM_DEBUGGER_ENABLE)
+						EXEC_LOAD_REGISTERS;
 						/* substitute a go-faster opcode */
-						*bvm_gl_rx_pc = OPCODE_ldc_w_fast_2;
-#endif
+						EXEC_QUICKEN(OPCODE_ldc_w_fast_2);
 					}
 					bvm_gl_rx_sp++;
 					bvm_gl_rx_pc += 3;
@@ -1046,9 +2758,7 @@ void bvm_exec_run() {
 					bvm_jarray_obj_t *array_obj = (bvm_jarray_obj_t *) bvm_gl_rx_sp[-2].ref_value;
 
 					/* what, no array ? */
-					if (array_obj == NULL) {
-					    throw_null_pointer_exception();
-					}
+					EXEC_NULL_CHECK(array_obj);
 
 					/* asking for a silly index? */
 					if ( (index < 0) || (index >= array_obj->length.int_value)) {
@@ -1066,9 +2776,7 @@ void bvm_exec_run() {
 					bvm_jarray_obj_t *array_obj = (bvm_jarray_obj_t *) bvm_gl_rx_sp[-2].ref_value;
 
 					/* what, no array ? */
-					if (array_obj == NULL) {
-					    throw_null_pointer_exception();
-					}
+					EXEC_NULL_CHECK(array_obj);
 
 					/* asking for a silly index? */
 					if ( (index < 0) || (index >= array_obj->length.int_value)) {
@@ -1088,9 +2796,7 @@ void bvm_exec_run() {
 					bvm_jarray_obj_t *array_obj = (bvm_jarray_obj_t *) bvm_gl_rx_sp[-2].ref_value;
 
 					/* what, no array ? */
-					if (array_obj == NULL) {
-					    throw_null_pointer_exception();
-					}
+					EXEC_NULL_CHECK(array_obj);
 
 					/* asking for a silly index? */
 					if ( (index < 0) || (index >= array_obj->length.int_value)) {
@@ -1112,9 +2818,7 @@ void bvm_exec_run() {
 					bvm_jarray_obj_t *array_obj = (bvm_jarray_obj_t *) bvm_gl_rx_sp[-2].ref_value;
 
 					/* what, no array ? */
-					if (array_obj == NULL) {
-					    throw_null_pointer_exception();
-					}
+					EXEC_NULL_CHECK(array_obj);
 
 					/* asking for a silly index? */
 					if ( (index < 0) || (index >= array_obj->length.int_value)) {
@@ -1136,16 +2840,14 @@ void bvm_exec_run() {
 					bvm_jarray_obj_t *array_obj = (bvm_jarray_obj_t *) bvm_gl_rx_sp[-2].ref_value;
 
 					/* what, no array ? */
-					if (array_obj == NULL) {
-					    throw_null_pointer_exception();
-					}
+					EXEC_NULL_CHECK(array_obj);
 
 					/* asking for a silly index? */
 					if ( (index < 0) || (index >= array_obj->length.int_value)) {
 					    throw_array_index_bounds_exception();
 					}
 
-					bvm_gl_rx_sp[-2].ref_value = ((bvm_instance_array_obj_t *) array_obj)->data[index];
+					bvm_gl_rx_sp[-2].ref_value = BVM_REF_Decode(((bvm_instance_array_obj_t *) array_obj)->data[index]);
 					bvm_gl_rx_sp--;
 					bvm_gl_rx_pc++;
 					OPCODE_NEXT;
@@ -1156,9 +2858,7 @@ void bvm_exec_run() {
 					bvm_jarray_obj_t *array_obj = (bvm_jarray_obj_t *) bvm_gl_rx_sp[-2].ref_value;
 
 					/* what, no array ? */
-					if (array_obj == NULL) {
-					    throw_null_pointer_exception();
-					}
+					EXEC_NULL_CHECK(array_obj);
 
 					/* asking for a silly index? */
 					if ( (index < 0) || (index >= array_obj->length.int_value)) {
@@ -1176,9 +2876,7 @@ void bvm_exec_run() {
 					bvm_jarray_obj_t *array_obj = (bvm_jarray_obj_t *) bvm_gl_rx_sp[-2].ref_value;
 
 					/* what, no array ? */
-					if (array_obj == NULL) {
-					    throw_null_pointer_exception();
-					}
+					EXEC_NULL_CHECK(array_obj);
 
 					/* asking for a silly index? */
 					if ( (index < 0) || (index >= array_obj->length.int_value)) {
@@ -1196,9 +2894,7 @@ void bvm_exec_run() {
 					bvm_jarray_obj_t *array_obj = (bvm_jarray_obj_t *) bvm_gl_rx_sp[-2].ref_value;
 
 					/* what, no array ? */
-					if (array_obj == NULL) {
-					    throw_null_pointer_exception();
-					}
+					EXEC_NULL_CHECK(array_obj);
 
 					/* asking for a silly index? */
 					if ( (index < 0) || (index >= array_obj->length.int_value)) {
@@ -1341,9 +3037,7 @@ void bvm_exec_run() {
 					bvm_int32_t index = bvm_gl_rx_sp[-2].int_value;
 
 					/* no array ? Nasty. */
-					if (array_obj == NULL) {
-					    throw_null_pointer_exception();
-					}
+					EXEC_NULL_CHECK(array_obj);
 
 					/* ensure index is in valid range */
 					if ( (index < 0) || (index >= array_obj->length.int_value)) {
@@ -1364,9 +3058,7 @@ void bvm_exec_run() {
 					bvm_int32_t index = bvm_gl_rx_sp[-3].int_value;
 
 					/* no array? Nasty. */
-					if (array_obj == NULL) {
-					    throw_null_pointer_exception();
-					}
+					EXEC_NULL_CHECK(array_obj);
 
 					/* ensure index is in valid range */
 					if ( (index < 0) || (index >= array_obj->length.int_value)) {
@@ -1389,9 +3081,7 @@ void bvm_exec_run() {
 					bvm_int32_t index = bvm_gl_rx_sp[-2].int_value;
 
 					/* no array ? Nasty. */
-					if (array_obj == NULL) {
-					    throw_null_pointer_exception();
-					}
+					EXEC_NULL_CHECK(array_obj);
 
 					/* ensure index is in valid range */
 					if ( (index < 0) || (index >= array_obj->length.int_value)) {
@@ -1415,9 +3105,7 @@ void bvm_exec_run() {
 					bvm_int32_t index = bvm_gl_rx_sp[-3].int_value;
 
 					/* no array? Nasty. */
-					if (array_obj == NULL) {
-					    throw_null_pointer_exception();
-					}
+					EXEC_NULL_CHECK(array_obj);
 
 					/* ensure index is in valid range */
 					if ( (index < 0) || (index >= array_obj->length.int_value)) {
@@ -1443,22 +3131,25 @@ void bvm_exec_run() {
 					bvm_int32_t index = bvm_gl_rx_sp[-2].int_value;
 
 					/* no array ? Nasty. */
-					if (array_obj == NULL) {
-					    throw_null_pointer_exception();
-					}
+					EXEC_NULL_CHECK(array_obj);
 
 					/* ensure index is in valid range */
 					if ( (index < 0) || (index >= array_obj->length.int_value)) {
 					    throw_array_index_bounds_exception();
 					}
 
-					/* before storing a reference type into an array we must check for assignment compatibility */
+					/* before storing a reference type into an array we must check for assignment compatibility.  Storing
+					 * an object of the array's own component clazz is by far the most common case. */
 					if ( (bvm_gl_rx_sp[-1].ref_value != NULL) &&
+						 (bvm_gl_rx_sp[-1].ref_value->clazz != array_obj->clazz->component_clazz) &&
 						 (!bvm_clazz_is_assignable_from(bvm_gl_rx_sp[-1].ref_value->clazz, array_obj->clazz->component_clazz)) ) {
-						bvm_throw_exception(BVM_ERR_ARRAYSTORE_EXCEPTION, NULL);
+						EXEC_THROW(BVM_ERR_ARRAYSTORE_EXCEPTION, NULL);
 					}
 
-					((bvm_instance_array_obj_t *) array_obj)->data[index] = bvm_gl_rx_sp[-1].ref_value;
+					EXEC_CHECK_SCOPED_STORE(array_obj, bvm_gl_rx_sp[-1].ref_value);
+
+					((bvm_instance_array_obj_t *) array_obj)->data[index] = BVM_REF_Encode(bvm_gl_rx_sp[-1].ref_value);
+					BVM_GC_WRITE_BARRIER(array_obj, bvm_gl_rx_sp[-1].ref_value);
 
 					bvm_gl_rx_sp -= 3;
 					bvm_gl_rx_pc++;
@@ -1473,9 +3164,7 @@ void bvm_exec_run() {
 					bvm_int32_t index = bvm_gl_rx_sp[-2].int_value;
 
 					/* no array ? Nasty. */
-					if (array_obj == NULL) {
-					    throw_null_pointer_exception();
-					}
+					EXEC_NULL_CHECK(array_obj);
 
 					/* ensure index is in valid range */
 					if ( (index < 0) || (index >= array_obj->length.int_value)) {
@@ -1496,9 +3185,7 @@ void bvm_exec_run() {
 					bvm_int32_t index = bvm_gl_rx_sp[-2].int_value;
 
 					/* no array ? Nasty. */
-					if (array_obj == NULL) {
-					    throw_null_pointer_exception();
-					}
+					EXEC_NULL_CHECK(array_obj);
 
 					/* ensure index is in valid range */
 					if ( (index < 0) || (index >= array_obj->length.int_value)) {
@@ -1519,9 +3206,7 @@ void bvm_exec_run() {
 					bvm_int32_t index = bvm_gl_rx_sp[-2].int_value;
 
 					/* no array ? Nasty. */
-					if (array_obj == NULL) {
-					    throw_null_pointer_exception();
-					}
+					EXEC_NULL_CHECK(array_obj);
 
 					/* ensure index is in valid range */
 					if ( (index < 0) || (index >= array_obj->length.int_value)) {
@@ -1711,7 +3396,7 @@ void bvm_exec_run() {
                     bvm_int32_t left = (bvm_int32_t) bvm_gl_rx_sp[-2].int_value;
                     bvm_int32_t right = (bvm_int32_t) bvm_gl_rx_sp[-1].int_value;
                     if (right == 0) {
-                        bvm_throw_exception(BVM_ERR_ARITHMETIC_EXCEPTION, "/ by zero");
+                        EXEC_THROW(BVM_ERR_ARITHMETIC_EXCEPTION, "/ by zero");
                     } else if (left == BVM_MIN_INT && right == -1) {
                         /*
                          * if the dividend is the negative integer of largest possible magnitude for the int
@@ -1732,7 +3417,7 @@ void bvm_exec_run() {
 			        bvm_int64_t value2 = BVM_INT64_from_cells(bvm_gl_rx_sp - 2);
 
 			        if (BVM_INT64_zero_eq(value2)) {
-			        	bvm_throw_exception(BVM_ERR_ARITHMETIC_EXCEPTION,"/ by zero");
+			        	EXEC_THROW(BVM_ERR_ARITHMETIC_EXCEPTION,"/ by zero");
 			        }
 
 			        // JVMS: "if the dividend is the negative integer of largest possible magnitude for the long type and the
@@ -1778,7 +3463,7 @@ void bvm_exec_run() {
 					bvm_gl_rx_sp--;
 
 					if (right == 0) {
-						bvm_throw_exception(BVM_ERR_ARITHMETIC_EXCEPTION, "zero divisor");
+						EXEC_THROW(BVM_ERR_ARITHMETIC_EXCEPTION, "zero divisor");
 					}
 
 			        if (left == BVM_MIN_INT && right == -1)
@@ -1795,7 +3480,7 @@ void bvm_exec_run() {
 			        bvm_int64_t value2 = BVM_INT64_from_cells(bvm_gl_rx_sp - 2);
 
 			        if (BVM_INT64_zero_eq(value2)) {
-			        	bvm_throw_exception(BVM_ERR_ARITHMETIC_EXCEPTION, "zero divisor");
+			        	EXEC_THROW(BVM_ERR_ARITHMETIC_EXCEPTION, "zero divisor");
 			        }
 
                     // JVMS: "in the special case in which the dividend is the negative long of largest
@@ -2268,114 +3953,114 @@ void bvm_exec_run() {
 #endif
 				}
 				OPCODE_HANDLER(OPCODE_ifeq): /* 153 */
-					if ((bvm_int32_t)bvm_gl_rx_sp[-1].int_value == 0)
-						bvm_gl_rx_pc += BVM_VM2INT16(bvm_gl_rx_pc+1);
+					bvm_gl_rx_sp--;
+					if ((bvm_int32_t)bvm_gl_rx_sp[0].int_value == 0)
+						EXEC_GOTO(BVM_VM2INT16(bvm_gl_rx_pc+1));
 					else
 						bvm_gl_rx_pc += 3;
-					bvm_gl_rx_sp--;
-					OPCODE_NEXT;
+					OPCODE_NEXT_PREEMPT;
 				OPCODE_HANDLER(OPCODE_ifne): /* 154 */
-					if ((bvm_int32_t)bvm_gl_rx_sp[-1].int_value != 0)
-						bvm_gl_rx_pc += BVM_VM2INT16(bvm_gl_rx_pc+1);
+					bvm_gl_rx_sp--;
+					if ((bvm_int32_t)bvm_gl_rx_sp[0].int_value != 0)
+						EXEC_GOTO(BVM_VM2INT16(bvm_gl_rx_pc+1));
 					else
 						bvm_gl_rx_pc += 3;
-					bvm_gl_rx_sp--;
-					OPCODE_NEXT;
+					OPCODE_NEXT_PREEMPT;
 				OPCODE_HANDLER(OPCODE_iflt): /* 155 */
-					if ((bvm_int32_t)bvm_gl_rx_sp[-1].int_value < 0)
-						bvm_gl_rx_pc += BVM_VM2INT16(bvm_gl_rx_pc+1);
+					bvm_gl_rx_sp--;
+					if ((bvm_int32_t)bvm_gl_rx_sp[0].int_value < 0)
+						EXEC_GOTO(BVM_VM2INT16(bvm_gl_rx_pc+1));
 					else
 						bvm_gl_rx_pc += 3;
-					bvm_gl_rx_sp--;
-					OPCODE_NEXT;
+					OPCODE_NEXT_PREEMPT;
 				OPCODE_HANDLER(OPCODE_ifge): /* 156 */
-					if ((bvm_int32_t)bvm_gl_rx_sp[-1].int_value >= 0)
-						bvm_gl_rx_pc += BVM_VM2INT16(bvm_gl_rx_pc+1);
+					bvm_gl_rx_sp--;
+					if ((bvm_int32_t)bvm_gl_rx_sp[0].int_value >= 0)
+						EXEC_GOTO(BVM_VM2INT16(bvm_gl_rx_pc+1));
 					else
 						bvm_gl_rx_pc += 3;
-					bvm_gl_rx_sp--;
-					OPCODE_NEXT;
+					OPCODE_NEXT_PREEMPT;
 				OPCODE_HANDLER(OPCODE_ifgt): /* 157 */
-					if ((bvm_int32_t)bvm_gl_rx_sp[-1].int_value > 0)
-						bvm_gl_rx_pc += BVM_VM2INT16(bvm_gl_rx_pc+1);
+					bvm_gl_rx_sp--;
+					if ((bvm_int32_t)bvm_gl_rx_sp[0].int_value > 0)
+						EXEC_GOTO(BVM_VM2INT16(bvm_gl_rx_pc+1));
 					else
 						bvm_gl_rx_pc += 3;
-					bvm_gl_rx_sp--;
-					OPCODE_NEXT;
+					OPCODE_NEXT_PREEMPT;
 				OPCODE_HANDLER(OPCODE_ifle): /* 158 */
-					if ((bvm_int32_t)bvm_gl_rx_sp[-1].int_value <= 0)
-						bvm_gl_rx_pc += BVM_VM2INT16(bvm_gl_rx_pc+1);
+					bvm_gl_rx_sp--;
+					if ((bvm_int32_t)bvm_gl_rx_sp[0].int_value <= 0)
+						EXEC_GOTO(BVM_VM2INT16(bvm_gl_rx_pc+1));
 					else
 						bvm_gl_rx_pc += 3;
-					bvm_gl_rx_sp--;
-					OPCODE_NEXT;
+					OPCODE_NEXT_PREEMPT;
 				OPCODE_HANDLER(OPCODE_if_icmpeq): /* 159 */
-					if ((bvm_int32_t)bvm_gl_rx_sp[-2].int_value == (bvm_int32_t)bvm_gl_rx_sp[-1].int_value)
-						bvm_gl_rx_pc += BVM_VM2INT16(bvm_gl_rx_pc+1);
+					bvm_gl_rx_sp -= 2;
+					if ((bvm_int32_t)bvm_gl_rx_sp[0].int_value == (bvm_int32_t)bvm_gl_rx_sp[1].int_value)
+						EXEC_GOTO(BVM_VM2INT16(bvm_gl_rx_pc+1));
 					else
 						bvm_gl_rx_pc += 3;
-					bvm_gl_rx_sp -= 2;
-					OPCODE_NEXT;
+					OPCODE_NEXT_PREEMPT;
 				OPCODE_HANDLER(OPCODE_if_icmpne): /* 160 */
-					if ((bvm_int32_t)bvm_gl_rx_sp[-2].int_value != (bvm_int32_t)bvm_gl_rx_sp[-1].int_value)
-						bvm_gl_rx_pc += BVM_VM2INT16(bvm_gl_rx_pc+1);
+					bvm_gl_rx_sp -= 2;
+					if ((bvm_int32_t)bvm_gl_rx_sp[0].int_value != (bvm_int32_t)bvm_gl_rx_sp[1].int_value)
+						EXEC_GOTO(BVM_VM2INT16(bvm_gl_rx_pc+1));
 					else
 						bvm_gl_rx_pc += 3;
-					bvm_gl_rx_sp -= 2;
-					OPCODE_NEXT;
+					OPCODE_NEXT_PREEMPT;
 				OPCODE_HANDLER(OPCODE_if_icmplt): /* 161 */
-					if ((bvm_int32_t)bvm_gl_rx_sp[-2].int_value < (bvm_int32_t)bvm_gl_rx_sp[-1].int_value)
-						bvm_gl_rx_pc += BVM_VM2INT16(bvm_gl_rx_pc+1);
+					bvm_gl_rx_sp -= 2;
+					if ((bvm_int32_t)bvm_gl_rx_sp[0].int_value < (bvm_int32_t)bvm_gl_rx_sp[1].int_value)
+						EXEC_GOTO(BVM_VM2INT16(bvm_gl_rx_pc+1));
 					else
 						bvm_gl_rx_pc += 3;
-					bvm_gl_rx_sp -= 2;
-					OPCODE_NEXT;
+					OPCODE_NEXT_PREEMPT;
 				OPCODE_HANDLER(OPCODE_if_icmpge): /* 162 */
-					if ((bvm_int32_t)bvm_gl_rx_sp[-2].int_value >= (bvm_int32_t)bvm_gl_rx_sp[-1].int_value)
-						bvm_gl_rx_pc += BVM_VM2INT16(bvm_gl_rx_pc+1);
+					bvm_gl_rx_sp -= 2;
+					if ((bvm_int32_t)bvm_gl_rx_sp[0].int_value >= (bvm_int32_t)bvm_gl_rx_sp[1].int_value)
+						EXEC_GOTO(BVM_VM2INT16(bvm_gl_rx_pc+1));
 					else
 						bvm_gl_rx_pc += 3;
-					bvm_gl_rx_sp -= 2;
-					OPCODE_NEXT;
+					OPCODE_NEXT_PREEMPT;
 				OPCODE_HANDLER(OPCODE_if_icmpgt): /* 163 */
-					if ((bvm_int32_t)bvm_gl_rx_sp[-2].int_value > (bvm_int32_t)bvm_gl_rx_sp[-1].int_value)
-						bvm_gl_rx_pc += BVM_VM2INT16(bvm_gl_rx_pc+1);
+					bvm_gl_rx_sp -= 2;
+					if ((bvm_int32_t)bvm_gl_rx_sp[0].int_value > (bvm_int32_t)bvm_gl_rx_sp[1].int_value)
+						EXEC_GOTO(BVM_VM2INT16(bvm_gl_rx_pc+1));
 					else
 						bvm_gl_rx_pc += 3;
-					bvm_gl_rx_sp -= 2;
-					OPCODE_NEXT;
+					OPCODE_NEXT_PREEMPT;
 				OPCODE_HANDLER(OPCODE_if_icmple): /* 164 */
-					if ((bvm_int32_t)bvm_gl_rx_sp[-2].int_value <= (bvm_int32_t)bvm_gl_rx_sp[-1].int_value)
-						bvm_gl_rx_pc += BVM_VM2INT16(bvm_gl_rx_pc+1);
+					bvm_gl_rx_sp -= 2;
+					if ((bvm_int32_t)bvm_gl_rx_sp[0].int_value <= (bvm_int32_t)bvm_gl_rx_sp[1].int_value)
+						EXEC_GOTO(BVM_VM2INT16(bvm_gl_rx_pc+1));
 					else
 						bvm_gl_rx_pc += 3;
-					bvm_gl_rx_sp -= 2;
-					OPCODE_NEXT;
+					OPCODE_NEXT_PREEMPT;
 				OPCODE_HANDLER(OPCODE_if_acmpeq): /* 165 */
-					if (bvm_gl_rx_sp[-2].ref_value == bvm_gl_rx_sp[-1].ref_value)
-						bvm_gl_rx_pc += BVM_VM2INT16(bvm_gl_rx_pc+1);
+					bvm_gl_rx_sp -= 2;
+					if (bvm_gl_rx_sp[0].ref_value == bvm_gl_rx_sp[1].ref_value)
+						EXEC_GOTO(BVM_VM2INT16(bvm_gl_rx_pc+1));
 					else
 						bvm_gl_rx_pc += 3;
-					bvm_gl_rx_sp -= 2;
-					OPCODE_NEXT;
+					OPCODE_NEXT_PREEMPT;
 				OPCODE_HANDLER(OPCODE_if_acmpne): /* 166 */
-					if (bvm_gl_rx_sp[-2].ref_value != bvm_gl_rx_sp[-1].ref_value)
-						bvm_gl_rx_pc += BVM_VM2INT16(bvm_gl_rx_pc+1);
+					bvm_gl_rx_sp -= 2;
+					if (bvm_gl_rx_sp[0].ref_value != bvm_gl_rx_sp[1].ref_value)
+						EXEC_GOTO(BVM_VM2INT16(bvm_gl_rx_pc+1));
 					else
 						bvm_gl_rx_pc += 3;
-					bvm_gl_rx_sp -= 2;
-					OPCODE_NEXT;
+					OPCODE_NEXT_PREEMPT;
 				OPCODE_HANDLER(OPCODE_goto): /* 167 */
-					bvm_gl_rx_pc += BVM_VM2INT16(bvm_gl_rx_pc+1);
-					OPCODE_NEXT;
+					EXEC_GOTO(BVM_VM2INT16(bvm_gl_rx_pc+1));
+					OPCODE_NEXT_PREEMPT;
 				OPCODE_HANDLER(OPCODE_jsr): /* 168 */
 					bvm_gl_rx_sp[0].ptr_value = bvm_gl_rx_pc + 3;
 					bvm_gl_rx_sp++;
 					bvm_gl_rx_pc += BVM_VM2INT16(bvm_gl_rx_pc+1);
-					OPCODE_NEXT;
+					OPCODE_NEXT_PREEMPT;
 				OPCODE_HANDLER(OPCODE_ret): /* 169 */
 					bvm_gl_rx_pc = bvm_gl_rx_sp[bvm_gl_rx_pc[1]].ptr_value;
-					OPCODE_NEXT;
+					OPCODE_NEXT_PREEMPT;
 				OPCODE_HANDLER(OPCODE_tableswitch): {/* 170  */
 
                     bvm_int32_t index = bvm_gl_rx_sp[-1].int_value;
@@ -2393,13 +4078,22 @@ void bvm_exec_run() {
                     bvm_int32_t high = BVM_VM2INT32(rxpc);
                     rxpc += 4;
 
+#if BVM_EXEC_SWITCH_TABLES_ENABLE
+					/* decode the operands once, for the quickened opcode to use from the next time on */
+					if (*bvm_gl_rx_pc == OPCODE_tableswitch) {
+						EXEC_STORE_REGISTERS;
+						exec_switch_table_build(bvm_gl_rx_method, bvm_gl_rx_pc);
+						EXEC_QUICKEN(OPCODE_246_tableswitch_fast);
+					}
+#endif
+
 					if (index < low || index > high)
 						bvm_gl_rx_pc += defaultRxpc;
 					else
 						bvm_gl_rx_pc += BVM_VM2INT32(&rxpc[(index - low) * 4]);
 
 					bvm_gl_rx_sp--;
-					OPCODE_NEXT;
+					OPCODE_NEXT_PREEMPT;
 				}
 				OPCODE_HANDLER(OPCODE_lookupswitch): {/* 171 */
 
@@ -2417,6 +4111,15 @@ void bvm_exec_run() {
                     bvm_int32_t pairsCnt = BVM_VM2INT32(rxpc);
                     rxpc += 4;
 
+#if BVM_EXEC_SWITCH_TABLES_ENABLE
+					/* decode the operands once, for the quickened opcode to use from the next time on */
+					if (*bvm_gl_rx_pc == OPCODE_lookupswitch) {
+						EXEC_STORE_REGISTERS;
+						exec_switch_table_build(bvm_gl_rx_method, bvm_gl_rx_pc);
+						EXEC_QUICKEN(OPCODE_247_lookupswitch_fast);
+					}
+#endif
+
                     /* JVMS: "The match-offset pairs are sorted to support lookup routines that are
                      * quicker than linear search".  The following is simple binary search */
 					if (pairsCnt > 0) {
@@ -2446,7 +4149,7 @@ void bvm_exec_run() {
 					}
 
 					bvm_gl_rx_sp--;
-					OPCODE_NEXT;
+					OPCODE_NEXT_PREEMPT;
 				}
 				OPCODE_HANDLER(OPCODE_ireturn): /* 172 */
 				OPCODE_HANDLER(OPCODE_lreturn): /* 173 */
@@ -2462,6 +4165,8 @@ void bvm_exec_run() {
 					/* number of cells returned by the current method 0, 1, or 2. */
 					bvm_uint8_t nr_return_cells = bvm_gl_rx_method->returns_value;
 
+					EXEC_STORE_REGISTERS;
+
 					/* release monitor if the current method is synchronised */
 					if (BVM_METHOD_IsSynchronized(bvm_gl_rx_method)) {
 						bvm_thread_monitor_release(BVM_STACK_ExecMethodSyncObject());
@@ -2477,6 +4182,7 @@ void bvm_exec_run() {
 
 					/* pop a return frame off of the stack */
 					bvm_frame_pop();
+					EXEC_LOAD_REGISTERS;
 
 					/* if the method after the pop is actually a callback wedge (and has a
 					 * callback) - call it.  After the callback, if the number of non-daemon threads has been reduced
@@ -2487,6 +4193,14 @@ void bvm_exec_run() {
 
 						if (bvm_gl_rx_locals[1].callback != NULL) {
 							bvm_gl_rx_locals[1].callback(&res1, &res2, BVM_FALSE, bvm_gl_rx_locals[2].ref_value);
+							EXEC_LOAD_REGISTERS;
+#if BVM_NI_CALLS_ENABLE
+							/* a call from native code has returned - back to the 'C' that made it */
+							if (exec_call_returned) {
+								exec_call_returned = BVM_FALSE;
+								return;
+							}
+#endif
 							if (bvm_gl_thread_nondaemon_count == 0 ) return;
 
 							/* callbacks do not return any value, so go to the top of the interp loop. */
@@ -2506,7 +4220,13 @@ void bvm_exec_run() {
 						bvm_gl_rx_sp[1] = res1;
 						bvm_gl_rx_sp += 2;
 					}
-					OPCODE_NEXT;
+
+					/* back in a translated or compiled method? */
+					EXEC_AOT_RESUME;
+					EXEC_JIT_RESUME;
+					EXEC_IR_RESUME;
+
+					OPCODE_NEXT_PREEMPT;
 				}
 				OPCODE_HANDLER(OPCODE_getstatic): {/* 178 */
 
@@ -2514,29 +4234,42 @@ void bvm_exec_run() {
 					bvm_uint16_t index = BVM_VM2UINT16(bvm_gl_rx_pc+1);
 
 					/* resolve static field */
+					EXEC_STORE_REGISTERS;
 					field = bvm_clazz_resolve_cp_field(bvm_gl_rx_clazz, index, BVM_TRUE);
+					EXEC_LOAD_REGISTERS;
 
 					/* if class it not initialised, then do not move the pc/sp.  The
 					 * initialise class will push a frame onto the stack, so we'll eventually get
 					 * back here sometime after the class is initialised. */
 					if (!BVM_CLAZZ_IsInitialised(field->clazz)) {
-                        if (bvm_clazz_initialise(field->clazz)) goto top_of_interpreter_loop;
+                        EXEC_STORE_REGISTERS;
+                        if (bvm_clazz_initialise(field->clazz)) {
+                        	EXEC_LOAD_REGISTERS;
+                        	goto top_of_interpreter_loop;
+                        }
 					}
 
 					/* change opcode so that it runs faster next time. */
 					if (BVM_FIELD_IsLong(field)) {
-#if (!BVM_DEBUGGER_ENABLE)
-						*bvm_gl_rx_pc = OPCODE_getstatic_fast_long;
-#endif
+						EXEC_QUICKEN_INITIALISED(field->clazz, OPCODE_getstatic_fast_long);
 						/* push the field static 64 bit value onto the stack - works for longs
 						 * and doubles - we're copying the bits ... not the int/double 'value' .... */
 						bvm_uint64_t val = *(bvm_uint64_t*)(field->value.static_value.ptr_value);
 						BVM_INT64_to_cells(bvm_gl_rx_sp, val);
 						bvm_gl_rx_sp++;
 					} else {
-#if (!BVM_DEBUGGER_ENABLE)
-						*bvm_gl_rx_pc = OPCODE_getstatic_fast;
+#if BVM_EXEC_CONSTANT_FOLDING_ENABLE
+						/* a constant is copied into the constant pool entry and pushed from there from now on.  Until
+						 * its class has finished initialising (this thread is running its <clinit>) it may still
+						 * change, so the instruction is left as it is */
+						if (EXEC_STATIC_IS_CONSTANT(field)) {
+							if (field->clazz->state == BVM_CLAZZ_STATE_INITIALISED) {
+								bvm_gl_rx_clazz->constant_pool[index].data.value = field->value.static_value;
+								EXEC_QUICKEN(OPCODE_245_getstatic_fast_constant);
+							}
+						} else
 #endif
+						EXEC_QUICKEN_INITIALISED(field->clazz, OPCODE_getstatic_fast);
 						/* push the field static value onto the stack */
 						bvm_gl_rx_sp[0] = field->value.static_value;
 					}
@@ -2552,7 +4285,9 @@ void bvm_exec_run() {
 					bvm_uint16_t index = BVM_VM2UINT16(bvm_gl_rx_pc+1);
 
 					/* resolve static field */
+					EXEC_STORE_REGISTERS;
 					field = bvm_clazz_resolve_cp_field(bvm_gl_rx_clazz, index, BVM_TRUE);
+					EXEC_LOAD_REGISTERS;
 
 #if BVM_BINARY_COMPAT_CHECKING_ENABLE
 					/* "if the field is final, it must be declared in the current
@@ -2566,7 +4301,11 @@ void bvm_exec_run() {
 					 * initialise_class will push a frame onto the stack, so we'll eventually get
 					 * back here sometime after the class is initialised. */
 					if (!BVM_CLAZZ_IsInitialised(field->clazz)) {
-						if (bvm_clazz_initialise(field->clazz)) goto top_of_interpreter_loop;
+						EXEC_STORE_REGISTERS;
+						if (bvm_clazz_initialise(field->clazz)) {
+							EXEC_LOAD_REGISTERS;
+							goto top_of_interpreter_loop;
+						}
 					}
 
 					/* if we got here we're all okay - the class is initialised and the field is
@@ -2575,20 +4314,18 @@ void bvm_exec_run() {
 
 					/* change opcode so that it runs faster next time. */
 					if (BVM_FIELD_IsLong(field)) {
-#if (!BVM_DEBUGGER_ENABLE)
-						*bvm_gl_rx_pc = OPCODE_putstatic_fast_long;
-#endif
+						EXEC_QUICKEN_INITIALISED(field->clazz, OPCODE_putstatic_fast_long);
 						/* copy the 64 value from the stack into the field - works for longs and doubles
 						 * as we're effectively copying the bits .. not the value */
 						bvm_int64_t val = BVM_INT64_from_cells(bvm_gl_rx_sp-2);
                         (*(bvm_int64_t*)(field->value.static_value.ptr_value)) = val;
 						bvm_gl_rx_sp--;
 					} else {
-#if (!BVM_DEBUGGER_ENABLE)
-						*bvm_gl_rx_pc = OPCODE_putstatic_fast;
-#endif
+						EXEC_QUICKEN_INITIALISED(field->clazz, OPCODE_putstatic_fast);
 						/* push the field static value into the field */
+						if (BVM_FIELD_IsReference(field)) EXEC_CHECK_SCOPED_STORE(field->clazz, bvm_gl_rx_sp[-1].ref_value);
 						field->value.static_value = bvm_gl_rx_sp[-1];
+						if (BVM_FIELD_IsReference(field)) BVM_GC_WRITE_BARRIER(field->clazz, bvm_gl_rx_sp[-1].ref_value);
 					}
 
 					bvm_gl_rx_sp--;
@@ -2606,21 +4343,26 @@ void bvm_exec_run() {
 					if (obj == NULL) throw_null_pointer_exception();
 
 					/* resolve non-static field */
+					EXEC_STORE_REGISTERS;
 					field = bvm_clazz_resolve_cp_field(bvm_gl_rx_clazz, index, BVM_FALSE);
+					EXEC_LOAD_REGISTERS;
 
 					/* change opcode so that it runs faster next time. */
-					if (BVM_FIELD_IsLong(field)) {
-#if (!BVM_DEBUGGER_ENABLE)
-						*bvm_gl_rx_pc = OPCODE_getfield_fast_long;
+#if BVM_FIELD_PACKING_ENABLE
+					if (BVM_FIELD_IsPacked(field)) {
+						EXEC_QUICKEN(OPCODE_243_getfield_fast_packed);
+						bvm_object_get_packed_field(obj, field, &bvm_gl_rx_sp[-1]);
+						if (BVM_FIELD_IsLong(field)) bvm_gl_rx_sp++;
+					} else
 #endif
+					if (BVM_FIELD_IsLong(field)) {
+						EXEC_QUICKEN(OPCODE_getfield_fast_long);
 						/* get the two halves of the value */
 						bvm_gl_rx_sp[-1] = obj->fields[field->value.offset];
 						bvm_gl_rx_sp[0]  = obj->fields[field->value.offset+1];
 						bvm_gl_rx_sp++;
 					} else {
-#if (!BVM_DEBUGGER_ENABLE)
-						*bvm_gl_rx_pc = OPCODE_getfield_fast;
-#endif
+						EXEC_QUICKEN(OPCODE_getfield_fast);
 						/* get the value of the object at the offset given by the field. */
 						bvm_gl_rx_sp[-1] = obj->fields[field->value.offset];
 					}
@@ -2636,7 +4378,9 @@ void bvm_exec_run() {
 					bvm_int16_t index = BVM_VM2UINT16(bvm_gl_rx_pc+1);
 
 					/* resolve non-static field */
+					EXEC_STORE_REGISTERS;
 					field = bvm_clazz_resolve_cp_field(bvm_gl_rx_clazz, index, BVM_FALSE);
+					EXEC_LOAD_REGISTERS;
 
 					/* if the field is a long field we need to dig further into the stack to
 					 * get our value */
@@ -2655,21 +4399,26 @@ void bvm_exec_run() {
 					}
 #endif
 					/* change opcode so that it runs faster next time. */
-					if (BVM_FIELD_IsLong(field)) {
-#if (!BVM_DEBUGGER_ENABLE)
-						*bvm_gl_rx_pc = OPCODE_putfield_fast_long;
+#if BVM_FIELD_PACKING_ENABLE
+					if (BVM_FIELD_IsPacked(field)) {
+						EXEC_QUICKEN(OPCODE_244_putfield_fast_packed);
+						bvm_object_put_packed_field(obj, field, &bvm_gl_rx_sp[stack_pos+1]);
+						if (BVM_FIELD_IsLong(field)) bvm_gl_rx_sp--;
+					} else
 #endif
+					if (BVM_FIELD_IsLong(field)) {
+						EXEC_QUICKEN(OPCODE_putfield_fast_long);
 						/* set the value of the object at the offset given by the field plus the
 						 * extra one for a long. */
 						obj->fields[field->value.offset]   = bvm_gl_rx_sp[-2];
 						obj->fields[field->value.offset+1] = bvm_gl_rx_sp[-1];
 						bvm_gl_rx_sp--;
 					} else {
-#if (!BVM_DEBUGGER_ENABLE)
-						*bvm_gl_rx_pc = OPCODE_putfield_fast;
-#endif
+						EXEC_QUICKEN(OPCODE_putfield_fast);
 						/* set the value of the object at the offset given by the field. */
+						if (BVM_FIELD_IsReference(field)) EXEC_CHECK_SCOPED_STORE(obj, bvm_gl_rx_sp[-1].ref_value);
 						obj->fields[field->value.offset] = bvm_gl_rx_sp[-1];
+						if (BVM_FIELD_IsReference(field)) BVM_GC_WRITE_BARRIER(obj, bvm_gl_rx_sp[-1].ref_value);
 					}
 
 					bvm_gl_rx_sp -= 2;
@@ -2688,8 +4437,11 @@ void bvm_exec_run() {
 
 					if (BVM_CONSTANT_IsOptimised(bvm_gl_rx_clazz,method_index))
 						resolved_method = bvm_gl_rx_clazz->constant_pool[method_index].resolved_ptr;
-					else
+					else {
+						EXEC_STORE_REGISTERS;
 						resolved_method = bvm_clazz_resolve_cp_method(bvm_gl_rx_clazz, method_index);
+						EXEC_LOAD_REGISTERS;
+					}
 
 					invoke_method = resolved_method;
 
@@ -2717,7 +4469,8 @@ void bvm_exec_run() {
 							if (BVM_CLAZZ_IsArrayClazz(search_clazz) &&
 									strncmp("clone", (char *) invoke_method->name->data, 5) == 0) {
 								bvm_gl_rx_sp -= invoke_nr_args;
-								bvm_gl_rx_sp[0].ptr_value = bvm_heap_clone(invoke_obj);
+								EXEC_STORE_REGISTERS;
+								bvm_gl_rx_sp[0].ref_value = bvm_object_clone(invoke_obj);
 								bvm_gl_rx_sp++;
 								bvm_gl_rx_pc += 3;
 								goto top_of_interpreter_loop;
@@ -2725,7 +4478,13 @@ void bvm_exec_run() {
 								search_clazz = BVM_OBJECT_CLAZZ;
 						}
 
-						invoke_method = locate_virtual_method(search_clazz, resolved_method);
+#if BVM_CLAZZ_DISPATCH_TABLES_ENABLE
+						/* a method with a vtable slot is just indexed from the receiver clazz vtable */
+						if (resolved_method->vtable_index < search_clazz->vtable_count)
+							invoke_method = search_clazz->vtable[resolved_method->vtable_index];
+						else
+#endif
+						invoke_method = LOCATE_VIRTUAL_METHOD(search_clazz, resolved_method);
 						invoke_clazz = invoke_method->clazz;
 					}
 
@@ -2737,21 +4496,27 @@ void bvm_exec_run() {
 					}
 #endif
 
-#if (!BVM_DEBUGGER_ENABLE)
 					/* substitute a go-faster opcode - if the resolved method is final or private, or the class
 					 * of the resolved method is final we really do not need to go through method lookup stuff again -
 					 * the resolved method does not so no need to be dynamically looked up.
 					 *
-					 * Note that we do not have a specific 'fast' opcode for invokevirtual. There is not really a lot
-					 * that we can do.  Using the invokespecial_fast opcode optimisation here is making
+					 * The invokevirtual_fast opcode shares the invokespecial_fast implementation.  It makes
 					 * use of the fact that with final/private methods or final classes, the resolved
 					 * method will be the same as the dynamically found one always - so we just do not look it up
-					 * after the first time. */
+					 * after the first time.  It is a distinct opcode only so that the debugger can tell what the
+					 * original opcode was. */
 	                if ( (resolved_method->access_flags & (BVM_METHOD_ACCESS_PRIVATE | BVM_METHOD_ACCESS_FINAL))
 	                    || (resolved_method->clazz->access_flags & BVM_CLASS_ACCESS_FINAL) ) {
-	                    *bvm_gl_rx_pc = OPCODE_230_invokespecial_fast;
-	                }
+#if BVM_EXEC_INTRINSICS_ENABLE
+	                	/* ... and if it is an intrinsic, that can be done without a call at all */
+	                	if (resolved_method->intrinsic != BVM_EXEC_INTRINSIC_NONE) {
+	                		EXEC_QUICKEN(OPCODE_238_invokevirtual_intrinsic);
+	                	} else
 #endif
+	                	{
+	                		EXEC_QUICKEN(OPCODE_232_invokevirtual_fast);
+	                	}
+	                }
 					invoke_pc_offset = 3;
 
 					goto do_method_invocation;
@@ -2762,8 +4527,11 @@ void bvm_exec_run() {
 
 					if (BVM_CONSTANT_IsOptimised(bvm_gl_rx_clazz,method_index))
 						invoke_method = bvm_gl_rx_clazz->constant_pool[method_index].resolved_ptr;
-					else
+					else {
+						EXEC_STORE_REGISTERS;
 						invoke_method = bvm_clazz_resolve_cp_method(bvm_gl_rx_clazz, method_index);
+						EXEC_LOAD_REGISTERS;
+					}
 
 					invoke_clazz = invoke_method->clazz;
 
@@ -2795,10 +4563,8 @@ void bvm_exec_run() {
 					}
 #endif
 
-#if (!BVM_DEBUGGER_ENABLE)
 					/* substitute a go-faster opcode */
-					*bvm_gl_rx_pc = OPCODE_230_invokespecial_fast;
-#endif
+					EXEC_QUICKEN(OPCODE_230_invokespecial_fast);
 
 					/* skip Object <init> method.  It does nothing so we'll save a small amount
 					 * of time (but we'll save it a lot of times). */
@@ -2820,8 +4586,11 @@ void bvm_exec_run() {
 
 					if (BVM_CONSTANT_IsOptimised(bvm_gl_rx_clazz,method_index))
 						invoke_method = bvm_gl_rx_clazz->constant_pool[method_index].resolved_ptr;
-					else
+					else {
+						EXEC_STORE_REGISTERS;
 						invoke_method = bvm_clazz_resolve_cp_method(bvm_gl_rx_clazz, method_index);
+						EXEC_LOAD_REGISTERS;
+					}
 
 					invoke_clazz = invoke_method->clazz;
 
@@ -2848,7 +4617,11 @@ void bvm_exec_run() {
 					if (!BVM_CLAZZ_IsInitialised(invoke_clazz)) {
 						/*bvm_clazz_initialise(invoke_clazz);*/
 						/*if (!BVM_CLAZZ_IsInitialised(invoke_clazz)) */
-						if (bvm_clazz_initialise(invoke_clazz)) goto top_of_interpreter_loop;
+						EXEC_STORE_REGISTERS;
+						if (bvm_clazz_initialise(invoke_clazz)) {
+							EXEC_LOAD_REGISTERS;
+							goto top_of_interpreter_loop;
+						}
 					}
 
 					/* check this current class can access the method -  note that the isPublic() is redundant -
@@ -2860,10 +4633,15 @@ void bvm_exec_run() {
 						}
 					}
 
-#if (!BVM_DEBUGGER_ENABLE)
 					/* substitute a go-faster opcode */
-					*bvm_gl_rx_pc = OPCODE_229_invokestatic_fast;
+#if BVM_EXEC_INTRINSICS_ENABLE
+					if (invoke_method->intrinsic != BVM_EXEC_INTRINSIC_NONE) {
+						EXEC_QUICKEN_INITIALISED(invoke_clazz, OPCODE_237_invokestatic_intrinsic);
+					} else
 #endif
+					{
+						EXEC_QUICKEN_INITIALISED(invoke_clazz, OPCODE_229_invokestatic_fast);
+					}
 
 					invoke_pc_offset = 3;
 
@@ -2881,8 +4659,11 @@ void bvm_exec_run() {
 
 					if (BVM_CONSTANT_IsOptimised(bvm_gl_rx_clazz,method_index))
 						invoke_method = bvm_gl_rx_clazz->constant_pool[method_index].resolved_ptr;
-					else
+					else {
+						EXEC_STORE_REGISTERS;
 						invoke_method = bvm_clazz_resolve_cp_method(bvm_gl_rx_clazz, method_index);
+						EXEC_LOAD_REGISTERS;
+					}
 
 					invoke_clazz = invoke_method->clazz;
 
@@ -2917,7 +4698,7 @@ void bvm_exec_run() {
 						/* the class of the object reference we are making the method call upon */
 						search_clazz = (bvm_instance_clazz_t *) invoke_obj->clazz;
 
-						invoke_method = locate_virtual_method(search_clazz, resolved_method);
+						invoke_method = LOCATE_VIRTUAL_METHOD(search_clazz, resolved_method);
 						invoke_clazz = invoke_method->clazz;
 
 					}
@@ -2943,7 +4724,9 @@ void bvm_exec_run() {
 					bvm_uint16_t index = BVM_VM2UINT16(bvm_gl_rx_pc+1);
 
 					/* get the class name from the constant pool */
+					EXEC_STORE_REGISTERS;
 					cl = (bvm_instance_clazz_t *) bvm_clazz_resolve_cp_clazz(bvm_gl_rx_clazz, index);
+					EXEC_LOAD_REGISTERS;
 
 #if BVM_BINARY_COMPAT_CHECKING_ENABLE
 
@@ -2961,15 +4744,26 @@ void bvm_exec_run() {
 					 * of the interp loop.  The initialise_clazz() may push a frame into the stack.  We'll
 					 * arrive back here after initialisation. */
 					if (!BVM_CLAZZ_IsInitialised(cl)) {
-                        if (bvm_clazz_initialise(cl)) goto top_of_interpreter_loop;
+                        EXEC_STORE_REGISTERS;
+                        if (bvm_clazz_initialise(cl)) {
+                        	EXEC_LOAD_REGISTERS;
+                        	goto top_of_interpreter_loop;
+                        }
 					}
 
-#if (!BVM_DEBUGGER_ENABLE)
 					/* make it faster next time */
-					*bvm_gl_rx_pc = OPCODE_new_fast;
+					EXEC_QUICKEN_INITIALISED(cl, OPCODE_new_fast);
+
+#if BVM_EXEC_STRING_CONCAT_ENABLE
+					/* ... and if it starts a string concatenation, do the whole of it in one go from then on */
+					if (*bvm_gl_rx_pc == OPCODE_new_fast) {
+						EXEC_STORE_REGISTERS;
+						if (exec_concat_build(bvm_gl_rx_method, bvm_gl_rx_pc, cl)) *bvm_gl_rx_pc = OPCODE_248_new_concat;
+					}
 #endif
+
 					/* create the object and put it on the stack */
-					bvm_gl_rx_sp[0].ref_value = bvm_object_alloc(cl);
+					EXEC_NEW_OBJECT(bvm_gl_rx_sp[0].ref_value, cl);
 
 					bvm_gl_rx_sp++;
 					bvm_gl_rx_pc += 3;
@@ -2982,11 +4776,12 @@ void bvm_exec_run() {
 
 					/* if requested length is less than zero, throw exception */
 					if (length < 0) {
-						bvm_throw_exception(BVM_ERR_NEGATIVE_ARRAY_SIZE_EXCEPTION, NULL);
+						EXEC_THROW(BVM_ERR_NEGATIVE_ARRAY_SIZE_EXCEPTION, NULL);
 					}
 
 					/* create new primitive array instance and push new onto stack */
-					bvm_gl_rx_sp[-1].ref_value = (bvm_obj_t *) bvm_object_alloc_array_primitive(length, bvm_gl_rx_pc[1]);
+					EXEC_STORE_REGISTERS;
+					bvm_gl_rx_sp[-1].ref_value = (bvm_obj_t *) EXEC_ALLOC_ARRAY_PRIMITIVE(length, bvm_gl_rx_pc[1]);
 
 					bvm_gl_rx_pc += 2;
 					OPCODE_NEXT;
@@ -3001,21 +4796,24 @@ void bvm_exec_run() {
 
 					/* if requested length is less than zero, throw exception */
 					if (length < 0) {
-						bvm_throw_exception(BVM_ERR_NEGATIVE_ARRAY_SIZE_EXCEPTION, NULL);
+						EXEC_THROW(BVM_ERR_NEGATIVE_ARRAY_SIZE_EXCEPTION, NULL);
 					}
 
 					/* the class name of the component of the new array */
 					clazzname = bvm_clazz_cp_utfstring_from_index(bvm_gl_rx_clazz, BVM_VM2UINT16(bvm_gl_rx_pc+1));
 
 					/* the clazz of the array component */
+					EXEC_STORE_REGISTERS;
 					component_clazz = bvm_clazz_get(bvm_gl_rx_clazz->classloader_obj, clazzname);
+					EXEC_LOAD_REGISTERS;
 
 					/* if the array component clazz is not accessible throw an IllegalAccessError */
 					if (!bvm_clazz_is_class_accessible((bvm_clazz_t *) bvm_gl_rx_clazz, (bvm_clazz_t *) component_clazz)) {
 						bvm_throw_exception(BVM_ERR_ILLEGAL_ACCESS_ERROR, (char *) component_clazz->name->data);
 					}
 
-					bvm_gl_rx_sp[-1].ref_value = (bvm_obj_t *) bvm_object_alloc_array_reference(length, component_clazz);
+					EXEC_STORE_REGISTERS;
+					bvm_gl_rx_sp[-1].ref_value = (bvm_obj_t *) EXEC_ALLOC_ARRAY_REFERENCE(length, component_clazz);
 
 					bvm_gl_rx_pc += 3;
 					OPCODE_NEXT;
@@ -3026,7 +4824,7 @@ void bvm_exec_run() {
 					bvm_jarray_obj_t *array_obj = (bvm_jarray_obj_t *) bvm_gl_rx_sp[-1].ref_value;
 
 					/* No object? */
-					if (array_obj == NULL) throw_null_pointer_exception();
+					EXEC_NULL_CHECK(array_obj);
 
 					/* push length */
 					bvm_gl_rx_sp[-1].int_value = array_obj->length.int_value;
@@ -3038,6 +4836,7 @@ void bvm_exec_run() {
 opcode_athrow:
 
 				{
+					EXEC_STORE_REGISTERS;
 
 					/* if the throwable var is not yet set (the throwable will be non-NULL here if a native exception is thrown),
 					 * get it from the stack: it is a normal java bytecode 'athrow' . If still NULL, substitute a null pointer
@@ -3096,6 +4895,7 @@ opcode_athrow:
 						/* go and see if any exception breakpoints are satisfied */
 						bvmd_event_Exception(context);
 						bvmd_eventdef_free_context(context);
+						EXEC_LOAD_REGISTERS;
 
 						/* if we have come back from exception breakpoint event and the current thread is no longer runnable,
 						 * set the thread as 'breakpointed', set the breakpoint opcode to be the 2nd part of exception handling
@@ -3122,6 +4922,10 @@ opcode_athrow:
 
 					bvm_obj_t *obj = bvm_gl_rx_sp[-1].ref_value;
 
+#if BVM_EXEC_TYPE_CACHE_ENABLE
+					bvm_type_cache_t *cache;
+#endif
+
 					/* if the reference is null and we are doing an instanceof, we can push failure
 					 * and then continue */
 				    if (obj == NULL) {
@@ -3130,24 +4934,43 @@ opcode_athrow:
 						 goto top_of_interpreter_loop;
 					}
 
-					targetindex = BVM_VM2UINT16(bvm_gl_rx_pc+1);
-					targetname  = bvm_clazz_cp_utfstring_from_index(bvm_gl_rx_clazz, targetindex);
+#if BVM_EXEC_TYPE_CACHE_ENABLE
+					/* has this instruction seen an object of this clazz before?  If it has, it also knows its target clazz */
+					cache = &type_cache_table[TYPE_CACHE_HASH(bvm_gl_rx_pc)];
+					if (cache->pc == bvm_gl_rx_pc) {
+						iscompatible = type_cache_is_compatible(cache, obj->clazz);
+						target_cl = cache->target_clazz;
+					} else
+#endif
+					{
+						targetindex = BVM_VM2UINT16(bvm_gl_rx_pc+1);
+						targetname  = bvm_clazz_cp_utfstring_from_index(bvm_gl_rx_clazz, targetindex);
+
+						EXEC_STORE_REGISTERS;
+						target_cl   = bvm_clazz_get(bvm_gl_rx_clazz->classloader_obj, targetname);
+						EXEC_LOAD_REGISTERS;
+					}
+
+					if (!iscompatible) {
 
-					target_cl   = bvm_clazz_get(bvm_gl_rx_clazz->classloader_obj, targetname);
+						/* a simple check before the incurring expense of a function call to is_assignable_from().
+						 * If the two clazzes are the same or the target is the Object class, forget it.
+						 * Note: is_assignable_from also performs these same two checks. */
+						if ((obj->clazz == target_cl) || (target_cl == (bvm_clazz_t *) BVM_OBJECT_CLAZZ))
+							iscompatible = BVM_TRUE;
+						else
+							iscompatible = bvm_clazz_is_assignable_from(obj->clazz, target_cl);
 
-					/* a simple check before the incurring expense of a function call to is_assignable_from().
-					 * If the two clazzes are the same or the target is the Object class, forget it.
-					 * Note: is_assignable_from also performs these same two checks. */
-					if ((obj->clazz == target_cl) || (target_cl == (bvm_clazz_t *) BVM_OBJECT_CLAZZ))
-						iscompatible = BVM_TRUE;
-					else
-						iscompatible = bvm_clazz_is_assignable_from(obj->clazz, target_cl);
+#if BVM_EXEC_TYPE_CACHE_ENABLE
+						if (iscompatible) type_cache_add(bvm_gl_rx_pc, target_cl, obj->clazz);
+#endif
+					}
 
 					/* checkcast throws an exception if the two are not compatible, instanceof
 					 * pushes a false on the stack */
 					if (CURRENT_OPCODE == OPCODE_checkcast) {
 						if (!iscompatible) {
-							bvm_throw_exception(BVM_ERR_CLASS_CAST_EXCEPTION, NULL);
+							EXEC_THROW(BVM_ERR_CLASS_CAST_EXCEPTION, NULL);
 						}
 					} else
 						bvm_gl_rx_sp[-1].int_value = iscompatible;
@@ -3160,6 +4983,7 @@ opcode_athrow:
 					/* attempt to acquire the monitor for the object.  If it cannot be
 					 * acquired the current thread must have been suspended so we'll just
 					 * loop back to the top where a thread switch will take place. */
+					EXEC_STORE_REGISTERS;
 					if (!bvm_thread_monitor_acquire(bvm_gl_rx_sp[-1].ref_value, bvm_gl_thread_current)) {
 						goto top_of_interpreter_loop;
 					}
@@ -3170,6 +4994,7 @@ opcode_athrow:
 				}
 				OPCODE_HANDLER(OPCODE_monitorexit): {/* 195 */
 
+					EXEC_STORE_REGISTERS;
 					bvm_thread_monitor_release(bvm_gl_rx_sp[-1].ref_value);
 
 					bvm_gl_rx_pc++;
@@ -3240,7 +5065,9 @@ opcode_athrow:
 
 					/* get the array class - unlike the 'anewarray' opcode which specifies the component
 					 * clazz, this is the actual array class */
+					EXEC_STORE_REGISTERS;
 					cl = (bvm_array_clazz_t *) bvm_clazz_get(bvm_gl_rx_clazz->classloader_obj, clazzname);
+					EXEC_LOAD_REGISTERS;
 
 					/* JVMS: "if the current class does not have permission to access the element
 					 * type of the resolved array class, multianewarray throws an IllegalAccessError."
@@ -3262,34 +5089,35 @@ opcode_athrow:
 
 					/* create the new multi array - note the int array passed here are actually cells - the size of the pointer
 					 * here matches the size if the int in an bvm_cell_t */
-					bvm_gl_rx_sp[0].ref_value = (bvm_obj_t *) bvm_object_alloc_array_multi(cl , dimensions, (bvm_native_long_t *) bvm_gl_rx_sp);
+					EXEC_STORE_REGISTERS;
+					bvm_gl_rx_sp[0].ref_value = (bvm_obj_t *) EXEC_ALLOC_ARRAY_MULTI(cl , dimensions, (bvm_native_long_t *) bvm_gl_rx_sp);
 
 					bvm_gl_rx_sp++;
 					bvm_gl_rx_pc += 4;
 					OPCODE_NEXT;
 				}
 				OPCODE_HANDLER(OPCODE_ifnull): /* 198 */
-					if (bvm_gl_rx_sp[-1].ref_value == NULL)
-						bvm_gl_rx_pc += BVM_VM2INT16(bvm_gl_rx_pc+1);
+					bvm_gl_rx_sp--;
+					if (bvm_gl_rx_sp[0].ref_value == NULL)
+						EXEC_GOTO(BVM_VM2INT16(bvm_gl_rx_pc+1));
 					else
 						bvm_gl_rx_pc += 3;
-					bvm_gl_rx_sp--;
-					OPCODE_NEXT;
+					OPCODE_NEXT_PREEMPT;
 				OPCODE_HANDLER(OPCODE_ifnonnull): /* 199 */
-					if (bvm_gl_rx_sp[-1].ref_value != NULL)
-						bvm_gl_rx_pc += BVM_VM2INT16(bvm_gl_rx_pc+1);
+					bvm_gl_rx_sp--;
+					if (bvm_gl_rx_sp[0].ref_value != NULL)
+						EXEC_GOTO(BVM_VM2INT16(bvm_gl_rx_pc+1));
 					else
 						bvm_gl_rx_pc += 3;
-					bvm_gl_rx_sp--;
-					OPCODE_NEXT;
+					OPCODE_NEXT_PREEMPT;
 				OPCODE_HANDLER(OPCODE_goto_w): /* 200 */
-					bvm_gl_rx_pc += BVM_VM2INT32(bvm_gl_rx_pc+1);
-					OPCODE_NEXT;
+					EXEC_GOTO(BVM_VM2INT32(bvm_gl_rx_pc+1));
+					OPCODE_NEXT_PREEMPT;
 				OPCODE_HANDLER(OPCODE_jsr_w): /* 201 */
 					bvm_gl_rx_sp[0].ptr_value = bvm_gl_rx_pc + 5;
 					bvm_gl_rx_pc += BVM_VM2INT32(bvm_gl_rx_pc+1);
 					bvm_gl_rx_sp++;
-					OPCODE_NEXT;
+					OPCODE_NEXT_PREEMPT;
 				OPCODE_HANDLER(OPCODE_breakpoint): {/* 202 */
 
 #if BVM_DEBUGGER_ENABLE
@@ -3303,7 +5131,9 @@ opcode_athrow:
 
 						/* Send the breakpoint event.  Breakpoint events are never parked.  As a convenience, the
 						 * bvmd_event_Breakpoint function gives us the original opcode the breakpoint displaced. */
+						EXEC_STORE_REGISTERS;
 						bvmd_event_Breakpoint(&location);
+						EXEC_LOAD_REGISTERS;
 
 						bvm_gl_thread_current->dbg_is_at_breakpoint = BVM_TRUE;
 						if (!bvmd_breakpoint_opcode_for_location(&location, &(bvm_gl_thread_current->dbg_breakpoint_opcode))) {
@@ -3336,13 +5166,30 @@ opcode_pop_for_exception:
 					 * zero-based meaning 0 == current frame == no pops required. */
 					while (bvm_gl_thread_current->exception_location.depth--) {
 
+						EXEC_STORE_REGISTERS;
+
 						if (BVM_METHOD_IsSynchronized(bvm_gl_rx_method)) {
 							bvm_thread_monitor_release(BVM_STACK_ExecMethodSyncObject());
 						}
 
 						bvm_frame_pop();
+						EXEC_LOAD_REGISTERS;
 					}
 
+#if BVM_NI_CALLS_ENABLE
+					/* the exception has reached the wedge of a call from native code - the call ends with it */
+					if (bvm_gl_rx_method == BVM_METHOD_CALLBACKWEDGE) {
+						bvm_cell_t thrown;
+
+						thrown.ref_value = (bvm_obj_t *) throwable;
+						exception_location->throwable = NULL;
+
+						bvm_gl_rx_locals[1].callback(&thrown, &thrown, BVM_TRUE, bvm_gl_rx_locals[2].ref_value);
+						exec_call_returned = BVM_FALSE;
+						return;
+					}
+#endif
+
 					if (!exception_location->caught) {
 
 #if BVM_EXIT_ON_UNCAUGHT_EXCEPTION
@@ -3362,7 +5209,9 @@ opcode_pop_for_exception:
 #endif
 
 #else
+						EXEC_STORE_REGISTERS;
 						bvm_thread_push_exceptionhandler(throwable);
+						EXEC_LOAD_REGISTERS;
 
 						exception_location->throwable = NULL;
 
@@ -3402,8 +5251,6 @@ opcode_pop_for_exception:
 				OPCODE_HANDLER(OPCODE_215):
 					throw_unsupported_feature_exception();
 
-#if (!BVM_DEBUGGER_ENABLE)
-
 				/*
 				 * A series of faster version of the normal opcodes for fields.  The first
 				 * time a field opcode is performed in a method it is replaced with a faster
@@ -3412,8 +5259,6 @@ opcode_pop_for_exception:
 				 * and otherwise.  yes, a bit more code space - but worth the speed.  All thse
 				 * opcodes basically just perform pointer operations and copying.  No
 				 * function calls etc.
-				 *
-				 * Fast opcodes are only used when debugger support is *not* compiled in
 				 */
 
 				OPCODE_HANDLER(OPCODE_ldc_fast_1): { /* 216 */
@@ -3460,6 +5305,24 @@ opcode_pop_for_exception:
 					bvm_gl_rx_pc += 3;
 					OPCODE_NEXT;
 				}
+#if BVM_EXEC_CONSTANT_FOLDING_ENABLE
+				OPCODE_HANDLER(OPCODE_245_getstatic_fast_constant):  {/* 245 */
+					/* the value of the static final was folded into the field constant when quickened */
+					bvm_gl_rx_sp[0] = bvm_gl_rx_clazz->constant_pool[BVM_VM2UINT16(bvm_gl_rx_pc+1)].data.value;
+					bvm_gl_rx_sp++;
+					bvm_gl_rx_pc += 3;
+					OPCODE_NEXT;
+				}
+#endif
+#if BVM_EXEC_SWITCH_TABLES_ENABLE
+				OPCODE_HANDLER(OPCODE_246_tableswitch_fast): /* 246 */
+				OPCODE_HANDLER(OPCODE_247_lookupswitch_fast): {/* 247 */
+					/* the operands were decoded into a table when quickened */
+					bvm_gl_rx_pc += exec_switch_table_offset(bvm_gl_rx_method, bvm_gl_rx_pc, bvm_gl_rx_sp[-1].int_value);
+					bvm_gl_rx_sp--;
+					OPCODE_NEXT_PREEMPT;
+				}
+#endif
 				OPCODE_HANDLER(OPCODE_getstatic_fast_long):  {/* 221 */
 
 					bvm_field_t *field;
@@ -3485,7 +5348,9 @@ opcode_pop_for_exception:
 					/* get the optimised field */
 					field = bvm_gl_rx_clazz->constant_pool[index].resolved_ptr;
 
+					if (BVM_FIELD_IsReference(field)) EXEC_CHECK_SCOPED_STORE(field->clazz, bvm_gl_rx_sp[-1].ref_value);
 					field->value.static_value = bvm_gl_rx_sp[-1];
+					if (BVM_FIELD_IsReference(field)) BVM_GC_WRITE_BARRIER(field->clazz, bvm_gl_rx_sp[-1].ref_value);
 
 					bvm_gl_rx_sp--;
 					bvm_gl_rx_pc += 3;
@@ -3516,7 +5381,7 @@ opcode_pop_for_exception:
 					bvm_uint16_t index = BVM_VM2UINT16(bvm_gl_rx_pc+1);
 
 					/* No object?  Bang out. */
-					if (obj == NULL) throw_null_pointer_exception();
+					EXEC_NULL_CHECK(obj);
 
 					/* get the optimised field */
 					field = bvm_gl_rx_clazz->constant_pool[index].resolved_ptr;
@@ -3534,7 +5399,7 @@ opcode_pop_for_exception:
 					bvm_uint16_t index = BVM_VM2UINT16(bvm_gl_rx_pc+1);
 
 					/* No object?  Bang out. */
-					if (obj == NULL) throw_null_pointer_exception();
+					EXEC_NULL_CHECK(obj);
 
 					/* get the optimised field */
 					field = bvm_gl_rx_clazz->constant_pool[index].resolved_ptr;
@@ -3553,13 +5418,15 @@ opcode_pop_for_exception:
 					bvm_uint16_t index = BVM_VM2UINT16(bvm_gl_rx_pc+1);
 
 					/* No object?  Bang out. */
-					if (obj == NULL) throw_null_pointer_exception();
+					EXEC_NULL_CHECK(obj);
 
 					/* get optimised field */
 					field = bvm_gl_rx_clazz->constant_pool[index].resolved_ptr;
 
 					/* set the value of the object at the offset given by the field. */
+					if (BVM_FIELD_IsReference(field)) EXEC_CHECK_SCOPED_STORE(obj, bvm_gl_rx_sp[-1].ref_value);
 					obj->fields[field->value.offset] = bvm_gl_rx_sp[-1];
+					if (BVM_FIELD_IsReference(field)) BVM_GC_WRITE_BARRIER(obj, bvm_gl_rx_sp[-1].ref_value);
 
 					bvm_gl_rx_sp -= 2;
 					bvm_gl_rx_pc += 3;
@@ -3574,7 +5441,7 @@ opcode_pop_for_exception:
 					field = bvm_gl_rx_clazz->constant_pool[index].resolved_ptr;
 
 					/* No object?  Bang out. */
-					if (obj == NULL) throw_null_pointer_exception();
+					EXEC_NULL_CHECK(obj);
 
 					obj->fields[field->value.offset]   = bvm_gl_rx_sp[-2];
 					obj->fields[field->value.offset+1] = bvm_gl_rx_sp[-1];
@@ -3583,6 +5450,59 @@ opcode_pop_for_exception:
 					bvm_gl_rx_pc += 3;
 					OPCODE_NEXT;
 				}
+#if BVM_FIELD_PACKING_ENABLE
+				OPCODE_HANDLER(OPCODE_243_getfield_fast_packed): { /* 243 */
+
+					bvm_field_t *field;
+					bvm_obj_t *obj = bvm_gl_rx_sp[-1].ref_value;
+
+					/* No object?  Bang out. */
+					EXEC_NULL_CHECK(obj);
+
+					field = bvm_gl_rx_clazz->constant_pool[BVM_VM2UINT16(bvm_gl_rx_pc+1)].resolved_ptr;
+
+					/* read the field at its width - a long or double takes two cells */
+					bvm_object_get_packed_field(obj, field, &bvm_gl_rx_sp[-1]);
+					if (BVM_FIELD_IsLong(field)) bvm_gl_rx_sp++;
+
+					bvm_gl_rx_pc += 3;
+					OPCODE_NEXT;
+				}
+				OPCODE_HANDLER(OPCODE_244_putfield_fast_packed): { /* 244 */
+
+					bvm_field_t *field = bvm_gl_rx_clazz->constant_pool[BVM_VM2UINT16(bvm_gl_rx_pc+1)].resolved_ptr;
+					int cells = BVM_FIELD_IsLong(field) ? 2 : 1;
+					bvm_obj_t *obj = bvm_gl_rx_sp[-1-cells].ref_value;
+
+					/* No object?  Bang out. */
+					EXEC_NULL_CHECK(obj);
+
+					/* write the field at its width */
+					bvm_object_put_packed_field(obj, field, &bvm_gl_rx_sp[-cells]);
+
+					bvm_gl_rx_sp -= cells + 1;
+					bvm_gl_rx_pc += 3;
+					OPCODE_NEXT;
+				}
+#endif
+#if BVM_EXEC_STRING_CONCAT_ENABLE
+				OPCODE_HANDLER(OPCODE_248_new_concat): {/* 248 */
+
+					bvm_concat_t *concat = exec_concat_get(bvm_gl_rx_method, bvm_gl_rx_pc);
+
+					/* the whole idiom, up to and including the toString().  A String made in a scope would be made in
+					 * the heap, so there it is left as bytecode. */
+					if (!EXEC_IN_SCOPE && EXEC_CONCAT_IS_WHOLE(concat)) {
+						EXEC_STORE_REGISTERS;
+						bvm_gl_rx_sp[0].ref_value = (bvm_obj_t *) exec_concat_run(concat, bvm_gl_rx_clazz, bvm_gl_rx_locals);
+						bvm_gl_rx_sp++;
+						bvm_gl_rx_pc += concat->length;
+						OPCODE_NEXT;
+					}
+
+					/* otherwise, just the new - falls through */
+				}
+#endif
 				OPCODE_HANDLER(OPCODE_new_fast):  {/* 228 */
 
 					bvm_instance_clazz_t *cl;
@@ -3592,13 +5512,17 @@ opcode_pop_for_exception:
 					cl = (bvm_instance_clazz_t *) bvm_gl_rx_clazz->constant_pool[index].resolved_ptr;
 
 					/* create the object and push on the stack */
-					bvm_gl_rx_sp[0].ref_value = bvm_object_alloc(cl);
+					EXEC_NEW_OBJECT(bvm_gl_rx_sp[0].ref_value, cl);
 
 					bvm_gl_rx_sp++;
 					bvm_gl_rx_pc += 3;
 					OPCODE_NEXT;
 				}
-				OPCODE_HANDLER(OPCODE_229_invokestatic_fast): {
+				OPCODE_HANDLER(OPCODE_229_invokestatic_fast):
+#if (BVM_EXEC_INTRINSICS_ENABLE && BVM_NATIVE_BOX_CACHE_ENABLE)
+				exec_invokestatic_fast:
+#endif
+				{
 
 					bvm_uint16_t method_index = BVM_VM2INT16(bvm_gl_rx_pc+1);
 
@@ -3613,19 +5537,40 @@ opcode_pop_for_exception:
 
 					goto do_method_invocation;
 				}
-				OPCODE_HANDLER(OPCODE_230_invokespecial_fast): {
+				OPCODE_HANDLER(OPCODE_232_invokevirtual_fast):
+				OPCODE_HANDLER(OPCODE_230_invokespecial_fast):
+#if BVM_EXEC_ACCESSOR_INLINING_ENABLE
+				exec_invoke_fast:
+#endif
+				{
 					bvm_uint16_t method_index = BVM_VM2INT16(bvm_gl_rx_pc+1);
 
 					invoke_method = bvm_gl_rx_clazz->constant_pool[method_index].resolved_ptr;
 					invoke_clazz = invoke_method->clazz;
 
+#if BVM_EXEC_ACCESSOR_INLINING_ENABLE
+					/* a getter or setter can be done inline from now on - once its own access to its field is
+					 * resolved.  Until then it is invoked to resolve it. */
+					if ( (invoke_method->accessor != BVM_METHOD_ACCESSOR_NONE) && EXEC_ACCESSOR_INLINING_ALLOWED ) {
+
+						bvm_field_t *field = EXEC_ACCESSOR_FIELD(invoke_method);
+
+						if ( (field != NULL) && !BVM_FIELD_IsStatic(field) && !BVM_FIELD_IsLong(field) ) {
+							bvm_uint8_t opcode = (*bvm_gl_rx_pc == OPCODE_232_invokevirtual_fast) ?
+									OPCODE_239_invokevirtual_getter : OPCODE_241_invokespecial_getter;
+							if (invoke_method->accessor == BVM_METHOD_ACCESSOR_SETTER) opcode++;
+							EXEC_QUICKEN(opcode);
+						}
+					}
+#endif
+
 					invoke_nr_args = invoke_method->num_args+1;
 
 					/* the object ref_value we are making a call upon */
 					invoke_obj = bvm_gl_rx_sp[-invoke_nr_args].ref_value;
 
 					/* if no object throw a NullPointerException */
-					if (invoke_obj == NULL) throw_null_pointer_exception();
+					EXEC_NULL_CHECK(invoke_obj);
 
 					/* skip Object <init> method.  It does nothing so we'll save a small amount
 					 * of time (but we'll save it a lot of times). */
@@ -3640,50 +5585,264 @@ opcode_pop_for_exception:
 
 					goto do_method_invocation;
 				}
-				OPCODE_HANDLER(OPCODE_231_invokeinterface_fast): {
+#if BVM_EXEC_SUPERINSTRUCTIONS
+				OPCODE_HANDLER(OPCODE_233_aload_0_getfield): { /* 233 - aload_0, getfield_fast */
+
+					bvm_obj_t *obj = bvm_gl_rx_locals[0].ref_value;
+
+					if (EXEC_SUPER_FOLLOWS(1, OPCODE_getfield_fast)) {
+
+						bvm_field_t *field = bvm_gl_rx_clazz->constant_pool[BVM_VM2UINT16(bvm_gl_rx_pc+2)].resolved_ptr;
+
+						/* the exception belongs to the getfield */
+						if (obj == NULL) {
+							bvm_gl_rx_sp[0].ref_value = obj;
+							bvm_gl_rx_sp++;
+							bvm_gl_rx_pc++;
+							throw_null_pointer_exception();
+						}
+
+						bvm_gl_rx_sp[0] = obj->fields[field->value.offset];
+						bvm_gl_rx_sp++;
+						bvm_gl_rx_pc += 4;
+						OPCODE_NEXT;
+					}
+
+					/* just the aload_0 */
+					bvm_gl_rx_sp[0] = bvm_gl_rx_locals[0];
+					bvm_gl_rx_sp++;
+					bvm_gl_rx_pc++;
+					OPCODE_NEXT;
+				}
+				OPCODE_HANDLER(OPCODE_234_iload_iload): /* 234 - iload, iload */
+					bvm_gl_rx_sp[0] = bvm_gl_rx_locals[bvm_gl_rx_pc[1]];
+					if (EXEC_SUPER_FOLLOWS(2, OPCODE_iload)) {
+						bvm_gl_rx_sp[1] = bvm_gl_rx_locals[bvm_gl_rx_pc[3]];
+						bvm_gl_rx_sp += 2;
+						bvm_gl_rx_pc += 4;
+						OPCODE_NEXT;
+					}
+					bvm_gl_rx_sp++;
+					bvm_gl_rx_pc += 2;
+					OPCODE_NEXT;
+				OPCODE_HANDLER(OPCODE_235_iload_iload_if_icmp): { /* 235 - iload, iload, if_icmp<cond> */
+
+					bvm_uint8_t branch_opcode = bvm_gl_rx_pc[4];
+
+					if ( EXEC_SUPER_FOLLOWS(2, OPCODE_iload) &&
+						 (branch_opcode >= OPCODE_if_icmpeq) && (branch_opcode <= OPCODE_if_icmple) ) {
+
+						bvm_int32_t value1 = bvm_gl_rx_locals[bvm_gl_rx_pc[1]].int_value;
+						bvm_int32_t value2 = bvm_gl_rx_locals[bvm_gl_rx_pc[3]].int_value;
+						bvm_bool_t branch;
+
+						switch (branch_opcode) {
+							case OPCODE_if_icmpeq: branch = (value1 == value2); break;
+							case OPCODE_if_icmpne: branch = (value1 != value2); break;
+							case OPCODE_if_icmplt: branch = (value1 <  value2); break;
+							case OPCODE_if_icmpge: branch = (value1 >= value2); break;
+							case OPCODE_if_icmpgt: branch = (value1 >  value2); break;
+							default: 			   branch = (value1 <= value2); break;
+						}
+
+						/* the branch offset is relative to the if_icmp<cond> */
+						if (branch)
+							EXEC_GOTO(4 + BVM_VM2INT16(bvm_gl_rx_pc+5));
+						else
+							bvm_gl_rx_pc += 7;
+						OPCODE_NEXT_PREEMPT;
+					}
+
+					/* just the first iload */
+					bvm_gl_rx_sp[0] = bvm_gl_rx_locals[bvm_gl_rx_pc[1]];
+					bvm_gl_rx_sp++;
+					bvm_gl_rx_pc += 2;
+					OPCODE_NEXT;
+				}
+				OPCODE_HANDLER(OPCODE_236_aload_arraylength): { /* 236 - aload, arraylength */
+
+					bvm_jarray_obj_t *array_obj = (bvm_jarray_obj_t *) bvm_gl_rx_locals[bvm_gl_rx_pc[1]].ref_value;
+
+					if (EXEC_SUPER_FOLLOWS(2, OPCODE_arraylength)) {
+
+						/* the exception belongs to the arraylength */
+						if (array_obj == NULL) {
+							bvm_gl_rx_sp[0].ref_value = NULL;
+							bvm_gl_rx_sp++;
+							bvm_gl_rx_pc += 2;
+							throw_null_pointer_exception();
+						}
+
+						bvm_gl_rx_sp[0].int_value = array_obj->length.int_value;
+						bvm_gl_rx_sp++;
+						bvm_gl_rx_pc += 3;
+						OPCODE_NEXT;
+					}
+
+					/* just the aload */
+					bvm_gl_rx_sp[0] = bvm_gl_rx_locals[bvm_gl_rx_pc[1]];
+					bvm_gl_rx_sp++;
+					bvm_gl_rx_pc += 2;
 					OPCODE_NEXT;
 				}
-				OPCODE_HANDLER(OPCODE_232_invokevirtual_fast): {
+#endif
+#if BVM_EXEC_INTRINSICS_ENABLE
+				OPCODE_HANDLER(OPCODE_237_invokestatic_intrinsic): { /* 237 - an intrinsic static method */
+
+					bvm_method_t *method = bvm_gl_rx_clazz->constant_pool[BVM_VM2UINT16(bvm_gl_rx_pc+1)].resolved_ptr;
+
+					switch (method->intrinsic) {
+#if BVM_FLOAT_ENABLE
+						case BVM_EXEC_INTRINSIC_MATH_SQRT: {
+							bvm_double_t value = BVM_DOUBLE_from_cells(bvm_gl_rx_sp - 2);
+							BVM_DOUBLE_to_cells(bvm_gl_rx_sp - 2, sqrt(value));
+							break;
+						}
+#endif
+						case BVM_EXEC_INTRINSIC_SYSTEM_ARRAYCOPY:
+							EXEC_STORE_REGISTERS;
+							bvm_native_arraycopy(bvm_gl_rx_sp[-5].ref_value, bvm_gl_rx_sp[-4].int_value,
+									bvm_gl_rx_sp[-3].ref_value, bvm_gl_rx_sp[-2].int_value, bvm_gl_rx_sp[-1].int_value);
+							bvm_gl_rx_sp -= 5;
+							break;
+#if BVM_NATIVE_BOX_CACHE_ENABLE
+						case BVM_EXEC_INTRINSIC_INTEGER_VALUEOF: {
+							bvm_int32_t value = bvm_gl_rx_sp[-1].int_value;
+							/* a value with no cached box (yet) is boxed by the native */
+							if ( (value < BVM_NATIVE_BOX_INTEGER_MIN) || (value > BVM_NATIVE_BOX_INTEGER_MAX) ||
+								 (bvm_gl_native_integer_boxes[value - BVM_NATIVE_BOX_INTEGER_MIN] == NULL) )
+								goto exec_invokestatic_fast;
+							bvm_gl_rx_sp[-1].ref_value = bvm_gl_native_integer_boxes[value - BVM_NATIVE_BOX_INTEGER_MIN];
+							break;
+						}
+						case BVM_EXEC_INTRINSIC_CHARACTER_VALUEOF: {
+							bvm_int32_t value = bvm_gl_rx_sp[-1].int_value;
+							if ( (value > BVM_NATIVE_BOX_CHARACTER_MAX) || (bvm_gl_native_character_boxes[value] == NULL) )
+								goto exec_invokestatic_fast;
+							bvm_gl_rx_sp[-1].ref_value = bvm_gl_native_character_boxes[value];
+							break;
+						}
+#endif
+						default:
+							throw_unsupported_feature_exception();
+					}
+
+					bvm_gl_rx_pc += 3;
 					OPCODE_NEXT;
 				}
-#else
+				OPCODE_HANDLER(OPCODE_238_invokevirtual_intrinsic): { /* 238 - an intrinsic instance method */
 
-				/* If debugging support is compiled in, we do not use the fast opcodes */
-				OPCODE_HANDLER(OPCODE_ldc_fast_1):  /* 216 */
-				OPCODE_HANDLER(OPCODE_ldc_fast_2):  /* 217 */
-				OPCODE_HANDLER(OPCODE_ldc_w_fast_1): /* 218 */
-				OPCODE_HANDLER(OPCODE_ldc_w_fast_2): /* 219 */
-				OPCODE_HANDLER(OPCODE_getstatic_fast): /* 220 */
-				OPCODE_HANDLER(OPCODE_getstatic_fast_long): /* 221 */
-				OPCODE_HANDLER(OPCODE_putstatic_fast): /* 222 */
-				OPCODE_HANDLER(OPCODE_putstatic_fast_long): /* 223 */
-				OPCODE_HANDLER(OPCODE_getfield_fast): /* 224 */
-				OPCODE_HANDLER(OPCODE_getfield_fast_long):  /* 225 */
-				OPCODE_HANDLER(OPCODE_putfield_fast): /* 226 */
-				OPCODE_HANDLER(OPCODE_putfield_fast_long):  /* 227 */
-				OPCODE_HANDLER(OPCODE_new_fast):/* 228 */
-				OPCODE_HANDLER(OPCODE_229_invokestatic_fast):
-				OPCODE_HANDLER(OPCODE_230_invokespecial_fast):
+					bvm_method_t *method = bvm_gl_rx_clazz->constant_pool[BVM_VM2UINT16(bvm_gl_rx_pc+1)].resolved_ptr;
+					bvm_string_obj_t *string_obj = (bvm_string_obj_t *) bvm_gl_rx_sp[-(method->num_args+1)].ref_value;
+
+					EXEC_NULL_CHECK(string_obj);
+
+					switch (method->intrinsic) {
+						case BVM_EXEC_INTRINSIC_STRING_CHARAT: {
+							bvm_int32_t index = bvm_gl_rx_sp[-1].int_value;
+							if ( (index < 0) || (index >= string_obj->length.int_value) )
+								throw_array_index_bounds_exception();
+							bvm_gl_rx_sp[-2].int_value = string_obj->chars->data[string_obj->offset.int_value + index];
+							break;
+						}
+						case BVM_EXEC_INTRINSIC_STRING_HASHCODE:
+							bvm_gl_rx_sp[-1].int_value = bvm_string_hash_code(string_obj);
+							break;
+						case BVM_EXEC_INTRINSIC_STRING_EQUALS:
+							bvm_gl_rx_sp[-2].int_value = bvm_string_equals(string_obj, bvm_gl_rx_sp[-1].ref_value);
+							break;
+						default:
+							throw_unsupported_feature_exception();
+					}
+
+					/* the result replaces 'this' */
+					bvm_gl_rx_sp -= method->num_args;
+					bvm_gl_rx_pc += 3;
+					OPCODE_NEXT;
+				}
+#endif
+#if BVM_EXEC_ACCESSOR_INLINING_ENABLE
+				OPCODE_HANDLER(OPCODE_239_invokevirtual_getter):
+				OPCODE_HANDLER(OPCODE_241_invokespecial_getter): { /* 239, 241 - an inlined getter */
+
+					bvm_method_t *method = bvm_gl_rx_clazz->constant_pool[BVM_VM2UINT16(bvm_gl_rx_pc+1)].resolved_ptr;
+					bvm_obj_t *obj = bvm_gl_rx_sp[-1].ref_value;
+					bvm_field_t *field;
+
+					if (!EXEC_ACCESSOR_INLINING_ALLOWED) goto exec_invoke_fast;
+
+					EXEC_NULL_CHECK(obj);
+
+					field = method->clazz->constant_pool[BVM_VM2UINT16(method->code.bytecode+2)].resolved_ptr;
+
+#if BVM_FIELD_PACKING_ENABLE
+					if (BVM_FIELD_IsPacked(field))
+						bvm_object_get_packed_field(obj, field, &bvm_gl_rx_sp[-1]);
+					else
+#endif
+					bvm_gl_rx_sp[-1] = obj->fields[field->value.offset];
+					bvm_gl_rx_pc += 3;
+					OPCODE_NEXT;
+				}
+				OPCODE_HANDLER(OPCODE_240_invokevirtual_setter):
+				OPCODE_HANDLER(OPCODE_242_invokespecial_setter): { /* 240, 242 - an inlined setter */
+
+					bvm_method_t *method = bvm_gl_rx_clazz->constant_pool[BVM_VM2UINT16(bvm_gl_rx_pc+1)].resolved_ptr;
+					bvm_obj_t *obj = bvm_gl_rx_sp[-2].ref_value;
+					bvm_field_t *field;
+
+					if (!EXEC_ACCESSOR_INLINING_ALLOWED) goto exec_invoke_fast;
+
+					EXEC_NULL_CHECK(obj);
+
+					field = method->clazz->constant_pool[BVM_VM2UINT16(method->code.bytecode+3)].resolved_ptr;
+
+					if (BVM_FIELD_IsReference(field)) EXEC_CHECK_SCOPED_STORE(obj, bvm_gl_rx_sp[-1].ref_value);
+
+#if BVM_FIELD_PACKING_ENABLE
+					if (BVM_FIELD_IsPacked(field))
+						bvm_object_put_packed_field(obj, field, &bvm_gl_rx_sp[-1]);
+					else
+#endif
+					obj->fields[field->value.offset] = bvm_gl_rx_sp[-1];
+					if (BVM_FIELD_IsReference(field)) BVM_GC_WRITE_BARRIER(obj, bvm_gl_rx_sp[-1].ref_value);
+
+					bvm_gl_rx_sp -= 2;
+					bvm_gl_rx_pc += 3;
+					OPCODE_NEXT;
+				}
+#endif
 				OPCODE_HANDLER(OPCODE_231_invokeinterface_fast):
-				OPCODE_HANDLER(OPCODE_232_invokevirtual_fast):
-					throw_unsupported_feature_exception();
+#if (!BVM_EXEC_SUPERINSTRUCTIONS)
+				OPCODE_HANDLER(OPCODE_233_aload_0_getfield):
+				OPCODE_HANDLER(OPCODE_234_iload_iload):
+				OPCODE_HANDLER(OPCODE_235_iload_iload_if_icmp):
+				OPCODE_HANDLER(OPCODE_236_aload_arraylength):
+#endif
+#if (!BVM_EXEC_INTRINSICS_ENABLE)
+				OPCODE_HANDLER(OPCODE_237_invokestatic_intrinsic):
+				OPCODE_HANDLER(OPCODE_238_invokevirtual_intrinsic):
+#endif
+#if (!BVM_EXEC_ACCESSOR_INLINING_ENABLE)
+				OPCODE_HANDLER(OPCODE_239_invokevirtual_getter):
+				OPCODE_HANDLER(OPCODE_240_invokevirtual_setter):
+				OPCODE_HANDLER(OPCODE_241_invokespecial_getter):
+				OPCODE_HANDLER(OPCODE_242_invokespecial_setter):
+#endif
+#if (!BVM_FIELD_PACKING_ENABLE)
+				OPCODE_HANDLER(OPCODE_243_getfield_fast_packed):
+				OPCODE_HANDLER(OPCODE_244_putfield_fast_packed):
+#endif
+#if (!BVM_EXEC_CONSTANT_FOLDING_ENABLE)
+				OPCODE_HANDLER(OPCODE_245_getstatic_fast_constant):
+#endif
+#if (!BVM_EXEC_SWITCH_TABLES_ENABLE)
+				OPCODE_HANDLER(OPCODE_246_tableswitch_fast):
+				OPCODE_HANDLER(OPCODE_247_lookupswitch_fast):
+#endif
+#if (!BVM_EXEC_STRING_CONCAT_ENABLE)
+				OPCODE_HANDLER(OPCODE_248_new_concat):
 #endif
-				OPCODE_HANDLER(OPCODE_233):
-				OPCODE_HANDLER(OPCODE_234):
-				OPCODE_HANDLER(OPCODE_235):
-				OPCODE_HANDLER(OPCODE_236):
-				OPCODE_HANDLER(OPCODE_237):
-				OPCODE_HANDLER(OPCODE_238):
-				OPCODE_HANDLER(OPCODE_239):
-				OPCODE_HANDLER(OPCODE_240):
-				OPCODE_HANDLER(OPCODE_241):
-				OPCODE_HANDLER(OPCODE_242):
-				OPCODE_HANDLER(OPCODE_243):
-				OPCODE_HANDLER(OPCODE_244):
-				OPCODE_HANDLER(OPCODE_245):
-				OPCODE_HANDLER(OPCODE_246):
-				OPCODE_HANDLER(OPCODE_247):
-				OPCODE_HANDLER(OPCODE_248):
 				OPCODE_HANDLER(OPCODE_249):
 				OPCODE_HANDLER(OPCODE_250):
 				OPCODE_HANDLER(OPCODE_251):
@@ -3701,6 +5860,26 @@ do_method_invocation:
 
 				bvm_cell_t *arguments_pos;
 
+#if BVM_NATIVE_LEAF_CALLS_ENABLE
+				/* A leaf native never throws, allocates, blocks or looks at its own frame, so it is called with no
+				 * frame at all.  Its arguments are dropped from the stack first so that it pushes its return value
+				 * exactly where the invoke's result belongs - as if a frame had been pushed and popped. */
+				if (BVM_METHOD_IsLeafNative(invoke_method)) {
+
+					arguments_pos = bvm_gl_rx_sp - invoke_nr_args;
+					bvm_gl_rx_sp = arguments_pos;
+					bvm_gl_rx_pc += invoke_pc_offset;
+
+					BVM_PROFILER_COUNT_INVOCATION(invoke_method);
+
+					EXEC_STORE_REGISTERS;
+					invoke_method->code.nativemethod(arguments_pos);
+					EXEC_LOAD_REGISTERS;
+
+					OPCODE_NEXT;
+				}
+#endif
+
 				/* if the method is synchronised, we must try to acquire the monitor for the sync object.
 				 * For non-static methods, the sync object will be the object the method is
 				 * being called upon.  For static methods it is the Class object of the resolved clazz.
@@ -3709,6 +5888,8 @@ do_method_invocation:
 				 * current thread will be suspended.  We go to the top of the loop for a thread
 				 * switch, and at some other time when this executing thread wakes up we'll have
 				 * another attempt to acquire the monitor and really execute the method */
+				EXEC_STORE_REGISTERS;
+
 				if (BVM_METHOD_IsSynchronized(invoke_method)) {
 					if (!bvm_thread_monitor_acquire(invoke_obj, bvm_gl_thread_current))
 						goto top_of_interpreter_loop;
@@ -3730,6 +5911,7 @@ do_method_invocation:
 
 				/* Push a stack frame and also set the return registers info at the base of the frame */
 				bvm_frame_push(invoke_method, arguments_pos, bvm_gl_rx_pc, bvm_gl_rx_pc + invoke_pc_offset, invoke_obj);
+				EXEC_LOAD_REGISTERS;
 
                 /* different processing for native/bytecode methods.  A native method is
                  * called and its result processed immediately.  A non-native method
@@ -3741,6 +5923,12 @@ do_method_invocation:
 					 * push them as local variables into the new frame at the new frame's 'locals' start. */
 					memcpy(bvm_gl_rx_locals, arguments_pos, invoke_nr_args * sizeof(bvm_cell_t));
 
+					EXEC_AOT_ENTER(invoke_method);
+
+#if BVM_JIT_ENABLE
+					if (EXEC_JIT_HOT(invoke_method)) goto exec_jit_run;
+#endif
+					EXEC_IR_ENTER(invoke_method);
 					goto top_of_interpreter_loop;
 
 				} else {
@@ -3760,6 +5948,13 @@ do_method_invocation:
 						invoke_method->code.nativemethod(arguments_pos);
 					} BVM_END_TRANSIENT_BLOCK;
 
+#if BVM_NI_LOCAL_ARENA_ENABLE
+					if (bvm_gl_ni_arena != ni_arena_mark) bvm_ni_arena_release(ni_arena_mark);
+#endif
+
+					/* the native method may have pushed frames, or switched threads */
+					EXEC_LOAD_REGISTERS;
+
 					/* if we have come back from a native method and there is an exception
 					 * pending then throw it. */
 					if (bvm_gl_thread_current->pending_exception != NULL) {
@@ -3773,12 +5968,208 @@ do_method_invocation:
 				goto top_of_interpreter_loop;
 			}
 
+#if BVM_JIT_ENABLE
+			/* run the compiled code of the current method from the current pc, and carry on interpreting from
+			 * wherever it stops */
+			exec_jit_run:
+				bvm_gl_rx_pc = bvm_jit_run(bvm_gl_rx_method, bvm_gl_rx_locals, &bvm_gl_rx_sp, bvm_gl_rx_pc);
+				goto top_of_interpreter_loop;
+#endif
+
+#if BVM_AOT_ENABLE
+			/* run the C translation of the current method from the current pc, and carry on interpreting from
+			 * wherever it stops */
+			exec_aot_run:
+				bvm_gl_rx_pc = bvm_aot_run(bvm_gl_rx_method, bvm_gl_rx_locals, &bvm_gl_rx_sp, bvm_gl_rx_pc);
+				goto top_of_interpreter_loop;
+#endif
+
+#if BVM_EXEC_REGISTER_IR_ENABLE
+			/* run the register code of the current method from the current pc, and carry on interpreting from
+			 * wherever it stops */
+			exec_ir_run:
+				bvm_gl_rx_pc = bvm_ir_run(bvm_gl_rx_method, bvm_gl_rx_locals, &bvm_gl_rx_sp, bvm_gl_rx_pc);
+				goto top_of_interpreter_loop;
+#endif
+
 			OPCODE_DISPATCH_END
 		}
 
 	} BVM_CATCH(ex) {
 		/* catch an exception and defer handling to the athrow opcode */
 		throwable = ex;
+#if BVM_NI_LOCAL_ARENA_ENABLE
+		/* a native method that threw natively has not had its arena released */
+		if (bvm_gl_ni_arena != ni_arena_mark) bvm_ni_arena_release(ni_arena_mark);
+#endif
+		EXEC_LOAD_REGISTERS;
 		goto opcode_athrow;
 	} BVM_END_CATCH
 }
+
+#undef EXEC_THROW
+#if (BVM_EXEC_FAST_THROW_ENABLE && !BVM_USE_REGISTERS)
+#undef throw_null_pointer_exception
+#undef throw_array_index_bounds_exception
+#endif
+
+#if BVM_USE_REGISTERS
+#undef bvm_gl_rx_pc
+#undef bvm_gl_rx_sp
+#undef bvm_gl_rx_locals
+#undef throw_null_pointer_exception
+#undef throw_array_index_bounds_exception
+#undef throw_unsupported_feature_exception
+#undef throw_unsupported_feature_exception_float
+#undef bvm_throw_exception
+#endif
+
+#if BVM_NI_CALLS_ENABLE
+
+/**
+ * Call a Java method from native code and run it to completion.  A callback wedge frame is pushed above the current
+ * frame with the method above it, and the interpreter loop is run again until the method returns or throws to the
+ * wedge (see @ref exec-call).  Any frames of the method's clazz initialisation run first.
+ *
+ * An instance method is looked up in the clazz of the object it is called on, unless it is private or a constructor.
+ * A native method is called directly, with no frame, in the way of a leaf native (see #BVM_NATIVE_LEAF_CALLS_ENABLE).
+ *
+ * @param method the method to call.
+ * @param args the argument cells of the call, starting with the object it is made upon for an instance method.
+ * @param result where to put the cells returned by the method - in stack order.  May be \c NULL.
+ *
+ * @return the throwable the method ended with, or \c NULL if it returned normally.
+ *
+ * @throws #BVM_ERR_NULL_POINTER_EXCEPTION if an instance method is called upon \c NULL.
+ * @throws #BVM_ERR_ILLEGAL_THREAD_STATE_EXCEPTION if another thread has calls in progress.
+ * @throws #BVM_ERR_ABSTRACT_METHOD_ERROR if the method to call is abstract.
+ */
+bvm_throwable_obj_t *bvm_exec_call(bvm_method_t *method, bvm_cell_t *args, bvm_cell_t *result) {
+
+	exec_call_t call;
+	bvm_exception_frame_t *exception_stack = bvm_gl_exception_stack;
+	bvm_uint32_t transient_roots_top = bvm_gl_gc_transient_roots_top;
+	bvm_uint16_t nr_args = method->num_args;
+	bvm_obj_t *sync_obj = NULL;
+
+#if BVM_VM_SLICE_ENABLE
+	bvm_bool_t slice_active;
+#endif
+
+	/* each nested loop must return to the 'C' that entered it, so only one thread may be making calls */
+	if ( (exec_call_thread != NULL) && (exec_call_thread != bvm_gl_thread_current) )
+		bvm_throw_exception(BVM_ERR_ILLEGAL_THREAD_STATE_EXCEPTION, NULL);
+
+	if (!BVM_METHOD_IsStatic(method)) {
+
+		bvm_obj_t *obj = args[0].ref_value;
+
+		if (obj == NULL) bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+
+		/* the implementation of the method for the clazz of the object */
+		if ( !BVM_ACCESS_IsPrivate(BVM_METHOD_AccessFlags(method)) && (method->name->data[0] != '<') &&
+			 (method->clazz != (bvm_instance_clazz_t *) obj->clazz) ) {
+			method = locate_virtual_method(BVM_CLAZZ_IsInstanceClazz(obj->clazz) ? (bvm_instance_clazz_t *) obj->clazz : BVM_OBJECT_CLAZZ, method);
+		}
+
+		sync_obj = obj;
+		nr_args++;
+	} else {
+		sync_obj = (bvm_obj_t *) method->clazz->class_obj;
+	}
+
+	if (BVM_METHOD_IsAbstract(method))
+		bvm_throw_exception(BVM_ERR_ABSTRACT_METHOD_ERROR, NULL);
+
+	memset(&call, 0, sizeof(exec_call_t));
+
+	if (BVM_METHOD_IsNative(method)) {
+
+		/* a native returns its value at the stack pointer, which is left where it was */
+		bvm_cell_t *sp = bvm_gl_rx_sp;
+
+#if BVM_NI_LOCAL_ARENA_ENABLE
+		bvm_ni_arena_t *ni_arena_mark = bvm_gl_ni_arena;
+#endif
+
+		BVM_BEGIN_TRANSIENT_BLOCK {
+			method->code.nativemethod(args);
+		} BVM_END_TRANSIENT_BLOCK;
+
+#if BVM_NI_LOCAL_ARENA_ENABLE
+		if (bvm_gl_ni_arena != ni_arena_mark) bvm_ni_arena_release(ni_arena_mark);
+#endif
+
+		if (result != NULL) {
+			result[0] = sp[0];
+			result[1] = sp[1];
+		}
+
+		bvm_gl_rx_sp = sp;
+
+		call.exception = bvm_gl_thread_current->pending_exception;
+		bvm_gl_thread_current->pending_exception = NULL;
+
+		return call.exception;
+	}
+
+	/* a contended monitor is handed to the thread when it is released - with a depth of one, as if it had been
+	 * acquired here */
+	if (BVM_METHOD_IsSynchronized(method)) {
+		if (!bvm_thread_monitor_acquire(sync_obj, bvm_gl_thread_current))
+			bvm_gl_thread_current->lock_depth = 1;
+	}
+
+	/* the wedge that ends the call.  It is not the bottom of the stack so does not have the kill pc. */
+	bvm_frame_push(BVM_METHOD_CALLBACKWEDGE, bvm_gl_rx_sp, bvm_gl_rx_pc, bvm_gl_rx_pc, NULL);
+	bvm_gl_rx_locals[0].ref_value = NULL;
+	bvm_gl_rx_locals[1].callback = exec_call_callback;
+	bvm_gl_rx_locals[2].ptr_value = &call;
+
+	bvm_frame_push(method, bvm_gl_rx_sp, bvm_gl_rx_pc, bvm_gl_rx_pc, sync_obj);
+	memcpy(bvm_gl_rx_locals, args, nr_args * sizeof(bvm_cell_t));
+
+	/* may push the clazz's <clinit> above the method */
+	if (!BVM_CLAZZ_IsInitialised(method->clazz))
+		bvm_clazz_initialise(method->clazz);
+
+	exec_call_thread = bvm_gl_thread_current;
+	exec_call_depth++;
+
+#if BVM_VM_SLICE_ENABLE
+	/* the nested loop must run until the call is done, whatever is left of a slice */
+	slice_active = bvm_gl_exec_slice_active;
+	bvm_gl_exec_slice_active = BVM_FALSE;
+#endif
+
+	bvm_exec_run();
+
+#if BVM_VM_SLICE_ENABLE
+	bvm_gl_exec_slice_active = slice_active;
+#endif
+
+	/* the nested loop returned from within its BVM_TRY */
+	bvm_gl_exception_stack = exception_stack;
+	bvm_gl_gc_transient_roots_top = transient_roots_top;
+
+	if (--exec_call_depth == 0) exec_call_thread = NULL;
+
+	/* the loop only returns before the call is done when the last non-daemon thread has ended */
+	if (!call.is_done) BVM_VM_EXIT(0, NULL);
+
+	/* pop the wedge - back to the frame of the caller */
+	bvm_frame_pop();
+
+	if ( (result != NULL) && (call.exception == NULL) ) {
+		if (method->returns_value == 2) {
+			result[0] = call.res2;
+			result[1] = call.res1;
+		} else {
+			result[0] = call.res1;
+		}
+	}
+
+	return call.exception;
+}
+
+#endif
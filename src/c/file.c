@@ -48,7 +48,30 @@
  * int, and the underlying handle used by the OS.
  *
  * The size of the underlying file handles array is #bvm_gl_max_file_handles.  This number is defaulted to
- * #BVM_MAX_FILE_HANDLES if not set on the command line.
+ * #BVM_MAX_FILE_HANDLES if not set on the command line.  If #BVM_FILE_HANDLES_GROW_ENABLE is set, that is only the
+ * initial size - the array doubles in size when every handle is in use.  The unused handles are then kept in a list
+ * linked through the array, so an unused handle is found without scanning for one.
+ *
+ * @section buffering Buffering
+ *
+ * If #BVM_FILE_BUFFER_ENABLE is set, a file read with #bvm_file_buffered_read or written with #bvm_file_buffered_write
+ * is given a buffer of #BVM_FILE_BUFFER_SIZE bytes with its file handle.  The buffer holds either bytes read ahead of
+ * the reader or bytes written and not yet passed to the file - never both.  Reading after writing first passes the
+ * written bytes to the file and flushes it.  Writing after reading first moves the file position back to where the
+ * reader is up to, so the read-ahead is given back.  A read or write as large as the buffer goes straight to the file.
+ *
+ * The other functions of this unit synchronise the buffer with the file the same way before they act, so a buffered
+ * file can be positioned, sized, truncated, flushed and closed as usual.  Getting the position of a file with a
+ * read-ahead does not give it back - the position is worked out from the read-ahead instead.
+ *
+ * @section async Reads and writes on a host thread
+ *
+ * If #BVM_FILE_ASYNC_ENABLE is set, a read or write of an open file may be handed to a host OS thread with
+ * #bvm_file_async_start so that slow storage holds up only the Java thread that asked for it (see
+ * #bvm_thread_wait_for_file).  The platform handle of the file is lent to the read or write - the file handle looks
+ * closed to the rest of the VM until #bvm_file_async_poll finds the read or write done and gives it back.  The host
+ * thread only ever touches the platform handle and the bytes of its #bvm_file_async_t, which are static memory, so it
+ * needs nothing else of the VM.  If a host thread cannot be started the read or write is done there and then.
  *
   @author Greg McCreath
   @since 0.0.10
@@ -58,18 +81,213 @@
 /**
  * The default number of file handles.
  */
-int bvm_gl_max_file_handles = BVM_MAX_FILE_HANDLES;
+BVM_VM_LOCAL int bvm_gl_max_file_handles = BVM_MAX_FILE_HANDLES;
 
 typedef struct _filehandlestruct {
 	bvm_filetypeintf_t *type;
 	void *handle;
+#if BVM_FILE_MAP_ENABLE
+	/** the mapping of the file, or \c NULL if it is not mapped */
+	bvm_uint8_t *map;
+	/** the size of the mapping */
+	size_t map_size;
+#endif
+#if BVM_FILE_BUFFER_ENABLE
+	/** the buffer, or \c NULL if the file has not been read or written buffered */
+	struct _filebufferstruct *buffer;
+#endif
+#if BVM_FILE_ASYNC_ENABLE
+	/** the platform handle while it is lent to a read or write on a host thread - \c handle is \c NULL meanwhile */
+	void *lent;
+#endif
+#if BVM_FILE_HANDLES_GROW_ENABLE
+	/** for an unused handle, the next unused handle, or #BVM_ERR if there is none */
+	int next_free;
+#endif
 } filehandle_t;
 
+#if BVM_FILE_BUFFER_ENABLE
+
+/**
+ * The buffer of a file read or written with #bvm_file_buffered_read or #bvm_file_buffered_write.  It is allocated
+ * when first needed, and freed when the file is closed.
+ */
+typedef struct _filebufferstruct {
+	/** what the buffer holds - one of the \c FILE_BUFFER_* */
+	int mode;
+	/** the number of bytes the buffer holds */
+	size_t count;
+	/** for a read-ahead, the number of its bytes already read */
+	size_t pos;
+	/** the bytes */
+	bvm_uint8_t data[BVM_FILE_BUFFER_SIZE];
+} filebuffer_t;
+
+/** The buffer of a file holds nothing */
+#define FILE_BUFFER_NONE	0
+
+/** The buffer of a file holds bytes read ahead of the reader */
+#define FILE_BUFFER_READ	1
+
+/** The buffer of a file holds bytes written and not yet passed to the file */
+#define FILE_BUFFER_WRITE	2
+
+#endif
+
 /** Pointer to an array of file handles */
-filehandle_t *filehandles = NULL;
+BVM_VM_LOCAL filehandle_t *filehandles = NULL;
+
+#if BVM_FILE_HANDLES_GROW_ENABLE
+
+/** The number of handles in the file handles array */
+static BVM_VM_LOCAL int filehandles_length = 0;
+
+/** The first unused handle in the file handles array, or #BVM_ERR if all are in use */
+static BVM_VM_LOCAL int filehandles_free = BVM_ERR;
+
+#define FILE_HANDLES_LENGTH filehandles_length
+
+#else
+
+#define FILE_HANDLES_LENGTH bvm_gl_max_file_handles
+
+#endif
 
 /** Pointer to file type definition for md files */
-bvm_filetypeintf_t *bvm_gl_filetype_md = NULL;
+BVM_VM_LOCAL bvm_filetypeintf_t *bvm_gl_filetype_md = NULL;
+
+#if BVM_FILE_ASYNC_ENABLE
+
+/** The reads and writes started by #bvm_file_async_start that #bvm_file_async_poll has not yet found done */
+static BVM_VM_LOCAL bvm_file_async_t *file_async_list = NULL;
+
+/** The lock a host thread takes to mark its read or write done, or \c NULL if no lock could be created */
+static BVM_VM_LOCAL void *file_async_lock = NULL;
+
+#endif
+
+#if BVM_FILE_BUFFER_ENABLE
+
+/**
+ * Synchronise the buffer of a file with the file.  Written bytes are passed to the file, and a read-ahead is given
+ * back by moving the file position back to where the reader is up to.  The buffer is empty afterwards.
+ *
+ * @param fh the file handle
+ *
+ * @return zero, or #BVM_ERR if the file could not be written or positioned.
+ */
+static int file_buffer_sync(filehandle_t *fh) {
+
+	filebuffer_t *buffer = fh->buffer;
+	int ret = 0;
+
+	if (buffer->mode == FILE_BUFFER_WRITE) {
+		if (fh->type->write(buffer->data, buffer->count, fh->handle) != buffer->count)
+			ret = BVM_ERR;
+	} else if (buffer->mode == FILE_BUFFER_READ) {
+		if (fh->type->setpos(fh->handle, - (bvm_int32_t) (buffer->count - buffer->pos), BVM_FILE_SEEK_CUR) != 0)
+			ret = BVM_ERR;
+	}
+
+	buffer->mode = FILE_BUFFER_NONE;
+	buffer->count = 0;
+	buffer->pos = 0;
+
+	return ret;
+}
+
+/** What the buffer of a file holds - one of the \c FILE_BUFFER_* */
+#define FILE_BUFFER_MODE(fh) ( ((fh)->buffer == NULL) ? FILE_BUFFER_NONE : (fh)->buffer->mode )
+
+/** Synchronise the buffer of a file if it holds anything, returning #BVM_ERR from the calling function if that fails */
+#define FILE_BUFFER_SYNC(fh) if ( (FILE_BUFFER_MODE(fh) != FILE_BUFFER_NONE) && (file_buffer_sync(fh) != 0) ) return BVM_ERR;
+
+#else
+
+#define FILE_BUFFER_SYNC(fh)
+
+#endif
+
+#if BVM_FILE_HANDLES_GROW_ENABLE
+
+/**
+ * Make the file handles array the given number of handles long, keeping the handles already there.  The new handles are
+ * added to the free list, lowest first.
+ *
+ * @param length the new number of handles - more than the current number
+ * @throw OutOfMemoryError if the larger array cannot be allocated.
+ */
+static void file_handles_grow(int length) {
+
+	filehandle_t *grown = (filehandle_t *) bvm_heap_calloc(length * sizeof(filehandle_t), BVM_ALLOC_TYPE_STATIC);
+	int i = length;
+
+	if (filehandles != NULL) {
+		memcpy(grown, filehandles, filehandles_length * sizeof(filehandle_t));
+		bvm_heap_free(filehandles);
+	}
+
+	while (i-- > filehandles_length) {
+		grown[i].next_free = filehandles_free;
+		filehandles_free = i;
+	}
+
+	filehandles = grown;
+	filehandles_length = length;
+}
+
+#endif
+
+#if BVM_FILE_ASYNC_ENABLE
+
+/**
+ * Do the platform read or write of a #bvm_file_async_t.
+ *
+ * @param async the read or write
+ */
+static void file_async_io(bvm_file_async_t *async) {
+	async->result = (async->is_write) ?
+			async->type->write(async->data, async->count, async->handle) :
+			async->type->read(async->data, async->count, async->handle);
+}
+
+/**
+ * The body of the host thread of a read or write started by #bvm_file_async_start.  Nothing of the VM is touched but
+ * the #bvm_file_async_t itself.
+ *
+ * @param data the #bvm_file_async_t
+ */
+static void file_async_run(void *data) {
+
+	bvm_file_async_t *async = data;
+
+	file_async_io(async);
+
+	bvm_pd_system_lock(file_async_lock);
+	async->is_done = BVM_TRUE;
+	bvm_pd_system_unlock(file_async_lock);
+}
+
+/**
+ * Finish with the host thread of a read or write that is done (or waiting for it to be, at VM exit), and give the
+ * platform handle back to its file.
+ *
+ * @param async the read or write
+ */
+static void file_async_end(bvm_file_async_t *async) {
+
+	filehandle_t *fh = &filehandles[async->file];
+
+	if (async->thread != NULL) {
+		bvm_pd_system_thread_join(async->thread);
+		async->thread = NULL;
+	}
+
+	fh->handle = fh->lent;
+	fh->lent = NULL;
+}
+
+#endif
 
 /**
  * Initialise the VM file handling.  Creates the storage for files from the heap.  Note that size of the
@@ -78,7 +296,14 @@ bvm_filetypeintf_t *bvm_gl_filetype_md = NULL;
  */
 void bvm_init_io() {
 
+#if BVM_FILE_HANDLES_GROW_ENABLE
+	filehandles = NULL;
+	filehandles_length = 0;
+	filehandles_free = BVM_ERR;
+	file_handles_grow( (bvm_gl_max_file_handles > 0) ? bvm_gl_max_file_handles : 1);
+#else
 	filehandles = (filehandle_t *) bvm_heap_calloc(bvm_gl_max_file_handles * sizeof(filehandle_t), BVM_ALLOC_TYPE_STATIC);
+#endif
 
 	bvm_gl_filetype_md = bvm_heap_calloc(sizeof(bvm_filetypeintf_t), BVM_ALLOC_TYPE_STATIC);
 
@@ -95,6 +320,15 @@ void bvm_init_io() {
 	bvm_gl_filetype_md->rename 	= bvm_pd_file_rename;
 	bvm_gl_filetype_md->size 	 = bvm_pd_file_sizeof;
 	bvm_gl_filetype_md->truncate = bvm_pd_file_truncate;
+#if BVM_FILE_MAP_ENABLE
+	bvm_gl_filetype_md->map		 = bvm_pd_file_map;
+	bvm_gl_filetype_md->unmap	 = bvm_pd_file_unmap;
+#endif
+
+#if BVM_FILE_ASYNC_ENABLE
+	file_async_list = NULL;
+	file_async_lock = bvm_pd_system_lock_create();
+#endif
 }
 
 /**
@@ -102,7 +336,22 @@ void bvm_init_io() {
  * back to the heap.
  */
 void bvm_file_finalise() {
-	int lc = bvm_gl_max_file_handles;
+	int lc = FILE_HANDLES_LENGTH;
+
+#if BVM_FILE_ASYNC_ENABLE
+	/* wait for reads and writes still on host threads so their files are given back and closed */
+	while (file_async_list != NULL) {
+		bvm_file_async_t *async = file_async_list;
+		file_async_list = async->next;
+		file_async_end(async);
+		bvm_heap_free(async);
+	}
+
+	if (file_async_lock != NULL) {
+		bvm_pd_system_lock_destroy(file_async_lock);
+		file_async_lock = NULL;
+	}
+#endif
 
 	if (filehandles != NULL) {
 		while (lc--) {
@@ -116,6 +365,34 @@ void bvm_file_finalise() {
 	bvm_heap_free(bvm_gl_filetype_md);
 }
 
+#if BVM_FILE_HANDLES_GROW_ENABLE
+
+/**
+ * Get an unused file descriptor, doubling the size of the file descriptors array if all are in use.  The descriptor
+ * stays unused (and first in the free list) until it is taken with #take_descriptor.
+ *
+ * @return an int that is the file handle to use.
+ * @throw OutOfMemoryError if the file descriptors array cannot grow.
+ */
+static int get_next_descriptor() {
+
+	if (filehandles_free == BVM_ERR)
+		file_handles_grow(filehandles_length * 2);
+
+	return filehandles_free;
+}
+
+/**
+ * Take the file descriptor given by #get_next_descriptor out of the free list.
+ *
+ * @param file the file descriptor
+ */
+static void take_descriptor(int file) {
+	filehandles_free = filehandles[file].next_free;
+}
+
+#else
+
 /**
  * Scan the file descriptors array looking for an unused descriptor.
  *
@@ -125,12 +402,18 @@ static int get_next_descriptor() {
 	int i;
 
 	for (i=0;i < bvm_gl_max_file_handles ; i++) {
+#if BVM_FILE_ASYNC_ENABLE
+		if ( (filehandles[i].handle == NULL) && (filehandles[i].lent == NULL) ) return i;
+#else
 		if (filehandles[i].handle == NULL) return i;
+#endif
 	}
 
 	return BVM_ERR;
 }
 
+#endif
+
 /**
  * Create a full name of a given filename taking into account the 'home' directory for the VM.  The home
  * directory is contained in #bvm_gl_home_path.  The full name of a file is the filename appended to the
@@ -189,18 +472,33 @@ BVM_FILE bvm_file_open(bvm_filetypeintf_t *type, const char *filename, int flags
 	char fullname[255];
 	get_full_name(fullname, filename, 255);
 
+#if BVM_FILE_HANDLES_GROW_ENABLE
+	/* get the descriptor first - growing the descriptors array can throw and the platform handle would be lost */
+	file = get_next_descriptor();
+#endif
+
 	handle = type->open(fullname, flags);
 
 	if (handle == NULL)
 		return BVM_ERR; /* file opening failed */
 
+#if BVM_FILE_HANDLES_GROW_ENABLE
+	take_descriptor(file);
+#else
 	/* Get an available file descriptor */
 	file = get_next_descriptor();
+#endif
 
 	/* if there was a handle handle */
 	if (file != BVM_ERR) {
 		filehandles[file].type = type;
 		filehandles[file].handle = handle;
+#if BVM_FILE_MAP_ENABLE
+		filehandles[file].map = NULL;
+#endif
+#if BVM_FILE_BUFFER_ENABLE
+		filehandles[file].buffer = NULL;
+#endif
 	}
 
 	return file;
@@ -215,18 +513,76 @@ int bvm_file_close(BVM_FILE file) {
 
 	bvm_filetypeintf_t *type;
 	void *handle = filehandles[file].handle;
+#if BVM_FILE_BUFFER_ENABLE
+	int ret = 0;
+#endif
 
 	if (handle == NULL)
 		return BVM_ERR;
 
 	type = filehandles[file].type;
 
+#if BVM_FILE_BUFFER_ENABLE
+	if (filehandles[file].buffer != NULL) {
+		ret = file_buffer_sync(&filehandles[file]);
+		bvm_heap_free(filehandles[file].buffer);
+		filehandles[file].buffer = NULL;
+	}
+#endif
+
 	filehandles[file].handle = NULL;
 	filehandles[file].type   = NULL;
 
+#if BVM_FILE_HANDLES_GROW_ENABLE
+	/* the descriptor is the first to be used again */
+	filehandles[file].next_free = filehandles_free;
+	filehandles_free = file;
+#endif
+
+#if BVM_FILE_MAP_ENABLE
+	if (filehandles[file].map != NULL) {
+		type->unmap(filehandles[file].map, filehandles[file].map_size);
+		filehandles[file].map = NULL;
+	}
+#endif
+
+#if BVM_FILE_BUFFER_ENABLE
+	/* the file is closed regardless of whether its buffer could be written */
+	return (type->close(handle) != 0) ? BVM_ERR : ret;
+#else
 	return type->close(handle);
+#endif
+}
+
+#if BVM_FILE_MAP_ENABLE
+
+/**
+ * Map the whole of an open file into memory for reading.  A file is only mapped once - mapping it again gives the
+ * same mapping.  The mapping stays until the file is closed.
+ *
+ * @return the address of the mapping, or \c NULL if the file could not be mapped.  An empty file is not mapped.
+ */
+bvm_uint8_t *bvm_file_map(BVM_FILE file) {
+
+	filehandle_t *fh = &filehandles[file];
+
+	if ( (fh->map == NULL) && ( (fh->map_size = fh->type->size(fh->handle)) > 0) )
+		fh->map = fh->type->map(fh->handle, fh->map_size);
+
+	return fh->map;
+}
+
+/**
+ * Give the size of the mapping of an open file.
+ *
+ * @return the number of bytes mapped, or zero if the file is not mapped.
+ */
+size_t bvm_file_map_size(BVM_FILE file) {
+	return (filehandles[file].map == NULL) ? 0 : filehandles[file].map_size;
 }
 
+#endif
+
 /**
  * Read from a file.
  *
@@ -239,6 +595,8 @@ size_t bvm_file_read(void *dst, size_t size, BVM_FILE file) {
 	if (handle == NULL)
 		return BVM_ERR;
 
+	FILE_BUFFER_SYNC(&filehandles[file]);
+
 	return filehandles[file].type->read(dst, size, handle);
 }
 
@@ -254,6 +612,8 @@ size_t bvm_file_write(const void *src, size_t size, BVM_FILE file) {
 	if (handle == NULL)
 		return BVM_ERR;
 
+	FILE_BUFFER_SYNC(&filehandles[file]);
+
 	return filehandles[file].type->write(src, size, handle);
 }
 
@@ -269,6 +629,8 @@ int bvm_file_flush(BVM_FILE file) {
 	if (handle == NULL)
 		return BVM_ERR;
 
+	FILE_BUFFER_SYNC(&filehandles[file]);
+
 	return filehandles[file].type->flush(handle);
 }
 
@@ -285,6 +647,8 @@ int bvm_file_setpos(BVM_FILE file, bvm_int32_t offset, bvm_uint32_t origin) {
 	if (handle == NULL)
 		return BVM_ERR;
 
+	FILE_BUFFER_SYNC(&filehandles[file]);
+
 	return filehandles[file].type->setpos(handle, offset, origin);
 }
 
@@ -296,10 +660,25 @@ int bvm_file_setpos(BVM_FILE file, bvm_int32_t offset, bvm_uint32_t origin) {
 bvm_int32_t bvm_file_getpos(BVM_FILE file) {
 
 	void *handle = filehandles[file].handle;
+#if BVM_FILE_BUFFER_ENABLE
+	bvm_int32_t pos;
+#endif
 
 	if (handle == NULL)
 		return BVM_ERR;
 
+#if BVM_FILE_BUFFER_ENABLE
+	if (FILE_BUFFER_MODE(&filehandles[file]) == FILE_BUFFER_READ) {
+
+		/* the reader is behind the file position by what is left of the read-ahead */
+		pos = filehandles[file].type->getpos(handle);
+
+		return (pos == BVM_ERR) ? BVM_ERR : pos - (bvm_int32_t) (filehandles[file].buffer->count - filehandles[file].buffer->pos);
+	}
+
+	FILE_BUFFER_SYNC(&filehandles[file]);
+#endif
+
 	return filehandles[file].type->getpos(handle);
 }
 
@@ -315,10 +694,254 @@ size_t bvm_file_sizeof(BVM_FILE file) {
 	if (handle == NULL)
 		return BVM_ERR;
 
+#if BVM_FILE_BUFFER_ENABLE
+	/* a read-ahead does not change the size, written bytes may */
+	if (FILE_BUFFER_MODE(&filehandles[file]) == FILE_BUFFER_WRITE) {
+		FILE_BUFFER_SYNC(&filehandles[file]);
+	}
+#endif
+
 	return filehandles[file].type->size(handle);
 }
 
 
+#if BVM_FILE_BUFFER_ENABLE
+
+/**
+ * Read from a file through its buffer.  Bytes are taken from the read-ahead of the file, and the read-ahead is
+ * refilled with #BVM_FILE_BUFFER_SIZE bytes each time it runs out.  A read of what is left of a request that is at
+ * least as large as the buffer goes straight to the file.  Bytes written through the buffer are passed to the file and
+ * flushed first.
+ *
+ * @param dst where to read to
+ * @param size the number of bytes to read
+ * @param file the file
+ *
+ * @return the number of bytes read, which is less than requested only at the end of the file, or #BVM_ERR.
+ *
+ * @throws OutOfMemoryError if the buffer cannot be allocated.
+ */
+size_t bvm_file_buffered_read(void *dst, size_t size, BVM_FILE file) {
+
+	filehandle_t *fh = &filehandles[file];
+	filebuffer_t *buffer;
+	bvm_uint8_t *to = dst;
+	size_t done = 0;
+	size_t count;
+
+	if (fh->handle == NULL)
+		return BVM_ERR;
+
+	if (FILE_BUFFER_MODE(fh) == FILE_BUFFER_WRITE) {
+		if ( (file_buffer_sync(fh) != 0) || (fh->type->flush(fh->handle) != 0) )
+			return BVM_ERR;
+	}
+
+	buffer = fh->buffer;
+
+	while (done < size) {
+
+		count = (buffer == NULL) ? 0 : buffer->count - buffer->pos;
+
+		/* the read-ahead has run out.  An empty one is kept so a write that follows still positions the file */
+		if (count == 0) {
+
+			if (buffer != NULL) {
+				buffer->mode = FILE_BUFFER_READ;
+				buffer->count = 0;
+				buffer->pos = 0;
+			}
+
+			/* a large read does not need the buffer - a file only ever read this way never has one */
+			if (size - done >= BVM_FILE_BUFFER_SIZE)
+				return done + fh->type->read(to + done, size - done, fh->handle);
+
+			if (buffer == NULL) {
+				buffer = fh->buffer = bvm_heap_calloc(sizeof(filebuffer_t), BVM_ALLOC_TYPE_STATIC);
+				buffer->mode = FILE_BUFFER_READ;
+			}
+
+			count = fh->type->read(buffer->data, BVM_FILE_BUFFER_SIZE, fh->handle);
+
+			/* end of file, or an error */
+			if ( (count == 0) || (count > BVM_FILE_BUFFER_SIZE) ) break;
+
+			buffer->count = count;
+		}
+
+		if (count > size - done) count = size - done;
+
+		memcpy(to + done, buffer->data + buffer->pos, count);
+		buffer->pos += count;
+		done += count;
+	}
+
+	return done;
+}
+
+/**
+ * Write to a file through its buffer.  Bytes are gathered in the buffer and passed to the file when it fills, or when
+ * the file is otherwise read, positioned, sized, truncated, flushed or closed.  A write at least as large as the buffer
+ * goes straight to the file.  A read-ahead of the file is given back first.
+ *
+ * @param src where to write from
+ * @param size the number of bytes to write
+ * @param file the file
+ *
+ * @return the number of bytes written, which is less than \c size on error.
+ *
+ * @throws OutOfMemoryError if the buffer cannot be allocated.
+ */
+size_t bvm_file_buffered_write(const void *src, size_t size, BVM_FILE file) {
+
+	filehandle_t *fh = &filehandles[file];
+	filebuffer_t *buffer;
+
+	if (fh->handle == NULL)
+		return 0;
+
+	/* give back a read-ahead, or make room */
+	if ( (FILE_BUFFER_MODE(fh) == FILE_BUFFER_READ) || ( (fh->buffer != NULL) && (fh->buffer->count + size > BVM_FILE_BUFFER_SIZE) ) ) {
+		if (file_buffer_sync(fh) != 0) return 0;
+	}
+
+	/* a large write does not need the buffer */
+	if (size >= BVM_FILE_BUFFER_SIZE)
+		return fh->type->write(src, size, fh->handle);
+
+	/* the file may have been read without a buffer, and must be positioned before it is written */
+	if (fh->buffer == NULL) {
+		if (fh->type->setpos(fh->handle, 0, BVM_FILE_SEEK_CUR) != 0) return 0;
+		fh->buffer = bvm_heap_calloc(sizeof(filebuffer_t), BVM_ALLOC_TYPE_STATIC);
+	}
+
+	buffer = fh->buffer;
+
+	memcpy(buffer->data + buffer->count, src, size);
+	buffer->count += size;
+	buffer->mode = FILE_BUFFER_WRITE;
+
+	return size;
+}
+
+#endif
+
+#if BVM_FILE_ASYNC_ENABLE
+
+/**
+ * Start a read or write of an open file on a host OS thread.  Its buffer is synchronised with the file first, and the
+ * platform handle of the file is lent to the read or write until #bvm_file_async_poll gives it back - until then the
+ * file may not otherwise be used (its functions return #BVM_ERR as if it were closed).  If no host thread can be
+ * started the read or write is done before returning.
+ *
+ * The #bvm_file_async_t and its bytes are one static allocation.  Once #bvm_file_async_poll has returned it, it is the
+ * caller's to free with #bvm_file_async_free.
+ *
+ * @param file the file
+ * @param src for a write, the bytes to write - they are copied.  Unused for a read.
+ * @param count the number of bytes to read or write
+ * @param is_write whether to write rather than read
+ *
+ * @return the read or write, or \c NULL if the file is not open (or lent already) or its buffer could not be
+ * synchronised.
+ *
+ * @throws OutOfMemoryError if the read or write cannot be allocated.
+ */
+bvm_file_async_t *bvm_file_async_start(BVM_FILE file, const void *src, size_t count, bvm_bool_t is_write) {
+
+	filehandle_t *fh = &filehandles[file];
+	bvm_file_async_t *async;
+#if BVM_FILE_BUFFER_ENABLE
+	int mode = FILE_BUFFER_MODE(fh);
+#endif
+
+	if (fh->handle == NULL)
+		return NULL;
+
+#if BVM_FILE_BUFFER_ENABLE
+	/* written bytes are passed to the file and flushed before it is read, as for a buffered read */
+	if (mode != FILE_BUFFER_NONE) {
+		if ( (file_buffer_sync(fh) != 0) || ( (mode == FILE_BUFFER_WRITE) && (fh->type->flush(fh->handle) != 0) ) )
+			return NULL;
+	}
+#endif
+
+	async = bvm_heap_calloc(sizeof(bvm_file_async_t) + count, BVM_ALLOC_TYPE_STATIC);
+
+	async->file = file;
+	async->handle = fh->handle;
+	async->type = fh->type;
+	async->is_write = is_write;
+	async->data = (bvm_uint8_t *) (async + 1);
+	async->count = count;
+
+	if (is_write)
+		memcpy(async->data, src, count);
+
+	/* lend the platform handle */
+	fh->lent = fh->handle;
+	fh->handle = NULL;
+
+	if (file_async_lock != NULL)
+		async->thread = bvm_pd_system_thread_start(file_async_run, async);
+
+	/* no host thread - do it here */
+	if (async->thread == NULL) {
+		file_async_io(async);
+		async->is_done = BVM_TRUE;
+	}
+
+	async->next = file_async_list;
+	file_async_list = async;
+
+	return async;
+}
+
+/**
+ * Take a done read or write out of those started by #bvm_file_async_start, giving the platform handle back to its
+ * file.
+ *
+ * @return a read or write that is done, or \c NULL if none is.
+ */
+bvm_file_async_t *bvm_file_async_poll() {
+
+	bvm_file_async_t **link = &file_async_list;
+	bvm_file_async_t *async;
+	bvm_bool_t is_done;
+
+	while ( (async = *link) != NULL) {
+
+		if (async->thread != NULL) {
+			bvm_pd_system_lock(file_async_lock);
+			is_done = async->is_done;
+			bvm_pd_system_unlock(file_async_lock);
+		} else {
+			is_done = async->is_done;
+		}
+
+		if (is_done) {
+			*link = async->next;
+			file_async_end(async);
+			return async;
+		}
+
+		link = &async->next;
+	}
+
+	return NULL;
+}
+
+/**
+ * Free a read or write returned by #bvm_file_async_poll.
+ *
+ * @param async the read or write
+ */
+void bvm_file_async_free(bvm_file_async_t *async) {
+	bvm_heap_free(async);
+}
+
+#endif
+
 /**
  * Rename an file.
  *
@@ -359,6 +982,8 @@ int bvm_file_truncate(BVM_FILE file, size_t size) {
 	if (handle == NULL)
 		return BVM_ERR;
 
+	FILE_BUFFER_SYNC(&filehandles[file]);
+
 	return filehandles[file].type->truncate(handle, size);
 }
 
@@ -414,10 +1039,35 @@ bvm_filebuffer_t *bvm_create_buffer(size_t size, int alloc_type) {
 	bvm_filebuffer_t *buffer = bvm_heap_alloc(sizeof(bvm_filebuffer_t) + size, alloc_type);
 	buffer->length = size;
 	buffer->position = 0;
+#if BVM_FILE_MAP_ENABLE
+	buffer->data = buffer->bytes;
+#endif
 
 	return buffer;
 }
 
+#if BVM_FILE_MAP_ENABLE
+
+/**
+ * Allocate a buffer from the heap for data that is already in memory - part of a mapped file.  The data is not
+ * copied, so must stay in memory for as long as the buffer is used.  Only the buffer itself is freed when it is freed.
+ *
+ * @param data the data
+ * @param size the size of the data
+ * @param alloc_type the type of memory to allocate the buffer as
+ */
+bvm_filebuffer_t *bvm_create_mapped_buffer(bvm_uint8_t *data, size_t size, int alloc_type) {
+
+	bvm_filebuffer_t *buffer = bvm_heap_alloc(sizeof(bvm_filebuffer_t), alloc_type);
+	buffer->length = size;
+	buffer->position = 0;
+	buffer->data = data;
+
+	return buffer;
+}
+
+#endif
+
 /**
  * Read an endian-safe unsigned 16bit integer from a #bvm_filebuffer_t.
  *
@@ -539,3 +1189,74 @@ bvm_utfstring_t *bvm_file_read_utfstring(bvm_filebuffer_t *buffer, int alloc_typ
 	return str;
 }
 
+/**
+ * Read a #bvm_utfstring_t from a #bvm_filebuffer_t and return its pooled copy.  The chars are looked up in the utfstring
+ * pool where they lie in the buffer, so no memory is allocated or copied for a string that is already pooled - which,
+ * for the names and descriptors of a class's constants, is most of them.  Only a string that is not yet pooled is copied
+ * out of the buffer (as METADATA) and added to the pool.  The pooled copy always has chars of its own, so the buffer
+ * may be freed or unmapped afterwards.
+ *
+ * @param buffer the buffer to read
+ *
+ * @return the pooled #bvm_utfstring_t with the read chars
+ */
+bvm_utfstring_t *bvm_file_read_pooled_utfstring(bvm_filebuffer_t *buffer) {
+
+	bvm_utfstring_t tempstr;
+	bvm_utfstring_t *pooled_str;
+
+	/* a string of the chars in place in the buffer - it is never pooled */
+	tempstr.length = bvm_file_read_uint16(buffer);
+	tempstr.hash = 0;
+	tempstr.data = &buffer->data[buffer->position];
+
+	pooled_str = bvm_utfstring_pool_get(&tempstr, BVM_FALSE);
+
+	if (pooled_str == NULL) {
+
+		/* the allocation may GC, so the chars are copied from the buffer after it */
+		pooled_str = bvm_str_new_utfstring(tempstr.length, BVM_ALLOC_TYPE_METADATA);
+		memcpy(pooled_str->data, &buffer->data[buffer->position], tempstr.length);
+
+		bvm_utfstring_pool_add(pooled_str);
+	}
+
+	buffer->position += tempstr.length;
+
+	return pooled_str;
+}
+
+
+#if BVM_VM_SNAPSHOT_ENABLE
+
+/**
+ * Map the file handles for a VM snapshot being written - the buffers of the files hold no pointers.  See
+ * #bvm_snapshot_map_data.
+ */
+void bvm_file_snapshot_map() {
+
+#if BVM_FILE_HANDLES_GROW_ENABLE
+	int lc = filehandles_length;
+#else
+	int lc = bvm_gl_max_file_handles;
+#endif
+
+	bvm_snapshot_map_data(filehandles);
+
+	while (lc--) {
+		bvm_snapshot_map_pointer(&filehandles[lc].type);
+		bvm_snapshot_map_pointer(&filehandles[lc].handle);
+#if BVM_FILE_MAP_ENABLE
+		bvm_snapshot_map_pointer(&filehandles[lc].map);
+#endif
+#if BVM_FILE_BUFFER_ENABLE
+		bvm_snapshot_map_pointer(&filehandles[lc].buffer);
+		if (filehandles[lc].buffer != NULL) bvm_snapshot_map_data(filehandles[lc].buffer);
+#endif
+#if BVM_FILE_ASYNC_ENABLE
+		bvm_snapshot_map_pointer(&filehandles[lc].lent);
+#endif
+	}
+}
+
+#endif
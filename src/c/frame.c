@@ -97,6 +97,10 @@
   Unlike all other elements in a pushed frame which refer to the *calling* method, the sync object is for
   the currently executing method (the 'called' method).
 
+  With #BVM_FRAME_COMPACT_ENABLE the stack segment is not pushed - it is the segment holding the restored stack
+  pointer, and on the rare pop where that is not the current segment it is found by walking back the
+  #bvm_stacksegment_t::prev links.  The sync object is pushed only for a synchronized method.
+
   * a note about \c bvm_gl_rx_clazz:  This global register is not stored on the stack.  It can be
   derived easily from \c bvm_gl_rx_method each swap in/out of global registers.
 
@@ -121,7 +125,7 @@
   The size of each frame is calculated as such:
 
  @verbatim
-    method->max_stack + method->max_locals + BVM_STACK_RETURN_FRAME_SIZE;
+    method->max_stack + method->max_locals + BVM_STACK_FrameSize(method);
  @endverbatim
 
  Each Java method describes its max stack requirements and the max local values it has - both of these values are provided
@@ -142,25 +146,31 @@
 */
 
 /** Global 'stack pointer' register */
-bvm_cell_t *bvm_gl_rx_sp = NULL;
+BVM_VM_LOCAL bvm_cell_t *bvm_gl_rx_sp = NULL;
 
 /** Global 'program counter' register */
-bvm_uint8_t *bvm_gl_rx_pc = NULL;
+BVM_VM_LOCAL bvm_uint8_t *bvm_gl_rx_pc = NULL;
 
 /** Global 'previous program counter' register */
-bvm_uint8_t *bvm_gl_rx_ppc = NULL; // may not be needed anymore
+BVM_VM_LOCAL bvm_uint8_t *bvm_gl_rx_ppc = NULL; // may not be needed anymore
 
 /** Global 'current clazz' register */
-bvm_instance_clazz_t *bvm_gl_rx_clazz = NULL;
+BVM_VM_LOCAL bvm_instance_clazz_t *bvm_gl_rx_clazz = NULL;
 
 /** Global 'current executing method' register */
-bvm_method_t *bvm_gl_rx_method = NULL;
+BVM_VM_LOCAL bvm_method_t *bvm_gl_rx_method = NULL;
 
 /** Global 'element zero of the method-local variables' register */
-bvm_cell_t *bvm_gl_rx_locals = NULL;
+BVM_VM_LOCAL bvm_cell_t *bvm_gl_rx_locals = NULL;
 
 /** Global 'current stack segment' register */
-bvm_stacksegment_t *bvm_gl_rx_stack = NULL;
+BVM_VM_LOCAL bvm_stacksegment_t *bvm_gl_rx_stack = NULL;
+
+#if BVM_DEBUGGER_ENABLE
+/** Global 'frame count' register - the number of frames pushed and not yet popped on the current thread stack.  Kept
+ * so that debugger stepping can compare stack depths before each bytecode without walking the stack. */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_rx_depth = 0;
+#endif
 
 /**
  * Push a frame onto the current stack segment.  If the current stack segment is too small this
@@ -186,11 +196,15 @@ void bvm_frame_push(bvm_method_t *method, bvm_cell_t *current_sp, bvm_uint8_t *c
 
 	current_stack = bvm_gl_rx_stack;
 
+	/* the calling method's time ends here */
+	BVM_PROFILER_COUNT_TIME();
+	BVM_PROFILER_COUNT_INVOCATION(method);
+
 	/* Check for stack segment overflow (= cannot fit the next frame + method locals and op-stack).
 	 * If all this cannot fit, use the next one if it exists and will fit it.  If no next
 	 * one exists or it simply isn't big enough, allocate a new one.  */
 
-	required_size = method->max_stack + method->max_locals + BVM_STACK_RETURN_FRAME_SIZE;
+	required_size = method->max_stack + method->max_locals + BVM_STACK_FrameSize(method);
 
 	/* calc the starting address for the next frame.  It will be after the current frame.  Note if the
 	 * bvm_gl_rx_method is NULL then there is no current method executing .. that is, the VM is
@@ -210,6 +224,10 @@ void bvm_frame_push(bvm_method_t *method, bvm_cell_t *current_sp, bvm_uint8_t *c
 			/* ... so create it then ..*/
 			bvm_gl_rx_stack->next = bvm_thread_create_stack(real_size);
 
+#if BVM_FRAME_COMPACT_ENABLE
+			bvm_gl_rx_stack->next->prev = bvm_gl_rx_stack;
+#endif
+
 			/* make it the current stack */
 			bvm_gl_rx_stack = bvm_gl_rx_stack->next;
 
@@ -228,6 +246,21 @@ void bvm_frame_push(bvm_method_t *method, bvm_cell_t *current_sp, bvm_uint8_t *c
 
 	/* load up the global registers.  TODO Nice if this could be reduced to a single operation - might be faster ?*/
 
+#if BVM_FRAME_COMPACT_ENABLE
+
+	/* Push sync object onto the stack for a synchronised method only.  Ends up being at BVM_FRAME_SYNCOBJ_OFFSET */
+	if (BVM_METHOD_IsSynchronized(method))
+		(frame_cell_ptr++)->ptr_value 	= sync_obj;
+
+	(frame_cell_ptr++)->ptr_value 	= bvm_gl_rx_locals;
+	(frame_cell_ptr++)->ptr_value 	= current_sp;
+	(frame_cell_ptr++)->ptr_value 	= current_pc;
+	(frame_cell_ptr++)->ptr_value 	= next_pc;
+	(frame_cell_ptr++)->ptr_value 	= bvm_gl_rx_method;
+
+	UNUSED(current_stack);
+#else
+
 	/* Push current locals pointer onto stack.  Ends up being at BVM_FRAME_LOCALS_OFFSET */
 	(frame_cell_ptr++)->ptr_value 	= bvm_gl_rx_locals;
 
@@ -248,6 +281,7 @@ void bvm_frame_push(bvm_method_t *method, bvm_cell_t *current_sp, bvm_uint8_t *c
 
 	/* Push sync object onto the stack.  Ends up being at BVM_FRAME_SYNCOBJ_OFFSET */
 	(frame_cell_ptr++)->ptr_value 	= sync_obj;
+#endif
 
 	/* set the global registers to their new values for the being-called clazz/method */
 	bvm_gl_rx_method = method;
@@ -258,6 +292,15 @@ void bvm_frame_push(bvm_method_t *method, bvm_cell_t *current_sp, bvm_uint8_t *c
 
 	bvm_gl_rx_sp = bvm_gl_rx_locals + method->max_locals;
 	bvm_gl_rx_pc = method->code.bytecode;
+
+#if BVM_DEBUGGER_ENABLE
+	bvm_gl_rx_depth++;
+#endif
+
+#if BVM_SCOPED_MEMORY_ENABLE
+	/* a clazz is initialised in the heap, whatever scope the thread is in */
+	if (method == BVM_METHOD_DOINIT) bvm_scope_suspend();
+#endif
 }
 
 /**
@@ -270,14 +313,36 @@ void bvm_frame_pop() {
 
 	/* TODO - nice if this could be a single memory operation - might be faster ?*/
 	/*gl_sync_obj  = bvm_gl_rx_locals[BVM_FRAME_SYNCOBJ_OFFSET].ptr_value;*/
+
+	/* the popped method's time ends here */
+	BVM_PROFILER_COUNT_TIME();
+
+#if BVM_SCOPED_MEMORY_ENABLE
+	/* the end of a clazz initialisation - see #bvm_frame_push */
+	if (bvm_gl_rx_method == BVM_METHOD_DOINIT) bvm_scope_resume();
+#endif
+
+#if !BVM_FRAME_COMPACT_ENABLE
 	bvm_gl_rx_stack  = bvm_gl_rx_locals[BVM_FRAME_STACK_OFFSET].ptr_value;
+#endif
 	bvm_gl_rx_method = bvm_gl_rx_locals[BVM_FRAME_METHOD_OFFSET].ptr_value;
 	bvm_gl_rx_pc 	 = bvm_gl_rx_locals[BVM_FRAME_PC_OFFSET].ptr_value;
 	bvm_gl_rx_ppc 	 = bvm_gl_rx_locals[BVM_FRAME_PPC_OFFSET].ptr_value;
 	bvm_gl_rx_sp 	 = bvm_gl_rx_locals[BVM_FRAME_SP_OFFSET].ptr_value;
 	bvm_gl_rx_locals = bvm_gl_rx_locals[BVM_FRAME_LOCALS_OFFSET].ptr_value;
 
+#if BVM_FRAME_COMPACT_ENABLE
+	/* the calling frame lives in the segment that holds its stack pointer - if that is not this one, walk back
+	 * to it.  Only a pop across a segment boundary does this. */
+	while ( (bvm_gl_rx_sp < bvm_gl_rx_stack->body) || (bvm_gl_rx_sp >= bvm_gl_rx_stack->top) )
+		bvm_gl_rx_stack = bvm_gl_rx_stack->prev;
+#endif
+
 	bvm_gl_rx_clazz = (bvm_gl_rx_method == NULL) ? NULL : bvm_gl_rx_method->clazz;
+
+#if BVM_DEBUGGER_ENABLE
+	bvm_gl_rx_depth--;
+#endif
 }
 
 
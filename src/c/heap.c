@@ -33,20 +33,29 @@
 
  The allocator provides the ability for the VM to request some dynamic memory from the heap and also to put it back.
 
- This allocator could be described as a "coalescing best-fit" allocator.  It uses a two-way list of free
- space within the heap to quickly find a memory chunk of a given size using #bvm_heap_alloc().  When memory is given back to
- the allocator using #bvm_heap_free() the memory is coalesced with neighbouring chunks free chunks - if any.
+ This allocator could be described as a "coalescing segregated-fit" allocator.  It keeps free space within the heap in
+ a set of 'bins' so that a memory chunk of a given size can be quickly found using #bvm_heap_alloc().  When memory is
+ given back to the allocator using #bvm_heap_free() the memory is coalesced with neighbouring free chunks - if any.
 
- Each allocated 'chunk' of memory has a 4 byte header associated with it. The minimum chunk size is
- those 4 bytes + 3 pointers sizes - so for 32 bit, it is 16 bytes, and for 64 is 32 - when 8 byte alignment is taken
+ Each allocated 'chunk' of memory has a 4 byte header associated with it (or a \c size_t wide header - see below). The minimum
+ chunk size is the header + 3 pointers sizes - so for 32 bit, it is 16 bytes, and for 64 is 32 - when 8 byte alignment is taken
  into account.  Requesting \c bvm_heap_alloc(0) will still allocate the minimum bytes. The extra 3 pointers are using for
  housekeeping when the chunk is free (we'll get to that) - but are not used when the chunk is in use.  So for (say 32 bit)
  requesting \c bvm_heap_alloc(12) will still consume just those 16 bytes. There is a min size - but it is not all overhead.
 
- Chunks can be thought of as either 'free' or 'in use'.  Free chunks will have a reference to them in the 'free list'.
- The free list is a two-way linked list of 'free' chunks sorted in size order.  Smallest free chunks at the
- front, largest at the end.  When allocating the list is scanned in smallest-to-largest fashion looking for a
- free chunk that will accommodate the requested size.
+ Chunks can be thought of as either 'free' or 'in use'.  Free chunks will have a reference to them in exactly one free list 'bin'.
+ There are two kinds of bin:
+
+ @li 'small' bins.  Chunks smaller than #BVM_HEAP_SMALL_CHUNK_LIMIT are kept in exact-size bins - one bin for
+ each multiple of #BVM_CHUNK_ALIGN_SIZE.  Every chunk in a small bin is the same size, so a small bin is not ordered at all and
+ a small allocation that finds a non-empty bin of its size takes the first chunk from it without any searching or splitting.
+ @li 'large' bins.  Chunks of #BVM_HEAP_SMALL_CHUNK_LIMIT bytes or more are kept in a bin for each power-of-two range of sizes
+ above the limit.  Each large bin is a two-way list sorted in size order - smallest at the front, largest at the end - so the
+ first chunk in a bin big enough for a request is also the best fit within that bin.
+
+ A bitmap of non-empty bins is kept for both kinds of bin.  When the 'natural' bin for a request is empty the bitmap is used
+ to go straight to the next non-empty bin with larger chunks rather than visiting each empty bin in turn.  The common
+ object sizes are therefore allocated in constant time regardless of how fragmented the heap becomes.
 
  When memory is requested using #bvm_heap_alloc or #bvm_heap_calloc a memory 'allocation type' is
  specified.  The allocator does nothing with the allocation type except place it into the chunk
@@ -71,7 +80,8 @@
  depending on their free/in-use state, that is to say, when a chunk is free, its structure is used different to when in use.
  However, all chunks have a 4 byte (32 bit) header with the following structure :
 
- @li bits 01-24 : 24 bit - length (in bytes) of the chunk.  <i>Yes, largest chunk (therefore largest heap) is 16meg.</i>
+ @li bits 01-24 : 24 bit - length (in bytes) of the chunk.  <i>Yes, largest chunk (therefore largest heap) is 16meg - but see
+ the wide header below.</i>
  @li bits 25-28 : 4 bit - allocation 'type' of the memory, used by the garbage collector
  @li bits 29-30 C : 2 bit - used by garbage collector to specific a GC 'colour' for the chunk
  @li bit P   31 : 'prev-free' bit.  \c 1 if previous chunk in the heap is free (used to coalesce), \c 0 if not
@@ -85,6 +95,12 @@
          +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
  @endverbatim
 
+ If #BVM_HEAP_WIDE_HEADER_ENABLE is set (the default for 64 bit builds) the header is a \c size_t instead.  The low 8 bits are laid
+ out exactly as above and the size takes all the bits above them, so the heap may be as large as the 32 bit #bvm_gl_heap_size
+ allows.  On a 64 bit host the wide header costs nothing in practice - a 4 byte header is padded out by the 8 byte chunk alignment
+ anyway - and it has the bonus of leaving the user data of each chunk 8 byte aligned.  All header diagrams below are of the
+ compact header.
+
  After that header - for an in-use chunk - is the user-data, or for a free chunk is free-list
  housekeeping.
 
@@ -127,6 +143,15 @@ As below:
 
 You can see now why the minimum chunk size is header + 3 pointers. :-) yes, 'unused bytes' may be of zero length.
 
+With #BVM_HEAP_TINY_CHUNKS_ENABLE an in-use chunk may be as small as header + 2 pointers (#BVM_CHUNK_MIN_ALLOC_SIZE).  When
+such a chunk is freed and neither neighbour is free it has room for its back-pointer but not for both free list pointers, so it
+is simply not put in the free list.  It is still a valid free chunk with its U bit clear and the P bit of the next chunk set,
+so freeing either neighbour coalesces it back into a listed chunk.  A chunk is only ever split when the remainder would be big
+enough to list.
+
+With #BVM_THIN_LOCK_HEADER_ENABLE (64 bit wide headers only) the bits of the header above the 32 bit size hold the thin lock
+word of the object in the chunk.  They are cleared when the chunk is freed.
+
 When a chunk is freed its U bit is unset, and then if the chunk's P bit is set it removes the previous
 chunk from the free list and joins with it to form a larger chunk.  Also, if a chunk's P bit is set it can look at
 the previous bytes (just before its own address) to get a pointer to the beginning of the previous chunk.
@@ -155,10 +180,92 @@ requested size + overhead.  It is removed from the free list.  If the found free
 into another valid chunk then it is split and the remainder put back into the free list. This simple algorithm means we only take what is needed
 from a free chunk and give the rest back to the allocator.
 
+Thread allocation buffers:
+
+If #BVM_HEAP_TLAB_ENABLE is set, allocations smaller than #BVM_HEAP_SMALL_CHUNK_LIMIT are 'bump' allocated from a
+buffer of #BVM_HEAP_TLAB_SIZE bytes that is taken from the free list on behalf of the current thread.  The buffer is zeroed
+when it is taken, so callers that want zeroed memory do not need to clear it again.
+
+The unused remainder of a buffer is always kept as an in-use chunk in its own right, starting at #bvm_gl_heap_tlab_top.
+Allocating from the buffer simply writes a header for the new chunk over the remainder's header and writes a new remainder header
+just after it.  The heap is therefore always walkable (the GC does not need to know about buffers) and any chunk in a
+buffer may be freed as normal.  The #BVM_HEAP_TLAB_TRY_ALLOC macro is the inline fast path - the interpreter uses it directly
+for \c new.
+
+A buffer is 'retired' by #bvm_heap_tlab_retire() at each thread switch and before each GC - the remainder chunk is just freed back
+into the free list (coalescing as usual).  Only one thread runs at a time, so there is only ever one buffer.
+
 Exhaustion:
 
 If memory is requested and none can be granted for the requested size, a GC is performed and then
-the allocation re-attempted.  A second failure will cause an out-of-memory situation (and an out of memory exception to be thrown).
+the allocation re-attempted.  If that fails the heap is grown (see below) and the allocation tried once more.  A final failure
+will cause an out-of-memory situation (and an out of memory exception to be thrown).
+
+Regions:
+
+The heap is made of one or more regions, each a block of memory from #bvm_pd_memory_alloc (or from
+#bvm_pd_memory_heap_alloc, below 4gb, with #BVM_COMPRESSED_REFS_ENABLE).  The first region is the initial heap of #bvm_gl_heap_size bytes.  After each GC #bvm_heap_adjust_regions() returns any other region that is now
+entirely free to the platform, and adds a new region if less than #bvm_gl_heap_grow_percent of the heap is free.  The heap
+never grows beyond #bvm_gl_heap_limit - which by default means it does not grow at all.  Each region ends with a small in-use
+'fence' chunk so that chunks in different regions are never coalesced.  #bvm_gl_heap_start and #bvm_gl_heap_end bound all
+regions, but there may be non-heap memory between regions - use #BVM_HEAP_IsHeapAddress to test a pointer.
+
+Large Objects:
+
+If #BVM_HEAP_LARGE_OBJECT_ENABLE is set a primitive array of at least #bvm_gl_heap_large_object_size bytes is not
+taken from the free list.  It is given a region of its own (a whole number of #BVM_HEAP_LARGE_OBJECT_PAGE_SIZE pages)
+holding just the array and the fence.  Big buffers therefore never fragment the free list, small allocations never
+split the memory they leave behind, and the sweep of the region is a single chunk.  When the array is swept (or freed)
+the whole region goes back to the platform with #bvm_heap_release_large_region.  Large object regions count towards
+the heap size, so they are only used while the heap may grow (see #bvm_gl_heap_limit) - otherwise, or if the platform
+cannot provide the memory, the array is allocated from the free list as normal.
+
+Metadata Arena:
+
+If #BVM_HEAP_METADATA_ARENA_ENABLE is set the VM's own long-lived data (allocated as #BVM_ALLOC_TYPE_METADATA) is not
+taken from the heap at all.  It comes from a metadata arena - a list of regions of its own from the platform, at least
+#BVM_HEAP_METADATA_REGION_SIZE bytes each, that the collector never walks.  Each allocation is bumped off the top of the
+current region and laid out as an in-use chunk of alloc type #BVM_ALLOC_TYPE_METADATA, so #bvm_heap_free knows it by its
+header and gives it back to the arena.  Freed arena chunks are kept in lists of their own - exact size lists for small
+chunks, and one first-fit list for the rest - and are reused before the top is bumped.  A chunk freed from the top of
+the current region just moves the top back down.  When the last chunk in a region is freed the region is given back to
+the platform (or, if it is the current region, its top goes back to its start).  The arena does not count towards the
+heap size.
+
+The metadata of a clazz loaded by a class loader other than the bootstrap and system loaders comes from an arena of the
+loader's own, with smaller regions (#BVM_HEAP_METADATA_LOADER_REGION_SIZE) - see #BVM_ALLOC_TYPE_CLAZZ_METADATA.  Each
+clazz holds the arena, and when the last of them is unloaded the collector releases it with
+#bvm_heap_metadata_arena_release, which gives all its regions back to the platform at once rather than freeing the
+clazzes' tables one by one.  Strings in the utfstring pool are shared between loaders, so they stay in the default arena.
+
+Lazy Sweeping:
+
+If #BVM_GC_LAZY_SWEEP_ENABLE is set the GC leaves the heap unswept and #bvm_heap_alloc sweeps it a step at a time with
+#bvm_gc_sweep_step when no free chunk fits - a GC is only done once the sweep is finished.  While a sweep is pending, a chunk
+allocated ahead of the sweep position is coloured black so the sweeper does not free it, and free chunks are not coalesced
+across the sweep position.
+
+Concurrent Sweeping:
+
+If #BVM_GC_CONCURRENT_SWEEP_ENABLE is set the GC empties the free list and a host OS thread sweeps the heap while the
+interpreter carries on.  The sweeper does not touch the free list.  It joins up the free and unreachable chunks it passes
+into free chunks of their own, and every #BVM_GC_CONCURRENT_SWEEP_STEP bytes hands them back - ending at a live chunk, or
+the end of a region.  #bvm_heap_alloc picks them up with #bvm_gc_sweep_step when no free chunk fits, and moves the sweep
+position (#bvm_gl_heap_sweep_chunk) to the first chunk not yet handed back.  The sweeper owns the header of that chunk
+and everything after it, so free chunks are not coalesced with it and its P bit is left alone - it may be left clear
+with a free chunk before it, which only costs a coalesce.  A chunk freed with #bvm_heap_free that the sweeper has not
+handed back is held in a list of its own and freed when the sweep is done.  The sweeper changes the colour of live
+chunks with an atomic compare-and-swap, as does #bvm_heap_set_alloc_type while a sweep is pending.
+
+Idle Zeroing:
+
+If #BVM_HEAP_IDLE_ZERO_ENABLE is set the VM zeroes free chunks in the large bins with #bvm_heap_zero_step while it is
+idle, biggest bins first, and at most #BVM_HEAP_IDLE_ZERO_STEP bytes at a time - a chunk too big for one step is
+carried on with at the next.  Everything in a zeroed chunk but its free list links and its last word (the back-pointer
+to its start) is zero, and it is flagged by giving it the otherwise unused alloc type #HEAP_CHUNK_TYPE_ZEROED.  The flag
+goes as soon as the chunk header is rewritten - when it is coalesced or split.  When a zeroed chunk is taken from the
+free list its links and last word are cleared, and #bvm_heap_calloc (as well as a new thread allocation buffer) skips
+its own zeroing.  The remainder split off a zeroed chunk is still zero, so keeps the flag.
 
 Other Notes:
 
@@ -178,29 +285,384 @@ This is a fairly vanilla implementation and as-of-yet, no major optimisation has
 
 #include "../h/bvm.h"
 
-/** A pointer to the first byte of the heap */
-bvm_uint8_t *bvm_gl_heap_start;
+/** A pointer to the first byte of the lowest heap region */
+BVM_VM_LOCAL bvm_uint8_t *bvm_gl_heap_start;
+
+/** A pointer to one byte past the last byte of the highest heap region */
+BVM_VM_LOCAL bvm_uint8_t *bvm_gl_heap_end;
 
-/** A pointer to one byte past the last byte of the heap */
-bvm_uint8_t *bvm_gl_heap_end;
+/** The list of heap regions.  The first region is the initial heap and is never released. */
+BVM_VM_LOCAL bvm_heap_region_t *bvm_gl_heap_regions = NULL;
 
 /** The total memory (in bytes) in the free list */
-bvm_uint32_t bvm_gl_heap_free;
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_heap_free;
+
+/** The number of chunks in the free list */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_heap_free_chunks;
+
+/** The bytes taken from the free list since the last GC began */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_heap_allocated;
 
 /**
  * The total heap size in bytes.  Defaults to #BVM_HEAP_SIZE.
  */
-bvm_uint32_t bvm_gl_heap_size = BVM_HEAP_SIZE;
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_heap_size = BVM_HEAP_SIZE;
+
+/**
+ * The maximum size in bytes the heap may grow to.  Defaults to #BVM_HEAP_LIMIT.
+ */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_heap_limit = BVM_HEAP_LIMIT;
+
+#if BVM_HEAP_LARGE_OBJECT_ENABLE
+
+/**
+ * Primitive arrays of at least this many bytes are given a large object region of their own.  Defaults to
+ * #BVM_HEAP_LARGE_OBJECT_SIZE.
+ */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_heap_large_object_size = BVM_HEAP_LARGE_OBJECT_SIZE;
+
+#endif
+
+/**
+ * The free percentage below which the heap grows after a GC.  Defaults to #BVM_HEAP_GROW_PERCENT.
+ */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_heap_grow_percent = BVM_HEAP_GROW_PERCENT;
+
+/** The space at the start of each region for the region struct - rounded up so the first chunk is aligned. */
+#define HEAP_REGION_OVERHEAD	((sizeof(bvm_heap_region_t) + BVM_CHUNK_ALIGN_MASK) & ~BVM_CHUNK_ALIGN_MASK)
+
+/** The size of the in-use fence chunk at the end of each region */
+#define HEAP_FENCE_SIZE			BVM_CHUNK_MIN_SIZE
+
+/**
+ * Get and give back the platform memory of a region.  With #BVM_COMPRESSED_REFS_ENABLE it must lie below 4gb - the
+ * size it was got with is worked out again from the region when it is given back.
+ */
+#if BVM_COMPRESSED_REFS_ENABLE
+#define HEAP_REGION_ALLOC(s)			bvm_pd_memory_heap_alloc(s)
+#define HEAP_REGION_FREE_SIZED(r, s)	bvm_pd_memory_heap_free((r), (s))
+#else
+#define HEAP_REGION_ALLOC(s)			bvm_pd_memory_alloc(s)
+#define HEAP_REGION_FREE_SIZED(r, s)	bvm_pd_memory_free(r)
+#endif
+#define HEAP_REGION_FREE(r)				HEAP_REGION_FREE_SIZED((r), HEAP_REGION_OVERHEAD + ((r)->end - (r)->start) + HEAP_FENCE_SIZE)
+
+#if BVM_HEAP_METADATA_ARENA_ENABLE
+
+/** The total size in bytes of the metadata arena regions */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_heap_metadata_size = 0;
+
+/** The bytes of the metadata arena in in-use chunks */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_heap_metadata_used = 0;
+
+/** The arena for the next #BVM_ALLOC_TYPE_METADATA allocation, or \c NULL for the default arena.  Set by
+ * #BVM_ALLOC_TYPE_CLAZZ_METADATA and cleared by the allocation. */
+BVM_VM_LOCAL bvm_heap_metadata_arena_t *bvm_gl_heap_metadata_arena = NULL;
+
+/**
+ * A region of a metadata arena.  Like a heap region, the struct sits at the start of its block and the chunks follow
+ * it.  Chunks are bumped off #top - the memory from there to #end has never been used.
+ */
+typedef struct _bvmheapmetadataregionstruct {
+
+	/** The next region in the arena */
+	struct _bvmheapmetadataregionstruct *next;
+
+	/** The arena the region belongs to */
+	bvm_heap_metadata_arena_t *arena;
+
+	/** The first chunk in the region */
+	bvm_uint8_t *start;
+
+	/** The first byte not yet bumped off */
+	bvm_uint8_t *top;
+
+	/** One byte past the end of the region */
+	bvm_uint8_t *end;
+
+	/** The bytes of the region in in-use chunks */
+	bvm_uint32_t used;
+
+} heap_metadata_region_t;
+
+/** The space at the start of each arena region for the region struct - rounded up so the first chunk is aligned. */
+#define HEAP_METADATA_REGION_OVERHEAD	((sizeof(heap_metadata_region_t) + BVM_CHUNK_ALIGN_MASK) & ~BVM_CHUNK_ALIGN_MASK)
+
+/** Free arena chunks smaller than this many bytes are kept in exact size lists */
+#define HEAP_METADATA_SMALL_LIMIT	256
+
+/** The smallest arena chunk - it must hold the free list link when it is free */
+#define HEAP_METADATA_MIN_SIZE		BVM_CHUNK_AlignedSize(sizeof(bvm_chunk_t *))
+
+/** The link to the next free arena chunk is the first word of its user data */
+#define HEAP_METADATA_NextFree(c)	(*(bvm_chunk_t **) BVM_CHUNK_GetUserData(c))
+
+/**
+ * A metadata arena - the default arena, or the arena of the clazzes of a class loader.
+ */
+struct _bvmheapmetadataarenastruct {
+
+	/** The regions of the arena - the first is the one chunks are bumped from */
+	heap_metadata_region_t *regions;
+
+	/** Exact size lists of free small chunks - list \c i holds chunks of \c i * #BVM_CHUNK_ALIGN_SIZE bytes */
+	bvm_chunk_t *small_free[HEAP_METADATA_SMALL_LIMIT / BVM_CHUNK_ALIGN_SIZE];
+
+	/** The free chunks of #HEAP_METADATA_SMALL_LIMIT bytes or more */
+	bvm_chunk_t *large_free;
+
+	/** For a class loader arena, the number of clazzes that have their metadata in it */
+	bvm_uint32_t clazz_count;
+
+	/** For a class loader arena, the next class loader arena */
+	bvm_heap_metadata_arena_t *next;
+};
+
+/** The default metadata arena */
+static BVM_VM_LOCAL bvm_heap_metadata_arena_t heap_metadata_default;
+
+/** The class loader metadata arenas */
+static BVM_VM_LOCAL bvm_heap_metadata_arena_t *heap_metadata_loader_arenas = NULL;
+
+#endif
+
+#if BVM_HEAP_TLAB_ENABLE
+
+/** The chunk holding the unused remainder of the current thread allocation buffer, or \c NULL if there is none. */
+BVM_VM_LOCAL bvm_uint8_t *bvm_gl_heap_tlab_top = NULL;
+
+/** A pointer to one byte past the last byte of the current thread allocation buffer. */
+BVM_VM_LOCAL bvm_uint8_t *bvm_gl_heap_tlab_end = NULL;
+
+#if BVM_GC_LAZY_SWEEP_ENABLE
+
+/** The GC colour bits for chunks allocated from the current thread allocation buffer. */
+BVM_VM_LOCAL bvm_chunk_header_t bvm_gl_heap_tlab_colour = 0;
+
+#endif
+
+#endif
+
+#if (BVM_GC_LAZY_SWEEP_ENABLE || BVM_GC_CONCURRENT_SWEEP_ENABLE)
+
+/** The region being lazily swept, or \c NULL if no sweep is pending. */
+BVM_VM_LOCAL bvm_heap_region_t *bvm_gl_heap_sweep_region = NULL;
+
+/** The next chunk to be lazily swept.  Free chunks are never coalesced across it. */
+BVM_VM_LOCAL bvm_chunk_t *bvm_gl_heap_sweep_chunk = NULL;
+
+/** Is the given chunk where the lazy sweeper will resume?  Free chunks are not coalesced across it. */
+#define HEAP_IsSweepPosition(c)	((c) == bvm_gl_heap_sweep_chunk)
+
+#else
+#define HEAP_IsSweepPosition(c)	BVM_FALSE
+#endif
+
+#if BVM_GC_CONCURRENT_SWEEP_ENABLE
+
+/** Chunks freed ahead of the concurrent sweeper - linked through their first word of user data.  They are freed once the
+ * sweep is done. */
+static BVM_VM_LOCAL bvm_chunk_t *heap_held_chunks = NULL;
+
+#endif
+
+#if BVM_HEAP_IDLE_ZERO_ENABLE
+
+/** The alloc type given to a free chunk that is known to be zero (see Idle Zeroing).  A free chunk's alloc type is
+ * otherwise meaningless, and no in-use chunk has this type. */
+#define HEAP_CHUNK_TYPE_ZEROED		(BVM_CHUNK_TYPE_MASK >> BVM_CHUNK_TYPE_SHIFT)
+
+/** Is the given free chunk known to be zero? */
+#define HEAP_IsZeroedChunk(c)		(BVM_CHUNK_GetType(c) == HEAP_CHUNK_TYPE_ZEROED)
+
+/** The free chunk being zeroed by #bvm_heap_zero_step, or \c NULL if there is none part done */
+static BVM_VM_LOCAL bvm_chunk_t *heap_zero_chunk = NULL;
+
+/** The first byte of #heap_zero_chunk not yet zeroed */
+static BVM_VM_LOCAL bvm_uint8_t *heap_zero_position = NULL;
+
+/** Was the chunk of the last #bvm_heap_alloc known to be zero? */
+static BVM_VM_LOCAL bvm_bool_t heap_alloc_zeroed = BVM_FALSE;
+
+#endif
+
+/** Number of exact-size small bins.  Small bin \c i holds free chunks of exactly \c i * #BVM_CHUNK_ALIGN_SIZE
+ * bytes.  The bins below #BVM_CHUNK_MIN_SIZE are never used, but keeping them means a bin index is a simple divide. */
+#define HEAP_SMALL_BIN_COUNT	(BVM_HEAP_SMALL_CHUNK_LIMIT / BVM_CHUNK_ALIGN_SIZE)
+
+/** Number of 32 bit words in the small bin bitmap */
+#define HEAP_SMALL_MAP_WORDS	((HEAP_SMALL_BIN_COUNT + 31) / 32)
+
+/** Number of size-ordered large bins.  Large bin \c i holds free chunks from (#BVM_HEAP_SMALL_CHUNK_LIMIT << i) up to
+ * (but not including) (#BVM_HEAP_SMALL_CHUNK_LIMIT << (i+1)) bytes.  The last bin holds everything bigger. */
+#define HEAP_LARGE_BIN_COUNT	32
+
+/** Marker chunks that head the circular list of each small bin.  Each marker has a size of zero. */
+static BVM_VM_LOCAL bvm_chunk_t small_bins[HEAP_SMALL_BIN_COUNT];
+
+/** Marker chunks that head the circular, size-ordered list of each large bin.  Each marker has a size of zero. */
+static BVM_VM_LOCAL bvm_chunk_t large_bins[HEAP_LARGE_BIN_COUNT];
+
+/** Bitmap of small bins - a bit is set if the corresponding bin is non-empty. */
+static BVM_VM_LOCAL bvm_uint32_t small_bin_map[HEAP_SMALL_MAP_WORDS];
+
+/** Bitmap of large bins - a bit is set if the corresponding bin is non-empty. */
+static BVM_VM_LOCAL bvm_uint32_t large_bin_map;
+
+/**
+ * Determine which large bin a chunk of the given size belongs in.
+ *
+ * @param size - a chunk size that is at least #BVM_HEAP_SMALL_CHUNK_LIMIT.
+ * @return the index of the large bin.
+ */
+static int heap_large_bin_index(bvm_uint32_t size) {
+
+	int index = 0;
 
-/** Internal 'known' #bvm_chunk_t to mark the start of the free list.  Has a size of zero, points backwards
- * to \c NULL, and forwards to the free list.  If the list is empty, this chunk will point forward to the
- * #free_list_end marker chunk. */
-static bvm_chunk_t free_list_start;
+	size /= BVM_HEAP_SMALL_CHUNK_LIMIT;
+
+	while ( (size > 1) && (index < HEAP_LARGE_BIN_COUNT-1) ) {
+		size >>= 1;
+		index++;
+	}
 
-/** Internal 'known' #bvm_chunk_t to mark the end of the free list. Has a size equal to the total size of the heap.
- * Points forward to \c NULL and backwards to the last chunk in the free list.  In an empty list this will
- * point backwards to the #free_list_start marker chunk. */
-static bvm_chunk_t free_list_end;
+	return index;
+}
+
+/**
+ * Determine the position of the lowest set bit in a non-zero bin bitmap word.
+ *
+ * @param bits - a non-zero bitmap word
+ * @return the bit position of the lowest set bit.
+ */
+static int heap_lowest_bit(bvm_uint32_t bits) {
+
+	int index = 0;
+
+	while ( (bits & 1) == 0) {
+		bits >>= 1;
+		index++;
+	}
+
+	return index;
+}
+
+/**
+ * Insert a free chunk into the bin appropriate for its size.  Small chunks are pushed onto the front of their
+ * exact-size bin.  Large chunks are inserted into their bin in size order.
+ *
+ * @param chunk - the free chunk to insert.
+ * @param size - the size of the chunk.
+ */
+static void heap_link_free_chunk(bvm_chunk_t *chunk, bvm_uint32_t size) {
+
+	bvm_chunk_t *iter;
+
+	if (size < BVM_HEAP_SMALL_CHUNK_LIMIT) {
+
+		int index = size / BVM_CHUNK_ALIGN_SIZE;
+
+#if BVM_HEAP_TINY_CHUNKS_ENABLE
+		/* too small for the links and the back-pointer - it stays out of the lists until a neighbour coalesces it */
+		if (size < BVM_CHUNK_MIN_SIZE) return;
+#endif
+
+		/* all chunks in a small bin are the same size - just put it at the front */
+		iter = &small_bins[index];
+		small_bin_map[index >> 5] |= ((bvm_uint32_t) 1 << (index & 31));
+	} else {
+
+		int index = heap_large_bin_index(size);
+		bvm_chunk_t *bin = &large_bins[index];
+
+		/* From start of the bin, loop to find a chunk whose *next* chunk is larger than or equal to
+		 * the being-freed chunk size - we are looking for a place to insert it ...*/
+		for (iter = bin; (iter->next_free_chunk != bin) && (BVM_CHUNK_GetSize(iter->next_free_chunk) < size);
+				iter = iter->next_free_chunk) {}
+
+		large_bin_map |= ((bvm_uint32_t) 1 << index);
+	}
+
+	/* Update the bin list by updating next/prev chunk pointers and inserting the chunk. */
+	chunk->prev_free_chunk = iter;
+	chunk->next_free_chunk = iter->next_free_chunk;
+
+	iter->next_free_chunk->prev_free_chunk = chunk;
+	iter->next_free_chunk = chunk;
+
+	bvm_gl_heap_free_chunks++;
+}
+
+/**
+ * Remove a free chunk from whatever bin it is in.  If that leaves the bin empty its bit in the bin bitmap is
+ * cleared.  The chunk header must still hold the chunk's size.
+ *
+ * @param chunk - the free chunk to unlink.
+ */
+static void heap_unlink_free_chunk(bvm_chunk_t *chunk) {
+
+	bvm_chunk_t *prev_chunk;
+	bvm_chunk_t *next_chunk;
+
+#if BVM_HEAP_TINY_CHUNKS_ENABLE
+	/* a tiny free chunk is never in a list */
+	if (BVM_CHUNK_GetSize(chunk) < BVM_CHUNK_MIN_SIZE) return;
+#endif
+
+	prev_chunk = chunk->prev_free_chunk;
+	next_chunk = chunk->next_free_chunk;
+
+#if BVM_HEAP_IDLE_ZERO_ENABLE
+	/* a chunk part zeroed is about to be used or coalesced - what was zeroed of it is not known to be zero any more */
+	if (chunk == heap_zero_chunk) heap_zero_chunk = NULL;
+#endif
+
+	prev_chunk->next_free_chunk = next_chunk;
+	next_chunk->prev_free_chunk = prev_chunk;
+
+	bvm_gl_heap_free_chunks--;
+
+	/* the lists are circular, so if both neighbours are the same chunk it can only be the bin marker - the
+	 * bin is now empty. */
+	if (prev_chunk == next_chunk) {
+
+		bvm_uint32_t size = BVM_CHUNK_GetSize(chunk);
+
+		if (size < BVM_HEAP_SMALL_CHUNK_LIMIT) {
+			int index = size / BVM_CHUNK_ALIGN_SIZE;
+			small_bin_map[index >> 5] &= ~((bvm_uint32_t) 1 << (index & 31));
+		} else {
+			large_bin_map &= ~((bvm_uint32_t) 1 << heap_large_bin_index(size));
+		}
+	}
+}
+
+/**
+ * Find the heap region that contains the given address.
+ *
+ * @param ptr - the address to look for.
+ * @return the region holding the address, or \c NULL if the address is not within any region.
+ */
+static bvm_heap_region_t *heap_region_for(bvm_uint8_t *ptr) {
+
+	bvm_heap_region_t *region;
+
+	for (region = bvm_gl_heap_regions; region != NULL; region = region->next) {
+		if ( (ptr >= region->start) && (ptr < region->end) ) return region;
+	}
+
+	return NULL;
+}
+
+/**
+ * To determine if a pointer points within one of the heap regions.  See #BVM_HEAP_IsHeapAddress.
+ *
+ * @param ptr - the pointer to check
+ * @return bvm_bool_t - #BVM_TRUE if the pointer is within a heap region, or #BVM_FALSE otherwise
+ */
+bvm_bool_t bvm_heap_is_region_address(void *ptr) {
+	return (heap_region_for( (bvm_uint8_t *) ptr) != NULL);
+}
 
 /**
  * For GC, To determine if a pointer to a chunk really points to a chunk.  A number of tests are
@@ -213,14 +675,17 @@ static bvm_chunk_t free_list_end;
  */
 bvm_bool_t bvm_heap_is_chunk_valid(bvm_chunk_t *chunk) {
 
+	bvm_heap_region_t *region;
 	bvm_uint32_t size;
 	int type;
 
 	if (chunk == NULL)
 		return BVM_FALSE; /* cannot be NULL */
 
-	if  ( (chunk > (bvm_chunk_t *) (bvm_gl_heap_end - BVM_CHUNK_MIN_SIZE)) ||  /* address cannot be greater than end of heap */
-          (chunk < (bvm_chunk_t *) bvm_gl_heap_start) )					   /* address cannot be less than the start of heap */
+	region = heap_region_for( (bvm_uint8_t *) chunk);
+
+	if  ( (region == NULL) ||														/* address must be within a heap region */
+		  (chunk > (bvm_chunk_t *) (region->end - BVM_CHUNK_MIN_ALLOC_SIZE)) )			/* address cannot be greater than end of region */
 		return BVM_FALSE;
 
 	type = BVM_CHUNK_GetType(chunk);
@@ -231,15 +696,15 @@ bvm_bool_t bvm_heap_is_chunk_valid(bvm_chunk_t *chunk) {
 
 	size = BVM_CHUNK_GetSize(chunk);
 
-	if ( (size < BVM_CHUNK_MIN_SIZE) ||				/* size must be greater than the minimum size */
+	if ( (size < BVM_CHUNK_MIN_ALLOC_SIZE) ||		/* size must be greater than the minimum size */
 	     (size > bvm_gl_heap_size)  ||				/* size cannot exceed the heap size */
 	     (size != ( (size + BVM_CHUNK_ALIGN_MASK) & ~BVM_CHUNK_ALIGN_MASK) ) ) /* must be validly aligned using same algorithm as alloc */
 		return BVM_FALSE;
 
-	if (BVM_CHUNK_GetNextChunk(chunk) > (bvm_chunk_t *) bvm_gl_heap_end)
-		return BVM_FALSE; /* chunk end cannot go past end of heap */
+	if (BVM_CHUNK_GetNextChunk(chunk) > (bvm_chunk_t *) region->end)
+		return BVM_FALSE; /* chunk end cannot go past end of its region */
 
-	if (BVM_CHUNK_GetColour(chunk) > BVM_GC_COLOUR_BLACK)
+	if (BVM_CHUNK_GetColour(chunk) > BVM_GC_COLOUR_REMEMBERED)
 		return BVM_FALSE;
 
 	return BVM_TRUE;
@@ -261,12 +726,19 @@ bvm_bool_t bvm_heap_is_chunk_valid(bvm_chunk_t *chunk) {
  */
 bvm_chunk_t *bvm_heap_free_chunk(bvm_chunk_t *chunk) {
 
-	bvm_chunk_t *iter;
 	bvm_chunk_t *nextchunk;
 	bvm_chunk_t *startchunkptr;
 	/* the size of the chunk being added to the free list */
 	bvm_uint32_t size = BVM_CHUNK_GetSize(chunk);
 
+	/* a sampled object's site is forgotten with it */
+	BVM_PROFILER_ALLOCATION_FREED(BVM_CHUNK_GetUserData(chunk))
+
+#if (BVM_OBJECT_IDENTITY_HASH_ENABLE && BVM_GC_COMPACTION_ENABLE)
+	/* and the identity hash of an array */
+	BVM_OBJECT_HASH_FREED(BVM_CHUNK_GetUserData(chunk))
+#endif
+
 #if BVM_DEBUG_HEAP_ZERO_ON_FREE
 	void *ptr = BVM_CHUNK_GetUserData(chunk);
 	if (!bvm_heap_is_chunk_valid(chunk)) {
@@ -278,12 +750,12 @@ bvm_chunk_t *bvm_heap_free_chunk(bvm_chunk_t *chunk) {
 	/* we're increasing free space, so we'll note it in a totaller */
 	bvm_gl_heap_free += size;
 
-	/* flag it as being free  */
-	chunk->header &= ~BVM_CHUNK_INUSE_MASK;
+	/* flag it as being free - a free chunk has no lock word */
+	chunk->header &= ~(BVM_CHUNK_INUSE_MASK | BVM_CHUNK_LOCKWORD_MASK);
 
 	/* Test if the previous adjacent chunk in the heap (not the free list) is free, if so we'll coalesce with it.
-	 * We'll unlink that free chunk from the free list */
-	if (BVM_CHUNK_IsPrevChunkFree(chunk) && (chunk != (bvm_chunk_t *) bvm_gl_heap_start) ) {
+	 * We'll unlink that free chunk from the free list.  The first chunk in a region never has its P bit set. */
+	if (BVM_CHUNK_IsPrevChunkFree(chunk) && !HEAP_IsSweepPosition(chunk)) {
 
 		/* the last bytes of a free chunk hold the address of the start of that same free chunk.  We'll
 		 * get that address and point 'chunk' to it - this moves the start of our being-freed chunk to
@@ -293,76 +765,744 @@ bvm_chunk_t *bvm_heap_free_chunk(bvm_chunk_t *chunk) {
 		chunk = *(bvm_chunk_t **) chunk;
 
 		/* unlink the unused previous chunk from the free list */
-		chunk->prev_free_chunk->next_free_chunk = chunk->next_free_chunk;
-		chunk->next_free_chunk->prev_free_chunk = chunk->prev_free_chunk;
+		heap_unlink_free_chunk(chunk);
 
 		/* keep track of the total size of the new bigger (coalesced) chunk */
 		size += BVM_CHUNK_GetSize(chunk);
 
-		/* put the size into the header - this overwrites any previous contents (meaning ...  the header will only have
-		 * the size in it after this operation */
-		chunk->header = (size << BVM_CHUNK_SIZE_SHIFT);
+		/* put the size into the header - this overwrites any previous contents (meaning ...  the header will only have
+		 * the size in it after this operation */
+		chunk->header = BVM_CHUNK_SizeHeader(size);
+	}
+
+	/* 'chunk' will now point to the start of the chunk to free up. This could be
+	 * the chunk as passed in as a parameter, or could be the previous chunk if we coalesced with it (above). */
+
+	/* Now test the next chunk to see if it is also unused.  If it is, unlink it from the free
+	 * list and increase the size of our chunk-to-free to encompass it.  There is always a next chunk - the last chunk
+	 * of a region is its in-use fence chunk. */
+
+	nextchunk = BVM_CHUNK_GetNextChunk(chunk);
+
+	if (!HEAP_IsSweepPosition(nextchunk) && !BVM_CHUNK_IsInuse(nextchunk)) {
+
+		/* unlink the unused next chunk from the free list */
+		heap_unlink_free_chunk(nextchunk);
+
+		/* keep track of the total size of our new bigger coalesced chunk */
+		size += BVM_CHUNK_GetSize(nextchunk);
+
+		/* put the size into the header - this overwrites any previous contents (meaning ... the header will only have
+		 * the size in it after this operation */
+		chunk->header = BVM_CHUNK_SizeHeader(size);
+	}
+
+	/* At this point we will have coalesced the prev and next chunks in the heap if they were
+	 * free.  We have removed those chunks from the free list.  We are at a point where we
+	 * can now insert the new (maybe larger) chunk into the bin for its size */
+	heap_link_free_chunk(chunk, size);
+
+	/* Recalculate the next chunk (in case the next chunk was in fact coalesced with this one) */
+	nextchunk = BVM_CHUNK_GetNextChunk(chunk);
+
+	/* flag the next chunk as having its previous chunk being free (it may be the region fence) */
+#if BVM_GC_CONCURRENT_SWEEP_ENABLE
+	/* ... unless the concurrent sweeper is yet to hand it back - the header is the sweeper's */
+	if (!HEAP_IsSweepPosition(nextchunk))
+#endif
+	nextchunk->header |= BVM_CHUNK_PREV_FREE_MASK;
+
+	/* and finally ... set last bytes of this being-freed chunk to point to the beginning of itself. Yes, this is
+	 * a very difficult couple of lines to understand.  It casts the bytes previous to the next chunk as a
+	 chunk pointer and sets its value - I hate it, but it seems to be the way it is done. */
+	startchunkptr = (bvm_chunk_t *) ( ((bvm_uint8_t *) nextchunk) - sizeof(bvm_chunk_t *));
+	*(bvm_chunk_t **) startchunkptr = chunk;
+
+	/* return the handle to the chunk ... it may have moved to the prev chunk if coalesced */
+	return chunk;
+}
+
+#if (BVM_GC_LAZY_SWEEP_ENABLE || BVM_GC_CONCURRENT_SWEEP_ENABLE)
+
+/**
+ * Determine if the lazy sweeper has yet to reach the given chunk - that is, it is in the region being swept at or after the
+ * sweep position, or in a later region.  A chunk allocated there must be coloured #BVM_GC_COLOUR_BLACK or the sweeper
+ * would take it for garbage.
+ *
+ * @param chunk - the chunk to check
+ * @return #BVM_TRUE if the chunk is yet to be swept, #BVM_FALSE if it has already been swept or there is no sweep
+ * pending.
+ */
+static bvm_bool_t heap_is_unswept(bvm_chunk_t *chunk) {
+
+	bvm_heap_region_t *region = bvm_gl_heap_sweep_region;
+
+	if (region == NULL) return BVM_FALSE;
+
+	if ( (chunk >= bvm_gl_heap_sweep_chunk) && (chunk < (bvm_chunk_t *) region->end) ) return BVM_TRUE;
+
+	for (region = region->next; region != NULL; region = region->next) {
+		if ( (chunk >= (bvm_chunk_t *) region->start) && (chunk < (bvm_chunk_t *) region->end) ) return BVM_TRUE;
+	}
+
+	return BVM_FALSE;
+}
+
+#endif
+
+/**
+ * Recalculate the bounding start and end of the heap over all regions.
+ */
+static void heap_calc_bounds() {
+
+	bvm_heap_region_t *region = bvm_gl_heap_regions;
+
+	bvm_gl_heap_start = region->start;
+	bvm_gl_heap_end = region->end;
+
+	for (region = region->next; region != NULL; region = region->next) {
+		if (region->start < bvm_gl_heap_start) bvm_gl_heap_start = region->start;
+		if (region->end > bvm_gl_heap_end) bvm_gl_heap_end = region->end;
+	}
+}
+
+/**
+ * Request a new region from the platform using #bvm_pd_memory_alloc and link it onto the end of the region list.  The
+ * region's usable memory is followed by an in-use fence chunk.  Its usable memory is counted in the heap size, but the
+ * caller must give it a chunk header.
+ *
+ * @param size - the aligned size of usable memory in the new region.
+ * @return the new region, or \c NULL if the platform could not provide the memory.
+ */
+static bvm_heap_region_t *heap_new_region(bvm_uint32_t size) {
+
+	bvm_heap_region_t *region;
+	bvm_heap_region_t **link;
+	bvm_chunk_t *chunk;
+
+	region = HEAP_REGION_ALLOC(HEAP_REGION_OVERHEAD + size + HEAP_FENCE_SIZE);
+
+	if (region == NULL) return NULL;
+
+	region->next = NULL;
+	region->start = ((bvm_uint8_t *) region) + HEAP_REGION_OVERHEAD;
+	region->end = region->start + size;
+#if BVM_HEAP_LARGE_OBJECT_ENABLE
+	region->is_large = BVM_FALSE;
+#endif
+
+	/* the fence is in-use, static, and never freed */
+	chunk = (bvm_chunk_t *) region->end;
+	chunk->header = BVM_CHUNK_SizeHeader(HEAP_FENCE_SIZE) | (BVM_ALLOC_TYPE_STATIC << BVM_CHUNK_TYPE_SHIFT) | BVM_CHUNK_INUSE_MASK;
+
+	for (link = &bvm_gl_heap_regions; *link != NULL; link = &(*link)->next) {}
+	*link = region;
+
+	heap_calc_bounds();
+
+	bvm_gl_heap_size += size;
+
+	return region;
+}
+
+/**
+ * Request a new region from the platform and add it to the heap.  The region's usable memory is placed into the free
+ * list as a single free chunk.  See #heap_new_region.
+ *
+ * @param size - the aligned size of usable memory in the new region.
+ * @return the new region, or \c NULL if the platform could not provide the memory.
+ */
+static bvm_heap_region_t *heap_add_region(bvm_uint32_t size) {
+
+	bvm_heap_region_t *region = heap_new_region(size);
+	bvm_chunk_t *chunk;
+
+	if (region == NULL) return NULL;
+
+	/* the region memory is one big chunk ... freeing it puts it in the free list (and accounts for it
+	 * in the free totaller) */
+	chunk = (bvm_chunk_t *) region->start;
+	chunk->header = BVM_CHUNK_SizeHeader(size);
+	bvm_heap_free_chunk(chunk);
+
+	return region;
+}
+
+#if BVM_HEAP_LARGE_OBJECT_ENABLE
+
+/**
+ * Get an in-use chunk of the given size in a large object region of its own.  The region is a whole number of
+ * #BVM_HEAP_LARGE_OBJECT_PAGE_SIZE pages (the chunk gets any slack) and the heap may not grow past #bvm_gl_heap_limit
+ * to make it.  The chunk never goes into the free list - when it is swept the whole region is given back to the
+ * platform by #bvm_heap_release_large_region.
+ *
+ * @param size - the exact size of the chunk required.
+ * @return a bvm_chunk_t* or \c NULL if the heap may not grow enough or the platform could not provide the memory.
+ */
+static bvm_chunk_t *heap_large_get_chunk(bvm_uint32_t size) {
+
+	bvm_heap_region_t *region;
+	bvm_chunk_t *chunk;
+	bvm_uint32_t total = HEAP_REGION_OVERHEAD + size + HEAP_FENCE_SIZE;
+
+	/* round the whole block up to pages */
+	total = (total + BVM_HEAP_LARGE_OBJECT_PAGE_SIZE - 1) & ~(BVM_HEAP_LARGE_OBJECT_PAGE_SIZE - 1);
+	size = total - HEAP_REGION_OVERHEAD - HEAP_FENCE_SIZE;
+
+	if ( (bvm_gl_heap_limit <= bvm_gl_heap_size) || (size > (bvm_gl_heap_limit - bvm_gl_heap_size)) ) return NULL;
+
+	region = heap_new_region(size);
+
+	if (region == NULL) return NULL;
+
+	region->is_large = BVM_TRUE;
+
+	chunk = (bvm_chunk_t *) region->start;
+	chunk->header = BVM_CHUNK_SizeHeader(size) | BVM_CHUNK_INUSE_MASK;
+
+#if BVM_GC_LAZY_SWEEP_ENABLE
+	/* the region is last in the list - so if a sweep is pending it is yet to be swept */
+	BVM_CHUNK_SetColour(chunk, heap_is_unswept(chunk) ? BVM_GC_COLOUR_BLACK : BVM_GC_COLOUR_WHITE);
+#endif
+
+	bvm_gl_heap_allocated += size;
+
+	return chunk;
+}
+
+/**
+ * Give a large object region (and the object in it) back to the platform.  Called by the GC when the object in the
+ * region is swept, and by #bvm_heap_free when the object is freed explicitly.
+ *
+ * @param region - a large object region.
+ */
+void bvm_heap_release_large_region(bvm_heap_region_t *region) {
+
+	bvm_heap_region_t **link;
+
+	/* a sampled object's site is forgotten with it */
+	BVM_PROFILER_ALLOCATION_FREED(BVM_CHUNK_GetUserData( (bvm_chunk_t *) region->start))
+
+#if (BVM_OBJECT_IDENTITY_HASH_ENABLE && BVM_GC_COMPACTION_ENABLE)
+	BVM_OBJECT_HASH_FREED(BVM_CHUNK_GetUserData( (bvm_chunk_t *) region->start))
+#endif
+
+#if BVM_GC_LAZY_SWEEP_ENABLE
+	/* an explicit free may give back the region the lazy sweeper is yet to reach - move the sweep position on to
+	 * the next region rather than leave it pointing into freed memory.  The concurrent sweeper never works on a
+	 * large object region, they are swept before it starts. */
+	if (bvm_gl_heap_sweep_region == region) {
+		bvm_gl_heap_sweep_region = region->next;
+		bvm_gl_heap_sweep_chunk = (region->next != NULL) ? (bvm_chunk_t *) region->next->start : NULL;
+	}
+#endif
+
+	for (link = &bvm_gl_heap_regions; *link != region; link = &(*link)->next) {}
+	*link = region->next;
+
+	bvm_gl_heap_size -= (bvm_uint32_t) (region->end - region->start);
+
+	heap_calc_bounds();
+
+	HEAP_REGION_FREE(region);
+}
+
+#endif
+
+#if BVM_HEAP_METADATA_ARENA_ENABLE
+
+/**
+ * Find the region of an arena that holds the given address.  The current region is looked at first - most frees are of
+ * recent allocations.
+ *
+ * @param arena - the arena to look in.
+ * @param ptr - the address to look for.
+ * @return the region holding the address, or \c NULL if it is not in the arena.
+ */
+static heap_metadata_region_t *heap_metadata_arena_region_for(bvm_heap_metadata_arena_t *arena, bvm_uint8_t *ptr) {
+
+	heap_metadata_region_t *region;
+
+	for (region = arena->regions; region != NULL; region = region->next) {
+		if ( (ptr >= region->start) && (ptr < region->end) ) break;
+	}
+
+	return region;
+}
+
+/**
+ * Find the metadata arena region that holds the given address - in the default arena, or failing that, a class
+ * loader arena.
+ *
+ * @param ptr - the address to look for.
+ * @return the region holding the address.
+ */
+static heap_metadata_region_t *heap_metadata_region_for(bvm_uint8_t *ptr) {
+
+	heap_metadata_region_t *region = heap_metadata_arena_region_for(&heap_metadata_default, ptr);
+	bvm_heap_metadata_arena_t *arena;
+
+	for (arena = heap_metadata_loader_arenas; (region == NULL) && (arena != NULL); arena = arena->next)
+		region = heap_metadata_arena_region_for(arena, ptr);
+
+	return region;
+}
+
+/**
+ * Return the free list of an arena that a chunk of the given size belongs in.
+ *
+ * @param arena - the arena.
+ * @param size - an aligned chunk size.
+ * @return the head of the free list.
+ */
+static bvm_chunk_t **heap_metadata_free_list(bvm_heap_metadata_arena_t *arena, bvm_uint32_t size) {
+	return (size < HEAP_METADATA_SMALL_LIMIT) ? &arena->small_free[size / BVM_CHUNK_ALIGN_SIZE] : &arena->large_free;
+}
+
+/**
+ * Put a free arena chunk onto its free list.
+ *
+ * @param arena - the arena of the chunk.
+ * @param chunk - the chunk, with its size in its header.
+ */
+static void heap_metadata_link_free(bvm_heap_metadata_arena_t *arena, bvm_chunk_t *chunk) {
+
+	bvm_chunk_t **list = heap_metadata_free_list(arena, BVM_CHUNK_GetSize(chunk));
+
+	HEAP_METADATA_NextFree(chunk) = *list;
+	*list = chunk;
+}
+
+/**
+ * Take the free chunks of the given region out of one free list.
+ *
+ * @param link - the head of the free list.
+ * @param region - an arena region with no chunks in use.
+ */
+static void heap_metadata_unlink_region_list(bvm_chunk_t **link, heap_metadata_region_t *region) {
+
+	while (*link != NULL) {
+		if ( (BVM_CHUNK_AsBytePtr(*link) >= region->start) && (BVM_CHUNK_AsBytePtr(*link) < region->end) )
+			*link = HEAP_METADATA_NextFree(*link);
+		else
+			link = &HEAP_METADATA_NextFree(*link);
+	}
+}
+
+/**
+ * Take every free chunk of the given region out of the free lists of its arena.  Called as a region is emptied.
+ *
+ * @param region - an arena region with no chunks in use.
+ */
+static void heap_metadata_unlink_region(heap_metadata_region_t *region) {
+
+	int lc;
+
+	for (lc = HEAP_METADATA_SMALL_LIMIT / BVM_CHUNK_ALIGN_SIZE; lc--;)
+		heap_metadata_unlink_region_list(&region->arena->small_free[lc], region);
+
+	heap_metadata_unlink_region_list(&region->arena->large_free, region);
+}
+
+/**
+ * Give the memory of an arena region back to the platform.
+ *
+ * @param region - the region, which is no longer in its arena's list of regions.
+ */
+static void heap_metadata_free_region(heap_metadata_region_t *region) {
+
+	bvm_gl_heap_metadata_size -= (bvm_uint32_t) (region->end - region->start);
+	bvm_gl_heap_metadata_used -= region->used;
+
+	HEAP_REGION_FREE_SIZED(region, HEAP_METADATA_REGION_OVERHEAD + (region->end - region->start));
+}
+
+/**
+ * Add a region of at least the given size to an arena and make it the arena's current region.  What is left at the
+ * top of the old current region goes into the free lists.  The regions of class loader arenas are smaller (see
+ * #BVM_HEAP_METADATA_LOADER_REGION_SIZE) - many loaders only ever have a few clazzes.
+ *
+ * @param arena - the arena.
+ * @param size - the aligned chunk size the region must hold.
+ * @return #BVM_TRUE if the region was added, #BVM_FALSE if the platform could not provide the memory.
+ */
+static bvm_bool_t heap_metadata_add_region(bvm_heap_metadata_arena_t *arena, bvm_uint32_t size) {
+
+	heap_metadata_region_t *region;
+	heap_metadata_region_t *current = arena->regions;
+	bvm_uint32_t min_size = (arena == &heap_metadata_default) ? BVM_HEAP_METADATA_REGION_SIZE : BVM_HEAP_METADATA_LOADER_REGION_SIZE;
+
+	if (size < min_size) size = min_size;
+
+	region = HEAP_REGION_ALLOC(HEAP_METADATA_REGION_OVERHEAD + size);
+
+	if (region == NULL) return BVM_FALSE;
+
+	if ( (current != NULL) && ((bvm_uint32_t) (current->end - current->top) >= HEAP_METADATA_MIN_SIZE) ) {
+		bvm_chunk_t *rest = (bvm_chunk_t *) current->top;
+		rest->header = BVM_CHUNK_SizeHeader(current->end - current->top) | (BVM_ALLOC_TYPE_METADATA << BVM_CHUNK_TYPE_SHIFT);
+		current->top = current->end;
+		heap_metadata_link_free(arena, rest);
+	}
+
+	region->start = region->top = ((bvm_uint8_t *) region) + HEAP_METADATA_REGION_OVERHEAD;
+	region->end = region->start + size;
+	region->used = 0;
+	region->arena = arena;
+	region->next = current;
+	arena->regions = region;
+
+	bvm_gl_heap_metadata_size += size;
+
+	return BVM_TRUE;
+}
+
+/**
+ * Split what a free arena chunk does not need off its end - if it is worth keeping - and free it.
+ *
+ * @param arena - the arena of the chunk.
+ * @param chunk - a chunk just taken from a free list.
+ * @param size - the aligned chunk size it must keep.
+ */
+static void heap_metadata_trim(bvm_heap_metadata_arena_t *arena, bvm_chunk_t *chunk, bvm_uint32_t size) {
+
+	bvm_uint32_t chunk_size = BVM_CHUNK_GetSize(chunk);
+
+	if (chunk_size - size >= HEAP_METADATA_MIN_SIZE) {
+		bvm_chunk_t *rest = (bvm_chunk_t *) (BVM_CHUNK_AsBytePtr(chunk) + size);
+		rest->header = BVM_CHUNK_SizeHeader(chunk_size - size) | (BVM_ALLOC_TYPE_METADATA << BVM_CHUNK_TYPE_SHIFT);
+		heap_metadata_link_free(arena, rest);
+		chunk->header = BVM_CHUNK_SizeHeader(size);
+	}
+}
+
+/**
+ * Get a free chunk of the given size from the free lists of an arena - for a small chunk the first of its own size or
+ * the next larger size that is free, otherwise the first large chunk that is big enough.  Any worthwhile remainder is
+ * split off and freed.
+ *
+ * @param arena - the arena.
+ * @param size - the aligned chunk size.
+ * @return a chunk of the size (or a little larger), or \c NULL if none is free.
+ */
+static bvm_chunk_t *heap_metadata_take_free(bvm_heap_metadata_arena_t *arena, bvm_uint32_t size) {
+
+	bvm_chunk_t **link;
+	bvm_chunk_t *chunk;
+	bvm_uint32_t index;
+
+	for (index = size / BVM_CHUNK_ALIGN_SIZE; index < HEAP_METADATA_SMALL_LIMIT / BVM_CHUNK_ALIGN_SIZE; index++) {
+
+		if ( (chunk = arena->small_free[index]) != NULL) {
+			arena->small_free[index] = HEAP_METADATA_NextFree(chunk);
+			heap_metadata_trim(arena, chunk, size);
+			return chunk;
+		}
+	}
+
+	for (link = &arena->large_free; (chunk = *link) != NULL; link = &HEAP_METADATA_NextFree(chunk)) {
+
+		if (BVM_CHUNK_GetSize(chunk) < size) continue;
+
+		*link = HEAP_METADATA_NextFree(chunk);
+		heap_metadata_trim(arena, chunk, size);
+		return chunk;
+	}
+
+	return NULL;
+}
+
+/**
+ * Bump a chunk of the given size off the top of the current region of an arena - adding a new region if the current
+ * one does not have room.
+ *
+ * @param arena - the arena.
+ * @param size - the aligned chunk size.
+ * @return the chunk, or \c NULL if the platform could not provide a new region.
+ */
+static bvm_chunk_t *heap_metadata_bump(bvm_heap_metadata_arena_t *arena, bvm_uint32_t size) {
+
+	heap_metadata_region_t *region = arena->regions;
+	bvm_chunk_t *chunk;
+
+	if ( (region == NULL) || ((bvm_uint32_t) (region->end - region->top) < size) ) {
+
+		if (!heap_metadata_add_region(arena, size)) return NULL;
+
+		region = arena->regions;
+	}
+
+	chunk = (bvm_chunk_t *) region->top;
+	chunk->header = BVM_CHUNK_SizeHeader(size);
+	region->top += size;
+
+	return chunk;
+}
+
+/**
+ * Allocate memory from a metadata arena.  Called by #bvm_heap_alloc for #BVM_ALLOC_TYPE_METADATA.  The memory comes
+ * from the arena given by #bvm_gl_heap_metadata_arena (see #BVM_ALLOC_TYPE_CLAZZ_METADATA) - or the default arena.
+ *
+ * If the platform cannot provide a new region, a GC is done (it may unload clazzes, and free their metadata) before
+ * trying again.  The arena of a clazz is not released by the GC - the clazz is being loaded or is in use.  Failing
+ * that an out of memory error is thrown.
+ *
+ * @param size - the size in bytes of the memory to allocate.
+ * @return a pointer to the (not zeroed) memory.
+ */
+static void *heap_metadata_alloc(size_t size) {
+
+	bvm_heap_metadata_arena_t *arena = (bvm_gl_heap_metadata_arena != NULL) ? bvm_gl_heap_metadata_arena : &heap_metadata_default;
+	bvm_uint32_t real_size = BVM_CHUNK_AlignedSize( (bvm_uint32_t) size);
+	bvm_chunk_t *chunk;
+
+	/* the arena is for this allocation only */
+	bvm_gl_heap_metadata_arena = NULL;
+
+	if (real_size < HEAP_METADATA_MIN_SIZE) real_size = HEAP_METADATA_MIN_SIZE;
+
+	chunk = heap_metadata_take_free(arena, real_size);
+
+	if (chunk == NULL) chunk = heap_metadata_bump(arena, real_size);
+
+	if (chunk == NULL) {
+
+		/* do a GC - unloaded clazzes give their metadata back - and try again */
+		bvm_gc();
+
+		chunk = heap_metadata_take_free(arena, real_size);
+
+		if (chunk == NULL) chunk = heap_metadata_bump(arena, real_size);
+	}
+
+	if (chunk == NULL) {
+		if (bvm_gl_vm_is_initialised)
+			BVM_THROW(bvm_gl_out_of_memory_err_obj)
+		else
+			BVM_VM_EXIT(BVM_FATAL_ERR_OUT_OF_MEMORY, NULL);
+	}
+
+	chunk->header |= (BVM_ALLOC_TYPE_METADATA << BVM_CHUNK_TYPE_SHIFT) | BVM_CHUNK_INUSE_MASK;
+
+	real_size = BVM_CHUNK_GetSize(chunk);
+	heap_metadata_arena_region_for(arena, BVM_CHUNK_AsBytePtr(chunk))->used += real_size;
+	bvm_gl_heap_metadata_used += real_size;
+
+	return BVM_CHUNK_GetUserData(chunk);
+}
+
+/**
+ * Give an in-use arena chunk back to its metadata arena.  Called by #bvm_heap_free.
+ *
+ * @param chunk - the in-use arena chunk.
+ */
+static void heap_metadata_free(bvm_chunk_t *chunk) {
+
+	bvm_uint32_t size = BVM_CHUNK_GetSize(chunk);
+	heap_metadata_region_t *region = heap_metadata_region_for(BVM_CHUNK_AsBytePtr(chunk));
+	bvm_heap_metadata_arena_t *arena = region->arena;
+
+	chunk->header &= ~BVM_CHUNK_INUSE_MASK;
+
+	region->used -= size;
+	bvm_gl_heap_metadata_used -= size;
+
+	if (region->used == 0) {
+
+		/* the region is empty - none of its free chunks are wanted any more */
+		heap_metadata_unlink_region(region);
+
+		if (region == arena->regions) {
+			region->top = region->start;
+		} else {
+
+			heap_metadata_region_t **link;
+
+			for (link = &arena->regions; *link != region; link = &(*link)->next) {}
+			*link = region->next;
+
+			heap_metadata_free_region(region);
+		}
+
+	} else if ( (region == arena->regions) && (BVM_CHUNK_AsBytePtr(chunk) + size == region->top) ) {
+		/* the most recent allocation is just taken off the top again */
+		region->top -= size;
+	} else {
+		heap_metadata_link_free(arena, chunk);
+	}
+}
+
+/**
+ * Create a new, empty, class loader metadata arena.  Its regions are added as it is allocated from.  It is released
+ * when its last clazz is - see #bvm_heap_metadata_arena_hold.
+ *
+ * @return the new arena.
+ */
+bvm_heap_metadata_arena_t *bvm_heap_metadata_arena_new() {
+
+	bvm_heap_metadata_arena_t *arena = bvm_heap_calloc(sizeof(bvm_heap_metadata_arena_t), BVM_ALLOC_TYPE_METADATA);
+
+	arena->next = heap_metadata_loader_arenas;
+	heap_metadata_loader_arenas = arena;
+
+	return arena;
+}
+
+/**
+ * Note that a clazz has its metadata in a class loader arena.  The arena is kept until each clazz that holds it
+ * has released it with #bvm_heap_metadata_arena_release.
+ *
+ * @param arena - a class loader arena.
+ */
+void bvm_heap_metadata_arena_hold(bvm_heap_metadata_arena_t *arena) {
+	arena->clazz_count++;
+}
+
+/**
+ * Note that a clazz that holds a class loader arena is being unloaded.  When the last of the clazzes goes the whole
+ * arena - every region of it - is given back to the platform at once, whether or not its chunks have been freed.
+ * The clazzes of a loader are only ever unloaded together, so nothing else uses the arena's memory by then.
+ *
+ * @param arena - a class loader arena.
+ */
+void bvm_heap_metadata_arena_release(bvm_heap_metadata_arena_t *arena) {
+
+	bvm_heap_metadata_arena_t **link;
+
+	if (--arena->clazz_count > 0) return;
+
+	while (arena->regions != NULL) {
+		heap_metadata_region_t *region = arena->regions;
+		arena->regions = region->next;
+		heap_metadata_free_region(region);
+	}
+
+	for (link = &heap_metadata_loader_arenas; *link != arena; link = &(*link)->next) {}
+	*link = arena->next;
+
+	bvm_heap_free(arena);
+}
+
+#endif
+
+/**
+ * Grow the heap by a new region big enough for a chunk of the given size.  The region will be at least
+ * #BVM_HEAP_REGION_SIZE bytes.  The heap will not grow beyond #bvm_gl_heap_limit.
+ *
+ * @param size - the size of the chunk the new region must accommodate.
+ * @return #BVM_TRUE if the heap grew, #BVM_FALSE otherwise.
+ */
+static bvm_bool_t heap_grow(bvm_uint32_t size) {
+
+	bvm_uint32_t room;
+
+	if (bvm_gl_heap_limit <= bvm_gl_heap_size) return BVM_FALSE;
+
+	room = (bvm_gl_heap_limit - bvm_gl_heap_size) & ~BVM_CHUNK_ALIGN_MASK;
+
+	if (size < BVM_HEAP_REGION_SIZE) size = BVM_HEAP_REGION_SIZE;
+	size = (size + BVM_CHUNK_ALIGN_MASK) & ~BVM_CHUNK_ALIGN_MASK;
+
+	/* a smaller region than usual is fine if it is as close to the limit as we can get */
+	if (size > room) size = room;
+
+	if (size < BVM_CHUNK_MIN_SIZE) return BVM_FALSE;
+
+	return (heap_add_region(size) != NULL);
+}
+
+/**
+ * Determine if the heap is below its grow threshold - that is, if less than #bvm_gl_heap_grow_percent of the
+ * given heap size would be free.
+ *
+ * @param free - a free byte count.
+ * @param size - a heap size.
+ *
+ * @return #BVM_TRUE if the free count is below the threshold for the heap size.
+ */
+static bvm_bool_t heap_is_below_threshold(bvm_uint32_t free, bvm_uint32_t size) {
+	return ( (free / bvm_gl_heap_grow_percent) < (size / 100) );
+}
+
+/**
+ * Determine the size of the largest chunk in the free list.  Used by the GC as a measure of fragmentation.
+ *
+ * @return the size in bytes of the largest free chunk, or zero if the free list is empty.
+ */
+bvm_uint32_t bvm_heap_largest_free() {
+
+	int index;
+
+	/* the large bins are in size order, so the largest chunk is the last in the highest non-empty large bin */
+	for (index = HEAP_LARGE_BIN_COUNT; index--;) {
+		if (large_bin_map & ((bvm_uint32_t) 1 << index))
+			return BVM_CHUNK_GetSize(large_bins[index].prev_free_chunk);
 	}
 
-	/* 'chunk' will now point to the start of the chunk to free up. This could be
-	 * the chunk as passed in as a parameter, or could be the previous chunk if we coalesced with it (above). */
+	for (index = HEAP_SMALL_BIN_COUNT; index--;) {
+		if (small_bin_map[index >> 5] & ((bvm_uint32_t) 1 << (index & 31)))
+			return index * BVM_CHUNK_ALIGN_SIZE;
+	}
 
-	/* Now test the next chunk to see if it is also unused.  If it is, unlink it from the free
-	 * list and increase the size of our chunk-to-free to encompass it. */
+	return 0;
+}
 
-	nextchunk = BVM_CHUNK_GetNextChunk(chunk);
+#if BVM_GC_COMPACTION_ENABLE
 
-	if (nextchunk != (bvm_chunk_t *) bvm_gl_heap_end) {
+/**
+ * Take a chunk out of the free list and flag it as in use - without splitting it or colouring it.  Used by the
+ * GC compactor to claim free chunks that live chunks are about to be moved over.
+ *
+ * @param chunk - a free chunk.
+ */
+void bvm_heap_take_free_chunk(bvm_chunk_t *chunk) {
 
-		if (!BVM_CHUNK_IsInuse(nextchunk)) {
+	heap_unlink_free_chunk(chunk);
 
-			/*debug_free_list_count--;*/
+	bvm_gl_heap_free -= BVM_CHUNK_GetSize(chunk);
 
-			/* unlink the unused next chunk from the free list */
-			nextchunk->prev_free_chunk->next_free_chunk = nextchunk->next_free_chunk;
-			nextchunk->next_free_chunk->prev_free_chunk = nextchunk->prev_free_chunk;
+	chunk->header |= BVM_CHUNK_INUSE_MASK;
+}
 
-			/* keep track of the total size of our new bigger coalesced chunk */
-			size += BVM_CHUNK_GetSize(nextchunk);
+#endif
 
-			/* put the size into the header - this overwrites any previous contents (meaning ... the header will only have
-			 * the size in it after this operation */
-			chunk->header = (size << BVM_CHUNK_SIZE_SHIFT);
-		}
+/**
+ * Called after each GC to size the heap to its live data.  Each non-initial region that is now entirely free is
+ * returned to the platform - so long as the heap is left above its grow threshold.  Then, if the heap is below its
+ * grow threshold it is grown by a region (if #bvm_gl_heap_limit allows).
+ */
+void bvm_heap_adjust_regions() {
 
-	}
+	bvm_heap_region_t **link = &bvm_gl_heap_regions->next;
 
-	/* At this point we will have coalesced the prev and next chunks in the heap if they were
-	 * free.  We have removed those chunks from the free list.  We are at a point where we
-	 * can now try to insert the new (maybe larger) chunk into the free list */
+	if (bvm_gl_heap_grow_percent == 0) return;
 
-	/* From start of the free list, loop to find a chunk whose *next* chunk is larger than or equal to
-	 * the being-freed chunk size - we are looking for a place to insert it ...*/
-	for (iter = &free_list_start; BVM_CHUNK_GetSize(iter->next_free_chunk)
-			< size; iter = iter->next_free_chunk) {}
+	while (*link != NULL) {
 
-	/* Update the free list by updating next/prev chunk pointers and inserting the being-freed chunk. */
-	chunk->prev_free_chunk = iter;
-	chunk->next_free_chunk = iter->next_free_chunk;
+		bvm_heap_region_t *region = *link;
+		bvm_chunk_t *chunk = (bvm_chunk_t *) region->start;
+		bvm_uint32_t size = (bvm_uint32_t) (region->end - region->start);
 
-	iter->next_free_chunk->prev_free_chunk = chunk;
-	iter->next_free_chunk = chunk;
+		/* release it if the whole region is one free chunk */
+		if ( !BVM_CHUNK_IsInuse(chunk) && (BVM_CHUNK_GetSize(chunk) == size) &&
+			 !heap_is_below_threshold(bvm_gl_heap_free - size, bvm_gl_heap_size - size) ) {
 
-	/* Recalculate the next chunk (in case the next chunk was in fact coalesced with this one) */
-	nextchunk = BVM_CHUNK_GetNextChunk(chunk);
+			heap_unlink_free_chunk(chunk);
 
-	/* if the next chunk is not past the end of the heap (that is, we are not sitting on the last chunk)
-	 * flag it as having its previous chunk being free */
-	if (nextchunk != (bvm_chunk_t *) bvm_gl_heap_end) nextchunk->header |= BVM_CHUNK_PREV_FREE_MASK;
+			bvm_gl_heap_free -= size;
+			bvm_gl_heap_size -= size;
 
-	/* and finally ... set last bytes of this being-freed chunk to point to the beginning of itself. Yes, this is
-	 * a very difficult couple of lines to understand.  It casts the bytes previous to the next chunk as a
-	 chunk pointer and sets its value - I hate it, but it seems to be the way it is done. */
-	startchunkptr = (bvm_chunk_t *) ( ((bvm_uint8_t *) nextchunk) - sizeof(bvm_chunk_t *));
-	*(bvm_chunk_t **) startchunkptr = chunk;
+			*link = region->next;
+			HEAP_REGION_FREE(region);
+		} else {
+			link = &region->next;
+		}
+	}
 
-	/* return the handle to the chunk ... it may have moved to the prev chunk if coalesced */
-	return chunk;
+	heap_calc_bounds();
+
+	if (heap_is_below_threshold(bvm_gl_heap_free, bvm_gl_heap_size))
+		heap_grow(BVM_HEAP_REGION_SIZE);
 }
 
 /**
@@ -370,9 +1510,10 @@ bvm_chunk_t *bvm_heap_free_chunk(bvm_chunk_t *chunk) {
  * will be rounded to a multiple of the #BVM_CHUNK_ALIGN_SIZE setting and must be between #BVM_HEAP_MIN_SIZE and
  * #BVM_HEAP_MAX_SIZE.
  *
- * The free list is established with the list markers #free_list_start and #free_list_end as delimiters. The
- * new heap space will become the first available chunk on the free list. Yes, the new heap memory is
- * added as a free chunk to the free list.  All subsequence allocations will subdivide this large free list chunk.
+ * Each free list bin is established as an empty circular list headed by its marker chunk. The
+ * new heap space becomes the initial heap region and its memory the first available chunk on the free list.
+ * All subsequence allocations will subdivide this large free list chunk.  The heap may later grow (up to
+ * #bvm_gl_heap_limit) by adding more regions.
  *
  * @param size - the heap size to allocate from the OS for the VM.
  *
@@ -387,55 +1528,128 @@ bvm_chunk_t *bvm_heap_free_chunk(bvm_chunk_t *chunk) {
  */
 void bvm_heap_init(size_t size) {
 
-	bvm_chunk_t *heapchunk;
+	int lc;
 
 	/* align it */
-	bvm_gl_heap_size = (size + BVM_CHUNK_ALIGN_MASK) & ~BVM_CHUNK_ALIGN_MASK;
+	size = (size + BVM_CHUNK_ALIGN_MASK) & ~BVM_CHUNK_ALIGN_MASK;
 
 	/* Less than specified min? Bang out. */
-	if (bvm_gl_heap_size < BVM_HEAP_MIN_SIZE) BVM_VM_EXIT(BVM_FATAL_ERR_HEAP_SIZE_LT_THAN_ALLOWABLE_MIN, NULL);
+	if (size < BVM_HEAP_MIN_SIZE) BVM_VM_EXIT(BVM_FATAL_ERR_HEAP_SIZE_LT_THAN_ALLOWABLE_MIN, NULL);
 
 	/* Greater than specified max? Bang out. */
-	if (bvm_gl_heap_size > BVM_HEAP_MAX_SIZE) BVM_VM_EXIT(BVM_FATAL_ERR_HEAP_SIZE_GT_THAN_ALLOWABLE_MAX, NULL);
+	if (size > BVM_HEAP_MAX_SIZE) BVM_VM_EXIT(BVM_FATAL_ERR_HEAP_SIZE_GT_THAN_ALLOWABLE_MAX, NULL);
+
+	/* the heap limit cannot exceed the max either */
+	if (bvm_gl_heap_limit > BVM_HEAP_MAX_SIZE) bvm_gl_heap_limit = BVM_HEAP_MAX_SIZE;
 
-	/* get the heap memory from the platform OS */
-	bvm_gl_heap_start = (bvm_uint8_t *) bvm_pd_memory_alloc(bvm_gl_heap_size);
+	/* init the size and free space to zero - adding the initial region will account for it */
+	bvm_gl_heap_size = 0;
+	bvm_gl_heap_free = 0;
+	bvm_gl_heap_free_chunks = 0;
+	bvm_gl_heap_allocated = 0;
+
+	/* each bin starts empty - its marker (of size zero) points forwards and backwards to itself */
+	for (lc = HEAP_SMALL_BIN_COUNT; lc--;) {
+		small_bins[lc].header = 0;
+		small_bins[lc].next_free_chunk = &small_bins[lc];
+		small_bins[lc].prev_free_chunk = &small_bins[lc];
+	}
 
-	/* if we can't get any memory do not continue */
-	if (bvm_gl_heap_start == NULL) BVM_VM_EXIT(BVM_FATAL_ERR_CANNOT_ALLOCATE_HEAP, NULL);
+	for (lc = HEAP_LARGE_BIN_COUNT; lc--;) {
+		large_bins[lc].header = 0;
+		large_bins[lc].next_free_chunk = &large_bins[lc];
+		large_bins[lc].prev_free_chunk = &large_bins[lc];
+	}
 
-	/* set a pointer to the byte just past the end of the heap.  We'll use this to make sure that
-	 * last chunk in the heap when allocated/freed does not set the previous used/free marker
-	 * to something past the end of the heap. */
-	bvm_gl_heap_end = bvm_gl_heap_start + bvm_gl_heap_size;
+	memset(small_bin_map, 0, sizeof(small_bin_map));
+	large_bin_map = 0;
 
-	/* init the free space to zero */
-	bvm_gl_heap_free = 0;
+#if BVM_HEAP_IDLE_ZERO_ENABLE
+	heap_zero_chunk = NULL;
+#endif
+
+#if BVM_HEAP_METADATA_ARENA_ENABLE
+	/* the arena starts empty - its first region is added by the first allocation */
+	memset(&heap_metadata_default, 0, sizeof(heap_metadata_default));
+	heap_metadata_loader_arenas = NULL;
+	bvm_gl_heap_metadata_arena = NULL;
+	bvm_gl_heap_metadata_size = 0;
+	bvm_gl_heap_metadata_used = 0;
+#endif
+
+	/* get the initial heap region from the platform OS and place its memory in the free list.  If we can't
+	 * get any memory do not continue */
+	if (heap_add_region( (bvm_uint32_t) size) == NULL) BVM_VM_EXIT(BVM_FATAL_ERR_CANNOT_ALLOCATE_HEAP, NULL);
+}
+
+/**
+ * Find a free chunk in the bins that will accommodate the given size.  The found chunk is not removed from its bin.
+ *
+ * A small request first tries its own exact-size bin, and then the next non-empty small bin of larger chunks.  Failing
+ * that (or for a large request) the large bins are tried - a best fit within the request's own large bin (if any) or the
+ * smallest chunk of the next non-empty large bin.  The bin bitmaps mean empty bins are never visited.
+ *
+ * @param size - the exact size of the memory to search for.
+ * @return a free bvm_chunk_t* or \c NULL if no bin has an accommodating chunk.
+ */
+static bvm_chunk_t *heap_find_chunk(bvm_uint32_t size) {
+
+	bvm_uint32_t bits;
+	int index;
+
+	if (size < BVM_HEAP_SMALL_CHUNK_LIMIT) {
+
+		int word;
+
+		index = size / BVM_CHUNK_ALIGN_SIZE;
+		word = index >> 5;
+
+		/* mask off the bins for sizes smaller than requested */
+		bits = small_bin_map[word] & (~((bvm_uint32_t) 0) << (index & 31));
+
+		while (bits == 0) {
+			if (++word == HEAP_SMALL_MAP_WORDS) break;
+			bits = small_bin_map[word];
+		}
+
+		if (bits != 0)
+			return small_bins[(word << 5) + heap_lowest_bit(bits)].next_free_chunk;
+
+		/* any large chunk will do */
+		bits = large_bin_map;
+
+	} else {
+
+		index = heap_large_bin_index(size);
+
+		/* chunks in the request's own large bin may or may not be big enough - the bin is in size
+		 * order so the first one that fits is the best fit */
+		if (large_bin_map & ((bvm_uint32_t) 1 << index)) {
 
-	/* configure the heap as a large chunk and we'll place it as the first entry on the
-	 * free list */
-	heapchunk = (bvm_chunk_t *) bvm_gl_heap_start;
-	heapchunk->header = (bvm_gl_heap_size << BVM_CHUNK_SIZE_SHIFT);
+			bvm_chunk_t *bin = &large_bins[index];
+			bvm_chunk_t *chunk;
 
-	/* end of free list points to nothing and has its size set to the size of the heap.  We
-	 * can use both these markers when traversing the free list */
-	free_list_end.header = (bvm_gl_heap_size << BVM_CHUNK_SIZE_SHIFT);
-	free_list_end.next_free_chunk = NULL;
-	free_list_end.prev_free_chunk = &free_list_start;
+			for (chunk = bin->next_free_chunk; chunk != bin; chunk = chunk->next_free_chunk) {
+				if (BVM_CHUNK_GetSize(chunk) >= size) return chunk;
+			}
+		}
+
+		/* every chunk in a higher bin is big enough.  Note that shifting 2 by 31 gives 0 and the mask
+		 * is then also 0 - there is no higher bin */
+		bits = large_bin_map & ~(((bvm_uint32_t) 2 << index) - 1);
+	}
 
-	free_list_start.header = 0;
-	free_list_start.next_free_chunk = &free_list_end;
-	free_list_start.prev_free_chunk = NULL;
+	if (bits != 0)
+		return large_bins[heap_lowest_bit(bits)].next_free_chunk;
 
-	/* and now place it in the free list */
-	bvm_heap_free_chunk(heapchunk);
+	return NULL;
 }
 
 /**
  * Find a free memory chunk that will accommodate the given size.  No idiocy checking is performed on the
- * size of the request.  The free list is scanned for the first accommodating chunk size.
+ * size of the request.  The bins are searched using #heap_find_chunk.
  *
- * The found chunk is removed from the free list.  If the found chunk size is >=
+ * The found chunk is removed from its bin.  If the found chunk size is >=
  * to (requested size + #BVM_CHUNK_MIN_SIZE), the excess is trimmed off and inserted back
  * into the free list as a distinct new free chunk.
  *
@@ -445,75 +1659,163 @@ void bvm_heap_init(size_t size) {
  */
 static bvm_chunk_t *heap_get_chunk(size_t size) {
 
-	bvm_chunk_t *chunk, *prev_chunk, *next_chunk;
+	bvm_chunk_t *chunk, *next_chunk;
 	bvm_chunk_t *rv = NULL;
+#if BVM_HEAP_IDLE_ZERO_ENABLE
+	bvm_bool_t zeroed;
+#endif
 
-	/* traverse free list for the first chunk that is equal to or larger than than
-	 * the requested size */
-	prev_chunk = &free_list_start;
-	chunk = free_list_start.next_free_chunk;
-
-	while ( ( BVM_CHUNK_GetSize(chunk) < size ) && (chunk->next_free_chunk != NULL )) {
-		prev_chunk = chunk;
-		chunk = chunk->next_free_chunk;
-	}
+	chunk = heap_find_chunk( (bvm_uint32_t) size);
 
-	/* if we have not reached the end of the list ... it means we found one */
-	if (chunk != &free_list_end) {
+	/* did we find one? */
+	if (chunk != NULL) {
 
 		/* set the return value as the chunk we have found */
 		rv = chunk;
 
-		/* Remove the found chunk from the free list */
-		chunk->next_free_chunk->prev_free_chunk = prev_chunk;
-		prev_chunk->next_free_chunk = chunk->next_free_chunk;
+#if BVM_HEAP_IDLE_ZERO_ENABLE
+		zeroed = HEAP_IsZeroedChunk(chunk);
+#endif
+
+		/* Remove the found chunk from its bin */
+		heap_unlink_free_chunk(chunk);
 
 		/* we've removed a chunk from the free list, so we'll note the memory usage in our
 		 * free-memory totaller */
 		bvm_gl_heap_free -= BVM_CHUNK_GetSize(chunk);
+		bvm_gl_heap_allocated += (bvm_uint32_t) size;
 
 		/* if the chunk is larger than the requested size + BVM_CHUNK_MIN_SIZE, we'll split it in two and
 		 * add the remainder back to the free list*/
 		if (BVM_CHUNK_GetSize(chunk) >= (size + BVM_CHUNK_MIN_SIZE)) {
 
 			bvm_chunk_t *newchunk;
+#if BVM_HEAP_IDLE_ZERO_ENABLE
+			bvm_uint32_t rest;
+#endif
 
 			/* get a pointer to the beginning of the excess bytes and treat it as a 'remainder' chunk */
 			newchunk = (bvm_chunk_t *) (BVM_CHUNK_AsBytePtr(chunk) + size);
 
 			/* set the size of the 'remainder' chunk */
-			newchunk->header = ( (BVM_CHUNK_GetSize(chunk) - size) << BVM_CHUNK_SIZE_SHIFT);
+			newchunk->header = BVM_CHUNK_SizeHeader(BVM_CHUNK_GetSize(chunk) - size);
 
 			/* truncate the size of the requested chunk */
-			chunk->header = (size << BVM_CHUNK_SIZE_SHIFT);
+			chunk->header = BVM_CHUNK_SizeHeader(size);
 
 			/* put the new 'remainder' chunk into the free list */
+#if BVM_HEAP_IDLE_ZERO_ENABLE
+			/* ... the remainder of a zeroed chunk is still zero - if it was not coalesced with anything */
+			rest = BVM_CHUNK_GetSize(newchunk);
+			if ( (bvm_heap_free_chunk(newchunk) == newchunk) && zeroed && (BVM_CHUNK_GetSize(newchunk) == rest) )
+				newchunk->header |= BVM_CHUNK_TYPE_MASK;
+#else
 			bvm_heap_free_chunk(newchunk);
+#endif
+		}
+
+#if BVM_HEAP_IDLE_ZERO_ENABLE
+		/* all but the free list links and the back-pointer of a zeroed chunk is zero - clear those too.  If the chunk
+		 * was split its last word was zero already. */
+		if (zeroed) {
+			memset(BVM_CHUNK_GetUserData(chunk), 0, sizeof(bvm_chunk_t) - BVM_CHUNK_OVERHEAD);
+			*(bvm_chunk_t **) (BVM_CHUNK_AsBytePtr(chunk) + BVM_CHUNK_GetSize(chunk) - sizeof(bvm_chunk_t *)) = NULL;
 		}
 
+		heap_alloc_zeroed = zeroed;
+#endif
+
 		/* set the in-use flag of our found chunk */
 		chunk->header |= BVM_CHUNK_INUSE_MASK;
 
-		/* give it a GC colour of white */
+		/* give it a GC colour of white - or black if the lazy sweeper is yet to reach it, so it is not swept up */
+#if BVM_GC_LAZY_SWEEP_ENABLE
+		BVM_CHUNK_SetColour(chunk, heap_is_unswept(chunk) ? BVM_GC_COLOUR_BLACK : BVM_GC_COLOUR_WHITE);
+#else
 		BVM_CHUNK_SetColour(chunk, BVM_GC_COLOUR_WHITE);
+#endif
 
-		/* if the next chunk is not past the end of the heap (that is, we are not presently on the last heap chunk)
-		 * clear its previous chunk free flag. */
+		/* clear the previous chunk free flag of the next chunk (it may be the region fence) */
 		next_chunk = BVM_CHUNK_GetNextChunk(chunk);
-		if (next_chunk != (bvm_chunk_t *) bvm_gl_heap_end) {
-			next_chunk->header &= ~BVM_CHUNK_PREV_FREE_MASK;
-		}
+#if BVM_GC_CONCURRENT_SWEEP_ENABLE
+		/* ... unless the concurrent sweeper is yet to hand it back - the header is the sweeper's */
+		if (!HEAP_IsSweepPosition(next_chunk))
+#endif
+		next_chunk->header &= ~BVM_CHUNK_PREV_FREE_MASK;
 	}
 
 	return rv;
 }
 
+#if BVM_HEAP_TLAB_ENABLE
+
+/**
+ * Give the unused remainder of the current thread allocation buffer (if any) back to the free list.  Called at each thread
+ * switch and before each GC.
+ */
+void bvm_heap_tlab_retire() {
+
+	if (bvm_gl_heap_tlab_top != NULL) {
+
+		/* the remainder is a valid in-use chunk, so it is just freed as normal */
+		bvm_heap_free_chunk( (bvm_chunk_t *) bvm_gl_heap_tlab_top);
+
+		bvm_gl_heap_tlab_top = NULL;
+		bvm_gl_heap_tlab_end = NULL;
+	}
+}
+
+/**
+ * Get a chunk of the given (aligned, small) size from the current thread allocation buffer.  If there is no buffer,
+ * or not enough room left in it, the buffer is retired and a new one taken from the free list.
+ *
+ * @param size - the exact size of the chunk required.
+ * @return a bvm_chunk_t* or \c NULL if no buffer could be taken from the free list.
+ */
+static bvm_chunk_t *heap_tlab_get_chunk(size_t size) {
+
+	void *ptr;
+	bvm_chunk_t *chunk;
+
+	BVM_HEAP_TLAB_TRY_ALLOC(ptr, size - BVM_CHUNK_OVERHEAD, BVM_ALLOC_TYPE_DATA);
+
+	if (ptr != NULL) return BVM_CHUNK_GetPointerChunk(ptr);
+
+	/* no room - give back what is left and try for a new buffer.  If there is no free chunk big
+	 * enough for a buffer we just do not use one. */
+	bvm_heap_tlab_retire();
+
+	chunk = heap_get_chunk(BVM_HEAP_TLAB_SIZE);
+	if (chunk == NULL) return NULL;
+
+	/* the whole buffer is zeroed up front (unless it already is) and the buffer itself becomes the remainder chunk */
+#if BVM_HEAP_IDLE_ZERO_ENABLE
+	if (!heap_alloc_zeroed)
+#endif
+	memset(BVM_CHUNK_GetUserData(chunk), 0, BVM_CHUNK_GetSize(chunk) - BVM_CHUNK_OVERHEAD);
+	BVM_CHUNK_SetAllocType(chunk, BVM_ALLOC_TYPE_DATA);
+
+	bvm_gl_heap_tlab_top = BVM_CHUNK_AsBytePtr(chunk);
+	bvm_gl_heap_tlab_end = bvm_gl_heap_tlab_top + BVM_CHUNK_GetSize(chunk);
+
+#if BVM_GC_LAZY_SWEEP_ENABLE
+	/* the whole buffer is either swept or unswept - every chunk in it gets the colour the buffer itself was given */
+	bvm_gl_heap_tlab_colour = ((bvm_chunk_header_t) BVM_CHUNK_GetColour(chunk)) << BVM_CHUNK_COLOUR_SHIFT;
+#endif
+
+	BVM_HEAP_TLAB_TRY_ALLOC(ptr, size - BVM_CHUNK_OVERHEAD, BVM_ALLOC_TYPE_DATA);
+
+	return (ptr != NULL) ? BVM_CHUNK_GetPointerChunk(ptr) : NULL;
+}
+
+#endif
+
 /**
  * Request the allocator to provide memory of the given size.
  *
  * The size requested is massaged to be a correct multiple of #BVM_CHUNK_ALIGN_SIZE.
  * Requesting 0 bytes will successfully return a void*.  However, there is overhead and
- * minimum allocation size is defined by #BVM_CHUNK_MIN_SIZE.  Continually requesting zero
+ * minimum allocation size is defined by #BVM_CHUNK_MIN_ALLOC_SIZE.  Continually requesting zero
  * bytes will exhaust memory.
  *
  * Unlike other allocators may do, this one will not return \c NULL if no memory can be allocated.
@@ -530,6 +1832,19 @@ void *bvm_heap_alloc(size_t size, int alloc_type) {
 
 	bvm_chunk_t *chunk = NULL;
 	size_t real_size;
+#if BVM_HEAP_LARGE_OBJECT_ENABLE
+	bvm_bool_t is_large;
+#endif
+
+#if BVM_HEAP_IDLE_ZERO_ENABLE
+	/* until a zeroed chunk is taken */
+	heap_alloc_zeroed = BVM_FALSE;
+#endif
+
+#if BVM_HEAP_METADATA_ARENA_ENABLE
+	/* the VM's own long-lived data is not in the heap at all */
+	if (alloc_type == BVM_ALLOC_TYPE_METADATA) return heap_metadata_alloc(size);
+#endif
 
 	/* if BVM_DEBUG_HEAP_GC_ON_ALLOC is defined we'll do a GC before, erm, each
 	 * allocation.  This will help weed out the circumstances where a temporary
@@ -544,12 +1859,33 @@ void *bvm_heap_alloc(size_t size, int alloc_type) {
 	 * aligning, then ((7+3) & ~3) is 8. But, requesting 8 bytes will give 8. */
 	real_size = (size + BVM_CHUNK_OVERHEAD + BVM_CHUNK_ALIGN_MASK) & ~BVM_CHUNK_ALIGN_MASK;
 
-	/* cannot allocate a chunk smaller than the BVM_CHUNK_MIN_SIZE - so round up */
-	if (real_size < BVM_CHUNK_MIN_SIZE)
-		real_size = BVM_CHUNK_MIN_SIZE;
+	/* cannot allocate a chunk smaller than the BVM_CHUNK_MIN_ALLOC_SIZE - so round up */
+	if (real_size < BVM_CHUNK_MIN_ALLOC_SIZE)
+		real_size = BVM_CHUNK_MIN_ALLOC_SIZE;
+
+#if BVM_HEAP_LARGE_OBJECT_ENABLE
+	/* large primitive arrays get a region of their own - if the heap may grow */
+	is_large = ( (alloc_type == BVM_ALLOC_TYPE_ARRAY_OF_PRIMITIVE) && (real_size >= bvm_gl_heap_large_object_size) );
+
+	if (is_large)
+		chunk = heap_large_get_chunk( (bvm_uint32_t) real_size);
+#endif
+
+#if BVM_HEAP_TLAB_ENABLE
+	/* small allocations come from the thread allocation buffer */
+	if ( (chunk == NULL) && (real_size < BVM_HEAP_SMALL_CHUNK_LIMIT) )
+		chunk = heap_tlab_get_chunk(real_size);
+#endif
 
 	/* find a chunk that will fit the requested size.*/
-	chunk = heap_get_chunk(real_size);
+	if (chunk == NULL)
+		chunk = heap_get_chunk(real_size);
+
+#if (BVM_GC_LAZY_SWEEP_ENABLE || BVM_GC_CONCURRENT_SWEEP_ENABLE)
+	/* sweep some more of the heap until a chunk is found or the sweep of the last GC is done */
+	while ( (chunk == NULL) && bvm_gc_sweep_step() )
+		chunk = heap_get_chunk(real_size);
+#endif
 
 	/* whoops.  Can't find any at all. */
 	if (chunk == NULL) {
@@ -559,6 +1895,33 @@ void *bvm_heap_alloc(size_t size, int alloc_type) {
 
 		/* .. and try again to get the memory */
 		chunk = heap_get_chunk(real_size);
+
+#if (BVM_GC_LAZY_SWEEP_ENABLE || BVM_GC_CONCURRENT_SWEEP_ENABLE)
+		while ( (chunk == NULL) && bvm_gc_sweep_step() )
+			chunk = heap_get_chunk(real_size);
+#endif
+
+#if BVM_GC_GENERATIONAL_ENABLE
+		/* the collection may have only been a minor one - try again with the whole heap */
+		if (chunk == NULL) {
+			bvm_gc_full();
+			chunk = heap_get_chunk(real_size);
+		}
+#endif
+
+#if BVM_HEAP_LARGE_OBJECT_ENABLE
+		/* the GC may have given back large object regions */
+		if ( (chunk == NULL) && is_large )
+			chunk = heap_large_get_chunk( (bvm_uint32_t) real_size);
+#endif
+
+		/* still nothing - try growing the heap by a region big enough for it */
+		if ( (chunk == NULL) && heap_grow( (bvm_uint32_t) real_size) )
+			chunk = heap_get_chunk(real_size);
+
+		/* last of all, clear soft references - least recently used first - until it fits */
+		while ( (chunk == NULL) && bvm_gc_clear_soft_references() )
+			chunk = heap_get_chunk(real_size);
 	}
 
 	/* still can't get it?  Memory must be exhausted (or fragmented in a bad way).
@@ -571,6 +1934,14 @@ void *bvm_heap_alloc(size_t size, int alloc_type) {
 		 * the chance to initialise the standard bootstrap objects.  So, if we run into memory
 		 * trouble before the VM is initialised, we exit the VM in a horrid way */
 		if (bvm_gl_vm_is_initialised) {
+#if BVM_HEAP_DUMP_ENABLE
+			/* only the first time - the dump shows what filled the heap */
+			if (bvm_gl_heapdump_on_oom_filename != NULL) {
+				char *filename = bvm_gl_heapdump_on_oom_filename;
+				bvm_gl_heapdump_on_oom_filename = NULL;
+				bvm_heapdump_to_file(filename);
+			}
+#endif
 			BVM_THROW(bvm_gl_out_of_memory_err_obj)
 		}
 		else
@@ -581,6 +1952,8 @@ void *bvm_heap_alloc(size_t size, int alloc_type) {
 		BVM_CHUNK_SetAllocType(chunk, alloc_type);
 	}
 
+	BVM_PROFILER_SAMPLE_ALLOCATION(((bvm_inuse_chunk_t *) chunk)->user_data, size, alloc_type)
+
 	/* Return a pointer to the user data part of the chunk, not the start of the chunk.*/
 	return ((bvm_inuse_chunk_t *) chunk)->user_data;
 }
@@ -592,11 +1965,106 @@ void *bvm_heap_alloc(size_t size, int alloc_type) {
  * @param alloc_type - the bvm_gc allocation type of the memory
  */
 void *bvm_heap_calloc(size_t size, int alloc_type) {
-	void *ptr = bvm_heap_alloc(size, alloc_type);
+
+	void *ptr;
+
+	/* memory from the thread allocation buffer is already zeroed - arena memory is not in it */
+#if BVM_HEAP_METADATA_ARENA_ENABLE
+	if (alloc_type == BVM_ALLOC_TYPE_METADATA)
+		ptr = NULL;
+	else
+#endif
+	BVM_HEAP_TLAB_TRY_ALLOC(ptr, size, alloc_type);
+
+	if (ptr != NULL) {
+		BVM_PROFILER_SAMPLE_ALLOCATION(ptr, size, alloc_type)
+		return ptr;
+	}
+
+	ptr = bvm_heap_alloc(size, alloc_type);
+
+#if BVM_HEAP_IDLE_ZERO_ENABLE
+	/* a chunk zeroed while the VM was idle is not zeroed again */
+	if (heap_alloc_zeroed) return ptr;
+#endif
+
 	memset(ptr, 0, size);
 	return ptr;
 }
 
+#if BVM_HEAP_IDLE_ZERO_ENABLE
+
+/**
+ * Find the next free chunk for #bvm_heap_zero_step to zero - the first chunk not already zeroed in the highest large
+ * bin that has one.
+ *
+ * @return the chunk, or \c NULL if every chunk in the large bins is zeroed.
+ */
+static bvm_chunk_t *heap_zero_find_chunk() {
+
+	int index;
+
+	for (index = HEAP_LARGE_BIN_COUNT; index--;) {
+
+		bvm_chunk_t *bin = &large_bins[index];
+		bvm_chunk_t *chunk;
+
+		if ( (large_bin_map & ((bvm_uint32_t) 1 << index)) == 0) continue;
+
+		for (chunk = bin->next_free_chunk; chunk != bin; chunk = chunk->next_free_chunk) {
+			if (!HEAP_IsZeroedChunk(chunk)) return chunk;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Zero up to #BVM_HEAP_IDLE_ZERO_STEP bytes of the free chunks in the large bins, carrying on with a chunk that the last
+ * step did not finish.  Each chunk that is finished is flagged as zeroed.  Called while the VM is idle.
+ *
+ * @return #BVM_TRUE if anything was zeroed, #BVM_FALSE if there was nothing left to zero.
+ */
+bvm_bool_t bvm_heap_zero_step() {
+
+	bvm_uint32_t budget = BVM_HEAP_IDLE_ZERO_STEP;
+	bvm_bool_t zeroed = BVM_FALSE;
+
+	while (budget > 0) {
+
+		bvm_uint8_t *end;
+		bvm_uint32_t length;
+
+		if (heap_zero_chunk == NULL) {
+
+			if ( (heap_zero_chunk = heap_zero_find_chunk()) == NULL) break;
+
+			/* the free list links stay as they are */
+			heap_zero_position = BVM_CHUNK_AsBytePtr(heap_zero_chunk) + sizeof(bvm_chunk_t);
+		}
+
+		/* ... as does the back-pointer in its last word */
+		end = BVM_CHUNK_AsBytePtr(heap_zero_chunk) + BVM_CHUNK_GetSize(heap_zero_chunk) - sizeof(bvm_chunk_t *);
+
+		length = (bvm_uint32_t) (end - heap_zero_position);
+		if (length > budget) length = budget;
+
+		memset(heap_zero_position, 0, length);
+		heap_zero_position += length;
+		budget -= length;
+		zeroed = BVM_TRUE;
+
+		if (heap_zero_position == end) {
+			heap_zero_chunk->header |= BVM_CHUNK_TYPE_MASK;
+			heap_zero_chunk = NULL;
+		}
+	}
+
+	return zeroed;
+}
+
+#endif
+
 /**
  * Make an exact copy of memory allocated by the allocator.  New memory is allocated and the
  * contents of the \c ptr argument are copied into it.  The \c ptr argument must be a pointer to
@@ -622,7 +2090,8 @@ void *bvm_heap_clone(void *ptr) {
 		BVM_VM_EXIT(BVM_FATAL_ERR_INVALID_MEMORY_CHUNK, NULL);
 #endif
 
-	size = BVM_CHUNK_GetSize(chunk);
+	/* the user data of the chunk - not the whole chunk, or the copy grows by a header each time */
+	size = BVM_CHUNK_GetSize(chunk) - BVM_CHUNK_OVERHEAD;
 
 	new_ptr = bvm_heap_alloc(size, BVM_CHUNK_GetType(chunk));
 	memcpy(new_ptr, ptr, size);
@@ -640,6 +2109,21 @@ void bvm_heap_set_alloc_type(void *ptr, int alloc_type) {
 
 	bvm_chunk_t *chunk = BVM_CHUNK_GetPointerChunk(ptr);
 
+#if BVM_GC_CONCURRENT_SWEEP_ENABLE
+	/* the sweeper may be changing the colour of the same header */
+	if (heap_is_unswept(chunk)) {
+
+		bvm_chunk_header_t header;
+
+		do {
+			header = chunk->header;
+		} while (!BVM_PD_ATOMIC_CAS(&chunk->header, header,
+				(header & ~BVM_CHUNK_TYPE_MASK) | ((bvm_chunk_header_t) alloc_type << BVM_CHUNK_TYPE_SHIFT)));
+
+		return;
+	}
+#endif
+
     BVM_CHUNK_SetAllocType(chunk, alloc_type);
 }
 
@@ -653,6 +2137,14 @@ void bvm_heap_free(void *ptr) {
 	/* chunk will begin at the start of the ptr less the chunk header size */
 	bvm_chunk_t *chunk = BVM_CHUNK_GetPointerChunk(ptr);
 
+#if BVM_HEAP_METADATA_ARENA_ENABLE
+	/* arena memory is not in the heap at all */
+	if (BVM_CHUNK_GetType(chunk) == BVM_ALLOC_TYPE_METADATA) {
+		heap_metadata_free(chunk);
+		return;
+	}
+#endif
+
 #if BVM_DEBUG_HEAP_CHECK_CHUNKS
 	/* Do some correctness checking just to make sure (as much as we can) that the thing being
 	 * freed is a valid address as supplied by bvm_heap_alloc.  We'll consider issues here
@@ -661,16 +2153,146 @@ void bvm_heap_free(void *ptr) {
 		BVM_VM_EXIT(BVM_FATAL_ERR_INVALID_MEMORY_CHUNK, NULL);
 #endif
 
+#if (BVM_GC_GENERATIONAL_ENABLE || BVM_GC_INCREMENTAL_ENABLE)
+	/* the collector may be holding on to it */
+	if ( (BVM_CHUNK_GetColour(chunk) == BVM_GC_COLOUR_GREY) || (BVM_CHUNK_GetColour(chunk) == BVM_GC_COLOUR_REMEMBERED) )
+		bvm_gc_forget(ptr);
+#endif
+
+#if BVM_HEAP_LARGE_OBJECT_ENABLE
+	/* a large primitive array may have a region of its own */
+	if (BVM_CHUNK_GetType(chunk) == BVM_ALLOC_TYPE_ARRAY_OF_PRIMITIVE) {
+
+		bvm_heap_region_t *region = heap_region_for( (bvm_uint8_t *) chunk);
+
+		if (region->is_large) {
+			bvm_heap_release_large_region(region);
+			return;
+		}
+	}
+#endif
+
+#if BVM_GC_CONCURRENT_SWEEP_ENABLE
+	/* its neighbours may be being swept - hold it until the sweep is done */
+	if (heap_is_unswept(chunk)) {
+		*(bvm_chunk_t **) BVM_CHUNK_GetUserData(chunk) = heap_held_chunks;
+		heap_held_chunks = chunk;
+		return;
+	}
+#endif
+
 	bvm_heap_free_chunk(chunk);
 }
 
+#if BVM_GC_CONCURRENT_SWEEP_ENABLE
+
+/**
+ * Empty the free list.  Called at the end of the marking of a GC before the concurrent sweeper starts - it will hand
+ * back every free chunk of the regions it sweeps.
+ */
+void bvm_heap_empty_free_list() {
+
+	int lc;
+
+	for (lc = HEAP_SMALL_BIN_COUNT; lc--;) {
+		small_bins[lc].next_free_chunk = &small_bins[lc];
+		small_bins[lc].prev_free_chunk = &small_bins[lc];
+	}
+
+	for (lc = HEAP_LARGE_BIN_COUNT; lc--;) {
+		large_bins[lc].next_free_chunk = &large_bins[lc];
+		large_bins[lc].prev_free_chunk = &large_bins[lc];
+	}
+
+	memset(small_bin_map, 0, sizeof(small_bin_map));
+	large_bin_map = 0;
+
+#if BVM_HEAP_IDLE_ZERO_ENABLE
+	heap_zero_chunk = NULL;
+#endif
+
+	bvm_gl_heap_free = 0;
+	bvm_gl_heap_free_chunks = 0;
+}
+
+/**
+ * Make a free chunk of the given bytes without putting it in the free list - its header holds just its size and its
+ * last bytes point back to its start.  The P bit of the chunk after it is left to the caller.  Used by the concurrent
+ * sweeper, so touches nothing outside the chunk.
+ *
+ * @param chunk - the start of the free chunk.
+ * @param size - the size of the free chunk.
+ */
+void bvm_heap_format_free_chunk(bvm_chunk_t *chunk, bvm_uint32_t size) {
+
+	chunk->header = BVM_CHUNK_SizeHeader(size);
+
+	*(bvm_chunk_t **) (BVM_CHUNK_AsBytePtr(chunk) + size - sizeof(bvm_chunk_t *)) = chunk;
+}
+
+/**
+ * Put free chunks handed back by the concurrent sweeper into the free list.
+ *
+ * @param chunks - the free chunks, linked through their \c next_free_chunk.  Chunks too small for the free list are not
+ * in it.
+ * @param size - the bytes of all the free chunks handed back, including those too small for the free list.
+ */
+void bvm_heap_add_swept_chunks(bvm_chunk_t *chunks, bvm_uint32_t size) {
+
+	while (chunks != NULL) {
+		bvm_chunk_t *next = chunks->next_free_chunk;
+		heap_link_free_chunk(chunks, BVM_CHUNK_GetSize(chunks));
+		chunks = next;
+	}
+
+	bvm_gl_heap_free += size;
+}
+
+/**
+ * Free the chunks held by #bvm_heap_free while the concurrent sweeper was at work.  Called once the sweep is done.
+ */
+void bvm_heap_free_held_chunks() {
+
+	while (heap_held_chunks != NULL) {
+		bvm_chunk_t *chunk = heap_held_chunks;
+		heap_held_chunks = *(bvm_chunk_t **) BVM_CHUNK_GetUserData(chunk);
+		bvm_heap_free_chunk(chunk);
+	}
+}
+
+#endif
+
 /**
- * Pass the entire VM heap back to the operating system.
+ * Pass the entire VM heap (all regions) back to the operating system.
  *
  * Called upon exit from the VM.
  */
 void bvm_heap_release() {
-	bvm_pd_memory_free(bvm_gl_heap_start);
+
+	while (bvm_gl_heap_regions != NULL) {
+		bvm_heap_region_t *region = bvm_gl_heap_regions;
+		bvm_gl_heap_regions = region->next;
+		HEAP_REGION_FREE(region);
+	}
+
+#if BVM_HEAP_METADATA_ARENA_ENABLE
+	/* the loader arena structs are in the default arena - so it goes last */
+	while (heap_metadata_loader_arenas != NULL) {
+		bvm_heap_metadata_arena_t *arena = heap_metadata_loader_arenas;
+		heap_metadata_loader_arenas = arena->next;
+		while (arena->regions != NULL) {
+			heap_metadata_region_t *region = arena->regions;
+			arena->regions = region->next;
+			heap_metadata_free_region(region);
+		}
+	}
+
+	while (heap_metadata_default.regions != NULL) {
+		heap_metadata_region_t *region = heap_metadata_default.regions;
+		heap_metadata_default.regions = region->next;
+		heap_metadata_free_region(region);
+	}
+#endif
 }
 
 /**
@@ -678,23 +2300,27 @@ void bvm_heap_release() {
  */
 void bvm_heap_debug_dump() {
 
-	bvm_chunk_t *chunk = (bvm_chunk_t *) bvm_gl_heap_start;
+	bvm_heap_region_t *region;
+	bvm_chunk_t *chunk;
 
     bvm_pd_console_out("heap free: %u\n", bvm_gl_heap_free);
 
-	while (chunk != (bvm_chunk_t *) bvm_gl_heap_end) {
+	for (region = bvm_gl_heap_regions; region != NULL; region = region->next) {
 
-		bvm_uint32_t size = BVM_CHUNK_GetSize(chunk);
-		int colour = BVM_CHUNK_GetColour(chunk);
-		int inuse = BVM_CHUNK_IsInuse(chunk);
-		int prevfree = BVM_CHUNK_IsPrevChunkFree(chunk);
-        int type = BVM_CHUNK_GetType(chunk);
+		bvm_pd_console_out("region: %p \t size: %u\n", (void *) region, (bvm_uint32_t) (region->end - region->start));
 
-        unsigned long memoffset = (bvm_uint8_t *) chunk - bvm_gl_heap_start;
+		for (chunk = (bvm_chunk_t *) region->start; chunk != (bvm_chunk_t *) region->end; chunk = BVM_CHUNK_GetNextChunk(chunk)) {
 
-		bvm_pd_console_out("addr: %p \t offset: %u \t size: %u \t type: %u \t inuse :%u \t  prev: %u  \t  colour : %u \n", (void *) chunk, memoffset, (int) size, type, inuse, prevfree, colour);
+			bvm_uint32_t size = BVM_CHUNK_GetSize(chunk);
+			int colour = BVM_CHUNK_GetColour(chunk);
+			int inuse = BVM_CHUNK_IsInuse(chunk);
+			int prevfree = BVM_CHUNK_IsPrevChunkFree(chunk);
+			int type = BVM_CHUNK_GetType(chunk);
 
-		chunk = BVM_CHUNK_GetNextChunk(chunk);
+			unsigned long memoffset = (bvm_uint8_t *) chunk - region->start;
+
+			bvm_pd_console_out("addr: %p \t offset: %u \t size: %u \t type: %u \t inuse :%u \t  prev: %u  \t  colour : %u \n", (void *) chunk, memoffset, (int) size, type, inuse, prevfree, colour);
+		}
 	}
 	bvm_pd_console_out("**************\n");
 }
@@ -718,21 +2344,22 @@ void printFreeChunk(bvm_chunk_t *chunk) {
  */
 void bvm_heap_debug_dump_free_list() {
 
-    bvm_chunk_t *chunk = free_list_start.next_free_chunk;
-
-    bvm_pd_console_out("free list\n");
-
-    printFreeChunk(&free_list_start);
+	bvm_chunk_t *chunk;
+	int lc;
 
-    int i = 0;
+	bvm_pd_console_out("free list\n");
 
-    while (chunk != &free_list_end && chunk != NULL) {
-        printFreeChunk(chunk);
-        chunk = chunk->next_free_chunk;
-        i++;
-    }
+	for (lc = 0; lc < HEAP_SMALL_BIN_COUNT; lc++) {
+		for (chunk = small_bins[lc].next_free_chunk; chunk != &small_bins[lc]; chunk = chunk->next_free_chunk) {
+			printFreeChunk(chunk);
+		}
+	}
 
-    printFreeChunk(&free_list_end);
+	for (lc = 0; lc < HEAP_LARGE_BIN_COUNT; lc++) {
+		for (chunk = large_bins[lc].next_free_chunk; chunk != &large_bins[lc]; chunk = chunk->next_free_chunk) {
+			printFreeChunk(chunk);
+		}
+	}
 
 	bvm_pd_console_out("**************\n");
 }
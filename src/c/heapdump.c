@@ -0,0 +1,981 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#include "../h/bvm.h"
+
+/**
+
+ @file
+
+ HPROF heap dumps.
+
+ @section ov Overview
+
+ A heap dump is written in the HPROF binary format ("JAVA PROFILE 1.0.2") so that the standard heap analysis tools can
+ be used to see what is holding on to memory.  The dump is streamed through a #bvm_heapdump_writer_t a block at a time
+ from a fixed size buffer (see #BVM_HEAP_DUMP_BUFFER_SIZE) so no heap memory is needed to write it - it can be written
+ when the heap is exhausted.  #bvm_heapdump_to_file and #bvm_heapdump_to_socket provide writers for a file and a socket.
+
+ The dump is made of:
+
+ @li a \c STRING record for the name of each clazz and field, and a \c LOAD \c CLASS record for each clazz.
+ @li the GC roots - each thread object and each object found on a thread stack, each object in the permanent and
+ transient root stacks, and the interned strings.
+ @li a \c CLASS \c DUMP for each clazz and an \c INSTANCE \c DUMP or array dump for each object and array - in the
+ order they are found walking the heap regions.
+
+ The heap records go into \c HEAP \c DUMP \c SEGMENT records.  The length of a record comes before its body, so each
+ group of records is first 'written' with the writes only being counted, and then written again for real after the
+ record header.  Segments are kept to about #BVM_HEAP_DUMP_SEGMENT_SIZE bytes.
+
+ The ID of an object is its address.  The ID of a class is the address of its clazz (not its \c java.lang.Class
+ object).  The ID of a name is the address of its pooled utfstring.  Stack traces are not recorded, except that with
+ #BVM_PROFILER_ALLOCATION_SITES_ENABLE each allocation site gets a stack trace of one frame, and each sampled object
+ the profiler still knows the site of is dumped with that stack trace.
+
+ Like the GC, thread stacks are scanned conservatively - each cell that looks like an object reference is taken as a
+ root.  Objects not yet swept by the lazy sweeper would refer to freed memory, so any pending sweep is finished first.
+
+ @author Greg McCreath
+ @since 0.0.10
+
+*/
+
+#if BVM_HEAP_DUMP_ENABLE
+
+/* HPROF top level record tags */
+#define HD_TAG_STRING					0x01
+#define HD_TAG_LOAD_CLASS				0x02
+#define HD_TAG_STACK_FRAME				0x04
+#define HD_TAG_STACK_TRACE				0x05
+#define HD_TAG_HEAP_DUMP_SEGMENT		0x1C
+#define HD_TAG_HEAP_DUMP_END			0x2C
+
+/* HPROF heap dump sub-record tags */
+#define HD_SUB_ROOT_UNKNOWN				0xFF
+#define HD_SUB_ROOT_JNI_GLOBAL			0x01
+#define HD_SUB_ROOT_JAVA_FRAME			0x03
+#define HD_SUB_ROOT_THREAD_OBJECT		0x08
+#define HD_SUB_CLASS_DUMP				0x20
+#define HD_SUB_INSTANCE_DUMP			0x21
+#define HD_SUB_OBJECT_ARRAY_DUMP		0x22
+#define HD_SUB_PRIMITIVE_ARRAY_DUMP		0x23
+
+/** The HPROF basic type for an object.  The other HPROF basic types have the same values as the BVM_T_* types. */
+#define HD_TYPE_OBJECT					2
+
+/** The size of an HPROF ID - big enough for an address */
+#define HD_ID_SIZE						((bvm_uint32_t) sizeof(void *))
+
+/** The serial number given for every stack trace.  Its stack trace record has no frames. */
+#define HD_STACK_TRACE_SERIAL			1
+
+/** If not \c NULL, a heap dump is written to this file the first time the VM runs out of memory.  Set with the
+ * \c -heapdump command line option. */
+BVM_VM_LOCAL char *bvm_gl_heapdump_on_oom_filename = NULL;
+
+/** The buffer the dump is written through */
+static BVM_VM_LOCAL bvm_uint8_t hd_buffer[BVM_HEAP_DUMP_BUFFER_SIZE];
+
+/** The number of bytes in #hd_buffer */
+static BVM_VM_LOCAL bvm_uint32_t hd_buffer_count;
+
+/** The writer for the dump being written */
+static BVM_VM_LOCAL bvm_heapdump_writer_t hd_writer;
+
+/** The context given to #hd_writer */
+static BVM_VM_LOCAL void *hd_context;
+
+/** Set if the writer has failed.  Nothing more is written. */
+static BVM_VM_LOCAL bvm_bool_t hd_failed;
+
+/** If set, writes are only counted, in #hd_counted, not written. */
+static BVM_VM_LOCAL bvm_bool_t hd_counting;
+
+/** The number of bytes counted while #hd_counting is set */
+static BVM_VM_LOCAL bvm_uint32_t hd_counted;
+
+/**
+ * Give what is in the buffer to the writer.
+ */
+static void hd_flush() {
+
+	if ( (hd_buffer_count > 0) && !hd_failed && !hd_writer(hd_buffer, hd_buffer_count, hd_context) )
+		hd_failed = BVM_TRUE;
+
+	hd_buffer_count = 0;
+}
+
+/**
+ * Write bytes to the dump - or just count them if #hd_counting is set.
+ *
+ * @param data - the bytes to write.
+ * @param length - the number of bytes.
+ */
+static void hd_write(const bvm_uint8_t *data, bvm_uint32_t length) {
+
+	if (hd_counting) {
+		hd_counted += length;
+		return;
+	}
+
+	while (length > 0) {
+
+		bvm_uint32_t count = BVM_HEAP_DUMP_BUFFER_SIZE - hd_buffer_count;
+
+		if (count > length) count = length;
+
+		memcpy(&hd_buffer[hd_buffer_count], data, count);
+
+		hd_buffer_count += count;
+		data += count;
+		length -= count;
+
+		if (hd_buffer_count == BVM_HEAP_DUMP_BUFFER_SIZE) hd_flush();
+	}
+}
+
+static void hd_u1(bvm_uint8_t value) {
+	hd_write(&value, 1);
+}
+
+static void hd_u2(bvm_uint16_t value) {
+
+	bvm_uint8_t bytes[2];
+
+	bytes[0] = (bvm_uint8_t) (value >> 8);
+	bytes[1] = (bvm_uint8_t) value;
+
+	hd_write(bytes, 2);
+}
+
+static void hd_u4(bvm_uint32_t value) {
+
+	bvm_uint8_t bytes[4];
+
+	bytes[0] = (bvm_uint8_t) (value >> 24);
+	bytes[1] = (bvm_uint8_t) (value >> 16);
+	bytes[2] = (bvm_uint8_t) (value >> 8);
+	bytes[3] = (bvm_uint8_t) value;
+
+	hd_write(bytes, 4);
+}
+
+static void hd_u8(bvm_int64_t value) {
+
+	bvm_uint64_hilo_t p = uint64Unpack( (bvm_uint64_t) value);
+
+	hd_u4(p.high);
+	hd_u4(p.low);
+}
+
+/**
+ * Write an ID - an address, most significant byte first.
+ *
+ * @param ptr - the address.  May be \c NULL.
+ */
+static void hd_id(const void *ptr) {
+
+	bvm_uint8_t bytes[sizeof(void *)];
+	size_t value = (size_t) ptr;
+	int i;
+
+	for (i = sizeof(void *); i--;) {
+		bytes[i] = (bvm_uint8_t) value;
+		value >>= 8;
+	}
+
+	hd_write(bytes, HD_ID_SIZE);
+}
+
+/**
+ * Write the header of a top level record.
+ *
+ * @param tag - the record tag.
+ * @param length - the length of the record body.
+ */
+static void hd_record(bvm_uint8_t tag, bvm_uint32_t length) {
+	hd_u1(tag);
+	hd_u4(0);
+	hd_u4(length);
+}
+
+/**
+ * Write a \c STRING record for a utfstring.  Its ID is the utfstring address.
+ *
+ * @param str - the utfstring.
+ */
+static void hd_string(bvm_utfstring_t *str) {
+	hd_record(HD_TAG_STRING, HD_ID_SIZE + str->length);
+	hd_id(str);
+	hd_write(str->data, str->length);
+}
+
+#if BVM_PROFILER_ALLOCATION_SITES_ENABLE
+
+/** The empty string - the signature and source file of an allocation site frame */
+static const char hd_empty_string[] = "";
+
+/**
+ * Give the stack trace serial number of an object - that of its allocation site if the profiler knows it.
+ *
+ * @param ptr - the object.
+ * @return its stack trace serial number.
+ */
+static bvm_uint32_t hd_trace_serial(void *ptr) {
+	return HD_STACK_TRACE_SERIAL + bvm_profiler_allocation_site_serial(ptr);
+}
+
+/**
+ * A #bvm_profiler_site_callback_t that writes the \c STRING, \c STACK \c FRAME and \c STACK \c TRACE records of an
+ * allocation site.  The site's text is the name of the frame's method, and its address the ID of both.  Its serial
+ * number is after #HD_STACK_TRACE_SERIAL.
+ */
+static void hd_allocation_site(bvm_uint32_t serial, const char *text, bvm_int32_t line) {
+
+	bvm_uint32_t length = (bvm_uint32_t) strlen(text);
+
+	hd_record(HD_TAG_STRING, HD_ID_SIZE + length);
+	hd_id(text);
+	hd_write( (const bvm_uint8_t *) text, length);
+
+	hd_record(HD_TAG_STACK_FRAME, (4 * HD_ID_SIZE) + 8);
+	hd_id(text);
+	hd_id(text);
+	hd_id(hd_empty_string);
+	hd_id(hd_empty_string);
+	hd_u4(0);
+	hd_u4( (bvm_uint32_t) line);
+
+	hd_record(HD_TAG_STACK_TRACE, 12 + HD_ID_SIZE);
+	hd_u4(HD_STACK_TRACE_SERIAL + serial);
+	hd_u4(0);
+	hd_u4(1);
+	hd_id(text);
+}
+
+/**
+ * Write the records of the allocation sites known to the profiler.
+ */
+static void hd_allocation_sites() {
+
+	hd_record(HD_TAG_STRING, HD_ID_SIZE);
+	hd_id(hd_empty_string);
+
+	bvm_profiler_allocsites_visit(hd_allocation_site);
+}
+
+#else
+#define hd_trace_serial(ptr) HD_STACK_TRACE_SERIAL
+#endif
+
+/**
+ * Give the HPROF basic type of a field.
+ *
+ * @param field - the field.
+ * @return the HPROF basic type.
+ */
+static bvm_uint8_t hd_field_type(bvm_field_t *field) {
+
+	switch (field->jni_signature->data[0]) {
+		case 'Z':
+			return BVM_T_BOOLEAN;
+		case 'C':
+			return BVM_T_CHAR;
+		case 'F':
+			return BVM_T_FLOAT;
+		case 'D':
+			return BVM_T_DOUBLE;
+		case 'B':
+			return BVM_T_BYTE;
+		case 'S':
+			return BVM_T_SHORT;
+		case 'I':
+			return BVM_T_INT;
+		case 'J':
+			return BVM_T_LONG;
+		default:
+			return HD_TYPE_OBJECT;
+	}
+}
+
+/**
+ * Give the size of a value of an HPROF basic type.
+ *
+ * @param type - the HPROF basic type.
+ * @return the size in bytes of a value.
+ */
+static bvm_uint32_t hd_type_size(bvm_uint8_t type) {
+
+	switch (type) {
+		case HD_TYPE_OBJECT:
+			return HD_ID_SIZE;
+		case BVM_T_BOOLEAN:
+		case BVM_T_BYTE:
+			return 1;
+		case BVM_T_CHAR:
+		case BVM_T_SHORT:
+			return 2;
+		case BVM_T_FLOAT:
+		case BVM_T_INT:
+			return 4;
+		default:
+			return 8;
+	}
+}
+
+/**
+ * Write a field value held in a cell.  Long and double values are held in two cells.
+ *
+ * @param cell - the cell holding the value.
+ * @param type - the HPROF basic type of the value.
+ */
+static void hd_cell_value(bvm_cell_t *cell, bvm_uint8_t type) {
+
+	switch (type) {
+		case HD_TYPE_OBJECT:
+			hd_id(cell->ref_value);
+			break;
+		case BVM_T_BOOLEAN:
+		case BVM_T_BYTE:
+			hd_u1( (bvm_uint8_t) cell->int_value);
+			break;
+		case BVM_T_CHAR:
+		case BVM_T_SHORT:
+			hd_u2( (bvm_uint16_t) cell->int_value);
+			break;
+#if BVM_FLOAT_ENABLE
+		case BVM_T_FLOAT: {
+			bvm_uint32_t bits;
+			memcpy(&bits, &cell->float_value, sizeof(bits));
+			hd_u4(bits);
+			break;
+		}
+#endif
+		case BVM_T_LONG:
+		case BVM_T_DOUBLE:
+			hd_u4( (bvm_uint32_t) cell[0].int_value);
+			hd_u4( (bvm_uint32_t) cell[1].int_value);
+			break;
+		default:
+			hd_u4( (bvm_uint32_t) cell->int_value);
+	}
+}
+
+/**
+ * Is the given pointer (probably) a live Java object?  Uses the same tests as the GC does for a thread stack cell.
+ *
+ * @param ptr - the pointer to test.
+ * @return #BVM_TRUE if it is an object.
+ */
+static bvm_bool_t hd_is_object(void *ptr) {
+
+	bvm_obj_t *obj = ptr;
+	bvm_chunk_t *chunk;
+
+	if (!BVM_HEAP_IsHeapAddress(obj) || !BVM_HEAP_IsHeapAddress(obj->clazz) || (obj->clazz->magic_number != BVM_MAGIC_NUMBER) )
+		return BVM_FALSE;
+
+	chunk = BVM_CHUNK_GetPointerChunk(obj);
+
+	return ( BVM_CHUNK_IsInuse(chunk) &&
+			 (BVM_CHUNK_GetType(chunk) <= BVM_ALLOC_MAX_OBJECT) &&
+			 bvm_heap_is_chunk_valid(chunk) );
+}
+
+/**
+ * Write a root record for an object.
+ *
+ * @param tag - the root sub-record tag - #HD_SUB_ROOT_UNKNOWN or #HD_SUB_ROOT_JNI_GLOBAL.
+ * @param obj - the object.
+ * @param ref - for a JNI global, the address of the reference to the object.
+ */
+static void hd_root(bvm_uint8_t tag, void *obj, void *ref) {
+	hd_u1(tag);
+	hd_id(obj);
+	if (tag == HD_SUB_ROOT_JNI_GLOBAL) hd_id(ref);
+}
+
+/**
+ * Write a root for each object found on a thread stack.  Each frame is walked as for the GC.
+ *
+ * @param vmthread - the thread.
+ * @param thread_serial - the thread's serial number in the dump.
+ */
+static void hd_thread_stack_roots(bvm_vmthread_t *vmthread, bvm_uint32_t thread_serial) {
+
+	bvm_method_t *frame_method = vmthread->rx_method;
+	bvm_cell_t *frame_locals = vmthread->rx_locals;
+	bvm_cell_t *frame_top = vmthread->rx_sp;
+	bvm_cell_t *cell_ptr;
+	bvm_uint32_t depth = 0;
+
+	while (  !( (frame_method == BVM_METHOD_CALLBACKWEDGE) &&
+		        (frame_locals[1].callback == bvm_thread_terminated_callback) )) {
+
+		if (!BVM_METHOD_IsNative(frame_method)) {
+			cell_ptr = frame_locals;
+		} else {
+			/* a native method's arguments are at the top of the calling frame's stack */
+			cell_ptr = frame_locals[BVM_FRAME_SP_OFFSET].ptr_value;
+			frame_top = cell_ptr + frame_method->num_args + ( BVM_METHOD_IsStatic(frame_method) ? 0 : 1);
+		}
+
+		for (; cell_ptr < frame_top; cell_ptr++) {
+
+			if (hd_is_object(cell_ptr->ptr_value)) {
+				hd_u1(HD_SUB_ROOT_JAVA_FRAME);
+				hd_id(cell_ptr->ptr_value);
+				hd_u4(thread_serial);
+				hd_u4(depth);
+			}
+		}
+
+		frame_method = frame_locals[BVM_FRAME_METHOD_OFFSET].ptr_value;
+		frame_top    = frame_locals[BVM_FRAME_SP_OFFSET].ptr_value;
+		frame_locals = frame_locals[BVM_FRAME_LOCALS_OFFSET].ptr_value;
+		depth++;
+	}
+}
+
+/**
+ * Write the GC roots - the threads and their stacks, and the permanent and transient roots.
+ */
+static void hd_roots() {
+
+	bvm_vmthread_t *vmthread;
+	bvm_uint32_t serial = 0;
+	bvm_uint32_t i;
+
+	for (vmthread = bvm_gl_threads; vmthread != NULL; vmthread = vmthread->next) {
+
+		if (vmthread->status == BVM_THREAD_STATUS_TERMINATED) continue;
+
+		serial++;
+
+		hd_u1(HD_SUB_ROOT_THREAD_OBJECT);
+		hd_id(vmthread->thread_obj);
+		hd_u4(serial);
+		hd_u4(HD_STACK_TRACE_SERIAL);
+
+		/* a NEW thread has nothing on its stack yet */
+		if ( (vmthread->stack_list != NULL) && (vmthread->status != BVM_THREAD_STATUS_NEW) )
+			hd_thread_stack_roots(vmthread, serial);
+
+		if (vmthread->pending_exception != NULL)
+			hd_root(HD_SUB_ROOT_UNKNOWN, vmthread->pending_exception, NULL);
+
+		if (vmthread->exception_location.throwable != NULL)
+			hd_root(HD_SUB_ROOT_UNKNOWN, vmthread->exception_location.throwable, NULL);
+	}
+
+	/* the root stacks also hold things other than objects */
+	for (i = 0; i < bvm_gl_gc_permanent_roots_top; i++) {
+		if (hd_is_object(bvm_gl_gc_permanent_roots[i].ptr_value))
+			hd_root(HD_SUB_ROOT_JNI_GLOBAL, bvm_gl_gc_permanent_roots[i].ptr_value, &bvm_gl_gc_permanent_roots[i]);
+	}
+
+	for (i = 0; i < bvm_gl_gc_transient_roots_top; i++) {
+		if (hd_is_object(bvm_gl_gc_transient_roots[i].ptr_value))
+			hd_root(HD_SUB_ROOT_JNI_GLOBAL, bvm_gl_gc_transient_roots[i].ptr_value, &bvm_gl_gc_transient_roots[i]);
+	}
+}
+
+/**
+ * Give the size of the field values of an instance of a clazz - its own fields and those of its superclasses.
+ *
+ * @param clazz - the clazz.
+ * @return the size in bytes of the values in an \c INSTANCE \c DUMP.
+ */
+static bvm_uint32_t hd_instance_size(bvm_instance_clazz_t *clazz) {
+
+	bvm_uint32_t size = 0;
+	int i;
+
+	for (; clazz != NULL; clazz = clazz->super_clazz) {
+
+		if (clazz->fields == NULL) continue;
+
+		for (i = clazz->virtual_field_offset; i < clazz->fields_count; i++)
+			size += hd_type_size(hd_field_type(&clazz->fields[i]));
+	}
+
+	return size;
+}
+
+/**
+ * Write the \c CLASS \c DUMP of a clazz.  Primitive clazzes are not written.
+ *
+ * @param clazz - the clazz.
+ * @param is_instance - #BVM_TRUE if \c clazz is an instance clazz, #BVM_FALSE if it is an array clazz.
+ */
+static void hd_class_dump(bvm_clazz_t *clazz, bvm_bool_t is_instance) {
+
+	bvm_instance_clazz_t *instance_clazz = (bvm_instance_clazz_t *) clazz;
+	bvm_uint16_t statics = 0;
+	bvm_uint16_t fields = 0;
+	int i;
+
+	if (is_instance && (instance_clazz->fields != NULL) ) {
+		statics = instance_clazz->virtual_field_offset;
+		fields = (bvm_uint16_t) (instance_clazz->fields_count - statics);
+	}
+
+	hd_u1(HD_SUB_CLASS_DUMP);
+	hd_id(clazz);
+	hd_u4(HD_STACK_TRACE_SERIAL);
+	hd_id(clazz->super_clazz);
+	hd_id(clazz->classloader_obj);
+	hd_id(NULL);		/* signers */
+	hd_id(NULL);		/* protection domain */
+	hd_id(NULL);		/* reserved */
+	hd_id(NULL);		/* reserved */
+	hd_u4(is_instance ? hd_instance_size(instance_clazz) : 0);
+	hd_u2(0);			/* constant pool */
+
+	hd_u2(statics);
+	for (i = 0; i < statics; i++) {
+
+		bvm_field_t *field = &instance_clazz->fields[i];
+		bvm_uint8_t type = hd_field_type(field);
+
+		hd_id(field->name);
+		hd_u1(type);
+
+		/* static longs and doubles are held apart from the field */
+		if (BVM_FIELD_IsLong(field))
+			hd_u8(*((bvm_int64_t *) field->value.static_value.ptr_value));
+		else
+			hd_cell_value(&field->value.static_value, type);
+	}
+
+	hd_u2(fields);
+	for (i = statics; i < statics + fields; i++) {
+		hd_id(instance_clazz->fields[i].name);
+		hd_u1(hd_field_type(&instance_clazz->fields[i]));
+	}
+}
+
+/**
+ * Write the \c INSTANCE \c DUMP of an object.  The values of its clazz's fields come first, then those of its
+ * superclass, and so on.
+ *
+ * @param obj - the object.
+ */
+static void hd_instance_dump(bvm_obj_t *obj) {
+
+	bvm_instance_clazz_t *clazz = (bvm_instance_clazz_t *) obj->clazz;
+	int i;
+
+	hd_u1(HD_SUB_INSTANCE_DUMP);
+	hd_id(obj);
+	hd_u4(hd_trace_serial(obj));
+	hd_id(clazz);
+	hd_u4(hd_instance_size(clazz));
+
+	for (; clazz != NULL; clazz = clazz->super_clazz) {
+
+		if (clazz->fields == NULL) continue;
+
+		for (i = clazz->virtual_field_offset; i < clazz->fields_count; i++) {
+			bvm_field_t *field = &clazz->fields[i];
+#if BVM_FIELD_PACKING_ENABLE
+			if (BVM_FIELD_IsPacked(field)) {
+				bvm_cell_t cells[2];
+				bvm_object_get_packed_field(obj, field, cells);
+				hd_cell_value(cells, hd_field_type(field));
+				continue;
+			}
+#endif
+			hd_cell_value(&obj->fields[field->value.offset], hd_field_type(field));
+		}
+	}
+}
+
+/**
+ * Write the \c OBJECT \c ARRAY \c DUMP of an array of references.
+ *
+ * @param array - the array.
+ */
+static void hd_object_array_dump(bvm_instance_array_obj_t *array) {
+
+	bvm_uint32_t length = (bvm_uint32_t) array->length.int_value;
+	bvm_uint32_t i;
+
+	hd_u1(HD_SUB_OBJECT_ARRAY_DUMP);
+	hd_id(array);
+	hd_u4(hd_trace_serial(array));
+	hd_u4(length);
+	hd_id(array->clazz);
+
+	for (i = 0; i < length; i++)
+		hd_id(BVM_REF_Decode(array->data[i]));
+}
+
+/**
+ * Write the \c PRIMITIVE \c ARRAY \c DUMP of an array of primitives.  Elements are written most significant byte
+ * first.
+ *
+ * @param array - the array.
+ */
+static void hd_primitive_array_dump(bvm_jarray_obj_t *array) {
+
+	bvm_uint8_t type = (bvm_uint8_t) array->clazz->component_jtype;
+	bvm_uint32_t length = (bvm_uint32_t) array->length.int_value;
+	bvm_uint32_t i;
+
+	hd_u1(HD_SUB_PRIMITIVE_ARRAY_DUMP);
+	hd_id(array);
+	hd_u4(hd_trace_serial(array));
+	hd_u4(length);
+	hd_u1(type);
+
+	/* counting only needs the size */
+	if (hd_counting) {
+		hd_counted += length * hd_type_size(type);
+		return;
+	}
+
+	switch (type) {
+		case BVM_T_BOOLEAN:
+			hd_write( ((bvm_jboolean_array_obj_t *) array)->data, length);
+			break;
+		case BVM_T_BYTE:
+			hd_write( (bvm_uint8_t *) ((bvm_jbyte_array_obj_t *) array)->data, length);
+			break;
+		case BVM_T_CHAR:
+			for (i = 0; i < length; i++) hd_u2( ((bvm_jchar_array_obj_t *) array)->data[i]);
+			break;
+		case BVM_T_SHORT:
+			for (i = 0; i < length; i++) hd_u2( (bvm_uint16_t) ((bvm_jshort_array_obj_t *) array)->data[i]);
+			break;
+		case BVM_T_INT:
+			for (i = 0; i < length; i++) hd_u4( (bvm_uint32_t) ((bvm_jint_array_obj_t *) array)->data[i]);
+			break;
+		case BVM_T_LONG:
+			for (i = 0; i < length; i++) hd_u8( ((bvm_jlong_array_obj_t *) array)->data[i]);
+			break;
+#if BVM_FLOAT_ENABLE
+		case BVM_T_FLOAT:
+			for (i = 0; i < length; i++) {
+				bvm_uint32_t bits;
+				memcpy(&bits, &((bvm_jfloat_array_obj_t *) array)->data[i], sizeof(bits));
+				hd_u4(bits);
+			}
+			break;
+		case BVM_T_DOUBLE:
+			for (i = 0; i < length; i++) {
+				bvm_uint64_t bits;
+				bvm_uint64_hilo_t p;
+				memcpy(&bits, &((bvm_jdouble_array_obj_t *) array)->data[i], sizeof(bits));
+				p = uint64Unpack(bits);
+				hd_u4(p.high);
+				hd_u4(p.low);
+			}
+			break;
+#endif
+	}
+}
+
+/**
+ * Write the heap dump record for a chunk - if it is a clazz, an object or an array.
+ *
+ * @param chunk - the chunk.
+ */
+static void hd_chunk(bvm_chunk_t *chunk) {
+
+	void *data = BVM_CHUNK_GetUserData(chunk);
+
+	if (!BVM_CHUNK_IsInuse(chunk)) return;
+
+	switch (BVM_CHUNK_GetType(chunk)) {
+		case BVM_ALLOC_TYPE_OBJECT:
+		case BVM_ALLOC_TYPE_STRING:
+		case BVM_ALLOC_TYPE_WEAK_REFERENCE:
+		case BVM_ALLOC_TYPE_SOFT_REFERENCE:
+		case BVM_ALLOC_TYPE_EPHEMERON:
+			/* an object may be caught before its clazz is set */
+			if ( ((bvm_obj_t *) data)->clazz != NULL) hd_instance_dump(data);
+			break;
+		case BVM_ALLOC_TYPE_ARRAY_OF_OBJECT:
+			hd_object_array_dump(data);
+			break;
+		case BVM_ALLOC_TYPE_ARRAY_OF_PRIMITIVE:
+			hd_primitive_array_dump(data);
+			break;
+		case BVM_ALLOC_TYPE_INSTANCE_CLAZZ:
+			hd_class_dump(data, BVM_TRUE);
+			break;
+		case BVM_ALLOC_TYPE_ARRAY_CLAZZ:
+			hd_class_dump(data, BVM_FALSE);
+			break;
+	}
+}
+
+/**
+ * Write the interned strings and their char arrays.  Being STATIC they are not found by the heap walk.  Each is
+ * also a root.
+ */
+static void hd_interned_strings() {
+
+	bvm_internstring_obj_t *string;
+	int i;
+
+	for (i = bvm_gl_internstring_pool_bucketcount; i--;) {
+
+		for (string = bvm_gl_internstring_pool[i]; string != NULL; string = string->next) {
+
+			hd_root(HD_SUB_ROOT_UNKNOWN, string, NULL);
+			hd_instance_dump( (bvm_obj_t *) string);
+
+			if (string->chars != NULL)
+				hd_primitive_array_dump( (bvm_jarray_obj_t *) string->chars);
+		}
+	}
+}
+
+/**
+ * Write the output of the given function as a heap dump segment.  The function is called twice - once to count the
+ * bytes it writes and then again to write them after the segment header.
+ *
+ * @param emit - the function that writes the sub-records of the segment.
+ */
+static void hd_segment(void (*emit)()) {
+
+	hd_counting = BVM_TRUE;
+	hd_counted = 0;
+	emit();
+	hd_counting = BVM_FALSE;
+
+	if (hd_counted > 0) {
+		hd_record(HD_TAG_HEAP_DUMP_SEGMENT, hd_counted);
+		emit();
+	}
+}
+
+/**
+ * Write the \c STRING and \c LOAD \c CLASS records for every clazz in the heap and the names of its fields.
+ */
+static void hd_load_classes() {
+
+	bvm_heap_region_t *region;
+	bvm_chunk_t *chunk;
+	bvm_uint32_t serial = 0;
+	int i;
+
+	for (region = bvm_gl_heap_regions; region != NULL; region = region->next) {
+
+		for (chunk = (bvm_chunk_t *) region->start; chunk < (bvm_chunk_t *) region->end; chunk = BVM_CHUNK_GetNextChunk(chunk)) {
+
+			int type = BVM_CHUNK_GetType(chunk);
+			bvm_clazz_t *clazz = BVM_CHUNK_GetUserData(chunk);
+
+			if ( !BVM_CHUNK_IsInuse(chunk) ||
+				 ((type != BVM_ALLOC_TYPE_INSTANCE_CLAZZ) && (type != BVM_ALLOC_TYPE_ARRAY_CLAZZ)) )
+				continue;
+
+			hd_string(clazz->name);
+
+			hd_record(HD_TAG_LOAD_CLASS, 4 + HD_ID_SIZE + 4 + HD_ID_SIZE);
+			hd_u4(++serial);
+			hd_id(clazz);
+			hd_u4(HD_STACK_TRACE_SERIAL);
+			hd_id(clazz->name);
+
+			if ( (type == BVM_ALLOC_TYPE_INSTANCE_CLAZZ) && (((bvm_instance_clazz_t *) clazz)->fields != NULL) ) {
+				bvm_instance_clazz_t *instance_clazz = (bvm_instance_clazz_t *) clazz;
+				for (i = 0; i < instance_clazz->fields_count; i++)
+					hd_string(instance_clazz->fields[i].name);
+			}
+		}
+	}
+}
+
+/**
+ * Write the clazzes, objects and arrays of the heap - walking each region in groups of chunks that make a heap dump
+ * segment of about #BVM_HEAP_DUMP_SEGMENT_SIZE bytes.
+ */
+static void hd_heap() {
+
+	bvm_heap_region_t *region;
+
+	for (region = bvm_gl_heap_regions; region != NULL; region = region->next) {
+
+		bvm_chunk_t *chunk = (bvm_chunk_t *) region->start;
+
+		while (chunk < (bvm_chunk_t *) region->end) {
+
+			bvm_chunk_t *last = chunk;
+			bvm_chunk_t *c;
+
+			/* count the records for a segment's worth of chunks */
+			hd_counting = BVM_TRUE;
+			hd_counted = 0;
+
+			while ( (last < (bvm_chunk_t *) region->end) && (hd_counted < BVM_HEAP_DUMP_SEGMENT_SIZE) ) {
+				hd_chunk(last);
+				last = BVM_CHUNK_GetNextChunk(last);
+			}
+
+			hd_counting = BVM_FALSE;
+
+			/* and write them */
+			if (hd_counted > 0) {
+				hd_record(HD_TAG_HEAP_DUMP_SEGMENT, hd_counted);
+				for (c = chunk; c < last; c = BVM_CHUNK_GetNextChunk(c))
+					hd_chunk(c);
+			}
+
+			chunk = last;
+		}
+	}
+}
+
+/**
+ * Write an HPROF heap dump of the whole heap.  No heap memory is allocated.  Threads do not switch while it is
+ * written.
+ *
+ * @param writer - the writer each block of the dump is given to.
+ * @param context - passed to the writer.
+ * @return #BVM_TRUE if the dump was written, #BVM_FALSE if the writer failed.
+ */
+bvm_bool_t bvm_heapdump(bvm_heapdump_writer_t writer, void *context) {
+
+	static const char header[] = "JAVA PROFILE 1.0.2";
+
+#if (BVM_GC_LAZY_SWEEP_ENABLE || BVM_GC_CONCURRENT_SWEEP_ENABLE)
+	/* unswept garbage may refer to memory that has been freed */
+	while (bvm_gc_sweep_step()) {}
+#endif
+
+#if BVM_HEAP_TLAB_ENABLE
+	/* the free remainder of the allocation buffer is not a chunk that can be walked */
+	bvm_heap_tlab_retire();
+#endif
+
+	/* the current thread's registers are live in the globals */
+	if (bvm_gl_thread_current != NULL) bvm_thread_store_registers(bvm_gl_thread_current);
+
+	hd_writer = writer;
+	hd_context = context;
+	hd_failed = BVM_FALSE;
+	hd_counting = BVM_FALSE;
+	hd_buffer_count = 0;
+
+	/* the header - including the string's terminating zero */
+	hd_write( (const bvm_uint8_t *) header, sizeof(header));
+	hd_u4(HD_ID_SIZE);
+	hd_u8(bvm_pd_system_time());
+
+	hd_load_classes();
+
+	hd_record(HD_TAG_STACK_TRACE, 12);
+	hd_u4(HD_STACK_TRACE_SERIAL);
+	hd_u4(0);
+	hd_u4(0);
+
+#if BVM_PROFILER_ALLOCATION_SITES_ENABLE
+	hd_allocation_sites();
+#endif
+
+	hd_segment(hd_roots);
+
+	if (bvm_gl_internstring_pool != NULL) hd_segment(hd_interned_strings);
+
+	hd_heap();
+
+	hd_record(HD_TAG_HEAP_DUMP_END, 0);
+
+	hd_flush();
+
+	return !hd_failed;
+}
+
+/**
+ * A #bvm_heapdump_writer_t for a platform file.
+ */
+static bvm_bool_t hd_file_writer(const bvm_uint8_t *data, bvm_uint32_t length, void *context) {
+	return (bvm_pd_file_write(data, length, context) == length);
+}
+
+/**
+ * Write an HPROF heap dump to a file.  An existing file is overwritten.
+ *
+ * @param filename - the name of the file.
+ * @return #BVM_TRUE if the dump was written, #BVM_FALSE if the file could not be opened or written.
+ */
+bvm_bool_t bvm_heapdump_to_file(const char *filename) {
+
+	bvm_bool_t result;
+	void *handle = bvm_pd_file_open(filename, BVM_FILE_O_WRONLY | BVM_FILE_O_TRUNC);
+
+	if (handle == NULL) return BVM_FALSE;
+
+	result = bvm_heapdump(hd_file_writer, handle);
+
+	if (bvm_pd_file_close(handle) == BVM_ERR) result = BVM_FALSE;
+
+	return result;
+}
+
+#if BVM_SOCKETS_ENABLE
+
+/**
+ * A #bvm_heapdump_writer_t for a socket.  The context is the socket descriptor.
+ */
+static bvm_bool_t hd_socket_writer(const bvm_uint8_t *data, bvm_uint32_t length, void *context) {
+
+	bvm_int32_t fd = *((bvm_int32_t *) context);
+
+	while (length > 0) {
+
+		bvm_int32_t written = bvm_pd_socket_write(fd, (const char *) data, (bvm_int32_t) length);
+
+		if (written <= 0) return BVM_FALSE;
+
+		data += written;
+		length -= (bvm_uint32_t) written;
+	}
+
+	return BVM_TRUE;
+}
+
+/**
+ * Write an HPROF heap dump to a socket connection - to a listening analysis tool, say.
+ *
+ * @param hostname - the host to connect to.
+ * @param port - the port to connect to.
+ * @return #BVM_TRUE if the dump was written, #BVM_FALSE if the connection could not be made or written to.
+ */
+bvm_bool_t bvm_heapdump_to_socket(const char *hostname, bvm_int32_t port) {
+
+	bvm_bool_t result;
+	bvm_int32_t fd = bvm_pd_socket_open(hostname, port);
+
+	if (fd == BVM_SOCKET_ERROR) return BVM_FALSE;
+
+	result = bvm_heapdump(hd_socket_writer, &fd);
+
+	bvm_pd_socket_close(fd);
+
+	return result;
+}
+
+#endif
+
+#endif
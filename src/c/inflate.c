@@ -0,0 +1,768 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#include "../h/bvm.h"
+
+/**
+
+ @file
+
+ Table driven inflater for deflated jar entries.
+
+ @section ov Overview
+
+ The bundled tinf inflater is built for size - it decodes each Huffman code one bit at a time by walking the code
+ length counts, and reads the compressed data one byte at a time.  That makes inflating the runtime jar one of the
+ larger costs of starting the VM.  When #BVM_JAR_FAST_INFLATE_ENABLE is set jar entries are inflated by
+ #bvm_inflate instead.  It decodes the same deflate format (RFC 1951) with the same checks as tinf, and decodes
+ straight into the destination buffer.
+
+ @section tables Decode Tables
+
+ Each Huffman code is decoded by a lookup in a table indexed by the next few bits of the input - 10 bits for
+ literal/length codes, 8 for distance codes, and 7 for the code length codes of a dynamic block.  A table entry
+ holds the number of bits in the code and what the code decodes to - a literal, the end of the block, or the base
+ value and number of extra bits of a length or distance.  Codes longer than the table bits (rare) have their entry in
+ the table point to a second level table indexed by the following bits.  A whole code is decoded with one or two
+ lookups regardless of its length.  The tables for the fixed Huffman codes are built once and kept - the tables for
+ a dynamic block are built for each block.
+
+ @section bits Bit Buffer
+
+ Input bits are held in a machine word.  While there is at least a word of input left the buffer is topped up with
+ a single (unaligned) word load, which on a 64 bit machine gives enough bits for a whole literal/length and distance
+ pair.  Near the end of the input it is topped up a byte at a time.  To keep the decode loop free of end-of-input
+ checks, reading past the end of the input gives zero bits - the bytes 'read' past the end are counted and it is an
+ error if any of their bits are used.
+
+ Matches of a distance of at least a word are copied a word at a time when there is room in the destination.
+
+ @author Greg McCreath
+ @since 0.0.10
+
+*/
+
+#if BVM_JAR_FAST_INFLATE_ENABLE
+
+/** Bits of input to index the literal/length table by */
+#define INFLATE_LITLEN_BITS		10
+
+/** Bits of input to index the distance table by */
+#define INFLATE_DIST_BITS		8
+
+/** Bits of input to index the code length table by - as long as the longest code length code */
+#define INFLATE_PRECODE_BITS	7
+
+/** Maximum size of a literal/length table, including second level tables, for any valid code ('enough 288 10 15') */
+#define INFLATE_LITLEN_ENOUGH	1334
+
+/** Maximum size of a distance table, including second level tables, for any valid code ('enough 32 8 15') */
+#define INFLATE_DIST_ENOUGH		402
+
+/** The longest Huffman code in deflate */
+#define INFLATE_MAX_CODE_BITS	15
+
+/** The largest number of symbols in a deflate code */
+#define INFLATE_MAX_SYMBOLS		288
+
+/** Table entry op - mask for the number of extra bits of a length or distance, or the bits of a second level table */
+#define INFLATE_OP_EXTRA		0x0F
+
+/** Table entry op - the entry points to a second level table */
+#define INFLATE_OP_SUB			0x10
+
+/** Table entry op - end of block */
+#define INFLATE_OP_END			0x20
+
+/** Table entry op - a literal byte */
+#define INFLATE_OP_LITERAL		0x40
+
+/** Table entry op - not a valid code */
+#define INFLATE_OP_INVALID		0x80
+
+/** A table entry.  The top 16 bits are the value, then 8 bits of op, then 8 bits of the code bits to drop */
+#define INFLATE_ENTRY(value, op, bits)	( ((bvm_uint32_t) (value) << 16) | ((bvm_uint32_t) (op) << 8) | (bvm_uint32_t) (bits) )
+#define INFLATE_ENTRY_VALUE(e)			( (e) >> 16 )
+#define INFLATE_ENTRY_OP(e)				( ((e) >> 8) & 0xFF )
+#define INFLATE_ENTRY_BITS(e)			( (e) & 0xFF )
+
+/** The kinds of decode table */
+#define INFLATE_KIND_PRECODE	0
+#define INFLATE_KIND_LITLEN		1
+#define INFLATE_KIND_DIST		2
+
+/** The bit buffer - a machine word */
+typedef size_t inflate_word_t;
+
+/** Bits in the bit buffer */
+#define INFLATE_WORD_BITS		((int) (sizeof(inflate_word_t) * 8))
+
+/**
+ * The state of an inflate - the input and its bit buffer, and the output.
+ */
+typedef struct _inflatestreamstruct {
+
+	/** the next byte of input */
+	const bvm_uint8_t *in;
+
+	/** the end of the input */
+	const bvm_uint8_t *in_end;
+
+	/** input bits not yet used, the next bit lowest */
+	inflate_word_t bitbuf;
+
+	/** the number of bits in \c bitbuf */
+	int bitcount;
+
+	/** the number of zero bytes put into \c bitbuf from past the end of the input */
+	int pad;
+
+	/** the start of the output */
+	bvm_uint8_t *out_start;
+
+	/** the next byte of output */
+	bvm_uint8_t *out;
+
+	/** the end of the output */
+	bvm_uint8_t *out_end;
+
+} inflate_stream_t;
+
+/**
+ * Literal/length and distance decode tables.
+ */
+typedef struct _inflatetablesstruct {
+	bvm_uint32_t litlen[INFLATE_LITLEN_ENOUGH];
+	bvm_uint32_t dist[INFLATE_DIST_ENOUGH];
+} inflate_tables_t;
+
+/**
+ * The tables an inflate builds - those of the fixed codes once, and those of each dynamic block.  Kept out of the
+ * native stack.
+ */
+struct _inflateworkstruct {
+
+	/** tables for the codes of a dynamic block */
+	inflate_tables_t dynamic_tables;
+
+	/** tables for the fixed codes */
+	inflate_tables_t fixed_tables;
+
+	/** whether \c fixed_tables have been built */
+	bvm_bool_t fixed_built;
+};
+
+/** The tables of #bvm_inflate */
+static BVM_VM_LOCAL bvm_inflate_work_t inflate_work;
+
+/** Base lengths of length codes 257..285 */
+static const bvm_uint16_t inflate_length_base[29] = {
+	  3,   4,   5,   6,   7,   8,   9,  10,  11,  13,  15,  17,  19,  23,  27,
+	 31,  35,  43,  51,  59,  67,  83,  99, 115, 131, 163, 195, 227, 258
+};
+
+/** Extra bits of length codes 257..285 */
+static const bvm_uint8_t inflate_length_extra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+/** Base distances of distance codes 0..29 */
+static const bvm_uint16_t inflate_dist_base[30] = {
+	    1,     2,     3,     4,     5,     7,     9,    13,    17,    25,
+	   33,    49,    65,    97,   129,   193,   257,   385,   513,   769,
+	 1025,  1537,  2049,  3073,  4097,  6145,  8193, 12289, 16385, 24577
+};
+
+/** Extra bits of distance codes 0..29 */
+static const bvm_uint8_t inflate_dist_extra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+/** The next \c n bits of input */
+#define INFLATE_BITS(s, n)		( (unsigned int) ((s).bitbuf & (((inflate_word_t) 1 << (n)) - 1)) )
+
+/** Drop \c n bits of input */
+#define INFLATE_DROP(s, n)		( (s).bitbuf >>= (n), (s).bitcount -= (n) )
+
+/** Make sure there are at least \c n (up to a word less a byte) bits of input in the bit buffer */
+#define INFLATE_NEED(s, n)																	\
+	do {																					\
+		if ((s).bitcount < (n)) {															\
+			if ((size_t) ((s).in_end - (s).in) >= sizeof(inflate_word_t)) {				\
+				int bytes_ = (INFLATE_WORD_BITS - 1 - (s).bitcount) >> 3;					\
+				(s).bitbuf |= inflate_load_word((s).in) << (s).bitcount;					\
+				(s).in += bytes_;															\
+				(s).bitcount += bytes_ << 3;												\
+			} else {																		\
+				while ((s).bitcount <= INFLATE_WORD_BITS - 8) {								\
+					if ((s).in != (s).in_end)												\
+						(s).bitbuf |= (inflate_word_t) *(s).in++ << (s).bitcount;			\
+					else																	\
+						(s).pad++;															\
+					(s).bitcount += 8;														\
+				}																			\
+			}																				\
+		}																					\
+	} while (0)
+
+/** Whether bits from past the end of the input have been used */
+#define INFLATE_OVERRUN(s)		( ((s).pad > 0) && ((s).bitcount < ((s).pad << 3)) )
+
+/** Decode a code from the input using the given table into entry \c e.  There must be at least 15 bits of input */
+#define INFLATE_DECODE(s, table, bits, e)													\
+	do {																					\
+		(e) = (table)[INFLATE_BITS(s, bits)];												\
+		if (INFLATE_ENTRY_OP(e) & INFLATE_OP_SUB) {										\
+			INFLATE_DROP(s, bits);															\
+			(e) = (table)[INFLATE_ENTRY_VALUE(e) + INFLATE_BITS(s, INFLATE_ENTRY_OP(e) & INFLATE_OP_EXTRA)];	\
+		}																					\
+		INFLATE_DROP(s, INFLATE_ENTRY_BITS(e));												\
+	} while (0)
+
+/**
+ * Load a word of input, little endian.
+ */
+static inflate_word_t inflate_load_word(const bvm_uint8_t *p) {
+
+	inflate_word_t word;
+
+#if BVM_BIG_ENDIAN_ENABLE
+	int i;
+
+	word = 0;
+	for (i = sizeof(inflate_word_t); i-- > 0;)
+		word = (word << 8) | p[i];
+#else
+	memcpy(&word, p, sizeof(inflate_word_t));
+#endif
+
+	return word;
+}
+
+/**
+ * The table entry for a symbol.
+ *
+ * @param kind the kind of table - one of INFLATE_KIND_XXX
+ * @param sym the symbol
+ * @param bits the code bits to drop for the entry
+ */
+static bvm_uint32_t inflate_entry(int kind, unsigned int sym, unsigned int bits) {
+
+	switch (kind) {
+		case INFLATE_KIND_LITLEN:
+			if (sym < 256)
+				return INFLATE_ENTRY(sym, INFLATE_OP_LITERAL, bits);
+			if (sym == 256)
+				return INFLATE_ENTRY(0, INFLATE_OP_END, bits);
+			if (sym <= 285)
+				return INFLATE_ENTRY(inflate_length_base[sym - 257], inflate_length_extra[sym - 257], bits);
+			break;
+		case INFLATE_KIND_DIST:
+			if (sym < 30)
+				return INFLATE_ENTRY(inflate_dist_base[sym], inflate_dist_extra[sym], bits);
+			break;
+		default:
+			return INFLATE_ENTRY(sym, 0, bits);
+	}
+
+	return INFLATE_ENTRY(0, INFLATE_OP_INVALID, bits);
+}
+
+/**
+ * Build a decode table from the code lengths of a canonical Huffman code.  A code must be complete, except that
+ * a code with a single symbol of length 1, or no symbols at all, is allowed - as it is for tinf.  Unused table entries
+ * are marked as invalid.
+ *
+ * Entries for codes no longer than the table bits are repeated for each value of the bits after the code.  Longer
+ * codes share a second level table for their first \c table_bits bits, sized to fit the codes under it.
+ *
+ * @param table the table to build
+ * @param table_bits the number of input bits to index the first level of the table by
+ * @param enough the size of \c table
+ * @param lengths the code length of each symbol, zero for unused symbols
+ * @param num the number of symbols
+ * @param kind the kind of table - one of INFLATE_KIND_XXX
+ *
+ * @return #BVM_OK if the table was built, or #BVM_ERR if the code is invalid.
+ */
+static int inflate_build_table(bvm_uint32_t *table, unsigned int table_bits, unsigned int enough,
+							   const bvm_uint8_t *lengths, unsigned int num, int kind) {
+
+	bvm_uint16_t count[INFLATE_MAX_CODE_BITS + 1];
+	bvm_uint16_t offs[INFLATE_MAX_CODE_BITS + 1];
+	bvm_uint16_t sorted[INFLATE_MAX_SYMBOLS];
+	bvm_uint32_t *next;
+	unsigned int i, len, min_len, max_len, num_codes, sym;
+	unsigned int huff, incr, fill, curr, drop, low, mask, used;
+	int left;
+
+	for (len = 0; len <= INFLATE_MAX_CODE_BITS; len++)
+		count[len] = 0;
+
+	for (i = 0; i < num; i++)
+		count[lengths[i]]++;
+
+	/* check the code is not over subscribed, and is complete */
+	left = 1;
+	num_codes = 0;
+	min_len = 0;
+	max_len = 0;
+	for (len = 1; len <= INFLATE_MAX_CODE_BITS; len++) {
+		left = (left << 1) - count[len];
+		if (left < 0)
+			return BVM_ERR;
+		if (count[len] > 0) {
+			if (min_len == 0) min_len = len;
+			max_len = len;
+		}
+		num_codes += count[len];
+	}
+
+	if ( (num_codes > 1 && left > 0) || (num_codes == 1 && count[1] != 1) || (min_len > table_bits) )
+		return BVM_ERR;
+
+	for (i = 0; i < (1U << table_bits); i++)
+		table[i] = INFLATE_ENTRY(0, INFLATE_OP_INVALID, 1);
+
+	if (num_codes == 0)
+		return BVM_OK;
+
+	/* sort the symbols by code length, and by symbol within a length - the order of their codes */
+	offs[1] = 0;
+	for (len = 1; len < INFLATE_MAX_CODE_BITS; len++)
+		offs[len + 1] = offs[len] + count[len];
+
+	for (i = 0; i < num; i++)
+		if (lengths[i] != 0)
+			sorted[offs[lengths[i]]++] = i;
+
+	/* Fill the table in code order.  'huff' is the current code with its bits reversed - the order they are read
+	 * from the input.  'next' is the (sub) table being filled, with 'curr' index bits, where the first 'drop' bits of
+	 * the code have already been used by the first level. */
+	huff = 0;
+	sym = 0;
+	len = min_len;
+	next = table;
+	curr = table_bits;
+	drop = 0;
+	low = (unsigned int) -1;
+	mask = (1U << table_bits) - 1;
+	used = 1U << table_bits;
+
+	for (;;) {
+
+		bvm_uint32_t entry = inflate_entry(kind, sorted[sym], len - drop);
+
+		/* repeat the entry for each value of the bits after the code */
+		incr = 1U << (len - drop);
+		fill = 1U << curr;
+		do {
+			fill -= incr;
+			next[(huff >> drop) + fill] = entry;
+		} while (fill != 0);
+
+		/* increment the reversed code */
+		incr = 1U << (len - 1);
+		while (huff & incr)
+			incr >>= 1;
+		huff = (incr != 0) ? (huff & (incr - 1)) + incr : 0;
+
+		/* next symbol */
+		sym++;
+		if (--count[len] == 0) {
+			if (len == max_len) break;
+			len = lengths[sorted[sym]];
+		}
+
+		/* a code longer than the first level bits with a new first level prefix starts a new second level table */
+		if ( (len > table_bits) && ((huff & mask) != low) ) {
+
+			if (drop == 0) drop = table_bits;
+
+			next += 1U << curr;
+
+			/* size the table to hold the codes under this prefix */
+			curr = len - drop;
+			left = 1 << curr;
+			while (curr + drop < max_len) {
+				left -= count[curr + drop];
+				if (left <= 0) break;
+				curr++;
+				left <<= 1;
+			}
+
+			used += 1U << curr;
+			if (used > enough)
+				return BVM_ERR;
+
+			low = huff & mask;
+			table[low] = INFLATE_ENTRY(next - table, INFLATE_OP_SUB | curr, table_bits);
+		}
+	}
+
+	return BVM_OK;
+}
+
+/**
+ * Build the tables of the fixed codes.
+ */
+static void inflate_build_fixed_tables(bvm_inflate_work_t *work) {
+
+	bvm_uint8_t lengths[INFLATE_MAX_SYMBOLS];
+	int i;
+
+	for (i = 0; i < 144; i++) lengths[i] = 8;
+	for (; i < 256; i++) lengths[i] = 9;
+	for (; i < 280; i++) lengths[i] = 7;
+	for (; i < 288; i++) lengths[i] = 8;
+
+	inflate_build_table(work->fixed_tables.litlen, INFLATE_LITLEN_BITS, INFLATE_LITLEN_ENOUGH, lengths, 288, INFLATE_KIND_LITLEN);
+
+	for (i = 0; i < 32; i++) lengths[i] = 5;
+
+	inflate_build_table(work->fixed_tables.dist, INFLATE_DIST_BITS, INFLATE_DIST_ENOUGH, lengths, 32, INFLATE_KIND_DIST);
+
+	work->fixed_built = BVM_TRUE;
+}
+
+/**
+ * Read the code lengths of a dynamic block and build its tables into the dynamic tables of \c work.
+ *
+ * @return #BVM_OK if the tables were built, or #BVM_ERR if the code lengths are invalid.
+ */
+static int inflate_read_dynamic_tables(inflate_stream_t *s, bvm_inflate_work_t *work) {
+
+	/* order of the code length code lengths */
+	static const bvm_uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+	bvm_uint32_t precode[1 << INFLATE_PRECODE_BITS];
+	bvm_uint8_t lengths[286 + 30];
+	unsigned int hlit, hdist, hclen, i, num, length, sym;
+	bvm_uint32_t e;
+
+	INFLATE_NEED(*s, 14);
+	hlit = INFLATE_BITS(*s, 5) + 257;
+	INFLATE_DROP(*s, 5);
+	hdist = INFLATE_BITS(*s, 5) + 1;
+	INFLATE_DROP(*s, 5);
+	hclen = INFLATE_BITS(*s, 4) + 4;
+	INFLATE_DROP(*s, 4);
+
+	if (hlit > 286 || hdist > 30)
+		return BVM_ERR;
+
+	for (i = 0; i < 19; i++)
+		lengths[i] = 0;
+
+	for (i = 0; i < hclen; i++) {
+		INFLATE_NEED(*s, 3);
+		lengths[order[i]] = INFLATE_BITS(*s, 3);
+		INFLATE_DROP(*s, 3);
+	}
+
+	if (inflate_build_table(precode, INFLATE_PRECODE_BITS, 1 << INFLATE_PRECODE_BITS, lengths, 19, INFLATE_KIND_PRECODE) != BVM_OK)
+		return BVM_ERR;
+
+	for (num = 0; num < hlit + hdist; ) {
+
+		/* a code length code and its extra bits */
+		INFLATE_NEED(*s, INFLATE_PRECODE_BITS + 7);
+		INFLATE_DECODE(*s, precode, INFLATE_PRECODE_BITS, e);
+
+		if (INFLATE_ENTRY_OP(e) & INFLATE_OP_INVALID)
+			return BVM_ERR;
+
+		sym = INFLATE_ENTRY_VALUE(e);
+
+		switch (sym) {
+			case 16:
+				/* copy the previous length 3-6 times */
+				if (num == 0)
+					return BVM_ERR;
+				sym = lengths[num - 1];
+				length = 3 + INFLATE_BITS(*s, 2);
+				INFLATE_DROP(*s, 2);
+				break;
+			case 17:
+				/* a zero length 3-10 times */
+				sym = 0;
+				length = 3 + INFLATE_BITS(*s, 3);
+				INFLATE_DROP(*s, 3);
+				break;
+			case 18:
+				/* a zero length 11-138 times */
+				sym = 0;
+				length = 11 + INFLATE_BITS(*s, 7);
+				INFLATE_DROP(*s, 7);
+				break;
+			default:
+				length = 1;
+				break;
+		}
+
+		if (length > hlit + hdist - num)
+			return BVM_ERR;
+
+		while (length--)
+			lengths[num++] = (bvm_uint8_t) sym;
+	}
+
+	/* there must be an end of block code */
+	if (lengths[256] == 0)
+		return BVM_ERR;
+
+	if (inflate_build_table(work->dynamic_tables.litlen, INFLATE_LITLEN_BITS, INFLATE_LITLEN_ENOUGH, lengths, hlit, INFLATE_KIND_LITLEN) != BVM_OK)
+		return BVM_ERR;
+
+	return inflate_build_table(work->dynamic_tables.dist, INFLATE_DIST_BITS, INFLATE_DIST_ENOUGH, lengths + hlit, hdist, INFLATE_KIND_DIST);
+}
+
+/**
+ * Inflate the data of a Huffman coded block.  The stream state is worked on in a local copy so it can be kept in
+ * registers - the output pointer could otherwise alias it.
+ *
+ * @return #BVM_OK at the end of the block, or #BVM_ERR if the data is invalid.
+ */
+static int inflate_block(inflate_stream_t *stream, const bvm_uint32_t *litlen, const bvm_uint32_t *dist) {
+
+	inflate_stream_t s = *stream;
+	bvm_uint32_t e;
+	unsigned int op, length, offs;
+	int result;
+
+	for (;;) {
+
+		INFLATE_NEED(s, INFLATE_MAX_CODE_BITS);
+		INFLATE_DECODE(s, litlen, INFLATE_LITLEN_BITS, e);
+
+		if (INFLATE_OVERRUN(s)) {
+			result = BVM_ERR;
+			break;
+		}
+
+		op = INFLATE_ENTRY_OP(e);
+
+		if (op & INFLATE_OP_LITERAL) {
+			if (s.out == s.out_end) {
+				result = BVM_ERR;
+				break;
+			}
+			*s.out++ = (bvm_uint8_t) INFLATE_ENTRY_VALUE(e);
+			continue;
+		}
+
+		if (op & (INFLATE_OP_END | INFLATE_OP_INVALID)) {
+			result = (op & INFLATE_OP_END) ? BVM_OK : BVM_ERR;
+			break;
+		}
+
+		/* a length and distance pair */
+		INFLATE_NEED(s, 5);
+		length = INFLATE_ENTRY_VALUE(e) + INFLATE_BITS(s, op);
+		INFLATE_DROP(s, op);
+
+		INFLATE_NEED(s, INFLATE_MAX_CODE_BITS);
+		INFLATE_DECODE(s, dist, INFLATE_DIST_BITS, e);
+
+		op = INFLATE_ENTRY_OP(e);
+		if (op & INFLATE_OP_INVALID) {
+			result = BVM_ERR;
+			break;
+		}
+
+		INFLATE_NEED(s, 13);
+		offs = INFLATE_ENTRY_VALUE(e) + INFLATE_BITS(s, op);
+		INFLATE_DROP(s, op);
+
+		if ( (offs > (unsigned int) (s.out - s.out_start)) || (length > (unsigned int) (s.out_end - s.out)) ) {
+			result = BVM_ERR;
+			break;
+		}
+
+		/* copy the match */
+		{
+			const bvm_uint8_t *from = s.out - offs;
+
+			if ( (offs >= sizeof(inflate_word_t)) && ((size_t) (s.out_end - s.out) >= length + sizeof(inflate_word_t)) ) {
+				/* a word at a time - may copy up to a word past the end of the match, but there is room for it and
+				 * it does not overlap the source */
+				bvm_uint8_t *end = s.out + length;
+				do {
+					memcpy(s.out, from, sizeof(inflate_word_t));
+					s.out += sizeof(inflate_word_t);
+					from += sizeof(inflate_word_t);
+				} while (s.out < end);
+				s.out = end;
+			} else if (offs == 1) {
+				memset(s.out, *from, length);
+				s.out += length;
+			} else {
+				while (length--)
+					*s.out++ = *from++;
+			}
+		}
+	}
+
+	*stream = s;
+
+	return result;
+}
+
+/**
+ * Inflate a stored (not compressed) block.
+ *
+ * @return #BVM_OK if the block was copied, or #BVM_ERR if the data is invalid.
+ */
+static int inflate_stored(inflate_stream_t *s) {
+
+	unsigned int length, bytes;
+
+	/* go to the next byte boundary, and give the whole bytes still in the bit buffer back to the input */
+	INFLATE_DROP(*s, s->bitcount & 7);
+	bytes = s->bitcount >> 3;
+
+	if (bytes < (unsigned int) s->pad)
+		return BVM_ERR;
+
+	s->in -= bytes - s->pad;
+	s->bitbuf = 0;
+	s->bitcount = 0;
+	s->pad = 0;
+
+	if (s->in_end - s->in < 4)
+		return BVM_ERR;
+
+	/* the length, and its ones complement */
+	length = s->in[0] | (s->in[1] << 8);
+	if (length != (~(s->in[2] | (s->in[3] << 8)) & 0xFFFF))
+		return BVM_ERR;
+
+	s->in += 4;
+
+	if ( (length > (unsigned int) (s->in_end - s->in)) || (length > (unsigned int) (s->out_end - s->out)) )
+		return BVM_ERR;
+
+	memcpy(s->out, s->in, length);
+	s->in += length;
+	s->out += length;
+
+	return BVM_OK;
+}
+
+/**
+ * Inflate deflated data building its decode tables in a given #bvm_inflate_work_t - OS threads that inflate at the
+ * same time each use tables of their own.
+ *
+ * @param work the tables to build
+ * @param dest where to put the inflated data
+ * @param dest_len on entry, the size of \c dest.  On success, set to the size of the inflated data.
+ * @param source the deflated data
+ * @param source_len the size of the deflated data
+ *
+ * @return #BVM_OK on success, or #BVM_ERR if the deflated data is invalid or does not fit in \c dest.
+ */
+int bvm_inflate_with(bvm_inflate_work_t *work, bvm_uint8_t *dest, bvm_uint32_t *dest_len, const bvm_uint8_t *source,
+					 bvm_uint32_t source_len) {
+
+	inflate_stream_t s;
+	unsigned int final, type;
+	int result;
+
+	s.in = source;
+	s.in_end = source + source_len;
+	s.bitbuf = 0;
+	s.bitcount = 0;
+	s.pad = 0;
+	s.out_start = dest;
+	s.out = dest;
+	s.out_end = dest + *dest_len;
+
+	do {
+
+		/* the block header */
+		INFLATE_NEED(s, 3);
+		final = INFLATE_BITS(s, 1);
+		INFLATE_DROP(s, 1);
+		type = INFLATE_BITS(s, 2);
+		INFLATE_DROP(s, 2);
+
+		switch (type) {
+			case 0:
+				result = inflate_stored(&s);
+				break;
+			case 1:
+				if (!work->fixed_built) inflate_build_fixed_tables(work);
+				result = inflate_block(&s, work->fixed_tables.litlen, work->fixed_tables.dist);
+				break;
+			case 2:
+				result = inflate_read_dynamic_tables(&s, work);
+				if (result == BVM_OK)
+					result = inflate_block(&s, work->dynamic_tables.litlen, work->dynamic_tables.dist);
+				break;
+			default:
+				result = BVM_ERR;
+				break;
+		}
+
+		if (result != BVM_OK)
+			return result;
+
+	} while (!final);
+
+	if (INFLATE_OVERRUN(s))
+		return BVM_ERR;
+
+	*dest_len = (bvm_uint32_t) (s.out - s.out_start);
+
+	return BVM_OK;
+}
+
+/**
+ * Inflate deflated data.
+ *
+ * @param dest where to put the inflated data
+ * @param dest_len on entry, the size of \c dest.  On success, set to the size of the inflated data.
+ * @param source the deflated data
+ * @param source_len the size of the deflated data
+ *
+ * @return #BVM_OK on success, or #BVM_ERR if the deflated data is invalid or does not fit in \c dest.
+ */
+int bvm_inflate(bvm_uint8_t *dest, bvm_uint32_t *dest_len, const bvm_uint8_t *source, bvm_uint32_t source_len) {
+	return bvm_inflate_with(&inflate_work, dest, dest_len, source, source_len);
+}
+
+#if BVM_CLAZZ_PREFETCH_ENABLE
+
+/**
+ * Create tables for #bvm_inflate_with, in memory from #bvm_pd_memory_alloc.  They are given back with
+ * #bvm_pd_memory_free.
+ *
+ * @return the tables, or \c NULL if there is no memory for them.
+ */
+bvm_inflate_work_t *bvm_inflate_work_create() {
+
+	bvm_inflate_work_t *work = bvm_pd_memory_alloc(sizeof(bvm_inflate_work_t));
+
+	if (work != NULL) work->fixed_built = BVM_FALSE;
+
+	return work;
+}
+
+#endif
+
+#endif
@@ -17,7 +17,6 @@
 *******************************************************************/
 
 #include "../h/bvm.h"
-#include "../thirdparty/xp/xp.h"
 
 /**
 
@@ -29,241 +28,232 @@
   @since 0.0.10
 
 
- Software implementation of Java 'long' arithmetic.  Uses the "Arbitrary Precision" (XP) code from
- "C Interfaces and Implementations: Techniques for Creating Reusable Software".  I'm sure all this can
- be done a lot more efficiently and with much less hassle and code.
+ Software implementation of Java 'long' arithmetic for platforms without a native 64 bit integer.  A #bvm_int64_t is
+ a pair of unsigned 32 bit words, and everything here is done a word at a time with 32 bit operations only - the C
+ compiler of such a platform may well not have anything wider.  Because the words are named fields, none of it
+ depends on the platform's endianness.
 
- But for now this is it.
+ Addition, subtraction and comparison are macros in int64.h.  The rest are functions here:
 
- The XP code is all little-endian and only works on positive numbers.  Hence there is a bit
- of gymnastics in here for negatives and positives and endianness.
+ @li multiplication is done modulo 2^64, which is the same for signed and unsigned values, so a negative needs no
+ special handling.  The low words are multiplied to a full 64 bits (as four 16 by 16 bit multiplies), and the two
+ cross products only ever contribute to the high word, so only their low 32 bits are needed.
+ @li division is of the magnitudes, with the signs put back after.  When both high words are zero - most amounts
+ and counters in practice - it is a single 32 bit divide.  A 32 bit divisor divides the high word, then what is left
+ of it with the low word by the long division of Knuth's Algorithm D (\c divlu in Hacker's Delight), which finds the
+ quotient as two 16 bit digits.  A larger divisor leaves a quotient of 32 bits at most - it is estimated in one such
+ division from the top 32 bits of the divisor and corrected by at most one (\c divlu64 in Hacker's Delight).
+ @li shifts are a couple of 32 bit shifts.
+
+ Earlier versions used the XP extended precision library for multiplication, division and shifts.  It works a byte at
+ a time and is still in the tree, but is no longer used for longs.
 
  */
 
 #if (!BVM_NATIVE_INT64_ENABLE)
 
-
-/* number of bytes in a java 'long' */
-#define BVM_INT64_BYTES 8
-
-#if (BVM_BIG_ENDIAN_ENABLE)
-/**
- * Toggles the 'endianness' of a bvm_int64_t.
- */
-static void toggle_endian64(char *p_out, char *p_in) {
-  p_out[0] = p_in[7];
-  p_out[1] = p_in[6];
-  p_out[2] = p_in[5];
-  p_out[3] = p_in[4];
-
-  p_out[4] = p_in[3];
-  p_out[5] = p_in[2];
-  p_out[5] = p_in[1];
-  p_out[7] = p_in[0];
-}
-#endif
-
 /**
- * Multiply two bvm_int64_t integers together.
+ * Multiply two unsigned 32 bit integers to a full 64 bit result, using only 32 bit arithmetic.
  *
- * @param x the first bvm_int64_t to multiply
- * @param y the second bvm_int64_t to multiply
+ * @param x the first multiplicand
+ * @param y the second multiplicand
  *
- * @return the multiplication of x and y.
+ * @return the 64 bit product.
  */
-static bvm_int64_t int64_mul(bvm_int64_t x, bvm_int64_t y) {
-
-	/* a temporary scratch area for the multiplication.  The XP lib requires a space at least twice
-	 * as large as the largest of x & y.  Considering that both x & y are 64 bits, we allocation two
-	 * longs - 128 bits */
-   bvm_int64_t temp[] = { {0,0} , {0,0} };
-   bvm_int64_t result = {0,0};
-   bvm_bool_t x_neg, y_neg;
-   bvm_int64_t local_x;
-   bvm_int64_t local_y;
-
-   /* copy the arguments */
-#if (!BVM_BIG_ENDIAN_ENABLE)
-   local_x = x;
-   local_y = y;
-#else
-   /* on big endian systems, convert longs to little endian for XP lib */
-   toggle_endian64((char *) &local_x, (char *) &x);
-   toggle_endian64((char *) &local_y, (char *) &y);
-#endif
+static bvm_int64_t int64_mul32(bvm_uint32_t x, bvm_uint32_t y) {
 
-   /* the XP lib only works on positive numbers.  Remember the sign of x & y and make them positive
-    * if need be */
-   x_neg = BVM_INT64_zero_lt(x);
-   y_neg = BVM_INT64_zero_lt(y);
+	bvm_int64_t result;
 
-   /* turn arguments into positives - XP only works with positive values */
-   if (x_neg) BVM_INT64_negate(local_x);
-   if (y_neg) BVM_INT64_negate(local_y);
+	bvm_uint32_t x_low = x & 0xFFFF, x_high = x >> 16;
+	bvm_uint32_t y_low = y & 0xFFFF, y_high = y >> 16;
 
-   /* multiply x & y using 'temp' as the scratch area. */
-   bvm_XP_mul( (unsigned char *) &temp, BVM_INT64_BYTES , (unsigned char *) &local_x, BVM_INT64_BYTES , (unsigned char *) &local_y) ;
+	/* the four 16 by 16 bit partial products - none can overflow 32 bits */
+	bvm_uint32_t low_low   = x_low  * y_low;
+	bvm_uint32_t high_low  = x_high * y_low;
+	bvm_uint32_t low_high  = x_low  * y_high;
+	bvm_uint32_t high_high = x_high * y_high;
 
-   /* the result will come back from the XP lib as the first 64 bits of the temp area */
-   result = temp[0];
+	/* the middle 32 bits, and what they carry into the high word.  Cannot overflow: at most 3 * 0xFFFF */
+	bvm_uint32_t middle = (low_low >> 16) + (high_low & 0xFFFF) + (low_high & 0xFFFF);
 
-   /* if the signs of x & y are not equal, negate the result */
-   if (x_neg^y_neg) BVM_INT64_negate(result);
+	result.low  = (middle << 16) | (low_low & 0xFFFF);
+	result.high = high_high + (high_low >> 16) + (low_high >> 16) + (middle >> 16);
 
-#if (!BVM_BIG_ENDIAN_ENABLE)
-   return result;
-#else
-   {
-	   bvm_int64_t be_result;
-	   /* on big endian systems, convert the result back to big endian */
-	   toggle_endian64((char *) &be_result, (char *) &result);
-
-	   return be_result;
-   }
-#endif
+	return result;
 }
 
 /**
+ * Count the leading zero bits of a non-zero 32 bit value.
  *
- * Divide two bvm_int64_t integers and return either the result or the remainder.
- *
- * @param x the divisor
- * @param y the dividend
- * @param ret_rem specifies whether to return the result or the remainder
- *
- * @return if \c ret_rem is #BVM_FALSE return the result of the divide operation.  If \c ret_rem
- * is \c #BVM_TRUE return the remainder of the divide operation - equivalent to a 'mod' operation.
+ * @param word the value, which must not be zero
  *
+ * @return the number of zero bits above its highest set bit, from 0 to 31.
  */
-static bvm_int64_t int64_div(bvm_int64_t x, bvm_int64_t y, bvm_bool_t remainder_only) {
-
-   char tmp[18];
-   bvm_int64_t result = {0,0};
-   bvm_int64_t remainder = {0,0};
-   bvm_bool_t x_neg, y_neg;
-   bvm_int64_t divisor;
-   bvm_int64_t dividend;
-
-   /* copy the arguments */
-#if (!BVM_BIG_ENDIAN_ENABLE)
-   divisor = x;
-   dividend = y;
-#else
-   /* on big endian systems, convert longs to little endian for XP lib */
-   toggle_endian64((char *) &divisor, (char *) &x);
-   toggle_endian64((char *) &dividend, (char *) &y);
-#endif
-
-   /* the XP lib only works on positive numbers.  Remember the sign of x & y and make them positive
-    * if need be */
-   x_neg = BVM_INT64_zero_lt(x);
-   y_neg = BVM_INT64_zero_lt(y);
-
-   /* turn arguments into positives - XP only works with positive values */
-   if (x_neg) BVM_INT64_negate(divisor);
-   if (y_neg) BVM_INT64_negate(dividend);
-
-   /* perform the divide operation */
-   bvm_XP_div(8, (unsigned char *) &result, (unsigned char *) &divisor, BVM_INT64_BYTES, (unsigned char *) &dividend, (unsigned char *) &remainder, (unsigned char *) tmp ) ;
-
-   /* return the remainder or the divide result depending on ret_rem - ensuring the
-    * sign is correct.  */
-   if (remainder_only) {
-	   if (x_neg) BVM_INT64_negate(remainder);
-   } else {
-	   if (x_neg^y_neg) BVM_INT64_negate(result);
-   }
+static int int64_leading_zeros(bvm_uint32_t word) {
 
-#if (!BVM_BIG_ENDIAN_ENABLE)
-   return (remainder_only) ? remainder : result;
-#else
-   {
-	   bvm_int64_t be_result;
-	   bvm_int64_t le_result = (remainder_only) ? remainder : result;
+	int count = 0;
 
-	   /* on big endian systems, convert the result back to big endian */
-	   toggle_endian64((char *) &be_result, (char *) &le_result);
+	if ((word & 0xFFFF0000) == 0) { count += 16; word <<= 16; }
+	if ((word & 0xFF000000) == 0) { count += 8;  word <<= 8;  }
+	if ((word & 0xF0000000) == 0) { count += 4;  word <<= 4;  }
+	if ((word & 0xC0000000) == 0) { count += 2;  word <<= 2;  }
+	if ((word & 0x80000000) == 0) { count += 1; }
 
-	   return be_result;
-   }
-#endif
+	return count;
 }
 
 /**
- * Long bitwise left shift.
+ * Divide a 64 bit unsigned value given as two words by a 32 bit one, using only 32 bit arithmetic.  The divisor is
+ * shifted up until its top bit is set, and the quotient found as two 16 bit digits, each estimated from the top
+ * half of the divisor and corrected (at most twice).  This is the long division of Knuth's Algorithm D, as given in
+ * Hacker's Delight (\c divlu).
  *
- * @param x the bvm_int64_t integer to perform the operation on
- * @param count the number of positions to shift
- * @param the value to fill at the LSB.
+ * @param high the high word of the dividend, which must be less than the divisor so the quotient fits 32 bits
+ * @param low the low word of the dividend
+ * @param divisor the divisor, which must not be zero
+ * @param remainder the remainder is returned here
  *
- * @return the left shifted bvm_int64_t.
+ * @return the 32 bit quotient.
  */
-static bvm_int64_t int64_shl(bvm_int64_t x, int count, int fill) {
+static bvm_uint32_t int64_divlu(bvm_uint32_t high, bvm_uint32_t low, bvm_uint32_t divisor, bvm_uint32_t *remainder) {
 
-   bvm_int64_t result = {0,0};
-   bvm_int64_t local_x;
+	bvm_uint32_t divisor_high, divisor_low, low_high, low_low, top, middle, q_high, q_low, rhat;
+	int shift = int64_leading_zeros(divisor);
 
-#if (!BVM_BIG_ENDIAN_ENABLE)
-   local_x = x;
-#else
-   /* on big endian systems, convert longs to little endian for XP lib */
-   toggle_endian64((char *) &local_x, (char *) &x);
-#endif
+	/* normalise, so the top bit of the divisor is set.  Shifting by 32 is undefined, hence the special case */
+	divisor <<= shift;
+	divisor_high = divisor >> 16;
+	divisor_low = divisor & 0xFFFF;
 
-   bvm_XP_lshift(BVM_INT64_BYTES, (unsigned char *) &result, BVM_INT64_BYTES, (unsigned char *) &local_x, count, fill);
+	top = (shift == 0) ? high : ((high << shift) | (low >> (32 - shift)));
+	low <<= shift;
+	low_high = low >> 16;
+	low_low = low & 0xFFFF;
 
-#if (!BVM_BIG_ENDIAN_ENABLE)
-   return result;
-#else
-   {
-	   bvm_int64_t be_result;
-	   /* on big endian systems, convert the result back to big endian */
-	   toggle_endian64((char *) &be_result, (char *) &result);
+	/* the first digit of the quotient */
+	q_high = top / divisor_high;
+	rhat = top - (q_high * divisor_high);
 
-	   return be_result;
-   }
-#endif
+	while ( (q_high > 0xFFFF) || ((q_high * divisor_low) > ((rhat << 16) + low_high)) ) {
+		q_high--;
+		rhat += divisor_high;
+		if (rhat > 0xFFFF) break;
+	}
+
+	/* and the second, from what is left */
+	middle = (top << 16) + low_high - (q_high * divisor);
+	q_low = middle / divisor_high;
+	rhat = middle - (q_low * divisor_high);
+
+	while ( (q_low > 0xFFFF) || ((q_low * divisor_low) > ((rhat << 16) + low_low)) ) {
+		q_low--;
+		rhat += divisor_high;
+		if (rhat > 0xFFFF) break;
+	}
+
+	*remainder = ((middle << 16) + low_low - (q_low * divisor)) >> shift;
+
+	return (q_high << 16) | q_low;
+}
+
+/**
+ * Divide one unsigned 64 bit value by another, giving the quotient and the remainder.
+ *
+ * @param dividend the dividend
+ * @param divisor the divisor, which must not be zero
+ * @param quotient the quotient is returned here
+ * @param remainder the remainder is returned here
+ */
+static void int64_udivmod(bvm_int64_t dividend, bvm_int64_t divisor, bvm_int64_t *quotient, bvm_int64_t *remainder) {
+
+	bvm_int64_t product;
+	bvm_int64_t top;
+	bvm_uint32_t q, unused;
+	int shift;
+
+	/* both fit in 32 bits - just divide */
+	if ((dividend.high | divisor.high) == 0) {
+		quotient->high = 0;
+		quotient->low = dividend.low / divisor.low;
+		remainder->high = 0;
+		remainder->low = dividend.low % divisor.low;
+		return;
+	}
+
+	/* a 32 bit divisor - divide the high word, then what is left of it with the low word */
+	if (divisor.high == 0) {
+		bvm_uint32_t rest = dividend.high;
+		quotient->high = 0;
+		if (rest >= divisor.low) {
+			quotient->high = rest / divisor.low;
+			rest %= divisor.low;
+		}
+		quotient->low = int64_divlu(rest, dividend.low, divisor.low, &remainder->low);
+		remainder->high = 0;
+		return;
+	}
+
+	/* a larger divisor, so the quotient fits 32 bits.  Estimate it from the dividend halved, divided by the top 32 bits
+	 * of the divisor.  The estimate is the quotient or one too many, after the one taken off (Hacker's Delight
+	 * divlu64) */
+	shift = int64_leading_zeros(divisor.high);
+	top = BVM_INT64_ushr(dividend, 1);
+	q = int64_divlu(top.high, top.low, BVM_INT64_shl(divisor, shift).high, &unused);
+
+	/* undo the normalisation - (q << shift) >> 31, without needing 64 bits */
+	q >>= (31 - shift);
+	if (q != 0) q--;
+
+	/* remainder = dividend - q * divisor, and one more if that leaves a whole divisor */
+	product = int64_mul32(q, divisor.low);
+	product.high += q * divisor.high;
+	*remainder = dividend;
+	BVM_INT64_decrease(*remainder, product);
+
+	if ( (remainder->high > divisor.high) || ((remainder->high == divisor.high) && (remainder->low >= divisor.low)) ) {
+		BVM_INT64_decrease(*remainder, divisor);
+		q++;
+	}
+
+	quotient->high = 0;
+	quotient->low = q;
 }
 
 /**
- * Long bitwise right shift.  Can be used for both a signed right shift '>>' and
- * an unsigned right shift '>>>' operations depending on how the \c fill param is used.
+ * Divide two bvm_int64_t integers and return either the quotient or the remainder.  Java division rounds towards
+ * zero, and the remainder takes the sign of the dividend.
  *
- * @param x the bvm_int64_t integer to perform the operation on
- * @param count the number of positions to shift
- * @param the value to fill at the MSB.
+ * @param dividend the dividend
+ * @param divisor the divisor, which must not be zero
+ * @param remainder_only specifies whether to return the quotient or the remainder
  *
- * @return the right shifted bvm_int64_t.
+ * @return if \c remainder_only is #BVM_FALSE return the quotient of the divide.  If it is #BVM_TRUE return the
+ * remainder - equivalent to a 'mod' operation.
  */
-static bvm_int64_t int64_shr(bvm_int64_t x, int count, int fill) {
+static bvm_int64_t int64_div(bvm_int64_t dividend, bvm_int64_t divisor, bvm_bool_t remainder_only) {
 
-   bvm_int64_t result = {0,0};
-   bvm_int64_t local_x;
+	bvm_int64_t quotient;
+	bvm_int64_t remainder;
+	bvm_bool_t dividend_neg = BVM_INT64_zero_lt(dividend);
+	bvm_bool_t divisor_neg = BVM_INT64_zero_lt(divisor);
 
-#if (!BVM_BIG_ENDIAN_ENABLE)
-   local_x = x;
-#else
-   /* on big endian systems, convert longs to little endian for XP lib */
-   toggle_endian64((char *) &local_x, (char *) &x);
-#endif
+	/* divide the magnitudes.  The magnitude of the most negative long is itself, which is right read as unsigned */
+	if (dividend_neg) BVM_INT64_negate(dividend);
+	if (divisor_neg) BVM_INT64_negate(divisor);
 
-   bvm_XP_rshift(BVM_INT64_BYTES, (unsigned char *) &result, BVM_INT64_BYTES, (unsigned char *) &local_x, count, fill);
+	int64_udivmod(dividend, divisor, &quotient, &remainder);
 
-#if (!BVM_BIG_ENDIAN_ENABLE)
-   return result;
-#else
-   {
-	   bvm_int64_t be_result;
-	   /* on big endian systems, convert the result back to big endian */
-	   toggle_endian64((char *) &be_result, (char *) &result);
+	if (remainder_only) {
+		if (dividend_neg) BVM_INT64_negate(remainder);
+		return remainder;
+	}
 
-	   return be_result;
-   }
-#endif
+	if (dividend_neg ^ divisor_neg) BVM_INT64_negate(quotient);
+	return quotient;
 }
 
 /**
- * Multiplies two bvm_int64_t values.
+ * Multiplies two bvm_int64_t values.  The result is the low 64 bits of the product, as Java requires.
  *
  * @param a the first multiplicand
  * @param b the second multiplicand
@@ -271,7 +261,14 @@ static bvm_int64_t int64_shr(bvm_int64_t x, int count, int fill) {
  * @return the result
  */
 bvm_int64_t BVM_INT64_mul(bvm_int64_t a, bvm_int64_t b) {
-	return int64_mul(a,b);
+
+	bvm_int64_t result = int64_mul32(a.low, b.low);
+
+	/* the cross products are shifted up 32 bits, so only their low words count, and the high words product is
+	 * shifted out altogether */
+	result.high += (a.high * b.low) + (a.low * b.high);
+
+	return result;
 }
 
 /**
@@ -283,7 +280,7 @@ bvm_int64_t BVM_INT64_mul(bvm_int64_t a, bvm_int64_t b) {
  * @return the quotient
  */
 bvm_int64_t BVM_INT64_div(bvm_int64_t dividend, bvm_int64_t divisor) {
-	return int64_div(dividend,divisor, BVM_FALSE);
+	return int64_div(dividend, divisor, BVM_FALSE);
 }
 
 /**
@@ -294,20 +291,29 @@ bvm_int64_t BVM_INT64_div(bvm_int64_t dividend, bvm_int64_t divisor) {
  *
  * @return the remainder
  */
-bvm_int64_t BVM_INT64_rem(bvm_int64_t a, bvm_int64_t b) {
-	return int64_div(a,b, BVM_TRUE);
+bvm_int64_t BVM_INT64_rem(bvm_int64_t dividend, bvm_int64_t divisor) {
+	return int64_div(dividend, divisor, BVM_TRUE);
 }
 
 /**
  * Performs a bvm_int64_t left shift inserting zeroes into the LSB.
  *
  * @param a the long to act upon
- * @param count the number of bits to shift
+ * @param count the number of bits to shift, from 0 to 63
  *
  * @return the left shifted long.
  */
 bvm_int64_t BVM_INT64_shl(bvm_int64_t a, int count) {
-	return int64_shl(a, count, 0);
+
+	if (count >= 32) {
+		a.high = a.low << (count - 32);
+		a.low = 0;
+	} else if (count > 0) {
+		a.high = (a.high << count) | (a.low >> (32 - count));
+		a.low <<= count;
+	}
+
+	return a;
 }
 
 /**
@@ -315,24 +321,45 @@ bvm_int64_t BVM_INT64_shl(bvm_int64_t a, int count) {
  * with the sign of the being-shifted long.
  *
  * @param a the long to act upon
- * @param count the number of bits to shift
+ * @param count the number of bits to shift, from 0 to 63
  *
  * @return the right shifted long.
  */
 bvm_int64_t BVM_INT64_shr(bvm_int64_t a, int count) {
-	return int64_shr(a, count, (( bvm_int32_t) a.high < 0));
+
+	/* all ones if negative, otherwise zero */
+	bvm_uint32_t sign = (bvm_uint32_t) 0 - (a.high >> 31);
+
+	if (count >= 32) {
+		a.low = (count == 32) ? a.high : ((a.high >> (count - 32)) | (sign << (64 - count)));
+		a.high = sign;
+	} else if (count > 0) {
+		a.low = (a.low >> count) | (a.high << (32 - count));
+		a.high = (a.high >> count) | (sign << (32 - count));
+	}
+
+	return a;
 }
 
 /**
  * Perform a bvm_int64_t right shift filling the MSB with zeroes.
  *
  * @param a the long to act upon
- * @param count the number of bits to shift
+ * @param count the number of bits to shift, from 0 to 63
  *
  * @return the right shifted long.
  */
 bvm_int64_t BVM_INT64_ushr(bvm_int64_t a, int count) {
-	return int64_shr(a, count, 0);
+
+	if (count >= 32) {
+		a.low = a.high >> (count - 32);
+		a.high = 0;
+	} else if (count > 0) {
+		a.low = (a.low >> count) | (a.high << (32 - count));
+		a.high >>= count;
+	}
+
+	return a;
 }
 
 #endif
@@ -374,17 +401,30 @@ bvm_uint64_t uint64Pack(bvm_uint32_t high, bvm_uint32_t low) {
 }
 
 bvm_int64_t BVM_INT64_from_cells(bvm_cell_t *cell) {
+#if (!BVM_NATIVE_INT64_ENABLE)
+    // the words are fields, so just copy them in
+    bvm_int64_t value;
+    value.high = (bvm_uint32_t) cell->int_value;
+    value.low  = (bvm_uint32_t) (cell+1)->int_value;
+    return value;
+#else
     // get the values of the two adjacent cells as uint32 and pack them into a 64.
     bvm_uint32_t high = (bvm_uint32_t) cell->int_value;
     bvm_uint32_t low  = (bvm_uint32_t) (cell+1)->int_value;
     return (bvm_int64_t) uint64Pack(high, low);
+#endif
 }
 
 void BVM_INT64_to_cells(bvm_cell_t *cell, bvm_int64_t value) {
+#if (!BVM_NATIVE_INT64_ENABLE)
+    cell->int_value = (bvm_native_long_t) value.high;
+    (cell+1)->int_value = (bvm_native_long_t) value.low;
+#else
     bvm_uint64_hilo_t p = uint64Unpack( (bvm_uint64_t) value);
     // set the values of the two adjacent cells
     cell->int_value = (bvm_native_long_t) p.high;
     (cell+1)->int_value = (bvm_native_long_t) p.low;
+#endif
 }
 
 //gmc_int64_t get64(bvm_int64_t l) {
@@ -0,0 +1,1247 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#include "../h/bvm.h"
+
+/**
+
+ @file
+
+ Register based internal code.
+
+ @section ir-ov Overview
+
+ With #BVM_EXEC_REGISTER_IR_ENABLE the bytecode of a method is translated, the first time each part of it is run,
+ into three-address register instructions that a second, simpler interpreter loop runs.  The registers are the cells
+ of the frame - the locals, and the cells of the operand stack above them - so the register code works on exactly the
+ same frame as the interpreter and there is no stack pointer to move.  A bytecode sequence such as <code>iload_1
+ iload_2 iadd istore_3</code> becomes a single \c ADD of local 3 from locals 1 and 2.  Field offsets and array element
+ sizes are worked out as the code is translated, so the register instructions carry them directly.
+
+ The bytecode stays the canonical form of the method.  The register code is only ever run with the frame exactly as
+ the interpreter would have it at some bytecode offset, and it always stops, back to the interpreter, at a bytecode
+ offset with the frame exactly as the interpreter expects it there.  The way in and out is the same as for JIT
+ compiled code (see jit.c) - the interpreter goes into the register code at the start of a method, at the target of a
+ backwards branch, on return to the method from a call and when a thread switch resumes the method, and carries on
+ from wherever the register code stops.  Stack traces, exception handling, the debugger and the GC see only bytecode
+ offsets.
+
+ @section ir-tr Translation
+
+ Translation goes through the bytecode in order from the offset the interpreter first goes in at, keeping track of
+ what each operand stack cell would hold.  Loads and constants are not copied to the stack at all - the stack cell
+ just records the local or the constant - and only when a value must really be in its stack cell (at a branch, at a
+ store, at a branch target or before a bytecode the register code does not do) is it moved there.  The result of an
+ operation is put straight into its stack cell, or straight into a local if the next bytecode stores it.
+
+ An instruction that would throw - a \c null reference, an array index out of bounds, a zero divisor - stops before
+ doing anything, at a bytecode offset from which the interpreter can run again and throw the exception itself.  That
+ offset is the last at which the frame was exactly as the interpreter would have it, and the stops are arranged so
+ nothing that changes the frame below that point is done before such an instruction.  Stopping there means the
+ interpreter re-runs a few loads and operations, which are free of effects, and then throws in the usual way.
+
+ Translation stops at anything not done - invocations and returns, longs and floats arithmetic, allocation, statics,
+ monitors, \c athrow, switches - with an instruction to stop.  A field access that has not yet been resolved by the
+ interpreter stops with an instruction that translates again from there when it is next run, so the access is done
+ by the register code once the interpreter has resolved it.  A branch to an offset that has not been translated yet is
+ translated when it is first taken.
+
+ Each branch back to an instruction earlier in the register code looks at the thread timeslice counter (or with
+ #BVM_THREAD_TIMER_PREEMPTION_ENABLE the switch request flag) as the interpreter does and stops at the branch target
+ when it is time to switch threads.
+
+ Like compiled code, register code is not run while a debugger session is open.
+
+ Register code is allocated from the platform, not the heap, and is freed with the clazz of its method.
+
+ @author Greg McCreath
+ @since 0.0.10
+
+*/
+
+#if BVM_EXEC_REGISTER_IR_ENABLE
+
+/* register operations */
+#define IR_EXIT			0	/* stop at pc_index */
+#define IR_TRANSLATE	1	/* translate from pc_index, then go there */
+#define IR_MOV			2	/* a = b */
+#define IR_MOVK			3	/* a = k */
+#define IR_ADD			4	/* a = b + c */
+#define IR_SUB			5	/* a = b - c */
+#define IR_MUL			6	/* a = b * c */
+#define IR_AND			7	/* a = b & c */
+#define IR_OR			8	/* a = b | c */
+#define IR_XOR			9	/* a = b ^ c */
+#define IR_SHL			10	/* a = b << c */
+#define IR_SHR			11	/* a = b >> c */
+#define IR_USHR			12	/* a = b >>> c */
+#define IR_ADDK			13	/* a = b + k */
+#define IR_MULK			14	/* a = b * k */
+#define IR_ANDK			15	/* a = b & k */
+#define IR_ORK			16	/* a = b | k */
+#define IR_XORK			17	/* a = b ^ k */
+#define IR_SHLK			18	/* a = b << k */
+#define IR_SHRK			19	/* a = b >> k */
+#define IR_USHRK		20	/* a = b >>> k */
+#define IR_DIV			21	/* a = b / c, stop if c is zero */
+#define IR_REM			22	/* a = b % c, stop if c is zero */
+#define IR_NEG			23	/* a = -b */
+#define IR_I2B			24	/* a = (byte) b */
+#define IR_I2C			25	/* a = (char) b */
+#define IR_I2S			26	/* a = (short) b */
+#define IR_IFEQ			27	/* go to k if b == c */
+#define IR_IFNE			28
+#define IR_IFLT			29
+#define IR_IFGE			30
+#define IR_IFGT			31
+#define IR_IFLE			32
+#define IR_IFEQK		33	/* go to k if b == (short) c */
+#define IR_IFNEK		34
+#define IR_IFLTK		35
+#define IR_IFGEK		36
+#define IR_IFGTK		37
+#define IR_IFLEK		38
+#define IR_IFACMPEQ		39	/* go to k if reference b == reference c */
+#define IR_IFACMPNE		40
+#define IR_IFNULL		41	/* go to k if reference b is null */
+#define IR_IFNONNULL	42
+#define IR_GOTO			43	/* go to k */
+#define IR_IALOAD		44	/* a = b[c], stop if b is null or c out of bounds */
+#define IR_BALOAD		45
+#define IR_CALOAD		46
+#define IR_SALOAD		47
+#define IR_AALOAD		48
+#define IR_IASTORE		49	/* b[c] = a, stop if b is null or c out of bounds */
+#define IR_BASTORE		50
+#define IR_CASTORE		51
+#define IR_SASTORE		52
+#define IR_ARRAYLENGTH	53	/* a = b.length, stop if b is null */
+#define IR_GETFIELD		54	/* a = field k of b, stop if b is null */
+#define IR_GETFIELD2	55	/* a, a+1 = fields k and k+1 of b, stop if b is null */
+#define IR_PUTFIELD		56	/* field k of b = a, stop if b is null */
+#define IR_GETPACKED	57	/* a = packed field of constant k of b, stop if b is null */
+#define IR_PUTPACKED	58	/* packed field of constant k of b = a, stop if b is null */
+
+/* what the translation of one bytecode does next */
+#define IR_NEXT			0	/* goes on to the next bytecode */
+#define IR_ENDS			1	/* does not go on to the next bytecode */
+#define IR_UNSUPPORTED	2	/* is not translated */
+#define IR_UNRESOLVED	3	/* is not translated until the interpreter has resolved it */
+
+/* the most register instructions the translation of one bytecode adds, on top of moving the stack to its cells
+ * twice */
+#define IR_INSNS_MAX	8
+
+/* the int value of a register */
+#define IR_INT(x)	((bvm_int32_t) r[x].int_value)
+
+/**
+ * What an operand stack cell holds while a method is being translated.
+ */
+typedef struct _irvaluestruct {
+
+	/** whether the value is a constant rather than in a register */
+	bvm_bool_t is_constant;
+
+	/** the register the value is in */
+	bvm_uint16_t reg;
+
+	/** the constant value */
+	bvm_int32_t constant;
+
+} ir_value_t;
+
+/**
+ * The state of a translation.
+ */
+typedef struct _irtranslationstruct {
+
+	/** the code being added to */
+	bvm_ir_code_t *ir;
+
+	/** the method */
+	bvm_method_t *method;
+
+	/** for each operand stack cell, what it holds */
+	ir_value_t *stack;
+
+	/** the operand stack depth */
+	bvm_uint32_t depth;
+
+	/** the register of the first operand stack cell - the number of locals */
+	bvm_uint32_t base;
+
+	/** the last bytecode offset at which the frame was exactly as the interpreter would have it */
+	bvm_uint32_t restart_pc;
+
+	/** the operand stack depth at \c restart_pc */
+	bvm_uint32_t restart_depth;
+
+	/** the index of the last instruction if it put a result in the top stack cell, otherwise \c -1 */
+	bvm_int32_t last_result;
+
+} ir_translation_t;
+
+/** The list of all code, so it can be freed at VM exit. */
+static BVM_VM_LOCAL bvm_ir_code_t *ir_list = NULL;
+
+/**
+ * Add an instruction.  It stops, if it does, at the last offset the frame was exact.
+ */
+static bvm_ir_insn_t *ir_emit(ir_translation_t *t, bvm_uint8_t op, bvm_uint32_t a, bvm_uint32_t b, bvm_uint32_t c, bvm_int32_t k) {
+
+	bvm_ir_insn_t *insn = t->ir->insns + t->ir->count++;
+
+	insn->op = op;
+	insn->a = (bvm_uint16_t) a;
+	insn->b = (bvm_uint16_t) b;
+	insn->c = (bvm_uint16_t) c;
+	insn->k = k;
+	insn->pc_index = (bvm_uint16_t) t->restart_pc;
+	insn->depth = (bvm_uint16_t) t->restart_depth;
+
+	t->last_result = -1;
+
+	return insn;
+}
+
+/**
+ * Whether operand stack cell \c i holds its own value, as the interpreter would have it.
+ */
+static bvm_bool_t ir_is_real(ir_translation_t *t, bvm_uint32_t i) {
+	return (!t->stack[i].is_constant) && (t->stack[i].reg == t->base + i);
+}
+
+/**
+ * Whether any of the first \c n operand stack cells is not as the interpreter would have it.
+ */
+static bvm_bool_t ir_is_symbolic(ir_translation_t *t, bvm_uint32_t n) {
+
+	bvm_uint32_t lc;
+
+	for (lc = 0; lc < n; lc++)
+		if (!ir_is_real(t, lc)) return BVM_TRUE;
+
+	return BVM_FALSE;
+}
+
+/**
+ * Move the value of operand stack cell \c i into the cell.
+ */
+static void ir_materialise(ir_translation_t *t, bvm_uint32_t i) {
+
+	ir_value_t *value = &t->stack[i];
+
+	if (ir_is_real(t, i)) return;
+
+	if (value->is_constant)
+		ir_emit(t, IR_MOVK, t->base + i, 0, 0, value->constant);
+	else
+		ir_emit(t, IR_MOV, t->base + i, value->reg, 0, 0);
+
+	value->is_constant = BVM_FALSE;
+	value->reg = (bvm_uint16_t) (t->base + i);
+}
+
+/**
+ * Move the values of the first \c n operand stack cells into their cells.
+ */
+static void ir_flush(ir_translation_t *t, bvm_uint32_t n) {
+
+	bvm_uint32_t lc;
+
+	for (lc = 0; lc < n; lc++) ir_materialise(t, lc);
+}
+
+/**
+ * Make the frame exactly as the interpreter would have it at \c pc_index.
+ */
+static void ir_sync(ir_translation_t *t, bvm_uint32_t pc_index) {
+
+	ir_flush(t, t->depth);
+
+	t->restart_pc = pc_index;
+	t->restart_depth = t->depth;
+}
+
+/**
+ * The register holding the value of operand stack cell \c i, moving a constant into the cell if need be.
+ */
+static bvm_uint32_t ir_reg(ir_translation_t *t, bvm_uint32_t i) {
+
+	if (t->stack[i].is_constant) ir_materialise(t, i);
+
+	return t->stack[i].reg;
+}
+
+static void ir_push_reg(ir_translation_t *t, bvm_uint32_t reg) {
+	t->stack[t->depth].is_constant = BVM_FALSE;
+	t->stack[t->depth].reg = (bvm_uint16_t) reg;
+	t->depth++;
+}
+
+static void ir_push_constant(ir_translation_t *t, bvm_int32_t constant) {
+	t->stack[t->depth].is_constant = BVM_TRUE;
+	t->stack[t->depth].constant = constant;
+	t->depth++;
+}
+
+/**
+ * Before the instruction for a bytecode that pops \c n cells and pushes its result in their place.  If the result goes
+ * below the exact depth the frame will be exact again after it - so the cells below the result are moved into place
+ * first, and for an instruction that may stop, the whole frame, so that it stops at this bytecode.
+ *
+ * @return whether the frame is exact after the instruction
+ */
+static bvm_bool_t ir_begin_result(ir_translation_t *t, bvm_uint32_t n, bvm_bool_t may_stop, bvm_uint32_t pc_index) {
+
+	bvm_uint32_t result = t->depth - n;
+
+	if (result >= t->restart_depth) return BVM_FALSE;
+
+	if (may_stop)
+		ir_sync(t, pc_index);
+	else
+		ir_flush(t, result);
+
+	return BVM_TRUE;
+}
+
+/**
+ * After the instruction for a bytecode that popped \c n cells and put a result of \c width cells in their place.
+ */
+static void ir_end_result(ir_translation_t *t, bvm_uint32_t n, bvm_uint32_t width, bvm_bool_t exact, bvm_uint32_t next_pc) {
+
+	bvm_uint32_t result = t->depth - n;
+	bvm_uint32_t lc;
+
+	for (lc = 0; lc < width; lc++) {
+		t->stack[result + lc].is_constant = BVM_FALSE;
+		t->stack[result + lc].reg = (bvm_uint16_t) (t->base + result + lc);
+	}
+
+	t->depth = result + width;
+	t->last_result = (width == 1) ? (bvm_int32_t) t->ir->count - 1 : -1;
+
+	if (exact) {
+		t->restart_pc = next_pc;
+		t->restart_depth = t->depth;
+	}
+}
+
+/**
+ * Before the instruction for a bytecode that pops \c n cells and does something other than push a result - the frame
+ * is exact after it, so the cells below those popped are moved into place first.  If the instruction may stop and
+ * doing that would change the frame below the exact depth, the whole frame is made exact at this bytecode.
+ */
+static void ir_begin_effect(ir_translation_t *t, bvm_uint32_t n, bvm_bool_t may_stop, bvm_uint32_t pc_index) {
+
+	bvm_uint32_t below = t->depth - n;
+
+	if (may_stop && ir_is_symbolic(t, (t->depth < t->restart_depth) ? t->depth : t->restart_depth))
+		ir_sync(t, pc_index);
+	else
+		ir_flush(t, below);
+}
+
+/**
+ * After the instruction for a bytecode that popped \c n cells.
+ */
+static void ir_end_effect(ir_translation_t *t, bvm_uint32_t n, bvm_uint32_t next_pc) {
+	t->depth -= n;
+	t->restart_pc = next_pc;
+	t->restart_depth = t->depth;
+}
+
+/**
+ * Set where a branch goes.  A target with no code yet is linked when the branch is first taken.
+ */
+static void ir_link(ir_translation_t *t, bvm_ir_insn_t *insn, bvm_uint32_t target, bvm_uint32_t depth) {
+
+	bvm_uint32_t entry = t->ir->entries[target];
+
+	insn->pc_index = (bvm_uint16_t) target;
+	insn->depth = (bvm_uint16_t) depth;
+	insn->k = (entry >= BVM_IR_FIRST) ? (bvm_int32_t) (entry - BVM_IR_FIRST) : -1;
+}
+
+/**
+ * Work out an int operation on two constants.
+ */
+static bvm_int32_t ir_fold(bvm_uint8_t op, bvm_int32_t left, bvm_int32_t right) {
+
+	bvm_uint32_t l = (bvm_uint32_t) left, r = (bvm_uint32_t) right;
+
+	switch (op) {
+		case IR_ADD:  return (bvm_int32_t) (l + r);
+		case IR_SUB:  return (bvm_int32_t) (l - r);
+		case IR_MUL:  return (bvm_int32_t) (l * r);
+		case IR_AND:  return (bvm_int32_t) (l & r);
+		case IR_OR:   return (bvm_int32_t) (l | r);
+		case IR_XOR:  return (bvm_int32_t) (l ^ r);
+		case IR_SHL:  return (bvm_int32_t) (l << (r & 0x1F));
+		case IR_SHR:  return left >> (r & 0x1F);
+		default: 	  return (bvm_int32_t) (l >> (r & 0x1F));
+	}
+}
+
+/**
+ * Translate a two operand int bytecode.  \c op_k is the operation with a constant second operand, or zero if there is
+ * none.
+ */
+static void ir_binary(ir_translation_t *t, bvm_uint8_t op, bvm_uint8_t op_k, bvm_uint32_t pc_index, bvm_uint32_t next_pc) {
+
+	bvm_uint32_t result = t->depth - 2;
+	ir_value_t *left = &t->stack[result];
+	ir_value_t *right = &t->stack[result+1];
+	bvm_bool_t may_stop = (op == IR_DIV) || (op == IR_REM);
+	bvm_bool_t exact;
+	bvm_uint32_t reg;
+
+	if (left->is_constant && right->is_constant && !may_stop) {
+		left->constant = ir_fold(op, left->constant, right->constant);
+		t->depth--;
+		t->last_result = -1;
+		return;
+	}
+
+	exact = ir_begin_result(t, 2, may_stop, pc_index);
+	reg = ir_reg(t, result);
+
+	if (right->is_constant && (op_k != 0)) {
+		bvm_int32_t k = right->constant;
+		if (op == IR_SUB) k = (bvm_int32_t) (0 - (bvm_uint32_t) k);
+		if ( (op >= IR_SHL) && (op <= IR_USHR) ) k &= 0x1F;
+		ir_emit(t, op_k, t->base + result, reg, 0, k);
+	} else {
+		ir_emit(t, op, t->base + result, reg, ir_reg(t, result+1), 0);
+	}
+
+	ir_end_result(t, 2, 1, exact, next_pc);
+}
+
+/**
+ * Translate a one operand int bytecode.
+ */
+static void ir_unary(ir_translation_t *t, bvm_uint8_t op, bvm_uint32_t pc_index, bvm_uint32_t next_pc) {
+
+	bvm_uint32_t result = t->depth - 1;
+	ir_value_t *value = &t->stack[result];
+	bvm_bool_t exact;
+
+	if (value->is_constant) {
+		bvm_int32_t v = value->constant;
+		switch (op) {
+			case IR_NEG: value->constant = (bvm_int32_t) (0 - (bvm_uint32_t) v); break;
+			case IR_I2B: value->constant = (bvm_int8_t) v; break;
+			case IR_I2C: value->constant = (bvm_uint16_t) v; break;
+			default: 	 value->constant = (bvm_int16_t) v;
+		}
+		t->last_result = -1;
+		return;
+	}
+
+	exact = ir_begin_result(t, 1, BVM_FALSE, pc_index);
+	ir_emit(t, op, t->base + result, value->reg, 0, 0);
+	ir_end_result(t, 1, 1, exact, next_pc);
+}
+
+/**
+ * Translate a conditional branch bytecode that compares \c n cells - with zero, \c null, or each other.
+ */
+static void ir_branch(ir_translation_t *t, bvm_uint8_t op, bvm_uint8_t op_k, bvm_uint32_t n, bvm_uint32_t pc_index, bvm_uint32_t target, bvm_uint32_t next_pc) {
+
+	bvm_uint32_t first = t->depth - n;
+	ir_value_t *right = &t->stack[t->depth - 1];
+	bvm_ir_insn_t *insn;
+	bvm_uint32_t reg;
+
+	ir_begin_effect(t, n, BVM_FALSE, pc_index);
+	reg = ir_reg(t, first);
+
+	if (n == 1)
+		/* with zero, or with null */
+		insn = ir_emit(t, op, 0, reg, 0, 0);
+	else if ( (op_k != 0) && right->is_constant && (right->constant == (bvm_int16_t) right->constant) )
+		insn = ir_emit(t, op_k, 0, reg, (bvm_uint16_t) right->constant, 0);
+	else
+		insn = ir_emit(t, op, 0, reg, ir_reg(t, first+1), 0);
+
+	ir_end_effect(t, n, next_pc);
+	ir_link(t, insn, target, t->depth);
+}
+
+/**
+ * Translate a store of the top \c width stack cells to a local.
+ */
+static void ir_store(ir_translation_t *t, bvm_uint32_t local, bvm_uint32_t width, bvm_uint32_t pc_index, bvm_uint32_t next_pc) {
+
+	bvm_uint32_t top = t->depth - 1;
+	ir_value_t *value = &t->stack[top];
+
+	if ( (width == 1) && (t->last_result == (bvm_int32_t) t->ir->count - 1) && ir_is_real(t, top) &&
+		 !ir_is_symbolic(t, top) && (t->ir->entries[pc_index] != t->ir->count + BVM_IR_FIRST) ) {
+		/* put the result of the last instruction straight into the local - unless the store can be gone into */
+		t->ir->insns[t->last_result].a = (bvm_uint16_t) local;
+		ir_end_effect(t, 1, next_pc);
+		t->last_result = -1;
+		return;
+	}
+
+	if (width == 1) {
+		ir_begin_effect(t, 1, BVM_FALSE, 0);
+		if (value->is_constant)
+			ir_emit(t, IR_MOVK, local, 0, 0, value->constant);
+		else
+			ir_emit(t, IR_MOV, local, value->reg, 0, 0);
+	} else {
+		/* the two halves may overlap the local, so they are moved to their cells first */
+		ir_flush(t, t->depth);
+		ir_emit(t, IR_MOV, local, t->base + top - 1, 0, 0);
+		ir_emit(t, IR_MOV, local + 1, t->base + top, 0, 0);
+	}
+
+	ir_end_effect(t, width, next_pc);
+}
+
+/**
+ * Translate one bytecode.
+ *
+ * @return an \c IR_NEXT, \c IR_ENDS, \c IR_UNSUPPORTED or \c IR_UNRESOLVED value
+ */
+static int ir_bytecode(ir_translation_t *t, bvm_uint8_t opcode, bvm_uint32_t pc_index, bvm_uint32_t next_pc) {
+
+	bvm_method_t *method = t->method;
+	bvm_uint8_t *pc = method->code.bytecode + pc_index;
+	bvm_uint32_t max_locals = method->max_locals;
+	bvm_uint32_t local = 0;
+	bvm_field_t *field;
+	bvm_ir_insn_t *insn;
+	bvm_bool_t exact;
+
+	switch (opcode) {
+
+		case OPCODE_nop:
+			return IR_NEXT;
+
+		case OPCODE_aconst_null:
+			ir_push_constant(t, 0);
+			return IR_NEXT;
+
+		case OPCODE_iconst_m1:
+		case OPCODE_iconst_0:
+		case OPCODE_iconst_1:
+		case OPCODE_iconst_2:
+		case OPCODE_iconst_3:
+		case OPCODE_iconst_4:
+		case OPCODE_iconst_5:
+			ir_push_constant(t, (bvm_int32_t) opcode - OPCODE_iconst_0);
+			return IR_NEXT;
+
+		case OPCODE_bipush:
+			ir_push_constant(t, (bvm_int8_t) pc[1]);
+			return IR_NEXT;
+
+		case OPCODE_sipush:
+			ir_push_constant(t, BVM_VM2INT16(pc+1));
+			return IR_NEXT;
+
+		case OPCODE_iload:
+		case OPCODE_fload:
+		case OPCODE_aload:
+		case OPCODE_lload:
+		case OPCODE_dload:
+			local = pc[1];
+			/* no break */
+		case OPCODE_iload_0:
+		case OPCODE_iload_1:
+		case OPCODE_iload_2:
+		case OPCODE_iload_3:
+		case OPCODE_fload_0:
+		case OPCODE_fload_1:
+		case OPCODE_fload_2:
+		case OPCODE_fload_3:
+		case OPCODE_aload_0:
+		case OPCODE_aload_1:
+		case OPCODE_aload_2:
+		case OPCODE_aload_3:
+		case OPCODE_lload_0:
+		case OPCODE_lload_1:
+		case OPCODE_lload_2:
+		case OPCODE_lload_3:
+		case OPCODE_dload_0:
+		case OPCODE_dload_1:
+		case OPCODE_dload_2:
+		case OPCODE_dload_3: {
+			bvm_bool_t wide = ( (opcode == OPCODE_lload) || (opcode == OPCODE_dload) ||
+							    ((opcode >= OPCODE_lload_0) && (opcode <= OPCODE_lload_3)) ||
+							    ((opcode >= OPCODE_dload_0) && (opcode <= OPCODE_dload_3)) );
+			if (opcode >= OPCODE_iload_0) local = (opcode - OPCODE_iload_0) & 3;
+			if (local + (wide ? 2 : 1) > max_locals) return IR_UNSUPPORTED;
+			ir_push_reg(t, local);
+			if (wide) ir_push_reg(t, local + 1);
+			t->last_result = -1;
+			return IR_NEXT;
+		}
+
+		case OPCODE_istore:
+		case OPCODE_fstore:
+		case OPCODE_astore:
+		case OPCODE_lstore:
+		case OPCODE_dstore:
+			local = pc[1];
+			/* no break */
+		case OPCODE_istore_0:
+		case OPCODE_istore_1:
+		case OPCODE_istore_2:
+		case OPCODE_istore_3:
+		case OPCODE_fstore_0:
+		case OPCODE_fstore_1:
+		case OPCODE_fstore_2:
+		case OPCODE_fstore_3:
+		case OPCODE_astore_0:
+		case OPCODE_astore_1:
+		case OPCODE_astore_2:
+		case OPCODE_astore_3:
+		case OPCODE_lstore_0:
+		case OPCODE_lstore_1:
+		case OPCODE_lstore_2:
+		case OPCODE_lstore_3:
+		case OPCODE_dstore_0:
+		case OPCODE_dstore_1:
+		case OPCODE_dstore_2:
+		case OPCODE_dstore_3: {
+			bvm_bool_t wide = ( (opcode == OPCODE_lstore) || (opcode == OPCODE_dstore) ||
+							    ((opcode >= OPCODE_lstore_0) && (opcode <= OPCODE_lstore_3)) ||
+							    ((opcode >= OPCODE_dstore_0) && (opcode <= OPCODE_dstore_3)) );
+			if (opcode >= OPCODE_istore_0) local = (opcode - OPCODE_istore_0) & 3;
+			if (local + (wide ? 2 : 1) > max_locals) return IR_UNSUPPORTED;
+			ir_store(t, local, wide ? 2 : 1, pc_index, next_pc);
+			return IR_NEXT;
+		}
+
+		case OPCODE_iinc:
+			if (pc[1] >= max_locals) return IR_UNSUPPORTED;
+			ir_begin_effect(t, 0, BVM_FALSE, pc_index);
+			ir_emit(t, IR_ADDK, pc[1], pc[1], 0, (bvm_int8_t) pc[2]);
+			ir_end_effect(t, 0, next_pc);
+			return IR_NEXT;
+
+		case OPCODE_pop:
+		case OPCODE_pop2:
+			t->depth -= (opcode == OPCODE_pop) ? 1 : 2;
+			t->last_result = -1;
+			return IR_NEXT;
+
+		case OPCODE_dup: {
+			ir_value_t *value = &t->stack[t->depth - 1];
+			if (value->is_constant)
+				ir_push_constant(t, value->constant);
+			else
+				ir_push_reg(t, value->reg);
+			t->last_result = -1;
+			return IR_NEXT;
+		}
+
+		case OPCODE_iadd:	ir_binary(t, IR_ADD, IR_ADDK, pc_index, next_pc); return IR_NEXT;
+		case OPCODE_isub:	ir_binary(t, IR_SUB, IR_ADDK, pc_index, next_pc); return IR_NEXT;
+		case OPCODE_imul:	ir_binary(t, IR_MUL, IR_MULK, pc_index, next_pc); return IR_NEXT;
+		case OPCODE_iand:	ir_binary(t, IR_AND, IR_ANDK, pc_index, next_pc); return IR_NEXT;
+		case OPCODE_ior:	ir_binary(t, IR_OR, IR_ORK, pc_index, next_pc); return IR_NEXT;
+		case OPCODE_ixor:	ir_binary(t, IR_XOR, IR_XORK, pc_index, next_pc); return IR_NEXT;
+		case OPCODE_ishl:	ir_binary(t, IR_SHL, IR_SHLK, pc_index, next_pc); return IR_NEXT;
+		case OPCODE_ishr:	ir_binary(t, IR_SHR, IR_SHRK, pc_index, next_pc); return IR_NEXT;
+		case OPCODE_iushr:	ir_binary(t, IR_USHR, IR_USHRK, pc_index, next_pc); return IR_NEXT;
+		case OPCODE_idiv:	ir_binary(t, IR_DIV, 0, pc_index, next_pc); return IR_NEXT;
+		case OPCODE_irem:	ir_binary(t, IR_REM, 0, pc_index, next_pc); return IR_NEXT;
+
+		case OPCODE_ineg:	ir_unary(t, IR_NEG, pc_index, next_pc); return IR_NEXT;
+		case OPCODE_i2b:	ir_unary(t, IR_I2B, pc_index, next_pc); return IR_NEXT;
+		case OPCODE_i2c:	ir_unary(t, IR_I2C, pc_index, next_pc); return IR_NEXT;
+		case OPCODE_i2s:	ir_unary(t, IR_I2S, pc_index, next_pc); return IR_NEXT;
+
+		case OPCODE_ifeq:
+		case OPCODE_ifne:
+		case OPCODE_iflt:
+		case OPCODE_ifge:
+		case OPCODE_ifgt:
+		case OPCODE_ifle:
+			/* compare with a constant zero */
+			ir_push_constant(t, 0);
+			ir_branch(t, IR_IFEQ + (opcode - OPCODE_ifeq), IR_IFEQK + (opcode - OPCODE_ifeq), 2, pc_index,
+					  pc_index + BVM_VM2INT16(pc+1), next_pc);
+			return IR_NEXT;
+
+		case OPCODE_if_icmpeq:
+		case OPCODE_if_icmpne:
+		case OPCODE_if_icmplt:
+		case OPCODE_if_icmpge:
+		case OPCODE_if_icmpgt:
+		case OPCODE_if_icmple:
+			ir_branch(t, IR_IFEQ + (opcode - OPCODE_if_icmpeq), IR_IFEQK + (opcode - OPCODE_if_icmpeq), 2, pc_index,
+					  pc_index + BVM_VM2INT16(pc+1), next_pc);
+			return IR_NEXT;
+
+		case OPCODE_if_acmpeq:
+		case OPCODE_if_acmpne:
+			ir_branch(t, IR_IFACMPEQ + (opcode - OPCODE_if_acmpeq), 0, 2, pc_index, pc_index + BVM_VM2INT16(pc+1), next_pc);
+			return IR_NEXT;
+
+		case OPCODE_ifnull:
+		case OPCODE_ifnonnull:
+			ir_branch(t, IR_IFNULL + (opcode - OPCODE_ifnull), 0, 1, pc_index, pc_index + BVM_VM2INT16(pc+1), next_pc);
+			return IR_NEXT;
+
+		case OPCODE_goto:
+		case OPCODE_goto_w:
+			ir_begin_effect(t, 0, BVM_FALSE, pc_index);
+			insn = ir_emit(t, IR_GOTO, 0, 0, 0, 0);
+			ir_link(t, insn, pc_index + ((opcode == OPCODE_goto) ? BVM_VM2INT16(pc+1) : BVM_VM2INT32(pc+1)), t->depth);
+			return IR_ENDS;
+
+		case OPCODE_iaload:
+		case OPCODE_baload:
+		case OPCODE_caload:
+		case OPCODE_saload:
+		case OPCODE_aaload: {
+			bvm_uint32_t array = t->depth - 2;
+			bvm_uint8_t op = (opcode == OPCODE_iaload) ? IR_IALOAD : (opcode == OPCODE_aaload) ? IR_AALOAD :
+							 IR_BALOAD + (opcode - OPCODE_baload);
+			exact = ir_begin_result(t, 2, BVM_TRUE, pc_index);
+			ir_emit(t, op, t->base + array, ir_reg(t, array), ir_reg(t, array + 1), 0);
+			ir_end_result(t, 2, 1, exact, next_pc);
+			return IR_NEXT;
+		}
+
+		case OPCODE_iastore:
+		case OPCODE_bastore:
+		case OPCODE_castore:
+		case OPCODE_sastore: {
+			bvm_uint32_t array = t->depth - 3;
+			bvm_uint8_t op = (opcode == OPCODE_iastore) ? IR_IASTORE : IR_BASTORE + (opcode - OPCODE_bastore);
+			ir_begin_effect(t, 3, BVM_TRUE, pc_index);
+			ir_emit(t, op, ir_reg(t, array + 2), ir_reg(t, array), ir_reg(t, array + 1), 0);
+			ir_end_effect(t, 3, next_pc);
+			return IR_NEXT;
+		}
+
+		case OPCODE_arraylength: {
+			bvm_uint32_t array = t->depth - 1;
+			exact = ir_begin_result(t, 1, BVM_TRUE, pc_index);
+			ir_emit(t, IR_ARRAYLENGTH, t->base + array, ir_reg(t, array), 0, 0);
+			ir_end_result(t, 1, 1, exact, next_pc);
+			return IR_NEXT;
+		}
+
+		case OPCODE_getfield:
+		case OPCODE_putfield:
+			/* the interpreter resolves it, and quickens it to a form translated here */
+			return IR_UNRESOLVED;
+
+		case OPCODE_getfield_fast:
+		case OPCODE_getfield_fast_long: {
+			bvm_uint32_t obj = t->depth - 1;
+			field = method->clazz->constant_pool[BVM_VM2UINT16(pc+1)].resolved_ptr;
+			exact = ir_begin_result(t, 1, BVM_TRUE, pc_index);
+			ir_emit(t, (opcode == OPCODE_getfield_fast) ? IR_GETFIELD : IR_GETFIELD2, t->base + obj, ir_reg(t, obj), 0,
+					field->value.offset);
+			ir_end_result(t, 1, (opcode == OPCODE_getfield_fast) ? 1 : 2, exact, next_pc);
+			return IR_NEXT;
+		}
+
+		case OPCODE_putfield_fast: {
+			bvm_uint32_t obj = t->depth - 2;
+			field = method->clazz->constant_pool[BVM_VM2UINT16(pc+1)].resolved_ptr;
+
+			/* storing a reference needs the GC write barrier */
+			if (BVM_FIELD_IsReference(field)) return IR_UNSUPPORTED;
+
+			ir_begin_effect(t, 2, BVM_TRUE, pc_index);
+			ir_emit(t, IR_PUTFIELD, ir_reg(t, obj + 1), ir_reg(t, obj), 0, field->value.offset);
+			ir_end_effect(t, 2, next_pc);
+			return IR_NEXT;
+		}
+
+#if BVM_FIELD_PACKING_ENABLE
+		case OPCODE_243_getfield_fast_packed:
+		case OPCODE_244_putfield_fast_packed: {
+			bvm_uint16_t index = BVM_VM2UINT16(pc+1);
+			field = method->clazz->constant_pool[index].resolved_ptr;
+
+			if (BVM_FIELD_IsLong(field) || BVM_FIELD_IsReference(field)) return IR_UNSUPPORTED;
+
+			if (opcode == OPCODE_243_getfield_fast_packed) {
+				bvm_uint32_t obj = t->depth - 1;
+				exact = ir_begin_result(t, 1, BVM_TRUE, pc_index);
+				ir_emit(t, IR_GETPACKED, t->base + obj, ir_reg(t, obj), 0, index);
+				ir_end_result(t, 1, 1, exact, next_pc);
+			} else {
+				bvm_uint32_t obj = t->depth - 2;
+				ir_begin_effect(t, 2, BVM_TRUE, pc_index);
+				ir_emit(t, IR_PUTPACKED, ir_reg(t, obj + 1), ir_reg(t, obj), 0, index);
+				ir_end_effect(t, 2, next_pc);
+			}
+			return IR_NEXT;
+		}
+#endif
+
+		default:
+			/* everything else is done by the interpreter */
+			return IR_UNSUPPORTED;
+	}
+}
+
+/**
+ * Translate a method from a bytecode offset, adding to its register code, until the translation reaches something it
+ * does not do, or code that has already been translated.
+ *
+ * @param ir the register code of the method
+ * @param method the method
+ * @param pc_index the offset to translate from
+ * @param depth the operand stack depth at \c pc_index
+ *
+ * @return the index of the first instruction translated, or \c -1 if nothing could be
+ */
+static bvm_int32_t ir_translate(bvm_ir_code_t *ir, bvm_method_t *method, bvm_uint32_t pc_index, bvm_uint32_t depth) {
+
+	bvm_uint8_t *code = method->code.bytecode;
+	bvm_uint32_t start = ir->count;
+	bvm_uint32_t old_entry = ir->entries[pc_index];
+	bvm_bool_t first = BVM_TRUE;
+	ir_translation_t t;
+	bvm_uint32_t lc;
+
+	if (depth > method->max_stack) return -1;
+
+	if ( (t.stack = bvm_pd_memory_alloc((method->max_stack + 3) * sizeof(ir_value_t))) == NULL) return -1;
+
+	t.ir = ir;
+	t.method = method;
+	t.depth = depth;
+	t.base = method->max_locals;
+	t.restart_pc = pc_index;
+	t.restart_depth = depth;
+	t.last_result = -1;
+
+	for (lc = 0; lc < depth; lc++) {
+		t.stack[lc].is_constant = BVM_FALSE;
+		t.stack[lc].reg = (bvm_uint16_t) (t.base + lc);
+	}
+
+	while (pc_index < method->code_length) {
+
+		bvm_uint32_t entry = ir->entries[pc_index];
+		bvm_uint8_t opcode = code[pc_index];
+		bvm_uint32_t length;
+		int next;
+
+		/* carry on in code already translated */
+		if ( (!first) && (entry != BVM_IR_UNTRANSLATED) ) {
+			ir_sync(&t, pc_index);
+			if (entry == BVM_IR_NONE)
+				ir_emit(&t, IR_EXIT, 0, 0, 0, 0);
+			else
+				ir_link(&t, ir_emit(&t, IR_GOTO, 0, 0, 0, 0), pc_index, t.depth);
+			break;
+		}
+
+		/* a branch target is always exact, so the branch can go straight there */
+		if (ir->targets[pc_index]) ir_sync(&t, pc_index);
+
+		if ( (ir->count + (t.depth * 2) + IR_INSNS_MAX > ir->capacity) || (t.depth > method->max_stack) ) {
+			/* out of room - the rest is interpreted */
+			if (first) {
+				ir->entries[pc_index] = BVM_IR_NONE;
+				break;
+			}
+			ir_sync(&t, pc_index);
+			ir_emit(&t, IR_EXIT, 0, 0, 0, 0);
+			break;
+		}
+
+		if (!ir_is_symbolic(&t, t.depth)) {
+			ir->entries[pc_index] = ir->count + BVM_IR_FIRST;
+			t.restart_pc = pc_index;
+			t.restart_depth = t.depth;
+		}
+
+		/* superinstructions are translated as their first instruction */
+		if ( (opcode >= OPCODE_233_aload_0_getfield) && (opcode <= OPCODE_236_aload_arraylength) )
+			opcode = bvm_exec_unquickened_opcode(opcode);
+
+		length = bvm_exec_instruction_length(code, pc_index, bvm_exec_unquickened_opcode(opcode));
+
+		next = ( (length == 0) || (length > method->code_length - pc_index) ) ? IR_UNSUPPORTED :
+				ir_bytecode(&t, opcode, pc_index, pc_index + length);
+
+		if ( (next == IR_UNSUPPORTED) || (next == IR_UNRESOLVED) ) {
+
+			/* nothing to run here - the interpreter runs it, or runs it until it is resolved */
+			if (first) {
+				ir->count = start;
+				ir->entries[pc_index] = (next == IR_UNSUPPORTED) ? BVM_IR_NONE : old_entry;
+				break;
+			}
+
+			ir_sync(&t, pc_index);
+
+			/* the interpreter need not come here just to be sent back */
+			if ( (next == IR_UNSUPPORTED) && (ir->entries[pc_index] == ir->count + BVM_IR_FIRST) )
+				ir->entries[pc_index] = BVM_IR_NONE;
+
+			ir_emit(&t, (next == IR_UNSUPPORTED) ? IR_EXIT : IR_TRANSLATE, 0, 0, 0, 0);
+			break;
+		}
+
+		first = BVM_FALSE;
+
+		if (next == IR_ENDS) break;
+
+		pc_index += length;
+	}
+
+	bvm_pd_memory_free(t.stack);
+
+	return (ir->count > start) ? (bvm_int32_t) start : -1;
+}
+
+/**
+ * Make the (empty) register code of a method, noting where its branches go.
+ *
+ * @return the code, or \c NULL if the method cannot have any
+ */
+static bvm_ir_code_t *ir_create(bvm_method_t *method) {
+
+	bvm_uint8_t *code = method->code.bytecode;
+	bvm_uint32_t code_length = method->code_length;
+	bvm_uint32_t capacity = code_length + method->max_stack + (IR_INSNS_MAX * 2);
+	bvm_uint32_t pc_index = 0;
+	bvm_ir_code_t *ir;
+
+	if (BVM_METHOD_IsNative(method) || (code_length == 0) || (code_length > 0xFFFF) ||
+		(method->max_locals + method->max_stack > 0xFFFF) ) return NULL;
+
+	ir = bvm_pd_memory_alloc(sizeof(bvm_ir_code_t) + (capacity - 1) * sizeof(bvm_ir_insn_t) +
+							 code_length * (sizeof(bvm_uint32_t) + sizeof(bvm_uint8_t)));
+
+	if (ir == NULL) return NULL;
+
+	ir->count = 0;
+	ir->capacity = capacity;
+	ir->entries = (bvm_uint32_t *) (ir->insns + capacity);
+	ir->targets = (bvm_uint8_t *) (ir->entries + code_length);
+	memset(ir->entries, 0, code_length * (sizeof(bvm_uint32_t) + sizeof(bvm_uint8_t)));
+
+	while (pc_index < code_length) {
+
+		bvm_uint8_t opcode = bvm_exec_unquickened_opcode(code[pc_index]);
+		bvm_uint32_t length = bvm_exec_instruction_length(code, pc_index, opcode);
+		bvm_int32_t target = -1;
+
+		if ( (length == 0) || (length > code_length - pc_index) ) {
+			/* the method cannot be followed - a breakpoint perhaps - so none of it is translated */
+			for (pc_index = 0; pc_index < code_length; pc_index++) ir->entries[pc_index] = BVM_IR_NONE;
+			break;
+		}
+
+		if ( ((opcode >= OPCODE_ifeq) && (opcode <= OPCODE_goto)) || (opcode == OPCODE_ifnull) || (opcode == OPCODE_ifnonnull) )
+			target = (bvm_int32_t) pc_index + BVM_VM2INT16(code + pc_index + 1);
+		else if (opcode == OPCODE_goto_w)
+			target = (bvm_int32_t) pc_index + BVM_VM2INT32(code + pc_index + 1);
+
+		if ( (target >= 0) && ((bvm_uint32_t) target < code_length) ) ir->targets[target] = BVM_TRUE;
+
+		pc_index += length;
+	}
+
+	ir->prev = NULL;
+	ir->next = ir_list;
+	if (ir_list != NULL) ir_list->prev = ir;
+	ir_list = ir;
+
+	return ir;
+}
+
+/**
+ * Run the register code of a method from a given pc until it stops, translating the method from there first if that
+ * has not been done.  The \c locals and \c sp are those of the method's current frame.
+ *
+ * @param method the method
+ * @param locals the locals of the current frame
+ * @param sp the stack pointer of the current frame - updated when the register code stops
+ * @param pc the pc to start at
+ *
+ * @return the pc to carry on interpreting from
+ */
+bvm_uint8_t *bvm_ir_run(bvm_method_t *method, bvm_cell_t *locals, bvm_cell_t **sp, bvm_uint8_t *pc) {
+
+	bvm_ir_code_t *ir = method->ir_code;
+	bvm_uint32_t pc_index = (bvm_uint32_t) (pc - method->code.bytecode);
+	bvm_cell_t *r = locals;
+	bvm_ir_insn_t *insn;
+	bvm_int32_t index;
+	bvm_uint32_t entry;
+
+	if (ir == NULL) {
+		if ( (ir = ir_create(method)) == NULL) return pc;
+		method->ir_code = ir;
+	}
+
+	entry = ir->entries[pc_index];
+
+	if (entry == BVM_IR_NONE) return pc;
+
+	if (entry == BVM_IR_UNTRANSLATED) {
+		index = ir_translate(ir, method, pc_index, (bvm_uint32_t) (*sp - (locals + method->max_locals)));
+		if (index < 0) return pc;
+	} else {
+		index = entry - BVM_IR_FIRST;
+	}
+
+	insn = ir->insns + index;
+
+	for (;;) {
+
+		switch (insn->op) {
+
+			case IR_TRANSLATE:
+				/* it may be resolved by now */
+				if ( (index = ir_translate(ir, method, insn->pc_index, insn->depth)) < 0) goto ir_stop;
+				insn->op = IR_GOTO;
+				insn->k = index;
+				insn = ir->insns + index;
+				continue;
+
+			case IR_MOV:	r[insn->a] = r[insn->b]; break;
+			case IR_MOVK:	r[insn->a].int_value = insn->k; break;
+
+			case IR_ADD:	r[insn->a].int_value = (bvm_int32_t) ((bvm_uint32_t) IR_INT(insn->b) + (bvm_uint32_t) IR_INT(insn->c)); break;
+			case IR_SUB:	r[insn->a].int_value = (bvm_int32_t) ((bvm_uint32_t) IR_INT(insn->b) - (bvm_uint32_t) IR_INT(insn->c)); break;
+			case IR_MUL:	r[insn->a].int_value = (bvm_int32_t) ((bvm_uint32_t) IR_INT(insn->b) * (bvm_uint32_t) IR_INT(insn->c)); break;
+			case IR_AND:	r[insn->a].int_value = IR_INT(insn->b) & IR_INT(insn->c); break;
+			case IR_OR:		r[insn->a].int_value = IR_INT(insn->b) | IR_INT(insn->c); break;
+			case IR_XOR:	r[insn->a].int_value = IR_INT(insn->b) ^ IR_INT(insn->c); break;
+			case IR_SHL:	r[insn->a].int_value = (bvm_int32_t) ((bvm_uint32_t) IR_INT(insn->b) << (IR_INT(insn->c) & 0x1F)); break;
+			case IR_SHR:	r[insn->a].int_value = IR_INT(insn->b) >> (IR_INT(insn->c) & 0x1F); break;
+			case IR_USHR:	r[insn->a].int_value = (bvm_int32_t) ((bvm_uint32_t) IR_INT(insn->b) >> (IR_INT(insn->c) & 0x1F)); break;
+
+			case IR_ADDK:	r[insn->a].int_value = (bvm_int32_t) ((bvm_uint32_t) IR_INT(insn->b) + (bvm_uint32_t) insn->k); break;
+			case IR_MULK:	r[insn->a].int_value = (bvm_int32_t) ((bvm_uint32_t) IR_INT(insn->b) * (bvm_uint32_t) insn->k); break;
+			case IR_ANDK:	r[insn->a].int_value = IR_INT(insn->b) & insn->k; break;
+			case IR_ORK:	r[insn->a].int_value = IR_INT(insn->b) | insn->k; break;
+			case IR_XORK:	r[insn->a].int_value = IR_INT(insn->b) ^ insn->k; break;
+			case IR_SHLK:	r[insn->a].int_value = (bvm_int32_t) ((bvm_uint32_t) IR_INT(insn->b) << insn->k); break;
+			case IR_SHRK:	r[insn->a].int_value = IR_INT(insn->b) >> insn->k; break;
+			case IR_USHRK:	r[insn->a].int_value = (bvm_int32_t) ((bvm_uint32_t) IR_INT(insn->b) >> insn->k); break;
+
+			case IR_DIV:
+			case IR_REM: {
+				bvm_int32_t left = IR_INT(insn->b);
+				bvm_int32_t right = IR_INT(insn->c);
+				if (right == 0) goto ir_stop;
+				if (right == -1)
+					/* MIN_INT / -1 overflows to MIN_INT */
+					r[insn->a].int_value = (insn->op == IR_DIV) ? (bvm_int32_t) (0 - (bvm_uint32_t) left) : 0;
+				else
+					r[insn->a].int_value = (insn->op == IR_DIV) ? left / right : left % right;
+				break;
+			}
+
+			case IR_NEG:	r[insn->a].int_value = (bvm_int32_t) (0 - (bvm_uint32_t) IR_INT(insn->b)); break;
+			case IR_I2B:	r[insn->a].int_value = (bvm_int8_t) IR_INT(insn->b); break;
+			case IR_I2C:	r[insn->a].int_value = (bvm_uint16_t) IR_INT(insn->b); break;
+			case IR_I2S:	r[insn->a].int_value = (bvm_int16_t) IR_INT(insn->b); break;
+
+			case IR_IFEQ:	if (IR_INT(insn->b) == IR_INT(insn->c)) goto ir_branch; break;
+			case IR_IFNE:	if (IR_INT(insn->b) != IR_INT(insn->c)) goto ir_branch; break;
+			case IR_IFLT:	if (IR_INT(insn->b) <  IR_INT(insn->c)) goto ir_branch; break;
+			case IR_IFGE:	if (IR_INT(insn->b) >= IR_INT(insn->c)) goto ir_branch; break;
+			case IR_IFGT:	if (IR_INT(insn->b) >  IR_INT(insn->c)) goto ir_branch; break;
+			case IR_IFLE:	if (IR_INT(insn->b) <= IR_INT(insn->c)) goto ir_branch; break;
+
+			case IR_IFEQK:	if (IR_INT(insn->b) == (bvm_int16_t) insn->c) goto ir_branch; break;
+			case IR_IFNEK:	if (IR_INT(insn->b) != (bvm_int16_t) insn->c) goto ir_branch; break;
+			case IR_IFLTK:	if (IR_INT(insn->b) <  (bvm_int16_t) insn->c) goto ir_branch; break;
+			case IR_IFGEK:	if (IR_INT(insn->b) >= (bvm_int16_t) insn->c) goto ir_branch; break;
+			case IR_IFGTK:	if (IR_INT(insn->b) >  (bvm_int16_t) insn->c) goto ir_branch; break;
+			case IR_IFLEK:	if (IR_INT(insn->b) <= (bvm_int16_t) insn->c) goto ir_branch; break;
+
+			case IR_IFACMPEQ:	if (r[insn->b].ref_value == r[insn->c].ref_value) goto ir_branch; break;
+			case IR_IFACMPNE:	if (r[insn->b].ref_value != r[insn->c].ref_value) goto ir_branch; break;
+			case IR_IFNULL:		if (r[insn->b].ref_value == NULL) goto ir_branch; break;
+			case IR_IFNONNULL:	if (r[insn->b].ref_value != NULL) goto ir_branch; break;
+
+			case IR_GOTO:	goto ir_branch;
+
+			case IR_IALOAD:
+			case IR_BALOAD:
+			case IR_CALOAD:
+			case IR_SALOAD:
+			case IR_AALOAD: {
+				bvm_jarray_obj_t *array_obj = (bvm_jarray_obj_t *) r[insn->b].ref_value;
+				bvm_int32_t i = IR_INT(insn->c);
+
+				/* unsigned, so a negative index is caught too */
+				if ( (array_obj == NULL) || ((bvm_uint32_t) i >= (bvm_uint32_t) array_obj->length.int_value) ) goto ir_stop;
+
+				switch (insn->op) {
+					case IR_IALOAD: r[insn->a].int_value = ((bvm_jint_array_obj_t *) array_obj)->data[i]; break;
+					case IR_BALOAD: r[insn->a].int_value = ((bvm_jbyte_array_obj_t *) array_obj)->data[i]; break;
+					case IR_CALOAD: r[insn->a].int_value = ((bvm_jchar_array_obj_t *) array_obj)->data[i]; break;
+					case IR_SALOAD: r[insn->a].int_value = ((bvm_jshort_array_obj_t *) array_obj)->data[i]; break;
+					default: 		r[insn->a].ref_value = BVM_REF_Decode(((bvm_instance_array_obj_t *) array_obj)->data[i]);
+				}
+				break;
+			}
+
+			case IR_IASTORE:
+			case IR_BASTORE:
+			case IR_CASTORE:
+			case IR_SASTORE: {
+				bvm_jarray_obj_t *array_obj = (bvm_jarray_obj_t *) r[insn->b].ref_value;
+				bvm_int32_t i = IR_INT(insn->c);
+
+				if ( (array_obj == NULL) || ((bvm_uint32_t) i >= (bvm_uint32_t) array_obj->length.int_value) ) goto ir_stop;
+
+				switch (insn->op) {
+					case IR_IASTORE: ((bvm_jint_array_obj_t *) array_obj)->data[i] = IR_INT(insn->a); break;
+					case IR_BASTORE: ((bvm_jbyte_array_obj_t *) array_obj)->data[i] = (bvm_int8_t) IR_INT(insn->a); break;
+					case IR_CASTORE: ((bvm_jchar_array_obj_t *) array_obj)->data[i] = (bvm_uint16_t) IR_INT(insn->a); break;
+					default: 		 ((bvm_jshort_array_obj_t *) array_obj)->data[i] = (bvm_int16_t) IR_INT(insn->a);
+				}
+				break;
+			}
+
+			case IR_ARRAYLENGTH: {
+				bvm_jarray_obj_t *array_obj = (bvm_jarray_obj_t *) r[insn->b].ref_value;
+				if (array_obj == NULL) goto ir_stop;
+				r[insn->a].int_value = array_obj->length.int_value;
+				break;
+			}
+
+			case IR_GETFIELD: {
+				bvm_obj_t *obj = r[insn->b].ref_value;
+				if (obj == NULL) goto ir_stop;
+				r[insn->a] = obj->fields[insn->k];
+				break;
+			}
+
+			case IR_GETFIELD2: {
+				bvm_obj_t *obj = r[insn->b].ref_value;
+				if (obj == NULL) goto ir_stop;
+				r[insn->a] = obj->fields[insn->k];
+				r[insn->a + 1] = obj->fields[insn->k + 1];
+				break;
+			}
+
+			case IR_PUTFIELD: {
+				bvm_obj_t *obj = r[insn->b].ref_value;
+				if (obj == NULL) goto ir_stop;
+				obj->fields[insn->k] = r[insn->a];
+				break;
+			}
+
+#if BVM_FIELD_PACKING_ENABLE
+			case IR_GETPACKED:
+			case IR_PUTPACKED: {
+				bvm_obj_t *obj = r[insn->b].ref_value;
+				bvm_field_t *field = method->clazz->constant_pool[insn->k].resolved_ptr;
+				if (obj == NULL) goto ir_stop;
+				if (insn->op == IR_GETPACKED)
+					bvm_object_get_packed_field(obj, field, &r[insn->a]);
+				else
+					bvm_object_put_packed_field(obj, field, &r[insn->a]);
+				break;
+			}
+#endif
+
+			default:
+				/* IR_EXIT */
+				goto ir_stop;
+		}
+
+		insn++;
+		continue;
+
+		ir_branch:
+
+		/* a branch to code not yet translated is linked when it is first taken */
+		if (insn->k < 0) {
+			entry = ir->entries[insn->pc_index];
+			if (entry >= BVM_IR_FIRST)
+				index = entry - BVM_IR_FIRST;
+			else if (entry == BVM_IR_UNTRANSLATED)
+				index = ir_translate(ir, method, insn->pc_index, insn->depth);
+			else
+				index = -1;
+			if (index < 0) goto ir_stop;
+			insn->k = index;
+		}
+
+		/* going back may loop, so give other threads a go */
+		if (ir->insns + insn->k <= insn) {
+#if BVM_THREAD_TIMER_PREEMPTION_ENABLE
+			if (bvm_gl_thread_switch_requested) goto ir_stop;
+#else
+			if (bvm_gl_thread_timeslice_counter == 0) goto ir_stop;
+			bvm_gl_thread_timeslice_counter--;
+#endif
+		}
+
+		insn = ir->insns + insn->k;
+	}
+
+	ir_stop:
+
+	*sp = locals + method->max_locals + insn->depth;
+	return method->code.bytecode + insn->pc_index;
+}
+
+/**
+ * Frees the register code of a method, if it has some.  Called as its clazz is unloaded.
+ */
+void bvm_ir_free(bvm_method_t *method) {
+
+	bvm_ir_code_t *ir = method->ir_code;
+
+	if (ir == NULL) return;
+
+	if (ir->prev != NULL)
+		ir->prev->next = ir->next;
+	else
+		ir_list = ir->next;
+
+	if (ir->next != NULL) ir->next->prev = ir->prev;
+
+	bvm_pd_memory_free(ir);
+	method->ir_code = NULL;
+}
+
+/**
+ * Frees all register code.  Called as the VM exits.
+ */
+void bvm_ir_release() {
+
+	while (ir_list != NULL) {
+		bvm_ir_code_t *next = ir_list->next;
+		bvm_pd_memory_free(ir_list);
+		ir_list = next;
+	}
+}
+
+#endif
@@ -0,0 +1,950 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#include "../h/bvm.h"
+
+/**
+
+ @file
+
+ Baseline template JIT.
+
+ @section jit-ov Overview
+
+ With #BVM_JIT_ENABLE a method that has been invoked or has looped #BVM_JIT_THRESHOLD times is compiled to native code
+ by gluing together a fixed machine code template for each of its instructions.  There is no register allocation and
+ no optimisation - what is saved is the interpreter's fetch and dispatch for each opcode, and the native code can keep
+ the locals and stack pointers in CPU registers.
+
+ Compiled code shares everything with the interpreter.  It runs in the frame #bvm_frame_push made for the method and
+ uses the interpreter's locals and operand stack just as the interpreter does, so at the start of each instruction the
+ state of the frame is exactly what the interpreter would have at that pc.  That makes it possible to go in and out of
+ compiled code at any instruction:
+
+ @li compiled code can be entered at any instruction - the interpreter enters it at the start of a method,
+ at the target of a backwards branch, on return to the method from a call, and when a thread switch resumes the method.
+ @li compiled code leaves to the interpreter at any instruction it does not translate.  It stops with the pc at that
+ instruction and the interpreter carries on from there.
+
+ Only simple and frequent instructions are translated - the int and reference loads, stores and constants, int
+ arithmetic, stack manipulation, conditional and unconditional branches, array access for int, byte, char, short and
+ reference arrays, and fast (already resolved) non-reference field access.  Everything else - invocations and returns,
+ longs and floats, allocation, anything that needs resolving, monitors, \c athrow - is left to the interpreter.  Compiled
+ code never calls out to the VM, never allocates and never throws.  Where an instruction would throw (a \c null
+ reference, an index out of bounds, a zero divisor) the compiled code stops at the instruction and the interpreter runs
+ it again and throws the exception in the usual way, so exception handling, stack traces and the GC are unaware of
+ compiled code.
+
+ Compiled code must still give other threads a go.  Each backwards branch decrements the thread timeslice counter (or
+ with #BVM_THREAD_TIMER_PREEMPTION_ENABLE looks at the switch request flag) and stops at the branch target when it is
+ time to switch threads.
+
+ A debugger must see every instruction, so no compiled code is run or compiled while a debugger session is open.
+
+ Compiled code is placed in a single block of executable memory of #BVM_JIT_CODE_CACHE_SIZE bytes from
+ #bvm_pd_memory_exec_alloc.  When it is full no more methods are compiled.
+
+ @section jit-x64 x86-64
+
+ The only backend is for x86-64.  The native code for a method is one function taking a #jit_context_t.  It starts with
+ a prologue that loads \c rbx with the locals pointer and \c r13 with the stack pointer, and jumps to the native code of
+ the entry instruction.  All exits load \c eax with the pc offset to carry on interpreting from and jump to the shared
+ epilogue, which writes \c r13 back as the stack pointer.  \c r14 holds the context.  Each method is translated twice:
+ the first pass records where the native code for each instruction starts, and the second emits the same code again
+ with the branch displacements filled in.
+
+ @author Greg McCreath
+ @since 0.0.10
+
+*/
+
+#if BVM_JIT_ENABLE
+
+/**
+ * What the interpreter passes to compiled code, and what it gets back.
+ */
+typedef struct _jitcontextstruct {
+
+	/** the locals of the current frame */
+	bvm_cell_t *locals;
+
+	/** the stack pointer of the current frame.  Compiled code updates it when it stops. */
+	bvm_cell_t *sp;
+
+	/** the native code of the instruction to start at */
+	bvm_uint8_t *entry;
+
+	/** the thread switch counter or flag to look at on backwards branches */
+	void *yield;
+
+} jit_context_t;
+
+/**
+ * The native code of a method.
+ *
+ * @return the pc offset the interpreter should carry on from.
+ */
+typedef bvm_int32_t (*jit_native_t)(jit_context_t *context);
+
+/**
+ * Native code being emitted.
+ */
+typedef struct _jitbufferstruct {
+
+	/** the native code */
+	bvm_uint8_t *code;
+
+	/** the offset of the next byte to emit */
+	bvm_uint32_t pos;
+
+	/** the number of bytes available at \c code */
+	bvm_uint32_t limit;
+
+	/** the offset of the shared epilogue */
+	bvm_uint32_t epilogue;
+
+	/** the native offset of each instruction - see #bvm_jit_code_t */
+	bvm_uint32_t *entries;
+
+	/** whether this is the second pass, with all entries known */
+	bvm_bool_t final;
+
+	/** cleared if the method cannot be compiled after all */
+	bvm_bool_t ok;
+
+} jit_buffer_t;
+
+/* the x86-64 registers used by the templates */
+#define JIT_RAX 	0
+#define JIT_RCX 	1
+#define JIT_RDX 	2
+#define JIT_RBX 	3
+#define JIT_R13 	13
+#define JIT_R14 	14
+
+/* the x86 condition codes used by the templates.  A condition is negated by flipping its bottom bit. */
+#define JIT_CC_AE 		0x3
+#define JIT_CC_E  		0x4
+#define JIT_CC_NE 		0x5
+#define JIT_CC_L  		0xC
+#define JIT_CC_GE 		0xD
+#define JIT_CC_LE 		0xE
+#define JIT_CC_G  		0xF
+#define JIT_CC_ALWAYS	-1
+
+/* the size of a stack or locals cell */
+#define JIT_CELL ((bvm_int32_t) sizeof(bvm_cell_t))
+
+/* the most native code bytes any one instruction is translated into */
+#define JIT_TEMPLATE_MAX 	128
+
+/* alignment of compiled methods in the code cache */
+#define JIT_ALIGN(n) (((n) + 15) & ~15)
+
+/* where array data starts for each array type */
+#define JIT_INT_DATA 	((bvm_int32_t) offsetof(bvm_jint_array_obj_t, data))
+#define JIT_BYTE_DATA 	((bvm_int32_t) offsetof(bvm_jbyte_array_obj_t, data))
+#define JIT_CHAR_DATA 	((bvm_int32_t) offsetof(bvm_jchar_array_obj_t, data))
+#define JIT_SHORT_DATA 	((bvm_int32_t) offsetof(bvm_jshort_array_obj_t, data))
+#define JIT_REF_DATA 	((bvm_int32_t) offsetof(bvm_instance_array_obj_t, data))
+#define JIT_LENGTH 		((bvm_int32_t) offsetof(bvm_jarray_obj_t, length))
+
+/** The code cache.  \c NULL until the first compile. */
+static BVM_VM_LOCAL bvm_uint8_t *jit_cache = NULL;
+
+/** The number of bytes of the code cache used so far. */
+static BVM_VM_LOCAL bvm_uint32_t jit_cache_used = 0;
+
+static void jit_byte(jit_buffer_t *b, bvm_int32_t value) {
+	b->code[b->pos++] = (bvm_uint8_t) value;
+}
+
+static void jit_int32(jit_buffer_t *b, bvm_int32_t value) {
+	bvm_uint32_t v = (bvm_uint32_t) value;
+	jit_byte(b, v);
+	jit_byte(b, v >> 8);
+	jit_byte(b, v >> 16);
+	jit_byte(b, v >> 24);
+}
+
+/**
+ * Emit an instruction with a \c [base+disp] memory operand.  A REX prefix is emitted when needed.
+ *
+ * @param b the buffer
+ * @param wide whether the operation is 64 bit
+ * @param opcode the opcode.  If greater than \c 0xff it is a two byte opcode.
+ * @param reg the register (or opcode extension) for the ModRM \c reg field
+ * @param base the base register.  Not \c rsp or \c r12.
+ * @param disp the displacement
+ */
+static void jit_mem(jit_buffer_t *b, bvm_bool_t wide, bvm_int32_t opcode, bvm_int32_t reg, bvm_int32_t base, bvm_int32_t disp) {
+
+	bvm_int32_t rex = 0x40 | (wide ? 0x08 : 0) | ((reg & 8) ? 0x04 : 0) | ((base & 8) ? 0x01 : 0);
+
+	if (rex != 0x40) jit_byte(b, rex);
+	if (opcode > 0xff) jit_byte(b, opcode >> 8);
+	jit_byte(b, opcode);
+
+	if ( (disp >= -128) && (disp <= 127) ) {
+		jit_byte(b, 0x40 | ((reg & 7) << 3) | (base & 7));
+		jit_byte(b, disp);
+	} else {
+		jit_byte(b, 0x80 | ((reg & 7) << 3) | (base & 7));
+		jit_int32(b, disp);
+	}
+}
+
+/**
+ * Emit an instruction with a \c [rax+rcx*scale+disp] memory operand - an array element.
+ *
+ * @param b the buffer
+ * @param prefix an operand size prefix to emit first, or \c 0 (zero)
+ * @param wide whether the operation is 64 bit
+ * @param opcode the opcode.  If greater than \c 0xff it is a two byte opcode.
+ * @param reg the register for the ModRM \c reg field - \c rax to \c rbx
+ * @param scale_bits the scale as a shift - \c 0 to \c 3
+ * @param disp the displacement
+ */
+static void jit_element(jit_buffer_t *b, bvm_int32_t prefix, bvm_bool_t wide, bvm_int32_t opcode, bvm_int32_t reg, bvm_int32_t scale_bits, bvm_int32_t disp) {
+
+	if (prefix) jit_byte(b, prefix);
+	if (wide) jit_byte(b, 0x48);
+	if (opcode > 0xff) jit_byte(b, opcode >> 8);
+	jit_byte(b, opcode);
+	jit_byte(b, 0x84 | (reg << 3));
+	jit_byte(b, (scale_bits << 6) | (JIT_RCX << 3) | JIT_RAX);
+	jit_int32(b, disp);
+}
+
+/* load and store a register from and to stack cell 'slot' relative to the stack pointer, and a local */
+#define JIT_LOAD_STACK(b, wide, reg, slot) 	jit_mem(b, wide, 0x8B, reg, JIT_R13, (slot) * JIT_CELL)
+#define JIT_STORE_STACK(b, wide, reg, slot) jit_mem(b, wide, 0x89, reg, JIT_R13, (slot) * JIT_CELL)
+#define JIT_LOAD_LOCAL(b, reg, index) 		jit_mem(b, BVM_TRUE, 0x8B, reg, JIT_RBX, (index) * JIT_CELL)
+#define JIT_STORE_LOCAL(b, reg, index) 		jit_mem(b, BVM_TRUE, 0x89, reg, JIT_RBX, (index) * JIT_CELL)
+
+/**
+ * Move the stack pointer by \c cells.  Uses \c lea so the flags are left alone.
+ */
+static void jit_move_sp(jit_buffer_t *b, bvm_int32_t cells) {
+	jit_mem(b, BVM_TRUE, 0x8D, JIT_R13, JIT_R13, cells * JIT_CELL);
+}
+
+/**
+ * Emit a stop at a given pc - the interpreter carries on from there.
+ */
+static void jit_exit(jit_buffer_t *b, bvm_uint32_t pc_index) {
+
+	/* mov eax, pc_index */
+	jit_byte(b, 0xB8);
+	jit_int32(b, pc_index);
+
+	/* jmp epilogue */
+	jit_byte(b, 0xE9);
+	jit_int32(b, b->epilogue - (b->pos + 4));
+}
+
+/**
+ * Emit a stop at a given pc if condition \c cc holds.
+ */
+static void jit_exit_if(jit_buffer_t *b, bvm_int32_t cc, bvm_uint32_t pc_index) {
+
+	/* a short jump over the 10 byte stop if the condition does not hold */
+	jit_byte(b, 0x70 | (cc ^ 1));
+	jit_byte(b, 10);
+	jit_exit(b, pc_index);
+}
+
+/**
+ * Emit a stop at \c pc_index if it is time for a thread switch.  Without timer preemption, this counts
+ * down the timeslice counter as the interpreter does for each opcode.
+ */
+static void jit_yield_check(jit_buffer_t *b, bvm_uint32_t pc_index) {
+
+	/* mov rax, [r14 + yield] */
+	jit_mem(b, BVM_TRUE, 0x8B, JIT_RAX, JIT_R14, offsetof(jit_context_t, yield));
+
+	/* cmp dword [rax], 0 */
+	jit_mem(b, BVM_FALSE, 0x83, 7, JIT_RAX, 0);
+	jit_byte(b, 0);
+
+#if BVM_THREAD_TIMER_PREEMPTION_ENABLE
+	jit_exit_if(b, JIT_CC_NE, pc_index);
+#else
+	jit_exit_if(b, JIT_CC_E, pc_index);
+
+	/* dec dword [rax] */
+	jit_mem(b, BVM_FALSE, 0xFF, 1, JIT_RAX, 0);
+#endif
+}
+
+/**
+ * Emit a jump, or a conditional jump if \c cc is not #JIT_CC_ALWAYS, from the instruction at \c pc_index to the
+ * instruction at \c target.  A backwards jump first checks for a thread switch.
+ */
+static void jit_branch(jit_buffer_t *b, bvm_int32_t cc, bvm_uint32_t pc_index, bvm_int32_t target, bvm_uint32_t code_length) {
+
+	bvm_uint32_t skip = 0;
+
+	/* a branch somewhere other than the start of an instruction.  Leave it to the interpreter. */
+	if ( (target < 0) || ((bvm_uint32_t) target >= code_length) || (b->final && b->entries[target] == 0) ) {
+		b->ok = BVM_FALSE;
+		return;
+	}
+
+	if ((bvm_uint32_t) target > pc_index) {
+
+		if (cc == JIT_CC_ALWAYS) {
+			jit_byte(b, 0xE9);
+		} else {
+			jit_byte(b, 0x0F);
+			jit_byte(b, 0x80 | cc);
+		}
+
+		jit_int32(b, b->entries[target] - (b->pos + 4));
+		return;
+	}
+
+	/* backwards - short jump over the thread switch check and the jump if the condition does not hold */
+	if (cc != JIT_CC_ALWAYS) {
+		jit_byte(b, 0x70 | (cc ^ 1));
+		skip = b->pos;
+		jit_byte(b, 0);
+	}
+
+	jit_yield_check(b, target);
+
+	jit_byte(b, 0xE9);
+	jit_int32(b, b->entries[target] - (b->pos + 4));
+
+	if (cc != JIT_CC_ALWAYS) b->code[skip] = (bvm_uint8_t) (b->pos - (skip + 1));
+}
+
+/**
+ * Emit the checks before an array access - stop if the array at stack cell \c array_slot is \c null or the
+ * index (after it) is out of bounds.  Leaves the array in \c rax and the index in \c rcx.
+ */
+static void jit_array_check(jit_buffer_t *b, bvm_int32_t array_slot, bvm_uint32_t pc_index) {
+
+	JIT_LOAD_STACK(b, BVM_TRUE, JIT_RAX, array_slot);
+	JIT_LOAD_STACK(b, BVM_FALSE, JIT_RCX, array_slot + 1);
+
+	/* test rax, rax */
+	jit_byte(b, 0x48); jit_byte(b, 0x85); jit_byte(b, 0xC0);
+	jit_exit_if(b, JIT_CC_E, pc_index);
+
+	/* cmp ecx, [rax + length] - unsigned, so a negative index is caught too */
+	jit_mem(b, BVM_FALSE, 0x3B, JIT_RCX, JIT_RAX, JIT_LENGTH);
+	jit_exit_if(b, JIT_CC_AE, pc_index);
+}
+
+/**
+ * Emit the native code for one instruction.
+ *
+ * @param b the buffer
+ * @param method the method being compiled
+ * @param pc_index the offset of the instruction
+ * @param opcode the opcode of the instruction
+ */
+static void jit_instruction(jit_buffer_t *b, bvm_method_t *method, bvm_uint32_t pc_index, bvm_uint8_t opcode) {
+
+	bvm_uint8_t *pc = method->code.bytecode + pc_index;
+	bvm_field_t *field;
+
+	switch (opcode) {
+
+		case OPCODE_nop:
+			break;
+
+		case OPCODE_aconst_null:
+			/* mov qword [r13], 0 */
+			jit_mem(b, BVM_TRUE, 0xC7, 0, JIT_R13, 0);
+			jit_int32(b, 0);
+			jit_move_sp(b, 1);
+			break;
+
+		case OPCODE_iconst_m1:
+		case OPCODE_iconst_0:
+		case OPCODE_iconst_1:
+		case OPCODE_iconst_2:
+		case OPCODE_iconst_3:
+		case OPCODE_iconst_4:
+		case OPCODE_iconst_5:
+		case OPCODE_bipush:
+		case OPCODE_sipush:
+			/* mov dword [r13], value */
+			jit_mem(b, BVM_FALSE, 0xC7, 0, JIT_R13, 0);
+			if (opcode == OPCODE_bipush)
+				jit_int32(b, (bvm_int8_t) pc[1]);
+			else if (opcode == OPCODE_sipush)
+				jit_int32(b, BVM_VM2INT16(pc+1));
+			else
+				jit_int32(b, opcode - OPCODE_iconst_0);
+			jit_move_sp(b, 1);
+			break;
+
+		case OPCODE_iload:
+		case OPCODE_aload:
+			JIT_LOAD_LOCAL(b, JIT_RAX, pc[1]);
+			JIT_STORE_STACK(b, BVM_TRUE, JIT_RAX, 0);
+			jit_move_sp(b, 1);
+			break;
+
+		case OPCODE_iload_0:
+		case OPCODE_iload_1:
+		case OPCODE_iload_2:
+		case OPCODE_iload_3:
+			JIT_LOAD_LOCAL(b, JIT_RAX, opcode - OPCODE_iload_0);
+			JIT_STORE_STACK(b, BVM_TRUE, JIT_RAX, 0);
+			jit_move_sp(b, 1);
+			break;
+
+		case OPCODE_aload_0:
+		case OPCODE_aload_1:
+		case OPCODE_aload_2:
+		case OPCODE_aload_3:
+			JIT_LOAD_LOCAL(b, JIT_RAX, opcode - OPCODE_aload_0);
+			JIT_STORE_STACK(b, BVM_TRUE, JIT_RAX, 0);
+			jit_move_sp(b, 1);
+			break;
+
+		case OPCODE_istore:
+		case OPCODE_astore:
+			JIT_LOAD_STACK(b, BVM_TRUE, JIT_RAX, -1);
+			JIT_STORE_LOCAL(b, JIT_RAX, pc[1]);
+			jit_move_sp(b, -1);
+			break;
+
+		case OPCODE_istore_0:
+		case OPCODE_istore_1:
+		case OPCODE_istore_2:
+		case OPCODE_istore_3:
+			JIT_LOAD_STACK(b, BVM_TRUE, JIT_RAX, -1);
+			JIT_STORE_LOCAL(b, JIT_RAX, opcode - OPCODE_istore_0);
+			jit_move_sp(b, -1);
+			break;
+
+		case OPCODE_astore_0:
+		case OPCODE_astore_1:
+		case OPCODE_astore_2:
+		case OPCODE_astore_3:
+			JIT_LOAD_STACK(b, BVM_TRUE, JIT_RAX, -1);
+			JIT_STORE_LOCAL(b, JIT_RAX, opcode - OPCODE_astore_0);
+			jit_move_sp(b, -1);
+			break;
+
+		case OPCODE_iaload:
+			jit_array_check(b, -2, pc_index);
+			jit_element(b, 0, BVM_FALSE, 0x8B, JIT_RAX, 2, JIT_INT_DATA);
+			JIT_STORE_STACK(b, BVM_FALSE, JIT_RAX, -2);
+			jit_move_sp(b, -1);
+			break;
+
+		case OPCODE_aaload:
+			jit_array_check(b, -2, pc_index);
+#if BVM_COMPRESSED_REFS_ENABLE
+			/* mov eax, dword [...] - a compressed reference is the address, and the load zero extends it */
+			jit_element(b, 0, BVM_FALSE, 0x8B, JIT_RAX, 2, JIT_REF_DATA);
+#else
+			jit_element(b, 0, BVM_TRUE, 0x8B, JIT_RAX, 3, JIT_REF_DATA);
+#endif
+			JIT_STORE_STACK(b, BVM_TRUE, JIT_RAX, -2);
+			jit_move_sp(b, -1);
+			break;
+
+		case OPCODE_baload:
+			/* movsx eax, byte [...] */
+			jit_array_check(b, -2, pc_index);
+			jit_element(b, 0, BVM_FALSE, 0x0FBE, JIT_RAX, 0, JIT_BYTE_DATA);
+			JIT_STORE_STACK(b, BVM_FALSE, JIT_RAX, -2);
+			jit_move_sp(b, -1);
+			break;
+
+		case OPCODE_caload:
+			/* movzx eax, word [...] */
+			jit_array_check(b, -2, pc_index);
+			jit_element(b, 0, BVM_FALSE, 0x0FB7, JIT_RAX, 1, JIT_CHAR_DATA);
+			JIT_STORE_STACK(b, BVM_FALSE, JIT_RAX, -2);
+			jit_move_sp(b, -1);
+			break;
+
+		case OPCODE_saload:
+			/* movsx eax, word [...] */
+			jit_array_check(b, -2, pc_index);
+			jit_element(b, 0, BVM_FALSE, 0x0FBF, JIT_RAX, 1, JIT_SHORT_DATA);
+			JIT_STORE_STACK(b, BVM_FALSE, JIT_RAX, -2);
+			jit_move_sp(b, -1);
+			break;
+
+		case OPCODE_iastore:
+			jit_array_check(b, -3, pc_index);
+			JIT_LOAD_STACK(b, BVM_FALSE, JIT_RDX, -1);
+			jit_element(b, 0, BVM_FALSE, 0x89, JIT_RDX, 2, JIT_INT_DATA);
+			jit_move_sp(b, -3);
+			break;
+
+		case OPCODE_bastore:
+			/* mov byte [...], dl */
+			jit_array_check(b, -3, pc_index);
+			JIT_LOAD_STACK(b, BVM_FALSE, JIT_RDX, -1);
+			jit_element(b, 0, BVM_FALSE, 0x88, JIT_RDX, 0, JIT_BYTE_DATA);
+			jit_move_sp(b, -3);
+			break;
+
+		case OPCODE_castore:
+		case OPCODE_sastore:
+			/* mov word [...], dx */
+			jit_array_check(b, -3, pc_index);
+			JIT_LOAD_STACK(b, BVM_FALSE, JIT_RDX, -1);
+			jit_element(b, 0x66, BVM_FALSE, 0x89, JIT_RDX, 1, (opcode == OPCODE_castore) ? JIT_CHAR_DATA : JIT_SHORT_DATA);
+			jit_move_sp(b, -3);
+			break;
+
+		case OPCODE_pop:
+			jit_move_sp(b, -1);
+			break;
+
+		case OPCODE_pop2:
+			jit_move_sp(b, -2);
+			break;
+
+		case OPCODE_dup:
+			JIT_LOAD_STACK(b, BVM_TRUE, JIT_RAX, -1);
+			JIT_STORE_STACK(b, BVM_TRUE, JIT_RAX, 0);
+			jit_move_sp(b, 1);
+			break;
+
+		case OPCODE_dup_x1:
+			JIT_LOAD_STACK(b, BVM_TRUE, JIT_RAX, -1);
+			JIT_LOAD_STACK(b, BVM_TRUE, JIT_RCX, -2);
+			JIT_STORE_STACK(b, BVM_TRUE, JIT_RAX, -2);
+			JIT_STORE_STACK(b, BVM_TRUE, JIT_RCX, -1);
+			JIT_STORE_STACK(b, BVM_TRUE, JIT_RAX, 0);
+			jit_move_sp(b, 1);
+			break;
+
+		case OPCODE_swap:
+			JIT_LOAD_STACK(b, BVM_TRUE, JIT_RAX, -1);
+			JIT_LOAD_STACK(b, BVM_TRUE, JIT_RCX, -2);
+			JIT_STORE_STACK(b, BVM_TRUE, JIT_RAX, -2);
+			JIT_STORE_STACK(b, BVM_TRUE, JIT_RCX, -1);
+			break;
+
+		case OPCODE_iadd:
+		case OPCODE_isub:
+		case OPCODE_imul:
+		case OPCODE_iand:
+		case OPCODE_ior:
+		case OPCODE_ixor:
+			/* <op> eax, [r13-cell] */
+			JIT_LOAD_STACK(b, BVM_FALSE, JIT_RAX, -2);
+			switch (opcode) {
+				case OPCODE_iadd: jit_mem(b, BVM_FALSE, 0x03, JIT_RAX, JIT_R13, -JIT_CELL); break;
+				case OPCODE_isub: jit_mem(b, BVM_FALSE, 0x2B, JIT_RAX, JIT_R13, -JIT_CELL); break;
+				case OPCODE_imul: jit_mem(b, BVM_FALSE, 0x0FAF, JIT_RAX, JIT_R13, -JIT_CELL); break;
+				case OPCODE_iand: jit_mem(b, BVM_FALSE, 0x23, JIT_RAX, JIT_R13, -JIT_CELL); break;
+				case OPCODE_ior:  jit_mem(b, BVM_FALSE, 0x0B, JIT_RAX, JIT_R13, -JIT_CELL); break;
+				default: 		  jit_mem(b, BVM_FALSE, 0x33, JIT_RAX, JIT_R13, -JIT_CELL); break;
+			}
+			JIT_STORE_STACK(b, BVM_FALSE, JIT_RAX, -2);
+			jit_move_sp(b, -1);
+			break;
+
+		case OPCODE_idiv:
+		case OPCODE_irem:
+			/* a zero divisor throws, and MIN_INT / -1 traps on x86 - both are left to the interpreter */
+			JIT_LOAD_STACK(b, BVM_FALSE, JIT_RCX, -1);
+			jit_byte(b, 0x85); jit_byte(b, 0xC9);					/* test ecx, ecx */
+			jit_exit_if(b, JIT_CC_E, pc_index);
+			jit_byte(b, 0x83); jit_byte(b, 0xF9); jit_byte(b, 0xFF);	/* cmp ecx, -1 */
+			jit_exit_if(b, JIT_CC_E, pc_index);
+			JIT_LOAD_STACK(b, BVM_FALSE, JIT_RAX, -2);
+			jit_byte(b, 0x99);										/* cdq */
+			jit_byte(b, 0xF7); jit_byte(b, 0xF9);					/* idiv ecx */
+			JIT_STORE_STACK(b, BVM_FALSE, (opcode == OPCODE_idiv) ? JIT_RAX : JIT_RDX, -2);
+			jit_move_sp(b, -1);
+			break;
+
+		case OPCODE_ineg:
+			/* neg dword [r13-cell] */
+			jit_mem(b, BVM_FALSE, 0xF7, 3, JIT_R13, -JIT_CELL);
+			break;
+
+		case OPCODE_ishl:
+		case OPCODE_ishr:
+		case OPCODE_iushr:
+			/* x86 masks the shift count to 5 bits, as Java does */
+			JIT_LOAD_STACK(b, BVM_FALSE, JIT_RCX, -1);
+			JIT_LOAD_STACK(b, BVM_FALSE, JIT_RAX, -2);
+			jit_byte(b, 0xD3);
+			jit_byte(b, (opcode == OPCODE_ishl) ? 0xE0 : (opcode == OPCODE_ishr) ? 0xF8 : 0xE8);
+			JIT_STORE_STACK(b, BVM_FALSE, JIT_RAX, -2);
+			jit_move_sp(b, -1);
+			break;
+
+		case OPCODE_iinc:
+			/* add dword [rbx + local], value */
+			jit_mem(b, BVM_FALSE, 0x81, 0, JIT_RBX, pc[1] * JIT_CELL);
+			jit_int32(b, (bvm_int8_t) pc[2]);
+			break;
+
+		case OPCODE_i2b:
+		case OPCODE_i2c:
+		case OPCODE_i2s:
+			/* movsx / movzx eax, [r13-cell] */
+			jit_mem(b, BVM_FALSE, (opcode == OPCODE_i2b) ? 0x0FBE : (opcode == OPCODE_i2c) ? 0x0FB7 : 0x0FBF, JIT_RAX, JIT_R13, -JIT_CELL);
+			JIT_STORE_STACK(b, BVM_FALSE, JIT_RAX, -1);
+			break;
+
+		case OPCODE_ifeq:
+		case OPCODE_ifne:
+		case OPCODE_iflt:
+		case OPCODE_ifge:
+		case OPCODE_ifgt:
+		case OPCODE_ifle: {
+			static const bvm_int8_t conditions[] = { JIT_CC_E, JIT_CC_NE, JIT_CC_L, JIT_CC_GE, JIT_CC_G, JIT_CC_LE };
+			JIT_LOAD_STACK(b, BVM_FALSE, JIT_RAX, -1);
+			jit_move_sp(b, -1);
+			jit_byte(b, 0x85); jit_byte(b, 0xC0);					/* test eax, eax */
+			jit_branch(b, conditions[opcode - OPCODE_ifeq], pc_index, pc_index + BVM_VM2INT16(pc+1), method->code_length);
+			break;
+		}
+
+		case OPCODE_if_icmpeq:
+		case OPCODE_if_icmpne:
+		case OPCODE_if_icmplt:
+		case OPCODE_if_icmpge:
+		case OPCODE_if_icmpgt:
+		case OPCODE_if_icmple: {
+			static const bvm_int8_t conditions[] = { JIT_CC_E, JIT_CC_NE, JIT_CC_L, JIT_CC_GE, JIT_CC_G, JIT_CC_LE };
+			/* cmp eax, [r13-cell] */
+			JIT_LOAD_STACK(b, BVM_FALSE, JIT_RAX, -2);
+			jit_mem(b, BVM_FALSE, 0x3B, JIT_RAX, JIT_R13, -JIT_CELL);
+			jit_move_sp(b, -2);
+			jit_branch(b, conditions[opcode - OPCODE_if_icmpeq], pc_index, pc_index + BVM_VM2INT16(pc+1), method->code_length);
+			break;
+		}
+
+		case OPCODE_if_acmpeq:
+		case OPCODE_if_acmpne:
+			/* cmp rax, [r13-cell] */
+			JIT_LOAD_STACK(b, BVM_TRUE, JIT_RAX, -2);
+			jit_mem(b, BVM_TRUE, 0x3B, JIT_RAX, JIT_R13, -JIT_CELL);
+			jit_move_sp(b, -2);
+			jit_branch(b, (opcode == OPCODE_if_acmpeq) ? JIT_CC_E : JIT_CC_NE, pc_index, pc_index + BVM_VM2INT16(pc+1), method->code_length);
+			break;
+
+		case OPCODE_ifnull:
+		case OPCODE_ifnonnull:
+			JIT_LOAD_STACK(b, BVM_TRUE, JIT_RAX, -1);
+			jit_move_sp(b, -1);
+			jit_byte(b, 0x48); jit_byte(b, 0x85); jit_byte(b, 0xC0);	/* test rax, rax */
+			jit_branch(b, (opcode == OPCODE_ifnull) ? JIT_CC_E : JIT_CC_NE, pc_index, pc_index + BVM_VM2INT16(pc+1), method->code_length);
+			break;
+
+		case OPCODE_goto:
+			jit_branch(b, JIT_CC_ALWAYS, pc_index, pc_index + BVM_VM2INT16(pc+1), method->code_length);
+			break;
+
+		case OPCODE_goto_w:
+			jit_branch(b, JIT_CC_ALWAYS, pc_index, pc_index + BVM_VM2INT32(pc+1), method->code_length);
+			break;
+
+		case OPCODE_arraylength:
+			JIT_LOAD_STACK(b, BVM_TRUE, JIT_RAX, -1);
+			jit_byte(b, 0x48); jit_byte(b, 0x85); jit_byte(b, 0xC0);	/* test rax, rax */
+			jit_exit_if(b, JIT_CC_E, pc_index);
+			jit_mem(b, BVM_FALSE, 0x8B, JIT_RAX, JIT_RAX, JIT_LENGTH);
+			JIT_STORE_STACK(b, BVM_FALSE, JIT_RAX, -1);
+			break;
+
+		case OPCODE_getfield_fast:
+			/* the field is already resolved, so its offset is known */
+			field = method->clazz->constant_pool[BVM_VM2UINT16(pc+1)].resolved_ptr;
+			JIT_LOAD_STACK(b, BVM_TRUE, JIT_RAX, -1);
+			jit_byte(b, 0x48); jit_byte(b, 0x85); jit_byte(b, 0xC0);	/* test rax, rax */
+			jit_exit_if(b, JIT_CC_E, pc_index);
+			jit_mem(b, BVM_TRUE, 0x8B, JIT_RAX, JIT_RAX, offsetof(bvm_obj_t, fields) + field->value.offset * JIT_CELL);
+			JIT_STORE_STACK(b, BVM_TRUE, JIT_RAX, -1);
+			break;
+
+#if BVM_FIELD_PACKING_ENABLE
+		case OPCODE_243_getfield_fast_packed: {
+			bvm_int32_t load;
+			field = method->clazz->constant_pool[BVM_VM2UINT16(pc+1)].resolved_ptr;
+
+			/* a long or double is left to the interpreter */
+			switch (field->packed_type) {
+				case 'C': load = 0x0FB7; break;		/* movzx eax, word [...] */
+				case 'S': load = 0x0FBF; break;		/* movsx eax, word [...] */
+				case 'B': load = 0x0FBE; break;		/* movsx eax, byte [...] */
+				case 'Z': load = 0x0FB6; break;		/* movzx eax, byte [...] */
+				case 'I':
+				case 'F': load = 0x8B; break;		/* mov eax, dword [...] */
+				default: load = 0;
+			}
+
+			if (load == 0) {
+				jit_exit(b, pc_index);
+				break;
+			}
+
+			JIT_LOAD_STACK(b, BVM_TRUE, JIT_RAX, -1);
+			jit_byte(b, 0x48); jit_byte(b, 0x85); jit_byte(b, 0xC0);	/* test rax, rax */
+			jit_exit_if(b, JIT_CC_E, pc_index);
+			jit_mem(b, BVM_FALSE, load, JIT_RAX, JIT_RAX, offsetof(bvm_obj_t, fields) + field->value.offset);
+			JIT_STORE_STACK(b, BVM_FALSE, JIT_RAX, -1);
+			break;
+		}
+
+		case OPCODE_244_putfield_fast_packed:
+			field = method->clazz->constant_pool[BVM_VM2UINT16(pc+1)].resolved_ptr;
+
+			if (BVM_FIELD_IsLong(field)) {
+				jit_exit(b, pc_index);
+				break;
+			}
+
+			JIT_LOAD_STACK(b, BVM_TRUE, JIT_RAX, -2);
+			jit_byte(b, 0x48); jit_byte(b, 0x85); jit_byte(b, 0xC0);	/* test rax, rax */
+			jit_exit_if(b, JIT_CC_E, pc_index);
+			JIT_LOAD_STACK(b, BVM_FALSE, JIT_RCX, -1);
+
+			switch (field->packed_type) {
+				case 'C':
+				case 'S':
+					/* mov word [...], cx */
+					jit_byte(b, 0x66);
+					jit_mem(b, BVM_FALSE, 0x89, JIT_RCX, JIT_RAX, offsetof(bvm_obj_t, fields) + field->value.offset);
+					break;
+				case 'B':
+				case 'Z':
+					/* mov byte [...], cl */
+					jit_mem(b, BVM_FALSE, 0x88, JIT_RCX, JIT_RAX, offsetof(bvm_obj_t, fields) + field->value.offset);
+					break;
+				default:
+					jit_mem(b, BVM_FALSE, 0x89, JIT_RCX, JIT_RAX, offsetof(bvm_obj_t, fields) + field->value.offset);
+			}
+
+			jit_move_sp(b, -2);
+			break;
+#endif
+
+		case OPCODE_putfield_fast:
+			field = method->clazz->constant_pool[BVM_VM2UINT16(pc+1)].resolved_ptr;
+
+			/* storing a reference needs the GC write barrier */
+			if (BVM_FIELD_IsReference(field)) {
+				jit_exit(b, pc_index);
+				break;
+			}
+
+			JIT_LOAD_STACK(b, BVM_TRUE, JIT_RAX, -2);
+			jit_byte(b, 0x48); jit_byte(b, 0x85); jit_byte(b, 0xC0);	/* test rax, rax */
+			jit_exit_if(b, JIT_CC_E, pc_index);
+			JIT_LOAD_STACK(b, BVM_TRUE, JIT_RCX, -1);
+			jit_mem(b, BVM_TRUE, 0x89, JIT_RCX, JIT_RAX, offsetof(bvm_obj_t, fields) + field->value.offset * JIT_CELL);
+			jit_move_sp(b, -2);
+			break;
+
+		default:
+			/* everything else is done by the interpreter */
+			jit_exit(b, pc_index);
+			break;
+	}
+}
+
+/**
+ * Translate a method into native code.  Called twice - see the overview.
+ *
+ * @return #BVM_TRUE if the method was translated, #BVM_FALSE if it could not be.
+ */
+static bvm_bool_t jit_translate(jit_buffer_t *b, bvm_method_t *method) {
+
+	bvm_uint8_t *code = method->code.bytecode;
+	bvm_uint32_t pc_index = 0;
+
+	b->pos = 0;
+	b->ok = BVM_TRUE;
+
+	/* prologue - push rbx, r13, r14 */
+	jit_byte(b, 0x53);
+	jit_byte(b, 0x41); jit_byte(b, 0x55);
+	jit_byte(b, 0x41); jit_byte(b, 0x56);
+
+	/* mov r14, <the context argument> */
+	jit_byte(b, 0x49); jit_byte(b, 0x89);
+#ifdef _WIN64
+	jit_byte(b, 0xCE);
+#else
+	jit_byte(b, 0xFE);
+#endif
+
+	jit_mem(b, BVM_TRUE, 0x8B, JIT_RBX, JIT_R14, offsetof(jit_context_t, locals));
+	jit_mem(b, BVM_TRUE, 0x8B, JIT_R13, JIT_R14, offsetof(jit_context_t, sp));
+
+	/* jmp [r14 + entry] */
+	jit_mem(b, BVM_FALSE, 0xFF, 4, JIT_R14, offsetof(jit_context_t, entry));
+
+	/* epilogue - write back the stack pointer, pop r14, r13, rbx and return */
+	b->epilogue = b->pos;
+	jit_mem(b, BVM_TRUE, 0x89, JIT_R13, JIT_R14, offsetof(jit_context_t, sp));
+	jit_byte(b, 0x41); jit_byte(b, 0x5E);
+	jit_byte(b, 0x41); jit_byte(b, 0x5D);
+	jit_byte(b, 0x5B);
+	jit_byte(b, 0xC3);
+
+	while (pc_index < method->code_length) {
+
+		bvm_uint8_t opcode = code[pc_index];
+		bvm_uint32_t length;
+
+		/* breakpoints hide the real opcode */
+		if (opcode == OPCODE_breakpoint) return BVM_FALSE;
+
+		/* superinstructions are translated as their first instruction. */
+		if ( (opcode >= OPCODE_233_aload_0_getfield) && (opcode <= OPCODE_236_aload_arraylength) )
+			opcode = bvm_exec_unquickened_opcode(opcode);
+
+		length = bvm_exec_instruction_length(code, pc_index, bvm_exec_unquickened_opcode(opcode));
+
+		if ( (length == 0) || (length > method->code_length - pc_index) ) return BVM_FALSE;
+		if (b->pos + JIT_TEMPLATE_MAX > b->limit) return BVM_FALSE;
+
+		b->entries[pc_index] = b->pos;
+		jit_instruction(b, method, pc_index, opcode);
+
+		pc_index += length;
+	}
+
+	return b->ok;
+}
+
+/**
+ * Compile a method to native code.  Called by the interpreter when a method's #bvm_method_t.jit_counter reaches
+ * #BVM_JIT_THRESHOLD.  On success the method's \c jit_code is set.  A method that cannot be compiled is left alone
+ * and is interpreted.
+ *
+ * @param method the method to compile
+ *
+ * @return #BVM_TRUE if the method was compiled, #BVM_FALSE otherwise.
+ */
+bvm_bool_t bvm_jit_compile(bvm_method_t *method) {
+
+	bvm_jit_code_t *jit_code;
+	jit_buffer_t buffer;
+	bvm_uint32_t header_size;
+
+	if (BVM_METHOD_IsNative(method) || (method->code_length == 0)) return BVM_FALSE;
+
+	/* the first compile allocates the code cache.  If that fails, mark it as full */
+	if (jit_cache == NULL) {
+
+		if (jit_cache_used != 0) return BVM_FALSE;
+
+		jit_cache = bvm_pd_memory_exec_alloc(BVM_JIT_CODE_CACHE_SIZE);
+
+		if (jit_cache == NULL) {
+			jit_cache_used = BVM_JIT_CODE_CACHE_SIZE;
+			return BVM_FALSE;
+		}
+	}
+
+	header_size = JIT_ALIGN(offsetof(bvm_jit_code_t, entries) + method->code_length * sizeof(bvm_uint32_t));
+
+	if (jit_cache_used + header_size + JIT_TEMPLATE_MAX > BVM_JIT_CODE_CACHE_SIZE) return BVM_FALSE;
+
+	jit_code = (bvm_jit_code_t *) (jit_cache + jit_cache_used);
+	memset(jit_code->entries, 0, method->code_length * sizeof(bvm_uint32_t));
+
+	buffer.code = (bvm_uint8_t *) jit_code + header_size;
+	buffer.limit = BVM_JIT_CODE_CACHE_SIZE - jit_cache_used - header_size;
+	buffer.entries = jit_code->entries;
+
+	/* the first pass finds where each instruction goes, the second fills in the branches */
+	buffer.final = BVM_FALSE;
+	if (!jit_translate(&buffer, method)) return BVM_FALSE;
+
+	buffer.final = BVM_TRUE;
+	if (!jit_translate(&buffer, method)) return BVM_FALSE;
+
+	jit_code->native = buffer.code;
+	jit_cache_used += header_size + JIT_ALIGN(buffer.pos);
+
+#if BVM_PROFILER_PERF_ENABLE
+	bvm_profiler_perf_map_code(method, jit_code->native, buffer.pos);
+#endif
+
+	method->jit_code = jit_code;
+
+	return BVM_TRUE;
+}
+
+/**
+ * Run the compiled code of a method from a given pc until it stops.  The \c locals and \c sp are those of the
+ * method's current frame.  If the pc is not the start of an instruction nothing is run.
+ *
+ * @param method the compiled method
+ * @param locals the locals of the current frame
+ * @param sp the stack pointer of the current frame - updated when the compiled code stops
+ * @param pc the pc to start at
+ *
+ * @return the pc to carry on interpreting from
+ */
+bvm_uint8_t *bvm_jit_run(bvm_method_t *method, bvm_cell_t *locals, bvm_cell_t **sp, bvm_uint8_t *pc) {
+
+	bvm_jit_code_t *jit_code = method->jit_code;
+	bvm_uint32_t entry = jit_code->entries[pc - method->code.bytecode];
+	jit_context_t context;
+	union {
+		bvm_uint8_t *code;
+		jit_native_t function;
+	} native;
+
+	if (entry == 0) return pc;
+
+	context.locals = locals;
+	context.sp = *sp;
+	context.entry = jit_code->native + entry;
+#if BVM_THREAD_TIMER_PREEMPTION_ENABLE
+	context.yield = (void *) &bvm_gl_thread_switch_requested;
+#else
+	context.yield = &bvm_gl_thread_timeslice_counter;
+#endif
+
+	native.code = jit_code->native;
+	pc = method->code.bytecode + native.function(&context);
+
+	*sp = context.sp;
+
+	return pc;
+}
+
+/**
+ * Give the code cache back to the platform at VM exit.
+ */
+void bvm_jit_release() {
+
+	if (jit_cache != NULL) {
+		bvm_pd_memory_exec_free(jit_cache, BVM_JIT_CODE_CACHE_SIZE);
+		jit_cache = NULL;
+	}
+
+	jit_cache_used = 0;
+}
+
+#endif
@@ -0,0 +1,397 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#include "../h/bvm.h"
+
+/**
+
+ @file
+
+ Runtime metrics server.
+
+ @section ov Overview
+
+ When the VM is started with \c -metrics and a port, it listens on that port and answers each connection with a
+ snapshot of its runtime metrics as plain text in the Prometheus exposition format, wrapped in an HTTP response so a
+ Prometheus server (or \c curl) can scrape it directly.  The request itself is read and ignored - any path gets the
+ same snapshot.
+
+ The server is serviced from #bvm_thread_switch every #BVM_METRICS_INTERACTION_COUNT thread switches, the same way
+ the debugger is.  When no thread is runnable the VM sleeps no more than #BVM_METRICS_POLL_MAX milliseconds at a time
+ and checks for a request after each sleep.  The VM does not run while a request is answered.
+
+ Nothing extra is done as the VM runs to keep most of the figures - the heap sizes, the GC statistics, the threads and
+ the clazz pool are read where the VM already keeps them when a snapshot is served.  The few that are counted - the
+ bytes allocated, the GC pause histogram and the monitors - are kept together in #bvm_gl_metrics.
+
+ The metrics are:
+
+ @li \c babe_heap_size_bytes, \c babe_heap_free_bytes and \c babe_heap_used_bytes - the heap, and how much of it is
+ and is not in the free list.
+ @li \c babe_heap_allocated_bytes_total - the bytes allocated since the VM started.  Its rate is the allocation rate.
+ @li \c babe_gc_collections_total - the number of GCs.
+ @li \c babe_gc_pause_seconds - a histogram of GC pauses, and \c babe_gc_pause_max_seconds, the longest of them.
+ @li \c babe_threads - the number of threads in each state, by a \c state label.
+ @li \c babe_classes - the number of clazzes loaded.
+ @li \c babe_monitors and \c babe_monitors_in_use - the monitors allocated, and those of them bound to an object.
+
+ With #BVM_THREAD_ACCOUNTING_ENABLE there are also:
+
+ @li \c babe_thread_wait_seconds - a histogram of how long threads waited to run each time they became runnable.
+ @li \c babe_thread_cpu_seconds_total and \c babe_thread_bytecodes_total - the time each thread that has not
+ terminated has run for and the bytecodes it has executed, by a \c thread label of its id.  Threads past those that fit
+ in a snapshot are left out.
+
+ @author Greg McCreath
+ @since 0.0.10
+
+*/
+
+#if BVM_METRICS_ENABLE
+
+/** The size of the buffer a snapshot is written into - comfortably more than a snapshot needs */
+#define METRICS_BUFFER_SIZE 8192
+
+/** The most a single line of a snapshot is written with - the per-thread lines stop when there is not this much room */
+#define METRICS_LINE_MAX 128
+
+/**
+ * The runtime metrics that are counted as the VM runs.
+ */
+BVM_VM_LOCAL bvm_metrics_t bvm_gl_metrics;
+
+/**
+ * The port the metrics server listens on, or zero for no metrics server.  Set with the \c -metrics command line
+ * option.
+ */
+BVM_VM_LOCAL bvm_int32_t bvm_gl_metrics_port = 0;
+
+/**
+ * The listening metrics server socket, or -1 if there is none.
+ */
+BVM_VM_LOCAL bvm_int32_t bvm_gl_metrics_socket = -1;
+
+/**
+ * The buffer a snapshot is written into, and the length written so far.
+ */
+static BVM_VM_LOCAL char metrics_buffer[METRICS_BUFFER_SIZE];
+static BVM_VM_LOCAL bvm_uint32_t metrics_length;
+
+/**
+ * The upper bounds in milliseconds of the GC pause histogram buckets - the last bucket has no bound - and the same
+ * bounds in seconds as they are written out.
+ */
+static const bvm_uint32_t metrics_pause_bounds[BVM_METRICS_GC_PAUSE_BUCKETS - 1] = {
+	1, 2, 5, 10, 20, 50, 100, 200, 500, 1000
+};
+
+static const char *metrics_pause_labels[BVM_METRICS_GC_PAUSE_BUCKETS] = {
+	"0.001", "0.002", "0.005", "0.01", "0.02", "0.05", "0.1", "0.2", "0.5", "1", "+Inf"
+};
+
+#if BVM_THREAD_ACCOUNTING_ENABLE
+
+/**
+ * The bounds of the thread wait histogram buckets (#bvm_gl_thread_wait_bounds) in seconds as they are written out.
+ */
+static const char *metrics_wait_labels[BVM_THREAD_WAIT_BUCKETS] = {
+	"0.0001", "0.0002", "0.0005", "0.001", "0.002", "0.005", "0.01", "0.02", "0.05", "+Inf"
+};
+
+#endif
+
+/**
+ * Starts the metrics server listening on #bvm_gl_metrics_port, if there is one.  Called once sockets are
+ * initialised.
+ */
+void bvm_metrics_open() {
+
+	/* a socket restored from a snapshot is not open in this process */
+	bvm_gl_metrics_socket = -1;
+
+	if (bvm_gl_metrics_port <= 0) return;
+
+	bvm_gl_metrics_socket = bvm_pd_socket_server_open(bvm_gl_metrics_port);
+
+	if (bvm_gl_metrics_socket == BVM_SOCKET_ERROR) {
+		bvm_gl_metrics_socket = -1;
+#if BVM_CONSOLE_ENABLE
+		bvm_pd_console_out("Metrics server could not listen on port %d.\n", (int) bvm_gl_metrics_port);
+#endif
+	}
+}
+
+/**
+ * Stops the metrics server listening, if it is.
+ */
+void bvm_metrics_close() {
+
+	if (bvm_gl_metrics_socket < 0) return;
+
+	bvm_pd_socket_server_close(bvm_gl_metrics_socket);
+	bvm_gl_metrics_socket = -1;
+}
+
+/**
+ * Counts a GC pause in the pause histogram.
+ *
+ * @param millis the length of the pause in milliseconds
+ */
+void bvm_metrics_gc_pause(bvm_uint32_t millis) {
+
+	bvm_uint32_t i = 0;
+
+	while ( (i < BVM_METRICS_GC_PAUSE_BUCKETS - 1) && (millis > metrics_pause_bounds[i]) ) i++;
+
+	bvm_gl_metrics.gc_pauses[i]++;
+}
+
+/**
+ * Appends formatted text to the snapshot buffer.
+ *
+ * @param format a \c printf format
+ */
+static void metrics_printf(const char *format, ...) {
+
+	va_list args;
+
+	va_start(args, format);
+	metrics_length += (bvm_uint32_t) vsprintf(metrics_buffer + metrics_length, format, args);
+	va_end(args);
+}
+
+/**
+ * Appends the help and type lines of a metric to the snapshot buffer.
+ *
+ * @param name the name of the metric
+ * @param type the Prometheus type of the metric
+ * @param help a description of the metric
+ */
+static void metrics_describe(const char *name, const char *type, const char *help) {
+	metrics_printf("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/**
+ * Appends a metric with a single value to the snapshot buffer.
+ *
+ * @param name the name of the metric
+ * @param type the Prometheus type of the metric
+ * @param help a description of the metric
+ * @param value the value of the metric
+ */
+static void metrics_value(const char *name, const char *type, const char *help, bvm_native_ulong_t value) {
+	metrics_describe(name, type, help);
+	metrics_printf("%s %lu\n", name, (unsigned long) value);
+}
+
+/**
+ * Appends a metric with a value in milliseconds to the snapshot buffer, as seconds.
+ *
+ * @param name the name of the metric, including any labels
+ * @param millis the value in milliseconds
+ */
+static void metrics_seconds(const char *name, bvm_native_ulong_t millis) {
+	metrics_printf("%s %lu.%03lu\n", name, (unsigned long) (millis / 1000), (unsigned long) (millis % 1000));
+}
+
+#if BVM_THREAD_ACCOUNTING_ENABLE
+
+/**
+ * Appends the thread scheduling metrics to the snapshot buffer - the wait histogram of all threads, and the run time
+ * and bytecodes of each thread that has not terminated for as long as there is room.
+ */
+static void metrics_threads() {
+
+	bvm_native_ulong_t count = 0, micros;
+	bvm_vmthread_t *vmthread;
+	bvm_uint32_t i, limit;
+
+	metrics_describe("babe_thread_wait_seconds", "histogram", "The waits of runnable threads to run.");
+	for (i = 0; i < BVM_THREAD_WAIT_BUCKETS; i++) {
+		count += bvm_gl_thread_waits[i];
+		metrics_printf("babe_thread_wait_seconds_bucket{le=\"%s\"} %lu\n", metrics_wait_labels[i], (unsigned long) count);
+	}
+	metrics_printf("babe_thread_wait_seconds_sum %lu.%06lu\n", (unsigned long) (bvm_gl_thread_wait_micros / 1000000),
+				   (unsigned long) (bvm_gl_thread_wait_micros % 1000000));
+	metrics_printf("babe_thread_wait_seconds_count %lu\n", (unsigned long) count);
+
+	/* the run times get half of the room left, the bytecodes the rest */
+	limit = metrics_length + (METRICS_BUFFER_SIZE - metrics_length) / 2 - METRICS_LINE_MAX;
+
+	metrics_describe("babe_thread_cpu_seconds_total", "counter", "The time each thread has run for.");
+	for (vmthread = bvm_gl_threads; vmthread != NULL; vmthread = vmthread->next) {
+		if ( (vmthread->thread_obj == NULL) || (vmthread->status & BVM_THREAD_STATUS_TERMINATED) ) continue;
+		if (metrics_length > limit) break;
+		micros = bvm_thread_cpu_micros(vmthread);
+		metrics_printf("babe_thread_cpu_seconds_total{thread=\"%ld\"} %lu.%06lu\n", (long) vmthread->thread_obj->id.int_value,
+					   (unsigned long) (micros / 1000000), (unsigned long) (micros % 1000000));
+	}
+
+	metrics_describe("babe_thread_bytecodes_total", "counter", "The bytecodes each thread has executed.");
+	for (vmthread = bvm_gl_threads; vmthread != NULL; vmthread = vmthread->next) {
+		if ( (vmthread->thread_obj == NULL) || (vmthread->status & BVM_THREAD_STATUS_TERMINATED) ) continue;
+		if (metrics_length > METRICS_BUFFER_SIZE - 2 * METRICS_LINE_MAX) break;
+		metrics_printf("babe_thread_bytecodes_total{thread=\"%ld\"} %lu\n", (long) vmthread->thread_obj->id.int_value,
+					   (unsigned long) bvm_thread_bytecodes(vmthread));
+	}
+}
+
+#endif
+
+/**
+ * Writes a snapshot of the runtime metrics into the snapshot buffer.
+ */
+static void metrics_snapshot() {
+
+	static const char *state_names[] = { "new", "runnable", "blocked", "waiting", "timed_waiting", "terminated" };
+
+	bvm_uint32_t states[6] = { 0, 0, 0, 0, 0, 0 };
+	bvm_native_ulong_t count = 0;
+	bvm_vmthread_t *vmthread;
+	bvm_gc_stats_t stats;
+	bvm_uint32_t i;
+
+	bvm_gc_get_stats(&stats);
+
+	metrics_value("babe_heap_size_bytes", "gauge", "The size of the heap.", bvm_gl_heap_size);
+	metrics_value("babe_heap_free_bytes", "gauge", "The bytes of the heap in the free list.", bvm_gl_heap_free);
+	metrics_value("babe_heap_used_bytes", "gauge", "The bytes of the heap not in the free list.",
+				  bvm_gl_heap_size - bvm_gl_heap_free);
+	metrics_value("babe_heap_allocated_bytes_total", "counter", "The bytes allocated since the VM started.",
+				  bvm_gl_metrics.allocated + bvm_gl_heap_allocated);
+
+	metrics_value("babe_gc_collections_total", "counter", "The number of GCs.", stats.collections);
+
+	metrics_describe("babe_gc_pause_seconds", "histogram", "The pauses of GCs.");
+	for (i = 0; i < BVM_METRICS_GC_PAUSE_BUCKETS; i++) {
+		count += bvm_gl_metrics.gc_pauses[i];
+		metrics_printf("babe_gc_pause_seconds_bucket{le=\"%s\"} %lu\n", metrics_pause_labels[i], (unsigned long) count);
+	}
+	metrics_seconds("babe_gc_pause_seconds_sum", stats.total_pause_time);
+	metrics_printf("babe_gc_pause_seconds_count %lu\n", (unsigned long) count);
+
+	metrics_describe("babe_gc_pause_max_seconds", "gauge", "The longest pause of any GC.");
+	metrics_seconds("babe_gc_pause_max_seconds", stats.max_pause_time);
+
+	/* a blocked thread may also be marked as waiting - blocked is what it is waiting for now */
+	for (vmthread = bvm_gl_threads; vmthread != NULL; vmthread = vmthread->next) {
+		bvm_uint32_t status = vmthread->status;
+		if (status & BVM_THREAD_STATUS_TERMINATED) states[5]++;
+		else if (status & BVM_THREAD_STATUS_BLOCKED) states[2]++;
+		else if (status & BVM_THREAD_STATUS_TIMED_WAITING) states[4]++;
+		else if (status & BVM_THREAD_STATUS_WAITING) states[3]++;
+		else if (status & BVM_THREAD_STATUS_NEW) states[0]++;
+		else states[1]++;
+	}
+
+	metrics_describe("babe_threads", "gauge", "The number of threads in each state.");
+	for (i = 0; i < 6; i++)
+		metrics_printf("babe_threads{state=\"%s\"} %lu\n", state_names[i], (unsigned long) states[i]);
+
+	metrics_value("babe_classes", "gauge", "The number of clazzes loaded.", bvm_gl_clazz_pool_count);
+
+	metrics_value("babe_monitors", "gauge", "The number of monitors allocated.", bvm_gl_metrics.monitors);
+	metrics_value("babe_monitors_in_use", "gauge", "The number of monitors bound to an object.",
+				  bvm_gl_metrics.monitors_in_use);
+
+#if BVM_THREAD_ACCOUNTING_ENABLE
+	/* last, as the per-thread lines are cut short if there are too many threads to fit */
+	metrics_threads();
+#endif
+}
+
+/**
+ * Writes all of a block of bytes to a socket.
+ *
+ * @param fd the socket
+ * @param data the bytes to write
+ * @param length the number of bytes to write
+ *
+ * @return #BVM_TRUE if the bytes were written, #BVM_FALSE if not.
+ */
+static bvm_bool_t metrics_write(bvm_int32_t fd, const char *data, bvm_uint32_t length) {
+
+	while (length > 0) {
+
+		bvm_int32_t written = bvm_pd_socket_write(fd, data, (bvm_int32_t) length);
+
+		if (written <= 0) return BVM_FALSE;
+
+		data += written;
+		length -= (bvm_uint32_t) written;
+	}
+
+	return BVM_TRUE;
+}
+
+/**
+ * Answers a connected metrics client.  Its request is read and ignored, and a snapshot of the metrics is written back
+ * as an HTTP response.
+ *
+ * @param fd the client socket
+ */
+static void metrics_serve(bvm_int32_t fd) {
+
+	char header[128];
+	bvm_uint32_t header_length;
+	bvm_pd_socket_poll_t poll;
+
+	/* the request is not looked at, but it is read so closing the connection does not reset it */
+	poll.fd = fd;
+	poll.events = BVM_SOCKET_POLL_READ;
+
+	if ( (bvm_pd_socket_poll(&poll, 1, BVM_METRICS_REQUEST_TIMEOUT) > 0) && (poll.ready & BVM_SOCKET_POLL_READ) )
+		bvm_pd_socket_recv(fd, metrics_buffer, METRICS_BUFFER_SIZE);
+
+	metrics_length = 0;
+	metrics_snapshot();
+
+	header_length = (bvm_uint32_t) sprintf(header,
+			"HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %lu\r\n\r\n",
+			(unsigned long) metrics_length);
+
+	if (metrics_write(fd, header, header_length))
+		metrics_write(fd, metrics_buffer, metrics_length);
+}
+
+/**
+ * Answers a metrics client if one has connected.  Does not wait for one.
+ */
+void bvm_metrics_interact() {
+
+	bvm_pd_socket_poll_t poll;
+	bvm_int32_t fd;
+
+	if (bvm_gl_metrics_socket < 0) return;
+
+	poll.fd = bvm_gl_metrics_socket;
+	poll.events = BVM_SOCKET_POLL_READ;
+
+	if ( (bvm_pd_socket_poll(&poll, 1, 0) <= 0) || !(poll.ready & BVM_SOCKET_POLL_READ) ) return;
+
+	/* the connection is already waiting, so this does not wait */
+	fd = bvm_pd_socket_server_accept(bvm_gl_metrics_socket, 0);
+
+	if (fd == BVM_SOCKET_ERROR) return;
+
+	metrics_serve(fd);
+
+	bvm_pd_socket_close(fd);
+}
+
+#endif
@@ -39,8 +39,15 @@
  * int hashCode()
  */
 void java_lang_Object_hashCode(void *args) {
+#if BVM_OBJECT_IDENTITY_HASH_ENABLE
+	bvm_obj_t *obj = (bvm_obj_t *) NI_GetParameterAsObject(0);
+
+	/* System.identityHashCode(null) is zero */
+	NI_ReturnInt( (obj == NULL) ? 0 : bvm_object_identity_hash(obj));
+#else
     // treat memory location as its hashcode.  Will not give exact address on 64 bit as int is 32 bit.
 	NI_ReturnInt(NI_GetParameterAsInt(0));
+#endif
 }
 
 /*
@@ -60,7 +67,7 @@ void java_lang_Object_wait(void *args) {
 	bvm_monitor_t *monitor;
 
 	/* param 0 is the object with the monitor to wait on*/
-	bvm_obj_t *obj = NI_GetParameterAsObject(0);
+	bvm_obj_t *obj = (bvm_obj_t *) NI_GetParameterAsObject(0);
 
 	/* param 1 is the *long* length of time to wait (it takes two cells)*/
     wait_time = NI_GetParameterAsLong(1);
@@ -69,7 +76,8 @@ void java_lang_Object_wait(void *args) {
 	if (!BVM_INT64_zero_ge(wait_time))
 		bvm_throw_exception(BVM_ERR_ILLEGAL_ARGUMENT_EXCEPTION, "timeout negative");
 
-	monitor = get_monitor_for_obj(obj);
+	/* a waiting thread needs a monitor to wait in */
+	monitor = bvm_thread_monitor_inflate(obj);
 
 	/* monitor is not owned by the current thread?  Whoops */
 	if ( (monitor == NULL) || (monitor->owner_thread != bvm_gl_thread_current) )
@@ -85,15 +93,18 @@ void java_lang_Object_wait(void *args) {
  */
 void java_lang_Object_notify(void *args) {
 
-	bvm_obj_t *obj = NI_GetParameterAsObject(0);
+	bvm_obj_t *obj = (bvm_obj_t *) NI_GetParameterAsObject(0);
 
-	bvm_monitor_t *monitor = get_monitor_for_obj(obj);
+	bvm_monitor_t *monitor;
 
-	/* monitor is not owned by the current thread?  Whoops */
-	if ( (monitor == NULL) || (monitor->owner_thread != bvm_gl_thread_current) )
+	/* lock is not owned by the current thread?  Whoops */
+	if (!bvm_thread_monitor_is_owner(obj, bvm_gl_thread_current))
 		bvm_throw_exception(BVM_ERR_ILLEGAL_MONITOR_STATE_EXCEPTION, NULL);
 
-	bvm_thread_notify(monitor, BVM_FALSE);
+	/* a thin lock has no monitor and so no waiting threads to notify */
+	monitor = get_monitor_for_obj(obj);
+	if (monitor != NULL)
+		bvm_thread_notify(monitor, BVM_FALSE);
 
 	NI_ReturnVoid();
 }
@@ -103,15 +114,18 @@ void java_lang_Object_notify(void *args) {
  */
 void java_lang_Object_notifyAll(void *args) {
 
-	bvm_obj_t *obj = NI_GetParameterAsObject(0);
+	bvm_obj_t *obj = (bvm_obj_t *) NI_GetParameterAsObject(0);
 
-	bvm_monitor_t *monitor = get_monitor_for_obj(obj);
+	bvm_monitor_t *monitor;
 
-	/* monitor is not owned by the current thread?  Whoops */
-	if ( (monitor == NULL) || (monitor->owner_thread != bvm_gl_thread_current) )
+	/* lock is not owned by the current thread?  Whoops */
+	if (!bvm_thread_monitor_is_owner(obj, bvm_gl_thread_current))
 		bvm_throw_exception(BVM_ERR_ILLEGAL_MONITOR_STATE_EXCEPTION, NULL);
 
-	bvm_thread_notify(monitor, BVM_TRUE);
+	/* a thin lock has no monitor and so no waiting threads to notify */
+	monitor = get_monitor_for_obj(obj);
+	if (monitor != NULL)
+		bvm_thread_notify(monitor, BVM_TRUE);
 
 	NI_ReturnVoid();
 }
@@ -123,14 +137,14 @@ void java_lang_Object_clone(void *args) {
 
 	void *newobj;
 
-	bvm_obj_t *obj = NI_GetParameterAsObject(0);
+	bvm_obj_t *obj = (bvm_obj_t *) NI_GetParameterAsObject(0);
 
 	/* it better implement cloneable or CloneNotSupportedException */
 	if (!bvm_clazz_implements_interface((bvm_instance_clazz_t *) obj->clazz,
 			(bvm_instance_clazz_t *) bvm_clazz_get_c(BVM_BOOTSTRAP_CLASSLOADER_OBJ, "java/lang/Cloneable")))
 		bvm_throw_exception(BVM_ERR_CLONE_NOT_SUPPORTED_EXCEPTION, NULL);
 
-	newobj = bvm_heap_clone(obj);
+	newobj = bvm_object_clone(obj);
 
 	NI_ReturnObject(newobj);
 }
@@ -214,30 +228,11 @@ void java_lang_Class_newInstance(void *args) {
 
 static bvm_class_obj_t *class_forname(bvm_string_obj_t *string_obj, bvm_classloader_obj_t *classloader_obj) {
 
-	bvm_clazz_t *clazz;
-
-	bvm_utfstring_t *utfstring;
-
     // TODO.  Likely should throw a class not found exception if the class name has any forward or backward
     //  slashes in it.  That would affect where it loads from.
 
-	/* copy the char array to the utfstring - space allocated from the heap*/
-	utfstring = bvm_str_unicode_to_utfstring(string_obj->chars->data, string_obj->offset.int_value, string_obj->length.int_value);
-	BVM_MAKE_TRANSIENT_ROOT(utfstring);
-
-	/* replace '.'s in class name with '/'s - turn a class name into an
-	 * internalised class name. */
-	bvm_str_replace_char( (char *) utfstring->data, utfstring->length, '.', '/');
-
-	/* get the clazz reflectively */
-	clazz = bvm_clazz_get_by_reflection(classloader_obj, utfstring);
-
-	/* free up the temp memory we have used.  If get_clazz_by_reflection throws an exception
-	 * and we don't get free it now, the temp string 'utfstring' will be freed in the next GC */
-	bvm_heap_free(utfstring);
-
 	/* now that we have loaded the clazz, return the Class object that represents it .. */
-	return clazz->class_obj;
+	return bvm_clazz_get_by_name_string(classloader_obj, string_obj)->class_obj;
 }
 
 /*
@@ -339,6 +334,11 @@ void java_lang_Class_doclinit(void *args) {
 			                   BVM_METHOD_SEARCH_CLAZZ);
 
 	if (method != NULL) {
+
+#if BVM_PROFILER_STARTUP_TRACE_ENABLE
+		bvm_profiler_startup_clinit_begin(clazz);
+#endif
+
 		/* remove the __doclinit method from the stack */
 		bvm_frame_pop();
 
@@ -381,6 +381,12 @@ void java_lang_Class_setState(void *args) {
 	/* second arg is the new clazz state */
 	clazz->state = NI_GetParameterAsInt(1);
 
+#if BVM_PROFILER_STARTUP_TRACE_ENABLE
+	/* the end of a <clinit>, if the clazz had one */
+	if (clazz->state == BVM_CLAZZ_STATE_INITIALISED || clazz->state == BVM_CLAZZ_STATE_ERROR)
+		bvm_profiler_startup_clinit_end(clazz);
+#endif
+
 	NI_ReturnVoid();
 }
 
@@ -403,6 +409,7 @@ void java_lang_Class_getName(void *args) {
 	 * the qualified class name (that is, replace all '/' with '.') */
 	bvm_utfstring_t s;
 	s.length = clazz->name->length;
+	s.hash = 0;
 	s.data = bvm_heap_alloc(s.length+1, BVM_ALLOC_TYPE_DATA); /* extra '1' is for null terminator */
 	BVM_MAKE_TRANSIENT_ROOT(s.data);
 
@@ -448,6 +455,49 @@ void java_lang_Runtime_freeMemory(void *args) {
 	NI_ReturnLong(l64);
 }
 
+#if BVM_GC_STATS_ENABLE
+
+/*
+ * void gcStats0(long[] stats)
+ *
+ * Fill the given array with the collector statistics (see bvm_gc_stats_t) - as many as it will hold, in this order:
+ * collections, last mark time, last sweep time, last pause time, max pause time, total pause time, last bytes
+ * reclaimed, largest free chunk, free chunk count, and then the last bytes reclaimed for each alloc type.  Times are in
+ * milliseconds.
+ */
+void java_lang_Runtime_gcStats0(void *args) {
+
+	bvm_jlong_array_obj_t *array = NI_GetParameterAsObject(0);
+	bvm_gc_stats_t stats;
+	bvm_uint32_t values[9 + BVM_ALLOC_MAX_TYPE + 1];
+	bvm_uint32_t i;
+
+	if (array == NULL)
+		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+
+	bvm_gc_get_stats(&stats);
+
+	values[0] = stats.collections;
+	values[1] = stats.last_mark_time;
+	values[2] = stats.last_sweep_time;
+	values[3] = stats.last_pause_time;
+	values[4] = stats.max_pause_time;
+	values[5] = stats.total_pause_time;
+	values[6] = stats.last_reclaimed;
+	values[7] = stats.largest_free;
+	values[8] = stats.free_chunks;
+
+	for (i = 0; i <= BVM_ALLOC_MAX_TYPE; i++)
+		values[9 + i] = stats.last_reclaimed_by_type[i];
+
+	for (i = 0; (i < (bvm_uint32_t) array->length.int_value) && (i < (sizeof(values) / sizeof(values[0]))); i++)
+		BVM_INT64_uint32_to_int64(array->data[i], values[i]);
+
+	NI_ReturnVoid();
+}
+
+#endif
+
 /*
  * long totalMemory()
  */
@@ -463,7 +513,7 @@ void java_lang_Runtime_totalMemory(void *args) {
  */
 void java_lang_Runtime_gc(void *args) {
     UNUSED(args);
-	bvm_gc();
+	bvm_gc_full();
 	NI_ReturnVoid();
 }
 
@@ -486,6 +536,54 @@ void java_lang_Runtime_exit0(void *args) {
  * java.lang.System
  **************************************************************************************************/
 
+#if BVM_NATIVE_ARRAYCOPY_SPECIALISED_ENABLE
+
+/* Copies of up to this many elements are done inline, without calling memmove/memcpy */
+#define NATIVE_ARRAYCOPY_INLINE_MAX	8
+
+/* An element at a time copy of 'length' elements of type T - backwards if the ranges overlap with the destination
+ * after the source */
+#define NATIVE_ARRAYCOPY_INLINE(T) {															\
+	T *d = (T *) dest;																			\
+	T *s = (T *) src;																			\
+	bvm_int32_t lc;																				\
+	if (may_overlap && (d > s))																	\
+		for (lc = length; lc--;) d[lc] = s[lc];													\
+	else																						\
+		for (lc = 0; lc < length; lc++) d[lc] = s[lc];											\
+}
+
+/**
+ * Copies array elements of a given size.  A short copy is done inline, a longer one by \c memcpy, or by
+ * \c memmove if the ranges may overlap.
+ *
+ * @param dest the address of the first destination element
+ * @param src the address of the first source element
+ * @param typesize the size of each element
+ * @param length the number of elements
+ * @param may_overlap whether the source and destination are the same array
+ */
+static void native_copy_elements(void *dest, void *src, bvm_uint32_t typesize, bvm_int32_t length, bvm_bool_t may_overlap) {
+
+	if (length <= NATIVE_ARRAYCOPY_INLINE_MAX) {
+		switch (typesize) {
+			case 1: NATIVE_ARRAYCOPY_INLINE(bvm_uint8_t); return;
+			case 2: NATIVE_ARRAYCOPY_INLINE(bvm_uint16_t); return;
+			case 4: NATIVE_ARRAYCOPY_INLINE(bvm_uint32_t); return;
+#if BVM_NATIVE_INT64_ENABLE
+			case 8: NATIVE_ARRAYCOPY_INLINE(bvm_uint64_t); return;
+#endif
+		}
+	}
+
+	if (may_overlap)
+		memmove(dest, src, typesize * length);
+	else
+		memcpy(dest, src, typesize * length);
+}
+
+#endif
+
 /**
   Raw byte copy of all contents of an array object to another array object.  No checking at all.  None.
   This code assumes the types of both arrays are the same, and thus, the byte length of each
@@ -505,20 +603,27 @@ static void bvm_raw_copy_array_contents(void *src_array_obj,
     srcPtr = ((bvm_uint8_t *) ((bvm_jbyte_array_obj_t *)src_array_obj)->data) + (typesize * srcPos);
     destPtr = ((bvm_uint8_t *) ((bvm_jbyte_array_obj_t *)dest_array_obj)->data) + (typesize * destPos);
 
+#if BVM_NATIVE_ARRAYCOPY_SPECIALISED_ENABLE
+    native_copy_elements(destPtr, srcPtr, typesize, length, (src_array_obj == dest_array_obj));
+#else
     memmove(destPtr, srcPtr, typesize * length);
+#endif
 }
 
-/*
- * static void arraycopy(Object src, int srcPos, Object dest, int destPos, int length)
+/**
+ * Copies elements from one array to another as \c System.arraycopy does, throwing the same exceptions.  Shared by the
+ * native method and its interpreter intrinsic (see #BVM_EXEC_INTRINSICS_ENABLE).
+ *
+ * @param src the source array
+ * @param srcPos the index of the first element to copy from \c src
+ * @param dest the destination array
+ * @param destPos the index in \c dest to copy the first element to
+ * @param length the number of elements to copy
  */
-void java_lang_System_arraycopy(void *args) {
+void bvm_native_arraycopy(bvm_obj_t *src, bvm_int32_t srcPos, bvm_obj_t *dest, bvm_int32_t destPos, bvm_int32_t length) {
 
-	/* Gather info from the method args */
-	bvm_jbyte_array_obj_t *src_array_obj  = NI_GetParameterAsObject(0);
-	jint srcPos 		   = NI_GetParameterAsInt(1);
-	bvm_jbyte_array_obj_t *dest_array_obj = NI_GetParameterAsObject(2);
-	jint destPos 		   = NI_GetParameterAsInt(3);
-	jint length            = NI_GetParameterAsInt(4);
+	bvm_jbyte_array_obj_t *src_array_obj  = (bvm_jbyte_array_obj_t *) src;
+	bvm_jbyte_array_obj_t *dest_array_obj = (bvm_jbyte_array_obj_t *) dest;
 
 	/*
 	 * JVMS - "If dest is null, then a NullPointerException is thrown.
@@ -567,6 +672,20 @@ void java_lang_System_arraycopy(void *args) {
 		bvm_throw_exception(BVM_ERR_ARRAY_INDEX_OUT_OF_BOUNDS_EXCEPTION, NULL);
 	}
 
+#if BVM_SCOPED_MEMORY_ENABLE
+	/* no reference to a scoped object may be copied anywhere it may outlive its scope.  Checked before anything is copied
+	 * so the destination is not modified. */
+	if ( (bvm_gl_scopes_entered != NULL) && (src_array_obj->clazz->component_jtype <= BVM_T_ARRAY) ) {
+
+		bvm_int32_t lc;
+
+		for (lc = 0; lc < length; lc++) {
+			if (BVM_SCOPE_IsEscape(dest_array_obj, BVM_REF_Decode(((bvm_instance_array_obj_t *)src_array_obj)->data[srcPos + lc])))
+				bvm_throw_exception(BVM_ERR_ILLEGAL_STATE_EXCEPTION, NULL);
+		}
+	}
+#endif
+
 	/* Element by element compatibility checking will not have to be done if :
 	 *
 	 * 1) The elements are primitive
@@ -579,28 +698,75 @@ void java_lang_System_arraycopy(void *args) {
 		(bvm_clazz_is_assignable_from((bvm_clazz_t *) src_array_obj->clazz->component_clazz,
 		                     (bvm_clazz_t *) dest_array_obj->clazz->component_clazz))) {
         bvm_raw_copy_array_contents(src_array_obj, dest_array_obj, srcPos, destPos, length);
+
+        /* references copied in bulk may be to new objects */
+        if (src_array_obj->clazz->component_jtype <= BVM_T_ARRAY) BVM_GC_WRITE_BARRIER_BULK(dest_array_obj);
     }
 	else {
+#if BVM_NATIVE_ARRAYCOPY_SPECIALISED_ENABLE
+		/* else array is reference type so each element must be checked as compatible before it is copied.  Elements
+		 * tend to come in runs of the same clazz, so the clazz last found compatible is not checked again.  The
+		 * arrays cannot be the same array, so the checked elements are copied at once.  If one is not compatible,
+		 * those before it are still copied, as System.arraycopy requires. */
+		bvm_ref_t *src_data = &((bvm_instance_array_obj_t *)src_array_obj)->data[srcPos];
+		bvm_clazz_t *dest_component_clazz = dest_array_obj->clazz->component_clazz;
+		bvm_clazz_t *compatible_clazz = dest_component_clazz;
+		bvm_int32_t checked;
+
+		for (checked = 0; checked < length; checked++) {
+
+			bvm_obj_t *element_obj = BVM_REF_Decode(src_data[checked]);
+
+			if ( (element_obj != NULL) && (element_obj->clazz != compatible_clazz) ) {
+				if (!bvm_clazz_is_assignable_from((bvm_clazz_t *) element_obj->clazz, dest_component_clazz))
+					break;
+				compatible_clazz = element_obj->clazz;
+			}
+		}
+
+		if (checked > 0) {
+			native_copy_elements(&((bvm_instance_array_obj_t *)dest_array_obj)->data[destPos], src_data,
+								 sizeof(bvm_ref_t), checked, BVM_FALSE);
+			BVM_GC_WRITE_BARRIER_BULK(dest_array_obj);
+		}
+
+		if (checked < length)
+			bvm_throw_exception(BVM_ERR_ARRAYSTORE_EXCEPTION, NULL);
+#else
 		/* else array is reference type so loop through each element to be copied and
-		 * check that each is compatible before copying it.  Yes, SLOW, but absolutely necessary. */
+		 * check that each is compatible before copying it.  Yes, SLOW, but absolutely necessary.  Elements
+		 * tend to be of few clazzes, so the clazz last found compatible is not checked again. */
 		int lc;
+		bvm_clazz_t *compatible_clazz = dest_array_obj->clazz->component_clazz;
 
 		for (lc = length; lc--;) {
 
 			/* get the object from the src array to be copied into the dest array */
-			bvm_obj_t *element_obj = ((bvm_instance_array_obj_t *)src_array_obj)->data[srcPos + lc];
+			bvm_obj_t *element_obj = BVM_REF_Decode(((bvm_instance_array_obj_t *)src_array_obj)->data[srcPos + lc]);
 
 			/* if the src and dest are not assignment compatible, throw an exception */
-			if (element_obj != NULL) {
+			if ( (element_obj != NULL) && (element_obj->clazz != compatible_clazz) ) {
 				if (!bvm_clazz_is_assignable_from((bvm_clazz_t *)element_obj->clazz,
 										 (bvm_clazz_t *)dest_array_obj->clazz->component_clazz))
 					bvm_throw_exception(BVM_ERR_ARRAYSTORE_EXCEPTION, NULL);
+				compatible_clazz = element_obj->clazz;
 			}
 
 			/* if all okay, copy src to dest */
 			((bvm_instance_array_obj_t *)dest_array_obj)->data[destPos + lc] = ((bvm_instance_array_obj_t *)src_array_obj)->data[srcPos + lc];
+			BVM_GC_WRITE_BARRIER(dest_array_obj, element_obj);
 		}
+#endif
 	}
+}
+
+/*
+ * static void arraycopy(Object src, int srcPos, Object dest, int destPos, int length)
+ */
+void java_lang_System_arraycopy(void *args) {
+
+	bvm_native_arraycopy(NI_GetParameterAsObject(0), NI_GetParameterAsInt(1), NI_GetParameterAsObject(2),
+			NI_GetParameterAsInt(3), NI_GetParameterAsInt(4));
 
 	NI_ReturnVoid();
 }
@@ -624,21 +790,23 @@ void java_lang_System_currentTimeMillis(void *args) {
 void java_lang_String_intern(void *args) {
 
 	bvm_internstring_obj_t *internstring_obj;
+	bvm_utfstring_t *utfstr;
 
 	bvm_string_obj_t *string_obj = NI_GetParameterAsObject(0);
 
-	/* create a new utfstring based on the String's contents.  The utfstring is
-	 * allocated from the heap */
-	bvm_utfstring_t *utfstr = bvm_str_unicode_to_utfstring(string_obj->chars->data, string_obj->offset.int_value, string_obj->length.int_value);
-	BVM_MAKE_TRANSIENT_ROOT(utfstr);
+	/* look for the chars in the pool as they are - a String that is already interned costs no allocation */
+	internstring_obj = bvm_internstring_pool_get_chars(string_obj->chars->data + string_obj->offset.int_value,
+									string_obj->length.int_value, (bvm_uint32_t) bvm_string_hash_code(string_obj));
+
+	if (internstring_obj == NULL) {
 
-	/* get the string from the pool.  If it is not there add it. */
-	internstring_obj = bvm_internstring_pool_get(utfstr, BVM_TRUE);
+		/* create a new utfstring based on the String's contents.  The utfstring is
+		 * allocated from the heap and becomes the utfstring of the interned string */
+		utfstr = bvm_str_unicode_to_utfstring(string_obj->chars->data, string_obj->offset.int_value, string_obj->length.int_value);
+		BVM_MAKE_TRANSIENT_ROOT(utfstr);
 
-	/* If the utfstring we get back it is not the same as the utfstring we passed in, then
-	 * it must have already  been in the pool.  So lets clean up. The GC would get it
-	 * later anyways, but better sooner I reckon */
-	if (internstring_obj->utfstring != utfstr) bvm_heap_free(utfstr);
+		internstring_obj = bvm_internstring_pool_add(utfstr);
+	}
 
 	NI_ReturnObject(internstring_obj);
 }
@@ -647,73 +815,14 @@ void java_lang_String_intern(void *args) {
 * public int hashCode();
  */
 void java_lang_String_hashCode(void *args) {
-
-	jint i, h, len;
-
-	bvm_string_obj_t *string_obj = NI_GetParameterAsObject(0);
-	bvm_jchar_array_obj_t *char_array_obj = string_obj->chars;
-
-	h = 0;
-	len = string_obj->length.int_value + string_obj->offset.int_value;
-
-	for (i = string_obj->offset.int_value; i < len; i++) {
-		h = 31 * h + char_array_obj->data[i];
-	}
-
-	NI_ReturnInt(h);
+	NI_ReturnInt(bvm_string_hash_code(NI_GetParameterAsObject(0)));
 }
 
 /*
  * public boolean equals(Object obj);
  */
 void java_lang_String_equals(void *args) {
-
-	/* this */
-	bvm_string_obj_t *this_obj = NI_GetParameterAsObject(0);
-
-	/* assume argument is a string .. saves a bit of typecasting later */
-	bvm_string_obj_t *other_string_obj = NI_GetParameterAsObject(1);
-
-	/* if it is the same object, all good */
-	if (this_obj == other_string_obj) {
-		NI_ReturnBoolean(BVM_TRUE);
-		return;
-	}
-
-	/* if it is not actually a string, forget it */
-	if (!bvm_clazz_is_instanceof( (bvm_obj_t *) other_string_obj, (bvm_clazz_t *) BVM_STRING_CLAZZ)) {
-		NI_ReturnBoolean(BVM_FALSE);
-		return;
-	}
-
-	/* a quick length check, they cannot be the equal if the have different lengths! */
-	if (this_obj->length.int_value != other_string_obj->length.int_value) {
-		NI_ReturnBoolean(BVM_FALSE);
-		return;
-	}
-
-	/* .. and finally check equality of all the chars in their respective char arrays */
-	{
-		int i;
-
-		jint toffset = this_obj->offset.int_value;
-		jint ooffset = other_string_obj->offset.int_value;
-
-		bvm_jchar_array_obj_t *tchar_array_obj = this_obj->chars;
-		bvm_jchar_array_obj_t *ochar_array_obj = other_string_obj->chars;
-
-		jint l = this_obj->length.int_value;
-
-		for (i = 0; i < l; i++) {
-			if (tchar_array_obj->data[i + toffset] != ochar_array_obj->data[i + ooffset]) {
-				NI_ReturnBoolean(BVM_FALSE);
-				return;
-			}
-		}
-
-	}
-
-	NI_ReturnBoolean(BVM_TRUE);
+	NI_ReturnBoolean(bvm_string_equals(NI_GetParameterAsObject(0), NI_GetParameterAsObject(1)));
 }
 
 /*
@@ -749,14 +858,7 @@ void java_lang_String_startsWith(void *args) {
 		return;
 	}
 
-	while (--pl >= 0) {
-		if (tchar_array_obj->data[tindex++] != pchar_array_obj->data[pindex++]) {
-			NI_ReturnBoolean(BVM_FALSE);
-			return;
-		}
-	}
-
-	NI_ReturnBoolean(BVM_TRUE);
+	NI_ReturnBoolean(memcmp(&tchar_array_obj->data[tindex], &pchar_array_obj->data[pindex], pl * sizeof(bvm_uint16_t)) == 0);
 }
 
 /*
@@ -788,8 +890,6 @@ void java_lang_String_indexOf(void *args) {
 	jint len = this_obj->length.int_value;
 	jint offset = this_obj->offset.int_value;
 
-	jint limit = offset + len;
-
 	if (fromIndex < 0) {
 		fromIndex = 0;
 	} else if (fromIndex >= len) {
@@ -797,13 +897,15 @@ void java_lang_String_indexOf(void *args) {
 		return;
 	}
 
-	for (i = fromIndex + offset; i < limit; i++) {
-		if (char_aray_obj->data[i] == ch) {
-			NI_ReturnInt(i - offset);
-			return;
-		}
+	/* a char outside of 16 bits is never found */
+	if ( (ch & ~0xFFFF) != 0) {
+		NI_ReturnInt(-1);
+		return;
 	}
-	NI_ReturnInt(-1);
+
+	i = bvm_str_jchar_index_of(&char_aray_obj->data[offset + fromIndex], len - fromIndex, (bvm_uint16_t) ch);
+
+	NI_ReturnInt( (i < 0) ? -1 : i + fromIndex);
 }
 
 /*
@@ -827,14 +929,17 @@ void java_lang_String_lastIndexOf(void *args) {
 	jint offset = this_obj->offset.int_value;
 	jint length = this_obj->length.int_value;
 
-	for (i = offset + ((fromIndex >= length) ? length - 1 : fromIndex); i >= offset; i--) {
-		if (char_aray_obj->data[i + offset] == ch) {
-			NI_ReturnInt(i - offset);
-			return;
-		}
+	if (fromIndex >= length) fromIndex = length - 1;
+
+	/* nothing before the start, and a char outside of 16 bits is never found */
+	if ( (fromIndex < 0) || ( (ch & ~0xFFFF) != 0) ) {
+		NI_ReturnInt(-1);
+		return;
 	}
 
-	NI_ReturnInt(-1);
+	i = bvm_str_jchar_last_index_of(&char_aray_obj->data[offset], fromIndex + 1, (bvm_uint16_t) ch);
+
+	NI_ReturnInt(i);
 }
 
 /*
@@ -848,10 +953,10 @@ void java_lang_String_charAt(void *args) {
 	/* index */
 	jint i = NI_GetParameterAsInt(1);
 
-	if ((i < this_obj->offset.int_value) || (i - this_obj->offset.int_value >= this_obj->length.int_value))
+	if ((i < 0) || (i >= this_obj->length.int_value))
 		bvm_throw_exception(BVM_ERR_ARRAY_INDEX_OUT_OF_BOUNDS_EXCEPTION, NULL);
 
-	NI_ReturnInt(this_obj->chars->data[i]);
+	NI_ReturnInt(this_obj->chars->data[this_obj->offset.int_value + i]);
 }
 
 /***************************************************************************************************
@@ -870,6 +975,7 @@ void java_lang_String_charAt(void *args) {
 static void unshare_buffer(bvm_stringbuffer_obj_t *stringbuffer_obj) {
 
 	stringbuffer_obj->chars = (bvm_jchar_array_obj_t *) bvm_heap_clone(stringbuffer_obj->chars);
+	BVM_GC_WRITE_BARRIER(stringbuffer_obj, stringbuffer_obj->chars);
 	stringbuffer_obj->is_shared.int_value = BVM_FALSE;
 }
 
@@ -898,6 +1004,7 @@ static void expand_buffer(bvm_stringbuffer_obj_t *stringbuffer_obj, jint newleng
 		/* copy the old contents into it */
 		memcpy(char_array_obj->data, stringbuffer_obj->chars->data, stringbuffer_obj->length.int_value * sizeof(bvm_uint16_t));
 		stringbuffer_obj->chars = char_array_obj;
+		BVM_GC_WRITE_BARRIER(stringbuffer_obj, char_array_obj);
 
 		/* mark as unshared now .. */
 		stringbuffer_obj->is_shared.int_value = BVM_FALSE;
@@ -1077,6 +1184,104 @@ void java_lang_StringBuffer_append(void *args) {
 	NI_ReturnObject(stringbuffer_obj);
 }
 
+#if BVM_NATIVE_REPLACEMENT_ENABLE
+
+/**
+ * Formats the decimal digits of an integer magnitude backwards into a jchar buffer, ending just before a given
+ * position, with a leading '-' if it is negative.
+ *
+ * @param magnitude the absolute value of the integer
+ * @param negative whether the integer is negative
+ * @param end pointer to just past where the last digit goes
+ *
+ * @return the number of jchars formatted
+ */
+static jint stringbuffer_format_int(bvm_uint32_t magnitude, bvm_bool_t negative, jchar *end) {
+
+	jchar *c = end;
+
+	do {
+		*--c = (jchar) ('0' + (magnitude % 10));
+		magnitude /= 10;
+	} while (magnitude != 0);
+
+	if (negative) *--c = '-';
+
+	return (jint) (end - c);
+}
+
+/*
+ * StringBuffer append(int i)
+ *
+ * Replaces the class library bytecode, which appends the String given by Integer.toString(i).
+ */
+void java_lang_StringBuffer_append_int(void *args) {
+
+	/* enough for "-2147483648" */
+	jchar buf[11];
+
+	bvm_stringbuffer_obj_t *stringbuffer_obj = NI_GetParameterAsObject(0);
+	jint value = NI_GetParameterAsInt(1);
+
+	/* the magnitude is taken as unsigned so that MIN_INT needs no special case */
+	jint length = stringbuffer_format_int( (value < 0) ? 0U - (bvm_uint32_t) value : (bvm_uint32_t) value, value < 0, buf + 11);
+
+	stringbuffer_insert(stringbuffer_obj, stringbuffer_obj->length.int_value, buf, 11 - length, length);
+
+	NI_ReturnObject(stringbuffer_obj);
+}
+
+#if BVM_NATIVE_INT64_ENABLE
+
+/*
+ * StringBuffer append(long l)
+ *
+ * Replaces the class library bytecode, which appends the String given by Long.toString(l).
+ */
+void java_lang_StringBuffer_append_long(void *args) {
+
+	/* enough for "-9223372036854775808" */
+	jchar buf[20];
+	jchar *c = buf + 20;
+
+	bvm_stringbuffer_obj_t *stringbuffer_obj = NI_GetParameterAsObject(0);
+	jlong value = NI_GetParameterAsLong(1);
+
+	bvm_uint64_t magnitude = (value < 0) ? 0U - (bvm_uint64_t) value : (bvm_uint64_t) value;
+	jint length;
+
+	/* 64 bit division only while the remaining digits do not fit in 32 bits */
+	while (magnitude > 0xFFFFFFFFU) {
+		*--c = (jchar) ('0' + (jint) (magnitude % 10));
+		magnitude /= 10;
+	}
+
+	length = (jint) (buf + 20 - c) + stringbuffer_format_int((bvm_uint32_t) magnitude, value < 0, c);
+
+	stringbuffer_insert(stringbuffer_obj, stringbuffer_obj->length.int_value, buf, 20 - length, length);
+
+	NI_ReturnObject(stringbuffer_obj);
+}
+
+#endif
+
+/*
+ * StringBuffer append(char c)
+ *
+ * Replaces the class library bytecode, which appends the String given by String.valueOf(c).
+ */
+void java_lang_StringBuffer_append_char(void *args) {
+
+	bvm_stringbuffer_obj_t *stringbuffer_obj = NI_GetParameterAsObject(0);
+	jchar c = NI_GetParameterAsChar(1);
+
+	stringbuffer_insert(stringbuffer_obj, stringbuffer_obj->length.int_value, &c, 0, 1);
+
+	NI_ReturnObject(stringbuffer_obj);
+}
+
+#endif
+
 
 /***************************************************************************************************
  * java.lang.Integer
@@ -1107,6 +1312,101 @@ void java_lang_Integer_toString(void *args) {
 	NI_ReturnObject(string_obj);
 }
 
+#if BVM_NATIVE_BOX_CACHE_ENABLE
+
+/** The cached \c Integer boxes, from #BVM_NATIVE_BOX_INTEGER_MIN */
+BVM_VM_LOCAL bvm_obj_t *bvm_gl_native_integer_boxes[BVM_NATIVE_BOX_INTEGER_MAX - BVM_NATIVE_BOX_INTEGER_MIN + 1];
+
+/** The cached \c Character boxes, from zero */
+BVM_VM_LOCAL bvm_obj_t *bvm_gl_native_character_boxes[BVM_NATIVE_BOX_CHARACTER_MAX + 1];
+
+/** The \c _value fields of \c Integer and \c Character */
+static BVM_VM_LOCAL jfieldID integer_value_field;
+static BVM_VM_LOCAL jfieldID character_value_field;
+
+/**
+ * Ready the cache of \c Integer and \c Character boxes.  Called as the bootstrap objects are made.  The clazzes are
+ * loaded here but not initialised - a box is only given out by \c valueOf, and calling that initialises the clazz first.
+ *
+ * The boxes themselves are made on first use.  Each is made #BVM_ALLOC_TYPE_STATIC, and making all of them up front
+ * would scatter a few hundred chunks the GC can never coalesce across a small heap.
+ */
+void bvm_native_box_cache_init() {
+
+	bvm_clazz_t *integer_clazz = bvm_clazz_get_c(BVM_BOOTSTRAP_CLASSLOADER_OBJ, "java/lang/Integer");
+	bvm_clazz_t *character_clazz = bvm_clazz_get_c(BVM_BOOTSTRAP_CLASSLOADER_OBJ, "java/lang/Character");
+
+	integer_value_field = NI_GetFieldID(integer_clazz->class_obj, "_value", "I");
+	character_value_field = NI_GetFieldID(character_clazz->class_obj, "_value", "C");
+}
+
+/**
+ * Put a newly made box in the cache.  It is made #BVM_ALLOC_TYPE_STATIC - it lives as long as the VM and holds no
+ * references, so the GC need never look at it.
+ */
+static void native_box_cache_put(bvm_obj_t **slot, bvm_obj_t *box) {
+	bvm_heap_set_alloc_type(box, BVM_ALLOC_TYPE_STATIC);
+	*slot = box;
+}
+
+/*
+ * static Integer valueOf(int i)
+ *
+ * Replaces the class library bytecode, which always makes a new Integer.
+ */
+void java_lang_Integer_valueOf(void *args) {
+
+	jint value = NI_GetParameterAsInt(0);
+	bvm_obj_t **slot = NULL;
+	bvm_obj_t *box;
+
+	if ( (value >= BVM_NATIVE_BOX_INTEGER_MIN) && (value <= BVM_NATIVE_BOX_INTEGER_MAX) ) {
+		slot = &bvm_gl_native_integer_boxes[value - BVM_NATIVE_BOX_INTEGER_MIN];
+		if (*slot != NULL) {
+			NI_ReturnObject(*slot);
+			return;
+		}
+	}
+
+	box = bvm_object_alloc((bvm_instance_clazz_t *) bvm_gl_rx_clazz);
+	NI_SetIntField(box, integer_value_field, value);
+	if (slot != NULL) native_box_cache_put(slot, box);
+
+	NI_ReturnObject(box);
+}
+
+/***************************************************************************************************
+ * java.lang.Character
+ **************************************************************************************************/
+
+/*
+ * static Character valueOf(char c)
+ *
+ * Replaces the class library bytecode, which always makes a new Character.
+ */
+void java_lang_Character_valueOf(void *args) {
+
+	jchar value = NI_GetParameterAsChar(0);
+	bvm_obj_t **slot = NULL;
+	bvm_obj_t *box;
+
+	if (value <= BVM_NATIVE_BOX_CHARACTER_MAX) {
+		slot = &bvm_gl_native_character_boxes[value];
+		if (*slot != NULL) {
+			NI_ReturnObject(*slot);
+			return;
+		}
+	}
+
+	box = bvm_object_alloc((bvm_instance_clazz_t *) bvm_gl_rx_clazz);
+	NI_SetCharField(box, character_value_field, value);
+	if (slot != NULL) native_box_cache_put(slot, box);
+
+	NI_ReturnObject(box);
+}
+
+#endif
+
 /***************************************************************************************************
  * java.lang.Float
  **************************************************************************************************/
@@ -1115,19 +1415,24 @@ void java_lang_Integer_toString(void *args) {
 #if BVM_FLOAT_ENABLE
 
 /**
- * Converts a given double to a String.  Not an exact replication of the Java toString for float
+ * Formats a given double into a char buffer.
+ *
+ * With #BVM_FP_FAST_CONVERSION_ENABLE this is the Java form, with the shortest digits that read back as the same
+ * double.  Otherwise it is not an exact replication of the Java toString for float
  * and double, but a reasonable approximation.  All exceptional cases (like pos/neg infinity and
  * pos/neg zero) are handled, but this function produces more decimal places than
  * Java.
  *
  * @param d a given double
+ * @param buf a char buffer of at least 64 chars to place the nul terminated result
+ *
+ * @return the length of the result
  */
-static bvm_string_obj_t *double_tostring(jdouble d) {
-
-	bvm_utfstring_t temp_utfstring;
-
-	char buf[64];
+static int double_format(jdouble d, char *buf) {
 
+#if BVM_FP_FAST_CONVERSION_ENABLE
+	return bvm_fp_double_to_chars(d, buf);
+#else
 	int i;
 
 	jlong intv = * (jlong *) &d;
@@ -1197,8 +1502,36 @@ static bvm_string_obj_t *double_tostring(jdouble d) {
 		}
     }
 
-	/* wrap the new buffer in utfstring */
-	temp_utfstring = bvm_str_wrap_utfstring(buf);
+	return (int) strlen(buf);
+#endif
+}
+
+/**
+ * Formats a given float into a char buffer.  With #BVM_FP_FAST_CONVERSION_ENABLE the digits are the shortest
+ * that read back as the same float, otherwise the float is formatted as a double.
+ *
+ * @param f a given float
+ * @param buf a char buffer of at least 64 chars to place the nul terminated result
+ *
+ * @return the length of the result
+ */
+static int float_format(jfloat f, char *buf) {
+#if BVM_FP_FAST_CONVERSION_ENABLE
+	return bvm_fp_float_to_chars(f, buf);
+#else
+	return double_format((jdouble) f, buf);
+#endif
+}
+
+/**
+ * Creates a String from a formatted float or double.
+ *
+ * @param buf the nul terminated chars
+ */
+static bvm_string_obj_t *fp_chars_tostring(char *buf) {
+
+	/* wrap the buffer in utfstring */
+	bvm_utfstring_t temp_utfstring = bvm_str_wrap_utfstring(buf);
 
 	/* create a String object for our float number */
     return bvm_string_create_from_utfstring(&temp_utfstring, BVM_FALSE);
@@ -1208,8 +1541,9 @@ static bvm_string_obj_t *double_tostring(jdouble d) {
  * static String toString()
  */
 void java_lang_Float_toString(void *args) {
-    jfloat f  = NI_GetParameterAsFloat(0);
-	NI_ReturnObject(double_tostring((jdouble) f));
+	char buf[64];
+	float_format(NI_GetParameterAsFloat(0), buf);
+	NI_ReturnObject(fp_chars_tostring(buf));
 }
 
 /*
@@ -1233,11 +1567,121 @@ void java_lang_Float_floatToIntBits(void *args) {
  * static String toString()
  */
 void java_lang_Double_toString(void *args) {
-    bvm_double_t d = NI_GetParameterAsDouble(0);
-	NI_ReturnObject(double_tostring(d));
+	char buf[64];
+	double_format(NI_GetParameterAsDouble(0), buf);
+	NI_ReturnObject(fp_chars_tostring(buf));
 }
 
-/*
+#if (BVM_FP_FAST_CONVERSION_ENABLE && BVM_NATIVE_REPLACEMENT_ENABLE)
+
+/**
+ * Parses the String argument of \c Float.valueOf(String) or \c Double.valueOf(String) and boxes the result in
+ * a new object of the class of the running native - a \c Float or a \c Double.
+ *
+ * @param string_obj the String to parse
+ * @param is_float whether to make a Float
+ *
+ * @throws NullPointerException if the String is \c null
+ * @throws NumberFormatException if the String is not a floating point literal
+ */
+static bvm_obj_t *fp_value_of(bvm_string_obj_t *string_obj, bvm_bool_t is_float) {
+
+	jdouble d;
+	jfieldID field;
+	bvm_obj_t *obj;
+
+	if (string_obj == NULL)
+		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+
+	if (!bvm_fp_parse(&string_obj->chars->data[string_obj->offset.int_value], string_obj->length.int_value, is_float, &d))
+		bvm_throw_exception(BVM_ERR_NUMBER_FORMAT_EXCEPTION, NULL);
+
+	field = NI_GetFieldID(bvm_gl_rx_clazz->class_obj, "_value", is_float ? "F" : "D");
+
+	obj = bvm_object_alloc((bvm_instance_clazz_t *) bvm_gl_rx_clazz);
+
+	if (is_float)
+		NI_SetFloatField(obj, field, (jfloat) d);
+	else
+		NI_SetDoubleField(obj, field, d);
+
+	return obj;
+}
+
+/*
+ * static Double valueOf(String s)
+ *
+ * Replaces the class library bytecode, which throws NumberFormatException("Not yet implemented").
+ */
+void java_lang_Double_valueOf(void *args) {
+	NI_ReturnObject(fp_value_of(NI_GetParameterAsObject(0), BVM_FALSE));
+}
+
+/*
+ * static Float valueOf(String s)
+ *
+ * Replaces the class library bytecode, which throws NumberFormatException("Not yet implemented").
+ */
+void java_lang_Float_valueOf(void *args) {
+	NI_ReturnObject(fp_value_of(NI_GetParameterAsObject(0), BVM_TRUE));
+}
+
+#endif
+
+#if BVM_NATIVE_REPLACEMENT_ENABLE
+
+/**
+ * Appends a formatted float or double to a StringBuffer (or StringBuilder).
+ *
+ * @param stringbuffer_obj a StringBuffer object
+ * @param buf the formatted chars
+ * @param length the number of chars
+ */
+static void stringbuffer_append_fp(bvm_stringbuffer_obj_t *stringbuffer_obj, char *buf, jint length) {
+
+	jchar chars[64];
+	jint lc;
+
+	/* the formatted number is all ASCII */
+	for (lc = 0; lc < length; lc++)
+		chars[lc] = (jchar) buf[lc];
+
+	stringbuffer_insert(stringbuffer_obj, stringbuffer_obj->length.int_value, chars, 0, length);
+}
+
+/*
+ * StringBuffer append(double d)
+ *
+ * Replaces the class library bytecode, which appends the String given by Double.toString(d).
+ */
+void java_lang_StringBuffer_append_double(void *args) {
+
+	bvm_stringbuffer_obj_t *stringbuffer_obj = NI_GetParameterAsObject(0);
+	char buf[64];
+
+	stringbuffer_append_fp(stringbuffer_obj, buf, double_format(NI_GetParameterAsDouble(1), buf));
+
+	NI_ReturnObject(stringbuffer_obj);
+}
+
+/*
+ * StringBuffer append(float f)
+ *
+ * Replaces the class library bytecode, which appends the String given by Float.toString(f).
+ */
+void java_lang_StringBuffer_append_float(void *args) {
+
+	bvm_stringbuffer_obj_t *stringbuffer_obj = NI_GetParameterAsObject(0);
+	char buf[64];
+
+	stringbuffer_append_fp(stringbuffer_obj, buf, float_format(NI_GetParameterAsFloat(1), buf));
+
+	NI_ReturnObject(stringbuffer_obj);
+}
+
+#endif
+
+/*
  * static native int doubleToLongBits(float value)
  */
 void java_lang_Double_doubleToLongBits(void *args) {
@@ -1298,7 +1742,7 @@ void java_lang_Math_exp(void *args) {
  */
 void java_lang_Math_IEEEremainder(void *args) {
 	jdouble d1 = NI_GetParameterAsDouble(0);
-	jdouble d2 = NI_GetParameterAsDouble(1);
+	jdouble d2 = NI_GetParameterAsDouble(2);
 	NI_ReturnDouble(fmod(d1,d2));
 }
 
@@ -1315,12 +1759,45 @@ void java_io_Console_write(void *args) {
 
 #if BVM_CONSOLE_ENABLE
 	jbyte data = NI_GetParameterAsByte(1);
+#if BVM_CONSOLE_BUFFER_ENABLE
+	bvm_pd_console_write((char *) &data, 1);
+#else
 	bvm_pd_console_out("%c",data);
 #endif
+#endif
+
+	NI_ReturnVoid();
+}
+
+#if BVM_CONSOLE_BUFFER_ENABLE
+
+/*
+ * void write(byte[] b, int off, int len) throws IOException
+ *
+ * The class library declares this as \c native in \c java.io.Console (in place of the \c OutputStream
+ * default that writes a byte at a time).
+ */
+void java_io_Console_writeBytes(void *args) {
+
+#if BVM_CONSOLE_ENABLE
+	bvm_jbyte_array_obj_t *src_array_obj = NI_GetParameterAsObject(1);
+	jint offset = NI_GetParameterAsInt(2);
+	jint count  = NI_GetParameterAsInt(3);
+
+	if (src_array_obj == NULL)
+		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+
+	if ( (count < 0) || (offset < 0) || (count > src_array_obj->length.int_value - offset) )
+		bvm_throw_exception(BVM_ERR_INDEX_OUT_OF_BOUNDS_EXCEPTION, NULL);
+
+	bvm_pd_console_write((char *) &src_array_obj->data[offset], count);
+#endif
 
 	NI_ReturnVoid();
 }
 
+#endif
+
 /*
  * void println0(String s)
  */
@@ -1333,7 +1810,12 @@ void java_io_Console_println0(void *args) {
 	/* no string?  Null pointer Exception */
 	if (string_obj == NULL) bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
 
+#if BVM_CONSOLE_BUFFER_ENABLE
+	bvm_string_print_to_console(string_obj, NULL);
+	bvm_pd_console_write("\n", 1);
+#else
 	bvm_string_print_to_console(string_obj, "%s\n");
+#endif
 #endif
 	NI_ReturnVoid();
 }
@@ -1449,8 +1931,8 @@ void java_lang_Thread_isInterrupted(void *args) {
  */
 void java_lang_Thread_yield(void *args) {
     UNUSED(args);
-	/* setting to zero will cause a thread switch before the next bytecode is executed */
-	bvm_gl_thread_timeslice_counter = 0;
+	/* will cause a thread switch before the next bytecode is executed */
+	BVM_THREAD_REQUEST_SWITCH();
 	NI_ReturnVoid();
 }
 
@@ -1490,428 +1972,2476 @@ void java_lang_Thread_interrupt0(void *args) {
 	NI_ReturnVoid();
 }
 
-/***************************************************************************************************
- * java.lang.ref.WeakReference
- **************************************************************************************************/
+#if BVM_THREAD_ACCOUNTING_ENABLE
 
 /*
- * public native void makeweak();
+ * native long getCpuTime()
  *
+ * The nanoseconds the thread has run for - measured in microseconds.  Zero for a thread not yet started.
  */
-void java_lang_ref_WeakReference_makeweak(void *args) {
+void java_lang_Thread_getCpuTime(void *args) {
 
-	/* this */
-	bvm_weak_reference_obj_t *weak_reference_obj = NI_GetParameterAsObject(0);
+	bvm_int64_t l64, thousand;
+	bvm_thread_obj_t *thread_obj = NI_GetParameterAsObject(0);
 
-	/* change the GC alloc type from BVM_ALLOC_TYPE_OBJECT, to BVM_ALLOC_TYPE_WEAK_REFERENCE */
-	bvm_heap_set_alloc_type(weak_reference_obj, BVM_ALLOC_TYPE_WEAK_REFERENCE);
+	BVM_INT64_uint32_to_int64(l64, (thread_obj->vmthread == NULL) ? 0 : bvm_thread_cpu_micros(thread_obj->vmthread));
+	BVM_INT64_uint32_to_int64(thousand, 1000);
 
-	NI_ReturnVoid();
+	NI_ReturnLong(BVM_INT64_mul(l64, thousand));
+}
+
+/*
+ * native long getBytecodeCount()
+ *
+ * The bytecodes the thread has executed, as counted by its timeslice (see bvm_vmthread_t::bytecodes).  Zero for a
+ * thread not yet started.
+ */
+void java_lang_Thread_getBytecodeCount(void *args) {
+
+	bvm_int64_t l64;
+	bvm_thread_obj_t *thread_obj = NI_GetParameterAsObject(0);
+
+	BVM_INT64_uint32_to_int64(l64, (thread_obj->vmthread == NULL) ? 0 : bvm_thread_bytecodes(thread_obj->vmthread));
+
+	NI_ReturnLong(l64);
 }
 
+#endif
+
+#if BVM_THREAD_TASKS_ENABLE
 
 /***************************************************************************************************
- * java.nio.ByteOrder
+ * babe.lang.Task
+ *
+ * A Task is a Thread started with a small first stack segment and a pooled VM thread (see
+ * bvm_thread_create_task), so a program can have many more of them than of plain threads.  Any thread
+ * may yield until another resumes it, so tasks can hand control to each other as coroutines.  The Java
+ * class is expected to be:
+ *
+ *   public class Task extends Thread {
+ *       public Task() { super(); }
+ *       public Task(Runnable target) { super(target); }
+ *       public synchronized native void start();
+ *       public static void yieldTask() throws InterruptedException { yield0(); }
+ *       public void resume() { resume0(); }
+ *       private static native void yield0() throws InterruptedException;
+ *       private native void resume0();
+ *   }
  **************************************************************************************************/
 
 /*
- * static boolean isLittleEndian()
+ * synchronized void start()
  */
-void java_nio_ByteOrder_isLittleEndian(void *args) {
+void babe_lang_Task_start(void *args) {
+	bvm_vmthread_t *vmthread;
+	bvm_thread_obj_t *thread_obj = NI_GetParameterAsObject(0);
 
-    UNUSED(args);
+	vmthread = thread_obj->vmthread;
 
-#if (!BVM_BIG_ENDIAN_ENABLE)
-		NI_ReturnInt(BVM_TRUE);
-#else
-		NI_ReturnInt(BVM_FALSE);
-#endif
-}
+	/* a Task that has had its priority set already has a plain VM thread - it starts as a thread */
+	if (vmthread == NULL)
+		vmthread = bvm_thread_create_task(thread_obj);
 
-/***************************************************************************************************
- * babe.io.File
- **************************************************************************************************/
+	bvm_thread_start(vmthread, BVM_TRUE);
 
-typedef struct fileobjstruct {
-	BVM_COMMON_OBJ_INFO
-	jint native_handle;
-    jint flags;
-    jint flush_pending;
-} file_obj_t;
+	NI_ReturnVoid();
+}
 
 /*
- * flush a file if it needs it */
-static void flushfile(file_obj_t *file_obj) {
-
-	if (file_obj->flush_pending) {
-		if (bvm_file_flush(file_obj->native_handle) != 0)
-			bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
-		file_obj->flush_pending = BVM_FALSE;
-	}
+ * static void yield0() throws InterruptedException
+ */
+void babe_lang_Task_yield0(void *args) {
+	UNUSED(args);
+	bvm_thread_task_yield();
+	NI_ReturnVoid();
 }
 
 /*
- * static int open0(String filename, int flags)
+ * void resume0()
  */
-void babe_io_File_open0(void *args) {
+void babe_lang_Task_resume0(void *args) {
+	bvm_thread_obj_t *thread_obj = NI_GetParameterAsObject(0);
+	bvm_thread_task_resume(thread_obj->vmthread);
+	NI_ReturnVoid();
+}
 
-	BVM_FILE file;
-	char *name;
+#endif
 
-	/* the String name */
-	bvm_string_obj_t *string_obj = NI_GetParameterAsObject(0);
+#if BVM_SCOPED_MEMORY_ENABLE
 
-	/* The open flags mode - note that no sanity checking is performed. */
-	jint flags = NI_GetParameterAsInt(1);
+/***************************************************************************************************
+ * babe.lang.ScopedMemory
+ *
+ * A ScopedMemory is an arena that a thread may enter to have the objects it creates allocated there
+ * instead of the heap - see scope.c.  Everything in the arena is dropped when the thread leaves it.  The
+ * Java class is expected to be:
+ *
+ *   public final class ScopedMemory {
+ *       private int scope;
+ *       public ScopedMemory(int size) { create0(size); }
+ *       public void enter(Runnable logic) { enter0(); try { logic.run(); } finally { exit0(); } }
+ *       public native int size();
+ *       public native int memoryConsumed();
+ *       public native void release();
+ *       private native void create0(int size);
+ *       private native void enter0();
+ *       private native void exit0();
+ *   }
+ **************************************************************************************************/
 
-	if (string_obj == NULL)
-		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+/*
+ * void create0(int size)
+ */
+void babe_lang_ScopedMemory_create0(void *args) {
+	bvm_scoped_memory_obj_t *scoped_memory_obj = NI_GetParameterAsObject(0);
+	bvm_int32_t size = NI_GetParameterAsInt(1);
 
-	/* convert the name to a c string (comes from the heap, so we'll clean it up later */
-	name = bvm_string_to_cstring(string_obj);
+	if (size < 0) bvm_throw_exception(BVM_ERR_ILLEGAL_ARGUMENT_EXCEPTION, NULL);
 
-	/* make the name transient just in case a GC is caused */
-	BVM_MAKE_TRANSIENT_ROOT(name);
+	scoped_memory_obj->scope = bvm_scope_create(size);
 
-	/* perform the file open.  We'll get NULL back it it does not work */
-	file = bvm_file_open(bvm_gl_filetype_md, name, flags);
+	NI_ReturnVoid();
+}
 
-	/* no can do?  whoops */
-	if (file == BVM_ERR)
-		bvm_throw_exception(BVM_ERR_FILE_NOT_FOUND_EXCEPTION, NULL);
+/*
+ * void enter0()
+ */
+void babe_lang_ScopedMemory_enter0(void *args) {
+	bvm_scoped_memory_obj_t *scoped_memory_obj = NI_GetParameterAsObject(0);
 
-	bvm_heap_free(name);
+	if (scoped_memory_obj->scope == NULL) bvm_throw_exception(BVM_ERR_ILLEGAL_STATE_EXCEPTION, "scope is released");
 
-	/* void* handle is returned as ref.  VM will interpret it as int */
-	NI_ReturnInt(file);
+	bvm_scope_enter(scoped_memory_obj->scope);
+
+	NI_ReturnVoid();
 }
 
 /*
- * void close() throws IOException
+ * void exit0()
  */
-void babe_io_File_close(void *args) {
-
-	/* the File object */
-	file_obj_t *file_obj = NI_GetParameterAsObject(0);
+void babe_lang_ScopedMemory_exit0(void *args) {
+	bvm_scoped_memory_obj_t *scoped_memory_obj = NI_GetParameterAsObject(0);
 
-	/* if the file is not closed, close it */
-	if (file_obj->native_handle != -1) {
+	if (scoped_memory_obj->scope == NULL) bvm_throw_exception(BVM_ERR_ILLEGAL_STATE_EXCEPTION, "scope is released");
 
-		/* flush if required */
-		flushfile(file_obj);
+	bvm_scope_exit(scoped_memory_obj->scope);
 
-		/* native file close will return -1 if any issues */
-		if (bvm_file_close(file_obj->native_handle) < 0)
-			bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+	NI_ReturnVoid();
+}
 
-		/* set handle to -1 to indicate the file is now closed */
-		file_obj->native_handle = -1;
-	}
+/*
+ * int size()
+ */
+void babe_lang_ScopedMemory_size(void *args) {
+	bvm_scope_t *scope = ((bvm_scoped_memory_obj_t *) NI_GetParameterAsObject(0))->scope;
+	NI_ReturnInt( (scope == NULL) ? 0 : (bvm_int32_t) (scope->end - scope->start) );
+}
 
-	NI_ReturnVoid();
+/*
+ * int memoryConsumed()
+ */
+void babe_lang_ScopedMemory_memoryConsumed(void *args) {
+	bvm_scope_t *scope = ((bvm_scoped_memory_obj_t *) NI_GetParameterAsObject(0))->scope;
+	NI_ReturnInt( (scope == NULL) ? 0 : (bvm_int32_t) (scope->top - scope->start) );
 }
 
 /*
- * int read(byte[] dst, int offset, int count) throws IOException
+ * void release()
  */
-void babe_io_File_read(void *args) {
+void babe_lang_ScopedMemory_release(void *args) {
+	bvm_scoped_memory_obj_t *scoped_memory_obj = NI_GetParameterAsObject(0);
 
-	jint ret;
+	if (scoped_memory_obj->scope != NULL) {
+		bvm_scope_release(scoped_memory_obj->scope);
+		scoped_memory_obj->scope = NULL;
+	}
 
-	/* the File object */
-	file_obj_t *file_obj = NI_GetParameterAsObject(0);
-	BVM_FILE file = file_obj->native_handle;
+	NI_ReturnVoid();
+}
 
-	/* the dest array and offset/count */
-	bvm_jbyte_array_obj_t *dst_array_obj = NI_GetParameterAsObject(1);
-	jint offset = NI_GetParameterAsInt(2);
-	jint count  = NI_GetParameterAsInt(3);
+#endif
 
-	if (dst_array_obj == NULL)
-		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+#if BVM_NATIVE_COLLECTIONS_ENABLE
 
-	if ( (count < 0) || (offset < 0) || (count > dst_array_obj->length.int_value - offset) )
-		bvm_throw_exception(BVM_ERR_INDEX_OUT_OF_BOUNDS_EXCEPTION, NULL);
+/***************************************************************************************************
+ * babe.util.IntHashMap, babe.util.LongHashMap
+ *
+ * Maps of int (or long) keys to objects, open addressed with linear probing.  The slots of a map are the
+ * same index of its '_keys' and '_values' arrays, and a slot is empty when its value is null - so, as
+ * with Hashtable, a null value may not be put.  Nothing is synchronised.  The Java classes are expected
+ * to be (LongHashMap with 'long' for the key types):
+ *
+ *   public final class IntHashMap {
+ *       private int[] _keys;
+ *       private Object[] _values;
+ *       private int _size;
+ *       public IntHashMap() { this(16); }
+ *       public IntHashMap(int capacity) { init0(capacity); }
+ *       public int size() { return _size; }
+ *       public native Object get(int key);
+ *       public native boolean containsKey(int key);
+ *       public native Object put(int key, Object value);
+ *       public native Object remove(int key);
+ *       public native void clear();
+ *       public native int[] keys();
+ *       private native void init0(int capacity);
+ *   }
+ **************************************************************************************************/
 
-	/* the file is closed, */
-	if (file_obj->native_handle == -1)
-		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+/* the fewest slots a map has */
+#define PRIMITIVEMAP_MIN_CAPACITY 8
 
-	/* if file is write only */
-	if (file_obj->flags & BVM_FILE_O_WRONLY)
-		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+/* whether a map of a number of slots may hold a number of entries - it is kept at most three quarters full so that
+ * probes stay short, and so that there is always an empty slot to end a probe */
+#define PRIMITIVEMAP_Fits(entries, capacity) ( (bvm_uint32_t) (entries) <= ((bvm_uint32_t) (capacity) / 4) * 3 )
 
-	/* flush if required */
-	flushfile(file_obj);
+/**
+ * Gives the hash of a key.  The multiply (Fibonacci hashing) and shift spread keys that differ only in their high bits
+ * - or that are all multiples of some power of two - over the low bits the slot is taken from.
+ *
+ * @param key the key - an \c int or \c long
+ * @param is_long whether the key is a \c long
+ *
+ * @return the hash
+ */
+static bvm_uint32_t primitivemap_hash(const void *key, bvm_bool_t is_long) {
 
-	/* Read zero bytes ?  Stupid.  Exit */
-	if (count == 0) {
-		NI_ReturnInt(0);
-		return;
-	}
+	bvm_uint32_t words[2];
+	bvm_uint32_t hash;
 
-	/* native returns 0 if EOF, negative if error */
-	ret = bvm_file_read(&dst_array_obj->data[offset], count, file);
+	if (is_long) {
+		memcpy(words, key, sizeof(words));
+		hash = words[0] ^ words[1];
+	} else {
+		hash = *((bvm_uint32_t *) key);
+	}
 
-	if (ret < 0)
-		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+	hash *= 0x9E3779B9U;
+	return hash ^ (hash >> 16);
+}
 
-	/* return -1 to java if eof, otherwise return nr bytes read */
-	NI_ReturnInt( ret == 0 ? -1 : ret);
+/**
+ * Gives the key of a slot.
+ *
+ * @param keys the keys array of a map
+ * @param slot the slot
+ * @param is_long whether the keys are \c long
+ *
+ * @return a pointer to the key
+ */
+static void *primitivemap_key(bvm_jarray_obj_t *keys, bvm_uint32_t slot, bvm_bool_t is_long) {
+	return is_long ? (void *) &((bvm_jlong_array_obj_t *) keys)->data[slot] : (void *) &((bvm_jint_array_obj_t *) keys)->data[slot];
 }
 
+/**
+ * Finds the slot of a key in a map.
+ *
+ * @param map_obj the map
+ * @param key the key
+ * @param is_long whether the key is a \c long
+ *
+ * @return the slot of the key, or if it is not in the map, -1 less the empty slot it would go in.
+ */
+static bvm_int32_t primitivemap_find(bvm_primitivemap_obj_t *map_obj, const void *key, bvm_bool_t is_long) {
+
+	bvm_uint32_t mask = map_obj->keys->length.int_value - 1;
+	bvm_uint32_t slot = primitivemap_hash(key, is_long) & mask;
+	size_t width = is_long ? 8 : 4;
+
+	while (BVM_REF_Decode(map_obj->values->data[slot]) != NULL) {
+
+		if (memcmp(primitivemap_key(map_obj->keys, slot, is_long), key, width) == 0)
+			return (bvm_int32_t) slot;
+
+		slot = (slot + 1) & mask;
+	}
+
+	return -1 - (bvm_int32_t) slot;
+}
+
+/**
+ * Gives a map new, empty, arrays of a number of slots and moves its entries into them.  The map is assumed to be
+ * reachable by the GC from elsewhere.
+ *
+ * @param map_obj the map
+ * @param capacity the number of slots - a power of two
+ * @param is_long whether the keys are \c long
+ */
+static void primitivemap_resize(bvm_primitivemap_obj_t *map_obj, bvm_uint32_t capacity, bvm_bool_t is_long) {
+
+	bvm_jarray_obj_t *old_keys = map_obj->keys;
+	bvm_instance_array_obj_t *old_values = map_obj->values;
+	bvm_jarray_obj_t *keys;
+	bvm_instance_array_obj_t *values;
+	bvm_uint32_t lc, slot;
+	size_t width = is_long ? 8 : 4;
+
+	BVM_BEGIN_TRANSIENT_BLOCK {
+
+		keys = bvm_object_alloc_array_primitive(capacity, is_long ? BVM_T_LONG : BVM_T_INT);
+		BVM_MAKE_TRANSIENT_ROOT(keys);
+
+		values = bvm_object_alloc_array_reference(capacity, (bvm_clazz_t *) BVM_OBJECT_CLAZZ);
+
+		map_obj->keys = keys;
+		map_obj->values = values;
+		BVM_GC_WRITE_BARRIER(map_obj, keys);
+		BVM_GC_WRITE_BARRIER(map_obj, values);
+
+	} BVM_END_TRANSIENT_BLOCK
+
+	if (old_values == NULL) return;
+
+	/* the new arrays are empty, so each entry goes in the first empty slot of its probe */
+	for (lc = old_values->length.int_value; lc--;) {
+
+		if (BVM_REF_Decode(old_values->data[lc]) == NULL) continue;
+
+		slot = (bvm_uint32_t) (-1 - primitivemap_find(map_obj, primitivemap_key(old_keys, lc, is_long), is_long));
+
+		memcpy(primitivemap_key(keys, slot, is_long), primitivemap_key(old_keys, lc, is_long), width);
+		values->data[slot] = old_values->data[lc];
+	}
+
+	BVM_GC_WRITE_BARRIER_BULK(values);
+}
+
+/**
+ * Gives the number of slots for a map of a number of entries.
+ *
+ * @param entries the number of entries
+ *
+ * @return the number of slots - a power of two
+ *
+ * @throws IllegalArgumentException if \c entries is negative or too large.
+ */
+static bvm_uint32_t primitivemap_capacity(bvm_int32_t entries) {
+
+	bvm_uint32_t capacity = PRIMITIVEMAP_MIN_CAPACITY;
+
+	if ( (entries < 0) || (entries > (BVM_MAX_INT / 4) * 3) )
+		bvm_throw_exception(BVM_ERR_ILLEGAL_ARGUMENT_EXCEPTION, NULL);
+
+	while (!PRIMITIVEMAP_Fits(entries, capacity)) capacity <<= 1;
+
+	return capacity;
+}
+
+/**
+ * Puts a key and value in a map.
+ *
+ * @param map_obj the map
+ * @param key the key
+ * @param value the value
+ * @param is_long whether the key is a \c long
+ *
+ * @return the value the key had, or \c NULL if it had none.
+ *
+ * @throws NullPointerException if \c value is \c NULL.
+ * @throws IllegalStateException if \c value is a scoped object that would escape its scope.
+ */
+static bvm_obj_t *primitivemap_put(bvm_primitivemap_obj_t *map_obj, const void *key, bvm_obj_t *value, bvm_bool_t is_long) {
+
+	bvm_int32_t slot;
+	bvm_obj_t *old_value = NULL;
+
+	if (value == NULL) bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+
+	slot = primitivemap_find(map_obj, key, is_long);
+
+	if (slot >= 0) {
+		old_value = BVM_REF_Decode(map_obj->values->data[slot]);
+	} else {
+
+		if (!PRIMITIVEMAP_Fits(map_obj->size.int_value + 1, map_obj->keys->length.int_value)) {
+
+			/* the value must survive a GC while the map grows */
+			BVM_BEGIN_TRANSIENT_BLOCK {
+				BVM_MAKE_TRANSIENT_ROOT(value);
+				primitivemap_resize(map_obj, primitivemap_capacity(map_obj->size.int_value + 1), is_long);
+			} BVM_END_TRANSIENT_BLOCK
+
+			slot = primitivemap_find(map_obj, key, is_long);
+		}
+
+		slot = -1 - slot;
+		memcpy(primitivemap_key(map_obj->keys, slot, is_long), key, is_long ? 8 : 4);
+		map_obj->size.int_value++;
+	}
+
+#if BVM_SCOPED_MEMORY_ENABLE
+	/* a scoped object may not be stored where it may outlive its scope */
+	if (BVM_SCOPE_IsEscape(map_obj->values, value)) {
+		if (old_value == NULL) map_obj->size.int_value--;
+		bvm_throw_exception(BVM_ERR_ILLEGAL_STATE_EXCEPTION, "scoped object would escape its scope");
+	}
+#endif
+
+	map_obj->values->data[slot] = BVM_REF_Encode(value);
+	BVM_GC_WRITE_BARRIER(map_obj->values, value);
+
+	return old_value;
+}
+
+/**
+ * Removes a key from a map.  The entries after it in its probe sequence that would no longer be found are moved back
+ * into the gap, so no 'deleted' markers are needed.
+ *
+ * @param map_obj the map
+ * @param key the key
+ * @param is_long whether the key is a \c long
+ *
+ * @return the value the key had, or \c NULL if it had none.
+ */
+static bvm_obj_t *primitivemap_remove(bvm_primitivemap_obj_t *map_obj, const void *key, bvm_bool_t is_long) {
+
+	bvm_int32_t found = primitivemap_find(map_obj, key, is_long);
+	bvm_uint32_t mask = map_obj->keys->length.int_value - 1;
+	bvm_uint32_t gap, slot, home;
+	bvm_ref_t *values = map_obj->values->data;
+	bvm_obj_t *old_value;
+
+	if (found < 0) return NULL;
+
+	old_value = BVM_REF_Decode(values[found]);
+	gap = slot = (bvm_uint32_t) found;
+
+	while (BVM_REF_Decode(values[slot = (slot + 1) & mask]) != NULL) {
+
+		home = primitivemap_hash(primitivemap_key(map_obj->keys, slot, is_long), is_long) & mask;
+
+		/* an entry whose home slot is (cyclically) after the gap and not after itself stays where it is */
+		if ( (gap <= slot) ? ((gap < home) && (home <= slot)) : ((gap < home) || (home <= slot)) )
+			continue;
+
+		memcpy(primitivemap_key(map_obj->keys, gap, is_long), primitivemap_key(map_obj->keys, slot, is_long), is_long ? 8 : 4);
+		values[gap] = values[slot];
+		gap = slot;
+	}
+
+	values[gap] = BVM_REF_Encode(NULL);
+	map_obj->size.int_value--;
+
+	return old_value;
+}
+
+/**
+ * Empties a map.
+ *
+ * @param map_obj the map
+ */
+static void primitivemap_clear(bvm_primitivemap_obj_t *map_obj) {
+	memset(map_obj->values->data, 0, map_obj->values->length.int_value * sizeof(bvm_ref_t));
+	map_obj->size.int_value = 0;
+}
+
+/**
+ * Gives a new array of the keys of a map, in no particular order.
+ *
+ * @param map_obj the map
+ * @param is_long whether the keys are \c long
+ *
+ * @return an \c int[] or \c long[]
+ */
+static bvm_jarray_obj_t *primitivemap_keys(bvm_primitivemap_obj_t *map_obj, bvm_bool_t is_long) {
+
+	bvm_jarray_obj_t *keys = bvm_object_alloc_array_primitive(map_obj->size.int_value, is_long ? BVM_T_LONG : BVM_T_INT);
+	bvm_uint32_t lc, count = 0;
+
+	for (lc = 0; lc < (bvm_uint32_t) map_obj->values->length.int_value; lc++) {
+		if (BVM_REF_Decode(map_obj->values->data[lc]) != NULL)
+			memcpy(primitivemap_key(keys, count++, is_long), primitivemap_key(map_obj->keys, lc, is_long), is_long ? 8 : 4);
+	}
+
+	return keys;
+}
+
+/*
+ * void init0(int capacity)
+ */
+void babe_util_IntHashMap_init0(void *args) {
+	bvm_primitivemap_obj_t *map_obj = NI_GetParameterAsObject(0);
+	primitivemap_resize(map_obj, primitivemap_capacity(NI_GetParameterAsInt(1)), BVM_FALSE);
+	NI_ReturnVoid();
+}
+
+/*
+ * Object get(int key)
+ */
+void babe_util_IntHashMap_get(void *args) {
+	bvm_primitivemap_obj_t *map_obj = NI_GetParameterAsObject(0);
+	jint key = NI_GetParameterAsInt(1);
+	bvm_int32_t slot = primitivemap_find(map_obj, &key, BVM_FALSE);
+	NI_ReturnObject( (slot < 0) ? NULL : BVM_REF_Decode(map_obj->values->data[slot]) );
+}
+
+/*
+ * boolean containsKey(int key)
+ */
+void babe_util_IntHashMap_containsKey(void *args) {
+	jint key = NI_GetParameterAsInt(1);
+	NI_ReturnBoolean( primitivemap_find(NI_GetParameterAsObject(0), &key, BVM_FALSE) >= 0 );
+}
+
+/*
+ * Object put(int key, Object value)
+ */
+void babe_util_IntHashMap_put(void *args) {
+	jint key = NI_GetParameterAsInt(1);
+	NI_ReturnObject( primitivemap_put(NI_GetParameterAsObject(0), &key, NI_GetParameterAsObject(2), BVM_FALSE) );
+}
+
+/*
+ * Object remove(int key)
+ */
+void babe_util_IntHashMap_remove(void *args) {
+	jint key = NI_GetParameterAsInt(1);
+	NI_ReturnObject( primitivemap_remove(NI_GetParameterAsObject(0), &key, BVM_FALSE) );
+}
+
+/*
+ * void clear()
+ */
+void babe_util_IntHashMap_clear(void *args) {
+	primitivemap_clear(NI_GetParameterAsObject(0));
+	NI_ReturnVoid();
+}
+
+/*
+ * int[] keys()
+ */
+void babe_util_IntHashMap_keys(void *args) {
+	NI_ReturnObject( primitivemap_keys(NI_GetParameterAsObject(0), BVM_FALSE) );
+}
+
+#if BVM_NATIVE_INT64_ENABLE
+
+/*
+ * void init0(int capacity)
+ */
+void babe_util_LongHashMap_init0(void *args) {
+	bvm_primitivemap_obj_t *map_obj = NI_GetParameterAsObject(0);
+	primitivemap_resize(map_obj, primitivemap_capacity(NI_GetParameterAsInt(1)), BVM_TRUE);
+	NI_ReturnVoid();
+}
+
+/*
+ * Object get(long key)
+ */
+void babe_util_LongHashMap_get(void *args) {
+	bvm_primitivemap_obj_t *map_obj = NI_GetParameterAsObject(0);
+	jlong key = NI_GetParameterAsLong(1);
+	bvm_int32_t slot = primitivemap_find(map_obj, &key, BVM_TRUE);
+	NI_ReturnObject( (slot < 0) ? NULL : BVM_REF_Decode(map_obj->values->data[slot]) );
+}
+
+/*
+ * boolean containsKey(long key)
+ */
+void babe_util_LongHashMap_containsKey(void *args) {
+	jlong key = NI_GetParameterAsLong(1);
+	NI_ReturnBoolean( primitivemap_find(NI_GetParameterAsObject(0), &key, BVM_TRUE) >= 0 );
+}
+
+/*
+ * Object put(long key, Object value)
+ */
+void babe_util_LongHashMap_put(void *args) {
+	jlong key = NI_GetParameterAsLong(1);
+	NI_ReturnObject( primitivemap_put(NI_GetParameterAsObject(0), &key, NI_GetParameterAsObject(3), BVM_TRUE) );
+}
+
+/*
+ * Object remove(long key)
+ */
+void babe_util_LongHashMap_remove(void *args) {
+	jlong key = NI_GetParameterAsLong(1);
+	NI_ReturnObject( primitivemap_remove(NI_GetParameterAsObject(0), &key, BVM_TRUE) );
+}
+
+/*
+ * long[] keys()
+ */
+void babe_util_LongHashMap_keys(void *args) {
+	NI_ReturnObject( primitivemap_keys(NI_GetParameterAsObject(0), BVM_TRUE) );
+}
+
+#endif
+
+/***************************************************************************************************
+ * babe.util.IntArray, babe.util.LongArray
+ *
+ * Growable arrays of int (or long).  The elements are the first '_size' of the '_data' array, which is
+ * replaced by one twice the size when it is full.  Nothing is synchronised.  The Java classes are
+ * expected to be (LongArray with 'long' for the element types):
+ *
+ *   public final class IntArray {
+ *       private int[] _data;
+ *       private int _size;
+ *       public IntArray() { this(16); }
+ *       public IntArray(int capacity) { init0(capacity); }
+ *       public int size() { return _size; }
+ *       public void clear() { _size = 0; }
+ *       public native void add(int value);
+ *       public native int get(int index);
+ *       public native void set(int index, int value);
+ *       public native int removeLast();
+ *       public native int[] toArray();
+ *       private native void init0(int capacity);
+ *   }
+ **************************************************************************************************/
+
+/**
+ * Gives a growable array a new data array of a number of elements, with its current elements copied in.  The
+ * growable array is assumed to be reachable by the GC from elsewhere.
+ *
+ * @param array_obj the growable array
+ * @param capacity the number of elements of the new data array
+ * @param is_long whether the elements are \c long
+ */
+static void primitivearray_resize(bvm_primitivearray_obj_t *array_obj, bvm_uint32_t capacity, bvm_bool_t is_long) {
+
+	bvm_jarray_obj_t *data = bvm_object_alloc_array_primitive(capacity, is_long ? BVM_T_LONG : BVM_T_INT);
+
+	if (array_obj->data != NULL)
+		memcpy(primitivemap_key(data, 0, is_long), primitivemap_key(array_obj->data, 0, is_long), array_obj->size.int_value * (is_long ? 8 : 4));
+
+	array_obj->data = data;
+	BVM_GC_WRITE_BARRIER(array_obj, data);
+}
+
+/**
+ * Gives the element at an index of a growable array, which is checked against its size.
+ *
+ * @param array_obj the growable array
+ * @param index the index
+ * @param is_long whether the elements are \c long
+ *
+ * @return a pointer to the element
+ *
+ * @throws IndexOutOfBoundsException if the index is not that of an element.
+ */
+static void *primitivearray_element(bvm_primitivearray_obj_t *array_obj, bvm_int32_t index, bvm_bool_t is_long) {
+
+	/* a negative index wraps around to a large one */
+	if ( (bvm_uint32_t) index >= (bvm_uint32_t) array_obj->size.int_value)
+		bvm_throw_exception(BVM_ERR_INDEX_OUT_OF_BOUNDS_EXCEPTION, NULL);
+
+	return primitivemap_key(array_obj->data, index, is_long);
+}
+
+/**
+ * Makes room for one more element at the end of a growable array.
+ *
+ * @param array_obj the growable array
+ * @param is_long whether the elements are \c long
+ *
+ * @return a pointer to the new element
+ */
+static void *primitivearray_add(bvm_primitivearray_obj_t *array_obj, bvm_bool_t is_long) {
+
+	bvm_uint32_t length = array_obj->data->length.int_value;
+
+	if ((bvm_uint32_t) array_obj->size.int_value == length) {
+
+		if (length >= (bvm_uint32_t) BVM_MAX_INT / 2) {
+			BVM_THROW(bvm_gl_out_of_memory_err_obj)
+		}
+
+		primitivearray_resize(array_obj, (length < PRIMITIVEMAP_MIN_CAPACITY) ? PRIMITIVEMAP_MIN_CAPACITY : length * 2, is_long);
+	}
+
+	return primitivemap_key(array_obj->data, array_obj->size.int_value++, is_long);
+}
+
+/**
+ * Gives a new array of the elements of a growable array.
+ *
+ * @param array_obj the growable array
+ * @param is_long whether the elements are \c long
+ *
+ * @return an \c int[] or \c long[]
+ */
+static bvm_jarray_obj_t *primitivearray_to_array(bvm_primitivearray_obj_t *array_obj, bvm_bool_t is_long) {
+
+	bvm_jarray_obj_t *data = bvm_object_alloc_array_primitive(array_obj->size.int_value, is_long ? BVM_T_LONG : BVM_T_INT);
+
+	memcpy(primitivemap_key(data, 0, is_long), primitivemap_key(array_obj->data, 0, is_long), array_obj->size.int_value * (is_long ? 8 : 4));
+
+	return data;
+}
+
+/*
+ * void init0(int capacity)
+ */
+void babe_util_IntArray_init0(void *args) {
+	bvm_int32_t capacity = NI_GetParameterAsInt(1);
+
+	if (capacity < 0) bvm_throw_exception(BVM_ERR_ILLEGAL_ARGUMENT_EXCEPTION, NULL);
+
+	primitivearray_resize(NI_GetParameterAsObject(0), capacity, BVM_FALSE);
+	NI_ReturnVoid();
+}
+
+/*
+ * void add(int value)
+ */
+void babe_util_IntArray_add(void *args) {
+	jint value = NI_GetParameterAsInt(1);
+	*((jint *) primitivearray_add(NI_GetParameterAsObject(0), BVM_FALSE)) = value;
+	NI_ReturnVoid();
+}
+
+/*
+ * int get(int index)
+ */
+void babe_util_IntArray_get(void *args) {
+	NI_ReturnInt( *((jint *) primitivearray_element(NI_GetParameterAsObject(0), NI_GetParameterAsInt(1), BVM_FALSE)) );
+}
+
+/*
+ * void set(int index, int value)
+ */
+void babe_util_IntArray_set(void *args) {
+	*((jint *) primitivearray_element(NI_GetParameterAsObject(0), NI_GetParameterAsInt(1), BVM_FALSE)) = NI_GetParameterAsInt(2);
+	NI_ReturnVoid();
+}
+
+/*
+ * int removeLast()
+ */
+void babe_util_IntArray_removeLast(void *args) {
+	bvm_primitivearray_obj_t *array_obj = NI_GetParameterAsObject(0);
+	jint value = *((jint *) primitivearray_element(array_obj, array_obj->size.int_value - 1, BVM_FALSE));
+	array_obj->size.int_value--;
+	NI_ReturnInt(value);
+}
+
+/*
+ * int[] toArray()
+ */
+void babe_util_IntArray_toArray(void *args) {
+	NI_ReturnObject( primitivearray_to_array(NI_GetParameterAsObject(0), BVM_FALSE) );
+}
+
+#if BVM_NATIVE_INT64_ENABLE
+
+/*
+ * void init0(int capacity)
+ */
+void babe_util_LongArray_init0(void *args) {
+	bvm_int32_t capacity = NI_GetParameterAsInt(1);
+
+	if (capacity < 0) bvm_throw_exception(BVM_ERR_ILLEGAL_ARGUMENT_EXCEPTION, NULL);
+
+	primitivearray_resize(NI_GetParameterAsObject(0), capacity, BVM_TRUE);
+	NI_ReturnVoid();
+}
+
+/*
+ * void add(long value)
+ */
+void babe_util_LongArray_add(void *args) {
+	jlong value = NI_GetParameterAsLong(1);
+	*((jlong *) primitivearray_add(NI_GetParameterAsObject(0), BVM_TRUE)) = value;
+	NI_ReturnVoid();
+}
+
+/*
+ * long get(int index)
+ */
+void babe_util_LongArray_get(void *args) {
+	jlong value = *((jlong *) primitivearray_element(NI_GetParameterAsObject(0), NI_GetParameterAsInt(1), BVM_TRUE));
+	NI_ReturnLong(value);
+}
+
+/*
+ * void set(int index, long value)
+ */
+void babe_util_LongArray_set(void *args) {
+	*((jlong *) primitivearray_element(NI_GetParameterAsObject(0), NI_GetParameterAsInt(1), BVM_TRUE)) = NI_GetParameterAsLong(2);
+	NI_ReturnVoid();
+}
+
+/*
+ * long removeLast()
+ */
+void babe_util_LongArray_removeLast(void *args) {
+	bvm_primitivearray_obj_t *array_obj = NI_GetParameterAsObject(0);
+	jlong value = *((jlong *) primitivearray_element(array_obj, array_obj->size.int_value - 1, BVM_TRUE));
+	array_obj->size.int_value--;
+	NI_ReturnLong(value);
+}
+
+/*
+ * long[] toArray()
+ */
+void babe_util_LongArray_toArray(void *args) {
+	NI_ReturnObject( primitivearray_to_array(NI_GetParameterAsObject(0), BVM_TRUE) );
+}
+
+#endif
+
+#endif
+
+/***************************************************************************************************
+ * java.lang.ref.WeakReference
+ **************************************************************************************************/
+
+/*
+ * public native void makeweak();
+ *
+ */
+void java_lang_ref_WeakReference_makeweak(void *args) {
+
+	/* this */
+	bvm_weak_reference_obj_t *weak_reference_obj = NI_GetParameterAsObject(0);
+
+	/* change the GC alloc type from BVM_ALLOC_TYPE_OBJECT, to BVM_ALLOC_TYPE_WEAK_REFERENCE */
+	bvm_heap_set_alloc_type(weak_reference_obj, BVM_ALLOC_TYPE_WEAK_REFERENCE);
+
+	NI_ReturnVoid();
+}
+
+/***************************************************************************************************
+ * java.lang.ref.SoftReference
+ **************************************************************************************************/
+
+/*
+ * public native void makesoft();
+ *
+ */
+void java_lang_ref_SoftReference_makesoft(void *args) {
+
+	/* this */
+	bvm_soft_reference_obj_t *soft_reference_obj = NI_GetParameterAsObject(0);
+
+	/* change the GC alloc type from BVM_ALLOC_TYPE_OBJECT, to BVM_ALLOC_TYPE_SOFT_REFERENCE */
+	bvm_heap_set_alloc_type(soft_reference_obj, BVM_ALLOC_TYPE_SOFT_REFERENCE);
+
+	soft_reference_obj->timestamp.int_value = (bvm_int32_t) ++bvm_gl_gc_soft_clock;
+
+	NI_ReturnVoid();
+}
+
+/*
+ * public native Object get();
+ *
+ * Getting the referent makes the soft reference the most recently used - the last to be cleared.
+ */
+void java_lang_ref_SoftReference_get(void *args) {
+
+	/* this */
+	bvm_soft_reference_obj_t *soft_reference_obj = NI_GetParameterAsObject(0);
+
+	soft_reference_obj->timestamp.int_value = (bvm_int32_t) ++bvm_gl_gc_soft_clock;
+
+	NI_ReturnObject(soft_reference_obj->referent);
+}
+
+
+/***************************************************************************************************
+ * java.lang.ref.Ephemeron
+ **************************************************************************************************/
+
+/*
+ * private native void makeephemeron();
+ *
+ * Called by the Ephemeron constructor once its key and value are set.  Ephemeron extends Reference directly, with a
+ * private Object field 'value' - see bvm_ephemeron_obj_t.
+ */
+void java_lang_ref_Ephemeron_makeephemeron(void *args) {
+
+	/* this */
+	bvm_ephemeron_obj_t *ephemeron_obj = NI_GetParameterAsObject(0);
+
+	/* change the GC alloc type from BVM_ALLOC_TYPE_OBJECT, to BVM_ALLOC_TYPE_EPHEMERON */
+	bvm_heap_set_alloc_type(ephemeron_obj, BVM_ALLOC_TYPE_EPHEMERON);
+
+	NI_ReturnVoid();
+}
+
+/***************************************************************************************************
+ * java.nio.ByteOrder
+ **************************************************************************************************/
+
+/*
+ * static boolean isLittleEndian()
+ */
+void java_nio_ByteOrder_isLittleEndian(void *args) {
+
+    UNUSED(args);
+
+#if (!BVM_BIG_ENDIAN_ENABLE)
+		NI_ReturnInt(BVM_TRUE);
+#else
+		NI_ReturnInt(BVM_FALSE);
+#endif
+}
+
+#if (BVM_NATIVE_BYTEBUFFER_ENABLE && BVM_NATIVE_REPLACEMENT_ENABLE)
+
+/***************************************************************************************************
+ * java.nio.ByteBuffer
+ *
+ * Replacements for the get and put methods of the class library ByteBuffer.  Each behaves as the bytecode it
+ * replaces - including which exception is thrown when more than one check fails - but checks the bounds once and
+ * moves all the bytes of a value together.  Like the class library, a buffer from allocateDirect() is backed by a
+ * byte array on the heap (there is no other memory to give it), so the same natives serve both kinds of buffer.
+ **************************************************************************************************/
+
+/* The fields of java.nio.Buffer and then java.nio.ByteBuffer */
+typedef struct bytebufferobjstruct {
+	BVM_COMMON_OBJ_INFO
+	bvm_cell_t capacity;
+	bvm_cell_t limit;
+	bvm_cell_t position;
+	bvm_cell_t mark;
+	bvm_cell_t array_offset;
+	bvm_cell_t is_read_only;
+	bvm_obj_t *order;
+	bvm_jbyte_array_obj_t *bytes;
+	bvm_cell_t is_direct;
+} bytebuffer_obj_t;
+
+/* The ByteOrder.LITTLE_ENDIAN static field - found when first needed */
+static BVM_VM_LOCAL bvm_field_t *bytebuffer_little_endian_field = NULL;
+
+/**
+ * Whether a buffer is in little endian byte order - that is, its order is \c ByteOrder.LITTLE_ENDIAN.
+ *
+ * @param buffer_obj the buffer
+ *
+ * @return \c BVM_TRUE if the buffer's bytes are little endian, \c BVM_FALSE if they are big endian.
+ */
+static bvm_bool_t bytebuffer_is_little_endian(bytebuffer_obj_t *buffer_obj) {
+
+	if (bytebuffer_little_endian_field == NULL) {
+		bvm_instance_clazz_t *clazz = (bvm_instance_clazz_t *) bvm_clazz_get_c(BVM_BOOTSTRAP_CLASSLOADER_OBJ, "java/nio/ByteOrder");
+		bytebuffer_little_endian_field = bvm_clazz_field_get(clazz,
+								bvm_utfstring_pool_get_c("LITTLE_ENDIAN", BVM_TRUE),
+								bvm_utfstring_pool_get_c("Ljava/nio/ByteOrder;", BVM_TRUE));
+	}
+
+	/* a buffer only has an order once ByteOrder is initialised, so the static has its value by then */
+	return (buffer_obj->order != NULL) && (buffer_obj->order == bytebuffer_little_endian_field->value.static_value.ref_value);
+}
+
+/**
+ * Moves the position of a buffer past the next \c size bytes for a relative get or put, and gives the index of the
+ * first of them.
+ *
+ * @param buffer_obj the buffer
+ * @param size the number of bytes
+ * @param is_put \c BVM_TRUE if the bytes are to be written
+ *
+ * @return the index of the first byte
+ *
+ * @throw BufferUnderflowException if fewer than \c size bytes remain to be read
+ * @throw BufferOverflowException if fewer than \c size bytes remain to be written
+ * @throw ReadOnlyBufferException if the bytes are to be written and the buffer is read only
+ */
+static jint bytebuffer_next(bytebuffer_obj_t *buffer_obj, jint size, bvm_bool_t is_put) {
+
+	jint position = buffer_obj->position.int_value;
+
+	if (buffer_obj->limit.int_value - position < size)
+		bvm_throw_exception(is_put ? BVM_ERR_BUFFER_OVERFLOW_EXCEPTION : BVM_ERR_BUFFER_UNDERFLOW_EXCEPTION, NULL);
+
+	if (is_put && buffer_obj->is_read_only.int_value)
+		bvm_throw_exception(BVM_ERR_READ_ONLY_BUFFER_EXCEPTION, NULL);
+
+	buffer_obj->position.int_value = position + size;
+
+	return position;
+}
+
+/**
+ * Gives the address of \c size bytes of a buffer starting at a given index for an absolute get or put.
+ *
+ * @param buffer_obj the buffer
+ * @param index the index of the first byte
+ * @param size the number of bytes
+ * @param is_put \c BVM_TRUE if the bytes are to be written
+ *
+ * @return the address of the first byte in the buffer's byte array
+ *
+ * @throw IndexOutOfBoundsException if the bytes are not all below the buffer's limit
+ * @throw ReadOnlyBufferException if the bytes are to be written and the buffer is read only
+ */
+static bvm_uint8_t *bytebuffer_at(bytebuffer_obj_t *buffer_obj, jint index, jint size, bvm_bool_t is_put) {
+
+	jint offset;
+
+	if ( (index < 0) || (index > buffer_obj->limit.int_value - size) )
+		bvm_throw_exception(BVM_ERR_INDEX_OUT_OF_BOUNDS_EXCEPTION, NULL);
+
+	if (is_put && buffer_obj->is_read_only.int_value)
+		bvm_throw_exception(BVM_ERR_READ_ONLY_BUFFER_EXCEPTION, NULL);
+
+	if (buffer_obj->bytes == NULL)
+		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+
+	offset = buffer_obj->array_offset.int_value + index;
+
+	if ( (offset < 0) || (offset > buffer_obj->bytes->length.int_value - size) )
+		bvm_throw_exception(BVM_ERR_ARRAY_INDEX_OUT_OF_BOUNDS_EXCEPTION, NULL);
+
+	return (bvm_uint8_t *) &buffer_obj->bytes->data[offset];
+}
+
+/**
+ * Assembles an unsigned value of up to four bytes.
+ *
+ * @param at the first byte
+ * @param size the number of bytes
+ * @param little \c BVM_TRUE if the bytes are little endian
+ */
+static bvm_uint32_t bytebuffer_get(const bvm_uint8_t *at, int size, bvm_bool_t little) {
+
+	bvm_uint32_t value = 0;
+	int i;
+
+	if (little) {
+		for (i = size; i-- > 0;) value = (value << 8) | at[i];
+	} else {
+		for (i = 0; i < size; i++) value = (value << 8) | at[i];
+	}
+
+	return value;
+}
+
+/**
+ * Splits the low bytes of a value into up to four bytes.
+ *
+ * @param at the first byte
+ * @param size the number of bytes
+ * @param value the value
+ * @param little \c BVM_TRUE if the bytes are to be little endian
+ */
+static void bytebuffer_put(bvm_uint8_t *at, int size, bvm_uint32_t value, bvm_bool_t little) {
+
+	int i;
+
+	if (little) {
+		for (i = 0; i < size; i++, value >>= 8) at[i] = (bvm_uint8_t) value;
+	} else {
+		for (i = size; i-- > 0; value >>= 8) at[i] = (bvm_uint8_t) value;
+	}
+}
+
+/*
+ * byte get()
+ */
+void java_nio_ByteBuffer_get(void *args) {
+	bytebuffer_obj_t *buffer_obj = NI_GetParameterAsObject(0);
+	NI_ReturnByte( (jbyte) *bytebuffer_at(buffer_obj, bytebuffer_next(buffer_obj, 1, BVM_FALSE), 1, BVM_FALSE));
+}
+
+/*
+ * byte get(int index)
+ */
+void java_nio_ByteBuffer_get_at(void *args) {
+	bytebuffer_obj_t *buffer_obj = NI_GetParameterAsObject(0);
+	NI_ReturnByte( (jbyte) *bytebuffer_at(buffer_obj, NI_GetParameterAsInt(1), 1, BVM_FALSE));
+}
+
+/*
+ * ByteBuffer put(byte b)
+ */
+void java_nio_ByteBuffer_put(void *args) {
+	bytebuffer_obj_t *buffer_obj = NI_GetParameterAsObject(0);
+	*bytebuffer_at(buffer_obj, bytebuffer_next(buffer_obj, 1, BVM_TRUE), 1, BVM_TRUE) = (bvm_uint8_t) NI_GetParameterAsByte(1);
+	NI_ReturnObject(buffer_obj);
+}
+
+/*
+ * ByteBuffer put(int index, byte b)
+ */
+void java_nio_ByteBuffer_put_at(void *args) {
+	bytebuffer_obj_t *buffer_obj = NI_GetParameterAsObject(0);
+	*bytebuffer_at(buffer_obj, NI_GetParameterAsInt(1), 1, BVM_TRUE) = (bvm_uint8_t) NI_GetParameterAsByte(2);
+	NI_ReturnObject(buffer_obj);
+}
+
+/*
+ * short getShort()
+ */
+void java_nio_ByteBuffer_getShort(void *args) {
+	bytebuffer_obj_t *buffer_obj = NI_GetParameterAsObject(0);
+	bvm_uint8_t *at = bytebuffer_at(buffer_obj, bytebuffer_next(buffer_obj, 2, BVM_FALSE), 2, BVM_FALSE);
+	NI_ReturnShort( (jshort) bytebuffer_get(at, 2, bytebuffer_is_little_endian(buffer_obj)));
+}
+
+/*
+ * short getShort(int index)
+ */
+void java_nio_ByteBuffer_getShort_at(void *args) {
+	bytebuffer_obj_t *buffer_obj = NI_GetParameterAsObject(0);
+	bvm_uint8_t *at = bytebuffer_at(buffer_obj, NI_GetParameterAsInt(1), 2, BVM_FALSE);
+	NI_ReturnShort( (jshort) bytebuffer_get(at, 2, bytebuffer_is_little_endian(buffer_obj)));
+}
+
+/*
+ * char getChar()
+ */
+void java_nio_ByteBuffer_getChar(void *args) {
+	bytebuffer_obj_t *buffer_obj = NI_GetParameterAsObject(0);
+	bvm_uint8_t *at = bytebuffer_at(buffer_obj, bytebuffer_next(buffer_obj, 2, BVM_FALSE), 2, BVM_FALSE);
+	NI_ReturnChar( (jchar) bytebuffer_get(at, 2, bytebuffer_is_little_endian(buffer_obj)));
+}
+
+/*
+ * char getChar(int index)
+ */
+void java_nio_ByteBuffer_getChar_at(void *args) {
+	bytebuffer_obj_t *buffer_obj = NI_GetParameterAsObject(0);
+	bvm_uint8_t *at = bytebuffer_at(buffer_obj, NI_GetParameterAsInt(1), 2, BVM_FALSE);
+	NI_ReturnChar( (jchar) bytebuffer_get(at, 2, bytebuffer_is_little_endian(buffer_obj)));
+}
+
+/*
+ * ByteBuffer putShort(short value) and ByteBuffer putChar(char value)
+ */
+void java_nio_ByteBuffer_putShort(void *args) {
+	bytebuffer_obj_t *buffer_obj = NI_GetParameterAsObject(0);
+	bvm_uint8_t *at = bytebuffer_at(buffer_obj, bytebuffer_next(buffer_obj, 2, BVM_TRUE), 2, BVM_TRUE);
+	bytebuffer_put(at, 2, (bvm_uint32_t) NI_GetParameterAsInt(1), bytebuffer_is_little_endian(buffer_obj));
+	NI_ReturnObject(buffer_obj);
+}
+
+/*
+ * ByteBuffer putShort(int index, short value) and ByteBuffer putChar(int index, char value)
+ */
+void java_nio_ByteBuffer_putShort_at(void *args) {
+	bytebuffer_obj_t *buffer_obj = NI_GetParameterAsObject(0);
+	bvm_uint8_t *at = bytebuffer_at(buffer_obj, NI_GetParameterAsInt(1), 2, BVM_TRUE);
+	bytebuffer_put(at, 2, (bvm_uint32_t) NI_GetParameterAsInt(2), bytebuffer_is_little_endian(buffer_obj));
+	NI_ReturnObject(buffer_obj);
+}
+
+/*
+ * int getInt()
+ */
+void java_nio_ByteBuffer_getInt(void *args) {
+	bytebuffer_obj_t *buffer_obj = NI_GetParameterAsObject(0);
+	bvm_uint8_t *at = bytebuffer_at(buffer_obj, bytebuffer_next(buffer_obj, 4, BVM_FALSE), 4, BVM_FALSE);
+	NI_ReturnInt( (jint) bytebuffer_get(at, 4, bytebuffer_is_little_endian(buffer_obj)));
+}
+
+/*
+ * int getInt(int index)
+ */
+void java_nio_ByteBuffer_getInt_at(void *args) {
+	bytebuffer_obj_t *buffer_obj = NI_GetParameterAsObject(0);
+	bvm_uint8_t *at = bytebuffer_at(buffer_obj, NI_GetParameterAsInt(1), 4, BVM_FALSE);
+	NI_ReturnInt( (jint) bytebuffer_get(at, 4, bytebuffer_is_little_endian(buffer_obj)));
+}
+
+/*
+ * ByteBuffer putInt(int value)
+ */
+void java_nio_ByteBuffer_putInt(void *args) {
+	bytebuffer_obj_t *buffer_obj = NI_GetParameterAsObject(0);
+	bvm_uint8_t *at = bytebuffer_at(buffer_obj, bytebuffer_next(buffer_obj, 4, BVM_TRUE), 4, BVM_TRUE);
+	bytebuffer_put(at, 4, (bvm_uint32_t) NI_GetParameterAsInt(1), bytebuffer_is_little_endian(buffer_obj));
+	NI_ReturnObject(buffer_obj);
+}
+
+/*
+ * ByteBuffer putInt(int index, int value)
+ */
+void java_nio_ByteBuffer_putInt_at(void *args) {
+	bytebuffer_obj_t *buffer_obj = NI_GetParameterAsObject(0);
+	bvm_uint8_t *at = bytebuffer_at(buffer_obj, NI_GetParameterAsInt(1), 4, BVM_TRUE);
+	bytebuffer_put(at, 4, (bvm_uint32_t) NI_GetParameterAsInt(2), bytebuffer_is_little_endian(buffer_obj));
+	NI_ReturnObject(buffer_obj);
+}
+
+#if BVM_NATIVE_INT64_ENABLE
+
+/**
+ * Assembles a \c long from eight bytes.
+ *
+ * @param at the first byte
+ * @param little \c BVM_TRUE if the bytes are little endian
+ */
+static jlong bytebuffer_get_long(const bvm_uint8_t *at, bvm_bool_t little) {
+
+	bvm_uint64_t high = bytebuffer_get(little ? at + 4 : at, 4, little);
+	bvm_uint64_t low  = bytebuffer_get(little ? at : at + 4, 4, little);
+
+	return (jlong) ((high << 32) | low);
+}
+
+/**
+ * Splits a \c long into eight bytes.
+ *
+ * @param at the first byte
+ * @param value the value
+ * @param little \c BVM_TRUE if the bytes are to be little endian
+ */
+static void bytebuffer_put_long(bvm_uint8_t *at, jlong value, bvm_bool_t little) {
+
+	bvm_uint32_t high = (bvm_uint32_t) ((bvm_uint64_t) value >> 32);
+	bvm_uint32_t low  = (bvm_uint32_t) value;
+
+	bytebuffer_put(little ? at + 4 : at, 4, high, little);
+	bytebuffer_put(little ? at : at + 4, 4, low, little);
+}
+
+/*
+ * long getLong()
+ */
+void java_nio_ByteBuffer_getLong(void *args) {
+	bytebuffer_obj_t *buffer_obj = NI_GetParameterAsObject(0);
+	bvm_uint8_t *at = bytebuffer_at(buffer_obj, bytebuffer_next(buffer_obj, 8, BVM_FALSE), 8, BVM_FALSE);
+	jlong value = bytebuffer_get_long(at, bytebuffer_is_little_endian(buffer_obj));
+	NI_ReturnLong(value);
+}
+
+/*
+ * long getLong(int index)
+ */
+void java_nio_ByteBuffer_getLong_at(void *args) {
+	bytebuffer_obj_t *buffer_obj = NI_GetParameterAsObject(0);
+	bvm_uint8_t *at = bytebuffer_at(buffer_obj, NI_GetParameterAsInt(1), 8, BVM_FALSE);
+	jlong value = bytebuffer_get_long(at, bytebuffer_is_little_endian(buffer_obj));
+	NI_ReturnLong(value);
+}
+
+/*
+ * ByteBuffer putLong(long value)
+ */
+void java_nio_ByteBuffer_putLong(void *args) {
+	bytebuffer_obj_t *buffer_obj = NI_GetParameterAsObject(0);
+	bvm_uint8_t *at = bytebuffer_at(buffer_obj, bytebuffer_next(buffer_obj, 8, BVM_TRUE), 8, BVM_TRUE);
+	bytebuffer_put_long(at, NI_GetParameterAsLong(1), bytebuffer_is_little_endian(buffer_obj));
+	NI_ReturnObject(buffer_obj);
+}
+
+/*
+ * ByteBuffer putLong(int index, long value)
+ */
+void java_nio_ByteBuffer_putLong_at(void *args) {
+	bytebuffer_obj_t *buffer_obj = NI_GetParameterAsObject(0);
+	bvm_uint8_t *at = bytebuffer_at(buffer_obj, NI_GetParameterAsInt(1), 8, BVM_TRUE);
+	bytebuffer_put_long(at, NI_GetParameterAsLong(2), bytebuffer_is_little_endian(buffer_obj));
+	NI_ReturnObject(buffer_obj);
+}
+
+#endif
+
+/**
+ * Checks the array, offset and length of a bulk get or put, and gives the address of the first byte of the array.
+ *
+ * @throw NullPointerException if the array is \c NULL
+ * @throw IndexOutOfBoundsException if the offset and length do not lie within the array
+ */
+static bvm_uint8_t *bytebuffer_bulk_array(bvm_jbyte_array_obj_t *array_obj, jint offset, jint length) {
+
+	if (array_obj == NULL)
+		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+
+	if ( (offset < 0) || (offset > array_obj->length.int_value) ||
+		 (length < 0) || (length > array_obj->length.int_value - offset) )
+		bvm_throw_exception(BVM_ERR_INDEX_OUT_OF_BOUNDS_EXCEPTION, NULL);
+
+	return (bvm_uint8_t *) &array_obj->data[offset];
+}
+
+/*
+ * ByteBuffer get(byte[] dst, int offset, int length)
+ */
+void java_nio_ByteBuffer_get_bulk(void *args) {
+
+	bytebuffer_obj_t *buffer_obj = NI_GetParameterAsObject(0);
+	jint length = NI_GetParameterAsInt(3);
+	bvm_uint8_t *dst = bytebuffer_bulk_array(NI_GetParameterAsObject(1), NI_GetParameterAsInt(2), length);
+
+	if (length > buffer_obj->limit.int_value - buffer_obj->position.int_value)
+		bvm_throw_exception(BVM_ERR_BUFFER_UNDERFLOW_EXCEPTION, NULL);
+
+	/* the array may be the one behind the buffer */
+	if (length > 0)
+		memmove(dst, bytebuffer_at(buffer_obj, buffer_obj->position.int_value, length, BVM_FALSE), length);
+
+	buffer_obj->position.int_value += length;
+
+	NI_ReturnObject(buffer_obj);
+}
+
+/*
+ * ByteBuffer put(byte[] src, int offset, int length)
+ */
+void java_nio_ByteBuffer_put_bulk(void *args) {
+
+	bytebuffer_obj_t *buffer_obj = NI_GetParameterAsObject(0);
+	jint length = NI_GetParameterAsInt(3);
+	bvm_uint8_t *src = bytebuffer_bulk_array(NI_GetParameterAsObject(1), NI_GetParameterAsInt(2), length);
+
+	if (length > buffer_obj->limit.int_value - buffer_obj->position.int_value)
+		bvm_throw_exception(BVM_ERR_BUFFER_OVERFLOW_EXCEPTION, NULL);
+
+	if (length > 0)
+		memmove(bytebuffer_at(buffer_obj, buffer_obj->position.int_value, length, BVM_TRUE), src, length);
+	else if (buffer_obj->is_read_only.int_value)
+		bvm_throw_exception(BVM_ERR_READ_ONLY_BUFFER_EXCEPTION, NULL);
+
+	buffer_obj->position.int_value += length;
+
+	NI_ReturnObject(buffer_obj);
+}
+
+#endif
+
+/***************************************************************************************************
+ * babe.io.File
+ **************************************************************************************************/
+
+typedef struct fileobjstruct {
+	BVM_COMMON_OBJ_INFO
+	bvm_cell_t native_handle;
+	bvm_cell_t flags;
+	bvm_cell_t flush_pending;
+} file_obj_t;
+
+/*
+ * flush a file if it needs it */
+static void flushfile(file_obj_t *file_obj) {
+
+	if (file_obj->flush_pending.int_value) {
+		if (bvm_file_flush(file_obj->native_handle.int_value) != 0)
+			bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+		file_obj->flush_pending.int_value = BVM_FALSE;
+	}
+}
+
+/*
+ * static int open0(String filename, int flags)
+ */
+void babe_io_File_open0(void *args) {
+
+	BVM_FILE file;
+	char *name;
+
+	/* the String name */
+	bvm_string_obj_t *string_obj = NI_GetParameterAsObject(0);
+
+	/* The open flags mode - note that no sanity checking is performed. */
+	jint flags = NI_GetParameterAsInt(1);
+
+	if (string_obj == NULL)
+		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+
+	/* convert the name to a c string (comes from the heap, so we'll clean it up later */
+	name = bvm_string_to_cstring(string_obj);
+
+	/* make the name transient just in case a GC is caused */
+	BVM_MAKE_TRANSIENT_ROOT(name);
+
+	/* perform the file open.  We'll get NULL back it it does not work */
+	file = bvm_file_open(bvm_gl_filetype_md, name, flags);
+
+	/* no can do?  whoops */
+	if (file == BVM_ERR)
+		bvm_throw_exception(BVM_ERR_FILE_NOT_FOUND_EXCEPTION, NULL);
+
+	bvm_heap_free(name);
+
+	/* void* handle is returned as ref.  VM will interpret it as int */
+	NI_ReturnInt(file);
+}
+
+/*
+ * void close() throws IOException
+ */
+void babe_io_File_close(void *args) {
+
+	/* the File object */
+	file_obj_t *file_obj = NI_GetParameterAsObject(0);
+
+	/* if the file is not closed, close it */
+	if (file_obj->native_handle.int_value != -1) {
+
+		/* flush if required */
+		flushfile(file_obj);
+
+		/* native file close will return -1 if any issues */
+		if (bvm_file_close(file_obj->native_handle.int_value) < 0)
+			bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+		/* set handle to -1 to indicate the file is now closed */
+		file_obj->native_handle.int_value = -1;
+	}
+
+	NI_ReturnVoid();
+}
+
+/*
+ * int read(byte[] dst, int offset, int count) throws IOException
+ */
+void babe_io_File_read(void *args) {
+
+	jint ret;
+
+	/* the File object */
+	file_obj_t *file_obj = NI_GetParameterAsObject(0);
+	BVM_FILE file = file_obj->native_handle.int_value;
+
+	/* the dest array and offset/count */
+	bvm_jbyte_array_obj_t *dst_array_obj = NI_GetParameterAsObject(1);
+	jint offset = NI_GetParameterAsInt(2);
+	jint count  = NI_GetParameterAsInt(3);
+
+	if (dst_array_obj == NULL)
+		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+
+	if ( (count < 0) || (offset < 0) || (count > dst_array_obj->length.int_value - offset) )
+		bvm_throw_exception(BVM_ERR_INDEX_OUT_OF_BOUNDS_EXCEPTION, NULL);
+
+	/* the file is closed, */
+	if (file_obj->native_handle.int_value == -1)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	/* if file is write only */
+	if (file_obj->flags.int_value & BVM_FILE_O_WRONLY)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	/* flush if required */
+	flushfile(file_obj);
+
+	/* Read zero bytes ?  Stupid.  Exit */
+	if (count == 0) {
+		NI_ReturnInt(0);
+		return;
+	}
+
+	/* native returns 0 if EOF, negative if error */
+#if BVM_FILE_BUFFER_ENABLE
+	ret = bvm_file_buffered_read(&dst_array_obj->data[offset], count, file);
+#else
+	ret = bvm_file_read(&dst_array_obj->data[offset], count, file);
+#endif
+
+	if (ret < 0)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	/* return -1 to java if eof, otherwise return nr bytes read */
+	NI_ReturnInt( ret == 0 ? -1 : ret);
+}
+
+/*
+ * void write(byte[] dst, int offset, int count) throws IOException
+ */
+void babe_io_File_write(void *args) {
+
+	/* the File object */
+	file_obj_t *file_obj = NI_GetParameterAsObject(0);
+	BVM_FILE file = file_obj->native_handle.int_value;
+
+	/* the source array and offset/count */
+	bvm_jbyte_array_obj_t *src_array_obj = NI_GetParameterAsObject(1);
+	jint offset = NI_GetParameterAsInt(2);
+	jint count  = NI_GetParameterAsInt(3);
+
+
+	if (src_array_obj == NULL)
+		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+
+	if ( (count < 0) || (offset < 0) || (count > src_array_obj->length.int_value - offset) )
+		bvm_throw_exception(BVM_ERR_INDEX_OUT_OF_BOUNDS_EXCEPTION, NULL);
+
+	/* the file is closed, */
+	if (file_obj->native_handle.int_value == -1)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	/* if file is read only */
+	if ( (file_obj->flags.int_value & (BVM_FILE_O_WRONLY | BVM_FILE_O_RDWR)) == BVM_FILE_O_RDONLY)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	/* Write zero bytes ?  Stupid.  Exit */
+	if (count == 0) return;
+
+	/* native call returns less than count if error*/
+#if BVM_FILE_BUFFER_ENABLE
+	if ( (jint) bvm_file_buffered_write(&src_array_obj->data[offset],count,file) != count)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+#else
+	if ( (jint) bvm_file_write(&src_array_obj->data[offset],count,file) != count)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+#endif
+
+	/* done a write, make sure we flush if required to */
+	file_obj->flush_pending.int_value = BVM_TRUE;
+
+	NI_ReturnVoid();
+}
+
+#if BVM_FILE_ASYNC_ENABLE
+
+/*
+ * The reads and writes of a file handed to a host thread (see bvm_file_async_start).  The calling thread is
+ * parked while the host thread has them, and other threads carry on.  A native that parks a thread returns
+ * void, so the read or write is started by one native and finished by another.  The Java methods of
+ * babe.io.File are expected to be:
+ *
+ *   public int readAsync(byte[] dst, int offset, int count) throws IOException {
+ *       startAsync0(dst, offset, count, false);
+ *       return finishAsync0(dst, offset);
+ *   }
+ *   public void writeAsync(byte[] src, int offset, int count) throws IOException {
+ *       startAsync0(src, offset, count, true);
+ *       finishAsync0(null, 0);
+ *   }
+ *   private native void startAsync0(byte[] buf, int offset, int count, boolean write) throws IOException;
+ *   private native int finishAsync0(byte[] dst, int offset) throws IOException;
+ */
+
+/*
+ * private void startAsync0(byte[] buf, int offset, int count, boolean write) throws IOException
+ */
+void babe_io_File_startAsync0(void *args) {
+
+	bvm_file_async_t *async;
+
+	/* the File object */
+	file_obj_t *file_obj = NI_GetParameterAsObject(0);
+
+	/* the array and offset/count */
+	bvm_jbyte_array_obj_t *array_obj = NI_GetParameterAsObject(1);
+	jint offset = NI_GetParameterAsInt(2);
+	jint count  = NI_GetParameterAsInt(3);
+	jboolean is_write = NI_GetParameterAsBoolean(4);
+
+	if (array_obj == NULL)
+		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+
+	if ( (count < 0) || (offset < 0) || (count > array_obj->length.int_value - offset) )
+		bvm_throw_exception(BVM_ERR_INDEX_OUT_OF_BOUNDS_EXCEPTION, NULL);
+
+	/* the file is closed, */
+	if (file_obj->native_handle.int_value == -1)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	/* if the file is read only, or write only */
+	if (is_write) {
+		if ( (file_obj->flags.int_value & (BVM_FILE_O_WRONLY | BVM_FILE_O_RDWR)) == BVM_FILE_O_RDONLY)
+			bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+	} else {
+		if (file_obj->flags.int_value & BVM_FILE_O_WRONLY)
+			bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+		/* flush if required */
+		flushfile(file_obj);
+	}
+
+	/* nothing to do - the finish gives zero */
+	if (count == 0) {
+		NI_ReturnVoid();
+		return;
+	}
+
+	/* NULL if the file is already lent to another read or write */
+	async = bvm_file_async_start(file_obj->native_handle.int_value, &array_obj->data[offset], count, is_write);
+
+	if (async == NULL)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	bvm_thread_wait_for_file(async);
+
+	NI_ReturnVoid();
+}
+
+/*
+ * private int finishAsync0(byte[] dst, int offset) throws IOException
+ */
+void babe_io_File_finishAsync0(void *args) {
+
+	bvm_file_async_t *async = bvm_gl_thread_current->file_async;
+	jint ret;
+
+	/* the File object */
+	file_obj_t *file_obj = NI_GetParameterAsObject(0);
+
+	/* the dest array and offset - unused for a write */
+	bvm_jbyte_array_obj_t *dst_array_obj = NI_GetParameterAsObject(1);
+	jint offset = NI_GetParameterAsInt(2);
+
+	/* a read or write of zero bytes */
+	if (async == NULL) {
+		NI_ReturnInt(0);
+		return;
+	}
+
+	bvm_gl_thread_current->file_async = NULL;
+
+	/* native returns 0 if EOF, negative if error, less than count on a write error */
+	ret = (jint) async->result;
+
+	if (async->is_write) {
+
+		/* done a write, make sure we flush if required to */
+		file_obj->flush_pending.int_value = BVM_TRUE;
+
+		if (ret != (jint) async->count)
+			ret = BVM_ERR;
+
+	} else if (ret > 0) {
+
+		if ( (dst_array_obj == NULL) || (offset < 0) || (ret > dst_array_obj->length.int_value - offset) )
+			ret = BVM_ERR;
+		else
+			memcpy(&dst_array_obj->data[offset], async->data, ret);
+	}
+
+	bvm_file_async_free(async);
+
+	if (ret < 0)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	/* return -1 to java if eof, otherwise return nr bytes read or written */
+	NI_ReturnInt( ret == 0 ? -1 : ret);
+}
+
+#endif
+
+/*
+ * void setPosition(int offset, int origin) throws IOException
+ */
+void babe_io_File_setPosition(void *args) {
+
+	jint ret;
+
+	/* the File object */
+	file_obj_t *file_obj = NI_GetParameterAsObject(0);
+	BVM_FILE file = file_obj->native_handle.int_value;
+
+	jint offset = NI_GetParameterAsInt(1);
+	jint origin = NI_GetParameterAsInt(2);
+
+	/* the file is closed, */
+	if (file_obj->native_handle.int_value == -1)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	/* force a flush if required */
+	flushfile(file_obj);
+
+	/* returns new position, or -1 is error */
+	ret = bvm_file_setpos(file, offset, origin);
+
+	if (ret == -1)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	NI_ReturnVoid();
+}
+
+/*
+ * int getPosition() throws IOException
+ */
+void babe_io_File_getPosition(void *args) {
+
+	jint ret;
+
+	/* the File object */
+	file_obj_t *file_obj = NI_GetParameterAsObject(0);
+	BVM_FILE file = file_obj->native_handle.int_value;
+
+	/* the file is closed, */
+	if (file_obj->native_handle.int_value == -1)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	/* force a flush if required */
+	flushfile(file_obj);
+
+	/* returns current position, or -1 is error */
+	ret = bvm_file_getpos(file);
+
+	if (ret == -1)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	NI_ReturnInt(ret);
+}
+
+/*
+ * int sizeOf() throws IOException
+ */
+void babe_io_File_sizeOf(void *args) {
+
+	jint ret;
+
+	/* the File object */
+	file_obj_t *file_obj = NI_GetParameterAsObject(0);
+	BVM_FILE file = file_obj->native_handle.int_value;
+
+	/* the file is closed, */
+	if (file_obj->native_handle.int_value == -1)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	/* force a flush if required */
+	flushfile(file_obj);
+
+	/* returns size or -1 if error */
+	ret = bvm_file_sizeof(file);
+
+	if (ret == -1)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	NI_ReturnInt(ret);
+}
+
+/*
+ * static void rename(String oldname, String newname) throws IOException
+ */
+void babe_io_File_rename(void *args) {
+
+	char *oldname;
+	char *newname;
+
+	/* the String file name */
+	bvm_string_obj_t *old_string_obj = NI_GetParameterAsObject(0);
+	bvm_string_obj_t *new_string_obj = NI_GetParameterAsObject(1);
+
+	if (old_string_obj == NULL)
+		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+
+	if (new_string_obj == NULL)
+		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+
+	/* convert the old name to a c string */
+	oldname = bvm_string_to_cstring(old_string_obj);
+	BVM_MAKE_TRANSIENT_ROOT(oldname);
+
+	/* convert the new name to a c string */
+	newname = bvm_string_to_cstring(new_string_obj);
+	BVM_MAKE_TRANSIENT_ROOT(newname);
+
+	/* returns -1 if error */
+	if (bvm_file_rename(oldname, newname) == -1)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	bvm_heap_free(oldname);
+	bvm_heap_free(newname);
+
+	NI_ReturnVoid();
+}
+
+/*
+ * static void remove(String filename) throws IOException
+ */
+void babe_io_File_remove(void *args) {
+
+	char *name;
+
+	/* the String file name */
+	bvm_string_obj_t *string_obj = NI_GetParameterAsObject(0);
+
+	if (string_obj == NULL)
+		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+
+	/* convert the name to a c string */
+	name = bvm_string_to_cstring(string_obj);
+	BVM_MAKE_TRANSIENT_ROOT(name);
+
+	/* returns -1 if error */
+	if (bvm_file_remove(name) == -1)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	bvm_heap_free(name);
+
+	NI_ReturnVoid();
+}
+
+/*
+ * static boolean exists(String filename) throws IOException
+ */
+void babe_io_File_exists(void *args) {
+
+	jint ret;
+	char *name;
+
+	/* the String file name */
+	bvm_string_obj_t *string_obj = NI_GetParameterAsObject(0);
+
+	if (string_obj == NULL)
+		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+
+	/* convert the name to a c string */
+	name = bvm_string_to_cstring(string_obj);
+	BVM_MAKE_TRANSIENT_ROOT(name);
+
+	/* returns -1 if error */
+	ret = bvm_file_exists(name);
+
+	if ( ret == -1)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	bvm_heap_free(name);
+
+	NI_ReturnBoolean(ret);
+}
+
+/*
+ * void truncate(int newlength) throws IOException
+ */
+void babe_io_File_truncate(void *args) {
+
+	/* the File object */
+	file_obj_t *file_obj = NI_GetParameterAsObject(0);
+	BVM_FILE file = file_obj->native_handle.int_value;
+
+	jint newlen = NI_GetParameterAsInt(1);
+
+	/* the file is closed, */
+	if (file_obj->native_handle.int_value == -1)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	if (newlen < 0)
+		bvm_throw_exception(BVM_ERR_ILLEGAL_ARGUMENT_EXCEPTION, NULL);
+
+	/* read only?  Bang! */
+	if ( (file_obj->flags.int_value & (BVM_FILE_O_WRONLY | BVM_FILE_O_RDWR)) == BVM_FILE_O_RDONLY)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	/* force a flush if required */
+	flushfile(file_obj);
+
+	if (newlen > (jint) bvm_file_sizeof(file))
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	/* returns -1 if error */
+	if (bvm_file_truncate(file, newlen) == -1)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	NI_ReturnVoid();
+}
+
+#if BVM_FILE_MAP_ENABLE
+
+/***************************************************************************************************
+ * babe.io.MappedFile
+ *
+ * A MappedFile reads a babe.io.File that has been mapped into memory (see bvm_file_map), so large
+ * read-only data can be used in place rather than read into the heap.  The mapping belongs to the file
+ * and goes when the file is closed.  The Java class is expected to be:
+ *
+ *   public final class MappedFile {
+ *       private File _file;
+ *       private int _size;
+ *       public MappedFile(File file) throws IOException { _file = file; _size = map0(file); }
+ *       private static native int map0(File file) throws IOException;
+ *       public int size() { return _size; }
+ *       public native byte get(int position) throws IOException;
+ *       public native void get(int position, byte[] dst, int offset, int count) throws IOException;
+ *       public native short getShort(int position) throws IOException;
+ *       public native int getInt(int position) throws IOException;
+ *   }
+ *
+ * Multi-byte values are read big-endian, as by java.io.DataInput.
+ **************************************************************************************************/
+
+typedef struct mappedfileobjstruct {
+	BVM_COMMON_OBJ_INFO
+	file_obj_t *file;
+	bvm_cell_t size;
+} mappedfile_obj_t;
+
 /*
- * void write(byte[] dst, int offset, int count) throws IOException
+ * Give the address in the mapping of a MappedFile of 'count' bytes from 'position', throwing an
+ * IOException if its file has been closed and an IndexOutOfBoundsException if the bytes are not all
+ * in the mapping. */
+static bvm_uint8_t *mappedfile_at(mappedfile_obj_t *mappedfile_obj, jint position, jint count) {
+
+	file_obj_t *file_obj = mappedfile_obj->file;
+	bvm_uint8_t *map;
+
+	if ( (file_obj == NULL) || (file_obj->native_handle.int_value == -1) )
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	map = bvm_file_map(file_obj->native_handle.int_value);
+
+	if (map == NULL)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	if ( (count < 0) || (position < 0) || ( (bvm_uint32_t) position + count > bvm_file_map_size(file_obj->native_handle.int_value) ) )
+		bvm_throw_exception(BVM_ERR_INDEX_OUT_OF_BOUNDS_EXCEPTION, NULL);
+
+	return map + position;
+}
+
+/*
+ * static int map0(File file) throws IOException
  */
-void babe_io_File_write(void *args) {
+void babe_io_MappedFile_map0(void *args) {
 
-	/* the File object */
 	file_obj_t *file_obj = NI_GetParameterAsObject(0);
-	BVM_FILE file = file_obj->native_handle;
 
-	/* the source array and offset/count */
-	bvm_jbyte_array_obj_t *src_array_obj = NI_GetParameterAsObject(1);
-	jint offset = NI_GetParameterAsInt(2);
-	jint count  = NI_GetParameterAsInt(3);
+	if (file_obj == NULL)
+		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
 
+	if (file_obj->native_handle.int_value == -1)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
 
-	if (src_array_obj == NULL)
+	/* the mapping must see what has been written */
+	flushfile(file_obj);
+
+	/* no can do, or an empty file */
+	if (bvm_file_map(file_obj->native_handle.int_value) == NULL)
+		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+	NI_ReturnInt(bvm_file_map_size(file_obj->native_handle.int_value));
+}
+
+/*
+ * byte get(int position) throws IOException
+ */
+void babe_io_MappedFile_get(void *args) {
+
+	bvm_uint8_t *at = mappedfile_at(NI_GetParameterAsObject(0), NI_GetParameterAsInt(1), 1);
+
+	NI_ReturnByte( (jbyte) at[0]);
+}
+
+/*
+ * void get(int position, byte[] dst, int offset, int count) throws IOException
+ */
+void babe_io_MappedFile_getBytes(void *args) {
+
+	mappedfile_obj_t *mappedfile_obj = NI_GetParameterAsObject(0);
+	jint position = NI_GetParameterAsInt(1);
+	bvm_jbyte_array_obj_t *dst_array_obj = NI_GetParameterAsObject(2);
+	jint offset = NI_GetParameterAsInt(3);
+	jint count  = NI_GetParameterAsInt(4);
+
+	if (dst_array_obj == NULL)
 		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
 
-	if ( (count < 0) || (offset < 0) || (count > src_array_obj->length.int_value - offset) )
+	if ( (count < 0) || (offset < 0) || (count > dst_array_obj->length.int_value - offset) )
 		bvm_throw_exception(BVM_ERR_INDEX_OUT_OF_BOUNDS_EXCEPTION, NULL);
 
-	/* the file is closed, */
-	if (file_obj->native_handle == -1)
+	memcpy(&dst_array_obj->data[offset], mappedfile_at(mappedfile_obj, position, count), count);
+
+	NI_ReturnVoid();
+}
+
+/*
+ * short getShort(int position) throws IOException
+ */
+void babe_io_MappedFile_getShort(void *args) {
+
+	bvm_uint8_t *at = mappedfile_at(NI_GetParameterAsObject(0), NI_GetParameterAsInt(1), 2);
+
+	NI_ReturnShort( (jshort) ( (at[0] << 8) | at[1]) );
+}
+
+/*
+ * int getInt(int position) throws IOException
+ */
+void babe_io_MappedFile_getInt(void *args) {
+
+	bvm_uint8_t *at = mappedfile_at(NI_GetParameterAsObject(0), NI_GetParameterAsInt(1), 4);
+
+	NI_ReturnInt( (jint) ( ((bvm_uint32_t) at[0] << 24) | ((bvm_uint32_t) at[1] << 16) | ((bvm_uint32_t) at[2] << 8) | at[3]) );
+}
+
+#endif
+
+
+#if BVM_SOCKETS_ENABLE
+
+/***************************************************************************************************
+ * babe.io.Socket / babe.io.ServerSocket
+ *
+ * Sockets are plain int handles.  Reads and writes go straight to and from the data of the given
+ * byte[] - no intermediate C buffer.  Sockets are made non-blocking as they are opened or accepted, so none
+ * of these block the VM: read0() and write0() return 0 when nothing can be read or written, and the Java side
+ * is expected to call await0() to park its thread until the socket is ready (see bvm_thread_wait_for_socket)
+ * and then try again.  The Java side is expected to be along the lines of:
+ *
+ *   public final class Socket {
+ *       private static final int READ = 1, WRITE = 2;
+ *       public int read(byte[] b, int off, int len) throws IOException {
+ *           int n;
+ *           while ( ((n = read0(fd, b, off, len)) == 0) && (len > 0) ) await0(fd, READ, 0);
+ *           return n;
+ *       }
+ *       public void write(byte[] b, int off, int len) throws IOException {
+ *           while (len > 0) {
+ *               int n = write0(fd, b, off, len);
+ *               if (n == 0) await0(fd, WRITE, 0);
+ *               off += n;
+ *               len -= n;
+ *           }
+ *       }
+ *   }
+ **************************************************************************************************/
+
+/*
+ * check a byte array and an offset/count into it are good.
+ */
+static void check_socket_array(bvm_jbyte_array_obj_t *array_obj, jint offset, jint count) {
+
+	if (array_obj == NULL)
+		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+
+	if ( (count < 0) || (offset < 0) || (count > array_obj->length.int_value - offset) )
+		bvm_throw_exception(BVM_ERR_INDEX_OUT_OF_BOUNDS_EXCEPTION, NULL);
+}
+
+/*
+ * static int open0(String hostname, int port) throws IOException
+ */
+void babe_io_Socket_open0(void *args) {
+
+	bvm_int32_t fd;
+	char *hostname;
+
+	/* the String host name */
+	bvm_string_obj_t *string_obj = NI_GetParameterAsObject(0);
+	jint port = NI_GetParameterAsInt(1);
+
+	if (string_obj == NULL)
+		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+
+	hostname = bvm_string_to_cstring(string_obj);
+
+	fd = bvm_pd_socket_open(hostname, port);
+
+	bvm_heap_free(hostname);
+
+	if (fd < 0)
 		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
 
-	/* if file is read only */
-	if ( (file_obj->flags & BVM_FILE_O_RDONLY) == BVM_FILE_O_RDONLY)
+	if (bvm_pd_socket_set_nonblocking(fd) != BVM_SOCKET_OK) {
+		bvm_pd_socket_close(fd);
 		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+	}
 
-	/* Write zero bytes ?  Stupid.  Exit */
-	if (count == 0) return;
+	NI_ReturnInt(fd);
+}
 
-	/* native call returns less than count if error*/
-	if ( (jint) bvm_file_write(&src_array_obj->data[offset],count,file) != count)
+/*
+ * static int ready0(int fd, int events) throws IOException
+ *
+ * Returns the readiness of the socket for the given events without waiting.
+ */
+void babe_io_Socket_ready0(void *args) {
+
+	bvm_pd_socket_poll_t poll;
+
+	poll.fd = NI_GetParameterAsInt(0);
+	poll.events = (bvm_uint8_t) NI_GetParameterAsInt(1);
+
+	if (bvm_pd_socket_poll(&poll, 1, 0) == BVM_SOCKET_ERROR)
 		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
 
-	/* done a write, make sure we flush if required to */
-	file_obj->flush_pending = BVM_TRUE;
+	NI_ReturnInt(poll.ready);
+}
+
+/*
+ * static void await0(int fd, int events, long timeout) throws InterruptedException
+ *
+ * Parks the current thread until the socket is ready for the given events, or the timeout expires.  Zero
+ * timeout waits until ready.
+ */
+void babe_io_Socket_await0(void *args) {
+
+	bvm_int32_t fd = NI_GetParameterAsInt(0);
+	jint events = NI_GetParameterAsInt(1);
+	bvm_int64_t timeout = BVM_INT64_from_cells( ((bvm_cell_t*)args)+2);
+
+	if (BVM_INT64_zero_lt(timeout))
+		bvm_throw_exception(BVM_ERR_ILLEGAL_ARGUMENT_EXCEPTION, "timeout negative");
+
+	bvm_thread_wait_for_socket(fd, (bvm_uint8_t) events, timeout);
 
 	NI_ReturnVoid();
 }
 
 /*
- * void setPosition(int offset, int origin) throws IOException
+ * static int read0(int fd, byte[] dst, int offset, int count) throws IOException
+ *
+ * Reads whatever is waiting, up to count bytes.  Returns 0 if nothing is waiting (await0 for READ), or -1 if the
+ * connection has been closed.
  */
-void babe_io_File_setPosition(void *args) {
+void babe_io_Socket_read0(void *args) {
 
-	jint ret;
+	bvm_int32_t ret;
 
-	/* the File object */
-	file_obj_t *file_obj = NI_GetParameterAsObject(0);
-	BVM_FILE file = file_obj->native_handle;
+	bvm_int32_t fd = NI_GetParameterAsInt(0);
+	bvm_jbyte_array_obj_t *dst_array_obj = NI_GetParameterAsObject(1);
+	jint offset = NI_GetParameterAsInt(2);
+	jint count  = NI_GetParameterAsInt(3);
 
-	jint offset = NI_GetParameterAsInt(1);
-	jint origin = NI_GetParameterAsInt(2);
+	check_socket_array(dst_array_obj, offset, count);
 
-	/* the file is closed, */
-	if (file_obj->native_handle == -1)
-		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+	if (count == 0) {
+		NI_ReturnInt(0);
+		return;
+	}
 
-	/* force a flush if required */
-	flushfile(file_obj);
+	/* straight into the array data - no GC can happen during the read */
+	ret = bvm_pd_socket_recv(fd, (char *) &dst_array_obj->data[offset], count);
 
-	/* returns new position, or -1 is error */
-	ret = bvm_file_setpos(file, offset, origin);
+	if (ret == BVM_SOCKET_WOULD_BLOCK) {
+		NI_ReturnInt(0);
+		return;
+	}
 
-	if (ret == -1)
+	if (ret < 0)
 		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
 
-	NI_ReturnVoid();
+	/* return -1 to java if closed, otherwise return nr bytes read */
+	NI_ReturnInt( ret == 0 ? -1 : ret);
 }
 
 /*
- * int getPosition() throws IOException
+ * static int write0(int fd, byte[] src, int offset, int count) throws IOException
+ *
+ * Returns the number of bytes written, which may be less than count - and is 0 if there is no room to write anything
+ * (await0 for WRITE).
  */
-void babe_io_File_getPosition(void *args) {
+void babe_io_Socket_write0(void *args) {
 
-	jint ret;
+	bvm_int32_t ret = 0;
 
-	/* the File object */
-	file_obj_t *file_obj = NI_GetParameterAsObject(0);
-	BVM_FILE file = file_obj->native_handle;
+	bvm_int32_t fd = NI_GetParameterAsInt(0);
+	bvm_jbyte_array_obj_t *src_array_obj = NI_GetParameterAsObject(1);
+	jint offset = NI_GetParameterAsInt(2);
+	jint count  = NI_GetParameterAsInt(3);
 
-	/* the file is closed, */
-	if (file_obj->native_handle == -1)
-		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+	check_socket_array(src_array_obj, offset, count);
 
-	/* force a flush if required */
-	flushfile(file_obj);
+	/* straight from the array data */
+	if (count != 0)
+		ret = bvm_pd_socket_write(fd, (const char *) &src_array_obj->data[offset], count);
 
-	/* returns current position, or -1 is error */
-	ret = bvm_file_getpos(file);
+	if (ret == BVM_SOCKET_WOULD_BLOCK)
+		ret = 0;
 
-	if (ret == -1)
+	if (ret < 0)
 		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
 
 	NI_ReturnInt(ret);
 }
 
 /*
- * int sizeOf() throws IOException
+ * static void close0(int fd)
  */
-void babe_io_File_sizeOf(void *args) {
+void babe_io_Socket_close0(void *args) {
+	bvm_pd_socket_close(NI_GetParameterAsInt(0));
+	NI_ReturnVoid();
+}
 
-	jint ret;
+/*
+ * static int open0(int port) throws IOException
+ */
+void babe_io_ServerSocket_open0(void *args) {
 
-	/* the File object */
-	file_obj_t *file_obj = NI_GetParameterAsObject(0);
-	BVM_FILE file = file_obj->native_handle;
+	bvm_int32_t fd = bvm_pd_socket_server_open(NI_GetParameterAsInt(0));
 
-	/* the file is closed, */
-	if (file_obj->native_handle == -1)
+	if (fd < 0)
 		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
 
-	/* force a flush if required */
-	flushfile(file_obj);
+	NI_ReturnInt(fd);
+}
 
-	/* returns size or -1 if error */
-	ret = bvm_file_sizeof(file);
+/*
+ * static int accept0(int fd) throws IOException
+ *
+ * Returns an accepted socket, or -1 if no connection is pending (await0 first).
+ */
+void babe_io_ServerSocket_accept0(void *args) {
 
-	if (ret == -1)
+	bvm_pd_socket_poll_t poll;
+	bvm_int32_t fd = -1;
+
+	poll.fd = NI_GetParameterAsInt(0);
+	poll.events = BVM_SOCKET_POLL_READ;
+
+	if (bvm_pd_socket_poll(&poll, 1, 0) == BVM_SOCKET_ERROR)
 		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
 
-	NI_ReturnInt(ret);
+	/* only accept when a connection is known to be pending - the platform accept
+	 * closes the server socket if it finds none */
+	if (poll.ready != 0) {
+		fd = bvm_pd_socket_server_accept(poll.fd, -1);
+		if (fd < 0)
+			bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+
+		if (bvm_pd_socket_set_nonblocking(fd) != BVM_SOCKET_OK) {
+			bvm_pd_socket_close(fd);
+			bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+		}
+	}
+
+	NI_ReturnInt(fd);
+}
+
+/*
+ * static void close0(int fd)
+ */
+void babe_io_ServerSocket_close0(void *args) {
+	bvm_pd_socket_server_close(NI_GetParameterAsInt(0));
+	NI_ReturnVoid();
+}
+
+#endif
+
+#if BVM_PROFILER_ENABLE
+
+/***************************************************************************************************
+ * babe.lang.Profiler
+ *
+ * The sampling profiler (see profiler.c).  The Java side is expected to be:
+ *
+ *   public final class Profiler {
+ *       public static native void start();
+ *       public static native void stop();
+ *       public static native void reset();
+ *       public static native boolean dump(String filename);
+ *   }
+ **************************************************************************************************/
+
+/*
+ * static void start()
+ */
+void babe_lang_Profiler_start(void *args) {
+	UNUSED(args);
+	bvm_profiler_start();
+	NI_ReturnVoid();
+}
+
+/*
+ * static void stop()
+ */
+void babe_lang_Profiler_stop(void *args) {
+	UNUSED(args);
+	bvm_profiler_stop();
+	NI_ReturnVoid();
+}
+
+/*
+ * static void reset()
+ */
+void babe_lang_Profiler_reset(void *args) {
+	UNUSED(args);
+	bvm_profiler_reset();
+	NI_ReturnVoid();
+}
+
+/*
+ * static boolean dump(String filename)
+ *
+ * Writes the counts so far in collapsed stack format.  Returns false if the file could not be written.
+ */
+void babe_lang_Profiler_dump(void *args) {
+
+	bvm_string_obj_t *filename_obj = NI_GetParameterAsObject(0);
+	char *filename;
+	bvm_bool_t result;
+
+	if (filename_obj == NULL)
+		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+
+	filename = bvm_string_to_cstring(filename_obj);
+	result = bvm_profiler_dump_to_file(filename);
+	bvm_heap_free(filename);
+
+	NI_ReturnInt(result);
+}
+
+#endif
+
+#if BVM_PROFILER_METHOD_COUNTERS_ENABLE
+
+/***************************************************************************************************
+ * babe.lang.Profiler method counters
+ *
+ * The per-method counters (see profiler.c).  The Java side is expected to add to babe.lang.Profiler:
+ *
+ *       public static native void resetMethodCounts();
+ *       public static native boolean dumpMethodCounts(String filename);
+ **************************************************************************************************/
+
+/*
+ * static void resetMethodCounts()
+ */
+void babe_lang_Profiler_resetMethodCounts(void *args) {
+	UNUSED(args);
+	bvm_profiler_method_counts_reset();
+	NI_ReturnVoid();
+}
+
+/*
+ * static boolean dumpMethodCounts(String filename)
+ *
+ * Writes the counts of each method that has any.  Returns false if the file could not be written.
+ */
+void babe_lang_Profiler_dumpMethodCounts(void *args) {
+
+	bvm_string_obj_t *filename_obj = NI_GetParameterAsObject(0);
+	char *filename;
+	bvm_bool_t result;
+
+	if (filename_obj == NULL)
+		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+
+	filename = bvm_string_to_cstring(filename_obj);
+	result = bvm_profiler_method_counts_dump_to_file(filename);
+	bvm_heap_free(filename);
+
+	NI_ReturnInt(result);
+}
+
+#endif
+
+#if BVM_PROFILER_MONITOR_CONTENTION_ENABLE
+
+/***************************************************************************************************
+ * babe.lang.Profiler monitor contention
+ *
+ * The monitor contention sites (see profiler.c).  The Java side is expected to add to babe.lang.Profiler:
+ *
+ *       public static native void resetContention();
+ *       public static native boolean dumpContention(String filename);
+ **************************************************************************************************/
+
+/*
+ * static void resetContention()
+ */
+void babe_lang_Profiler_resetContention(void *args) {
+	UNUSED(args);
+	bvm_profiler_contention_reset();
+	NI_ReturnVoid();
 }
 
 /*
- * static void rename(String oldname, String newname) throws IOException
+ * static boolean dumpContention(String filename)
+ *
+ * Writes the contention sites, most time blocked first.  Returns false if the file could not be written.
  */
-void babe_io_File_rename(void *args) {
+void babe_lang_Profiler_dumpContention(void *args) {
 
-	char *oldname;
-	char *newname;
-
-	/* the String file name */
-	bvm_string_obj_t *old_string_obj = NI_GetParameterAsObject(0);
-	bvm_string_obj_t *new_string_obj = NI_GetParameterAsObject(1);
+	bvm_string_obj_t *filename_obj = NI_GetParameterAsObject(0);
+	char *filename;
+	bvm_bool_t result;
 
-	if (old_string_obj == NULL)
+	if (filename_obj == NULL)
 		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
 
-	if (new_string_obj == NULL)
-		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+	filename = bvm_string_to_cstring(filename_obj);
+	result = bvm_profiler_contention_dump_to_file(filename);
+	bvm_heap_free(filename);
 
-	/* convert the old name to a c string */
-	oldname = bvm_string_to_cstring(old_string_obj);
-	BVM_MAKE_TRANSIENT_ROOT(oldname);
+	NI_ReturnInt(result);
+}
 
-	/* convert the new name to a c string */
-	newname = bvm_string_to_cstring(new_string_obj);
-	BVM_MAKE_TRANSIENT_ROOT(newname);
+#endif
 
-	/* returns -1 if error */
-	if (bvm_file_rename(oldname, newname) == -1)
-		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+#if BVM_VM_ISOLATES_ENABLE
 
-	bvm_heap_free(oldname);
-	bvm_heap_free(newname);
+/***************************************************************************************************
+ * babe.lang.Isolate
+ *
+ * Isolates are plain int ids (see bvm_vm_isolate_start).  An isolate is a whole VM on an OS thread
+ * of its own, given the same arguments as the command line.  join0() waits in the OS, so the Java side
+ * is expected to poll isAlive0() (sleeping between) until the isolate has finished, and only then join.
+ **************************************************************************************************/
 
-	NI_ReturnVoid();
+/*
+ * check an isolate id is good.
+ */
+static void check_isolate_id(jint id) {
+	if (!bvm_vm_isolate_is_valid(id))
+		bvm_throw_exception(BVM_ERR_ILLEGAL_ARGUMENT_EXCEPTION, "invalid isolate");
 }
 
 /*
- * static void remove(String filename) throws IOException
+ * static int start0(String[] args)
+ *
+ * The arguments are copied out of this VM's heap - the isolate has a heap of its own.
  */
-void babe_io_File_remove(void *args) {
-
-	char *name;
+void babe_lang_Isolate_start0(void *args) {
 
-	/* the String file name */
-	bvm_string_obj_t *string_obj = NI_GetParameterAsObject(0);
+	bvm_instance_array_obj_t *array_obj = NI_GetParameterAsObject(0);
+	char **argv;
+	volatile int argc = 0;
+	int length, id;
 
-	if (string_obj == NULL)
+	if (array_obj == NULL)
 		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
 
-	/* convert the name to a c string */
-	name = bvm_string_to_cstring(string_obj);
-	BVM_MAKE_TRANSIENT_ROOT(name);
+	length = array_obj->length.int_value;
 
-	/* returns -1 if error */
-	if (bvm_file_remove(name) == -1)
-		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+	for (id = 0; id < length; id++)
+		if (BVM_REF_Decode(array_obj->data[id]) == NULL)
+			bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
 
-	bvm_heap_free(name);
+	argv = bvm_pd_memory_alloc( (length + 1) * sizeof(char *));
 
-	NI_ReturnVoid();
-}
+	if (argv == NULL)
+		bvm_throw_exception(BVM_ERR_OUT_OF_MEMORY_ERROR, NULL);
 
-/*
- * static boolean exists(String filename) throws IOException
- */
-void babe_io_File_exists(void *args) {
+	BVM_TRY {
+		for (; argc < length; argc++) {
 
-	jint ret;
-	char *name;
+			char *cstring = bvm_string_to_cstring((bvm_string_obj_t *) BVM_REF_Decode(array_obj->data[argc]));
 
-	/* the String file name */
-	bvm_string_obj_t *string_obj = NI_GetParameterAsObject(0);
+			argv[argc] = bvm_pd_memory_alloc(strlen(cstring) + 1);
+			if (argv[argc] != NULL) strcpy(argv[argc], cstring);
 
-	if (string_obj == NULL)
-		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
+			bvm_heap_free(cstring);
 
-	/* convert the name to a c string */
-	name = bvm_string_to_cstring(string_obj);
-	BVM_MAKE_TRANSIENT_ROOT(name);
+			if (argv[argc] == NULL)
+				bvm_throw_exception(BVM_ERR_OUT_OF_MEMORY_ERROR, NULL);
+		}
 
-	/* returns -1 if error */
-	ret = bvm_file_exists(name);
+		id = bvm_vm_isolate_start(length, argv);
 
-	if ( ret == -1)
-		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+		if (id < 0)
+			bvm_throw_exception(BVM_ERR_OUT_OF_MEMORY_ERROR, "cannot start isolate");
 
-	bvm_heap_free(name);
+	} BVM_CATCH(e) {
 
-	NI_ReturnBoolean(ret);
+		while (argc-- > 0)
+			bvm_pd_memory_free(argv[argc]);
+
+		bvm_pd_memory_free(argv);
+
+		BVM_THROW(e);
+	} BVM_END_CATCH
+
+	NI_ReturnInt(id);
 }
 
 /*
- * void truncate(int newlength) throws IOException
+ * static boolean isAlive0(int id)
  */
-void babe_io_File_truncate(void *args) {
-
-	/* the File object */
-	file_obj_t *file_obj = NI_GetParameterAsObject(0);
-	BVM_FILE file = file_obj->native_handle;
-
-	jint newlen = NI_GetParameterAsInt(1);
+void babe_lang_Isolate_isAlive0(void *args) {
 
-	/* the file is closed, */
-	if (file_obj->native_handle == -1)
-		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+	jint id = NI_GetParameterAsInt(0);
 
-	if (newlen < 0)
-		bvm_throw_exception(BVM_ERR_ILLEGAL_ARGUMENT_EXCEPTION, NULL);
+	check_isolate_id(id);
 
-	/* read only?  Bang! */
-	if ( (file_obj->flags & BVM_FILE_O_RDONLY) == BVM_FILE_O_RDONLY)
-		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+	NI_ReturnBoolean(bvm_vm_isolate_is_alive(id));
+}
 
-	/* force a flush if required */
-	flushfile(file_obj);
+/*
+ * static int join0(int id)
+ *
+ * Returns the isolate's VM exit code.  The id is no longer valid afterwards.
+ */
+void babe_lang_Isolate_join0(void *args) {
 
-	if (newlen > (jint) bvm_file_sizeof(file))
-		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+	jint id = NI_GetParameterAsInt(0);
 
-	/* returns -1 if error */
-	if (bvm_file_truncate(file, newlen) == -1)
-		bvm_throw_exception(BVM_ERR_IO_EXCEPTION, NULL);
+	check_isolate_id(id);
 
-	NI_ReturnVoid();
+	NI_ReturnInt(bvm_vm_isolate_join(id));
 }
 
+#endif
 
 /***************************************************************************************************
  * java.lang.Throwable
@@ -1957,6 +4487,15 @@ void java_lang_Throwable_getStackTrace0(void *args) {
 typedef struct {
 	bvm_instance_array_obj_t *array;
 	bvm_bool_t privileged;
+	bvm_utfstring_t *method_name;
+	bvm_clazz_t *clazz;
+	bvm_clazz_t *pd_clazz;
+#if BVM_NATIVE_ACCESS_CONTEXT_CACHE_ENABLE
+	/* the distinct protection domains of the stack, in the order they are found */
+	bvm_protectiondomain_obj_t *domains[BVM_NATIVE_ACCESS_CONTEXT_DOMAINS];
+	int nr_domains;
+	bvm_bool_t overflowed;
+#endif
 } stackcontext_t;
 
 // for the given array, return a pointer to the data section of the array
@@ -1980,40 +4519,54 @@ static void* bvm_get_array_data_offset_ptr(bvm_jbyte_array_obj_t *src_array_obj)
     return ((bvm_jbyte_array_obj_t *) src_array_obj)->data;
 }
 
+/* the protection domain of the clazz of the method of a stack frame - a bootstrap clazz has none */
+static bvm_protectiondomain_obj_t *stackcontext_domain(bvm_stack_frame_info_t *stackinfo) {
+
+	/* if the clazz is a bootstrap clazz (it has NULL classloader) there will be no PD, otherwise, use the
+	 * PD of the clazz's classloader. */
+	return (stackinfo->method->clazz->classloader_obj == BVM_BOOTSTRAP_CLASSLOADER_OBJ) ? NULL :
+	       stackinfo->method->clazz->classloader_obj->protection_domain;
+}
+
+/* whether the stack visit carries on past a frame - it stops after the frame following a privileged one */
+static bvm_bool_t stackcontext_next(bvm_stack_frame_info_t *stackinfo, stackcontext_t *context) {
+
+	/* if the last frame was privileged, stop the stack visit */
+	if (context->privileged) return BVM_FALSE;
+
+	/* check the method to see if it is one of the "AccessController.doPrivileged" methods. */
+	if ( (context->method_name == stackinfo->method->name) &&
+		 (context->clazz == (bvm_clazz_t *) stackinfo->method->clazz) ) {
+
+		context->privileged = BVM_TRUE;
+	}
+
+	return BVM_TRUE;
+}
+
 static bvm_bool_t stackcontextcallback(bvm_stack_frame_info_t *stackinfo, void *data) {
 
 	int i;
 
-	static bvm_utfstring_t *method_name;
-	static bvm_clazz_t *clazz;
-	static bvm_clazz_t *pd_clazz;
-
 	stackcontext_t *context;
 	bvm_protectiondomain_obj_t *pd;
 
 	context = data;
 
-	method_name = bvm_utfstring_pool_get_c("doPrivileged", BVM_TRUE);
-	clazz = bvm_clazz_get_c(BVM_BOOTSTRAP_CLASSLOADER_OBJ, "java/security/SecurityManager");
-	pd_clazz = bvm_clazz_get_c(BVM_BOOTSTRAP_CLASSLOADER_OBJ, "java/security/ProtectionDomain");
-
-	/* if the clazz is a bootstrap clazz (it has NULL classloader) there will be no PD, otherwise, use the
-	 * PD of the clazz's classloader. */
-	pd = (stackinfo->method->clazz->classloader_obj == BVM_BOOTSTRAP_CLASSLOADER_OBJ) ? NULL :
-	       stackinfo->method->clazz->classloader_obj->protection_domain;
+	pd = stackcontext_domain(stackinfo);
 
 	if (pd != NULL) {
 
 		/* if the array is null, create a new default one of size 2. */
 		if (context->array == NULL) {
-			context->array = bvm_object_alloc_array_reference(2, pd_clazz);
+			context->array = bvm_object_alloc_array_reference(2, context->pd_clazz);
 			BVM_MAKE_TRANSIENT_ROOT(context->array);
 		}
 
         // check if the pd is already in the array
         bvm_bool_t found = BVM_FALSE;
         for (i = 0; i < context->array->length.int_value; i++) {
-            if (context->array->data[i] == (bvm_obj_t *) pd) {
+            if (BVM_REF_Decode(context->array->data[i]) == (bvm_obj_t *) pd) {
                 found = BVM_TRUE;
                 break;
             }
@@ -2023,8 +4576,8 @@ static bvm_bool_t stackcontextcallback(bvm_stack_frame_info_t *stackinfo, void *
 
             /* we'll need to add it to the first NULL spot (this will be at the end) - no duplicate checking as yet */
             for (i = 0; i < context->array->length.int_value; i++) {
-                if (context->array->data[i] == NULL) {
-                    context->array->data[i] = (bvm_obj_t *) pd;
+                if (BVM_REF_Decode(context->array->data[i]) == NULL) {
+                    context->array->data[i] = BVM_REF_Encode((bvm_obj_t *) pd);
                     break;
                 }
             }
@@ -2037,7 +4590,7 @@ static bvm_bool_t stackcontextcallback(bvm_stack_frame_info_t *stackinfo, void *
                 bvm_instance_array_obj_t *src_array = context->array;
 
                 // create a new larger array
-                context->array = bvm_object_alloc_array_reference(context->array->length.int_value * 2, pd_clazz);
+                context->array = bvm_object_alloc_array_reference(context->array->length.int_value * 2, context->pd_clazz);
 
                 BVM_MAKE_TRANSIENT_ROOT(context->array);
 
@@ -2045,24 +4598,102 @@ static bvm_bool_t stackcontextcallback(bvm_stack_frame_info_t *stackinfo, void *
                 bvm_raw_copy_array_contents(src_array, context->array, 0, 0, src_array->length.int_value);
 
                 // set the pd into the new array
-                context->array->data[i] = (bvm_obj_t *) pd;
+                context->array->data[i] = BVM_REF_Encode((bvm_obj_t *) pd);
             }
         }
 	}
 
-	/* if the last frame was privileged, stop the stack visit */
-	if (context->privileged) return BVM_FALSE;
+	return stackcontext_next(stackinfo, context);
+}
 
-	/* check the method to see if it is one of the "AccessController.doPrivileged" methods. */
-	if ( (method_name == stackinfo->method->name) &&
-		 (clazz == (bvm_clazz_t *) stackinfo->method->clazz) ) {
+/* visit the stack of the current thread building an AccessControlContext as it goes.  NULL if there are no
+ * protection domains on the stack. */
+static bvm_accesscontrolcontext_obj_t *stackcontext_build(stackcontext_t *data) {
 
-		context->privileged = BVM_TRUE;
+	bvm_accesscontrolcontext_obj_t *acc = NULL;
+
+	bvm_stack_visit(bvm_gl_thread_current, 0, -1, NULL,  stackcontextcallback, data);
+
+	if (data->array != NULL) {
+		/* create a new AccessControlContext object */
+		acc = (bvm_accesscontrolcontext_obj_t *)
+		   bvm_object_alloc( (bvm_instance_clazz_t *) bvm_clazz_get_c(BVM_BOOTSTRAP_CLASSLOADER_OBJ, "java/security/AccessControlContext"));
+
+        // TODO: If the stack context is not privileged, add in the current thread's inherited context
+//        if (!data.privileged) {
+//            bvm_accesscontrolcontext_obj_t *inherited_context = (bvm_accesscontrolcontext_obj_t *) bvm_gl_thread_current->thread_obj->inherited_context;
+//            if (inherited_context != NULL) {
+//                int len = (inherited_context->context != NULL) ? inherited_context->context->length.int_value : 0;
+//                if (len != 0) {
+//                    // create a new array a copy both found pds + inherited context
+//                    bvm_clazz_t *pd_clazz = bvm_clazz_get_c(BVM_BOOTSTRAP_CLASSLOADER_OBJ, "java/security/ProtectionDomain");
+//                    bvm_instance_array_obj_t *new_array = bvm_object_alloc_array_reference(data->array->length.int_value + len, pd_clazz);
+//                    bvm_raw_copy_array_contents(data->array, new_array, 0, 0, data->array->length.int_value);
+//                    bvm_raw_copy_array_contents(inherited_context->context, new_array, 0, data->array->length.int_value, len);
+////                    bvm_heap_free(data->array);
+//                    data->array = new_array;
+//                }
+//            }
+//        }
+
+		acc->context = data->array;
+	}
+
+	return acc;
+}
+
+#if BVM_NATIVE_ACCESS_CONTEXT_CACHE_ENABLE
+
+/* collects the protection domains of the stack into the native list of the context, allocating nothing.  Gives up if
+ * there are more than fit. */
+static bvm_bool_t stackdomainscallback(bvm_stack_frame_info_t *stackinfo, void *data) {
+
+	int i;
+
+	stackcontext_t *context;
+	bvm_protectiondomain_obj_t *pd;
+
+	context = data;
+
+	pd = stackcontext_domain(stackinfo);
+
+	if (pd != NULL) {
+
+		for (i = 0; i < context->nr_domains; i++) {
+			if (context->domains[i] == pd) break;
+		}
+
+		if (i == context->nr_domains) {
+
+			if (i == BVM_NATIVE_ACCESS_CONTEXT_DOMAINS) {
+				context->overflowed = BVM_TRUE;
+				return BVM_FALSE;
+			}
+
+			context->domains[context->nr_domains++] = pd;
+		}
+	}
+
+	return stackcontext_next(stackinfo, context);
+}
+
+/* whether an AccessControlContext has exactly the collected protection domains of a context, in the same order */
+static bvm_bool_t stackcontext_matches(bvm_accesscontrolcontext_obj_t *acc, stackcontext_t *data) {
+
+	int i;
+
+	if ( (acc->context == NULL) || (acc->context->length.int_value != (bvm_uint32_t) data->nr_domains) )
+		return BVM_FALSE;
+
+	for (i = 0; i < data->nr_domains; i++) {
+		if (BVM_REF_Decode(acc->context->data[i]) != (bvm_obj_t *) data->domains[i]) return BVM_FALSE;
 	}
 
 	return BVM_TRUE;
 }
 
+#endif
+
 /*
  * private static native AccessControlContext getStackAccessControlContext();
  *
@@ -2084,35 +4715,57 @@ void java_security_SecurityManager_getStackAccessControlContext(void *args) {
 
 	bvm_accesscontrolcontext_obj_t *acc = NULL;
 
-	stackcontext_t data = {NULL, BVM_FALSE};
+	stackcontext_t data;
 
-	bvm_stack_visit(bvm_gl_thread_current, 0, -1, NULL,  stackcontextcallback, &data);
+	data.array = NULL;
+	data.privileged = BVM_FALSE;
+	data.method_name = bvm_utfstring_pool_get_c("doPrivileged", BVM_TRUE);
+	data.clazz = bvm_clazz_get_c(BVM_BOOTSTRAP_CLASSLOADER_OBJ, "java/security/SecurityManager");
+	data.pd_clazz = bvm_clazz_get_c(BVM_BOOTSTRAP_CLASSLOADER_OBJ, "java/security/ProtectionDomain");
 
-	if (data.array != NULL) {
-		/* create a new AccessControlContext object */
-		acc = (bvm_accesscontrolcontext_obj_t *)
-		   bvm_object_alloc( (bvm_instance_clazz_t *) bvm_clazz_get_c(BVM_BOOTSTRAP_CLASSLOADER_OBJ, "java/security/AccessControlContext"));
+#if BVM_NATIVE_ACCESS_CONTEXT_CACHE_ENABLE
 
-        // TODO: If the stack context is not privileged, add in the current thread's inherited context
-//        if (!data.privileged) {
-//            bvm_accesscontrolcontext_obj_t *inherited_context = (bvm_accesscontrolcontext_obj_t *) bvm_gl_thread_current->thread_obj->inherited_context;
-//            if (inherited_context != NULL) {
-//                int len = (inherited_context->context != NULL) ? inherited_context->context->length.int_value : 0;
-//                if (len != 0) {
-//                    // create a new array a copy both found pds + inherited context
-//                    bvm_clazz_t *pd_clazz = bvm_clazz_get_c(BVM_BOOTSTRAP_CLASSLOADER_OBJ, "java/security/ProtectionDomain");
-//                    bvm_instance_array_obj_t *new_array = bvm_object_alloc_array_reference(data.array->length.int_value + len, pd_clazz);
-//                    bvm_raw_copy_array_contents(data.array, new_array, 0, 0, data.array->length.int_value);
-//                    bvm_raw_copy_array_contents(inherited_context->context, new_array, 0, data.array->length.int_value, len);
-////                    bvm_heap_free(data.array);
-//                    data.array = new_array;
-//                }
-//            }
-//        }
+	data.nr_domains = 0;
+	data.overflowed = BVM_FALSE;
+
+	/* A permission check asks for the context over and over from much the same stack.  The domains of the stack are
+	 * collected first without allocating anything - if they are those of the context built last time for this thread,
+	 * it is given back again. */
+	bvm_stack_visit(bvm_gl_thread_current, 0, -1, NULL,  stackdomainscallback, &data);
+
+	if (data.overflowed) {
+
+		/* too many to keep - build the context as the stack is visited again */
+		data.privileged = BVM_FALSE;
+		acc = stackcontext_build(&data);
+	}
+	else if (data.nr_domains != 0) {
+
+		acc = bvm_gl_thread_current->access_context;
+
+		if ( (acc == NULL) || !stackcontext_matches(acc, &data) ) {
+
+			int i;
+
+			data.array = bvm_object_alloc_array_reference(data.nr_domains, data.pd_clazz);
+			BVM_MAKE_TRANSIENT_ROOT(data.array);
+
+			for (i = 0; i < data.nr_domains; i++)
+				data.array->data[i] = BVM_REF_Encode((bvm_obj_t *) data.domains[i]);
+
+			acc = (bvm_accesscontrolcontext_obj_t *)
+			   bvm_object_alloc( (bvm_instance_clazz_t *) bvm_clazz_get_c(BVM_BOOTSTRAP_CLASSLOADER_OBJ, "java/security/AccessControlContext"));
+
+			acc->context = data.array;
 
-		acc->context = data.array;
+			bvm_gl_thread_current->access_context = acc;
+		}
 	}
 
+#else
+	acc = stackcontext_build(&data);
+#endif
+
 	NI_ReturnObject(acc);
 }
 
@@ -2138,12 +4791,47 @@ static char *classloader_classname   	= "java/lang/ClassLoader";
 static char *thread_classname  			= "java/lang/Thread";
 static char *runtime_classname  		= "java/lang/Runtime";
 static char *integer_classname  		= "java/lang/Integer";
+#if BVM_NATIVE_BOX_CACHE_ENABLE
+static char *character_classname  		= "java/lang/Character";
+#endif
 static char *stringbuffer_classname  	= "java/lang/StringBuffer";
 static char *stringbuilder_classname  	= "java/lang/StringBuilder";
 static char *throwable_classname  	    = "java/lang/Throwable";
 static char *weakreference_classname  	= "java/lang/ref/WeakReference";
+static char *softreference_classname  	= "java/lang/ref/SoftReference";
+static char *ephemeron_classname  		= "java/lang/ref/Ephemeron";
 static char *byteorder_classname  		= "java/nio/ByteOrder";
+#if (BVM_NATIVE_BYTEBUFFER_ENABLE && BVM_NATIVE_REPLACEMENT_ENABLE)
+static char *bytebuffer_classname  		= "java/nio/ByteBuffer";
+#endif
 static char *file_classname  			= "babe/io/File";
+#if BVM_FILE_MAP_ENABLE
+static char *mappedfile_classname  		= "babe/io/MappedFile";
+#endif
+#if BVM_SOCKETS_ENABLE
+static char *socket_classname  			= "babe/io/Socket";
+static char *serversocket_classname  	= "babe/io/ServerSocket";
+#endif
+#if BVM_VM_ISOLATES_ENABLE
+static char *isolate_classname  		= "babe/lang/Isolate";
+#endif
+#if BVM_THREAD_TASKS_ENABLE
+static char *task_classname  			= "babe/lang/Task";
+#endif
+#if BVM_SCOPED_MEMORY_ENABLE
+static char *scopedmemory_classname  	= "babe/lang/ScopedMemory";
+#endif
+#if BVM_NATIVE_COLLECTIONS_ENABLE
+static char *inthashmap_classname  		= "babe/util/IntHashMap";
+static char *intarray_classname  		= "babe/util/IntArray";
+#if BVM_NATIVE_INT64_ENABLE
+static char *longhashmap_classname  	= "babe/util/LongHashMap";
+static char *longarray_classname  		= "babe/util/LongArray";
+#endif
+#endif
+#if (BVM_PROFILER_ENABLE || BVM_PROFILER_METHOD_COUNTERS_ENABLE || BVM_PROFILER_MONITOR_CONTENTION_ENABLE)
+static char *profiler_classname  		= "babe/lang/Profiler";
+#endif
 static char *securitymanager_classname  = "java/security/SecurityManager";
 
 #if BVM_FLOAT_ENABLE
@@ -2154,7 +4842,7 @@ static char *math_classname   = "java/lang/Math";
 
 void bvm_init_native() {
 
-	bvm_native_method_pool_register(object_classname, "hashCode", "()I", java_lang_Object_hashCode);
+	bvm_native_method_pool_register_leaf(object_classname, "hashCode", "()I", java_lang_Object_hashCode);
 	bvm_native_method_pool_register(object_classname, "getClass", "()Ljava/lang/Class;", java_lang_Object_getClass);
 	bvm_native_method_pool_register(object_classname, "wait", "(J)V", java_lang_Object_wait);
 	bvm_native_method_pool_register(object_classname, "notify", "()V", java_lang_Object_notify);
@@ -2162,26 +4850,36 @@ void bvm_init_native() {
 	bvm_native_method_pool_register(object_classname, "clone", "()Ljava/lang/Object;", java_lang_Object_clone);
 
 	bvm_native_method_pool_register(console_classname, "write", "(I)V", java_io_Console_write);
+#if BVM_CONSOLE_BUFFER_ENABLE
+	bvm_native_method_pool_register(console_classname, "write", "([BII)V", java_io_Console_writeBytes);
+#endif
 	bvm_native_method_pool_register(console_classname, "println0", "(Ljava/lang/String;)V", java_io_Console_println0);
 	bvm_native_method_pool_register(console_classname, "print0", "(Ljava/lang/String;)V", java_io_Console_print0);
 
-	bvm_native_method_pool_register(runtime_classname, "freeMemory", "()J", java_lang_Runtime_freeMemory);
-	bvm_native_method_pool_register(runtime_classname, "totalMemory", "()J", java_lang_Runtime_totalMemory);
+	bvm_native_method_pool_register_leaf(runtime_classname, "freeMemory", "()J", java_lang_Runtime_freeMemory);
+	bvm_native_method_pool_register_leaf(runtime_classname, "totalMemory", "()J", java_lang_Runtime_totalMemory);
+#if BVM_GC_STATS_ENABLE
+	bvm_native_method_pool_register(runtime_classname, "gcStats0", "([J)V", java_lang_Runtime_gcStats0);
+#endif
 	bvm_native_method_pool_register(runtime_classname, "gc", "()V", java_lang_Runtime_gc);
 	bvm_native_method_pool_register(runtime_classname, "exit0", "(I)V", java_lang_Runtime_exit0);
 
 	bvm_native_method_pool_register(system_classname, "arraycopy", "(Ljava/lang/Object;ILjava/lang/Object;II)V", java_lang_System_arraycopy);
-	bvm_native_method_pool_register(system_classname, "currentTimeMillis", "()J", java_lang_System_currentTimeMillis);
-	bvm_native_method_pool_register(system_classname, "identityHashCode", "(Ljava/lang/Object;)I", java_lang_Object_hashCode); /* Yes, same as object */
+	bvm_native_method_pool_register_leaf(system_classname, "currentTimeMillis", "()J", java_lang_System_currentTimeMillis);
+	bvm_native_method_pool_register_leaf(system_classname, "identityHashCode", "(Ljava/lang/Object;)I", java_lang_Object_hashCode); /* Yes, same as object */
 
 	bvm_native_method_pool_register(integer_classname, "toString", "(I)Ljava/lang/String;", java_lang_Integer_toString);
+#if BVM_NATIVE_BOX_CACHE_ENABLE
+	bvm_native_method_pool_register_replacement(integer_classname, "valueOf", "(I)Ljava/lang/Integer;", java_lang_Integer_valueOf);
+	bvm_native_method_pool_register_replacement(character_classname, "valueOf", "(C)Ljava/lang/Character;", java_lang_Character_valueOf);
+#endif
 
 	bvm_native_method_pool_register(string_classname, "intern", "()Ljava/lang/String;", java_lang_String_intern);
-	bvm_native_method_pool_register(string_classname, "equals", "(Ljava/lang/Object;)Z", java_lang_String_equals);
-	bvm_native_method_pool_register(string_classname, "hashCode", "()I", java_lang_String_hashCode);
+	bvm_native_method_pool_register_leaf(string_classname, "equals", "(Ljava/lang/Object;)Z", java_lang_String_equals);
+	bvm_native_method_pool_register_leaf(string_classname, "hashCode", "()I", java_lang_String_hashCode);
 	bvm_native_method_pool_register(string_classname, "startsWith", "(Ljava/lang/String;I)Z", java_lang_String_startsWith);
-	bvm_native_method_pool_register(string_classname, "indexOf", "(II)I", java_lang_String_indexOf);
-	bvm_native_method_pool_register(string_classname, "lastIndexOf", "(II)I", java_lang_String_lastIndexOf);
+	bvm_native_method_pool_register_leaf(string_classname, "indexOf", "(II)I", java_lang_String_indexOf);
+	bvm_native_method_pool_register_leaf(string_classname, "lastIndexOf", "(II)I", java_lang_String_lastIndexOf);
 	bvm_native_method_pool_register(string_classname, "charAt", "(I)C", java_lang_String_charAt);
 
 	bvm_native_method_pool_register(stringbuffer_classname, "insert0", "(I[CII)Ljava/lang/StringBuffer;", java_lang_StringBuffer_insert0);
@@ -2194,6 +4892,23 @@ void bvm_init_native() {
 	bvm_native_method_pool_register(stringbuilder_classname, "ensureCapacity", "(I)V", java_lang_StringBuffer_ensureCapacity);
 	bvm_native_method_pool_register(stringbuilder_classname, "append", "(Ljava/lang/String;)Ljava/lang/StringBuilder;", java_lang_StringBuffer_append);
 
+#if BVM_NATIVE_REPLACEMENT_ENABLE
+	bvm_native_method_pool_register_replacement(stringbuffer_classname, "append", "(I)Ljava/lang/StringBuffer;", java_lang_StringBuffer_append_int);
+	bvm_native_method_pool_register_replacement(stringbuffer_classname, "append", "(C)Ljava/lang/StringBuffer;", java_lang_StringBuffer_append_char);
+	bvm_native_method_pool_register_replacement(stringbuilder_classname, "append", "(I)Ljava/lang/StringBuilder;", java_lang_StringBuffer_append_int);
+	bvm_native_method_pool_register_replacement(stringbuilder_classname, "append", "(C)Ljava/lang/StringBuilder;", java_lang_StringBuffer_append_char);
+#if BVM_NATIVE_INT64_ENABLE
+	bvm_native_method_pool_register_replacement(stringbuffer_classname, "append", "(J)Ljava/lang/StringBuffer;", java_lang_StringBuffer_append_long);
+	bvm_native_method_pool_register_replacement(stringbuilder_classname, "append", "(J)Ljava/lang/StringBuilder;", java_lang_StringBuffer_append_long);
+#endif
+#if BVM_FLOAT_ENABLE
+	bvm_native_method_pool_register_replacement(stringbuffer_classname, "append", "(D)Ljava/lang/StringBuffer;", java_lang_StringBuffer_append_double);
+	bvm_native_method_pool_register_replacement(stringbuffer_classname, "append", "(F)Ljava/lang/StringBuffer;", java_lang_StringBuffer_append_float);
+	bvm_native_method_pool_register_replacement(stringbuilder_classname, "append", "(D)Ljava/lang/StringBuilder;", java_lang_StringBuffer_append_double);
+	bvm_native_method_pool_register_replacement(stringbuilder_classname, "append", "(F)Ljava/lang/StringBuilder;", java_lang_StringBuffer_append_float);
+#endif
+#endif
+
 	bvm_native_method_pool_register(class_classname, "forName", "(Ljava/lang/String;)Ljava/lang/Class;", java_lang_Class_forName);
 	bvm_native_method_pool_register(class_classname, "forName2", "(Ljava/lang/String;ZLjava/lang/ClassLoader;)Ljava/lang/Class;", java_lang_Class_forName2);
 	/* not a mistake - getPrimitiveClass() uses the same code as forName() */
@@ -2201,18 +4916,18 @@ void bvm_init_native() {
 	bvm_native_method_pool_register(class_classname, "newInstance", "()Ljava/lang/Object;", java_lang_Class_newInstance);
 	bvm_native_method_pool_register(class_classname, "getName", "()Ljava/lang/String;", java_lang_Class_getName);
 	bvm_native_method_pool_register(class_classname, "getSuperclass", "()Ljava/lang/Class;", java_lang_Class_getSuperclass);
-	bvm_native_method_pool_register(class_classname, "isInterface", "()Z", java_lang_Class_isInterface);
+	bvm_native_method_pool_register_leaf(class_classname, "isInterface", "()Z", java_lang_Class_isInterface);
 	bvm_native_method_pool_register(class_classname, "__doclinit", "()V", java_lang_Class_doclinit);
-	bvm_native_method_pool_register(class_classname, "getState", "()I", java_lang_Class_getState);
+	bvm_native_method_pool_register_leaf(class_classname, "getState", "()I", java_lang_Class_getState);
 	bvm_native_method_pool_register(class_classname, "setState", "(I)V", java_lang_Class_setState);
-	bvm_native_method_pool_register(class_classname, "getInitThread", "()Ljava/lang/Thread;", java_lang_Class_getInitThread);
-	bvm_native_method_pool_register(class_classname, "desiredAssertionStatus", "()Z", java_lang_Class_desiredAssertionStatus);
+	bvm_native_method_pool_register_leaf(class_classname, "getInitThread", "()Ljava/lang/Thread;", java_lang_Class_getInitThread);
+	bvm_native_method_pool_register_leaf(class_classname, "desiredAssertionStatus", "()Z", java_lang_Class_desiredAssertionStatus);
 	bvm_native_method_pool_register(class_classname, "getClassLoader0", "()Ljava/lang/ClassLoader;", java_lang_Class_getClassLoader0);
 
 	bvm_native_method_pool_register(classloader_classname, "getSystemClassLoader", "()Ljava/lang/ClassLoader;", java_lang_ClassLoader_getSystemClassLoader);
 
-	bvm_native_method_pool_register(thread_classname, "nextThreadId", "()I", java_lang_Thread_nextThreadId);
-	bvm_native_method_pool_register(thread_classname, "currentThread0", "()Ljava/lang/Thread;", java_lang_Thread_currentThread0);
+	bvm_native_method_pool_register_leaf(thread_classname, "nextThreadId", "()I", java_lang_Thread_nextThreadId);
+	bvm_native_method_pool_register_leaf(thread_classname, "currentThread0", "()Ljava/lang/Thread;", java_lang_Thread_currentThread0);
 	bvm_native_method_pool_register(thread_classname, "start", "()V", java_lang_Thread_start);
 	bvm_native_method_pool_register(thread_classname, "setPriority0", "(I)V", java_lang_Thread_setPriority0);
 	bvm_native_method_pool_register(thread_classname, "isAlive", "()Z", java_lang_Thread_isAlive);
@@ -2221,33 +4936,73 @@ void bvm_init_native() {
 	bvm_native_method_pool_register(thread_classname, "interrupt0", "()V", java_lang_Thread_interrupt0);
 	bvm_native_method_pool_register(thread_classname, "sleep", "(J)V", java_lang_Thread_sleep);
 	bvm_native_method_pool_register(thread_classname, "getState", "()I", java_lang_Thread_getState);
+#if BVM_THREAD_ACCOUNTING_ENABLE
+	bvm_native_method_pool_register_leaf(thread_classname, "getCpuTime", "()J", java_lang_Thread_getCpuTime);
+	bvm_native_method_pool_register_leaf(thread_classname, "getBytecodeCount", "()J", java_lang_Thread_getBytecodeCount);
+#endif
 
 #if BVM_FLOAT_ENABLE
 	bvm_native_method_pool_register(float_classname, "toString", "(F)Ljava/lang/String;", java_lang_Float_toString);
 	// same code for both
-	bvm_native_method_pool_register(float_classname, "floatToIntBits", "(F)I", java_lang_Float_floatToIntBits);
-	bvm_native_method_pool_register(float_classname, "intBitsToFloat", "(I)F", java_lang_Float_floatToIntBits);
+	bvm_native_method_pool_register_leaf(float_classname, "floatToIntBits", "(F)I", java_lang_Float_floatToIntBits);
+	bvm_native_method_pool_register_leaf(float_classname, "intBitsToFloat", "(I)F", java_lang_Float_floatToIntBits);
 
 	bvm_native_method_pool_register(double_classname, "toString", "(D)Ljava/lang/String;", java_lang_Double_toString);
     // same code for both
-	bvm_native_method_pool_register(double_classname, "doubleToLongBits", "(D)J", java_lang_Double_doubleToLongBits);
-	bvm_native_method_pool_register(double_classname, "longBitsToDouble", "(J)D", java_lang_Double_doubleToLongBits);
+	bvm_native_method_pool_register_leaf(double_classname, "doubleToLongBits", "(D)J", java_lang_Double_doubleToLongBits);
+	bvm_native_method_pool_register_leaf(double_classname, "longBitsToDouble", "(J)D", java_lang_Double_doubleToLongBits);
+#if (BVM_FP_FAST_CONVERSION_ENABLE && BVM_NATIVE_REPLACEMENT_ENABLE)
+	bvm_native_method_pool_register_replacement(float_classname, "valueOf", "(Ljava/lang/String;)Ljava/lang/Float;", java_lang_Float_valueOf);
+	bvm_native_method_pool_register_replacement(double_classname, "valueOf", "(Ljava/lang/String;)Ljava/lang/Double;", java_lang_Double_valueOf);
+#endif
 
-	bvm_native_method_pool_register(math_classname, "floor", "(D)D", java_lang_Math_floor);
-	bvm_native_method_pool_register(math_classname, "sqrt", "(D)D", java_lang_Math_sqrt);
-	bvm_native_method_pool_register(math_classname, "log", "(D)D", java_lang_Math_log);
-	bvm_native_method_pool_register(math_classname, "log10", "(D)D", java_lang_Math_log10);
-	bvm_native_method_pool_register(math_classname, "ceil", "(D)D", java_lang_Math_ceil);
-	bvm_native_method_pool_register(math_classname, "exp", "(D)D", java_lang_Math_exp);
-	bvm_native_method_pool_register(math_classname, "IEEEremainder", "(DD)D", java_lang_Math_IEEEremainder);
+	bvm_native_method_pool_register_leaf(math_classname, "floor", "(D)D", java_lang_Math_floor);
+	bvm_native_method_pool_register_leaf(math_classname, "sqrt", "(D)D", java_lang_Math_sqrt);
+	bvm_native_method_pool_register_leaf(math_classname, "log", "(D)D", java_lang_Math_log);
+	bvm_native_method_pool_register_leaf(math_classname, "log10", "(D)D", java_lang_Math_log10);
+	bvm_native_method_pool_register_leaf(math_classname, "ceil", "(D)D", java_lang_Math_ceil);
+	bvm_native_method_pool_register_leaf(math_classname, "exp", "(D)D", java_lang_Math_exp);
+	bvm_native_method_pool_register_leaf(math_classname, "IEEEremainder", "(DD)D", java_lang_Math_IEEEremainder);
 #endif
 
-	bvm_native_method_pool_register(byteorder_classname, "isLittleEndian", "()Z", java_nio_ByteOrder_isLittleEndian);
+	bvm_native_method_pool_register_leaf(byteorder_classname, "isLittleEndian", "()Z", java_nio_ByteOrder_isLittleEndian);
+
+#if (BVM_NATIVE_BYTEBUFFER_ENABLE && BVM_NATIVE_REPLACEMENT_ENABLE)
+	bytebuffer_little_endian_field = NULL;
+	bvm_native_method_pool_register_replacement(bytebuffer_classname, "get", "()B", java_nio_ByteBuffer_get);
+	bvm_native_method_pool_register_replacement(bytebuffer_classname, "get", "(I)B", java_nio_ByteBuffer_get_at);
+	bvm_native_method_pool_register_replacement(bytebuffer_classname, "put", "(B)Ljava/nio/ByteBuffer;", java_nio_ByteBuffer_put);
+	bvm_native_method_pool_register_replacement(bytebuffer_classname, "put", "(IB)Ljava/nio/ByteBuffer;", java_nio_ByteBuffer_put_at);
+	bvm_native_method_pool_register_replacement(bytebuffer_classname, "get", "([BII)Ljava/nio/ByteBuffer;", java_nio_ByteBuffer_get_bulk);
+	bvm_native_method_pool_register_replacement(bytebuffer_classname, "put", "([BII)Ljava/nio/ByteBuffer;", java_nio_ByteBuffer_put_bulk);
+	bvm_native_method_pool_register_replacement(bytebuffer_classname, "getShort", "()S", java_nio_ByteBuffer_getShort);
+	bvm_native_method_pool_register_replacement(bytebuffer_classname, "getShort", "(I)S", java_nio_ByteBuffer_getShort_at);
+	bvm_native_method_pool_register_replacement(bytebuffer_classname, "getChar", "()C", java_nio_ByteBuffer_getChar);
+	bvm_native_method_pool_register_replacement(bytebuffer_classname, "getChar", "(I)C", java_nio_ByteBuffer_getChar_at);
+	bvm_native_method_pool_register_replacement(bytebuffer_classname, "putShort", "(S)Ljava/nio/ByteBuffer;", java_nio_ByteBuffer_putShort);
+	bvm_native_method_pool_register_replacement(bytebuffer_classname, "putShort", "(IS)Ljava/nio/ByteBuffer;", java_nio_ByteBuffer_putShort_at);
+	bvm_native_method_pool_register_replacement(bytebuffer_classname, "putChar", "(C)Ljava/nio/ByteBuffer;", java_nio_ByteBuffer_putShort);
+	bvm_native_method_pool_register_replacement(bytebuffer_classname, "putChar", "(IC)Ljava/nio/ByteBuffer;", java_nio_ByteBuffer_putShort_at);
+	bvm_native_method_pool_register_replacement(bytebuffer_classname, "getInt", "()I", java_nio_ByteBuffer_getInt);
+	bvm_native_method_pool_register_replacement(bytebuffer_classname, "getInt", "(I)I", java_nio_ByteBuffer_getInt_at);
+	bvm_native_method_pool_register_replacement(bytebuffer_classname, "putInt", "(I)Ljava/nio/ByteBuffer;", java_nio_ByteBuffer_putInt);
+	bvm_native_method_pool_register_replacement(bytebuffer_classname, "putInt", "(II)Ljava/nio/ByteBuffer;", java_nio_ByteBuffer_putInt_at);
+#if BVM_NATIVE_INT64_ENABLE
+	bvm_native_method_pool_register_replacement(bytebuffer_classname, "getLong", "()J", java_nio_ByteBuffer_getLong);
+	bvm_native_method_pool_register_replacement(bytebuffer_classname, "getLong", "(I)J", java_nio_ByteBuffer_getLong_at);
+	bvm_native_method_pool_register_replacement(bytebuffer_classname, "putLong", "(J)Ljava/nio/ByteBuffer;", java_nio_ByteBuffer_putLong);
+	bvm_native_method_pool_register_replacement(bytebuffer_classname, "putLong", "(IJ)Ljava/nio/ByteBuffer;", java_nio_ByteBuffer_putLong_at);
+#endif
+#endif
 
 	bvm_native_method_pool_register(file_classname, "open0", "(Ljava/lang/String;I)I", babe_io_File_open0);
 	bvm_native_method_pool_register(file_classname, "close", "()V", babe_io_File_close);
 	bvm_native_method_pool_register(file_classname, "read", "([BII)I", babe_io_File_read);
 	bvm_native_method_pool_register(file_classname, "write", "([BII)V", babe_io_File_write);
+#if BVM_FILE_ASYNC_ENABLE
+	bvm_native_method_pool_register(file_classname, "startAsync0", "([BIIZ)V", babe_io_File_startAsync0);
+	bvm_native_method_pool_register(file_classname, "finishAsync0", "([BI)I", babe_io_File_finishAsync0);
+#endif
 	bvm_native_method_pool_register(file_classname, "setPosition", "(II)V", babe_io_File_setPosition);
 	bvm_native_method_pool_register(file_classname, "getPosition", "()I", babe_io_File_getPosition);
 	bvm_native_method_pool_register(file_classname, "sizeOf", "()I", babe_io_File_sizeOf);
@@ -2256,11 +5011,109 @@ void bvm_init_native() {
 	bvm_native_method_pool_register(file_classname, "exists", "(Ljava/lang/String;)Z", babe_io_File_exists);
 	bvm_native_method_pool_register(file_classname, "truncate", "(I)V", babe_io_File_truncate);
 
+#if BVM_FILE_MAP_ENABLE
+	bvm_native_method_pool_register(mappedfile_classname, "map0", "(Lbabe/io/File;)I", babe_io_MappedFile_map0);
+	bvm_native_method_pool_register(mappedfile_classname, "get", "(I)B", babe_io_MappedFile_get);
+	bvm_native_method_pool_register(mappedfile_classname, "get", "(I[BII)V", babe_io_MappedFile_getBytes);
+	bvm_native_method_pool_register(mappedfile_classname, "getShort", "(I)S", babe_io_MappedFile_getShort);
+	bvm_native_method_pool_register(mappedfile_classname, "getInt", "(I)I", babe_io_MappedFile_getInt);
+#endif
+
+#if BVM_SOCKETS_ENABLE
+	bvm_native_method_pool_register(socket_classname, "open0", "(Ljava/lang/String;I)I", babe_io_Socket_open0);
+	bvm_native_method_pool_register(socket_classname, "ready0", "(II)I", babe_io_Socket_ready0);
+	bvm_native_method_pool_register(socket_classname, "await0", "(IIJ)V", babe_io_Socket_await0);
+	bvm_native_method_pool_register(socket_classname, "read0", "(I[BII)I", babe_io_Socket_read0);
+	bvm_native_method_pool_register(socket_classname, "write0", "(I[BII)I", babe_io_Socket_write0);
+	bvm_native_method_pool_register(socket_classname, "close0", "(I)V", babe_io_Socket_close0);
+
+	bvm_native_method_pool_register(serversocket_classname, "open0", "(I)I", babe_io_ServerSocket_open0);
+	bvm_native_method_pool_register(serversocket_classname, "accept0", "(I)I", babe_io_ServerSocket_accept0);
+	bvm_native_method_pool_register(serversocket_classname, "close0", "(I)V", babe_io_ServerSocket_close0);
+#endif
+
+#if BVM_THREAD_TASKS_ENABLE
+	bvm_native_method_pool_register(task_classname, "start", "()V", babe_lang_Task_start);
+	bvm_native_method_pool_register(task_classname, "yield0", "()V", babe_lang_Task_yield0);
+	bvm_native_method_pool_register(task_classname, "resume0", "()V", babe_lang_Task_resume0);
+#endif
+
+#if BVM_SCOPED_MEMORY_ENABLE
+	bvm_native_method_pool_register(scopedmemory_classname, "create0", "(I)V", babe_lang_ScopedMemory_create0);
+	bvm_native_method_pool_register(scopedmemory_classname, "enter0", "()V", babe_lang_ScopedMemory_enter0);
+	bvm_native_method_pool_register(scopedmemory_classname, "exit0", "()V", babe_lang_ScopedMemory_exit0);
+	bvm_native_method_pool_register_leaf(scopedmemory_classname, "size", "()I", babe_lang_ScopedMemory_size);
+	bvm_native_method_pool_register_leaf(scopedmemory_classname, "memoryConsumed", "()I", babe_lang_ScopedMemory_memoryConsumed);
+	bvm_native_method_pool_register(scopedmemory_classname, "release", "()V", babe_lang_ScopedMemory_release);
+#endif
+
+#if BVM_NATIVE_COLLECTIONS_ENABLE
+	bvm_native_method_pool_register(inthashmap_classname, "init0", "(I)V", babe_util_IntHashMap_init0);
+	bvm_native_method_pool_register_leaf(inthashmap_classname, "get", "(I)Ljava/lang/Object;", babe_util_IntHashMap_get);
+	bvm_native_method_pool_register_leaf(inthashmap_classname, "containsKey", "(I)Z", babe_util_IntHashMap_containsKey);
+	bvm_native_method_pool_register(inthashmap_classname, "put", "(ILjava/lang/Object;)Ljava/lang/Object;", babe_util_IntHashMap_put);
+	bvm_native_method_pool_register_leaf(inthashmap_classname, "remove", "(I)Ljava/lang/Object;", babe_util_IntHashMap_remove);
+	bvm_native_method_pool_register_leaf(inthashmap_classname, "clear", "()V", babe_util_IntHashMap_clear);
+	bvm_native_method_pool_register(inthashmap_classname, "keys", "()[I", babe_util_IntHashMap_keys);
+
+	bvm_native_method_pool_register(intarray_classname, "init0", "(I)V", babe_util_IntArray_init0);
+	bvm_native_method_pool_register(intarray_classname, "add", "(I)V", babe_util_IntArray_add);
+	bvm_native_method_pool_register(intarray_classname, "get", "(I)I", babe_util_IntArray_get);
+	bvm_native_method_pool_register(intarray_classname, "set", "(II)V", babe_util_IntArray_set);
+	bvm_native_method_pool_register(intarray_classname, "removeLast", "()I", babe_util_IntArray_removeLast);
+	bvm_native_method_pool_register(intarray_classname, "toArray", "()[I", babe_util_IntArray_toArray);
+#if BVM_NATIVE_INT64_ENABLE
+	bvm_native_method_pool_register(longhashmap_classname, "init0", "(I)V", babe_util_LongHashMap_init0);
+	bvm_native_method_pool_register_leaf(longhashmap_classname, "get", "(J)Ljava/lang/Object;", babe_util_LongHashMap_get);
+	bvm_native_method_pool_register_leaf(longhashmap_classname, "containsKey", "(J)Z", babe_util_LongHashMap_containsKey);
+	bvm_native_method_pool_register(longhashmap_classname, "put", "(JLjava/lang/Object;)Ljava/lang/Object;", babe_util_LongHashMap_put);
+	bvm_native_method_pool_register_leaf(longhashmap_classname, "remove", "(J)Ljava/lang/Object;", babe_util_LongHashMap_remove);
+	/* not a mistake - clearing a map does not depend on its keys */
+	bvm_native_method_pool_register_leaf(longhashmap_classname, "clear", "()V", babe_util_IntHashMap_clear);
+	bvm_native_method_pool_register(longhashmap_classname, "keys", "()[J", babe_util_LongHashMap_keys);
+
+	bvm_native_method_pool_register(longarray_classname, "init0", "(I)V", babe_util_LongArray_init0);
+	bvm_native_method_pool_register(longarray_classname, "add", "(J)V", babe_util_LongArray_add);
+	bvm_native_method_pool_register(longarray_classname, "get", "(I)J", babe_util_LongArray_get);
+	bvm_native_method_pool_register(longarray_classname, "set", "(IJ)V", babe_util_LongArray_set);
+	bvm_native_method_pool_register(longarray_classname, "removeLast", "()J", babe_util_LongArray_removeLast);
+	bvm_native_method_pool_register(longarray_classname, "toArray", "()[J", babe_util_LongArray_toArray);
+#endif
+#endif
+
+#if BVM_VM_ISOLATES_ENABLE
+	bvm_native_method_pool_register(isolate_classname, "start0", "([Ljava/lang/String;)I", babe_lang_Isolate_start0);
+	bvm_native_method_pool_register(isolate_classname, "isAlive0", "(I)Z", babe_lang_Isolate_isAlive0);
+	bvm_native_method_pool_register(isolate_classname, "join0", "(I)I", babe_lang_Isolate_join0);
+#endif
+
+#if BVM_PROFILER_ENABLE
+	bvm_native_method_pool_register_leaf(profiler_classname, "start", "()V", babe_lang_Profiler_start);
+	bvm_native_method_pool_register_leaf(profiler_classname, "stop", "()V", babe_lang_Profiler_stop);
+	bvm_native_method_pool_register_leaf(profiler_classname, "reset", "()V", babe_lang_Profiler_reset);
+	bvm_native_method_pool_register(profiler_classname, "dump", "(Ljava/lang/String;)Z", babe_lang_Profiler_dump);
+#endif
+
+#if BVM_PROFILER_METHOD_COUNTERS_ENABLE
+	bvm_native_method_pool_register_leaf(profiler_classname, "resetMethodCounts", "()V", babe_lang_Profiler_resetMethodCounts);
+	bvm_native_method_pool_register(profiler_classname, "dumpMethodCounts", "(Ljava/lang/String;)Z", babe_lang_Profiler_dumpMethodCounts);
+#endif
+
+#if BVM_PROFILER_MONITOR_CONTENTION_ENABLE
+	bvm_native_method_pool_register_leaf(profiler_classname, "resetContention", "()V", babe_lang_Profiler_resetContention);
+	bvm_native_method_pool_register(profiler_classname, "dumpContention", "(Ljava/lang/String;)Z", babe_lang_Profiler_dumpContention);
+#endif
+
 	bvm_native_method_pool_register(throwable_classname, "fillInStackTrace", "()V", java_lang_Throwable_fillInStackTrace);
 	bvm_native_method_pool_register(throwable_classname, "getStackTrace0", "()[Ljava/lang/StackTraceElement;", java_lang_Throwable_getStackTrace0);
 
 	bvm_native_method_pool_register(weakreference_classname, "makeweak", "()V", java_lang_ref_WeakReference_makeweak);
 
+	bvm_native_method_pool_register(softreference_classname, "makesoft", "()V", java_lang_ref_SoftReference_makesoft);
+	bvm_native_method_pool_register(softreference_classname, "get", "()Ljava/lang/Object;", java_lang_ref_SoftReference_get);
+
+	bvm_native_method_pool_register(ephemeron_classname, "makeephemeron", "()V", java_lang_ref_Ephemeron_makeephemeron);
+
 	bvm_native_method_pool_register(securitymanager_classname, "getStackAccessControlContext", "()Ljava/security/AccessControlContext;", java_security_SecurityManager_getStackAccessControlContext);
 	bvm_native_method_pool_register(securitymanager_classname, "getInheritedAccessControlContext", "()Ljava/security/AccessControlContext;", java_security_SecurityManager_getInheritedAccessControlContext);
 }
@@ -60,13 +60,12 @@
  * @li Threads.  The JNI defines a number of functions for thread control such as acquiring and
  * releasing an object monitor.  This is not supported in the NI. The VM's green threads
  * implementation does not make it possible.
- * @li Method invocation: An additional side effect of green-threads is it also makes it
- * impossible to support calling a java method from the NI in a synchronous manner.  Unfortunately,
- * this is what method invocation requires.
- * @li Object construction: A flow-on from not being able to call java methods from the NI is that it
- * is not possible to call either an object's &lt;init&gt; method or a class's &lt;clinit&gt; method.
- * This limitation would mean that developers could not rely on the state on an new-created object
- * or just-loaded class.  However, creation of String and array objects is fully supported.
+ * @li Method invocation: With #BVM_NI_CALLS_ENABLE a Java method may be called from the NI with the
+ * \c NI_CallTYPEMethod and \c NI_CallStaticTYPEMethod functions.  Green threads mean the call runs in a nested
+ * interpreter loop, so only one thread at a time may be calling Java from native code (see #bvm_exec_call).
+ * There are no \c NI_CallTYPEMethodA / \c NI_CallTYPEMethodV forms, and no non-virtual calls.
+ * @li Object construction: It is not possible to construct an object from the NI, other than String and
+ * array objects - for which creation is fully supported.
  * @li Global/local/weak references: the NI does not support the JNI memory management functions
  * for references.  However, it *is* possible to create temporary objects for use and free them.
  * @li Array: Not all JNI array access functions have been implemented, but all the same functionality
@@ -137,6 +136,11 @@
  * memory that has the same characteristics as the local references returned by a function like
  * (say) #NI_NewByteArray - the handle to it is only valid during the current native method execution.
  *
+ * If #BVM_NI_LOCAL_ARENA_ENABLE is set, local memory is not allocated one piece at a time from the heap.  Instead it
+ * is bumped from blocks of #BVM_NI_LOCAL_ARENA_BLOCK_SIZE bytes that belong to the current native method execution.
+ * Each block is made a transient root once, and all the blocks are freed together when the native method returns.
+ * #NI_Free of local memory does nothing in that case.
+ *
  * Local references are transient and will be swept up by the GC the next time it runs after the current native
  * method execution terminates.
  *
@@ -157,6 +161,12 @@
  *
  * No equivalent to 'realloc' is provided.
  *
+ * The raw data of a primitive array may be accessed with the \c NI_GetTYPEArrayElements functions or with
+ * #NI_GetPrimitiveArrayCritical.  Neither copies the data.  Arrays are only ever moved by a heap compaction, and
+ * that happens between bytecodes, so a pointer to array data is good for the rest of the native method.  A native
+ * that must keep a pointer to array data for longer should hold the array with #NI_GetPrimitiveArrayCritical until
+ * it is done with it and then call #NI_ReleasePrimitiveArrayCritical.
+ *
  * There is a limited number of local references that may exist.  This number is determined by the value in
  * #bvm_gl_gc_transient_roots_depth - which default to the compile time constant #BVM_GC_TRANSIENT_ROOTS_DEPTH.
  *
@@ -546,6 +556,14 @@ jfieldID NI_GetFieldID(jclass clazz, const char *name, const char *sig) {
 /** macro to make getting at a virtual field cell more tidy */
 #define VIRTUAL_FIELD_CELL(obj, fieldID)  ( ((bvm_obj_t *)(obj))->fields[((bvm_field_t *) (fieldID))->value.offset] )
 
+#if BVM_FIELD_PACKING_ENABLE
+/** is a virtual field packed? - see #BVM_FIELD_PACKING_ENABLE */
+#define VIRTUAL_FIELD_IS_PACKED(fieldID)  BVM_FIELD_IsPacked((bvm_field_t *) (fieldID))
+
+/** macro to make getting at a packed virtual field of a given type more tidy */
+#define VIRTUAL_FIELD_PACKED(obj, fieldID, type)  ( *((type *) BVM_OBJECT_PACKED_FIELD((bvm_obj_t *) (obj), (bvm_field_t *) (fieldID))) )
+#endif
+
 /** macro to make getting at a static field cell more tidy */
 #define STATIC_FIELD_CELL(fieldID)   ( ((bvm_field_t *) (fieldID) )->value.static_value)
 
@@ -582,6 +600,9 @@ jobject NI_GetObjectField(jobject obj, jfieldID fieldID) {
  * @throws none.
  */
 jboolean NI_GetBooleanField(jobject obj, jfieldID fieldID) {
+#if BVM_FIELD_PACKING_ENABLE
+	if (VIRTUAL_FIELD_IS_PACKED(fieldID)) return VIRTUAL_FIELD_PACKED(obj, fieldID, jboolean);
+#endif
 	/* return cell int as 8 bit int making sure to truncate nicely */
 	return (VIRTUAL_FIELD_CELL(obj, fieldID).int_value & 0xFF);
 }
@@ -601,6 +622,9 @@ jboolean NI_GetBooleanField(jobject obj, jfieldID fieldID) {
  * @throws none.
  */
 jbyte NI_GetByteField(jobject obj, jfieldID fieldID) {
+#if BVM_FIELD_PACKING_ENABLE
+	if (VIRTUAL_FIELD_IS_PACKED(fieldID)) return VIRTUAL_FIELD_PACKED(obj, fieldID, jbyte);
+#endif
 	/* return as 8 bit int making sure to truncate nicely */
 	return (VIRTUAL_FIELD_CELL(obj, fieldID).int_value & 0xFF);
 }
@@ -620,6 +644,9 @@ jbyte NI_GetByteField(jobject obj, jfieldID fieldID) {
  * @throws none.
  */
 jchar NI_GetCharField(jobject obj, jfieldID fieldID) {
+#if BVM_FIELD_PACKING_ENABLE
+	if (VIRTUAL_FIELD_IS_PACKED(fieldID)) return VIRTUAL_FIELD_PACKED(obj, fieldID, jchar);
+#endif
 	/* return as 16 bit making sure to truncate nicely */
 	return (VIRTUAL_FIELD_CELL(obj, fieldID).int_value & 0xFFFF);
 }
@@ -639,6 +666,9 @@ jchar NI_GetCharField(jobject obj, jfieldID fieldID) {
  * @throws none.
  */
 jshort NI_GetShortField(jobject obj, jfieldID fieldID) {
+#if BVM_FIELD_PACKING_ENABLE
+	if (VIRTUAL_FIELD_IS_PACKED(fieldID)) return VIRTUAL_FIELD_PACKED(obj, fieldID, jshort);
+#endif
 	/* return as 16 bit int making sure to truncate nicely */
 	return (VIRTUAL_FIELD_CELL(obj, fieldID).int_value & 0xFFFF);
 }
@@ -658,6 +688,9 @@ jshort NI_GetShortField(jobject obj, jfieldID fieldID) {
  * @throws none.
  */
 jint NI_GetIntField(jobject obj, jfieldID fieldID) {
+#if BVM_FIELD_PACKING_ENABLE
+	if (VIRTUAL_FIELD_IS_PACKED(fieldID)) return VIRTUAL_FIELD_PACKED(obj, fieldID, jint);
+#endif
 	return VIRTUAL_FIELD_CELL(obj, fieldID).int_value;
 }
 
@@ -676,6 +709,13 @@ jint NI_GetIntField(jobject obj, jfieldID fieldID) {
  * @throws none.
  */
 jlong NI_GetLongField(jobject obj, jfieldID fieldID) {
+#if BVM_FIELD_PACKING_ENABLE
+	if (VIRTUAL_FIELD_IS_PACKED(fieldID)) {
+		bvm_cell_t cells[2];
+		bvm_object_get_packed_field((bvm_obj_t *) obj, (bvm_field_t *) fieldID, cells);
+		return BVM_INT64_from_cells(cells);
+	}
+#endif
 	/* create a long using starting at the first field cell of the long field */
 	return BVM_INT64_from_cells(&VIRTUAL_FIELD_CELL(obj, fieldID));
 }
@@ -697,6 +737,9 @@ jlong NI_GetLongField(jobject obj, jfieldID fieldID) {
  * @throws none.
  */
 jfloat NI_GetFloatField(jobject obj, jfieldID fieldID) {
+#if BVM_FIELD_PACKING_ENABLE
+	if (VIRTUAL_FIELD_IS_PACKED(fieldID)) return VIRTUAL_FIELD_PACKED(obj, fieldID, jfloat);
+#endif
 	return VIRTUAL_FIELD_CELL(obj, fieldID).float_value;
 }
 
@@ -715,6 +758,13 @@ jfloat NI_GetFloatField(jobject obj, jfieldID fieldID) {
  * @throws none.
  */
 jdouble NI_GetDoubleField(jobject obj, jfieldID fieldID) {
+#if BVM_FIELD_PACKING_ENABLE
+	if (VIRTUAL_FIELD_IS_PACKED(fieldID)) {
+		bvm_cell_t cells[2];
+		bvm_object_get_packed_field((bvm_obj_t *) obj, (bvm_field_t *) fieldID, cells);
+		return BVM_DOUBLE_from_cells(cells);
+	}
+#endif
 	/* create a double using starting at the first field cell of the long field */
 	return BVM_DOUBLE_from_cells(&VIRTUAL_FIELD_CELL(obj, fieldID));
 }
@@ -735,10 +785,21 @@ jdouble NI_GetDoubleField(jobject obj, jfieldID fieldID) {
  * @param fieldID a field ID of the given instance.
  * @param val the new value.
  *
- * @throws none.
+ * @throws none.  With #BVM_SCOPED_MEMORY_ENABLE an \c IllegalStateException is left pending and the field is not set
+ * if \c val would outlive its scope.
  */
 void NI_SetObjectField(jobject obj, jfieldID fieldID, jobject val) {
+
+#if BVM_SCOPED_MEMORY_ENABLE
+	/* a scoped object may not be stored where it may outlive its scope */
+	if (BVM_SCOPE_IsEscape(obj, val)) {
+		bvm_gl_thread_current->pending_exception = bvm_create_exception_c(BVM_ERR_ILLEGAL_STATE_EXCEPTION, NULL);
+		return;
+	}
+#endif
+
 	VIRTUAL_FIELD_CELL(obj, fieldID).ref_value = val;
+	BVM_GC_WRITE_BARRIER(obj, val);
 }
 
 /**
@@ -754,6 +815,12 @@ void NI_SetObjectField(jobject obj, jfieldID fieldID, jobject val) {
  * @throws none.
 */
 void NI_SetBooleanField(jobject obj, jfieldID fieldID, jboolean val) {
+#if BVM_FIELD_PACKING_ENABLE
+	if (VIRTUAL_FIELD_IS_PACKED(fieldID)) {
+		VIRTUAL_FIELD_PACKED(obj, fieldID, jboolean) = val;
+		return;
+	}
+#endif
 	VIRTUAL_FIELD_CELL(obj, fieldID).int_value = val;
 }
 
@@ -770,6 +837,12 @@ void NI_SetBooleanField(jobject obj, jfieldID fieldID, jboolean val) {
  * @throws none.
 */
 void NI_SetByteField(jobject obj, jfieldID fieldID, jbyte val) {
+#if BVM_FIELD_PACKING_ENABLE
+	if (VIRTUAL_FIELD_IS_PACKED(fieldID)) {
+		VIRTUAL_FIELD_PACKED(obj, fieldID, jbyte) = val;
+		return;
+	}
+#endif
 	VIRTUAL_FIELD_CELL(obj, fieldID).int_value = val;
 }
 
@@ -786,6 +859,12 @@ void NI_SetByteField(jobject obj, jfieldID fieldID, jbyte val) {
  * @throws none.
 */
 void NI_SetCharField(jobject obj, jfieldID fieldID, jchar val) {
+#if BVM_FIELD_PACKING_ENABLE
+	if (VIRTUAL_FIELD_IS_PACKED(fieldID)) {
+		VIRTUAL_FIELD_PACKED(obj, fieldID, jchar) = val;
+		return;
+	}
+#endif
 	VIRTUAL_FIELD_CELL(obj, fieldID).int_value = val;
 }
 
@@ -802,6 +881,12 @@ void NI_SetCharField(jobject obj, jfieldID fieldID, jchar val) {
  * @throws none.
 */
 void NI_SetShortField(jobject obj, jfieldID fieldID, jshort val) {
+#if BVM_FIELD_PACKING_ENABLE
+	if (VIRTUAL_FIELD_IS_PACKED(fieldID)) {
+		VIRTUAL_FIELD_PACKED(obj, fieldID, jshort) = val;
+		return;
+	}
+#endif
 	VIRTUAL_FIELD_CELL(obj, fieldID).int_value = val;
 }
 
@@ -818,6 +903,12 @@ void NI_SetShortField(jobject obj, jfieldID fieldID, jshort val) {
  * @throws none.
 */
 void NI_SetIntField(jobject obj, jfieldID fieldID, jint val) {
+#if BVM_FIELD_PACKING_ENABLE
+	if (VIRTUAL_FIELD_IS_PACKED(fieldID)) {
+		VIRTUAL_FIELD_PACKED(obj, fieldID, jint) = val;
+		return;
+	}
+#endif
 	VIRTUAL_FIELD_CELL(obj, fieldID).int_value = val;
 }
 
@@ -834,6 +925,14 @@ void NI_SetIntField(jobject obj, jfieldID fieldID, jint val) {
  * @throws none.
 */
 void NI_SetLongField(jobject obj, jfieldID fieldID, jlong val) {
+#if BVM_FIELD_PACKING_ENABLE
+	if (VIRTUAL_FIELD_IS_PACKED(fieldID)) {
+		bvm_cell_t cells[2];
+		BVM_INT64_to_cells(cells, val);
+		bvm_object_put_packed_field((bvm_obj_t *) obj, (bvm_field_t *) fieldID, cells);
+		return;
+	}
+#endif
 	/* copy the long value to the field starting at the address of the first cell of the
 	 * long field */
 	BVM_INT64_to_cells(&VIRTUAL_FIELD_CELL(obj, fieldID), val);
@@ -855,6 +954,12 @@ void NI_SetLongField(jobject obj, jfieldID fieldID, jlong val) {
  * @throws none.
 */
 void NI_SetFloatField(jobject obj, jfieldID fieldID, jfloat val) {
+#if BVM_FIELD_PACKING_ENABLE
+	if (VIRTUAL_FIELD_IS_PACKED(fieldID)) {
+		VIRTUAL_FIELD_PACKED(obj, fieldID, jfloat) = val;
+		return;
+	}
+#endif
 	VIRTUAL_FIELD_CELL(obj, fieldID).float_value = val;
 }
 
@@ -871,6 +976,14 @@ void NI_SetFloatField(jobject obj, jfieldID fieldID, jfloat val) {
  * @throws none.
 */
 void NI_SetDoubleField(jobject obj, jfieldID fieldID, jdouble val) {
+#if BVM_FIELD_PACKING_ENABLE
+	if (VIRTUAL_FIELD_IS_PACKED(fieldID)) {
+		bvm_cell_t cells[2];
+		BVM_DOUBLE_to_cells(cells, val);
+		bvm_object_put_packed_field((bvm_obj_t *) obj, (bvm_field_t *) fieldID, cells);
+		return;
+	}
+#endif
 	/* copy the double value to the field starting at the address of the first cell of the
 	 * field */
 	BVM_DOUBLE_to_cells(&VIRTUAL_FIELD_CELL(obj, fieldID), val);
@@ -1105,11 +1218,22 @@ jdouble NI_GetStaticDoubleField(jclass clazz, jfieldID fieldID) {
  * @param fieldID a field ID of the given instance.
  * @param value the new value.
  *
- * @throws none.
+ * @throws none.  With #BVM_SCOPED_MEMORY_ENABLE an \c IllegalStateException is left pending and the field is not set
+ * if \c value would outlive its scope.
  */
 void NI_SetStaticObjectField(jclass clazz, jfieldID fieldID, jobject value) {
     UNUSED(clazz);
+
+#if BVM_SCOPED_MEMORY_ENABLE
+	/* a scoped object may not be stored where it may outlive its scope */
+	if (BVM_SCOPE_IsEscape(((bvm_field_t *) fieldID)->clazz, value)) {
+		bvm_gl_thread_current->pending_exception = bvm_create_exception_c(BVM_ERR_ILLEGAL_STATE_EXCEPTION, NULL);
+		return;
+	}
+#endif
+
 	STATIC_FIELD_CELL(fieldID).ref_value = value;
+	BVM_GC_WRITE_BARRIER(((bvm_field_t *) fieldID)->clazz, value);
 }
 
 /**
@@ -1260,6 +1384,729 @@ void NI_SetStaticDoubleField(jclass clazz, jfieldID fieldID, jdouble value) {
 
 #endif
 
+/*********************************************************************************************
+ ** Method call functions
+ *********************************************************************************************/
+
+#if BVM_NI_CALLS_ENABLE
+
+/** The number of argument cells a call may have before heap is allocated to hold them */
+#define NI_CALL_ARGS_BUFFER_SIZE 16
+
+/**
+ * Look up a method of a class by name and descriptor for #NI_GetMethodID or #NI_GetStaticMethodID.
+ *
+ * @param clazz a reference to the class object to look in.
+ * @param name the method name.
+ * @param sig the method descriptor.
+ * @param is_static whether a static method is wanted.
+ *
+ * @return the method, or \c NULL if none is found - with an exception pending.
+ */
+static jmethodID ni_get_method(jclass clazz, const char *name, const char *sig, bvm_bool_t is_static) {
+
+	bvm_method_t *method = NULL;
+	bvm_clazz_t *cl = ( (bvm_class_obj_t *) clazz)->refers_to_clazz;
+
+	BVM_TRY {
+		method = bvm_clazz_method_get( (bvm_instance_clazz_t *) cl, bvm_utfstring_pool_get_c(name, BVM_TRUE),
+				bvm_utfstring_pool_get_c(sig, BVM_TRUE), BVM_METHOD_SEARCH_FULL_TREE);
+	} BVM_CATCH (e) {
+		bvm_gl_thread_current->pending_exception = e;
+		return NULL;
+	} BVM_END_CATCH
+
+	/* not found, or the wrong kind?  Nasty, create exception for thread */
+	if ( (method == NULL) || (BVM_METHOD_IsStatic(method) != is_static) ) {
+		bvm_gl_thread_current->pending_exception = bvm_create_exception_c(BVM_ERR_NO_SUCH_METHOD_ERROR, name);
+		method = NULL;
+	}
+
+	return method;
+}
+
+/**
+ * Make a call for the \c NI_Call<Type>Method functions.  The arguments are taken from a \c va_list as the method
+ * descriptor describes them - with the C default argument promotions applied to them - and the method is run by
+ * #bvm_exec_call.
+ *
+ * @param obj the object the call is made upon.  Ignored for a static method.
+ * @param methodID the method to call.
+ * @param args the arguments of the call.
+ * @param result where the cells returned by the method are put.  May be \c NULL.
+ *
+ * @return #NI_OK, or #NI_ERR if the call threw an exception - which is then pending.  Nothing is called if an
+ * exception is already pending.
+ */
+static jint ni_call(jobject obj, jmethodID methodID, va_list args, bvm_cell_t *result) {
+
+	bvm_method_t *method = methodID;
+	bvm_cell_t buffer[NI_CALL_ARGS_BUFFER_SIZE];
+	bvm_cell_t * volatile cells = buffer;
+	bvm_throwable_obj_t *exception = NULL;
+	bvm_uint32_t nr_cells = method->num_args + 1;
+#if BVM_NI_LOCAL_ARENA_ENABLE
+	bvm_ni_arena_t *arena_mark = bvm_gl_ni_arena;
+#endif
+
+	if (bvm_gl_thread_current->pending_exception != NULL) return NI_ERR;
+
+	BVM_TRY {
+
+		char *c = (char *) method->jni_signature->data + 1;
+		bvm_uint32_t i = 0;
+
+		if (nr_cells > NI_CALL_ARGS_BUFFER_SIZE)
+			cells = bvm_heap_alloc(nr_cells * sizeof(bvm_cell_t), BVM_ALLOC_TYPE_STATIC);
+
+		if (!BVM_METHOD_IsStatic(method))
+			cells[i++].ref_value = obj;
+
+		/* one argument for each parameter of the descriptor */
+		while (*c != ')') {
+			switch (*c++) {
+				case 'B':
+				case 'C':
+				case 'I':
+				case 'S':
+				case 'Z':
+					cells[i++].int_value = va_arg(args, int);
+					break;
+				case 'J':
+					BVM_INT64_to_cells(&cells[i], va_arg(args, jlong));
+					i += 2;
+					break;
+#if BVM_FLOAT_ENABLE
+				case 'F':
+					cells[i++].float_value = (jfloat) va_arg(args, double);
+					break;
+				case 'D':
+					BVM_DOUBLE_to_cells(&cells[i], va_arg(args, double));
+					i += 2;
+					break;
+#endif
+				case '[':
+					while (*c == '[') c++;
+					if (*c++ != 'L') {
+						cells[i++].ref_value = va_arg(args, jobject);
+						break;
+					}
+					/* an array of references - skip its clazz name as for an object.  Falls through. */
+				case 'L':
+					while (*c++ != ';');
+					cells[i++].ref_value = va_arg(args, jobject);
+					break;
+			}
+		}
+
+		exception = bvm_exec_call(method, cells, result);
+
+	} BVM_CATCH (e) {
+		exception = e;
+#if BVM_NI_LOCAL_ARENA_ENABLE
+		/* a called native that threw natively has lost the transient roots of its arena */
+		if (bvm_gl_ni_arena != arena_mark) bvm_ni_arena_release(arena_mark);
+#endif
+	} BVM_END_CATCH
+
+	if (cells != buffer) bvm_heap_free(cells);
+
+	if (exception != NULL) {
+		bvm_gl_thread_current->pending_exception = exception;
+		return NI_ERR;
+	}
+
+	return NI_OK;
+}
+
+/**
+ * Returns the method ID for an instance method of a class.  The method is specified by its name and
+ * descriptor and may be defined in the class, one of its superclasses or one of its interfaces.  The method ID is
+ * the VM's own method - it may be looked up once and kept for as long as the class is loaded.  The
+ * \c NI_Call<Type>Method family of functions use method IDs to call methods.  The clazz reference must not be
+ * \c NULL.
+ *
+ * @param clazz a reference to the class object from which the method ID will be derived.
+ * @param name the method name in a null-terminated UTF-8 string.
+ * @param sig the method descriptor as a null-terminated UTF-8 string.
+ *
+ * @return a method ID, or \c NULL if the operation fails. Returns \c NULL if and only if
+ * an invocation of this function has thrown an exception.
+ *
+ * @throws NoSuchMethodError if the specified method cannot be found, or is static.
+ */
+jmethodID NI_GetMethodID(jclass clazz, const char *name, const char *sig) {
+	return ni_get_method(clazz, name, sig, BVM_FALSE);
+}
+
+/**
+ * Returns the method ID for a static method of a class.  The method is specified by its name and
+ * descriptor.  The \c NI_CallStatic<Type>Method family of functions use method IDs to call static methods.
+ * The clazz reference must not be \c NULL.
+ *
+ * @param clazz a reference to the class object from which the method ID will be derived.
+ * @param name the method name in a null-terminated UTF-8 string.
+ * @param sig the method descriptor as a null-terminated UTF-8 string.
+ *
+ * @return a method ID, or \c NULL if the operation fails. Returns \c NULL if and only if
+ * an invocation of this function has thrown an exception.
+ *
+ * @throws NoSuchMethodError if the specified method cannot be found, or is not static.
+ */
+jmethodID NI_GetStaticMethodID(jclass clazz, const char *name, const char *sig) {
+	return ni_get_method(clazz, name, sig, BVM_TRUE);
+}
+
+/**
+ * Calls an instance method of an object returning nothing.  The arguments of the call follow \c methodID, one
+ * for each parameter of the method descriptor.  The method ID must be from #NI_GetMethodID.  The method runs to
+ * completion before this function returns.  An exception it throws is pending afterwards.
+ *
+ * @param obj the object to call the method upon.  The method called is its implementation for the class of
+ * \c obj.
+ * @param methodID the method ID of the method to call.
+ *
+ * @throws any exception thrown by the method.
+ */
+void NI_CallVoidMethod(jobject obj, jmethodID methodID, ...) {
+
+	va_list args;
+
+	va_start(args, methodID);
+	ni_call(obj, methodID, args, NULL);
+	va_end(args);
+}
+
+/**
+ * Calls an instance method of an object and returns its jobject result.  The arguments of the call follow \c methodID, one
+ * for each parameter of the method descriptor.  The method ID must be from #NI_GetMethodID.  The method runs to
+ * completion before this function returns.  An exception it throws is pending afterwards.
+ *
+ * @param obj the object to call the method upon.  The method called is its implementation for the class of
+ * \c obj.
+ * @param methodID the method ID of the method to call.
+ *
+ * @return a local reference to the object returned by the method, or \c NULL if it threw an exception.
+ *
+ * @throws any exception thrown by the method.
+ */
+jobject NI_CallObjectMethod(jobject obj, jmethodID methodID, ...) {
+
+	bvm_cell_t result[2];
+	jint rv;
+	va_list args;
+
+	va_start(args, methodID);
+	rv = ni_call(obj, methodID, args, result);
+	va_end(args);
+
+	if (rv != NI_OK) return NULL;
+
+	/* the result is a local reference */
+	if (result[0].ref_value != NULL) {
+		BVM_MAKE_TRANSIENT_ROOT(result[0].ref_value);
+	}
+
+	return result[0].ref_value;
+}
+
+/**
+ * Calls an instance method of an object and returns its jboolean result.  The arguments of the call follow \c methodID, one
+ * for each parameter of the method descriptor.  The method ID must be from #NI_GetMethodID.  The method runs to
+ * completion before this function returns.  An exception it throws is pending afterwards.
+ *
+ * @param obj the object to call the method upon.  The method called is its implementation for the class of
+ * \c obj.
+ * @param methodID the method ID of the method to call.
+ *
+ * @return the jboolean returned by the method, or \c 0 if it threw an exception.
+ *
+ * @throws any exception thrown by the method.
+ */
+jboolean NI_CallBooleanMethod(jobject obj, jmethodID methodID, ...) {
+
+	bvm_cell_t result[2];
+	jint rv;
+	va_list args;
+
+	va_start(args, methodID);
+	rv = ni_call(obj, methodID, args, result);
+	va_end(args);
+
+	return (rv == NI_OK) ? (jboolean) result[0].int_value : 0;
+}
+
+/**
+ * Calls an instance method of an object and returns its jbyte result.  The arguments of the call follow \c methodID, one
+ * for each parameter of the method descriptor.  The method ID must be from #NI_GetMethodID.  The method runs to
+ * completion before this function returns.  An exception it throws is pending afterwards.
+ *
+ * @param obj the object to call the method upon.  The method called is its implementation for the class of
+ * \c obj.
+ * @param methodID the method ID of the method to call.
+ *
+ * @return the jbyte returned by the method, or \c 0 if it threw an exception.
+ *
+ * @throws any exception thrown by the method.
+ */
+jbyte NI_CallByteMethod(jobject obj, jmethodID methodID, ...) {
+
+	bvm_cell_t result[2];
+	jint rv;
+	va_list args;
+
+	va_start(args, methodID);
+	rv = ni_call(obj, methodID, args, result);
+	va_end(args);
+
+	return (rv == NI_OK) ? (jbyte) result[0].int_value : 0;
+}
+
+/**
+ * Calls an instance method of an object and returns its jchar result.  The arguments of the call follow \c methodID, one
+ * for each parameter of the method descriptor.  The method ID must be from #NI_GetMethodID.  The method runs to
+ * completion before this function returns.  An exception it throws is pending afterwards.
+ *
+ * @param obj the object to call the method upon.  The method called is its implementation for the class of
+ * \c obj.
+ * @param methodID the method ID of the method to call.
+ *
+ * @return the jchar returned by the method, or \c 0 if it threw an exception.
+ *
+ * @throws any exception thrown by the method.
+ */
+jchar NI_CallCharMethod(jobject obj, jmethodID methodID, ...) {
+
+	bvm_cell_t result[2];
+	jint rv;
+	va_list args;
+
+	va_start(args, methodID);
+	rv = ni_call(obj, methodID, args, result);
+	va_end(args);
+
+	return (rv == NI_OK) ? (jchar) result[0].int_value : 0;
+}
+
+/**
+ * Calls an instance method of an object and returns its jshort result.  The arguments of the call follow \c methodID, one
+ * for each parameter of the method descriptor.  The method ID must be from #NI_GetMethodID.  The method runs to
+ * completion before this function returns.  An exception it throws is pending afterwards.
+ *
+ * @param obj the object to call the method upon.  The method called is its implementation for the class of
+ * \c obj.
+ * @param methodID the method ID of the method to call.
+ *
+ * @return the jshort returned by the method, or \c 0 if it threw an exception.
+ *
+ * @throws any exception thrown by the method.
+ */
+jshort NI_CallShortMethod(jobject obj, jmethodID methodID, ...) {
+
+	bvm_cell_t result[2];
+	jint rv;
+	va_list args;
+
+	va_start(args, methodID);
+	rv = ni_call(obj, methodID, args, result);
+	va_end(args);
+
+	return (rv == NI_OK) ? (jshort) result[0].int_value : 0;
+}
+
+/**
+ * Calls an instance method of an object and returns its jint result.  The arguments of the call follow \c methodID, one
+ * for each parameter of the method descriptor.  The method ID must be from #NI_GetMethodID.  The method runs to
+ * completion before this function returns.  An exception it throws is pending afterwards.
+ *
+ * @param obj the object to call the method upon.  The method called is its implementation for the class of
+ * \c obj.
+ * @param methodID the method ID of the method to call.
+ *
+ * @return the jint returned by the method, or \c 0 if it threw an exception.
+ *
+ * @throws any exception thrown by the method.
+ */
+jint NI_CallIntMethod(jobject obj, jmethodID methodID, ...) {
+
+	bvm_cell_t result[2];
+	jint rv;
+	va_list args;
+
+	va_start(args, methodID);
+	rv = ni_call(obj, methodID, args, result);
+	va_end(args);
+
+	return (rv == NI_OK) ? (jint) result[0].int_value : 0;
+}
+
+/**
+ * Calls an instance method of an object and returns its jlong result.  The arguments of the call follow \c methodID, one
+ * for each parameter of the method descriptor.  The method ID must be from #NI_GetMethodID.  The method runs to
+ * completion before this function returns.  An exception it throws is pending afterwards.
+ *
+ * @param obj the object to call the method upon.  The method called is its implementation for the class of
+ * \c obj.
+ * @param methodID the method ID of the method to call.
+ *
+ * @return the jlong returned by the method, or \c 0 if it threw an exception.
+ *
+ * @throws any exception thrown by the method.
+ */
+jlong NI_CallLongMethod(jobject obj, jmethodID methodID, ...) {
+
+	bvm_cell_t result[2];
+	jint rv;
+	va_list args;
+
+	va_start(args, methodID);
+	rv = ni_call(obj, methodID, args, result);
+	va_end(args);
+
+	return (rv == NI_OK) ? BVM_INT64_from_cells(result) : 0;
+}
+
+#if BVM_FLOAT_ENABLE
+
+/**
+ * Calls an instance method of an object and returns its jfloat result.  The arguments of the call follow \c methodID, one
+ * for each parameter of the method descriptor.  The method ID must be from #NI_GetMethodID.  The method runs to
+ * completion before this function returns.  An exception it throws is pending afterwards.
+ *
+ * @param obj the object to call the method upon.  The method called is its implementation for the class of
+ * \c obj.
+ * @param methodID the method ID of the method to call.
+ *
+ * @return the jfloat returned by the method, or \c 0 if it threw an exception.
+ *
+ * @throws any exception thrown by the method.
+ */
+jfloat NI_CallFloatMethod(jobject obj, jmethodID methodID, ...) {
+
+	bvm_cell_t result[2];
+	jint rv;
+	va_list args;
+
+	va_start(args, methodID);
+	rv = ni_call(obj, methodID, args, result);
+	va_end(args);
+
+	return (rv == NI_OK) ? result[0].float_value : 0;
+}
+
+#endif
+
+#if BVM_FLOAT_ENABLE
+
+/**
+ * Calls an instance method of an object and returns its jdouble result.  The arguments of the call follow \c methodID, one
+ * for each parameter of the method descriptor.  The method ID must be from #NI_GetMethodID.  The method runs to
+ * completion before this function returns.  An exception it throws is pending afterwards.
+ *
+ * @param obj the object to call the method upon.  The method called is its implementation for the class of
+ * \c obj.
+ * @param methodID the method ID of the method to call.
+ *
+ * @return the jdouble returned by the method, or \c 0 if it threw an exception.
+ *
+ * @throws any exception thrown by the method.
+ */
+jdouble NI_CallDoubleMethod(jobject obj, jmethodID methodID, ...) {
+
+	bvm_cell_t result[2];
+	jint rv;
+	va_list args;
+
+	va_start(args, methodID);
+	rv = ni_call(obj, methodID, args, result);
+	va_end(args);
+
+	return (rv == NI_OK) ? BVM_DOUBLE_from_cells(result) : 0;
+}
+
+#endif
+
+/**
+ * Calls a static method of a class returning nothing.  The arguments of the call follow \c methodID, one
+ * for each parameter of the method descriptor.  The method ID must be from #NI_GetStaticMethodID.  The method runs to
+ * completion before this function returns.  An exception it throws is pending afterwards.
+ *
+ * @param clazz the class of the method.  Not used - the method ID is enough.
+ * @param methodID the method ID of the method to call.
+ *
+ * @throws any exception thrown by the method.
+ */
+void NI_CallStaticVoidMethod(jclass clazz, jmethodID methodID, ...) {
+
+	va_list args;
+
+	UNUSED(clazz);
+
+	va_start(args, methodID);
+	ni_call(NULL, methodID, args, NULL);
+	va_end(args);
+}
+
+/**
+ * Calls a static method of a class and returns its jobject result.  The arguments of the call follow \c methodID, one
+ * for each parameter of the method descriptor.  The method ID must be from #NI_GetStaticMethodID.  The method runs to
+ * completion before this function returns.  An exception it throws is pending afterwards.
+ *
+ * @param clazz the class of the method.  Not used - the method ID is enough.
+ * @param methodID the method ID of the method to call.
+ *
+ * @return a local reference to the object returned by the method, or \c NULL if it threw an exception.
+ *
+ * @throws any exception thrown by the method.
+ */
+jobject NI_CallStaticObjectMethod(jclass clazz, jmethodID methodID, ...) {
+
+	bvm_cell_t result[2];
+	jint rv;
+	va_list args;
+
+	UNUSED(clazz);
+
+	va_start(args, methodID);
+	rv = ni_call(NULL, methodID, args, result);
+	va_end(args);
+
+	if (rv != NI_OK) return NULL;
+
+	/* the result is a local reference */
+	if (result[0].ref_value != NULL) {
+		BVM_MAKE_TRANSIENT_ROOT(result[0].ref_value);
+	}
+
+	return result[0].ref_value;
+}
+
+/**
+ * Calls a static method of a class and returns its jboolean result.  The arguments of the call follow \c methodID, one
+ * for each parameter of the method descriptor.  The method ID must be from #NI_GetStaticMethodID.  The method runs to
+ * completion before this function returns.  An exception it throws is pending afterwards.
+ *
+ * @param clazz the class of the method.  Not used - the method ID is enough.
+ * @param methodID the method ID of the method to call.
+ *
+ * @return the jboolean returned by the method, or \c 0 if it threw an exception.
+ *
+ * @throws any exception thrown by the method.
+ */
+jboolean NI_CallStaticBooleanMethod(jclass clazz, jmethodID methodID, ...) {
+
+	bvm_cell_t result[2];
+	jint rv;
+	va_list args;
+
+	UNUSED(clazz);
+
+	va_start(args, methodID);
+	rv = ni_call(NULL, methodID, args, result);
+	va_end(args);
+
+	return (rv == NI_OK) ? (jboolean) result[0].int_value : 0;
+}
+
+/**
+ * Calls a static method of a class and returns its jbyte result.  The arguments of the call follow \c methodID, one
+ * for each parameter of the method descriptor.  The method ID must be from #NI_GetStaticMethodID.  The method runs to
+ * completion before this function returns.  An exception it throws is pending afterwards.
+ *
+ * @param clazz the class of the method.  Not used - the method ID is enough.
+ * @param methodID the method ID of the method to call.
+ *
+ * @return the jbyte returned by the method, or \c 0 if it threw an exception.
+ *
+ * @throws any exception thrown by the method.
+ */
+jbyte NI_CallStaticByteMethod(jclass clazz, jmethodID methodID, ...) {
+
+	bvm_cell_t result[2];
+	jint rv;
+	va_list args;
+
+	UNUSED(clazz);
+
+	va_start(args, methodID);
+	rv = ni_call(NULL, methodID, args, result);
+	va_end(args);
+
+	return (rv == NI_OK) ? (jbyte) result[0].int_value : 0;
+}
+
+/**
+ * Calls a static method of a class and returns its jchar result.  The arguments of the call follow \c methodID, one
+ * for each parameter of the method descriptor.  The method ID must be from #NI_GetStaticMethodID.  The method runs to
+ * completion before this function returns.  An exception it throws is pending afterwards.
+ *
+ * @param clazz the class of the method.  Not used - the method ID is enough.
+ * @param methodID the method ID of the method to call.
+ *
+ * @return the jchar returned by the method, or \c 0 if it threw an exception.
+ *
+ * @throws any exception thrown by the method.
+ */
+jchar NI_CallStaticCharMethod(jclass clazz, jmethodID methodID, ...) {
+
+	bvm_cell_t result[2];
+	jint rv;
+	va_list args;
+
+	UNUSED(clazz);
+
+	va_start(args, methodID);
+	rv = ni_call(NULL, methodID, args, result);
+	va_end(args);
+
+	return (rv == NI_OK) ? (jchar) result[0].int_value : 0;
+}
+
+/**
+ * Calls a static method of a class and returns its jshort result.  The arguments of the call follow \c methodID, one
+ * for each parameter of the method descriptor.  The method ID must be from #NI_GetStaticMethodID.  The method runs to
+ * completion before this function returns.  An exception it throws is pending afterwards.
+ *
+ * @param clazz the class of the method.  Not used - the method ID is enough.
+ * @param methodID the method ID of the method to call.
+ *
+ * @return the jshort returned by the method, or \c 0 if it threw an exception.
+ *
+ * @throws any exception thrown by the method.
+ */
+jshort NI_CallStaticShortMethod(jclass clazz, jmethodID methodID, ...) {
+
+	bvm_cell_t result[2];
+	jint rv;
+	va_list args;
+
+	UNUSED(clazz);
+
+	va_start(args, methodID);
+	rv = ni_call(NULL, methodID, args, result);
+	va_end(args);
+
+	return (rv == NI_OK) ? (jshort) result[0].int_value : 0;
+}
+
+/**
+ * Calls a static method of a class and returns its jint result.  The arguments of the call follow \c methodID, one
+ * for each parameter of the method descriptor.  The method ID must be from #NI_GetStaticMethodID.  The method runs to
+ * completion before this function returns.  An exception it throws is pending afterwards.
+ *
+ * @param clazz the class of the method.  Not used - the method ID is enough.
+ * @param methodID the method ID of the method to call.
+ *
+ * @return the jint returned by the method, or \c 0 if it threw an exception.
+ *
+ * @throws any exception thrown by the method.
+ */
+jint NI_CallStaticIntMethod(jclass clazz, jmethodID methodID, ...) {
+
+	bvm_cell_t result[2];
+	jint rv;
+	va_list args;
+
+	UNUSED(clazz);
+
+	va_start(args, methodID);
+	rv = ni_call(NULL, methodID, args, result);
+	va_end(args);
+
+	return (rv == NI_OK) ? (jint) result[0].int_value : 0;
+}
+
+/**
+ * Calls a static method of a class and returns its jlong result.  The arguments of the call follow \c methodID, one
+ * for each parameter of the method descriptor.  The method ID must be from #NI_GetStaticMethodID.  The method runs to
+ * completion before this function returns.  An exception it throws is pending afterwards.
+ *
+ * @param clazz the class of the method.  Not used - the method ID is enough.
+ * @param methodID the method ID of the method to call.
+ *
+ * @return the jlong returned by the method, or \c 0 if it threw an exception.
+ *
+ * @throws any exception thrown by the method.
+ */
+jlong NI_CallStaticLongMethod(jclass clazz, jmethodID methodID, ...) {
+
+	bvm_cell_t result[2];
+	jint rv;
+	va_list args;
+
+	UNUSED(clazz);
+
+	va_start(args, methodID);
+	rv = ni_call(NULL, methodID, args, result);
+	va_end(args);
+
+	return (rv == NI_OK) ? BVM_INT64_from_cells(result) : 0;
+}
+
+#if BVM_FLOAT_ENABLE
+
+/**
+ * Calls a static method of a class and returns its jfloat result.  The arguments of the call follow \c methodID, one
+ * for each parameter of the method descriptor.  The method ID must be from #NI_GetStaticMethodID.  The method runs to
+ * completion before this function returns.  An exception it throws is pending afterwards.
+ *
+ * @param clazz the class of the method.  Not used - the method ID is enough.
+ * @param methodID the method ID of the method to call.
+ *
+ * @return the jfloat returned by the method, or \c 0 if it threw an exception.
+ *
+ * @throws any exception thrown by the method.
+ */
+jfloat NI_CallStaticFloatMethod(jclass clazz, jmethodID methodID, ...) {
+
+	bvm_cell_t result[2];
+	jint rv;
+	va_list args;
+
+	UNUSED(clazz);
+
+	va_start(args, methodID);
+	rv = ni_call(NULL, methodID, args, result);
+	va_end(args);
+
+	return (rv == NI_OK) ? result[0].float_value : 0;
+}
+
+#endif
+
+#if BVM_FLOAT_ENABLE
+
+/**
+ * Calls a static method of a class and returns its jdouble result.  The arguments of the call follow \c methodID, one
+ * for each parameter of the method descriptor.  The method ID must be from #NI_GetStaticMethodID.  The method runs to
+ * completion before this function returns.  An exception it throws is pending afterwards.
+ *
+ * @param clazz the class of the method.  Not used - the method ID is enough.
+ * @param methodID the method ID of the method to call.
+ *
+ * @return the jdouble returned by the method, or \c 0 if it threw an exception.
+ *
+ * @throws any exception thrown by the method.
+ */
+jdouble NI_CallStaticDoubleMethod(jclass clazz, jmethodID methodID, ...) {
+
+	bvm_cell_t result[2];
+	jint rv;
+	va_list args;
+
+	UNUSED(clazz);
+
+	va_start(args, methodID);
+	rv = ni_call(NULL, methodID, args, result);
+	va_end(args);
+
+	return (rv == NI_OK) ? BVM_DOUBLE_from_cells(result) : 0;
+}
+
+#endif
+
+#endif
+
 /*********************************************************************************************
  ** String functions
  *********************************************************************************************/
@@ -1504,7 +2351,7 @@ jobjectArray NI_NewObjectArray(jsize len, jclass clazz, jobject init) {
 		/* and init the contents if required */
 		if (init != NULL) {
 			while (len--)
-				array->data[len] = init;
+				array->data[len] = BVM_REF_Encode((bvm_obj_t *) init);
 		}
 
 		BVM_MAKE_TRANSIENT_ROOT(array);
@@ -1537,7 +2384,7 @@ jobject NI_GetObjectArrayElement(jobjectArray array, jsize index) {
 		return NULL;
 	}
 
-	return arr->data[index];
+	return BVM_REF_Decode(arr->data[index]);
 }
 
 /**
@@ -1560,6 +2407,7 @@ jobject NI_GetObjectArrayElement(jobjectArray array, jsize index) {
  * @throws ArrayIndexOutOfBoundsException: if index does not specify a valid index in the array.
  * @throws ArrayStoreException: if the class of value is not assignment compatible with the component
  * class of the array.
+ * @throws IllegalStateException: with #BVM_SCOPED_MEMORY_ENABLE, if value would outlive its scope.
  */
 jint NI_SetObjectArrayElement(jobjectArray array, jsize index, jobject val) {
 
@@ -1577,7 +2425,16 @@ jint NI_SetObjectArrayElement(jobjectArray array, jsize index, jobject val) {
 		return NI_ERR;
 	}
 
-	arr->data[index] = val;
+#if BVM_SCOPED_MEMORY_ENABLE
+	/* a scoped object may not be stored where it may outlive its scope */
+	if (BVM_SCOPE_IsEscape(arr, val)) {
+		bvm_gl_thread_current->pending_exception = bvm_create_exception_c(BVM_ERR_ILLEGAL_STATE_EXCEPTION, NULL);
+		return NI_ERR;
+	}
+#endif
+
+	arr->data[index] = BVM_REF_Encode((bvm_obj_t *) val);
+	BVM_GC_WRITE_BARRIER(arr, val);
 
 	return NI_OK;
 }
@@ -1854,6 +2711,65 @@ jdouble *NI_GetDoubleArrayElements(jdoubleArray array) {
 
 #endif
 
+#if BVM_GC_COMPACTION_ENABLE
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_ni_critical_count = 0;
+#endif
+
+/**
+ * Returns a pointer to the first element of the raw data of the given primitive array and holds the array in place
+ * until a matching #NI_ReleasePrimitiveArrayCritical.  The data is never copied - the pointer is to the array itself.
+ *
+ * Between the get and the release the array will not be moved by a heap compaction (see #BVM_GC_COMPACTION_ENABLE).
+ * Calls may be nested and may be made for more than one array at a time, but each must be released.  As no
+ * compaction is done while any array is held, developers should release an array as soon as they are done with it.
+ *
+ * @param array the primitive array to get a handle to the data of.
+ * @param isCopy if not \c NULL, set to \c BVM_FALSE - the data is never a copy.
+ *
+ * @return a pointer to the array data.
+ *
+ * @throws none.
+ */
+void *NI_GetPrimitiveArrayCritical(jarray array, jboolean *isCopy) {
+
+	bvm_jtype_t jtype = ((bvm_jarray_obj_t *) array)->clazz->component_jtype;
+
+	if (isCopy != NULL) *isCopy = BVM_FALSE;
+
+#if BVM_GC_COMPACTION_ENABLE
+	bvm_gl_ni_critical_count++;
+#endif
+
+	/* the eight byte types may have their data aligned further along */
+	if (jtype == BVM_T_LONG) return ((bvm_jlong_array_obj_t *) array)->data;
+#if BVM_FLOAT_ENABLE
+	if (jtype == BVM_T_DOUBLE) return ((bvm_jdouble_array_obj_t *) array)->data;
+#endif
+
+	return ((bvm_jbyte_array_obj_t *) array)->data;
+}
+
+/**
+ * Releases an array held by #NI_GetPrimitiveArrayCritical.  As the data given out is never a copy there is nothing
+ * to copy back or free - changes made through the pointer are already in the array, whatever the mode.
+ *
+ * @param array the primitive array given to #NI_GetPrimitiveArrayCritical.
+ * @param carray the pointer returned by #NI_GetPrimitiveArrayCritical.
+ * @param mode \c 0, #NI_COMMIT or #NI_ABORT.  Ignored.
+ *
+ * @throws none.
+ */
+void NI_ReleasePrimitiveArrayCritical(jarray array, void *carray, jint mode) {
+
+	UNUSED(array);
+	UNUSED(carray);
+	UNUSED(mode);
+
+#if BVM_GC_COMPACTION_ENABLE
+	if (bvm_gl_ni_critical_count > 0) bvm_gl_ni_critical_count--;
+#endif
+}
+
 /*********************************************************************************************
  **  Memory management functions
  *********************************************************************************************/
@@ -1874,6 +2790,9 @@ jdouble *NI_GetDoubleArrayElements(jdoubleArray array) {
  *
  * Memory returned by this function is not zeroed or initialised in any way.
  *
+ * If #BVM_NI_LOCAL_ARENA_ENABLE is set the memory is bumped from the arena of the current native method execution and
+ * is freed with it when the native method returns.  #NI_Free of it is harmless but has no effect.
+ *
  * @param size the amount of memory (in bytes) to allocate.
  *
  * @return a void pointer handle to allocated memory or \ c NULL if an error occurs.  Returns \c NULL if and
@@ -1885,14 +2804,60 @@ void *NI_MallocLocal(jint size) {
 
 	void *ptr = NULL;
 
+#if BVM_NI_LOCAL_ARENA_ENABLE
+
+	bvm_uint32_t aligned_size = (size + BVM_CHUNK_ALIGN_MASK) & ~BVM_CHUNK_ALIGN_MASK;
+	bvm_ni_arena_t *arena = bvm_gl_ni_arena;
+
+	/* bump from the newest block if it has room */
+	if ( (arena != NULL) && ( (bvm_uint32_t) (arena->end - arena->top) >= aligned_size) ) {
+		ptr = arena->top;
+		arena->top += aligned_size;
+		return ptr;
+	}
+
+	BVM_TRY {
+
+		/* a large request gets a block of its own */
+		bvm_uint32_t block_size = (aligned_size > (BVM_NI_LOCAL_ARENA_BLOCK_SIZE / 4)) ? aligned_size : BVM_NI_LOCAL_ARENA_BLOCK_SIZE;
+		bvm_uint32_t header_size = (sizeof(bvm_ni_arena_t) + BVM_CHUNK_ALIGN_MASK) & ~BVM_CHUNK_ALIGN_MASK;
+
+		arena = bvm_heap_alloc(header_size + block_size, BVM_ALLOC_TYPE_DATA);
+
+		arena->top = ((bvm_uint8_t *) arena) + header_size;
+		arena->end = arena->top + block_size;
+
+		arena->prev = bvm_gl_ni_arena;
+		bvm_gl_ni_arena = arena;
+
+		ptr = arena->top;
+		arena->top += aligned_size;
+
+	} BVM_CATCH(e) {
+		bvm_gl_thread_current->pending_exception = e;
+		ptr = NULL;
+	} BVM_END_CATCH;
+
+	/* the catch resets the transient roots, so the new block is made one after it */
+	if (ptr != NULL) {
+		BVM_MAKE_TRANSIENT_ROOT(bvm_gl_ni_arena);
+	}
+
+#else
+
 	BVM_TRY {
 		ptr = bvm_heap_alloc(size, BVM_ALLOC_TYPE_DATA);
-		BVM_MAKE_TRANSIENT_ROOT(ptr);
 	} BVM_CATCH(e) {
 		bvm_gl_thread_current->pending_exception = e;
 		ptr = NULL;
 	} BVM_END_CATCH;
 
+	if (ptr != NULL) {
+		BVM_MAKE_TRANSIENT_ROOT(ptr);
+	}
+
+#endif
+
 	return ptr;
 }
 
@@ -1943,9 +2908,41 @@ void *NI_MallocGlobal(jint size) {
  * @throws none.
  */
 void NI_Free(void *handle) {
+
+#if BVM_NI_LOCAL_ARENA_ENABLE
+	bvm_ni_arena_t *arena = bvm_gl_ni_arena;
+
+	/* local memory is freed with the rest of its arena when the native method returns */
+	while (arena != NULL) {
+		if ( ((bvm_uint8_t *) handle > (bvm_uint8_t *) arena) && ((bvm_uint8_t *) handle < arena->end) ) return;
+		arena = arena->prev;
+	}
+#endif
+
 	bvm_heap_free(handle);
 }
 
+#if BVM_NI_LOCAL_ARENA_ENABLE
+
+BVM_VM_LOCAL bvm_ni_arena_t *bvm_gl_ni_arena = NULL;
+
+/**
+ * Free the blocks of the #NI_MallocLocal arena newer than a given block.  Called by the interpreter when a native
+ * method returns, or throws, with the block that was newest before it was called.
+ *
+ * @param mark the newest block to keep, or \c NULL to free them all.
+ */
+void bvm_ni_arena_release(bvm_ni_arena_t *mark) {
+
+	while (bvm_gl_ni_arena != mark) {
+		bvm_ni_arena_t *prev = bvm_gl_ni_arena->prev;
+		bvm_heap_free(bvm_gl_ni_arena);
+		bvm_gl_ni_arena = prev;
+	}
+}
+
+#endif
+
 #if BVM_FLOAT_ENABLE
 // some special handling for getting a double param.  It is a long, then cast as the value of the
 // same memory space.
@@ -28,60 +28,42 @@
 
  */
 
-#if 0
-/**
- * Hash function.  Refer "http://www.burtleburtle.net/bob/hash/doobs.html".
- * Differs only in that no mask is supplied.
- */
-bvm_uint32_t bvm_calchash(bvm_uint8_t *key, bvm_uint16_t len) {
-	bvm_uint32_t hash, i;
-	for (hash=0, i=len; i--;) {
-		hash += key[i];
-		hash += (hash << 10);
-		hash ^= (hash >> 6);
-	}
-	hash += (hash << 3);
-	hash ^= (hash >> 11);
-	hash += (hash << 15);
-	return hash;
-}
-
-bvm_uint32_t calchash2(bvm_uint8_t *key, bvm_uint16_t len) {
-
-	bvm_uint32_t value, i;
-
-	i = len;
-
-	value = 0;
-	while (i--)
-		value += *key++;
-
-	value = (value << 6) + len;
-
-	return value;
-}
-
-
-bvm_uint32_t bvm_calchash(bvm_uint8_t *key, bvm_uint16_t len)
-{
-	bvm_uint32_t hash = 0;
-    while (len--) {
-        int c = *key++;
-        hash = (((hash << 3) + hash)  << 2) + hash  + c;
-    }
-    return hash;
-}
-
-#endif
-
 /**
  * Handle to a pre-built out-of-memory exception object.  Gets its value during VM initialisation. We do not create it
  * during memory allocation - difficult to create an "out of memory" object when there is no memory!
  */
-bvm_throwable_obj_t *bvm_gl_out_of_memory_err_obj = NULL;
+BVM_VM_LOCAL bvm_throwable_obj_t *bvm_gl_out_of_memory_err_obj = NULL;
+
+/* the array type information and quick access handles declared in object.h */
+BVM_VM_LOCAL bvm_array_typeinfo_t bvm_gl_type_array_info[12];
+BVM_VM_LOCAL bvm_instance_clazz_t *BVM_OBJECT_CLAZZ;
+BVM_VM_LOCAL bvm_instance_clazz_t *BVM_CLASS_CLAZZ;
+BVM_VM_LOCAL bvm_instance_clazz_t *BVM_THREAD_CLAZZ;
+BVM_VM_LOCAL bvm_instance_clazz_t *BVM_CLASSLOADER_CLAZZ;
+BVM_VM_LOCAL bvm_instance_clazz_t *BVM_STRING_CLAZZ;
+BVM_VM_LOCAL bvm_instance_clazz_t *BVM_SYSTEM_CLAZZ;
+BVM_VM_LOCAL bvm_instance_clazz_t *BVM_THROWABLE_CLAZZ;
+BVM_VM_LOCAL bvm_classloader_obj_t *BVM_BOOTSTRAP_CLASSLOADER_OBJ;
+BVM_VM_LOCAL bvm_instance_array_obj_t *BVM_BOOTSTRAP_CLASSPATH_ARRAY;
+BVM_VM_LOCAL bvm_classloader_obj_t *BVM_SYSTEM_CLASSLOADER_OBJ;
+
+/** Rotate a 32 bit value left */
+#define OBJECT_ROTL32(x, r) ( ((x) << (r)) | ((x) >> (32 - (r))) )
+
+/** Mix a four byte block into a hash */
+#define OBJECT_HASH_MIX(h, k) {					\
+	(k) *= 0xcc9e2d51;							\
+	(k) = OBJECT_ROTL32((k), 15);				\
+	(k) *= 0x1b873593;							\
+	(h) ^= (k);									\
+}
 
 /**
- * Calculate a hash of a given range of bytes.
+ * Calculate a hash of a given range of bytes.  This is the 32 bit MurmurHash3 - the bytes are taken four at a time
+ * and the result is well distributed in all its bits, so it may be masked or taken modulo any bucket count.  The
+ * hash of the same bytes may differ between platforms of different byte order - it must not be saved.
+ *
+ * Used for all the VM pools, jar directories and classpath indexes.
  *
  * @param key a pointer to an array of bytes to calculate a hash on.
  * @param len the length of the array of bytes used in the hash calculation.
@@ -90,12 +72,33 @@ bvm_throwable_obj_t *bvm_gl_out_of_memory_err_obj = NULL;
  */
 bvm_uint32_t bvm_calchash(bvm_uint8_t *key, bvm_uint16_t len) {
 
-	bvm_uint32_t hash = 0;
-	bvm_uint16_t i = 0;
-	while (len--) {
-	    hash = 31*hash + key[i++];
+	bvm_uint32_t hash = len;
+	bvm_uint32_t k;
+	bvm_uint16_t blocks = len >> 2;
+
+	while (blocks--) {
+		memcpy(&k, key, 4);
+		key += 4;
+		OBJECT_HASH_MIX(hash, k);
+		hash = OBJECT_ROTL32(hash, 13);
+		hash = hash * 5 + 0xe6546b64;
 	}
 
+	/* the last one to three bytes */
+	if (len & 3) {
+		k = key[0];
+		if ((len & 3) > 1) k |= (bvm_uint32_t) key[1] << 8;
+		if ((len & 3) > 2) k |= (bvm_uint32_t) key[2] << 16;
+		OBJECT_HASH_MIX(hash, k);
+	}
+
+	/* avalanche the bits */
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	hash ^= hash >> 16;
+
 	return hash;
 }
 
@@ -116,10 +119,8 @@ bvm_obj_t *bvm_object_alloc(bvm_instance_clazz_t *clazz) {
 	bvm_obj_t *obj;
 
 	/* how many bytes storage required for object?  The size of an object is the size of
-	 * a clazz pointer + the fields - each field is contained in a bvm_cell_t).
-	 * The clazz pointer is also the size of a cell, so our memory requirement equals
-	 * "nr of fields + 1 * size of a cell" */
-	size = ( (clazz->instance_fields_count + 1 ) * sizeof(bvm_cell_t));
+	 * its header + the fields - each field is contained in a bvm_cell_t). */
+	size = (bvm_int32_t) BVM_OBJECT_SIZE(clazz);
 
     /* get the memory (zeroed). We'll check if it is a string here - hopefully (given the number of strings
      * Java programs create, this will ease the GC a bit as the GC specifically looks for BVM_ALLOC_TYPE_STRING
@@ -129,20 +130,20 @@ bvm_obj_t *bvm_object_alloc(bvm_instance_clazz_t *clazz) {
 	/* set the class of the new object */
 	obj->clazz = (bvm_clazz_t *) clazz;
 
+	BVM_PROFILER_COUNT_ALLOCATION();
+
 	return obj;
 }
 
 /**
- * Create a primitive array object of the given size and component type.
+ * The size in bytes of the memory of a primitive array - see #bvm_object_alloc_array_primitive.
  *
  * @param length the array length
  * @param type the primitive type of the array
  *
- * @return a new array object
+ * @return the size of the array
  */
-bvm_jarray_obj_t *bvm_object_alloc_array_primitive(bvm_uint32_t length, bvm_jtype_t type) {
-
-	bvm_jarray_obj_t *array_obj;
+bvm_uint32_t bvm_object_primitive_array_size(bvm_uint32_t length, bvm_jtype_t type) {
 
 	/* the actual size of the array memory to allocate is the size of the object array struct + the requested
 	* length less one.  Why?  Well, the array object structures are all the 'array_obj_t' structures and they
@@ -157,14 +158,6 @@ bvm_jarray_obj_t *bvm_object_alloc_array_primitive(bvm_uint32_t length, bvm_jtyp
 	int element_size = bvm_gl_type_array_info[type].element_size;
 	int array_struct_size = 0; /*= (type == BVM_T_LONG) ? sizeof(bvm_jlong_array_obj_t) - sizeof(bvm_int64_t) : sizeof(bvm_jarray_obj_t);*/
 
-	/* overflow protection for size calculation below.  If a very large length number is specified
-	* for the array, the size calculation could trip up and overflow - nasty.  This trap limits
-	* the length of the array to stop overflow, but the limit is still stupidly large for this
-	* small VM. */
-	if (length > 0x1000000) {
-		BVM_THROW(bvm_gl_out_of_memory_err_obj)
-	}
-
 	switch(type) {
 	 case(BVM_T_BOOLEAN):
 		 array_struct_size = sizeof(bvm_jboolean_array_obj_t);
@@ -203,41 +196,53 @@ bvm_jarray_obj_t *bvm_object_alloc_array_primitive(bvm_uint32_t length, bvm_jtyp
 		 break;
 	}
 
+	return array_struct_size + (element_size * (length-1) );
+}
+
+/**
+ * Create a primitive array object of the given size and component type.
+ *
+ * @param length the array length
+ * @param type the primitive type of the array
+ *
+ * @return a new array object
+ */
+bvm_jarray_obj_t *bvm_object_alloc_array_primitive(bvm_uint32_t length, bvm_jtype_t type) {
+
+	bvm_jarray_obj_t *array_obj;
+
+	/* overflow protection for size calculation below.  If a very large length number is specified
+	* for the array, the size calculation could trip up and overflow - nasty.  This trap limits
+	* the length of the array to stop overflow, but the limit is still stupidly large for this
+	* small VM. */
+	if (length > 0x1000000) {
+		BVM_THROW(bvm_gl_out_of_memory_err_obj)
+	}
+
     /* alloc the memory for the array */
-	array_obj = bvm_heap_calloc(array_struct_size + (element_size * (length-1) ), BVM_ALLOC_TYPE_ARRAY_OF_PRIMITIVE);
+	array_obj = bvm_heap_calloc(bvm_object_primitive_array_size(length, type), BVM_ALLOC_TYPE_ARRAY_OF_PRIMITIVE);
 
 	array_obj->clazz  = bvm_gl_type_array_info[type].primitive_array_clazz;
 	array_obj->length.int_value = length;
 
+	BVM_PROFILER_COUNT_ALLOCATION();
+
 	return array_obj;
 }
 
 /**
- * Create an object array given a length and reference component type.
+ * Get the array clazz of arrays of a given reference component type, loading it if need be.
  *
- * @param length the length of the new array
  * @param component_clazz the component type #bvm_clazz_t
  *
- * @return a new array object
+ * @return the array clazz
  */
-bvm_instance_array_obj_t *bvm_object_alloc_array_reference(bvm_uint32_t length, bvm_clazz_t *component_clazz) {
+bvm_array_clazz_t *bvm_object_array_clazz(bvm_clazz_t *component_clazz) {
 
-	bvm_uint32_t size;
-	bvm_instance_array_obj_t *array_obj;
 	bvm_array_clazz_t *array_clazz;
 	bvm_utfstring_t *component_clazz_name = component_clazz->name;
 	char *array_clazz_name = NULL;
 
-	/* overflow protection for size calculation below.  If a very large length number is specified
-	* for the array, the size calculation could trip up and overflow - nasty.  This trap limits
-	* the length of the array to stop overflow, but the limit is still stupidly large */
-	if (length > 0x1000000) {
-		BVM_THROW(bvm_gl_out_of_memory_err_obj)
-	}
-
-	/* size of instance + array length + the actual data */
-	size = sizeof(bvm_jarray_obj_t) + (sizeof(void *) * length);
-
 	/* a bit of string manipulation to create an array class name like '[Lxx/xx/xx;'
 	 * so that we get the correct array calls.  Note that the class name
 	 * specified for the array may actually *already* be an array type class
@@ -269,15 +274,151 @@ bvm_instance_array_obj_t *bvm_object_alloc_array_reference(bvm_uint32_t length,
 	/* free up the temp memory used for the class name */
 	bvm_heap_free(array_clazz_name);
 
+	return array_clazz;
+}
+
+/**
+ * Create an object array given a length and reference component type.
+ *
+ * @param length the length of the new array
+ * @param component_clazz the component type #bvm_clazz_t
+ *
+ * @return a new array object
+ */
+bvm_instance_array_obj_t *bvm_object_alloc_array_reference(bvm_uint32_t length, bvm_clazz_t *component_clazz) {
+
+	bvm_uint32_t size;
+	bvm_instance_array_obj_t *array_obj;
+	bvm_array_clazz_t *array_clazz;
+
+	/* overflow protection for size calculation below.  If a very large length number is specified
+	* for the array, the size calculation could trip up and overflow - nasty.  This trap limits
+	* the length of the array to stop overflow, but the limit is still stupidly large */
+	if (length > 0x1000000) {
+		BVM_THROW(bvm_gl_out_of_memory_err_obj)
+	}
+
+	/* size of instance + array length + the actual data */
+	size = sizeof(bvm_jarray_obj_t) + (sizeof(bvm_ref_t) * length);
+
+	array_clazz = bvm_object_array_clazz(component_clazz);
+
     /* get the zero-filled memory for the object array */
     array_obj = bvm_heap_calloc(size, BVM_ALLOC_TYPE_ARRAY_OF_OBJECT);
 
 	array_obj->clazz = array_clazz;
 	array_obj->length.int_value = length;
 
+	BVM_PROFILER_COUNT_ALLOCATION();
+
 	return array_obj;
 }
 
+#if BVM_OBJECT_MULTI_ARRAY_CONTIGUOUS_ENABLE
+
+/** The number of heap bytes a chunk with the given user size takes */
+static bvm_uint32_t object_chunk_size(bvm_uint32_t size) {
+	size = (bvm_uint32_t) BVM_CHUNK_AlignedSize(size);
+	return (size < BVM_CHUNK_MIN_ALLOC_SIZE) ? (bvm_uint32_t) BVM_CHUNK_MIN_ALLOC_SIZE : size;
+}
+
+/**
+ * Works out the number of heap bytes a multi-dimensional array and all its sub-arrays take.  Lengths are checked as
+ * they would be by #bvm_object_alloc_array_multi.
+ *
+ * @param clazz the #bvm_array_clazz_t of the array
+ * @param dimensions the number of dimensions of the array
+ * @param lengths an array of integer lengths - one for each array dimension
+ *
+ * @return the number of bytes, or zero if it is more than #BVM_OBJECT_MULTI_ARRAY_CONTIGUOUS_MAX_SIZE.
+ */
+static bvm_uint32_t object_multi_array_size(bvm_array_clazz_t *clazz, int dimensions, bvm_native_long_t lengths[]) {
+
+	bvm_int32_t length = (bvm_int32_t) lengths[0];
+	bvm_jtype_t component_type = clazz->component_jtype;
+	bvm_uint32_t size, subsize;
+
+	if (length < 0) bvm_throw_exception(BVM_ERR_NEGATIVE_ARRAY_SIZE_EXCEPTION, NULL);
+
+	if (length > 0x1000000) {
+		BVM_THROW(bvm_gl_out_of_memory_err_obj)
+	}
+
+	size = object_chunk_size( (component_type > BVM_T_ARRAY) ?
+			bvm_object_primitive_array_size(length, component_type) :
+			sizeof(bvm_jarray_obj_t) + (sizeof(bvm_ref_t) * length) );
+
+	if (size > BVM_OBJECT_MULTI_ARRAY_CONTIGUOUS_MAX_SIZE) return 0;
+
+	if ( (component_type == BVM_T_ARRAY) && (dimensions > 1) && (length > 0) ) {
+
+		/* rectangular, so every sub-array is the same size */
+		subsize = object_multi_array_size( (bvm_array_clazz_t *) clazz->component_clazz, dimensions - 1, &lengths[1]);
+
+		if ( (subsize == 0) || (subsize > (BVM_OBJECT_MULTI_ARRAY_CONTIGUOUS_MAX_SIZE - size) / length) ) return 0;
+
+		size += subsize * length;
+	}
+
+	return size;
+}
+
+/**
+ * Carves a multi-dimensional array and all its sub-arrays from heap memory, the array first and then each sub-array
+ * in index order with its own sub-arrays after it.  Each is split off as a chunk of its own.
+ *
+ * @param clazz the #bvm_array_clazz_t of the array
+ * @param dimensions the number of dimensions of the array
+ * @param lengths an array of integer lengths - one for each array dimension
+ * @param ptr the memory to carve the array from.  On return, the memory left after it.
+ * @param remaining the number of heap bytes left to carve.  On return, less those the array took.
+ *
+ * @return the array.
+ */
+static bvm_instance_array_obj_t *object_multi_array_carve(bvm_array_clazz_t *clazz, int dimensions, bvm_native_long_t lengths[],
+														   void **ptr, bvm_uint32_t *remaining) {
+
+	bvm_instance_array_obj_t *array_obj = *ptr;
+	bvm_chunk_t *chunk = BVM_CHUNK_GetPointerChunk(array_obj);
+	bvm_int32_t length = (bvm_int32_t) lengths[0];
+	bvm_jtype_t component_type = clazz->component_jtype;
+	bvm_uint32_t size;
+	bvm_int32_t lc;
+
+	if (component_type > BVM_T_ARRAY) {
+		size = bvm_object_primitive_array_size(length, component_type);
+		BVM_CHUNK_SetAllocType(chunk, BVM_ALLOC_TYPE_ARRAY_OF_PRIMITIVE);
+	} else {
+		size = sizeof(bvm_jarray_obj_t) + (sizeof(bvm_ref_t) * length);
+	}
+
+	/* zeroed a piece at a time while it is in the cache, rather than the whole lot up front */
+	memset(array_obj, 0, size);
+	array_obj->clazz = (component_type > BVM_T_ARRAY) ? bvm_gl_type_array_info[component_type].primitive_array_clazz : clazz;
+	array_obj->length.int_value = length;
+
+	BVM_PROFILER_COUNT_ALLOCATION();
+
+	/* the last array keeps whatever is left */
+	size = object_chunk_size(size);
+	*remaining -= size;
+	if (*remaining != 0) {
+		BVM_CHUNK_Split(chunk, size, BVM_ALLOC_TYPE_ARRAY_OF_OBJECT);
+		*ptr = BVM_CHUNK_GetUserData(BVM_CHUNK_GetNextChunk(chunk));
+	}
+
+	if ( (component_type == BVM_T_ARRAY) && (dimensions > 1) ) {
+		for (lc = 0; lc < length; lc++) {
+			array_obj->data[lc] = BVM_REF_Encode((bvm_obj_t *)
+				object_multi_array_carve( (bvm_array_clazz_t *) clazz->component_clazz, dimensions - 1, &lengths[1], ptr, remaining));
+		}
+	}
+
+	return array_obj;
+}
+
+#endif
+
 /**
  * Recursive creation of a multi-dimensional array from the stack.  Support code
  * for #OPCODE_multianewarray.
@@ -308,6 +449,22 @@ bvm_instance_array_obj_t *bvm_object_alloc_array_multi(bvm_array_clazz_t *clazz,
 	bvm_int32_t length;
 	bvm_jtype_t component_type;
 
+#if BVM_OBJECT_MULTI_ARRAY_CONTIGUOUS_ENABLE
+
+	/* if the whole array is small enough it is allocated in one go and carved up.  Otherwise each sub-array is
+	 * allocated by the recursion below - and may itself be small enough to be carved. */
+	if ( (dimensions > 1) && (clazz->component_jtype == BVM_T_ARRAY) ) {
+
+		bvm_uint32_t size = object_multi_array_size(clazz, dimensions, lengths);
+
+		if (size != 0) {
+			void *ptr = bvm_heap_alloc(size - BVM_CHUNK_OVERHEAD, BVM_ALLOC_TYPE_ARRAY_OF_OBJECT);
+			return object_multi_array_carve(clazz, dimensions, lengths, &ptr, &size);
+		}
+	}
+
+#endif
+
 	/* the length of this array */
 	length = lengths[0];
 
@@ -337,7 +494,7 @@ bvm_instance_array_obj_t *bvm_object_alloc_array_multi(bvm_array_clazz_t *clazz,
 			for (lc = length; lc--;) {
 				/* create the subarray and put it into the current-dimension array */
 				array_obj->data[lc] =
-					(bvm_obj_t *) bvm_object_alloc_array_multi( (bvm_array_clazz_t *) clazz->component_clazz, subdims, sublengths);
+					BVM_REF_Encode((bvm_obj_t *) bvm_object_alloc_array_multi( (bvm_array_clazz_t *) clazz->component_clazz, subdims, sublengths));
 			}
 
 		} BVM_END_TRANSIENT_BLOCK
@@ -346,3 +503,360 @@ bvm_instance_array_obj_t *bvm_object_alloc_array_multi(bvm_array_clazz_t *clazz,
 	return array_obj;
 }
 
+
+/**
+ * Create a shallow copy of an object or array.  The copy is not locked, whatever the state of the original.
+ *
+ * @param obj the object to copy.
+ *
+ * @return a new object.
+ */
+bvm_obj_t *bvm_object_clone(bvm_obj_t *obj) {
+
+	bvm_obj_t *new_obj;
+
+#if BVM_SCOPED_MEMORY_ENABLE
+	/* a copy made in a scope may hold references to objects in the scope, so it is made there too */
+	if (BVM_SCOPE_IsAllocating()) return bvm_scope_clone(obj);
+#endif
+
+	new_obj = bvm_heap_clone(obj);
+
+#if BVM_THIN_LOCK_ENABLE
+	BVM_OBJECT_SetLockword(new_obj, 0);
+#endif
+
+	return new_obj;
+}
+
+#if BVM_OBJECT_IDENTITY_HASH_ENABLE
+
+/** Mix the bits of an address into a 32 bit hash.  Chunks are aligned, so the low bits are shifted away first. */
+static bvm_uint32_t object_address_hash(void *ptr) {
+	bvm_uint32_t hash = (bvm_uint32_t) ((bvm_native_ulong_t) ptr >> 3) * 2654435761u;
+	return hash ^ (hash >> 16);
+}
+
+#if BVM_GC_COMPACTION_ENABLE
+
+/**
+ * An array that has been given an identity hash, and the hash it was given.
+ */
+typedef struct _bvmobjecthashstruct {
+
+	/** the array, or \c NULL for an empty slot */
+	void *ptr;
+
+	/** its identity hash */
+	bvm_uint32_t hash;
+
+} object_hash_t;
+
+/** The number of arrays in #object_hashes */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_object_hash_count = 0;
+
+/** An open addressed hash table of the arrays that have been given an identity hash - allocated on first use */
+static BVM_VM_LOCAL object_hash_t *object_hashes = NULL;
+
+/** A second table of the same size as #object_hashes, kept so that compaction can always rehash into it */
+static BVM_VM_LOCAL object_hash_t *object_hashes_spare = NULL;
+
+/** The number of slots in #object_hashes.  Always a power of two. */
+static BVM_VM_LOCAL bvm_uint32_t object_hashes_size = 0;
+
+/** The home slot of an array in #object_hashes */
+#define OBJECT_HASH_SLOT(p) (object_address_hash(p) & (object_hashes_size - 1))
+
+/**
+ * Add an array and its hash to #object_hashes.  There must be room.
+ */
+static void object_hash_put(void *ptr, bvm_uint32_t hash) {
+
+	bvm_uint32_t i;
+
+	for (i = OBJECT_HASH_SLOT(ptr); object_hashes[i].ptr != NULL; i = (i + 1) & (object_hashes_size - 1)) {}
+
+	object_hashes[i].ptr = ptr;
+	object_hashes[i].hash = hash;
+	bvm_gl_object_hash_count++;
+}
+
+/**
+ * Find the slot of an array in #object_hashes.
+ *
+ * @param ptr - the array.
+ * @return its slot, or -1 if it is not there.
+ */
+static bvm_int32_t object_hash_find(void *ptr) {
+
+	bvm_uint32_t i;
+
+	if (object_hashes == NULL) return -1;
+
+	for (i = OBJECT_HASH_SLOT(ptr); object_hashes[i].ptr != NULL; i = (i + 1) & (object_hashes_size - 1)) {
+		if (object_hashes[i].ptr == ptr) return (bvm_int32_t) i;
+	}
+
+	return -1;
+}
+
+/**
+ * Put each array of a table back into #object_hashes, which must be empty and big enough.  If each array is also being
+ * moved it is put back at its new address.
+ *
+ * @param old_hashes - the table the arrays are in.
+ * @param old_size - the number of slots in it.
+ * @param forward - gives the new address of an array, or \c NULL if none are being moved.
+ */
+static void object_hash_refill(object_hash_t *old_hashes, bvm_uint32_t old_size, bvm_obj_t *(*forward)(bvm_obj_t *)) {
+
+	bvm_uint32_t i;
+
+	bvm_gl_object_hash_count = 0;
+
+	for (i = 0; i < old_size; i++) {
+		if (old_hashes[i].ptr != NULL)
+			object_hash_put( (forward != NULL) ? forward(old_hashes[i].ptr) : old_hashes[i].ptr, old_hashes[i].hash);
+	}
+}
+
+/**
+ * Give #object_hashes a new number of slots and put each array back into it.  The spare table is allocated at the new
+ * size along with it, so that #bvm_object_hash_forward never needs memory.
+ *
+ * @param size - the new number of slots.
+ *
+ * @return #BVM_FALSE if there was no memory for the new tables - the old ones are kept as they were.
+ */
+static bvm_bool_t object_hash_grow(bvm_uint32_t size) {
+
+	object_hash_t *new_hashes = bvm_pd_memory_alloc(size * sizeof(object_hash_t));
+	object_hash_t *new_spare = bvm_pd_memory_alloc(size * sizeof(object_hash_t));
+
+	if ( (new_hashes == NULL) || (new_spare == NULL) ) {
+		if (new_hashes != NULL) bvm_pd_memory_free(new_hashes);
+		if (new_spare != NULL) bvm_pd_memory_free(new_spare);
+		return BVM_FALSE;
+	}
+
+	memset(new_hashes, 0, size * sizeof(object_hash_t));
+
+	if (object_hashes != NULL) {
+
+		object_hash_t *old_hashes = object_hashes;
+		bvm_uint32_t old_size = object_hashes_size;
+
+		object_hashes = new_hashes;
+		object_hashes_size = size;
+		object_hash_refill(old_hashes, old_size, NULL);
+
+		bvm_pd_memory_free(old_hashes);
+		bvm_pd_memory_free(object_hashes_spare);
+	} else {
+		object_hashes = new_hashes;
+		object_hashes_size = size;
+	}
+
+	object_hashes_spare = new_spare;
+
+	return BVM_TRUE;
+}
+
+/**
+ * Forget the identity hash of an array as its memory is freed.  The entries after it in the same run of the table are
+ * moved back so that no lookup stops short of them.
+ *
+ * @param ptr - the address of the user data of the freed chunk.
+ */
+void bvm_object_hash_freed(void *ptr) {
+
+	bvm_int32_t found = object_hash_find(ptr);
+	bvm_uint32_t i, j;
+
+	if (found < 0) return;
+
+	i = j = (bvm_uint32_t) found;
+
+	while (BVM_TRUE) {
+
+		bvm_uint32_t home;
+
+		j = (j + 1) & (object_hashes_size - 1);
+
+		if (object_hashes[j].ptr == NULL) break;
+
+		home = OBJECT_HASH_SLOT(object_hashes[j].ptr);
+
+		/* an entry whose home slot is cyclically after the gap and up to itself stays where it is */
+		if ( (i <= j) ? ( (i < home) && (home <= j) ) : ( (i < home) || (home <= j) ) ) continue;
+
+		object_hashes[i] = object_hashes[j];
+		i = j;
+	}
+
+	object_hashes[i].ptr = NULL;
+	bvm_gl_object_hash_count--;
+}
+
+/**
+ * Give each array that has an identity hash the address it is being moved to by heap compaction.  The hash given to
+ * each goes with it.  The arrays are rehashed at their new addresses into the spare table, which then becomes the
+ * table, so this needs no memory and cannot fail.
+ *
+ * @param forward - gives the new address of an array.
+ */
+void bvm_object_hash_forward(bvm_obj_t *(*forward)(bvm_obj_t *)) {
+
+	object_hash_t *old_hashes = object_hashes;
+
+	if (bvm_gl_object_hash_count == 0) return;
+
+	memset(object_hashes_spare, 0, object_hashes_size * sizeof(object_hash_t));
+
+	object_hashes = object_hashes_spare;
+	object_hashes_spare = old_hashes;
+
+	object_hash_refill(old_hashes, object_hashes_size, forward);
+}
+
+/**
+ * Free the tables of arrays that have an identity hash.  Only called as the VM exits.
+ */
+void bvm_object_hash_release() {
+
+	if (object_hashes != NULL) bvm_pd_memory_free(object_hashes);
+	if (object_hashes_spare != NULL) bvm_pd_memory_free(object_hashes_spare);
+
+	object_hashes = NULL;
+	object_hashes_spare = NULL;
+	object_hashes_size = 0;
+	bvm_gl_object_hash_count = 0;
+}
+
+#endif
+
+/**
+ * Give the identity hash code of an object - as returned by \c Object.hashCode and \c System.identityHashCode.  It is
+ * made from the address of the object, with the bits mixed so that objects that are close together in the heap do not
+ * all have hashes that differ just in their top bits.
+ *
+ * Only arrays are ever moved (by compaction - see #BVM_GC_COMPACTION_ENABLE).  When an array is first asked for its
+ * identity hash it is kept in a side table with the hash it was given, and the table follows the array when it is
+ * moved, so the hash of an array does not change either.  Other objects never need an entry.
+ *
+ * @param obj the object.  Must not be \c NULL.
+ *
+ * @return its identity hash code.
+ */
+bvm_uint32_t bvm_object_identity_hash(bvm_obj_t *obj) {
+
+#if BVM_GC_COMPACTION_ENABLE
+
+	bvm_int32_t found;
+	bvm_uint32_t hash;
+
+	if (!BVM_CLAZZ_IsArrayClazz(obj->clazz)) return object_address_hash(obj);
+
+	found = object_hash_find(obj);
+	if (found >= 0) return object_hashes[found].hash;
+
+	hash = object_address_hash(obj);
+
+	/* keep it no more than three quarters full.  With no memory to grow, the array just keeps its address hash - it
+	 * changes if the array is moved. */
+	if ( (bvm_gl_object_hash_count + 1) * 4 > object_hashes_size * 3) {
+		if (!object_hash_grow( (object_hashes_size == 0) ? BVM_OBJECT_IDENTITY_HASH_TABLE_SIZE : object_hashes_size * 2))
+			return hash;
+	}
+
+	object_hash_put(obj, hash);
+
+	return hash;
+#else
+	return object_address_hash(obj);
+#endif
+}
+
+#endif
+
+#if BVM_FIELD_PACKING_ENABLE
+
+/**
+ * Read the value of a packed field of an object into one cell, or two for a long or double, in the form the
+ * interpreter keeps it on the stack - see #BVM_FIELD_PACKING_ENABLE.
+ *
+ * @param obj the object.  Must not be \c NULL.
+ * @param field a packed field of the object's class.
+ * @param cells the cell (or cells) to put the value into.
+ */
+void bvm_object_get_packed_field(bvm_obj_t *obj, bvm_field_t *field, bvm_cell_t *cells) {
+
+	bvm_uint8_t *ptr = BVM_OBJECT_PACKED_FIELD(obj, field);
+
+	switch (field->packed_type) {
+		case 'J':
+		case 'D':
+			/* the two halves as they are in two cells */
+			cells[0].int_value = ((bvm_uint32_t *) ptr)[0];
+			cells[1].int_value = ((bvm_uint32_t *) ptr)[1];
+			break;
+#if BVM_FLOAT_ENABLE
+		case 'F':
+			cells[0].int_value = 0;
+			cells[0].float_value = *((bvm_float_t *) ptr);
+			break;
+#endif
+		case 'C':
+			cells[0].int_value = *((bvm_uint16_t *) ptr);
+			break;
+		case 'S':
+			cells[0].int_value = *((bvm_int16_t *) ptr);
+			break;
+		case 'B':
+			cells[0].int_value = *((bvm_int8_t *) ptr);
+			break;
+		case 'Z':
+			cells[0].int_value = *ptr;
+			break;
+		default:
+			cells[0].int_value = *((bvm_int32_t *) ptr);
+	}
+}
+
+/**
+ * Write the value of a packed field of an object from one cell, or two for a long or double, truncating it to the
+ * width of the field.
+ *
+ * @param obj the object.  Must not be \c NULL.
+ * @param field a packed field of the object's class.
+ * @param cells the cell (or cells) holding the value.
+ */
+void bvm_object_put_packed_field(bvm_obj_t *obj, bvm_field_t *field, bvm_cell_t *cells) {
+
+	bvm_uint8_t *ptr = BVM_OBJECT_PACKED_FIELD(obj, field);
+
+	switch (field->packed_type) {
+		case 'J':
+		case 'D':
+			((bvm_uint32_t *) ptr)[0] = (bvm_uint32_t) cells[0].int_value;
+			((bvm_uint32_t *) ptr)[1] = (bvm_uint32_t) cells[1].int_value;
+			break;
+#if BVM_FLOAT_ENABLE
+		case 'F':
+			*((bvm_float_t *) ptr) = cells[0].float_value;
+			break;
+#endif
+		case 'C':
+		case 'S':
+			*((bvm_uint16_t *) ptr) = (bvm_uint16_t) cells[0].int_value;
+			break;
+		case 'B':
+		case 'Z':
+			*ptr = (bvm_uint8_t) cells[0].int_value;
+			break;
+		default:
+			*((bvm_int32_t *) ptr) = (bvm_int32_t) cells[0].int_value;
+	}
+}
+
+#endif
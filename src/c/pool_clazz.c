@@ -32,12 +32,52 @@
 /**
  * An array of pointers to #bvm_clazz_t  - the class pool.
  */
-bvm_clazz_t **bvm_gl_clazz_pool = NULL;
+BVM_VM_LOCAL bvm_clazz_t **bvm_gl_clazz_pool = NULL;
 
 /**
  * Default clazz pool size
  */
-int bvm_gl_clazz_pool_bucketcount = BVM_CLAZZ_POOL_BUCKETCOUNT;
+BVM_VM_LOCAL int bvm_gl_clazz_pool_bucketcount = BVM_CLAZZ_POOL_BUCKETCOUNT;
+
+#if BVM_POOL_RESIZE_ENABLE
+
+/**
+ * The number of clazzes in the clazz pool.
+ */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_clazz_pool_count = 0;
+
+/**
+ * Double the number of hash buckets in the clazz pool and rehash its clazzes into them.  The clazzes stay in the
+ * old buckets until the new ones are allocated, so the pool is whole if the allocation GCs (or throws).
+ */
+static void clazz_pool_grow() {
+
+	int new_bucketcount = bvm_gl_clazz_pool_bucketcount * 2;
+	bvm_clazz_t **new_pool, **old_pool;
+	int i;
+
+	new_pool = bvm_heap_calloc(new_bucketcount * sizeof(bvm_clazz_t*), BVM_ALLOC_TYPE_METADATA);
+
+	for (i = bvm_gl_clazz_pool_bucketcount; i--;) {
+
+		bvm_clazz_t *clazz = bvm_gl_clazz_pool[i];
+
+		while (clazz != NULL) {
+			bvm_clazz_t *next = clazz->next;
+			bvm_uint32_t hash = BVM_UTFSTRING_HASH(clazz->name) % new_bucketcount;
+			clazz->next = new_pool[hash];
+			new_pool[hash] = clazz;
+			clazz = next;
+		}
+	}
+
+	old_pool = bvm_gl_clazz_pool;
+	bvm_gl_clazz_pool = new_pool;
+	bvm_gl_clazz_pool_bucketcount = new_bucketcount;
+	bvm_heap_free(old_pool);
+}
+
+#endif
 
 /**
  * Given a ClassLoader object and a class name, search the clazz pool for an already loaded
@@ -55,7 +95,7 @@ bvm_clazz_t *bvm_clazz_pool_get(bvm_classloader_obj_t *loader, bvm_utfstring_t *
 	bvm_clazz_t *pooled_clazz;
 	bvm_classloader_obj_t *search_loader;
 
-	hash = bvm_calchash(clazzname->data, clazzname->length) % bvm_gl_clazz_pool_bucketcount;
+	hash = BVM_UTFSTRING_HASH(clazzname) % bvm_gl_clazz_pool_bucketcount;
 	pooled_clazz = bvm_gl_clazz_pool[hash];
 
 	while (pooled_clazz != NULL) {
@@ -93,7 +133,7 @@ void bvm_clazz_pool_remove(bvm_clazz_t *clazz) {
 	bvm_uint32_t hash;
 	bvm_clazz_t *pooled_clazz, *prev_clazz;
 
-	hash = bvm_calchash(clazz->name->data, clazz->name->length) % bvm_gl_clazz_pool_bucketcount;
+	hash = BVM_UTFSTRING_HASH(clazz->name) % bvm_gl_clazz_pool_bucketcount;
 
 	prev_clazz = NULL;
 	pooled_clazz = bvm_gl_clazz_pool[hash];
@@ -109,6 +149,9 @@ void bvm_clazz_pool_remove(bvm_clazz_t *clazz) {
 				prev_clazz->next = pooled_clazz->next;
 			}
 
+#if BVM_POOL_RESIZE_ENABLE
+			bvm_gl_clazz_pool_count--;
+#endif
 			break;
 		}
 
@@ -130,6 +173,7 @@ bvm_clazz_t *clazz_pool_get_c(bvm_classloader_obj_t *loader, char *clazzname) {
 
 	bvm_utfstring_t str;
 	str.length = strlen(clazzname);
+	str.hash = 0;
 	str.data = (bvm_uint8_t *) clazzname;
 
 	return bvm_clazz_pool_get(loader, &str);
@@ -137,13 +181,18 @@ bvm_clazz_t *clazz_pool_get_c(bvm_classloader_obj_t *loader, char *clazzname) {
 
 /**
  * Add a clazz to the clazz pool.  No checking is performed to see if the clazz is already in
- * there.  It is just added.
+ * there.  It is just added.  The pool grows if it is now too full (see #BVM_POOL_RESIZE_ENABLE).
  *
  * @param clazz and #bvm_clazz_t to add
  */
 void bvm_clazz_pool_add(bvm_clazz_t *clazz) {
-	bvm_uint32_t hash = bvm_calchash(clazz->name->data, clazz->name->length) % bvm_gl_clazz_pool_bucketcount;
+	bvm_uint32_t hash = BVM_UTFSTRING_HASH(clazz->name) % bvm_gl_clazz_pool_bucketcount;
 	clazz->next = bvm_gl_clazz_pool[hash];
 	bvm_gl_clazz_pool[hash] = clazz;
+
+#if BVM_POOL_RESIZE_ENABLE
+	if (++bvm_gl_clazz_pool_count > (bvm_uint32_t) bvm_gl_clazz_pool_bucketcount * BVM_POOL_MAX_LOAD)
+		clazz_pool_grow();
+#endif
 }
 
@@ -33,12 +33,85 @@
 /**
  * An array of pointers to #bvm_internstring_obj_t - the intern string pool.
  */
-bvm_internstring_obj_t **bvm_gl_internstring_pool = NULL;
+BVM_VM_LOCAL bvm_internstring_obj_t **bvm_gl_internstring_pool = NULL;
 
 /**
  * Default intern string pool size
  */
-int bvm_gl_internstring_pool_bucketcount = BVM_INTERNSTRING_POOL_BUCKETCOUNT;
+BVM_VM_LOCAL int bvm_gl_internstring_pool_bucketcount = BVM_INTERNSTRING_POOL_BUCKETCOUNT;
+
+#if BVM_POOL_RESIZE_ENABLE
+
+/**
+ * The number of interned strings in the intern string pool.
+ */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_internstring_pool_count = 0;
+
+/**
+ * Double the number of hash buckets in the intern string pool and rehash its strings into them.  The strings stay in
+ * the old buckets until the new ones are allocated, so the pool is whole if the allocation GCs (or throws).
+ */
+static void internstring_pool_grow() {
+
+	int new_bucketcount = bvm_gl_internstring_pool_bucketcount * 2;
+	bvm_internstring_obj_t **new_pool, **old_pool;
+	int i;
+
+	new_pool = bvm_heap_calloc(new_bucketcount * sizeof(bvm_internstring_obj_t*), BVM_ALLOC_TYPE_STATIC);
+
+	for (i = bvm_gl_internstring_pool_bucketcount; i--;) {
+
+		bvm_internstring_obj_t *str = bvm_gl_internstring_pool[i];
+
+		while (str != NULL) {
+			bvm_internstring_obj_t *next = str->next;
+			bvm_uint32_t hash = str->hash % new_bucketcount;
+			str->next = new_pool[hash];
+			new_pool[hash] = str;
+			str = next;
+		}
+	}
+
+	old_pool = bvm_gl_internstring_pool;
+	bvm_gl_internstring_pool = new_pool;
+	bvm_gl_internstring_pool_bucketcount = new_bucketcount;
+	bvm_heap_free(old_pool);
+}
+
+#endif
+
+/**
+ * Calculates the Java \c String.hashCode() of the chars a utfstring decodes to, without decoding them anywhere.  The
+ * intern string pool is hashed by the chars rather than by the utf bytes so that a String may look itself up by its
+ * own chars - see #bvm_internstring_pool_get_chars.
+ *
+ * @param str the utfstring
+ *
+ * @return the hash
+ */
+static bvm_uint32_t internstring_utf_hash(bvm_utfstring_t *str) {
+
+	bvm_uint8_t *bytes = str->data;
+	bvm_uint32_t i, hash = 0;
+
+	for (i = 0; i < str->length; i++) {
+
+		bvm_uint16_t ch = bytes[i];
+
+		/* as for bvm_str_decode_utf8_to_unicode */
+		if ((ch & 0xE0) == 0xC0) {
+			ch = ((ch & 0x1f) << 6) + (bytes[i+1] & 0x3f);
+			i++;
+		} else if ((ch & 0xF0) == 0xE0) {
+			ch = ((ch & 0xf) << 12) + ((bytes[i+1] & 0x3f) << 6) + (bytes[i+2] & 0x3f);
+			i += 2;
+		}
+
+		hash = 31 * hash + ch;
+	}
+
+	return hash;
+}
 
 /**
  * Given a handle to a utf string, find if its value is already in cache.  If not in the cache and the
@@ -52,10 +125,10 @@ bvm_internstring_obj_t *bvm_internstring_pool_get(bvm_utfstring_t *str, bvm_bool
 	bvm_uint32_t hash;
 	bvm_internstring_obj_t *pooled_str;
 
-	hash = bvm_calchash(str->data, str->length) % bvm_gl_internstring_pool_bucketcount;
-	pooled_str = bvm_gl_internstring_pool[hash];
+	hash = internstring_utf_hash(str);
+	pooled_str = bvm_gl_internstring_pool[hash % bvm_gl_internstring_pool_bucketcount];
 	for (; (pooled_str != NULL) &&
-	       (bvm_str_utfstringcmp(str, pooled_str->utfstring) != 0); pooled_str = pooled_str->next);
+	       ( (pooled_str->hash != hash) || (bvm_str_utfstringcmp(str, pooled_str->utfstring) != 0) ); pooled_str = pooled_str->next);
 
 	if ( (pooled_str == NULL) && add_if_missing) {
 		pooled_str = bvm_internstring_pool_add(str);
@@ -65,7 +138,31 @@ bvm_internstring_obj_t *bvm_internstring_pool_get(bvm_utfstring_t *str, bvm_bool
 }
 
 /**
- * Adds a utf string to the cache.  No checking is performed to see if it is already there.
+ * Find the interned string of some chars.  Nothing is allocated, so a String may be looked up without first making a
+ * utfstring of it.
+ *
+ * @param chars the chars
+ * @param len the number of chars
+ * @param hash the Java \c String.hashCode() of the chars - see #bvm_string_hash_chars
+ *
+ * @return the interned string, or \c NULL if the chars have not been interned.
+ */
+bvm_internstring_obj_t *bvm_internstring_pool_get_chars(const bvm_uint16_t *chars, bvm_int32_t len, bvm_uint32_t hash) {
+
+	bvm_internstring_obj_t *pooled_str = bvm_gl_internstring_pool[hash % bvm_gl_internstring_pool_bucketcount];
+
+	for (; pooled_str != NULL; pooled_str = pooled_str->next) {
+		if ( (pooled_str->hash == hash) && (pooled_str->length.int_value == len) &&
+			 (memcmp(pooled_str->chars->data + pooled_str->offset.int_value, chars, len * sizeof(bvm_uint16_t)) == 0) )
+			break;
+	}
+
+	return pooled_str;
+}
+
+/**
+ * Adds a utf string to the cache.  No checking is performed to see if it is already there.  The new interned string
+ * and its char array are allocated as #BVM_ALLOC_TYPE_STATIC.
  *
  * @param str the utf string to add
  * @return a pointer to the interned string.
@@ -77,10 +174,20 @@ bvm_internstring_obj_t *bvm_internstring_pool_add(bvm_utfstring_t *str) {
 
 	internstr = (bvm_internstring_obj_t *) bvm_string_create_from_utfstring(str, BVM_TRUE);
 
-	hash = bvm_calchash(str->data, str->length) % bvm_gl_internstring_pool_bucketcount;
+	/* an interned string lives as long as the VM, so it and its chars are STATIC - the GC need never mark them */
+	bvm_heap_set_alloc_type(internstr, BVM_ALLOC_TYPE_STATIC);
+	bvm_heap_set_alloc_type(internstr->chars, BVM_ALLOC_TYPE_STATIC);
+
+	internstr->hash = (bvm_uint32_t) bvm_string_hash_chars(internstr->chars->data, internstr->length.int_value);
+
+	hash = internstr->hash % bvm_gl_internstring_pool_bucketcount;
 	internstr->next = bvm_gl_internstring_pool[hash];
 	bvm_gl_internstring_pool[hash] = internstr;
 
+#if BVM_POOL_RESIZE_ENABLE
+	if (++bvm_gl_internstring_pool_count > (bvm_uint32_t) bvm_gl_internstring_pool_bucketcount * BVM_POOL_MAX_LOAD)
+		internstring_pool_grow();
+#endif
+
 	return internstr;
 }
-
@@ -38,12 +38,52 @@
 /**
  * An array of pointers to #bvm_native_method_desc_t - the native method pool.
  */
-bvm_native_method_desc_t **bvm_gl_native_method_pool = NULL;
+BVM_VM_LOCAL bvm_native_method_desc_t **bvm_gl_native_method_pool = NULL;
 
 /**
  * Default native method pool size.
  */
-int bvm_gl_native_method_pool_bucketcount = BVM_NATIVEMETHOD_POOL_BUCKETCOUNT;
+BVM_VM_LOCAL int bvm_gl_native_method_pool_bucketcount = BVM_NATIVEMETHOD_POOL_BUCKETCOUNT;
+
+#if BVM_POOL_RESIZE_ENABLE
+
+/**
+ * The number of native methods in the native method pool.
+ */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_native_method_pool_count = 0;
+
+/**
+ * Double the number of hash buckets in the native method pool and rehash its methods into them.  The methods stay in
+ * the old buckets until the new ones are allocated, so the pool is whole if the allocation GCs (or throws).
+ */
+static void native_method_pool_grow() {
+
+	int new_bucketcount = bvm_gl_native_method_pool_bucketcount * 2;
+	bvm_native_method_desc_t **new_pool, **old_pool;
+	int i;
+
+	new_pool = bvm_heap_calloc(new_bucketcount * sizeof(bvm_native_method_desc_t*), BVM_ALLOC_TYPE_METADATA);
+
+	for (i = bvm_gl_native_method_pool_bucketcount; i--;) {
+
+		bvm_native_method_desc_t *method_desc = bvm_gl_native_method_pool[i];
+
+		while (method_desc != NULL) {
+			bvm_native_method_desc_t *next = method_desc->next;
+			bvm_uint32_t hash = BVM_UTFSTRING_HASH(method_desc->name) % new_bucketcount;
+			method_desc->next = new_pool[hash];
+			new_pool[hash] = method_desc;
+			method_desc = next;
+		}
+	}
+
+	old_pool = bvm_gl_native_method_pool;
+	bvm_gl_native_method_pool = new_pool;
+	bvm_gl_native_method_pool_bucketcount = new_bucketcount;
+	bvm_heap_free(old_pool);
+}
+
+#endif
 
 /**
  * Retrieve a native method from the native method pool.
@@ -61,7 +101,7 @@ bvm_native_method_desc_t *bvm_native_method_pool_get(bvm_utfstring_t *clazzname,
 	bvm_native_method_desc_t *pooled_method;
 
 	/* calc a hash on the method name.  Nice and simple - no need to hash all three params. */
-	hash = bvm_calchash(name->data, name->length) % bvm_gl_native_method_pool_bucketcount;
+	hash = BVM_UTFSTRING_HASH(name) % bvm_gl_native_method_pool_bucketcount;
 
 	/* get the entry for the hash in the pool */
 	pooled_method = bvm_gl_native_method_pool[hash];
@@ -84,7 +124,7 @@ bvm_native_method_desc_t *bvm_native_method_pool_get(bvm_utfstring_t *clazzname,
 static void native_method_pool_add(bvm_native_method_desc_t *method_desc) {
 
 	/* calc hash on the method name */
-	bvm_uint32_t hash = bvm_calchash(method_desc->name->data, method_desc->name->length) % bvm_gl_native_method_pool_bucketcount;
+	bvm_uint32_t hash = BVM_UTFSTRING_HASH(method_desc->name) % bvm_gl_native_method_pool_bucketcount;
 
 	/* new entries are added at the front of the hash list */
 
@@ -93,10 +133,43 @@ static void native_method_pool_add(bvm_native_method_desc_t *method_desc) {
 
 	/* set the front of the pool bucket to the new entry */
 	bvm_gl_native_method_pool[hash] = method_desc;
+
+#if BVM_POOL_RESIZE_ENABLE
+	if (++bvm_gl_native_method_pool_count > (bvm_uint32_t) bvm_gl_native_method_pool_bucketcount * BVM_POOL_MAX_LOAD)
+		native_method_pool_grow();
+#endif
 }
 
 /**
+ * Create a native method descriptor and add it to the native method pool.
+ *
+ * @param clazzname char * to the full internalised name of the class
+ * @param methodname char * to name of method
+ * @param methoddesc char * to method description (signature) of method
+ * @param method function pointer to native method
+ * @param is_leaf whether the method is a 'leaf' native
+ * @return the new native method descriptor
  */
+static bvm_native_method_desc_t *native_method_pool_register(char *clazzname, char *methodname, char *methoddesc, bvm_native_method_t method, bvm_bool_t is_leaf) {
+
+	bvm_native_method_desc_t *native_method_desc = bvm_heap_alloc(sizeof(bvm_native_method_desc_t), BVM_ALLOC_TYPE_METADATA);
+
+	native_method_desc->clazzname = bvm_utfstring_pool_get_c(clazzname, BVM_TRUE);
+	native_method_desc->name	  = bvm_utfstring_pool_get_c(methodname, BVM_TRUE);
+	native_method_desc->desc      = bvm_utfstring_pool_get_c(methoddesc, BVM_TRUE);
+	native_method_desc->method    = method;
+	native_method_desc->is_leaf   = is_leaf;
+#if BVM_NATIVE_REPLACEMENT_ENABLE
+	native_method_desc->is_replacement = BVM_FALSE;
+#endif
+#if BVM_AOT_ENABLE
+	native_method_desc->aot_method = NULL;
+#endif
+
+	native_method_pool_add(native_method_desc);
+
+	return native_method_desc;
+}
 
 /**
  * To register a native method for later retrieval by the class loading mechanism.  No checking is performed
@@ -109,13 +182,67 @@ static void native_method_pool_add(bvm_native_method_desc_t *method_desc) {
  * @param method function pointer to native method
  */
 void bvm_native_method_pool_register(char *clazzname, char *methodname, char *methoddesc, bvm_native_method_t method) {
+	native_method_pool_register(clazzname, methodname, methoddesc, method, BVM_FALSE);
+}
+
+/**
+ * To register a 'leaf' native method.  A leaf native must never throw an exception, allocate from the heap, block or
+ * switch threads, push frames, or look at the current stack frame - it may only read its arguments and return a
+ * value.  With #BVM_NATIVE_LEAF_CALLS_ENABLE, a leaf native is called without a native method frame being pushed
+ * for it.
+ *
+ * @param clazzname - a bvm_utfstring_t* contain the full internalised name of the class (yes, it must
+ * have '/'s and not '.'s as package separators.
+ * @param methodname char * to name of method
+ * @param methoddesc char * to method description (signature) of method (like '(Ljava/lang/String;)V')
+ * @param method function pointer to native method
+ */
+void bvm_native_method_pool_register_leaf(char *clazzname, char *methodname, char *methoddesc, bvm_native_method_t method) {
+	native_method_pool_register(clazzname, methodname, methoddesc, method, BVM_TRUE);
+}
 
-	bvm_native_method_desc_t *native_method_desc = bvm_heap_alloc(sizeof(bvm_native_method_desc_t), BVM_ALLOC_TYPE_STATIC);
+#if BVM_NATIVE_REPLACEMENT_ENABLE
 
-	native_method_desc->clazzname = bvm_utfstring_pool_get_c(clazzname, BVM_TRUE);
-	native_method_desc->name	  = bvm_utfstring_pool_get_c(methodname, BVM_TRUE);
-	native_method_desc->desc      = bvm_utfstring_pool_get_c(methoddesc, BVM_TRUE);
-	native_method_desc->method    = method;
+/**
+ * To register a 'replacement' native method.  A replacement native is linked in place of a method that is not
+ * declared native in its class, but only when that class is loaded by the bootstrap classloader.  The bytecode of the
+ * replaced method is not loaded.  The native must behave exactly as the bytecode it replaces.
+ *
+ * @param clazzname - a bvm_utfstring_t* contain the full internalised name of the class (yes, it must
+ * have '/'s and not '.'s as package separators.
+ * @param methodname char * to name of method
+ * @param methoddesc char * to method description (signature) of method (like '(I)Ljava/lang/StringBuffer;')
+ * @param method function pointer to native method
+ */
+void bvm_native_method_pool_register_replacement(char *clazzname, char *methodname, char *methoddesc, bvm_native_method_t method) {
 
-	native_method_pool_add(native_method_desc);
+	native_method_pool_register(clazzname, methodname, methoddesc, method, BVM_FALSE)->is_replacement = BVM_TRUE;
+}
+
+#endif
+
+#if BVM_AOT_ENABLE
+
+/**
+ * To register a method translated to C ahead of time (see aot.c).  The translation is linked to the method with the
+ * given class name, name and description when its class is loaded, but only if the hash of the method's bytecode is
+ * the given hash - the bytecode it was translated from.  Called by the generated #bvm_aot_register_methods.
+ *
+ * @param clazzname - a bvm_utfstring_t* contain the full internalised name of the class (yes, it must
+ * have '/'s and not '.'s as package separators.
+ * @param methodname char * to name of method
+ * @param methoddesc char * to method description (signature) of method (like '(I)I')
+ * @param method function pointer to the translated method
+ * @param hash the hash of the bytecode it was translated from
+ */
+void bvm_native_method_pool_register_aot(char *clazzname, char *methodname, char *methoddesc, bvm_aot_method_t method, bvm_uint32_t hash) {
+
+	bvm_native_method_desc_t *method_desc = native_method_pool_register(clazzname, methodname, methoddesc, NULL, BVM_FALSE);
+
+	method_desc->aot_method = method;
+	method_desc->aot_hash = hash;
+
+	bvm_gl_aot_method_count++;
 }
+
+#endif
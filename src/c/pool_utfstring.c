@@ -32,12 +32,52 @@
 /**
  * An array of pointers to #bvm_utfstring_t - the utfstring pool.
  */
-bvm_utfstring_t **bvm_gl_utfstring_pool = NULL;
+BVM_VM_LOCAL bvm_utfstring_t **bvm_gl_utfstring_pool = NULL;
 
 /**
  * Default utf8 string pool size
  */
-int bvm_gl_utfstring_pool_bucketcount = BVM_UTFSTRING_POOL_BUCKETCOUNT;
+BVM_VM_LOCAL int bvm_gl_utfstring_pool_bucketcount = BVM_UTFSTRING_POOL_BUCKETCOUNT;
+
+#if BVM_POOL_RESIZE_ENABLE
+
+/**
+ * The number of utfstrings in the utfstring pool.
+ */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_utfstring_pool_count = 0;
+
+/**
+ * Double the number of hash buckets in the utfstring pool and rehash its strings into them.  The strings stay in the
+ * old buckets until the new ones are allocated, so the pool is whole if the allocation GCs (or throws).
+ */
+static void utfstring_pool_grow() {
+
+    int new_bucketcount = bvm_gl_utfstring_pool_bucketcount * 2;
+    bvm_utfstring_t **new_pool, **old_pool;
+    int i;
+
+    new_pool = bvm_heap_calloc(new_bucketcount * sizeof(bvm_utfstring_t*), BVM_ALLOC_TYPE_METADATA);
+
+    for (i = bvm_gl_utfstring_pool_bucketcount; i--;) {
+
+        bvm_utfstring_t *str = bvm_gl_utfstring_pool[i];
+
+        while (str != NULL) {
+            bvm_utfstring_t *next = str->next;
+            bvm_uint32_t hash = BVM_UTFSTRING_HASH(str) % new_bucketcount;
+            str->next = new_pool[hash];
+            new_pool[hash] = str;
+            str = next;
+        }
+    }
+
+    old_pool = bvm_gl_utfstring_pool;
+    bvm_gl_utfstring_pool = new_pool;
+    bvm_gl_utfstring_pool_bucketcount = new_bucketcount;
+    bvm_heap_free(old_pool);
+}
+
+#endif
 
 /**
 * To get a utf string from the pool that matches the given char* (which must be null terminated).
@@ -52,6 +92,7 @@ bvm_utfstring_t *bvm_utfstring_pool_get_c(const char *data, bvm_bool_t add_if_mi
     bvm_utfstring_t *pooled_str;
 
     tempstr.length = (bvm_uint16_t) strlen(data);
+    tempstr.hash = 0;
     tempstr.data = (bvm_uint8_t *) data;
 
     pooled_str = bvm_utfstring_pool_get(&tempstr, BVM_FALSE);
@@ -62,7 +103,7 @@ bvm_utfstring_t *bvm_utfstring_pool_get_c(const char *data, bvm_bool_t add_if_mi
 
         size_t length = strlen(data);
 
-        pooled_str = bvm_str_new_utfstring(length, BVM_ALLOC_TYPE_STATIC);
+        pooled_str = bvm_str_new_utfstring(length, BVM_ALLOC_TYPE_METADATA);
 
         /* copy data plus null terminator */
         memcpy(pooled_str->data, data, length + 1);
@@ -91,7 +132,7 @@ bvm_utfstring_t *bvm_utfstring_pool_get(bvm_utfstring_t *str, bvm_bool_t add_if_
     bvm_uint32_t hash;
     bvm_utfstring_t *pooled_str;
 
-    hash = bvm_calchash(str->data, str->length) % bvm_gl_utfstring_pool_bucketcount;
+    hash = BVM_UTFSTRING_HASH(str) % bvm_gl_utfstring_pool_bucketcount;
     pooled_str = bvm_gl_utfstring_pool[hash];
     for (; (pooled_str != NULL) &&
            (bvm_str_utfstringcmp(str, pooled_str) != 0);
@@ -108,13 +149,24 @@ bvm_utfstring_t *bvm_utfstring_pool_get(bvm_utfstring_t *str, bvm_bool_t add_if_
 /**
  * Add a utfstring to the pool.  Note this function does not check whether it exists in the
  * pool already, it simple adds it to the vmstring pool array as the first node of the
- * hash bucket
+ * hash bucket.  The pool grows if it is now too full (see #BVM_POOL_RESIZE_ENABLE).  The hash of the string is
+ * cached in it.
  *
  * @param str the bvm_utfstring_t to add.
  */
 void bvm_utfstring_pool_add(bvm_utfstring_t *str) {
-    bvm_uint32_t hash = bvm_calchash(str->data, str->length) % bvm_gl_utfstring_pool_bucketcount;
+    bvm_uint32_t hash;
+
+    /* a pooled string's chars never change, so its hash is worked out just the once */
+    str->hash = bvm_calchash(str->data, str->length);
+
+    hash = str->hash % bvm_gl_utfstring_pool_bucketcount;
     str->next = bvm_gl_utfstring_pool[hash];
     bvm_gl_utfstring_pool[hash] = str;
+
+#if BVM_POOL_RESIZE_ENABLE
+    if (++bvm_gl_utfstring_pool_count > (bvm_uint32_t) bvm_gl_utfstring_pool_bucketcount * BVM_POOL_MAX_LOAD)
+        utfstring_pool_grow();
+#endif
 }
 
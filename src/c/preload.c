@@ -0,0 +1,588 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#include "../h/bvm.h"
+
+/**
+
+ @file
+
+ Profile driven class preloading.
+
+ @section ov Overview
+
+ Classes are loaded one at a time as they are first used, and each class file read from a jar is a seek to its
+ local header and a read or two of its data - across the jar, in no particular order.  On storage where a random read
+ costs a good deal more than a sequential one, those reads are a large part of startup.
+
+ A VM started with \c -preloadwrite records the jar and path name of each class file that is read from a jar, in the
+ order they are read, and writes them to the given profile file when the VM exits.  A VM started with \c -preload
+ reads the profile during initialisation, before any class is loaded, and reads and inflates all the class files in
+ it - jar by jar, in the order the files are in each jar, so each jar is read front to back in a few large reads (see
+ #bvm_zip_read_files).  When a class file is then asked for from a jar it is taken from those already read, if it is
+ there, and the jar is not read at all.
+
+ Class files read ahead are held in memory from #bvm_pd_memory_alloc, not the heap, and each is given back as soon as
+ it is taken - it is copied into a heap buffer, just as if it had been read from the jar.  A file in the profile that
+ is not in its jar (or that jar is not there) is just not read ahead.  A class that is never asked for costs its
+ memory until the VM exits.  A profile is a hint, so it never needs to be made again - but it helps less as the
+ classes a program loads move away from those in it.
+
+ A class served from a class image (see clazzimage.c) is not read from a jar, so is not recorded.
+
+ @section prefetch Prefetching
+
+ With #BVM_CLAZZ_PREFETCH_ENABLE the class files of mapped jars are not read during initialisation.  Instead a host
+ OS thread is started at the end of #bvm_preload_load to read and inflate them, in the order they are in the profile -
+ the order the VM will ask for them.  On a host with a core to spare the VM then spends no time inflating the class
+ files the thread gets to first.  The thread and the VM share a lock while they look at a file: when the VM asks for a
+ file the thread has read it takes it, and when it asks for one the thread has not yet got to it reads it from the
+ jar itself and the thread skips it.  The thread uses nothing of the VM but the mappings of the jars and what it is
+ given in #pl_prefetch, and the VM waits for it to end before letting go of the jars.
+
+ The profile is a text file with a line for each class file read - the jar name, a tab, and the path name of the
+ class file in the jar.
+
+ @author Greg McCreath
+ @since 0.0.10
+
+*/
+
+#if BVM_CLAZZ_PRELOAD_ENABLE
+
+/**
+ * A class file in a loaded profile.  The jar and path names point into #pl_profile.
+ */
+typedef struct _plfilestruct {
+
+	/** the name of the jar */
+	char *jarname;
+
+	/** the path name of the class file in the jar */
+	char *pathname;
+
+	/** the length of the class file bytes */
+	bvm_uint32_t length;
+
+	/** the class file bytes, or \c NULL if not read ahead or already taken */
+	bvm_uint8_t *data;
+
+	/** set once the file has been read ahead with the rest of its jar */
+	bvm_bool_t is_queued;
+
+#if BVM_CLAZZ_PREFETCH_ENABLE
+	/** set once the VM has asked for the file - the prefetch thread then leaves it alone */
+	bvm_bool_t is_claimed;
+#endif
+
+} pl_file_t;
+
+/**
+ * A class file read from a jar recorded for writing to a profile.  The jar name and path name follow, each null
+ * terminated.
+ */
+typedef struct _plrecordstruct {
+
+	/** the next recorded file */
+	struct _plrecordstruct *next;
+
+	/** the jar name, then the path name */
+	char data[1];
+
+} pl_record_t;
+
+/** The profile to read ahead from at VM startup.  Set with the \c -preload command line option. */
+BVM_VM_LOCAL char *bvm_gl_preload_filename = NULL;
+
+/** The profile to write at VM exit.  Set with the \c -preloadwrite command line option. */
+BVM_VM_LOCAL char *bvm_gl_preload_write_filename = NULL;
+
+/** The bytes of the loaded profile, or \c NULL if no profile is being used */
+static BVM_VM_LOCAL char *pl_profile = NULL;
+
+/** The class files in the loaded profile */
+static BVM_VM_LOCAL pl_file_t *pl_files = NULL;
+
+/** The hash index of #pl_files by path name.  Each slot holds the index of a file plus one, or zero if empty. */
+static BVM_VM_LOCAL bvm_uint32_t *pl_index = NULL;
+
+/** The number of slots in #pl_index less one - the slot count is a power of two */
+static BVM_VM_LOCAL bvm_uint32_t pl_index_mask;
+
+/** The first file recorded for writing */
+static BVM_VM_LOCAL pl_record_t *pl_records = NULL;
+
+/** The last file recorded for writing - files are written in the order they were read */
+static BVM_VM_LOCAL pl_record_t *pl_records_last = NULL;
+
+#if BVM_CLAZZ_PREFETCH_ENABLE
+
+/**
+ * What the prefetch thread is given.  It has none of the VM's state, so all it uses is here.
+ */
+typedef struct _plprefetchstruct {
+
+	/** the lock held by the prefetch thread or the VM while looking at a prefetched file, or \c NULL if none */
+	void *lock;
+
+	/** the prefetch thread, or \c NULL if it has not been started */
+	void *thread;
+
+	/** the files to read, from #bvm_zip_prepare_read_files */
+	void *reads;
+
+	/** the class files of the profile - #pl_files */
+	pl_file_t *files;
+
+	/** the index in \c files of each file to read */
+	bvm_uint32_t *indexes;
+
+} pl_prefetch_t;
+
+/** The prefetch thread of the loaded profile */
+static BVM_VM_LOCAL pl_prefetch_t pl_prefetch = {NULL, NULL, NULL, NULL, NULL};
+
+#endif
+
+/**
+ * The files of one jar being read ahead by #pl_read_jar.
+ */
+typedef struct _pljarstruct {
+
+	/** the index of each file in #pl_files */
+	bvm_uint32_t *indexes;
+
+	/** the path name of each file */
+	char **pathnames;
+
+} pl_jar_t;
+
+/**
+ * Take a file read ahead by #bvm_zip_read_files.
+ */
+static void pl_file_read(bvm_uint32_t index, bvm_uint8_t *data, bvm_uint32_t length, void *jar) {
+
+	pl_file_t *file = &pl_files[((pl_jar_t *) jar)->indexes[index]];
+
+	file->data = data;
+	file->length = length;
+}
+
+/**
+ * Read ahead all the files in the profile from the same jar as a given file.
+ *
+ * @param first - the index of the first file of the jar in #pl_files.
+ * @param count - the number of files in the profile.
+ * @param jar - room for the names and indexes of \c count files.
+ */
+static void pl_read_jar(bvm_uint32_t first, bvm_uint32_t count, pl_jar_t *jar) {
+
+	bvm_uint32_t lc, nr_files = 0;
+	char *jarname = pl_files[first].jarname;
+
+	for (lc = first; lc < count; lc++) {
+		if (!pl_files[lc].is_queued && (strcmp(pl_files[lc].jarname, jarname) == 0)) {
+			pl_files[lc].is_queued = BVM_TRUE;
+			jar->indexes[nr_files] = lc;
+			jar->pathnames[nr_files++] = pl_files[lc].pathname;
+		}
+	}
+
+	bvm_zip_read_files(jarname, jar->pathnames, nr_files, pl_file_read, jar);
+}
+
+#if BVM_CLAZZ_PREFETCH_ENABLE
+
+/**
+ * Report to #bvm_zip_read_prepared_files whether the prefetch thread is to read a file - not if the VM has already
+ * asked for it.
+ */
+static bvm_bool_t pl_prefetch_wanted(bvm_uint32_t index, void *data) {
+
+	pl_prefetch_t *prefetch = data;
+	bvm_bool_t wanted;
+
+	bvm_pd_system_lock(prefetch->lock);
+	wanted = !prefetch->files[prefetch->indexes[index]].is_claimed;
+	bvm_pd_system_unlock(prefetch->lock);
+
+	return wanted;
+}
+
+/**
+ * Take a file read by the prefetch thread, or give it back if the VM has asked for it in the meantime.
+ */
+static void pl_prefetch_read(bvm_uint32_t index, bvm_uint8_t *data, bvm_uint32_t length, void *prefetch_data) {
+
+	pl_prefetch_t *prefetch = prefetch_data;
+	pl_file_t *file = &prefetch->files[prefetch->indexes[index]];
+
+	bvm_pd_system_lock(prefetch->lock);
+
+	if (file->is_claimed) {
+		bvm_pd_memory_free(data);
+	} else {
+		file->data = data;
+		file->length = length;
+	}
+
+	bvm_pd_system_unlock(prefetch->lock);
+}
+
+/**
+ * What the prefetch thread runs.
+ */
+static void pl_prefetch_run(void *data) {
+
+	pl_prefetch_t *prefetch = data;
+
+	bvm_zip_read_prepared_files(prefetch->reads, pl_prefetch_wanted, pl_prefetch_read, prefetch);
+}
+
+/**
+ * Queue the files of the profile in mapped jars for the prefetch thread, in profile order.  They are then not read
+ * ahead with the rest of their jar by #pl_read_jar - unless they cannot be queued, when they are.
+ *
+ * @param count - the number of files in the profile.
+ * @param jar - room for the names of \c count files.
+ */
+static void pl_prefetch_queue(bvm_uint32_t count, pl_jar_t *jar) {
+
+	bvm_uint32_t lc, nr_files = 0;
+	char **jarnames, *jarname = NULL;
+	bvm_bool_t is_mapped = BVM_FALSE;
+
+	pl_prefetch.files = pl_files;
+	pl_prefetch.indexes = bvm_pd_memory_alloc(count * sizeof(bvm_uint32_t) + 1);
+	pl_prefetch.lock = bvm_pd_system_lock_create();
+	jarnames = bvm_pd_memory_alloc(count * sizeof(char *) + 1);
+
+	if ( (pl_prefetch.indexes != NULL) && (pl_prefetch.lock != NULL) && (jarnames != NULL) ) {
+
+		for (lc = 0; lc < count; lc++) {
+
+			/* profile lines of a jar are mostly together, so the last jar asked about is mostly the one */
+			if ( (jarname == NULL) || (strcmp(pl_files[lc].jarname, jarname) != 0) ) {
+				jarname = pl_files[lc].jarname;
+				is_mapped = bvm_zip_is_mapped(jarname);
+			}
+
+			if (is_mapped) {
+				pl_prefetch.indexes[nr_files] = lc;
+				jarnames[nr_files] = pl_files[lc].jarname;
+				jar->pathnames[nr_files++] = pl_files[lc].pathname;
+			}
+		}
+
+		if ( (pl_prefetch.reads = bvm_zip_prepare_read_files(jarnames, jar->pathnames, nr_files)) != NULL) {
+			for (lc = 0; lc < nr_files; lc++) pl_files[pl_prefetch.indexes[lc]].is_queued = BVM_TRUE;
+		}
+	}
+
+	if (jarnames != NULL) bvm_pd_memory_free(jarnames);
+
+	if (pl_prefetch.reads == NULL) {
+		if (pl_prefetch.indexes != NULL) bvm_pd_memory_free(pl_prefetch.indexes);
+		if (pl_prefetch.lock != NULL) bvm_pd_system_lock_destroy(pl_prefetch.lock);
+		pl_prefetch.indexes = NULL;
+		pl_prefetch.lock = NULL;
+	}
+}
+
+#endif
+
+/**
+ * Report the slot of a path name in #pl_index.
+ */
+static bvm_uint32_t pl_slot(const char *pathname) {
+	return bvm_calchash( (bvm_uint8_t *) pathname, strlen(pathname)) & pl_index_mask;
+}
+
+/**
+ * Read a profile and read ahead all the class files in it.  The classpaths must have been set.  A profile that
+ * cannot be read is not used - all class files are read from their jars as usual.
+ *
+ * @param filename - the name of the profile file.
+ * @return #BVM_TRUE if the profile is being used, #BVM_FALSE if not.
+ */
+bvm_bool_t bvm_preload_load(const char *filename) {
+
+	bvm_uint32_t length, lc, count = 0, slot, slots;
+	char *line, *tab, *end;
+	pl_jar_t jar;
+	void *handle = bvm_pd_file_open(filename, BVM_FILE_O_RDONLY);
+
+	if (handle == NULL) return BVM_FALSE;
+
+	length = (bvm_uint32_t) bvm_pd_file_sizeof(handle);
+
+	if ( (pl_profile = bvm_pd_memory_alloc(length + 1)) != NULL) {
+		if (bvm_pd_file_read(pl_profile, length, handle) != length) {
+			bvm_pd_memory_free(pl_profile);
+			pl_profile = NULL;
+		}
+	}
+
+	bvm_pd_file_close(handle);
+
+	if (pl_profile == NULL) return BVM_FALSE;
+
+	pl_profile[length] = '\0';
+
+	for (lc = 0; lc < length; lc++) {
+		if (pl_profile[lc] == '\n') count++;
+	}
+
+	for (slots = 1; slots < count * 2; slots <<= 1);
+
+	pl_files = bvm_pd_memory_alloc(count * sizeof(pl_file_t) + 1);
+	pl_index = bvm_pd_memory_alloc(slots * sizeof(bvm_uint32_t));
+	jar.indexes = bvm_pd_memory_alloc(count * sizeof(bvm_uint32_t) + 1);
+	jar.pathnames = bvm_pd_memory_alloc(count * sizeof(char *) + 1);
+
+	if ( (pl_files == NULL) || (pl_index == NULL) || (jar.indexes == NULL) || (jar.pathnames == NULL) ) {
+		/* nothing has been read ahead yet */
+		if (pl_files != NULL) bvm_pd_memory_free(pl_files);
+		if (pl_index != NULL) bvm_pd_memory_free(pl_index);
+		if (jar.indexes != NULL) bvm_pd_memory_free(jar.indexes);
+		if (jar.pathnames != NULL) bvm_pd_memory_free(jar.pathnames);
+		bvm_pd_memory_free(pl_profile);
+		pl_files = NULL;
+		pl_index = NULL;
+		pl_profile = NULL;
+		return BVM_FALSE;
+	}
+
+	memset(pl_index, 0, slots * sizeof(bvm_uint32_t));
+	pl_index_mask = slots - 1;
+
+	/* each line is a jar name, a tab, and a path name - lines that are not are skipped */
+	for (count = 0, line = pl_profile; (end = strchr(line, '\n')) != NULL; line = end + 1) {
+
+		*end = '\0';
+
+		if ( (tab = strchr(line, '\t')) != NULL) {
+			*tab = '\0';
+			pl_files[count].jarname = line;
+			pl_files[count].pathname = tab + 1;
+			pl_files[count].length = 0;
+			pl_files[count].data = NULL;
+#if BVM_CLAZZ_PREFETCH_ENABLE
+			pl_files[count].is_claimed = BVM_FALSE;
+#endif
+			pl_files[count++].is_queued = BVM_FALSE;
+		}
+	}
+
+#if BVM_CLAZZ_PREFETCH_ENABLE
+	pl_prefetch_queue(count, &jar);
+#endif
+
+	/* read the files a jar at a time */
+	for (lc = 0; lc < count; lc++) {
+		if (!pl_files[lc].is_queued) pl_read_jar(lc, count, &jar);
+	}
+
+	bvm_pd_memory_free(jar.indexes);
+	bvm_pd_memory_free(jar.pathnames);
+
+	for (lc = 0; lc < count; lc++) {
+
+#if BVM_CLAZZ_PREFETCH_ENABLE
+		/* a file queued for the prefetch thread has not been read yet, so all are indexed */
+#else
+		if (pl_files[lc].data == NULL) continue;
+#endif
+
+		for (slot = pl_slot(pl_files[lc].pathname); pl_index[slot] != 0; slot = (slot + 1) & pl_index_mask);
+		pl_index[slot] = lc + 1;
+	}
+
+#if BVM_CLAZZ_PREFETCH_ENABLE
+	/* without a thread the files are just read now */
+	if (pl_prefetch.reads != NULL) {
+		pl_prefetch.thread = bvm_pd_system_thread_start(pl_prefetch_run, &pl_prefetch);
+		if (pl_prefetch.thread == NULL) pl_prefetch_run(&pl_prefetch);
+	}
+#endif
+
+	return BVM_TRUE;
+}
+
+/**
+ * Buffer a class file read ahead from a profile.  The buffer is allocated from the heap as #BVM_ALLOC_TYPE_DATA, just
+ * as a file buffered from a jar is, and the file is given back - it is only taken once.
+ *
+ * @param jarname - the name of the jar.
+ * @param pathname - the path name of the class file in the jar.
+ * @return a buffer of the class file, or \c NULL if no profile is being used or the file was not read ahead.
+ */
+bvm_filebuffer_t *bvm_preload_buffer_file(char *jarname, char *pathname) {
+
+	bvm_uint32_t slot, index;
+	bvm_uint8_t *data;
+	bvm_filebuffer_t *buffer;
+
+	if (pl_index == NULL) return NULL;
+
+	for (slot = pl_slot(pathname); (index = pl_index[slot]) != 0; slot = (slot + 1) & pl_index_mask) {
+
+		pl_file_t *file = &pl_files[index-1];
+
+		if ( (strcmp(file->pathname, pathname) != 0) || (strcmp(file->jarname, jarname) != 0) ) continue;
+
+#if BVM_CLAZZ_PREFETCH_ENABLE
+		/* once claimed the prefetch thread leaves the file alone, read or not */
+		if (pl_prefetch.lock != NULL) bvm_pd_system_lock(pl_prefetch.lock);
+		file->is_claimed = BVM_TRUE;
+#endif
+
+		data = file->data;
+
+#if BVM_CLAZZ_PREFETCH_ENABLE
+		if (pl_prefetch.lock != NULL) bvm_pd_system_unlock(pl_prefetch.lock);
+#endif
+
+		if (data == NULL) continue;
+
+		buffer = bvm_create_buffer(file->length, BVM_ALLOC_TYPE_DATA);
+		memcpy(buffer->data, data, file->length);
+
+		bvm_pd_memory_free(data);
+		file->data = NULL;
+
+		return buffer;
+	}
+
+	return NULL;
+}
+
+/**
+ * Record a class file read from a jar so it is written to the profile at VM exit.  Does nothing if no profile is to
+ * be written.  A file that there is no memory to record is left out of the profile.
+ *
+ * @param jarname - the name of the jar.
+ * @param pathname - the path name of the class file in the jar.
+ */
+void bvm_preload_record(char *jarname, char *pathname) {
+
+	pl_record_t *record;
+	size_t jarname_length;
+
+	if (bvm_gl_preload_write_filename == NULL) return;
+
+	jarname_length = strlen(jarname) + 1;
+
+	record = bvm_pd_memory_alloc(sizeof(pl_record_t) + jarname_length + strlen(pathname));
+	if (record == NULL) return;
+
+	record->next = NULL;
+	memcpy(record->data, jarname, jarname_length);
+	strcpy(record->data + jarname_length, pathname);
+
+	if (pl_records_last == NULL)
+		pl_records = record;
+	else
+		pl_records_last->next = record;
+
+	pl_records_last = record;
+}
+
+/**
+ * Write the class files recorded with #bvm_preload_record to a profile.
+ *
+ * @param filename - the name of the profile file.
+ * @return #BVM_TRUE if the profile was written, #BVM_FALSE if it could not be.
+ */
+bvm_bool_t bvm_preload_write(const char *filename) {
+
+	bvm_bool_t result = BVM_TRUE;
+	pl_record_t *record;
+	size_t jarname_length, pathname_length;
+	void *handle = bvm_pd_file_open(filename, BVM_FILE_O_WRONLY | BVM_FILE_O_TRUNC);
+
+	if (handle == NULL) return BVM_FALSE;
+
+	for (record = pl_records; result && (record != NULL); record = record->next) {
+
+		jarname_length = strlen(record->data);
+		pathname_length = strlen(record->data + jarname_length + 1);
+
+		result = (bvm_pd_file_write(record->data, jarname_length, handle) == jarname_length) &&
+				 (bvm_pd_file_write("\t", 1, handle) == 1) &&
+				 (bvm_pd_file_write(record->data + jarname_length + 1, pathname_length, handle) == pathname_length) &&
+				 (bvm_pd_file_write("\n", 1, handle) == 1);
+	}
+
+	if (bvm_pd_file_close(handle) == BVM_ERR) result = BVM_FALSE;
+
+	return result;
+}
+
+/**
+ * Give back all memory held for preloading - the loaded profile, the files read ahead and not taken, and the
+ * recorded files.
+ */
+void bvm_preload_release() {
+
+	pl_record_t *record;
+
+#if BVM_CLAZZ_PREFETCH_ENABLE
+	/* the prefetch thread is done with the jars before they are let go of */
+	if (pl_prefetch.thread != NULL) bvm_pd_system_thread_join(pl_prefetch.thread);
+	if (pl_prefetch.lock != NULL) bvm_pd_system_lock_destroy(pl_prefetch.lock);
+	if (pl_prefetch.indexes != NULL) bvm_pd_memory_free(pl_prefetch.indexes);
+
+	pl_prefetch.thread = NULL;
+	pl_prefetch.lock = NULL;
+	pl_prefetch.reads = NULL;
+	pl_prefetch.files = NULL;
+	pl_prefetch.indexes = NULL;
+#endif
+
+	while ( (record = pl_records) != NULL) {
+		pl_records = record->next;
+		bvm_pd_memory_free(record);
+	}
+	pl_records_last = NULL;
+
+	if (pl_files != NULL) {
+
+		/* the files not taken - those of the index are all there is */
+		if (pl_index != NULL) {
+
+			bvm_uint32_t slot;
+
+			for (slot = 0; slot <= pl_index_mask; slot++) {
+				if ( (pl_index[slot] != 0) && (pl_files[pl_index[slot]-1].data != NULL) )
+					bvm_pd_memory_free(pl_files[pl_index[slot]-1].data);
+			}
+		}
+
+		bvm_pd_memory_free(pl_files);
+	}
+
+	if (pl_index != NULL) bvm_pd_memory_free(pl_index);
+	if (pl_profile != NULL) bvm_pd_memory_free(pl_profile);
+
+	pl_files = NULL;
+	pl_index = NULL;
+	pl_profile = NULL;
+}
+
+#endif
@@ -0,0 +1,1853 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#include "../h/bvm.h"
+
+/**
+
+ @file
+
+ A sampling profiler.
+
+ @section ov Overview
+
+ While the profiler is started, every #BVM_PROFILER_SAMPLE_INTERVAL thread switches the stack of the thread that was
+ running is sampled - the methods of its top #BVM_PROFILER_MAX_DEPTH frames and the source line of the top frame.
+ Threads that are switched out because they are blocking or waiting are not sampled.  Each distinct stack is counted
+ in a hash table, so a sample costs a short stack walk and a lookup.
+
+ The counts are written by #bvm_profiler_dump_to_file in the 'collapsed stack' format flame graph tools read - a
+ line per stack with its frames from the bottom of the stack up separated by semi-colons, followed by a space and its
+ sample count:
+
+ @verbatim
+ java/lang/Thread.run;Worker.loop;Worker.crunch:42 117
+ @endverbatim
+
+ The text of a stack is built the first time the stack is seen, so a dump never refers to the methods of clazzes that
+ have since been unloaded.  The sample table is platform memory, not heap - sampling never causes a GC.
+
+ The profiler is started and stopped at runtime through \c babe.lang.Profiler, or for the whole run with the
+ \c -profile command line option, in which case the counts are written to the given file when the VM exits.
+
+ @section mc Method counters
+
+ With #BVM_PROFILER_METHOD_COUNTERS_ENABLE each method also keeps exact counts - its invocations (counted as its frame
+ is pushed), the bytecodes dispatched in it (counted by the interpreter loop), the objects and arrays it allocates, and
+ the milliseconds spent in it.  The time is charged each time the current method changes - at a frame push or pop and
+ at a thread switch - to the method that was running, so it is 'self' time that does not include the methods it
+ calls.  The clock is the platform millisecond clock, so the time of a short method is only right on average.
+
+ The counts are written by #bvm_profiler_method_counts_dump_to_file a line per method that has any, for example:
+
+ @verbatim
+ # invocations bytecodes allocations millis method
+ 1000 35000 1000 12 Worker.crunch(I)I
+ @endverbatim
+
+ The counts live in the methods themselves, so those of an unloaded clazz go with it.  They are written at VM exit with
+ the \c -methodcounts command line option, or at runtime through \c babe.lang.Profiler.
+
+ @section oh Opcode histogram
+
+ With #BVM_PROFILER_OPCODE_HISTOGRAM_ENABLE the interpreter loop counts each opcode as it is dispatched, and each pair
+ of an opcode and the one dispatched before it - whatever the method or thread.  Opcodes are counted as they are found
+ in the bytecode, so quickened and fused opcodes are counted under their own names rather than the opcodes they
+ replaced.  The counts are written by #bvm_profiler_opcodes_dump_to_file, most frequent first, with the
+ \c -opcodes command line option:
+
+ @verbatim
+ # total 35200417
+ # opcode count
+ iload 4400050
+ ...
+ # pair count
+ iload iload 2200011
+ ...
+ @endverbatim
+
+ @section as Allocation sites
+
+ With #BVM_PROFILER_ALLOCATION_SITES_ENABLE every allocation counts its bytes down from a sample interval that averages
+ #BVM_PROFILER_ALLOCATION_SAMPLE_BYTES (each interval is randomised so the samples do not fall into step with a
+ repeating pattern of allocations).  When the count runs out the allocation is sampled - the current method and pc are
+ its site, and the site is given the bytes allocated since the last sample.  A site's bytes are therefore an estimate
+ of what was really allocated there, and its sample count is in proportion to how often it allocated.  Allocations
+ made while the VM boots, or by the VM between bytecodes, are counted against a \c [vm] site.
+
+ The sites are written by #bvm_profiler_allocsites_dump_to_file, most bytes first:
+
+ @verbatim
+ # bytes samples site
+ 1048576 256 Worker.buffer(I)[B pc=3 line=17
+ @endverbatim
+
+ With #BVM_HEAP_DUMP_ENABLE the address of each sampled object or array is remembered (up to
+ #BVM_PROFILER_ALLOCATION_MAX_OBJECTS of them) until its memory is freed, or moved by #bvm_gc_compact.  A heap dump
+ writes a stack trace of one frame for each site, and a remembered object is dumped with the stack trace of its site,
+ so heap tools show where the sampled part of the retained heap was allocated.
+
+ @section mn Monitor contention
+
+ With #BVM_PROFILER_MONITOR_CONTENTION_ENABLE each use of a monitor that may hurt is counted against a site - the
+ clazz of the monitor's object and the method and pc that used it.  A thread that blocks because another owns the
+ monitor is counted as a contended acquisition at the site of its \c monitorenter (or synchronized call), and the
+ time until it is taken off the lock queue is added to the site.  A thread coming back from a \c wait() that has to
+ join the lock queue is counted at the site of the \c wait().  Each \c wait() and each \c notify() or
+ \c notifyAll() of an inflated monitor is counted at its site too - a thin locked object has no waiters, so notifying
+ one is not counted.  Methods of \c java/lang/Object are skipped, so a site is always in the code that called them.
+
+ The sites are written by #bvm_profiler_contention_dump_to_file, most time blocked first:
+
+ @verbatim
+ # contended blocked_us waits notifies monitor site
+ 5120 812340 0 0 java/util/Vector Worker.run()V pc=14 line=22
+ @endverbatim
+
+ The sites are kept in platform memory.  They are written at VM exit with the \c -contention command line option, or
+ at runtime through \c babe.lang.Profiler.
+
+ @section st Startup trace
+
+ With #BVM_PROFILER_STARTUP_TRACE_ENABLE and the \c -starttrace command line option the VM times its own startup on
+ the platform microsecond clock - each phase of #bvm_main and its initialisation, each class load (with the bytes of
+ its class file and how long reading and inflating them took), and each class &lt;clinit&gt;.  Class loads and
+ initialisations are traced for the whole run, not just until the main method starts.  At VM exit the intervals are
+ written by #bvm_profiler_startup_dump_to_file as complete ('X') events of a Chrome trace event file:
+
+ @verbatim
+ {"displayTimeUnit":"ms","traceEvents":[
+ {"name":"vm init","cat":"phase","ph":"X","pid":1,"tid":1,"ts":85,"dur":5120},
+ {"name":"java/lang/String","cat":"load","ph":"X","pid":1,"tid":1,"ts":160,"dur":420,"args":{"bytes":9120,"read_us":210,"inflate_us":150}},
+ ...
+ ]}
+ @endverbatim
+
+ Nested intervals (a class load within a phase, the load of a superclass within the load of its subclass) are shown
+ nested.  Timestamps are microseconds from entry to #bvm_main.  The events are kept as text in platform memory.
+
+ @section pf Native profilers
+
+ With #BVM_PROFILER_PERF_ENABLE the VM helps native sampling profilers like Linux \c perf and eBPF based tools put
+ names to the time spent in Java code.
+
+ With the \c -perfmap command line option each method compiled by #BVM_JIT_ENABLE is written as it is compiled to the
+ \c /tmp/perf-&lt;pid&gt;.map file \c perf looks in for the symbols of generated code - a line per method of the start
+ address and size of its code (in hex) and its name:
+
+ @verbatim
+ 7f3a1c000040 1a0 Worker.crunch(I)I
+ @endverbatim
+
+ The code cache is only ever added to while the VM runs, so a line is never made wrong by code being moved or reused.
+
+ Interpreted code all samples as the interpreter loop, and the interpreter does not recurse in C for each Java call, so
+ no native frame can stand for a Java one.  Instead the VM exports the #bvm_perf_descriptor symbol.  It gives the
+ addresses of the registers holding the running method and the locals of its frame, the offsets (from a frame's
+ locals) of the method and locals of the frame below it, and the offsets of the names of methods and clazzes.  A tool
+ that can read the process memory at a sample - a \c bpf_probe_read program, or a debugger - finds the symbol, checks
+ its magic and version, and walks the Java stack from there.  The method register is always current.  The locals
+ register is only current between bytecodes when #BVM_USE_REGISTERS is not set.  With #BVM_VM_INSTANCES_ENABLE the
+ registers are per-VM, and the descriptor describes those of the VM that initialised last.
+
+ @author Greg McCreath
+ @since 0.0.10
+
+*/
+
+#if BVM_PROFILER_ENABLE
+
+/** The number of buckets in the sample hash table.  A power of two. */
+#define PROFILER_BUCKETS	256
+
+/** A distinct sampled stack and the number of times it was seen */
+typedef struct _profilerstackstruct {
+
+	/** the next stack in the same hash bucket */
+	struct _profilerstackstruct *next;
+
+	/** the hash of the methods and line */
+	bvm_uint32_t hash;
+
+	/** the number of samples of this stack */
+	bvm_uint32_t count;
+
+	/** the source line of the top frame, or -1 */
+	bvm_int32_t line;
+
+	/** the number of frames in #methods */
+	int depth;
+
+	/** the methods from the top of the stack down - only compared, never read after the sample */
+	bvm_method_t *methods[BVM_PROFILER_MAX_DEPTH];
+
+	/** the collapsed stack text */
+	char *text;
+
+} profiler_stack_t;
+
+/** A sample being taken */
+typedef struct {
+	int depth;
+	bvm_uint8_t *pc;
+	bvm_method_t *methods[BVM_PROFILER_MAX_DEPTH];
+} profiler_sample_t;
+
+/** #BVM_TRUE while the profiler is sampling */
+BVM_VM_LOCAL bvm_bool_t bvm_gl_profiler_enabled = BVM_FALSE;
+
+/** If not \c NULL, the profiler runs from startup and writes its counts to this file at VM exit.  Set with the
+ * \c -profile command line option. */
+BVM_VM_LOCAL char *bvm_gl_profiler_filename = NULL;
+
+/** The sample hash table - allocated when the profiler is first started */
+static BVM_VM_LOCAL profiler_stack_t **profiler_stacks = NULL;
+
+/** The number of distinct stacks in #profiler_stacks */
+static BVM_VM_LOCAL bvm_uint32_t profiler_stack_count = 0;
+
+/** The samples not counted against a stack because #BVM_PROFILER_MAX_STACKS was reached */
+static BVM_VM_LOCAL bvm_uint32_t profiler_other_count = 0;
+
+/** Thread switches left until the next sample */
+static BVM_VM_LOCAL bvm_uint32_t profiler_countdown = BVM_PROFILER_SAMPLE_INTERVAL;
+
+/**
+ * Start sampling.  Counts from an earlier start that have not been reset are added to.
+ */
+void bvm_profiler_start() {
+
+	if (profiler_stacks == NULL) {
+		profiler_stacks = bvm_pd_memory_alloc(PROFILER_BUCKETS * sizeof(profiler_stack_t *));
+		if (profiler_stacks == NULL) return;
+		memset(profiler_stacks, 0, PROFILER_BUCKETS * sizeof(profiler_stack_t *));
+	}
+
+	profiler_countdown = BVM_PROFILER_SAMPLE_INTERVAL;
+	bvm_gl_profiler_enabled = BVM_TRUE;
+}
+
+/**
+ * Stop sampling.  The counts so far are kept.
+ */
+void bvm_profiler_stop() {
+	bvm_gl_profiler_enabled = BVM_FALSE;
+}
+
+/**
+ * Throw away all counts.  Sampling carries on if the profiler is started.
+ */
+void bvm_profiler_reset() {
+
+	bvm_uint32_t i;
+
+	if (profiler_stacks == NULL) return;
+
+	for (i = 0; i < PROFILER_BUCKETS; i++) {
+		profiler_stack_t *stack = profiler_stacks[i];
+		while (stack != NULL) {
+			profiler_stack_t *next = stack->next;
+			bvm_pd_memory_free(stack->text);
+			bvm_pd_memory_free(stack);
+			stack = next;
+		}
+		profiler_stacks[i] = NULL;
+	}
+
+	profiler_stack_count = 0;
+	profiler_other_count = 0;
+}
+
+/**
+ * Stop sampling and give all profiler memory back to the platform.
+ */
+void bvm_profiler_release() {
+
+	bvm_profiler_stop();
+	bvm_profiler_reset();
+
+	if (profiler_stacks != NULL) {
+		bvm_pd_memory_free(profiler_stacks);
+		profiler_stacks = NULL;
+	}
+}
+
+/**
+ * A #bvm_stack_visit_callback_t that records the method of each frame of a sample.  Wedge frames are left out.
+ */
+static bvm_bool_t profiler_visit_frame(bvm_stack_frame_info_t *info, void *data) {
+
+	profiler_sample_t *sample = data;
+
+	if ( (info->method == BVM_METHOD_CALLBACKWEDGE) || (info->method == BVM_METHOD_NOOP) ||
+		 (info->method == BVM_METHOD_NOOP_RET) ) return BVM_TRUE;
+
+	if (sample->depth == 0) sample->pc = info->pc;
+
+	sample->methods[sample->depth++] = info->method;
+
+	return (sample->depth < BVM_PROFILER_MAX_DEPTH);
+}
+
+/**
+ * Build the collapsed stack text for a newly seen stack - the frames from the bottom up, the top one with its line.
+ *
+ * @param stack - the stack.
+ * @return the text, or \c NULL if there is no memory for it.
+ */
+static char *profiler_stack_text(profiler_stack_t *stack) {
+
+	size_t length = 16;
+	char *text, *p;
+	int i;
+
+	for (i = 0; i < stack->depth; i++)
+		length += stack->methods[i]->clazz->name->length + stack->methods[i]->name->length + 2;
+
+	if ( (text = bvm_pd_memory_alloc(length)) == NULL) return NULL;
+
+	p = text;
+
+	for (i = stack->depth; i--;) {
+		bvm_method_t *method = stack->methods[i];
+		p += sprintf(p, "%s.%s", method->clazz->name->data, method->name->data);
+		if (i > 0) *p++ = ';';
+	}
+
+	if (stack->line >= 0) sprintf(p, ":%d", (int) stack->line);
+	else *p = '\0';
+
+	return text;
+}
+
+/**
+ * Count a sample of the stack of the current thread.
+ */
+static void profiler_sample() {
+
+	profiler_sample_t sample;
+	profiler_stack_t *stack;
+	bvm_uint32_t hash;
+	bvm_int32_t line = -1;
+	int i;
+
+	sample.depth = 0;
+	sample.pc = NULL;
+
+	bvm_stack_visit(bvm_gl_thread_current, 0, -1, NULL, profiler_visit_frame, &sample);
+
+	if (sample.depth == 0) return;
+
+#if (BVM_LINE_NUMBERS_ENABLE || BVM_DEBUGGER_ENABLE)
+	if (!BVM_METHOD_IsNative(sample.methods[0]))
+		line = bvm_clazz_get_source_line(sample.methods[0], sample.pc);
+#endif
+
+	/* FNV-1a over the method addresses and the line */
+	hash = 2166136261u ^ (bvm_uint32_t) line;
+	for (i = 0; i < sample.depth; i++)
+		hash = (hash ^ (bvm_uint32_t) ((bvm_native_ulong_t) sample.methods[i] >> 3)) * 16777619u;
+
+	for (stack = profiler_stacks[hash & (PROFILER_BUCKETS - 1)]; stack != NULL; stack = stack->next) {
+		if ( (stack->hash == hash) && (stack->line == line) && (stack->depth == sample.depth) &&
+			 (memcmp(stack->methods, sample.methods, sample.depth * sizeof(bvm_method_t *)) == 0) ) {
+			stack->count++;
+			return;
+		}
+	}
+
+	/* a new stack */
+	if ( (profiler_stack_count >= BVM_PROFILER_MAX_STACKS) ||
+		 ( (stack = bvm_pd_memory_alloc(sizeof(profiler_stack_t))) == NULL) ) {
+		profiler_other_count++;
+		return;
+	}
+
+	stack->hash = hash;
+	stack->count = 1;
+	stack->line = line;
+	stack->depth = sample.depth;
+	memcpy(stack->methods, sample.methods, sample.depth * sizeof(bvm_method_t *));
+
+	if ( (stack->text = profiler_stack_text(stack)) == NULL) {
+		bvm_pd_memory_free(stack);
+		profiler_other_count++;
+		return;
+	}
+
+	stack->next = profiler_stacks[hash & (PROFILER_BUCKETS - 1)];
+	profiler_stacks[hash & (PROFILER_BUCKETS - 1)] = stack;
+	profiler_stack_count++;
+}
+
+/**
+ * Called at each thread switch while the profiler is started (see #bvm_gl_profiler_enabled).  Every
+ * #BVM_PROFILER_SAMPLE_INTERVAL calls the current thread is sampled if it is still runnable - that is, its
+ * timeslice ran out rather than it blocking.
+ */
+void bvm_profiler_tick() {
+
+	if (--profiler_countdown > 0) return;
+
+	profiler_countdown = BVM_PROFILER_SAMPLE_INTERVAL;
+
+	if ( (bvm_gl_thread_current != NULL) && (bvm_gl_thread_current->status == BVM_THREAD_STATUS_RUNNABLE) )
+		profiler_sample();
+}
+
+/**
+ * Write the profiler counts to a file in collapsed stack format.  An existing file is overwritten.  The counts are
+ * kept - see #bvm_profiler_reset.
+ *
+ * @param filename - the name of the file.
+ * @return #BVM_TRUE if the counts were written, #BVM_FALSE if the file could not be opened or written.
+ */
+bvm_bool_t bvm_profiler_dump_to_file(const char *filename) {
+
+	char line[32];
+	bvm_bool_t result = BVM_TRUE;
+	bvm_uint32_t i;
+	void *handle = bvm_pd_file_open(filename, BVM_FILE_O_WRONLY | BVM_FILE_O_TRUNC);
+
+	if (handle == NULL) return BVM_FALSE;
+
+	for (i = 0; (profiler_stacks != NULL) && (i < PROFILER_BUCKETS); i++) {
+
+		profiler_stack_t *stack;
+
+		for (stack = profiler_stacks[i]; stack != NULL; stack = stack->next) {
+			size_t length = strlen(stack->text);
+			size_t count_length = sprintf(line, " %lu\n", (unsigned long) stack->count);
+			if ( (bvm_pd_file_write(stack->text, length, handle) != length) ||
+				 (bvm_pd_file_write(line, count_length, handle) != count_length) ) result = BVM_FALSE;
+		}
+	}
+
+	if (profiler_other_count > 0) {
+		size_t count_length = sprintf(line, "[other] %lu\n", (unsigned long) profiler_other_count);
+		if (bvm_pd_file_write(line, count_length, handle) != count_length) result = BVM_FALSE;
+	}
+
+	if (bvm_pd_file_close(handle) == BVM_ERR) result = BVM_FALSE;
+
+	return result;
+}
+
+#endif
+
+#if BVM_PROFILER_METHOD_COUNTERS_ENABLE
+
+/** If not \c NULL, the method counts are written to this file at VM exit.  Set with the \c -methodcounts command line
+ * option. */
+BVM_VM_LOCAL char *bvm_gl_profiler_method_counts_filename = NULL;
+
+/** The platform time at the last method switch */
+static BVM_VM_LOCAL bvm_int64_t profiler_method_last_time;
+
+/** #BVM_TRUE once #profiler_method_last_time has been taken */
+static BVM_VM_LOCAL bvm_bool_t profiler_method_clock_started = BVM_FALSE;
+
+/**
+ * Charge the milliseconds since the last call to the current method.  Called just before the current method changes.
+ */
+void bvm_profiler_method_time() {
+
+	bvm_int64_t now = bvm_pd_system_time();
+
+	if (profiler_method_clock_started && (bvm_gl_rx_method != NULL)) {
+
+		bvm_int64_t elapsed = now;
+		bvm_uint32_t millis;
+
+		BVM_INT64_decrease(elapsed, profiler_method_last_time);
+		BVM_INT64_int64_to_uint32(elapsed, millis);
+
+		bvm_gl_rx_method->counter_millis += millis;
+	}
+
+	profiler_method_last_time = now;
+	profiler_method_clock_started = BVM_TRUE;
+}
+
+/**
+ * Zero the counts of every method of every loaded clazz.
+ */
+void bvm_profiler_method_counts_reset() {
+
+	int i;
+
+	if (bvm_gl_clazz_pool == NULL) return;
+
+	for (i = bvm_gl_clazz_pool_bucketcount; i--;) {
+
+		bvm_clazz_t *clazz;
+
+		for (clazz = bvm_gl_clazz_pool[i]; clazz != NULL; clazz = clazz->next) {
+
+			bvm_instance_clazz_t *inst_clazz = (bvm_instance_clazz_t *) clazz;
+			bvm_uint16_t j;
+
+			if (!BVM_CLAZZ_IsInstanceClazz(clazz)) continue;
+
+			for (j = 0; j < inst_clazz->methods_count; j++) {
+				bvm_method_t *method = &inst_clazz->methods[j];
+				method->counter_invocations = 0;
+				method->counter_bytecodes = 0;
+				method->counter_allocations = 0;
+				method->counter_millis = 0;
+			}
+		}
+	}
+}
+
+/**
+ * Write the counts of each method of each loaded clazz that has any to a file - a line per method with its
+ * invocations, bytecodes, allocations, milliseconds, and name.  An existing file is overwritten.  The counts are kept -
+ * see #bvm_profiler_method_counts_reset.
+ *
+ * @param filename - the name of the file.
+ * @return #BVM_TRUE if the counts were written, #BVM_FALSE if the file could not be opened or written.
+ */
+bvm_bool_t bvm_profiler_method_counts_dump_to_file(const char *filename) {
+
+	static const char header[] = "# invocations bytecodes allocations millis method\n";
+	char counts[64];
+	bvm_bool_t result = BVM_TRUE;
+	int i;
+	void *handle = bvm_pd_file_open(filename, BVM_FILE_O_WRONLY | BVM_FILE_O_TRUNC);
+
+	if (handle == NULL) return BVM_FALSE;
+
+	if (bvm_pd_file_write(header, sizeof(header) - 1, handle) != sizeof(header) - 1) result = BVM_FALSE;
+
+	for (i = (bvm_gl_clazz_pool == NULL) ? 0 : bvm_gl_clazz_pool_bucketcount; i--;) {
+
+		bvm_clazz_t *clazz;
+
+		for (clazz = bvm_gl_clazz_pool[i]; clazz != NULL; clazz = clazz->next) {
+
+			bvm_instance_clazz_t *inst_clazz = (bvm_instance_clazz_t *) clazz;
+			bvm_uint16_t j;
+
+			if (!BVM_CLAZZ_IsInstanceClazz(clazz)) continue;
+
+			for (j = 0; j < inst_clazz->methods_count; j++) {
+
+				bvm_method_t *method = &inst_clazz->methods[j];
+				size_t length;
+
+				if ( (method->counter_invocations == 0) && (method->counter_bytecodes == 0) &&
+					 (method->counter_allocations == 0) && (method->counter_millis == 0) ) continue;
+
+				length = sprintf(counts, "%lu %lu %lu %lu ", (unsigned long) method->counter_invocations,
+								 (unsigned long) method->counter_bytecodes, (unsigned long) method->counter_allocations,
+								 (unsigned long) method->counter_millis);
+
+				if ( (bvm_pd_file_write(counts, length, handle) != length) ||
+					 (bvm_pd_file_write(clazz->name->data, clazz->name->length, handle) != clazz->name->length) ||
+					 (bvm_pd_file_write(".", 1, handle) != 1) ||
+					 (bvm_pd_file_write(method->name->data, method->name->length, handle) != method->name->length) ||
+					 (bvm_pd_file_write(method->jni_signature->data, method->jni_signature->length, handle) != method->jni_signature->length) ||
+					 (bvm_pd_file_write("\n", 1, handle) != 1) ) result = BVM_FALSE;
+			}
+		}
+	}
+
+	if (bvm_pd_file_close(handle) == BVM_ERR) result = BVM_FALSE;
+
+	return result;
+}
+
+#endif
+
+#if BVM_PROFILER_OPCODE_HISTOGRAM_ENABLE
+
+/** If not \c NULL, the opcode histogram is written to this file at VM exit.  Set with the \c -opcodes command line
+ * option. */
+BVM_VM_LOCAL char *bvm_gl_profiler_opcodes_filename = NULL;
+
+/** The number of times each opcode has been dispatched */
+BVM_VM_LOCAL bvm_native_ulong_t bvm_gl_profiler_opcode_counts[256];
+
+/** The number of times each pair of opcodes has been dispatched one after the other, indexed by the first opcode
+ * times 256 plus the second */
+BVM_VM_LOCAL bvm_native_ulong_t bvm_gl_profiler_opcode_pair_counts[256 * 256];
+
+/** The last opcode dispatched */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_profiler_opcode_previous = OPCODE_nop;
+
+/** The name of each opcode - those the VM does not use are numbered */
+static const char *profiler_opcode_names[256] = {
+	"nop", "aconst_null", "iconst_m1", "iconst_0", "iconst_1", "iconst_2", "iconst_3", "iconst_4",
+	"iconst_5", "lconst_0", "lconst_1", "fconst_0", "fconst_1", "fconst_2", "dconst_0", "dconst_1",
+	"bipush", "sipush", "ldc", "ldc_w", "ldc2_w", "iload", "lload", "fload",
+	"dload", "aload", "iload_0", "iload_1", "iload_2", "iload_3", "lload_0", "lload_1",
+	"lload_2", "lload_3", "fload_0", "fload_1", "fload_2", "fload_3", "dload_0", "dload_1",
+	"dload_2", "dload_3", "aload_0", "aload_1", "aload_2", "aload_3", "iaload", "laload",
+	"faload", "daload", "aaload", "baload", "caload", "saload", "istore", "lstore",
+	"fstore", "dstore", "astore", "istore_0", "istore_1", "istore_2", "istore_3", "lstore_0",
+	"lstore_1", "lstore_2", "lstore_3", "fstore_0", "fstore_1", "fstore_2", "fstore_3", "dstore_0",
+	"dstore_1", "dstore_2", "dstore_3", "astore_0", "astore_1", "astore_2", "astore_3", "iastore",
+	"lastore", "fastore", "dastore", "aastore", "bastore", "castore", "sastore", "pop",
+	"pop2", "dup", "dup_x1", "dup_x2", "dup2", "dup2_x1", "dup2_x2", "swap",
+	"iadd", "ladd", "fadd", "dadd", "isub", "lsub", "fsub", "dsub",
+	"imul", "lmul", "fmul", "dmul", "idiv", "ldiv", "fdiv", "ddiv",
+	"irem", "lrem", "frem", "drem", "ineg", "lneg", "fneg", "dneg",
+	"ishl", "lshl", "ishr", "lshr", "iushr", "lushr", "iand", "land",
+	"ior", "lor", "ixor", "lxor", "iinc", "i2l", "i2f", "i2d",
+	"l2i", "l2f", "l2d", "f2i", "f2l", "f2d", "d2i", "d2l",
+	"d2f", "i2b", "i2c", "i2s", "lcmp", "fcmpl", "fcmpg", "dcmpl",
+	"dcmpg", "ifeq", "ifne", "iflt", "ifge", "ifgt", "ifle", "if_icmpeq",
+	"if_icmpne", "if_icmplt", "if_icmpge", "if_icmpgt", "if_icmple", "if_acmpeq", "if_acmpne", "goto",
+	"jsr", "ret", "tableswitch", "lookupswitch", "ireturn", "lreturn", "freturn", "dreturn",
+	"areturn", "return", "getstatic", "putstatic", "getfield", "putfield", "invokevirtual", "invokespecial",
+	"invokestatic", "invokeinterface", "186", "new", "newarray", "anewarray", "arraylength", "athrow",
+	"checkcast", "instanceof", "monitorenter", "monitorexit", "wide", "multianewarray", "ifnull", "ifnonnull",
+	"goto_w", "jsr_w", "breakpoint", "pop_for_exception", "204", "205", "206", "207",
+	"208", "209", "210", "211", "212", "213", "214", "215",
+	"ldc_fast_1", "ldc_fast_2", "ldc_w_fast_1", "ldc_w_fast_2", "getstatic_fast", "getstatic_fast_long", "putstatic_fast", "putstatic_fast_long",
+	"getfield_fast", "getfield_fast_long", "putfield_fast", "putfield_fast_long", "new_fast", "invokestatic_fast", "invokespecial_fast", "invokeinterface_fast",
+	"invokevirtual_fast", "aload_0_getfield", "iload_iload", "iload_iload_if_icmp", "aload_arraylength", "invokestatic_intrinsic", "invokevirtual_intrinsic", "invokevirtual_getter",
+	"invokevirtual_setter", "invokespecial_getter", "invokespecial_setter", "getfield_fast_packed", "putfield_fast_packed", "getstatic_fast_constant", "tableswitch_fast", "lookupswitch_fast",
+	"new_concat", "249", "250", "251", "252", "253", "impdep1", "impdep2"
+};
+
+/** The counts being sorted by #profiler_compare_counts */
+static BVM_VM_LOCAL bvm_native_ulong_t *profiler_sort_counts;
+
+/**
+ * A \c qsort comparison of two indexes into #profiler_sort_counts - the index with the higher count first, and
+ * the lower index first for equal counts.
+ */
+static int profiler_compare_counts(const void *a, const void *b) {
+
+	bvm_uint32_t index_a = *(const bvm_uint32_t *) a;
+	bvm_uint32_t index_b = *(const bvm_uint32_t *) b;
+
+	if (profiler_sort_counts[index_a] != profiler_sort_counts[index_b])
+		return (profiler_sort_counts[index_a] > profiler_sort_counts[index_b]) ? -1 : 1;
+
+	return (index_a < index_b) ? -1 : 1;
+}
+
+/**
+ * Write the indexes of a table of counts that are not zero, highest count first.
+ *
+ * @param counts - the counts.
+ * @param size - the number of counts.
+ * @param pairs - #BVM_TRUE if the counts are #bvm_gl_profiler_opcode_pair_counts.
+ * @param handle - the file to write to.
+ * @return #BVM_TRUE if the counts were written, #BVM_FALSE if the file could not be written or there was no memory
+ * to sort them.
+ */
+static bvm_bool_t profiler_write_sorted_counts(bvm_native_ulong_t *counts, bvm_uint32_t size, bvm_bool_t pairs,
+											   void *handle) {
+
+	char line[96];
+	bvm_bool_t result = BVM_TRUE;
+	bvm_uint32_t i, nr_indexes = 0;
+	bvm_uint32_t *indexes = bvm_pd_memory_alloc(size * sizeof(bvm_uint32_t));
+
+	if (indexes == NULL) return BVM_FALSE;
+
+	for (i = 0; i < size; i++)
+		if (counts[i] != 0) indexes[nr_indexes++] = i;
+
+	profiler_sort_counts = counts;
+	qsort(indexes, nr_indexes, sizeof(bvm_uint32_t), profiler_compare_counts);
+
+	for (i = 0; i < nr_indexes; i++) {
+
+		size_t length;
+
+		if (pairs)
+			length = sprintf(line, "%s %s %lu\n", profiler_opcode_names[indexes[i] >> 8],
+							 profiler_opcode_names[indexes[i] & 0xFF], (unsigned long) counts[indexes[i]]);
+		else
+			length = sprintf(line, "%s %lu\n", profiler_opcode_names[indexes[i]], (unsigned long) counts[indexes[i]]);
+
+		if (bvm_pd_file_write(line, length, handle) != length) result = BVM_FALSE;
+	}
+
+	bvm_pd_memory_free(indexes);
+
+	return result;
+}
+
+/**
+ * Write the opcode histogram to a file - the total number of opcodes dispatched, then the count of each opcode
+ * dispatched, then the count of each pair of opcodes dispatched one after the other, each most frequent first.  An
+ * existing file is overwritten.
+ *
+ * @param filename - the name of the file.
+ * @return #BVM_TRUE if the histogram was written, #BVM_FALSE if the file could not be opened or written.
+ */
+bvm_bool_t bvm_profiler_opcodes_dump_to_file(const char *filename) {
+
+	char line[64];
+	size_t length;
+	bvm_native_ulong_t total = 0;
+	bvm_bool_t result = BVM_TRUE;
+	bvm_uint32_t i;
+	void *handle = bvm_pd_file_open(filename, BVM_FILE_O_WRONLY | BVM_FILE_O_TRUNC);
+
+	if (handle == NULL) return BVM_FALSE;
+
+	for (i = 0; i < 256; i++)
+		total += bvm_gl_profiler_opcode_counts[i];
+
+	length = sprintf(line, "# total %lu\n# opcode count\n", (unsigned long) total);
+	if (bvm_pd_file_write(line, length, handle) != length) result = BVM_FALSE;
+
+	if (!profiler_write_sorted_counts(bvm_gl_profiler_opcode_counts, 256, BVM_FALSE, handle)) result = BVM_FALSE;
+
+	length = sprintf(line, "# pair count\n");
+	if (bvm_pd_file_write(line, length, handle) != length) result = BVM_FALSE;
+
+	if (!profiler_write_sorted_counts(bvm_gl_profiler_opcode_pair_counts, 256 * 256, BVM_TRUE, handle)) result = BVM_FALSE;
+
+	if (bvm_pd_file_close(handle) == BVM_ERR) result = BVM_FALSE;
+
+	return result;
+}
+
+#endif
+
+#if BVM_PROFILER_ALLOCATION_SITES_ENABLE
+
+/** The number of buckets in the allocation site hash table.  A power of two. */
+#define PROFILER_SITE_BUCKETS	256
+
+/** A distinct allocation site, and what has been sampled there */
+typedef struct _profilersitestruct {
+
+	/** the next site in the same hash bucket */
+	struct _profilersitestruct *next;
+
+	/** the allocating method, or \c NULL for the VM - only compared, never read after the sample */
+	bvm_method_t *method;
+
+	/** the offset of the allocating pc in the bytecode, or -1 for a native method or the VM */
+	bvm_int32_t pc;
+
+	/** the source line of the pc, \c -1 if not known, or \c -3 for a native method */
+	bvm_int32_t line;
+
+	/** the serial number of the site - from 1 in the order the sites were first seen */
+	bvm_uint32_t serial;
+
+	/** the number of samples at this site */
+	bvm_uint32_t samples;
+
+	/** the bytes the samples at this site stand for */
+	bvm_native_ulong_t bytes;
+
+	/** the site's text */
+	char *text;
+
+} profiler_site_t;
+
+/** If not \c NULL, the allocation sites are written to this file at VM exit.  Set with the \c -allocsites command
+ * line option. */
+BVM_VM_LOCAL char *bvm_gl_profiler_allocsites_filename = NULL;
+
+/** The bytes left to allocate until the next sample.  An allocation that takes it to zero or below is sampled. */
+BVM_VM_LOCAL bvm_int32_t bvm_gl_profiler_allocation_countdown = BVM_PROFILER_ALLOCATION_SAMPLE_BYTES;
+
+/** The countdown the current sample interval started from */
+static BVM_VM_LOCAL bvm_int32_t profiler_allocation_interval = BVM_PROFILER_ALLOCATION_SAMPLE_BYTES;
+
+/** The state of the generator of sample intervals */
+static BVM_VM_LOCAL bvm_uint32_t profiler_allocation_seed = 1;
+
+/** The allocation site hash table - allocated at the first sample */
+static BVM_VM_LOCAL profiler_site_t **profiler_sites = NULL;
+
+/** The number of distinct sites in #profiler_sites */
+static BVM_VM_LOCAL bvm_uint32_t profiler_site_count = 0;
+
+/** The samples not counted against a site because #BVM_PROFILER_ALLOCATION_MAX_SITES was reached, and the bytes they
+ * stand for */
+static BVM_VM_LOCAL bvm_uint32_t profiler_other_site_samples = 0;
+static BVM_VM_LOCAL bvm_native_ulong_t profiler_other_site_bytes = 0;
+
+#if BVM_HEAP_DUMP_ENABLE
+
+/** A sampled object still alive, and its site */
+typedef struct {
+	void *ptr;
+	profiler_site_t *site;
+} profiler_object_t;
+
+/** The sampled objects - an open addressed hash table of #BVM_PROFILER_ALLOCATION_MAX_OBJECTS entries, keyed by
+ * address.  Allocated at the first sample. */
+static BVM_VM_LOCAL profiler_object_t *profiler_objects = NULL;
+
+/** The number of objects in #profiler_objects */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_profiler_allocation_object_count = 0;
+
+/** The slot an address hashes to in #profiler_objects */
+#define PROFILER_OBJECT_HASH(p) (profiler_object_hash(p) & (BVM_PROFILER_ALLOCATION_MAX_OBJECTS - 1))
+
+/** Hash an address, mixing the high bits into the low */
+static bvm_uint32_t profiler_object_hash(void *ptr) {
+	bvm_uint32_t hash = (bvm_uint32_t) ((bvm_native_ulong_t) ptr >> 3) * 2654435761u;
+	return hash ^ (hash >> 16);
+}
+
+/**
+ * Whether memory of an alloc type is a Java object or array.
+ */
+static bvm_bool_t profiler_is_object_type(int alloc_type) {
+
+	switch (alloc_type) {
+		case BVM_ALLOC_TYPE_OBJECT:
+		case BVM_ALLOC_TYPE_STRING:
+		case BVM_ALLOC_TYPE_WEAK_REFERENCE:
+		case BVM_ALLOC_TYPE_SOFT_REFERENCE:
+		case BVM_ALLOC_TYPE_EPHEMERON:
+		case BVM_ALLOC_TYPE_ARRAY_OF_OBJECT:
+		case BVM_ALLOC_TYPE_ARRAY_OF_PRIMITIVE:
+			return BVM_TRUE;
+	}
+
+	return BVM_FALSE;
+}
+
+/**
+ * Remember the site of a sampled object.  The table is kept no more than three quarters full - past that, objects are
+ * sampled but their site is not remembered.
+ *
+ * @param ptr - the object.
+ * @param site - its site.
+ */
+static void profiler_object_add(void *ptr, profiler_site_t *site) {
+
+	bvm_uint32_t i;
+
+	if (bvm_gl_profiler_allocation_object_count >= (BVM_PROFILER_ALLOCATION_MAX_OBJECTS / 4) * 3) return;
+
+	if (profiler_objects == NULL) {
+		profiler_objects = bvm_pd_memory_alloc(BVM_PROFILER_ALLOCATION_MAX_OBJECTS * sizeof(profiler_object_t));
+		if (profiler_objects == NULL) return;
+		memset(profiler_objects, 0, BVM_PROFILER_ALLOCATION_MAX_OBJECTS * sizeof(profiler_object_t));
+	}
+
+	for (i = PROFILER_OBJECT_HASH(ptr); profiler_objects[i].ptr != NULL; i = (i + 1) & (BVM_PROFILER_ALLOCATION_MAX_OBJECTS - 1)) {
+		/* the same memory sampled again without being seen freed */
+		if (profiler_objects[i].ptr == ptr) break;
+	}
+
+	if (profiler_objects[i].ptr == NULL) bvm_gl_profiler_allocation_object_count++;
+
+	profiler_objects[i].ptr = ptr;
+	profiler_objects[i].site = site;
+}
+
+/**
+ * Find the slot of an object in #profiler_objects.
+ *
+ * @param ptr - the object.
+ * @return its slot, or -1 if it is not there.
+ */
+static bvm_int32_t profiler_object_find(void *ptr) {
+
+	bvm_uint32_t i;
+
+	if (profiler_objects == NULL) return -1;
+
+	for (i = PROFILER_OBJECT_HASH(ptr); profiler_objects[i].ptr != NULL; i = (i + 1) & (BVM_PROFILER_ALLOCATION_MAX_OBJECTS - 1)) {
+		if (profiler_objects[i].ptr == ptr) return (bvm_int32_t) i;
+	}
+
+	return -1;
+}
+
+/**
+ * Forget the site of the sampled object at a given address as its memory is freed.  The entries after it in the same
+ * run of the table are moved back so that no lookup stops short of them.
+ *
+ * @param ptr - the address of the user data of the freed chunk.
+ */
+void bvm_profiler_allocation_freed(void *ptr) {
+
+	bvm_int32_t found = profiler_object_find(ptr);
+	bvm_uint32_t i, j;
+
+	if (found < 0) return;
+
+	i = j = (bvm_uint32_t) found;
+
+	while (BVM_TRUE) {
+
+		bvm_uint32_t home;
+
+		j = (j + 1) & (BVM_PROFILER_ALLOCATION_MAX_OBJECTS - 1);
+
+		if (profiler_objects[j].ptr == NULL) break;
+
+		home = PROFILER_OBJECT_HASH(profiler_objects[j].ptr);
+
+		/* an entry whose home slot is cyclically after the gap and up to itself stays where it is */
+		if ( (i <= j) ? ( (i < home) && (home <= j) ) : ( (i < home) || (home <= j) ) ) continue;
+
+		profiler_objects[i] = profiler_objects[j];
+		i = j;
+	}
+
+	profiler_objects[i].ptr = NULL;
+	bvm_gl_profiler_allocation_object_count--;
+}
+
+/**
+ * Give each remembered object the address it is being moved to by heap compaction.
+ *
+ * @param forward - gives the new address of an object.
+ */
+void bvm_profiler_allocation_forward(bvm_obj_t *(*forward)(bvm_obj_t *)) {
+
+	profiler_object_t *old_objects;
+	bvm_uint32_t i;
+
+	if (bvm_gl_profiler_allocation_object_count == 0) return;
+
+	old_objects = bvm_pd_memory_alloc(BVM_PROFILER_ALLOCATION_MAX_OBJECTS * sizeof(profiler_object_t));
+
+	/* no memory to rehash - forget them all */
+	if (old_objects != NULL)
+		memcpy(old_objects, profiler_objects, BVM_PROFILER_ALLOCATION_MAX_OBJECTS * sizeof(profiler_object_t));
+
+	memset(profiler_objects, 0, BVM_PROFILER_ALLOCATION_MAX_OBJECTS * sizeof(profiler_object_t));
+	bvm_gl_profiler_allocation_object_count = 0;
+
+	if (old_objects == NULL) return;
+
+	for (i = 0; i < BVM_PROFILER_ALLOCATION_MAX_OBJECTS; i++) {
+		if (old_objects[i].ptr != NULL)
+			profiler_object_add(forward(old_objects[i].ptr), old_objects[i].site);
+	}
+
+	bvm_pd_memory_free(old_objects);
+}
+
+/**
+ * Give the serial number of the site of a sampled object.
+ *
+ * @param ptr - an object.
+ * @return the serial number of its site, or \c 0 if its site is not known.
+ */
+bvm_uint32_t bvm_profiler_allocation_site_serial(void *ptr) {
+
+	bvm_int32_t found = profiler_object_find(ptr);
+
+	return (found < 0) ? 0 : profiler_objects[found].site->serial;
+}
+
+/**
+ * Call a function for each allocation site.
+ *
+ * @param callback - the function.
+ */
+void bvm_profiler_allocsites_visit(bvm_profiler_site_callback_t callback) {
+
+	bvm_uint32_t i;
+	profiler_site_t *site;
+
+	for (i = 0; (profiler_sites != NULL) && (i < PROFILER_SITE_BUCKETS); i++) {
+		for (site = profiler_sites[i]; site != NULL; site = site->next)
+			callback(site->serial, site->text, site->line);
+	}
+}
+
+#endif
+
+/**
+ * Build the text of a newly seen allocation site.
+ *
+ * @param site - the site.
+ * @return the text, or \c NULL if there is no memory for it.
+ */
+static char *profiler_site_text(profiler_site_t *site) {
+
+	bvm_method_t *method = site->method;
+	char *text;
+
+	if (method == NULL) {
+		if ( (text = bvm_pd_memory_alloc(5)) != NULL) strcpy(text, "[vm]");
+		return text;
+	}
+
+	text = bvm_pd_memory_alloc(method->clazz->name->length + method->name->length + method->jni_signature->length + 32);
+	if (text == NULL) return NULL;
+
+	sprintf(text, "%s.%s%s", method->clazz->name->data, method->name->data, method->jni_signature->data);
+
+	if (site->pc < 0)
+		strcat(text, " native");
+	else if (site->line >= 0)
+		sprintf(text + strlen(text), " pc=%d line=%d", (int) site->pc, (int) site->line);
+	else
+		sprintf(text + strlen(text), " pc=%d", (int) site->pc);
+
+	return text;
+}
+
+/**
+ * Sample an allocation - called by #BVM_PROFILER_SAMPLE_ALLOCATION when the countdown to the next sample runs out.
+ * The site of the allocation is the current method and pc.  A new sample interval is started.
+ *
+ * @param ptr - the allocated memory.
+ * @param size - its size.
+ * @param alloc_type - its alloc type.
+ */
+void bvm_profiler_allocation_sample(void *ptr, size_t size, int alloc_type) {
+
+	bvm_method_t *method = bvm_gl_rx_method;
+	bvm_native_ulong_t bytes = (bvm_native_ulong_t) (profiler_allocation_interval - bvm_gl_profiler_allocation_countdown);
+	bvm_int32_t pc = -1, line = -1;
+	bvm_uint32_t hash;
+	profiler_site_t *site;
+
+	UNUSED(size);
+
+	/* the next interval is between a half and one and a half times the average */
+	profiler_allocation_seed = profiler_allocation_seed * 1103515245u + 12345u;
+	profiler_allocation_interval = (BVM_PROFILER_ALLOCATION_SAMPLE_BYTES / 2) +
+		(bvm_int32_t) ((profiler_allocation_seed >> 8) % BVM_PROFILER_ALLOCATION_SAMPLE_BYTES);
+	bvm_gl_profiler_allocation_countdown = profiler_allocation_interval;
+
+	if (profiler_sites == NULL) {
+		profiler_sites = bvm_pd_memory_alloc(PROFILER_SITE_BUCKETS * sizeof(profiler_site_t *));
+		if (profiler_sites == NULL) return;
+		memset(profiler_sites, 0, PROFILER_SITE_BUCKETS * sizeof(profiler_site_t *));
+	}
+
+	/* the wedge methods are not real methods - count them as the VM */
+	if ( (method == BVM_METHOD_CALLBACKWEDGE) || (method == BVM_METHOD_NOOP) || (method == BVM_METHOD_NOOP_RET) )
+		method = NULL;
+
+	if (method != NULL) {
+		if (BVM_METHOD_IsNative(method))
+			line = -3;
+		else {
+			pc = (bvm_int32_t) (bvm_gl_rx_pc - method->code.bytecode);
+#if (BVM_LINE_NUMBERS_ENABLE || BVM_DEBUGGER_ENABLE)
+			line = bvm_clazz_get_source_line(method, bvm_gl_rx_pc);
+#endif
+		}
+	}
+
+	hash = (bvm_uint32_t) ((bvm_native_ulong_t) method >> 3) * 31 + (bvm_uint32_t) pc;
+	hash = (hash ^ (hash >> 8)) & (PROFILER_SITE_BUCKETS - 1);
+
+	for (site = profiler_sites[hash]; site != NULL; site = site->next) {
+		if ( (site->method == method) && (site->pc == pc) ) break;
+	}
+
+	if (site == NULL) {
+
+		if ( (profiler_site_count >= BVM_PROFILER_ALLOCATION_MAX_SITES) ||
+			 ( (site = bvm_pd_memory_alloc(sizeof(profiler_site_t))) == NULL) ) {
+			profiler_other_site_samples++;
+			profiler_other_site_bytes += bytes;
+			return;
+		}
+
+		site->method = method;
+		site->pc = pc;
+		site->line = line;
+		site->serial = profiler_site_count + 1;
+		site->samples = 0;
+		site->bytes = 0;
+
+		if ( (site->text = profiler_site_text(site)) == NULL) {
+			bvm_pd_memory_free(site);
+			profiler_other_site_samples++;
+			profiler_other_site_bytes += bytes;
+			return;
+		}
+
+		site->next = profiler_sites[hash];
+		profiler_sites[hash] = site;
+		profiler_site_count++;
+	}
+
+	site->samples++;
+	site->bytes += bytes;
+
+#if BVM_HEAP_DUMP_ENABLE
+	if (profiler_is_object_type(alloc_type)) profiler_object_add(ptr, site);
+#else
+	UNUSED(ptr);
+	UNUSED(alloc_type);
+#endif
+}
+
+/**
+ * A \c qsort comparison of two sites - the one with the most bytes first, and the first seen first for equal bytes.
+ */
+static int profiler_compare_sites(const void *a, const void *b) {
+
+	const profiler_site_t *site_a = *(profiler_site_t * const *) a;
+	const profiler_site_t *site_b = *(profiler_site_t * const *) b;
+
+	if (site_a->bytes != site_b->bytes) return (site_a->bytes > site_b->bytes) ? -1 : 1;
+
+	return (site_a->serial < site_b->serial) ? -1 : 1;
+}
+
+/**
+ * Write the allocation sites to a file, most bytes first - a line per site with its bytes, samples and text.  An
+ * existing file is overwritten.
+ *
+ * @param filename - the name of the file.
+ * @return #BVM_TRUE if the sites were written, #BVM_FALSE if the file could not be opened or written, or there was no
+ * memory to sort them.
+ */
+bvm_bool_t bvm_profiler_allocsites_dump_to_file(const char *filename) {
+
+	static const char header[] = "# bytes samples site\n";
+	char line[48];
+	bvm_bool_t result = BVM_TRUE;
+	profiler_site_t **sorted = NULL;
+	profiler_site_t *site;
+	bvm_uint32_t i, count = 0;
+	void *handle = bvm_pd_file_open(filename, BVM_FILE_O_WRONLY | BVM_FILE_O_TRUNC);
+
+	if (handle == NULL) return BVM_FALSE;
+
+	if (bvm_pd_file_write(header, sizeof(header) - 1, handle) != sizeof(header) - 1) result = BVM_FALSE;
+
+	if (profiler_site_count > 0) {
+
+		if ( (sorted = bvm_pd_memory_alloc(profiler_site_count * sizeof(profiler_site_t *))) == NULL) {
+			bvm_pd_file_close(handle);
+			return BVM_FALSE;
+		}
+
+		for (i = 0; i < PROFILER_SITE_BUCKETS; i++) {
+			for (site = profiler_sites[i]; site != NULL; site = site->next)
+				sorted[count++] = site;
+		}
+
+		qsort(sorted, count, sizeof(profiler_site_t *), profiler_compare_sites);
+	}
+
+	for (i = 0; i < count; i++) {
+
+		size_t count_length = sprintf(line, "%lu %lu ", (unsigned long) sorted[i]->bytes, (unsigned long) sorted[i]->samples);
+		size_t length = strlen(sorted[i]->text);
+
+		if ( (bvm_pd_file_write(line, count_length, handle) != count_length) ||
+			 (bvm_pd_file_write(sorted[i]->text, length, handle) != length) ||
+			 (bvm_pd_file_write("\n", 1, handle) != 1) ) result = BVM_FALSE;
+	}
+
+	if (profiler_other_site_samples > 0) {
+		size_t count_length = sprintf(line, "%lu %lu [other]\n", (unsigned long) profiler_other_site_bytes,
+									  (unsigned long) profiler_other_site_samples);
+		if (bvm_pd_file_write(line, count_length, handle) != count_length) result = BVM_FALSE;
+	}
+
+	if (sorted != NULL) bvm_pd_memory_free(sorted);
+
+	if (bvm_pd_file_close(handle) == BVM_ERR) result = BVM_FALSE;
+
+	return result;
+}
+
+/**
+ * Give all allocation site memory back to the platform.  No more sites are remembered for heap dumps.
+ */
+void bvm_profiler_allocsites_release() {
+
+	bvm_uint32_t i;
+
+#if BVM_HEAP_DUMP_ENABLE
+	if (profiler_objects != NULL) {
+		bvm_pd_memory_free(profiler_objects);
+		profiler_objects = NULL;
+	}
+	bvm_gl_profiler_allocation_object_count = 0;
+#endif
+
+	if (profiler_sites == NULL) return;
+
+	for (i = 0; i < PROFILER_SITE_BUCKETS; i++) {
+		profiler_site_t *site = profiler_sites[i];
+		while (site != NULL) {
+			profiler_site_t *next = site->next;
+			bvm_pd_memory_free(site->text);
+			bvm_pd_memory_free(site);
+			site = next;
+		}
+	}
+
+	bvm_pd_memory_free(profiler_sites);
+	profiler_sites = NULL;
+	profiler_site_count = 0;
+}
+
+#endif
+
+#if BVM_PROFILER_MONITOR_CONTENTION_ENABLE
+
+/** The number of buckets in the monitor contention site hash table.  A power of two. */
+#define PROFILER_CONTENTION_BUCKETS	256
+
+/** A distinct monitor contention site - the clazz of a monitor's object and the method and pc that used it - and what
+ * has happened there */
+typedef struct _profilercontentionsitestruct {
+
+	/** the next site in the same hash bucket */
+	struct _profilercontentionsitestruct *next;
+
+	/** the clazz of the monitor's object - only compared, never read after the site is made */
+	bvm_clazz_t *clazz;
+
+	/** the method, or \c NULL for the VM - only compared, never read after the site is made */
+	bvm_method_t *method;
+
+	/** the offset of the pc in the bytecode, or -1 for the VM */
+	bvm_int32_t pc;
+
+	/** the serial number of the site - from 1 in the order the sites were first seen */
+	bvm_uint32_t serial;
+
+	/** the number of times a thread blocked for the monitor at this site */
+	bvm_uint32_t contended;
+
+	/** the microseconds threads spent blocked at this site */
+	bvm_native_ulong_t blocked_micros;
+
+	/** the number of waits on the monitor at this site */
+	bvm_uint32_t waits;
+
+	/** the number of notifies of the monitor at this site */
+	bvm_uint32_t notifies;
+
+	/** the site's text */
+	char *text;
+
+} profiler_contention_site_t;
+
+/** The method and pc found for a site by #profiler_visit_contention_frame */
+typedef struct {
+	bvm_method_t *method;
+	bvm_uint8_t *pc;
+} profiler_contention_frame_t;
+
+/** If not \c NULL, the monitor contention sites are written to this file at VM exit.  Set with the \c -contention
+ * command line option. */
+BVM_VM_LOCAL char *bvm_gl_profiler_contention_filename = NULL;
+
+/** The contention site hash table - allocated when the first site is seen */
+static BVM_VM_LOCAL profiler_contention_site_t **profiler_contention_sites = NULL;
+
+/** The number of distinct sites in #profiler_contention_sites */
+static BVM_VM_LOCAL bvm_uint32_t profiler_contention_site_count = 0;
+
+/** Where everything is counted once #BVM_PROFILER_CONTENTION_MAX_SITES is reached, or there is no memory for a site */
+static BVM_VM_LOCAL profiler_contention_site_t profiler_contention_other;
+
+/**
+ * A #bvm_stack_visit_callback_t that finds the Java code that used a monitor - the first frame that is not a wedge, a
+ * native method or a method of \c java/lang/Object (so a \c wait() is put down to its caller, not to the \c wait(J)
+ * it calls).
+ */
+static bvm_bool_t profiler_visit_contention_frame(bvm_stack_frame_info_t *info, void *data) {
+
+	profiler_contention_frame_t *frame = data;
+
+	if ( (info->method == NULL) || (info->method == BVM_METHOD_CALLBACKWEDGE) || (info->method == BVM_METHOD_NOOP) ||
+		 (info->method == BVM_METHOD_NOOP_RET) || BVM_METHOD_IsNative(info->method) ||
+		 (info->method->clazz == BVM_OBJECT_CLAZZ) ) return BVM_TRUE;
+
+	/* below the top frame, the pc of a frame is where it returns to - the pc of the call is the previous pc */
+	frame->method = info->method;
+	frame->pc = (info->ppc != NULL) ? info->ppc : info->pc;
+
+	return BVM_FALSE;
+}
+
+/**
+ * Build the text of a newly seen contention site.
+ *
+ * @param site - the site.
+ * @param line - the source line of the site's pc, or \c -1 if not known.
+ * @return the text, or \c NULL if there is no memory for it.
+ */
+static char *profiler_contention_site_text(profiler_contention_site_t *site, bvm_int32_t line) {
+
+	bvm_method_t *method = site->method;
+	size_t length = site->clazz->name->length + 40;
+	char *text;
+
+	if (method != NULL) length += method->clazz->name->length + method->name->length + method->jni_signature->length;
+
+	if ( (text = bvm_pd_memory_alloc(length)) == NULL) return NULL;
+
+	if (method == NULL)
+		sprintf(text, "%s [vm]", site->clazz->name->data);
+	else if (line >= 0)
+		sprintf(text, "%s %s.%s%s pc=%d line=%d", site->clazz->name->data, method->clazz->name->data,
+				method->name->data, method->jni_signature->data, (int) site->pc, (int) line);
+	else
+		sprintf(text, "%s %s.%s%s pc=%d", site->clazz->name->data, method->clazz->name->data, method->name->data,
+				method->jni_signature->data, (int) site->pc);
+
+	return text;
+}
+
+/**
+ * Give the contention site for a monitor used by the Java code at the top of a thread's stack, making it if it is
+ * newly seen.
+ *
+ * @param obj - the monitor's object.
+ * @param vmthread - the thread.
+ * @return the site - never \c NULL.
+ */
+static profiler_contention_site_t *profiler_contention_site(bvm_obj_t *obj, bvm_vmthread_t *vmthread) {
+
+	profiler_contention_frame_t frame;
+	profiler_contention_site_t *site;
+	bvm_clazz_t *clazz = obj->clazz;
+	bvm_int32_t pc = -1, line = -1;
+	bvm_uint32_t hash;
+
+	frame.method = NULL;
+	frame.pc = NULL;
+
+	/* a thread that has terminated (and notifies those joining it) has no stack left to walk */
+	if ( (vmthread->status & BVM_THREAD_STATUS_TERMINATED) == 0)
+		bvm_stack_visit(vmthread, 0, -1, NULL, profiler_visit_contention_frame, &frame);
+
+	if (frame.method != NULL) {
+		pc = (bvm_int32_t) (frame.pc - frame.method->code.bytecode);
+#if (BVM_LINE_NUMBERS_ENABLE || BVM_DEBUGGER_ENABLE)
+		line = bvm_clazz_get_source_line(frame.method, frame.pc);
+#endif
+	}
+
+	if (profiler_contention_sites == NULL) {
+		profiler_contention_sites = bvm_pd_memory_alloc(PROFILER_CONTENTION_BUCKETS * sizeof(profiler_contention_site_t *));
+		if (profiler_contention_sites == NULL) return &profiler_contention_other;
+		memset(profiler_contention_sites, 0, PROFILER_CONTENTION_BUCKETS * sizeof(profiler_contention_site_t *));
+	}
+
+	hash = ( (bvm_uint32_t) ((bvm_native_ulong_t) clazz >> 3) * 31 + (bvm_uint32_t) ((bvm_native_ulong_t) frame.method >> 3)) * 31 + (bvm_uint32_t) pc;
+	hash = (hash ^ (hash >> 8)) & (PROFILER_CONTENTION_BUCKETS - 1);
+
+	for (site = profiler_contention_sites[hash]; site != NULL; site = site->next) {
+		if ( (site->clazz == clazz) && (site->method == frame.method) && (site->pc == pc) ) return site;
+	}
+
+	if ( (profiler_contention_site_count >= BVM_PROFILER_CONTENTION_MAX_SITES) ||
+		 ( (site = bvm_pd_memory_alloc(sizeof(profiler_contention_site_t))) == NULL) )
+		return &profiler_contention_other;
+
+	memset(site, 0, sizeof(profiler_contention_site_t));
+	site->clazz = clazz;
+	site->method = frame.method;
+	site->pc = pc;
+	site->serial = profiler_contention_site_count + 1;
+
+	if ( (site->text = profiler_contention_site_text(site, line)) == NULL) {
+		bvm_pd_memory_free(site);
+		return &profiler_contention_other;
+	}
+
+	site->next = profiler_contention_sites[hash];
+	profiler_contention_sites[hash] = site;
+	profiler_contention_site_count++;
+
+	return site;
+}
+
+/**
+ * Count a thread blocking for a monitor, and start the clock on how long it is blocked.  A thread already blocked (one
+ * that lost the monitor again after being woken to compete for it) carries on being blocked where it was.
+ *
+ * @param obj - the monitor's object.
+ * @param vmthread - the blocked thread.
+ */
+void bvm_profiler_contention_blocked(bvm_obj_t *obj, bvm_vmthread_t *vmthread) {
+
+	profiler_contention_site_t *site;
+
+	if (vmthread->contention_site != NULL) return;
+
+	site = profiler_contention_site(obj, vmthread);
+	site->contended++;
+
+	vmthread->contention_site = site;
+	vmthread->contention_start = bvm_pd_system_time_micros();
+}
+
+/**
+ * Stop the clock on a thread that was blocked for a monitor - it has been taken from the lock queue.
+ *
+ * @param vmthread - the thread.
+ */
+void bvm_profiler_contention_unblocked(bvm_vmthread_t *vmthread) {
+
+	profiler_contention_site_t *site = vmthread->contention_site;
+
+	site->blocked_micros += (bvm_uint32_t) (bvm_pd_system_time_micros() - vmthread->contention_start);
+	vmthread->contention_site = NULL;
+}
+
+/**
+ * Count a wait on a monitor by the current thread.
+ *
+ * @param obj - the monitor's object.
+ */
+void bvm_profiler_contention_wait(bvm_obj_t *obj) {
+	profiler_contention_site(obj, bvm_gl_thread_current)->waits++;
+}
+
+/**
+ * Count a notify (or notifyAll) of a monitor by the current thread.
+ *
+ * @param obj - the monitor's object.
+ */
+void bvm_profiler_contention_notify(bvm_obj_t *obj) {
+	profiler_contention_site(obj, bvm_gl_thread_current)->notifies++;
+}
+
+/**
+ * Throw away all contention sites.  Threads blocked now are no longer timed.
+ */
+void bvm_profiler_contention_reset() {
+
+	bvm_vmthread_t *vmthread;
+	bvm_uint32_t i;
+
+	for (vmthread = bvm_gl_threads; vmthread != NULL; vmthread = vmthread->next)
+		vmthread->contention_site = NULL;
+
+	memset(&profiler_contention_other, 0, sizeof(profiler_contention_site_t));
+
+	if (profiler_contention_sites == NULL) return;
+
+	for (i = 0; i < PROFILER_CONTENTION_BUCKETS; i++) {
+		profiler_contention_site_t *site = profiler_contention_sites[i];
+		while (site != NULL) {
+			profiler_contention_site_t *next = site->next;
+			bvm_pd_memory_free(site->text);
+			bvm_pd_memory_free(site);
+			site = next;
+		}
+		profiler_contention_sites[i] = NULL;
+	}
+
+	profiler_contention_site_count = 0;
+}
+
+/**
+ * A \c qsort comparison of two contention sites - the one with the most time blocked first, then the most contended,
+ * and the first seen first for equal counts.
+ */
+static int profiler_compare_contention_sites(const void *a, const void *b) {
+
+	const profiler_contention_site_t *site_a = *(profiler_contention_site_t * const *) a;
+	const profiler_contention_site_t *site_b = *(profiler_contention_site_t * const *) b;
+
+	if (site_a->blocked_micros != site_b->blocked_micros) return (site_a->blocked_micros > site_b->blocked_micros) ? -1 : 1;
+	if (site_a->contended != site_b->contended) return (site_a->contended > site_b->contended) ? -1 : 1;
+
+	return (site_a->serial < site_b->serial) ? -1 : 1;
+}
+
+/**
+ * Write one contention site line.
+ *
+ * @return #BVM_TRUE if it was written.
+ */
+static bvm_bool_t profiler_write_contention_site(profiler_contention_site_t *site, const char *text, void *handle) {
+
+	char line[80];
+	size_t count_length = sprintf(line, "%lu %lu %lu %lu ", (unsigned long) site->contended,
+								  (unsigned long) site->blocked_micros, (unsigned long) site->waits,
+								  (unsigned long) site->notifies);
+	size_t length = strlen(text);
+
+	return (bvm_pd_file_write(line, count_length, handle) == count_length) &&
+		   (bvm_pd_file_write(text, length, handle) == length) &&
+		   (bvm_pd_file_write("\n", 1, handle) == 1);
+}
+
+/**
+ * Write the monitor contention sites to a file, most time blocked first - a line per site with its contended count,
+ * microseconds blocked, waits, notifies and text.  An existing file is overwritten.  The counts are kept - see
+ * #bvm_profiler_contention_reset.
+ *
+ * @param filename - the name of the file.
+ * @return #BVM_TRUE if the sites were written, #BVM_FALSE if the file could not be opened or written, or there was no
+ * memory to sort them.
+ */
+bvm_bool_t bvm_profiler_contention_dump_to_file(const char *filename) {
+
+	static const char header[] = "# contended blocked_us waits notifies monitor site\n";
+	bvm_bool_t result = BVM_TRUE;
+	profiler_contention_site_t **sorted = NULL;
+	profiler_contention_site_t *site;
+	bvm_uint32_t i, count = 0;
+	void *handle = bvm_pd_file_open(filename, BVM_FILE_O_WRONLY | BVM_FILE_O_TRUNC);
+
+	if (handle == NULL) return BVM_FALSE;
+
+	if (bvm_pd_file_write(header, sizeof(header) - 1, handle) != sizeof(header) - 1) result = BVM_FALSE;
+
+	if (profiler_contention_site_count > 0) {
+
+		if ( (sorted = bvm_pd_memory_alloc(profiler_contention_site_count * sizeof(profiler_contention_site_t *))) == NULL) {
+			bvm_pd_file_close(handle);
+			return BVM_FALSE;
+		}
+
+		for (i = 0; i < PROFILER_CONTENTION_BUCKETS; i++) {
+			for (site = profiler_contention_sites[i]; site != NULL; site = site->next)
+				sorted[count++] = site;
+		}
+
+		qsort(sorted, count, sizeof(profiler_contention_site_t *), profiler_compare_contention_sites);
+	}
+
+	for (i = 0; i < count; i++) {
+		if (!profiler_write_contention_site(sorted[i], sorted[i]->text, handle)) result = BVM_FALSE;
+	}
+
+	site = &profiler_contention_other;
+	if ( (site->contended | site->waits | site->notifies) != 0) {
+		if (!profiler_write_contention_site(site, "[other]", handle)) result = BVM_FALSE;
+	}
+
+	if (sorted != NULL) bvm_pd_memory_free(sorted);
+
+	if (bvm_pd_file_close(handle) == BVM_ERR) result = BVM_FALSE;
+
+	return result;
+}
+
+/**
+ * Give all contention site memory back to the platform.
+ */
+void bvm_profiler_contention_release() {
+
+	bvm_profiler_contention_reset();
+
+	if (profiler_contention_sites != NULL) {
+		bvm_pd_memory_free(profiler_contention_sites);
+		profiler_contention_sites = NULL;
+	}
+}
+
+#endif
+
+#if BVM_PROFILER_STARTUP_TRACE_ENABLE
+
+/** The most class initialisations that may be in progress at once and still be traced */
+#define PROFILER_CLINIT_DEPTH 64
+
+/**
+ * The name of the file the startup trace is written to at VM exit, or \c NULL if the startup is not being traced.  Set
+ * with the \c -starttrace command line option.
+ */
+BVM_VM_LOCAL char *bvm_gl_profiler_startup_filename = NULL;
+
+/**
+ * The microsecond time the trace timestamps are relative to - set as #bvm_main is entered.
+ */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_profiler_startup_origin = 0;
+
+/**
+ * The running total of microseconds spent inflating jar entries, so a class load can tell how much of its time was
+ * inflation.
+ */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_profiler_startup_inflate_micros = 0;
+
+/** The trace events so far - the JSON text of each, comma separated */
+static BVM_VM_LOCAL char *profiler_events = NULL;
+static BVM_VM_LOCAL size_t profiler_events_length = 0;
+static BVM_VM_LOCAL size_t profiler_events_size = 0;
+
+/** The class initialisations in progress - the clazz and when its initialisation began */
+static BVM_VM_LOCAL bvm_clazz_t *profiler_clinit_clazzes[PROFILER_CLINIT_DEPTH];
+static BVM_VM_LOCAL bvm_uint32_t profiler_clinit_starts[PROFILER_CLINIT_DEPTH];
+static BVM_VM_LOCAL bvm_uint32_t profiler_clinit_depth = 0;
+
+/**
+ * Append \c length chars to the trace events, growing them as needed.  Events that do not fit in memory are dropped.
+ */
+static void profiler_events_append(const char *text, size_t length) {
+
+	if (profiler_events_length + length > profiler_events_size) {
+
+		size_t size = (profiler_events_size == 0) ? 16 * BVM_KB : profiler_events_size * 2;
+		char *events;
+
+		while (size < profiler_events_length + length) size *= 2;
+
+		if ( (events = bvm_pd_memory_alloc(size)) == NULL) return;
+
+		if (profiler_events != NULL) {
+			memcpy(events, profiler_events, profiler_events_length);
+			bvm_pd_memory_free(profiler_events);
+		}
+
+		profiler_events = events;
+		profiler_events_size = size;
+	}
+
+	memcpy(profiler_events + profiler_events_length, text, length);
+	profiler_events_length += length;
+}
+
+/**
+ * Append \c name to the trace events as the chars of a JSON string - with quotes, backslashes and control chars
+ * escaped.
+ */
+static void profiler_events_append_string(const char *name) {
+
+	char escaped[8];
+
+	for (; *name != '\0'; name++) {
+		unsigned char c = (unsigned char) *name;
+		if (c == '"' || c == '\\') {
+			escaped[0] = '\\';
+			escaped[1] = (char) c;
+			profiler_events_append(escaped, 2);
+		} else if (c < 0x20) {
+			profiler_events_append(escaped, sprintf(escaped, "\\u%04x", c));
+		} else {
+			profiler_events_append((char *) &c, 1);
+		}
+	}
+}
+
+/**
+ * Record a trace event of an interval that began at \c start (a #bvm_pd_system_time_micros time) and ends now.
+ *
+ * @param category - the event category: \c phase, \c load or \c clinit.
+ * @param name - the event name.
+ * @param start - when the interval began.
+ * @param args - the members of the event's JSON \c args object, without the braces, or \c NULL if it has none.
+ */
+void bvm_profiler_startup_event(const char *category, const char *name, bvm_uint32_t start, const char *args) {
+
+	char numbers[64];
+	bvm_uint32_t now = bvm_pd_system_time_micros();
+
+	profiler_events_append( (profiler_events_length == 0) ? "{\"name\":\"" : ",\n{\"name\":\"",
+							(profiler_events_length == 0) ? 9 : 11);
+	profiler_events_append_string(name);
+	profiler_events_append("\",\"cat\":\"", 9);
+	profiler_events_append(category, strlen(category));
+	profiler_events_append(numbers, sprintf(numbers, "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%lu,\"dur\":%lu",
+							(unsigned long) (start - bvm_gl_profiler_startup_origin), (unsigned long) (now - start)));
+
+	if (args != NULL) {
+		profiler_events_append(",\"args\":{", 9);
+		profiler_events_append(args, strlen(args));
+		profiler_events_append("}", 1);
+	}
+
+	profiler_events_append("}", 1);
+}
+
+/**
+ * Record the trace event of a class load.
+ *
+ * @param clazz - the clazz loaded.
+ * @param start - when the load began.
+ * @param read_micros - how long finding and reading the class file took.
+ * @param inflate_micros - how much of the read was inflating the file out of a jar.
+ * @param bytes - the size of the class file.
+ */
+void bvm_profiler_startup_load_event(bvm_clazz_t *clazz, bvm_uint32_t start, bvm_uint32_t read_micros,
+									 bvm_uint32_t inflate_micros, bvm_int32_t bytes) {
+
+	char args[80];
+
+	sprintf(args, "\"bytes\":%ld,\"read_us\":%lu,\"inflate_us\":%lu", (long) bytes, (unsigned long) read_micros,
+			(unsigned long) inflate_micros);
+
+	bvm_profiler_startup_event("load", (char *) clazz->name->data, start, args);
+}
+
+/**
+ * Note that the &lt;clinit&gt; of a clazz is about to be run.
+ */
+void bvm_profiler_startup_clinit_begin(bvm_clazz_t *clazz) {
+
+	if (!BVM_PROFILER_STARTUP_TRACING() || profiler_clinit_depth == PROFILER_CLINIT_DEPTH) return;
+
+	profiler_clinit_clazzes[profiler_clinit_depth] = clazz;
+	profiler_clinit_starts[profiler_clinit_depth++] = bvm_pd_system_time_micros();
+}
+
+/**
+ * Note that a clazz has been initialised (or failed to be), and trace its &lt;clinit&gt; if it had one.  Another
+ * thread may have begun a class initialisation in the meantime, so the clazz is looked for from the most recently
+ * begun down.
+ */
+void bvm_profiler_startup_clinit_end(bvm_clazz_t *clazz) {
+
+	bvm_uint32_t i = profiler_clinit_depth;
+
+	if (!BVM_PROFILER_STARTUP_TRACING()) return;
+
+	while (i-- > 0) {
+
+		if (profiler_clinit_clazzes[i] == clazz) {
+
+			bvm_profiler_startup_event("clinit", (char *) clazz->name->data, profiler_clinit_starts[i], NULL);
+
+			/* close the gap */
+			for (profiler_clinit_depth--; i < profiler_clinit_depth; i++) {
+				profiler_clinit_clazzes[i] = profiler_clinit_clazzes[i + 1];
+				profiler_clinit_starts[i] = profiler_clinit_starts[i + 1];
+			}
+			return;
+		}
+	}
+}
+
+/**
+ * Write the trace events to a file as a Chrome trace event JSON object.  An existing file is overwritten.
+ *
+ * @param filename - the name of the file.
+ * @return #BVM_TRUE if the trace was written, #BVM_FALSE if the file could not be opened or written.
+ */
+bvm_bool_t bvm_profiler_startup_dump_to_file(const char *filename) {
+
+	static const char header[] = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	static const char footer[] = "\n]}\n";
+	bvm_bool_t result = BVM_TRUE;
+	void *handle = bvm_pd_file_open(filename, BVM_FILE_O_WRONLY | BVM_FILE_O_TRUNC);
+
+	if (handle == NULL) return BVM_FALSE;
+
+	if ( (bvm_pd_file_write(header, sizeof(header) - 1, handle) != sizeof(header) - 1) ||
+		 ((profiler_events_length > 0) && (bvm_pd_file_write(profiler_events, profiler_events_length, handle) != profiler_events_length)) ||
+		 (bvm_pd_file_write(footer, sizeof(footer) - 1, handle) != sizeof(footer) - 1) ) result = BVM_FALSE;
+
+	if (bvm_pd_file_close(handle) == BVM_ERR) result = BVM_FALSE;
+
+	return result;
+}
+
+/**
+ * Give the trace event memory back to the platform.
+ */
+void bvm_profiler_startup_release() {
+
+	if (profiler_events != NULL) bvm_pd_memory_free(profiler_events);
+
+	profiler_events = NULL;
+	profiler_events_length = 0;
+	profiler_events_size = 0;
+	profiler_clinit_depth = 0;
+}
+
+#endif
+
+#if BVM_PROFILER_PERF_ENABLE
+
+/**
+ * What a native profiler needs to find and walk the Java frames of the VM.  Not #BVM_VM_LOCAL, so a tool can find it
+ * by its symbol.  Filled in by #bvm_profiler_perf_init.
+ */
+bvm_perf_descriptor_t bvm_perf_descriptor;
+
+/**
+ * Is the native code of compiled methods written to the perf map file?  Set with the \c -perfmap command line option.
+ */
+BVM_VM_LOCAL bvm_bool_t bvm_gl_profiler_perf_map_enabled = BVM_FALSE;
+
+/** The open perf map file, or \c NULL if it is not open (yet) */
+static BVM_VM_LOCAL void *profiler_perf_map = NULL;
+
+/**
+ * Fill in #bvm_perf_descriptor for the registers of this VM, and open the perf map file if asked to.  The map is
+ * named for the process so \c perf can find it.
+ */
+void bvm_profiler_perf_init() {
+
+	strcpy(bvm_perf_descriptor.magic, "BVMPERF");
+	bvm_perf_descriptor.version = BVM_PERF_DESCRIPTOR_VERSION;
+	bvm_perf_descriptor.cell_size = sizeof(bvm_cell_t);
+	bvm_perf_descriptor.current_method = (void *) &bvm_gl_rx_method;
+	bvm_perf_descriptor.current_locals = (void *) &bvm_gl_rx_locals;
+	bvm_perf_descriptor.frame_method_offset = BVM_FRAME_METHOD_OFFSET;
+	bvm_perf_descriptor.frame_locals_offset = BVM_FRAME_LOCALS_OFFSET;
+	bvm_perf_descriptor.method_name_offset = offsetof(bvm_method_t, name);
+	bvm_perf_descriptor.method_signature_offset = offsetof(bvm_method_t, jni_signature);
+	bvm_perf_descriptor.method_clazz_offset = offsetof(bvm_method_t, clazz);
+	bvm_perf_descriptor.clazz_name_offset = offsetof(bvm_clazz_t, name);
+	bvm_perf_descriptor.utfstring_length_offset = offsetof(bvm_utfstring_t, length);
+	bvm_perf_descriptor.utfstring_data_offset = offsetof(bvm_utfstring_t, data);
+
+	if (bvm_gl_profiler_perf_map_enabled && (profiler_perf_map == NULL)) {
+
+		char filename[40];
+
+		sprintf(filename, "/tmp/perf-%lu.map", (unsigned long) bvm_pd_system_process_id());
+
+		if ( (profiler_perf_map = bvm_pd_file_open(filename, BVM_FILE_O_WRONLY | BVM_FILE_O_TRUNC)) == NULL) {
+#if BVM_CONSOLE_ENABLE
+			bvm_pd_console_out("Perf map %s could not be opened.\n", filename);
+#endif
+		}
+	}
+}
+
+/**
+ * Write the native code of a method to the perf map file.  Does nothing if the map is not open.  A map line that
+ * cannot be written is dropped.
+ *
+ * @param method - the method the code was compiled for.
+ * @param code - the start of the code.
+ * @param size - the size of the code in bytes.
+ */
+void bvm_profiler_perf_map_code(bvm_method_t *method, void *code, size_t size) {
+
+	char address[48];
+
+	if (profiler_perf_map == NULL) return;
+
+	bvm_pd_file_write(address, sprintf(address, "%lx %lx ", (unsigned long) (bvm_native_ulong_t) code, (unsigned long) size), profiler_perf_map);
+	bvm_pd_file_write(method->clazz->name->data, method->clazz->name->length, profiler_perf_map);
+	bvm_pd_file_write(".", 1, profiler_perf_map);
+	bvm_pd_file_write(method->name->data, method->name->length, profiler_perf_map);
+	bvm_pd_file_write(method->jni_signature->data, method->jni_signature->length, profiler_perf_map);
+	bvm_pd_file_write("\n", 1, profiler_perf_map);
+}
+
+/**
+ * Close the perf map file.  The file is left for \c perf to read.
+ */
+void bvm_profiler_perf_release() {
+
+	if (profiler_perf_map != NULL) bvm_pd_file_close(profiler_perf_map);
+
+	profiler_perf_map = NULL;
+}
+
+#endif
@@ -0,0 +1,428 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#include "../h/bvm.h"
+
+/**
+
+ @file
+
+ Scoped memory.
+
+ @section ov Overview
+
+ A scoped memory is an arena of a fixed size that a thread may enter to have the objects and arrays it creates
+ allocated there rather than from the heap.  An allocation in a scope is a bump of the arena top - no free list is
+ searched and no GC is ever started by it - so code in a scope allocates in time that does not depend on the state of
+ the heap.  When the thread leaves the scope the top is put back to the start of the arena, and everything allocated in
+ it is gone at once.  This is the scoped memory of the RTSJ, made small.
+
+ The Java side is \c babe.lang.ScopedMemory.  A scope is created with a size, and entered for the length of a
+ \c Runnable.  The arena is taken from the heap when the scope is created as a #BVM_ALLOC_TYPE_STATIC allocation, so it
+ is never moved or collected.  It is given back when the scope is released - a scope that is not released keeps its
+ arena until the VM exits.
+
+ Only allocations made by bytecode (\c new, \c newarray, \c anewarray, \c multianewarray and the cloning of an object
+ or array) are made in a scope.  Whatever the VM allocates for itself - clazzes, strings for constants, exceptions -
+ is allocated from the heap as usual.  A \c Throwable or \c Thread created in a scope is also allocated from the heap,
+ as either may well be used after the scope is left.
+
+ @section layout Layout
+
+ The objects in an arena are laid out as in-use heap chunks, one after the other from #bvm_scope_t::start to
+ #bvm_scope_t::top, each with the alloc type it would have had in the heap.  A reference to a scoped object is
+ therefore just like a reference to a heap object to the rest of the VM.  Each is given the colour
+ #BVM_GC_COLOUR_BLACK, and keeps it, so the collector never marks one when it finds a reference to it.  Instead, at the
+ start of each GC, every object in every entered scope is scanned as a root (see #bvm_gl_scopes_entered), so the heap
+ objects they refer to are kept.  The arena is not part of the heap walk, so the objects in it are never swept.
+
+ @section escape Assignment checks
+
+ An object in a scope must not be referred to from anywhere that may outlive the scope.  Before a reference is stored
+ into an object field, a static field or an array element by bytecode, a native or \c System.arraycopy, it is checked
+ with #BVM_SCOPE_IsEscape.  A reference to a scoped object may only be stored into an object in the same scope, or
+ in a scope entered (by the same thread) after it - those are always left first.  Anything else throws an
+ \c IllegalStateException and nothing is stored.  While no thread is in a scope the check is a load and a compare.
+
+ A thread may enter a scope while in another - the inner scope is used until it is left.  A scope may only be entered
+ by one thread at a time and may not be entered twice.
+
+ @section limits Limitations
+
+ References to scoped objects held on the Java stack are not checked, as they go when the frames that hold them
+ return.  Class initialisers allocate from the heap whatever scope the thread that triggers them is in - see
+ #bvm_scope_suspend.  The monitor of a scoped object must not be held after the scope is left.
+
+ */
+
+#if BVM_SCOPED_MEMORY_ENABLE
+
+/** The scopes that threads are in, most recently entered first.  Scanned as roots by the GC. */
+BVM_VM_LOCAL bvm_scope_t *bvm_gl_scopes_entered = NULL;
+
+/**
+ * Create a scope with an arena of the given size.  The scope is not entered.
+ *
+ * @param size the size in bytes of the arena
+ *
+ * @return a new scope
+ */
+bvm_scope_t *bvm_scope_create(bvm_uint32_t size) {
+
+	bvm_scope_t *scope;
+
+	/* room for the chunk alignment of the arena start */
+	scope = bvm_heap_calloc(sizeof(bvm_scope_t) + size + BVM_CHUNK_ALIGN_MASK, BVM_ALLOC_TYPE_STATIC);
+
+	scope->start = (bvm_uint8_t *) ( ((size_t) (scope + 1) + BVM_CHUNK_ALIGN_MASK) & ~BVM_CHUNK_ALIGN_MASK);
+	scope->top = scope->start;
+	scope->end = scope->start + size;
+
+	return scope;
+}
+
+/**
+ * Give the arena of a scope back to the heap.  A scope that has been entered may not be released.
+ *
+ * @param scope the scope to release
+ *
+ * @throws IllegalStateException if the scope has been entered.
+ */
+void bvm_scope_release(bvm_scope_t *scope) {
+
+	if (scope->owner != NULL)
+		bvm_throw_exception(BVM_ERR_ILLEGAL_STATE_EXCEPTION, "scope is entered");
+
+	bvm_heap_free(scope);
+}
+
+/**
+ * Have the current thread enter a scope.  Until the scope is left, the objects and arrays the thread creates are
+ * allocated from it.
+ *
+ * @param scope the scope to enter
+ *
+ * @throws IllegalStateException if the scope has already been entered.
+ */
+void bvm_scope_enter(bvm_scope_t *scope) {
+
+	if (scope->owner != NULL)
+		bvm_throw_exception(BVM_ERR_ILLEGAL_STATE_EXCEPTION, "scope is entered");
+
+	scope->owner = bvm_gl_thread_current;
+	scope->outer = bvm_gl_thread_current->scope;
+	scope->next = bvm_gl_scopes_entered;
+
+	bvm_gl_scopes_entered = scope;
+	bvm_gl_thread_current->scope = scope;
+}
+
+/**
+ * Have a thread leave the scope it is in.  Everything allocated in the scope is dropped.
+ *
+ * @param vmthread the thread
+ */
+static void scope_leave(bvm_vmthread_t *vmthread) {
+
+	bvm_scope_t *scope = vmthread->scope;
+	bvm_scope_t **prev;
+
+	/* unlink from the entered scopes */
+	for (prev = &bvm_gl_scopes_entered; *prev != scope; prev = &(*prev)->next);
+	*prev = scope->next;
+
+	vmthread->scope = scope->outer;
+
+	scope->owner = NULL;
+	scope->outer = NULL;
+	scope->next = NULL;
+	scope->top = scope->start;
+}
+
+/**
+ * Have the current thread leave a scope.  Everything allocated in the scope is dropped.
+ *
+ * @param scope the scope to leave.  Must be the scope the current thread entered last.
+ *
+ * @throws IllegalStateException if the scope is not the scope the current thread is in.
+ */
+void bvm_scope_exit(bvm_scope_t *scope) {
+
+	if (bvm_gl_thread_current->scope != scope)
+		bvm_throw_exception(BVM_ERR_ILLEGAL_STATE_EXCEPTION, "not in scope");
+
+	scope_leave(bvm_gl_thread_current);
+}
+
+/**
+ * Have a thread leave all the scopes it is in.  Used when a thread ends.
+ *
+ * @param vmthread the thread
+ */
+void bvm_scope_exit_all(bvm_vmthread_t *vmthread) {
+
+	while (vmthread->scope != NULL)
+		scope_leave(vmthread);
+
+	vmthread->scope_suspended = 0;
+}
+
+/**
+ * Have the current thread allocate from the heap rather than from the scope it is in, until the matching
+ * #bvm_scope_resume.  Called as each \c Class.__doInit frame is pushed - a clazz initialised in a scope could
+ * otherwise not keep what it creates in its static fields.  The frames pushed while suspended are counted too, so
+ * initialisations may nest.
+ */
+void bvm_scope_suspend() {
+
+	bvm_vmthread_t *vmthread = bvm_gl_thread_current;
+
+	/* the VM initialises clazzes before there is a thread */
+	if ( (vmthread != NULL) && ( (vmthread->scope != NULL) || (vmthread->scope_suspended > 0) ) )
+		vmthread->scope_suspended++;
+}
+
+/**
+ * End a #bvm_scope_suspend.  Called as each \c Class.__doInit frame is popped - whether it returned or not.
+ */
+void bvm_scope_resume() {
+
+	bvm_vmthread_t *vmthread = bvm_gl_thread_current;
+
+	if ( (vmthread != NULL) && (vmthread->scope_suspended > 0) )
+		vmthread->scope_suspended--;
+}
+
+/**
+ * Find the entered scope whose arena a pointer is in.
+ *
+ * @param ptr the pointer
+ *
+ * @return the scope, or \c NULL if the pointer is not in an entered scope.
+ */
+static bvm_scope_t *scope_for(void *ptr) {
+
+	bvm_scope_t *scope;
+
+	for (scope = bvm_gl_scopes_entered; scope != NULL; scope = scope->next) {
+		if ( ((bvm_uint8_t *) ptr >= scope->start) && ((bvm_uint8_t *) ptr < scope->top) )
+			return scope;
+	}
+
+	return NULL;
+}
+
+/**
+ * Determine if storing a reference into an object, array or clazz would let a scoped object outlive its scope.  Use
+ * #BVM_SCOPE_IsEscape rather than calling this directly.
+ *
+ * @param holder the object, array, or clazz that the reference is stored into.
+ * @param value the reference being stored.  Not \c NULL.
+ *
+ * @return \c BVM_TRUE if the reference may not be stored, \c BVM_FALSE otherwise.
+ */
+bvm_bool_t bvm_scope_is_escape(void *holder, void *value) {
+
+	bvm_scope_t *value_scope = scope_for(value);
+	bvm_scope_t *scope;
+
+	/* heap objects may be stored anywhere */
+	if (value_scope == NULL)
+		return BVM_FALSE;
+
+	/* a scope may refer to itself, or to any scope its thread was in when it was entered */
+	for (scope = scope_for(holder); scope != NULL; scope = scope->outer) {
+		if (scope == value_scope)
+			return BVM_FALSE;
+	}
+
+	return BVM_TRUE;
+}
+
+/**
+ * Allocate zeroed memory of an alloc type from the scope the current thread is in.  The memory is laid out as an
+ * in-use chunk coloured #BVM_GC_COLOUR_BLACK.
+ *
+ * @param size the size of the memory in bytes
+ * @param alloc_type the alloc type of the memory
+ *
+ * @return a pointer to the memory
+ *
+ * @throws OutOfMemoryError if the arena has no room.
+ */
+static void *scope_calloc(bvm_uint32_t size, int alloc_type) {
+
+	bvm_scope_t *scope = bvm_gl_thread_current->scope;
+	bvm_chunk_t *chunk;
+
+	size = (bvm_uint32_t) BVM_CHUNK_AlignedSize(size);
+	if (size < BVM_CHUNK_MIN_ALLOC_SIZE) size = BVM_CHUNK_MIN_ALLOC_SIZE;
+
+	if ((bvm_uint32_t) (scope->end - scope->top) < size) {
+		BVM_THROW(bvm_gl_out_of_memory_err_obj)
+	}
+
+	chunk = (bvm_chunk_t *) scope->top;
+	scope->top += size;
+
+	memset(chunk, 0, size);
+	chunk->header = BVM_CHUNK_SizeHeader(size) | ((bvm_chunk_header_t) alloc_type << BVM_CHUNK_TYPE_SHIFT) |
+			(BVM_GC_COLOUR_BLACK << BVM_CHUNK_COLOUR_SHIFT) | BVM_CHUNK_INUSE_MASK;
+
+	BVM_PROFILER_COUNT_ALLOCATION();
+
+	return BVM_CHUNK_GetUserData(chunk);
+}
+
+/**
+ * Create an object of the given clazz in the scope the current thread is in - see #bvm_object_alloc.  Throwables and
+ * threads are allocated from the heap.
+ *
+ * @param clazz the clazz of the new object.
+ *
+ * @return a new object.
+ */
+bvm_obj_t *bvm_scope_alloc_object(bvm_instance_clazz_t *clazz) {
+
+	bvm_obj_t *obj;
+
+	if ( bvm_clazz_is_subclass_of((bvm_clazz_t *) clazz, (bvm_clazz_t *) BVM_THROWABLE_CLAZZ) ||
+		 bvm_clazz_is_subclass_of((bvm_clazz_t *) clazz, (bvm_clazz_t *) BVM_THREAD_CLAZZ) )
+		return bvm_object_alloc(clazz);
+
+	obj = scope_calloc(BVM_OBJECT_SIZE(clazz), (clazz == BVM_STRING_CLAZZ) ? BVM_ALLOC_TYPE_STRING : BVM_ALLOC_TYPE_OBJECT);
+	obj->clazz = (bvm_clazz_t *) clazz;
+
+	return obj;
+}
+
+/**
+ * Create a primitive array in the scope the current thread is in - see #bvm_object_alloc_array_primitive.
+ *
+ * @param length the array length
+ * @param type the primitive type of the array
+ *
+ * @return a new array object
+ */
+bvm_jarray_obj_t *bvm_scope_alloc_array_primitive(bvm_uint32_t length, bvm_jtype_t type) {
+
+	bvm_jarray_obj_t *array_obj;
+
+	/* as for the heap - stops the size calculation overflowing */
+	if (length > 0x1000000) {
+		BVM_THROW(bvm_gl_out_of_memory_err_obj)
+	}
+
+	array_obj = scope_calloc(bvm_object_primitive_array_size(length, type), BVM_ALLOC_TYPE_ARRAY_OF_PRIMITIVE);
+
+	array_obj->clazz  = bvm_gl_type_array_info[type].primitive_array_clazz;
+	array_obj->length.int_value = length;
+
+	return array_obj;
+}
+
+/**
+ * Create an object array in the scope the current thread is in - see #bvm_object_alloc_array_reference.
+ *
+ * @param length the length of the new array
+ * @param component_clazz the component type #bvm_clazz_t
+ *
+ * @return a new array object
+ */
+bvm_instance_array_obj_t *bvm_scope_alloc_array_reference(bvm_uint32_t length, bvm_clazz_t *component_clazz) {
+
+	bvm_instance_array_obj_t *array_obj;
+	bvm_array_clazz_t *array_clazz;
+
+	/* as for the heap - stops the size calculation overflowing */
+	if (length > 0x1000000) {
+		BVM_THROW(bvm_gl_out_of_memory_err_obj)
+	}
+
+	/* may load the array clazz - which is allocated from the heap */
+	array_clazz = bvm_object_array_clazz(component_clazz);
+
+	array_obj = scope_calloc(sizeof(bvm_jarray_obj_t) + (sizeof(bvm_ref_t) * length), BVM_ALLOC_TYPE_ARRAY_OF_OBJECT);
+
+	array_obj->clazz = array_clazz;
+	array_obj->length.int_value = length;
+
+	return array_obj;
+}
+
+/**
+ * Create a multi-dimensional array in the scope the current thread is in - see #bvm_object_alloc_array_multi.  Scoped
+ * objects are never collected, so the arrays are not made transient roots while the sub-arrays are created.
+ *
+ * @param clazz the clazz of the array
+ * @param dimensions the number of dimensions to create
+ * @param lengths an array of integer lengths - one for each array dimension
+ *
+ * @return a instance object array populated with sub-arrays.
+ */
+bvm_instance_array_obj_t *bvm_scope_alloc_array_multi(bvm_array_clazz_t *clazz, int dimensions, bvm_native_long_t lengths[]) {
+
+	bvm_instance_array_obj_t *array_obj;
+	bvm_int32_t length = lengths[0];
+	bvm_int32_t lc;
+
+	if (length < 0) bvm_throw_exception(BVM_ERR_NEGATIVE_ARRAY_SIZE_EXCEPTION, NULL);
+
+	array_obj = (clazz->component_jtype > BVM_T_ARRAY) ?
+			(bvm_instance_array_obj_t *) bvm_scope_alloc_array_primitive(length, clazz->component_jtype) :
+			bvm_scope_alloc_array_reference(length, clazz->component_clazz);
+
+	if ( (clazz->component_jtype == BVM_T_ARRAY) && (dimensions > 1) ) {
+		for (lc = length; lc--;) {
+			array_obj->data[lc] = BVM_REF_Encode((bvm_obj_t *)
+				bvm_scope_alloc_array_multi( (bvm_array_clazz_t *) clazz->component_clazz, dimensions - 1, &lengths[1]));
+		}
+	}
+
+	return array_obj;
+}
+
+/**
+ * Make a shallow copy of an object or array in the scope the current thread is in - see #bvm_object_clone.
+ *
+ * @param obj the object to copy.
+ *
+ * @return a new object.
+ */
+bvm_obj_t *bvm_scope_clone(bvm_obj_t *obj) {
+
+	bvm_chunk_t *chunk = BVM_CHUNK_GetPointerChunk(obj);
+	bvm_uint32_t size = BVM_CHUNK_GetSize(chunk) - BVM_CHUNK_OVERHEAD;
+	int alloc_type = BVM_CHUNK_GetType(chunk);
+	bvm_obj_t *new_obj;
+
+	if ( !bvm_clazz_is_subclass_of(obj->clazz, (bvm_clazz_t *) BVM_THROWABLE_CLAZZ) &&
+		 !bvm_clazz_is_subclass_of(obj->clazz, (bvm_clazz_t *) BVM_THREAD_CLAZZ) ) {
+		new_obj = scope_calloc(size, alloc_type);
+		memcpy(new_obj, obj, size);
+	} else
+		new_obj = bvm_heap_clone(obj);
+
+#if BVM_THIN_LOCK_ENABLE
+	BVM_OBJECT_SetLockword(new_obj, 0);
+#endif
+
+	return new_obj;
+}
+
+#endif
@@ -0,0 +1,1458 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#include "../h/bvm.h"
+
+/**
+
+ @file
+
+ VM snapshots.
+
+ @section ov Overview
+
+ A class image (see clazzimage.c) saves the reading and inflating of the bootstrap classes, but they must still be
+ parsed, linked and initialised on every start.  A snapshot saves all of it.  A VM started with \c -snapshotwrite
+ starts as usual, and once its main class (and \c java.lang.Thread) have been initialised - with the \c main method
+ on the stack, about to run - writes its entire state to the given file: every heap region, and every VM global.  A
+ VM started with \c -snapshot reads that state back instead of initialising, and goes straight into \c main.
+
+ The point the snapshot is taken is a callback wedge (see #bvm_snapshot_ready) pushed between the \c main frame and
+ the class initialisations above it.  The interpreter calls it when the last of them returns, and after it returns the
+ wedge returns into \c main.  A restored VM starts the interpreter at that same wedge.
+
+ Every VM global is declared #BVM_VM_LOCAL, and with #BVM_VM_SNAPSHOT_ENABLE set that places them all in a section of
+ their own in the executable (see #BVM_PD_VM_STATE).  The section is written and read as one block.  Not all of it
+ may be taken from the snapshot, though - the globals set from the command line hold pointers to the command line of
+ the VM that wrote the snapshot.  So the section is copied just before initialisation by #bvm_snapshot_mark, and only
+ the words that were changed after that are taken from the snapshot.  The others keep the values this VM gave them,
+ as does the VM exit point, which is on the 'C' stack.
+
+ A restored VM has its heap at different addresses, and (as executables are usually position independent) its
+ code and globals too.  The snapshot records where each was, and after reading each pointer is moved by the distance
+ its target moved.  The changed globals are all taken as pointers if they fall inside the old executable image or an
+ old heap region.  The heap is not - a map of its pointer slots is built as the snapshot is written, with a bit for
+ each slot of each region:
+
+ @li Java objects - the clazz, the reference fields (by the clazz's \c ref_field_offsets), the links of a
+ reference, and the elements of an object array.  Never the other fields, a lock word, or primitive array data.
+ @li clazzes - the pointer members of each clazz struct, of its fields and methods (and a static field value if
+ it is a reference, or the pointer to the value of a static \c long or \c double), the pointer entries of its
+ constant pool, and the utfstring links.  Not the constant values, static primitive values, bytecode, or the index
+ and offset tables.
+ @li thread stacks - the frame headers, the cells of callback wedges, and the cells of Java and native frames that
+ hold an object (tested as the collector tests a stack cell) or a \c jsr return address into their method's code.
+ @li free chunks - their free list links and back pointer.
+ @li the VM's own structures - the pointer members of the VM threads and stack segments (pooled ones included),
+ monitors, native methods, exception backtraces, switch tables, string concatenations and file handles.  Raw data
+ chunks, classpath segments and socket polls hold no pointers.  Any other chunk (the pools, the root stacks and such
+ tables) is taken to be all pointers.
+
+ Nothing outside the heap and the globals is in a snapshot.  Before writing, the open jars, the boot classpath index,
+ any class image and any class files read ahead are let go (they are opened or built again on demand), and a
+ snapshot is not written at all if a tool is recording something to write at exit (allocation sites, a startup trace,
+ a perf map, an AOT file, a class image or a preload profile), or if arrays have identity hashes kept in a side table.
+
+ A snapshot is only good for the executable that wrote it, and only with the same command line (besides the snapshot
+ options themselves) - the options, the main class and its arguments.  It records the size of the executable, the
+ command line, and the size of each boot classpath file.  If any is different a snapshot is not used and the VM
+ initialises as usual.  Given both \c -snapshot and \c -snapshotwrite with the same file a VM uses the snapshot if it
+ is good, and makes it otherwise.
+
+ The snapshot file is made of (all in the native byte order and word size of the VM - a snapshot is not portable):
+
+ @li a header of words - the magic number #BVM_VM_SNAPSHOT_MAGIC, the version #BVM_VM_SNAPSHOT_VERSION, the word
+ size, the size of the executable image, the offset and size of the globals section in it, the address of the image,
+ the length and number of the command line arguments, and the numbers of boot classpath segments and heap regions.
+ @li the command line arguments, each null terminated.
+ @li for each boot classpath segment, the length of its name, the size of its file and its name.
+ @li for each heap region, its address, its size, and the offsets of the free 'hole' that is not written.
+ @li the bytes of each heap region, less its hole.
+ @li the pointer map of each heap region.
+ @li a mask with a bit for each word of the globals, set if the word was changed after the mark.
+ @li the bytes of the globals section.
+
+ @author Greg McCreath
+ @since 0.0.10
+
+*/
+
+#if BVM_VM_SNAPSHOT_ENABLE
+
+/** The snapshot to restore at VM startup.  Set with the \c -snapshot command line option. */
+BVM_VM_LOCAL char *bvm_gl_snapshot_filename = NULL;
+
+/** The snapshot to write once the main class is initialised.  Set with the \c -snapshotwrite command line option. */
+BVM_VM_LOCAL char *bvm_gl_snapshot_write_filename = NULL;
+
+/** The size of a boot classpath segment file that could not be opened */
+#define SS_NO_FILE_SIZE		((bvm_native_ulong_t) -1)
+
+/** The number of words in the snapshot header */
+#define SS_HEADER_WORDS		11
+
+/** The number of words that describe each heap region */
+#define SS_REGION_WORDS		4
+
+/** The number of bits in a mask word */
+#define SS_MASK_BITS		32
+
+/** The size of a slot of a heap pointer map.  Chunk user data follows a chunk header, so a pointer in the heap is
+ * aligned to the size of a header - which may be less than the size of a pointer. */
+#define SS_SLOT_SIZE		sizeof(bvm_chunk_header_t)
+
+/**
+ * The pointer map of a heap region while a snapshot is written.
+ */
+typedef struct _ssmapstruct {
+
+	/** the region */
+	bvm_heap_region_t *region;
+
+	/** the number of slots in the region */
+	bvm_native_ulong_t slots;
+
+	/** a bit for each slot, set if the slot holds a pointer */
+	bvm_uint32_t *bits;
+
+} ss_map_t;
+
+/**
+ * The copy of the globals section made by #bvm_snapshot_mark.  Deliberately not #BVM_VM_LOCAL - it must not be part
+ * of the section it is a copy of.
+ */
+static bvm_native_ulong_t *ss_mark_copy = NULL;
+
+/**
+ * The command line a snapshot records - kept by #bvm_snapshot_mark for the snapshot written later.
+ */
+static char **ss_argv = NULL;
+static int ss_argc = 0;
+
+/**
+ * The pointer maps of the heap regions while a snapshot is written.
+ */
+static ss_map_t *ss_maps = NULL;
+static bvm_native_ulong_t ss_nr_maps = 0;
+
+/**
+ * The old and new whereabouts of the executable image and each heap region while a snapshot is restored.
+ */
+typedef struct _ssrelocstruct {
+
+	/** the number of heap regions */
+	bvm_native_ulong_t nr_regions;
+
+	/** for each region (and the image first), its old address, its size, and its new address */
+	bvm_native_ulong_t *ranges;
+
+	/** the lowest old address in any range */
+	bvm_native_ulong_t low;
+
+	/** the highest old address in any range */
+	bvm_native_ulong_t high;
+
+} ss_reloc_t;
+
+/**
+ * Report the size of the globals section.
+ */
+static size_t ss_state_size() {
+	return (bvm_uint8_t *) BVM_PD_VM_STATE_END - (bvm_uint8_t *) BVM_PD_VM_STATE_START;
+}
+
+/**
+ * Report the number of bytes of a mask with the given number of bits.
+ */
+static size_t ss_bits_size(bvm_native_ulong_t bits) {
+	return ((bits + SS_MASK_BITS - 1) / SS_MASK_BITS) * sizeof(bvm_uint32_t);
+}
+
+/**
+ * Report the number of bytes of the mask of changed words of the globals section.
+ */
+static size_t ss_mask_size() {
+	return ss_bits_size(ss_state_size() / sizeof(bvm_native_ulong_t));
+}
+
+/**
+ * Report whether an option is one of the snapshot options - those are left out of the command line a snapshot records.
+ */
+static bvm_bool_t ss_is_snapshot_option(const char *option) {
+	return (strcmp(option, "-snapshot") == 0) || (strcmp(option, "-snapshotwrite") == 0);
+}
+
+/**
+ * Gather the command line a snapshot records - the options less the snapshot options, then the main class name and
+ * its arguments.
+ *
+ * @param optc - the number of command line options.
+ * @param optv - the command line options.
+ * @param ac - the number of arguments after the options.
+ * @param av - the arguments after the options.
+ * @param args - where to put the arguments - room for \c optc + \c ac.
+ * @return the number of arguments put.
+ */
+static int ss_arguments(int optc, char *optv[], int ac, char *av[], char *args[]) {
+
+	int count = 0;
+	int lc;
+
+	for (lc = 0; lc < optc; lc++) {
+		if (ss_is_snapshot_option(optv[lc]))
+			lc++;
+		else
+			args[count++] = optv[lc];
+	}
+
+	for (lc = 0; lc < ac; lc++) args[count++] = av[lc];
+
+	return count;
+}
+
+/**
+ * Report the length of the command line a snapshot records.  Each argument is counted with its null terminator.
+ */
+static bvm_native_ulong_t ss_arguments_length(int argc, char *argv[]) {
+
+	bvm_native_ulong_t length = 0;
+	int lc;
+
+	for (lc = 0; lc < argc; lc++) length += strlen(argv[lc]) + 1;
+
+	return length;
+}
+
+/**
+ * Report whether a recorded command line matches the given one.
+ */
+static bvm_bool_t ss_arguments_match(const char *recorded, bvm_native_ulong_t length, int argc, char *argv[]) {
+
+	bvm_native_ulong_t position = 0, size;
+	int lc;
+
+	for (lc = 0; lc < argc; lc++) {
+
+		size = strlen(argv[lc]) + 1;
+		if ( (length - position < size) || (memcmp(recorded + position, argv[lc], size) != 0) ) return BVM_FALSE;
+
+		position += size;
+	}
+
+	return (position == length);
+}
+
+/**
+ * Report the size of a boot classpath segment file, or #SS_NO_FILE_SIZE if there is none.  The platform file functions
+ * are used directly - a snapshot is checked before there is a heap for the VM file handling.
+ */
+static bvm_native_ulong_t ss_segment_size(const char *segment) {
+
+	bvm_native_ulong_t size;
+	void *handle = bvm_pd_file_open(segment, BVM_FILE_O_RDONLY);
+
+	if (handle == NULL) return SS_NO_FILE_SIZE;
+
+	size = (bvm_native_ulong_t) bvm_pd_file_sizeof(handle);
+	bvm_pd_file_close(handle);
+
+	return size;
+}
+
+/**
+ * Report the total size of a heap region - from the region struct to the end of its fence chunk.
+ */
+static bvm_native_ulong_t ss_region_size(bvm_heap_region_t *region) {
+	return (region->end - (bvm_uint8_t *) region) + BVM_CHUNK_GetSize( (bvm_chunk_t *) region->end);
+}
+
+/**
+ * Find the part of a heap region that need not be written - the inside of its largest free chunk.  The chunk's
+ * free list links and its back pointer are kept.
+ *
+ * @param region - the region.
+ * @param start - where to put the offset of the start of the hole in the region.
+ * @param end - where to put the offset of the end of the hole in the region.  Same as \c start if there is no hole.
+ */
+static void ss_region_hole(bvm_heap_region_t *region, bvm_native_ulong_t *start, bvm_native_ulong_t *end) {
+
+	bvm_chunk_t *chunk = (bvm_chunk_t *) region->start;
+	bvm_chunk_t *largest = NULL;
+
+	while (BVM_CHUNK_AsBytePtr(chunk) < region->end) {
+		if (!BVM_CHUNK_IsInuse(chunk) &&
+			( (largest == NULL) || (BVM_CHUNK_GetSize(chunk) > BVM_CHUNK_GetSize(largest)) )) largest = chunk;
+		chunk = BVM_CHUNK_GetNextChunk(chunk);
+	}
+
+	*start = *end = 0;
+
+	if ( (largest != NULL) && (BVM_CHUNK_GetSize(largest) > BVM_CHUNK_MIN_SIZE) ) {
+		*start = (BVM_CHUNK_AsBytePtr(largest) + sizeof(bvm_chunk_t)) - (bvm_uint8_t *) region;
+		*end = (BVM_CHUNK_AsBytePtr(largest) + BVM_CHUNK_GetSize(largest) - sizeof(bvm_chunk_t *)) - (bvm_uint8_t *) region;
+	}
+}
+
+/**
+ * Write bytes to a snapshot file.
+ */
+static bvm_bool_t ss_write(const void *src, size_t size, void *handle) {
+	return (bvm_pd_file_write(src, size, handle) == size);
+}
+
+/**
+ * Read bytes from a snapshot file.
+ */
+static bvm_bool_t ss_read(void *dst, size_t size, void *handle) {
+	return (bvm_pd_file_read(dst, size, handle) == size);
+}
+
+/**
+ * Report the pointer map of the heap region an address is in, or \c NULL if it is not in the heap.
+ */
+static ss_map_t *ss_map_find(void *address) {
+
+	bvm_native_ulong_t lc;
+
+	for (lc = 0; lc < ss_nr_maps; lc++) {
+		bvm_uint8_t *region = (bvm_uint8_t *) ss_maps[lc].region;
+		if ( ((bvm_uint8_t *) address >= region) && ((bvm_uint8_t *) address < region + ss_maps[lc].slots * SS_SLOT_SIZE) )
+			return &ss_maps[lc];
+	}
+
+	return NULL;
+}
+
+/**
+ * Mark a slot of the heap as holding a pointer.  Nothing is done for an address outside the heap.
+ */
+static void ss_map_set(void *slot) {
+
+	ss_map_t *map = ss_map_find(slot);
+	bvm_native_ulong_t index;
+
+	if (map == NULL) return;
+
+	index = ((bvm_uint8_t *) slot - (bvm_uint8_t *) map->region) / SS_SLOT_SIZE;
+	map->bits[index / SS_MASK_BITS] |= ( (bvm_uint32_t) 1 << (index % SS_MASK_BITS));
+}
+
+/**
+ * Mark each word of a part of the heap as holding a pointer.
+ */
+static void ss_map_words(void *start, void *end) {
+
+	bvm_uint8_t *word;
+
+	for (word = start; word + sizeof(bvm_native_ulong_t) <= (bvm_uint8_t *) end; word += sizeof(bvm_native_ulong_t))
+		ss_map_set(word);
+}
+
+/**
+ * Mark all of a heap allocation, from its start to the end of its chunk, as holding no pointers.  Nothing is done for
+ * \c NULL or an address outside the heap.
+ */
+static void ss_map_data(void *ptr) {
+
+	bvm_chunk_t *chunk;
+	ss_map_t *map;
+	bvm_native_ulong_t index, end;
+
+	if ( (ptr == NULL) || !BVM_HEAP_IsHeapAddress(ptr)) return;
+
+	chunk = BVM_CHUNK_GetPointerChunk(ptr);
+	map = ss_map_find(ptr);
+
+	if (map == NULL) return;
+
+	index = ((bvm_uint8_t *) ptr - (bvm_uint8_t *) map->region) / SS_SLOT_SIZE;
+	end = ((BVM_CHUNK_AsBytePtr(chunk) + BVM_CHUNK_GetSize(chunk)) - (bvm_uint8_t *) map->region) / SS_SLOT_SIZE;
+
+	for (; index < end; index++) map->bits[index / SS_MASK_BITS] &= ~( (bvm_uint32_t) 1 << (index % SS_MASK_BITS));
+}
+
+/**
+ * Map a Java object - its clazz, and its reference fields or elements.
+ *
+ * @param obj - the object.
+ * @param type - the alloc type it would have as a collected object - an object kept as #BVM_ALLOC_TYPE_STATIC is
+ * mapped as the object it is.
+ */
+static void ss_map_object(bvm_obj_t *obj, int type) {
+
+	bvm_instance_clazz_t *clazz;
+	bvm_uint16_t *offsets;
+	bvm_native_ulong_t lc;
+
+	ss_map_data(obj);
+	ss_map_set(&obj->clazz);
+
+	if (type == BVM_ALLOC_TYPE_ARRAY_OF_PRIMITIVE) return;
+
+	if (type == BVM_ALLOC_TYPE_ARRAY_OF_OBJECT) {
+		bvm_instance_array_obj_t *array = (bvm_instance_array_obj_t *) obj;
+		for (lc = 0; lc < (bvm_native_ulong_t) array->length.int_value; lc++) ss_map_set(&array->data[lc]);
+		return;
+	}
+
+	clazz = (bvm_instance_clazz_t *) obj->clazz;
+	offsets = clazz->ref_field_offsets;
+
+	for (lc = 0; lc < clazz->ref_fields_count; lc++) ss_map_set(&obj->fields[offsets[lc]]);
+
+	if ( (type == BVM_ALLOC_TYPE_WEAK_REFERENCE) || (type == BVM_ALLOC_TYPE_SOFT_REFERENCE) ||
+		 (type == BVM_ALLOC_TYPE_EPHEMERON) ) {
+		ss_map_set( &((bvm_weak_reference_obj_t *) obj)->referent);
+		ss_map_set( &((bvm_weak_reference_obj_t *) obj)->next);
+	}
+
+	if (type == BVM_ALLOC_TYPE_EPHEMERON) ss_map_set( &((bvm_ephemeron_obj_t *) obj)->value);
+}
+
+/**
+ * Map a utfstring that is an allocation of its own - its chars follow it.
+ */
+static void ss_map_utfstring(bvm_utfstring_t *utfstring) {
+	ss_map_data(utfstring);
+	ss_map_set(&utfstring->data);
+	ss_map_set(&utfstring->next);
+}
+
+/**
+ * Mark a slot of the heap as holding a pointer while a snapshot is written.  For the modules that keep structures of
+ * their own in the heap - see #bvm_snapshot_map_data.
+ *
+ * @param slot - the slot.  Nothing is done for an address outside the heap.
+ */
+void bvm_snapshot_map_pointer(void *slot) {
+	ss_map_set(slot);
+}
+
+/**
+ * Mark a heap allocation as holding no pointers while a snapshot is written.  The chunks of the VM's own structures
+ * are taken as all pointers unless the module that keeps them says otherwise - it calls this, then
+ * #bvm_snapshot_map_pointer for each pointer member.
+ *
+ * @param ptr - the allocation.  Nothing is done for \c NULL or an address outside the heap.
+ */
+void bvm_snapshot_map_data(void *ptr) {
+	ss_map_data(ptr);
+}
+
+/**
+ * Map a compact exception backtrace.
+ */
+static void ss_map_backtrace(bvm_stack_backtrace_t *backtrace) {
+
+	bvm_int32_t lc;
+
+	ss_map_data(backtrace);
+
+	for (lc = 0; lc < backtrace->depth; lc++) {
+#if BVM_STACKTRACE_LAZY_ENABLE
+		ss_map_set(&backtrace->frames[lc].method);
+		ss_map_set(&backtrace->frames[lc].pc);
+#else
+		ss_map_set(&backtrace->frames[lc].clazz_name);
+		ss_map_set(&backtrace->frames[lc].method_name);
+		ss_map_set(&backtrace->frames[lc].file_name);
+#endif
+	}
+}
+
+/**
+ * Map a method struct, and what it holds that is its own.
+ */
+static void ss_map_method(bvm_method_t *method) {
+
+	bvm_uint16_t lc;
+
+	ss_map_set(&method->clazz);
+	ss_map_set(&method->exceptions);
+	ss_map_set(&method->name);
+	ss_map_set(&method->jni_signature);
+	ss_map_set(&method->code);
+#if BVM_EXEC_HANDLER_INDEX_ENABLE
+	ss_map_set(&method->exception_index);
+#endif
+#if BVM_AOT_ENABLE
+	ss_map_set(&method->aot_code);
+#endif
+#if BVM_GC_STACK_MAPS_ENABLE
+	/* stack maps are outside the heap - they are worked out again when next needed */
+	bvm_stackmap_free(method);
+#endif
+#if BVM_EXEC_SWITCH_TABLES_ENABLE
+	ss_map_set(&method->switch_tables);
+#endif
+#if BVM_EXEC_STRING_CONCAT_ENABLE
+	ss_map_set(&method->concats);
+#endif
+#if (BVM_EXEC_SWITCH_TABLES_ENABLE || BVM_EXEC_STRING_CONCAT_ENABLE)
+	bvm_exec_snapshot_map(method);
+#endif
+#if (BVM_LINE_NUMBERS_ENABLE || BVM_DEBUGGER_ENABLE)
+	ss_map_set(&method->line_numbers);
+	ss_map_data(method->line_numbers);
+#endif
+#if BVM_DEBUGGER_ENABLE
+#if BVM_DEBUGGER_SIGNATURES_ENABLE
+	ss_map_set(&method->generic_signature);
+#endif
+	ss_map_set(&method->local_variables);
+	if (method->local_variables != NULL) {
+		ss_map_data(method->local_variables);
+		for (lc = 0; lc < method->local_variable_count; lc++) {
+			ss_map_set(&method->local_variables[lc].name);
+			ss_map_set(&method->local_variables[lc].desc);
+		}
+	}
+#endif
+
+	if (method->exceptions != NULL) {
+		ss_map_data(method->exceptions);
+		for (lc = 0; lc < method->exceptions_count; lc++) {
+			ss_map_set(&method->exceptions[lc].catch_type);
+#if BVM_EXEC_FAST_THROW_ENABLE
+			ss_map_set(&method->exceptions[lc].catch_clazz);
+#endif
+		}
+	}
+
+#if BVM_EXEC_HANDLER_INDEX_ENABLE
+	if (method->exception_index != NULL) {
+		ss_map_data(method->exception_index);
+		ss_map_set(&method->exception_index->first);
+		ss_map_set(&method->exception_index->starts);
+		ss_map_set(&method->exception_index->handlers);
+	}
+#endif
+
+	/* the bytecode holds no pointers - nor does the rest of a code attribute kept with it */
+	if (!BVM_METHOD_IsNative(method) && (method->code.bytecode != NULL) && BVM_HEAP_IsHeapAddress(method->code.bytecode)) {
+#if BVM_CLAZZ_LAZY_CODE_TABLES_ENABLE
+		ss_map_data(BVM_METHOD_CodeBuffer(method));
+#if BVM_FILE_MAP_ENABLE
+		ss_map_set(&BVM_METHOD_CodeBuffer(method)->data);
+#endif
+#else
+		ss_map_data(method->code.bytecode);
+#endif
+	}
+
+	UNUSED(lc);
+}
+
+/**
+ * Map a clazz struct, and what it holds that is its own.
+ */
+static void ss_map_clazz(bvm_clazz_t *clazz, int type) {
+
+	bvm_instance_clazz_t *instance_clazz = (bvm_instance_clazz_t *) clazz;
+	bvm_clazzconstant_t *cp;
+	bvm_native_ulong_t lc, count;
+
+	ss_map_data(clazz);
+
+	/* the name of an array or primitive clazz is not pooled */
+	if (clazz->name != NULL) ss_map_utfstring(clazz->name);
+
+	ss_map_set(&clazz->name);
+	ss_map_set(&clazz->package);
+	ss_map_set(&clazz->class_obj);
+	ss_map_set(&clazz->super_clazz);
+	ss_map_set(&clazz->next);
+	ss_map_set(&clazz->classloader_obj);
+
+	if (type == BVM_ALLOC_TYPE_ARRAY_CLAZZ) {
+#if BVM_DEBUGGER_ENABLE
+		ss_map_set( &((bvm_array_clazz_t *) clazz)->jni_signature);
+#endif
+		ss_map_set( &((bvm_array_clazz_t *) clazz)->component_clazz);
+		return;
+	}
+
+	if (type == BVM_ALLOC_TYPE_PRIMITIVE_CLAZZ) {
+#if BVM_DEBUGGER_ENABLE
+		ss_map_set( &((bvm_primitive_clazz_t *) clazz)->jni_signature);
+#endif
+		return;
+	}
+
+	ss_map_set(&instance_clazz->constant_pool);
+	ss_map_set(&instance_clazz->interfaces);
+	ss_map_set(&instance_clazz->fields);
+	ss_map_set(&instance_clazz->static_longs);
+	ss_map_set(&instance_clazz->methods);
+	ss_map_set(&instance_clazz->ref_field_offsets);
+#if BVM_DEBUGGER_ENABLE
+	ss_map_set(&instance_clazz->jni_signature);
+	if (instance_clazz->jni_signature != NULL) ss_map_utfstring(instance_clazz->jni_signature);
+#endif
+#if BVM_CLAZZ_MEMBER_INDEX_ENABLE
+	ss_map_set(&instance_clazz->method_index);
+	ss_map_set(&instance_clazz->field_index);
+	ss_map_data(instance_clazz->method_index);
+	ss_map_data(instance_clazz->field_index);
+#endif
+#if BVM_CLAZZ_DISPATCH_TABLES_ENABLE
+	ss_map_set(&instance_clazz->vtable);
+	ss_map_set(&instance_clazz->itable);
+#endif
+#if BVM_CLAZZ_TYPE_DISPLAYS_ENABLE
+	ss_map_set(&instance_clazz->super_display);
+	ss_map_set(&instance_clazz->interface_set);
+	ss_map_data(instance_clazz->interface_set);
+#endif
+#if (BVM_LINE_NUMBERS_ENABLE || BVM_DEBUGGER_ENABLE)
+	ss_map_set(&instance_clazz->source_file_name);
+#endif
+#if (BVM_DEBUGGER_ENABLE && BVM_DEBUGGER_JSR045_ENABLE)
+	ss_map_set(&instance_clazz->source_debug_extension);
+	if (instance_clazz->source_debug_extension != NULL) ss_map_utfstring(instance_clazz->source_debug_extension);
+#endif
+#if (BVM_DEBUGGER_ENABLE && BVM_DEBUGGER_SIGNATURES_ENABLE)
+	ss_map_set(&instance_clazz->generic_signature);
+#endif
+
+	ss_map_data(instance_clazz->ref_field_offsets);
+	ss_map_data(instance_clazz->static_longs);
+
+	/* each constant may be resolved to a pointer, but only a utfstring, class or string constant holds one */
+	cp = instance_clazz->constant_pool;
+	if (cp != NULL) {
+
+		count = (bvm_native_ulong_t) cp[0].data.value.int_value;
+
+		ss_map_data(cp);
+
+		for (lc = 0; lc <= count; lc++) {
+
+			ss_map_set(&cp[lc].resolved_ptr);
+
+			if (lc > 0) {
+				switch (BVM_CONSTANT_Tag(instance_clazz, lc)) {
+					case BVM_CONSTANT_Utf8:
+					case BVM_CONSTANT_Class:
+					case BVM_CONSTANT_String:
+						ss_map_set(&cp[lc].data.value);
+						break;
+					case BVM_CONSTANT_Long:
+					case BVM_CONSTANT_Double:
+						lc++;
+						break;
+				}
+			}
+		}
+	}
+
+	if (instance_clazz->fields != NULL) {
+
+		ss_map_data(instance_clazz->fields);
+
+		for (lc = 0; lc < instance_clazz->fields_count; lc++) {
+
+			bvm_field_t *field = &instance_clazz->fields[lc];
+
+			ss_map_set(&field->clazz);
+			ss_map_set(&field->name);
+			ss_map_set(&field->jni_signature);
+#if (BVM_DEBUGGER_ENABLE && BVM_DEBUGGER_SIGNATURES_ENABLE)
+			ss_map_set(&field->generic_signature);
+#endif
+			/* a static long value is kept in the static longs - the field points to it */
+			if (BVM_FIELD_IsStatic(field) && (BVM_FIELD_IsReference(field) || BVM_FIELD_IsLong(field)))
+				ss_map_set(&field->value.static_value);
+		}
+	}
+
+	if (instance_clazz->methods != NULL) {
+
+		ss_map_data(instance_clazz->methods);
+
+		for (lc = 0; lc < instance_clazz->methods_count; lc++) ss_map_method(&instance_clazz->methods[lc]);
+	}
+}
+
+/**
+ * Report whether a cell of a Java or native frame holds a pointer - an object, or a \c jsr return address into the
+ * code of the frame's method.  An object is tested for as the collector tests a stack cell.
+ */
+static bvm_bool_t ss_is_pointer_cell(bvm_method_t *method, bvm_cell_t *cell) {
+
+	bvm_obj_t *obj = cell->ref_value;
+	bvm_chunk_t *chunk;
+	int type;
+
+	if (!BVM_HEAP_IsHeapAddress(obj)) return BVM_FALSE;
+
+	if (!BVM_METHOD_IsNative(method) && BVM_HEAP_IsHeapAddress(method->code.bytecode)) {
+#if BVM_CLAZZ_LAZY_CODE_TABLES_ENABLE
+		chunk = BVM_CHUNK_GetPointerChunk(BVM_METHOD_CodeBuffer(method));
+#else
+		chunk = BVM_CHUNK_GetPointerChunk(method->code.bytecode);
+#endif
+		if ( ((bvm_uint8_t *) obj >= method->code.bytecode) &&
+			 ((bvm_uint8_t *) obj < BVM_CHUNK_AsBytePtr(chunk) + BVM_CHUNK_GetSize(chunk)) ) return BVM_TRUE;
+	}
+
+	if (!BVM_HEAP_IsHeapAddress(obj->clazz) || (obj->clazz->magic_number != BVM_MAGIC_NUMBER)) return BVM_FALSE;
+
+	chunk = BVM_CHUNK_GetPointerChunk(obj);
+	type = BVM_CHUNK_GetType(chunk);
+
+	return BVM_CHUNK_IsInuse(chunk) &&
+		   ( (type <= BVM_ALLOC_MAX_OBJECT) || (type == BVM_ALLOC_TYPE_STATIC) ) &&
+		   bvm_heap_is_chunk_valid(chunk);
+}
+
+/**
+ * Map a VM thread, its stack segments, and the frames on them.  The frames are walked as the collector walks them.
+ */
+static void ss_map_thread(bvm_vmthread_t *vmthread) {
+
+	bvm_stacksegment_t *stack;
+	bvm_method_t *frame_method = vmthread->rx_method;
+	bvm_cell_t *frame_locals = vmthread->rx_locals;
+	bvm_cell_t *frame_top = vmthread->rx_sp;
+	bvm_cell_t *cell_ptr;
+	bvm_bool_t is_base;
+
+	ss_map_data(vmthread);
+	ss_map_set(&vmthread->thread_obj);
+	ss_map_set(&vmthread->stack_list);
+	ss_map_set(&vmthread->rx_stack);
+	ss_map_set(&vmthread->rx_sp);
+	ss_map_set(&vmthread->rx_pc);
+	ss_map_set(&vmthread->rx_locals);
+	ss_map_set(&vmthread->rx_method);
+	ss_map_set(&vmthread->waiting_on_object);
+#if BVM_THREAD_PRIORITY_INHERITANCE_ENABLE
+	ss_map_set(&vmthread->blocked_on);
+#endif
+#if BVM_FILE_ASYNC_ENABLE
+	ss_map_set(&vmthread->file_async);
+#endif
+#if BVM_SCOPED_MEMORY_ENABLE
+	ss_map_set(&vmthread->scope);
+#endif
+	ss_map_set(&vmthread->pending_exception);
+	ss_map_set(&vmthread->callback);
+	ss_map_set(&vmthread->next);
+	ss_map_set(&vmthread->next_in_list);
+	ss_map_set(&vmthread->next_in_queue);
+	ss_map_set(&vmthread->prev_in_queue);
+#if BVM_PROFILER_MONITOR_CONTENTION_ENABLE
+	ss_map_set(&vmthread->contention_site);
+#endif
+	ss_map_set(&vmthread->exception_location.throwable);
+	ss_map_set(&vmthread->exception_location.method);
+#if BVM_NATIVE_ACCESS_CONTEXT_CACHE_ENABLE
+	ss_map_set(&vmthread->access_context);
+#endif
+#if BVM_DEBUGGER_ENABLE
+	ss_map_set(&vmthread->dbg_parked_events);
+	ss_map_set(&vmthread->dbg_step.method);
+#endif
+
+	/* a cell of a stack is only a pointer if a frame says so */
+	for (stack = vmthread->stack_list; stack != NULL; stack = stack->next) {
+		ss_map_data(stack);
+		ss_map_set(&stack->top);
+		ss_map_set(&stack->next);
+#if BVM_FRAME_COMPACT_ENABLE
+		ss_map_set(&stack->prev);
+#endif
+	}
+
+	if ( (vmthread->status == BVM_THREAD_STATUS_TERMINATED) || (vmthread->stack_list == NULL) || (frame_method == NULL) )
+		return;
+
+	do {
+
+		/* the bottom of the stack is the wedge that terminates the thread */
+		is_base = (frame_method == BVM_METHOD_CALLBACKWEDGE) &&
+				  (frame_locals[1].callback == bvm_thread_terminated_callback);
+
+		/* the frame header is all pointers */
+		for (cell_ptr = frame_locals - BVM_STACK_FrameSize(frame_method); cell_ptr < frame_locals; cell_ptr++)
+			ss_map_set(cell_ptr);
+
+		if (frame_method == BVM_METHOD_CALLBACKWEDGE) {
+
+			/* a wedge holds its callback and the callback's data */
+			for (cell_ptr = frame_locals; cell_ptr < frame_top; cell_ptr++) ss_map_set(cell_ptr);
+
+		} else {
+
+			/* the arguments of a native method are at the top of the calling frame - see the collector */
+			if (BVM_METHOD_IsNative(frame_method)) {
+				cell_ptr = frame_locals[BVM_FRAME_SP_OFFSET].ptr_value;
+				frame_top = cell_ptr + frame_method->num_args + ( BVM_METHOD_IsStatic(frame_method) ? 0 : 1);
+			} else {
+				cell_ptr = frame_locals;
+			}
+
+			for (; cell_ptr < frame_top; cell_ptr++) {
+				if (ss_is_pointer_cell(frame_method, cell_ptr)) ss_map_set(cell_ptr);
+			}
+		}
+
+		frame_method = frame_locals[BVM_FRAME_METHOD_OFFSET].ptr_value;
+		frame_top = frame_locals[BVM_FRAME_SP_OFFSET].ptr_value;
+		frame_locals = frame_locals[BVM_FRAME_LOCALS_OFFSET].ptr_value;
+
+	} while (!is_base);
+}
+
+/**
+ * Build the pointer maps of the heap regions.  A first walk over the chunks of each region maps the Java objects and
+ * the free chunks, and takes every word of every other chunk as a pointer.  Then the structures known to hold data
+ * other than pointers - clazzes, utfstrings, interned strings, threads and stacks - are mapped as what they are.
+ *
+ * @return #BVM_TRUE if the maps were built, #BVM_FALSE if there was no memory for them.
+ */
+static bvm_bool_t ss_map_build() {
+
+	bvm_heap_region_t *region;
+	bvm_chunk_t *chunk;
+	bvm_vmthread_t *vmthread;
+	bvm_monitor_t *monitor;
+	ss_map_t *map;
+	int lc, type;
+
+	for (ss_nr_maps = 0, region = bvm_gl_heap_regions; region != NULL; region = region->next) ss_nr_maps++;
+
+	ss_maps = bvm_pd_memory_alloc(ss_nr_maps * sizeof(ss_map_t));
+	if (ss_maps == NULL) return BVM_FALSE;
+
+	for (map = ss_maps, region = bvm_gl_heap_regions; region != NULL; region = region->next, map++) {
+		map->region = region;
+		map->slots = ss_region_size(region) / SS_SLOT_SIZE;
+		map->bits = bvm_pd_memory_alloc(ss_bits_size(map->slots));
+		if (map->bits == NULL) return BVM_FALSE;
+		memset(map->bits, 0, ss_bits_size(map->slots));
+	}
+
+	/* the chunks, by their type */
+	for (region = bvm_gl_heap_regions; region != NULL; region = region->next) {
+
+		ss_map_set(&region->next);
+		ss_map_set(&region->start);
+		ss_map_set(&region->end);
+
+		for (chunk = (bvm_chunk_t *) region->start; BVM_CHUNK_AsBytePtr(chunk) < region->end; chunk = BVM_CHUNK_GetNextChunk(chunk)) {
+
+			bvm_uint8_t *chunk_end = BVM_CHUNK_AsBytePtr(chunk) + BVM_CHUNK_GetSize(chunk);
+
+			if (!BVM_CHUNK_IsInuse(chunk)) {
+				if (BVM_CHUNK_GetSize(chunk) >= BVM_CHUNK_MIN_SIZE) {
+					ss_map_set(&chunk->next_free_chunk);
+					ss_map_set(&chunk->prev_free_chunk);
+				}
+				if (BVM_CHUNK_GetSize(chunk) >= sizeof(bvm_chunk_header_t) + sizeof(bvm_chunk_t *))
+					ss_map_set(chunk_end - sizeof(bvm_chunk_t *));
+				continue;
+			}
+
+			type = BVM_CHUNK_GetType(chunk);
+
+			/* raw data holds no pointers - a stack segment or utfstring that is data is mapped below */
+			if (type <= BVM_ALLOC_MAX_OBJECT)
+				ss_map_object(BVM_CHUNK_GetUserData(chunk), type);
+			else if (type == BVM_ALLOC_TYPE_BACKTRACE)
+				ss_map_backtrace(BVM_CHUNK_GetUserData(chunk));
+			else if (type != BVM_ALLOC_TYPE_DATA)
+				ss_map_words(BVM_CHUNK_GetUserData(chunk), chunk_end);
+		}
+	}
+
+	/* the clazzes */
+	for (region = bvm_gl_heap_regions; region != NULL; region = region->next) {
+		for (chunk = (bvm_chunk_t *) region->start; BVM_CHUNK_AsBytePtr(chunk) < region->end; chunk = BVM_CHUNK_GetNextChunk(chunk)) {
+			type = BVM_CHUNK_GetType(chunk);
+			if (BVM_CHUNK_IsInuse(chunk) && (type >= BVM_ALLOC_TYPE_ARRAY_CLAZZ) && (type <= BVM_ALLOC_TYPE_INSTANCE_CLAZZ))
+				ss_map_clazz(BVM_CHUNK_GetUserData(chunk), type);
+		}
+	}
+
+	/* the pooled utfstrings - the names and signatures of everything */
+	for (lc = bvm_gl_utfstring_pool_bucketcount; lc--;) {
+		bvm_utfstring_t *utfstring;
+		for (utfstring = bvm_gl_utfstring_pool[lc]; utfstring != NULL; utfstring = utfstring->next)
+			ss_map_utfstring(utfstring);
+	}
+
+	/* the interned strings - static, so not mapped as objects by their chunks */
+	for (lc = bvm_gl_internstring_pool_bucketcount; lc--;) {
+		bvm_internstring_obj_t *string;
+		for (string = bvm_gl_internstring_pool[lc]; string != NULL; string = string->next) {
+			ss_map_object( (bvm_obj_t *) string, BVM_ALLOC_TYPE_STRING);
+			ss_map_set(&string->utfstring);
+			ss_map_set(&string->next);
+			ss_map_object( (bvm_obj_t *) string->chars, BVM_ALLOC_TYPE_ARRAY_OF_PRIMITIVE);
+		}
+	}
+
+	/* the native methods */
+	for (lc = bvm_gl_native_method_pool_bucketcount; lc--;) {
+		bvm_native_method_desc_t *desc;
+		for (desc = bvm_gl_native_method_pool[lc]; desc != NULL; desc = desc->next) {
+			ss_map_data(desc);
+			ss_map_set(&desc->clazzname);
+			ss_map_set(&desc->name);
+			ss_map_set(&desc->desc);
+			ss_map_set(&desc->method);
+#if BVM_AOT_ENABLE
+			ss_map_set(&desc->aot_method);
+#endif
+			ss_map_set(&desc->next);
+		}
+	}
+
+	/* the monitors */
+	for (monitor = bvm_gl_thread_monitor_list; monitor != NULL; monitor = monitor->next) {
+		ss_map_data(monitor);
+		ss_map_set(&monitor->owner_object);
+		ss_map_set(&monitor->owner_thread);
+		ss_map_set(&monitor->lock_queue);
+		ss_map_set(&monitor->wait_queue);
+		ss_map_set(&monitor->next);
+		ss_map_set(&monitor->next_in_bucket);
+	}
+
+	for (lc = 0; (lc < BVM_MAX_CLASSPATH_SEGMENTS) && (bvm_gl_boot_classpath_segments[lc] != NULL); lc++)
+		ss_map_data(bvm_gl_boot_classpath_segments[lc]);
+	for (lc = 0; (lc < BVM_MAX_CLASSPATH_SEGMENTS) && (bvm_gl_user_classpath_segments[lc] != NULL); lc++)
+		ss_map_data(bvm_gl_user_classpath_segments[lc]);
+
+#if BVM_CLAZZ_TYPE_DISPLAYS_ENABLE
+	bvm_clazz_snapshot_map();
+#endif
+	bvm_file_snapshot_map();
+	bvm_thread_snapshot_map();
+
+#if BVM_NATIVE_BOX_CACHE_ENABLE
+	for (lc = BVM_NATIVE_BOX_INTEGER_MAX - BVM_NATIVE_BOX_INTEGER_MIN + 1; lc--;) {
+		if (bvm_gl_native_integer_boxes[lc] != NULL)
+			ss_map_object(bvm_gl_native_integer_boxes[lc], BVM_ALLOC_TYPE_OBJECT);
+	}
+	for (lc = BVM_NATIVE_BOX_CHARACTER_MAX + 1; lc--;) {
+		if (bvm_gl_native_character_boxes[lc] != NULL)
+			ss_map_object(bvm_gl_native_character_boxes[lc], BVM_ALLOC_TYPE_OBJECT);
+	}
+#endif
+
+	for (vmthread = bvm_gl_threads; vmthread != NULL; vmthread = vmthread->next) ss_map_thread(vmthread);
+
+	return BVM_TRUE;
+}
+
+/**
+ * Let go of the pointer maps of the heap regions.
+ */
+static void ss_map_release() {
+
+	bvm_native_ulong_t lc;
+
+	if (ss_maps == NULL) return;
+
+	for (lc = 0; lc < ss_nr_maps; lc++) {
+		if (ss_maps[lc].bits != NULL) bvm_pd_memory_free(ss_maps[lc].bits);
+	}
+
+	bvm_pd_memory_free(ss_maps);
+	ss_maps = NULL;
+	ss_nr_maps = 0;
+}
+
+/**
+ * Clear the bit of a global in the mask of changed words of the globals section, so it is not taken from a snapshot.
+ */
+static void ss_mask_clear(bvm_uint32_t *mask, void *global) {
+
+	bvm_native_ulong_t lc = ((bvm_uint8_t *) global - (bvm_uint8_t *) BVM_PD_VM_STATE_START) / sizeof(bvm_native_ulong_t);
+
+	if ( ((bvm_uint8_t *) global >= (bvm_uint8_t *) BVM_PD_VM_STATE_START) && ((bvm_uint8_t *) global < (bvm_uint8_t *) BVM_PD_VM_STATE_END) )
+		mask[lc / SS_MASK_BITS] &= ~( (bvm_uint32_t) 1 << (lc % SS_MASK_BITS));
+}
+
+/**
+ * Copy the globals section before VM initialisation, so that the words changed before a snapshot is written can be
+ * told.  Must be called after the command line has been parsed.
+ *
+ * @param optc - the number of command line options.
+ * @param optv - the command line options.
+ * @param ac - the number of arguments after the options - the startup class name and the arguments to \c main.
+ * @param av - the arguments after the options.
+ */
+void bvm_snapshot_mark(int optc, char *optv[], int ac, char *av[]) {
+
+#if BVM_CONSOLE_BUFFER_ENABLE
+	/* the console buffer is in the section - have it empty, as it will be when written */
+	bvm_pd_console_flush();
+#endif
+
+	ss_mark_copy = bvm_pd_memory_alloc(ss_state_size());
+	ss_argv = bvm_pd_memory_alloc( (optc + ac + 1) * sizeof(char *));
+
+	if ( (ss_mark_copy == NULL) || (ss_argv == NULL) ) {
+		if (ss_mark_copy != NULL) bvm_pd_memory_free(ss_mark_copy);
+		if (ss_argv != NULL) bvm_pd_memory_free(ss_argv);
+		ss_mark_copy = NULL;
+		ss_argv = NULL;
+		return;
+	}
+
+	memcpy(ss_mark_copy, BVM_PD_VM_STATE_START, ss_state_size());
+	ss_argc = ss_arguments(optc, optv, ac, av, ss_argv);
+}
+
+/**
+ * Write a snapshot of the VM.  Called at the ready point, with the registers of the current thread stored.  See the
+ * overview for what is written.
+ *
+ * @param filename - the name of the snapshot file.
+ * @return #BVM_TRUE if the snapshot was written, #BVM_FALSE if it could not be.
+ */
+static bvm_bool_t ss_snapshot_write(const char *filename) {
+
+	bvm_native_ulong_t header[SS_HEADER_WORDS];
+	bvm_native_ulong_t table[SS_REGION_WORDS];
+	bvm_native_ulong_t *state = BVM_PD_VM_STATE_START;
+	bvm_native_ulong_t nr_segments, nr_regions, lc, size;
+	bvm_uint32_t *mask;
+	bvm_heap_region_t *region;
+	bvm_bool_t result;
+	char *segment;
+	void *handle;
+	int argc;
+
+	/* these leave things in memory outside the heap to write at exit */
+	result = BVM_TRUE;
+#if BVM_PROFILER_ALLOCATION_SITES_ENABLE
+	if (bvm_gl_profiler_allocsites_filename != NULL) result = BVM_FALSE;
+#endif
+#if BVM_PROFILER_MONITOR_CONTENTION_ENABLE
+	if (bvm_gl_profiler_contention_filename != NULL) result = BVM_FALSE;
+#endif
+#if BVM_PROFILER_STARTUP_TRACE_ENABLE
+	if (bvm_gl_profiler_startup_filename != NULL) result = BVM_FALSE;
+#endif
+#if BVM_PROFILER_PERF_ENABLE
+	if (bvm_gl_profiler_perf_map_enabled) result = BVM_FALSE;
+#endif
+#if BVM_AOT_ENABLE
+	if (bvm_gl_aot_write_filename != NULL) result = BVM_FALSE;
+#endif
+#if BVM_CLAZZ_IMAGE_ENABLE
+	if (bvm_gl_clazzimage_write_filename != NULL) result = BVM_FALSE;
+#endif
+#if BVM_CLAZZ_PRELOAD_ENABLE
+	if (bvm_gl_preload_write_filename != NULL) result = BVM_FALSE;
+#endif
+#if (BVM_OBJECT_IDENTITY_HASH_ENABLE && BVM_GC_COMPACTION_ENABLE)
+	/* the side table of array hashes is outside the heap */
+	if (bvm_gl_object_hash_count > 0) result = BVM_FALSE;
+#endif
+
+	handle = result ? bvm_pd_file_open(filename, BVM_FILE_O_WRONLY | BVM_FILE_O_TRUNC) : NULL;
+
+	if (handle == NULL) return BVM_FALSE;
+
+	/* let go of everything outside the heap - it is all got again on demand */
+#if BVM_CONSOLE_BUFFER_ENABLE
+	bvm_pd_console_flush();
+#endif
+#if BVM_CLAZZ_PRELOAD_ENABLE
+	bvm_preload_release();
+#endif
+#if BVM_CLASSPATH_INDEX_ENABLE
+	bvm_classpath_release();
+#endif
+	bvm_zip_close_jars();
+#if BVM_CLAZZ_IMAGE_ENABLE
+	bvm_clazzimage_release();
+#endif
+
+	/* have every chunk of the heap walkable */
+#if (BVM_GC_LAZY_SWEEP_ENABLE || BVM_GC_CONCURRENT_SWEEP_ENABLE)
+	while (bvm_gc_sweep_step()) {}
+#endif
+#if BVM_HEAP_TLAB_ENABLE
+	bvm_heap_tlab_retire();
+#endif
+
+	result = ss_map_build();
+
+	for (nr_segments = 0; (nr_segments < BVM_MAX_CLASSPATH_SEGMENTS) && (bvm_gl_boot_classpath_segments[nr_segments] != NULL); nr_segments++);
+	for (nr_regions = 0, region = bvm_gl_heap_regions; region != NULL; region = region->next) nr_regions++;
+
+	header[0] = BVM_VM_SNAPSHOT_MAGIC;
+	header[1] = BVM_VM_SNAPSHOT_VERSION;
+	header[2] = sizeof(bvm_native_ulong_t);
+	header[3] = (bvm_uint8_t *) BVM_PD_IMAGE_END - (bvm_uint8_t *) BVM_PD_IMAGE_START;
+	header[4] = (bvm_uint8_t *) BVM_PD_VM_STATE_START - (bvm_uint8_t *) BVM_PD_IMAGE_START;
+	header[5] = ss_state_size();
+	header[6] = (bvm_native_ulong_t) BVM_PD_IMAGE_START;
+	header[7] = ss_arguments_length(ss_argc, ss_argv);
+	header[8] = ss_argc;
+	header[9] = nr_segments;
+	header[10] = nr_regions;
+
+	result = result && ss_write(header, sizeof(header), handle);
+
+	for (argc = 0; result && (argc < ss_argc); argc++)
+		result = ss_write(ss_argv[argc], strlen(ss_argv[argc]) + 1, handle);
+
+	for (lc = 0; result && (lc < nr_segments); lc++) {
+		segment = bvm_gl_boot_classpath_segments[lc];
+		table[0] = strlen(segment);
+		table[1] = ss_segment_size(segment);
+		result = ss_write(table, 2 * sizeof(bvm_native_ulong_t), handle) && ss_write(segment, table[0], handle);
+	}
+
+	for (region = bvm_gl_heap_regions; result && (region != NULL); region = region->next) {
+		table[0] = (bvm_native_ulong_t) region;
+		table[1] = ss_region_size(region);
+		ss_region_hole(region, &table[2], &table[3]);
+		result = ss_write(table, sizeof(table), handle);
+	}
+
+	for (region = bvm_gl_heap_regions; result && (region != NULL); region = region->next) {
+		ss_region_hole(region, &table[2], &table[3]);
+		size = ss_region_size(region);
+		result = ss_write(region, table[2], handle) &&
+				 ss_write( ((bvm_uint8_t *) region) + table[3], size - table[3], handle);
+	}
+
+	for (lc = 0; result && (lc < ss_nr_maps); lc++)
+		result = ss_write(ss_maps[lc].bits, ss_bits_size(ss_maps[lc].slots), handle);
+
+	ss_map_release();
+
+	/* the words changed since the mark - less the VM exit point, which is on the 'C' stack */
+	mask = bvm_pd_memory_alloc(ss_mask_size());
+
+	if (mask == NULL) {
+		result = BVM_FALSE;
+	} else {
+		memset(mask, 0, ss_mask_size());
+		for (lc = ss_state_size() / sizeof(bvm_native_ulong_t); lc-- > 0;) {
+			if (state[lc] != ss_mark_copy[lc]) mask[lc / SS_MASK_BITS] |= ( (bvm_uint32_t) 1 << (lc % SS_MASK_BITS));
+		}
+		ss_mask_clear(mask, &bvm_vm_exit_env);
+		result = result && ss_write(mask, ss_mask_size(), handle);
+		bvm_pd_memory_free(mask);
+	}
+
+	result = result && ss_write(state, ss_state_size(), handle);
+
+	if (bvm_pd_file_close(handle) == BVM_ERR) result = BVM_FALSE;
+
+	return result;
+}
+
+/**
+ * The callback of the ready point wedge.  Writes the snapshot - the VM then carries on into \c main.
+ */
+static bvm_obj_t *ss_ready_callback(bvm_cell_t *res1, bvm_cell_t *res2, bvm_bool_t is_exception, void *data) {
+
+	UNUSED(res1);
+	UNUSED(res2);
+	UNUSED(is_exception);
+	UNUSED(data);
+
+	/* the stack is walked from the registers of each thread */
+	bvm_thread_store_registers(bvm_gl_thread_current);
+
+	if (!ss_snapshot_write(bvm_gl_snapshot_write_filename)) {
+#if BVM_CONSOLE_ENABLE
+		bvm_pd_console_out("Snapshot %s could not be written.\n", bvm_gl_snapshot_write_filename);
+#endif
+	}
+
+	bvm_pd_memory_free(ss_mark_copy);
+	bvm_pd_memory_free(ss_argv);
+	ss_mark_copy = NULL;
+	ss_argv = NULL;
+
+	return NULL;
+}
+
+/**
+ * Push the point a snapshot is written at onto the stack of the main thread.  Must be called with the \c main frame on
+ * the stack, before the class initialisations that come before it are pushed.  A callback wedge is pushed, with a
+ * no-op frame on it so that it is always returned into - even if there are no class initialisations to run.  Nothing
+ * is done if #bvm_snapshot_mark was not called, or failed.
+ */
+void bvm_snapshot_ready() {
+
+	if (ss_mark_copy == NULL) return;
+
+	bvm_frame_push(BVM_METHOD_CALLBACKWEDGE, bvm_gl_rx_sp, bvm_gl_rx_pc, bvm_gl_rx_pc, NULL);
+	bvm_gl_rx_locals[0].ref_value = NULL;
+	bvm_gl_rx_locals[1].callback = ss_ready_callback;
+	bvm_gl_rx_locals[2].ref_value = NULL;
+
+	bvm_frame_push(BVM_METHOD_NOOP, bvm_gl_rx_sp, bvm_gl_rx_pc, bvm_gl_rx_pc, NULL);
+}
+
+/**
+ * Move a word that may be a pointer into the old executable image or an old heap region by the distance its target
+ * moved.  Any other word (such as \c NULL) is left as it is.
+ */
+static bvm_native_ulong_t ss_relocate(ss_reloc_t *reloc, bvm_native_ulong_t value) {
+
+	bvm_native_ulong_t *range = reloc->ranges;
+	bvm_native_ulong_t lc = reloc->nr_regions + 1;
+
+	if ( (value < reloc->low) || (value > reloc->high) ) return value;
+
+	while (lc--) {
+		if ( (value >= range[0]) && (value - range[0] <= range[1]) ) return value - range[0] + range[2];
+		range += 3;
+	}
+
+	return value;
+}
+
+/**
+ * Move each pointer of a restored heap region - each slot its pointer map has set.
+ *
+ * @param reloc - the ranges.
+ * @param region - the region at its new address.
+ * @param bits - the pointer map of the region.
+ * @param slots - the number of slots in the region.
+ */
+static void ss_relocate_region(ss_reloc_t *reloc, bvm_uint8_t *region, bvm_uint32_t *bits, bvm_native_ulong_t slots) {
+
+	bvm_native_ulong_t lc;
+
+	for (lc = 0; lc < slots; lc++) {
+
+		bvm_native_ulong_t *word;
+
+		/* a mask word of no pointers passes over all its slots at once */
+		if ( ((lc % SS_MASK_BITS) == 0) && (bits[lc / SS_MASK_BITS] == 0) ) {
+			lc += SS_MASK_BITS - 1;
+			continue;
+		}
+
+		if ( (bits[lc / SS_MASK_BITS] & ( (bvm_uint32_t) 1 << (lc % SS_MASK_BITS))) == 0) continue;
+
+		word = (bvm_native_ulong_t *) (region + lc * SS_SLOT_SIZE);
+		*word = ss_relocate(reloc, *word);
+	}
+}
+
+/**
+ * Restore a VM from a snapshot, in place of initialising it.  Must be called after the command line has been parsed,
+ * and before anything else is done to initialise the VM.  If the snapshot cannot be used the VM is left as it was
+ * and should be initialised as usual.  A restored VM has the \c main frame of its startup class on the stack, and its
+ * registers at the ready point - it is run by running the interpreter.
+ *
+ * @param filename - the name of the snapshot file.
+ * @param optc - the number of command line options.
+ * @param optv - the command line options.
+ * @param ac - the number of arguments after the options - the startup class name and the arguments to \c main.
+ * @param av - the arguments after the options.
+ * @return #BVM_TRUE if the VM was restored, #BVM_FALSE if not.
+ */
+bvm_bool_t bvm_snapshot_restore(const char *filename, int optc, char *optv[], int ac, char *av[]) {
+
+	bvm_native_ulong_t header[SS_HEADER_WORDS];
+	bvm_native_ulong_t pair[2];
+	bvm_native_ulong_t *state = BVM_PD_VM_STATE_START;
+	bvm_native_ulong_t *table = NULL;
+	bvm_native_ulong_t *entry;
+	bvm_native_ulong_t *current = NULL;
+	bvm_native_ulong_t lc, words;
+	bvm_uint32_t *mask = NULL;
+	bvm_uint32_t **maps = NULL;
+	char **argv;
+	char *buffer = NULL;
+	ss_reloc_t reloc;
+	bvm_bool_t result;
+	int argc = 0;
+	void *handle = bvm_pd_file_open(filename, BVM_FILE_O_RDONLY);
+
+	if (handle == NULL) return BVM_FALSE;
+
+	reloc.ranges = NULL;
+
+	argv = bvm_pd_memory_alloc( (optc + ac + 1) * sizeof(char *));
+	if (argv != NULL) argc = ss_arguments(optc, optv, ac, av, argv);
+
+	result = (argv != NULL) &&
+			 ss_read(header, sizeof(header), handle) &&
+			 (header[0] == BVM_VM_SNAPSHOT_MAGIC) &&
+			 (header[1] == BVM_VM_SNAPSHOT_VERSION) &&
+			 (header[2] == sizeof(bvm_native_ulong_t)) &&
+			 (header[3] == (bvm_native_ulong_t) ((bvm_uint8_t *) BVM_PD_IMAGE_END - (bvm_uint8_t *) BVM_PD_IMAGE_START)) &&
+			 (header[4] == (bvm_native_ulong_t) ((bvm_uint8_t *) BVM_PD_VM_STATE_START - (bvm_uint8_t *) BVM_PD_IMAGE_START)) &&
+			 (header[5] == ss_state_size()) &&
+			 (header[7] == ss_arguments_length(argc, argv)) &&
+			 (header[8] == (bvm_native_ulong_t) argc);
+
+	/* the same command line */
+	if (result) {
+		buffer = bvm_pd_memory_alloc(header[7] + 1);
+		result = (buffer != NULL) && ss_read(buffer, header[7], handle) && ss_arguments_match(buffer, header[7], argc, argv);
+		if (buffer != NULL) bvm_pd_memory_free(buffer);
+	}
+
+	if (argv != NULL) bvm_pd_memory_free(argv);
+
+	/* the same boot classpath files */
+	for (lc = 0; result && (lc < header[9]); lc++) {
+		result = ss_read(pair, sizeof(pair), handle) &&
+				 ( (buffer = bvm_pd_memory_alloc(pair[0] + 1)) != NULL);
+		if (result) {
+			result = ss_read(buffer, pair[0], handle);
+			buffer[pair[0]] = '\0';
+			result = result && (ss_segment_size(buffer) == pair[1]);
+			bvm_pd_memory_free(buffer);
+		}
+	}
+
+	/* the regions, each read to a new place */
+	if (result) {
+		table = bvm_pd_memory_alloc( (header[10] * SS_REGION_WORDS + 1) * sizeof(bvm_native_ulong_t));
+		reloc.ranges = bvm_pd_memory_alloc( (header[10] + 1) * 3 * sizeof(bvm_native_ulong_t));
+		maps = bvm_pd_memory_alloc( (header[10] + 1) * sizeof(bvm_uint32_t *));
+		result = (table != NULL) && (reloc.ranges != NULL) && (maps != NULL) &&
+				 ss_read(table, header[10] * SS_REGION_WORDS * sizeof(bvm_native_ulong_t), handle);
+	}
+
+	if (reloc.ranges != NULL) {
+
+		reloc.nr_regions = header[10];
+
+		/* the image is the first range */
+		reloc.ranges[0] = header[6];
+		reloc.ranges[1] = header[3];
+		reloc.ranges[2] = (bvm_native_ulong_t) BVM_PD_IMAGE_START;
+		reloc.low = reloc.ranges[0];
+		reloc.high = reloc.ranges[0] + reloc.ranges[1];
+
+		for (lc = 0; lc < reloc.nr_regions; lc++) reloc.ranges[(lc + 1) * 3 + 2] = 0;
+	}
+
+	if (maps != NULL) {
+		for (lc = 0; lc < header[10]; lc++) maps[lc] = NULL;
+	}
+
+	for (lc = 0; result && (lc < header[10]); lc++) {
+
+		bvm_uint8_t *region;
+
+		entry = &table[lc * SS_REGION_WORDS];
+
+		result = (entry[2] <= entry[3]) && (entry[3] <= entry[1]) &&
+				 ( (region = bvm_pd_memory_alloc(entry[1])) != NULL);
+
+		if (result) {
+
+			reloc.ranges[(lc + 1) * 3] = entry[0];
+			reloc.ranges[(lc + 1) * 3 + 1] = entry[1];
+			reloc.ranges[(lc + 1) * 3 + 2] = (bvm_native_ulong_t) region;
+
+			if (entry[0] < reloc.low) reloc.low = entry[0];
+			if (entry[0] + entry[1] > reloc.high) reloc.high = entry[0] + entry[1];
+
+			result = ss_read(region, entry[2], handle) &&
+					 ss_read(region + entry[3], entry[1] - entry[3], handle);
+		}
+	}
+
+	/* the pointer maps */
+	for (lc = 0; result && (lc < header[10]); lc++) {
+		size_t size = ss_bits_size(table[lc * SS_REGION_WORDS + 1] / SS_SLOT_SIZE);
+		result = ( (maps[lc] = bvm_pd_memory_alloc(size)) != NULL) && ss_read(maps[lc], size, handle);
+	}
+
+	/* the globals, with those not changed since the mark kept as this VM has them */
+	if (result) {
+		mask = bvm_pd_memory_alloc(ss_mask_size());
+		current = bvm_pd_memory_alloc(ss_state_size());
+		result = (mask != NULL) && (current != NULL) && ss_read(mask, ss_mask_size(), handle);
+	}
+
+	if (result) {
+
+#if BVM_CONSOLE_BUFFER_ENABLE
+		bvm_pd_console_flush();
+#endif
+		memcpy(current, state, ss_state_size());
+
+		if (!ss_read(state, ss_state_size(), handle)) {
+			memcpy(state, current, ss_state_size());
+			result = BVM_FALSE;
+		}
+	}
+
+	if (result) {
+
+		words = ss_state_size() / sizeof(bvm_native_ulong_t);
+
+		for (lc = 0; lc < words; lc++) {
+			if (mask[lc / SS_MASK_BITS] & ( (bvm_uint32_t) 1 << (lc % SS_MASK_BITS)))
+				state[lc] = ss_relocate(&reloc, state[lc]);
+			else
+				state[lc] = current[lc];
+		}
+
+		for (lc = 0; lc < reloc.nr_regions; lc++) {
+			entry = &table[lc * SS_REGION_WORDS];
+			ss_relocate_region(&reloc, (bvm_uint8_t *) reloc.ranges[(lc + 1) * 3 + 2], maps[lc], entry[1] / SS_SLOT_SIZE);
+		}
+	}
+
+	bvm_pd_file_close(handle);
+
+	if (!result) {
+
+		/* give back any regions read */
+		if (reloc.ranges != NULL) {
+			for (lc = 0; lc < reloc.nr_regions; lc++) {
+				if (reloc.ranges[(lc + 1) * 3 + 2] != 0) bvm_pd_memory_free( (void *) reloc.ranges[(lc + 1) * 3 + 2]);
+			}
+		}
+
+#if BVM_CONSOLE_ENABLE
+		bvm_pd_console_out("Snapshot %s is not valid for this VM - not used.\n", filename);
+#endif
+	}
+
+	if (maps != NULL) {
+		for (lc = 0; lc < header[10]; lc++) {
+			if (maps[lc] != NULL) bvm_pd_memory_free(maps[lc]);
+		}
+		bvm_pd_memory_free(maps);
+	}
+
+	if (table != NULL) bvm_pd_memory_free(table);
+	if (reloc.ranges != NULL) bvm_pd_memory_free(reloc.ranges);
+	if (mask != NULL) bvm_pd_memory_free(mask);
+	if (current != NULL) bvm_pd_memory_free(current);
+
+	return result;
+}
+
+#endif
@@ -0,0 +1,962 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#include "../h/bvm.h"
+
+/**
+
+ @file
+
+ Reference maps of method call sites.
+
+ @section stackmap-ov Overview
+
+ With #BVM_GC_STACK_MAPS_ENABLE the collector scans a frame that is waiting on a call with a map that says which of
+ its locals and operand stack cells hold a reference at that call site.  Only those cells are marked - there is no
+ testing of each cell to see if it looks like an object, and no stale value left in the frame keeps garbage alive.
+
+ The maps of a method are worked out by #bvm_stackmap_get the first time the collector asks for one.  The bytecode is
+ interpreted abstractly, keeping only whether each local and stack cell is a reference or not.  Starting from the
+ method arguments, the state at the start of each basic block is the merge of the states of all the paths into it - a
+ cell is a reference only if it is a reference on all of them.  A cell that is a reference on some paths and not
+ others cannot be used by the code that follows (the verifier does not allow it), so it need not be marked.  The
+ blocks are interpreted until no state changes, then interpreted once more to record the state at each invoke.  An
+ exception handler is entered from each instruction of its range with the locals the instruction starts with and the
+ exception on the stack.
+
+ Maps are worked out while the collector is running, so they are kept in memory from #bvm_pd_memory_alloc rather
+ than the heap.  A method whose maps cannot be worked out - it uses \c jsr / \c ret, or its bytecode is not what
+ the analysis expects - is given a map with no entries and its frames are scanned conservatively as before.  The
+ bytecode may have been quickened by the interpreter, so each opcode is first mapped back to the standard one it
+ stands for.
+
+ @author Greg McCreath
+ @since 0.0.10
+
+*/
+
+#if BVM_GC_STACK_MAPS_ENABLE
+
+/* the kinds of value a cell may hold as far as a map is concerned */
+#define STACKMAP_VALUE		0
+#define STACKMAP_REF		1
+
+/* bytecode offset flags */
+#define STACKMAP_FLAG_START		0x01	/* an instruction starts here */
+#define STACKMAP_FLAG_LEADER	0x02	/* a basic block starts here */
+#define STACKMAP_FLAG_VISITED	0x04	/* the block has a state */
+#define STACKMAP_FLAG_QUEUED	0x08	/* the block is waiting to be interpreted */
+
+/* the stack effect of the opcodes that just pop and push non-reference values - the pops in the top four bits, the
+ * pushes in the lower four.  STACKMAP_SPECIAL for all others. */
+#define STACKMAP_SPECIAL	0xFF
+
+static const bvm_uint8_t stackmap_effects[OPCODE_jsr_w + 1] = {
+	0x00, 0xFF, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x02, 0x02, 0x01, 0x01, 0x01, 0x02, 0x02,	/*   0 - 15  */
+	0x01, 0x01, 0xFF, 0xFF, 0x02, 0x01, 0x02, 0x01, 0x02, 0xFF, 0x01, 0x01, 0x01, 0x01, 0x02, 0x02,	/*  16 - 31  */
+	0x02, 0x02, 0x01, 0x01, 0x01, 0x01, 0x02, 0x02, 0x02, 0x02, 0xFF, 0xFF, 0xFF, 0xFF, 0x21, 0x22,	/*  32 - 47  */
+	0x21, 0x22, 0xFF, 0x21, 0x21, 0x21, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,	/*  48 - 63  */
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x30,	/*  64 - 79  */
+	0x40, 0x30, 0x40, 0x30, 0x30, 0x30, 0x30, 0x10, 0x20, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,	/*  80 - 95  */
+	0x21, 0x42, 0x21, 0x42, 0x21, 0x42, 0x21, 0x42, 0x21, 0x42, 0x21, 0x42, 0x21, 0x42, 0x21, 0x42,	/*  96 - 111 */
+	0x21, 0x42, 0x21, 0x42, 0x11, 0x22, 0x11, 0x22, 0x21, 0x32, 0x21, 0x32, 0x21, 0x32, 0x21, 0x42,	/* 112 - 127 */
+	0x21, 0x42, 0x21, 0x42, 0x00, 0x12, 0x11, 0x12, 0x21, 0x21, 0x22, 0x11, 0x12, 0x12, 0x21, 0x22,	/* 128 - 143 */
+	0x21, 0x11, 0x11, 0x11, 0x41, 0x21, 0x21, 0x41, 0x41, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,	/* 144 - 159 */
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,	/* 160 - 175 */
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x11, 0xFF,	/* 176 - 191 */
+	0xFF, 0x11, 0x10, 0x10, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF										/* 192 - 201 */
+};
+
+/**
+ * The working state of the analysis of a method.
+ */
+typedef struct _stackmapworkstruct {
+
+	/** the method */
+	bvm_method_t *method;
+
+	/** its bytecode */
+	bvm_uint8_t *code;
+
+	/** the length of its bytecode */
+	bvm_uint32_t code_length;
+
+	/** the number of cells in a state - \c max_locals plus \c max_stack */
+	bvm_uint32_t cells;
+
+	/** a \c STACKMAP_FLAG_ combination for each bytecode offset */
+	bvm_uint8_t *flags;
+
+	/** for each bytecode offset that starts a block, the number of the block */
+	bvm_uint16_t *block_of;
+
+	/** the bytecode offset of each block, in order */
+	bvm_uint16_t *block_pc;
+
+	/** the number of blocks */
+	bvm_uint32_t block_count;
+
+	/** the state at the start of each block, \c cells for each */
+	bvm_uint8_t *states;
+
+	/** the stack depth at the start of each block */
+	bvm_uint16_t *depths;
+
+	/** the blocks waiting to be interpreted */
+	bvm_uint16_t *queue;
+
+	/** the number of blocks waiting to be interpreted */
+	bvm_uint32_t queued;
+
+	/** a state for the entry to an exception handler */
+	bvm_uint8_t *scratch;
+
+	/** the map being recorded, or \c NULL while the states are being worked out */
+	bvm_stackmap_t *map;
+
+	/** set if the maps could not be worked out for now, but might be later */
+	bvm_bool_t retry;
+
+} stackmap_work_t;
+
+/** the list of all maps */
+static BVM_VM_LOCAL bvm_stackmap_t *stackmap_list = NULL;
+
+/**
+ * Gives the number of exception handlers of a method.  If the exception table has not been parsed yet (see
+ * #BVM_CLAZZ_LAZY_CODE_TABLES_ENABLE) it is read from the class file bytes after the bytecode - parsing it would
+ * allocate from the heap.
+ *
+ * @param work the analysis
+ *
+ * @return the number of handlers
+ */
+static bvm_uint32_t stackmap_handler_count(stackmap_work_t *work) {
+#if BVM_CLAZZ_LAZY_CODE_TABLES_ENABLE
+	if (work->method->access_flags & BVM_METHOD_ACCESS_FLAG_LAZY_TABLES)
+		return BVM_VM2UINT16(work->code + work->code_length);
+#endif
+	return work->method->exceptions_count;
+}
+
+/**
+ * Gives the range and handler offset of an exception handler of a method.
+ *
+ * @param work the analysis
+ * @param i the number of the handler
+ * @param start set to the offset of the start of the range
+ * @param end set to the offset of the end of the range, exclusive
+ *
+ * @return the offset of the handler
+ */
+static bvm_uint32_t stackmap_handler(stackmap_work_t *work, bvm_uint32_t i, bvm_uint32_t *start, bvm_uint32_t *end) {
+
+#if BVM_CLAZZ_LAZY_CODE_TABLES_ENABLE
+	if (work->method->access_flags & BVM_METHOD_ACCESS_FLAG_LAZY_TABLES) {
+		bvm_uint8_t *entry = work->code + work->code_length + 2 + (i * 8);
+		*start = BVM_VM2UINT16(entry);
+		*end   = BVM_VM2UINT16(entry+2);
+		return BVM_VM2UINT16(entry+4);
+	}
+#endif
+
+	*start = work->method->exceptions[i].start_pc;
+	*end   = work->method->exceptions[i].end_pc;
+	return work->method->exceptions[i].handler_pc;
+}
+
+/**
+ * Works out the number of cells of the arguments and the return type of a method descriptor.
+ *
+ * @param desc the method descriptor
+ * @param types if not \c NULL, set to the kind of value of each argument cell
+ * @param return_type set to the first character of the return type
+ *
+ * @return the number of argument cells
+ */
+static bvm_uint32_t stackmap_parse_args(bvm_utfstring_t *desc, bvm_uint8_t *types, bvm_uint8_t *return_type) {
+
+	bvm_uint8_t *c = desc->data + 1;
+	bvm_uint32_t cells = 0;
+
+	while (*c != ')') {
+		if ( (*c == 'J') || (*c == 'D') ) {
+			if (types != NULL) types[cells] = types[cells+1] = STACKMAP_VALUE;
+			cells += 2;
+			c++;
+		} else {
+			if (types != NULL) types[cells] = ( (*c == 'L') || (*c == '[') ) ? STACKMAP_REF : STACKMAP_VALUE;
+			cells++;
+			while (*c == '[') c++;
+			if (*c == 'L') while (*c != ';') c++;
+			c++;
+		}
+	}
+
+	*return_type = c[1];
+	return cells;
+}
+
+/**
+ * Gives the first character of the descriptor of the field of a field ref constant.  Once the field has been resolved
+ * its descriptor is taken from the field itself - the constant may have been folded (see
+ * #BVM_EXEC_CONSTANT_FOLDING_ENABLE) and no longer hold its name and type.
+ *
+ * @param clazz the clazz of the method
+ * @param index the constant pool index of the field ref
+ *
+ * @return the type character
+ */
+static bvm_uint8_t stackmap_field_type(bvm_instance_clazz_t *clazz, bvm_uint16_t index) {
+
+	if (BVM_CONSTANT_IsOptimised(clazz, index))
+		return ((bvm_field_t *) clazz->constant_pool[index].resolved_ptr)->jni_signature->data[0];
+
+	return bvm_clazz_cp_ref_sig(clazz, index)->data[0];
+}
+
+/**
+ * Merges a state into the state at the start of a block.  The first state a block gets is copied, and after that a
+ * cell of the block state stays a reference only if it is in the merged state too.  The block is queued to be
+ * interpreted (again) if its state changed.
+ *
+ * @param work the analysis
+ * @param pc_index the offset of the block
+ * @param state the state to merge
+ * @param depth the stack depth of the state
+ *
+ * @return #BVM_FALSE if the stack depths of the states do not agree
+ */
+static bvm_bool_t stackmap_merge(stackmap_work_t *work, bvm_uint32_t pc_index, bvm_uint8_t *state, bvm_uint32_t depth) {
+
+	bvm_uint32_t block = work->block_of[pc_index];
+	bvm_uint8_t *block_state = work->states + (block * work->cells);
+	bvm_uint32_t cells = work->method->max_locals + depth;
+	bvm_bool_t changed = BVM_FALSE;
+	bvm_uint32_t lc;
+
+	if ( (work->flags[pc_index] & STACKMAP_FLAG_VISITED) == 0) {
+		memcpy(block_state, state, cells);
+		work->depths[block] = (bvm_uint16_t) depth;
+		work->flags[pc_index] |= STACKMAP_FLAG_VISITED;
+		changed = BVM_TRUE;
+	} else {
+		if (work->depths[block] != depth) return BVM_FALSE;
+
+		for (lc = cells; lc--;) {
+			if (block_state[lc] != (block_state[lc] & state[lc])) {
+				block_state[lc] = STACKMAP_VALUE;
+				changed = BVM_TRUE;
+			}
+		}
+	}
+
+	if (changed && ( (work->flags[pc_index] & STACKMAP_FLAG_QUEUED) == 0) ) {
+		work->flags[pc_index] |= STACKMAP_FLAG_QUEUED;
+		work->queue[work->queued++] = (bvm_uint16_t) block;
+	}
+
+	return BVM_TRUE;
+}
+
+/**
+ * Records the state at an invoke as the next entry of the map being recorded.
+ *
+ * @param work the analysis
+ * @param pc_index the offset of the invoke
+ * @param state the state before the invoke
+ * @param depth the stack depth less the arguments of the invoke
+ */
+static void stackmap_record(stackmap_work_t *work, bvm_uint32_t pc_index, bvm_uint8_t *state, bvm_uint32_t depth) {
+
+	bvm_stackmap_t *map = work->map;
+	bvm_uint8_t *bits = map->bits + (map->count * map->width);
+	bvm_uint32_t lc;
+
+	map->entries[map->count].pc_index = (bvm_uint16_t) pc_index;
+	map->entries[map->count].depth = (bvm_uint16_t) depth;
+
+	for (lc = work->method->max_locals + depth; lc--;)
+		if (state[lc] == STACKMAP_REF) bits[lc >> 3] |= (bvm_uint8_t) (1 << (lc & 7));
+
+	map->count++;
+}
+
+/* the state of the block being interpreted - locals then the stack */
+#define STACKMAP_POP(n)		if ((bvm_int32_t) (depth -= (n)) < 0) return BVM_FALSE
+#define STACKMAP_PUSH(t)	if (depth >= max_stack) return BVM_FALSE; else stack[depth++] = (t)
+#define STACKMAP_LOCAL(i,n)	if ((i) + (n) > max_locals) return BVM_FALSE
+
+/**
+ * Gives the target offset of a branch, or fails the interpretation if it is not the start of a block.
+ */
+#define STACKMAP_TARGET(t)															\
+	target = (t);																	\
+	if ( (target < 0) || ((bvm_uint32_t) target >= work->code_length) ||			\
+		 ((work->flags[target] & STACKMAP_FLAG_LEADER) == 0) ) return BVM_FALSE
+
+/**
+ * Interprets a block from its start state to where it ends - at an instruction that does not continue to the next
+ * one, or at the start of another block.  The state is merged into each block that follows it, and into the
+ * exception handler of each instruction that has one.  If a map is being recorded, the state at each invoke is
+ * recorded to it.
+ *
+ * @param work the analysis
+ * @param block the number of the block
+ * @param state a state to interpret with
+ *
+ * @return #BVM_FALSE if the block cannot be interpreted - the method has no maps.
+ */
+static bvm_bool_t stackmap_interpret(stackmap_work_t *work, bvm_uint32_t block, bvm_uint8_t *state) {
+
+	bvm_method_t *method = work->method;
+	bvm_instance_clazz_t *clazz = method->clazz;
+	bvm_uint8_t *code = work->code;
+	bvm_uint32_t max_locals = method->max_locals;
+	bvm_uint32_t max_stack = method->max_stack;
+	bvm_uint8_t *stack = state + max_locals;
+	bvm_uint32_t depth = work->depths[block];
+	bvm_uint32_t pc_index = work->block_pc[block];
+	bvm_uint32_t handlers = stackmap_handler_count(work);
+
+	memcpy(state, work->states + (block * work->cells), max_locals + depth);
+
+	for (;;) {
+
+		bvm_uint8_t opcode = bvm_exec_unquickened_opcode(code[pc_index]);
+		bvm_uint32_t length = bvm_exec_instruction_length(code, pc_index, opcode);
+		bvm_uint8_t *operands = code + pc_index + 1;
+		bvm_bool_t ends = BVM_FALSE;
+		bvm_int32_t target;
+		bvm_uint32_t lc;
+
+		/* each exception handler that covers the instruction is entered with its locals and the exception */
+		for (lc = 0; lc < handlers; lc++) {
+			bvm_uint32_t start, end;
+			bvm_uint32_t handler_pc = stackmap_handler(work, lc, &start, &end);
+
+			if ( (pc_index >= start) && (pc_index < end) ) {
+				if ( (max_stack == 0) || (handler_pc >= work->code_length) ||
+					 ((work->flags[handler_pc] & STACKMAP_FLAG_LEADER) == 0) ) return BVM_FALSE;
+				memcpy(work->scratch, state, max_locals);
+				work->scratch[max_locals] = STACKMAP_REF;
+				if (!stackmap_merge(work, handler_pc, work->scratch, 1)) return BVM_FALSE;
+			}
+		}
+
+		if (opcode > OPCODE_jsr_w) return BVM_FALSE;
+
+		if (stackmap_effects[opcode] != STACKMAP_SPECIAL) {
+
+			bvm_uint32_t pushes = stackmap_effects[opcode] & 0xF;
+
+			STACKMAP_POP(stackmap_effects[opcode] >> 4);
+			while (pushes-- > 0) {
+				STACKMAP_PUSH(STACKMAP_VALUE);
+			}
+
+		} else switch (opcode) {
+
+			case OPCODE_aconst_null:
+			case OPCODE_aload_0:
+			case OPCODE_aload_1:
+			case OPCODE_aload_2:
+			case OPCODE_aload_3:
+			case OPCODE_aload:
+			case OPCODE_new:
+				STACKMAP_PUSH(STACKMAP_REF);
+				break;
+
+			case OPCODE_ldc:
+			case OPCODE_ldc_w: {
+				bvm_uint16_t index = (opcode == OPCODE_ldc) ? operands[0] : BVM_VM2UINT16(operands);
+				bvm_uint8_t tag = BVM_CONSTANT_Tag(clazz, index);
+				STACKMAP_PUSH( ((tag == BVM_CONSTANT_String) || (tag == BVM_CONSTANT_Class)) ? STACKMAP_REF : STACKMAP_VALUE);
+				break;
+			}
+
+			case OPCODE_aaload:
+				STACKMAP_POP(2);
+				STACKMAP_PUSH(STACKMAP_REF);
+				break;
+
+			case OPCODE_istore:
+			case OPCODE_fstore:
+				STACKMAP_LOCAL(operands[0], 1);
+				STACKMAP_POP(1);
+				state[operands[0]] = STACKMAP_VALUE;
+				break;
+
+			case OPCODE_lstore:
+			case OPCODE_dstore:
+				STACKMAP_LOCAL(operands[0], 2);
+				STACKMAP_POP(2);
+				state[operands[0]] = state[operands[0]+1] = STACKMAP_VALUE;
+				break;
+
+			case OPCODE_astore:
+				STACKMAP_LOCAL(operands[0], 1);
+				STACKMAP_POP(1);
+				state[operands[0]] = stack[depth];
+				break;
+
+			case OPCODE_istore_0:
+			case OPCODE_istore_1:
+			case OPCODE_istore_2:
+			case OPCODE_istore_3:
+			case OPCODE_fstore_0:
+			case OPCODE_fstore_1:
+			case OPCODE_fstore_2:
+			case OPCODE_fstore_3: {
+				bvm_uint32_t index = (opcode - OPCODE_istore_0) & 3;
+				STACKMAP_LOCAL(index, 1);
+				STACKMAP_POP(1);
+				state[index] = STACKMAP_VALUE;
+				break;
+			}
+
+			case OPCODE_lstore_0:
+			case OPCODE_lstore_1:
+			case OPCODE_lstore_2:
+			case OPCODE_lstore_3:
+			case OPCODE_dstore_0:
+			case OPCODE_dstore_1:
+			case OPCODE_dstore_2:
+			case OPCODE_dstore_3: {
+				bvm_uint32_t index = (opcode - OPCODE_istore_0) & 3;
+				STACKMAP_LOCAL(index, 2);
+				STACKMAP_POP(2);
+				state[index] = state[index+1] = STACKMAP_VALUE;
+				break;
+			}
+
+			case OPCODE_astore_0:
+			case OPCODE_astore_1:
+			case OPCODE_astore_2:
+			case OPCODE_astore_3: {
+				bvm_uint32_t index = opcode - OPCODE_astore_0;
+				STACKMAP_LOCAL(index, 1);
+				STACKMAP_POP(1);
+				state[index] = stack[depth];
+				break;
+			}
+
+			case OPCODE_wide: {
+				bvm_uint8_t wide_opcode = operands[0];
+				bvm_uint32_t index = BVM_VM2UINT16(operands+1);
+				switch (wide_opcode) {
+					case OPCODE_iload:
+					case OPCODE_fload:
+						STACKMAP_PUSH(STACKMAP_VALUE);
+						break;
+					case OPCODE_lload:
+					case OPCODE_dload:
+						STACKMAP_PUSH(STACKMAP_VALUE);
+						STACKMAP_PUSH(STACKMAP_VALUE);
+						break;
+					case OPCODE_aload:
+						STACKMAP_PUSH(STACKMAP_REF);
+						break;
+					case OPCODE_istore:
+					case OPCODE_fstore:
+						STACKMAP_LOCAL(index, 1);
+						STACKMAP_POP(1);
+						state[index] = STACKMAP_VALUE;
+						break;
+					case OPCODE_lstore:
+					case OPCODE_dstore:
+						STACKMAP_LOCAL(index, 2);
+						STACKMAP_POP(2);
+						state[index] = state[index+1] = STACKMAP_VALUE;
+						break;
+					case OPCODE_astore:
+						STACKMAP_LOCAL(index, 1);
+						STACKMAP_POP(1);
+						state[index] = stack[depth];
+						break;
+					case OPCODE_iinc:
+						break;
+					default:
+						/* includes 'wide ret' */
+						return BVM_FALSE;
+				}
+				break;
+			}
+
+			case OPCODE_dup: {
+				bvm_uint8_t cell;
+				STACKMAP_POP(1);
+				cell = stack[depth];
+				STACKMAP_PUSH(cell);
+				STACKMAP_PUSH(cell);
+				break;
+			}
+
+			case OPCODE_dup_x1:
+			case OPCODE_dup_x2:
+			case OPCODE_dup2:
+			case OPCODE_dup2_x1:
+			case OPCODE_dup2_x2: {
+				/* the cells copied, and the cells they are copied under */
+				bvm_uint32_t copied = (opcode <= OPCODE_dup_x2) ? 1 : 2;
+				bvm_uint32_t under = (opcode == OPCODE_dup2) ? 0 : (opcode - ((copied == 1) ? OPCODE_dup_x1 : OPCODE_dup2_x1) + 1);
+				bvm_uint8_t cells[4];
+
+				STACKMAP_POP(copied + under);
+				memcpy(cells, stack + depth, copied + under);
+				for (lc = 0; lc < copied; lc++) {
+					STACKMAP_PUSH(cells[under + lc]);
+				}
+				for (lc = 0; lc < copied + under; lc++) {
+					STACKMAP_PUSH(cells[lc]);
+				}
+				break;
+			}
+
+			case OPCODE_swap: {
+				bvm_uint8_t cell;
+				STACKMAP_POP(2);
+				cell = stack[depth];
+				stack[depth] = stack[depth+1];
+				stack[depth+1] = cell;
+				depth += 2;
+				break;
+			}
+
+			case OPCODE_ifeq:
+			case OPCODE_ifne:
+			case OPCODE_iflt:
+			case OPCODE_ifge:
+			case OPCODE_ifgt:
+			case OPCODE_ifle:
+			case OPCODE_ifnull:
+			case OPCODE_ifnonnull:
+				STACKMAP_POP(1);
+				STACKMAP_TARGET((bvm_int32_t) pc_index + BVM_VM2INT16(operands));
+				if (!stackmap_merge(work, target, state, depth)) return BVM_FALSE;
+				break;
+
+			case OPCODE_if_icmpeq:
+			case OPCODE_if_icmpne:
+			case OPCODE_if_icmplt:
+			case OPCODE_if_icmpge:
+			case OPCODE_if_icmpgt:
+			case OPCODE_if_icmple:
+			case OPCODE_if_acmpeq:
+			case OPCODE_if_acmpne:
+				STACKMAP_POP(2);
+				STACKMAP_TARGET((bvm_int32_t) pc_index + BVM_VM2INT16(operands));
+				if (!stackmap_merge(work, target, state, depth)) return BVM_FALSE;
+				break;
+
+			case OPCODE_goto:
+			case OPCODE_goto_w:
+				STACKMAP_TARGET((bvm_int32_t) pc_index + ((opcode == OPCODE_goto) ? BVM_VM2INT16(operands) : BVM_VM2INT32(operands)));
+				if (!stackmap_merge(work, target, state, depth)) return BVM_FALSE;
+				ends = BVM_TRUE;
+				break;
+
+			case OPCODE_tableswitch:
+			case OPCODE_lookupswitch: {
+				/* switch operands are aligned to 4 bytes from the method start */
+				bvm_uint8_t *aligned = code + pc_index + 1 + (3 - (pc_index & 3));
+				bvm_uint32_t count = (opcode == OPCODE_tableswitch) ?
+						(bvm_uint32_t) (BVM_VM2INT32(aligned+8) - BVM_VM2INT32(aligned+4) + 1) :
+						(bvm_uint32_t) BVM_VM2INT32(aligned+4);
+				/* the targets of a tableswitch are 4 bytes apart after the low and high values, those of a
+				 * lookupswitch 8 bytes apart, each after its match value */
+				bvm_uint8_t *offsets = aligned + 12;
+				bvm_uint32_t step = (opcode == OPCODE_tableswitch) ? 4 : 8;
+
+				STACKMAP_POP(1);
+				STACKMAP_TARGET((bvm_int32_t) pc_index + BVM_VM2INT32(aligned));
+				if (!stackmap_merge(work, target, state, depth)) return BVM_FALSE;
+				for (lc = 0; lc < count; lc++) {
+					STACKMAP_TARGET((bvm_int32_t) pc_index + BVM_VM2INT32(offsets + (lc * step)));
+					if (!stackmap_merge(work, target, state, depth)) return BVM_FALSE;
+				}
+				ends = BVM_TRUE;
+				break;
+			}
+
+			case OPCODE_ireturn:
+			case OPCODE_lreturn:
+			case OPCODE_freturn:
+			case OPCODE_dreturn:
+			case OPCODE_areturn:
+			case OPCODE_return:
+			case OPCODE_athrow:
+				ends = BVM_TRUE;
+				break;
+
+			case OPCODE_getstatic:
+			case OPCODE_getfield: {
+				bvm_uint8_t type = stackmap_field_type(clazz, BVM_VM2UINT16(operands));
+				if (opcode == OPCODE_getfield) {
+					STACKMAP_POP(1);
+				}
+				if ( (type == 'J') || (type == 'D') ) {
+					STACKMAP_PUSH(STACKMAP_VALUE);
+					STACKMAP_PUSH(STACKMAP_VALUE);
+				} else {
+					STACKMAP_PUSH( ((type == 'L') || (type == '[')) ? STACKMAP_REF : STACKMAP_VALUE);
+				}
+				break;
+			}
+
+			case OPCODE_putstatic:
+			case OPCODE_putfield: {
+				bvm_uint8_t type = stackmap_field_type(clazz, BVM_VM2UINT16(operands));
+				STACKMAP_POP( ( ((type == 'J') || (type == 'D')) ? 2 : 1) + ((opcode == OPCODE_putfield) ? 1 : 0) );
+				break;
+			}
+
+			case OPCODE_invokevirtual:
+			case OPCODE_invokespecial:
+			case OPCODE_invokestatic:
+			case OPCODE_invokeinterface: {
+				bvm_uint8_t type;
+				bvm_uint32_t args = stackmap_parse_args(bvm_clazz_cp_ref_sig(clazz, BVM_VM2UINT16(operands)), NULL, &type);
+
+				if (opcode != OPCODE_invokestatic) args++;
+
+				STACKMAP_POP(args);
+
+				if (work->map != NULL) stackmap_record(work, pc_index, state, depth);
+
+				if ( (type == 'J') || (type == 'D') ) {
+					STACKMAP_PUSH(STACKMAP_VALUE);
+					STACKMAP_PUSH(STACKMAP_VALUE);
+				} else if (type != 'V') {
+					STACKMAP_PUSH( ((type == 'L') || (type == '[')) ? STACKMAP_REF : STACKMAP_VALUE);
+				}
+				break;
+			}
+
+			case OPCODE_newarray:
+			case OPCODE_anewarray:
+			case OPCODE_checkcast:
+				STACKMAP_POP(1);
+				STACKMAP_PUSH(STACKMAP_REF);
+				break;
+
+			case OPCODE_multianewarray:
+				STACKMAP_POP(operands[2]);
+				STACKMAP_PUSH(STACKMAP_REF);
+				break;
+
+			default:
+				/* jsr, ret, jsr_w and invokedynamic */
+				return BVM_FALSE;
+		}
+
+		if (ends) return BVM_TRUE;
+
+		pc_index += length;
+
+		if (pc_index >= work->code_length) return BVM_FALSE;
+
+		/* falling into the next block */
+		if (work->flags[pc_index] & STACKMAP_FLAG_LEADER)
+			return stackmap_merge(work, pc_index, state, depth);
+	}
+}
+
+/**
+ * Flags the start of each instruction and block of a method and counts its blocks and invokes.
+ *
+ * @param work the analysis
+ * @param invokes set to the number of invokes
+ *
+ * @return #BVM_FALSE if the bytecode cannot be decoded
+ */
+static bvm_bool_t stackmap_find_blocks(stackmap_work_t *work, bvm_uint32_t *invokes) {
+
+	bvm_uint8_t *code = work->code;
+	bvm_uint32_t pc_index = 0;
+	bvm_uint32_t lc;
+
+	*invokes = 0;
+
+	work->flags[0] |= STACKMAP_FLAG_LEADER;
+
+	for (lc = stackmap_handler_count(work); lc--;) {
+		bvm_uint32_t start, end;
+		bvm_uint32_t handler_pc = stackmap_handler(work, lc, &start, &end);
+		if (handler_pc >= work->code_length) return BVM_FALSE;
+		work->flags[handler_pc] |= STACKMAP_FLAG_LEADER;
+	}
+
+	while (pc_index < work->code_length) {
+
+		bvm_uint8_t opcode = bvm_exec_unquickened_opcode(code[pc_index]);
+		bvm_uint32_t length = bvm_exec_instruction_length(code, pc_index, opcode);
+		bvm_int32_t target = -1;
+
+		/* a breakpoint hides the opcode beneath it - the maps may be worked out once it has gone */
+		if (opcode == OPCODE_breakpoint) work->retry = BVM_TRUE;
+
+		if ( (length == 0) || (length > work->code_length - pc_index) || (opcode > OPCODE_jsr_w) ) return BVM_FALSE;
+
+		work->flags[pc_index] |= STACKMAP_FLAG_START;
+
+		if ( ((opcode >= OPCODE_ifeq) && (opcode <= OPCODE_goto)) || (opcode == OPCODE_ifnull) || (opcode == OPCODE_ifnonnull) )
+			target = (bvm_int32_t) pc_index + BVM_VM2INT16(code + pc_index + 1);
+		else if (opcode == OPCODE_goto_w)
+			target = (bvm_int32_t) pc_index + BVM_VM2INT32(code + pc_index + 1);
+		else if ( (opcode == OPCODE_tableswitch) || (opcode == OPCODE_lookupswitch) ) {
+			bvm_uint8_t *aligned = code + pc_index + 1 + (3 - (pc_index & 3));
+			bvm_int32_t offset;
+
+			/* the default, then each of the cases */
+			target = (bvm_int32_t) pc_index + BVM_VM2INT32(aligned);
+
+			if (opcode == OPCODE_tableswitch) {
+				for (offset = 12; (bvm_uint32_t) offset < length - (aligned - (code + pc_index)); offset += 4) {
+					bvm_int32_t case_target = (bvm_int32_t) pc_index + BVM_VM2INT32(aligned + offset);
+					if ( (case_target < 0) || ((bvm_uint32_t) case_target >= work->code_length) ) return BVM_FALSE;
+					work->flags[case_target] |= STACKMAP_FLAG_LEADER;
+				}
+			} else {
+				for (offset = 12; (bvm_uint32_t) offset < length - (aligned - (code + pc_index)); offset += 8) {
+					bvm_int32_t case_target = (bvm_int32_t) pc_index + BVM_VM2INT32(aligned + offset);
+					if ( (case_target < 0) || ((bvm_uint32_t) case_target >= work->code_length) ) return BVM_FALSE;
+					work->flags[case_target] |= STACKMAP_FLAG_LEADER;
+				}
+			}
+		} else if ( (opcode >= OPCODE_invokevirtual) && (opcode <= OPCODE_invokeinterface) )
+			(*invokes)++;
+
+		if (target != -1) {
+			if ( (target < 0) || ((bvm_uint32_t) target >= work->code_length) ) return BVM_FALSE;
+			work->flags[target] |= STACKMAP_FLAG_LEADER;
+		}
+
+		pc_index += length;
+
+		/* the instruction after a branch, a return or a throw starts a block */
+		if ( (pc_index < work->code_length) &&
+			 ( (target != -1) || ((opcode >= OPCODE_ireturn) && (opcode <= OPCODE_return)) || (opcode == OPCODE_athrow) ) )
+			work->flags[pc_index] |= STACKMAP_FLAG_LEADER;
+	}
+
+	/* number the blocks - a block must start at an instruction */
+	work->block_count = 0;
+	for (pc_index = 0; pc_index < work->code_length; pc_index++) {
+		if (work->flags[pc_index] & STACKMAP_FLAG_LEADER) {
+			if ( (work->flags[pc_index] & STACKMAP_FLAG_START) == 0) return BVM_FALSE;
+			work->block_count++;
+		}
+	}
+
+	return BVM_TRUE;
+}
+
+/**
+ * Works out the maps of a method.
+ *
+ * @param method a non-native method
+ *
+ * @return the maps, or \c NULL if they could not be worked out for now but might be later.
+ */
+static bvm_stackmap_t *stackmap_compute(bvm_method_t *method) {
+
+	stackmap_work_t work;
+	bvm_stackmap_t *map = NULL;
+	bvm_uint8_t *block;
+	bvm_uint8_t *state;
+	bvm_uint32_t invokes = 0, lc;
+	bvm_bool_t ok;
+
+	memset(&work, 0, sizeof(stackmap_work_t));
+	work.method = method;
+	work.code = method->code.bytecode;
+	work.code_length = method->code_length;
+	work.cells = method->max_locals + method->max_stack;
+
+	/* the 'block_of' and 'flags' arrays first */
+	if ( (block = bvm_pd_memory_alloc(work.code_length * (sizeof(bvm_uint16_t) + sizeof(bvm_uint8_t)))) == NULL)
+		return NULL;
+
+	work.block_of = (bvm_uint16_t *) block;
+	work.flags = block + (work.code_length * sizeof(bvm_uint16_t));
+	memset(work.flags, 0, work.code_length);
+
+	ok = (work.code_length <= 0xFFFF) && stackmap_find_blocks(&work, &invokes);
+
+	if (ok) {
+		bvm_uint32_t width = (work.cells + 7) / 8;
+		bvm_uint32_t count = 0;
+		bvm_uint8_t *cell;
+		bvm_uint8_t type;
+
+		/* the block offsets, depths and queue, then the block states and two more states */
+		work.block_pc = bvm_pd_memory_alloc(work.block_count * (sizeof(bvm_uint16_t) * 3 + work.cells) + (work.cells * 2));
+		map = bvm_pd_memory_alloc(sizeof(bvm_stackmap_t) + invokes * (sizeof(bvm_stackmap_entry_t) + width));
+
+		if ( (work.block_pc == NULL) || (map == NULL) ) {
+			work.retry = BVM_TRUE;
+			ok = BVM_FALSE;
+		} else {
+
+			work.depths = work.block_pc + work.block_count;
+			work.queue = work.depths + work.block_count;
+			work.states = (bvm_uint8_t *) (work.queue + work.block_count);
+			work.scratch = work.states + (work.block_count * work.cells);
+			state = work.scratch + work.cells;
+
+			memset(map, 0, sizeof(bvm_stackmap_t));
+			map->width = (bvm_uint16_t) width;
+			map->entries = (bvm_stackmap_entry_t *) (map + 1);
+			map->bits = (bvm_uint8_t *) (map->entries + invokes);
+			memset(map->bits, 0, invokes * width);
+
+			for (lc = 0; lc < work.code_length; lc++) {
+				if (work.flags[lc] & STACKMAP_FLAG_LEADER) {
+					work.block_of[lc] = (bvm_uint16_t) count;
+					work.block_pc[count++] = (bvm_uint16_t) lc;
+				}
+			}
+
+			/* the state on entry - the arguments, with 'this' first if there is one */
+			memset(state, STACKMAP_VALUE, work.cells);
+			cell = state;
+			if (!BVM_METHOD_IsStatic(method)) *cell++ = STACKMAP_REF;
+
+			if ( (bvm_uint32_t) (cell - state) + method->num_args > method->max_locals)
+				ok = BVM_FALSE;
+			else {
+				stackmap_parse_args(method->jni_signature, cell, &type);
+				stackmap_merge(&work, 0, state, 0);
+			}
+
+			/* interpret until no block state changes */
+			while (ok && (work.queued > 0) ) {
+				bvm_uint32_t next = work.queue[--work.queued];
+				work.flags[work.block_pc[next]] &= ~STACKMAP_FLAG_QUEUED;
+				ok = stackmap_interpret(&work, next, state);
+			}
+
+			/* then once more over each reached block in order, recording the state at each invoke */
+			work.map = map;
+			for (lc = 0; ok && (lc < work.block_count); lc++) {
+				if (work.flags[work.block_pc[lc]] & STACKMAP_FLAG_VISITED)
+					ok = stackmap_interpret(&work, lc, state);
+			}
+		}
+
+		if (work.block_pc != NULL) bvm_pd_memory_free(work.block_pc);
+	}
+
+	bvm_pd_memory_free(block);
+
+	if (!ok) {
+
+		if (map != NULL) bvm_pd_memory_free(map);
+		map = NULL;
+
+		/* a method that has no maps gets a map with no entries, so it is not tried again */
+		if (!work.retry) {
+			if ( (map = bvm_pd_memory_alloc(sizeof(bvm_stackmap_t))) != NULL)
+				memset(map, 0, sizeof(bvm_stackmap_t));
+		}
+	}
+
+	return map;
+}
+
+/**
+ * Gives the reference map of a frame of a method waiting on a call, working out the maps of the method if it
+ * does not have them yet.  Only called by the collector.
+ *
+ * @param method a non-native method
+ * @param pc_index the bytecode offset of the invoke the frame is waiting on
+ * @param depth the stack depth of the frame
+ *
+ * @return the bits of the map entry - see #BVM_STACKMAP_IsRef - or \c NULL if there is no map for the frame and it
+ * must be scanned conservatively.
+ */
+bvm_uint8_t *bvm_stackmap_get(bvm_method_t *method, bvm_uint32_t pc_index, bvm_uint32_t depth) {
+
+	bvm_stackmap_t *map = method->stack_map;
+	bvm_int32_t low, high;
+
+	if (map == NULL) {
+		if ( (map = stackmap_compute(method)) == NULL) return NULL;
+
+		map->next = stackmap_list;
+		if (stackmap_list != NULL) stackmap_list->prev = map;
+		stackmap_list = map;
+
+		method->stack_map = map;
+	}
+
+	/* entries are in bytecode order */
+	low = 0;
+	high = map->count - 1;
+
+	while (low <= high) {
+		bvm_int32_t mid = (low + high) >> 1;
+		bvm_uint32_t mid_pc = map->entries[mid].pc_index;
+
+		if (mid_pc < pc_index)
+			low = mid + 1;
+		else if (mid_pc > pc_index)
+			high = mid - 1;
+		else
+			return (map->entries[mid].depth == depth) ? map->bits + (mid * map->width) : NULL;
+	}
+
+	return NULL;
+}
+
+/**
+ * Frees the maps of a method, if it has any.  Called as its clazz is unloaded.
+ *
+ * @param method a method
+ */
+void bvm_stackmap_free(bvm_method_t *method) {
+
+	bvm_stackmap_t *map = method->stack_map;
+
+	if (map == NULL) return;
+
+	if (map->prev != NULL)
+		map->prev->next = map->next;
+	else
+		stackmap_list = map->next;
+
+	if (map->next != NULL) map->next->prev = map->prev;
+
+	bvm_pd_memory_free(map);
+	method->stack_map = NULL;
+}
+
+/**
+ * Frees all maps.  Called as the VM exits.
+ */
+void bvm_stackmap_release() {
+
+	while (stackmap_list != NULL) {
+		bvm_stackmap_t *next = stackmap_list->next;
+		bvm_pd_memory_free(stackmap_list);
+		stackmap_list = next;
+	}
+}
+
+#endif
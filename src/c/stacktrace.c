@@ -30,6 +30,116 @@
 
  */
 
+/** The names of the classes (in internal '/' form) excluded from stack trace capture - see
+ * #bvm_stacktrace_exclude_clazz */
+static BVM_VM_LOCAL char **stacktrace_excluded_clazzes = NULL;
+
+/** The number of names in #stacktrace_excluded_clazzes */
+static BVM_VM_LOCAL int stacktrace_excluded_count = 0;
+
+/**
+ * Excludes instances of a throwable class (and of its subclasses) from stack trace capture.  This is
+ * meant for exception types that are thrown as a form of control flow and whose stack traces are never
+ * looked at.  Throwables of an excluded class carry no stack trace at all - \c getStackTrace() returns
+ * an empty trace.  Set with the \c -notrace command line option.
+ *
+ * The name may be given with either '.' or '/' as the package separator.  It must be called before
+ * the named class is loaded.
+ *
+ * @param clazz_name the name of the class.  The string is kept (and converted in place) so
+ * must not be freed.
+ */
+void bvm_stacktrace_exclude_clazz(char *clazz_name) {
+
+	char *c;
+
+	/* clazz names are held internally with '/' separators */
+	for (c = clazz_name; *c != '\0'; c++) {
+		if (*c == '.') *c = '/';
+	}
+
+	if (stacktrace_excluded_count % 5 == 0) {
+		char **old_array = stacktrace_excluded_clazzes;
+		int size = (stacktrace_excluded_count + 5) * sizeof(char *);
+		stacktrace_excluded_clazzes = bvm_pd_memory_alloc(size);
+		memset(stacktrace_excluded_clazzes, 0, size);
+
+		/* if the old array was not empty, copy its contents into the new one */
+		if (old_array != NULL) {
+			memcpy(stacktrace_excluded_clazzes, old_array, stacktrace_excluded_count * sizeof(char *));
+			bvm_pd_memory_free(old_array);
+		}
+	}
+
+	stacktrace_excluded_clazzes[stacktrace_excluded_count++] = clazz_name;
+}
+
+/**
+ * Tests whether a class name has been excluded from stack trace capture - see #bvm_stacktrace_exclude_clazz.
+ *
+ * @param clazz_name the class name
+ *
+ * @return \c BVM_TRUE if the class was excluded, \c BVM_FALSE otherwise.
+ */
+bvm_bool_t bvm_stacktrace_is_excluded(bvm_utfstring_t *clazz_name) {
+
+	int i;
+
+	for (i = stacktrace_excluded_count; i--;) {
+		char *name = stacktrace_excluded_clazzes[i];
+		if ( (strlen(name) == clazz_name->length) && (memcmp(name, clazz_name->data, clazz_name->length) == 0) )
+			return BVM_TRUE;
+	}
+
+	return BVM_FALSE;
+}
+
+/**
+ * Resolves the class name, method name, file name and line number of a stack frame from the method
+ * executing at the frame and the frame's pc.
+ *
+ * @param method the method executing at the frame
+ * @param pc the pc of the frame
+ * @param frame the frame info to populate
+ */
+static void stacktrace_resolve_frame(bvm_method_t *method, bvm_uint8_t *pc, bvm_stack_backtrace_frameinfo_t *frame) {
+
+	int line_number = -1;  /* -1 is 'no line number, -2 is 'native'. */
+
+	bvm_instance_clazz_t *clazz = method->clazz;
+
+	frame->clazz_name = clazz->name;
+	frame->method_name = method->name;
+	frame->file_name = NULL;
+
+#if (BVM_LINE_NUMBERS_ENABLE || BVM_DEBUGGER_ENABLE)
+	BVM_METHOD_LoadCodeTables(method);
+	line_number = (method->line_numbers == NULL) ? -1 : bvm_clazz_get_source_line(method, pc);
+	frame->file_name = clazz->source_file_name;
+#endif
+	/* line number is defaulted to -1.  If native, make -2.  If lines are supported it will be
+	 * the actual line number (if it was compiled into the class file).
+	 */
+	frame->line_number = BVM_METHOD_IsNative(method) ? -2 : line_number;
+}
+
+/**
+ * Gets the frame info for a frame in a backtrace.  For a compact backtrace (see #BVM_STACKTRACE_LAZY_ENABLE)
+ * the frame info is resolved from the recorded method and pc.
+ *
+ * @param backtrace the backtrace
+ * @param index the index of the frame in the backtrace
+ * @param frame the frame info to populate
+ */
+static void stacktrace_get_frame(bvm_stack_backtrace_t *backtrace, int index, bvm_stack_backtrace_frameinfo_t *frame) {
+
+#if BVM_STACKTRACE_LAZY_ENABLE
+	stacktrace_resolve_frame(backtrace->frames[index].method, backtrace->frames[index].pc, frame);
+#else
+	*frame = backtrace->frames[index];
+#endif
+}
+
 /**
  *
  * Callback for populating a frame in an exception backtrace.
@@ -41,28 +151,21 @@
  */
 static bvm_bool_t populate_backtrace_callback(bvm_stack_frame_info_t *frameinfo, void *data) {
 
-	int line_number = -1;  /* -1 is 'no line number, -2 is 'native'. */
-
 	bvm_stack_backtrace_t *backtrace = data;
 
 	bvm_method_t *method = frameinfo->method;
-	bvm_instance_clazz_t *clazz = method->clazz;
 
 	/* ignore all frames that are for any clazz that is a throwable class or subclass. */
-	if ( !(bvm_clazz_is_assignable_from( (bvm_clazz_t *) clazz, (bvm_clazz_t *) BVM_THROWABLE_CLAZZ))) {
-
-		bvm_stack_backtrace_frameinfo_t *frame = (bvm_stack_backtrace_frameinfo_t *) &backtrace->frames[backtrace->depth++];
-		frame->clazz_name = clazz->name;
-		frame->method_name = method->name;
-
-#if (BVM_LINE_NUMBERS_ENABLE || BVM_DEBUGGER_ENABLE)
-		line_number = (method->line_numbers == NULL) ? -1 : bvm_clazz_get_source_line(method, frameinfo->pc);
-		frame->file_name = clazz->source_file_name;
+	if ( !(bvm_clazz_is_assignable_from( (bvm_clazz_t *) method->clazz, (bvm_clazz_t *) BVM_THROWABLE_CLAZZ))) {
+
+#if BVM_STACKTRACE_LAZY_ENABLE
+		/* just record where the frame is - the rest is resolved if the trace is ever required */
+		bvm_stack_backtrace_location_t *frame = &backtrace->frames[backtrace->depth++];
+		frame->method = method;
+		frame->pc = frameinfo->pc;
+#else
+		stacktrace_resolve_frame(method, frameinfo->pc, &backtrace->frames[backtrace->depth++]);
 #endif
-		/* line number is defaulted to -1.  If native, make -2.  If lines are supported it will be
-		 * the actual line number (if it was compiled into the class file).
-		 */
-		frame->line_number = BVM_METHOD_IsNative(method) ? -2 : line_number;
 	}
 
 	return BVM_TRUE;
@@ -83,6 +186,9 @@ static bvm_bool_t populate_backtrace_callback(bvm_stack_frame_info_t *frameinfo,
  *
  * The actual backtrace population is implemented as a stack visit callback - #populate_backtrace_callback.
  *
+ * If #BVM_STACKTRACE_LAZY_ENABLE is set only the method and pc of each frame are recorded.  Throwables of
+ * a class excluded from stack traces (see #bvm_stacktrace_exclude_clazz) get no backtrace at all.
+ *
  * @param throwable_obj the throwable object
  */
 void bvm_stacktrace_populate_backtrace(bvm_throwable_obj_t *throwable_obj) {
@@ -92,17 +198,29 @@ void bvm_stacktrace_populate_backtrace(bvm_throwable_obj_t *throwable_obj) {
 
 	if (!bvm_gl_vm_is_initialised) return;
 
+	/* the class does not want stack traces - the stack is not even walked */
+	if (BVM_CLAZZ_IsNoStackTrace(throwable_obj->clazz)) {
+		throwable_obj->backtrace = NULL;
+		throwable_obj->stack_trace_elements = NULL;
+		return;
+	}
+
 	/* determine the stack depth - this may be greater than actually required.  At this point we do not know how
 	 * many of the stack frames are for throwable construction (which we will omit from the trace).  We'll
 	 * allocate memory for the entire depth of the trace and probably not fill it all. */
 	depth = bvm_stack_get_depth(bvm_gl_thread_current);
 
 	/* create a backtrace to accommodate a frame info element for each relevant frame in the stack */
+#if BVM_STACKTRACE_LAZY_ENABLE
+	backtrace = bvm_heap_calloc(sizeof(bvm_stack_backtrace_t) + (depth * (sizeof(bvm_stack_backtrace_location_t) )), BVM_ALLOC_TYPE_BACKTRACE );
+#else
 	backtrace = bvm_heap_calloc(sizeof(bvm_stack_backtrace_t) + (depth * (sizeof(bvm_stack_backtrace_frameinfo_t) )), BVM_ALLOC_TYPE_DATA );
+#endif
 
 	BVM_MAKE_TRANSIENT_ROOT(backtrace);
 
 	throwable_obj->backtrace = backtrace;
+	BVM_GC_WRITE_BARRIER(throwable_obj, backtrace);
 
 	/* if the throwable already has a stack strace, lose it before creating a new backtrace.
 	 * This situation probably means that someone created an exception and did not throw it
@@ -129,7 +247,7 @@ void bvm_stacktrace_populate(bvm_throwable_obj_t *throwable_obj) {
 
 	bvm_instance_array_obj_t *array;
 	bvm_instance_clazz_t *element_clazz;
-	bvm_stack_backtrace_frameinfo_t *frameinfo;
+	bvm_stack_backtrace_frameinfo_t frameinfo;
 	bvm_string_obj_t *temp_str;
 	int depth;
 	int i;
@@ -159,36 +277,40 @@ void bvm_stacktrace_populate(bvm_throwable_obj_t *throwable_obj) {
 				bvm_stack_frame_element_obj_t *element = (bvm_stack_frame_element_obj_t *) bvm_object_alloc(element_clazz);
 
 				/* assign to the array .. this will also stop it getting GC'd */
-				array->data[i] = (bvm_obj_t *) element;
+				array->data[i] = BVM_REF_Encode((bvm_obj_t *) element);
 
-				/* get a handle to a stack frame info object from the backtrace */
-				frameinfo = &throwable_obj->backtrace->frames[i];
+				/* get the stack frame info from the backtrace */
+				stacktrace_get_frame(throwable_obj->backtrace, i, &frameinfo);
 
 				/* get a String object for the class name - either from the interned string pool, or
 				 * by creating it (then adding it to the pool).  Assign it to the element (that will
 				 * also stop it being GC'd). */
-				temp_str = (bvm_string_obj_t *) bvm_internstring_pool_get(frameinfo->clazz_name, BVM_TRUE);
+				temp_str = (bvm_string_obj_t *) bvm_internstring_pool_get(frameinfo.clazz_name, BVM_TRUE);
 				element->class_name = temp_str;
+				BVM_GC_WRITE_BARRIER(element, temp_str);
 
 				/* .. and the same for the method name */
-				temp_str = (bvm_string_obj_t *) bvm_internstring_pool_get(frameinfo->method_name, BVM_TRUE);
+				temp_str = (bvm_string_obj_t *) bvm_internstring_pool_get(frameinfo.method_name, BVM_TRUE);
 				element->method_name = temp_str;
+				BVM_GC_WRITE_BARRIER(element, temp_str);
 
 				/* and the line number ..*/
-				element->line_number.int_value = frameinfo->line_number;
+				element->line_number.int_value = frameinfo.line_number;
 
 #if (BVM_LINE_NUMBERS_ENABLE || BVM_DEBUGGER_ENABLE)
 
 				/* .. create String from the source file name, if any */
-				if (frameinfo->file_name != NULL) {
-					temp_str = (bvm_string_obj_t *) bvm_internstring_pool_get(frameinfo->file_name, BVM_TRUE);
+				if (frameinfo.file_name != NULL) {
+					temp_str = (bvm_string_obj_t *) bvm_internstring_pool_get(frameinfo.file_name, BVM_TRUE);
 					element->file_name = temp_str;
+					BVM_GC_WRITE_BARRIER(element, temp_str);
 				}
 #endif
 			}
 
 			/* ... and assign the new array to the throwable object */
 			throwable_obj->stack_trace_elements = array;
+			BVM_GC_WRITE_BARRIER(throwable_obj, array);
 
 			/* free up the backtrace .. it is no longer needed */
 			bvm_heap_free(throwable_obj->backtrace);
@@ -253,7 +375,9 @@ static bvm_bool_t frames_are_equals(bvm_stack_backtrace_frameinfo_t *frame1, bvm
  */
 static void stacktrace_print_as_cause(bvm_throwable_obj_t *throwable_obj, bvm_stack_backtrace_t *caused_backtrace) {
 
-	bvm_uint32_t m, n, i, frames_in_common;
+	bvm_int32_t m, n, i;
+	bvm_uint32_t frames_in_common;
+	bvm_stack_backtrace_frameinfo_t frame, caused_frame;
 	bvm_stack_backtrace_t *backtrace = throwable_obj->backtrace;
 
 	if (backtrace != NULL) {
@@ -261,7 +385,11 @@ static void stacktrace_print_as_cause(bvm_throwable_obj_t *throwable_obj, bvm_st
 		m = backtrace->depth-1;
 		n = caused_backtrace->depth-1;
 
-		for (; m >= 0 && n >= 0 && frames_are_equals(&backtrace->frames[m], &caused_backtrace->frames[n]) ; m--, n--);
+		for (; m >= 0 && n >= 0; m--, n--) {
+			stacktrace_get_frame(backtrace, m, &frame);
+			stacktrace_get_frame(caused_backtrace, n, &caused_frame);
+			if (!frames_are_equals(&frame, &caused_frame)) break;
+		}
 
 		frames_in_common = backtrace->depth - 1 - m;
 
@@ -273,7 +401,8 @@ static void stacktrace_print_as_cause(bvm_throwable_obj_t *throwable_obj, bvm_st
 		bvm_pd_console_out("\n");
 
 		for (i=0; i <= m; i++) {
-			stacktrace_print_frameinfo(&backtrace->frames[i]);
+			stacktrace_get_frame(backtrace, i, &frame);
+			stacktrace_print_frameinfo(&frame);
 		}
 
 		if (frames_in_common > 0)
@@ -297,6 +426,7 @@ void bvm_stacktrace_print_to_console(bvm_throwable_obj_t *throwable_obj) {
 
 	int i;
 	bvm_stack_backtrace_t *backtrace;
+	bvm_stack_backtrace_frameinfo_t frame;
 
 	if (bvm_gl_thread_current->thread_obj->name != NULL) {
 		bvm_string_print_to_console(bvm_gl_thread_current->thread_obj->name, "Exception in thread \"%s\"");
@@ -315,7 +445,8 @@ void bvm_stacktrace_print_to_console(bvm_throwable_obj_t *throwable_obj) {
 	if (backtrace != NULL) {
 
 		for (i=0; i < backtrace->depth; i++) {
-			stacktrace_print_frameinfo(&backtrace->frames[i]);
+			stacktrace_get_frame(backtrace, i, &frame);
+			stacktrace_print_frameinfo(&frame);
 		}
 
 		/* if the throwable has a cause output it */
@@ -44,7 +44,7 @@
  */
 bvm_string_obj_t *bvm_string_create_from_utfstring(bvm_utfstring_t *utfstring, bvm_bool_t intern) {
 
-	bvm_uint32_t unicode_length, i;
+	bvm_uint32_t unicode_length;
 
 	bvm_jchar_array_obj_t *char_array_obj;
 
@@ -75,13 +75,8 @@ bvm_string_obj_t *bvm_string_create_from_utfstring(bvm_utfstring_t *utfstring, b
 		/* Create the char array that will contain the string text */
 		char_array_obj = (bvm_jchar_array_obj_t *) bvm_object_alloc_array_primitive(unicode_length, BVM_T_CHAR);
 
-		/* if the lengths are the same then there are no encoded characters so we can just
-		 * copy the data.  Otherwise, there is encoded data and we'll do it the hard way ... */
-		if (unicode_length == utfstring->length) {
-			for (i = unicode_length; i--;)
-				char_array_obj->data[i] = (bvm_uint16_t) utfstring->data[i] & 0xFF;
-		} else
-			bvm_str_decode_utf8_to_unicode(utfstring->data, 0, utfstring->length, char_array_obj->data);
+		/* the decoder widens runs of ASCII a block at a time */
+		bvm_str_decode_utf8_to_unicode(utfstring->data, 0, utfstring->length, char_array_obj->data);
 
 		/* set the array data of the new string object to the char array object */
 		string_obj->chars  = char_array_obj;
@@ -114,6 +109,7 @@ bvm_string_obj_t *bvm_string_create_from_cstring(const char *data) {
 		bvm_throw_exception(BVM_ERR_VIRTUAL_MACHINE_ERROR, "Max utfstring size (0xFFFF) exceeded");
 
 	str.length = length;
+	str.hash = 0;
 	str.data = (bvm_uint8_t *) data;
 
 	/* creating a string object makes a copy of the char data as unicode - it does
@@ -169,6 +165,149 @@ bvm_string_obj_t *bvm_string_create_from_unicode(const bvm_uint16_t *unicode, bv
 	return string_obj;
 }
 
+/* what a null String, and booleans, are concatenated as */
+static const bvm_uint16_t string_null[]  = { 'n', 'u', 'l', 'l' };
+static const bvm_uint16_t string_true[]  = { 't', 'r', 'u', 'e' };
+static const bvm_uint16_t string_false[] = { 'f', 'a', 'l', 's', 'e' };
+
+/**
+ * Gives the number of chars in the decimal form of an int.
+ *
+ * @param value the int
+ *
+ * @return the number of chars, including any sign
+ */
+static bvm_uint32_t string_int_length(bvm_int32_t value) {
+
+	/* the magnitude is taken as unsigned so that MIN_INT needs no special case */
+	bvm_uint32_t magnitude = (value < 0) ? 0U - (bvm_uint32_t) value : (bvm_uint32_t) value;
+	bvm_uint32_t length = (value < 0) ? 2 : 1;
+
+	while (magnitude >= 10) {
+		magnitude /= 10;
+		length++;
+	}
+
+	return length;
+}
+
+/**
+ * Create a String of a number of values one after the other, as \c StringBuilder.append() would have them.  The
+ * length of the String is worked out first, so its char array is allocated once, at its final size.
+ *
+ * The Strings among the values must be reachable by the GC from elsewhere - from the stack of the current thread, or
+ * a constant pool.
+ *
+ * @param values the values
+ * @param types the type of each value - #BVM_T_OBJECT for a String (which may be \c NULL), or #BVM_T_INT,
+ * #BVM_T_CHAR or #BVM_T_BOOLEAN
+ * @param count the number of values
+ *
+ * @return a new String object
+ *
+ * @throws OutOfMemoryError if the String would be longer than an array may be.
+ */
+bvm_string_obj_t *bvm_string_concat(const bvm_cell_t values[], const bvm_uint8_t types[], bvm_uint32_t count) {
+
+	bvm_string_obj_t *string_obj, *value_obj;
+	bvm_jchar_array_obj_t *char_array_obj;
+	bvm_uint16_t *chars;
+	bvm_uint32_t length = 0, value_length, magnitude, lc;
+	const bvm_uint16_t *literal;
+
+	/* first, how long */
+	for (lc = 0; lc < count; lc++) {
+
+		switch (types[lc]) {
+			case BVM_T_OBJECT:
+				value_obj = (bvm_string_obj_t *) values[lc].ref_value;
+				value_length = (value_obj == NULL) ? 4 : (bvm_uint32_t) value_obj->length.int_value;
+				break;
+			case BVM_T_INT:
+				value_length = string_int_length(values[lc].int_value);
+				break;
+			case BVM_T_BOOLEAN:
+				value_length = values[lc].int_value ? 4 : 5;
+				break;
+			default:
+				value_length = 1;
+		}
+
+		if (value_length > (bvm_uint32_t) BVM_MAX_INT - length) {
+			BVM_THROW(bvm_gl_out_of_memory_err_obj)
+		}
+
+		length += value_length;
+	}
+
+	BVM_BEGIN_TRANSIENT_BLOCK {
+
+		string_obj = bvm_heap_calloc(sizeof(bvm_string_obj_t), BVM_ALLOC_TYPE_STRING);
+
+		/* clear the chars pointer in case a GC occurs during the array allocation */
+		string_obj->chars = NULL;
+
+		/* make sure our new string memory is not GC'd during char array array memory allocation */
+		BVM_MAKE_TRANSIENT_ROOT(string_obj);
+
+		string_obj->clazz = (bvm_clazz_t *) BVM_STRING_CLAZZ;
+
+		char_array_obj = (bvm_jchar_array_obj_t *) bvm_object_alloc_array_primitive(length, BVM_T_CHAR);
+
+		/* then the chars.  The char arrays of the values are found through their Strings only after the allocations,
+		 * in case the collector moved one. */
+		chars = char_array_obj->data;
+
+		for (lc = 0; lc < count; lc++) {
+
+			literal = NULL;
+
+			switch (types[lc]) {
+				case BVM_T_OBJECT:
+					value_obj = (bvm_string_obj_t *) values[lc].ref_value;
+					if (value_obj == NULL) {
+						literal = string_null;
+						value_length = 4;
+					} else {
+						value_length = value_obj->length.int_value;
+						memcpy(chars, &value_obj->chars->data[value_obj->offset.int_value], value_length * sizeof(bvm_uint16_t));
+						chars += value_length;
+					}
+					break;
+				case BVM_T_INT:
+					value_length = string_int_length(values[lc].int_value);
+					magnitude = (values[lc].int_value < 0) ? 0U - (bvm_uint32_t) values[lc].int_value : (bvm_uint32_t) values[lc].int_value;
+					chars += value_length;
+					do {
+						*--chars = (bvm_uint16_t) ('0' + (magnitude % 10));
+						magnitude /= 10;
+					} while (magnitude != 0);
+					if (values[lc].int_value < 0) *--chars = '-';
+					chars += value_length;
+					break;
+				case BVM_T_BOOLEAN:
+					literal = values[lc].int_value ? string_true : string_false;
+					value_length = values[lc].int_value ? 4 : 5;
+					break;
+				default:
+					*chars++ = (bvm_uint16_t) values[lc].int_value;
+			}
+
+			if (literal != NULL) {
+				memcpy(chars, literal, value_length * sizeof(bvm_uint16_t));
+				chars += value_length;
+			}
+		}
+
+		string_obj->chars  = char_array_obj;
+		string_obj->length.int_value = length;
+		string_obj->offset.int_value = 0;
+
+	} BVM_END_TRANSIENT_BLOCK
+
+	return string_obj;
+}
+
 
 /**
  * Create a null-terminated C String from a Java string by simply using the lower
@@ -233,7 +372,12 @@ void bvm_string_print_to_console(bvm_string_obj_t *string_obj, char *message) {
 	/* if the message is null, just output the string, otherwise, use the string as a param
 	 * to the message. */
 	if (message == NULL) {
+#if BVM_CONSOLE_BUFFER_ENABLE
+		/* straight to the console buffer - the string is not a format */
+		bvm_pd_console_write(buf, strlen(buf));
+#else
 		bvm_pd_console_out(buf);
+#endif
 	} else {
 		bvm_pd_console_out(message, buf);
 	}
@@ -244,3 +388,76 @@ void bvm_string_print_to_console(bvm_string_obj_t *string_obj, char *message) {
 
 #endif
 
+/**
+ * Calculates the Java \c String.hashCode() of some chars - <code>s[0]*31^(n-1) + s[1]*31^(n-2) + ... + s[n-1]</code>.
+ * Four chars are taken at a time, so the multiplies of one step need not wait on those of the step before.
+ *
+ * @param data the chars
+ * @param len the number of chars
+ *
+ * @return the hash code.
+ */
+bvm_int32_t bvm_string_hash_chars(const bvm_uint16_t *data, bvm_int32_t len) {
+
+	bvm_int32_t i;
+
+	/* the sums are done unsigned - a Java int overflows quietly, a C one need not */
+	bvm_uint32_t u = 0;
+
+	for (i = 0; i + 4 <= len; i += 4) {
+		u = u * 923521 + data[i] * 29791 + data[i+1] * 961 + data[i+2] * 31 + data[i+3];
+	}
+
+	for (; i < len; i++) {
+		u = 31 * u + data[i];
+	}
+
+	return (bvm_int32_t) u;
+}
+
+/**
+ * Calculates the Java \c String.hashCode() of a String.
+ *
+ * @param string the String
+ *
+ * @return the hash code.
+ */
+bvm_int32_t bvm_string_hash_code(bvm_string_obj_t *string) {
+	return bvm_string_hash_chars(string->chars->data + string->offset.int_value, string->length.int_value);
+}
+
+/**
+ * Compares a String with another object as Java \c String.equals(Object) does.  They are equal if the object is a
+ * String with the same chars.
+ *
+ * @param string the String
+ * @param obj the object to compare with, may be \c NULL
+ *
+ * @return #BVM_TRUE if they are equal, #BVM_FALSE otherwise.
+ */
+bvm_bool_t bvm_string_equals(bvm_string_obj_t *string, bvm_obj_t *obj) {
+
+	bvm_string_obj_t *other_string = (bvm_string_obj_t *) obj;
+	bvm_uint16_t *tdata, *odata;
+	bvm_int32_t l;
+
+	/* if it is the same object, all good */
+	if ( (bvm_obj_t *) string == obj)
+		return BVM_TRUE;
+
+	/* if it is not actually a string, forget it */
+	if (!bvm_clazz_is_instanceof(obj, (bvm_clazz_t *) BVM_STRING_CLAZZ))
+		return BVM_FALSE;
+
+	/* a quick length check, they cannot be the equal if the have different lengths! */
+	l = string->length.int_value;
+	if (l != other_string->length.int_value)
+		return BVM_FALSE;
+
+	/* .. and finally check equality of all the chars in their respective char arrays - memcmp is about the fastest
+	 * compare the platform has */
+	tdata = string->chars->data + string->offset.int_value;
+	odata = other_string->chars->data + other_string->offset.int_value;
+
+	return (memcmp(tdata, odata, l * sizeof(bvm_uint16_t)) == 0);
+}
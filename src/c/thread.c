@@ -135,7 +135,9 @@
   other - never both at the same time.  That is to say, the lock queue and the wait queue are mutually exclusive.
 
   The VM thread maintains a 'next_in_queue' member to point to the next thread in the same queue.  If it is the end of a queue
-  (or not in one at all) this member will be \c NULL.
+  (or not in one at all) this member will be \c NULL.  It also maintains a 'prev_in_queue' member to point to the previous
+  thread in the queue - except for the head of a queue, whose 'prev_in_queue' points to the tail of the queue.  So a
+  thread is added to the end of a queue, or removed from anywhere in it, without walking the queue.
 
   When a thread 'wait' expires (if it indeed has a timeout), or the object has been the target of a Java \c notify()
   or \c notifyAll() the thread in question will attempt to lock the monitor and become its owner.  If
@@ -148,10 +150,40 @@
   wait queue after relinquishing all lock(s) on it.  At some later stage when it again becomes the owner
   of the monitor the lock depth is restored (as per the JVMS).
 
-  Monitors are cached.  When it is time to acquire a monitor, a cache (which is a simple linked list with its head at
-  #bvm_gl_thread_monitor_list) is first inspected - if the cache is empty or no 'unused' monitors exist, a new monitor
-  is allocated from the heap.  When that monitor is no longer used it will be emptied, marked as unused,
-  and left in the list to be reused later.
+  When the owner of a contended monitor releases it, the monitor is passed on to the thread at the head of the lock
+  queue in one of two ways.  With a direct handoff the head thread becomes the owner at once.  The trouble with that
+  is the releasing thread very often wants the monitor again before the new owner has even run - so it blocks, and
+  the two threads switch back and forth once for every lock.  With #BVM_THREAD_MONITOR_SPIN_LIMIT set, the head
+  thread is instead woken with the monitor left unowned, and competes for it when it next runs.  The releasing
+  thread may take it again in the meantime without a thread switch.  A woken thread that loses goes back to the
+  head of the lock queue, and once it has lost #BVM_THREAD_MONITOR_SPIN_LIMIT times it is handed the monitor
+  directly.  Threads that will not retry the acquire themselves - those coming back from a \c wait(), or started
+  on a synchronized method - have a lock depth to restore and are always handed the monitor directly.
+
+  Monitors are cached.  Every monitor ever allocated is kept in a simple linked list with its head at
+  #bvm_gl_thread_monitor_list.  In-use monitors are also kept in a small hash table keyed by the address of their
+  owner object so that #get_monitor_for_obj does not have to walk the whole list for each \c monitorenter,
+  \c monitorexit or synchronized method call.  When it is time to acquire a monitor, a free list of 'unused'
+  monitors is first inspected - if it is empty a new monitor is allocated from the heap.  When that monitor is no
+  longer used it will be emptied, marked as unused, removed from the hash table and pushed onto the free list to
+  be reused later.
+
+  The hash table is keyed by address, so it is rebuilt by #bvm_thread_monitor_rehash whenever
+  the GC moves objects.
+
+  @section threads-thinlocks Thin Locks
+
+  Most locks are never contended.  If #BVM_THIN_LOCK_ENABLE is set each object has a 'lock word' in its
+  header and a thread locks an unlocked object by writing its own #bvm_vmthread_t::lock_id and a recursion count of
+  one into it.  Re-entry and release by the owner just change the count - no monitor is found or created.  The lock
+  is 'inflated' into a full monitor as above when another thread wants it, when the owner \c wait()s on it, or when
+  the recursion count overflows.  The lock word then just flags that the object has a monitor in the hash table.
+  When an inflated monitor falls out of use the lock word is cleared and the object can be thin-locked again.
+  With #BVM_THIN_LOCK_HEADER_ENABLE the lock word is kept in the spare top bits of the object's chunk header rather
+  than in a word of its own, which leaves room for a 16 bit lock id - later threads use monitors only.
+
+  Thin locks are not taken while a debugger session is open so that the debugger sees every lock as a monitor.  Those
+  held as the session opens are inflated then (see #bvmd_thread_inflate_thin_locks).
 
   @section threads-threelists Three Thread Lists
 
@@ -161,9 +193,12 @@
   list is used by the GC to and scan and mark threads, or if they are terminated, remove them from the list.
 
   The other two lists are mutually exclusive and represent the 'runnable' threads and the 'timed callback'
-  threads.  The VM thread structure has a field called #next_in_list.  This points to the next thread in
-  the same list. It will be \c NULL if the thread in question is at the end of a list or not in one
-  at all.
+  threads.  The runnable list is linked by the VM thread structure's #next_in_list field.  This points to the next
+  thread in the list. It will be \c NULL if the thread in question is at the end of the list or not in it at all.
+
+  The timed-callback 'list' is actually a binary min-heap of threads ordered by their time-to-wake (see
+  #bvm_gl_thread_timers).  Each thread in it knows its own position in the heap (#bvm_vmthread_t::timer_index) so it
+  can be taken out of the middle of the heap when it is notified or interrupted.
 
   The 'runnable' list contains only those threads that the VM can execute.  It does not have to make
   any decisions about threads in this list.  It gives each one execution time and cycles around them.
@@ -177,11 +212,54 @@
   is removed from the runnable list and (with a calculated timeout) placed in the
   timed-callback list.
 
-  Each time a thread switch occurs, the timed-callback list if traversed to see if any
-  thread's time-to-wake has passed.  If so, the callback is executed.
+  Each time a thread switch occurs, the top of the timed-callback heap is inspected to see if the
+  earliest time-to-wake has passed.  If so, that thread is taken out of the heap and its callback is executed,
+  and so on until the top of the heap is a thread still to wake.  A thread switch therefore does not look at
+  sleeping threads that have not timed out.
 
   Sometimes, the runnable list may be exhausted while the timed-callback list is not.  In this case,
-  the VM will keep spinning through the timed-callback list until a thread becomes runnable again.
+  the VM sleeps in the platform (see #bvm_pd_system_sleep) until the earliest time-to-wake, in slices of no more than
+  #BVM_THREAD_IDLE_SLEEP_MAX milliseconds, rather than spinning through the timed-callback list.
+  If #BVM_GC_IDLE_ENABLE is set and no thread is due to wake for a while, the VM first does a GC (see #bvm_gc_idle).
+  If #BVM_HEAP_IDLE_ZERO_ENABLE is set, the VM then spends its idle time zeroing free memory (see
+  #bvm_heap_zero_step) - it does not wait until there is nothing left to zero.
+
+  @section threads-sockets Threads parked on sockets
+
+  A native method that would otherwise block the whole VM on a socket may instead park just the calling
+  thread with #bvm_thread_wait_for_socket and return.  The thread is blocked and its socket is
+  kept in a set of socket waiters (see #bvm_gl_thread_io_polls).  At each thread switch the whole set is tested
+  at once with a single #bvm_pd_socket_poll that does not wait, and the threads whose sockets are ready are resumed.
+  When no thread is runnable, the VM waits in that same poll (up to the earliest time-to-wake) rather than in
+  #bvm_pd_system_sleep, so a socket becoming ready wakes the VM straight away.  A socket wait with a timeout is also in
+  the timed-callback heap - whichever of the timeout or the socket comes first resumes the thread.
+
+  Like \c Thread.sleep(), the native method returns straight after parking the thread and the thread carries on
+  with the bytecode after the invoke once it is resumed - so a native that parks a thread should return \c void
+  and leave the actual I/O to a following call when the socket is ready.
+
+  @section threads-files Threads parked on file reads and writes
+
+  With #BVM_FILE_ASYNC_ENABLE a native method may hand a read or write of a file to a host OS thread with
+  #bvm_file_async_start and park just the calling thread with #bvm_thread_wait_for_file.  There is nothing to wait on
+  in the platform for a host thread, so at each thread switch the reads and writes are looked at with
+  #bvm_file_async_poll and the threads of those that are done are resumed.  When no thread is runnable the VM sleeps in
+  slices of no more than #BVM_FILE_ASYNC_POLL_MAX milliseconds while threads are parked on files, so one is resumed
+  soon after its read or write is done.  A thread parked on a file is not woken by an interrupt - the host thread still
+  has its bytes.  As with sockets, the native returns \c void and a following native takes the result.
+
+  @section threads-tasks Tasks
+
+  With #BVM_THREAD_TASKS_ENABLE a \c babe.lang.Task is a Java thread made cheap enough to have thousands of.  It is
+  started like any other thread, but with a first stack segment of just #BVM_THREAD_TASK_STACK_HEIGHT cells that grows
+  by default height segments like any other stack.  When a task ends its VM thread and first segment are kept in a
+  pool of up to #BVM_THREAD_TASK_POOL_SIZE (#bvm_gl_thread_task_pool) for the next task to start - the ended task's
+  Java object is given a shared terminated VM thread in its place.  A pooled VM thread may still be in the global
+  thread list, so it only becomes free for reuse once the GC has taken it out.
+
+  Any thread may yield (#bvm_thread_task_yield) until another resumes it (#bvm_thread_task_resume).  A yielded thread is
+  blocked and waiting, but in no list or queue at all.  A resume of a thread that has not yet yielded is remembered, so
+  two tasks can hand control back and forth without a race between one yielding and the other resuming it.
 
   All threads in the runnable list will have the status #bvm_vmthread_t::BVM_THREAD_STATUS_RUNNABLE.  All threads in the
   timed-callback list will have the static #bvm_vmthread_t::BVM_THREAD_STATUS_BLOCKED.
@@ -241,25 +319,49 @@
 
   @section threads-scheduling Scheduling
 
-  The VM thread scheduler is very simple.  It works on a round-robin basis for those threads that
-  are BVM_THREAD_STATUS_RUNNABLE.  Each thread is given a 'timeslice' which is calculated as
-  'thread priority * thread_default_timeslice'.  Each thread will execute this number of bytecodes before
+  The VM thread scheduler is very simple.  Each BVM_THREAD_STATUS_RUNNABLE thread is given a 'timeslice' which is
+  calculated as 'thread priority * thread_default_timeslice'.  Each thread will execute this number of bytecodes before
   a thread 'context' switch is requested.  The next available BVM_THREAD_STATUS_RUNNABLE thread is selected, the bytecode execution
   counter reset to the thread's calculated timeslice, and away it goes again.
 
+  With #BVM_THREAD_PRIORITY_QUEUES_ENABLE the runnable 'list' is a queue per Java priority.  The next thread is
+  always the one at the front of the highest priority queue, and a thread that has used its timeslice goes to the back
+  of the queue for its priority - so threads of the same priority are round-robin'd and a high priority thread
+  runs as soon as it is runnable.  So that a busy high priority thread cannot starve lower priority ones forever,
+  every #BVM_THREAD_AGEING_INTERVAL thread switches each thread in a lower queue is moved up one queue.  Once it has
+  had a turn it goes back to the queue for its own priority.  Without #BVM_THREAD_PRIORITY_QUEUES_ENABLE the
+  runnable list is simply round-robin'd and priority affects only the timeslice.
+
+  With #BVM_THREAD_PRIORITY_INHERITANCE_ENABLE as well, a thread that owns a monitor runs at no less than the
+  priority of the threads in the monitor's lock queue, so a low priority thread holding a monitor a high priority
+  thread wants is not itself held up by threads of middling priority.  A thread that blocks for a monitor raises the
+  owner (and the owner of any monitor that owner is blocked for, and so on), moving it up a runnable queue if it is
+  waiting in one.  When the owner gives the monitor up its inherited priority is worked out again from the monitors
+  it still owns, and it drops back once it has had its turn.
+
   The #thread_default_timeslice global var is defaulted to the #BVM_THREAD_TIMESLICE compile time
   constant.
 
-  At each thread switch, if the timed-callback list has any entries it is scanned to see if any threads in
-  that list can have their callbacks executed (which *may* place them back into the runnable list).
+  At each thread switch, if the timed-callback heap has any entries its top is inspected to see if any threads in
+  it can have their callbacks executed (which *may* place them back into the runnable list).  Being kept in
+  'time_to_wake' order, only those threads that have timed out are looked at.
 
-  <i>NOTE : I guess this could be more efficient.  The VM could scan the list only when it knows their will be
-  something to callback - each time a thread is added to the list a 'next visit time' could be
-  calculated and the list would be ignored until then.  Keeping the list in 'time_to_wake' order could
-  assist this.</i>
+  Occasionally, the VM forces a thread switch by setting the bytecode execution counter to zero (see
+  #BVM_THREAD_REQUEST_SWITCH).  This means a thread switch will occur before the next bytecode is executed.
 
-  Occasionally, the VM forces a thread switch by setting the bytecode execution counter to zero.  This means
-  a thread switch will occur before the next bytecode is executed.
+  With #BVM_THREAD_TIMER_PREEMPTION_ENABLE the counter counts platform timer ticks rather than bytecodes.  The timer
+  only sets the volatile #bvm_gl_thread_switch_requested flag, and the interpreter only looks at that flag at
+  branches, method invocations and returns, and wherever the current thread may block - a thread cannot run for long
+  without passing one of those, and straight-line bytecode carries no thread switch overhead.  A forced switch sets the flag as well as zeroing
+  the counter.
+
+  With #BVM_THREAD_ACCOUNTING_ENABLE each thread keeps account of its scheduling.  At a thread switch the thread
+  switched out has the time since it was switched to added to its run time, and what its timeslice counter has
+  counted down added to its bytecodes - a forced switch counts the timeslice before zeroing the counter, so only
+  what was executed is counted.  A thread that becomes runnable, or is switched out while still runnable, is marked
+  as waiting from then, and when it is switched to the wait is counted in a histogram of its own and in the VM's
+  (#bvm_gl_thread_waits).  The figures are for tuning #BVM_THREAD_TIMESLICE and thread priorities - they can be read
+  from Java with \c Thread.getCpuTime and \c Thread.getBytecodeCount, and are served by the metrics server.
 
   @section threads-stacks Threads Stacks
 
@@ -273,16 +375,21 @@
   current stack *already* has a 'next' one then that stack will be used if the new frame will fit in it - otherwise it
   will be discarded (and become GC'd) and a new stack created that *will* accommodate the new frame.
 
-  The stack may grow and shrink as required.  Shrinking is performed during GC by truncating the list at the current stack
-  in the list.  This is done by setting its 'next' pointer to \c NULL.  That means between GCs a thread will create a stack
-  list as tall as it needs to and later during GC, if it is not used any more it will be cut back down to only
-  what is being used.
+  The stack may grow and shrink as required.  Shrinking is performed during GC by truncating the list a little past the
+  current stack in the list.  That means between GCs a thread will create a stack list as tall as it needs to and later
+  during GC, if it is not used any more it will be cut back down to what is being used plus up to
+  #BVM_THREAD_STACK_SPARE_SEGMENTS spare segments.  The spares are the hysteresis - a thread that keeps calling back and
+  forth across the end of a segment does not lose the next segment at each GC only to allocate it again straight
+  after.
 
   This approach gives the VM the ability to run many threads will little overhead.  A thread, its java object, and its stack
   can literally be as small as a couple of hundred bytes (in 32 bit).
 
-  When a thread is terminated its stacks are immediately released back to the heap.  They will never be used again
-  so they are freed straight away.
+  When a thread is terminated its stacks are immediately released.  Default height segments, and those trimmed during
+  GC, go into a VM-wide pool (#bvm_gl_thread_stack_pool) of up to #BVM_THREAD_STACK_POOL_SIZE segments that new
+  threads and growing stacks take from before going to the heap.  A VM that starts and ends many short-lived threads
+  will mostly recycle the same few segments.  Anything the pool has no room for is freed straight away.  The pool is
+  marked by the GC so pooled segments stay put.
 
   Using dynamic stacks has implications for the what is stored per frame on the stack.  To support this, an
   extra element is in each stack frame - that element is a reference to the stack that the frame lives in.  This way, as
@@ -308,50 +415,233 @@
 /** A pointer to the start of the global thread list.  This one-way linked list contains all threads and
  * is the root for GC thread scanning.
  */
-bvm_vmthread_t *bvm_gl_threads = NULL;
+BVM_VM_LOCAL bvm_vmthread_t *bvm_gl_threads = NULL;
 
 /** A handle to the currently executing thread */
-bvm_vmthread_t *bvm_gl_thread_current = NULL;
+BVM_VM_LOCAL bvm_vmthread_t *bvm_gl_thread_current = NULL;
+
+/** A binary min-heap of threads awaiting a timed callback, ordered by #bvm_vmthread_t::time_to_awake.  Threads that
+ * have been blocked using \c Object.wait(x > 0) and \c Object.sleep(x) will have an entry here.  The earliest to wake
+ * is at element zero, and the children of element \c n are at \c 2n+1 and \c 2n+2. */
+BVM_VM_LOCAL bvm_vmthread_t **bvm_gl_thread_timers = NULL;
+
+/** The number of threads in #bvm_gl_thread_timers */
+static BVM_VM_LOCAL bvm_uint32_t thread_timers_count = 0;
+
+/** The number of threads #bvm_gl_thread_timers has room for.  Doubles each time it fills. */
+static BVM_VM_LOCAL bvm_uint32_t thread_timers_capacity = BVM_THREAD_TIMERS_SIZE;
+
+#if BVM_FILE_ASYNC_ENABLE
+
+/** The number of threads parked by #bvm_thread_wait_for_file */
+static BVM_VM_LOCAL bvm_uint32_t thread_file_count = 0;
+
+/** Whether there are threads parked on file reads or writes */
+#define THREAD_HAS_FILE_WAITERS (thread_file_count != 0)
+
+static void resume_file_waiters();
+
+#else
+
+#define THREAD_HAS_FILE_WAITERS BVM_FALSE
+
+#endif
+
+#if BVM_SOCKETS_ENABLE
+
+/** The sockets (and the readiness sought) of threads parked by #bvm_thread_wait_for_socket.  Parallel to
+ * #bvm_gl_thread_io_threads so it may be handed straight to #bvm_pd_socket_poll. */
+BVM_VM_LOCAL bvm_pd_socket_poll_t *bvm_gl_thread_io_polls = NULL;
+
+/** The threads parked by #bvm_thread_wait_for_socket.  Element \c n waits on socket \c n of #bvm_gl_thread_io_polls. */
+BVM_VM_LOCAL bvm_vmthread_t **bvm_gl_thread_io_threads = NULL;
+
+/** The number of threads parked on sockets */
+static BVM_VM_LOCAL bvm_uint32_t thread_io_count = 0;
+
+/** The number of threads #bvm_gl_thread_io_threads has room for.  Doubles each time it fills. */
+static BVM_VM_LOCAL bvm_uint32_t thread_io_capacity = BVM_THREAD_IO_WAITERS_SIZE;
+
+/** Whether there are threads waiting on a timeout, on a socket or on a file */
+#define THREAD_HAS_WAITERS ( (thread_timers_count != 0) || (thread_io_count != 0) || THREAD_HAS_FILE_WAITERS )
+
+static void resume_socket_waiters(bvm_int32_t timeout);
+
+#else
+
+/** Whether there are threads waiting on a timeout or on a file */
+#define THREAD_HAS_WAITERS ( (thread_timers_count != 0) || THREAD_HAS_FILE_WAITERS )
+
+#endif
+
+#if BVM_THREAD_PRIORITY_QUEUES_ENABLE
+
+/** The heads of the runnable thread queues, one per Java thread priority (element zero is unused).  Each queue is
+ * linked by #bvm_vmthread_t::next_in_list and served first-in first-out. */
+static BVM_VM_LOCAL bvm_vmthread_t *thread_runnable_heads[BVM_THREAD_PRIORITY_MAX + 1];
+
+/** The tails of the runnable thread queues, parallel to #thread_runnable_heads */
+static BVM_VM_LOCAL bvm_vmthread_t *thread_runnable_tails[BVM_THREAD_PRIORITY_MAX + 1];
 
-/** A handle to a list of threads awaiting a timed callback.  Threads that have been blocked
- * using \c Object.wait(x > 0) and \c Object.sleep(x) will have an entry here. */
-static bvm_vmthread_t *thread_callback_list  = NULL;
+/** The number of threads in all the runnable queues */
+static BVM_VM_LOCAL bvm_uint32_t thread_runnable_count = 0;
+
+/** Counts down the thread switches to the next ageing of the runnable queues */
+static BVM_VM_LOCAL bvm_uint32_t thread_ageing_counter = BVM_THREAD_AGEING_INTERVAL;
+
+/** Whether there are any runnable threads */
+#define THREAD_HAS_RUNNABLE (thread_runnable_count != 0)
+
+#else
 
 /** A handle to the head of the list of runnable threads */
-bvm_vmthread_t *bvm_gl_thread_runnable_list = NULL;
+BVM_VM_LOCAL bvm_vmthread_t *bvm_gl_thread_runnable_list = NULL;
+
+/** Whether there are any runnable threads */
+#define THREAD_HAS_RUNNABLE (bvm_gl_thread_runnable_list != NULL)
+
+#endif
+
+static bvm_vmthread_t *thread_runnable_next();
+static void thread_init_vmthread(bvm_vmthread_t *vmthread, bvm_thread_obj_t *thread_obj);
 
 /** A handle to the head of a (cache) list of object monitors */
-bvm_monitor_t *bvm_gl_thread_monitor_list = NULL;
+BVM_VM_LOCAL bvm_monitor_t *bvm_gl_thread_monitor_list = NULL;
+
+#if (BVM_THREAD_STACK_POOL_SIZE > 0)
+
+/** The head of a list (linked by #bvm_stacksegment_t::next) of default height stack segments free for reuse */
+BVM_VM_LOCAL bvm_stacksegment_t *bvm_gl_thread_stack_pool = NULL;
+
+/** The number of segments in #bvm_gl_thread_stack_pool */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_thread_stack_pool_count = 0;
+
+#endif
+
+#if BVM_THREAD_TASKS_ENABLE
+
+/** The head of a list (linked by #bvm_vmthread_t::next_in_list) of VM threads of ended tasks free for reuse by new
+ * tasks.  Each keeps the first stack segment of its task. */
+BVM_VM_LOCAL bvm_vmthread_t *bvm_gl_thread_task_pool = NULL;
+
+/** VM threads of ended tasks that may still be in the global thread list #bvm_gl_threads.  The GC moves them into
+ * #bvm_gl_thread_task_pool once it has taken them out of that list. */
+BVM_VM_LOCAL bvm_vmthread_t *bvm_gl_thread_task_retired = NULL;
+
+/** The number of VM threads in #bvm_gl_thread_task_pool and #bvm_gl_thread_task_retired together */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_thread_task_pool_count = 0;
+
+/** The VM thread every ended task is given in place of its own - always #bvm_vmthread_t::BVM_THREAD_STATUS_TERMINATED */
+static BVM_VM_LOCAL bvm_vmthread_t *thread_task_ended = NULL;
+
+#endif
+
+/** Hash buckets of in-use monitors keyed by owner object address, chained by #bvm_monitor_t::next_in_bucket */
+static BVM_VM_LOCAL bvm_monitor_t *thread_monitor_table[BVM_THREAD_MONITOR_HASH_SIZE];
+
+/** Head of the free list of unused monitors, chained by #bvm_monitor_t::next_in_bucket */
+static BVM_VM_LOCAL bvm_monitor_t *thread_monitor_free_list = NULL;
+
+#if BVM_THIN_LOCK_ENABLE
+
+/** Lock word flag - the lock has been inflated and the object has a monitor in the monitor hash table */
+#define THREAD_LOCKWORD_INFLATED		1
+
+/** A recursion count of one in a thin lock word */
+#define THREAD_LOCKWORD_COUNT_ONE		2
+
+/** Bits of a thin lock word that hold the recursion count */
+#define THREAD_LOCKWORD_COUNT_MASK		0xFE
+
+/** The owner thread's lock id is in the lock word bits above this one */
+#define THREAD_LOCKWORD_OWNER_SHIFT		8
+
+/** The largest owner lock id that fits in a thin lock word */
+#define THREAD_LOCKWORD_OWNER_MAX		( (~(bvm_native_ulong_t) 0) >> (sizeof(bvm_native_ulong_t) * 8 - (BVM_OBJECT_LOCKWORD_BITS - THREAD_LOCKWORD_OWNER_SHIFT)) )
+
+#define THREAD_LOCKWORD_GetOwner(w)		((w) >> THREAD_LOCKWORD_OWNER_SHIFT)
+#define THREAD_LOCKWORD_GetCount(w)		(((w) & THREAD_LOCKWORD_COUNT_MASK) >> 1)
+
+/** The next #bvm_vmthread_t::lock_id to hand out */
+static BVM_VM_LOCAL bvm_uint32_t thread_next_lock_id = 1;
+
+#endif
+
+/** Hash bucket of an object's monitor.  Objects are chunk aligned so the low address bits carry no information. */
+#define THREAD_MONITOR_BUCKET(obj) \
+	( (bvm_uint32_t) ( ((size_t) (obj) / BVM_CHUNK_ALIGN_SIZE) & (BVM_THREAD_MONITOR_HASH_SIZE - 1) ) )
 
 /**
  * The default unit of timeslice given to a thread.  This is multiplied against the thread priority to
  * get the thread timeslice allocation to get an actual timeslice for a thread.
  */
-static bvm_uint32_t thread_default_timeslice = BVM_THREAD_TIMESLICE;
+static BVM_VM_LOCAL bvm_uint32_t thread_default_timeslice = BVM_THREAD_TIMESLICE;
 
 /** Counter of all the active (daemon and non-daemon) threads.  Where active = started and not
  * yet terminated */
-bvm_uint32_t bvm_gl_thread_active_count = 0;
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_thread_active_count = 0;
 
 /** Counter of the number of non-daemon threads that have started but not yet terminated */
-bvm_uint32_t bvm_gl_thread_nondaemon_count = 0;
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_thread_nondaemon_count = 0;
 
 /** Counter that counts down to zero with each bytecode executed to determine when a thread switch takes
  * place.  Each thread switch will reset this value to the switched-in thread's timeslice setting.
  */
-bvm_int32_t bvm_gl_thread_timeslice_counter;
+BVM_VM_LOCAL bvm_int32_t bvm_gl_thread_timeslice_counter;
+
+#if BVM_THREAD_ACCOUNTING_ENABLE
+
+/** The value #bvm_gl_thread_timeslice_counter had when the current thread's bytecodes were last counted.  What the
+ * counter has counted down since is what the thread has executed since. */
+BVM_VM_LOCAL bvm_int32_t bvm_gl_thread_timeslice_start;
+
+/** When the current thread's run time was last counted, on the platform microsecond clock */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_thread_run_start;
+
+/** The upper bounds in microseconds of the thread wait histogram buckets - the last bucket has no bound */
+const bvm_uint32_t bvm_gl_thread_wait_bounds[BVM_THREAD_WAIT_BUCKETS - 1] = {
+	100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000
+};
+
+/** The number of times any thread waited to run for each bucket of the wait histogram.  Not cumulative. */
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_thread_waits[BVM_THREAD_WAIT_BUCKETS];
+
+/** The microseconds all threads have spent runnable but waiting to run */
+BVM_VM_LOCAL bvm_native_ulong_t bvm_gl_thread_wait_micros = 0;
+
+#endif
+
+#if BVM_THREAD_TIMER_PREEMPTION_ENABLE
+
+/** Set by the platform timer at each tick (and by #BVM_THREAD_REQUEST_SWITCH) to ask the interpreter to count down
+ * #bvm_gl_thread_timeslice_counter at its next branch, invocation or return. */
+BVM_VM_LOCAL volatile bvm_bool_t bvm_gl_thread_switch_requested = BVM_FALSE;
+
+/**
+ * The platform timer tick.  Called asynchronously so does nothing more than set a flag.
+ */
+static void thread_timer_tick() {
+	bvm_gl_thread_switch_requested = BVM_TRUE;
+}
+
+#endif
 
 /** As each thread is created it gets an id and it comes from here. */
-static bvm_uint32_t thread_next_id = 0;
+static BVM_VM_LOCAL bvm_uint32_t thread_next_id = 0;
 
 #if BVM_DEBUGGER_ENABLE
 /** How many thread switches to do before checking if any data is ready for reading from the debugger */
-static int bvmd_interaction_counter = BVM_DEBUGGER_INTERACTION_COUNT;
+static BVM_VM_LOCAL int bvmd_interaction_counter = BVM_DEBUGGER_INTERACTION_COUNT;
+#endif
+
+#if BVM_METRICS_ENABLE
+/** How many thread switches to do before checking for a metrics request */
+static BVM_VM_LOCAL int metrics_interaction_counter = BVM_METRICS_INTERACTION_COUNT;
 #endif
 
 /**
- * Create a stack for a thread.  The new stack is allocated from the heap and will have its
- * \c top calculated and its \c next pointer set to \c NULL.
+ * Create a stack for a thread.  The new stack is taken from the stack segment pool if it can be, otherwise it is
+ * allocated from the heap.  It will have its \c top calculated and its \c next pointer set to \c NULL.
  *
  * @param height - the height in cells of the new stack (note: NOT in bytes).
  *
@@ -359,15 +649,59 @@ static int bvmd_interaction_counter = BVM_DEBUGGER_INTERACTION_COUNT;
  */
 bvm_stacksegment_t *bvm_thread_create_stack(bvm_uint32_t height) {
 
-	bvm_stacksegment_t *newstack = bvm_heap_alloc(sizeof(bvm_stacksegment_t) + ( height * sizeof(bvm_cell_t)), BVM_ALLOC_TYPE_DATA);
+	bvm_stacksegment_t *newstack;
+
+#if (BVM_THREAD_STACK_POOL_SIZE > 0)
+	/* a pooled segment will do if the default height is enough */
+	if ( (height <= bvm_gl_stack_height) && (bvm_gl_thread_stack_pool != NULL) ) {
+		newstack = bvm_gl_thread_stack_pool;
+		bvm_gl_thread_stack_pool = newstack->next;
+		bvm_gl_thread_stack_pool_count--;
+		newstack->next = NULL;
+#if BVM_FRAME_COMPACT_ENABLE
+		newstack->prev = NULL;
+#endif
+		return newstack;
+	}
+#endif
+
+	newstack = bvm_heap_alloc(sizeof(bvm_stacksegment_t) + ( height * sizeof(bvm_cell_t)), BVM_ALLOC_TYPE_DATA);
 
  	newstack->height = height;
 	newstack->top    = newstack->body + height;
 	newstack->next   = NULL;
+#if BVM_FRAME_COMPACT_ENABLE
+	newstack->prev   = NULL;
+#endif
 
 	return newstack;
 }
 
+/**
+ * Offer a stack segment no longer needed by its thread to the stack segment pool.  Only segments of the default height
+ * are pooled, and only while the pool has fewer than #BVM_THREAD_STACK_POOL_SIZE segments.  A segment that is not
+ * pooled is left to the caller to free or let go.
+ *
+ * @param stack - the stack segment.
+ *
+ * @return #BVM_TRUE if the segment was pooled, #BVM_FALSE if not.
+ */
+bvm_bool_t bvm_thread_pool_stack(bvm_stacksegment_t *stack) {
+
+#if (BVM_THREAD_STACK_POOL_SIZE > 0)
+	if ( (stack->height == bvm_gl_stack_height) && (bvm_gl_thread_stack_pool_count < BVM_THREAD_STACK_POOL_SIZE) ) {
+		stack->next = bvm_gl_thread_stack_pool;
+		bvm_gl_thread_stack_pool = stack;
+		bvm_gl_thread_stack_pool_count++;
+		return BVM_TRUE;
+	}
+#else
+	UNUSED(stack);
+#endif
+
+	return BVM_FALSE;
+}
+
 /**
  * Create a VM thread from a given Java thread object.  Establishes the VM thread to wrap
  * the Java thread.  The VM thread is created with a new stack.  The size of the stack is determined
@@ -404,6 +738,104 @@ bvm_vmthread_t *bvm_thread_create_vmthread(bvm_thread_obj_t *thread_obj) {
 
 	} BVM_END_TRANSIENT_BLOCK
 
+	thread_init_vmthread(vmthread, thread_obj);
+
+	return vmthread;
+}
+
+#if BVM_THREAD_TASKS_ENABLE
+
+/**
+ * Create a VM thread for a Java thread object to be started as a task.  The VM thread of an ended task is taken from
+ * #bvm_gl_thread_task_pool if there is one, along with the first stack segment it kept.  Otherwise a new VM thread is
+ * created with a first stack segment of #BVM_THREAD_TASK_STACK_HEIGHT cells.  As for #bvm_thread_create_vmthread, the
+ * task is not started.
+ *
+ * @param thread_obj - the Java thread object to create a VM thread for.
+ *
+ * @return a new vm thread
+ */
+bvm_vmthread_t *bvm_thread_create_task(bvm_thread_obj_t *thread_obj) {
+
+	bvm_vmthread_t *vmthread = bvm_gl_thread_task_pool;
+	bvm_stacksegment_t *stack;
+#if BVM_THIN_LOCK_ENABLE
+	bvm_uint32_t lock_id;
+#endif
+
+	if (vmthread != NULL) {
+
+		bvm_gl_thread_task_pool = vmthread->next_in_list;
+		bvm_gl_thread_task_pool_count--;
+
+		/* start it as good as new, but for the stack segment and lock id it kept */
+		stack = vmthread->stack_list;
+#if BVM_THIN_LOCK_ENABLE
+		lock_id = vmthread->lock_id;
+#endif
+		memset(vmthread, 0, sizeof(bvm_vmthread_t));
+		vmthread->status = BVM_THREAD_STATUS_NEW;
+		vmthread->stack_list = stack;
+#if BVM_THIN_LOCK_ENABLE
+		vmthread->lock_id = lock_id;
+#endif
+
+	} else {
+
+		BVM_BEGIN_TRANSIENT_BLOCK {
+
+			vmthread = bvm_heap_calloc(sizeof(bvm_vmthread_t), BVM_ALLOC_TYPE_DATA);
+			vmthread->status = BVM_THREAD_STATUS_NEW;
+
+			BVM_MAKE_TRANSIENT_ROOT(vmthread);
+
+			vmthread->stack_list = bvm_thread_create_stack(BVM_THREAD_TASK_STACK_HEIGHT);
+
+		} BVM_END_TRANSIENT_BLOCK
+	}
+
+	vmthread->is_task = BVM_TRUE;
+
+	thread_init_vmthread(vmthread, thread_obj);
+
+	return vmthread;
+}
+
+/**
+ * Keep the VM thread of a task that has ended for a later task, if #bvm_gl_thread_task_pool has room.  It keeps its
+ * first stack segment, and the Java thread object is given #thread_task_ended in its place so it still reads as
+ * terminated.  It goes into #bvm_gl_thread_task_retired until the GC has taken it out of the global thread list.
+ *
+ * @param vmthread - the terminated VM thread of a task.
+ *
+ * @return #BVM_TRUE if the VM thread was kept, #BVM_FALSE if not.
+ */
+static bvm_bool_t thread_task_retire(bvm_vmthread_t *vmthread) {
+
+	if (bvm_gl_thread_task_pool_count >= BVM_THREAD_TASK_POOL_SIZE) return BVM_FALSE;
+
+	vmthread->thread_obj->vmthread = thread_task_ended;
+	BVM_GC_WRITE_BARRIER(vmthread->thread_obj, thread_task_ended);
+	vmthread->thread_obj = NULL;
+
+	vmthread->next_in_list = bvm_gl_thread_task_retired;
+	bvm_gl_thread_task_retired = vmthread;
+	bvm_gl_thread_task_pool_count++;
+
+	return BVM_TRUE;
+}
+
+#endif
+
+/**
+ * Set up a newly created VM thread with its first stack segment for a given Java thread object, and add it to the
+ * global list of threads.
+ *
+ * @param vmthread - the new VM thread.
+ * @param thread_obj - the Java thread object.
+ */
+static void thread_init_vmthread(bvm_vmthread_t *vmthread, bvm_thread_obj_t *thread_obj) {
+
 	/* default the current working stack to the start of the stack list */
 	vmthread->rx_stack = vmthread->stack_list;
 
@@ -415,8 +847,16 @@ bvm_vmthread_t *bvm_thread_create_vmthread(bvm_thread_obj_t *thread_obj) {
 	/* point the vmthread to the java thread */
 	vmthread->thread_obj = thread_obj;
 
+#if BVM_THIN_LOCK_ENABLE
+	/* an id that does not fit in a lock word leaves the thread using monitors only.  A pooled task VM thread
+	 * keeps the id it had. */
+	if ( (vmthread->lock_id == 0) && ( (bvm_native_ulong_t) thread_next_lock_id <= THREAD_LOCKWORD_OWNER_MAX) )
+		vmthread->lock_id = thread_next_lock_id++;
+#endif
+
 	/* ... and vice versa */
 	thread_obj->vmthread = vmthread;
+	BVM_GC_WRITE_BARRIER(thread_obj, vmthread);
 
 	/* set the timeslice for the new thread */
 	bvm_thread_calc_timeslice(vmthread);
@@ -424,49 +864,213 @@ bvm_vmthread_t *bvm_thread_create_vmthread(bvm_thread_obj_t *thread_obj) {
 	/* add the new VM thread to the front of global VM threads list */
 	vmthread->next = bvm_gl_threads;
 	bvm_gl_threads = vmthread;
+}
 
-	return vmthread;
+/**
+ * Put a thread at a given position in the timed callback heap.
+ */
+static void thread_timer_set(bvm_uint32_t i, bvm_vmthread_t *vmthread) {
+	bvm_gl_thread_timers[i] = vmthread;
+	vmthread->timer_index = i + 1;
+}
+
+/**
+ * Move the thread at a given position of the timed callback heap up towards the top until its parent
+ * wakes no later than it.
+ */
+static void thread_timer_sift_up(bvm_uint32_t i) {
+
+	bvm_vmthread_t *vmthread = bvm_gl_thread_timers[i];
+
+	while (i > 0) {
+
+		bvm_uint32_t parent = (i - 1) / 2;
+
+		if (!BVM_INT64_compare_lt(vmthread->time_to_awake, bvm_gl_thread_timers[parent]->time_to_awake))
+			break;
+
+		thread_timer_set(i, bvm_gl_thread_timers[parent]);
+		i = parent;
+	}
+
+	thread_timer_set(i, vmthread);
+}
+
+/**
+ * Move the thread at a given position of the timed callback heap down towards the bottom until its
+ * children wake no earlier than it.
+ */
+static void thread_timer_sift_down(bvm_uint32_t i) {
+
+	bvm_vmthread_t *vmthread = bvm_gl_thread_timers[i];
+
+	for (;;) {
+
+		bvm_uint32_t child = (2 * i) + 1;
+
+		if (child >= thread_timers_count)
+			break;
+
+		/* the earlier of the two children */
+		if ( (child + 1 < thread_timers_count) &&
+			 BVM_INT64_compare_lt(bvm_gl_thread_timers[child+1]->time_to_awake, bvm_gl_thread_timers[child]->time_to_awake))
+			child++;
+
+		if (!BVM_INT64_compare_lt(bvm_gl_thread_timers[child]->time_to_awake, vmthread->time_to_awake))
+			break;
+
+		thread_timer_set(i, bvm_gl_thread_timers[child]);
+		i = child;
+	}
+
+	thread_timer_set(i, vmthread);
 }
 
 /**
- * Scan the timed callback list looking for anything that has timed out.  The list is traversed
- * front to back and all threads with expired timers have their callback function invoked.
- * It is the responsibility of the callback to remove the thread from the timed callback list.
+ * Add a thread to the timed callback heap, growing the heap if it is full.
  *
- * This function is not called if there is nothing in the timed callback list so it
- * assumes the list is not \c NULL.
+ * @param vmthread the thread to add.  Its #bvm_vmthread_t::time_to_awake must already be set.
+ */
+static void thread_timer_add(bvm_vmthread_t *vmthread) {
+
+	if (thread_timers_count == thread_timers_capacity) {
+
+		/* static - the thread timers are not GC'd. Only arrays are moved by the GC, so the thread pointers
+		 * do not need updating */
+		bvm_vmthread_t **timers = bvm_heap_alloc(thread_timers_capacity * 2 * sizeof(bvm_vmthread_t *), BVM_ALLOC_TYPE_STATIC);
+
+		memcpy(timers, bvm_gl_thread_timers, thread_timers_count * sizeof(bvm_vmthread_t *));
+		bvm_heap_free(bvm_gl_thread_timers);
+
+		bvm_gl_thread_timers = timers;
+		thread_timers_capacity *= 2;
+	}
+
+	bvm_gl_thread_timers[thread_timers_count++] = vmthread;
+	thread_timer_sift_up(thread_timers_count - 1);
+}
+
+/**
+ * Remove a thread from the timed callback heap.  If it is not in the heap, nothing happens.
  *
+ * @param vmthread the thread to remove
+ */
+static void thread_timer_remove(bvm_vmthread_t *vmthread) {
+
+	bvm_uint32_t i = vmthread->timer_index;
+
+	if (i == 0) return;
+
+	vmthread->timer_index = 0;
+
+	/* fill the hole with the last thread in the heap and put that where it belongs */
+	if (--i != --thread_timers_count) {
+
+		bvm_vmthread_t *last = bvm_gl_thread_timers[thread_timers_count];
+
+		thread_timer_set(i, last);
+		thread_timer_sift_up(i);
+		thread_timer_sift_down(last->timer_index - 1);
+	}
+}
+
+/**
+ * Resume all threads in the timed callback heap that have timed out.  Each is taken out of the heap
+ * before its callback function is invoked.  Only the top of the heap is looked at so nothing is done for
+ * threads still to wake.
  */
 static void resume_callback_timeouts() {
 
-    // TODO: Not sure if I like the idea that callbacks remove it from the list.  Maybe check that out.
+	bvm_int64_t current_time = bvm_pd_system_time();
+
+	while ( (thread_timers_count != 0) &&
+			BVM_INT64_compare_le(bvm_gl_thread_timers[0]->time_to_awake, current_time) ) {
+
+		bvm_vmthread_t *vmthread = bvm_gl_thread_timers[0];
+
+		thread_timer_remove(vmthread);
+		vmthread->callback(vmthread);
+	}
+}
+
+/**
+ * With no runnable threads, sleep in the platform until the earliest timed callback is due, but for no more
+ * than #BVM_THREAD_IDLE_SLEEP_MAX milliseconds so a change of the platform clock is noticed.  If threads are parked
+ * on sockets the VM waits on their sockets instead, so it is woken as soon as one is ready.
+ */
+static void thread_idle_sleep() {
+
+	bvm_uint32_t millis = BVM_THREAD_IDLE_SLEEP_MAX;
+#if BVM_GC_IDLE_ENABLE
+	/* with no thread due to wake, the VM is idle for as long as it takes */
+	bvm_bool_t idle_gc = (bvm_gl_gc_idle_min_time > 0);
+#endif
+
+	if (thread_timers_count != 0) {
 
-	bvm_vmthread_t *next, *vmthread;
-	bvm_int64_t current_time;
+		bvm_int64_t wait_time = bvm_gl_thread_timers[0]->time_to_awake;
+		bvm_int64_t current_time = bvm_pd_system_time();
+		bvm_int64_t max_time;
 
-	vmthread = thread_callback_list;
-	current_time = bvm_pd_system_time();
+		BVM_INT64_decrease(wait_time, current_time);
 
-	do {
+		/* already due */
+		if (BVM_INT64_zero_le(wait_time)) return;
 
-		/* keep a handle to the next in the list.  If we do a callback that removes the thread from
-		 * the list we'll be in trouble */
-		next = vmthread->next_in_list;
+#if BVM_GC_IDLE_ENABLE
+		{
+			bvm_int64_t idle_time;
+			BVM_INT64_uint32_to_int64(idle_time, bvm_gl_gc_idle_min_time);
 
-		/* if the time has passed for the waiting thread, do the callback */
-		if (BVM_INT64_compare_le(vmthread->time_to_awake,current_time)) {
-			vmthread->callback(vmthread);
+			if (BVM_INT64_compare_lt(wait_time, idle_time)) idle_gc = BVM_FALSE;
 		}
+#endif
+
+		BVM_INT64_uint32_to_int64(max_time, BVM_THREAD_IDLE_SLEEP_MAX);
 
-		/* go to the next thread */
-		vmthread = next;
+		if (BVM_INT64_compare_lt(wait_time, max_time))
+			BVM_INT64_int64_to_uint32(wait_time, millis);
+	}
 
-		/* the callback will have removed the thread from the waiting list and also, if the thread was the only
-		 * one in the list, the callback may have set the gl_waiting_threads to NULL or, if was the first
-		 * on the list, moved it on to the next one. So we have to be careful about what gl_waiting_threads
-		 * really represents each time we loop here. */
+#if BVM_GC_IDLE_ENABLE
+	/* long enough to collect without keeping a thread waiting.  The collection takes time, so the wait is worked
+	 * out again afterwards. */
+	if (idle_gc && bvm_gc_idle()) return;
+#endif
 
-	} while ( vmthread != NULL);
+#if BVM_FILE_ASYNC_ENABLE
+	/* a file read or write being done is only seen by looking */
+	if ( (thread_file_count != 0) && (millis > BVM_FILE_ASYNC_POLL_MAX) )
+		millis = BVM_FILE_ASYNC_POLL_MAX;
+#endif
+
+#if BVM_METRICS_ENABLE
+	/* a metrics request is looked for after each sleep */
+	if ( (bvm_gl_metrics_socket >= 0) && (millis > BVM_METRICS_POLL_MAX) )
+		millis = BVM_METRICS_POLL_MAX;
+#endif
+
+#if BVM_HEAP_IDLE_ZERO_ENABLE
+	/* the idle time goes on zeroing free memory - the VM only waits once there is none left to zero */
+	if (bvm_heap_zero_step()) millis = 0;
+#endif
+
+#if BVM_CONSOLE_ENABLE && BVM_CONSOLE_BUFFER_ENABLE
+	/* nothing will be written for a while - let buffered console output be seen */
+	bvm_pd_console_flush();
+#endif
+
+#if BVM_SOCKETS_ENABLE
+	if (thread_io_count != 0)
+		resume_socket_waiters(millis);
+	else
+#endif
+		bvm_pd_system_sleep(millis);
+
+#if BVM_FILE_ASYNC_ENABLE
+	if (thread_file_count != 0)
+		resume_file_waiters();
+#endif
 }
 
 /**
@@ -484,6 +1088,106 @@ void bvm_do_thread_interrupt() {
 	BVM_THROW(th);
 }
 
+#if BVM_THREAD_ACCOUNTING_ENABLE
+
+/**
+ * Count what the current thread has executed of its timeslice since its bytecodes were last counted.  Called at a
+ * thread switch, and before anything else changes the timeslice counter.
+ */
+void bvm_thread_account_timeslice() {
+
+	/* the counter goes one below zero as the timeslice runs out */
+	bvm_int32_t counter = (bvm_gl_thread_timeslice_counter < 0) ? 0 : bvm_gl_thread_timeslice_counter;
+
+	if (bvm_gl_thread_timeslice_start > counter)
+		bvm_gl_thread_current->bytecodes += (bvm_native_ulong_t) (bvm_gl_thread_timeslice_start - counter);
+
+	bvm_gl_thread_timeslice_start = counter;
+}
+
+/**
+ * Mark a thread as waiting to run from now.
+ *
+ * @param vmthread the thread.
+ */
+static void thread_account_waiting(bvm_vmthread_t *vmthread) {
+	vmthread->waiting_since = bvm_pd_system_time_micros();
+	vmthread->is_waiting = BVM_TRUE;
+}
+
+/**
+ * Count the time the current thread has run for and the bytecodes it has executed up to now.  Called at a thread
+ * switch, and when a VM run in slices returns to the host.
+ */
+void bvm_thread_account_run() {
+
+	bvm_uint32_t now = bvm_pd_system_time_micros();
+
+	bvm_gl_thread_current->cpu_micros += (bvm_uint32_t) (now - bvm_gl_thread_run_start);
+	bvm_gl_thread_run_start = now;
+
+	bvm_thread_account_timeslice();
+}
+
+/**
+ * Count the start of a thread's run at a thread switch.  If the thread was waiting to run, the time it waited is
+ * counted in its own wait histogram and the VM's.
+ *
+ * @param vmthread the thread switched to.
+ */
+static void thread_account_switch_in(bvm_vmthread_t *vmthread) {
+
+	bvm_gl_thread_run_start = bvm_pd_system_time_micros();
+
+	if (vmthread->is_waiting) {
+
+		bvm_uint32_t micros = bvm_gl_thread_run_start - vmthread->waiting_since;
+		bvm_uint32_t i = 0;
+
+		while ( (i < BVM_THREAD_WAIT_BUCKETS - 1) && (micros > bvm_gl_thread_wait_bounds[i]) ) i++;
+
+		vmthread->waits[i]++;
+		vmthread->wait_micros += micros;
+		bvm_gl_thread_waits[i]++;
+		bvm_gl_thread_wait_micros += micros;
+
+		vmthread->is_waiting = BVM_FALSE;
+	}
+}
+
+/**
+ * Get the microseconds a thread has run for, including the current run of the current thread.
+ *
+ * @param vmthread the thread.
+ *
+ * @return the microseconds the thread has run for.
+ */
+bvm_native_ulong_t bvm_thread_cpu_micros(bvm_vmthread_t *vmthread) {
+
+	bvm_native_ulong_t micros = vmthread->cpu_micros;
+
+	if (vmthread == bvm_gl_thread_current)
+		micros += (bvm_uint32_t) (bvm_pd_system_time_micros() - bvm_gl_thread_run_start);
+
+	return micros;
+}
+
+/**
+ * Get the bytecodes a thread has executed, including those of the current run of the current thread.
+ *
+ * @param vmthread the thread.
+ *
+ * @return the bytecodes the thread has executed.
+ */
+bvm_native_ulong_t bvm_thread_bytecodes(bvm_vmthread_t *vmthread) {
+
+	if (vmthread == bvm_gl_thread_current) bvm_thread_account_timeslice();
+
+	return vmthread->bytecodes;
+}
+
+#endif
+
 /**
  * Switch from the current thread to the next runnable thread.
  *
@@ -491,30 +1195,69 @@ void bvm_do_thread_interrupt() {
  * the only runnable thread it will remain current and, of course,  the thread timeslice
  * counter is reset.
  *
- * Each time this function is called the timed callback list is scanned (if there is anything in it).
- *
- * TODO:  A more efficient means of checking the callback list is required.  Maybe every 'n' times
- * this function is called might be a simple way.  A better way would be to only check it when sure there is
- * something to resume - like doing a smart thing when adding something to the list.
+ * Each time this function is called the top of the timed callback heap is checked (if there is anything in it).
  */
 void bvm_thread_switch() {
 
 	bvm_vmthread_t *vmthread;
 
+#if BVM_GC_BUDGET_ENABLE
+	/* collect before the heap runs out if the allocation budget is spent */
+	bvm_gc_check_budget();
+#endif
+
+#if BVM_GC_INCREMENTAL_ENABLE
+	/* a bounded amount of GC marking is done at each thread switch */
+	bvm_gc_mark_slice();
+#endif
+
+#if BVM_PROFILER_ENABLE
+	/* the thread being switched out may be sampled */
+	if (bvm_gl_profiler_enabled) bvm_profiler_tick();
+#endif
+
+	/* the time of the thread being switched out ends here */
+	BVM_PROFILER_COUNT_TIME();
+
+#if BVM_THREAD_ACCOUNTING_ENABLE
+	bvm_thread_account_run();
+#endif
+
 #if BVM_DEBUGGER_ENABLE
 top:
 #endif
 
-	vmthread = NULL;
-
 	/* If there are callback threads, have a look at them first to see if any can be resumed */
-	if (thread_callback_list != NULL) {
+	if (thread_timers_count != 0)
 		resume_callback_timeouts();
 
-		/* If we have attempted to wake threads and found that afterwards there no runnable
-		 * threads, we'll spin on the waiting ones until something happens */
-		while ( (bvm_gl_thread_runnable_list == NULL) && (thread_callback_list != NULL) )
-			resume_callback_timeouts();
+#if BVM_SOCKETS_ENABLE
+	/* ... and likewise any threads parked on sockets */
+	if (thread_io_count != 0)
+		resume_socket_waiters(0);
+#endif
+
+#if BVM_FILE_ASYNC_ENABLE
+	/* ... and any threads parked on file reads or writes that are done */
+	if (thread_file_count != 0)
+		resume_file_waiters();
+#endif
+
+	/* If we have attempted to wake threads and found that afterwards there no runnable
+	 * threads, we'll sleep until the earliest waiting one is due (or a socket is ready) */
+	while ( !THREAD_HAS_RUNNABLE && THREAD_HAS_WAITERS ) {
+#if BVM_VM_SLICE_ENABLE
+		/* a VM run in slices gives its idle time back to the host */
+		if (bvm_gl_exec_slice_active) {
+			bvm_gl_exec_slice_idle = BVM_TRUE;
+			return;
+		}
+#endif
+		thread_idle_sleep();
+		resume_callback_timeouts();
+#if BVM_METRICS_ENABLE
+		bvm_metrics_interact();
+#endif
 	}
 
 #if BVM_DEBUGGER_ENABLE
@@ -551,103 +1294,379 @@ top:
 	}
 #endif
 
+#if BVM_METRICS_ENABLE
+	/* check for a metrics request "every so often" */
+	if ( (bvm_gl_metrics_socket >= 0) && (metrics_interaction_counter-- == 0) ) {
+		metrics_interaction_counter = BVM_METRICS_INTERACTION_COUNT;
+		bvm_metrics_interact();
+	}
+#endif
+
 	/* what!  Have we managed to get to this point and have no threads left to run?  Nasty. */
-	if ( (bvm_gl_thread_runnable_list == NULL) && (thread_callback_list == NULL) )
+	if ( !THREAD_HAS_RUNNABLE && !THREAD_HAS_WAITERS )
 		BVM_VM_EXIT(BVM_FATAL_ERR_NO_RUNNABLE_OR_WAITING_THREADS, NULL);
 
-	/* if the current thread has not been blocked (which means it is still in the runnable list)
-	 * get the next one in the list. */
-	if (bvm_gl_thread_current->status == BVM_THREAD_STATUS_RUNNABLE)
-		vmthread = bvm_gl_thread_current->next_in_list;
-
-	/* ... no joy? just go to head of the runnable list */
-	if (vmthread == NULL) vmthread = bvm_gl_thread_runnable_list;
+	vmthread = thread_runnable_next();
 
 	/* If we are changing threads save the current thread state and restore the switched-to
 	 * thread's state */
 	if (vmthread != bvm_gl_thread_current) {
+#if BVM_HEAP_TLAB_ENABLE
+		/* the allocation buffer belongs to the thread being switched out */
+		bvm_heap_tlab_retire();
+#endif
+#if BVM_THREAD_ACCOUNTING_ENABLE
+		/* a thread switched out while still runnable waits for its next turn from now */
+		if (bvm_gl_thread_current->status == BVM_THREAD_STATUS_RUNNABLE)
+			thread_account_waiting(bvm_gl_thread_current);
+#endif
 		bvm_thread_store_registers(bvm_gl_thread_current);
 		bvm_thread_load_registers(vmthread);
 		bvm_gl_thread_current = vmthread;
 	}
 
-	/* Reset the thread timeslice counter.  Even if we did not actually change threads (the current
-	 * thread is the only running thread) we will still reset this.  The result being that the
-	 * timeslice counter is reset every thread switch request. */
-	bvm_gl_thread_timeslice_counter = vmthread->timeslice;
+#if BVM_THREAD_ACCOUNTING_ENABLE
+	thread_account_switch_in(vmthread);
+#endif
+
+	/* Reset the thread timeslice counter.  Even if we did not actually change threads (the current
+	 * thread is the only running thread) we will still reset this.  The result being that the
+	 * timeslice counter is reset every thread switch request. */
+	bvm_gl_thread_timeslice_counter = vmthread->timeslice;
+#if BVM_THREAD_ACCOUNTING_ENABLE
+	bvm_gl_thread_timeslice_start = bvm_gl_thread_timeslice_counter;
+#endif
+
+#if BVM_DEBUGGER_ENABLE
+	/* if the switched-to thread has parked debug events, send them.  Being careful here
+	 * because sending a debug event *may* cause the switched-to thread or the VM to become suspended!
+	 * If this is the case, we'll just go back to the top of thread-switch and try for another
+	 * thread.*/
+	if ( (bvmd_is_session_open() && (bvm_gl_thread_current->dbg_parked_events != NULL) )) {
+		bvmd_send_parked_events(bvm_gl_thread_current);
+		if (bvm_gl_thread_current->status != BVM_THREAD_STATUS_RUNNABLE) goto top;
+	}
+#endif
+
+	/* if the switched-to thread has a pending exception, deal with it.  The exception will be
+	 * thrown from bvm_do_thread_interrupt() call */
+	if (bvm_gl_thread_current->pending_exception != NULL) {
+		bvm_do_thread_interrupt();
+	}
+}
+
+#if (!BVM_THREAD_PRIORITY_QUEUES_ENABLE)
+
+/**
+ * Remove a thread from a list.  If the thread is not in the list this function has no effect.
+ *
+ * @param list the list to remove from
+ * @param vmthread the thread to remove
+ */
+static void remove_thread_from_list(bvm_vmthread_t **list, bvm_vmthread_t *vmthread) {
+
+	if (*list == vmthread) {
+
+		/* the thread is actually the head of the list */
+		*list = vmthread->next_in_list;
+		vmthread->next_in_list = NULL;
+	}
+	else {
+
+		/* the thread is not the head of the list */
+
+		bvm_vmthread_t *th = *list;
+
+		while ( (th != NULL) ) {
+
+			if (th->next_in_list == vmthread) {
+				th->next_in_list = vmthread->next_in_list;
+				vmthread->next_in_list = NULL;
+				break;
+			}
+
+			th = th->next_in_list;
+		}
+	}
+}
+
+/**
+ *  Put a thread into a given list of threads.  Used to place a thread into either
+ *  the runnable list or the callback list.
+ *
+ * @param list the list to put the threa into
+ * @param vmthread the thread
+ */
+static void put_thread_in_list(bvm_vmthread_t **list, bvm_vmthread_t *vmthread) {
+
+	if (*list == NULL) {
+
+		/* list is empty, so make it the head */
+		*list = vmthread;
+		vmthread->next_in_list = NULL;
+	}
+	else {
+
+		/* list is not empty, but still insert it at the front */
+		vmthread->next_in_list = (*list)->next_in_list;
+		(*list)->next_in_list = vmthread;
+	}
+}
+
+#else
+
+/**
+ * Append a thread to the back of a runnable queue.
+ *
+ * @param vmthread the thread
+ * @param level the priority of the queue
+ */
+static void thread_queue_append(bvm_vmthread_t *vmthread, bvm_uint8_t level) {
+
+	vmthread->next_in_list = NULL;
+	vmthread->run_level = level;
+
+	if (thread_runnable_tails[level] == NULL)
+		thread_runnable_heads[level] = vmthread;
+	else
+		thread_runnable_tails[level]->next_in_list = vmthread;
+
+	thread_runnable_tails[level] = vmthread;
+}
+
+/**
+ * Unlink a thread from the runnable queue it is in.
+ *
+ * @param vmthread the thread
+ */
+static void thread_queue_unlink(bvm_vmthread_t *vmthread) {
+
+	bvm_uint8_t level = vmthread->run_level;
+	bvm_vmthread_t *prev = NULL;
+	bvm_vmthread_t *th = thread_runnable_heads[level];
+
+	while ( (th != NULL) && (th != vmthread) ) {
+		prev = th;
+		th = th->next_in_list;
+	}
+
+	if (th == NULL) return;
+
+	if (prev == NULL)
+		thread_runnable_heads[level] = vmthread->next_in_list;
+	else
+		prev->next_in_list = vmthread->next_in_list;
+
+	if (thread_runnable_tails[level] == vmthread)
+		thread_runnable_tails[level] = prev;
+
+	vmthread->next_in_list = NULL;
+	vmthread->run_level = 0;
+}
+
+/**
+ * The runnable queue a thread belongs in by its Java priority - or, with #BVM_THREAD_PRIORITY_INHERITANCE_ENABLE,
+ * by the priority it has inherited from the threads blocked for its monitors if that is higher.
+ *
+ * @param vmthread the thread
+ * @return the thread's priority, kept within the Java priority range.
+ */
+static bvm_uint8_t thread_base_level(bvm_vmthread_t *vmthread) {
+
+	bvm_int32_t priority = vmthread->thread_obj->priority.int_value;
+
+	if (priority < BVM_THREAD_PRIORITY_MIN) priority = BVM_THREAD_PRIORITY_MIN;
+	if (priority > BVM_THREAD_PRIORITY_MAX) priority = BVM_THREAD_PRIORITY_MAX;
+
+#if BVM_THREAD_PRIORITY_INHERITANCE_ENABLE
+	if (vmthread->inherited_level > priority) priority = vmthread->inherited_level;
+#endif
+
+	return (bvm_uint8_t) priority;
+}
+
+/**
+ * Age the runnable queues below a given priority by moving each thread in them up one queue.  A thread
+ * starved by higher priority threads therefore gets a turn eventually.  Threads drop back to their own
+ * priority once they have had a turn.
+ *
+ * @param top the highest priority with a runnable thread.
+ */
+static void thread_age_runnable(bvm_uint8_t top) {
+
+	bvm_uint8_t level;
+
+	/* downwards so no thread moves more than once */
+	for (level = top - 1; level >= BVM_THREAD_PRIORITY_MIN; level--) {
+
+		bvm_vmthread_t *vmthread = thread_runnable_heads[level];
+
+		thread_runnable_heads[level] = NULL;
+		thread_runnable_tails[level] = NULL;
+
+		while (vmthread != NULL) {
+			bvm_vmthread_t *next = vmthread->next_in_list;
+			thread_queue_append(vmthread, level + 1);
+			vmthread = next;
+		}
+	}
+}
+
+#if BVM_THREAD_PRIORITY_INHERITANCE_ENABLE
+
+/**
+ * Raise the priority of the owner of a monitor to at least the given priority, and the owner of the monitor that
+ * owner is blocked for (if any), and so on down the chain.  An owner waiting in a runnable queue below its new
+ * priority is moved up to the queue for it.
+ *
+ * @param owner the owner of a monitor, or \c NULL if it is not owned.
+ * @param level the priority of a thread blocked for the monitor.
+ */
+static void thread_inherit_level(bvm_vmthread_t *owner, bvm_uint8_t level) {
+
+	/* stops at a thread already at the priority - which also ends a chain that loops back on itself */
+	while ( (owner != NULL) && (level > thread_base_level(owner)) ) {
 
-#if BVM_DEBUGGER_ENABLE
-	/* if the switched-to thread has parked debug events, send them.  Being careful here
-	 * because sending a debug event *may* cause the switched-to thread or the VM to become suspended!
-	 * If this is the case, we'll just go back to the top of thread-switch and try for another
-	 * thread.*/
-	if ( (bvmd_is_session_open() && (bvm_gl_thread_current->dbg_parked_events != NULL) )) {
-		bvmd_send_parked_events(bvm_gl_thread_current);
-		if (bvm_gl_thread_current->status != BVM_THREAD_STATUS_RUNNABLE) goto top;
-	}
-#endif
+		owner->inherited_level = level;
 
-	/* if the switched-to thread has a pending exception, deal with it.  The exception will be
-	 * thrown from bvm_do_thread_interrupt() call */
-	if (bvm_gl_thread_current->pending_exception != NULL) {
-		bvm_do_thread_interrupt();
+		if ( (owner->run_level != 0) && (owner->run_level < level) ) {
+			thread_queue_unlink(owner);
+			thread_queue_append(owner, level);
+		}
+
+		owner = (owner->blocked_on != NULL) ? owner->blocked_on->owner_thread : NULL;
 	}
 }
 
 /**
- * Remove a thread from a list.  If the thread is not in the list this function has no effect.
+ * Give the highest priority of the threads in a lock queue.
  *
- * @param list the list to remove from
- * @param vmthread the thread to remove
+ * @param vmthread the head of the lock queue, or \c NULL if it is empty.
+ * @return the highest priority, or zero if the queue is empty.
  */
-static void remove_thread_from_list(bvm_vmthread_t **list, bvm_vmthread_t *vmthread) {
+static bvm_uint8_t thread_lock_queue_level(bvm_vmthread_t *vmthread) {
 
-	if (*list == vmthread) {
+	bvm_uint8_t level = 0;
 
-		/* the thread is actually the head of the list */
-		*list = vmthread->next_in_list;
-		vmthread->next_in_list = NULL;
+	for (; vmthread != NULL; vmthread = vmthread->next_in_queue) {
+		bvm_uint8_t thread_level = thread_base_level(vmthread);
+		if (thread_level > level) level = thread_level;
 	}
-	else {
 
-		/* the thread is not the head of the list */
+	return level;
+}
 
-		bvm_vmthread_t *th = *list;
+/**
+ * Work out again what priority a thread inherits, from the lock queues of the monitors it still owns.  Called once
+ * the thread has given up a monitor.  A runnable thread that was moved up keeps its place until it has had its turn.
+ *
+ * @param vmthread the thread.
+ */
+static void thread_uninherit_level(bvm_vmthread_t *vmthread) {
 
-		while ( (th != NULL) ) {
+	bvm_monitor_t *monitor;
+	bvm_uint8_t level = 0;
 
-			if (th->next_in_list == vmthread) {
-				th->next_in_list = vmthread->next_in_list;
-				vmthread->next_in_list = NULL;
-				break;
-			}
+	if (vmthread->inherited_level == 0) return;
 
-			th = th->next_in_list;
+	/* not kept per thread - only a thread that has had priority inherited pays for the walk */
+	vmthread->inherited_level = 0;
+
+	for (monitor = bvm_gl_thread_monitor_list; monitor != NULL; monitor = monitor->next) {
+		if ( (monitor->in_use) && (monitor->owner_thread == vmthread) && (monitor->lock_queue != NULL) ) {
+			bvm_uint8_t queue_level = thread_lock_queue_level(monitor->lock_queue);
+			if (queue_level > level) level = queue_level;
 		}
 	}
+
+	if (level > thread_base_level(vmthread)) vmthread->inherited_level = level;
 }
 
+#endif
+
+#endif
+
 /**
- *  Put a thread into a given list of threads.  Used to place a thread into either
- *  the runnable list or the callback list.
+ * Make a thread runnable by putting it in the runnable list.
  *
- * @param list the list to put the threa into
  * @param vmthread the thread
  */
-static void put_thread_in_list(bvm_vmthread_t **list, bvm_vmthread_t *vmthread) {
+static void thread_runnable_add(bvm_vmthread_t *vmthread) {
+#if BVM_THREAD_ACCOUNTING_ENABLE
+	thread_account_waiting(vmthread);
+#endif
+#if BVM_THREAD_PRIORITY_QUEUES_ENABLE
+	/* at the back of the queue for its priority */
+	thread_queue_append(vmthread, thread_base_level(vmthread));
+	thread_runnable_count++;
+#else
+	/* at the front of the list (just after the current thread) */
+	put_thread_in_list(&bvm_gl_thread_runnable_list, vmthread);
+#endif
+}
 
-	if (*list == NULL) {
+/**
+ * Take a thread out of the runnable list.  If it is not in it, nothing happens.
+ *
+ * @param vmthread the thread
+ */
+static void thread_runnable_remove(bvm_vmthread_t *vmthread) {
+#if BVM_THREAD_PRIORITY_QUEUES_ENABLE
+	if (vmthread->run_level != 0) {
+		thread_queue_unlink(vmthread);
+		thread_runnable_count--;
+	}
+#else
+	remove_thread_from_list(&bvm_gl_thread_runnable_list, vmthread);
+#endif
+}
 
-		/* list is empty, so make it the head */
-		*list = vmthread;
-		vmthread->next_in_list = NULL;
+/**
+ * Choose the next thread to run.  There must be a runnable thread.
+ *
+ * With priority queues, a current thread that is still runnable goes to the back of the queue for its own
+ * priority and the thread at the front of the highest priority queue is chosen.  Every
+ * #BVM_THREAD_AGEING_INTERVAL calls the lower queues are aged (see #thread_age_runnable).
+ *
+ * Without them, threads are simply taken round-robin from the runnable list.
+ *
+ * @return the next thread to run, which may be the current thread.
+ */
+static bvm_vmthread_t *thread_runnable_next() {
+
+#if BVM_THREAD_PRIORITY_QUEUES_ENABLE
+
+	bvm_uint8_t level = BVM_THREAD_PRIORITY_MAX;
+
+	if ( (bvm_gl_thread_current->status == BVM_THREAD_STATUS_RUNNABLE) && (bvm_gl_thread_current->run_level != 0) ) {
+		thread_queue_unlink(bvm_gl_thread_current);
+		thread_queue_append(bvm_gl_thread_current, thread_base_level(bvm_gl_thread_current));
 	}
-	else {
 
-		/* list is not empty, but still insert it at the front */
-		vmthread->next_in_list = (*list)->next_in_list;
-		(*list)->next_in_list = vmthread;
+	while (thread_runnable_heads[level] == NULL) level--;
+
+	if (--thread_ageing_counter == 0) {
+		thread_ageing_counter = BVM_THREAD_AGEING_INTERVAL;
+		thread_age_runnable(level);
 	}
+
+	return thread_runnable_heads[level];
+
+#else
+
+	bvm_vmthread_t *vmthread = NULL;
+
+	/* if the current thread has not been blocked (which means it is still in the runnable list)
+	 * get the next one in the list. */
+	if (bvm_gl_thread_current->status == BVM_THREAD_STATUS_RUNNABLE)
+		vmthread = bvm_gl_thread_current->next_in_list;
+
+	/* ... no joy? just go to head of the runnable list */
+	if (vmthread == NULL) vmthread = bvm_gl_thread_runnable_list;
+
+	return vmthread;
+
+#endif
 }
 
 
@@ -694,13 +1713,13 @@ bvm_obj_t *bvm_thread_terminated_callback(bvm_cell_t *res1, bvm_cell_t *res2, bv
 	vmthread->status = BVM_THREAD_STATUS_TERMINATED;
 
 	/* remove the thread from the runnable list*/
-	remove_thread_from_list(&bvm_gl_thread_runnable_list, vmthread);
+	thread_runnable_remove(vmthread);
 
 	/* pop the callback frame */
 	bvm_frame_pop();
 
 	/* free up stack thread memory straight away - it will never be used
-	 * again. We'll traverse the thread's stack list from the front and free them all ...*/
+	 * again by this thread. We'll traverse the thread's stack list from the front and pool or free them all ...*/
 	{
 		bvm_stacksegment_t *current, *next;
 
@@ -710,16 +1729,25 @@ bvm_obj_t *bvm_thread_terminated_callback(bvm_cell_t *res1, bvm_cell_t *res2, bv
 		/* set the head of the list to null */
 		vmthread->stack_list = NULL;
 
-		/* loop over each stack in the list and free it */
+#if BVM_THREAD_TASKS_ENABLE
+		/* a task keeps its first segment in case its VM thread is pooled */
+		if (vmthread->is_task) {
+			vmthread->stack_list = current;
+			current = current->next;
+			vmthread->stack_list->next = NULL;
+		}
+#endif
+
+		/* loop over each stack in the list and pool or free it */
 		while (current != NULL) {
 			next = current->next;
-			bvm_heap_free(current);
+			if (!bvm_thread_pool_stack(current)) bvm_heap_free(current);
 			current = next;
 		}
 	}
 
 	/* reset timeslice counter to cause a thread switch on return to the top of the interp loop */
-	bvm_gl_thread_timeslice_counter = 0;
+	BVM_THREAD_REQUEST_SWITCH();
 
 	bvm_monitor_t *monitor = get_monitor_for_obj((bvm_obj_t *) vmthread->thread_obj);
 
@@ -743,6 +1771,27 @@ bvm_obj_t *bvm_thread_terminated_callback(bvm_cell_t *res1, bvm_cell_t *res2, bv
 	}
 #endif
 
+#if BVM_SCOPED_MEMORY_ENABLE
+	/* a thread that ends leaves its scopes - nothing can be referring to what is in them */
+	bvm_scope_exit_all(vmthread);
+#endif
+
+#if BVM_FILE_ASYNC_ENABLE
+	/* a file read or write that was done but never finished */
+	if (vmthread->file_async != NULL) {
+		bvm_file_async_free(vmthread->file_async);
+		vmthread->file_async = NULL;
+	}
+#endif
+
+#if BVM_THREAD_TASKS_ENABLE
+	/* a task's VM thread goes to the next task - or its kept segment goes the way of the others */
+	if ( (vmthread->is_task) && (!thread_task_retire(vmthread)) ) {
+		if (!bvm_thread_pool_stack(vmthread->stack_list)) bvm_heap_free(vmthread->stack_list);
+		vmthread->stack_list = NULL;
+	}
+#endif
+
 	/* no return value required for a thread termination callback */
 	return NULL;
 }
@@ -774,12 +1823,8 @@ static void thread_resume(bvm_vmthread_t *vmthread) {
 	}
 #endif
 
-	/* put the thread into the front of the runnable list (just after the current thread).
-	 * We don't switch to it, it'll get there in its own time.
-	 * TODO.  Perhaps put at the *end* of the list - this could (might?) cause a thrashing
-	 * situation where other threads are starved - would not matter if thread switch was a little
-	 * more random in thread selection . */
-	put_thread_in_list(&bvm_gl_thread_runnable_list, vmthread);
+	/* put the thread into the runnable list.  We don't switch to it, it'll get there in its own time. */
+	thread_runnable_add(vmthread);
 
 	/* set it now to have the status that all threads in the runnable list have */
 	vmthread->status = BVM_THREAD_STATUS_RUNNABLE;
@@ -811,14 +1856,14 @@ static void thread_block(bvm_vmthread_t *vmthread) {
 		bvm_throw_exception(BVM_ERR_ILLEGAL_THREAD_STATE_EXCEPTION, NULL);
 
 	/* remove the thread from the runnable list */
-	remove_thread_from_list(&bvm_gl_thread_runnable_list, vmthread);
+	thread_runnable_remove(vmthread);
 
 	vmthread->status = BVM_THREAD_STATUS_BLOCKED;
 
 	/* if we just blocked the current thread, expire the thread's timeslice counter - this
 	 * will cause the interpreter loop to switch threads  */
 	if (vmthread == bvm_gl_thread_current)
-		bvm_gl_thread_timeslice_counter = 0;
+		BVM_THREAD_REQUEST_SWITCH();
 
 #if BVM_DEBUGGER_ENABLE
 	/* check and see if all threads are now suspended */
@@ -951,96 +1996,368 @@ void bvm_thread_start(bvm_vmthread_t *vmthread, bvm_bool_t push_run_method) {
 		bvmd_eventcontext_t *context = bvmd_eventdef_new_context(JDWP_EventKind_THREAD_START, vmthread);
 		bvmd_do_event(context);
 	}
-#endif
-}
+#endif
+}
+
+
+/**
+ * Add a thread to the end of a queue.
+ *
+ * @param queue the thread queue to add a thread to
+ * @param vmthread the thread to add
+ */
+static void add_thread_to_queue(bvm_vmthread_t **queue, bvm_vmthread_t *vmthread) {
+
+	bvm_vmthread_t *head = *queue;
+
+	vmthread->next_in_queue = NULL;
+
+	if (head == NULL) {
+		/* make it the head of the list - which is also its tail */
+		vmthread->prev_in_queue = vmthread;
+		*queue = vmthread;
+	}
+	else {
+		/* list exists, add it after the tail */
+		vmthread->prev_in_queue = head->prev_in_queue;
+		head->prev_in_queue->next_in_queue = vmthread;
+		head->prev_in_queue = vmthread;
+	}
+}
+
+#if BVM_THREAD_MONITOR_SPIN_LIMIT > 0
+
+/**
+ * Add a thread to the head of a queue.
+ *
+ * @param queue the thread queue to add a thread to
+ * @param vmthread the thread to add
+ */
+static void add_thread_to_queue_head(bvm_vmthread_t **queue, bvm_vmthread_t *vmthread) {
+
+	bvm_vmthread_t *head = *queue;
+
+	if (head == NULL) {
+		vmthread->prev_in_queue = vmthread;
+	} else {
+		vmthread->prev_in_queue = head->prev_in_queue;
+		head->prev_in_queue = vmthread;
+	}
+
+	vmthread->next_in_queue = head;
+	*queue = vmthread;
+}
+
+#endif
+
+/**
+ * Remove a thread from a queue.  The thread must be in the queue.
+ *
+ * @param queue the thread queue to remove a thread from
+ * @param vmthread the thread to remove
+ */
+static void remove_thread_from_queue(bvm_vmthread_t **queue, bvm_vmthread_t *vmthread) {
+
+	bvm_vmthread_t *head = *queue;
+	bvm_vmthread_t *next = vmthread->next_in_queue;
+
+	if (vmthread == head) {
+		/* move the head along - the new head takes over the pointer to the tail */
+		*queue = next;
+		if (next != NULL)
+			next->prev_in_queue = vmthread->prev_in_queue;
+	} else {
+		vmthread->prev_in_queue->next_in_queue = next;
+
+		/* the tail is pointed to by the head, not by the next */
+		if (next != NULL)
+			next->prev_in_queue = vmthread->prev_in_queue;
+		else
+			head->prev_in_queue = vmthread->prev_in_queue;
+	}
+
+	vmthread->next_in_queue = NULL;
+	vmthread->prev_in_queue = NULL;
+}
+
+/**
+ * Gets a monitor from the unused monitor free list, or creates a new one if the free list is empty.  The
+ * monitor is bound to the given object and entered in the monitor hash table.
+ *
+ * @param obj the object the monitor is for.
+ * @return a bvm_monitor_t*
+ */
+static bvm_monitor_t *get_unused_monitor(bvm_obj_t *obj) {
+
+	bvm_monitor_t *monitor = thread_monitor_free_list;
+	bvm_uint32_t bucket = THREAD_MONITOR_BUCKET(obj);
+
+	if (monitor != NULL) {
+		thread_monitor_free_list = monitor->next_in_bucket;
+	} else {
+		/* none free, create one at the head of the list of all monitors - note the metadata
+		 * type - we'll manage it ourselves and it'll be not GC'd */
+		monitor = bvm_heap_calloc(sizeof(bvm_monitor_t), BVM_ALLOC_TYPE_METADATA);
+		monitor->next = bvm_gl_thread_monitor_list;
+		bvm_gl_thread_monitor_list = monitor;
+#if BVM_METRICS_ENABLE
+		bvm_gl_metrics.monitors++;
+#endif
+	}
+
+#if BVM_METRICS_ENABLE
+	bvm_gl_metrics.monitors_in_use++;
+#endif
+
+	monitor->in_use = BVM_TRUE;
+	monitor->owner_object = obj;
+	monitor->next_in_bucket = thread_monitor_table[bucket];
+	thread_monitor_table[bucket] = monitor;
+
+#if BVM_THIN_LOCK_ENABLE
+	BVM_OBJECT_SetLockword(obj, THREAD_LOCKWORD_INFLATED);
+#endif
+
+	return monitor;
+}
+
+/**
+ * Look in the monitor hash table for a monitor for the given object.  If none found, returns \c NULL
+ *
+ * @param obj
+ * @return the bvm_monitor_t for the given object, or \c NULL if not found.
+ */
+bvm_monitor_t *get_monitor_for_obj(bvm_obj_t *obj) {
+
+	bvm_monitor_t *monitor;
+
+#if BVM_THIN_LOCK_ENABLE
+	/* only inflated locks have a monitor */
+	if ( (BVM_OBJECT_GetLockword(obj) & THREAD_LOCKWORD_INFLATED) == 0)
+		return NULL;
+#endif
+
+	monitor = thread_monitor_table[THREAD_MONITOR_BUCKET(obj)];
+
+	while ( (monitor != NULL) && (monitor->owner_object != obj) )
+		monitor = monitor->next_in_bucket;
+
+	return monitor;
+}
+
+#if BVM_THIN_LOCK_ENABLE
+
+/**
+ * Find the thread that holds a thin lock from its lock id.
+ *
+ * @param lockword the thin lock word of an object.
+ * @return the owner thread, or \c NULL if the thread no longer exists.
+ */
+static bvm_vmthread_t *thread_lock_owner(bvm_native_ulong_t lockword) {
+
+	bvm_native_ulong_t owner = THREAD_LOCKWORD_GetOwner(lockword);
+	bvm_vmthread_t *vmthread = bvm_gl_threads;
+
+	while ( (vmthread != NULL) && (vmthread->lock_id != owner) )
+		vmthread = vmthread->next;
+
+	return vmthread;
+}
+
+#endif
+
+/**
+ * Give the monitor of an object, inflating its thin lock into a monitor if it is thin-locked.  The new monitor
+ * takes the owner thread and recursion count of the thin lock.
+ *
+ * @param obj the object.
+ * @return the bvm_monitor_t for the given object, or \c NULL if the object is not locked and has no monitor.
+ */
+bvm_monitor_t *bvm_thread_monitor_inflate(bvm_obj_t *obj) {
+
+#if BVM_THIN_LOCK_ENABLE
+
+	bvm_native_ulong_t lockword = BVM_OBJECT_GetLockword(obj);
+
+	if ( (lockword != 0) && ( (lockword & THREAD_LOCKWORD_INFLATED) == 0) ) {
+
+		bvm_vmthread_t *vmthread = thread_lock_owner(lockword);
+		bvm_monitor_t *monitor = get_unused_monitor(obj);
+
+		/* a lock left by a thread that no longer exists is not held by anyone */
+		if (vmthread != NULL) {
+			monitor->owner_thread = vmthread;
+			monitor->lock_depth = (bvm_uint32_t) THREAD_LOCKWORD_GetCount(lockword);
+		}
+
+		return monitor;
+	}
+
+#endif
+
+	return get_monitor_for_obj(obj);
+}
+
+/**
+ * Determine if a thread holds the lock of an object, whether thin or inflated.
+ *
+ * @param obj the object.
+ * @param vmthread the thread.
+ * @return #BVM_TRUE if the given thread owns the object's lock, #BVM_FALSE otherwise.
+ */
+bvm_bool_t bvm_thread_monitor_is_owner(bvm_obj_t *obj, bvm_vmthread_t *vmthread) {
+
+	bvm_monitor_t *monitor;
+
+#if BVM_THIN_LOCK_ENABLE
+	bvm_native_ulong_t lockword = BVM_OBJECT_GetLockword(obj);
+
+	if ( (lockword & THREAD_LOCKWORD_INFLATED) == 0)
+		return (lockword != 0) && (THREAD_LOCKWORD_GetOwner(lockword) == vmthread->lock_id);
+#endif
+
+	monitor = get_monitor_for_obj(obj);
+
+	return (monitor != NULL) && (monitor->owner_thread == vmthread);
+}
+
+#if BVM_DEBUGGER_ENABLE && BVM_THIN_LOCK_ENABLE
+
+/**
+ * Count, or inflate, the thin locks held by live threads on the objects in a run of chunks.
+ *
+ * @param chunk the first chunk.
+ * @param end the end of the run.
+ * @param inflate #BVM_TRUE to inflate each lock found, #BVM_FALSE to just count them.
+ * @return the number of held thin locks found.
+ */
+static bvm_uint32_t thread_thin_locks_in(bvm_chunk_t *chunk, bvm_chunk_t *end, bvm_bool_t inflate) {
+
+	bvm_uint32_t count = 0;
+
+	for (; chunk < end; chunk = BVM_CHUNK_GetNextChunk(chunk)) {
+
+		bvm_obj_t *obj;
+		bvm_native_ulong_t lockword;
+
+		if (!BVM_CHUNK_IsInuse(chunk)) continue;
+
+		switch (BVM_CHUNK_GetType(chunk)) {
+			case BVM_ALLOC_TYPE_OBJECT:
+			case BVM_ALLOC_TYPE_ARRAY_OF_PRIMITIVE:
+			case BVM_ALLOC_TYPE_ARRAY_OF_OBJECT:
+			case BVM_ALLOC_TYPE_STRING:
+			case BVM_ALLOC_TYPE_WEAK_REFERENCE:
+			case BVM_ALLOC_TYPE_SOFT_REFERENCE:
+			case BVM_ALLOC_TYPE_EPHEMERON:
+				break;
+			default:
+				continue;
+		}
+
+		obj = BVM_CHUNK_GetUserData(chunk);
+		lockword = BVM_OBJECT_GetLockword(obj);
+
+		if ( (lockword == 0) || (lockword & THREAD_LOCKWORD_INFLATED) || (thread_lock_owner(lockword) == NULL) )
+			continue;
+
+		count++;
+
+		if (inflate) bvm_thread_monitor_inflate(obj);
+	}
 
+	return count;
+}
 
 /**
- * Add a thread to the end of a queue.
+ * Count, or inflate, the thin locks held on all the objects in the heap and in entered scopes.
  *
- * @param queue the thread queue to add a thread to
- * @param vmthread the thread to add
+ * @param inflate #BVM_TRUE to inflate each lock found, #BVM_FALSE to just count them.
+ * @return the number of held thin locks found.
  */
-static void add_thread_to_queue(bvm_vmthread_t **queue, bvm_vmthread_t *vmthread) {
+static bvm_uint32_t thread_thin_locks(bvm_bool_t inflate) {
 
-	if (*queue == NULL) {
-		/* make it the head of the list */
-		*queue = vmthread;
-	}
-	else {
+	bvm_heap_region_t *region;
+	bvm_uint32_t count = 0;
 
-		/* list exists, add it to the end */
+#if BVM_SCOPED_MEMORY_ENABLE
+	bvm_scope_t *scope;
 
-		bvm_vmthread_t *head = *queue;
-		while (head->next_in_queue != NULL)
-			head = head->next_in_queue;
-		head->next_in_queue = vmthread;
-	}
+	for (scope = bvm_gl_scopes_entered; scope != NULL; scope = scope->next)
+		count += thread_thin_locks_in( (bvm_chunk_t *) scope->start, (bvm_chunk_t *) scope->top, inflate);
+#endif
 
-	vmthread->next_in_queue = NULL;
+	for (region = bvm_gl_heap_regions; region != NULL; region = region->next)
+		count += thread_thin_locks_in( (bvm_chunk_t *) region->start, (bvm_chunk_t *) region->end, inflate);
+
+	return count;
 }
 
+#endif
+
+#if BVM_DEBUGGER_ENABLE
+
 /**
- * Gets a monitor from created monitor list, or creates a new one at the end if
- * the cache is empty.
+ * Inflate every thin lock held by a thread into a monitor.  Called as a debugger session opens - no thin locks are
+ * taken while a session is open, so from then on the debugger sees every held lock as a monitor.
  *
- * @return a bvm_monitor_t*
+ * The heap is walked twice - once to count the held locks, and again to inflate them.  Monitors for them all are put on
+ * the free list in between so that no allocation (which may collect, or carve up a free chunk) happens during the
+ * walk that inflates.
  */
-static bvm_monitor_t *get_unused_monitor() {
-
-	bvm_monitor_t *monitor = bvm_gl_thread_monitor_list;
+void bvmd_thread_inflate_thin_locks() {
 
-	if (bvm_gl_thread_monitor_list == NULL) {
-		/* list is empty, create the first one - note the static type - we'll manage it ourselves and it'll
-		 * be not GC'd */
-		bvm_gl_thread_monitor_list = monitor = bvm_heap_calloc(sizeof(bvm_monitor_t), BVM_ALLOC_TYPE_STATIC);
-	} else {
-
-		/* list is not empty, loop through to find an unused one.  If all are used,
-		 * create a new one at the end of the list.
-		 */
+#if BVM_THIN_LOCK_ENABLE
 
-		bvm_monitor_t *last = monitor;
+	bvm_uint32_t count = thread_thin_locks(BVM_FALSE);
+	bvm_monitor_t *monitor;
 
-		while (monitor != NULL) {
-			if (!monitor->in_use) break;
-			last = monitor;
-			monitor = monitor->next;
-		}
+	for (monitor = thread_monitor_free_list; (monitor != NULL) && (count > 0); monitor = monitor->next_in_bucket)
+		count--;
 
-		/* none free, create one at the end */
-		if (monitor == NULL) {
-			last->next = monitor = bvm_heap_calloc(sizeof(bvm_monitor_t), BVM_ALLOC_TYPE_STATIC);
-		}
+	while (count-- > 0) {
+		monitor = bvm_heap_calloc(sizeof(bvm_monitor_t), BVM_ALLOC_TYPE_METADATA);
+		monitor->next = bvm_gl_thread_monitor_list;
+		bvm_gl_thread_monitor_list = monitor;
+#if BVM_METRICS_ENABLE
+		bvm_gl_metrics.monitors++;
+#endif
+		monitor->next_in_bucket = thread_monitor_free_list;
+		thread_monitor_free_list = monitor;
 	}
 
-	return monitor;
+	thread_thin_locks(BVM_TRUE);
+
+#endif
 }
 
+#endif
+
 /**
- * Scan the monitor list for a matching object.  If none found, returns \c NULL
- *
- * @param obj
- * @return the bvm_monitor_t for the given object, or \c NULL if not found.
+ * Rebuild the monitor hash table from the in-use monitors in the list of all monitors.  Must be called
+ * whenever the owner objects of monitors have been moved.
  */
-bvm_monitor_t *get_monitor_for_obj(bvm_obj_t *obj) {
+void bvm_thread_monitor_rehash() {
 
-	bvm_monitor_t *monitor = bvm_gl_thread_monitor_list;
+	bvm_monitor_t *monitor;
+	bvm_uint32_t i;
 
-    while (monitor != NULL) {
-        if (monitor->in_use && monitor->owner_object == obj) {
-            break;
-        }
-        monitor = monitor->next;
-    }
+	for (i = 0; i < BVM_THREAD_MONITOR_HASH_SIZE; i++)
+		thread_monitor_table[i] = NULL;
 
-    return monitor;
+	for (monitor = bvm_gl_thread_monitor_list; monitor != NULL; monitor = monitor->next) {
+		if (monitor->in_use) {
+			bvm_uint32_t bucket = THREAD_MONITOR_BUCKET(monitor->owner_object);
+			monitor->next_in_bucket = thread_monitor_table[bucket];
+			thread_monitor_table[bucket] = monitor;
+		}
+	}
 }
 
 /**
  * Tests to determine if a monitor is unused by the object that it is associated with.  If
  * it is unused, object and monitor are disassociated and the monitor is placed in the monitor
- * cache.
+ * free list.
  */
 static void cache_monitor_if_unused(bvm_monitor_t *monitor) {
 
@@ -1049,14 +2366,34 @@ static void cache_monitor_if_unused(bvm_monitor_t *monitor) {
 			 (monitor->wait_queue == NULL) &&
 			 (monitor->owner_thread == NULL)) {
 
+				bvm_monitor_t **link = &thread_monitor_table[THREAD_MONITOR_BUCKET(monitor->owner_object)];
+
 		        // note that this is in a list
                 bvm_monitor_t *next = monitor->next;
 
+				/* unlink from its hash bucket */
+				while (*link != monitor)
+					link = &(*link)->next_in_bucket;
+				*link = monitor->next_in_bucket;
+
+#if BVM_THIN_LOCK_ENABLE
+				/* the object may be thin-locked again */
+				BVM_OBJECT_SetLockword(monitor->owner_object, 0);
+#endif
+
 				/* clear the monitor - also has the effect of setting 'in_use' to BVM_FALSE */
 				memset(monitor,0,sizeof(bvm_monitor_t));
 
 				// restore list pointer
 				monitor->next = next;
+
+				/* and make it available for reuse */
+				monitor->next_in_bucket = thread_monitor_free_list;
+				thread_monitor_free_list = monitor;
+
+#if BVM_METRICS_ENABLE
+				bvm_gl_metrics.monitors_in_use--;
+#endif
 			}
 	}
 }
@@ -1069,7 +2406,13 @@ static void cache_monitor_if_unused(bvm_monitor_t *monitor) {
  * @param vmthread the thread to set the timeslice of.
  */
 void bvm_thread_calc_timeslice(bvm_vmthread_t *vmthread) {
+#if BVM_THREAD_TIMER_PREEMPTION_ENABLE
+	/* counted in timer ticks */
+	UNUSED(thread_default_timeslice);
+	vmthread->timeslice = vmthread->thread_obj->priority.int_value;
+#else
 	vmthread->timeslice = vmthread->thread_obj->priority.int_value * thread_default_timeslice;
+#endif
 }
 
 
@@ -1081,19 +2424,7 @@ void bvm_thread_calc_timeslice(bvm_vmthread_t *vmthread) {
 static void remove_from_wait_queue(bvm_vmthread_t *vmthread) {
 	bvm_monitor_t *monitor = get_monitor_for_obj(vmthread->waiting_on_object);
 
-	/* if this thread is the head of the list move the head, otherwise scan the queue */
-	if (monitor->wait_queue == vmthread) {
-		monitor->wait_queue = vmthread->next_in_queue;
-	} else {
-		bvm_vmthread_t *current;
-		current = monitor->wait_queue;
-		while ( (current->next_in_queue != NULL) && (current->next_in_queue != vmthread))  {
-			current = current->next_in_queue;
-		}
-
-		if (current->next_in_queue == vmthread)
-			current->next_in_queue = vmthread->next_in_queue;
-	}
+	remove_thread_from_queue(&monitor->wait_queue, vmthread);
 
 	vmthread->waiting_on_object = NULL;
 }
@@ -1103,6 +2434,10 @@ static void remove_from_wait_queue(bvm_vmthread_t *vmthread) {
  * the monitor.  Unlike the JVMS which says it should be 'random', this just picks the first
  * one off the lock queue and promotes it.
  *
+ * With #BVM_THREAD_MONITOR_SPIN_LIMIT set, a thread that will retry the acquire itself and has not
+ * yet lost too often is not made the owner - it is just resumed to compete for the monitor, which
+ * is left unowned.
+ *
  * If the lock queue is empty, the owner of the monitor is set to \c NULL to indicate that
  * the monitor is not owned.
  *
@@ -1116,18 +2451,40 @@ static void promote_thread_in_lock_queue(bvm_monitor_t *monitor) {
 
 		bvm_vmthread_t *new_owner = monitor->lock_queue;
 
+		/* take the first entry off the lock queue */
+		remove_thread_from_queue(&monitor->lock_queue, new_owner);
+
+		BVM_PROFILER_CONTENTION_UNBLOCKED(new_owner);
+
+#if BVM_THREAD_PRIORITY_INHERITANCE_ENABLE
+		new_owner->blocked_on = NULL;
+#endif
+
+#if BVM_THREAD_MONITOR_SPIN_LIMIT > 0
+		/* a thread with no lock depth to restore will execute its monitorenter again when it runs, so
+		 * it can compete for the monitor rather than be given it */
+		if ( (new_owner->lock_depth == 0) && (new_owner->monitor_spins < BVM_THREAD_MONITOR_SPIN_LIMIT) ) {
+			monitor->owner_thread = NULL;
+			new_owner->monitor_spins++;
+			thread_resume(new_owner);
+			return;
+		}
+#endif
+
 		/* the first entry of the lock queue will now own the monitor */
 		monitor->owner_thread = new_owner;
 
-		/* move the start of the lock queue along to the next in the list (may be NULL) */
-		monitor->lock_queue = new_owner->next_in_queue;
-
 		/* restore the previous depth if there is one.*/
 		monitor->lock_depth = (new_owner->lock_depth > 0) ? (new_owner->lock_depth) : 0;
 
 		/* zero the lock depth of the new owner thread */
 		new_owner->lock_depth = 0;
 
+#if BVM_THREAD_PRIORITY_INHERITANCE_ENABLE
+		/* it now holds up those left in the queue */
+		thread_inherit_level(new_owner, thread_lock_queue_level(monitor->lock_queue));
+#endif
+
 		/* get the thread back into the runnable list by resuming it */
 		thread_resume(new_owner);
 	}
@@ -1157,8 +2514,7 @@ static void establish_timed_callback(bvm_vmthread_t *vmthread, bvm_int64_t wait_
 
     vmthread->time_to_awake = wait_time;
 
-	/* add to the waiting list at the end.  No reason, just seems reasonable to add it at the end */
-	put_thread_in_list(&thread_callback_list, vmthread);
+	thread_timer_add(vmthread);
 }
 
 /**
@@ -1175,9 +2531,6 @@ static void thread_sleep_timeout_callback(bvm_vmthread_t *vmthread) {
 	if ( (vmthread->status & BVM_THREAD_STATUS_TIMED_WAITING) == 0 )
 		bvm_throw_exception(BVM_ERR_ILLEGAL_THREAD_STATE_EXCEPTION, NULL);
 
-	/* remove it from the waiting list */
-	remove_thread_from_list(&thread_callback_list, vmthread);
-
 	/* remove the waiting status */
 	vmthread->status &= ~BVM_THREAD_STATUS_TIMED_WAITING;
 
@@ -1213,6 +2566,227 @@ void bvm_thread_sleep(bvm_int64_t sleep_time) {
 	}
 }
 
+#if BVM_THREAD_TASKS_ENABLE
+
+/**
+ * Block the current thread until another resumes it with #bvm_thread_task_resume.  If it was resumed since it last
+ * yielded it carries straight on.  As for \c Thread.sleep(), an interrupt wakes it with an \c InterruptedException.
+ *
+ * After this function, the thread will be #bvm_vmthread_t::BVM_THREAD_STATUS_BLOCKED with a
+ * #bvm_vmthread_t::BVM_THREAD_STATUS_WAITING modifier.  It is in no list or queue - only a resume or an interrupt
+ * makes it runnable again.
+ */
+void bvm_thread_task_yield() {
+
+	bvm_vmthread_t *vmthread = bvm_gl_thread_current;
+
+	if (vmthread->is_interrupted) {
+		bvm_do_thread_interrupt();
+	} else if (vmthread->resume_pending) {
+		vmthread->resume_pending = BVM_FALSE;
+	} else {
+		thread_block(vmthread);
+		vmthread->status |= BVM_THREAD_STATUS_WAITING;
+		vmthread->is_yielded = BVM_TRUE;
+	}
+}
+
+/**
+ * Resume a thread that has yielded with #bvm_thread_task_yield.  A thread that is not yielded will carry straight on
+ * from its next yield - resumes are not counted, so two before a yield are the same as one.
+ *
+ * @param vmthread - the thread to resume.
+ */
+void bvm_thread_task_resume(bvm_vmthread_t *vmthread) {
+
+	if (!bvm_thread_is_alive(vmthread)) return;
+
+	if (vmthread->is_yielded) {
+		vmthread->is_yielded = BVM_FALSE;
+		vmthread->status = BVM_THREAD_STATUS_BLOCKED;
+		thread_resume(vmthread);
+	} else {
+		vmthread->resume_pending = BVM_TRUE;
+	}
+}
+
+#endif
+
+#if BVM_SOCKETS_ENABLE
+
+/**
+ * Add a thread to the socket waiters, growing them if they are full.
+ *
+ * @param vmthread the thread to add
+ * @param fd the socket the thread waits on
+ * @param events the readiness the thread waits for.
+ */
+static void thread_io_add(bvm_vmthread_t *vmthread, bvm_int32_t fd, bvm_uint8_t events) {
+
+	if (thread_io_count == thread_io_capacity) {
+
+		/* static - like the thread timers, not GC'd and never moved */
+		bvm_pd_socket_poll_t *polls = bvm_heap_alloc(thread_io_capacity * 2 * sizeof(bvm_pd_socket_poll_t), BVM_ALLOC_TYPE_STATIC);
+		bvm_vmthread_t **threads = bvm_heap_alloc(thread_io_capacity * 2 * sizeof(bvm_vmthread_t *), BVM_ALLOC_TYPE_STATIC);
+
+		memcpy(polls, bvm_gl_thread_io_polls, thread_io_count * sizeof(bvm_pd_socket_poll_t));
+		memcpy(threads, bvm_gl_thread_io_threads, thread_io_count * sizeof(bvm_vmthread_t *));
+		bvm_heap_free(bvm_gl_thread_io_polls);
+		bvm_heap_free(bvm_gl_thread_io_threads);
+
+		bvm_gl_thread_io_polls = polls;
+		bvm_gl_thread_io_threads = threads;
+		thread_io_capacity *= 2;
+	}
+
+	bvm_gl_thread_io_polls[thread_io_count].fd = fd;
+	bvm_gl_thread_io_polls[thread_io_count].events = events;
+	bvm_gl_thread_io_polls[thread_io_count].ready = 0;
+	bvm_gl_thread_io_threads[thread_io_count] = vmthread;
+
+	vmthread->io_index = ++thread_io_count;
+}
+
+/**
+ * Remove a thread from the socket waiters.  If it is not waiting on a socket, nothing happens.
+ *
+ * @param vmthread the thread to remove
+ */
+static void thread_io_remove(bvm_vmthread_t *vmthread) {
+
+	bvm_uint32_t i = vmthread->io_index;
+
+	if (i == 0) return;
+
+	vmthread->io_index = 0;
+
+	/* fill the hole with the last waiter */
+	if (--i != --thread_io_count) {
+		bvm_gl_thread_io_polls[i] = bvm_gl_thread_io_polls[thread_io_count];
+		bvm_gl_thread_io_threads[i] = bvm_gl_thread_io_threads[thread_io_count];
+		bvm_gl_thread_io_threads[i]->io_index = i + 1;
+	}
+}
+
+/**
+ * Resume a thread parked on a socket, either because its socket is ready or because its wait timed out (or it was
+ * interrupted).  The given thread has already been removed from the timed-callback heap.
+ *
+ * @param vmthread the thread to resume
+ */
+static void thread_socket_timeout_callback(bvm_vmthread_t *vmthread) {
+
+	thread_io_remove(vmthread);
+
+	/* remove the waiting status */
+	vmthread->status &= ~(BVM_THREAD_STATUS_WAITING | BVM_THREAD_STATUS_TIMED_WAITING);
+
+	/* and resume it ... */
+	thread_resume(vmthread);
+}
+
+/**
+ * Test the sockets of all threads parked on sockets and resume those that are ready.  If the sockets
+ * cannot be tested (one has been closed, for example), every parked thread is resumed so that each may find
+ * out for itself with its own I/O.
+ *
+ * @param timeout the time, in milliseconds, to wait for a socket to become ready.  Zero does not wait.
+ */
+static void resume_socket_waiters(bvm_int32_t timeout) {
+
+	bvm_int32_t result = bvm_pd_socket_poll(bvm_gl_thread_io_polls, thread_io_count, timeout);
+	bvm_uint32_t i = thread_io_count;
+
+	if (result == 0) return;
+
+	/* backwards, because resuming a thread moves the last waiter (already looked at) into its place */
+	while (i-- > 0) {
+
+		if ( (result == BVM_SOCKET_ERROR) || (bvm_gl_thread_io_polls[i].ready != 0) ) {
+
+			bvm_vmthread_t *vmthread = bvm_gl_thread_io_threads[i];
+
+			thread_timer_remove(vmthread);
+			thread_socket_timeout_callback(vmthread);
+		}
+	}
+}
+
+/**
+ * Park the current thread until a socket is ready for reading or writing, or until a timeout expires.  The
+ * thread is blocked and the calling native method should return straight after - the thread carries on when
+ * it is resumed.  The native should not presume the socket is ready on resumption - the wait may have timed out or
+ * been interrupted.  See @ref threads-sockets "Threads parked on sockets".
+ *
+ * After this function, the thread will be #bvm_vmthread_t::BVM_THREAD_STATUS_BLOCKED with a
+ * #bvm_vmthread_t::BVM_THREAD_STATUS_WAITING modifier, or a #bvm_vmthread_t::BVM_THREAD_STATUS_TIMED_WAITING
+ * modifier (and in the timed-callback list) if \c timeout is greater than zero.
+ *
+ * @param fd the socket to wait on.
+ * @param events the readiness to wait for - a combination of #BVM_SOCKET_POLL_READ and #BVM_SOCKET_POLL_WRITE.
+ * @param timeout the most time, in milliseconds, to wait.  Zero or less waits until the socket is ready.
+ */
+void bvm_thread_wait_for_socket(bvm_int32_t fd, bvm_uint8_t events, bvm_int64_t timeout) {
+
+	/* if the thread was interrupted before we get here, throw an exception and reset
+	 * the interrupted flag */
+	if (bvm_gl_thread_current->is_interrupted) {
+		bvm_do_thread_interrupt();
+	} else {
+
+		/* block thread (which removes it from runnable list) */
+		thread_block(bvm_gl_thread_current);
+
+		thread_io_add(bvm_gl_thread_current, fd, events);
+
+		if (BVM_INT64_zero_gt(timeout)) {
+			establish_timed_callback(bvm_gl_thread_current, timeout, thread_socket_timeout_callback);
+			bvm_gl_thread_current->status |= BVM_THREAD_STATUS_TIMED_WAITING;
+		} else {
+			bvm_gl_thread_current->status |= BVM_THREAD_STATUS_WAITING;
+		}
+	}
+}
+
+#endif
+
+#if BVM_FILE_ASYNC_ENABLE
+
+/**
+ * Resume the threads parked on file reads or writes that are done.
+ */
+static void resume_file_waiters() {
+
+	bvm_file_async_t *async;
+
+	while ( (async = bvm_file_async_poll()) != NULL) {
+		thread_file_count--;
+		thread_resume(async->vmthread);
+	}
+}
+
+/**
+ * Park the current thread until a file read or write started by #bvm_file_async_start is done.  The thread is blocked
+ * and the calling native method should return straight after - the thread carries on when it is resumed, and a
+ * following native takes the read or write from #bvm_vmthread_t::file_async to finish it and free it.  See
+ * @ref threads-files "Threads parked on file reads and writes".
+ *
+ * After this function, the thread will be #bvm_vmthread_t::BVM_THREAD_STATUS_BLOCKED.  It is not interruptible.
+ *
+ * @param async the read or write to wait for.
+ */
+void bvm_thread_wait_for_file(bvm_file_async_t *async) {
+
+	/* block thread (which removes it from runnable list) */
+	thread_block(bvm_gl_thread_current);
+
+	async->vmthread = bvm_gl_thread_current;
+	bvm_gl_thread_current->file_async = async;
+	thread_file_count++;
+}
+
+#endif
+
 /**
  * After a thread has been 'wait'ing and has come back because of a wait timeout or a notify
  * or notifyAll, we'll try to have it get the monitor immediately.  It the given thread can acquire
@@ -1236,14 +2810,19 @@ static void acquire_monitor_or_wait_in_lock_queue(bvm_monitor_t *monitor, bvm_vm
 		/* and tell it to start again when it can */
 		thread_resume(vmthread);
 	} else {
+		BVM_PROFILER_CONTENTION_BLOCKED(monitor->owner_object, vmthread);
 		add_thread_to_queue(&monitor->lock_queue, vmthread);
+#if BVM_THREAD_PRIORITY_INHERITANCE_ENABLE
+		vmthread->blocked_on = monitor;
+		thread_inherit_level(monitor->owner_thread, thread_base_level(vmthread));
+#endif
 	}
 }
 
 
 /**
  * A callback for threads that have been waiting in the timed-callback list and have had
- * their wait-time expire.  The thread will be removed from the timed-callback list and will
+ * their wait-time expire.  The thread has already been removed from the timed-callback list and will
  * attempt to acquire the monitor it is waiting on.  It if can acquire it, it will become runnable,
  * it not, it will become blocked and join the lock queue on the monitor.
  *
@@ -1266,9 +2845,6 @@ static void thread_wait_timeout_callback(bvm_vmthread_t *vmthread) {
 	/* remove it from the monitor wait queue */
 	remove_from_wait_queue(vmthread);
 
-	/* remove it from the waiting list */
-	remove_thread_from_list(&thread_callback_list, vmthread);
-
 	/* remove the waiting status */
 	vmthread->status &= ~BVM_THREAD_STATUS_TIMED_WAITING;
 
@@ -1301,6 +2877,8 @@ void bvm_thread_wait(bvm_obj_t *obj, bvm_int64_t wait_time) {
 
 	monitor = get_monitor_for_obj(obj);
 
+	BVM_PROFILER_CONTENTION_WAIT(obj);
+
 	/* remember the monitor and depth depth for use when this thread re-acquires the monitor */
 	bvm_gl_thread_current->lock_depth = monitor->lock_depth;
 	bvm_gl_thread_current->waiting_on_object = obj;
@@ -1323,6 +2901,10 @@ void bvm_thread_wait(bvm_obj_t *obj, bvm_int64_t wait_time) {
 	/* promote and resume a waiting one if possible.  Has the effect of releasing all locks this
 	 * thread has and establishing another as the owner thread. */
 	promote_thread_in_lock_queue(monitor);
+
+#if BVM_THREAD_PRIORITY_INHERITANCE_ENABLE
+	thread_uninherit_level(bvm_gl_thread_current);
+#endif
 }
 
 /**
@@ -1339,19 +2921,57 @@ bvm_bool_t bvm_thread_monitor_acquire(bvm_obj_t *obj, bvm_vmthread_t *vmthread)
 
 	bvm_bool_t rv = BVM_TRUE;
 	bvm_monitor_t *monitor;
+#if BVM_THREAD_MONITOR_SPIN_LIMIT > 0
+	bvm_uint32_t spins = vmthread->monitor_spins;
+#endif
 
 	if (obj == NULL)
 		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
 
+#if BVM_THREAD_MONITOR_SPIN_LIMIT > 0
+	/* whatever happens below, any competing is over unless the thread loses again */
+	vmthread->monitor_spins = 0;
+#endif
+
+#if BVM_THIN_LOCK_ENABLE
+	{
+		bvm_native_ulong_t lockword = BVM_OBJECT_GetLockword(obj);
+
+		if (lockword == 0) {
+
+			/* not locked - thin lock it if we can.  A thread coming back from a wait has a lock depth to
+			 * restore, and a monitor to restore it in. */
+			if ( (vmthread->lock_id != 0) && (vmthread->lock_depth == 0)
+#if BVM_DEBUGGER_ENABLE
+				 && !bvmd_is_session_open()
+#endif
+				) {
+				BVM_OBJECT_SetLockword(obj, ( (bvm_native_ulong_t) vmthread->lock_id << THREAD_LOCKWORD_OWNER_SHIFT) | THREAD_LOCKWORD_COUNT_ONE);
+				return BVM_TRUE;
+			}
+
+		} else if ( (lockword & THREAD_LOCKWORD_INFLATED) == 0) {
+
+			/* thin locked.  The owner re-entering just counts up unless the count would overflow */
+			if ( (THREAD_LOCKWORD_GetOwner(lockword) == vmthread->lock_id) &&
+				 ( (lockword & THREAD_LOCKWORD_COUNT_MASK) != THREAD_LOCKWORD_COUNT_MASK) ) {
+				BVM_OBJECT_SetLockword(obj, lockword + THREAD_LOCKWORD_COUNT_ONE);
+				return BVM_TRUE;
+			}
+
+			/* contended, or too deep - from here on it is a monitor */
+			bvm_thread_monitor_inflate(obj);
+		}
+	}
+#endif
+
 	monitor = get_monitor_for_obj(obj);
 
 	if (monitor == NULL) {
 		/* there is no current monitor. Get a monitor and configure it */
-		monitor = get_unused_monitor();
+		monitor = get_unused_monitor(obj);
 		monitor->owner_thread = vmthread;
 		monitor->lock_depth++;
-		monitor->in_use = BVM_TRUE;
-		monitor->owner_object = obj;
 	} else {
 
 		/* there is already a monitor.  If the current thread owns it, we'll increase the lock depth
@@ -1365,15 +2985,37 @@ bvm_bool_t bvm_thread_monitor_acquire(bvm_obj_t *obj, bvm_vmthread_t *vmthread)
 
 			vmthread->lock_depth = 0;
 
+#if BVM_THREAD_PRIORITY_INHERITANCE_ENABLE
+			/* taken ahead of threads still queued for it - it now holds them up */
+			if (monitor->lock_queue != NULL)
+				thread_inherit_level(vmthread, thread_lock_queue_level(monitor->lock_queue));
+#endif
+
 		} else {
 
 			if (monitor->owner_thread == vmthread) {
 				monitor->lock_depth++;
 			} else {
 
+				BVM_PROFILER_CONTENTION_BLOCKED(obj, vmthread);
+
+#if BVM_THREAD_MONITOR_SPIN_LIMIT > 0
+				/* a thread that was woken to compete for the monitor and lost keeps its place
+				 * at the head of the lock queue */
+				if (spins > 0) {
+					vmthread->monitor_spins = spins;
+					add_thread_to_queue_head(&monitor->lock_queue, vmthread);
+				} else
+#endif
 				/* add the thread to the lock queue for the monitor */
 				add_thread_to_queue(&monitor->lock_queue, vmthread);
 
+#if BVM_THREAD_PRIORITY_INHERITANCE_ENABLE
+				/* the owner runs at no less than the priority of those it holds up */
+				vmthread->blocked_on = monitor;
+				thread_inherit_level(monitor->owner_thread, thread_base_level(vmthread));
+#endif
+
 				/* and block it */
 				thread_block(vmthread);
 
@@ -1402,10 +3044,27 @@ void bvm_thread_monitor_release(bvm_obj_t *obj) {
 	if (obj == NULL)
 		bvm_throw_exception(BVM_ERR_NULL_POINTER_EXCEPTION, NULL);
 
+#if BVM_THIN_LOCK_ENABLE
+	{
+		bvm_native_ulong_t lockword = BVM_OBJECT_GetLockword(obj);
+
+		if ( (lockword & THREAD_LOCKWORD_INFLATED) == 0) {
+
+			/* not locked, or thin locked by another thread?  Whoops */
+			if ( (lockword == 0) || (THREAD_LOCKWORD_GetOwner(lockword) != bvm_gl_thread_current->lock_id) )
+				bvm_throw_exception(BVM_ERR_ILLEGAL_MONITOR_STATE_EXCEPTION, NULL);
+
+			/* count down, unlocking at zero */
+			BVM_OBJECT_SetLockword(obj, (THREAD_LOCKWORD_GetCount(lockword) == 1) ? 0 : lockword - THREAD_LOCKWORD_COUNT_ONE);
+			return;
+		}
+	}
+#endif
+
 	monitor = get_monitor_for_obj(obj);
 
 	/* monitor is not owned by the current thread?  Whoops */
-	if (monitor->owner_thread != bvm_gl_thread_current)
+	if ( (monitor == NULL) || (monitor->owner_thread != bvm_gl_thread_current) )
 		bvm_throw_exception(BVM_ERR_ILLEGAL_MONITOR_STATE_EXCEPTION, NULL);
 
 	/* if by decreasing the depth we reach zero we either free the monitor if no one
@@ -1414,6 +3073,10 @@ void bvm_thread_monitor_release(bvm_obj_t *obj) {
 
 		promote_thread_in_lock_queue(monitor);
 
+#if BVM_THREAD_PRIORITY_INHERITANCE_ENABLE
+		thread_uninherit_level(bvm_gl_thread_current);
+#endif
+
 		cache_monitor_if_unused(monitor);
 	}
 }
@@ -1433,11 +3096,13 @@ void bvm_thread_notify(bvm_monitor_t *monitor, bvm_bool_t do_all) {
 
 	bvm_vmthread_t *vmthread;
 
+	BVM_PROFILER_CONTENTION_NOTIFY(monitor->owner_object);
+
 	while (monitor->wait_queue != NULL) {
 
 		/* take the first thread from the head of the queue */
 		vmthread = monitor->wait_queue;
-		monitor->wait_queue = vmthread->next_in_queue;
+		remove_thread_from_queue(&monitor->wait_queue, vmthread);
 
 		/* if the thread is not actually in a waiting state something must
 		 * have gone wrong */
@@ -1445,8 +3110,8 @@ void bvm_thread_notify(bvm_monitor_t *monitor, bvm_bool_t do_all) {
 			 ((vmthread->status & BVM_THREAD_STATUS_TIMED_WAITING) == 0) )
 			bvm_throw_exception(BVM_ERR_ILLEGAL_THREAD_STATE_EXCEPTION, NULL);
 
-		/* detach it from the waiting list - if it is not in the list - no effect */
-		remove_thread_from_list(&thread_callback_list, vmthread);
+		/* detach it from the timed callback heap - if it is not in the heap - no effect */
+		thread_timer_remove(vmthread);
 
 		/* remove waiting modifiers.  Leaves the status as BVM_THREAD_STATUS_BLOCKED.  May also be
 		 * BVM_THREAD_STATUS_DBG_SUSPENDED as well. */
@@ -1489,12 +3154,31 @@ void bvm_thread_interrupt(bvm_vmthread_t *vmthread) {
 			/* if the thread is waiting or sleeping, set its wake-up time to zero to make
 			 * it runnable again on the next thread switch */
 			BVM_INT64_setZero(vmthread->time_to_awake);
+
+			/* ... which makes it the earliest to wake */
+			if (vmthread->timer_index != 0)
+				thread_timer_sift_up(vmthread->timer_index - 1);
+#if BVM_SOCKETS_ENABLE
+			/* a thread parked on a socket with no timeout is given one at zero */
+			else if (vmthread->io_index != 0) {
+				vmthread->callback = thread_socket_timeout_callback;
+				thread_timer_add(vmthread);
+			}
+#endif
+#if BVM_THREAD_TASKS_ENABLE
+			/* a yielded thread is in no list - it is made runnable here */
+			else if (vmthread->is_yielded) {
+				vmthread->is_yielded = BVM_FALSE;
+				vmthread->status = BVM_THREAD_STATUS_BLOCKED;
+				thread_resume(vmthread);
+			}
+#endif
 		}
 
 		/* if the current thread is being interrupting itself, we'll cause a thread switch
 		 * so it exception gets thrown next time it becomes active. */
 		if (bvm_gl_thread_current == vmthread) {
-			bvm_gl_thread_timeslice_counter = 0;
+			BVM_THREAD_REQUEST_SWITCH();
 		}
 	}
 }
@@ -1529,6 +3213,11 @@ static void thread_establish_bootstrap() {
 	thread just runs 'main' */
 	bvm_thread_start(vmthread, BVM_FALSE);
 
+#if BVM_THREAD_ACCOUNTING_ENABLE
+	/* no thread has run before - the switch counts nothing to the boot thread */
+	bvm_gl_thread_run_start = bvm_pd_system_time_micros();
+#endif
+
 	/* and switch to it */
 	bvm_thread_switch();
 }
@@ -1580,7 +3269,24 @@ bvm_uint32_t bvm_thread_get_next_id() {
  * Performs initialisation for threading at VM startup
  */
 void bvm_init_threading() {
+
+	bvm_gl_thread_timers = bvm_heap_alloc(thread_timers_capacity * sizeof(bvm_vmthread_t *), BVM_ALLOC_TYPE_STATIC);
+
+#if BVM_SOCKETS_ENABLE
+	bvm_gl_thread_io_polls = bvm_heap_alloc(thread_io_capacity * sizeof(bvm_pd_socket_poll_t), BVM_ALLOC_TYPE_STATIC);
+	bvm_gl_thread_io_threads = bvm_heap_alloc(thread_io_capacity * sizeof(bvm_vmthread_t *), BVM_ALLOC_TYPE_STATIC);
+#endif
+
+#if BVM_THREAD_TASKS_ENABLE
+	thread_task_ended = bvm_heap_calloc(sizeof(bvm_vmthread_t), BVM_ALLOC_TYPE_STATIC);
+	thread_task_ended->status = BVM_THREAD_STATUS_TERMINATED;
+#endif
+
 	thread_establish_bootstrap();
+
+#if BVM_THREAD_TIMER_PREEMPTION_ENABLE
+	bvm_pd_system_timer_start(BVM_THREAD_TIMER_TICK, thread_timer_tick);
+#endif
 }
 
 /**
@@ -1593,6 +3299,49 @@ bvm_bool_t bvm_thread_is_alive(bvm_vmthread_t *vmthread) {
 			 ( (vmthread->status & BVM_THREAD_STATUS_TERMINATED) == 0) );
 }
 
+#if BVM_VM_SNAPSHOT_ENABLE
+
+/**
+ * Map what threading keeps in the heap besides the VM threads and their stacks for a VM snapshot being written.  See
+ * #bvm_snapshot_map_data.  The pooled stack segments and VM threads are data chunks, so only their links are mapped -
+ * a pooled VM thread is wiped when it is reused, all but its first stack segment.
+ */
+void bvm_thread_snapshot_map() {
+
+#if (BVM_THREAD_STACK_POOL_SIZE > 0)
+	bvm_stacksegment_t *stack;
+#endif
+#if BVM_THREAD_TASKS_ENABLE
+	bvm_vmthread_t *vmthread;
+#endif
+
+#if BVM_SOCKETS_ENABLE
+	/* the polls hold file descriptors */
+	bvm_snapshot_map_data(bvm_gl_thread_io_polls);
+#endif
+
+#if (BVM_THREAD_STACK_POOL_SIZE > 0)
+	for (stack = bvm_gl_thread_stack_pool; stack != NULL; stack = stack->next) {
+		bvm_snapshot_map_pointer(&stack->top);
+		bvm_snapshot_map_pointer(&stack->next);
+	}
+#endif
+
+#if BVM_THREAD_TASKS_ENABLE
+	/* all the stand-in for an ended task holds is its status */
+	bvm_snapshot_map_data(thread_task_ended);
+
+	for (vmthread = bvm_gl_thread_task_pool; vmthread != NULL; vmthread = vmthread->next_in_list) {
+		bvm_snapshot_map_pointer(&vmthread->next_in_list);
+		bvm_snapshot_map_pointer(&vmthread->stack_list);
+		bvm_snapshot_map_pointer(&vmthread->stack_list->top);
+		bvm_snapshot_map_pointer(&vmthread->stack_list->next);
+	}
+#endif
+}
+
+#endif
+
 /**
  * Copy the thread registers to the global registers
  *
@@ -1605,6 +3354,9 @@ void bvm_thread_load_registers(bvm_vmthread_t *vmthread) {
 	bvm_gl_rx_pc  	  = vmthread->rx_pc;
 	bvm_gl_rx_stack   = vmthread->rx_stack;
 	bvm_gl_rx_locals  = vmthread->rx_locals;
+#if BVM_DEBUGGER_ENABLE
+	bvm_gl_rx_depth   = vmthread->rx_depth;
+#endif
 
 	/* set the global class register... for quick access without having to dereference the method*/
 	bvm_gl_rx_clazz   = (bvm_gl_rx_method == NULL) ? NULL : bvm_gl_rx_method->clazz;
@@ -1623,6 +3375,9 @@ void bvm_thread_store_registers(bvm_vmthread_t *vmthread) {
 	vmthread->rx_pc 	= bvm_gl_rx_pc;
 	vmthread->rx_stack  = bvm_gl_rx_stack;
 	vmthread->rx_locals = bvm_gl_rx_locals;
+#if BVM_DEBUGGER_ENABLE
+	vmthread->rx_depth  = bvm_gl_rx_depth;
+#endif
 }
 
 /**
@@ -95,13 +95,37 @@
 /**
  * Storage for the base frame of the exception frame stack.
  */
-static bvm_exception_frame_t _throwable_scope_struct = { NULL, NULL, NULL };
+static BVM_VM_LOCAL bvm_exception_frame_t _throwable_scope_struct = { NULL, NULL, NULL };
+
+#if BVM_VM_INSTANCES_ENABLE
+
+/**
+ * Current top of the exceptions frame stack.  The address of a #BVM_VM_LOCAL is not a constant, so
+ * #bvm_init_exception_stack points this at the base frame when the VM starts.
+ */
+BVM_VM_LOCAL bvm_exception_frame_t *bvm_gl_exception_stack = NULL;
+
+/**
+ * Point the exception frame stack at its base frame.  Called once as the VM starts.
+ */
+void bvm_init_exception_stack() {
+	bvm_gl_exception_stack = &_throwable_scope_struct;
+}
+
+#else
 
 /**
  * Current top of the exceptions frame stack
  */
 bvm_exception_frame_t *bvm_gl_exception_stack = &_throwable_scope_struct;
 
+#endif
+
+/* the VM exit state declared in trycatch.h */
+BVM_VM_LOCAL void* bvm_vm_exit_env;
+BVM_VM_LOCAL int bvm_gl_vm_exit_code;
+BVM_VM_LOCAL char *bvm_gl_vm_exit_msg;
+
 /**
  * Create an exception object of the given class.  The pointer to the message char array is not held.  A String
  * object is created from it (meaning the data is copied as UTF into the new String).
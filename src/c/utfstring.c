@@ -23,11 +23,106 @@
 
   UTFString handling functions
 
+  The UTF-8 decoding and the char search kernels work on a block of chars at a time - 16 bytes (8 chars) with SSE2
+  or NEON (see #BVM_STRING_SIMD_ENABLE), or a machine word otherwise.  A block is only tested - any block that
+  needs more than that (a match, or a byte that is not ASCII) is done a char at a time.
+
   @author Greg McCreath
   @since 0.0.10
 
 */
 
+#if BVM_STRING_SIMD_ENABLE
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define UTF_SSE2 1
+#else
+#include <arm_neon.h>
+#define UTF_NEON 1
+#endif
+#endif
+
+/** A machine word with 0x0001 in each 16 bit lane */
+#define UTF_WORD_ONES16		( (size_t) -1 / 0xFFFF)
+
+/** A machine word with the high bit of each 16 bit lane set */
+#define UTF_WORD_HIGHS16	(UTF_WORD_ONES16 << 15)
+
+/** A machine word with the high bit of each byte set */
+#define UTF_WORD_HIGHS8		( ( (size_t) -1 / 0xFF) << 7)
+
+/** The number of jchars in a machine word */
+#define UTF_WORD_JCHARS		( (bvm_int32_t) (sizeof(size_t) / 2) )
+
+/** Does a machine word of jchars (xor'ed with the char looked for) have a zero 16 bit lane? */
+#define UTF_WORD_HAS_ZERO16(w)	( ( ( (w) - UTF_WORD_ONES16) & ~(w) & UTF_WORD_HIGHS16) != 0 )
+
+/**
+ * Does a block of jchars have a given char in it?
+ *
+ * @param chars the start of the block of 8 chars (SIMD), or a machine word of chars
+ * @param ch the char looked for
+ */
+static bvm_bool_t utf_block_has_jchar(const bvm_uint16_t *chars, bvm_uint16_t ch) {
+#if UTF_SSE2
+	__m128i eq = _mm_cmpeq_epi16(_mm_loadu_si128( (const __m128i *) chars), _mm_set1_epi16( (short) ch));
+	return (_mm_movemask_epi8(eq) != 0);
+#elif UTF_NEON
+	uint64x2_t eq = vreinterpretq_u64_u16(vceqq_u16(vld1q_u16(chars), vdupq_n_u16(ch)));
+	return ( (vgetq_lane_u64(eq, 0) | vgetq_lane_u64(eq, 1)) != 0);
+#else
+	size_t w;
+	memcpy(&w, chars, sizeof(size_t));
+	w ^= UTF_WORD_ONES16 * ch;
+	return UTF_WORD_HAS_ZERO16(w);
+#endif
+}
+
+/** The number of jchars in a block tested by #utf_block_has_jchar */
+#if (UTF_SSE2 || UTF_NEON)
+#define UTF_BLOCK_JCHARS	8
+#else
+#define UTF_BLOCK_JCHARS	UTF_WORD_JCHARS
+#endif
+
+/**
+ * Widen a block of ASCII bytes to jchars - if they are all ASCII.
+ *
+ * @param bytes the bytes - 16 (SIMD) or a machine word of them
+ * @param chars the chars to write to
+ *
+ * @return #BVM_TRUE if the bytes were all ASCII and were widened, #BVM_FALSE if not (and nothing was written)
+ */
+static bvm_bool_t utf_widen_ascii_block(const bvm_uint8_t *bytes, bvm_uint16_t *chars) {
+#if UTF_SSE2
+	__m128i v = _mm_loadu_si128( (const __m128i *) bytes);
+	if (_mm_movemask_epi8(v) != 0) return BVM_FALSE;
+	_mm_storeu_si128( (__m128i *) chars, _mm_unpacklo_epi8(v, _mm_setzero_si128()));
+	_mm_storeu_si128( (__m128i *) (chars + 8), _mm_unpackhi_epi8(v, _mm_setzero_si128()));
+	return BVM_TRUE;
+#elif UTF_NEON
+	uint8x16_t v = vld1q_u8(bytes);
+	uint64x2_t high = vreinterpretq_u64_u8(vandq_u8(v, vdupq_n_u8(0x80)));
+	if ( (vgetq_lane_u64(high, 0) | vgetq_lane_u64(high, 1)) != 0) return BVM_FALSE;
+	vst1q_u16(chars, vmovl_u8(vget_low_u8(v)));
+	vst1q_u16(chars + 8, vmovl_u8(vget_high_u8(v)));
+	return BVM_TRUE;
+#else
+	size_t w, i;
+	memcpy(&w, bytes, sizeof(size_t));
+	if ( (w & UTF_WORD_HIGHS8) != 0) return BVM_FALSE;
+	for (i = 0; i < sizeof(size_t); i++) chars[i] = bytes[i];
+	return BVM_TRUE;
+#endif
+}
+
+/** The number of bytes in a block widened by #utf_widen_ascii_block */
+#if (UTF_SSE2 || UTF_NEON)
+#define UTF_BLOCK_BYTES		16
+#else
+#define UTF_BLOCK_BYTES		sizeof(size_t)
+#endif
+
 /**
  * Replace a given char in a c string with another char.
  *
@@ -100,6 +195,7 @@ bvm_utfstring_t *bvm_str_new_utfstring(size_t length, int alloc_type) {
 
 	bvm_utfstring_t *str = bvm_heap_alloc(sizeof(bvm_utfstring_t) + length + 1,  alloc_type);
 	str->length = length;
+	str->hash = 0;
 	str->data = ( (bvm_uint8_t *) str) + sizeof(bvm_utfstring_t);
 	str->next = NULL;
 
@@ -189,7 +285,20 @@ bvm_uint32_t bvm_str_unicode_length_from_utf8(bvm_uint8_t *utf8, bvm_uint32_t of
 
 	for (i = 0; i < len; i++, count++) {
 
-		bvm_uint8_t ch = utf8[i];
+		bvm_uint8_t ch;
+
+		/* skip over whole words of ASCII */
+		while (i + sizeof(size_t) <= len) {
+			size_t w;
+			memcpy(&w, utf8 + i, sizeof(size_t));
+			if ( (w & UTF_WORD_HIGHS8) != 0) break;
+			i += sizeof(size_t);
+			count += sizeof(size_t);
+		}
+
+		if (i == len) break;
+
+		ch = utf8[i];
 
 		/* one byte char */
 		if ((ch & 0x80) == 0)
@@ -263,7 +372,17 @@ void bvm_str_decode_utf8_to_unicode(bvm_uint8_t *bytes, bvm_uint32_t offset, bvm
 
 	for (i = 0; i < len; i++, count++) {
 
-		bvm_uint8_t ch = bytes[i];
+		bvm_uint8_t ch;
+
+		/* widen whole blocks of ASCII */
+		while ( (i + UTF_BLOCK_BYTES <= len) && utf_widen_ascii_block(bytes + i, chars + count) ) {
+			i += UTF_BLOCK_BYTES;
+			count += UTF_BLOCK_BYTES;
+		}
+
+		if (i == len) break;
+
+		ch = bytes[i];
 
 		/* if char is single byte */
 		if ((ch & 0x80) == 0)
@@ -283,6 +402,53 @@ void bvm_str_decode_utf8_to_unicode(bvm_uint8_t *bytes, bvm_uint32_t offset, bvm
 	}
 }
 
+/**
+ * Find the first of a given char in an array of jchars.
+ *
+ * @param chars the chars to search
+ * @param len the number of chars to search
+ * @param ch the char to look for
+ *
+ * @return the index of the first \c ch in \c chars, or -1 if there is none
+ */
+bvm_int32_t bvm_str_jchar_index_of(const bvm_uint16_t *chars, bvm_int32_t len, bvm_uint16_t ch) {
+
+	bvm_int32_t i = 0;
+
+	/* pass over whole blocks that do not have the char - the block that does is searched below */
+	while ( (i + UTF_BLOCK_JCHARS <= len) && !utf_block_has_jchar(chars + i, ch) )
+		i += UTF_BLOCK_JCHARS;
+
+	for (; i < len; i++) {
+		if (chars[i] == ch) return i;
+	}
+
+	return -1;
+}
+
+/**
+ * Find the last of a given char in an array of jchars.
+ *
+ * @param chars the chars to search
+ * @param len the number of chars to search - the search starts at <code>chars[len-1]</code>
+ * @param ch the char to look for
+ *
+ * @return the index of the last \c ch in \c chars, or -1 if there is none
+ */
+bvm_int32_t bvm_str_jchar_last_index_of(const bvm_uint16_t *chars, bvm_int32_t len, bvm_uint16_t ch) {
+
+	bvm_int32_t i = len;
+
+	while ( (i >= UTF_BLOCK_JCHARS) && !utf_block_has_jchar(chars + i - UTF_BLOCK_JCHARS, ch) )
+		i -= UTF_BLOCK_JCHARS;
+
+	while (i--) {
+		if (chars[i] == ch) return i;
+	}
+
+	return -1;
+}
+
 /**
  * Given a char buffer, wrap it in an #bvm_utfstring_t and return it.  No heap allocation takes place -
  * the string is on the stack and does not need to be freed.
@@ -295,6 +461,7 @@ void bvm_str_decode_utf8_to_unicode(bvm_uint8_t *bytes, bvm_uint32_t offset, bvm
 bvm_utfstring_t bvm_str_wrap_utfstring(char *data) {
 	bvm_utfstring_t str;
 	str.length = strlen(data);
+	str.hash = 0;
 	str.data = (bvm_uint8_t *) data;
 	return str;
 }
@@ -93,14 +93,16 @@
 
   Some noteable Limitations:
 
-  @li 16mb heap limit max.  The memory allocator uses 24 bits to express the size of a memory chunk.  Each memory chunk
+  @li 16mb heap limit max on 32 bit builds.  The memory allocator uses 24 bits to express the size of a memory chunk.  Each memory chunk
   has a single 32bit header of which 24bits represent the size of the memory chunk.  Given the target
-  environment, it is rare that this VM will have 16m allocated to it.
+  environment, it is rare that this VM will have 16m allocated to it.  64 bit builds use a wide chunk header by default and are
+  limited to a 4gb heap (see #BVM_HEAP_WIDE_HEADER_ENABLE).
   @li class loaders are not responsible for reading class file bytes.  They serve primarily as
   a namespace for loaded classes and thus 'application' separation.  All class file reading is performed by the VM.
   @li class loading is restricted to files that can be found either on the class path or are contained within a jar
   file on the class path.  Jar files must end with a lowercase ".jar".
-  @li the heap does not grow or shrink - the heap size is declared on startup and its size remains constant.
+  @li the heap only grows if allowed to using \c -heapmax - by default the heap size is declared on startup and its size
+  remains constant.
 
   @section requirements Requirements
 
@@ -136,7 +138,8 @@
   @subsection vm-intro-memory Memory management.
 
   The VM performs all its own memory management, including garbage collection.  At startup, the VM heap is allocated from
-  the OS and it is never expanded nor shrunk during execution.  The memory allocator (found in heap.c) is meant for
+  the OS as a single region.  If permitted by \c -heapmax, the heap grows by further regions when a GC recovers too little
+  (see \c -heapgrow) and gives back regions that become entirely free.  The memory allocator (found in heap.c) is meant for
   managing a small linear address space.  It assumes that issues such as locality-of-reference or paging are not actually
   present (as is often the case in smaller platforms).
 
@@ -148,9 +151,10 @@
   internal 'C' memory usage and Java memory usage is unified. The memory used by the VM is garbage collected in the same
   way the memory the Java programs it runs is.  In this sense, the VM memory usage is "unified".
 
-  The VM allocator imposes a 16mb heap maximum.  This is to cut down on the overhead associated with tracking memory
-  allocations, including Java objects.  The heap allocator has an overhead of 4 bytes per memory allocation, and 24 of
-  those 32 bits is used to specify the size of an allocation.  2^24 is 16mb.
+  The VM allocator imposes a 16mb heap maximum when using its compact chunk header.  This is to cut down on the overhead associated with
+  tracking memory allocations, including Java objects.  The heap allocator has an overhead of 4 bytes per memory allocation, and 24 of
+  those 32 bits is used to specify the size of an allocation.  2^24 is 16mb.  On 64 bit hosts a \c size_t wide header is used
+  instead by default (the 8 byte chunk alignment means it costs no more) and the heap may be up to 4gb.
 
   @subsection vm-intro-bvm_gc Garbage Collection.
 
@@ -170,7 +174,9 @@
   it are no longer considered as 'roots' and are eligible for GC.  Thus, the size of the transient stack grows and shrinks as
   these transient blocks are entered and exited.
 
-  WeakReference objects are supported as per the CLDC 1.1 specification.
+  WeakReference objects are supported as per the CLDC 1.1 specification.  SoftReference objects are also supported - they
+  are cleared, least recently used first, only when the heap would otherwise be exhausted.  And \c java.lang.ref.Ephemeron
+  objects keep a value only for as long as their key is reachable other than through them.
 
   The size of the permanent and transient stacks can be set at VM startup.
 
@@ -243,6 +249,22 @@
   required. That is, if additional stack space is needed it will be allocated it from the shared heap and, when no longer required,
   given back to the heap. A thread call stack is a linked list of stack 'segments'.
 
+  @subsection vm-intro-instances VM Instances
+
+  The interpreter registers, the heap, the threads and the pools are all globals.  Normally that means one VM per process.
+  With #BVM_VM_INSTANCES_ENABLE every piece of mutable VM state is declared #BVM_VM_LOCAL and lives in OS thread-local
+  storage instead, so an embedder may call #bvm_main from several OS threads at once and each runs a VM entirely
+  isolated from the others - its own heap, classes, Java threads and debugger session.  No VM code passes a context
+  around, so there is nothing to change in the VM itself - but anything new that holds VM state in a global or static
+  variable must be declared #BVM_VM_LOCAL along with the rest (constant tables need not be).
+
+  With #BVM_VM_ISOLATES_ENABLE Java code may itself start such VMs - isolates - on OS threads of their own.  This is
+  how the VM uses more than one core.  The Java threads of any one VM are still green threads scheduled on its one OS
+  thread: running them M:N across OS threads would need every allocation, pool, class load and GC path made
+  thread-safe, safepoints, and atomic monitors - a different VM.  Work that is to run in parallel is split across
+  isolates instead, which share nothing.  An isolate is a VM like any other, except that a command line option that
+  would end the process ends only the isolate.
+
   @subsection vm-intro-pool Pooling Resources
 
   A number of 'pools' exist within the VM.  A pool is actually a cache in the form of a hash map structure.  There is no generic hash
@@ -375,56 +397,59 @@ const char *BVM_VM_COPYRIGHT = "Copyright 2022 Montera Pty Ltd.";
 
 /** Handle to the command line boot classpath with default. */
 #if BVM_PLATFORM_FILE_SEPARATOR == '/'
-char *bvm_gl_boot_classpath = "./rt.jar:../lib/rt.jar";
+BVM_VM_LOCAL char *bvm_gl_boot_classpath = "./rt.jar:../lib/rt.jar";
 #else
-char *bvm_gl_boot_classpath = ".\\rt.jar;..\\lib\\rt.jar";
+BVM_VM_LOCAL char *bvm_gl_boot_classpath = ".\\rt.jar;..\\lib\\rt.jar";
 #endif
 
 /** Handle to the command line user classpath.  Default is the current directory as represented by ".". */
-char *bvm_gl_user_classpath = ".";
+BVM_VM_LOCAL char *bvm_gl_user_classpath = ".";
 
 /** An array used to hold the segments of the command line boot classpath (as delimited by
  * a #BVM_PLATFORM_PATH_SEPARATOR character). The length is #BVM_MAX_CLASSPATH_SEGMENTS. Populated during VM initialisation.
  * If less than \c BVM_MAX_CLASSPATH_SEGMENTS elements are in the array, the final element will be \c NULL - this can be used
  * when traversing to identify the end of the segments list. */
-char *bvm_gl_boot_classpath_segments[BVM_MAX_CLASSPATH_SEGMENTS];
+BVM_VM_LOCAL char *bvm_gl_boot_classpath_segments[BVM_MAX_CLASSPATH_SEGMENTS];
 
 /** An array used to hold the segments of the command line user classpath (as delimited by
  * a #BVM_PLATFORM_PATH_SEPARATOR character). The length is #BVM_MAX_CLASSPATH_SEGMENTS. Populated during VM initialisation.  If less
  * than \c BVM_MAX_CLASSPATH_SEGMENTS elements are in the array, the final element will be \c NULL - this can be used
  * when traversing to identify the end of the segments list. */
-char *bvm_gl_user_classpath_segments[BVM_MAX_CLASSPATH_SEGMENTS];
+BVM_VM_LOCAL char *bvm_gl_user_classpath_segments[BVM_MAX_CLASSPATH_SEGMENTS];
 
 /**
  * Home file path of the VM - may be \c NULL (the default).  If not \c NULL, all file opening performed by the VM, including
  * the java.io.File class, will have this home path prepended to it before a file open is attempted.  Effectively,
  * this provides a mean of giving the VM a 'root' directory.
  */
-char *bvm_gl_home_path = NULL;
+BVM_VM_LOCAL char *bvm_gl_home_path = NULL;
 
 /**
  * Reports if the VM has finished initialising.  Will be #BVM_TRUE only when the VM has completed startup
  * and initialisation.
  */
-bvm_bool_t bvm_gl_vm_is_initialised = BVM_FALSE;
+BVM_VM_LOCAL bvm_bool_t bvm_gl_vm_is_initialised = BVM_FALSE;
 
-bvm_method_t *BVM_METHOD_NOOP =  NULL;
-bvm_method_t *BVM_METHOD_NOOP_RET  =  NULL;
-bvm_method_t *BVM_METHOD_CALLBACKWEDGE = NULL;
+BVM_VM_LOCAL bvm_method_t *BVM_METHOD_NOOP =  NULL;
+BVM_VM_LOCAL bvm_method_t *BVM_METHOD_NOOP_RET  =  NULL;
+BVM_VM_LOCAL bvm_method_t *BVM_METHOD_CALLBACKWEDGE = NULL;
+#if BVM_SCOPED_MEMORY_ENABLE
+BVM_VM_LOCAL bvm_method_t *BVM_METHOD_DOINIT = NULL;
+#endif
 
 /**
  * Default stack size in cells.  Defaults to #BVM_THREAD_STACK_HEIGHT.
  */
-bvm_uint32_t bvm_gl_stack_height = BVM_THREAD_STACK_HEIGHT;
+BVM_VM_LOCAL bvm_uint32_t bvm_gl_stack_height = BVM_THREAD_STACK_HEIGHT;
 
 /**
  * Determines if java language assertions are enabled.  If #BVM_ASSERTIONS_ENABLE is defined, defaults
  * to #BVM_TRUE.  Can be set on command line by using \c -ea.
  */
 #if BVM_ASSERTIONS_ENABLE
-bvm_bool_t bvm_gl_assertions_enabled = BVM_TRUE;
+BVM_VM_LOCAL bvm_bool_t bvm_gl_assertions_enabled = BVM_TRUE;
 #else
-bvm_bool_t bvm_gl_assertions_enabled = BVM_FALSE;
+BVM_VM_LOCAL bvm_bool_t bvm_gl_assertions_enabled = BVM_FALSE;
 #endif
 
 /*
@@ -446,6 +471,7 @@ const char *BVM_ERR_ILLEGAL_ACCESS_ERROR 					= "java/lang/IllegalAccessError";
 const char *BVM_ERR_ILLEGAL_THREAD_STATE_EXCEPTION      	= "java/lang/IllegalThreadStateException";
 const char *BVM_ERR_ILLEGAL_MONITOR_STATE_EXCEPTION     	= "java/lang/IllegalMonitorStateException";
 const char *BVM_ERR_ILLEGAL_ARGUMENT_EXCEPTION          	= "java/lang/IllegalArgumentException";
+const char *BVM_ERR_ILLEGAL_STATE_EXCEPTION          		= "java/lang/IllegalStateException";
 const char *BVM_ERR_INTERRUPTED_EXCEPTION               	= "java/lang/InterruptedException";
 const char *BVM_ERR_INCOMPATIBLE_CLASS_CHANGE_ERROR 		= "java/lang/IncompatibleClassChangeError";
 const char *BVM_ERR_INDEX_OUT_OF_BOUNDS_EXCEPTION 			= "java/lang/IndexOutOfBoundsException";
@@ -458,6 +484,7 @@ const char *BVM_ERR_NO_CLASS_DEF_FOUND_ERROR 				= "java/lang/NoClassDefFoundErr
 const char *BVM_ERR_NO_SUCH_FIELD_ERROR 					= "java/lang/NoSuchFieldError";
 const char *BVM_ERR_NO_SUCH_METHOD_ERROR 					= "java/lang/NoSuchMethodError";
 const char *BVM_ERR_NULL_POINTER_EXCEPTION 					= "java/lang/NullPointerException";
+const char *BVM_ERR_NUMBER_FORMAT_EXCEPTION 				= "java/lang/NumberFormatException";
 const char *BVM_ERR_UNSATISFIED_LINK_ERROR 					= "java/lang/UnsatisfiedLinkError";
 const char *BVM_ERR_OUT_OF_MEMORY_ERROR 					= "java/lang/OutOfMemoryError";
 const char *BVM_ERR_VIRTUAL_MACHINE_ERROR 					= "java/lang/VirtualMachineError";
@@ -466,13 +493,16 @@ const char *BVM_ERR_STACK_OVERFLOW_ERROR 					= "java/lang/StackOverflowError";
 const char *BVM_ERR_UNSUPPORTED_OPERATION_EXCEPTION 		= "java/lang/UnsupportedOperationException";
 const char *BVM_ERR_IO_EXCEPTION 							= "java/io/IOException";
 const char *BVM_ERR_FILE_NOT_FOUND_EXCEPTION 				= "java/io/FileNotFoundException";
+const char *BVM_ERR_BUFFER_OVERFLOW_EXCEPTION 				= "java/nio/BufferOverflowException";
+const char *BVM_ERR_BUFFER_UNDERFLOW_EXCEPTION 			= "java/nio/BufferUnderflowException";
+const char *BVM_ERR_READ_ONLY_BUFFER_EXCEPTION 			= "java/nio/ReadOnlyBufferException";
 
 /* The count of the number of system properties in the command line. */
-static int cmdline_nr_system_properties = 0;
+static BVM_VM_LOCAL int cmdline_nr_system_properties = 0;
 
 /* An array of pointers to the command line system properties. This will only get a value if there
  * are actually system properties */
-static char **cmdline_system_properties = NULL;
+static BVM_VM_LOCAL char **cmdline_system_properties = NULL;
 
 #if BVM_CONSOLE_ENABLE
 
@@ -585,8 +615,8 @@ static void vm_init_bootstrap_clazzes() {
 
 	{
 		bvm_gl_type_array_info[0].element_size          = 0;				/* unused */
-		bvm_gl_type_array_info[BVM_T_OBJECT].element_size   = sizeof(bvm_obj_t *);
-		bvm_gl_type_array_info[BVM_T_ARRAY].element_size 	= sizeof(bvm_obj_t *);
+		bvm_gl_type_array_info[BVM_T_OBJECT].element_size   = sizeof(bvm_ref_t);
+		bvm_gl_type_array_info[BVM_T_ARRAY].element_size 	= sizeof(bvm_ref_t);
 		bvm_gl_type_array_info[3].element_size 		    = 0;				/* unused */
 		bvm_gl_type_array_info[BVM_T_BOOLEAN].element_size  = sizeof(bvm_uint8_t);
 		bvm_gl_type_array_info[BVM_T_CHAR].element_size 	= sizeof(bvm_uint16_t);
@@ -662,6 +692,13 @@ static void vm_init_bootstrap_clazzes() {
 			                         			       bvm_utfstring_pool_get_c("(Ljava/lang/Object;Ljava/lang/Object;Ljava/lang/Object;)V", BVM_TRUE),
 			                         			       BVM_METHOD_SEARCH_CLAZZ);
 
+#if BVM_SCOPED_MEMORY_ENABLE
+	/* the end of a clazz initialisation started in a scope is found by the pop of its frame - see #bvm_scope_suspend */
+	BVM_METHOD_DOINIT = bvm_clazz_method_get(BVM_CLASS_CLAZZ, bvm_utfstring_pool_get_c("__doInit", BVM_TRUE),
+			                         		 bvm_utfstring_pool_get_c("()V", BVM_TRUE),
+			                         		 BVM_METHOD_SEARCH_CLAZZ);
+#endif
+
 	/* preload the ClassLoader class */
 	BVM_CLASSLOADER_CLAZZ = (bvm_instance_clazz_t *) bvm_clazz_get_c(BVM_BOOTSTRAP_CLASSLOADER_OBJ, "java/lang/ClassLoader");
 
@@ -723,7 +760,7 @@ static void vm_init_bootstrap_objects() {
 			char *segment;
 			if ( (segment = bvm_gl_user_classpath_segments[i]) == NULL) break;
 			tempstr = bvm_str_wrap_utfstring(segment);
-			patharray->data[i] = (bvm_obj_t *) bvm_string_create_from_utfstring(&tempstr, BVM_FALSE);
+			patharray->data[i] = BVM_REF_Encode((bvm_obj_t *) bvm_string_create_from_utfstring(&tempstr, BVM_FALSE));
 		}
 
 		/* associate the path String[] with the system classloader */
@@ -750,8 +787,14 @@ static void vm_init_bootstrap_objects() {
 		pd->codesource = cs;
 
 		BVM_SYSTEM_CLASSLOADER_OBJ->protection_domain = pd;
+		BVM_GC_WRITE_BARRIER(BVM_SYSTEM_CLASSLOADER_OBJ, pd);
 
 	} BVM_END_TRANSIENT_BLOCK
+
+#if BVM_NATIVE_BOX_CACHE_ENABLE
+	/* the canonical boxes of small Integer and Character values */
+	bvm_native_box_cache_init();
+#endif
 	/* **************************************************************** */
 }
 
@@ -801,6 +844,14 @@ static void bvm_show_sizes() {
 	bvm_pd_console_out("size clazzconstant_t        : %d \n", sizeof(bvm_clazzconstant_t));
 	bvm_pd_console_out("size field_t                : %d \n", sizeof(bvm_field_t));
 	bvm_pd_console_out("size method_t               : %d \n", sizeof(bvm_method_t));
+#if BVM_CLAZZ_DISPATCH_TABLES_ENABLE
+	bvm_pd_console_out("size vtable slot            : %d \n", sizeof(bvm_method_t *));
+	bvm_pd_console_out("size itable_entry_t         : %d \n", sizeof(bvm_itable_entry_t));
+	bvm_pd_console_out("size itable method slot     : %d \n", sizeof(bvm_method_t *));
+#endif
+#if BVM_CLAZZ_TYPE_DISPLAYS_ENABLE
+	bvm_pd_console_out("size super display slot     : %d \n", sizeof(bvm_instance_clazz_t *));
+#endif
 	bvm_pd_console_out("size utfstring_t            : %d \n", sizeof(bvm_utfstring_t));
 	bvm_pd_console_out("size exception_t            : %d \n", sizeof(bvm_exception_t));
 	bvm_pd_console_out("size linenumber_t           : %d \n", sizeof(bvm_linenumber_t));
@@ -864,8 +915,12 @@ static void vm_parse_classpath(char *classpath, char *segments[]) {
 
 	}
 
-	/* ... and get the tail ... */
-	segments[pos++] = mark;
+	/* ... and get the tail - copied too, so no segment points into the command line ... */
+	size = (int) strlen(mark) + 1;
+	seg = bvm_heap_alloc(size, BVM_ALLOC_TYPE_STATIC);
+	memcpy(seg, mark, size);
+
+	segments[pos++] = seg;
 
 	/* set the last segment in the segment array to NULL so when traversing the array we know when
 	 * we have reached the end - no need to store the length anywhere then.*/
@@ -899,25 +954,75 @@ static void vm_init_classpaths() {
  *
  * This function is the kickstart for the entire VM initialisation processes.  All VM related memory pool
  * and arrays are created and assigned during execution of this function.
+ *
+ * With #BVM_VM_SNAPSHOT_ENABLE set, the VM is restored from a snapshot in place of all this if one is given and is
+ * good.  If a snapshot is asked for, the globals are marked here and it is written once the main class is initialised
+ * (see #bvm_snapshot_ready).  The command line the VM was given is recorded in a snapshot, and checked on restore.
+ *
+ * @param optc the number of command line options.
+ * @param optv the command line options.
+ * @param ac the number of arguments after the options - the startup class name and its arguments.
+ * @param av the arguments after the options.
+ *
+ * @return \c BVM_TRUE if the VM was restored from a snapshot - its main thread is then ready to run \c main.
  */
-static void vm_init() {
+static bvm_bool_t vm_init(int optc, char *optv[], int ac, char *av[]) {
+
+#if BVM_PROFILER_STARTUP_TRACE_ENABLE
+	bvm_uint32_t vm_mark, phase_mark;
+	BVM_PROFILER_STARTUP_MARK(vm_mark);
+	BVM_PROFILER_STARTUP_MARK(phase_mark);
+#endif
+
+#if BVM_VM_SNAPSHOT_ENABLE
+	/* a snapshot is everything below, already done */
+	if ( (bvm_gl_snapshot_filename != NULL) && bvm_snapshot_restore(bvm_gl_snapshot_filename, optc, optv, ac, av)) {
+#if BVM_SOCKETS_ENABLE
+		bvm_pd_socket_init();
+#endif
+#if BVM_METRICS_ENABLE
+		bvm_metrics_open();
+#endif
+		BVM_PROFILER_STARTUP_PHASE(vm_mark, "vm snapshot");
+		return BVM_TRUE;
+	}
+
+	/* the globals as they are before initialisation, so the snapshot knows which were changed */
+	if (bvm_gl_snapshot_write_filename != NULL) bvm_snapshot_mark(optc, optv, ac, av);
+#else
+	UNUSED(optc);
+	UNUSED(optv);
+	UNUSED(ac);
+	UNUSED(av);
+#endif
 
 	/* initialize the heap to a given size */
 	bvm_heap_init(bvm_gl_heap_size);
 
+	BVM_PROFILER_STARTUP_PHASE(phase_mark, "heap init");
+	BVM_PROFILER_STARTUP_MARK(phase_mark);
+
 	/* create an array used for the clazz pool */
-	bvm_gl_clazz_pool = bvm_heap_calloc(bvm_gl_clazz_pool_bucketcount * sizeof(bvm_clazz_t*), BVM_ALLOC_TYPE_STATIC);
+	bvm_gl_clazz_pool = bvm_heap_calloc(bvm_gl_clazz_pool_bucketcount * sizeof(bvm_clazz_t*), BVM_ALLOC_TYPE_METADATA);
 
 	/* create the array used for the utf string pool.  The string pool is an
 	 * array of bvm_utfstring_t pointers */
-	bvm_gl_utfstring_pool = bvm_heap_calloc(bvm_gl_utfstring_pool_bucketcount * sizeof(bvm_utfstring_t*), BVM_ALLOC_TYPE_STATIC);
+	bvm_gl_utfstring_pool = bvm_heap_calloc(bvm_gl_utfstring_pool_bucketcount * sizeof(bvm_utfstring_t*), BVM_ALLOC_TYPE_METADATA);
 
 	/* create the array used for the intern string pool.  The string pool is an
 	 * array of bvm_internstring_obj_t pointers */
 	bvm_gl_internstring_pool = bvm_heap_calloc(bvm_gl_internstring_pool_bucketcount * sizeof(bvm_internstring_obj_t*), BVM_ALLOC_TYPE_STATIC );
 
 	/* create space for the native method pool */
-	bvm_gl_native_method_pool = bvm_heap_calloc(bvm_gl_native_method_pool_bucketcount * sizeof(bvm_native_method_desc_t*), BVM_ALLOC_TYPE_STATIC );
+	bvm_gl_native_method_pool = bvm_heap_calloc(bvm_gl_native_method_pool_bucketcount * sizeof(bvm_native_method_desc_t*), BVM_ALLOC_TYPE_METADATA );
+
+#if BVM_POOL_RESIZE_ENABLE
+	/* the pools are all empty */
+	bvm_gl_clazz_pool_count = 0;
+	bvm_gl_utfstring_pool_count = 0;
+	bvm_gl_internstring_pool_count = 0;
+	bvm_gl_native_method_pool_count = 0;
+#endif
 
 	/* create space for the transient GC roots and init the top of the stack */
 	bvm_gl_gc_transient_roots = bvm_heap_calloc(bvm_gl_gc_transient_roots_depth * sizeof(bvm_cell_t), BVM_ALLOC_TYPE_STATIC );
@@ -927,30 +1032,88 @@ static void vm_init() {
 	bvm_gl_gc_permanent_roots = bvm_heap_calloc(bvm_gl_gc_permanent_roots_depth * sizeof(bvm_cell_t), BVM_ALLOC_TYPE_STATIC );
 	bvm_gl_gc_permanent_roots_top = 0;
 
+	BVM_PROFILER_STARTUP_PHASE(phase_mark, "pools and roots");
+	BVM_PROFILER_STARTUP_MARK(phase_mark);
+
 	/* do any initialisation required for the native part of the VM */
     bvm_init_native();
 
+#if BVM_AOT_ENABLE
+	/* register the methods translated ahead of time along with the natives, before any class is loaded */
+	bvm_aot_init();
+#endif
+
+	BVM_PROFILER_STARTUP_PHASE(phase_mark, "native init");
+	BVM_PROFILER_STARTUP_MARK(phase_mark);
+
 	/* Initialise the VM file handling facilities */
     bvm_init_io();
 
+#if BVM_PROFILER_PERF_ENABLE
+	/* describe the registers to native profilers, and open the perf map before anything can be compiled */
+	bvm_profiler_perf_init();
+#endif
+
 	/* initialise java classes and objects used by the VM */
     vm_init_classpaths();
 
+	BVM_PROFILER_STARTUP_PHASE(phase_mark, "io and classpaths");
+
+#if BVM_CLAZZ_IMAGE_ENABLE
+	BVM_PROFILER_STARTUP_MARK(phase_mark);
+
+    /* serve bootstrap classes from a class image if one is given */
+    if (bvm_gl_clazzimage_filename != NULL) bvm_clazzimage_load(bvm_gl_clazzimage_filename);
+
+	BVM_PROFILER_STARTUP_PHASE(phase_mark, "class image");
+#endif
+
+#if BVM_CLAZZ_PRELOAD_ENABLE
+	BVM_PROFILER_STARTUP_MARK(phase_mark);
+
+    /* read ahead the class files of a preload profile if one is given */
+    if (bvm_gl_preload_filename != NULL) bvm_preload_load(bvm_gl_preload_filename);
+
+	BVM_PROFILER_STARTUP_PHASE(phase_mark, "class preload");
+#endif
+
+	BVM_PROFILER_STARTUP_MARK(phase_mark);
+
     /* load a number of important or often-used classes at bootstrap and have 'em all ready */
     vm_init_bootstrap_clazzes();
 
+	BVM_PROFILER_STARTUP_PHASE(phase_mark, "bootstrap classes");
+	BVM_PROFILER_STARTUP_MARK(phase_mark);
+
     /* create a number of objects that are used by the startup process on the VM */
     vm_init_bootstrap_objects();
 
+	BVM_PROFILER_STARTUP_PHASE(phase_mark, "bootstrap objects");
+	BVM_PROFILER_STARTUP_MARK(phase_mark);
+
     /* init the VM thread and create the bootstrap thread */
     bvm_init_threading();
 
+#if BVM_EXEC_IMPLICIT_NULL_CHECKS_ENABLE
+	/* the quickened opcodes leave null references to fault */
+	bvm_exec_null_trap_start();
+#endif
+
 #if BVM_SOCKETS_ENABLE
 	bvm_pd_socket_init();
 #endif
 
+#if BVM_METRICS_ENABLE
+	bvm_metrics_open();
+#endif
+
+	BVM_PROFILER_STARTUP_PHASE(phase_mark, "threading");
+	BVM_PROFILER_STARTUP_PHASE(vm_mark, "vm init");
+
 	/* all good .  Finished .... */
 	bvm_gl_vm_is_initialised = BVM_TRUE;
+
+	return BVM_FALSE;
 }
 
 
@@ -958,7 +1121,61 @@ static void vm_init() {
  * Perform any finalisation necessary of the heap before VM exit.
  */
 static void bvm_finalise() {
+#if BVM_GC_CONCURRENT_SWEEP_ENABLE
+	/* the sweeper thread may still be in the heap */
+	bvm_gc_sweep_stop();
+#endif
 	bvm_heap_release();
+#if BVM_CLAZZ_IMAGE_ENABLE
+	bvm_clazzimage_release();
+#endif
+#if BVM_CLASSPATH_INDEX_ENABLE
+	bvm_classpath_release();
+#endif
+#if BVM_AOT_ENABLE
+	bvm_aot_release();
+#endif
+#if BVM_JIT_ENABLE
+	bvm_jit_release();
+#endif
+#if BVM_GC_STACK_MAPS_ENABLE
+	bvm_stackmap_release();
+#endif
+#if BVM_EXEC_REGISTER_IR_ENABLE
+	bvm_ir_release();
+#endif
+#if (BVM_OBJECT_IDENTITY_HASH_ENABLE && BVM_GC_COMPACTION_ENABLE)
+	bvm_object_hash_release();
+#endif
+}
+
+#if BVM_VM_ISOLATES_ENABLE
+
+/** Where a command line option that ends the VM jumps back to on an isolate's OS thread - see #vm_option_exit */
+static BVM_VM_LOCAL jmp_buf *vm_isolate_option_exit_env = NULL;
+
+/** The exit code of an isolate ended by a command line option */
+static BVM_VM_LOCAL int vm_isolate_option_exit_code = 0;
+
+#endif
+
+/**
+ * End the VM while its command line is parsed - for a bad option, or one that just asks for information.  The VM
+ * has not started, so there is nothing to shut down.  An isolate (see #bvm_vm_isolate_start) ends only itself - its
+ * OS thread gets the exit code.  Otherwise the process exits.
+ *
+ * @param code the exit code.
+ */
+static void vm_option_exit(int code) {
+
+#if BVM_VM_ISOLATES_ENABLE
+	if (vm_isolate_option_exit_env != NULL) {
+		vm_isolate_option_exit_code = code;
+		longjmp(*vm_isolate_option_exit_env, 1);
+	}
+#endif
+
+	bvm_pd_system_exit(code);
 }
 
 /**
@@ -986,7 +1203,7 @@ static long parse_mem(char *c) {
 		mem_size *= BVM_MB;
 		break;
 	default:
-        bvm_pd_system_exit(1);
+        vm_option_exit(1);
 	}
 
 	return mem_size;
@@ -1006,7 +1223,7 @@ static long parse_num(char *c) {
 	case '\0':
 		break;
 	default:
-        bvm_pd_system_exit(1);
+        vm_option_exit(1);
 	}
 
 	return num;
@@ -1027,6 +1244,70 @@ void bvm_show_usage() {
 	bvm_pd_console_out("\t-Xbootclasspath \t<search path> search path for boot classes and jars.\n");
 	bvm_pd_console_out("\t-home \t<path> 'root' path for relative path resolution.\n");
 	bvm_pd_console_out("\t-heap \t<xxx> the heap size (or xxxM, or xxxK).\n");
+	bvm_pd_console_out("\t-heapmax <xxx> the size the heap may grow to (or xxxM, or xxxK).\n");
+	bvm_pd_console_out("\t-heapgrow <xxx> grow the heap if less than xxx percent is free after a GC.\n");
+#if BVM_HEAP_LARGE_OBJECT_ENABLE
+	bvm_pd_console_out("\t-largeobj <xxx> primitive arrays of xxx bytes or more get a region of their own.\n");
+#endif
+#if BVM_GC_INCREMENTAL_ENABLE
+	bvm_pd_console_out("\t-gcslice <xxx> the number of heap chunks marked at each thread switch.\n");
+#endif
+#if BVM_GC_PARALLEL_MARK_ENABLE
+	bvm_pd_console_out("\t-gcthreads <xxx> the number of threads that share the marking of a GC.\n");
+#endif
+#if BVM_GC_BUDGET_ENABLE
+	bvm_pd_console_out("\t-gcbudget <xxx> collect at a thread switch after xxx bytes are allocated (or xxxM, or xxxK).\n");
+	bvm_pd_console_out("\t-gcfree <xxx> collect at a thread switch if less than xxx percent of the heap is free.\n");
+#endif
+#if BVM_GC_IDLE_ENABLE
+	bvm_pd_console_out("\t-gcidle <xxx> collect when no thread is due to run for at least xxx milliseconds (0 for never).\n");
+#endif
+#if BVM_GC_STATS_ENABLE
+	bvm_pd_console_out("\t-verbose:gc \tLog each garbage collection.\n");
+#endif
+#if BVM_HEAP_DUMP_ENABLE
+	bvm_pd_console_out("\t-heapdump <file> write an HPROF heap dump to the file when out of memory.\n");
+#endif
+#if BVM_METRICS_ENABLE
+	bvm_pd_console_out("\t-metrics <port> serve runtime metrics in the Prometheus text format on the port.\n");
+#endif
+#if BVM_PROFILER_ENABLE
+	bvm_pd_console_out("\t-profile <file> sample the running threads and write the counts to the file at exit.\n");
+#endif
+#if BVM_PROFILER_METHOD_COUNTERS_ENABLE
+	bvm_pd_console_out("\t-methodcounts <file> write the per-method counts to the file at exit.\n");
+#endif
+#if BVM_PROFILER_OPCODE_HISTOGRAM_ENABLE
+	bvm_pd_console_out("\t-opcodes <file> write the opcode and opcode pair counts to the file at exit.\n");
+#endif
+#if BVM_PROFILER_ALLOCATION_SITES_ENABLE
+	bvm_pd_console_out("\t-allocsites <file> write the sampled allocation sites to the file at exit.\n");
+#endif
+#if BVM_PROFILER_MONITOR_CONTENTION_ENABLE
+	bvm_pd_console_out("\t-contention <file> write the monitor contention sites to the file at exit.\n");
+#endif
+#if BVM_PROFILER_STARTUP_TRACE_ENABLE
+	bvm_pd_console_out("\t-starttrace <file> write a trace of the VM startup phases, class loads and class initialisations to the file at exit.\n");
+#endif
+#if BVM_PROFILER_PERF_ENABLE
+	bvm_pd_console_out("\t-perfmap write the native code of compiled methods to /tmp/perf-<pid>.map for perf.\n");
+#endif
+#if BVM_CLAZZ_IMAGE_ENABLE
+	bvm_pd_console_out("\t-image <file> load bootstrap classes from the class image file.\n");
+	bvm_pd_console_out("\t-imagewrite <file> write the classes loaded by the bootstrap loader to a class image file at exit.\n");
+#endif
+#if BVM_CLAZZ_PRELOAD_ENABLE
+	bvm_pd_console_out("\t-preload <file> read ahead the class files listed in the preload profile file at startup.\n");
+	bvm_pd_console_out("\t-preloadwrite <file> write the class files read from jars to a preload profile file at exit.\n");
+#endif
+#if BVM_VM_SNAPSHOT_ENABLE
+	bvm_pd_console_out("\t-snapshot <file> restore the started VM from the snapshot file instead of initialising it.\n");
+	bvm_pd_console_out("\t-snapshotwrite <file> write a snapshot of the VM to the file once the main class is initialised, just before main runs.\n");
+#endif
+#if BVM_AOT_ENABLE
+	bvm_pd_console_out("\t-aotwrite <file> write the methods of the classes loaded translated to C to the file at exit.\n");
+	bvm_pd_console_out("\t-aotclasses <xxx> translate only classes whose names start with one of the comma separated prefixes.\n");
+#endif
 	bvm_pd_console_out("\t-stack \t<xxx> thread stack segment size in bytes (or xxxM, or xxxK).\n");
 	bvm_pd_console_out("\t-tr \t<xxx> The height of the transient root stack.\n");
 	bvm_pd_console_out("\t-sr \t<xxx> The height of the system root stack.\n");
@@ -1034,7 +1315,11 @@ void bvm_show_usage() {
 	bvm_pd_console_out("\t-utfb \t<xxx> The number of buckets for the intern utfstring hash pool.\n");
 	bvm_pd_console_out("\t-strb \t<xxx> The number of buckets for the intern String hash pool.\n");
 	bvm_pd_console_out("\t-clazzb <xxx> The number of buckets for the class hash pool.\n");
+	bvm_pd_console_out("\t-natb \t<xxx> The number of buckets for the native method hash pool.\n");
 	bvm_pd_console_out("\t-ea \tEnable assertions.\n");
+#if BVM_STACKTRACE_ENABLE
+	bvm_pd_console_out("\t-notrace <class> instances of the throwable class (and subclasses) record no stack trace.\n");
+#endif
 #if BVM_CONSOLE_ENABLE
 	bvm_pd_console_out("\t-version \tPrint version and exit.\n");
 	bvm_pd_console_out("\t-usage \tPrint this text and exit.\n");
@@ -1150,7 +1435,7 @@ static void parse_command_line(int *ac, char ***av) {
 #if BVM_CONSOLE_ENABLE
 		bvm_show_usage();
 #endif
-        bvm_pd_system_exit(0);
+        vm_option_exit(0);
 	}
 
 	while (argc > 0) {
@@ -1202,245 +1487,1119 @@ static void parse_command_line(int *ac, char ***av) {
 			argc-=2;
 		}
 
-		else if (strcmp(argv[0], "-stack") == 0) {
-			bvm_uint32_t mem = parse_mem(argv[1]);
+#if BVM_HEAP_LARGE_OBJECT_ENABLE
+		else if (strcmp(argv[0], "-largeobj") == 0) {
+			bvm_gl_heap_large_object_size = parse_mem(argv[1]);
 
 			echo_argument_value(argv[1]);
 
-			bvm_gl_stack_height = mem / sizeof(bvm_cell_t);
+			argv+=2;
+			argc-=2;
+		}
+#endif
 
-			/* Seems reasonable */
-			if (bvm_gl_stack_height < 128) {
-				bvm_gl_stack_height = 128;
-			}
+		else if (strcmp(argv[0], "-heapmax") == 0) {
+			bvm_gl_heap_limit = parse_mem(argv[1]);
 
-			/* pretty arbitrary really, just to stop bad params */
-			if (bvm_gl_stack_height > 16 * BVM_KB) {
-				bvm_gl_stack_height = 16 * BVM_KB;
+			echo_argument_value(argv[1]);
+
+			/* max */
+			if (bvm_gl_heap_limit > BVM_HEAP_MAX_SIZE) {
+				bvm_gl_heap_limit = BVM_HEAP_MAX_SIZE;
 			}
 
 			argv+=2;
 			argc-=2;
 		}
 
-		else if (strcmp(argv[0], "-tr") == 0) {
-			bvm_gl_gc_transient_roots_depth = parse_num(argv[1]);
+		else if (strcmp(argv[0], "-heapgrow") == 0) {
+			bvm_gl_heap_grow_percent = parse_num(argv[1]);
 
 			echo_argument_value(argv[1]);
 
-			/* Seems reasonable */
-			if (bvm_gl_gc_transient_roots_depth < 50) {
-				bvm_gl_gc_transient_roots_depth = 50;
-			}
-
-			/* pretty arbitrary really, just to stop bad params */
-			if (bvm_gl_gc_transient_roots_depth > 5000) {
-				bvm_gl_gc_transient_roots_depth = 5000;
+			/* it is a percentage */
+			if (bvm_gl_heap_grow_percent > 100) {
+				bvm_gl_heap_grow_percent = 100;
 			}
 
 			argv+=2;
 			argc-=2;
 		}
 
-		else if (strcmp(argv[0], "-sr") == 0) {
-			bvm_gl_gc_permanent_roots_depth = parse_num(argv[1]);
+#if BVM_GC_INCREMENTAL_ENABLE
+		else if (strcmp(argv[0], "-gcslice") == 0) {
+			bvm_gl_gc_slice_budget = parse_num(argv[1]);
 
 			echo_argument_value(argv[1]);
 
-			/* Must be large enough to hold all classes in java packages + a
-			 * few objects */
-			if (bvm_gl_gc_permanent_roots_depth < 100) {
-				bvm_gl_gc_permanent_roots_depth = 100;
-			}
-
-			/* pretty arbitrary really, just to stop bad params */
-			if (bvm_gl_gc_permanent_roots_depth > 500) {
-				bvm_gl_gc_permanent_roots_depth = 500;
+			/* must make some progress */
+			if (bvm_gl_gc_slice_budget < 1) {
+				bvm_gl_gc_slice_budget = 1;
 			}
 
 			argv+=2;
 			argc-=2;
 		}
+#endif
+
+#if BVM_GC_PARALLEL_MARK_ENABLE
+		else if (strcmp(argv[0], "-gcthreads") == 0) {
+			bvm_gl_gc_mark_threads = parse_num(argv[1]);
 
-		else if (strcmp(argv[0], "-files") == 0) {
-			bvm_gl_max_file_handles = parse_num(argv[1]);
 			echo_argument_value(argv[1]);
+
+			/* the VM thread always marks */
+			if (bvm_gl_gc_mark_threads < 1) {
+				bvm_gl_gc_mark_threads = 1;
+			}
+
 			argv+=2;
 			argc-=2;
 		}
+#endif
+
+#if BVM_GC_BUDGET_ENABLE
+		else if (strcmp(argv[0], "-gcbudget") == 0) {
+			bvm_gl_gc_alloc_budget = parse_mem(argv[1]);
 
-		else if (strcmp(argv[0], "-utfb") == 0) {
-			bvm_gl_utfstring_pool_bucketcount = parse_num(argv[1]);
 			echo_argument_value(argv[1]);
+
 			argv+=2;
 			argc-=2;
 		}
 
-		else if (strcmp(argv[0], "-strb") == 0) {
-			bvm_gl_internstring_pool_bucketcount = parse_num(argv[1]);
+		else if (strcmp(argv[0], "-gcfree") == 0) {
+			bvm_gl_gc_budget_free_percent = parse_num(argv[1]);
+
 			echo_argument_value(argv[1]);
+
+			/* it is a percentage */
+			if (bvm_gl_gc_budget_free_percent > 100) {
+				bvm_gl_gc_budget_free_percent = 100;
+			}
+
 			argv+=2;
 			argc-=2;
 		}
+#endif
+
+#if BVM_GC_IDLE_ENABLE
+		else if (strcmp(argv[0], "-gcidle") == 0) {
+			bvm_gl_gc_idle_min_time = parse_num(argv[1]);
 
-		else if (strcmp(argv[0], "-clazzb") == 0) {
-			bvm_gl_clazz_pool_bucketcount = parse_num(argv[1]);
 			echo_argument_value(argv[1]);
+
 			argv+=2;
 			argc-=2;
 		}
+#endif
 
-		else if (strcmp(argv[0], "-ea") == 0) {
-			bvm_gl_assertions_enabled = BVM_TRUE;
+#if BVM_GC_STATS_ENABLE
+		else if (strcmp(argv[0], "-verbose:gc") == 0) {
+			bvm_gl_gc_verbose = BVM_TRUE;
 			argv+=1;
 			argc-=1;
 		}
+#endif
 
-		else if (strncmp(argv[0], "-D", 2) == 0) {
-			/* for now, ignore system params - the System class will post process these
-			 * on VM startup. */
-			if (cmdline_nr_system_properties % 5 == 0) {
-				char **old_array = cmdline_system_properties;
-				int size = (cmdline_nr_system_properties + 5) * sizeof(char *);
-				cmdline_system_properties = bvm_pd_memory_alloc(size);
-				memset(cmdline_system_properties,0,size);
-
-				/* if the old array was not empty, copy its contents into the new one */
-				if (old_array != NULL) {
-					memcpy(cmdline_system_properties, old_array, cmdline_nr_system_properties * sizeof(char *) );
-				}
-			}
+#if BVM_HEAP_DUMP_ENABLE
+		else if (strcmp(argv[0], "-heapdump") == 0) {
+			bvm_gl_heapdump_on_oom_filename = argv[1];
 
-			cmdline_system_properties[cmdline_nr_system_properties++] = argv[0];
+			echo_argument_value(argv[1]);
 
-			argv+=1;
-			argc-=1;
+			argv+=2;
+			argc-=2;
 		}
+#endif
 
-#if BVM_CONSOLE_ENABLE
+#if BVM_METRICS_ENABLE
+		else if (strcmp(argv[0], "-metrics") == 0) {
+			bvm_gl_metrics_port = parse_num(argv[1]);
 
-		else if (strcmp(argv[0], "-version") == 0) {
-			bvm_show_version_and_copyright();
-            bvm_pd_system_exit(0);
+			echo_argument_value(argv[1]);
+
+			argv+=2;
+			argc-=2;
 		}
+#endif
 
-		else if (strcmp(argv[0], "-usage") == 0) {
-			bvm_show_usage();
-            bvm_pd_system_exit(0);
+#if BVM_PROFILER_ENABLE
+		else if (strcmp(argv[0], "-profile") == 0) {
+			bvm_gl_profiler_filename = argv[1];
+
+			echo_argument_value(argv[1]);
+
+			argv+=2;
+			argc-=2;
 		}
+#endif
 
-		else if (strcmp(argv[0], "-sizes") == 0) {
-            bvm_show_sizes();
-            bvm_pd_system_exit(0);
+#if BVM_PROFILER_METHOD_COUNTERS_ENABLE
+		else if (strcmp(argv[0], "-methodcounts") == 0) {
+			bvm_gl_profiler_method_counts_filename = argv[1];
+
+			echo_argument_value(argv[1]);
+
+			argv+=2;
+			argc-=2;
 		}
+#endif
+
+#if BVM_PROFILER_OPCODE_HISTOGRAM_ENABLE
+		else if (strcmp(argv[0], "-opcodes") == 0) {
+			bvm_gl_profiler_opcodes_filename = argv[1];
+
+			echo_argument_value(argv[1]);
 
+			argv+=2;
+			argc-=2;
+		}
 #endif
 
-#if BVM_DEBUGGER_ENABLE
+#if BVM_PROFILER_ALLOCATION_SITES_ENABLE
+		else if (strcmp(argv[0], "-allocsites") == 0) {
+			bvm_gl_profiler_allocsites_filename = argv[1];
 
-		else if (strcmp(argv[0], "-Xdebug") == 0) {
-			bvmd_gl_enabledebug = BVM_TRUE;
-			argv+=1;
-			argc-=1;
+			echo_argument_value(argv[1]);
+
+			argv+=2;
+			argc-=2;
 		}
+#endif
 
-		else if (strncmp(argv[0], "-Xrunjdwp:", 10) == 0) {
-			parse_runjdwp(argv[0]);
-			argv+=1;
-			argc-=1;
+#if BVM_PROFILER_MONITOR_CONTENTION_ENABLE
+		else if (strcmp(argv[0], "-contention") == 0) {
+			bvm_gl_profiler_contention_filename = argv[1];
+
+			echo_argument_value(argv[1]);
+
+			argv+=2;
+			argc-=2;
 		}
+#endif
 
+#if BVM_PROFILER_STARTUP_TRACE_ENABLE
+		else if (strcmp(argv[0], "-starttrace") == 0) {
+			bvm_gl_profiler_startup_filename = argv[1];
+
+			echo_argument_value(argv[1]);
+
+			argv+=2;
+			argc-=2;
+		}
 #endif
 
-		else if (strncmp(argv[0], "-X", 2) == 0) {
-			/* ignore all unknown -X arguments. */
+#if BVM_PROFILER_PERF_ENABLE
+		else if (strcmp(argv[0], "-perfmap") == 0) {
+			bvm_gl_profiler_perf_map_enabled = BVM_TRUE;
 			argv+=1;
 			argc-=1;
 		}
+#endif
 
-		else if (*(argv[0]) == '-') {
+#if BVM_CLAZZ_IMAGE_ENABLE
+		else if (strcmp(argv[0], "-image") == 0) {
+			bvm_gl_clazzimage_filename = argv[1];
 
-#if BVM_CONSOLE_ENABLE
-			bvm_pd_console_out("Invalid command line argument '%s'.", argv[0]);
-#endif
+			echo_argument_value(argv[1]);
 
-            bvm_pd_system_exit(500);
-		}
-		else {
-			break;
+			argv+=2;
+			argc-=2;
 		}
-	}
 
-	*ac = argc;
-	*av = argv;
-}
+		else if (strcmp(argv[0], "-imagewrite") == 0) {
+			bvm_gl_clazzimage_write_filename = argv[1];
 
-/**
- * Reads the command line system properties (those that begin with -D) into the first field on the runtime System
- * class ('_cmdLine').  The System class uses that to expose system properties as a Map.
- */
-static void set_system_class_properties() {
+			echo_argument_value(argv[1]);
+
+			argv+=2;
+			argc-=2;
+		}
+#endif
+
+#if BVM_CLAZZ_PRELOAD_ENABLE
+		else if (strcmp(argv[0], "-preload") == 0) {
+			bvm_gl_preload_filename = argv[1];
+
+			echo_argument_value(argv[1]);
+
+			argv+=2;
+			argc-=2;
+		}
+
+		else if (strcmp(argv[0], "-preloadwrite") == 0) {
+			bvm_gl_preload_write_filename = argv[1];
+
+			echo_argument_value(argv[1]);
+
+			argv+=2;
+			argc-=2;
+		}
+#endif
+
+#if BVM_VM_SNAPSHOT_ENABLE
+		else if (strcmp(argv[0], "-snapshot") == 0) {
+			bvm_gl_snapshot_filename = argv[1];
+
+			echo_argument_value(argv[1]);
+
+			argv+=2;
+			argc-=2;
+		}
+
+		else if (strcmp(argv[0], "-snapshotwrite") == 0) {
+			bvm_gl_snapshot_write_filename = argv[1];
+
+			echo_argument_value(argv[1]);
+
+			argv+=2;
+			argc-=2;
+		}
+#endif
+
+#if BVM_AOT_ENABLE
+		else if (strcmp(argv[0], "-aotwrite") == 0) {
+			bvm_gl_aot_write_filename = argv[1];
+
+			echo_argument_value(argv[1]);
+
+			argv+=2;
+			argc-=2;
+		}
+
+		else if (strcmp(argv[0], "-aotclasses") == 0) {
+			bvm_gl_aot_classes = argv[1];
+
+			echo_argument_value(argv[1]);
+
+			argv+=2;
+			argc-=2;
+		}
+#endif
+
+		else if (strcmp(argv[0], "-stack") == 0) {
+			bvm_uint32_t mem = parse_mem(argv[1]);
+
+			echo_argument_value(argv[1]);
+
+			bvm_gl_stack_height = mem / sizeof(bvm_cell_t);
+
+			/* Seems reasonable */
+			if (bvm_gl_stack_height < 128) {
+				bvm_gl_stack_height = 128;
+			}
+
+			/* pretty arbitrary really, just to stop bad params */
+			if (bvm_gl_stack_height > 16 * BVM_KB) {
+				bvm_gl_stack_height = 16 * BVM_KB;
+			}
+
+			argv+=2;
+			argc-=2;
+		}
+
+		else if (strcmp(argv[0], "-tr") == 0) {
+			bvm_gl_gc_transient_roots_depth = parse_num(argv[1]);
+
+			echo_argument_value(argv[1]);
+
+			/* Seems reasonable */
+			if (bvm_gl_gc_transient_roots_depth < 50) {
+				bvm_gl_gc_transient_roots_depth = 50;
+			}
+
+			/* pretty arbitrary really, just to stop bad params */
+			if (bvm_gl_gc_transient_roots_depth > 5000) {
+				bvm_gl_gc_transient_roots_depth = 5000;
+			}
+
+			argv+=2;
+			argc-=2;
+		}
+
+		else if (strcmp(argv[0], "-sr") == 0) {
+			bvm_gl_gc_permanent_roots_depth = parse_num(argv[1]);
+
+			echo_argument_value(argv[1]);
+
+			/* Must be large enough to hold all classes in java packages + a
+			 * few objects */
+			if (bvm_gl_gc_permanent_roots_depth < 100) {
+				bvm_gl_gc_permanent_roots_depth = 100;
+			}
+
+			/* pretty arbitrary really, just to stop bad params */
+			if (bvm_gl_gc_permanent_roots_depth > 500) {
+				bvm_gl_gc_permanent_roots_depth = 500;
+			}
+
+			argv+=2;
+			argc-=2;
+		}
+
+		else if (strcmp(argv[0], "-files") == 0) {
+			bvm_gl_max_file_handles = parse_num(argv[1]);
+			echo_argument_value(argv[1]);
+			argv+=2;
+			argc-=2;
+		}
+
+		else if (strcmp(argv[0], "-utfb") == 0) {
+			bvm_gl_utfstring_pool_bucketcount = parse_num(argv[1]);
+			echo_argument_value(argv[1]);
+			argv+=2;
+			argc-=2;
+		}
+
+		else if (strcmp(argv[0], "-strb") == 0) {
+			bvm_gl_internstring_pool_bucketcount = parse_num(argv[1]);
+			echo_argument_value(argv[1]);
+			argv+=2;
+			argc-=2;
+		}
+
+		else if (strcmp(argv[0], "-clazzb") == 0) {
+			bvm_gl_clazz_pool_bucketcount = parse_num(argv[1]);
+			echo_argument_value(argv[1]);
+			argv+=2;
+			argc-=2;
+		}
+
+		else if (strcmp(argv[0], "-natb") == 0) {
+			bvm_gl_native_method_pool_bucketcount = parse_num(argv[1]);
+			echo_argument_value(argv[1]);
+			argv+=2;
+			argc-=2;
+		}
+
+		else if (strcmp(argv[0], "-ea") == 0) {
+			bvm_gl_assertions_enabled = BVM_TRUE;
+			argv+=1;
+			argc-=1;
+		}
+
+#if BVM_STACKTRACE_ENABLE
+		else if (strcmp(argv[0], "-notrace") == 0) {
+			bvm_stacktrace_exclude_clazz(argv[1]);
+
+			echo_argument_value(argv[1]);
+
+			argv+=2;
+			argc-=2;
+		}
+#endif
+
+		else if (strncmp(argv[0], "-D", 2) == 0) {
+			/* for now, ignore system params - the System class will post process these
+			 * on VM startup. */
+			if (cmdline_nr_system_properties % 5 == 0) {
+				char **old_array = cmdline_system_properties;
+				int size = (cmdline_nr_system_properties + 5) * sizeof(char *);
+				cmdline_system_properties = bvm_pd_memory_alloc(size);
+				memset(cmdline_system_properties,0,size);
+
+				/* if the old array was not empty, copy its contents into the new one */
+				if (old_array != NULL) {
+					memcpy(cmdline_system_properties, old_array, cmdline_nr_system_properties * sizeof(char *) );
+				}
+			}
+
+			cmdline_system_properties[cmdline_nr_system_properties++] = argv[0];
+
+			argv+=1;
+			argc-=1;
+		}
+
+#if BVM_CONSOLE_ENABLE
+
+		else if (strcmp(argv[0], "-version") == 0) {
+			bvm_show_version_and_copyright();
+            vm_option_exit(0);
+		}
+
+		else if (strcmp(argv[0], "-usage") == 0) {
+			bvm_show_usage();
+            vm_option_exit(0);
+		}
+
+		else if (strcmp(argv[0], "-sizes") == 0) {
+            bvm_show_sizes();
+            vm_option_exit(0);
+		}
+
+#endif
+
+#if BVM_DEBUGGER_ENABLE
+
+		else if (strcmp(argv[0], "-Xdebug") == 0) {
+			bvmd_gl_enabledebug = BVM_TRUE;
+			argv+=1;
+			argc-=1;
+		}
+
+		else if (strncmp(argv[0], "-Xrunjdwp:", 10) == 0) {
+			parse_runjdwp(argv[0]);
+			argv+=1;
+			argc-=1;
+		}
+
+#endif
+
+		else if (strncmp(argv[0], "-X", 2) == 0) {
+			/* ignore all unknown -X arguments. */
+			argv+=1;
+			argc-=1;
+		}
+
+		else if (*(argv[0]) == '-') {
+
+#if BVM_CONSOLE_ENABLE
+			bvm_pd_console_out("Invalid command line argument '%s'.", argv[0]);
+#endif
+
+            vm_option_exit(500);
+		}
+		else {
+			break;
+		}
+	}
+
+	*ac = argc;
+	*av = argv;
+}
+
+/**
+ * Reads the command line system properties (those that begin with -D) into the first field on the runtime System
+ * class ('_cmdLine').  The System class uses that to expose system properties as a Map.
+ */
+static void set_system_class_properties() {
+
+	bvm_instance_clazz_t *clazz;
+	bvm_instance_array_obj_t *args_array_obj;
+	bvm_utfstring_t temp_utfstring;
+	int lc;
+
+	if (cmdline_nr_system_properties > 0) {
+
+		BVM_BEGIN_TRANSIENT_BLOCK {
+
+			/* Get the System clazz */
+			temp_utfstring = bvm_str_wrap_utfstring("java/lang/System");
+			clazz = (bvm_instance_clazz_t *) bvm_clazz_get( (bvm_classloader_obj_t *) BVM_SYSTEM_CLASSLOADER_OBJ, &temp_utfstring);
+
+			/* create an array of string objects to hold properties */
+			args_array_obj = bvm_object_alloc_array_reference(cmdline_nr_system_properties, (bvm_clazz_t *) BVM_STRING_CLAZZ);
+
+			/* make sure our new array does not disappear if any following allocations cause a GC */
+			BVM_MAKE_TRANSIENT_ROOT(args_array_obj);
+
+			/* set the first field '_cmdLine' of the System class to the new String object array - it will be
+			 * populated in the loop below. */
+			clazz->fields[0].value.static_value.ref_value = (bvm_obj_t *) args_array_obj;
+			BVM_GC_WRITE_BARRIER(clazz, args_array_obj);
+
+			/* for each System property set on the command line */
+			for (lc = cmdline_nr_system_properties; lc--;) {
+
+				/* get the command line system prop */
+				char *sysprop = cmdline_system_properties[lc] + 2;  /* the +2 moves past the '-D' */
+
+				/* create a String object from it and populate it into the String array */
+				temp_utfstring = bvm_str_wrap_utfstring(sysprop);
+				args_array_obj->data[lc] = BVM_REF_Encode((bvm_obj_t *) bvm_string_create_from_utfstring(&temp_utfstring, BVM_FALSE));
+			}
+
+		} BVM_END_TRANSIENT_BLOCK
+	}
+}
+
+/**
+ * Some sanity checking on the sizes of platform types.
+ */
+static void sanity_check_sizes() {
+    if (sizeof(bvm_int8_t) != 1) bvm_pd_system_exit(BVM_FATAL_ERR_INCORRECT_UINT8_SIZE);
+    if (sizeof(bvm_uint8_t) != 1) bvm_pd_system_exit(BVM_FATAL_ERR_INCORRECT_UINT8_SIZE);
+
+    if (sizeof(bvm_uint16_t) != 2) bvm_pd_system_exit(BVM_FATAL_ERR_INCORRECT_UINT16_SIZE);
+    if (sizeof(bvm_int16_t) != 2) bvm_pd_system_exit(BVM_FATAL_ERR_INCORRECT_INT16_SIZE);
+
+    if (sizeof(bvm_uint32_t) != 4) bvm_pd_system_exit(BVM_FATAL_ERR_INCORRECT_UINT32_SIZE);
+    if (sizeof(bvm_int32_t) != 4) bvm_pd_system_exit(BVM_FATAL_ERR_INCORRECT_INT32_SIZE);
+
+    if (sizeof(bvm_float_t) != 4) bvm_pd_system_exit(BVM_FATAL_ERR_INCORRECT_FLOAT_SIZE);
+    if (sizeof(bvm_double_t) != 8) bvm_pd_system_exit(BVM_FATAL_ERR_INCORRECT_DOUBLE_SIZE);
+
+    if (sizeof(bvm_native_long_t) != sizeof(void *)) bvm_pd_system_exit(BVM_FATAL_ERR_INCORRECT_NATIVE_LONG_SIZE);
+    if (sizeof(bvm_native_ulong_t) != sizeof(void *)) bvm_pd_system_exit(BVM_FATAL_ERR_INCORRECT_NATIVE_LONG_SIZE);
+
+    if (sizeof(bvm_cell_t) != sizeof(size_t)) bvm_pd_system_exit(BVM_FATAL_ERR_INCORRECT_CELL_SIZE);
+}
+
+
+#if BVM_VM_ISOLATES_ENABLE
+
+/**
+ * A VM running on an OS thread of its own, started by #bvm_vm_isolate_start.
+ */
+typedef struct _bvmisolatestruct {
+
+	/** The number of command line arguments */
+	int argc;
+
+	/** The command line arguments - owned by the isolate and freed when it is joined */
+	char **argv;
+
+	/** The OS thread the isolate runs on */
+	void *thread;
+
+	/** Cleared by the isolate's OS thread as its VM exits */
+	volatile bvm_bool_t is_alive;
+
+	/** The exit code of the isolate's VM, valid once it is no longer alive */
+	int exit_code;
+
+} bvm_isolate_t;
+
+/** The isolates started by this VM and not yet joined, indexed by isolate id */
+static BVM_VM_LOCAL bvm_isolate_t *vm_isolates[BVM_VM_ISOLATES_MAX];
+
+/**
+ * The body of an isolate's OS thread - a VM of its own.  A command line option that would end the process (a bad
+ * one, or \c -version and the like) ends just the isolate, with the exit code the process would have had.
+ */
+static void vm_isolate_run(void *data) {
+
+	bvm_isolate_t *isolate = data;
+	jmp_buf option_exit_env;
+
+	vm_isolate_option_exit_env = &option_exit_env;
+
+	if (setjmp(option_exit_env) == 0)
+		isolate->exit_code = bvm_main(isolate->argc, isolate->argv);
+	else
+		isolate->exit_code = vm_isolate_option_exit_code;
+
+	vm_isolate_option_exit_env = NULL;
+	isolate->is_alive = BVM_FALSE;
+}
+
+/**
+ * Start an isolate - a new VM on an OS thread of its own that shares nothing with this one.  The arguments are
+ * the same as those given to #bvm_main.  The \c argv array and each string in it must have been allocated with
+ * #bvm_pd_memory_alloc - the isolate owns them from here on and frees them when it is joined, unless it could not be
+ * started.
+ *
+ * @param argc - the number of arguments.
+ * @param argv - the arguments.
+ *
+ * @return the isolate id, or -1 if it has not been started because there are already #BVM_VM_ISOLATES_MAX isolates, or
+ * no OS thread could be started.
+ */
+int bvm_vm_isolate_start(int argc, char *argv[]) {
+
+	bvm_isolate_t *isolate;
+	int id;
+
+	for (id = 0; id < BVM_VM_ISOLATES_MAX; id++)
+		if (vm_isolates[id] == NULL) break;
+
+	if (id == BVM_VM_ISOLATES_MAX) return -1;
+
+	isolate = bvm_pd_memory_alloc(sizeof(bvm_isolate_t));
+	if (isolate == NULL) return -1;
+
+	isolate->argc = argc;
+	isolate->argv = argv;
+	isolate->exit_code = 0;
+	isolate->is_alive = BVM_TRUE;
+
+	isolate->thread = bvm_pd_system_thread_start(vm_isolate_run, isolate);
+
+	if (isolate->thread == NULL) {
+		bvm_pd_memory_free(isolate);
+		return -1;
+	}
+
+	vm_isolates[id] = isolate;
+
+	return id;
+}
+
+/**
+ * Reports whether an id is that of an isolate that has been started and not yet joined.
+ *
+ * @param id - the isolate id.
+ *
+ * @return #BVM_TRUE if it is, #BVM_FALSE if not.
+ */
+bvm_bool_t bvm_vm_isolate_is_valid(int id) {
+	return ( (id >= 0) && (id < BVM_VM_ISOLATES_MAX) && (vm_isolates[id] != NULL) );
+}
+
+/**
+ * Reports whether an isolate's VM is still running.
+ *
+ * @param id - the id of a valid isolate (see #bvm_vm_isolate_is_valid).
+ *
+ * @return #BVM_TRUE if it is, #BVM_FALSE if not.
+ */
+bvm_bool_t bvm_vm_isolate_is_alive(int id) {
+	return vm_isolates[id]->is_alive;
+}
+
+/**
+ * Wait for an isolate's VM to exit and release it.  The wait is in the OS, so no thread of this VM runs while
+ * waiting - Java code polls #bvm_vm_isolate_is_alive first.
+ *
+ * @param id - the id of a valid isolate (see #bvm_vm_isolate_is_valid).  It is no longer valid afterwards.
+ *
+ * @return the isolate's VM exit code.
+ */
+int bvm_vm_isolate_join(int id) {
+
+	bvm_isolate_t *isolate = vm_isolates[id];
+	int exit_code, i;
+
+	bvm_pd_system_thread_join(isolate->thread);
+
+	exit_code = isolate->exit_code;
+
+	for (i = 0; i < isolate->argc; i++)
+		bvm_pd_memory_free(isolate->argv[i]);
+
+	bvm_pd_memory_free(isolate->argv);
+	bvm_pd_memory_free(isolate);
+
+	vm_isolates[id] = NULL;
+
+	return exit_code;
+}
+
+#endif
+
+/**
+ * Parse the VM command line options and initialise the VM, but run nothing.  For C code that calls VM internals
+ * directly without the interpreter, like the \c babe-cbench microbenchmarks.  The options are as for #bvm_main,
+ * except that no class name needs to follow them.
+ *
+ * Like #bvm_main the caller must wrap this (and whatever follows that uses the VM) in a BVM_TRY and a #BVM_VM_TRY
+ * block.
+ *
+ * @param argc on entry, the number of arguments.  On exit, the number left after the options.
+ * @param argv on entry, the arguments.  On exit, those left after the options.
+ */
+void bvm_vm_init(int *argc, char **argv[]) {
+
+	int optc = *argc;
+	char **optv = *argv;
+
+	sanity_check_sizes();
+	parse_command_line(argc, argv);
+	vm_init(optc - *argc, optv, *argc, *argv);
+}
+
+/**
+ * Check the sizes of types and parse the command line options - the first of what #bvm_main does.
+ *
+ * @param ac on entry, the number of arguments.  On exit, the number left after the options - the startup class name
+ * and the arguments to \c main.
+ * @param av on entry, the arguments.  On exit, those left after the options.
+ */
+static void vm_parse(int *ac, char **av[]) {
+
+#if BVM_PROFILER_STARTUP_TRACE_ENABLE
+	/* trace timestamps are from here - whether the startup is traced is not known until the command line is parsed */
+	bvm_gl_profiler_startup_origin = bvm_pd_system_time_micros();
+#endif
+
+	sanity_check_sizes();
+
+#if BVM_VM_INSTANCES_ENABLE
+	bvm_init_exception_stack();
+#endif
+
+	/* parse and process the command line arguments.  The addresses of ac/av are passed in by reference
+	 * and after function execution ac > 0 and av == java main class name + args to the Java main(args[])
+	 method. */
+	parse_command_line(ac, av);
+
+	BVM_PROFILER_STARTUP_PHASE(bvm_gl_profiler_startup_origin, "command line");
+}
+
+/**
+ * Initialise the VM and ready the \c main method of the startup class on the stack of the main thread, with the
+ * startup class and \c java.lang.Thread initialised.  Everything #bvm_main does before the interpreter loop is started.
+ *
+ * @param optc the number of command line options.
+ * @param optv the command line options.
+ * @param ac the number of arguments after the options - the startup class name and the arguments to \c main.
+ * @param av the arguments after the options.
+ */
+static void vm_start(int optc, char *optv[], int ac, char *av[]) {
+
+	bvm_instance_clazz_t *clazz;
+	bvm_instance_array_obj_t *args_array_obj;
+	bvm_method_t *method;
+	bvm_utfstring_t temp_utfstring;
+
+	bvm_bool_t restored;
+	int lc;
+
+#if BVM_PROFILER_STARTUP_TRACE_ENABLE
+	bvm_uint32_t main_mark;
+#endif
+
+	// TODO: check the class file name does not already have slashes.
+
+	/* make the command line class name into an internal class name (replace dots with forward
+	 * slashes) - before init, as a snapshot records the command line */
+	if (ac > 0) bvm_str_replace_char(av[0], (int) strlen(av[0]),'.','/');
+
+	/* init the VM */
+	restored = vm_init(optc, optv, ac, av);
+
+	/* .. not even a startup class mentioned ? Bang out. */
+	if (ac == 0) BVM_VM_EXIT(BVM_FATAL_ERR_NOT_ENOUGH_PARAMS, NULL);
+
+#if BVM_CONSOLE_ENABLE
+	/* just to keep the punters straight, output a copyright notice. */
+	bvm_show_version_and_copyright();
+#endif
+
+#if BVM_DEBUGGER_ENABLE
+
+	if (bvmd_gl_enabledebug) {
+
+		/* initialise the debugger stuff */
+		bvmd_init();
+
+		if (bvmd_is_session_open()) {
+
+			/* wait for that first debugger command ... which will be 'sizes' */
+			bvmd_interact(BVMD_TIMEOUT_FOREVER);
+
+			/* send the debugger the 'VM start' event */
+			bvmd_event_VMStart();
+
+			/* if the start mode is to suspend everything, spin and wait on the debugger until
+			 * it resumes stuff ... */
+			if (bvmd_gl_suspendonstart)
+				bvmd_spin_on_debugger();
+
+		}
+	}
+#endif
+
+#if BVM_DEBUGGER_ENABLE
+
+	/* if debugging, inform the debugger that the system thread is starting */
+	if (bvmd_is_session_open()) {
+
+		/* create a new event context for the 'thread start' event type */
+		bvmd_eventcontext_t *context = bvmd_eventdef_new_context(JDWP_EventKind_THREAD_START, bvm_gl_thread_current);
+
+		/* and let the debugger know that the system thread has started - bvmd_do_event() will free the new context */
+		bvmd_do_event(context);
+	}
+#endif
+	BVM_PROFILER_STARTUP_MARK(main_mark);
+
+	/* a restored VM already has "main" on the stack, ready to run */
+	if (!restored) {
+
+		BVM_BEGIN_TRANSIENT_BLOCK {
+
+			/* create a String[] to be used as the arguments for the main method. */
+			args_array_obj = bvm_object_alloc_array_reference(ac-1, (bvm_clazz_t *) BVM_STRING_CLAZZ);
+
+			/* make sure our new array does not disappear if the following allocations cause a GC */
+			BVM_MAKE_TRANSIENT_ROOT(args_array_obj);
+
+			/* for each param create a String object and place it in the String array. */
+			for (lc=1; lc < ac; lc++)  {
+				temp_utfstring = bvm_str_wrap_utfstring(av[lc]);
+				args_array_obj->data[lc-1] = BVM_REF_Encode((bvm_obj_t *) bvm_string_create_from_utfstring(&temp_utfstring, BVM_FALSE));
+			}
+
+			/* .. and find the vm startup class to execute - use the system classloader  */
+			temp_utfstring = bvm_str_wrap_utfstring(av[0]);
+			clazz = (bvm_instance_clazz_t *) bvm_clazz_get( (bvm_classloader_obj_t *) BVM_SYSTEM_CLASSLOADER_OBJ, &temp_utfstring);
+
+			/* find the void static "main" method for the startup class that has an array of
+			 * Strings as an argument - only search the given class, not its supers or interfaces.
+			 * We do need to be very specific here because 'main()', like any other method name can be
+			 * overloaded - so we have to get the right one */
+			method = bvm_clazz_method_get(clazz, bvm_utfstring_pool_get_c("main", BVM_TRUE),
+									   bvm_utfstring_pool_get_c("([Ljava/lang/String;)V", BVM_TRUE),
+									   BVM_METHOD_SEARCH_CLAZZ);
+
+			/* If no "main" method can be found, or it is not both public and static, bang out */
+			if ( (method == NULL) || !(BVM_METHOD_IsPublic(method) && BVM_METHOD_IsStatic(method) ))
+				BVM_VM_EXIT(BVM_FATAL_ERR_NO_MAIN_METHOD, NULL);
+
+			/* push the "main" method onto the stack making sure to capture the sync object if required -
+			 * Yes, it is legal in Java to have a synchronised main method - it is just another
+			 * method like any other.  We set the return program counter ('pc') to the magic 
+			 * BVM_THREAD_KILL_PC to let us know this is the base of the thread */
+			bvm_frame_push(method, bvm_gl_rx_sp, bvm_gl_rx_pc, BVM_THREAD_KILL_PC, BVM_METHOD_IsSynchronized(method) ? (bvm_obj_t *) method->clazz->class_obj : NULL);
+
+			/* set the argument of "main" to our newly created String array of command
+			 * line arguments */
+			bvm_gl_rx_locals[0].ref_value = (bvm_obj_t *) args_array_obj;
+
+#if BVM_VM_SNAPSHOT_ENABLE
+			/* a snapshot is written once the class initialisations pushed below have all returned */
+			if (bvm_gl_snapshot_write_filename != NULL) bvm_snapshot_ready();
+#endif
+
+			/* (JVMS 5.5) VM startup class is initialised before use.  All classes, before being use are
+			 * 'initialized'.  This is a fairly complex process to get a class internalised and set up
+			 * for running - most of the complexity arises from the fact that more than single thread
+			 * may be attempting to initialise the class at the same time - so locking etc has
+			 * to be done.  */
+			bvm_clazz_initialise(clazz);
+
+			/* also, make sure the java Thread class is initialised before we used it - we have
+			 * already instantiated one before we get the interp loop running, so put it on top
+			 * here to make sure it is correctly initialised.  Normally, class initialisation happens
+			 * as part of the interp loop - but we're not there yet, so we push it manually. */
+			bvm_clazz_initialise(BVM_THREAD_CLAZZ);
+
+			/* Set System class properties */
+			set_system_class_properties();
+
+		} BVM_END_TRANSIENT_BLOCK
+	}
+
+	BVM_PROFILER_STARTUP_PHASE(main_mark, "main class");
+	BVM_PROFILER_STARTUP_PHASE(bvm_gl_profiler_startup_origin, "startup");
+
+#if BVM_PROFILER_ENABLE
+	/* profile the whole run if asked to */
+	if (bvm_gl_profiler_filename != NULL) bvm_profiler_start();
+#endif
+}
+
+/**
+ * Report an exception that reached the bottom of the VM uncaught.
+ *
+ * @param e the uncaught exception.
+ *
+ * @return the exit code for the VM - #BVM_FATAL_ERR_OUT_OF_MEMORY or #BVM_FATAL_ERR_UNCAUGHT_EXCEPTION.
+ */
+static int vm_uncaught_exception(bvm_throwable_obj_t *e) {
+
+#if BVM_CONSOLE_ENABLE
+
+	/* if we arrive here then an exception was raised that was not caught - let's stack trace it.  Stack
+	 * tracing may cause a GC as the stack trace elements are created, so even though we are about to exit
+	 * the VM we'll still make the exception a transient root to make sure a GC does not collect it while we're
+	 * using it. */
+
+	/* TODO - it is possible to arrive here before initialisation has completed - in other
+	 *  words there may be no memory, and no current thread.  Check for `bvm_gl_vm_is_initialised` */
+	BVM_BEGIN_TRANSIENT_BLOCK {
+		BVM_MAKE_TRANSIENT_ROOT(e);
+		bvm_stacktrace_print_to_console(e);
+	} BVM_END_TRANSIENT_BLOCK
 
-	bvm_instance_clazz_t *clazz;
-	bvm_instance_array_obj_t *args_array_obj;
-	bvm_utfstring_t temp_utfstring;
-	int lc;
+#endif
 
-	if (cmdline_nr_system_properties > 0) {
+	/* if the uncaught exception is actually an out of memory error we'll use a special
+	 * exit code to provide a little more information.
+	 */
+	return (e == bvm_gl_out_of_memory_err_obj) ? BVM_FATAL_ERR_OUT_OF_MEMORY : BVM_FATAL_ERR_UNCAUGHT_EXCEPTION;
+}
 
-		BVM_BEGIN_TRANSIENT_BLOCK {
+/**
+ * Shut the VM down once it has ended - tell the debugger, report the exit code, write whatever was asked to be written
+ * at exit and give back the VM resources.
+ *
+ * @param exit_code the exit code of the VM.
+ * @param exit_msg the exit message, or \c NULL if none.
+ *
+ * @return the exit code of the VM.
+ */
+static int vm_shutdown(int exit_code, char *exit_msg) {
 
-			/* Get the System clazz */
-			temp_utfstring = bvm_str_wrap_utfstring("java/lang/System");
-			clazz = (bvm_instance_clazz_t *) bvm_clazz_get( (bvm_classloader_obj_t *) BVM_SYSTEM_CLASSLOADER_OBJ, &temp_utfstring);
+#if BVM_DEBUGGER_ENABLE
+	/* if we're debugging and a session is open, then inform the debugger and close it */
+	if (bvmd_gl_enabledebug) {
+		if (bvmd_is_session_open()) {
+            bvmd_event_VMDeath();
+        }
+		bvmd_shutdown();
+	}
+#endif
 
-			/* create an array of string objects to hold properties */
-			args_array_obj = bvm_object_alloc_array_reference(cmdline_nr_system_properties, (bvm_clazz_t *) BVM_STRING_CLAZZ);
+#if BVM_CONSOLE_ENABLE
+    /* on exit, report the exit code and associated message (if any) to the console. */
+	if (bvm_gl_vm_is_initialised) {
+		if (exit_msg == NULL) {
+			bvm_pd_console_out("VM exit code: %d\n", exit_code);
+		} else {
+			bvm_pd_console_out("VM exit code: %d - %s\n", exit_code, exit_msg);
+		}
+	}
+#endif
 
-			/* make sure our new array does not disappear if any following allocations cause a GC */
-			BVM_MAKE_TRANSIENT_ROOT(args_array_obj);
+#if BVM_VM_ISOLATES_ENABLE
+	/* the VM is not finished until every isolate it started is */
+	{
+		int id;
+		for (id = 0; id < BVM_VM_ISOLATES_MAX; id++)
+			if (vm_isolates[id] != NULL) bvm_vm_isolate_join(id);
+	}
+#endif
 
-			/* set the first field '_cmdLine' of the System class to the new String object array - it will be
-			 * populated in the loop below. */
-			clazz->fields[0].value.static_value.ref_value = (bvm_obj_t *) args_array_obj;
+#if BVM_THREAD_TIMER_PREEMPTION_ENABLE
+	/* no more thread switching */
+	bvm_pd_system_timer_stop();
+#endif
 
-			/* for each System property set on the command line */
-			for (lc = cmdline_nr_system_properties; lc--;) {
+#if BVM_EXEC_IMPLICIT_NULL_CHECKS_ENABLE
+	bvm_exec_null_trap_stop();
+#endif
 
-				/* get the command line system prop */
-				char *sysprop = cmdline_system_properties[lc] + 2;  /* the +2 moves past the '-D' */
+#if BVM_METRICS_ENABLE
+	bvm_metrics_close();
+#endif
 
-				/* create a String object from it and populate it into the String array */
-				temp_utfstring = bvm_str_wrap_utfstring(sysprop);
-				args_array_obj->data[lc] = (bvm_obj_t *) bvm_string_create_from_utfstring(&temp_utfstring, BVM_FALSE);
-			}
+#if BVM_SOCKETS_ENABLE
+	/* close down the sockets */
+	bvm_pd_socket_finalise();
+#endif
 
-		} BVM_END_TRANSIENT_BLOCK
+#if BVM_CLAZZ_IMAGE_ENABLE
+	/* write the bootstrap classes to a class image if asked to */
+	if (bvm_gl_vm_is_initialised && (bvm_gl_clazzimage_write_filename != NULL)) {
+		if (!bvm_clazzimage_write(bvm_gl_clazzimage_write_filename)) {
+#if BVM_CONSOLE_ENABLE
+			bvm_pd_console_out("Class image %s could not be written.\n", bvm_gl_clazzimage_write_filename);
+#endif
+		}
 	}
-}
+#endif
 
-/**
- * Some sanity checking on the sizes of platform types.
- */
-static void sanity_check_sizes() {
-    if (sizeof(bvm_int8_t) != 1) bvm_pd_system_exit(BVM_FATAL_ERR_INCORRECT_UINT8_SIZE);
-    if (sizeof(bvm_uint8_t) != 1) bvm_pd_system_exit(BVM_FATAL_ERR_INCORRECT_UINT8_SIZE);
+#if BVM_CLAZZ_PRELOAD_ENABLE
+	/* write the class files read from jars to a preload profile if asked to */
+	if (bvm_gl_vm_is_initialised && (bvm_gl_preload_write_filename != NULL)) {
+		if (!bvm_preload_write(bvm_gl_preload_write_filename)) {
+#if BVM_CONSOLE_ENABLE
+			bvm_pd_console_out("Preload profile %s could not be written.\n", bvm_gl_preload_write_filename);
+#endif
+		}
+	}
+#endif
 
-    if (sizeof(bvm_uint16_t) != 2) bvm_pd_system_exit(BVM_FATAL_ERR_INCORRECT_UINT16_SIZE);
-    if (sizeof(bvm_int16_t) != 2) bvm_pd_system_exit(BVM_FATAL_ERR_INCORRECT_INT16_SIZE);
+#if BVM_AOT_ENABLE
+	/* write the translations of the methods loaded if asked to */
+	if (bvm_gl_vm_is_initialised && (bvm_gl_aot_write_filename != NULL)) {
+		if (!bvm_aot_write(bvm_gl_aot_write_filename)) {
+#if BVM_CONSOLE_ENABLE
+			bvm_pd_console_out("Translations %s could not be written.\n", bvm_gl_aot_write_filename);
+#endif
+		}
+	}
+#endif
 
-    if (sizeof(bvm_uint32_t) != 4) bvm_pd_system_exit(BVM_FATAL_ERR_INCORRECT_UINT32_SIZE);
-    if (sizeof(bvm_int32_t) != 4) bvm_pd_system_exit(BVM_FATAL_ERR_INCORRECT_INT32_SIZE);
+#if BVM_PROFILER_ENABLE
+	/* write the profile of the run if asked to, and give back the profiler memory */
+	if (bvm_gl_vm_is_initialised && (bvm_gl_profiler_filename != NULL)) {
+		if (!bvm_profiler_dump_to_file(bvm_gl_profiler_filename)) {
+#if BVM_CONSOLE_ENABLE
+			bvm_pd_console_out("Profile %s could not be written.\n", bvm_gl_profiler_filename);
+#endif
+		}
+	}
+	bvm_profiler_release();
+#endif
 
-    if (sizeof(bvm_float_t) != 4) bvm_pd_system_exit(BVM_FATAL_ERR_INCORRECT_FLOAT_SIZE);
-    if (sizeof(bvm_double_t) != 8) bvm_pd_system_exit(BVM_FATAL_ERR_INCORRECT_DOUBLE_SIZE);
+#if BVM_PROFILER_METHOD_COUNTERS_ENABLE
+	/* write the method counts of the run if asked to */
+	if (bvm_gl_vm_is_initialised && (bvm_gl_profiler_method_counts_filename != NULL)) {
+		if (!bvm_profiler_method_counts_dump_to_file(bvm_gl_profiler_method_counts_filename)) {
+#if BVM_CONSOLE_ENABLE
+			bvm_pd_console_out("Method counts %s could not be written.\n", bvm_gl_profiler_method_counts_filename);
+#endif
+		}
+	}
+#endif
 
-    if (sizeof(bvm_native_long_t) != sizeof(void *)) bvm_pd_system_exit(BVM_FATAL_ERR_INCORRECT_NATIVE_LONG_SIZE);
-    if (sizeof(bvm_native_ulong_t) != sizeof(void *)) bvm_pd_system_exit(BVM_FATAL_ERR_INCORRECT_NATIVE_LONG_SIZE);
+#if BVM_PROFILER_OPCODE_HISTOGRAM_ENABLE
+	/* write the opcode histogram of the run if asked to */
+	if (bvm_gl_vm_is_initialised && (bvm_gl_profiler_opcodes_filename != NULL)) {
+		if (!bvm_profiler_opcodes_dump_to_file(bvm_gl_profiler_opcodes_filename)) {
+#if BVM_CONSOLE_ENABLE
+			bvm_pd_console_out("Opcode counts %s could not be written.\n", bvm_gl_profiler_opcodes_filename);
+#endif
+		}
+	}
+#endif
 
-    if (sizeof(bvm_cell_t) != sizeof(size_t)) bvm_pd_system_exit(BVM_FATAL_ERR_INCORRECT_CELL_SIZE);
-}
+#if BVM_PROFILER_ALLOCATION_SITES_ENABLE
+	/* write the allocation sites of the run if asked to, and give back their memory */
+	if (bvm_gl_vm_is_initialised && (bvm_gl_profiler_allocsites_filename != NULL)) {
+		if (!bvm_profiler_allocsites_dump_to_file(bvm_gl_profiler_allocsites_filename)) {
+#if BVM_CONSOLE_ENABLE
+			bvm_pd_console_out("Allocation sites %s could not be written.\n", bvm_gl_profiler_allocsites_filename);
+#endif
+		}
+	}
+	bvm_profiler_allocsites_release();
+#endif
+
+#if BVM_PROFILER_MONITOR_CONTENTION_ENABLE
+	/* write the monitor contention sites of the run if asked to, and give back their memory */
+	if (bvm_gl_vm_is_initialised && (bvm_gl_profiler_contention_filename != NULL)) {
+		if (!bvm_profiler_contention_dump_to_file(bvm_gl_profiler_contention_filename)) {
+#if BVM_CONSOLE_ENABLE
+			bvm_pd_console_out("Monitor contention %s could not be written.\n", bvm_gl_profiler_contention_filename);
+#endif
+		}
+	}
+	bvm_profiler_contention_release();
+#endif
+
+#if BVM_PROFILER_STARTUP_TRACE_ENABLE
+	/* write the startup trace of the run if asked to, and give back its memory */
+	if (bvm_gl_profiler_startup_filename != NULL) {
+		if (!bvm_profiler_startup_dump_to_file(bvm_gl_profiler_startup_filename)) {
+#if BVM_CONSOLE_ENABLE
+			bvm_pd_console_out("Startup trace %s could not be written.\n", bvm_gl_profiler_startup_filename);
+#endif
+		}
+	}
+	bvm_profiler_startup_release();
+#endif
+
+#if BVM_PROFILER_PERF_ENABLE
+	bvm_profiler_perf_release();
+#endif
+
+#if BVM_CONSOLE_ENABLE && BVM_CONSOLE_BUFFER_ENABLE
+	/* write out anything left in the console buffer */
+	bvm_pd_console_flush();
+#endif
 
+#if BVM_CLAZZ_PRELOAD_ENABLE
+	/* before the jars are closed - a prefetch thread may still be reading them */
+	bvm_preload_release();
+#endif
+
+	/* shut down file system access */
+	bvm_file_finalise();
+
+#if BVM_DEBUG_CLEAR_HEAP_ON_EXIT
+	bvm_debug_clear_heap();
+#endif
+
+	/* clean up before we leave */
+	bvm_finalise();
+
+	return exit_code;
+}
 
 /**
  * The VM startup method.  Platform implementations are expected to call this method after they
@@ -1456,16 +2615,73 @@ static void sanity_check_sizes() {
  * @li \c -home : a home directory considered as a root for file opening.
  * @li \c -heap : the size of the heap.  Kilobytes can also be expressed by appending 'k' to the given
  * number ('K' will also do).  For megabytes append either an 'm' or an 'M'.
+ * @li \c -heapmax : the size the heap may grow to - see notes for expressing memory sizes on the 'heap' argument.  By
+ * default the heap does not grow.
+ * @li \c -heapgrow : the percentage of the heap that must be free after a GC for the heap not to grow.  Default is 25.
+ * @li \c -largeobj : primitive arrays of at least this many bytes are given a heap region of their own (if the heap
+ * may grow) - see notes for expressing memory sizes on the 'heap' argument.  Only if #BVM_HEAP_LARGE_OBJECT_ENABLE is
+ * set.  Default is 32k.
+ * @li \c -gcslice : the number of heap chunks marked at each thread switch by the incremental collector.  Only
+ * if #BVM_GC_INCREMENTAL_ENABLE is set.  Default is 256.
+ * @li \c -gcthreads : the number of threads (the VM thread included) that share the marking of a GC.  Only if
+ * #BVM_GC_PARALLEL_MARK_ENABLE is set.  Default is 4.
+ * @li \c -gcbudget : the bytes that may be allocated after a GC before one is started at a thread switch - see notes
+ * for expressing memory sizes on the 'heap' argument.  Only if #BVM_GC_BUDGET_ENABLE is set.  Default is no budget.
+ * @li \c -gcfree : a GC is started at a thread switch if less than this percentage of the heap is free.  Only if
+ * #BVM_GC_BUDGET_ENABLE is set.  Default is 10.
+ * @li \c -gcidle : a full GC is done when the VM expects to be idle for at least this many milliseconds, zero for
+ * never.  Only if #BVM_GC_IDLE_ENABLE is set.  Default is 50.
+ * @li \c -verbose:gc : log each garbage collection to the console.  Only if #BVM_GC_STATS_ENABLE is set.
+ * @li \c -heapdump : the name of a file an HPROF heap dump is written to the first time the VM runs out of memory.
+ * Only if #BVM_HEAP_DUMP_ENABLE is set.
+ * @li \c -metrics : the port a metrics server listens on - each connection is answered with a snapshot of the VM's
+ * runtime metrics in the Prometheus text format.  Only if #BVM_METRICS_ENABLE is set.  Default is no metrics server.
+ * @li \c -profile : the name of a file the sampling profiler's counts are written to in collapsed stack format when
+ * the VM exits.  The profiler runs from startup.  Only if #BVM_PROFILER_ENABLE is set.
+ * @li \c -methodcounts : the name of a file the per-method invocation, bytecode, allocation and time counts are written
+ * to when the VM exits.  Only if #BVM_PROFILER_METHOD_COUNTERS_ENABLE is set.
+ * @li \c -opcodes : the name of a file the counts of each opcode and each pair of consecutive opcodes dispatched are
+ * written to, most frequent first, when the VM exits.  Only if #BVM_PROFILER_OPCODE_HISTOGRAM_ENABLE is set.
+ * @li \c -allocsites : the name of a file the sampled allocation sites are written to, most bytes first, when the VM
+ * exits.  Only if #BVM_PROFILER_ALLOCATION_SITES_ENABLE is set.
+ * @li \c -contention : the name of a file the monitor contention sites are written to, most time blocked first, when
+ * the VM exits.  Only if #BVM_PROFILER_MONITOR_CONTENTION_ENABLE is set.
+ * @li \c -starttrace : the name of a file a Chrome trace event JSON timeline of the VM startup phases, class loads and
+ * class initialisations is written to when the VM exits.  Only if #BVM_PROFILER_STARTUP_TRACE_ENABLE is set.
+ * @li \c -perfmap : write the address, size and name of each method compiled by the JIT to \c /tmp/perf-&lt;pid&gt;.map
+ * for Linux \c perf.  Only if #BVM_PROFILER_PERF_ENABLE is set.
+ * @li \c -image : the name of a class image file to load the bootstrap classes from - it is not used if it was not made
+ * with the same boot classpath.  Only if #BVM_CLAZZ_IMAGE_ENABLE is set.
+ * @li \c -imagewrite : the name of a class image file the classes loaded by the bootstrap class loader are written to
+ * when the VM exits.  Only if #BVM_CLAZZ_IMAGE_ENABLE is set.
+ * @li \c -preload : the name of a preload profile file - the class files listed in it are read ahead from their jars,
+ * jar by jar in jar order, before any class is loaded.  Only if #BVM_CLAZZ_PRELOAD_ENABLE is set.
+ * @li \c -preloadwrite : the name of a preload profile file the class files read from jars are written to when the VM
+ * exits.  Only if #BVM_CLAZZ_PRELOAD_ENABLE is set.
+ * @li \c -snapshot : the name of a snapshot file to restore the started VM from - it is not used if it was not made
+ * by the same executable with the same command line.  Only if #BVM_VM_SNAPSHOT_ENABLE is set.
+ * @li \c -snapshotwrite : the name of a snapshot file the VM is written to once the main class is initialised, just
+ * before \c main runs.  Only if #BVM_VM_SNAPSHOT_ENABLE is set.
+ * @li \c -aotwrite : the name of a C file the methods of the classes loaded are written to, translated to C, when the
+ * VM exits.  Only if #BVM_AOT_ENABLE is set.
+ * @li \c -aotclasses : comma separated class name prefixes - only the classes they match are translated by
+ * \c -aotwrite.  Only if #BVM_AOT_ENABLE is set.
  * @li \c -stack : the size of a stack segment in bytes - see notes for expressing memory sizes on the 'heap' argument.
  * @li \c -tr : the size of the stack for transient GC roots - expressed in terms of its height, not size in
  * bytes.  Just an int. Min is 50 - Max is 5000.
  * @li \c -sr : the size of the stack for permanent system GC root - expressed in terms of its height, not size in
  * bytes.  Just an int. Min is 100 - Max is 500.
- * @li \c -files : max number of open files.
+ * @li \c -files : max number of open files (the initial number if #BVM_FILE_HANDLES_GROW_ENABLE is set).
  * @li \c -utfb : number of hash buckets for the utf string pool.
  * @li \c -strb : number of hash buckets for the interned String pool.
  * @li \c -clazzb : number of hash buckets for the class pool.
+ * @li \c -natb : number of hash buckets for the native method pool.
+ *
+ * With #BVM_POOL_RESIZE_ENABLE the bucket counts are starting sizes.  Each pool doubles its bucket count as it
+ * fills past #BVM_POOL_MAX_LOAD entries per bucket.
  * @li \c -ea : globally enable java asserts.  Java assertions are off by default.
+ * @li \c -notrace : the name of a throwable class whose instances (and those of its subclasses) record no stack
+ * trace - for exceptions used as control flow.  May be given more than once.  Only if #BVM_STACKTRACE_ENABLE is set.
  * @li \c -version : output version information and exit.  Not this is only available if the platform support a console.
  * @li \c -Dprop=value : Set a System property called "prop" to "value".
  *
@@ -1519,212 +2735,137 @@ int bvm_main(int argc, char *argv[]) {
 	int ac = argc;
 	char **av = argv;
 
-	sanity_check_sizes();
-
-	/* parse and process the command line arguments.  The addresses of ac/av are passed in by reference
-	 * and after function execution ac > 0 and av == java main class name + args to the Java main(args[]) 
-	 method. */
-	parse_command_line(&ac, &av);
+	vm_parse(&ac, &av);
 
 	BVM_TRY { /* to catch BVM_EXIT */
 
 		BVM_VM_TRY {  /* to catch uncaught exceptions */
 
-			bvm_instance_clazz_t *clazz;
-			bvm_instance_array_obj_t *args_array_obj;
-			bvm_method_t *method;
-			bvm_utfstring_t temp_utfstring;
-
-			int lc;
-
-			/* init the VM */
-			vm_init();
-
-			/* .. not even a startup class mentioned ? Bang out. */
-			if (ac == 0) BVM_VM_EXIT(BVM_FATAL_ERR_NOT_ENOUGH_PARAMS, NULL);
-
-#if BVM_CONSOLE_ENABLE
-			/* just to keep the punters straight, output a copyright notice. */
-			bvm_show_version_and_copyright();
-#endif
-
-#if BVM_DEBUGGER_ENABLE
-
-			if (bvmd_gl_enabledebug) {
-
-				/* initialise the debugger stuff */
-				bvmd_init();
-
-				if (bvmd_is_session_open()) {
-
-					/* wait for that first debugger command ... which will be 'sizes' */
-					bvmd_interact(BVMD_TIMEOUT_FOREVER);
+			vm_start(argc - ac, argv, ac, av);
 
-					/* send the debugger the 'VM start' event */
-					bvmd_event_VMStart();
-
-					/* if the start mode is to suspend everything, spin and wait on the debugger until
-					 * it resumes stuff ... */
-					if (bvmd_gl_suspendonstart)
-						bvmd_spin_on_debugger();
-
-				}
-			}
-#endif
-
-#if BVM_DEBUGGER_ENABLE
-
-			/* if debugging, inform the debugger that the system thread is starting */
-			if (bvmd_is_session_open()) {
-
-				/* create a new event context for the 'thread start' event type */
-				bvmd_eventcontext_t *context = bvmd_eventdef_new_context(JDWP_EventKind_THREAD_START, bvm_gl_thread_current);
-
-				/* and let the debugger know that the system thread has started - bvmd_do_event() will free the new context */
-				bvmd_do_event(context);
-			}
-#endif
-			BVM_BEGIN_TRANSIENT_BLOCK {
-
-				/* create a String[] to be used as the arguments for the main method. */
-				args_array_obj = bvm_object_alloc_array_reference(ac-1, (bvm_clazz_t *) BVM_STRING_CLAZZ);
+			/* and finally, start the interpreter loop for the virtual machine */
+			bvm_exec_run();
 
-				/* make sure our new array does not disappear if the following allocations cause a GC */
-				BVM_MAKE_TRANSIENT_ROOT(args_array_obj);
+		} BVM_VM_CATCH(code, msg) {
 
-				/* for each param create a String object and place it in the String array. */
-				for (lc=1; lc < ac; lc++)  {
-					temp_utfstring = bvm_str_wrap_utfstring(av[lc]);
-					args_array_obj->data[lc-1] = (bvm_obj_t *) bvm_string_create_from_utfstring(&temp_utfstring, BVM_FALSE);
-				}
+			/* nasty - if we arrive here an BVM_VM_EXIT has been performed somewhere */
+			exit_code = code;
+			exit_msg = msg;
 
-                // TODO: check the class file name does not already have slashes.
+		} BVM_VM_END_CATCH
 
-				/* make the command line class name into an internal class name (replace dots with forward
-				 * slashes)*/
-                bvm_str_replace_char(av[0], (int) strlen(av[0]),'.','/');
+	}
+	BVM_CATCH(e) {
 
-				/* .. and find the vm startup class to execute - use the system classloader  */
-				temp_utfstring = bvm_str_wrap_utfstring(av[0]);
-				clazz = (bvm_instance_clazz_t *) bvm_clazz_get( (bvm_classloader_obj_t *) BVM_SYSTEM_CLASSLOADER_OBJ, &temp_utfstring);
+		exit_code = vm_uncaught_exception(e);
 
-				/* find the void static "main" method for the startup class that has an array of
-				 * Strings as an argument - only search the given class, not its supers or interfaces.
-				 * We do need to be very specific here because 'main()', like any other method name can be
-				 * overloaded - so we have to get the right one */
-				method = bvm_clazz_method_get(clazz, bvm_utfstring_pool_get_c("main", BVM_TRUE),
-										   bvm_utfstring_pool_get_c("([Ljava/lang/String;)V", BVM_TRUE),
-										   BVM_METHOD_SEARCH_CLAZZ);
+	} BVM_END_CATCH
 
-				/* If no "main" method can be found, or it is not both public and static, bang out */
-				if ( (method == NULL) || !(BVM_METHOD_IsPublic(method) && BVM_METHOD_IsStatic(method) ))
-					BVM_VM_EXIT(BVM_FATAL_ERR_NO_MAIN_METHOD, NULL);
+	return vm_shutdown(exit_code, exit_msg);
+}
 
-				/* push the "main" method onto the stack making sure to capture the sync object if required -
-				 * Yes, it is legal in Java to have a synchronised main method - it is just another
-				 * method like any other.  We set the return program counter ('pc') to the magic 
-				 * BVM_THREAD_KILL_PC to let us know this is the base of the thread */
-				bvm_frame_push(method, bvm_gl_rx_sp, bvm_gl_rx_pc, BVM_THREAD_KILL_PC, BVM_METHOD_IsSynchronized(method) ? (bvm_obj_t *) method->clazz->class_obj : NULL);
+#if BVM_VM_SLICE_ENABLE
 
-				/* set the argument of "main" to our newly created String array of command
-				 * line arguments */
-				bvm_gl_rx_locals[0].ref_value = (bvm_obj_t *) args_array_obj;
+/** The exit code and message of the VM run in slices, once it has ended */
+static BVM_VM_LOCAL int vm_slice_exit_code = 0;
+static BVM_VM_LOCAL char *vm_slice_exit_msg = NULL;
 
-				/* (JVMS 5.5) VM startup class is initialised before use.  All classes, before being use are
-				 * 'initialized'.  This is a fairly complex process to get a class internalised and set up
-				 * for running - most of the complexity arises from the fact that more than single thread
-				 * may be attempting to initialise the class at the same time - so locking etc has
-				 * to be done.  */
-				bvm_clazz_initialise(clazz);
+/** Set once the VM run in slices has ended */
+static BVM_VM_LOCAL bvm_bool_t vm_slice_ended = BVM_FALSE;
 
-				/* also, make sure the java Thread class is initialised before we used it - we have
-				 * already instantiated one before we get the interp loop running, so put it on top
-				 * here to make sure it is correctly initialised.  Normally, class initialisation happens
-				 * as part of the interp loop - but we're not there yet, so we push it manually. */
-				bvm_clazz_initialise(BVM_THREAD_CLAZZ);
+/**
+ * Start a VM to be run in slices by a host that keeps its own event loop.  Does everything #bvm_main does before its
+ * interpreter loop starts - the arguments are as for #bvm_main - and returns.  The host then calls #bvm_vm_slice_run
+ * until the VM has ended, and #bvm_vm_slice_end to shut it down.
+ *
+ * Unlike #bvm_main the caller need not provide any BVM_TRY or #BVM_VM_TRY blocks - each slice function has its own.
+ * The arguments must stay valid until #bvm_vm_slice_end.
+ *
+ * @param argc the number of command line arguments.
+ * @param argv the command line arguments.
+ *
+ * @return #BVM_VM_SLICE_RUNNABLE, or #BVM_VM_SLICE_ENDED if the VM ended while starting up.
+ */
+bvm_vm_slice_state_t bvm_vm_slice_start(int argc, char *argv[]) {
 
-				/* Set System class properties */
-				set_system_class_properties();
+	int ac = argc;
+	char **av = argv;
 
-			} BVM_END_TRANSIENT_BLOCK
+	vm_slice_exit_code = 0;
+	vm_slice_exit_msg = NULL;
+	vm_slice_ended = BVM_FALSE;
 
-			/* and finally, start the interpreter loop for the virtual machine */
-			bvm_exec_run();
+	vm_parse(&ac, &av);
 
+	BVM_TRY {
+		BVM_VM_TRY {
+			vm_start(argc - ac, argv, ac, av);
 		} BVM_VM_CATCH(code, msg) {
-
-			/* nasty - if we arrive here an BVM_VM_EXIT has been performed somewhere */
-			exit_code = code;
-			exit_msg = msg;
-
+			vm_slice_exit_code = code;
+			vm_slice_exit_msg = msg;
+			vm_slice_ended = BVM_TRUE;
 		} BVM_VM_END_CATCH
-
 	}
 	BVM_CATCH(e) {
+		vm_slice_exit_code = vm_uncaught_exception(e);
+		vm_slice_ended = BVM_TRUE;
+	} BVM_END_CATCH
 
-#if BVM_CONSOLE_ENABLE
-
-		/* if we arrive here then an exception was raised that was not caught - let's stack trace it.  Stack
-		 * tracing may cause a GC as the stack trace elements are created, so even though we are about to exit
-		 * the VM we'll still make the exception a transient root to make sure a GC does not collect it while we're
-		 * using it. */
-
-		/* TODO - it is possible to arrive here before initialisation has completed - in other
-		 *  words there may be no memory, and no current thread.  Check for `bvm_gl_vm_is_initialised` */
-		BVM_BEGIN_TRANSIENT_BLOCK {
-			BVM_MAKE_TRANSIENT_ROOT(e);
-			bvm_stacktrace_print_to_console(e);
-		} BVM_END_TRANSIENT_BLOCK
-
-#endif
+	return vm_slice_ended ? BVM_VM_SLICE_ENDED : BVM_VM_SLICE_RUNNABLE;
+}
 
-		/* if the uncaught exception is actually an out of memory error we'll use a special
-		 * exit code to provide a little more information.
-		 */
-		if (e == bvm_gl_out_of_memory_err_obj) {
-			exit_code = BVM_FATAL_ERR_OUT_OF_MEMORY;
-		} else {
-			exit_code = BVM_FATAL_ERR_UNCAUGHT_EXCEPTION;
-		}
+/**
+ * Run the VM started by #bvm_vm_slice_start for one slice.  The slice ends at the first thread switch after
+ * \c max_bytecodes bytecodes have run or \c max_micros microseconds have passed, whichever comes first, so it may run
+ * over by up to a thread timeslice.  It ends early, without sleeping, if every thread is waiting on a timer, a socket,
+ * a file or a monitor - the host may then wait on its own events for a while before the next slice.
+ *
+ * @param max_bytecodes the bytecodes the slice may run, or zero for no limit.  Not used with
+ * #BVM_THREAD_TIMER_PREEMPTION_ENABLE, where slices only end at timer ticks.
+ * @param max_micros the microseconds the slice may run for, or zero for no limit.
+ *
+ * @return #BVM_VM_SLICE_RUNNABLE if there are threads ready to run, #BVM_VM_SLICE_IDLE if every thread is waiting, or
+ * #BVM_VM_SLICE_ENDED if the VM has ended.
+ */
+bvm_vm_slice_state_t bvm_vm_slice_run(bvm_uint32_t max_bytecodes, bvm_uint32_t max_micros) {
 
-	} BVM_END_CATCH
+	if (vm_slice_ended) return BVM_VM_SLICE_ENDED;
 
-#if BVM_DEBUGGER_ENABLE
-	/* if we're debugging and a session is open, then inform the debugger and close it */
-	if (bvmd_gl_enabledebug) {
-		if (bvmd_is_session_open()) {
-            bvmd_event_VMDeath();
-        }
-		bvmd_shutdown();
+	BVM_TRY {
+		BVM_VM_TRY {
+			if (!bvm_exec_run_slice(max_bytecodes, max_micros))
+				vm_slice_ended = BVM_TRUE;
+		} BVM_VM_CATCH(code, msg) {
+			vm_slice_exit_code = code;
+			vm_slice_exit_msg = msg;
+			vm_slice_ended = BVM_TRUE;
+		} BVM_VM_END_CATCH
 	}
-#endif
+	BVM_CATCH(e) {
+		vm_slice_exit_code = vm_uncaught_exception(e);
+		vm_slice_ended = BVM_TRUE;
+	} BVM_END_CATCH
 
-#if BVM_CONSOLE_ENABLE
-    /* on exit, report the exit code and associated message (if any) to the console. */
-	if (bvm_gl_vm_is_initialised) {
-		if (exit_msg == NULL) {
-			bvm_pd_console_out("VM exit code: %d\n", exit_code);
-		} else {
-			bvm_pd_console_out("VM exit code: %d - %s\n", exit_code, exit_msg);
-		}
-	}
-#endif
+	/* a VM exit may have left from within the slice */
+	bvm_gl_exec_slice_active = BVM_FALSE;
 
-#if BVM_SOCKETS_ENABLE
-	/* close down the sockets */
-	bvm_pd_socket_finalise();
-#endif
+	if (vm_slice_ended) return BVM_VM_SLICE_ENDED;
 
-	/* shut down file system access */
-	bvm_file_finalise();
+	return bvm_gl_exec_slice_idle ? BVM_VM_SLICE_IDLE : BVM_VM_SLICE_RUNNABLE;
+}
 
-#if BVM_DEBUG_CLEAR_HEAP_ON_EXIT
-	bvm_debug_clear_heap();
-#endif
+/**
+ * Shut down the VM started by #bvm_vm_slice_start, as #bvm_main does when its interpreter loop returns.  If the VM has
+ * not yet ended, its threads are abandoned where they are.
+ *
+ * @return the exit code of the VM, as for #bvm_main.
+ */
+int bvm_vm_slice_end() {
 
-	/* clean up before we leave */
-	bvm_finalise();
+	vm_slice_ended = BVM_TRUE;
 
-	return exit_code;
+	return vm_shutdown(vm_slice_exit_code, vm_slice_exit_msg);
 }
 
+#endif
+
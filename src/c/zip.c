@@ -134,17 +134,42 @@
 
  At this point the scan through an interned jar file desc file entry cache is linear.
 
+ @section index Directory Index
+
+ The compact cache above costs a linear scan of the cache and a read of the central directory from the jar for each
+ hash match on every lookup - which adds up for a jar of a few thousand classes.  If #BVM_JAR_DIRECTORY_INDEX_ENABLE
+ is set the central directory read during interning is kept in memory instead of freed, and the jar descriptor holds
+ an open addressed hash table of it keyed by the full 32 bit hash of each path name.  A lookup is a probe of the
+ table comparing the full path names in memory, and the jar file is only read for the file itself.  This costs the
+ central directory (about 50 bytes per file plus its name) and two pointer sized slots per file.
+
+ The index holds pointers rather than packed offsets, so the 16M jar size and 255 character path name limits of the
+ compact cache do not apply to it.  A jar of more than 65535 entries, or one written by a tool that always uses it, has
+ its central directory found through the ZIP64 end of central directory record.  The count of entries in the end
+ record is not relied on - without ZIP64 it is only 16 bits and wraps - the central directory is walked to count them
+ instead.  An entry whose sizes or local header offset do not fit the central directory file header has them in its
+ ZIP64 extra field, which is read instead (see #zip_cen_value).  Jar offsets are still kept in 32 bits and file
+ positions are signed 32 bit values, so a jar must be smaller than 2G (#ZIP_INDEX_MAX_JAR_SIZE).
+
+ @section map Mapped Jars
+
+ If #BVM_FILE_MAP_ENABLE is set a jar is mapped into memory (#bvm_file_map) when it is interned and file entries are
+ read from the mapping instead of the file.  A stored (uncompressed) entry is not copied at all - the buffer returned
+ just points into the mapping (#bvm_create_mapped_buffer), and a deflated entry is inflated straight from the
+ mapping without first reading the compressed data into the heap.  The mapping lasts until the jar is closed.  A jar
+ that cannot be mapped (or a platform without mapping) is read as before.
+
  @section nsupp Not Supported ...
 
  Some things to note (like .. what is not known to be supported):
 
- @li The ZIP64 format is not supported.  Only 32 bit zips are supported.
+ @li The ZIP64 format is only supported with #BVM_JAR_DIRECTORY_INDEX_ENABLE, and then for jars under 2G.
  @li Comments on a jar file are not supported.  In fact, they will cause the file not be read.  Why?  The
      comments are variable length and on the end of the file, so supporting them means scanning backwards
      from the end of the file to find the end-of-central-directory record.  Can't be bothered and there is
      already a fair bit of code here - so comments on a jar file will cause failure.  Don't comment jar files.
- @li full file names (including the directory path) cannot be longer than 255.
- @li a jar file cannot be greater than 16777215k (16M) in size.
+ @li without #BVM_JAR_DIRECTORY_INDEX_ENABLE full file names (including the directory path) cannot be longer than
+     255, and a jar file cannot be greater than 16777215 bytes (16M) in size.
  @li split jar files are not supported.  Yes, the zip spec says you can split them.  We don't.
  @li only the DEFLATE and STORE compression methods are supported.
  @li crc32 checksums are not being checked as the file is inflated.
@@ -152,6 +177,28 @@
 */
 
 
+#if BVM_JAR_DIRECTORY_INDEX_ENABLE
+
+/**
+ * A slot in the hash table of a jar's central directory.
+ */
+typedef struct _zipentrystruct {
+
+	/** the full 32 bit hash of the path name of the entry */
+	bvm_uint32_t hash;
+
+	/** the central directory file header of the entry, in the in-memory central directory.  \c NULL for an empty
+	 * slot. */
+	bvm_uint8_t *header;
+
+} zip_entry_t;
+
+/** The slot of a path name hash in a jar's hash table.  The high bits are folded in - the hash does not spread the
+ * low bits well for names with a common prefix. */
+#define ZIP_ENTRY_SLOT(h, m)	( ((h) ^ ((h) >> 15)) & (m) )
+
+#endif
+
 /**
  * A cached descriptor of an already-opened jar file.  The jar descriptor is used to cache some
  * important information extracted from the jar file to make searching it faster.
@@ -170,17 +217,42 @@ typedef struct _jarstruct {
 	/** the number of cached directory entries */
 	bvm_uint32_t entries_count;
 
+#if BVM_FILE_MAP_ENABLE
+
+	/** the jar file mapped into memory, or \c NULL if it could not be mapped */
+	bvm_uint8_t *map;
+
+	/** the size of the mapped jar file */
+	bvm_uint32_t map_size;
+
+#endif
+
+#if BVM_JAR_DIRECTORY_INDEX_ENABLE
+
+	/** the central directory of the jar, kept in memory */
+	bvm_uint8_t *central_dir;
+
+	/** the number of slots in \c entries less one - the slot count is a power of two */
+	bvm_uint32_t entries_mask;
+
+	/** open addressed hash table of the central directory file headers, keyed by their full path names */
+	zip_entry_t entries[1];
+
+#else
+
 	/** array of jar entries. 24bits offset. 8 bits hash. Max jar size is therefore 16mb. */
 	bvm_uint32_t entries[1];
 
+#endif
+
 } jardesc_t;
 
 
 /** initial size of jar descriptors array */
-int jars_sz = 10;
+BVM_VM_LOCAL int jars_sz = 10;
 
 /** array of pointers to jar descriptors */
-jardesc_t **jars = NULL;
+BVM_VM_LOCAL jardesc_t **jars = NULL;
 
 /** Read a non-aligned little-endian 4 byte value */
 #define READ_LE_INT(b)   ((b)[0]|((b)[1]<<8)|((b)[2]<<16)|((b)[3]<<24))
@@ -192,6 +264,9 @@ jardesc_t **jars = NULL;
 
 #define MAX_JAR_SIZE			   0xFFFFFF  /* 24 bits */
 
+/** The largest jar the directory index can read - jar offsets are kept in 32 bits and file positions are signed */
+#define ZIP_INDEX_MAX_JAR_SIZE	   0x7FFFFFFF
+
 /* End of central directory record */
 
 /*
@@ -217,6 +292,59 @@ jardesc_t **jars = NULL;
 #define END_CEN_DIR_SIZE_OFFSET    12
 #define END_CEN_DIR_START_OFFSET   16
 
+/* ZIP64 end of central directory locator - just before the end of central directory record */
+
+/*
+	zip64 end of central dir locator
+	signature                       4 bytes  (0x07064b50)
+	number of the disk with the
+	start of the zip64 end of
+	central directory               4 bytes
+	relative offset of the zip64
+	end of central directory record 8 bytes
+	total number of disks           4 bytes
+*/
+
+#define END64_LOC_SIG              0x07064b50
+#define END64_LOC_LEN              20
+#define END64_LOC_OFFSET_OFFSET     8
+
+/* ZIP64 end of central directory record */
+
+/*
+	zip64 end of central dir
+	signature                       4 bytes  (0x06064b50)
+	size of zip64 end of central
+	directory record                8 bytes
+	version made by                 2 bytes
+	version needed to extract       2 bytes
+	number of this disk             4 bytes
+	number of the disk with the
+	start of the central directory  4 bytes
+	total number of entries in the
+	central directory on this disk  8 bytes
+	total number of entries in the
+	central directory               8 bytes
+	size of the central directory   8 bytes
+	offset of start of central
+	directory with respect to
+	the starting disk number        8 bytes
+	zip64 extensible data sector    (variable size)
+*/
+
+#define END64_CEN_SIG              0x06064b50
+#define END64_CEN_LEN              56
+#define END64_CEN_DIR_SIZE_OFFSET  40
+#define END64_CEN_DIR_START_OFFSET 48
+
+/* A 32 bit (or 16 bit) value of this in a header means the real value is in a ZIP64 record or extra field */
+#define ZIP64_MAGIC                0xFFFFFFFF
+#define ZIP64_MAGIC_SHORT          0xFFFF
+
+/* The header id of the ZIP64 extended information extra field.  Holds, in this order, only those of the uncompressed
+ * size, compressed size and local header offset (8 bytes each) that are ZIP64_MAGIC in the central file header. */
+#define ZIP64_EXTRA_ID             0x0001
+
 /* Central directory file header */
 
 /*
@@ -283,6 +411,145 @@ jardesc_t **jars = NULL;
 #define COMP_STORED                0
 #define COMP_DEFLATED              8
 
+#if BVM_JAR_DIRECTORY_INDEX_ENABLE
+
+/**
+ * Read a non-aligned little-endian 8 byte ZIP64 size or offset into 32 bits.
+ *
+ * @param b the bytes
+ * @param value where to put the value
+ *
+ * @return #BVM_TRUE if the value is small enough for a jar the index can read, #BVM_FALSE if not.
+ */
+static bvm_bool_t zip_read_le_long(bvm_uint8_t *b, bvm_uint32_t *value) {
+
+	*value = (bvm_uint32_t) READ_LE_INT(b);
+
+	return (bvm_bool_t) ( (READ_LE_INT(b + 4) == 0) && (*value <= ZIP_INDEX_MAX_JAR_SIZE) );
+}
+
+/**
+ * Get the uncompressed size, compressed size or local header offset of an entry from its central directory file
+ * header in the in-memory central directory.  A value too big for the header is \c ZIP64_MAGIC there, and is read from
+ * the entry's ZIP64 extra field instead.
+ *
+ * @param fileheader the central directory file header
+ * @param offset the offset of the value in the header - #CEN_FILE_UNCOMPLEN_OFFSET, #CEN_FILE_COMPLEN_OFFSET or
+ * #CEN_FILE_LOCALHDR_OFFSET
+ *
+ * @return the value.
+ */
+static bvm_uint32_t zip_cen_value(bvm_uint8_t *fileheader, bvm_uint32_t offset) {
+
+	bvm_uint32_t value = (bvm_uint32_t) READ_LE_INT(fileheader + offset);
+	bvm_uint8_t *extra, *extra_end;
+
+	if (value != ZIP64_MAGIC) return value;
+
+	extra = fileheader + CEN_FILE_HEADER_LEN + READ_LE_SHORT(fileheader + CEN_FILE_PATHLEN_OFFSET);
+	extra_end = extra + READ_LE_SHORT(fileheader + CEN_FILE_EXTRALEN_OFFSET);
+
+	while (extra_end - extra >= 4) {
+
+		bvm_uint32_t size = READ_LE_SHORT(extra + 2);
+
+		if (READ_LE_SHORT(extra) == ZIP64_EXTRA_ID) {
+
+			/* only the values that overflowed are there, in header order - skip those before this one */
+			bvm_uint32_t position = 0;
+
+			if ( (offset != CEN_FILE_UNCOMPLEN_OFFSET) &&
+				 ((bvm_uint32_t) READ_LE_INT(fileheader + CEN_FILE_UNCOMPLEN_OFFSET) == ZIP64_MAGIC) ) position += 8;
+
+			if ( (offset == CEN_FILE_LOCALHDR_OFFSET) &&
+				 ((bvm_uint32_t) READ_LE_INT(fileheader + CEN_FILE_COMPLEN_OFFSET) == ZIP64_MAGIC) ) position += 8;
+
+			if ( (position + 8 <= size) && (extra + 4 + size <= extra_end) && zip_read_le_long(extra + 4 + position, &value) )
+				return value;
+
+			break;
+		}
+
+		extra += 4 + size;
+	}
+
+	bvm_throw_exception(BVM_ERR_VIRTUAL_MACHINE_ERROR, "Invalid or too large Jar ZIP64 entry");
+
+	return 0;
+}
+
+/**
+ * Count the file headers of a central directory by walking it.  Stops at the end of the central directory, or at
+ * anything that is not a whole file header.
+ *
+ * @param cd the central directory
+ * @param len the size of the central directory
+ *
+ * @return the number of file headers.
+ */
+static bvm_uint32_t zip_count_entries(bvm_uint8_t *cd, bvm_uint32_t len) {
+
+	bvm_uint32_t count = 0;
+	bvm_uint8_t *pntr = cd, *end = cd + len;
+
+	while ( (end - pntr >= CEN_FILE_HEADER_LEN) && (READ_LE_INT(pntr) == CEN_FILE_HEADER_SIG) ) {
+
+		bvm_uint32_t header_len = CEN_FILE_HEADER_LEN + READ_LE_SHORT(pntr + CEN_FILE_PATHLEN_OFFSET) +
+								  READ_LE_SHORT(pntr + CEN_FILE_EXTRALEN_OFFSET) +
+								  READ_LE_SHORT(pntr + CEN_FILE_COMMENTLEN_OFFSET);
+
+		if (header_len > (bvm_uint32_t) (end - pntr)) break;
+
+		pntr += header_len;
+		count++;
+	}
+
+	return count;
+}
+
+/**
+ * Find the central directory of a ZIP64 jar from its ZIP64 end of central directory locator and record.
+ *
+ * @param fd the open jar file
+ * @param size the size of the jar file
+ * @param posn where to put the offset of the central directory
+ * @param len where to put the size of the central directory
+ *
+ * @return #BVM_TRUE if the jar has valid ZIP64 records the index can read, #BVM_FALSE if not.
+ */
+static bvm_bool_t zip_find_central_dir64(BVM_FILE fd, bvm_uint32_t size, bvm_uint32_t *posn, bvm_uint32_t *len) {
+
+	bvm_uint8_t locator[END64_LOC_LEN];
+	bvm_uint8_t cd_end[END64_CEN_LEN];
+	bvm_uint32_t end_posn;
+
+	if (size < END_CEN_LEN + END64_LOC_LEN) return BVM_FALSE;
+
+	/* the locator is just before the end of central directory record */
+	bvm_file_setpos(fd, -(END_CEN_LEN + END64_LOC_LEN), BVM_FILE_SEEK_END);
+
+	if ( (bvm_file_read(locator, END64_LOC_LEN, fd) != END64_LOC_LEN) || (READ_LE_INT(locator) != END64_LOC_SIG) ||
+		 !zip_read_le_long(locator + END64_LOC_OFFSET_OFFSET, &end_posn) || (size - END64_CEN_LEN < end_posn) )
+		return BVM_FALSE;
+
+	bvm_file_setpos(fd, end_posn, BVM_FILE_SEEK_SET);
+
+	return (bvm_bool_t) ( (bvm_file_read(cd_end, END64_CEN_LEN, fd) == END64_CEN_LEN) &&
+						  (READ_LE_INT(cd_end) == END64_CEN_SIG) &&
+						  zip_read_le_long(cd_end + END64_CEN_DIR_SIZE_OFFSET, len) &&
+						  zip_read_le_long(cd_end + END64_CEN_DIR_START_OFFSET, posn) );
+}
+
+/** An uncompressed size, compressed size or local header offset from a central directory file header */
+#define ZIP_CEN_VALUE(h, o)		zip_cen_value((h), (o))
+
+#else
+
+/** An uncompressed size, compressed size or local header offset from a central directory file header */
+#define ZIP_CEN_VALUE(h, o)		((bvm_uint32_t) READ_LE_INT((h) + (o)))
+
+#endif
+
 /**
  * Put a jar desc into the jar desc cache array.  Will grow the array if required.
  *
@@ -329,6 +596,9 @@ static jardesc_t *zip_jar_intern(char *filename) {
 
 	bvm_uint8_t intbuf[sizeof(bvm_uint32_t)];
     bvm_uint32_t entries, len, posn;
+#if BVM_JAR_DIRECTORY_INDEX_ENABLE
+    bvm_uint32_t slots, size;
+#endif
 
     bvm_uint8_t *cd = NULL, *pntr;
     bvm_uint8_t cd_end[END_CEN_LEN];
@@ -341,10 +611,20 @@ static jardesc_t *zip_jar_intern(char *filename) {
     if ((fd = bvm_file_open(bvm_gl_filetype_md, filename, BVM_FILE_O_RDONLY)) == BVM_ERR)
         return NULL;
 
+#if BVM_JAR_DIRECTORY_INDEX_ENABLE
+	/* the index keeps jar offsets in 32 bits, and file positions are signed */
+	if (bvm_file_sizeof(fd) > ZIP_INDEX_MAX_JAR_SIZE) {
+		bvm_file_close(fd);
+		bvm_throw_exception(BVM_ERR_VIRTUAL_MACHINE_ERROR, "Max Jar size (0x7FFFFFFF) exceeded");
+	}
+
+	size = (bvm_uint32_t) bvm_file_sizeof(fd);
+#else
 	/* Throw a wobbly on large jars.  The caching mechanism we use limits the
 	 * size - yes, a trade off */
 	if (bvm_file_sizeof(fd) > MAX_JAR_SIZE)
 		bvm_throw_exception(BVM_ERR_VIRTUAL_MACHINE_ERROR, "Max Jar size (0xFFFFFF) exceeded");
+#endif
 
 
     /* First 4 bytes must be the signature for the first local file header */
@@ -378,14 +658,46 @@ static jardesc_t *zip_jar_intern(char *filename) {
     /* allocate some temp heap for the central directory - better to have in mem while we process
      * it than thrash the jar file pointer */
 	len = READ_LE_INT(cd_end + END_CEN_DIR_SIZE_OFFSET);
+
+#if BVM_JAR_DIRECTORY_INDEX_ENABLE
+
+	/* a value too big for the end record means the real ones are in the ZIP64 end record */
+	if ( (entries == ZIP64_MAGIC_SHORT) || (posn == ZIP64_MAGIC) || (len == ZIP64_MAGIC) ) {
+		if (!zip_find_central_dir64(fd, size, &posn, &len)) {
+			bvm_file_close(fd);
+			bvm_throw_exception(BVM_ERR_VIRTUAL_MACHINE_ERROR, "Not a valid Jar file (bad ZIP64 end record)");
+		}
+	}
+
+	if ( (posn > size) || (size - posn < len) ) {
+		bvm_file_close(fd);
+		bvm_throw_exception(BVM_ERR_VIRTUAL_MACHINE_ERROR, "Not a valid Jar file (bad central directory)");
+	}
+
+#endif
+
     pntr = cd = bvm_heap_alloc(len, BVM_ALLOC_TYPE_STATIC);
 
     /* ... and read the central directory fully into it */
     bvm_file_setpos(fd, posn, BVM_FILE_SEEK_SET);
     bvm_file_read(cd, len, fd);
 
+#if BVM_JAR_DIRECTORY_INDEX_ENABLE
+    /* the count in the end record is 16 bits and wraps for a big jar without ZIP64 - count the entries instead */
+    entries = zip_count_entries(cd, len);
+#endif
+
     /* we now have enough information and confidence to create and populate a jardesc */
+#if BVM_JAR_DIRECTORY_INDEX_ENABLE
+    /* at least twice as many slots as entries keeps the probe chains short */
+    for (slots = 16; slots < entries * 2; slots <<= 1);
+
+    jardesc = bvm_heap_calloc(sizeof(jardesc_t) + (slots * sizeof(zip_entry_t)), BVM_ALLOC_TYPE_STATIC);
+    jardesc->central_dir = cd;
+    jardesc->entries_mask = slots - 1;
+#else
     jardesc = bvm_heap_calloc(sizeof(jardesc_t) + (entries * sizeof(bvm_uint32_t)), BVM_ALLOC_TYPE_STATIC);
+#endif
 
 	/* make a copy of the filename for storage with the jardesc */
     len = strlen(filename);
@@ -397,11 +709,21 @@ static jardesc_t *zip_jar_intern(char *filename) {
     jardesc->file = fd;
     jardesc->central_dir_offset = posn;
 
+#if BVM_FILE_MAP_ENABLE
+    /* if the jar can be mapped into memory, entries are read from the mapping instead of the file */
+    if ( (jardesc->map = bvm_file_map(fd)) != NULL)
+    	jardesc->map_size = bvm_file_sizeof(fd);
+#endif
+
     /* Scan the directory list and add the entries to our jardesc */
     while (entries--) {
 
+#if BVM_JAR_DIRECTORY_INDEX_ENABLE
+        bvm_uint32_t entry_hash, slot;
+#else
         char *pathname;
         bvm_uint32_t entry_hash, entry_offset;
+#endif
         int path_len, comment_len, extra_len;
 
         /* Check directory entry signature is present */
@@ -410,6 +732,20 @@ static jardesc_t *zip_jar_intern(char *filename) {
         /* Get the length of the pathname */
         path_len = READ_LE_SHORT(pntr + CEN_FILE_PATHLEN_OFFSET);
 
+#if BVM_JAR_DIRECTORY_INDEX_ENABLE
+
+        /* The pathname starts after the fixed part of the dir entry */
+        entry_hash = bvm_calchash(pntr + CEN_FILE_HEADER_LEN, path_len);
+
+        /* put the file header in the first free slot from its hash */
+        slot = ZIP_ENTRY_SLOT(entry_hash, jardesc->entries_mask);
+        while (jardesc->entries[slot].header != NULL) slot = (slot + 1) & jardesc->entries_mask;
+
+        jardesc->entries[slot].hash = entry_hash;
+        jardesc->entries[slot].header = pntr;
+
+#else
+
 		/* Throw a wobbly if path_len > 255.  For speed, later the assumption is made that file
 		 * names will not be longer than 255. */
         if (path_len > 255)
@@ -428,6 +764,8 @@ static jardesc_t *zip_jar_intern(char *filename) {
          * a hash of the path name. Not exact, but compact. */
         jardesc->entries[entries] = ( (pntr-cd) << 8) + entry_hash;
 
+#endif
+
         /* Skip rest of variable fields */
         extra_len   = READ_LE_SHORT(pntr + CEN_FILE_EXTRALEN_OFFSET);
         comment_len = READ_LE_SHORT(pntr + CEN_FILE_COMMENTLEN_OFFSET);
@@ -438,12 +776,16 @@ static jardesc_t *zip_jar_intern(char *filename) {
 
     zip_putjar(jardesc);
 
+#if !BVM_JAR_DIRECTORY_INDEX_ENABLE
     if (cd != NULL) bvm_heap_free(cd);
+#endif
 
     return jardesc;
 
 error:
     bvm_file_close(fd);
+    bvm_heap_free(jardesc->filename);
+    bvm_heap_free(jardesc);
     if (cd != NULL) bvm_heap_free(cd);
     return NULL;
 }
@@ -472,6 +814,254 @@ static jardesc_t *zip_get_jar_desc(char *jarname) {
 	return zip_jar_intern(jarname);
 }
 
+/**
+ * Load the file of a central directory file header in a jar into an #bvm_filebuffer_t.
+ *
+ * @param jar the jar descriptor
+ * @param fileheader the central directory file header of the file
+ *
+ * @return a handle to file buffer #bvm_filebuffer_t.
+ */
+static bvm_filebuffer_t *zip_buffer_entry(jardesc_t *jar, bvm_uint8_t *fileheader) {
+
+#if BVM_FILE_MAP_ENABLE
+	bvm_uint8_t *localfileheader;						/* the local file header */
+	bvm_uint8_t localfileheader_buf[LOC_FILE_HEADER_LEN]; /* temp area for local file header if jar is not mapped */
+#else
+	bvm_uint8_t localfileheader[LOC_FILE_HEADER_LEN];   /* temp area for local file header */
+#endif
+	bvm_uint32_t local_pathlen;						    /* length of path name in local file header */
+
+	bvm_uint32_t local_header_offset;					/* offset of local header in jar */
+	bvm_uint32_t file_data_offset;					    /* offset of actual file data in jar */
+	bvm_uint32_t comp_len;							    /* compressed length */
+	bvm_uint32_t uncomp_len;							/* uncompressed length */
+	bvm_uint16_t comp_method;							/* compression methd */
+	bvm_uint16_t local_extralen;						/* 'extra len' in local file header */
+
+	bvm_filebuffer_t *buffer = NULL;
+
+	/* Let gather all the info we can about the file from the CD record.  The file offset in the CD is only to the
+	 * beginning of the local file header - not to the actual file data.  */
+
+	/* what is the compression method used on the file */
+	comp_method = READ_LE_SHORT(fileheader + CEN_FILE_COMPMETH_OFFSET);
+
+	/* the offset of the local file header */
+	local_header_offset = ZIP_CEN_VALUE(fileheader, CEN_FILE_LOCALHDR_OFFSET);
+
+#if BVM_FILE_MAP_ENABLE
+
+	/* a mapped jar has its local file header in place, otherwise read it into a buffer */
+	if (jar->map != NULL) {
+
+		if ( (local_header_offset > jar->map_size) || (jar->map_size - local_header_offset < LOC_FILE_HEADER_LEN) )
+			bvm_throw_exception(BVM_ERR_VIRTUAL_MACHINE_ERROR, "Invalid Jar file header offset");
+
+		localfileheader = jar->map + local_header_offset;
+	} else {
+		localfileheader = localfileheader_buf;
+		bvm_file_setpos(jar->file, local_header_offset, BVM_FILE_SEEK_SET);
+		bvm_file_read(localfileheader, LOC_FILE_HEADER_LEN, jar->file);
+	}
+
+#else
+
+	/* read the local file header into a buffer */
+	bvm_file_setpos(jar->file, local_header_offset, BVM_FILE_SEEK_SET);
+	bvm_file_read(&localfileheader, LOC_FILE_HEADER_LEN, jar->file);
+
+#endif
+
+	/* Check local file header signature is present - to be sure to be sure */
+	if (READ_LE_INT(localfileheader) != LOC_FILE_HEADER_SIG) {
+		bvm_throw_exception(BVM_ERR_VIRTUAL_MACHINE_ERROR, "Invalid Jar file header sig");
+	}
+
+	/* the compressed/uncompressed lengths from the CD record.  If zero, try the local header. */
+	/* what is the uncompressed length of the file */
+	uncomp_len = ZIP_CEN_VALUE(fileheader, CEN_FILE_UNCOMPLEN_OFFSET);
+	if (uncomp_len == 0)
+		uncomp_len = READ_LE_INT(localfileheader + LOC_FILE_UNCOMPLEN_OFFSET);
+
+	/* the compressed length of the file.  If zero, try the local header.  */
+	comp_len = ZIP_CEN_VALUE(fileheader, CEN_FILE_COMPLEN_OFFSET);
+	if (comp_len == 0)
+		comp_len = READ_LE_INT(localfileheader + LOC_FILE_COMPLEN_OFFSET);
+
+	/* the path len again from the local header - should be the same as
+	 * the CD path len, but the zip spec says it can be different - so we'll make no
+	 * assumptions here */
+	local_pathlen = READ_LE_SHORT(localfileheader + LOC_FILE_PATHLEN_OFFSET);
+
+	/* the extra len in the local file header  */
+	local_extralen = READ_LE_SHORT(localfileheader + LOC_FILE_EXTRA_OFFSET);
+
+	/* calc where the file data actual begins and seek to it */
+	file_data_offset = local_header_offset + LOC_FILE_HEADER_LEN + local_pathlen + local_extralen;
+
+#if BVM_FILE_MAP_ENABLE
+
+	if (jar->map != NULL) {
+
+		/* the file data must lie wholly within the mapping */
+		if ( (file_data_offset > jar->map_size) || (jar->map_size - file_data_offset < comp_len) )
+			bvm_throw_exception(BVM_ERR_VIRTUAL_MACHINE_ERROR, "Invalid Jar file data length");
+
+		/* stored data is used in place - the buffer just points into the mapping */
+		if (comp_method == COMP_STORED)
+			return bvm_create_mapped_buffer(jar->map + file_data_offset, comp_len, BVM_ALLOC_TYPE_DATA);
+
+	} else
+		bvm_file_setpos(jar->file, file_data_offset, BVM_FILE_SEEK_SET);
+
+#else
+	bvm_file_setpos(jar->file, file_data_offset, BVM_FILE_SEEK_SET);
+#endif
+
+	/* we have now got all the information required to read the file from the jar.  We'll allocate a
+	 * buffer for the uncompressed size of the file and then get the file data into that buffer - how
+	 * that is done depends on the compression method.  At this point only DEFLATE and STORE
+	 * are supported. */
+
+	BVM_BEGIN_TRANSIENT_BLOCK {
+
+		buffer = bvm_create_buffer(uncomp_len, BVM_ALLOC_TYPE_DATA);
+
+		BVM_MAKE_TRANSIENT_ROOT(buffer);
+
+		switch(comp_method) {
+
+			case COMP_STORED:
+
+				/* easy. data is not compressed. just return it "as is" */
+				bvm_file_read(buffer->data, comp_len, jar->file);
+				return buffer;
+
+			case COMP_DEFLATED: {
+
+#if BVM_JAR_INFLATE_ENABLE
+
+				int inflate_result;
+				bvm_uint8_t *compressed_data;				/* buffer for compressed data */
+#if BVM_PROFILER_STARTUP_TRACE_ENABLE
+				bvm_uint32_t inflate_mark;
+#endif
+
+#if BVM_FILE_MAP_ENABLE
+						/* a mapped jar is inflated straight from the mapping */
+						if (jar->map != NULL)
+							compressed_data = jar->map + file_data_offset;
+						else {
+							compressed_data = bvm_heap_alloc(comp_len, BVM_ALLOC_TYPE_STATIC);
+							bvm_file_read(compressed_data, comp_len, jar->file);
+						}
+#else
+                        /* read compressed data into buffer */
+                        compressed_data = bvm_heap_alloc(comp_len, BVM_ALLOC_TYPE_STATIC);
+                        bvm_file_read(compressed_data, comp_len, jar->file);
+#endif
+
+                        BVM_PROFILER_STARTUP_MARK(inflate_mark);
+
+#if BVM_JAR_FAST_INFLATE_ENABLE
+                        inflate_result = bvm_inflate(buffer->data, &uncomp_len, compressed_data, comp_len);
+
+                        if ((inflate_result != BVM_OK)) {
+#else
+                        inflate_result = tinf_uncompress(buffer->data,
+                                                         &uncomp_len,
+                                                         compressed_data,
+                                                         comp_len);
+
+                        if ((inflate_result != TINF_OK)) {
+#endif
+                            BVM_VM_EXIT(BVM_FATAL_ERR_INFLATE_FAILED, NULL)
+                        }
+
+#if BVM_PROFILER_STARTUP_TRACE_ENABLE
+                        if (BVM_PROFILER_STARTUP_TRACING())
+                            bvm_gl_profiler_startup_inflate_micros += bvm_pd_system_time_micros() - inflate_mark;
+#endif
+
+#if BVM_FILE_MAP_ENABLE
+                        if (jar->map == NULL)
+#endif
+                        bvm_heap_free(compressed_data);
+                        return buffer;
+#else
+                        BVM_VM_EXIT(BVM_FATAL_ERR_INFLATE_NOT_ENABLED, NULL)
+				bvm_z_stream_tiny stream;
+				bvm_uint8_t *comp_data;						/* buffer for compressed data */
+
+				/* read compressed data into buffer */
+				comp_data = bvm_heap_alloc(comp_len, BVM_ALLOC_TYPE_STATIC);
+				bvm_file_read(comp_data, comp_len, jar->file);
+
+				/* TODO.  inflate will only decompress up to 64k (decompressed) data at a time.
+				 *  So, for now, max uncompressed file size is 64k - resolve (or work with) and test. */
+
+				stream.next_in   = comp_data;
+				stream.avail_in  = comp_len;
+				stream.next_out  = buffer->data;
+				stream.avail_out = uncomp_len;
+
+				/* do the business! */
+				if (bvm_inflatedata(&stream) != 0) {
+					/* problem inflating ... */
+					bvm_heap_free(buffer);
+					bvm_heap_free(comp_data);
+					return NULL;
+				}
+
+				bvm_heap_free(comp_data);
+				return buffer;
+#endif // BVM_JAR_TINYF_ENABLE
+			}
+			default:
+                        BVM_VM_EXIT(BVM_FATAL_ERR_UNKNOWN_COMPRESSION_METHOD, NULL)
+//						bvm_throw_exception(BVM_ERR_INTERNAL_ERROR,  "Unknown Jar compression mode");
+		}
+
+	} BVM_END_TRANSIENT_BLOCK
+
+	return buffer;
+}
+
+#if BVM_JAR_DIRECTORY_INDEX_ENABLE
+
+/**
+ * Find the central directory file header of a file in an interned jar.
+ *
+ * @param jar the interned jar
+ * @param pathname the path of the file in the jar
+ * @param pathlen the length of the path
+ *
+ * @return the file header in the in-memory central directory, or \c NULL if the jar has no such file.
+ */
+static bvm_uint8_t *zip_find_entry(jardesc_t *jar, char *pathname, bvm_uint32_t pathlen) {
+
+	bvm_uint32_t slot;
+	bvm_uint8_t *fileheader;
+	bvm_uint32_t hash = bvm_calchash( (bvm_uint8_t *) pathname, pathlen);
+
+	/* probe the hash table from the slot of the hash until a matching file header or an empty slot.  The
+	 * full path names are in the in-memory central directory, so the jar file is not read until the file is found. */
+	for (slot = ZIP_ENTRY_SLOT(hash, jar->entries_mask);
+		 (fileheader = jar->entries[slot].header) != NULL;
+		 slot = (slot + 1) & jar->entries_mask) {
+
+		if ( (jar->entries[slot].hash == hash) &&
+			 (READ_LE_SHORT(fileheader + CEN_FILE_PATHLEN_OFFSET) == pathlen) &&
+			 (strncmp(pathname, (char *) (fileheader + CEN_FILE_HEADER_LEN), pathlen) == 0) )
+			return fileheader;
+	}
+
+	return NULL;
+}
+
+#endif
+
 /**
  * Load a given file name in a jar into an #bvm_filebuffer_t.
  *
@@ -482,10 +1072,13 @@ static jardesc_t *zip_get_jar_desc(char *jarname) {
  */
 bvm_filebuffer_t *bvm_zip_buffer_file_from_jar(char *jarname, char *pathname) {
 
+	bvm_uint32_t pathlen;
+#if BVM_JAR_DIRECTORY_INDEX_ENABLE
+	bvm_uint8_t *fileheader;
+#else
 	bvm_uint32_t hash;
 	bvm_int32_t lc;
-	bvm_uint32_t pathlen;
-	bvm_filebuffer_t *buffer = NULL;
+#endif
 
 	/* let's get a jar descriptor - this will intern the jar if it is not
 	 * already interned */
@@ -494,8 +1087,15 @@ bvm_filebuffer_t *bvm_zip_buffer_file_from_jar(char *jarname, char *pathname) {
 	/* Trouble loading jar or it is non existent will mean 'jar' is NULL. */
 	if (jar == NULL) return NULL;
 
-	/* calc an 8 bit hash of the required file name */
 	pathlen = strlen(pathname);
+
+#if BVM_JAR_DIRECTORY_INDEX_ENABLE
+
+	if ( (fileheader = zip_find_entry(jar, pathname, pathlen)) != NULL) return zip_buffer_entry(jar, fileheader);
+
+#else
+
+	/* calc an 8 bit hash of the required file name */
 	hash = bvm_calchash( (bvm_uint8_t *) pathname, pathlen) % 255;
 
 	lc = jar->entries_count;
@@ -516,17 +1116,8 @@ bvm_filebuffer_t *bvm_zip_buffer_file_from_jar(char *jarname, char *pathname) {
 		if ( (jar->entries[lc] & 0xFF) == hash) {		/* the 0xFF mask is to get the lower 8 bits */
 
 			bvm_uint8_t fileheader[CEN_FILE_HEADER_LEN+255];	/* temp area cd file header + 255 chars for path name.*/
-			bvm_uint8_t localfileheader[LOC_FILE_HEADER_LEN];   /* temp area for local file header */
 			bvm_uint32_t jar_pathlen;							/* the path name len in the cd file header */
 			char *jar_pathname;							        /* temp debug pointer to cd file header path name */
-			bvm_uint32_t local_pathlen;						    /* length of path name in local file header */
-
-			bvm_uint32_t local_header_offset;					/* offset of local header in jar */
-			bvm_uint32_t file_data_offset;					    /* offset of actual file data in jar */
-			bvm_uint32_t comp_len;							    /* compressed length */
-			bvm_uint32_t uncomp_len;							/* uncompressed length */
-			bvm_uint16_t comp_method;							/* compression methd */
-			bvm_uint16_t local_extralen;						/* 'extra len' in local file header */
 
 			/* the offset of the CD file header - the right shift is to get rid of the file name hash. */
 			bvm_uint32_t offset = jar->central_dir_offset + (jar->entries[lc] >> 8);
@@ -554,129 +1145,461 @@ bvm_filebuffer_t *bvm_zip_buffer_file_from_jar(char *jarname, char *pathname) {
 			 * pathnames in the jar file are not null-terminated. */
 			if (strncmp(pathname, jar_pathname, pathlen) != 0) continue;
 
-			/*** At this point, we have a found the file header we are looking for.  Let gather all the
-			info we can about the file from the CD record.  The file offset in the CD is only to the
-			beginning of the local file header - not to the actual file data.  */
+			/* At this point, we have a found the file header we are looking for. */
+			return zip_buffer_entry(jar, fileheader);
+		}
+	}
 
-			/* what is the compression method used on the file */
-			comp_method = READ_LE_SHORT(fileheader + CEN_FILE_COMPMETH_OFFSET);
+#endif
 
-			/* the offset of the local file header */
-	        local_header_offset = READ_LE_INT(fileheader + CEN_FILE_LOCALHDR_OFFSET);
+	return NULL;
+}
 
-			/* read the local file header into a buffer */
-			bvm_file_setpos(jar->file, local_header_offset, BVM_FILE_SEEK_SET);
-			bvm_file_read(&localfileheader, LOC_FILE_HEADER_LEN, jar->file);
+#if BVM_JAR_DIRECTORY_INDEX_ENABLE
 
-			/* Check local file header signature is present - to be sure to be sure */
-			if (READ_LE_INT(localfileheader) != LOC_FILE_HEADER_SIG) {
-				bvm_throw_exception(BVM_ERR_VIRTUAL_MACHINE_ERROR, "Invalid Jar file header sig");
-			}
+/**
+ * Call a function with the path name of each file in a jar.  The path names given are not null terminated - they
+ * point into the in-memory central directory of the jar, which is kept until the jar is closed.  Files are given in
+ * no particular order.
+ *
+ * @param jarname the name of the jar file
+ * @param callback the function to call for each file, with its path name, the length of the path name, and \c data
+ * @param data passed to \c callback
+ *
+ * @return #BVM_TRUE if the jar was opened, #BVM_FALSE if not.
+ */
+bvm_bool_t bvm_zip_for_each_file(char *jarname, void (*callback)(bvm_uint8_t *, bvm_uint32_t, void *), void *data) {
 
-			/* the compressed/uncompressed lengths from the CD record.  If zero, try the local header. */
-			/* what is the uncompressed length of the file */
-			uncomp_len = READ_LE_INT(fileheader + CEN_FILE_UNCOMPLEN_OFFSET);
-			if (uncomp_len == 0)
-				uncomp_len = READ_LE_INT(localfileheader + LOC_FILE_UNCOMPLEN_OFFSET);
+	bvm_uint32_t slot;
 
-			/* the compressed length of the file.  If zero, try the local header.  */
-			comp_len = READ_LE_INT(fileheader + CEN_FILE_COMPLEN_OFFSET);
-			if (comp_len == 0)
-				comp_len = READ_LE_INT(localfileheader + LOC_FILE_COMPLEN_OFFSET);
+	jardesc_t *jar = zip_get_jar_desc(jarname);
 
-			/* the path len again from the local header - should be the same as
-			 * the CD path len, but the zip spec says it can be different - so we'll make no
-			 * assumptions here */
-			local_pathlen = READ_LE_SHORT(localfileheader + LOC_FILE_PATHLEN_OFFSET);
+	if (jar == NULL) return BVM_FALSE;
 
-			/* the extra len in the local file header  */
-			local_extralen = READ_LE_SHORT(localfileheader + LOC_FILE_EXTRA_OFFSET);
+	for (slot = 0; slot <= jar->entries_mask; slot++) {
 
-	        /* calc where the file data actual begins and seek to it */
-			file_data_offset = local_header_offset + LOC_FILE_HEADER_LEN + local_pathlen + local_extralen;
-			bvm_file_setpos(jar->file, file_data_offset, BVM_FILE_SEEK_SET);
+		bvm_uint8_t *fileheader = jar->entries[slot].header;
 
-			/* we have now got all the information required to read the file from the jar.  We'll allocate a
-			 * buffer for the uncompressed size of the file and then get the file data into that buffer - how
-			 * that is done depends on the compression method.  At this point only DEFLATE and STORE
-			 * are supported. */
+		if (fileheader != NULL)
+			callback(fileheader + CEN_FILE_HEADER_LEN, READ_LE_SHORT(fileheader + CEN_FILE_PATHLEN_OFFSET), data);
+	}
 
-			BVM_BEGIN_TRANSIENT_BLOCK {
+	return BVM_TRUE;
+}
 
-				buffer = bvm_create_buffer(uncomp_len, BVM_ALLOC_TYPE_DATA);
+#endif
 
-				BVM_MAKE_TRANSIENT_ROOT(buffer);
+#if BVM_VM_SNAPSHOT_ENABLE
 
-				switch(comp_method) {
+/**
+ * Close every interned jar and forget it, giving back its mapping and heap.  A jar is interned again the next time a
+ * file is read from it.  Used before a VM snapshot is written - an open file or mapping cannot be restored.
+ */
+void bvm_zip_close_jars() {
 
-					case COMP_STORED:
+	int sz = jars_sz;
 
-						/* easy. data is not compressed. just return it "as is" */
-						bvm_file_read(buffer->data, comp_len, jar->file);
-						return buffer;
+	if (jars == NULL) return;
 
-					case COMP_DEFLATED: {
+	while (--sz) {
 
-#if BVM_JAR_INFLATE_ENABLE
+		jardesc_t *jar = jars[sz];
 
-						int inflate_result;
-						bvm_uint8_t *compressed_data;				/* buffer for compressed data */
+		if (jar != NULL) {
+			bvm_file_close(jar->file);
+#if BVM_JAR_DIRECTORY_INDEX_ENABLE
+			bvm_heap_free(jar->central_dir);
+#endif
+			bvm_heap_free(jar->filename);
+			bvm_heap_free(jar);
+		}
+	}
 
-                        /* read compressed data into buffer */
-                        compressed_data = bvm_heap_alloc(comp_len, BVM_ALLOC_TYPE_STATIC);
-                        bvm_file_read(compressed_data, comp_len, jar->file);
+	bvm_heap_free(jars);
+	jars = NULL;
+}
 
-                        inflate_result = tinf_uncompress(buffer->data,
-                                                         &uncomp_len,
-                                                         compressed_data,
-                                                         comp_len);
+#endif
 
-                        if ((inflate_result != TINF_OK)) {
-                            BVM_VM_EXIT(BVM_FATAL_ERR_INFLATE_FAILED, NULL)
-                        }
+#if BVM_CLAZZ_PRELOAD_ENABLE
 
-                        bvm_heap_free(compressed_data);
-                        return buffer;
-#else
-                        BVM_VM_EXIT(BVM_FATAL_ERR_INFLATE_NOT_ENABLED, NULL)
-						bvm_z_stream_tiny stream;
-						bvm_uint8_t *comp_data;						/* buffer for compressed data */
-
-						/* read compressed data into buffer */
-						comp_data = bvm_heap_alloc(comp_len, BVM_ALLOC_TYPE_STATIC);
-						bvm_file_read(comp_data, comp_len, jar->file);
-
-						/* TODO.  inflate will only decompress up to 64k (decompressed) data at a time.
-						 *  So, for now, max uncompressed file size is 64k - resolve (or work with) and test. */
-
-						stream.next_in   = comp_data;
-						stream.avail_in  = comp_len;
-						stream.next_out  = buffer->data;
-						stream.avail_out = uncomp_len;
-
-						/* do the business! */
-						if (bvm_inflatedata(&stream) != 0) {
-							/* problem inflating ... */
-							bvm_heap_free(buffer);
-							bvm_heap_free(comp_data);
-							return NULL;
-						}
+/** The size of the window a jar that is not mapped is read through by #bvm_zip_read_files */
+#define ZIP_READ_WINDOW_SIZE	0x10000
 
-						bvm_heap_free(comp_data);
-						return buffer;
-#endif // BVM_JAR_TINYF_ENABLE
-					}
-					default:
-                        BVM_VM_EXIT(BVM_FATAL_ERR_UNKNOWN_COMPRESSION_METHOD, NULL)
-//						bvm_throw_exception(BVM_ERR_INTERNAL_ERROR,  "Unknown Jar compression mode");
-				} BVM_END_TRANSIENT_BLOCK
+/**
+ * A file to be read by #bvm_zip_read_files.
+ */
+typedef struct _zipreadstruct {
 
-			}
-			break;
+	/** the offset of the local file header of the file in the jar */
+	bvm_uint32_t offset;
+
+	/** the index of the file in the path names given */
+	bvm_uint32_t index;
+
+	/** the central directory file header of the file */
+	bvm_uint8_t *fileheader;
+
+	/** the interned jar of the file */
+	jardesc_t *jar;
+
+} zip_read_t;
+
+/**
+ * The bytes of a jar that is not mapped, as last read by #zip_read_bytes.
+ */
+typedef struct _zipwindowstruct {
+
+	/** the bytes read */
+	bvm_uint8_t *data;
+
+	/** the offset in the jar of the bytes read */
+	bvm_uint32_t offset;
+
+	/** the number of bytes read */
+	bvm_uint32_t length;
+
+	/** the size of the jar file */
+	bvm_uint32_t size;
+
+} zip_window_t;
+
+/**
+ * The files to be read by #zip_run_reads, in the order they are to be read.
+ */
+typedef struct _zipreadsstruct {
+
+	/** the window a jar that is not mapped is read through */
+	zip_window_t window;
+
+#if BVM_JAR_FAST_INFLATE_ENABLE
+	/** the tables to inflate with, or \c NULL to use those of #bvm_inflate */
+	bvm_inflate_work_t *work;
+#endif
+
+	/** the number of files */
+	bvm_uint32_t count;
+
+	/** the files */
+	zip_read_t files[1];
+
+} zip_reads_t;
+
+/**
+ * A \c qsort comparison of two files to read - the one first in the jar first.
+ */
+static int zip_compare_reads(const void *a, const void *b) {
+
+	bvm_uint32_t offset_a = ((const zip_read_t *) a)->offset;
+	bvm_uint32_t offset_b = ((const zip_read_t *) b)->offset;
+
+	return (offset_a < offset_b) ? -1 : (offset_a > offset_b);
+}
+
+/**
+ * Get some bytes of a jar for #bvm_zip_read_files - from the mapping of a mapped jar, or else through a window read
+ * from the jar file.  The window is only read again when the bytes are not already in it, and files are read in jar
+ * order, so the jar is read front to back in few large reads rather than a seek and read or two for each file.
+ *
+ * @param jar the interned jar
+ * @param window the window, if the jar is not mapped
+ * @param offset the offset in the jar of the bytes
+ * @param length the number of bytes
+ *
+ * @return a pointer to the bytes, or \c NULL if they are not all in the jar or will not fit in the window.
+ */
+static bvm_uint8_t *zip_read_bytes(jardesc_t *jar, zip_window_t *window, bvm_uint32_t offset, bvm_uint32_t length) {
+
+#if BVM_FILE_MAP_ENABLE
+	if (jar->map != NULL)
+		return ( (offset > jar->map_size) || (jar->map_size - offset < length) ) ? NULL : jar->map + offset;
+#endif
+
+	if ( (offset > window->size) || (window->size - offset < length) || (length > ZIP_READ_WINDOW_SIZE) ) return NULL;
+
+	if ( (offset < window->offset) || (offset - window->offset + length > window->length) ) {
+
+		window->offset = offset;
+		window->length = (window->size - offset < ZIP_READ_WINDOW_SIZE) ? window->size - offset : ZIP_READ_WINDOW_SIZE;
+
+		bvm_file_setpos(jar->file, offset, BVM_FILE_SEEK_SET);
+		if (bvm_file_read(window->data, window->length, jar->file) != window->length) {
+			window->length = 0;
+			return NULL;
 		}
 	}
 
-	return buffer;
+	return window->data + (offset - window->offset);
+}
+
+/**
+ * Read and inflate a file for #zip_run_reads into memory from #bvm_pd_memory_alloc.
+ *
+ * @param reads the files being read
+ * @param read the file
+ * @param length where to put the length of the file
+ *
+ * @return the file bytes, or \c NULL if the file could not be read, or need not be.
+ */
+static bvm_uint8_t *zip_read_file(zip_reads_t *reads, zip_read_t *read, bvm_uint32_t *length) {
+
+	jardesc_t *jar = read->jar;
+	zip_window_t *window = &reads->window;
+	bvm_uint8_t *fileheader = read->fileheader;
+	bvm_uint8_t *localfileheader;
+	bvm_uint8_t *compressed_data;
+	bvm_uint8_t *bytes;
+	bvm_uint32_t local_header_offset, file_data_offset, comp_len, uncomp_len;
+	bvm_uint16_t comp_method = READ_LE_SHORT(fileheader + CEN_FILE_COMPMETH_OFFSET);
+
+	local_header_offset = ZIP_CEN_VALUE(fileheader, CEN_FILE_LOCALHDR_OFFSET);
+
+	localfileheader = zip_read_bytes(jar, window, local_header_offset, LOC_FILE_HEADER_LEN);
+	if ( (localfileheader == NULL) || (READ_LE_INT(localfileheader) != LOC_FILE_HEADER_SIG) ) return NULL;
+
+	uncomp_len = ZIP_CEN_VALUE(fileheader, CEN_FILE_UNCOMPLEN_OFFSET);
+	if (uncomp_len == 0)
+		uncomp_len = READ_LE_INT(localfileheader + LOC_FILE_UNCOMPLEN_OFFSET);
+
+	comp_len = ZIP_CEN_VALUE(fileheader, CEN_FILE_COMPLEN_OFFSET);
+	if (comp_len == 0)
+		comp_len = READ_LE_INT(localfileheader + LOC_FILE_COMPLEN_OFFSET);
+
+	file_data_offset = local_header_offset + LOC_FILE_HEADER_LEN + READ_LE_SHORT(localfileheader + LOC_FILE_PATHLEN_OFFSET) +
+					   READ_LE_SHORT(localfileheader + LOC_FILE_EXTRA_OFFSET);
+
+#if BVM_FILE_MAP_ENABLE
+	/* a stored file of a mapped jar is used in place anyway */
+	if ( (jar->map != NULL) && (comp_method == COMP_STORED) ) return NULL;
+#endif
+
+#if BVM_JAR_INFLATE_ENABLE
+	if ( (comp_method != COMP_STORED) && (comp_method != COMP_DEFLATED) ) return NULL;
+#else
+	if (comp_method != COMP_STORED) return NULL;
+#endif
+
+	if ( (compressed_data = zip_read_bytes(jar, window, file_data_offset, comp_len)) == NULL) return NULL;
+
+	if ( (bytes = bvm_pd_memory_alloc( (uncomp_len > 0) ? uncomp_len : 1)) == NULL) return NULL;
+
+	if (comp_method == COMP_STORED) {
+		memcpy(bytes, compressed_data, comp_len);
+		*length = comp_len;
+		return bytes;
+	}
+
+#if BVM_JAR_INFLATE_ENABLE
+#if BVM_JAR_FAST_INFLATE_ENABLE
+	if ( ((reads->work != NULL) ? bvm_inflate_with(reads->work, bytes, &uncomp_len, compressed_data, comp_len) :
+								  bvm_inflate(bytes, &uncomp_len, compressed_data, comp_len)) == BVM_OK) {
+#else
+	if (tinf_uncompress(bytes, &uncomp_len, compressed_data, comp_len) == TINF_OK) {
+#endif
+		*length = uncomp_len;
+		return bytes;
+	}
+#endif
+
+	bvm_pd_memory_free(bytes);
+	return NULL;
+}
+
+/**
+ * Create an empty list of files to read with #zip_run_reads.
+ *
+ * @param count the most files to be added with #zip_add_read
+ *
+ * @return the list, in memory from #bvm_pd_memory_alloc, or \c NULL if there is no memory for it.
+ */
+static zip_reads_t *zip_create_reads(bvm_uint32_t count) {
+
+	zip_reads_t *reads = bvm_pd_memory_alloc(sizeof(zip_reads_t) + count * sizeof(zip_read_t));
+
+	if (reads != NULL) {
+		reads->window.data = NULL;
+		reads->window.offset = 0;
+		reads->window.length = 0;
+		reads->window.size = 0;
+#if BVM_JAR_FAST_INFLATE_ENABLE
+		reads->work = NULL;
+#endif
+		reads->count = 0;
+	}
+
+	return reads;
+}
+
+/**
+ * Add a file of a jar to a list of files to read, if the jar has it.
+ *
+ * @param reads the list
+ * @param jar the interned jar
+ * @param pathname the path name of the file in the jar
+ * @param index the index given to the callback of #zip_run_reads with the file
+ */
+static void zip_add_read(zip_reads_t *reads, jardesc_t *jar, char *pathname, bvm_uint32_t index) {
+
+	bvm_uint8_t *fileheader = zip_find_entry(jar, pathname, strlen(pathname));
+
+	if (fileheader != NULL) {
+		reads->files[reads->count].offset = ZIP_CEN_VALUE(fileheader, CEN_FILE_LOCALHDR_OFFSET);
+		reads->files[reads->count].index = index;
+		reads->files[reads->count].fileheader = fileheader;
+		reads->files[reads->count++].jar = jar;
+	}
+}
+
+/**
+ * Read a list of files, giving each to a callback, and then give back the memory of the list.
+ *
+ * @param reads the files to read
+ * @param wanted if not \c NULL, asked with the index of each file and \c data before the file is read - a file it
+ * does not want is skipped.
+ * @param callback the function to call for each file read
+ * @param data passed to \c wanted and \c callback
+ */
+static void zip_run_reads(zip_reads_t *reads, bvm_bool_t (*wanted)(bvm_uint32_t, void *),
+						  void (*callback)(bvm_uint32_t, bvm_uint8_t *, bvm_uint32_t, void *), void *data) {
+
+	bvm_uint32_t lc, length;
+	bvm_uint8_t *bytes;
+
+	for (lc = 0; lc < reads->count; lc++) {
+
+		if ( (wanted != NULL) && !wanted(reads->files[lc].index, data) ) continue;
+
+		if ( (bytes = zip_read_file(reads, &reads->files[lc], &length)) != NULL)
+			callback(reads->files[lc].index, bytes, length, data);
+	}
+
+	if (reads->window.data != NULL) bvm_pd_memory_free(reads->window.data);
+	bvm_pd_memory_free(reads);
+}
+
+/**
+ * Read and inflate a number of files of a jar in one pass, in the order they are in the jar rather than the order
+ * they are given.  A jar that is not mapped is read through a window of #ZIP_READ_WINDOW_SIZE bytes, so files that
+ * are together in the jar take one read between them.  Each file read is given to a callback in memory from
+ * #bvm_pd_memory_alloc, which the callback then owns.
+ *
+ * A file that is not in the jar, or that cannot be read in one go, or is a stored file of a mapped jar (which is used
+ * in place anyway) is just not given to the callback.
+ *
+ * @param jarname the name of the jar file
+ * @param pathnames the path names of the files in the jar
+ * @param count the number of path names
+ * @param callback the function to call for each file read, with the index of its path name, its bytes, their length,
+ * and \c data
+ * @param data passed to \c callback
+ *
+ * @return #BVM_TRUE if the jar was opened, #BVM_FALSE if not.
+ */
+bvm_bool_t bvm_zip_read_files(char *jarname, char *pathnames[], bvm_uint32_t count,
+							  void (*callback)(bvm_uint32_t, bvm_uint8_t *, bvm_uint32_t, void *), void *data) {
+
+	bvm_uint32_t lc;
+	zip_reads_t *reads;
+	jardesc_t *jar = zip_get_jar_desc(jarname);
+
+	if (jar == NULL) return BVM_FALSE;
+
+	if ( (reads = zip_create_reads(count)) == NULL) return BVM_TRUE;
+
+	for (lc = 0; lc < count; lc++) zip_add_read(reads, jar, pathnames[lc], lc);
+
+	qsort(reads->files, reads->count, sizeof(zip_read_t), zip_compare_reads);
+
+#if BVM_FILE_MAP_ENABLE
+	if (jar->map == NULL)
+#endif
+	{
+		reads->window.size = (bvm_uint32_t) bvm_file_sizeof(jar->file);
+		if ( (reads->window.data = bvm_pd_memory_alloc(ZIP_READ_WINDOW_SIZE)) == NULL) reads->count = 0;
+	}
+
+	zip_run_reads(reads, NULL, callback, data);
+
+	return BVM_TRUE;
 }
 
+#if BVM_CLAZZ_PREFETCH_ENABLE
+
+/**
+ * Report whether a jar is mapped into memory.
+ *
+ * @param jarname the name of the jar file
+ *
+ * @return #BVM_TRUE if the jar could be opened and is mapped, #BVM_FALSE if not.
+ */
+bvm_bool_t bvm_zip_is_mapped(char *jarname) {
+
+	jardesc_t *jar = zip_get_jar_desc(jarname);
+
+	return (bvm_bool_t) ( (jar != NULL) && (jar->map != NULL) );
+}
 
+/**
+ * Find a number of files of mapped jars to be read later, in the order given, by #bvm_zip_read_prepared_files - which
+ * may be called from another OS thread.  Nothing of the VM is used by that read but the mappings of the jars, so the
+ * jars must stay open until it is done.  A file that is not found, or is of a jar that is not mapped, is left out.
+ *
+ * @param jarnames the name of the jar of each file
+ * @param pathnames the path name of each file in its jar
+ * @param count the number of files
+ *
+ * @return the files to read, or \c NULL if there is no memory for them.
+ */
+void *bvm_zip_prepare_read_files(char *jarnames[], char *pathnames[], bvm_uint32_t count) {
+
+	bvm_uint32_t lc;
+	jardesc_t *jar;
+	zip_reads_t *reads = zip_create_reads(count);
+
+	if (reads == NULL) return NULL;
+
+	for (lc = 0; lc < count; lc++) {
+		if ( ((jar = zip_get_jar_desc(jarnames[lc])) != NULL) && (jar->map != NULL) )
+			zip_add_read(reads, jar, pathnames[lc], lc);
+	}
+
+	return reads;
+}
+
+/**
+ * Read the files found by #bvm_zip_prepare_read_files as #bvm_zip_read_files does, and give back \c reads.  May be
+ * called from an OS thread other than the VM's - the files are inflated with tables of its own.
+ *
+ * @param reads the files to read
+ * @param wanted asked with the index of each file and \c data before the file is read - a file it does not want is
+ * skipped.
+ * @param callback the function to call for each file read, with the index of the file, its bytes, their length, and
+ * \c data
+ * @param data passed to \c wanted and \c callback
+ */
+void bvm_zip_read_prepared_files(void *reads, bvm_bool_t (*wanted)(bvm_uint32_t, void *),
+								 void (*callback)(bvm_uint32_t, bvm_uint8_t *, bvm_uint32_t, void *), void *data) {
+
+	zip_reads_t *zip_reads = reads;
+
+#if BVM_JAR_FAST_INFLATE_ENABLE
+	bvm_inflate_work_t *work = bvm_inflate_work_create();
+
+	if (work == NULL) {
+		bvm_pd_memory_free(zip_reads);
+		return;
+	}
+
+	zip_reads->work = work;
+#endif
+
+	zip_run_reads(zip_reads, wanted, callback, data);
+
+#if BVM_JAR_FAST_INFLATE_ENABLE
+	bvm_pd_memory_free(work);
+#endif
+}
+
+#endif
+
+#endif
@@ -0,0 +1,212 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#ifndef BVM_AOT_H_
+#define BVM_AOT_H_
+
+/**
+  @file
+
+  Constants/Macros/Functions/Types for the ahead-of-time bytecode to C translator.
+
+  The \c BVM_AOT_ macros are what the generated C is written in.  Each works on the locals \c l and the stack
+  pointer \c s of the frame the generated function was given, just as the interpreter handler of the same opcode does
+  with the VM registers.  Those that take a \c pc stop at that instruction - leaving it to the interpreter - where
+  the interpreter would throw.
+
+  @author Greg McCreath
+  @since 0.0.10
+
+*/
+
+#if BVM_AOT_ENABLE
+
+extern BVM_VM_LOCAL char *bvm_gl_aot_write_filename;
+extern BVM_VM_LOCAL char *bvm_gl_aot_classes;
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_aot_method_count;
+
+void bvm_aot_init();
+void bvm_aot_register_methods();
+void bvm_aot_link(bvm_method_t *method, bvm_uint8_t *code, bvm_uint32_t code_length);
+bvm_uint8_t *bvm_aot_run(bvm_method_t *method, bvm_cell_t *locals, bvm_cell_t **sp, bvm_uint8_t *pc);
+bvm_bool_t bvm_aot_write(const char *filename);
+void bvm_aot_release();
+
+/** Start of a generated function - take a working copy of the stack pointer */
+#define BVM_AOT_ENTER 		bvm_cell_t *s = *sp; (void) l;
+
+/** Stop at the instruction at \c pc - the interpreter carries on from there */
+#define BVM_AOT_STOP(pc) 	{ *sp = s; return (pc); }
+
+/** Stop at \c pc if it is time for a thread switch - as the JIT, on backwards branches only */
+#if BVM_THREAD_TIMER_PREEMPTION_ENABLE
+#define BVM_AOT_YIELD(pc) 	if (bvm_gl_thread_switch_requested) BVM_AOT_STOP(pc)
+#else
+#define BVM_AOT_YIELD(pc) 	if (bvm_gl_thread_timeslice_counter == 0) BVM_AOT_STOP(pc) else bvm_gl_thread_timeslice_counter--;
+#endif
+
+/** Branch forwards, or backwards, to the instruction at \c t */
+#define BVM_AOT_GOTO(t) 	goto L##t;
+#define BVM_AOT_BACK(t) 	{ BVM_AOT_YIELD(t) goto L##t; }
+
+#define BVM_AOT_INT(c) 		((bvm_int32_t) (c).int_value)
+#define BVM_AOT_UINT(c) 	((bvm_uint32_t) (c).int_value)
+
+#define BVM_AOT_ACONST_NULL { s[0].ref_value = NULL; s++; }
+#define BVM_AOT_ICONST(v) 	{ s[0].int_value = (v); s++; }
+#define BVM_AOT_LCONST(v) 	{ s[0].int_value = 0; s[1].int_value = (v); s += 2; }
+
+#define BVM_AOT_LOAD(n) 	{ s[0] = l[n]; s++; }
+#define BVM_AOT_LOAD2(n) 	{ s[0] = l[n]; s[1] = l[(n)+1]; s += 2; }
+#define BVM_AOT_STORE(n) 	{ s--; l[n] = s[0]; }
+#define BVM_AOT_STORE2(n) 	{ s -= 2; l[n] = s[0]; l[(n)+1] = s[1]; }
+#define BVM_AOT_IINC(n, v) 	{ l[n].int_value = (bvm_int32_t) (BVM_AOT_UINT(l[n]) + (bvm_uint32_t) (v)); }
+
+#define BVM_AOT_POP 		{ s--; }
+#define BVM_AOT_POP2 		{ s -= 2; }
+#define BVM_AOT_DUP 		{ s[0] = s[-1]; s++; }
+#define BVM_AOT_DUP_X1 		{ s[0] = s[-1]; s[-1] = s[-2]; s[-2] = s[0]; s++; }
+#define BVM_AOT_DUP_X2 		{ s[0] = s[-1]; s[-1] = s[-2]; s[-2] = s[-3]; s[-3] = s[0]; s++; }
+#define BVM_AOT_DUP2 		{ s[1] = s[-1]; s[0] = s[-2]; s += 2; }
+#define BVM_AOT_DUP2_X1 	{ s[1] = s[-1]; s[0] = s[-2]; s[-1] = s[-3]; s[-2] = s[1]; s[-3] = s[0]; s += 2; }
+#define BVM_AOT_DUP2_X2 	{ s[1] = s[-1]; s[0] = s[-2]; s[-1] = s[-3]; s[-2] = s[-4]; s[-3] = s[1]; s[-4] = s[0]; s += 2; }
+#define BVM_AOT_SWAP 		{ bvm_cell_t v = s[-2]; s[-2] = s[-1]; s[-1] = v; }
+
+/** An int \c + \c - \c * \c & \c | or \c ^ - done unsigned so that overflow wraps as Java says it does */
+#define BVM_AOT_IARITH(op) 	{ s--; s[-1].int_value = (bvm_int32_t) (BVM_AOT_UINT(s[-1]) op BVM_AOT_UINT(s[0])); }
+#define BVM_AOT_INEG 		{ s[-1].int_value = (bvm_int32_t) (0 - BVM_AOT_UINT(s[-1])); }
+#define BVM_AOT_ISHL 		{ s--; s[-1].int_value = (bvm_int32_t) (BVM_AOT_UINT(s[-1]) << (BVM_AOT_INT(s[0]) & 0x1F)); }
+#define BVM_AOT_ISHR 		{ s--; s[-1].int_value = BVM_AOT_INT(s[-1]) >> (BVM_AOT_INT(s[0]) & 0x1F); }
+#define BVM_AOT_IUSHR 		{ s--; s[-1].int_value = (bvm_int32_t) (BVM_AOT_UINT(s[-1]) >> (BVM_AOT_INT(s[0]) & 0x1F)); }
+
+#define BVM_AOT_IDIV(pc) {																		\
+	bvm_int32_t left = BVM_AOT_INT(s[-2]), right = BVM_AOT_INT(s[-1]);							\
+	if (right == 0) BVM_AOT_STOP(pc)																\
+	s--;																						\
+	s[-1].int_value = ( (left == BVM_MIN_INT) && (right == -1) ) ? left : left / right;			\
+}
+
+#define BVM_AOT_IREM(pc) {																		\
+	bvm_int32_t left = BVM_AOT_INT(s[-2]), right = BVM_AOT_INT(s[-1]);							\
+	if (right == 0) BVM_AOT_STOP(pc)																\
+	s--;																						\
+	s[-1].int_value = ( (left == BVM_MIN_INT) && (right == -1) ) ? 0 : left % right;				\
+}
+
+#define BVM_AOT_I2B 		{ s[-1].int_value = (bvm_int8_t) BVM_AOT_INT(s[-1]); }
+#define BVM_AOT_I2C 		{ s[-1].int_value = (bvm_uint16_t) BVM_AOT_INT(s[-1]); }
+#define BVM_AOT_I2S 		{ s[-1].int_value = (bvm_int16_t) BVM_AOT_INT(s[-1]); }
+
+/** A long operation written with the int64.h macros, so it is right for native or emulated 64 bit ints */
+#define BVM_AOT_LOP(stmt) {																		\
+	bvm_int64_t left = BVM_INT64_from_cells(s - 4), right = BVM_INT64_from_cells(s - 2);		\
+	stmt;																						\
+	BVM_INT64_to_cells(s - 4, left);															\
+	s -= 2;																						\
+}
+
+#define BVM_AOT_LADD 		BVM_AOT_LOP(BVM_INT64_increase(left, right))
+#define BVM_AOT_LSUB 		BVM_AOT_LOP(BVM_INT64_decrease(left, right))
+#define BVM_AOT_LMUL 		BVM_AOT_LOP(left = BVM_INT64_mul(left, right))
+
+/* and, or, xor work cell by cell on the two halves, as the interpreter does */
+#define BVM_AOT_LLOGIC(op) 	{ s[-3].int_value op s[-1].int_value; s[-4].int_value op s[-2].int_value; s -= 2; }
+
+#define BVM_AOT_LDIV(pc) {																		\
+	if (BVM_INT64_zero_eq(BVM_INT64_from_cells(s - 2))) BVM_AOT_STOP(pc)							\
+	BVM_AOT_LOP(if (!(BVM_INT64_compare_eq(BVM_MIN_LONG, left) && BVM_INT64_compare_eq(BVM_INT64_MINUS_ONE, right))) left = BVM_INT64_div(left, right))	\
+}
+
+#define BVM_AOT_LREM(pc) {																		\
+	if (BVM_INT64_zero_eq(BVM_INT64_from_cells(s - 2))) BVM_AOT_STOP(pc)							\
+	BVM_AOT_LOP(if (BVM_INT64_compare_eq(BVM_MIN_LONG, left) && BVM_INT64_compare_eq(BVM_INT64_MINUS_ONE, right)) left = BVM_INT64_ZERO; else left = BVM_INT64_rem(left, right))	\
+}
+
+#define BVM_AOT_LNEG 		{ bvm_int64_t value = BVM_INT64_from_cells(s - 2); BVM_INT64_negate(value); BVM_INT64_to_cells(s - 2, value); }
+
+/** A long shift by the low 6 bits of the int on top - \c f is one of \c BVM_INT64_shl, \c shr or \c ushr */
+#define BVM_AOT_LSHIFT(f) 	{ s--; BVM_INT64_to_cells(s - 2, f(BVM_INT64_from_cells(s - 2), BVM_AOT_INT(s[0]) & 0x3F)); }
+
+#define BVM_AOT_LCMP {																			\
+	bvm_int64_t left = BVM_INT64_from_cells(s - 4), right = BVM_INT64_from_cells(s - 2);		\
+	s[-4].int_value = BVM_INT64_compare_eq(left, right) ? 0 : BVM_INT64_compare_lt(left, right) ? -1 : 1;	\
+	s -= 3;																						\
+}
+
+#define BVM_AOT_I2L 		{ bvm_int64_t value; BVM_INT64_int32_to_int64(value, BVM_AOT_INT(s[-1])); BVM_INT64_to_cells(s - 1, value); s++; }
+#define BVM_AOT_L2I 		{ bvm_int64_t value = BVM_INT64_from_cells(s - 2); bvm_uint32_t low; BVM_INT64_int64_to_uint32(value, low); s[-2].int_value = (bvm_int32_t) low; s--; }
+
+/** The conditions of the \c if opcodes.  Each pops its operands. */
+#define BVM_AOT_IF(op) 		(s--, BVM_AOT_INT(s[0]) op 0)
+#define BVM_AOT_IF_ICMP(op) (s -= 2, BVM_AOT_INT(s[0]) op BVM_AOT_INT(s[1]))
+#define BVM_AOT_IF_ACMP(op) (s -= 2, s[0].ref_value op s[1].ref_value)
+#define BVM_AOT_IFNULL(op) 	(s--, s[0].ref_value op NULL)
+
+/** The key of a \c tableswitch or \c lookupswitch - popped */
+#define BVM_AOT_SWITCH 		(s--, BVM_AOT_INT(s[0]))
+
+#define BVM_AOT_ARRAYLENGTH(pc) {																\
+	if (s[-1].ref_value == NULL) BVM_AOT_STOP(pc)												\
+	s[-1].int_value = ((bvm_jarray_obj_t *) s[-1].ref_value)->length.int_value;				\
+}
+
+/** Load an element of an array of \c type - stops if the array is \c null or the index is out of bounds */
+#define BVM_AOT_XALOAD(type, pc) {																\
+	bvm_jarray_obj_t *array_obj = (bvm_jarray_obj_t *) s[-2].ref_value;						\
+	bvm_int32_t index = BVM_AOT_INT(s[-1]);														\
+	if ( (array_obj == NULL) || (index < 0) || (index >= array_obj->length.int_value) ) BVM_AOT_STOP(pc)	\
+	s[-2].int_value = ((type *) array_obj)->data[index];										\
+	s--;																						\
+}
+
+/** Store an int to an element of an array of \c type, as \c cast */
+#define BVM_AOT_XASTORE(type, cast, pc) {														\
+	bvm_jarray_obj_t *array_obj = (bvm_jarray_obj_t *) s[-3].ref_value;						\
+	bvm_int32_t index = BVM_AOT_INT(s[-2]);														\
+	if ( (array_obj == NULL) || (index < 0) || (index >= array_obj->length.int_value) ) BVM_AOT_STOP(pc)	\
+	((type *) array_obj)->data[index] = (cast) s[-1].int_value;								\
+	s -= 3;																						\
+}
+
+#define BVM_AOT_IALOAD(pc) 	BVM_AOT_XALOAD(bvm_jint_array_obj_t, pc)
+#define BVM_AOT_BALOAD(pc) 	BVM_AOT_XALOAD(bvm_jbyte_array_obj_t, pc)
+#define BVM_AOT_CALOAD(pc) 	BVM_AOT_XALOAD(bvm_jchar_array_obj_t, pc)
+#define BVM_AOT_SALOAD(pc) 	BVM_AOT_XALOAD(bvm_jshort_array_obj_t, pc)
+#define BVM_AOT_IASTORE(pc) BVM_AOT_XASTORE(bvm_jint_array_obj_t, bvm_int32_t, pc)
+#define BVM_AOT_BASTORE(pc) BVM_AOT_XASTORE(bvm_jbyte_array_obj_t, bvm_int8_t, pc)
+#define BVM_AOT_CASTORE(pc) BVM_AOT_XASTORE(bvm_jchar_array_obj_t, bvm_uint16_t, pc)
+#define BVM_AOT_SASTORE(pc) BVM_AOT_XASTORE(bvm_jshort_array_obj_t, bvm_int16_t, pc)
+
+#define BVM_AOT_LALOAD(pc) {																	\
+	bvm_jarray_obj_t *array_obj = (bvm_jarray_obj_t *) s[-2].ref_value;						\
+	bvm_int32_t index = BVM_AOT_INT(s[-1]);														\
+	if ( (array_obj == NULL) || (index < 0) || (index >= array_obj->length.int_value) ) BVM_AOT_STOP(pc)	\
+	BVM_INT64_to_cells(s - 2, ((bvm_jlong_array_obj_t *) array_obj)->data[index]);				\
+}
+
+#define BVM_AOT_LASTORE(pc) {																	\
+	bvm_jarray_obj_t *array_obj = (bvm_jarray_obj_t *) s[-4].ref_value;						\
+	bvm_int32_t index = BVM_AOT_INT(s[-3]);														\
+	if ( (array_obj == NULL) || (index < 0) || (index >= array_obj->length.int_value) ) BVM_AOT_STOP(pc)	\
+	((bvm_jlong_array_obj_t *) array_obj)->data[index] = BVM_INT64_from_cells(s - 2);			\
+	s -= 4;																						\
+}
+
+#endif
+
+#endif /*BVM_AOT_H_*/
@@ -65,6 +65,7 @@ typedef enum {
 #include "utfstring.h"
 #include "file.h"
 #include "zip.h"
+#include "inflate.h"
 
 #include "clazz.h"
 #include "object.h"
@@ -88,6 +89,10 @@ typedef enum {
 #include "stacktrace.h"
 #include "thread.h"
 #include "exec.h"
+#include "jit.h"
+#include "aot.h"
+#include "stackmap.h"
+#include "ir.h"
 
 #include "pd/pd.h"
 
@@ -108,6 +113,14 @@ typedef enum {
 
 #include "collector.h"
 #include "heap.h"
+#include "scope.h"
+#include "heapdump.h"
+#include "profiler.h"
+#include "metrics.h"
+#include "clazzimage.h"
+#include "preload.h"
+#include "snapshot.h"
+#include "classpath.h"
 
 #include "ni.h"
 #include "native.h"
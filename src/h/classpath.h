@@ -0,0 +1,47 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#ifndef BVM_CLASSPATH_H_
+#define BVM_CLASSPATH_H_
+
+/**
+  @file
+
+  Constants/Macros/Functions/Types for classpath lookup caching.
+
+  @author Greg McCreath
+  @since 0.0.10
+
+*/
+
+#if BVM_CLASSPATH_INDEX_ENABLE
+
+/** Returned by #bvm_classpath_boot_segment for a class that is in none of the indexed boot classpath jars */
+#define BVM_CLASSPATH_NO_SEGMENT	-1
+
+int bvm_classpath_boot_segment(bvm_utfstring_t *clazzname);
+bvm_bool_t bvm_classpath_boot_is_indexed(bvm_uint32_t segment);
+
+bvm_bool_t bvm_classpath_is_missing(bvm_classloader_obj_t *classloader_obj, bvm_utfstring_t *clazzname);
+void bvm_classpath_add_missing(bvm_classloader_obj_t *classloader_obj, bvm_utfstring_t *clazzname);
+void bvm_classpath_purge_missing();
+void bvm_classpath_release();
+
+#endif
+
+#endif
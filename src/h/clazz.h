@@ -50,6 +50,8 @@ typedef struct _bvmarrayclazzstruct bvm_array_clazz_t;
 struct _bvmprimitiveclazzstruct;
 typedef struct _bvmprimitiveclazzstruct bvm_primitive_clazz_t;
 
+struct _bvmstringinstancestruct;
+
 /* ********************************************/
 /* ********** JVMS Constants    **************/
 /* ********************************************/
@@ -69,6 +71,9 @@ typedef struct _bvmprimitiveclazzstruct bvm_primitive_clazz_t;
 #define BVM_CLASS_ACCESS_FLAG_INSTANCE   0x0080
 #define BVM_CLASS_ACCESS_FLAG_PRIMITIVE  0x0100
 
+/* Non JVMS - set on a throwable class (and its subclasses) whose instances do not record stack traces */
+#define BVM_CLASS_ACCESS_FLAG_NO_STACKTRACE  0x0800
+
 /* Field access flags */
 #define BVM_FIELD_ACCESS_PUBLIC       0x0001
 #define BVM_FIELD_ACCESS_PRIVATE      0x0002
@@ -84,11 +89,16 @@ typedef struct _bvmprimitiveclazzstruct bvm_primitive_clazz_t;
 #define BVM_FIELD_ACCESS_FLAG_CONST        0x2000
 /* Non JVMS - modifier for the field access flags to say it is a long field */
 #define BVM_FIELD_ACCESS_FLAG_LONG         0x8000
+/* Non JVMS - modifier for the field access flags to say it is a reference (object or array) field */
+#define BVM_FIELD_ACCESS_FLAG_REFERENCE    0x0400
 /* Non JVMS - modifier for the field access flags to say it is a 'native' field.  'Native'
  * means it is used to hold a native pointer - and should be shown via JDWP to be an int.
  * Field with NATIVE set are described in the Java class as Object - but are
  * not actually an 'object' here */
 #define BVM_FIELD_ACCESS_FLAG_NATIVE   0x0020
+/* Non JVMS - modifier for the field access flags to say it is a packed primitive field whose offset is in bytes - see
+ * #BVM_FIELD_PACKING_ENABLE */
+#define BVM_FIELD_ACCESS_FLAG_PACKED   0x0800
 
 /* Method access flags */
 #define BVM_METHOD_ACCESS_PUBLIC       0x0001
@@ -104,6 +114,14 @@ typedef struct _bvmprimitiveclazzstruct bvm_primitive_clazz_t;
 #define BVM_METHOD_ACCESS_STRICT       0x0800
 #define BVM_METHOD_ACCESS_SYNTHETIC    0x1000
 
+/* Non JVMS - modifier for the method access flags to say it is linked to a 'leaf' native method - one that can be
+ * called without a native method frame */
+#define BVM_METHOD_ACCESS_FLAG_LEAF    0x8000
+
+/* Non JVMS - modifier for the method access flags to say the exception table and code attributes of the method have
+ * not been parsed yet - see #BVM_METHOD_LoadCodeTables */
+#define BVM_METHOD_ACCESS_FLAG_LAZY_TABLES    0x4000
+
 /* Access flags.  For classes methods and fields. */
 #define BVM_ACCESS_PUBLIC       0x0001
 #define BVM_ACCESS_PRIVATE      0x0002
@@ -148,6 +166,14 @@ typedef enum {
 /** class search mask for the full interfaces and supers search */
 #define BVM_METHOD_SEARCH_FULL_TREE             (BVM_METHOD_SEARCH_CLAZZ | BVM_METHOD_SEARCH_SUPERS | BVM_METHOD_SEARCH_INTERFACES)
 
+/** The #bvm_method_t vtable_index of a method that has no vtable slot */
+#define BVM_METHOD_NO_VTABLE_INDEX		0xFFFF
+
+/* #bvm_method_t accessor kinds - see #BVM_EXEC_ACCESSOR_INLINING_ENABLE */
+#define BVM_METHOD_ACCESSOR_NONE		0
+#define BVM_METHOD_ACCESSOR_GETTER		1
+#define BVM_METHOD_ACCESSOR_SETTER		2
+
 /* ********************************************/
 /* ********** Member Access flags Macros ******/
 /* ********************************************/
@@ -175,8 +201,10 @@ typedef enum {
 #define BVM_FIELD_IsProtected(f) 				(((f)->access_flags & BVM_FIELD_ACCESS_PROTECTED) > 0)
 
 #define BVM_FIELD_IsLong(f)						(((f)->access_flags & BVM_FIELD_ACCESS_FLAG_LONG)   > 0)
+#define BVM_FIELD_IsReference(f)				(((f)->access_flags & BVM_FIELD_ACCESS_FLAG_REFERENCE) > 0)
 #define BVM_FIELD_IsConst(f)					(((f)->access_flags & BVM_FIELD_ACCESS_FLAG_CONST)  > 0)
 #define BVM_FIELD_IsNative(f)					(((f)->access_flags & BVM_FIELD_ACCESS_FLAG_NATIVE) > 0)
+#define BVM_FIELD_IsPacked(f)					(((f)->access_flags & BVM_FIELD_ACCESS_FLAG_PACKED) > 0)
 
 /* ********************************************/
 /* ********** Method Access flags Macros ******/
@@ -191,6 +219,26 @@ typedef enum {
 #define BVM_METHOD_IsPublic(m) 					(((m)->access_flags & BVM_METHOD_ACCESS_PUBLIC) 	  > 0)
 #define BVM_METHOD_IsStatic(m) 					(((m)->access_flags & BVM_METHOD_ACCESS_STATIC) 	  > 0)
 #define BVM_METHOD_IsSynchronized(m) 			(((m)->access_flags & BVM_METHOD_ACCESS_SYNCHRONIZED) > 0)
+#define BVM_METHOD_IsLeafNative(m) 				(((m)->access_flags & BVM_METHOD_ACCESS_FLAG_LEAF) 	  > 0)
+
+#if BVM_CLAZZ_LAZY_CODE_TABLES_ENABLE
+
+/** The buffer a method's bytecode is kept in, along with the rest of its 'Code' attribute.  Its position is the start
+ * of the exception table. */
+#if BVM_FILE_MAP_ENABLE
+#define BVM_METHOD_CodeBuffer(m)	( (bvm_filebuffer_t *) ((m)->code.bytecode - offsetof(bvm_filebuffer_t, bytes)) )
+#else
+#define BVM_METHOD_CodeBuffer(m)	( (bvm_filebuffer_t *) ((m)->code.bytecode - offsetof(bvm_filebuffer_t, data)) )
+#endif
+
+/** Make sure the exception table, line numbers and local variables of a method have been parsed.  Must be used before
+ * any of them are read. */
+#define BVM_METHOD_LoadCodeTables(m)	\
+	( (((m)->access_flags & BVM_METHOD_ACCESS_FLAG_LAZY_TABLES) > 0) ? bvm_clazz_method_load_code_tables(m) : (void) 0 )
+
+#else
+#define BVM_METHOD_LoadCodeTables(m)	( (void) 0 )
+#endif
 
 /* ********************************************/
 /* ********** Class Access flags Macros ******/
@@ -205,6 +253,7 @@ typedef enum {
 #define BVM_CLAZZ_IsArrayClazz(c) 				( (( (bvm_clazz_t *) c)->access_flags & BVM_CLASS_ACCESS_FLAG_ARRAY)     > 0)
 #define BVM_CLAZZ_IsInstanceClazz(c) 			( (( (bvm_clazz_t *) c)->access_flags & BVM_CLASS_ACCESS_FLAG_INSTANCE)  > 0)
 #define BVM_CLAZZ_IsPrimitiveClazz(c) 			( (( (bvm_clazz_t *) c)->access_flags & BVM_CLASS_ACCESS_FLAG_PRIMITIVE) > 0)
+#define BVM_CLAZZ_IsNoStackTrace(c) 			( (( (bvm_clazz_t *) c)->access_flags & BVM_CLASS_ACCESS_FLAG_NO_STACKTRACE) > 0)
 
 /* ********************************************/
 /* ********** Class lifecycle states **********/
@@ -280,6 +329,11 @@ typedef struct _bvmfieldstruct {
 	/** The access rights flags for the field */
 	bvm_uint16_t access_flags;
 
+#if BVM_FIELD_PACKING_ENABLE
+	/** For a packed field, the first char of its descriptor ('I', 'Z' and so on), which gives its width */
+	bvm_uint8_t packed_type;
+#endif
+
 	/** Handle to the pooled #bvm_utfstring_t name of the field */
 	bvm_utfstring_t *name;
 
@@ -294,7 +348,8 @@ typedef struct _bvmfieldstruct {
 	/** Static final constants field will get a value at class load time in 'static_value', otherwise
 	 * the 'offset' represents the index of this instance field among all other instance fields
 	 * for the defining class - including superclasses.   These two are expressed as a union as they
-	 * are mutually exclusive */
+	 * are mutually exclusive.  The offset of a packed field is in bytes from the start of the fields
+	 * rather than in cells */
     union {
         bvm_uint16_t offset;
         bvm_cell_t static_value;
@@ -308,6 +363,15 @@ typedef struct _bvmfieldstruct {
  */
 typedef void (*bvm_native_method_t)(void *args);
 
+#if BVM_AOT_ENABLE
+/**
+ * Function pointer definition of a method translated to C ahead of time (see aot.c).  It is given the locals and
+ * stack pointer of the method's frame and the bytecode offset to start at, and returns the offset the interpreter
+ * should carry on from.  The stack pointer is updated.
+ */
+typedef bvm_int32_t (*bvm_aot_method_t)(bvm_cell_t *locals, bvm_cell_t **sp, bvm_int32_t pc_index);
+#endif
+
 /**
  * DOCME
  */
@@ -359,8 +423,40 @@ typedef struct _bvmexceptionstruct {
 	 * for a 'finally'. */
 	bvm_utfstring_t *catch_type;
 
+#if BVM_EXEC_FAST_THROW_ENABLE
+	/** The clazz of the catch type, once it has been looked up by the first search of the handler, otherwise
+	 * \c NULL. */
+	bvm_clazz_t *catch_clazz;
+#endif
+
 } bvm_exception_t;
 
+#if BVM_EXEC_HANDLER_INDEX_ENABLE
+
+/**
+ * An index of a method's exception handlers by pc range - see #BVM_EXEC_HANDLER_INDEX_ENABLE.  The index is a single
+ * allocation, with the arrays following the struct.
+ */
+typedef struct _bvmexceptionindexstruct {
+
+	/** The number of pc intervals */
+	bvm_uint16_t count;
+
+	/** The position in #handlers of the first handler of each interval, plus the end of the last - \c count + 1
+	 * entries. */
+	bvm_uint32_t *first;
+
+	/** The sorted start pcs of the intervals, plus the end pc of the last one - \c count + 1 entries.  Interval \c i
+	 * runs from \c starts[i] up to (but not including) \c starts[i+1]. */
+	bvm_uint16_t *starts;
+
+	/** The positions in the method's exception table of the handlers covering each interval, in table order */
+	bvm_uint16_t *handlers;
+
+} bvm_exception_index_t;
+
+#endif
+
 #if (BVM_LINE_NUMBERS_ENABLE || BVM_DEBUGGER_ENABLE)
 
 /**
@@ -408,6 +504,11 @@ typedef struct _bvmmethodstruct {
 	/** handle to a list of exception definitions */
 	bvm_exception_t *exceptions;
 
+#if BVM_EXEC_HANDLER_INDEX_ENABLE
+	/** the index of #exceptions by pc range, or \c NULL if the method has too few handlers to be indexed */
+	bvm_exception_index_t *exception_index;
+#endif
+
 	/** handle to the pooled #bvm_utfstring_t name */
 	bvm_utfstring_t *name;
 
@@ -433,6 +534,76 @@ typedef struct _bvmmethodstruct {
 	/** The number of locals used by the method - with \c max_stack used to calculate stack frame size. */
 	bvm_uint16_t max_locals;
 
+#if BVM_CLAZZ_DISPATCH_TABLES_ENABLE
+	/** The slot of this method in the vtable of its clazz and all its subclazzes, or #BVM_METHOD_NO_VTABLE_INDEX
+	 * if the method is never virtually dispatched - static, private, constructors and interface methods. */
+	bvm_uint16_t vtable_index;
+#endif
+
+#if (BVM_DEBUGGER_ENABLE || BVM_JIT_ENABLE || BVM_GC_STACK_MAPS_ENABLE || BVM_EXEC_REGISTER_IR_ENABLE)
+	/** the number of bytecodes in the method */
+	bvm_uint32_t code_length;
+#endif
+
+#if BVM_EXEC_ACCESSOR_INLINING_ENABLE
+	/** Whether the method is a getter or setter - a \c BVM_METHOD_ACCESSOR_ value.  The cp index of the accessed field
+	 * is in the bytecode - at offset 2 for a getter and offset 3 for a setter. */
+	bvm_uint8_t accessor;
+#endif
+
+#if BVM_EXEC_INTRINSICS_ENABLE
+	/** For a native method the interpreter runs inline, which one it is (a \c BVM_EXEC_INTRINSIC_ value), otherwise
+	 * #BVM_EXEC_INTRINSIC_NONE. */
+	bvm_uint8_t intrinsic;
+#endif
+
+#if BVM_JIT_ENABLE
+	/** the count of invocations and backward branches taken, towards #BVM_JIT_THRESHOLD */
+	bvm_uint32_t jit_counter;
+
+	/** the compiled code for the method, or \c NULL if it has not been compiled */
+	struct _bvmjitcodestruct *jit_code;
+#endif
+
+#if BVM_AOT_ENABLE
+	/** the C translation of the method linked into the VM, or \c NULL if it has none */
+	bvm_aot_method_t aot_code;
+#endif
+
+#if BVM_GC_STACK_MAPS_ENABLE
+	/** the reference maps of the call sites of the method, or \c NULL if they have not been worked out yet */
+	struct _bvmstackmapstruct *stack_map;
+#endif
+
+#if BVM_EXEC_SWITCH_TABLES_ENABLE
+	/** the decoded tables of the switch instructions of the method that have run, or \c NULL if none have */
+	struct _bvmswitchtablestruct *switch_tables;
+#endif
+
+#if BVM_EXEC_STRING_CONCAT_ENABLE
+	/** the recognised string concatenations of the method, or \c NULL if none have been */
+	struct _bvmconcatstruct *concats;
+#endif
+
+#if BVM_EXEC_REGISTER_IR_ENABLE
+	/** the register code of the method, or \c NULL if it has not been run yet */
+	struct _bvmircodestruct *ir_code;
+#endif
+
+#if BVM_PROFILER_METHOD_COUNTERS_ENABLE
+	/** the number of times the method has been invoked */
+	bvm_uint32_t counter_invocations;
+
+	/** the number of bytecodes dispatched in the method */
+	bvm_native_ulong_t counter_bytecodes;
+
+	/** the number of objects and arrays allocated by the method */
+	bvm_uint32_t counter_allocations;
+
+	/** the milliseconds spent in the method itself, not counting the methods it calls */
+	bvm_uint32_t counter_millis;
+#endif
+
 #if (BVM_LINE_NUMBERS_ENABLE || BVM_DEBUGGER_ENABLE)
 	/** Number of #bvm_linenumber_t defs this method has */
 	bvm_uint16_t line_number_count;
@@ -447,9 +618,6 @@ typedef struct _bvmmethodstruct {
 	bvm_utfstring_t *generic_signature;
 #endif
 
-	/** the number of bytecodes in the method */
-	bvm_uint32_t code_length;
-
 	/** the number of local variables the method has. */
 	bvm_uint16_t local_variable_count;
 
@@ -493,6 +661,25 @@ struct _bvmclazzstruct {
 
 } /* bvm_clazz_t is forward defined */ ;
 
+#if BVM_CLAZZ_DISPATCH_TABLES_ENABLE
+
+/**
+ * One interface of a clazz's interface method table.  Holds the method that implements each method of the interface
+ * in the clazz, in the same order as the interface's own \c methods array.  An entry is \c NULL if the clazz does not
+ * implement the method (abstract clazzes) or if the interface method is static.
+ */
+typedef struct _bvmitableentrystruct {
+
+	/** the interface */
+	struct _bvminstanceclazzstruct *interface_clazz;
+
+	/** the implementing method for each method of the interface */
+	bvm_method_t **methods;
+
+} bvm_itable_entry_t;
+
+#endif
+
 /**
  * A Java class for user-definable objects - not arrays or primitives.
  */
@@ -541,13 +728,81 @@ struct _bvminstanceclazzstruct {
 	/** Pointer to the first element of an array of methods for the class*/
 	bvm_method_t *methods;
 
+#if BVM_CLAZZ_MEMBER_INDEX_ENABLE
+	/** The number of slots in #method_index less one.  The slot count is a power of two. */
+	bvm_uint32_t method_index_mask;
+
+	/** An open addressed hash index of #methods keyed by name and signature.  Each used slot holds the
+	 * position of a method in #methods plus one, an empty slot holds zero.  \c NULL if the clazz has fewer than
+	 * #BVM_CLAZZ_MEMBER_INDEX_MIN methods. */
+	bvm_uint16_t *method_index;
+
+	/** The number of slots in #field_index less one.  The slot count is a power of two. */
+	bvm_uint32_t field_index_mask;
+
+	/** An open addressed hash index of #fields, the same as #method_index.  \c NULL if the clazz has fewer than
+	 * #BVM_CLAZZ_MEMBER_INDEX_MIN fields. */
+	bvm_uint16_t *field_index;
+#endif
+
 	/**
 	 * Holds the cumulative number of non-static fields (including fields in superclasses)
 	 * for this class def.  Using this count, we can easily calculate how much memory
 	 * an instance of this class will consume.  memory = instance_fields_count * sizeof(bvm_cell_t).  Easy.
+	 * Packed fields (see #BVM_FIELD_PACKING_ENABLE) are counted as the cells they are rounded up to.
 	 */
 	bvm_uint16_t instance_fields_count;
 
+	/** The number of entries in #ref_field_offsets */
+	bvm_uint16_t ref_fields_count;
+
+	/** The instance field offsets of every non-static reference (object or array) field of this class, including
+	 * those inherited from superclasses.  Used by the GC to mark an object without looking at its field defs.  \c NULL if
+	 * there are none. */
+	bvm_uint16_t *ref_field_offsets;
+
+#if BVM_CLAZZ_DISPATCH_TABLES_ENABLE
+	/** The number of slots in #vtable */
+	bvm_uint16_t vtable_count;
+
+	/** The virtual method table - the method invoked for each vtable slot on an instance of this clazz, inherited slots
+	 * first.  \c NULL for interfaces. */
+	bvm_method_t **vtable;
+
+	/** The number of entries in #itable */
+	bvm_uint16_t itable_count;
+
+	/** The interface method table - one entry for every interface with methods that this clazz implements, directly or
+	 * through its superclazzes and superinterfaces. \c NULL for interfaces or if there are none. */
+	bvm_itable_entry_t *itable;
+#endif
+
+#if BVM_CLAZZ_TYPE_DISPLAYS_ENABLE
+	/** The depth of this clazz in the clazz hierarchy.  \c java.lang.Object is at depth zero. */
+	bvm_uint16_t super_depth;
+
+	/** The superclass display - the superclazz at each depth of the hierarchy above this clazz, from
+	 * \c java.lang.Object at index zero down to this clazz itself at index #super_depth. */
+	struct _bvminstanceclazzstruct **super_display;
+
+	/** For an interface, its bit in the #interface_set of clazzes that implement it.  Zero if this is not an
+	 * interface, or if all interface ids were taken when it was loaded. */
+	bvm_uint16_t interface_id;
+
+	/** The number of words in #interface_set */
+	bvm_uint16_t interface_set_words;
+
+	/** A bitmap of the #interface_id of every interface this clazz implements, directly or through its superclazzes
+	 * and superinterfaces.  An interface includes itself.  \c NULL if there are none. */
+	bvm_uint32_t *interface_set;
+#endif
+
+#if BVM_HEAP_METADATA_ARENA_ENABLE
+	/** The metadata arena of the clazz's class loader, or \c NULL if its metadata is in the default arena (the
+	 * bootstrap and system loaders).  See #BVM_ALLOC_TYPE_CLAZZ_METADATA. */
+	struct _bvmheapmetadataarenastruct *metadata_arena;
+#endif
+
 #if (BVM_LINE_NUMBERS_ENABLE || BVM_DEBUGGER_ENABLE)
 	/** The source file name in the #bvm_utfstring_t pool */
 	bvm_utfstring_t *source_file_name;
@@ -606,13 +861,23 @@ struct _bvmprimitiveclazzstruct {
 bvm_clazz_t *bvm_clazz_get(bvm_classloader_obj_t *loader, bvm_utfstring_t *clazzname);
 bvm_clazz_t *bvm_clazz_get_by_reflection(bvm_classloader_obj_t *loader, bvm_utfstring_t *clazzname);
 bvm_clazz_t *bvm_clazz_get_c(bvm_classloader_obj_t *loader, const char *clazzname);
+bvm_clazz_t *bvm_clazz_get_by_name_string(bvm_classloader_obj_t *loader, struct _bvmstringinstancestruct *name_obj);
+#if BVM_CLAZZ_FORNAME_CACHE_ENABLE
+void bvm_clazz_forname_cache_flush();
+#endif
 bvm_method_t *bvm_clazz_method_get(bvm_instance_clazz_t *clazz, bvm_utfstring_t *name, bvm_utfstring_t *desc, int mode);
+#if BVM_CLAZZ_DISPATCH_TABLES_ENABLE
+bvm_method_t *bvm_clazz_virtual_method_get(bvm_instance_clazz_t *clazz, bvm_method_t *resolved_method);
+#endif
 bvm_field_t *bvm_clazz_field_get(bvm_instance_clazz_t *clazz, bvm_utfstring_t *name, bvm_utfstring_t *desc);
 bvm_field_t *bvm_clazz_resolve_cp_field(bvm_instance_clazz_t *clazz, bvm_uint16_t index, bvm_bool_t is_static);
 bvm_clazz_t *bvm_clazz_resolve_cp_clazz(bvm_instance_clazz_t *clazz, bvm_uint16_t index);
 bvm_method_t *bvm_clazz_resolve_cp_method(bvm_instance_clazz_t *clazz, bvm_uint16_t index);
 bvm_jtype_t bvm_clazz_get_array_type(char c);
 bvm_int32_t bvm_clazz_get_source_line(bvm_method_t *method, bvm_uint8_t *pc);
+#if BVM_CLAZZ_LAZY_CODE_TABLES_ENABLE
+void bvm_clazz_method_load_code_tables(bvm_method_t *method);
+#endif
 
 bvm_utfstring_t *bvm_clazz_cp_utfstring_from_index(bvm_instance_clazz_t *c, bvm_uint16_t i);
 bvm_utfstring_t *bvm_clazz_cp_ref_name(bvm_instance_clazz_t *c, bvm_uint16_t i);
@@ -628,4 +893,11 @@ bvm_bool_t bvm_clazz_is_subclass_of(bvm_clazz_t *from_clazz, bvm_clazz_t *to_cla
 
 bvm_bool_t bvm_clazz_initialise(bvm_instance_clazz_t *clazz);
 
+#if BVM_CLAZZ_TYPE_DISPLAYS_ENABLE
+void bvm_clazz_interface_id_release(bvm_instance_clazz_t *clazz);
+#if BVM_VM_SNAPSHOT_ENABLE
+void bvm_clazz_snapshot_map();
+#endif
+#endif
+
 #endif /*BVM_CLAZZ_H_*/
@@ -0,0 +1,50 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+#ifndef BVM_CLAZZIMAGE_H_
+#define BVM_CLAZZIMAGE_H_
+
+/**
+  @file
+
+  Constants/Macros/Functions/Types for boot class images.
+
+  @author Greg McCreath
+  @since 0.0.10
+
+*/
+
+#if BVM_CLAZZ_IMAGE_ENABLE
+
+/** The first four bytes of a class image file - "BVMI" */
+#define BVM_CLAZZ_IMAGE_MAGIC		0x42564D49
+
+/** The version of the class image file format.  An image of another version is not used. */
+#define BVM_CLAZZ_IMAGE_VERSION		1
+
+extern BVM_VM_LOCAL char *bvm_gl_clazzimage_filename;
+extern BVM_VM_LOCAL char *bvm_gl_clazzimage_write_filename;
+
+bvm_bool_t bvm_clazzimage_load(const char *filename);
+bvm_filebuffer_t *bvm_clazzimage_buffer_class(bvm_utfstring_t *clazzname);
+void bvm_clazzimage_record(bvm_utfstring_t *clazzname, bvm_filebuffer_t *buffer);
+bvm_bool_t bvm_clazzimage_write(const char *filename);
+void bvm_clazzimage_release();
+
+#endif
+
+#endif /*BVM_CLAZZIMAGE_H_*/
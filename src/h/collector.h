@@ -38,35 +38,225 @@
 #define BVM_ALLOC_TYPE_ARRAY_OF_OBJECT    2  /* for an array of object references */
 #define BVM_ALLOC_TYPE_STRING             3  /* for String references  */
 #define BVM_ALLOC_TYPE_WEAK_REFERENCE     4  /* For Java WeakReference Objects */
+#define BVM_ALLOC_TYPE_SOFT_REFERENCE     5  /* For Java SoftReference Objects */
+#define BVM_ALLOC_TYPE_EPHEMERON          6  /* For Java Ephemeron Objects */
 // everything above here is an object allocation. See #BVM_ALLOC_MAX_OBJECT
-#define BVM_ALLOC_TYPE_DATA               5  /* Just a block of raw data - not java objects */
-#define BVM_ALLOC_TYPE_ARRAY_CLAZZ        6  /* for array clazz structure */
-#define BVM_ALLOC_TYPE_PRIMITIVE_CLAZZ    7  /* for primitive clazz structure */
-#define BVM_ALLOC_TYPE_INSTANCE_CLAZZ     8  /* for instance clazz structure */
-#define BVM_ALLOC_TYPE_STATIC     		  9  /* GC will ignore */
+#define BVM_ALLOC_TYPE_DATA               7  /* Just a block of raw data - not java objects */
+#define BVM_ALLOC_TYPE_ARRAY_CLAZZ        8  /* for array clazz structure */
+#define BVM_ALLOC_TYPE_PRIMITIVE_CLAZZ    9  /* for primitive clazz structure */
+#define BVM_ALLOC_TYPE_INSTANCE_CLAZZ     10 /* for instance clazz structure */
+#define BVM_ALLOC_TYPE_STATIC     		  11 /* GC will ignore */
+#define BVM_ALLOC_TYPE_BACKTRACE          12 /* for a compact exception backtrace - keeps the clazzes of its methods */
+
+/* for the VM's own long-lived data - from the metadata arena, so never in a heap region and never seen by the GC.  Just
+ * static heap memory if there is no arena.  See #BVM_HEAP_METADATA_ARENA_ENABLE. */
+#if BVM_HEAP_METADATA_ARENA_ENABLE
+#define BVM_ALLOC_TYPE_METADATA           13
+#else
+#define BVM_ALLOC_TYPE_METADATA           BVM_ALLOC_TYPE_STATIC
+#endif
+
+/* metadata owned by the given instance clazz - from the arena of its class loader, if it has one, so it goes with the
+ * loader.  See #bvm_heap_metadata_arena_new. */
+#if BVM_HEAP_METADATA_ARENA_ENABLE
+#define BVM_ALLOC_TYPE_CLAZZ_METADATA(c)  ( bvm_gl_heap_metadata_arena = (c)->metadata_arena, BVM_ALLOC_TYPE_METADATA )
+#else
+#define BVM_ALLOC_TYPE_CLAZZ_METADATA(c)  BVM_ALLOC_TYPE_METADATA
+#endif
 
 /* min and max allocation types are used in pointer validity checking */
 #define BVM_ALLOC_MIN_TYPE  BVM_ALLOC_TYPE_OBJECT
-#define BVM_ALLOC_MAX_TYPE  BVM_ALLOC_TYPE_STATIC
-#define BVM_ALLOC_MAX_OBJECT BVM_ALLOC_TYPE_WEAK_REFERENCE
+#define BVM_ALLOC_MAX_TYPE  BVM_ALLOC_TYPE_BACKTRACE
+#define BVM_ALLOC_MAX_OBJECT BVM_ALLOC_TYPE_EPHEMERON
 
-extern bvm_cell_t *bvm_gl_gc_permanent_roots;
+extern BVM_VM_LOCAL bvm_cell_t *bvm_gl_gc_permanent_roots;
 
-extern bvm_uint32_t bvm_gl_gc_permanent_roots_top;
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_gc_permanent_roots_top;
 
-extern bvm_cell_t *bvm_gl_gc_transient_roots;
+extern BVM_VM_LOCAL bvm_cell_t *bvm_gl_gc_transient_roots;
 
-extern bvm_uint32_t bvm_gl_gc_transient_roots_top;
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_gc_transient_roots_top;
 
-extern bvm_uint32_t bvm_gl_gc_transient_roots_depth;
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_gc_transient_roots_depth;
 
-extern bvm_uint32_t bvm_gl_gc_permanent_roots_depth;
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_gc_permanent_roots_depth;
+
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_gc_soft_clock;
 
 #define BVM_BEGIN_TRANSIENT_BLOCK  { bvm_uint32_t __transient_mark__ = bvm_gl_gc_transient_roots_top;
 
 #define BVM_END_TRANSIENT_BLOCK bvm_gl_gc_transient_roots_top = __transient_mark__; }
 
 void bvm_gc();
+void bvm_gc_full();
+
+#if BVM_GC_BUDGET_ENABLE
+
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_gc_alloc_budget;
+
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_gc_budget_free_percent;
+
+void bvm_gc_check_budget();
+
+#endif
+
+#if BVM_GC_IDLE_ENABLE
+
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_gc_idle_min_time;
+
+bvm_bool_t bvm_gc_idle();
+
+#endif
+bvm_bool_t bvm_gc_clear_soft_references();
+
+#if BVM_GC_GENERATIONAL_ENABLE
+
+void bvm_gc_remember(void *ptr);
+
+/**
+ * The generational collector write barrier.  Must be used whenever a reference \c v is stored into a heap
+ * object (or instance clazz, for statics) \c h that may already exist - that is, not one that has just been allocated.
+ * If \c h is old and \c v is new, \c h is added to the remembered set so the next minor collection will treat it as a
+ * root.
+ *
+ * @param h - the object, array, or clazz that the reference is stored into.
+ * @param v - the reference being stored.  May be \c NULL.
+ */
+#define BVM_GC_WRITE_BARRIER(h, v) {																\
+	if ( ((v) != NULL) &&																			\
+		 (BVM_CHUNK_GetColour(BVM_CHUNK_GetPointerChunk(h)) == BVM_GC_COLOUR_BLACK) &&				\
+		 (BVM_CHUNK_GetColour(BVM_CHUNK_GetPointerChunk(v)) == BVM_GC_COLOUR_WHITE) )				\
+		bvm_gc_remember(h);																			\
+}
+
+/**
+ * The generational collector write barrier for a bulk store of (unknown) references into \c h - an array copy,
+ * for example.  If \c h is old it is added to the remembered set.
+ *
+ * @param h - the object or array that references have been stored into.
+ */
+#define BVM_GC_WRITE_BARRIER_BULK(h) {															\
+	if (BVM_CHUNK_GetColour(BVM_CHUNK_GetPointerChunk(h)) == BVM_GC_COLOUR_BLACK)				\
+		bvm_gc_remember(h);																			\
+}
+
+#elif BVM_GC_INCREMENTAL_ENABLE
+
+extern BVM_VM_LOCAL bvm_bool_t bvm_gl_gc_is_marking;
+
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_gc_slice_budget;
+
+void bvm_gc_shade(void *ptr);
+void bvm_gc_mark_slice();
+
+/**
+ * The incremental collector write barrier.  Must be used whenever a reference \c v is stored into a heap
+ * object (or instance clazz, for statics) \c h that may already exist - that is, not one that has just been allocated.
+ * If a marking cycle is in progress and \c h has already been marked but \c v has not, \c v is coloured grey so the
+ * marker will not miss it.
+ *
+ * @param h - the object, array, or clazz that the reference is stored into.
+ * @param v - the reference being stored.  May be \c NULL.
+ */
+#define BVM_GC_WRITE_BARRIER(h, v) {																\
+	if ( bvm_gl_gc_is_marking && ((v) != NULL) &&													\
+		 (BVM_CHUNK_GetColour(BVM_CHUNK_GetPointerChunk(h)) == BVM_GC_COLOUR_BLACK) &&				\
+		 (BVM_CHUNK_GetColour(BVM_CHUNK_GetPointerChunk(v)) == BVM_GC_COLOUR_WHITE) )				\
+		bvm_gc_shade(v);																			\
+}
+
+/**
+ * The incremental collector write barrier for a bulk store of (unknown) references into \c h - an array copy,
+ * for example.  If a marking cycle is in progress and \c h has already been marked it is coloured grey to be
+ * marked again.
+ *
+ * @param h - the object or array that references have been stored into.
+ */
+#define BVM_GC_WRITE_BARRIER_BULK(h) {															\
+	if ( bvm_gl_gc_is_marking &&																	\
+		 (BVM_CHUNK_GetColour(BVM_CHUNK_GetPointerChunk(h)) == BVM_GC_COLOUR_BLACK) )				\
+		bvm_gc_shade(h);																			\
+}
+
+#else
+#define BVM_GC_WRITE_BARRIER(h, v) {}
+#define BVM_GC_WRITE_BARRIER_BULK(h) {}
+#endif
+
+#if (BVM_GC_GENERATIONAL_ENABLE || BVM_GC_INCREMENTAL_ENABLE)
+void bvm_gc_forget(void *ptr);
+#endif
+
+#if (BVM_GC_LAZY_SWEEP_ENABLE || BVM_GC_CONCURRENT_SWEEP_ENABLE)
+bvm_bool_t bvm_gc_sweep_step();
+#endif
+
+#if BVM_GC_CONCURRENT_SWEEP_ENABLE
+void bvm_gc_sweep_stop();
+#endif
+
+#if BVM_GC_PARALLEL_MARK_ENABLE
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_gc_mark_threads;
+#endif
+
+#if BVM_GC_COMPACTION_ENABLE
+
+/** Set after a GC that left the heap fragmented - the interpreter calls #bvm_gc_compact at its next thread switch */
+extern BVM_VM_LOCAL bvm_bool_t bvm_gl_gc_compact_pending;
+
+void bvm_gc_compact();
+#endif
+
+#if BVM_GC_STATS_ENABLE
+
+/**
+ * GC statistics.  Times are in milliseconds.  The 'last' values are for the most recent GC.  For the lazy and
+ * concurrent sweepers the bytes reclaimed by a GC are only complete once the heap has been swept.
+ */
+typedef struct _bvmgcstatsstruct {
+
+	/** The number of GCs performed */
+	bvm_uint32_t collections;
+
+	/** The time taken to mark the heap by the last GC */
+	bvm_uint32_t last_mark_time;
+
+	/** The time taken to sweep the heap by the last GC.  Zero for the lazy and concurrent sweepers - the sweep
+	 * is done in steps as memory is allocated */
+	bvm_uint32_t last_sweep_time;
+
+	/** The pause of the last GC - its mark and sweep time together */
+	bvm_uint32_t last_pause_time;
+
+	/** The longest pause of any GC */
+	bvm_uint32_t max_pause_time;
+
+	/** The total pause of all GCs */
+	bvm_uint32_t total_pause_time;
+
+	/** The bytes reclaimed by the last GC */
+	bvm_uint32_t last_reclaimed;
+
+	/** The bytes reclaimed by the last GC of each BVM_ALLOC_TYPE_* - indexed by alloc type */
+	bvm_uint32_t last_reclaimed_by_type[BVM_ALLOC_MAX_TYPE + 1];
+
+#if BVM_GC_STRING_DEDUP_ENABLE
+	/** The number of Strings given an equal char array by the last GC */
+	bvm_uint32_t last_deduplicated;
+#endif
+
+	/** The size of the largest free chunk.  Filled in by #bvm_gc_get_stats */
+	bvm_uint32_t largest_free;
+
+	/** The number of chunks in the free list.  Filled in by #bvm_gc_get_stats */
+	bvm_uint32_t free_chunks;
+
+} bvm_gc_stats_t;
+
+extern BVM_VM_LOCAL bvm_bool_t bvm_gl_gc_verbose;
+
+void bvm_gc_get_stats(bvm_gc_stats_t *stats);
+#endif
 
 /**
  * Push a ptr onto the permanent root stack to stop it from becoming GC'd during a collection.  Note there
@@ -30,9 +30,9 @@
 
 */
 
-extern bvm_uint32_t bvmd_gl_registered_events;
+extern BVM_VM_LOCAL bvm_uint32_t bvmd_gl_registered_events;
 
-extern bvm_clazz_t *bvmd_gl_unloaded_clazzes;
+extern BVM_VM_LOCAL bvm_clazz_t *bvmd_gl_unloaded_clazzes;
 
 /**
  * Macro to determine if a given DBG eventkind is registered.
@@ -161,11 +161,32 @@ typedef struct _dbgeventdefstruct {
 	bvm_bool_t in_use;
 	bvmd_event_modifier_t *modifiers;
 	bvm_uint8_t breakpoint_opcode;
+	bvmd_location_t *breakpoint_location;
 	struct _dbgeventdefstruct *next;
+	struct _dbgeventdefstruct *next_of_kind;
+	struct _dbgeventdefstruct *next_at_location;
 	struct _dbgeventdefstruct *nextvalid;
 } bvmd_eventdef_t;
 
-extern bvmd_eventdef_t *bvmd_gl_eventdefs;
+/**
+ * The number of DBG eventkinds.  Each is a bit in #bvmd_gl_registered_events, and its bit number is the index of its
+ * list in #bvmd_gl_eventdefs_by_kind.
+ */
+#define BVMD_EVENTKIND_COUNT		23
+
+/**
+ * The number of lists in #bvmd_gl_breakpoints.  Must be a power of two.
+ */
+#define BVMD_BREAKPOINT_HASH_SIZE	16
+
+/**
+ * The index of the #bvmd_gl_breakpoints list for a given method and pc index.
+ */
+#define BVMD_BREAKPOINT_HASH(m, pc) ( (int) ( ( ((bvm_native_ulong_t) (m) >> 4) ^ (pc) ) & (BVMD_BREAKPOINT_HASH_SIZE - 1) ) )
+
+extern BVM_VM_LOCAL bvmd_eventdef_t *bvmd_gl_eventdefs;
+extern BVM_VM_LOCAL bvmd_eventdef_t *bvmd_gl_eventdefs_by_kind[BVMD_EVENTKIND_COUNT];
+extern BVM_VM_LOCAL bvmd_eventdef_t *bvmd_gl_breakpoints[BVMD_BREAKPOINT_HASH_SIZE];
 
 #define BVMD_EventKind_ANY								0xFFFFFF
 #define BVMD_EventKind_NONE								0x000000
@@ -204,6 +225,7 @@ bvm_bool_t bvmd_event_SingleStep(bvmd_eventcontext_t *context, bvm_bool_t do_bre
 void bvmd_event_VMStart();
 void bvmd_event_VMDeath();
 
+int bvmd_eventkind_index(bvm_uint8_t jdwp_eventkind);
 void bvmd_eventdef_clearall();
 bvmd_eventcontext_t *bvmd_eventdef_new_context(bvm_uint8_t eventkind, bvm_vmthread_t *vmthread);
 void bvmd_eventdef_free_context(bvmd_eventcontext_t *context);
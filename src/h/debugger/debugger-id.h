@@ -39,6 +39,10 @@ void bvmd_id_remove_id(bvm_int32_t id);
 bvm_int32_t bvmd_id_get_by_address(void *addr);
 void *bvmd_id_get_by_id(bvm_int32_t id);
 
+#if BVM_DEBUGGER_ID_MAP_RESIZE_ENABLE
+void bvmd_id_remove_if(bvm_bool_t (*is_removed)(void *addr));
+#endif
+
 bvm_uint32_t calc_hash_for_ptr(void* addr, int mod);
 
 #endif /* BVM_DEBUGGERID_H_ */
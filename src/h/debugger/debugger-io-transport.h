@@ -197,8 +197,8 @@ typedef struct _bvmdtransportstruct {
 
 } bvmd_transport_t;
 
-extern bvmd_transport_t bvmd_gl_transport;
-extern bvmd_transport_capabilities_t bvmd_gl_transport_capabilities;
+extern BVM_VM_LOCAL bvmd_transport_t bvmd_gl_transport;
+extern BVM_VM_LOCAL bvmd_transport_capabilities_t bvmd_gl_transport_capabilities;
 
 void bvmd_transport_init(bvmd_transport_t *transport);
 
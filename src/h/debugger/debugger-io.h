@@ -43,6 +43,10 @@ typedef struct _bvmdpacketdatastruct bvmd_packetdata_t;
 
 struct _bvmdpacketdatastruct {
     bvm_int32_t length;
+#if BVM_DEBUGGER_BATCHED_IO_ENABLE
+    /** the number of bytes the segment can hold - at least #BVM_DEBUGGER_PACKETDATA_SIZE */
+    bvm_int32_t capacity;
+#endif
     bvmd_packetdata_t *next;
     bvm_uint8_t bytes[BVM_DEBUGGER_PACKETDATA_SIZE];
 };
@@ -124,6 +128,10 @@ void bvmd_sendstream(bvmd_packetstream_t* stream);
 
 void dbg_free_packetstream(bvmd_packetstream_t *packetstream);
 
+#if BVM_DEBUGGER_BATCHED_IO_ENABLE
+bvmd_packetdata_t *bvmd_new_packetdata(bvm_int32_t capacity);
+#endif
+
 bvm_method_t *bvmd_readcheck_method(bvmd_instream_t* in, bvmd_outstream_t* out);
 bvm_clazz_t *bvmd_readcheck_reftype(bvmd_instream_t* in, bvmd_outstream_t* out);
 
@@ -39,7 +39,7 @@ typedef struct _bvmdrootstruct {
 	struct _bvmdrootstruct *next;
 } bvmd_root_t;
 
-extern bvmd_root_t **bvmd_root_map;
+extern BVM_VM_LOCAL bvmd_root_t **bvmd_root_map;
 
 void bvmd_root_init();
 void bvmd_root_free();
@@ -38,15 +38,15 @@
 
 #define BVMD_TIMEOUT_FOREVER -1
 
-extern bvm_bool_t bvmd_gl_enabledebug;
-extern bvm_bool_t bvmd_gl_server;
-extern bvm_uint32_t bvmd_gl_timeout;
-extern bvm_bool_t bvmd_gl_suspendonstart;
-extern bvm_bool_t bvmd_gl_all_suspended;
-extern bvm_bool_t bvmd_gl_holdevents;
-extern char *bvmd_gl_address;
-
-extern bvm_string_obj_t *bvmd_nosupp_tostring_obj;
+extern BVM_VM_LOCAL bvm_bool_t bvmd_gl_enabledebug;
+extern BVM_VM_LOCAL bvm_bool_t bvmd_gl_server;
+extern BVM_VM_LOCAL bvm_uint32_t bvmd_gl_timeout;
+extern BVM_VM_LOCAL bvm_bool_t bvmd_gl_suspendonstart;
+extern BVM_VM_LOCAL bvm_bool_t bvmd_gl_all_suspended;
+extern BVM_VM_LOCAL bvm_bool_t bvmd_gl_holdevents;
+extern BVM_VM_LOCAL char *bvmd_gl_address;
+
+extern BVM_VM_LOCAL bvm_string_obj_t *bvmd_nosupp_tostring_obj;
 
 /**
  * Represents a JDWP location.
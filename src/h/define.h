@@ -65,6 +65,19 @@
 #define BVM_CONSOLE_ENABLE 1
 #endif
 
+/**
+ * When set with #BVM_CONSOLE_ENABLE, output from \c java.io.Console is gathered in a buffer of
+ * #BVM_CONSOLE_BUFFER_SIZE bytes (see #bvm_pd_console_write) instead of going to the platform a byte at a time.  The
+ * buffer is written out at each newline, when it is full, when output has been waiting for longer than
+ * #BVM_CONSOLE_FLUSH_INTERVAL milliseconds, before any #bvm_pd_console_out message, when the VM goes idle and when it
+ * exits.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_CONSOLE_BUFFER_ENABLE
+#define BVM_CONSOLE_BUFFER_ENABLE 1
+#endif
+
 /**
  * Enables platform support for floating point.  The underlying platform/compiler must provide support for a
  * 32 bit single precision float type and a 64 bit double precision float type.  Additionally, float support is
@@ -74,6 +87,18 @@
 #define BVM_FLOAT_ENABLE 1
 #endif
 
+/**
+ * When set with #BVM_FLOAT_ENABLE, \c Float.toString and \c Double.toString give the shortest decimal that reads
+ * back as the same value (using the table driven Ryu algorithm) instead of formatting through \c sprintf, and
+ * \c Float.valueOf(String) and \c Double.valueOf(String) parse their argument - with
+ * #BVM_NATIVE_REPLACEMENT_ENABLE, as the class library does not implement them.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_FP_FAST_CONVERSION_ENABLE
+#define BVM_FP_FAST_CONVERSION_ENABLE 1
+#endif
+
 /**
  * Enables support for line number within class files.  Line numbers will also be supported
  * if #BVM_DEBUGGER_ENABLE is enabled.
@@ -94,6 +119,20 @@
 #define BVM_STACKTRACE_ENABLE 1
 #endif
 
+/**
+ * Enables compact exception backtraces.  When a throwable is created only the method and pc of each
+ * stack frame are recorded.  Class names, method names, file names and line numbers are resolved
+ * later, and only if the stack trace is actually asked for by \c getStackTrace(), \c printStackTrace(),
+ * or an uncaught exception.  Most exceptions are caught and never printed, so this makes throwing
+ * cheaper and the backtrace smaller.  A compact backtrace keeps the classes of its methods from being
+ * unloaded.  Only meaningful if #BVM_STACKTRACE_ENABLE is set.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_STACKTRACE_LAZY_ENABLE
+#define BVM_STACKTRACE_LAZY_ENABLE 1
+#endif
+
 /**
  * Enables support for allowing a Java program to exit using \c System.exit().
  */
@@ -190,278 +229,2316 @@
 #endif
 
 /**
- * Enables big endian support.
+ * When set, every object carries a lock word in its header and an uncontended \c synchronized is handled there
+ * by recording the owning thread and recursion count - no #bvm_monitor_t is involved.  The lock is 'inflated'
+ * to a full monitor only on contention, on \c wait() or when the recursion count overflows.  Costs one word per
+ * object.
+ *
+ * Default is enabled.
  */
-#ifndef BVM_BIG_ENDIAN_ENABLE
-#define BVM_BIG_ENDIAN_ENABLE 0
+#ifndef BVM_THIN_LOCK_ENABLE
+#define BVM_THIN_LOCK_ENABLE 1
 #endif
 
 /**
- * Enables support for runtime binary compatibility checking in classes.
+ * When set, runnable threads are kept in a queue per Java thread priority and the highest priority runnable thread
+ * always runs next, with ageing so lower priorities are not starved (see #BVM_THREAD_AGEING_INTERVAL).  When not set,
+ * runnable threads are round-robin'd and priority affects only the length of a thread's timeslice.
+ *
+ * Default is enabled.
  */
-#ifndef BVM_BINARY_COMPAT_CHECKING_ENABLE
-#define BVM_BINARY_COMPAT_CHECKING_ENABLE 1
+#ifndef BVM_THREAD_PRIORITY_QUEUES_ENABLE
+#define BVM_THREAD_PRIORITY_QUEUES_ENABLE 1
 #endif
 
 /**
- * Enables support for compression in jar files.
+ * When set, a thread that owns a monitor is scheduled at no less than the highest priority of the threads blocked
+ * for it, until it gives the monitor up.  A low priority thread holding a monitor that a high priority thread needs
+ * then cannot be kept from running by threads of middling priority.  Only used with #BVM_THREAD_PRIORITY_QUEUES_ENABLE.
+ *
+ * Default is enabled.
  */
-#ifndef BVM_JAR_INFLATE_ENABLE
-#define BVM_JAR_INFLATE_ENABLE 1
+#ifndef BVM_THREAD_PRIORITY_INHERITANCE_ENABLE
+#define BVM_THREAD_PRIORITY_INHERITANCE_ENABLE 1
+#endif
+
+#if (BVM_THREAD_PRIORITY_INHERITANCE_ENABLE && !BVM_THREAD_PRIORITY_QUEUES_ENABLE)
+#undef BVM_THREAD_PRIORITY_INHERITANCE_ENABLE
+#define BVM_THREAD_PRIORITY_INHERITANCE_ENABLE 0
 #endif
 
 /**
- * Enables support for ANSI C console.
+ * When set, the natives of \c babe.lang.Task are available.  A task is a \c Thread started with a small first stack
+ * segment (see #BVM_THREAD_TASK_STACK_HEIGHT) that grows like any other thread stack, and whose VM thread is pooled
+ * for the next task when it ends (see #BVM_THREAD_TASK_POOL_SIZE).  Any thread may yield until it is resumed by
+ * another, so many tasks can be run as coroutines over the green thread scheduler.
+ *
+ * Default is enabled.
  */
-#ifndef BVM_ANSI_CONSOLE_ENABLE
-#define BVM_ANSI_CONSOLE_ENABLE 1
+#ifndef BVM_THREAD_TASKS_ENABLE
+#define BVM_THREAD_TASKS_ENABLE 1
 #endif
 
 /**
- * Enables support for ANSI C file operations.
+ * When set, the natives of \c babe.lang.ScopedMemory are available.  A scoped memory is an arena of a fixed size
+ * allocated from the heap as #BVM_ALLOC_TYPE_STATIC.  While a thread is in a scope, the objects and arrays it creates
+ * with bytecode are bumped off the arena rather than allocated from the heap, so no GC is ever started by them.  When
+ * the thread leaves the scope, everything in the arena is dropped at once.  Storing a reference to an object in a scope
+ * anywhere it could outlive the scope throws an \c IllegalStateException, as does running out of arena (as an
+ * \c OutOfMemoryError).
+ *
+ * Default is disabled.  May not be used with #BVM_GC_GENERATIONAL_ENABLE, #BVM_GC_INCREMENTAL_ENABLE or
+ * #BVM_GC_COMPACTION_ENABLE.
  */
-#ifndef BVM_ANSI_FILE_ENABLE
-#define BVM_ANSI_FILE_ENABLE 1
+#ifndef BVM_SCOPED_MEMORY_ENABLE
+#define BVM_SCOPED_MEMORY_ENABLE 0
 #endif
 
 /**
- * Enables support for ANSI C heap.
+ * When set, thread timeslices are measured by a platform timer (see #bvm_pd_system_timer_start) rather than by counting
+ * bytecodes.  The timer ticks every #BVM_THREAD_TIMER_TICK milliseconds of VM execution and a thread's timeslice is its
+ * priority in ticks.  The interpreter only looks for a tick at branches and method invocations and returns, so
+ * straight-line bytecode does not pay for thread switching at all.  Requires a platform timer -
+ * the linux, osx and winos platforms have one.
+ *
+ * Default is disabled.
  */
-#ifndef BVM_ANSI_MEMORY_ENABLE
-#define BVM_ANSI_MEMORY_ENABLE 1
+#ifndef BVM_THREAD_TIMER_PREEMPTION_ENABLE
+#define BVM_THREAD_TIMER_PREEMPTION_ENABLE 0
 #endif
 
 /**
- * Enables support for sockets.
+ * When set, each thread keeps account of its scheduling at every thread switch - the time it has run for, the
+ * bytecodes it has executed and a histogram of how long it waited to run each time it became runnable.  The figures
+ * are available to Java through \c Thread.getCpuTime and \c Thread.getBytecodeCount, and are served by the metrics
+ * server (see #BVM_METRICS_ENABLE).  The cost is two reads of the platform microsecond clock at each thread switch and
+ * one each time a thread becomes runnable.  Requires #bvm_pd_system_time_micros - the linux and winos platforms have
+ * it, and set this.
+ *
+ * Default is disabled.
  */
-#ifndef BVM_SOCKETS_ENABLE
-#define BVM_SOCKETS_ENABLE 1
+#ifndef BVM_THREAD_ACCOUNTING_ENABLE
+#define BVM_THREAD_ACCOUNTING_ENABLE 0
 #endif
 
 /**
-+ * Enables BSD sockets - assumes \c BVM_SOCKETS_ENABLE is also enabled.
-+ */
-#ifndef BVM_BSD_SOCKETS_ENABLE
-#define BVM_BSD_SOCKETS_ENABLE 1
+ * When set, more than one VM may run in the same process, each on its own OS thread.  All mutable VM state - the
+ * interpreter registers, the heap, the threads, the pools and so on - is declared #BVM_VM_LOCAL, which places it in
+ * OS thread-local storage, so each OS thread that calls #bvm_main gets a VM of its own that shares nothing with any
+ * other.  Requires the platform to define \c BVM_PD_THREAD_LOCAL - the linux, osx and winos platforms do.  Each access
+ * to VM state is a little slower, so small single VM targets leave this off and keep plain globals.
+ *
+ * Timer preemption (#BVM_THREAD_TIMER_PREEMPTION_ENABLE) uses a single process-wide timer and may not be used with
+ * this.
+ *
+ * Default is disabled.
+ */
+#ifndef BVM_VM_INSTANCES_ENABLE
+#define BVM_VM_INSTANCES_ENABLE 0
 #endif
 
-/*
- * Let the platform override anything it needs to, or whatever.  Notice that all the defines above this line
- * are of a boolean on/off nature.  All defines below this line will set a default if no value has been given.
+/**
+ * When set, Java code may start further VMs - isolates - each on an OS thread of its own (see the \c babe.lang.Isolate
+ * natives and #bvm_vm_isolate_start).  Isolates share nothing, so compute-heavy work split across isolates runs in
+ * parallel on as many cores as there are isolates.  This stands in for M:N scheduling of green threads across OS
+ * threads - the threads of any one VM still share one core.  An isolate's bad command line options end just the
+ * isolate.  Requires #BVM_VM_INSTANCES_ENABLE and platform OS threads - the linux, osx and winos platforms have them.
+ *
+ * Default is disabled.
  */
+#ifndef BVM_VM_ISOLATES_ENABLE
+#define BVM_VM_ISOLATES_ENABLE 0
+#endif
 
 /**
- * The default listen port when debug listening on TCP transport in server mode.  When debug attaching to
- * a debugger this is the default port to attach to on the default host name of "localhost". Only valid
- * if debugger support is also enabled - refer #BVM_DEBUGGER_ENABLE.  Overridden with the \c
- * address=xxxx setting the \c -Xrunjdwp command line option.
+ * When set, a host with its own event loop may run the VM a slice at a time instead of handing it the thread until
+ * #bvm_main returns.  #bvm_vm_slice_start initialises the VM and readies \c main, each #bvm_vm_slice_run runs it until
+ * a bytecode or microsecond budget is spent and then returns to the host, and #bvm_vm_slice_end shuts the VM down.
+ * Slices end at the interpreter's thread switch points, and a slice that finds every thread waiting returns at once
+ * rather than sleeping, so the host never blocks in the VM.
  *
- * Default is 8000.
+ * Default is disabled.
  */
-#ifndef BVM_DEBUGGER_SOCKET_PORT
-#define BVM_DEBUGGER_SOCKET_PORT 	8000
+#ifndef BVM_VM_SLICE_ENABLE
+#define BVM_VM_SLICE_ENABLE 0
 #endif
 
 /**
- * Default debugger connection attach/accept/handshake timeout in millseconds.  Can be set with the \c timeout=xxx
- * setting in the =Xrunjdwp command line option.  Only valid if debugger support is also enabled - refer
- * #BVM_DEBUGGER_ENABLE.  The #bvmd_gl_timeout global variable will be set to #BVM_DEBUGGER_TIMEOUT if no
- * command line value is given.
+ * When set, each \c invokevirtual and \c invokeinterface call site remembers the receiver clazzes it has seen and
+ * the methods they dispatched to, so a repeat call on a receiver of the same clazz skips the hierarchy search.  The
+ * caches are held in a side table keyed by the call site's bytecode address (see #BVM_EXEC_INLINE_CACHE_SIZE and
+ * #BVM_EXEC_INLINE_CACHE_WAYS) and do not alter the bytecode, so they also work with the debugger.
  *
- * Default is 60000 milliseconds.
+ * Default is enabled.
  */
-#ifndef BVM_DEBUGGER_TIMEOUT
-#define BVM_DEBUGGER_TIMEOUT 		60000
+#ifndef BVM_EXEC_INLINE_CACHE_ENABLE
+#define BVM_EXEC_INLINE_CACHE_ENABLE 1
 #endif
 
 /**
- * Data packet size in bytes for reading/writing JDWP debug packets.   Only valid if debugger support is also
- * enabled - refer #BVM_DEBUGGER_ENABLE.
+ * When set, each \c checkcast and \c instanceof remembers the clazz it names and the object clazzes it last found to
+ * be compatible with it, so a repeat check of an object of the same clazz is one comparison - no clazz lookup by name
+ * and no hierarchy search.  Like the inline caches, these are held in a side table keyed by the instruction's bytecode
+ * address (see #BVM_EXEC_TYPE_CACHE_SIZE and #BVM_EXEC_TYPE_CACHE_WAYS).
  *
- * Default is 128 bytes.
+ * Default is enabled.
  */
-#ifndef BVM_DEBUGGER_PACKETDATA_SIZE
-#define BVM_DEBUGGER_PACKETDATA_SIZE 		128
+#ifndef BVM_EXEC_TYPE_CACHE_ENABLE
+#define BVM_EXEC_TYPE_CACHE_ENABLE 1
 #endif
 
 /**
- * Platform path separator.
+ * When set, the quickened field, invoke and array opcodes do not test their object reference for null.  Instead they
+ * note where they are and read the first word of the object.  A null reference makes that read fault on the
+ * unmapped first page of memory, and the platform fault handler (see #bvm_pd_system_null_trap_start) has the VM
+ * throw a \c NullPointerException at the noted bytecode - through the same native try/catch as any other exception
+ * thrown from the interpreter.  The compare and branch of each check becomes a few stores and a load that is
+ * usually needed anyway.  Requires a host with an MMU that leaves address zero unmapped and a platform that can
+ * trap the fault - the linux, osx and winos platforms can.  The VM will not start if the trap cannot be installed.
  *
- * Default is ':'.
+ * Default is disabled.
  */
-#ifndef BVM_PLATFORM_PATH_SEPARATOR
-#define BVM_PLATFORM_PATH_SEPARATOR 	':'
+#ifndef BVM_EXEC_IMPLICIT_NULL_CHECKS_ENABLE
+#define BVM_EXEC_IMPLICIT_NULL_CHECKS_ENABLE 0
 #endif
 
 /**
- * Platform directory separator.
+ * When set, \c Class.forName remembers the clazzes it has found by the String of the name and the class loader asked,
+ * so that finding the same clazz again needs no utfstring made of the name and no clazz pool lookup - nothing is
+ * allocated.  The cache is a side table of #BVM_CLAZZ_FORNAME_CACHE_SIZE entries and is flushed whenever a clazz is
+ * unloaded.
  *
- * Default is '/'.
+ * Default is enabled.
  */
-#ifndef BVM_PLATFORM_FILE_SEPARATOR
-#define BVM_PLATFORM_FILE_SEPARATOR 	'/'
+#ifndef BVM_CLAZZ_FORNAME_CACHE_ENABLE
+#define BVM_CLAZZ_FORNAME_CACHE_ENABLE 1
 #endif
 
 /**
- * Maximum number of #BVM_PLATFORM_PATH_SEPARATOR separated segments in a classpath.
+ * When set, each loaded clazz gets a virtual method table and an interface method table built as it is loaded.  An
+ * \c invokevirtual then finds the method to invoke by indexing the receiver clazz's vtable with the resolved method's
+ * slot, and an \c invokeinterface by looking up the interface in the receiver clazz's itable, instead of searching
+ * the receiver's clazz hierarchy.  Costs one pointer per vtable slot and per interface method implemented, per clazz -
+ * see the \c -sizes command line option.
  *
- * Default is 5.
+ * Default is enabled.
  */
-#ifndef BVM_MAX_CLASSPATH_SEGMENTS
-#define BVM_MAX_CLASSPATH_SEGMENTS		5
+#ifndef BVM_CLAZZ_DISPATCH_TABLES_ENABLE
+#define BVM_CLAZZ_DISPATCH_TABLES_ENABLE 1
 #endif
 
 /**
- * Initial thread stack height (in cells - see #bvm_cell_t).  Can be set using command line
- * option \c -stack.  The #bvm_gl_stack_height global variable will be set to #BVM_THREAD_STACK_HEIGHT if
- * the value is not specified on the command line.
+ * When set, each loaded clazz with at least #BVM_CLAZZ_MEMBER_INDEX_MIN methods (or fields) gets a small open addressed
+ * hash index of them keyed by their interned name and signature.  Method and field resolution, and native interface
+ * lookups like \c NI_GetFieldID, then find a member declared by a clazz without scanning all of them.  Costs two
+ * bytes per slot, with at least twice as many slots as members.
  *
- * Default is 256 cells.
+ * Default is enabled.
  */
-#ifndef BVM_THREAD_STACK_HEIGHT
-#define BVM_THREAD_STACK_HEIGHT 256
+#ifndef BVM_CLAZZ_MEMBER_INDEX_ENABLE
+#define BVM_CLAZZ_MEMBER_INDEX_ENABLE 1
 #endif
 
 /**
- * Default heap size in bytes.  Heap size can set using command line option \c -heap and specifying
- * bytes, kb, or Mb.  The #bvm_gl_heap_size global variable will be set to #BVM_HEAP_SIZE if the value is
- * not specified on the command line.
+ * When set, the exception table, line numbers and local variables of a method are not parsed when its clazz is
+ * loaded.  The rest of the method's 'Code' attribute is kept with its bytecode in a single allocation and they are
+ * parsed from there the first time the method throws, is stack traced, or is asked about by the debugger.  Most
+ * methods of a large library clazz never are, so class loading does less work and makes fewer allocations.
  *
- * Default is 256.
+ * Default is enabled.
  */
-#ifndef BVM_HEAP_SIZE
-#ifdef BVM_DEBUGGER_ENABLE
-#define BVM_HEAP_SIZE          (256 * BVM_KB)
-#else
-#define BVM_HEAP_SIZE          (256 * BVM_KB)
+#ifndef BVM_CLAZZ_LAZY_CODE_TABLES_ENABLE
+#define BVM_CLAZZ_LAZY_CODE_TABLES_ENABLE 1
 #endif
+
+/**
+ * The fewest methods (or fields) a clazz must declare to be given a member index - see
+ * #BVM_CLAZZ_MEMBER_INDEX_ENABLE.  Smaller clazzes are scanned.
+ *
+ * Default is 8.
+ */
+#ifndef BVM_CLAZZ_MEMBER_INDEX_MIN
+#define BVM_CLAZZ_MEMBER_INDEX_MIN 8
 #endif
 
 /**
- * Height of transient root stack in cells (refer #bvm_cell_t).  Can be set using command line option \c -tr.
- * The #bvm_gl_gc_transient_roots_depth global variable will be set to #BVM_GC_TRANSIENT_ROOTS_DEPTH if the value is
- * not specified on the command line.
+ * When set, each loaded clazz gets a superclass display - its superclazzes indexed by their depth in the hierarchy -
+ * and a bitmap of every interface it implements.  Subclass and interface tests (\c checkcast, \c instanceof,
+ * \c aastore, \c System.arraycopy and the like) then take constant time instead of walking the clazz hierarchy.
+ * Costs one pointer per superclazz and one bit per loaded interface, per clazz.
  *
- * Default is 50 cells.
+ * Default is enabled.
  */
-#ifndef BVM_GC_TRANSIENT_ROOTS_DEPTH
-#define BVM_GC_TRANSIENT_ROOTS_DEPTH   		50
+#ifndef BVM_CLAZZ_TYPE_DISPLAYS_ENABLE
+#define BVM_CLAZZ_TYPE_DISPLAYS_ENABLE 1
 #endif
 
 /**
- * Height of permanent root stack in cells (refer #bvm_cell_t).  Can be set using command line option \c -sr. Has
- * the effect of setting the #bvm_gl_gc_permanent_roots_depth global variable.
+ * When set, a few hot core library native methods - \c String.charAt, \c String.hashCode, \c String.equals,
+ * \c Math.sqrt and \c System.arraycopy, and the boxing \c valueOf natives of #BVM_NATIVE_BOX_CACHE_ENABLE - are
+ * recognised as they are linked.  Calls to them are quickened to intrinsic opcodes that do the work inline in the
+ * interpreter loop, without pushing a native method frame.
  *
- * Default is 100 cells.
+ * Default is enabled.
  */
-#ifndef BVM_GC_PERMANENT_ROOTS_DEPTH
-#define BVM_GC_PERMANENT_ROOTS_DEPTH   		100
+#ifndef BVM_EXEC_INTRINSICS_ENABLE
+#define BVM_EXEC_INTRINSICS_ENABLE 1
 #endif
 
 /**
- * Default number of hash buckets in the intern string pool.  Can be set using command line option \c -strb.
- * The #bvm_gl_internstring_pool_bucketcount global variable will be set to #BVM_INTERNSTRING_POOL_BUCKETCOUNT if
- * no command line value is given.
+ * When set, methods whose whole body is a getter (\c aload_0, \c getfield, return) or a setter (\c aload_0, load,
+ * \c putfield, \c return) are marked as accessors as they are loaded.  A call site that goes straight to one - a
+ * final or private \c invokevirtual, or an \c invokespecial - is quickened to do the field access inline, without
+ * pushing a frame.  While a debugger session is open accessors are invoked as normal methods.
  *
- * Default is 64 buckets.
+ * Default is enabled.
  */
-#ifndef BVM_INTERNSTRING_POOL_BUCKETCOUNT
-#define BVM_INTERNSTRING_POOL_BUCKETCOUNT  	64
+#ifndef BVM_EXEC_ACCESSOR_INLINING_ENABLE
+#define BVM_EXEC_ACCESSOR_INLINING_ENABLE 1
 #endif
 
 /**
- * Default number of hash buckets in the utfstring pool.  Can be set using command line option \c -utfb.
- * The #bvm_gl_utfstring_pool_bucketcount global variable will be set to #BVM_UTFSTRING_POOL_BUCKETCOUNT if no
- * command line value is given.
+ * When set, a \c getstatic of a \c static \c final primitive field of a class that has finished its initialisation
+ * is quickened to an opcode that pushes the field's value from the instruction's constant pool entry, as \c ldc does,
+ * rather than following the entry to the field.  The value is copied into the entry when the instruction is
+ * quickened - a \c final field cannot change after its class is initialised.  Long and double fields, reference
+ * fields, and fields of a class that is still initialising are not folded, and nothing is folded while a debugger
+ * session is open.
  *
- * Default is 64 buckets.
+ * Default is enabled.
  */
-#ifndef BVM_UTFSTRING_POOL_BUCKETCOUNT
-#define BVM_UTFSTRING_POOL_BUCKETCOUNT 		64
+#ifndef BVM_EXEC_CONSTANT_FOLDING_ENABLE
+#define BVM_EXEC_CONSTANT_FOLDING_ENABLE 1
 #endif
 
 /**
- * Default number of hash buckets in the native method pool.  Unlike other pool sizes this is cannot be
- * set from the command line.
+ * When set, the operands of a \c tableswitch or \c lookupswitch are decoded the first time it runs into a table of
+ * native ints kept with its method, and the instruction is quickened to an opcode that uses the table instead of
+ * aligning and decoding the big-endian operands every time.  A \c lookupswitch whose keys fill at least half of their
+ * range gets a table indexed directly by key, like a \c tableswitch - others keep their keys sorted for a binary
+ * search.  The bytecode itself is not changed.  The tables are taken from the heap and freed with their clazz.
  *
- * Default is 16 buckets.
+ * Default is enabled.
  */
-#ifndef BVM_NATIVEMETHOD_POOL_BUCKETCOUNT
-#define BVM_NATIVEMETHOD_POOL_BUCKETCOUNT 	16
+#ifndef BVM_EXEC_SWITCH_TABLES_ENABLE
+#define BVM_EXEC_SWITCH_TABLES_ENABLE 1
 #endif
 
 /**
- * Default number of hash buckets in the clazz pool.  Can be set using command line option \c -clazzb.  The
- * #bvm_gl_clazz_pool_bucketcount global variable will be set to #BVM_CLAZZ_POOL_BUCKETCOUNT if no command line
- * value is given.
+ * When set, the \c StringBuilder (or \c StringBuffer) idiom that javac compiles a string concatenation \c a+b+c to is
+ * recognised the first time its \c new is quickened, and from then on the whole idiom - up to and including the
+ * \c toString() - runs as one native concatenation.  The length of the result is worked out first, so the String and
+ * its char array are each allocated just once, rather than the builder growing its buffer and \c toString() copying
+ * it again.  Only concatenations of Strings, ints, chars and booleans that are each pushed by a single local variable
+ * load or constant are recognised - anything else is left to run as bytecode.  The bytecode itself is not changed.
  *
- * Default is 64 buckets.
+ * Default is enabled.
  */
-#ifndef BVM_CLAZZ_POOL_BUCKETCOUNT
-#define BVM_CLAZZ_POOL_BUCKETCOUNT 	64
+#ifndef BVM_EXEC_STRING_CONCAT_ENABLE
+#define BVM_EXEC_STRING_CONCAT_ENABLE 1
 #endif
 
 /**
- * Default max file handles.  Can be set using command line option \c -files.  The #bvm_gl_max_file_handles
- * global variable will be set to #BVM_MAX_FILE_HANDLES if no command line value is given.
+ * When set, native methods registered as 'leaf' natives - ones that never throw, allocate, block, or look at their
+ * own stack frame, like \c Math.floor or \c System.currentTimeMillis - are called straight from the invoking
+ * opcode without a native method frame being pushed and popped around them.
  *
- * Default is 32 files.
+ * Default is enabled.
  */
-#ifndef BVM_MAX_FILE_HANDLES
-#define BVM_MAX_FILE_HANDLES 		32
+#ifndef BVM_NATIVE_LEAF_CALLS_ENABLE
+#define BVM_NATIVE_LEAF_CALLS_ENABLE 1
 #endif
 
 /**
- * Number of opcodes to use when calculating a thread's timeslice.  Default is 300 opcodes normally, or 100
- * opcodes if debugging is enabled.
+ * When set, a method of a class loaded by the bootstrap classloader may be replaced by a native registered for it
+ * as a 'replacement' native.  The method's bytecode is discarded as it is loaded and the method is linked as a
+ * native instead.  This is used for the \c StringBuffer and \c StringBuilder \c append overloads for primitives
+ * which, in the class library, format a temporary \c String and then append it.
+ *
+ * Default is enabled.
  */
-#ifndef BVM_THREAD_TIMESLICE
-#if BVM_DEBUGGER_ENABLE
-#define BVM_THREAD_TIMESLICE 		100
-#else
-#define BVM_THREAD_TIMESLICE 		300
+#ifndef BVM_NATIVE_REPLACEMENT_ENABLE
+#define BVM_NATIVE_REPLACEMENT_ENABLE 1
 #endif
+
+/**
+ * When set with #BVM_NATIVE_REPLACEMENT_ENABLE, canonical boxes for the \c Integer values -128 to 127 and the
+ * \c Character values 0 to 127 are cached.  They are #BVM_ALLOC_TYPE_STATIC, so the collector never looks at them.  \c Integer.valueOf(int) and \c Character.valueOf(char) are replaced by natives that give the
+ * cached box for a value in range, and with #BVM_EXEC_INTRINSICS_ENABLE a call to either is done inline for such a
+ * value.  Boxing small values then allocates nothing.  \c Boolean.valueOf already gives one of its two constants.
+ * Each box is made the first time its value is boxed, and is kept for the life of the VM.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_NATIVE_BOX_CACHE_ENABLE
+#define BVM_NATIVE_BOX_CACHE_ENABLE 1
 #endif
 
-/* Sanity check - float support requires native 64 bit integer support */
-#if BVM_FLOAT_ENABLE
-#if (!BVM_NATIVE_INT64_ENABLE)
-#error "Floating point support requires BVM_NATIVE_INT64_ENABLE to be 1"
+#if (BVM_NATIVE_BOX_CACHE_ENABLE && !BVM_NATIVE_REPLACEMENT_ENABLE)
+#undef BVM_NATIVE_BOX_CACHE_ENABLE
+#define BVM_NATIVE_BOX_CACHE_ENABLE 0
 #endif
+
+/**
+ * When set, \c System.arraycopy copies a few elements inline rather than calling \c memmove, uses \c memcpy when
+ * the source and destination are different arrays, and copies a reference array whose elements must be checked
+ * against the destination component type in one go once they have been checked - with the clazz of each run of
+ * like elements checked only once.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_NATIVE_ARRAYCOPY_SPECIALISED_ENABLE
+#define BVM_NATIVE_ARRAYCOPY_SPECIALISED_ENABLE 1
 #endif
 
-#ifndef BVM_32BIT_ENABLE
-#define BVM_32BIT_ENABLE 0
-#if (!BVM_NATIVE_INT64_ENABLE)
-#error "64 bit systems must not have BVM_NATIVE_INT64_ENABLE as 0"
+/**
+ * When set with #BVM_NATIVE_REPLACEMENT_ENABLE, the single byte, typed (\c short, \c char, \c int and \c long) and
+ * bulk \c get and \c put methods of \c java.nio.ByteBuffer are replaced by natives.  The class library assembles
+ * and splits typed values a byte at a time in bytecode, with a bounds check and a field load for each byte - the
+ * natives check the bounds once and move the bytes in the buffer's byte order together.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_NATIVE_BYTEBUFFER_ENABLE
+#define BVM_NATIVE_BYTEBUFFER_ENABLE 1
 #endif
+
+/**
+ * When set, the natives of the \c babe.util primitive collections are available - \c IntHashMap and \c LongHashMap,
+ * maps of \c int and \c long keys to objects, and \c IntArray and \c LongArray, growable arrays of \c int and
+ * \c long.  Keys and elements are never boxed, and no call is synchronised.  The maps are open addressed with linear
+ * probing over a power of two sized table.  The storage of each collection is ordinary Java arrays held in its fields,
+ * so the GC finds and traces it like any other.  The \c long collections also need #BVM_NATIVE_INT64_ENABLE.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_NATIVE_COLLECTIONS_ENABLE
+#define BVM_NATIVE_COLLECTIONS_ENABLE 1
 #endif
 
-/* Sanity check - X86 endian-ness */
-//#ifdef BVM_CPU_X86
-//#undef BVM_BIG_ENDIAN_ENABLE
-//#define BVM_BIG_ENDIAN_ENABLE 0
-//#endif
+/**
+ * When set, each thread keeps the \c AccessControlContext last built from its stack by
+ * \c SecurityManager.getStackAccessControlContext.  The stack is still walked on each call, but only to collect its
+ * protection domains into a small native list (see #BVM_NATIVE_ACCESS_CONTEXT_DOMAINS) - if they are the same as those of
+ * the kept context, it is given back again rather than a new context and array being allocated.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_NATIVE_ACCESS_CONTEXT_CACHE_ENABLE
+#define BVM_NATIVE_ACCESS_CONTEXT_CACHE_ENABLE 1
+#endif
 
 /**
- * "Direct Threading" takes advantage of the GCC ability to treat labels as first class values and are
- * used with "goto" to speed up a 'switch'-like statement.  If \c __GNUC__ is defined we'll define
- * \c BVM_DIRECT_THREADING_ENABLE=1 so that the interp dispatch can be sped up.  Probably by 5% to 10%.
+ * When set, native methods may call Java methods through the NI with the \c NI_CallTYPEMethod and
+ * \c NI_CallStaticTYPEMethod functions, using method IDs from #NI_GetMethodID and #NI_GetStaticMethodID.  A call
+ * runs the method to completion in a nested interpreter loop before control returns to the native method.
  *
- * On GNUC, direct threading will be enabled by default, but can be turned off by
- * defining \c BVM_DIRECT_THREADING_ENABLE=0.
+ * Default is enabled.
+ */
+#ifndef BVM_NI_CALLS_ENABLE
+#define BVM_NI_CALLS_ENABLE 1
+#endif
+
+/**
+ * When set, #NI_MallocLocal bumps its memory from an arena of blocks that belongs to the current native method call,
+ * rather than allocating each from the heap and making each a transient root.  Only each block is a transient root,
+ * and the whole arena is freed in one go when the native method returns (see #BVM_NI_LOCAL_ARENA_BLOCK_SIZE).
  *
- * @note The use of direct threading avoids a few extra machine instructions that a 'switch'
- * statement generates to range check.  If GCC, unless you're having issues, direct threading is
- * recommended.
+ * Default is enabled.
+ */
+#ifndef BVM_NI_LOCAL_ARENA_ENABLE
+#define BVM_NI_LOCAL_ARENA_ENABLE 1
+#endif
+
+/**
+ * When set, the runtime exceptions the interpreter raises itself - \c NullPointerException,
+ * \c ArrayIndexOutOfBoundsException, \c ArithmeticException, \c ClassCastException and the like - are handed
+ * straight to the \c athrow handling instead of being thrown natively with a \c longjmp, and the interpreter's
+ * native try block does not have to be re-entered afterwards.  The clazz of each exception handler's catch type is
+ * also remembered once it has been looked up, so locating a handler no longer goes to the clazz pool.
  *
+ * Default is enabled.
  */
-#ifndef BVM_DIRECT_THREADING_ENABLE
-#if (defined(__GNUC__))
-#define BVM_DIRECT_THREADING_ENABLE 1
-#else
-#define BVM_DIRECT_THREADING_ENABLE 0
+#ifndef BVM_EXEC_FAST_THROW_ENABLE
+#define BVM_EXEC_FAST_THROW_ENABLE 1
+#endif
+
+/**
+ * When set, a method with at least #BVM_EXEC_HANDLER_INDEX_MIN exception handlers gets an index of them by pc range
+ * when its exception table is loaded.  The pcs at which handler ranges start and end split the method's code into
+ * intervals, and each interval lists the handlers covering it in table order.  Finding the handler for a throw then
+ * binary searches the intervals instead of scanning the whole table, which matters for methods with very large
+ * try/catch tables such as generated parsers.  A method whose ranges nest so deeply that the lists would be more than
+ * four times the size of its table is not indexed.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_EXEC_HANDLER_INDEX_ENABLE
+#define BVM_EXEC_HANDLER_INDEX_ENABLE 1
+#endif
+
+/**
+ * The fewest exception handlers a method must have to be given a handler index - see
+ * #BVM_EXEC_HANDLER_INDEX_ENABLE.  The tables of smaller methods are scanned.
+ *
+ * Default is 8.
+ */
+#ifndef BVM_EXEC_HANDLER_INDEX_MIN
+#define BVM_EXEC_HANDLER_INDEX_MIN 8
+#endif
+
+/** Superinstruction for \c aload_0 followed by \c getfield.  See #BVM_EXEC_SUPERINSTRUCTIONS. */
+#define BVM_EXEC_SUPERINSTRUCTION_ALOAD_0_GETFIELD 		0x01
+
+/** Superinstruction for \c iload followed by \c iload.  See #BVM_EXEC_SUPERINSTRUCTIONS. */
+#define BVM_EXEC_SUPERINSTRUCTION_ILOAD_ILOAD 			0x02
+
+/** Superinstruction for \c iload, \c iload then an \c if_icmp<cond>.  See #BVM_EXEC_SUPERINSTRUCTIONS. */
+#define BVM_EXEC_SUPERINSTRUCTION_ILOAD_ILOAD_IF_ICMP 	0x04
+
+/** Superinstruction for \c aload followed by \c arraylength.  See #BVM_EXEC_SUPERINSTRUCTIONS. */
+#define BVM_EXEC_SUPERINSTRUCTION_ALOAD_ARRAYLENGTH 	0x08
+
+/**
+ * The set of bytecode sequences fused into single superinstructions as methods are loaded, as a mask of the
+ * \c BVM_EXEC_SUPERINSTRUCTION_xxx values.  A fused sequence runs as one opcode dispatch instead of two or three.  Only
+ * the first opcode of a sequence is rewritten, so a branch to a later instruction in it still works.  Zero disables
+ * superinstructions.
+ *
+ * Default is all of them.
+ */
+#ifndef BVM_EXEC_SUPERINSTRUCTIONS
+#define BVM_EXEC_SUPERINSTRUCTIONS (BVM_EXEC_SUPERINSTRUCTION_ALOAD_0_GETFIELD | \
+									BVM_EXEC_SUPERINSTRUCTION_ILOAD_ILOAD | \
+									BVM_EXEC_SUPERINSTRUCTION_ILOAD_ILOAD_IF_ICMP | \
+									BVM_EXEC_SUPERINSTRUCTION_ALOAD_ARRAYLENGTH)
+#endif
+
+/**
+ * When set, the interpreter loop keeps the pc, sp and locals registers in local variables, which the compiler may
+ * keep in CPU registers, rather than reading and writing the global registers for every opcode.  The globals are
+ * only brought up to date around calls out of the loop that use them - allocation, exceptions, class
+ * initialisation, method invocation and return, thread switches and the debugger.  Most worthwhile when the
+ * globals are thread local (see #BVM_VM_INSTANCES_ENABLE).
+ *
+ * Default is disabled.
+ */
+#ifndef BVM_USE_REGISTERS
+#define BVM_USE_REGISTERS 0
+#endif
+
+/**
+ * When set, hot methods are compiled to native code by a baseline template JIT (see jit.c).  A method becomes hot
+ * when the count of its invocations and backward branches reaches #BVM_JIT_THRESHOLD.  The compiled code works on
+ * the same frames, locals and operand stack as the interpreter and hands back to the interpreter for anything it
+ * does not translate, so a method that becomes hot in a long running loop goes into its compiled code at the next
+ * backward branch, frame and all.  Only x86-64 hosts have a JIT - on others this is turned off.
+ *
+ * Default is disabled.
+ */
+#ifndef BVM_JIT_ENABLE
+#define BVM_JIT_ENABLE 0
+#endif
+
+/**
+ * When set, methods translated to C ahead of time can be linked into the VM and run in place of their bytecode (see
+ * aot.c).  A training run with \c -aotwrite writes the C for the methods of the classes it loads, and the build links
+ * the file given by the \c BVM_AOT_SOURCE cmake variable.  Like JIT compiled code, translated code works on the
+ * interpreter's own frames and hands back to the interpreter for anything it does not translate.  Without a linked
+ * file the cost is a test of the current method at each return and backwards branch.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_AOT_ENABLE
+#define BVM_AOT_ENABLE 1
+#endif
+
+/**
+ * When set, methods are run from a register based code that each part of a method is translated to the first time
+ * it runs (see ir.c).  The register code works on the interpreter's own frames, with the locals and operand stack
+ * cells as its registers, and has field offsets worked out as it is translated.  Like compiled code it hands back to
+ * the interpreter for anything it does not translate, so the bytecode remains the form the debugger, stack traces
+ * and exceptions see.
+ *
+ * Default is disabled.
+ */
+#ifndef BVM_EXEC_REGISTER_IR_ENABLE
+#define BVM_EXEC_REGISTER_IR_ENABLE 0
 #endif
+
+/**
+ * When set, small heap allocations are bump-allocated from an allocation buffer that belongs to the current thread
+ * rather than searched for in the heap free lists.  The buffer is retired back to the heap at each thread switch
+ * and before each GC.  See #BVM_HEAP_TLAB_SIZE.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_HEAP_TLAB_ENABLE
+#define BVM_HEAP_TLAB_ENABLE 1
+#endif
+
+/**
+ * When set, each large primitive array (see #BVM_HEAP_LARGE_OBJECT_SIZE) is allocated in a heap region of its own
+ * rather than from the free list, and the region is given back to the platform as a whole when the array is swept.  Big
+ * buffers then do not fragment the heap.  Large object regions count towards the heap size, so are only used if the heap
+ * may grow (see #BVM_HEAP_LIMIT).
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_HEAP_LARGE_OBJECT_ENABLE
+#define BVM_HEAP_LARGE_OBJECT_ENABLE 1
+#endif
+
+/**
+ * When set, the VM's own long-lived data - the constant pools, fields, methods, bytecode and tables of loaded clazzes,
+ * pooled utfstrings, native method descriptors and monitors - is bump-allocated from a metadata arena of its own rather
+ * than from the heap.  The arena is a list of regions from the platform (see #BVM_HEAP_METADATA_REGION_SIZE) that the
+ * collector never walks, so this data neither pins the heap against coalescing nor lengthens the sweep.  Memory freed
+ * back to the arena (as clazzes are unloaded) is reused, and a region that becomes empty is given back.  The arena
+ * does not count towards the heap size.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_HEAP_METADATA_ARENA_ENABLE
+#define BVM_HEAP_METADATA_ARENA_ENABLE 1
+#endif
+
+/**
+ * When set, large free chunks are zeroed a step at a time (see #BVM_HEAP_IDLE_ZERO_STEP) while the VM is idle - when
+ * no thread is runnable and the VM would otherwise wait in the platform.  A zeroed chunk is flagged as such in its
+ * header, and an allocation that must be zeroed (#bvm_heap_calloc, so new objects and arrays) does not zero it again.
+ * Big arrays then cost little more to allocate than small ones.  The VM only waits once there is nothing left to zero.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_HEAP_IDLE_ZERO_ENABLE
+#define BVM_HEAP_IDLE_ZERO_ENABLE 1
+#endif
+
+/**
+ * When set, the collector is generational.  Objects that survive a collection are 'old' and most collections are
+ * 'minor' collections that only mark and free objects allocated since the last collection.  Stores of references into
+ * old objects are caught by a write barrier (see #BVM_GC_WRITE_BARRIER) and remembered for the next minor collection.  A
+ * full collection is done when a minor one does not free enough (see #BVM_GC_FULL_PERCENT).
+ *
+ * Default is disabled.
+ *
+ * @note Any native code that stores a reference into an existing object must use #BVM_GC_WRITE_BARRIER.
+ */
+#ifndef BVM_GC_GENERATIONAL_ENABLE
+#define BVM_GC_GENERATIONAL_ENABLE 0
+#endif
+
+/**
+ * When set, the collector marks incrementally.  Once the heap is short of free space (see
+ * #BVM_GC_INCREMENTAL_START_PERCENT) a marking cycle is started and a bounded amount of marking (see
+ * #BVM_GC_INCREMENTAL_SLICE_BUDGET) is done at each thread switch.  Stores of references into already marked objects
+ * are caught by a write barrier (see #BVM_GC_WRITE_BARRIER).  The cycle is finished by a short pause that re-marks the
+ * roots and sweeps the heap.
+ *
+ * Default is disabled.  May not be used with #BVM_GC_GENERATIONAL_ENABLE.
+ *
+ * @note Any native code that stores a reference into an existing object must use #BVM_GC_WRITE_BARRIER.
+ */
+#ifndef BVM_GC_INCREMENTAL_ENABLE
+#define BVM_GC_INCREMENTAL_ENABLE 0
+#endif
+
+/**
+ * When set, a GC may be started at a thread switch before the heap is exhausted - once a budget of bytes has been
+ * allocated since the last GC (see #BVM_GC_ALLOC_BUDGET), or once the free space falls below a threshold (see
+ * #BVM_GC_BUDGET_FREE_PERCENT).  Collections then happen at a quiet moment with some of the heap still free, rather than
+ * in the allocation slow path with none.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_GC_BUDGET_ENABLE
+#define BVM_GC_BUDGET_ENABLE 1
+#endif
+
+/**
+ * When set, a full GC is done while the VM is idle - when no thread is runnable and none is due to wake for at least
+ * #BVM_GC_IDLE_MIN_TIME milliseconds - as long as enough has been allocated since the last GC (see
+ * #BVM_GC_IDLE_MIN_PERCENT) or an incremental marking cycle is under way.  The heap is then mostly collected between
+ * bursts of work rather than in the middle of the next one.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_GC_IDLE_ENABLE
+#define BVM_GC_IDLE_ENABLE 1
+#endif
+
+/**
+ * When set, the heap is not swept in the GC pause.  Instead it is swept a step at a time (see
+ * #BVM_GC_LAZY_SWEEP_STEP) by the allocator when it cannot find a free chunk, so the pause is only as long
+ * as the marking.  Memory freed by a GC becomes available as it is swept.
+ *
+ * Default is disabled.  May not be used with #BVM_GC_GENERATIONAL_ENABLE.
+ */
+#ifndef BVM_GC_LAZY_SWEEP_ENABLE
+#define BVM_GC_LAZY_SWEEP_ENABLE 0
+#endif
+
+/**
+ * When set, the collector shares the char arrays of equal Strings.  As each String is marked its char array is hashed
+ * by content and looked up in a table of the arrays already marked by the same GC (see
+ * #BVM_GC_STRING_DEDUP_TABLE_SIZE).  If an equal one is found the String is given it instead, and its own array is
+ * freed by the sweep unless something else refers to it.  Only a String that uses the whole of its array is
+ * deduplicated.
+ *
+ * Default is disabled.
+ *
+ * @note A native must not keep the pointer given by \c NI_GetStringChars across anything that may GC.
+ */
+#ifndef BVM_GC_STRING_DEDUP_ENABLE
+#define BVM_GC_STRING_DEDUP_ENABLE 0
+#endif
+
+/**
+ * When set, the heap is compacted when it becomes fragmented.  After a GC, if the largest free chunk is too small a part
+ * of the free space (see #BVM_GC_COMPACT_FRAGMENTATION_PERCENT) a compaction is done at the next thread switch.  Live
+ * arrays are slid down towards the start of their region to close up the free space between them.  Arrays referred to
+ * from a thread stack or a VM root are not moved.  Nothing is compacted while a debugger is attached.
+ *
+ * Default is disabled.
+ *
+ * @note Without #BVM_OBJECT_IDENTITY_HASH_ENABLE moving an array changes its identity hash code.
+ */
+#ifndef BVM_GC_COMPACTION_ENABLE
+#define BVM_GC_COMPACTION_ENABLE 0
+#endif
+
+/**
+ * When set, the mark phase of a GC is shared between the VM thread and a number of host OS threads (see
+ * #BVM_GC_MARK_THREADS).  The roots are found by the VM thread as usual, then every marker scans grey chunks from a
+ * mark stack of its own, handing some of its work to a shared pool when another marker runs dry.  A chunk is claimed for
+ * scanning by an atomic compare-and-swap of the colour in its header, so each is scanned once.  The Java threads are
+ * all stopped while this happens, so no write barrier is needed.  A GC with less of the heap in use than
+ * #BVM_GC_PARALLEL_MARK_MIN_USED is marked by the VM thread alone.
+ *
+ * Default is disabled.  May not be used with #BVM_VM_INSTANCES_ENABLE, #BVM_GC_INCREMENTAL_ENABLE or
+ * #BVM_GC_STRING_DEDUP_ENABLE.  Requires the platform to define \c BVM_PD_ATOMIC_CAS and \c BVM_PD_THREAD_LOCAL.
+ */
+#ifndef BVM_GC_PARALLEL_MARK_ENABLE
+#define BVM_GC_PARALLEL_MARK_ENABLE 0
+#endif
+
+/**
+ * When set, the heap is swept by a host OS thread while the interpreter carries on after a GC, so the pause is only as
+ * long as the marking.  The free lists are emptied at the end of the marking and the sweeper hands back what it has
+ * swept every #BVM_GC_CONCURRENT_SWEEP_STEP bytes.  The allocator only uses memory that has been handed back - when it
+ * runs out it takes what the sweeper has done since, waiting for it if there is nothing yet.  A chunk freed ahead of
+ * the sweeper is held until the sweep is done.  Unreachable clazzes are unloaded by the VM thread once the sweep is
+ * done.  The heap is swept in the GC pause as usual while a debugger is attached.
+ *
+ * Default is disabled.  May not be used with #BVM_VM_INSTANCES_ENABLE, #BVM_GC_GENERATIONAL_ENABLE,
+ * #BVM_GC_INCREMENTAL_ENABLE, #BVM_GC_LAZY_SWEEP_ENABLE or #BVM_GC_COMPACTION_ENABLE.  Turns off
+ * #BVM_THIN_LOCK_HEADER_ENABLE - the sweeper changes the headers of live chunks.  Requires the platform to define
+ * \c BVM_PD_ATOMIC_CAS.
+ */
+#ifndef BVM_GC_CONCURRENT_SWEEP_ENABLE
+#define BVM_GC_CONCURRENT_SWEEP_ENABLE 0
+#endif
+
+/**
+ * When set, the identity hash code of an object (\c Object.hashCode and \c System.identityHashCode) is its address
+ * with the bits mixed, rather than just its address cut to 32 bits - objects that are aligned and close together in
+ * the heap otherwise have hashes that share their low bits and crowd the same buckets of a \c Hashtable.  With
+ * #BVM_GC_COMPACTION_ENABLE an array is also given an entry in a side table the first time it is asked for its hash, and
+ * the entry goes with the array when it is moved, so its hash is stable (see #BVM_OBJECT_IDENTITY_HASH_TABLE_SIZE).
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_OBJECT_IDENTITY_HASH_ENABLE
+#define BVM_OBJECT_IDENTITY_HASH_ENABLE 1
+#endif
+
+/**
+ * When set, a multi-dimensional array created by \c multianewarray is allocated with one call to the heap and its
+ * sub-arrays are carved from that memory one after another - the outer array first, then each sub-array with its own
+ * sub-arrays after it.  Each is still a chunk of its own, so a row that is no longer referred to is collected as
+ * usual, but a matrix lies together in the heap in the order it is walked.  Arrays bigger in total than
+ * #BVM_OBJECT_MULTI_ARRAY_CONTIGUOUS_MAX_SIZE are allocated one at a time.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_OBJECT_MULTI_ARRAY_CONTIGUOUS_ENABLE
+#define BVM_OBJECT_MULTI_ARRAY_CONTIGUOUS_ENABLE 1
+#endif
+
+/**
+ * When set, the frames of a thread stack that are waiting on a call are scanned by the collector using a reference map
+ * for the call site - only the locals and stack cells that hold a reference are marked.  The maps of a method are
+ * worked out from its bytecode the first time the collector finds one of its frames waiting on a call, and are kept
+ * outside the heap until its class is unloaded.  The top frame of each thread, native frames, and all frames while a
+ * debugger is attached are still scanned conservatively.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_GC_STACK_MAPS_ENABLE
+#define BVM_GC_STACK_MAPS_ENABLE 1
+#endif
+
+/**
+ * When set, the collector keeps statistics for each GC - its pause time, the bytes it reclaimed of each alloc type, and
+ * the state of the free list afterwards.  These are available to 'C' through #bvm_gc_get_stats and to Java through the
+ * \c Runtime.gcStats0 native.  Each GC is also logged to the console if the VM is started with \c -verbose:gc.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_GC_STATS_ENABLE
+#define BVM_GC_STATS_ENABLE 1
+#endif
+
+/**
+ * When set, the heap can be dumped in the HPROF binary format for analysis with standard heap tools - to a file or a
+ * socket through #bvm_heapdump_to_file and #bvm_heapdump_to_socket.  If the VM is started with \c -heapdump a dump
+ * is written to the given file the first time an \c OutOfMemoryError is thrown.
+ *
+ * Default is disabled.
+ */
+#ifndef BVM_HEAP_DUMP_ENABLE
+#define BVM_HEAP_DUMP_ENABLE 0
+#endif
+
+/**
+ * When set, the VM has a sampling profiler.  Every #BVM_PROFILER_SAMPLE_INTERVAL thread switches the stack of the
+ * running thread is sampled and counted by its methods and the source line of its top frame.  The counts are
+ * written in the 'collapsed stack' format used by flame graph tools.  The profiler is started and stopped at runtime
+ * through \c babe.lang.Profiler, or for the whole run with the \c -profile command line option.  When compiled in
+ * but not started, the only cost is a flag test at each thread switch.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_PROFILER_ENABLE
+#define BVM_PROFILER_ENABLE 1
+#endif
+
+/**
+ * When set, each method keeps exact counts of its invocations, the bytecodes dispatched in it, the objects and arrays it
+ * allocates, and the milliseconds spent in it (not counting the methods it calls).  The counts are written at VM exit
+ * with the \c -methodcounts command line option, or at runtime through \c babe.lang.Profiler.  Unlike the sampling
+ * profiler this costs on every bytecode and every call, so it is for measurement builds only.  Bytecodes run as
+ * compiled code with #BVM_JIT_ENABLE, and getters and setters inlined by #BVM_EXEC_ACCESSOR_INLINING_ENABLE, are not
+ * counted.
+ *
+ * Default is disabled.
+ */
+#ifndef BVM_PROFILER_METHOD_COUNTERS_ENABLE
+#define BVM_PROFILER_METHOD_COUNTERS_ENABLE 0
+#endif
+
+/**
+ * When set, the interpreter loop counts each opcode it dispatches and each pair of consecutively dispatched opcodes -
+ * the quickened and fused opcodes the VM rewrites bytecode to are counted as themselves.  The counts are written
+ * sorted, most frequent first, at VM exit with the \c -opcodes command line option.  They are the data to choose
+ * superinstructions and the handlers to tune from.  This costs on every bytecode, so it is for measurement builds
+ * only.  Bytecodes run as compiled code with #BVM_JIT_ENABLE are not counted.
+ *
+ * Default is disabled.
+ */
+#ifndef BVM_PROFILER_OPCODE_HISTOGRAM_ENABLE
+#define BVM_PROFILER_OPCODE_HISTOGRAM_ENABLE 0
+#endif
+
+/**
+ * When set, about every #BVM_PROFILER_ALLOCATION_SAMPLE_BYTES bytes allocated the method and pc that asked for the
+ * memory is recorded as an allocation site, weighted by the bytes allocated since the last sample.  The sites are
+ * written ranked by bytes at VM exit with the \c -allocsites command line option.  With #BVM_HEAP_DUMP_ENABLE, the
+ * sampled objects that are still alive are given the stack trace of their site in a heap dump, so retained memory can
+ * be tied to the code that allocated it.  The cost is a subtraction on each allocation and a table lookup on each
+ * sample, so it is for measurement builds.
+ *
+ * Default is disabled.
+ */
+#ifndef BVM_PROFILER_ALLOCATION_SITES_ENABLE
+#define BVM_PROFILER_ALLOCATION_SITES_ENABLE 0
+#endif
+
+/**
+ * When set, monitors are profiled.  Each time a thread blocks for a monitor another thread owns, the clazz of the
+ * monitor's object and the method and pc that asked for it are counted as a contended site, and the time the thread
+ * stays blocked is added to the site.  Waits and notifies are counted at their sites too.  The sites are written
+ * ranked by time blocked at VM exit with the \c -contention command line option, or at runtime through
+ * \c babe.lang.Profiler.  The cost is a stack walk and a table lookup on each contended acquire, wait and notify, so
+ * it is for measurement builds.
+ *
+ * Default is disabled.
+ */
+#ifndef BVM_PROFILER_MONITOR_CONTENTION_ENABLE
+#define BVM_PROFILER_MONITOR_CONTENTION_ENABLE 0
+#endif
+
+/**
+ * When set, the VM can time its own startup - each phase of its initialisation, each class load (with the bytes read
+ * and the time spent inflating them) and each class initialisation.  With the \c -starttrace command line option the
+ * timings are written at VM exit as a Chrome trace event file, which \c chrome://tracing, Perfetto and similar tools
+ * show as a timeline.  When compiled in but not asked for, the cost is a test at each phase, class load and class
+ * initialisation.
+ *
+ * Default is disabled.
+ */
+#ifndef BVM_PROFILER_STARTUP_TRACE_ENABLE
+#define BVM_PROFILER_STARTUP_TRACE_ENABLE 0
+#endif
+
+/**
+ * When set, native profilers like \c perf and eBPF tools can attribute time to Java methods.  With the \c -perfmap
+ * command line option the native code of each method compiled by #BVM_JIT_ENABLE is written to the
+ * \c /tmp/perf-&lt;pid&gt;.map file \c perf reads symbols for generated code from.  For interpreted code the VM exports
+ * a #bvm_perf_descriptor symbol giving the address of the current method register and the layout of methods, names
+ * and frames, so a tool reading the process memory can walk the Java stack of a sample.  The only cost is a file
+ * write for each compiled method.
+ *
+ * Default is disabled.
+ */
+#ifndef BVM_PROFILER_PERF_ENABLE
+#define BVM_PROFILER_PERF_ENABLE 0
+#endif
+
+/**
+ * When set, the classes loaded by the bootstrap class loader can be written to a class image file at VM exit (with the
+ * \c -imagewrite command line option) and read back from one at VM startup (with \c -image).  Classes found in the
+ * image are not read and inflated from the boot classpath jar, which makes VM startup a good deal quicker.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_CLAZZ_IMAGE_ENABLE
+#define BVM_CLAZZ_IMAGE_ENABLE 1
+#endif
+
+/**
+ * When set, the whole VM as it is once its main class is initialised, just before \c main runs - the heap with its
+ * pools and loaded classes, and every #BVM_VM_LOCAL variable - can be written to a snapshot file (with the
+ * \c -snapshotwrite command line option) and restored from one at a later startup (with \c -snapshot) in place of
+ * initialising the VM and the main class.  See snapshot.c.
+ *
+ * Requires the platform to define \c BVM_PD_VM_STATE, which places all of the VM state together in the executable -
+ * the linux platform does.  Not with #BVM_VM_INSTANCES_ENABLE, #BVM_COMPRESSED_REFS_ENABLE, or
+ * #BVM_THREAD_TIMER_PREEMPTION_ENABLE, and turns off #BVM_JIT_ENABLE and #BVM_EXEC_REGISTER_IR_ENABLE.
+ *
+ * Default is disabled.
+ */
+#ifndef BVM_VM_SNAPSHOT_ENABLE
+#define BVM_VM_SNAPSHOT_ENABLE 0
+#endif
+
+/**
+ * Enables big endian support.
+ */
+#ifndef BVM_BIG_ENDIAN_ENABLE
+#define BVM_BIG_ENDIAN_ENABLE 0
+#endif
+
+/**
+ * Enables support for runtime binary compatibility checking in classes.
+ */
+#ifndef BVM_BINARY_COMPAT_CHECKING_ENABLE
+#define BVM_BINARY_COMPAT_CHECKING_ENABLE 1
+#endif
+
+/**
+ * Enables support for compression in jar files.
+ */
+#ifndef BVM_JAR_INFLATE_ENABLE
+#define BVM_JAR_INFLATE_ENABLE 1
+#endif
+
+/**
+ * When set (with #BVM_JAR_INFLATE_ENABLE), deflated jar entries are inflated by the table driven #bvm_inflate rather
+ * than the bundled tinf.  It decodes each Huffman code with one or two table lookups instead of a bit at a time, and
+ * reads its input a word at a time.  Costs about 7k of static decode tables.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_JAR_FAST_INFLATE_ENABLE
+#define BVM_JAR_FAST_INFLATE_ENABLE 1
+#endif
+
+/**
+ * When set, the central directory of each jar on a classpath is kept in memory with a hash table of its full path
+ * names.  Finding a file in a jar is then a hash probe, rather than a linear scan of a one byte hash of each entry that
+ * reads each candidate directory entry back from the jar.  Costs the size of the central directory per jar.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_JAR_DIRECTORY_INDEX_ENABLE
+#define BVM_JAR_DIRECTORY_INDEX_ENABLE 1
+#endif
+
+/**
+ * When set, the class files read from jars can be recorded to a preload profile at VM exit (with the
+ * \c -preloadwrite command line option), and a VM started with the profile (with \c -preload) reads and inflates all
+ * the class files in it before any class is loaded.  The files of each jar are read in the order they are in the jar,
+ * in a few large reads, rather than with a seek and a read or two for each class as it is loaded.  See preload.c.
+ *
+ * Needs #BVM_JAR_DIRECTORY_INDEX_ENABLE, and is unset without it.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_CLAZZ_PRELOAD_ENABLE
+#define BVM_CLAZZ_PRELOAD_ENABLE 1
+#endif
+
+#if (BVM_CLAZZ_PRELOAD_ENABLE && !BVM_JAR_DIRECTORY_INDEX_ENABLE)
+#undef BVM_CLAZZ_PRELOAD_ENABLE
+#define BVM_CLAZZ_PRELOAD_ENABLE 0
+#endif
+
+/**
+ * When set, an open file may be mapped into memory with #bvm_file_map on platforms that can (see #bvm_pd_file_map).
+ * Each jar on a classpath is mapped when first opened - a stored (uncompressed) class file is then used in place from
+ * the mapping rather than copied into a heap buffer, and a deflated one is inflated straight from the mapping.
+ * A \c babe.io.File may also be read in place through a \c babe.io.MappedFile.  Platforms that cannot map files
+ * read them as before.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_FILE_MAP_ENABLE
+#define BVM_FILE_MAP_ENABLE 1
+#endif
+
+/**
+ * When set (with #BVM_CLAZZ_PRELOAD_ENABLE), the class files of a preload profile in mapped jars are read and
+ * inflated by a host OS thread while the VM runs, rather than all before the first class is loaded.  The VM takes a
+ * class file from the thread if it has been read, and otherwise reads it from the jar itself as usual - the thread then
+ * skips it.  Class files of jars that are not mapped are still read before the first class is loaded.  Only worth
+ * having on a multi core host.  Requires platform OS threads and locks - the linux, osx and winos platforms have them.
+ *
+ * Needs #BVM_FILE_MAP_ENABLE, and is unset without it.
+ *
+ * Default is disabled.
+ */
+#ifndef BVM_CLAZZ_PREFETCH_ENABLE
+#define BVM_CLAZZ_PREFETCH_ENABLE 0
+#endif
+
+#if (BVM_CLAZZ_PREFETCH_ENABLE && !(BVM_CLAZZ_PRELOAD_ENABLE && BVM_FILE_MAP_ENABLE))
+#undef BVM_CLAZZ_PREFETCH_ENABLE
+#define BVM_CLAZZ_PREFETCH_ENABLE 0
+#endif
+
+/**
+ * When set, the reads and writes of a \c babe.io.File go through a buffer of #BVM_FILE_BUFFER_SIZE bytes kept with its
+ * file handle (see #bvm_file_buffered_read and #bvm_file_buffered_write).  Small reads are served from a read-ahead of
+ * the file, and small writes are gathered and written together.  The buffer is synchronised with the file before it
+ * is positioned, sized, truncated, flushed or closed.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_FILE_BUFFER_ENABLE
+#define BVM_FILE_BUFFER_ENABLE 1
+#endif
+
+/**
+ * When set, a \c babe.io.File may be read and written without holding up the whole VM while the storage is slow (flash
+ * or an SD card, say).  The read or write is handed to a host OS thread and only the Java thread that asked for it is
+ * parked until it is done - other Java threads carry on.  See #bvm_file_async_start and #bvm_thread_wait_for_file.
+ * Requires platform OS threads and locks - the linux, osx and winos platforms have them.
+ *
+ * Default is disabled.
+ */
+#ifndef BVM_FILE_ASYNC_ENABLE
+#define BVM_FILE_ASYNC_ENABLE 0
+#endif
+
+/**
+ * When set, the file handles table starts with #bvm_gl_max_file_handles entries and doubles in size when all are in
+ * use, so the number of open files is limited only by the platform and the heap.  Unused entries are kept in a free
+ * list, so opening and closing a file does not search the table.  When not set, #bvm_gl_max_file_handles is the most
+ * files that may be open at once.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_FILE_HANDLES_GROW_ENABLE
+#define BVM_FILE_HANDLES_GROW_ENABLE 1
+#endif
+
+/**
+ * When set, class loaders remember the classes they did not find on their own classpath and do not look for them
+ * again, and the bootstrap class loader keeps a combined index of the classes in the jars on the boot classpath (with
+ * #BVM_JAR_DIRECTORY_INDEX_ENABLE) so it looks in at most one of those jars for a class.  See #bvm_classpath_boot_segment.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_CLASSPATH_INDEX_ENABLE
+#define BVM_CLASSPATH_INDEX_ENABLE 1
+#endif
+
+/**
+ * When set, the utfstring, intern string, clazz and native method pools double their hash bucket count (and rehash
+ * their entries) when the average bucket holds more than #BVM_POOL_MAX_LOAD entries.  The bucket counts given on the
+ * command line are then just starting sizes.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_POOL_RESIZE_ENABLE
+#define BVM_POOL_RESIZE_ENABLE 1
+#endif
+
+/**
+ * Enables support for ANSI C console.
+ */
+#ifndef BVM_ANSI_CONSOLE_ENABLE
+#define BVM_ANSI_CONSOLE_ENABLE 1
+#endif
+
+/**
+ * Enables support for ANSI C file operations.
+ */
+#ifndef BVM_ANSI_FILE_ENABLE
+#define BVM_ANSI_FILE_ENABLE 1
+#endif
+
+/**
+ * Enables support for ANSI C heap.
+ */
+#ifndef BVM_ANSI_MEMORY_ENABLE
+#define BVM_ANSI_MEMORY_ENABLE 1
+#endif
+
+/**
+ * Enables support for sockets.
+ */
+#ifndef BVM_SOCKETS_ENABLE
+#define BVM_SOCKETS_ENABLE 1
+#endif
+
+/**
++ * Enables BSD sockets - assumes \c BVM_SOCKETS_ENABLE is also enabled.
++ */
+#ifndef BVM_BSD_SOCKETS_ENABLE
+#define BVM_BSD_SOCKETS_ENABLE 1
+#endif
+
+/**
+ * When set, the VM can serve a snapshot of its runtime metrics - heap size, free and used, bytes allocated, GC count and
+ * pause histogram, thread counts by state, clazz count and monitor count - as plain text in the Prometheus exposition
+ * format to anything that connects to a port given with the \c -metrics command line option.  Requests are answered
+ * from the thread switch like the debugger's, so no JDWP session is needed.  Assumes \c BVM_SOCKETS_ENABLE and
+ * \c BVM_GC_STATS_ENABLE are also enabled.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_METRICS_ENABLE
+#define BVM_METRICS_ENABLE 1
+#endif
+
+/*
+ * Let the platform override anything it needs to, or whatever.  Notice that all the defines above this line
+ * are of a boolean on/off nature.  All defines below this line will set a default if no value has been given.
+ */
+
+/**
+ * The default listen port when debug listening on TCP transport in server mode.  When debug attaching to
+ * a debugger this is the default port to attach to on the default host name of "localhost". Only valid
+ * if debugger support is also enabled - refer #BVM_DEBUGGER_ENABLE.  Overridden with the \c
+ * address=xxxx setting the \c -Xrunjdwp command line option.
+ *
+ * Default is 8000.
+ */
+#ifndef BVM_DEBUGGER_SOCKET_PORT
+#define BVM_DEBUGGER_SOCKET_PORT 	8000
+#endif
+
+/**
+ * Default debugger connection attach/accept/handshake timeout in millseconds.  Can be set with the \c timeout=xxx
+ * setting in the =Xrunjdwp command line option.  Only valid if debugger support is also enabled - refer
+ * #BVM_DEBUGGER_ENABLE.  The #bvmd_gl_timeout global variable will be set to #BVM_DEBUGGER_TIMEOUT if no
+ * command line value is given.
+ *
+ * Default is 60000 milliseconds.
+ */
+#ifndef BVM_DEBUGGER_TIMEOUT
+#define BVM_DEBUGGER_TIMEOUT 		60000
+#endif
+
+/**
+ * Data packet size in bytes for reading/writing JDWP debug packets.   Only valid if debugger support is also
+ * enabled - refer #BVM_DEBUGGER_ENABLE.
+ *
+ * Default is 128 bytes.
+ */
+#ifndef BVM_DEBUGGER_PACKETDATA_SIZE
+#define BVM_DEBUGGER_PACKETDATA_SIZE 		128
+#endif
+
+/**
+ * The number of thread switches between checks for a metrics request.  Only valid if #BVM_METRICS_ENABLE is set and
+ * the VM was started with \c -metrics.
+ *
+ * Default is 100.
+ */
+#ifndef BVM_METRICS_INTERACTION_COUNT
+#define BVM_METRICS_INTERACTION_COUNT 		100
+#endif
+
+/**
+ * The longest time in milliseconds the VM sleeps in the platform in one go when no thread is runnable and a metrics
+ * server is listening - a metrics request made while the VM is idle is answered no later than this.  Only valid if
+ * #BVM_METRICS_ENABLE is set.
+ *
+ * Default is 100.
+ */
+#ifndef BVM_METRICS_POLL_MAX
+#define BVM_METRICS_POLL_MAX 		100
+#endif
+
+/**
+ * The longest time in milliseconds the VM waits for the request of a metrics client that has connected.  The VM does
+ * not run while it waits.  Only valid if #BVM_METRICS_ENABLE is set.
+ *
+ * Default is 100.
+ */
+#ifndef BVM_METRICS_REQUEST_TIMEOUT
+#define BVM_METRICS_REQUEST_TIMEOUT 		100
+#endif
+
+/**
+ * Batches the JDWP packet I/O with the debugger.  A packet is sent to the transport as a few large writes from a
+ * write buffer instead of a write per packet field and data segment, and an inbound packet is read as its header
+ * and one data segment.  Output stream data segments also grow geometrically from #BVM_DEBUGGER_PACKETDATA_SIZE
+ * up to #BVM_DEBUGGER_PACKETDATA_MAX_SIZE bytes so large replies are not built 128 bytes at a time.  Only valid if
+ * debugger support is also enabled - refer #BVM_DEBUGGER_ENABLE.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_DEBUGGER_BATCHED_IO_ENABLE
+#define BVM_DEBUGGER_BATCHED_IO_ENABLE 1
+#endif
+
+/**
+ * The largest size in bytes an output stream data segment will grow to.  Refer
+ * #BVM_DEBUGGER_BATCHED_IO_ENABLE.
+ *
+ * Default is 8k.
+ */
+#ifndef BVM_DEBUGGER_PACKETDATA_MAX_SIZE
+#define BVM_DEBUGGER_PACKETDATA_MAX_SIZE 	8192
+#endif
+
+/**
+ * The size in bytes of the buffer JDWP packets are assembled in before being written to the debugger transport.
+ * Refer #BVM_DEBUGGER_BATCHED_IO_ENABLE.
+ *
+ * Default is 1k.
+ */
+#ifndef BVM_DEBUGGER_WRITE_BUFFER_SIZE
+#define BVM_DEBUGGER_WRITE_BUFFER_SIZE 		1024
+#endif
+
+/**
+ * The debugger's object/ID maps grow (and are rehashed) as IDs are handed out instead of using a fixed number of
+ * buckets, and addresses are hashed on their value.  Objects freed by a GC have their IDs removed in one pass over
+ * the maps before the sweep rather than a map removal for every chunk the sweep frees.  Only valid if debugger
+ * support is also enabled - refer #BVM_DEBUGGER_ENABLE.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_DEBUGGER_ID_MAP_RESIZE_ENABLE
+#define BVM_DEBUGGER_ID_MAP_RESIZE_ENABLE 1
+#endif
+
+/**
+ * Platform path separator.
+ *
+ * Default is ':'.
+ */
+#ifndef BVM_PLATFORM_PATH_SEPARATOR
+#define BVM_PLATFORM_PATH_SEPARATOR 	':'
+#endif
+
+/**
+ * Platform directory separator.
+ *
+ * Default is '/'.
+ */
+#ifndef BVM_PLATFORM_FILE_SEPARATOR
+#define BVM_PLATFORM_FILE_SEPARATOR 	'/'
+#endif
+
+/**
+ * Maximum number of #BVM_PLATFORM_PATH_SEPARATOR separated segments in a classpath.
+ *
+ * Default is 5.
+ */
+#ifndef BVM_MAX_CLASSPATH_SEGMENTS
+#define BVM_MAX_CLASSPATH_SEGMENTS		5
+#endif
+
+/**
+ * Maximum number of classes remembered as not found on the classpath of a class loader when
+ * #BVM_CLASSPATH_INDEX_ENABLE is set.  When there are this many, all are forgotten and remembering starts over.
+ *
+ * Default is 512.
+ */
+#ifndef BVM_CLASSPATH_MISSING_MAX
+#define BVM_CLASSPATH_MISSING_MAX		512
+#endif
+
+/**
+ * Initial thread stack height (in cells - see #bvm_cell_t).  Can be set using command line
+ * option \c -stack.  The #bvm_gl_stack_height global variable will be set to #BVM_THREAD_STACK_HEIGHT if
+ * the value is not specified on the command line.
+ *
+ * Default is 256 cells.
+ */
+#ifndef BVM_THREAD_STACK_HEIGHT
+#define BVM_THREAD_STACK_HEIGHT 256
+#endif
+
+/**
+ * Enables the compact frame layout.  A pushed frame then holds only the calling method's locals, stack pointer,
+ * pcs and method - five cells rather than seven.  The sync object cell is kept only for frames of synchronized
+ * methods, and the stack segment of the calling frame is not kept at all - on the rare pop that crosses a segment
+ * boundary it is found by walking back along the segments.  Deep recursion then fits more frames into each segment
+ * and cache line.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_FRAME_COMPACT_ENABLE
+#define BVM_FRAME_COMPACT_ENABLE 1
+#endif
+
+/**
+ * The number of default height stack segments the VM keeps for reuse (see #bvm_gl_thread_stack_pool).  Segments of
+ * terminated threads and segments trimmed from thread stacks during GC are kept in the pool rather than
+ * given back to the heap, and new threads and growing stacks take from it first.  Zero disables the pool.
+ *
+ * Default is 16.
+ */
+#ifndef BVM_THREAD_STACK_POOL_SIZE
+#define BVM_THREAD_STACK_POOL_SIZE 16
+#endif
+
+/**
+ * The number of unused stack segments a thread keeps past its current segment when its stack is shrunk during
+ * GC.  Keeping one or two stops a thread that repeatedly recurses just past a segment boundary from allocating
+ * and losing a segment on every GC.  Any further unused segments are trimmed.
+ *
+ * Default is 1.
+ */
+#ifndef BVM_THREAD_STACK_SPARE_SEGMENTS
+#define BVM_THREAD_STACK_SPARE_SEGMENTS 1
+#endif
+
+/**
+ * The height (in cells) of the first stack segment of a task (see #BVM_THREAD_TASKS_ENABLE).  A task that needs more
+ * grows its stack by segments of the default height, as other threads do.
+ *
+ * Default is 64 cells.
+ */
+#ifndef BVM_THREAD_TASK_STACK_HEIGHT
+#define BVM_THREAD_TASK_STACK_HEIGHT 64
+#endif
+
+/**
+ * The number of VM threads of ended tasks the VM keeps for new tasks (see #bvm_gl_thread_task_pool).  Each keeps the
+ * first stack segment of its task.  Zero keeps none.
+ *
+ * Default is 64.
+ */
+#ifndef BVM_THREAD_TASK_POOL_SIZE
+#define BVM_THREAD_TASK_POOL_SIZE 64
+#endif
+
+/**
+ * Number of buckets in the hash table used to find the monitor of an object (see #get_monitor_for_obj).  Must be
+ * a power of two.
+ *
+ * Default is 64.
+ */
+#ifndef BVM_THREAD_MONITOR_HASH_SIZE
+#define BVM_THREAD_MONITOR_HASH_SIZE 64
+#endif
+
+/**
+ * The number of times a thread blocked on a contended monitor may be woken to compete for the monitor when it is
+ * released, before it is handed the monitor directly.  While competing, the releasing thread may take the monitor
+ * again without a thread switch, which avoids a block and resume for every lock when two threads share a monitor
+ * in a loop.  A thread that loses keeps its place at the head of the lock queue, so it waits no more than this many
+ * releases.  When 0, a released monitor is always handed directly to the thread at the head of the lock queue.
+ *
+ * Default is 2.
+ */
+#ifndef BVM_THREAD_MONITOR_SPIN_LIMIT
+#define BVM_THREAD_MONITOR_SPIN_LIMIT 2
+#endif
+
+/**
+ * Initial number of threads the timed callback heap (see #bvm_gl_thread_timers) has room for.  It doubles
+ * in size each time it fills.
+ *
+ * Default is 16.
+ */
+#ifndef BVM_THREAD_TIMERS_SIZE
+#define BVM_THREAD_TIMERS_SIZE 16
+#endif
+
+/**
+ * The number of thread switches between each ageing of the runnable queues, when a thread waiting in each queue below
+ * the highest is moved up one queue.  Smaller is fairer to low priority threads, larger favours high priority
+ * threads.  Only used with #BVM_THREAD_PRIORITY_QUEUES_ENABLE.
+ *
+ * Default is 16.
+ */
+#ifndef BVM_THREAD_AGEING_INTERVAL
+#define BVM_THREAD_AGEING_INTERVAL 16
+#endif
+
+/**
+ * Initial number of threads that may be parked on sockets (see #bvm_thread_wait_for_socket) before the socket waiters
+ * have to grow.  They double in size each time they fill.
+ *
+ * Default is 8.
+ */
+#ifndef BVM_THREAD_IO_WAITERS_SIZE
+#define BVM_THREAD_IO_WAITERS_SIZE 8
+#endif
+
+/**
+ * The longest time in milliseconds the VM sleeps in the platform in one go when no thread is runnable and all are
+ * waiting for a timeout (see #bvm_pd_system_sleep).
+ *
+ * Default is 1000.
+ */
+#ifndef BVM_THREAD_IDLE_SLEEP_MAX
+#define BVM_THREAD_IDLE_SLEEP_MAX 1000
+#endif
+
+/**
+ * Default heap size in bytes.  Heap size can set using command line option \c -heap and specifying
+ * bytes, kb, or Mb.  The #bvm_gl_heap_size global variable will be set to #BVM_HEAP_SIZE if the value is
+ * not specified on the command line.
+ *
+ * Default is 256.
+ */
+#ifndef BVM_HEAP_SIZE
+#ifdef BVM_DEBUGGER_ENABLE
+#define BVM_HEAP_SIZE          (256 * BVM_KB)
+#else
+#define BVM_HEAP_SIZE          (256 * BVM_KB)
+#endif
+#endif
+
+/**
+ * Chunks smaller than this size (in bytes) are kept by the heap allocator in exact-size 'small' bins, one bin for
+ * each multiple of the chunk alignment size.  Chunks of this size or larger are kept in size-ordered 'large' bins that each
+ * cover a power-of-two range of sizes.  See heap.c.
+ *
+ * Default is 512 bytes.
+ */
+#ifndef BVM_HEAP_SMALL_CHUNK_LIMIT
+#define BVM_HEAP_SMALL_CHUNK_LIMIT	512
+#endif
+
+/**
+ * Size in bytes of each thread allocation buffer carved from the heap when #BVM_HEAP_TLAB_ENABLE is set.  Only
+ * allocations smaller than #BVM_HEAP_SMALL_CHUNK_LIMIT are taken from an allocation buffer.
+ *
+ * Default is 4k.
+ */
+#ifndef BVM_HEAP_TLAB_SIZE
+#define BVM_HEAP_TLAB_SIZE			(4 * BVM_KB)
+#endif
+
+/**
+ * Primitive arrays of at least this many bytes are allocated in a large object region of their own.  Can be set using
+ * command line option \c -largeobj.  Only used if #BVM_HEAP_LARGE_OBJECT_ENABLE is set.
+ *
+ * Default is 32k.
+ */
+#ifndef BVM_HEAP_LARGE_OBJECT_SIZE
+#define BVM_HEAP_LARGE_OBJECT_SIZE		(32 * BVM_KB)
+#endif
+
+/**
+ * Large object regions are a whole number of pages of this many bytes.  Must be a power of two.  Only used if
+ * #BVM_HEAP_LARGE_OBJECT_ENABLE is set.
+ *
+ * Default is 4k.
+ */
+#ifndef BVM_HEAP_LARGE_OBJECT_PAGE_SIZE
+#define BVM_HEAP_LARGE_OBJECT_PAGE_SIZE	(4 * BVM_KB)
+#endif
+
+/**
+ * Minimum size in bytes of each region of the metadata arena.  A region is made larger if required for a single
+ * allocation.  Only used if #BVM_HEAP_METADATA_ARENA_ENABLE is set.
+ *
+ * Default is 64k.
+ */
+#ifndef BVM_HEAP_METADATA_REGION_SIZE
+#define BVM_HEAP_METADATA_REGION_SIZE	(64 * BVM_KB)
+#endif
+
+/**
+ * Minimum size in bytes of each region of the metadata arena of a class loader (other than the bootstrap and system
+ * loaders).  Smaller than #BVM_HEAP_METADATA_REGION_SIZE as most such loaders only load a few classes.  Only used if
+ * #BVM_HEAP_METADATA_ARENA_ENABLE is set.
+ *
+ * Default is 16k.
+ */
+#ifndef BVM_HEAP_METADATA_LOADER_REGION_SIZE
+#define BVM_HEAP_METADATA_LOADER_REGION_SIZE	(16 * BVM_KB)
+#endif
+
+/**
+ * The most bytes of free memory zeroed each time the VM finds itself idle.  Small enough that a thread due to wake
+ * is not kept waiting.  Only used if #BVM_HEAP_IDLE_ZERO_ENABLE is set.
+ *
+ * Default is 64k.
+ */
+#ifndef BVM_HEAP_IDLE_ZERO_STEP
+#define BVM_HEAP_IDLE_ZERO_STEP	(64 * BVM_KB)
+#endif
+
+/**
+ * Default maximum size in bytes the heap may grow to.  The heap starts as a single region of #BVM_HEAP_SIZE bytes and
+ * further regions are requested from the platform as required up to this limit.  Can be set using command line option
+ * \c -heapmax.  A value that is not larger than the initial heap size means the heap never grows.
+ *
+ * Default is 0 (no growth).
+ */
+#ifndef BVM_HEAP_LIMIT
+#define BVM_HEAP_LIMIT				0
+#endif
+
+/**
+ * Minimum size in bytes of each region added to the heap when it grows.  A region is made larger if required to
+ * satisfy the allocation that caused the heap to grow.
+ *
+ * Default is 256k.
+ */
+#ifndef BVM_HEAP_REGION_SIZE
+#define BVM_HEAP_REGION_SIZE		(256 * BVM_KB)
+#endif
+
+/**
+ * If, after a GC, less than this percentage of the heap is free the heap is grown by a region (if allowed by
+ * #BVM_HEAP_LIMIT).  Regions that are entirely free after a GC are returned to the platform so long as the
+ * heap would still have at least this percentage free.  Can be set using command line option \c -heapgrow.
+ *
+ * Default is 25 percent.
+ */
+#ifndef BVM_HEAP_GROW_PERCENT
+#define BVM_HEAP_GROW_PERCENT		25
+#endif
+
+/**
+ * Height of transient root stack in cells (refer #bvm_cell_t).  Can be set using command line option \c -tr.
+ * The #bvm_gl_gc_transient_roots_depth global variable will be set to #BVM_GC_TRANSIENT_ROOTS_DEPTH if the value is
+ * not specified on the command line.
+ *
+ * Default is 50 cells.
+ */
+#ifndef BVM_GC_TRANSIENT_ROOTS_DEPTH
+#define BVM_GC_TRANSIENT_ROOTS_DEPTH   		50
+#endif
+
+/**
+ * Height of permanent root stack in cells (refer #bvm_cell_t).  Can be set using command line option \c -sr. Has
+ * the effect of setting the #bvm_gl_gc_permanent_roots_depth global variable.
+ *
+ * Default is 100 cells.
+ */
+#ifndef BVM_GC_PERMANENT_ROOTS_DEPTH
+#define BVM_GC_PERMANENT_ROOTS_DEPTH   		100
+#endif
+
+/**
+ * Height of the collector's mark stack in chunk pointers.  The mark stack is not in the heap.  If it fills during marking
+ * the remaining grey chunks are found later by rescanning the heap - so a small stack is slower, but never unsafe.
+ *
+ * Default is 1024 entries.
+ */
+#ifndef BVM_GC_MARK_STACK_DEPTH
+#define BVM_GC_MARK_STACK_DEPTH   			1024
+#endif
+
+/**
+ * The number of markers (the VM thread included) that share a GC's marking.  May be changed with the \c -gcthreads
+ * command line option.  Only used if #BVM_GC_PARALLEL_MARK_ENABLE is set.
+ *
+ * Default is 4.
+ */
+#ifndef BVM_GC_MARK_THREADS
+#define BVM_GC_MARK_THREADS					4
+#endif
+
+/**
+ * The bytes of the heap that must be in use when a GC starts for its marking to be shared between threads - starting
+ * the threads costs more than it saves for a small heap.  Only used if #BVM_GC_PARALLEL_MARK_ENABLE is set.
+ *
+ * Default is 1M.
+ */
+#ifndef BVM_GC_PARALLEL_MARK_MIN_USED
+#define BVM_GC_PARALLEL_MARK_MIN_USED		(1 * BVM_MB)
+#endif
+
+/**
+ * Size of the generational collector's remembered set - the old objects that have had a reference to a new object
+ * stored into them since the last collection.  If the set fills, the next collection is a full collection.  Only
+ * used if #BVM_GC_GENERATIONAL_ENABLE is set.
+ *
+ * Default is 512 entries.
+ */
+#ifndef BVM_GC_REMEMBERED_SET_SIZE
+#define BVM_GC_REMEMBERED_SET_SIZE   		512
+#endif
+
+/**
+ * If less than this percentage of the heap is free after a minor collection, a full collection follows.  Only used if
+ * #BVM_GC_GENERATIONAL_ENABLE is set.
+ *
+ * Default is 25 percent.
+ */
+#ifndef BVM_GC_FULL_PERCENT
+#define BVM_GC_FULL_PERCENT   				25
+#endif
+
+/**
+ * The number of chunks scanned by each slice of incremental marking.  Bounds the pause at each thread switch.  Can be
+ * set using command line option \c -gcslice.  Only used if #BVM_GC_INCREMENTAL_ENABLE is set.
+ *
+ * Default is 256 chunks.
+ */
+#ifndef BVM_GC_INCREMENTAL_SLICE_BUDGET
+#define BVM_GC_INCREMENTAL_SLICE_BUDGET   	256
+#endif
+
+/**
+ * An incremental marking cycle is started when less than this percentage of the heap is free.  Only used if
+ * #BVM_GC_INCREMENTAL_ENABLE is set.
+ *
+ * Default is 40 percent.
+ */
+#ifndef BVM_GC_INCREMENTAL_START_PERCENT
+#define BVM_GC_INCREMENTAL_START_PERCENT   	40
+#endif
+
+/**
+ * A GC is started at a thread switch once this many bytes have been allocated since the last GC.  Zero for no budget.
+ * Can be set using command line option \c -gcbudget.  Only used if #BVM_GC_BUDGET_ENABLE is set.
+ *
+ * Default is no budget.
+ */
+#ifndef BVM_GC_ALLOC_BUDGET
+#define BVM_GC_ALLOC_BUDGET   				0
+#endif
+
+/**
+ * A GC is started at a thread switch when less than this percentage of the heap is free - as long as at least half as
+ * much again has been allocated since the last GC, so a heap that is mostly live is not collected at every switch.  Zero
+ * to never start one this way.  Can be set using command line option \c -gcfree.  Only used if #BVM_GC_BUDGET_ENABLE is
+ * set.
+ *
+ * Default is 10 percent.
+ */
+#ifndef BVM_GC_BUDGET_FREE_PERCENT
+#define BVM_GC_BUDGET_FREE_PERCENT   		10
+#endif
+
+/**
+ * The shortest time in milliseconds the VM must expect to be idle for a GC to be done in that time.  Zero to never
+ * collect when idle.  Can be set using command line option \c -gcidle.  Only used if #BVM_GC_IDLE_ENABLE is set.
+ *
+ * Default is 50 milliseconds.
+ */
+#ifndef BVM_GC_IDLE_MIN_TIME
+#define BVM_GC_IDLE_MIN_TIME   				50
+#endif
+
+/**
+ * The percentage of the heap that must have been allocated since the last GC for an idle GC to be worth doing.  A
+ * VM that wakes now and then to do a little work is then not collected each time it goes back to sleep.  Only used if
+ * #BVM_GC_IDLE_ENABLE is set.
+ *
+ * Default is 5 percent.
+ */
+#ifndef BVM_GC_IDLE_MIN_PERCENT
+#define BVM_GC_IDLE_MIN_PERCENT   			5
+#endif
+
+/**
+ * The number of heap bytes swept by each step of a lazy sweep.  A step never crosses a region boundary.  Only used if
+ * #BVM_GC_LAZY_SWEEP_ENABLE is set.
+ *
+ * Default is 64k.
+ */
+#ifndef BVM_GC_LAZY_SWEEP_STEP
+#define BVM_GC_LAZY_SWEEP_STEP   			(64 * BVM_KB)
+#endif
+
+/**
+ * The number of heap bytes the concurrent sweeper sweeps before handing them back to the allocator.  A step ends at
+ * the first live chunk after this many bytes, or at the end of a region.  Only used if #BVM_GC_CONCURRENT_SWEEP_ENABLE
+ * is set.
+ *
+ * Default is 64k.
+ */
+#ifndef BVM_GC_CONCURRENT_SWEEP_STEP
+#define BVM_GC_CONCURRENT_SWEEP_STEP		(64 * BVM_KB)
+#endif
+
+/**
+ * The maximum number of arrays that may be moved or pinned by a single compaction.  Bounds the pause of a compaction
+ * - and the memory the collector sets aside for it.  Only used if #BVM_GC_COMPACTION_ENABLE is set.
+ *
+ * Default is 1024 arrays.
+ */
+#ifndef BVM_GC_COMPACT_TABLE_SIZE
+#define BVM_GC_COMPACT_TABLE_SIZE   		1024
+#endif
+
+/**
+ * The most distinct String char arrays a single GC remembers for deduplication.  Once the table is full, Strings are
+ * still matched against what is in it.  Must be a power of two.  Only used if #BVM_GC_STRING_DEDUP_ENABLE is set.
+ *
+ * Default is 1024 arrays.
+ */
+#ifndef BVM_GC_STRING_DEDUP_TABLE_SIZE
+#define BVM_GC_STRING_DEDUP_TABLE_SIZE   	1024
+#endif
+
+/**
+ * A compaction is done when, after a GC, the largest free chunk is less than this percentage of the total free
+ * space.  Only used if #BVM_GC_COMPACTION_ENABLE is set.
+ *
+ * Default is 50 percent.
+ */
+#ifndef BVM_GC_COMPACT_FRAGMENTATION_PERCENT
+#define BVM_GC_COMPACT_FRAGMENTATION_PERCENT	50
+#endif
+
+/**
+ * The size in bytes of each block of the arena #NI_MallocLocal memory is bumped from.  A request for more than a
+ * quarter of a block is given a block of its own.  Only used if #BVM_NI_LOCAL_ARENA_ENABLE is set.
+ *
+ * Default is 1k.
+ */
+#ifndef BVM_NI_LOCAL_ARENA_BLOCK_SIZE
+#define BVM_NI_LOCAL_ARENA_BLOCK_SIZE		(1 * BVM_KB)
+#endif
+
+/**
+ * The most distinct protection domains a thread stack may have for its \c AccessControlContext to be kept.  A stack with
+ * more is given a new context each time.  Only used if #BVM_NATIVE_ACCESS_CONTEXT_CACHE_ENABLE is set.
+ *
+ * Default is 8.
+ */
+#ifndef BVM_NATIVE_ACCESS_CONTEXT_DOMAINS
+#define BVM_NATIVE_ACCESS_CONTEXT_DOMAINS	8
+#endif
+
+/**
+ * The initial number of slots in the side table of arrays that have been given an identity hash.  It doubles each time
+ * it is three quarters full.  A spare table of the same size is kept with it, so compaction can always rehash the
+ * moved arrays without allocating.  Must be a power of two.  Only used if #BVM_OBJECT_IDENTITY_HASH_ENABLE and
+ * #BVM_GC_COMPACTION_ENABLE are set.
+ *
+ * Default is 64.
+ */
+#ifndef BVM_OBJECT_IDENTITY_HASH_TABLE_SIZE
+#define BVM_OBJECT_IDENTITY_HASH_TABLE_SIZE	64
+#endif
+
+/**
+ * The most bytes a multi-dimensional array and all its sub-arrays may take together to be allocated in one piece.
+ * The piece must be found in a single free chunk, so this is best kept well below the size of the heap.  Only used if
+ * #BVM_OBJECT_MULTI_ARRAY_CONTIGUOUS_ENABLE is set.
+ *
+ * Default is 128k.
+ */
+#ifndef BVM_OBJECT_MULTI_ARRAY_CONTIGUOUS_MAX_SIZE
+#define BVM_OBJECT_MULTI_ARRAY_CONTIGUOUS_MAX_SIZE	(128 * BVM_KB)
+#endif
+
+/**
+ * The size in bytes of the static buffer a heap dump is written through.  Only used if #BVM_HEAP_DUMP_ENABLE is set.
+ *
+ * Default is 4k.
+ */
+#ifndef BVM_HEAP_DUMP_BUFFER_SIZE
+#define BVM_HEAP_DUMP_BUFFER_SIZE			(4 * BVM_KB)
+#endif
+
+/**
+ * The number of thread switches between profiler samples.  Only used if #BVM_PROFILER_ENABLE is set.
+ *
+ * Default is 10.
+ */
+#ifndef BVM_PROFILER_SAMPLE_INTERVAL
+#define BVM_PROFILER_SAMPLE_INTERVAL		10
+#endif
+
+/**
+ * The number of frames from the top of a thread stack the profiler records for a sample.  Deeper frames are left out
+ * of the sample's stack.  Only used if #BVM_PROFILER_ENABLE is set.
+ *
+ * Default is 16.
+ */
+#ifndef BVM_PROFILER_MAX_DEPTH
+#define BVM_PROFILER_MAX_DEPTH				16
+#endif
+
+/**
+ * The number of distinct stacks the profiler counts.  Samples of further stacks are counted together as an
+ * \c [other] stack.  Only used if #BVM_PROFILER_ENABLE is set.
+ *
+ * Default is 2048.
+ */
+#ifndef BVM_PROFILER_MAX_STACKS
+#define BVM_PROFILER_MAX_STACKS				2048
+#endif
+
+/**
+ * The average number of bytes allocated between allocation site samples.  Only used if
+ * #BVM_PROFILER_ALLOCATION_SITES_ENABLE is set.
+ *
+ * Default is 4k.
+ */
+#ifndef BVM_PROFILER_ALLOCATION_SAMPLE_BYTES
+#define BVM_PROFILER_ALLOCATION_SAMPLE_BYTES	(4 * BVM_KB)
+#endif
+
+/**
+ * The most distinct allocation sites recorded.  Samples beyond this are counted against an \c [other] site.  Only
+ * used if #BVM_PROFILER_ALLOCATION_SITES_ENABLE is set.
+ *
+ * Default is 1024.
+ */
+#ifndef BVM_PROFILER_ALLOCATION_MAX_SITES
+#define BVM_PROFILER_ALLOCATION_MAX_SITES		1024
+#endif
+
+/**
+ * The most sampled objects whose allocation site is remembered for a heap dump while they are alive.  Must be a
+ * power of two.  Only used if #BVM_PROFILER_ALLOCATION_SITES_ENABLE and #BVM_HEAP_DUMP_ENABLE are set.
+ *
+ * Default is 4096.
+ */
+#ifndef BVM_PROFILER_ALLOCATION_MAX_OBJECTS
+#define BVM_PROFILER_ALLOCATION_MAX_OBJECTS	4096
+#endif
+
+/**
+ * The most distinct monitor contention sites recorded.  Beyond this they are counted against an \c [other] site.  Only
+ * used if #BVM_PROFILER_MONITOR_CONTENTION_ENABLE is set.
+ *
+ * Default is 256.
+ */
+#ifndef BVM_PROFILER_CONTENTION_MAX_SITES
+#define BVM_PROFILER_CONTENTION_MAX_SITES		256
+#endif
+
+/**
+ * The size in bytes at which a heap dump starts a new heap dump segment record.  Only used if #BVM_HEAP_DUMP_ENABLE is
+ * set.
+ *
+ * Default is 64k.
+ */
+#ifndef BVM_HEAP_DUMP_SEGMENT_SIZE
+#define BVM_HEAP_DUMP_SEGMENT_SIZE			(64 * BVM_KB)
+#endif
+
+/**
+ * Default number of hash buckets in the intern string pool.  Can be set using command line option \c -strb.
+ * The #bvm_gl_internstring_pool_bucketcount global variable will be set to #BVM_INTERNSTRING_POOL_BUCKETCOUNT if
+ * no command line value is given.
+ *
+ * Default is 64 buckets.
+ */
+#ifndef BVM_INTERNSTRING_POOL_BUCKETCOUNT
+#define BVM_INTERNSTRING_POOL_BUCKETCOUNT  	64
+#endif
+
+/**
+ * Default number of hash buckets in the utfstring pool.  Can be set using command line option \c -utfb.
+ * The #bvm_gl_utfstring_pool_bucketcount global variable will be set to #BVM_UTFSTRING_POOL_BUCKETCOUNT if no
+ * command line value is given.
+ *
+ * Default is 64 buckets.
+ */
+#ifndef BVM_UTFSTRING_POOL_BUCKETCOUNT
+#define BVM_UTFSTRING_POOL_BUCKETCOUNT 		64
+#endif
+
+/**
+ * Default number of hash buckets in the native method pool.  Can be set using command line option \c -natb.  The
+ * #bvm_gl_native_method_pool_bucketcount global variable will be set to #BVM_NATIVEMETHOD_POOL_BUCKETCOUNT if no
+ * command line value is given.  The pool is only searched as native methods are linked at class load time, but
+ * with more than a hundred natives registered by the core library a small pool makes for long bucket lists.  The
+ * default holds all the natives the VM registers without the pool growing as they are registered (see
+ * #BVM_POOL_RESIZE_ENABLE).
+ *
+ * Default is 128 buckets.
+ */
+#ifndef BVM_NATIVEMETHOD_POOL_BUCKETCOUNT
+#define BVM_NATIVEMETHOD_POOL_BUCKETCOUNT 	128
+#endif
+
+/**
+ * Default number of hash buckets in the clazz pool.  Can be set using command line option \c -clazzb.  The
+ * #bvm_gl_clazz_pool_bucketcount global variable will be set to #BVM_CLAZZ_POOL_BUCKETCOUNT if no command line
+ * value is given.
+ *
+ * Default is 64 buckets.
+ */
+#ifndef BVM_CLAZZ_POOL_BUCKETCOUNT
+#define BVM_CLAZZ_POOL_BUCKETCOUNT 	64
+#endif
+
+/**
+ * The average number of entries per hash bucket a pool may hold before its bucket count is doubled.  Only if
+ * #BVM_POOL_RESIZE_ENABLE is set.
+ *
+ * Default is 2.
+ */
+#ifndef BVM_POOL_MAX_LOAD
+#define BVM_POOL_MAX_LOAD 	2
+#endif
+
+/**
+ * Default max file handles.  Can be set using command line option \c -files.  The #bvm_gl_max_file_handles
+ * global variable will be set to #BVM_MAX_FILE_HANDLES if no command line value is given.
+ *
+ * With #BVM_FILE_HANDLES_GROW_ENABLE this is the initial number of file handles rather than the most.
+ *
+ * Default is 32 files.
+ */
+#ifndef BVM_MAX_FILE_HANDLES
+#define BVM_MAX_FILE_HANDLES 		32
+#endif
+
+/**
+ * The size in bytes of the buffer of a file read or written with #bvm_file_buffered_read or #bvm_file_buffered_write.
+ * A read or write of at least this many bytes goes straight to the file.  Only used if #BVM_FILE_BUFFER_ENABLE is set.
+ *
+ * Default is 2k.
+ */
+#ifndef BVM_FILE_BUFFER_SIZE
+#define BVM_FILE_BUFFER_SIZE 		(2 * BVM_KB)
+#endif
+
+/**
+ * The longest time in milliseconds the VM sleeps in the platform in one go when no thread is runnable and some are
+ * parked on file reads or writes handed to a host thread - a finished read or write is noticed no later than this.
+ * Only used if #BVM_FILE_ASYNC_ENABLE is set.
+ *
+ * Default is 1.
+ */
+#ifndef BVM_FILE_ASYNC_POLL_MAX
+#define BVM_FILE_ASYNC_POLL_MAX 	1
+#endif
+
+/**
+ * The size in bytes of the console output buffer.  A write of at least this many bytes goes straight to the console.
+ * Only used if #BVM_CONSOLE_BUFFER_ENABLE is set.
+ *
+ * Default is 512 bytes.
+ */
+#ifndef BVM_CONSOLE_BUFFER_SIZE
+#define BVM_CONSOLE_BUFFER_SIZE 	512
+#endif
+
+/**
+ * The longest time in milliseconds buffered console output without a newline waits before it is written out.  The
+ * time is checked as output is written and when the VM goes idle.  Only used if #BVM_CONSOLE_BUFFER_ENABLE is set.
+ *
+ * Default is 100.
+ */
+#ifndef BVM_CONSOLE_FLUSH_INTERVAL
+#define BVM_CONSOLE_FLUSH_INTERVAL 	100
+#endif
+
+/**
+ * The number of isolates a VM may have started and not yet joined at once.  Only used with #BVM_VM_ISOLATES_ENABLE.
+ *
+ * Default is 8.
+ */
+#ifndef BVM_VM_ISOLATES_MAX
+#define BVM_VM_ISOLATES_MAX 		8
+#endif
+
+/**
+ * The number of call sites the inline cache side table holds.  Call sites are hashed by bytecode address into the
+ * table and a call site that collides with another simply takes its slot.  Must be a power of 2.  Only used with
+ * #BVM_EXEC_INLINE_CACHE_ENABLE.
+ *
+ * Default is 256.
+ */
+#ifndef BVM_EXEC_INLINE_CACHE_SIZE
+#define BVM_EXEC_INLINE_CACHE_SIZE 	256
+#endif
+
+/**
+ * The number of receiver clazzes each inline cached call site remembers.  \c 1 gives a monomorphic cache, larger
+ * values a polymorphic one.  When all are in use the least recently added is dropped.  Only used with
+ * #BVM_EXEC_INLINE_CACHE_ENABLE.
+ *
+ * Default is 4.
+ */
+#ifndef BVM_EXEC_INLINE_CACHE_WAYS
+#define BVM_EXEC_INLINE_CACHE_WAYS 	4
+#endif
+
+/**
+ * The number of \c checkcast and \c instanceof instructions the type check cache side table holds.  Instructions are
+ * hashed by bytecode address into the table and one that collides with another simply takes its slot.  Must be a
+ * power of 2.  Only used with #BVM_EXEC_TYPE_CACHE_ENABLE.
+ *
+ * Default is 256.
+ */
+#ifndef BVM_EXEC_TYPE_CACHE_SIZE
+#define BVM_EXEC_TYPE_CACHE_SIZE 	256
+#endif
+
+/**
+ * The number of compatible object clazzes each cached \c checkcast or \c instanceof remembers.  When all are in use
+ * the least recently added is dropped.  Only used with #BVM_EXEC_TYPE_CACHE_ENABLE.
+ *
+ * Default is 2.
+ */
+#ifndef BVM_EXEC_TYPE_CACHE_WAYS
+#define BVM_EXEC_TYPE_CACHE_WAYS 	2
+#endif
+
+/**
+ * The number of entries of the \c Class.forName cache.  Names are hashed into the table and one that collides with
+ * another simply takes its slot.  Must be a power of 2.  Only used with #BVM_CLAZZ_FORNAME_CACHE_ENABLE.
+ *
+ * Default is 64.
+ */
+#ifndef BVM_CLAZZ_FORNAME_CACHE_SIZE
+#define BVM_CLAZZ_FORNAME_CACHE_SIZE 	64
+#endif
+
+/**
+ * The count of invocations and backward branches at which a method is compiled by the JIT.  Only used with
+ * #BVM_JIT_ENABLE.
+ *
+ * Default is 1000.
+ */
+#ifndef BVM_JIT_THRESHOLD
+#define BVM_JIT_THRESHOLD 			1000
+#endif
+
+/**
+ * The size in bytes of the executable memory the JIT compiles methods into.  It is allocated at the first compile and
+ * once it is full no more methods are compiled.  Only used with #BVM_JIT_ENABLE.
+ *
+ * Default is 512k.
+ */
+#ifndef BVM_JIT_CODE_CACHE_SIZE
+#define BVM_JIT_CODE_CACHE_SIZE 	(512 * 1024)
+#endif
+
+/**
+ * Number of opcodes to use when calculating a thread's timeslice.  Default is 300 opcodes normally, or 100
+ * opcodes if debugging is enabled.
+ */
+#ifndef BVM_THREAD_TIMESLICE
+#if BVM_DEBUGGER_ENABLE
+#define BVM_THREAD_TIMESLICE 		100
+#else
+#define BVM_THREAD_TIMESLICE 		300
+#endif
+#endif
+
+/**
+ * With #BVM_THREAD_TIMER_PREEMPTION_ENABLE, the milliseconds between platform timer ticks.  A thread's timeslice is
+ * its priority in ticks.
+ *
+ * Default is 2 milliseconds.
+ */
+#ifndef BVM_THREAD_TIMER_TICK
+#define BVM_THREAD_TIMER_TICK 		2
+#endif
+
+/* Sanity check - float support requires native 64 bit integer support */
+#if BVM_FLOAT_ENABLE
+#if (!BVM_NATIVE_INT64_ENABLE)
+#error "Floating point support requires BVM_NATIVE_INT64_ENABLE to be 1"
+#endif
+#endif
+
+/* Sanity check - the generational and incremental collectors use the colours differently and cannot be combined */
+#if (BVM_GC_GENERATIONAL_ENABLE && BVM_GC_INCREMENTAL_ENABLE)
+#error "BVM_GC_GENERATIONAL_ENABLE and BVM_GC_INCREMENTAL_ENABLE may not both be set"
+#endif
+
+/* Sanity check - the lazy sweeper colours survivors white, but the generational collector relies on them staying black */
+#if (BVM_GC_GENERATIONAL_ENABLE && BVM_GC_LAZY_SWEEP_ENABLE)
+#error "BVM_GC_GENERATIONAL_ENABLE and BVM_GC_LAZY_SWEEP_ENABLE may not both be set"
+#endif
+
+/* Sanity check - the remembered set holds chunk addresses between collections, so chunks may not be moved */
+#if (BVM_GC_GENERATIONAL_ENABLE && BVM_GC_COMPACTION_ENABLE)
+#error "BVM_GC_GENERATIONAL_ENABLE and BVM_GC_COMPACTION_ENABLE may not both be set"
+#endif
+
+/* Sanity check - the mark threads share the collector's state, and claim chunks only as they turn from white to grey */
+#if (BVM_GC_PARALLEL_MARK_ENABLE && BVM_VM_INSTANCES_ENABLE)
+#error "BVM_GC_PARALLEL_MARK_ENABLE and BVM_VM_INSTANCES_ENABLE may not both be set"
+#endif
+
+#if (BVM_GC_PARALLEL_MARK_ENABLE && BVM_GC_INCREMENTAL_ENABLE)
+#error "BVM_GC_PARALLEL_MARK_ENABLE and BVM_GC_INCREMENTAL_ENABLE may not both be set"
+#endif
+
+#if (BVM_GC_PARALLEL_MARK_ENABLE && BVM_GC_STRING_DEDUP_ENABLE)
+#error "BVM_GC_PARALLEL_MARK_ENABLE and BVM_GC_STRING_DEDUP_ENABLE may not both be set"
+#endif
+
+#if BVM_GC_PARALLEL_MARK_ENABLE
+#ifndef BVM_PD_ATOMIC_CAS
+#error "BVM_GC_PARALLEL_MARK_ENABLE requires the platform to define BVM_PD_ATOMIC_CAS"
+#endif
+#ifndef BVM_PD_THREAD_LOCAL
+#error "BVM_GC_PARALLEL_MARK_ENABLE requires the platform to define BVM_PD_THREAD_LOCAL"
+#endif
+#endif
+
+/* Sanity check - the sweeper thread shares the heap with the interpreter, and owns the colours until it is done */
+#if (BVM_GC_CONCURRENT_SWEEP_ENABLE && BVM_VM_INSTANCES_ENABLE)
+#error "BVM_GC_CONCURRENT_SWEEP_ENABLE and BVM_VM_INSTANCES_ENABLE may not both be set"
+#endif
+
+#if (BVM_GC_CONCURRENT_SWEEP_ENABLE && (BVM_GC_GENERATIONAL_ENABLE || BVM_GC_INCREMENTAL_ENABLE))
+#error "BVM_GC_CONCURRENT_SWEEP_ENABLE may not be set with BVM_GC_GENERATIONAL_ENABLE or BVM_GC_INCREMENTAL_ENABLE"
+#endif
+
+#if (BVM_GC_CONCURRENT_SWEEP_ENABLE && (BVM_GC_LAZY_SWEEP_ENABLE || BVM_GC_COMPACTION_ENABLE))
+#error "BVM_GC_CONCURRENT_SWEEP_ENABLE may not be set with BVM_GC_LAZY_SWEEP_ENABLE or BVM_GC_COMPACTION_ENABLE"
+#endif
+
+#if (BVM_GC_CONCURRENT_SWEEP_ENABLE && !defined(BVM_PD_ATOMIC_CAS))
+#error "BVM_GC_CONCURRENT_SWEEP_ENABLE requires the platform to define BVM_PD_ATOMIC_CAS"
+#endif
+
+/* Sanity check - the objects in a scope are always black and are hidden from a heap walk, so may not be used with a
+ * collector that keeps colours between collections or moves chunks */
+#if (BVM_SCOPED_MEMORY_ENABLE && (BVM_GC_GENERATIONAL_ENABLE || BVM_GC_INCREMENTAL_ENABLE || BVM_GC_COMPACTION_ENABLE))
+#error "BVM_SCOPED_MEMORY_ENABLE may not be set with BVM_GC_GENERATIONAL_ENABLE, BVM_GC_INCREMENTAL_ENABLE or BVM_GC_COMPACTION_ENABLE"
+#endif
+
+#if (BVM_VM_INSTANCES_ENABLE && BVM_THREAD_TIMER_PREEMPTION_ENABLE)
+#error "BVM_VM_INSTANCES_ENABLE and BVM_THREAD_TIMER_PREEMPTION_ENABLE may not both be set"
+#endif
+
+#if (BVM_VM_ISOLATES_ENABLE && !BVM_VM_INSTANCES_ENABLE)
+#error "BVM_VM_ISOLATES_ENABLE requires BVM_VM_INSTANCES_ENABLE"
+#endif
+
+/* Sanity check - a snapshot is of the one VM of the process, and its state is taken and put back as plain memory */
+#if (BVM_VM_SNAPSHOT_ENABLE && BVM_VM_INSTANCES_ENABLE)
+#error "BVM_VM_SNAPSHOT_ENABLE and BVM_VM_INSTANCES_ENABLE may not both be set"
+#endif
+
+/* a snapshot holds the heap regions only */
+#if (BVM_VM_SNAPSHOT_ENABLE && BVM_HEAP_METADATA_ARENA_ENABLE)
+#undef BVM_HEAP_METADATA_ARENA_ENABLE
+#define BVM_HEAP_METADATA_ARENA_ENABLE 0
+#endif
+
+/* .. and the main thread is on its way into "main" when it is written, so compiled code may already be outside them */
+#if (BVM_VM_SNAPSHOT_ENABLE && BVM_JIT_ENABLE)
+#undef BVM_JIT_ENABLE
+#define BVM_JIT_ENABLE 0
+#endif
+
+#if (BVM_VM_SNAPSHOT_ENABLE && BVM_EXEC_REGISTER_IR_ENABLE)
+#undef BVM_EXEC_REGISTER_IR_ENABLE
+#define BVM_EXEC_REGISTER_IR_ENABLE 0
+#endif
+
+#if (BVM_VM_SNAPSHOT_ENABLE && BVM_THREAD_TIMER_PREEMPTION_ENABLE)
+#error "BVM_VM_SNAPSHOT_ENABLE and BVM_THREAD_TIMER_PREEMPTION_ENABLE may not both be set"
+#endif
+
+/* the metrics are served over a socket, and the GC figures come from the GC statistics */
+#if (BVM_METRICS_ENABLE && !(BVM_SOCKETS_ENABLE && BVM_GC_STATS_ENABLE))
+#undef BVM_METRICS_ENABLE
+#define BVM_METRICS_ENABLE 0
+#endif
+
+/**
+ * The storage class of all mutable VM state.  Thread-local storage when #BVM_VM_INSTANCES_ENABLE is set, a section of
+ * its own in the executable when #BVM_VM_SNAPSHOT_ENABLE is set, otherwise nothing at all.
+ */
+#if BVM_VM_INSTANCES_ENABLE
+#ifndef BVM_PD_THREAD_LOCAL
+#error "BVM_VM_INSTANCES_ENABLE requires the platform to define BVM_PD_THREAD_LOCAL"
+#endif
+#define BVM_VM_LOCAL BVM_PD_THREAD_LOCAL
+#elif BVM_VM_SNAPSHOT_ENABLE
+#ifndef BVM_PD_VM_STATE
+#error "BVM_VM_SNAPSHOT_ENABLE requires the platform to define BVM_PD_VM_STATE"
+#endif
+#define BVM_VM_LOCAL BVM_PD_VM_STATE
+#else
+#define BVM_VM_LOCAL
+#endif
+
+/* Sanity check - a GC before every allocation is of little use if most allocations bypass the allocator */
+#if BVM_DEBUG_HEAP_GC_ON_ALLOC
+#undef BVM_HEAP_TLAB_ENABLE
+#define BVM_HEAP_TLAB_ENABLE 0
+#endif
+
+#ifndef BVM_32BIT_ENABLE
+#define BVM_32BIT_ENABLE 0
+#if (!BVM_NATIVE_INT64_ENABLE)
+#error "64 bit systems must not have BVM_NATIVE_INT64_ENABLE as 0"
+#endif
+#endif
+
+/**
+ * When set, each heap chunk header is a \c size_t wide rather than 32 bits.  On a 64 bit host this lifts the heap
+ * maximum from 16mb (the limit of the 24 bit size field of the compact header) to 4gb, and also gives the user data
+ * of each chunk the full native alignment.  Small targets keep the compact header.
+ *
+ * Default is enabled for 64 bit builds (#BVM_32BIT_ENABLE is 0) and disabled otherwise.
+ */
+#ifndef BVM_HEAP_WIDE_HEADER_ENABLE
+#if BVM_32BIT_ENABLE
+#define BVM_HEAP_WIDE_HEADER_ENABLE 0
+#else
+#define BVM_HEAP_WIDE_HEADER_ENABLE 1
+#endif
+#endif
+
+/**
+ * When set, the elements of reference arrays are 32 bit compressed references rather than native pointers, which on
+ * a 64 bit host halves the size of every \c Object[] (and so of the tables of hashtables, vectors and the like).
+ * Heap regions are taken from the platform below 4gb with #bvm_pd_memory_heap_alloc so that the address of any
+ * object fits in 32 bits, and a reference is compressed and decompressed with #BVM_REF_Encode and #BVM_REF_Decode.
+ * The fields of objects stay #bvm_cell_t wide, as the VM reads many of them through C structs.  Not used (and
+ * turned off) by 32 bit builds, whose pointers are 32 bits already.
+ *
+ * Default is disabled.
+ */
+#ifndef BVM_COMPRESSED_REFS_ENABLE
+#define BVM_COMPRESSED_REFS_ENABLE 0
+#endif
+
+#if (BVM_COMPRESSED_REFS_ENABLE && BVM_32BIT_ENABLE)
+#undef BVM_COMPRESSED_REFS_ENABLE
+#define BVM_COMPRESSED_REFS_ENABLE 0
+#endif
+
+/* Sanity check - a snapshot is relocated a native pointer at a time */
+#if (BVM_VM_SNAPSHOT_ENABLE && BVM_COMPRESSED_REFS_ENABLE)
+#error "BVM_VM_SNAPSHOT_ENABLE and BVM_COMPRESSED_REFS_ENABLE may not both be set"
+#endif
+
+/**
+ * When set, the primitive instance fields of a class are packed by width rather than each taking a #bvm_cell_t.
+ * A class's reference fields still take a cell each (so the GC sees them as before), and its primitive fields follow
+ * them grouped as 8 byte (long and double), 4 byte (int and float), 2 byte (char and short) and 1 byte (byte and
+ * boolean) fields, with the whole rounded up to a cell.  On a 64 bit host a class of eight booleans takes one cell of
+ * fields rather than eight.  Packed fields are read and written through #bvm_object_get_packed_field and
+ * #bvm_object_put_packed_field.  Classes of the bootstrap classloader keep their cell layout, as the VM reads many of
+ * them through C structs.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_FIELD_PACKING_ENABLE
+#define BVM_FIELD_PACKING_ENABLE 1
+#endif
+
+/**
+ * When set, the thin lock word of an object (see #BVM_THIN_LOCK_ENABLE) is kept in the top bits of its chunk header
+ * rather than in a word of its own after the object's clazz.  The wide header of a 64 bit build has 24 bits spare above
+ * the 32 bit chunk size - room for the inflated flag, a recursion count and a 16 bit owner lock id.  Saves a word on
+ * every object and array.  A thread whose lock id does not fit uses monitors only.  Needs a 64 bit wide chunk header,
+ * so it is turned off otherwise.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_THIN_LOCK_HEADER_ENABLE
+#define BVM_THIN_LOCK_HEADER_ENABLE 1
+#endif
+
+#if (BVM_THIN_LOCK_HEADER_ENABLE && (!BVM_THIN_LOCK_ENABLE || !BVM_HEAP_WIDE_HEADER_ENABLE || BVM_32BIT_ENABLE || \
+		BVM_GC_CONCURRENT_SWEEP_ENABLE))
+#undef BVM_THIN_LOCK_HEADER_ENABLE
+#define BVM_THIN_LOCK_HEADER_ENABLE 0
+#endif
+
+/**
+ * When set, the smallest chunk the heap hands out is the size of a #bvm_chunk_t (a header and two pointers) rather
+ * than #BVM_CHUNK_MIN_SIZE, which also has room for the back pointer a free chunk keeps in its last bytes.  An object
+ * of a field or two no longer pays for that pointer.  A free chunk that small cannot hold both its free list links and
+ * its back pointer, so it is kept out of the free list altogether - its space is taken back when a neighbour is freed
+ * and coalesces with it.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_HEAP_TINY_CHUNKS_ENABLE
+#define BVM_HEAP_TINY_CHUNKS_ENABLE 1
+#endif
+
+/* Sanity check - the JIT only has an x86-64 backend */
+#if (BVM_JIT_ENABLE && !(defined(__x86_64__) || defined(_M_X64)))
+#undef BVM_JIT_ENABLE
+#define BVM_JIT_ENABLE 0
+#endif
+
+/* Sanity check - X86 endian-ness */
+//#ifdef BVM_CPU_X86
+//#undef BVM_BIG_ENDIAN_ENABLE
+//#define BVM_BIG_ENDIAN_ENABLE 0
+//#endif
+
+/**
+ * When set, the String search and UTF-8 decoding kernels (see #bvm_str_jchar_index_of) use SSE2 or NEON vector
+ * instructions.  Otherwise they work a machine word at a time.  If the compiler targets SSE2 (\c __SSE2__) or NEON
+ * (\c __ARM_NEON) this will be enabled by default, but can be turned off by defining \c BVM_STRING_SIMD_ENABLE=0.
+ */
+#ifndef BVM_STRING_SIMD_ENABLE
+#if (defined(__SSE2__) || defined(__ARM_NEON))
+#define BVM_STRING_SIMD_ENABLE 1
+#else
+#define BVM_STRING_SIMD_ENABLE 0
+#endif
+#endif
+
+/**
+ * "Direct Threading" takes advantage of the GCC ability to treat labels as first class values and are
+ * used with "goto" to speed up a 'switch'-like statement.  If \c __GNUC__ is defined we'll define
+ * \c BVM_DIRECT_THREADING_ENABLE=1 so that the interp dispatch can be sped up.  Probably by 5% to 10%.
+ *
+ * On GNUC, direct threading will be enabled by default, but can be turned off by
+ * defining \c BVM_DIRECT_THREADING_ENABLE=0.
+ *
+ * @note The use of direct threading avoids a few extra machine instructions that a 'switch'
+ * statement generates to range check.  If GCC, unless you're having issues, direct threading is
+ * recommended.
+ *
+ */
+#ifndef BVM_DIRECT_THREADING_ENABLE
+#if (defined(__GNUC__))
+#define BVM_DIRECT_THREADING_ENABLE 1
+#else
+#define BVM_DIRECT_THREADING_ENABLE 0
+#endif
+#endif
+
+/**
+ * With direct threading and the debugger, the interpreter dispatches each bytecode through one of two label
+ * tables.  While no debugger session is open the plain opcode table is used and the dispatch carries no debugger
+ * overhead at all.  While a session is open, every entry of the second table leads to the debugger hook (breakpoints
+ * and stepping) which then dispatches the opcode through the plain table.  The loop changes tables when a session
+ * opens or closes.  If disabled, the session state is checked before each bytecode.
+ *
+ * Only has effect when both \c BVM_DEBUGGER_ENABLE and \c BVM_DIRECT_THREADING_ENABLE are enabled.
+ *
+ * Default is enabled.
+ */
+#ifndef BVM_EXEC_DEBUG_DISPATCH_ENABLE
+#define BVM_EXEC_DEBUG_DISPATCH_ENABLE 1
 #endif
 
 #endif /*BVM_DEFINE_H_*/
@@ -31,6 +31,68 @@
 
 void bvm_exec_run();
 
+#if BVM_NI_CALLS_ENABLE
+bvm_throwable_obj_t *bvm_exec_call(bvm_method_t *method, bvm_cell_t *args, bvm_cell_t *result);
+#endif
+
+#if BVM_VM_SLICE_ENABLE
+extern BVM_VM_LOCAL bvm_bool_t bvm_gl_exec_slice_active;
+extern BVM_VM_LOCAL bvm_bool_t bvm_gl_exec_slice_idle;
+
+bvm_bool_t bvm_exec_run_slice(bvm_uint32_t max_bytecodes, bvm_uint32_t max_micros);
+#endif
+
+bvm_uint8_t bvm_exec_unquickened_opcode(bvm_uint8_t opcode);
+
+#if (BVM_EXEC_SUPERINSTRUCTIONS || BVM_DEBUGGER_BYTECODES_ENABLE || BVM_JIT_ENABLE || BVM_AOT_ENABLE || BVM_GC_STACK_MAPS_ENABLE || \
+	 BVM_EXEC_REGISTER_IR_ENABLE)
+bvm_uint32_t bvm_exec_instruction_length(bvm_uint8_t *code, bvm_uint32_t pc_index, bvm_uint8_t opcode);
+#endif
+
+#if BVM_EXEC_SUPERINSTRUCTIONS
+void bvm_exec_fuse_superinstructions(bvm_uint8_t *code, bvm_uint32_t code_length);
+#endif
+
+#if BVM_EXEC_INLINE_CACHE_ENABLE
+void bvm_exec_inline_cache_flush();
+#endif
+
+#if BVM_EXEC_TYPE_CACHE_ENABLE
+void bvm_exec_type_cache_flush();
+#endif
+
+#if BVM_EXEC_IMPLICIT_NULL_CHECKS_ENABLE
+void bvm_exec_null_trap_start();
+void bvm_exec_null_trap_stop();
+#endif
+
+#if BVM_EXEC_SWITCH_TABLES_ENABLE
+void bvm_exec_switch_tables_free(bvm_method_t *method);
+#endif
+
+#if BVM_EXEC_STRING_CONCAT_ENABLE
+void bvm_exec_concats_free(bvm_method_t *method);
+#endif
+
+#if (BVM_VM_SNAPSHOT_ENABLE && (BVM_EXEC_SWITCH_TABLES_ENABLE || BVM_EXEC_STRING_CONCAT_ENABLE))
+void bvm_exec_snapshot_map(bvm_method_t *method);
+#endif
+
+#if BVM_EXEC_INTRINSICS_ENABLE
+
+/* the intrinsic methods - see #BVM_EXEC_INTRINSICS_ENABLE */
+#define BVM_EXEC_INTRINSIC_NONE				0
+#define BVM_EXEC_INTRINSIC_STRING_CHARAT	1
+#define BVM_EXEC_INTRINSIC_STRING_HASHCODE	2
+#define BVM_EXEC_INTRINSIC_STRING_EQUALS	3
+#define BVM_EXEC_INTRINSIC_MATH_SQRT		4
+#define BVM_EXEC_INTRINSIC_SYSTEM_ARRAYCOPY	5
+#define BVM_EXEC_INTRINSIC_INTEGER_VALUEOF	6
+#define BVM_EXEC_INTRINSIC_CHARACTER_VALUEOF	7
+
+bvm_uint8_t bvm_exec_intrinsic_get(bvm_method_t *method);
+#endif
+
 /* The list of opcodes in all their naked glory. */
 #define OPCODE_nop             0
 #define OPCODE_aconst_null     1
@@ -269,23 +331,37 @@ void bvm_exec_run();
 #define OPCODE_230_invokespecial_fast   230
 #define OPCODE_231_invokeinterface_fast 231
 #define OPCODE_232_invokevirtual_fast   232
-#define OPCODE_233 					233
-#define OPCODE_234             		234
-#define OPCODE_235             		235
-#define OPCODE_236             		236
-#define OPCODE_237             		237
-#define OPCODE_238             		238
-#define OPCODE_239             		239
-
-#define OPCODE_240             		240
-#define OPCODE_241             		241
-#define OPCODE_242             		242
-#define OPCODE_243             		243
-#define OPCODE_244             		244
-#define OPCODE_245             		245
-#define OPCODE_246             		246
-#define OPCODE_247             		247
-#define OPCODE_248             		248
+
+/* superinstructions - see #BVM_EXEC_SUPERINSTRUCTIONS */
+#define OPCODE_233_aload_0_getfield     233
+#define OPCODE_234_iload_iload          234
+#define OPCODE_235_iload_iload_if_icmp  235
+#define OPCODE_236_aload_arraylength    236
+
+/* intrinsic method invocations - see #BVM_EXEC_INTRINSICS_ENABLE */
+#define OPCODE_237_invokestatic_intrinsic  237
+#define OPCODE_238_invokevirtual_intrinsic 238
+
+/* inlined accessor method invocations - see #BVM_EXEC_ACCESSOR_INLINING_ENABLE */
+#define OPCODE_239_invokevirtual_getter    239
+#define OPCODE_240_invokevirtual_setter    240
+#define OPCODE_241_invokespecial_getter    241
+#define OPCODE_242_invokespecial_setter    242
+
+/* packed field access - see #BVM_FIELD_PACKING_ENABLE */
+#define OPCODE_243_getfield_fast_packed    243
+#define OPCODE_244_putfield_fast_packed    244
+
+/* folded static final constants - see #BVM_EXEC_CONSTANT_FOLDING_ENABLE */
+#define OPCODE_245_getstatic_fast_constant 245
+
+/* pre-decoded switches - see #BVM_EXEC_SWITCH_TABLES_ENABLE */
+#define OPCODE_246_tableswitch_fast        246
+#define OPCODE_247_lookupswitch_fast       247
+
+/* a recognised string concatenation - see #BVM_EXEC_STRING_CONCAT_ENABLE */
+#define OPCODE_248_new_concat              248
+
 #define OPCODE_249             		249
 
 #define OPCODE_250             		250
@@ -40,8 +40,17 @@ typedef struct _bvmfilebufferstruct {
 	/** The current reading/writing position within the buffer */
 	bvm_int32_t position;
 
+#if BVM_FILE_MAP_ENABLE
+	/** The byte data - the #bytes of the buffer, or for a buffer created by #bvm_create_mapped_buffer, part of a
+	 * file mapped into memory */
+	bvm_uint8_t *data;
+
+	/** An array of byte data.  The actual size of the data array is determined at runtime */
+	bvm_uint8_t bytes[1];
+#else
 	/** An array of byte data.  The actual size of the data array is determined at runtime */
 	bvm_uint8_t data[1];
+#endif
 } bvm_filebuffer_t;
 
 /**
@@ -62,6 +71,10 @@ typedef struct _bvmfiletype {
 	int (*remove)(const char *);
 	int (*truncate)(void *, size_t);
 	int (*exists)(const char *);
+#if BVM_FILE_MAP_ENABLE
+	void *(*map)(void *, size_t);
+	int (*unmap)(void *, size_t);
+#endif
 } bvm_filetypeintf_t;
 
 /**
@@ -71,15 +84,18 @@ typedef struct _bvmfiletype {
 
 /* global limits and sizes */
 
-extern int bvm_gl_max_file_handles;
+extern BVM_VM_LOCAL int bvm_gl_max_file_handles;
 
-extern bvm_filetypeintf_t *bvm_gl_filetype_md;
+extern BVM_VM_LOCAL bvm_filetypeintf_t *bvm_gl_filetype_md;
 
 void bvm_init_io();
 void bvm_file_finalise();
 
 bvm_filebuffer_t *bvm_buffer_file_from_platform(char *filename);
 bvm_filebuffer_t *bvm_create_buffer(size_t size, int alloc_type);
+#if BVM_FILE_MAP_ENABLE
+bvm_filebuffer_t *bvm_create_mapped_buffer(bvm_uint8_t *data, size_t size, int alloc_type);
+#endif
 
 typedef int BVM_FILE;
 
@@ -163,6 +179,87 @@ int bvm_file_truncate(BVM_FILE file, size_t size);
  */
 int bvm_file_exists(const char *filename);
 
+#if BVM_FILE_BUFFER_ENABLE
+/**
+ * Read from a file through its buffer.
+ *
+ * @return the number of bytes read, which is less than requested only at the end of the file.
+ */
+size_t bvm_file_buffered_read(void *dst, size_t size, BVM_FILE file);
+
+/**
+ * Write to a file through its buffer.
+ *
+ * @return the number of bytes written, which is less than count on error.
+ */
+size_t bvm_file_buffered_write(const void *src, size_t size, BVM_FILE file);
+#endif
+
+#if BVM_FILE_MAP_ENABLE
+/**
+ * Map the whole of an open file into memory for reading.  The mapping is unmapped when the file is closed.
+ *
+ * @return the address of the mapping, or \c NULL if the file could not be mapped.
+ */
+bvm_uint8_t *bvm_file_map(BVM_FILE file);
+
+/**
+ * Give the size of the mapping of an open file.
+ *
+ * @return the number of bytes mapped, or zero if the file is not mapped.
+ */
+size_t bvm_file_map_size(BVM_FILE file);
+#endif
+
+#if BVM_FILE_ASYNC_ENABLE
+
+/**
+ * A read or write of an open file handed to a host OS thread by #bvm_file_async_start.  The file is lent to the read or
+ * write until it is done - the VM may not otherwise use it meanwhile.
+ */
+typedef struct _bvmfileasyncstruct {
+
+	/** the file read or written */
+	BVM_FILE file;
+
+	/** the platform handle of the file, lent to the read or write */
+	void *handle;
+
+	/** the file type of the file */
+	bvm_filetypeintf_t *type;
+
+	/** whether this is a write rather than a read */
+	bvm_bool_t is_write;
+
+	/** the bytes written, or the bytes read.  Static memory - not moved or collected while the host thread has it. */
+	bvm_uint8_t *data;
+
+	/** the number of bytes to read or write */
+	size_t count;
+
+	/** the result of the platform read or write - valid once #is_done is set */
+	size_t result;
+
+	/** set by the host thread (under the async lock) when the read or write is done */
+	bvm_bool_t is_done;
+
+	/** the host thread, or \c NULL if the read or write was done by the VM thread itself */
+	void *thread;
+
+	/** the VM thread parked until the read or write is done - see #bvm_thread_wait_for_file */
+	struct _bvmthreadstruct *vmthread;
+
+	/** the next read or write still with a host thread */
+	struct _bvmfileasyncstruct *next;
+
+} bvm_file_async_t;
+
+bvm_file_async_t *bvm_file_async_start(BVM_FILE file, const void *src, size_t count, bvm_bool_t is_write);
+bvm_file_async_t *bvm_file_async_poll();
+void bvm_file_async_free(bvm_file_async_t *async);
+
+#endif
+
 bvm_uint16_t bvm_file_read_uint16(bvm_filebuffer_t *buffer);
 bvm_int32_t bvm_file_read_int32(bvm_filebuffer_t *buffer);
 bvm_uint32_t bvm_file_read_uint32(bvm_filebuffer_t *buffer);
@@ -170,5 +267,10 @@ void bvm_file_skip_bytes(bvm_filebuffer_t *buffer, size_t count);
 bvm_uint8_t *bvm_file_read_bytes(bvm_filebuffer_t *buffer, size_t size, int alloc_type);
 void bvm_file_read_bytes_into(bvm_filebuffer_t *buffer, size_t size, void *dest);
 bvm_utfstring_t *bvm_file_read_utfstring(bvm_filebuffer_t *buffer, int alloc_type);
+bvm_utfstring_t *bvm_file_read_pooled_utfstring(bvm_filebuffer_t *buffer);
+
+#if BVM_VM_SNAPSHOT_ENABLE
+void bvm_file_snapshot_map();
+#endif
 
 #endif /*BVM_FILE_H_*/
@@ -76,6 +76,17 @@ bvm_bool_t bvm_fp_is_dnan(bvm_int64_t v);
 bvm_bool_t bvm_fp_is_dpinf(bvm_int64_t v);
 bvm_bool_t bvm_fp_is_dninf(bvm_int64_t v);
 
+#if BVM_FP_FAST_CONVERSION_ENABLE
+
+/** The size of buffer #bvm_fp_double_to_chars and #bvm_fp_float_to_chars need, including the nul */
+#define BVM_FP_MAX_CHARS	32
+
+int bvm_fp_double_to_chars(bvm_double_t d, char *buf);
+int bvm_fp_float_to_chars(bvm_float_t f, char *buf);
+bvm_bool_t bvm_fp_parse(const bvm_uint16_t *chars, bvm_int32_t length, bvm_bool_t is_float, bvm_double_t *result);
+
+#endif
+
 #endif
 
 
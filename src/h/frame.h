@@ -45,6 +45,13 @@ typedef struct _bvmstacksegmentstruct {
 	 * list.  */
 	struct _bvmstacksegmentstruct *next;
 
+#if BVM_FRAME_COMPACT_ENABLE
+	/** Pointer to the #bvm_stacksegment_t this one follows in its thread's list.  If \c NULL, this is the first
+	 * segment in the list.  Compact frames do not keep their calling frame's segment, so a frame pop that crosses
+	 * a segment boundary uses this to find it. */
+	struct _bvmstacksegmentstruct *prev;
+#endif
+
 	/** Pointer to the first #bvm_cell_t of the stack.  The actual length of each segment is determined
 	 * at runtime. The default stack size (in cells, not in bytes) is given in the global #bvm_gl_stack_height,
 	 * which is defaulted from the compile-time define #BVM_THREAD_STACK_HEIGHT. */
@@ -53,20 +60,41 @@ typedef struct _bvmstacksegmentstruct {
 } bvm_stacksegment_t;
 
 /* externs for global registers */
-extern bvm_cell_t 			*bvm_gl_rx_sp;
-extern bvm_uint8_t   		*bvm_gl_rx_pc;
-extern bvm_uint8_t   		*bvm_gl_rx_ppc;
-extern bvm_instance_clazz_t *bvm_gl_rx_clazz;
-extern bvm_method_t 		*bvm_gl_rx_method;
-extern bvm_cell_t 			*bvm_gl_rx_locals;
-extern bvm_stacksegment_t 	*bvm_gl_rx_stack;
+extern BVM_VM_LOCAL bvm_cell_t 			*bvm_gl_rx_sp;
+extern BVM_VM_LOCAL bvm_uint8_t   		*bvm_gl_rx_pc;
+extern BVM_VM_LOCAL bvm_uint8_t   		*bvm_gl_rx_ppc;
+extern BVM_VM_LOCAL bvm_instance_clazz_t *bvm_gl_rx_clazz;
+extern BVM_VM_LOCAL bvm_method_t 		*bvm_gl_rx_method;
+extern BVM_VM_LOCAL bvm_cell_t 			*bvm_gl_rx_locals;
+extern BVM_VM_LOCAL bvm_stacksegment_t 	*bvm_gl_rx_stack;
 /*extern bvm_obj_t  		*bvm_gl_sync_obj;*/
 
-/*extern bvm_uint32_t bvm_gl_stack_depth;*/
+#if BVM_DEBUGGER_ENABLE
+extern BVM_VM_LOCAL bvm_uint32_t		bvm_gl_rx_depth;
+#endif
+
+extern BVM_VM_LOCAL bvm_method_t *BVM_METHOD_NOOP;
+extern BVM_VM_LOCAL bvm_method_t *BVM_METHOD_NOOP_RET;
+extern BVM_VM_LOCAL bvm_method_t *BVM_METHOD_CALLBACKWEDGE;
+#if BVM_SCOPED_MEMORY_ENABLE
+extern BVM_VM_LOCAL bvm_method_t *BVM_METHOD_DOINIT;
+#endif
+
+#if BVM_FRAME_COMPACT_ENABLE
+
+#define BVM_FRAME_METHOD_OFFSET 	-1
+#define BVM_FRAME_PC_OFFSET     	-2
+#define BVM_FRAME_PPC_OFFSET    	-3
+#define BVM_FRAME_SP_OFFSET 		-4
+#define BVM_FRAME_LOCALS_OFFSET 	-5
+/* only present in the frame of a synchronized method */
+#define BVM_FRAME_SYNCOBJ_OFFSET  	-6
 
-extern bvm_method_t *BVM_METHOD_NOOP;
-extern bvm_method_t *BVM_METHOD_NOOP_RET;
-extern bvm_method_t *BVM_METHOD_CALLBACKWEDGE;
+#define BVM_STACK_RETURN_FRAME_SIZE  5
+
+#define BVM_STACK_FrameSize(m)  ( BVM_STACK_RETURN_FRAME_SIZE + (BVM_METHOD_IsSynchronized(m) ? 1 : 0) )
+
+#else
 
 #define BVM_FRAME_SYNCOBJ_OFFSET  	-1
 #define BVM_FRAME_STACK_OFFSET  	-2
@@ -78,6 +106,10 @@ extern bvm_method_t *BVM_METHOD_CALLBACKWEDGE;
 
 #define BVM_STACK_RETURN_FRAME_SIZE  7
 
+#define BVM_STACK_FrameSize(m)  BVM_STACK_RETURN_FRAME_SIZE
+
+#endif
+
 #define BVM_STACK_GetCallingClass()       ( (bvm_instance_clazz_t *) ((bvm_method_t *) bvm_gl_rx_locals[BVM_FRAME_METHOD_OFFSET].ptr_value)->clazz)
 #define BVM_STACK_ExecMethodSyncObject()  (bvm_gl_rx_locals[BVM_FRAME_SYNCOBJ_OFFSET].ref_value)
 
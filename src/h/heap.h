@@ -35,6 +35,16 @@
 #define BVM_GC_COLOUR_GREY   1
 /** GC marking colour meaning "marked" */
 #define BVM_GC_COLOUR_BLACK  2
+/** GC marking colour meaning "marked, and in the remembered set" - only used by the generational collector */
+#define BVM_GC_COLOUR_REMEMBERED  3
+
+#if BVM_HEAP_WIDE_HEADER_ENABLE
+/** A chunk header - wide enough for a chunk size that spans the entire 32 bit heap size range */
+typedef size_t bvm_chunk_header_t;
+#else
+/** A chunk header - compact at 32 bits with 24 bits of chunk size */
+typedef bvm_uint32_t bvm_chunk_header_t;
+#endif
 
 /**
  * A chunk of memory as managed by the allocator.   This structure here represents the structure of a 'free' chunk.  An
@@ -46,15 +56,15 @@
 typedef struct _bvmchunkstruct {
 
 	/**
-	 * header is 32 bits:
+	 * header is 32 bits (or \c size_t bits if #BVM_HEAP_WIDE_HEADER_ENABLE is set):
 	 *
-     * 24 bits size
+     * 24 bits size (or the remaining upper bits if wide)
 	 * 4 bits alloc type
 	 * 2 bits GC colour (white/grey/black)
 	 * 1 bit prev chunk in-use/free status
 	 * 1 bit this chunk in-use/free status
 	 */
-	bvm_uint32_t header;
+	bvm_chunk_header_t header;
 
 	/** If this chunk is free, this points to the next chunk in the free list.  If this chunk is
 	 * in-use, this marks the start of the user-data memory. See #bvm_inuse_chunk_t */
@@ -74,27 +84,122 @@ typedef struct _bvmchunkstruct {
  * Used as a cast for the #bvm_chunk_t structure for convenient use as an in-use chunk
  */
 typedef struct _bvminusechunkstruct {
-	bvm_uint32_t header;
+	bvm_chunk_header_t header;
 	bvm_uint8_t user_data[1];
 } bvm_inuse_chunk_t;
 
-/** Handle to the start of the heap */
-extern bvm_uint8_t *bvm_gl_heap_start;
+/**
+ * A region of the heap.  The heap is made of one or more regions, each a separate block of memory gained from the
+ * platform using #bvm_pd_memory_alloc.  The region struct sits at the start of its block and the region's chunks follow
+ * it.  The last chunk in each region is a permanently in-use 'fence' chunk at \c end so that no chunk is ever coalesced
+ * with (or flags) a chunk in another region.
+ */
+typedef struct _bvmheapregionstruct {
+
+	/** The next region in the heap's region list, or \c NULL if this is the last */
+	struct _bvmheapregionstruct *next;
+
+	/** The first chunk in the region */
+	bvm_uint8_t *start;
+
+	/** One byte past the last usable chunk in the region - the region fence chunk sits here */
+	bvm_uint8_t *end;
 
-/** Handle to a byte past the end of the heap */
-extern bvm_uint8_t  *bvm_gl_heap_end;
+#if BVM_HEAP_LARGE_OBJECT_ENABLE
+	/** Set if the region holds just a single large primitive array */
+	bvm_bool_t is_large;
+#endif
 
-/** Total heap size */
-extern bvm_uint32_t bvm_gl_heap_size;
+} bvm_heap_region_t;
+
+/** Handle to the start of the lowest heap region */
+extern BVM_VM_LOCAL bvm_uint8_t *bvm_gl_heap_start;
+
+/** Handle to a byte past the end of the highest heap region */
+extern BVM_VM_LOCAL bvm_uint8_t  *bvm_gl_heap_end;
+
+/** The list of heap regions - the first is the initial heap region */
+extern BVM_VM_LOCAL bvm_heap_region_t *bvm_gl_heap_regions;
+
+/** Total heap size over all regions */
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_heap_size;
 
 /** Total bytes in the free list */
-extern bvm_uint32_t bvm_gl_heap_free;
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_heap_free;
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_heap_free_chunks;
+
+/** Bytes taken from the free list since the last GC began */
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_heap_allocated;
+
+/** Maximum size the heap may grow to */
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_heap_limit;
+
+#if BVM_HEAP_LARGE_OBJECT_ENABLE
+/** Primitive arrays of at least this many bytes get a region of their own */
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_heap_large_object_size;
+#endif
+
+/** Free percentage below which the heap is grown after a GC */
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_heap_grow_percent;
+
+#if BVM_HEAP_METADATA_ARENA_ENABLE
+
+/** Total size of the regions of the metadata arena */
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_heap_metadata_size;
+
+/** Bytes of the metadata arena in use */
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_heap_metadata_used;
+
+/** A metadata arena - opaque outside of the heap */
+typedef struct _bvmheapmetadataarenastruct bvm_heap_metadata_arena_t;
+
+/** The arena for the next #BVM_ALLOC_TYPE_METADATA allocation - see #BVM_ALLOC_TYPE_CLAZZ_METADATA */
+extern BVM_VM_LOCAL bvm_heap_metadata_arena_t *bvm_gl_heap_metadata_arena;
+
+#endif
+
+#if BVM_HEAP_TLAB_ENABLE
+
+/** Handle to the chunk that holds the unused remainder of the current thread allocation buffer, or \c NULL if
+ * there is no current buffer */
+extern BVM_VM_LOCAL bvm_uint8_t *bvm_gl_heap_tlab_top;
+
+/** Handle to a byte past the end of the current thread allocation buffer */
+extern BVM_VM_LOCAL bvm_uint8_t *bvm_gl_heap_tlab_end;
+
+#if BVM_GC_LAZY_SWEEP_ENABLE
+
+/** The GC colour bits given to each chunk allocated from the current thread allocation buffer */
+extern BVM_VM_LOCAL bvm_chunk_header_t bvm_gl_heap_tlab_colour;
+
+#define BVM_HEAP_TLAB_COLOUR bvm_gl_heap_tlab_colour
+#else
+#define BVM_HEAP_TLAB_COLOUR 0
+#endif
+
+#endif
+
+#if (BVM_GC_LAZY_SWEEP_ENABLE || BVM_GC_CONCURRENT_SWEEP_ENABLE)
+
+/** The region being lazily swept, or \c NULL if there is no sweep pending */
+extern BVM_VM_LOCAL bvm_heap_region_t *bvm_gl_heap_sweep_region;
+
+/** The next chunk to be lazily swept in #bvm_gl_heap_sweep_region - for the concurrent sweeper, the first chunk it
+ * has not yet handed back */
+extern BVM_VM_LOCAL bvm_chunk_t *bvm_gl_heap_sweep_chunk;
+
+#endif
 
 /** The minimum VM heap size */
 #define BVM_HEAP_MIN_SIZE  (256 * BVM_KB)
 
+#if BVM_HEAP_WIDE_HEADER_ENABLE
+/** The maximum heap size - limited by the 32 bit heap size and free space totallers (4gb less alignment). */
+#define BVM_HEAP_MAX_SIZE  (0xFFFFFFFF & ~BVM_CHUNK_ALIGN_MASK)
+#else
 /** The maximum heap size - limited by the 24 bit space in the header for size (16mb). */
 #define BVM_HEAP_MAX_SIZE  0xFFFFFF
+#endif
 
 /** Chunk header mask for the in-use bit. */
 #define BVM_CHUNK_INUSE_MASK  		0x1
@@ -108,6 +213,18 @@ extern bvm_uint32_t bvm_gl_heap_free;
 /** Chunk header mask to isolate the GC colour */
 #define CHUNK_COLOUR_MASK		0xC
 
+#if BVM_THIN_LOCK_HEADER_ENABLE
+
+/** How many bits we have to shift the header to access the thin lock word - it sits above the 32 bit size. */
+#define BVM_CHUNK_LOCKWORD_SHIFT	(BVM_CHUNK_SIZE_SHIFT + 32)
+
+/** Chunk header mask to isolate the thin lock word */
+#define BVM_CHUNK_LOCKWORD_MASK		(~(bvm_chunk_header_t) 0 << BVM_CHUNK_LOCKWORD_SHIFT)
+
+#else
+#define BVM_CHUNK_LOCKWORD_MASK		0
+#endif
+
 /** To determine if a given chunk is in use */
 #define BVM_CHUNK_IsInuse(c)       (((c)->header & BVM_CHUNK_INUSE_MASK) > 0)
 
@@ -115,7 +232,10 @@ extern bvm_uint32_t bvm_gl_heap_free;
 #define BVM_CHUNK_IsPrevChunkFree(c)   (((c)->header & BVM_CHUNK_PREV_FREE_MASK) > 0)
 
 /** Determine the size of a given chunk */
-#define BVM_CHUNK_GetSize(c)  ( (c)->header >> BVM_CHUNK_SIZE_SHIFT)
+#define BVM_CHUNK_GetSize(c)  ( (bvm_uint32_t) ((c)->header >> BVM_CHUNK_SIZE_SHIFT) )
+
+/** A chunk header with the given size and all other bits clear */
+#define BVM_CHUNK_SizeHeader(s)  ( ((bvm_chunk_header_t) (s)) << BVM_CHUNK_SIZE_SHIFT)
 
 /** Determine the alloc type of a given chunk. */
 #define BVM_CHUNK_GetType(c)  ( ((c)->header & BVM_CHUNK_TYPE_MASK) >> BVM_CHUNK_TYPE_SHIFT)
@@ -137,6 +257,15 @@ extern bvm_uint32_t bvm_gl_heap_free;
 #define BVM_CHUNK_SetAllocType(c, t)  \
 	{(c)->header = ((c)->header & ~BVM_CHUNK_TYPE_MASK) | ((t) << BVM_CHUNK_TYPE_SHIFT);}
 
+/** Split an in-use chunk where it is so that it keeps only its first \c s bytes - a chunk size, so aligned and at
+ * least #BVM_CHUNK_MIN_ALLOC_SIZE.  The rest becomes the next chunk, in use, of alloc type \c t and the same GC
+ * colour.  Nothing is freed or moved, and the heap stays walkable. */
+#define BVM_CHUNK_Split(c, s, t)  \
+	{((bvm_chunk_t *) (BVM_CHUNK_AsBytePtr(c) + (s)))->header = BVM_CHUNK_SizeHeader(BVM_CHUNK_GetSize(c) - (s)) |		\
+		((t) << BVM_CHUNK_TYPE_SHIFT) | ((c)->header & CHUNK_COLOUR_MASK) | BVM_CHUNK_INUSE_MASK;							\
+	 (c)->header = BVM_CHUNK_SizeHeader(s) | ((c)->header & (BVM_CHUNK_TYPE_MASK | CHUNK_COLOUR_MASK |						\
+		BVM_CHUNK_PREV_FREE_MASK | BVM_CHUNK_INUSE_MASK | BVM_CHUNK_LOCKWORD_MASK));}
+
 /** Gets the pointer to the #bvm_chunk_t associated with a user data pointer.  No correctness checking is
  * performed - this will return a pointer to the position where the chunk will start if it is a
  * valid chunk. */
@@ -146,12 +275,20 @@ extern bvm_uint32_t bvm_gl_heap_free;
 #define BVM_CHUNK_GetUserData(c)     (void *) (((bvm_inuse_chunk_t *) (c))->user_data)
 
 /** The size of the header of a chunk */
-#define BVM_CHUNK_OVERHEAD      sizeof(bvm_uint32_t)
+#define BVM_CHUNK_OVERHEAD      sizeof(bvm_chunk_header_t)
 
 /** The minimum allowable size for a chunk - space for header, next/prev pointers and last bytes used as
  * prev heap chunk pointer when not in use */
 #define BVM_CHUNK_MIN_SIZE     sizeof(bvm_chunk_t)+sizeof(bvm_chunk_t*)
 
+#if BVM_HEAP_TINY_CHUNKS_ENABLE
+/** The smallest chunk the heap hands out.  A free chunk smaller than #BVM_CHUNK_MIN_SIZE is not kept in the free
+ * list - see #BVM_HEAP_TINY_CHUNKS_ENABLE. */
+#define BVM_CHUNK_MIN_ALLOC_SIZE	sizeof(bvm_chunk_t)
+#else
+#define BVM_CHUNK_MIN_ALLOC_SIZE	BVM_CHUNK_MIN_SIZE
+#endif
+
 /** Memory alignment size */
 #define BVM_CHUNK_ALIGN_SIZE 	sizeof(size_t)
 
@@ -167,17 +304,87 @@ extern bvm_uint32_t bvm_gl_heap_free;
 /** How many bits required to shift the header for the GC colour */
 #define BVM_CHUNK_COLOUR_SHIFT  2
 
+/** The aligned size of a chunk that can hold \c s bytes of user data.  Note this may be less than #BVM_CHUNK_MIN_ALLOC_SIZE. */
+#define BVM_CHUNK_AlignedSize(s)	( ((s) + BVM_CHUNK_OVERHEAD + BVM_CHUNK_ALIGN_MASK) & ~BVM_CHUNK_ALIGN_MASK)
+
+#if BVM_HEAP_TLAB_ENABLE
+
+/**
+ * Inline fast path for allocating \c s bytes of alloc type \c t from the current thread allocation buffer.  \c p is
+ * set to the (already zeroed) user data of the new chunk, or to \c NULL if the buffer does not have room - in which
+ * case the caller must fall back to #bvm_heap_alloc or #bvm_heap_calloc.
+ *
+ * The unused remainder of the buffer is always an in-use chunk of its own (starting at #bvm_gl_heap_tlab_top) so the
+ * heap remains walkable by the GC and a chunk in the buffer may be freed as normal.  A new chunk is bumped off the front of the
+ * remainder, keeping the remainder's P bit (its previous chunk may have been freed) and giving it a white GC colour -
+ * or, with #BVM_GC_LAZY_SWEEP_ENABLE, the colour the buffer was given when it was taken (see #BVM_HEAP_TLAB_COLOUR).
+ */
+#define BVM_HEAP_TLAB_TRY_ALLOC(p, s, t) {																	\
+	bvm_uint32_t _tsz = BVM_CHUNK_AlignedSize(s);															\
+	if (_tsz < BVM_CHUNK_MIN_ALLOC_SIZE) _tsz = BVM_CHUNK_MIN_ALLOC_SIZE;									\
+	if ( (_tsz < BVM_HEAP_SMALL_CHUNK_LIMIT) &&																\
+		 ((bvm_uint32_t) (bvm_gl_heap_tlab_end - bvm_gl_heap_tlab_top) >= _tsz + BVM_CHUNK_MIN_SIZE) ) {	\
+		bvm_chunk_t *_tc = (bvm_chunk_t *) bvm_gl_heap_tlab_top;											\
+		bvm_gl_heap_tlab_top += _tsz;																		\
+		((bvm_chunk_t *) bvm_gl_heap_tlab_top)->header =													\
+			BVM_CHUNK_SizeHeader(bvm_gl_heap_tlab_end - bvm_gl_heap_tlab_top) |								\
+			(BVM_ALLOC_TYPE_DATA << BVM_CHUNK_TYPE_SHIFT) | BVM_CHUNK_INUSE_MASK;							\
+		_tc->header = BVM_CHUNK_SizeHeader(_tsz) | ((t) << BVM_CHUNK_TYPE_SHIFT) | BVM_HEAP_TLAB_COLOUR |	\
+			(_tc->header & BVM_CHUNK_PREV_FREE_MASK) | BVM_CHUNK_INUSE_MASK;								\
+		(p) = BVM_CHUNK_GetUserData(_tc);																	\
+	} else (p) = NULL;																						\
+}
+
+#else
+#define BVM_HEAP_TLAB_TRY_ALLOC(p, s, t) { (p) = NULL; }
+#endif
+
+/**
+ * Determine if a pointer lies within a heap region.  A cheap bounds check is done first - the region list is only walked
+ * if the heap has more than one region (there may be non-heap memory between them).
+ */
+#define BVM_HEAP_IsHeapAddress(p) ( ((bvm_uint8_t *) (p) >= bvm_gl_heap_start) &&			\
+									((bvm_uint8_t *) (p) < bvm_gl_heap_end) &&				\
+									( (bvm_gl_heap_regions->next == NULL) || bvm_heap_is_region_address(p) ) )
+
 void bvm_heap_init(size_t size);
 void bvm_heap_release();
 void *bvm_heap_alloc(size_t size, int alloc_type);
 void *bvm_heap_calloc(size_t size, int alloc_type);
 void bvm_heap_free(void *ptr);
+#if BVM_HEAP_IDLE_ZERO_ENABLE
+bvm_bool_t bvm_heap_zero_step();
+#endif
+#if BVM_HEAP_METADATA_ARENA_ENABLE
+bvm_heap_metadata_arena_t *bvm_heap_metadata_arena_new();
+void bvm_heap_metadata_arena_hold(bvm_heap_metadata_arena_t *arena);
+void bvm_heap_metadata_arena_release(bvm_heap_metadata_arena_t *arena);
+#endif
 bvm_chunk_t *bvm_heap_free_chunk(bvm_chunk_t *chunk);
 void *bvm_heap_clone(void *ptr);
 void bvm_heap_set_alloc_type(void *ptr, int alloc_type);
+void bvm_heap_tlab_retire();
+
+#if BVM_HEAP_LARGE_OBJECT_ENABLE
+void bvm_heap_release_large_region(bvm_heap_region_t *region);
+#endif
 
 void bvm_heap_debug_dump_free_list();
 void bvm_heap_debug_dump();
 bvm_bool_t bvm_heap_is_chunk_valid(bvm_chunk_t *chunk);
+bvm_bool_t bvm_heap_is_region_address(void *ptr);
+void bvm_heap_adjust_regions();
+bvm_uint32_t bvm_heap_largest_free();
+
+#if BVM_GC_COMPACTION_ENABLE
+void bvm_heap_take_free_chunk(bvm_chunk_t *chunk);
+#endif
+
+#if BVM_GC_CONCURRENT_SWEEP_ENABLE
+void bvm_heap_empty_free_list();
+void bvm_heap_format_free_chunk(bvm_chunk_t *chunk, bvm_uint32_t size);
+void bvm_heap_add_swept_chunks(bvm_chunk_t *chunks, bvm_uint32_t size);
+void bvm_heap_free_held_chunks();
+#endif
 
 #endif /*BVM_HEAP_H_*/
@@ -0,0 +1,55 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#ifndef BVM_HEAPDUMP_H_
+#define BVM_HEAPDUMP_H_
+
+/**
+  @file
+
+  Constants/Macros/Functions/Types for HPROF heap dumps.
+
+  @author Greg McCreath
+  @since 0.0.10
+
+*/
+
+#if BVM_HEAP_DUMP_ENABLE
+
+/**
+ * A heap dump writer.  Called by #bvm_heapdump with each block of the dump in order.
+ *
+ * @param data - the bytes to write.
+ * @param length - the number of bytes to write.
+ * @param context - the context given to #bvm_heapdump.
+ * @return #BVM_TRUE if the bytes were written, #BVM_FALSE if not - the dump is abandoned.
+ */
+typedef bvm_bool_t (*bvm_heapdump_writer_t)(const bvm_uint8_t *data, bvm_uint32_t length, void *context);
+
+extern BVM_VM_LOCAL char *bvm_gl_heapdump_on_oom_filename;
+
+bvm_bool_t bvm_heapdump(bvm_heapdump_writer_t writer, void *context);
+bvm_bool_t bvm_heapdump_to_file(const char *filename);
+
+#if BVM_SOCKETS_ENABLE
+bvm_bool_t bvm_heapdump_to_socket(const char *hostname, bvm_int32_t port);
+#endif
+
+#endif
+
+#endif /*BVM_HEAPDUMP_H_*/
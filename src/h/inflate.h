@@ -0,0 +1,47 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+/**
+  @file
+
+  Constants/Macros/Functions/Types for the table driven inflater.
+
+  @author Greg McCreath
+  @since 0.0.10
+
+*/
+
+#ifndef BVM_INFLATE_H_
+#define BVM_INFLATE_H_
+
+#if BVM_JAR_FAST_INFLATE_ENABLE
+
+/** The decode tables an inflate builds as it goes */
+typedef struct _inflateworkstruct bvm_inflate_work_t;
+
+int bvm_inflate(bvm_uint8_t *dest, bvm_uint32_t *dest_len, const bvm_uint8_t *source, bvm_uint32_t source_len);
+int bvm_inflate_with(bvm_inflate_work_t *work, bvm_uint8_t *dest, bvm_uint32_t *dest_len, const bvm_uint8_t *source,
+					 bvm_uint32_t source_len);
+
+#if BVM_CLAZZ_PREFETCH_ENABLE
+bvm_inflate_work_t *bvm_inflate_work_create();
+#endif
+
+#endif
+
+#endif
@@ -43,14 +43,10 @@
 
   @section long-emulated Emulated 64bit
 
-  This is more complex.  64 integer emulation is achieved by using two unsigned 32 bit integers.  Underlying this is a very small XP
-  (Extended Precision) library to operate on 64 bit integers as collection of 8 bit chars.  The XP library, if required, could be used
-  to do any extended precision mathematics for the platform like 2048 bit integer maths (and so on).  My feeling is that emulated 64 bit
-  integers could possibly be achieved with less code than is in the XP libs as it is made for arbitrary length integers.  Something specific
-  for 64 bit emulation could be a future enhancement.
-
-  In reality, the XP code is only used for multiplication, division, and bit shifting. All other operations including addition, subtraction, and
-  comparisons are done using non-XP macros.
+  This is more complex.  64 integer emulation is achieved by using two unsigned 32 bit integers, and only ever 32 bit
+  arithmetic.  Addition, subtraction, negation and comparisons are the macros below, done inline.  Multiplication, division
+  and shifts are functions in int64.c that work a 32 bit word at a time - a multiply of the low words to a full 64
+  bits, a plain 32 bit divide when both high words are zero, and a shift and subtract division otherwise.
 
   Refer note above re native vs emulated performance.
 
@@ -77,8 +73,14 @@ bvm_uint64_t uint64Pack(bvm_uint32_t hi, bvm_uint32_t low);
 
 #if (!BVM_NATIVE_INT64_ENABLE)
 
+/* the initialisers follow the order of the words in #bvm_int64_t, which depends on the endianness */
+#if (!BVM_BIG_ENDIAN_ENABLE)
+#define BVM_MAX_LONG        ((bvm_int64_t){0xFFFFFFFF,0x7FFFFFFF})
+#define BVM_MIN_LONG        ((bvm_int64_t){0,0x80000000})
+#else
 #define BVM_MAX_LONG        ((bvm_int64_t){0x7FFFFFFF,0xFFFFFFFF})
 #define BVM_MIN_LONG        ((bvm_int64_t){0x80000000,0})
+#endif
 
 #define BVM_INT64_ZERO      ((bvm_int64_t){0,0})
 #define BVM_INT64_MINUS_ONE ((bvm_int64_t){0xFFFFFFFF,0xFFFFFFFF})
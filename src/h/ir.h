@@ -0,0 +1,117 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#ifndef BVM_IR_H_
+#define BVM_IR_H_
+
+/**
+  @file
+
+  Constants/Macros/Functions/Types for the register based internal code.
+
+  @author Greg McCreath
+  @since 0.0.10
+
+*/
+
+#if BVM_EXEC_REGISTER_IR_ENABLE
+
+/**
+ * One register instruction.  Registers are cell indexes from the locals of the frame - the locals first, then the
+ * cells of the operand stack.
+ */
+typedef struct _bvmirinsnstruct {
+
+	/** the operation, an \c IR_ value */
+	bvm_uint8_t op;
+
+	/** the result register */
+	bvm_uint16_t a;
+
+	/** the first operand register */
+	bvm_uint16_t b;
+
+	/** the second operand register */
+	bvm_uint16_t c;
+
+	/** a constant operand, a field offset, or the index of the instruction a branch goes to */
+	bvm_int32_t k;
+
+	/** the bytecode offset the interpreter carries on from if the instruction stops - for a branch, that of the branch
+	 * target */
+	bvm_uint16_t pc_index;
+
+	/** the stack depth at \c pc_index */
+	bvm_uint16_t depth;
+
+} bvm_ir_insn_t;
+
+/**
+ * The register code of a method.  It is translated a piece at a time - from wherever the interpreter first goes into
+ * it - and grows as more of the method is run.
+ */
+typedef struct _bvmircodestruct {
+
+	/** the next code in the list of all code */
+	struct _bvmircodestruct *next;
+
+	/** the previous code in the list of all code */
+	struct _bvmircodestruct *prev;
+
+	/** for each bytecode offset, #BVM_IR_UNTRANSLATED, #BVM_IR_NONE, or the index of the instruction that starts
+	 * there plus #BVM_IR_FIRST */
+	bvm_uint32_t *entries;
+
+	/** for each bytecode offset, whether a branch goes there */
+	bvm_uint8_t *targets;
+
+	/** the number of instructions translated so far */
+	bvm_uint32_t count;
+
+	/** the room there is for instructions */
+	bvm_uint32_t capacity;
+
+	/** the instructions */
+	bvm_ir_insn_t insns[1];
+
+} bvm_ir_code_t;
+
+/** There is no register code for a bytecode offset yet - it is translated the first time it is run */
+#define BVM_IR_UNTRANSLATED	0
+
+/** There is no register code for a bytecode offset, and there never will be */
+#define BVM_IR_NONE			1
+
+/** What is added to instruction indexes in #bvm_ir_code_t.entries */
+#define BVM_IR_FIRST		2
+
+/** May the register code of a bytecode method be run from a given pc? */
+#define BVM_IR_MayRun(m, pc)	( ((m)->ir_code == NULL) || 												\
+								  ((m)->ir_code->entries[(pc) - (m)->code.bytecode] != BVM_IR_NONE) )
+
+/** Has a bytecode method register code already translated from a given pc? */
+#define BVM_IR_HasCode(m, pc)	( ((m)->ir_code != NULL) && 												\
+								  ((m)->ir_code->entries[(pc) - (m)->code.bytecode] >= BVM_IR_FIRST) )
+
+bvm_uint8_t *bvm_ir_run(bvm_method_t *method, bvm_cell_t *locals, bvm_cell_t **sp, bvm_uint8_t *pc);
+void bvm_ir_free(bvm_method_t *method);
+void bvm_ir_release();
+
+#endif
+
+#endif /*BVM_IR_H_*/
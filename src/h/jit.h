@@ -0,0 +1,54 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#ifndef BVM_JIT_H_
+#define BVM_JIT_H_
+
+/**
+  @file
+
+  Constants/Macros/Functions/Types for the baseline template JIT.
+
+  @author Greg McCreath
+  @since 0.0.10
+
+*/
+
+#if BVM_JIT_ENABLE
+
+/**
+ * The compiled code of a method.  Held in the JIT code cache along with the native code itself.
+ */
+typedef struct _bvmjitcodestruct {
+
+	/** the start of the native code */
+	bvm_uint8_t *native;
+
+	/** for each bytecode offset in the method, the offset of its native code from \c native, or \c 0 (zero) if the
+	 * offset is not the start of an instruction.  There are \c code_length of them. */
+	bvm_uint32_t entries[1];
+
+} bvm_jit_code_t;
+
+bvm_bool_t bvm_jit_compile(bvm_method_t *method);
+bvm_uint8_t *bvm_jit_run(bvm_method_t *method, bvm_cell_t *locals, bvm_cell_t **sp, bvm_uint8_t *pc);
+void bvm_jit_release();
+
+#endif
+
+#endif /*BVM_JIT_H_*/
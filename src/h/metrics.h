@@ -0,0 +1,68 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#ifndef BVM_METRICS_H_
+#define BVM_METRICS_H_
+
+/**
+  @file
+
+  Constants/Macros/Functions/Types for the runtime metrics server.
+
+  @author Greg McCreath
+  @since 0.0.10
+
+*/
+
+#if BVM_METRICS_ENABLE
+
+/** The number of buckets in the GC pause histogram - the last is for pauses longer than all the others */
+#define BVM_METRICS_GC_PAUSE_BUCKETS 11
+
+/**
+ * The runtime metrics that are counted as the VM runs.  The rest - the heap sizes, thread and clazz counts and the
+ * GC statistics - are read from where the VM already keeps them when a snapshot is served.
+ */
+typedef struct _bvmmetricsstruct {
+
+	/** Bytes allocated up to the start of the last GC.  Those allocated since are #bvm_gl_heap_allocated */
+	bvm_native_ulong_t allocated;
+
+	/** The number of GC pauses in each bucket of the pause histogram.  Not cumulative. */
+	bvm_uint32_t gc_pauses[BVM_METRICS_GC_PAUSE_BUCKETS];
+
+	/** The number of monitors bound to an object */
+	bvm_uint32_t monitors_in_use;
+
+	/** The number of monitors allocated - in use or cached for reuse */
+	bvm_uint32_t monitors;
+
+} bvm_metrics_t;
+
+extern BVM_VM_LOCAL bvm_metrics_t bvm_gl_metrics;
+extern BVM_VM_LOCAL bvm_int32_t bvm_gl_metrics_port;
+extern BVM_VM_LOCAL bvm_int32_t bvm_gl_metrics_socket;
+
+void bvm_metrics_open();
+void bvm_metrics_close();
+void bvm_metrics_interact();
+void bvm_metrics_gc_pause(bvm_uint32_t millis);
+
+#endif
+
+#endif /*BVM_METRICS_H_*/
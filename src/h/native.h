@@ -29,5 +29,19 @@
 
 */
 void bvm_init_native();
+void bvm_native_arraycopy(bvm_obj_t *src, bvm_int32_t srcPos, bvm_obj_t *dest, bvm_int32_t destPos, bvm_int32_t length);
+
+#if BVM_NATIVE_BOX_CACHE_ENABLE
+
+/** The lowest and highest \c Integer values, and the highest \c Character value, that have a cached box */
+#define BVM_NATIVE_BOX_INTEGER_MIN		(-128)
+#define BVM_NATIVE_BOX_INTEGER_MAX		127
+#define BVM_NATIVE_BOX_CHARACTER_MAX	127
+
+extern BVM_VM_LOCAL bvm_obj_t *bvm_gl_native_integer_boxes[];
+extern BVM_VM_LOCAL bvm_obj_t *bvm_gl_native_character_boxes[];
+
+void bvm_native_box_cache_init();
+#endif
 
 #endif /*BVM_NATIVE_H_*/
@@ -34,6 +34,12 @@
 
 #define NI_VERSION 0x00010000
 
+/** Release mode for #NI_ReleasePrimitiveArrayCritical - copy back the array contents and free the buffer */
+#define NI_COMMIT       1
+
+/** Release mode for #NI_ReleasePrimitiveArrayCritical - free the buffer without copying back its contents */
+#define NI_ABORT        2
+
 jint 	 NI_GetVersion();
 
 jclass 	 NI_FindClass(const char *name);
@@ -104,6 +110,37 @@ void 	 NI_SetStaticFloatField(jclass clazz, jfieldID fieldID, jfloat value);
 void 	 NI_SetStaticDoubleField(jclass clazz, jfieldID fieldID, jdouble value);
 #endif
 
+#if BVM_NI_CALLS_ENABLE
+jmethodID NI_GetMethodID(jclass clazz, const char *name, const char *sig);
+jmethodID NI_GetStaticMethodID(jclass clazz, const char *name, const char *sig);
+
+void      NI_CallVoidMethod(jobject obj, jmethodID methodID, ...);
+jobject   NI_CallObjectMethod(jobject obj, jmethodID methodID, ...);
+jboolean  NI_CallBooleanMethod(jobject obj, jmethodID methodID, ...);
+jbyte     NI_CallByteMethod(jobject obj, jmethodID methodID, ...);
+jchar     NI_CallCharMethod(jobject obj, jmethodID methodID, ...);
+jshort    NI_CallShortMethod(jobject obj, jmethodID methodID, ...);
+jint      NI_CallIntMethod(jobject obj, jmethodID methodID, ...);
+jlong     NI_CallLongMethod(jobject obj, jmethodID methodID, ...);
+#if BVM_FLOAT_ENABLE
+jfloat    NI_CallFloatMethod(jobject obj, jmethodID methodID, ...);
+jdouble   NI_CallDoubleMethod(jobject obj, jmethodID methodID, ...);
+#endif
+
+void      NI_CallStaticVoidMethod(jclass clazz, jmethodID methodID, ...);
+jobject   NI_CallStaticObjectMethod(jclass clazz, jmethodID methodID, ...);
+jboolean  NI_CallStaticBooleanMethod(jclass clazz, jmethodID methodID, ...);
+jbyte     NI_CallStaticByteMethod(jclass clazz, jmethodID methodID, ...);
+jchar     NI_CallStaticCharMethod(jclass clazz, jmethodID methodID, ...);
+jshort    NI_CallStaticShortMethod(jclass clazz, jmethodID methodID, ...);
+jint      NI_CallStaticIntMethod(jclass clazz, jmethodID methodID, ...);
+jlong     NI_CallStaticLongMethod(jclass clazz, jmethodID methodID, ...);
+#if BVM_FLOAT_ENABLE
+jfloat    NI_CallStaticFloatMethod(jclass clazz, jmethodID methodID, ...);
+jdouble   NI_CallStaticDoubleMethod(jclass clazz, jmethodID methodID, ...);
+#endif
+#endif
+
 jstring      NI_NewString(const jchar *unicode, jsize len);
 jsize 		 NI_GetStringLength(jstring str);
 const jchar *NI_GetStringChars(jstring str);
@@ -142,6 +179,38 @@ jfloat   *NI_GetFloatArrayElements(jfloatArray array);
 jdouble  *NI_GetDoubleArrayElements(jdoubleArray array);
 #endif
 
+void *NI_GetPrimitiveArrayCritical(jarray array, jboolean *isCopy);
+void  NI_ReleasePrimitiveArrayCritical(jarray array, void *carray, jint mode);
+
+#if BVM_GC_COMPACTION_ENABLE
+/** The number of primitive arrays currently held by #NI_GetPrimitiveArrayCritical - no compaction is done while set */
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_ni_critical_count;
+#endif
+
+#if BVM_NI_LOCAL_ARENA_ENABLE
+
+/**
+ * A block of the arena that #NI_MallocLocal memory is bumped from.  The memory follows the header.
+ */
+typedef struct _bvmniarenastruct {
+
+	/** The block allocated before this one, or \c NULL */
+	struct _bvmniarenastruct *prev;
+
+	/** Where the next allocation from this block starts */
+	bvm_uint8_t *top;
+
+	/** The end of this block */
+	bvm_uint8_t *end;
+} bvm_ni_arena_t;
+
+/** The newest block of the arena of the current native method call, or \c NULL if it has none */
+extern BVM_VM_LOCAL bvm_ni_arena_t *bvm_gl_ni_arena;
+
+void bvm_ni_arena_release(bvm_ni_arena_t *mark);
+
+#endif
+
 void *NI_MallocLocal(jint size);
 void *NI_MallocGlobal(jint size);
 void NI_Free(void *handle);
@@ -156,7 +225,7 @@ void NI_Free(void *handle);
 #define NI_GetParameterAsBoolean(x)  ((jboolean) ((bvm_cell_t*)args)[x].int_value)
 #if BVM_FLOAT_ENABLE
 #define NI_GetParameterAsFloat(x)    ((jfloat) 	 ((bvm_cell_t*)args)[x].float_value)
-#define NI_GetParameterAsDouble(x)    (__NI_GetParameterAsDouble(args))
+#define NI_GetParameterAsDouble(x)    (__NI_GetParameterAsDouble(((bvm_cell_t*)args)+(x)))
 jdouble __NI_GetParameterAsDouble(void *args);
 #endif
 #define NI_GetParameterAsLong(x)     ((jlong) (BVM_INT64_from_cells( ((bvm_cell_t*)args)+x)))
@@ -35,11 +35,20 @@ typedef struct _bvmstackbacktracestruct bvm_stack_backtrace_t;
 
 /**
  * Stuff that goes at the top of all object structs.  Holds a pointer to  the object's #bvm_clazz_t, and
- * its thread locking monitor, if it has one.
+ * its thread lock word (see #BVM_THIN_LOCK_ENABLE) unless that is kept in its chunk header (see
+ * #BVM_THIN_LOCK_HEADER_ENABLE).
  */
+#if BVM_THIN_LOCK_ENABLE && !BVM_THIN_LOCK_HEADER_ENABLE
+#define BVM_COMMON_OBJ_INFO										\
+	/* The clazz of the object */								\
+	bvm_clazz_t *clazz;											\
+	/* Thin lock owner and count, or inflated flag */			\
+	bvm_native_ulong_t lockword;
+#else
 #define BVM_COMMON_OBJ_INFO										\
 	/* The clazz of the object */								\
 	bvm_clazz_t *clazz;
+#endif
 
 
 /**
@@ -54,6 +63,45 @@ struct _bvmobjstruct {
     bvm_cell_t fields[1];
 } /* bvm_obj_t is forward defined */ ;
 
+/**
+ * The size in bytes of an object header - everything before its fields.
+ */
+#define BVM_OBJECT_HEADER_SIZE	(sizeof(bvm_obj_t) - sizeof(bvm_cell_t))
+
+/**
+ * The size in bytes of an instance of the given #bvm_instance_clazz_t.
+ */
+#define BVM_OBJECT_SIZE(clazz)	(BVM_OBJECT_HEADER_SIZE + ((clazz)->instance_fields_count * sizeof(bvm_cell_t)))
+
+#if BVM_FIELD_PACKING_ENABLE
+/**
+ * The address of the packed field \c field within the object \c obj.
+ */
+#define BVM_OBJECT_PACKED_FIELD(obj, field) ( ((bvm_uint8_t *) (obj)->fields) + (field)->value.offset )
+#endif
+
+#if BVM_THIN_LOCK_HEADER_ENABLE
+
+/** The number of bits in the thin lock word of an object */
+#define BVM_OBJECT_LOCKWORD_BITS	(sizeof(bvm_chunk_header_t) * 8 - BVM_CHUNK_LOCKWORD_SHIFT)
+
+/** Get the thin lock word of an object from its chunk header */
+#define BVM_OBJECT_GetLockword(o)	( (bvm_native_ulong_t) (BVM_CHUNK_GetPointerChunk(o)->header >> BVM_CHUNK_LOCKWORD_SHIFT) )
+
+/** Set the thin lock word of an object in its chunk header */
+#define BVM_OBJECT_SetLockword(o, w) {																		\
+	bvm_chunk_t *_lwc = BVM_CHUNK_GetPointerChunk(o);														\
+	_lwc->header = (_lwc->header & ~BVM_CHUNK_LOCKWORD_MASK) | ((bvm_chunk_header_t) (w) << BVM_CHUNK_LOCKWORD_SHIFT);	\
+}
+
+#elif BVM_THIN_LOCK_ENABLE
+
+#define BVM_OBJECT_LOCKWORD_BITS	(sizeof(bvm_native_ulong_t) * 8)
+#define BVM_OBJECT_GetLockword(o)	((o)->lockword)
+#define BVM_OBJECT_SetLockword(o, w) { (o)->lockword = (w); }
+
+#endif
+
 
 /**
  * A Java Weakreference object.
@@ -69,6 +117,58 @@ typedef struct _bvmweakrefstruct {
 
 } bvm_weak_reference_obj_t ;
 
+/**
+ * A Java SoftReference object.  The first fields must be the same as #bvm_weak_reference_obj_t - a soft reference
+ * being cleared is treated by the GC as a weak one.
+ */
+typedef struct _bvmsoftrefstruct {
+	BVM_COMMON_OBJ_INFO
+
+	/** The Java object the softreference if referring to */
+	bvm_obj_t *referent;
+
+	/** Used for GC - the next reference in a list created during GC */
+	struct _bvmweakrefstruct *next;
+
+	/** The value of #bvm_gl_gc_soft_clock when the reference was made or last got - maps to java field \c timestamp */
+	bvm_cell_t timestamp;
+
+} bvm_soft_reference_obj_t ;
+
+/**
+ * A Java Ephemeron object - a reference that also holds a value.  The value is kept only for as long as the key
+ * (the referent) is reachable other than through the ephemeron, and both are cleared together.  The first fields must
+ * be the same as #bvm_weak_reference_obj_t.
+ */
+typedef struct _bvmephemeronstruct {
+	BVM_COMMON_OBJ_INFO
+
+	/** The key object of the ephemeron */
+	bvm_obj_t *referent;
+
+	/** Used for GC - the next ephemeron in a list created during GC */
+	struct _bvmweakrefstruct *next;
+
+	/** The object held for as long as the key is reachable - maps to java field \c value */
+	bvm_obj_t *value;
+
+} bvm_ephemeron_obj_t ;
+
+
+/**
+ * A reference held in an element of a reference array.  With #BVM_COMPRESSED_REFS_ENABLE it is the 32 bit address
+ * of the object (all heap memory being below 4gb), otherwise just a pointer.  #BVM_REF_Decode gives the object of a
+ * reference and #BVM_REF_Encode the reference of an object (or \c NULL).
+ */
+#if BVM_COMPRESSED_REFS_ENABLE
+typedef bvm_uint32_t bvm_ref_t;
+#define BVM_REF_Decode(r)	((bvm_obj_t *) (bvm_native_ulong_t) (r))
+#define BVM_REF_Encode(p)	((bvm_ref_t) (bvm_native_ulong_t) (p))
+#else
+typedef bvm_obj_t *bvm_ref_t;
+#define BVM_REF_Decode(r)	(r)
+#define BVM_REF_Encode(p)	(p)
+#endif
 
 /**
  * A structure to hold information about array class types.
@@ -87,18 +187,28 @@ typedef struct _bvmstructtypearrayinfo {
  * like \c BVM_T_OBJECT = 1, \c BVM_T_ARRAY = 2 etc.  There is no zero-th element.  Index 1 is \c BVM_T_OBJECT,
  * index 11 is \c BVM_T_LONG.
  */
-bvm_array_typeinfo_t bvm_gl_type_array_info[12];		/* 12 represents 0 .. BVM_T_LONG */
+extern BVM_VM_LOCAL bvm_array_typeinfo_t bvm_gl_type_array_info[12];		/* 12 represents 0 .. BVM_T_LONG */
 
 /**
  * Common fields used across java array object structs.
  */
+#if BVM_THIN_LOCK_ENABLE && !BVM_THIN_LOCK_HEADER_ENABLE
 #define BVM_COMMON_ARRAY_OBJ_INFO									\
 	/* first fields here must match BVM_COMMON_OBJ_INFO */			\
 	/** The class of the array */								    \
 	bvm_array_clazz_t *clazz;										\
+	/** Thin lock owner and count, or inflated flag */				\
+	bvm_native_ulong_t lockword;									\
 	/** The length of the array*/								    \
 	bvm_cell_t length;
-
+#else
+#define BVM_COMMON_ARRAY_OBJ_INFO									\
+	/* first fields here must match BVM_COMMON_OBJ_INFO */			\
+	/** The class of the array */								    \
+	bvm_array_clazz_t *clazz;										\
+	/** The length of the array*/								    \
+	bvm_cell_t length;
+#endif
 
 /**
  * A Java array object.
@@ -179,11 +289,14 @@ typedef struct _bvmjbytearraystruct {
  */
 typedef struct _bvminstancearraystruct {
 	BVM_COMMON_ARRAY_OBJ_INFO
-    bvm_obj_t *data[1];
+    bvm_ref_t data[1];
 } bvm_instance_array_obj_t;
 
 /**
- * A \c java.lang.String object.
+ * A \c java.lang.String object.  The fields are those of the \c String class of the class library, whose
+ * non-native methods read \c _chars as a \c char[] - so a String is always backed by 16 bit chars, even when all
+ * of them are Latin-1.  A more compact String needs a class library String with a byte array and a coder, and the
+ * natives here changed to match.
  */
 typedef struct _bvmstringinstancestruct {
 	BVM_COMMON_OBJ_INFO
@@ -208,6 +321,30 @@ typedef struct _bvmstringbufferinstancestruct {
     bvm_cell_t is_shared;
 } bvm_stringbuffer_obj_t;
 
+/**
+ * A \c babe.util.IntHashMap or \c babe.util.LongHashMap object - see #BVM_NATIVE_COLLECTIONS_ENABLE.
+ */
+typedef struct _bvmprimitivemapobjstruct {
+	BVM_COMMON_OBJ_INFO
+	/** maps to java field \c _keys[] - an \c int[] or \c long[] */
+	bvm_jarray_obj_t *keys;
+	/** maps to java field \c _values[] - a \c NULL value is an empty slot */
+	bvm_instance_array_obj_t *values;
+	/** maps to java field \c _size */
+	bvm_cell_t size;
+} bvm_primitivemap_obj_t;
+
+/**
+ * A \c babe.util.IntArray or \c babe.util.LongArray object - see #BVM_NATIVE_COLLECTIONS_ENABLE.
+ */
+typedef struct _bvmprimitivearrayobjstruct {
+	BVM_COMMON_OBJ_INFO
+	/** maps to java field \c _data[] - an \c int[] or \c long[] */
+	bvm_jarray_obj_t *data;
+	/** maps to java field \c _size */
+	bvm_cell_t size;
+} bvm_primitivearray_obj_t;
+
 /**
  * Substruct of #bvm_string_obj_t that holds the info
  * required to have an string interned and maintained in a pool
@@ -229,6 +366,9 @@ typedef struct _bvminternstringinstancestruct {
 
     /** pointer to the next interned #bvm_internstring_obj_t in the same pool hash bucket */
     struct _bvminternstringinstancestruct *next;
+
+    /** the Java \c String.hashCode() of the chars - the intern string pool is hashed by it */
+    bvm_uint32_t hash;
 } bvm_internstring_obj_t;
 
 /**
@@ -292,7 +432,11 @@ struct _bvmclassinstancestruct {
  */
 typedef struct _bvmclassinstancearraystruct {
 	BVM_COMMON_ARRAY_OBJ_INFO
+#if BVM_COMPRESSED_REFS_ENABLE
+    bvm_ref_t data[1];
+#else
     bvm_class_obj_t *data[1];
+#endif
 } bvm_class_instance_array_obj_t;
 
 
@@ -349,43 +493,70 @@ struct _bvmclassloaderstruct {
 } /* bvm_classloader_obj_t is forward defined */;
 
 /** Handle to clazz java/lang/Object for quick access */
-bvm_instance_clazz_t *BVM_OBJECT_CLAZZ;
+extern BVM_VM_LOCAL bvm_instance_clazz_t *BVM_OBJECT_CLAZZ;
 
 /** Handle to clazz java/lang/Class for quick access */
-bvm_instance_clazz_t *BVM_CLASS_CLAZZ;
+extern BVM_VM_LOCAL bvm_instance_clazz_t *BVM_CLASS_CLAZZ;
 
 /** Handle to clazz Thread for quick access */
-bvm_instance_clazz_t *BVM_THREAD_CLAZZ;
+extern BVM_VM_LOCAL bvm_instance_clazz_t *BVM_THREAD_CLAZZ;
 
 /** Handle to clazz java/lang/ClassLoader for quick access */
-bvm_instance_clazz_t *BVM_CLASSLOADER_CLAZZ;
+extern BVM_VM_LOCAL bvm_instance_clazz_t *BVM_CLASSLOADER_CLAZZ;
 
 /** Handle to clazz java/lang/String for quick access */
-bvm_instance_clazz_t *BVM_STRING_CLAZZ;
+extern BVM_VM_LOCAL bvm_instance_clazz_t *BVM_STRING_CLAZZ;
 
 /** Handle to clazz java/lang/System for quick access */
-bvm_instance_clazz_t *BVM_SYSTEM_CLAZZ;
+extern BVM_VM_LOCAL bvm_instance_clazz_t *BVM_SYSTEM_CLAZZ;
 
 /** Handle to clazz java/lang/Throwable for quick access */
-bvm_instance_clazz_t *BVM_THROWABLE_CLAZZ;
+extern BVM_VM_LOCAL bvm_instance_clazz_t *BVM_THROWABLE_CLAZZ;
 
 /** Handle to the bootstrap classloader for quick access.  Will always be \c NULL but is defined to
  * explicitly show usage. */
-bvm_classloader_obj_t *BVM_BOOTSTRAP_CLASSLOADER_OBJ;
+extern BVM_VM_LOCAL bvm_classloader_obj_t *BVM_BOOTSTRAP_CLASSLOADER_OBJ;
 
 /** The bootstrap classpath as a Java array of String objects */
-bvm_instance_array_obj_t *BVM_BOOTSTRAP_CLASSPATH_ARRAY;
+extern BVM_VM_LOCAL bvm_instance_array_obj_t *BVM_BOOTSTRAP_CLASSPATH_ARRAY;
 
 /** Handle to the system classloader object for quick access */
-bvm_classloader_obj_t *BVM_SYSTEM_CLASSLOADER_OBJ;
+extern BVM_VM_LOCAL bvm_classloader_obj_t *BVM_SYSTEM_CLASSLOADER_OBJ;
 
 /** Pre-built \c lava.lang.OutOfMemoryError object */
-extern bvm_throwable_obj_t *bvm_gl_out_of_memory_err_obj;
+extern BVM_VM_LOCAL bvm_throwable_obj_t *bvm_gl_out_of_memory_err_obj;
 
 bvm_obj_t *bvm_object_alloc(bvm_instance_clazz_t *clazz);
 bvm_jarray_obj_t *bvm_object_alloc_array_primitive(bvm_uint32_t length, bvm_jtype_t type);
 bvm_instance_array_obj_t *bvm_object_alloc_array_reference(bvm_uint32_t length, bvm_clazz_t *component_clazz);
+bvm_uint32_t bvm_object_primitive_array_size(bvm_uint32_t length, bvm_jtype_t type);
+bvm_array_clazz_t *bvm_object_array_clazz(bvm_clazz_t *component_clazz);
 bvm_instance_array_obj_t *bvm_object_alloc_array_multi(bvm_array_clazz_t *clazz, int dimensions, bvm_native_long_t lengths[]);
+bvm_obj_t *bvm_object_clone(bvm_obj_t *obj);
+#if BVM_FIELD_PACKING_ENABLE
+void bvm_object_get_packed_field(bvm_obj_t *obj, bvm_field_t *field, bvm_cell_t *cells);
+void bvm_object_put_packed_field(bvm_obj_t *obj, bvm_field_t *field, bvm_cell_t *cells);
+#endif
 bvm_uint32_t bvm_calchash(bvm_uint8_t *key, bvm_uint16_t len);
 
+#if BVM_OBJECT_IDENTITY_HASH_ENABLE
+bvm_uint32_t bvm_object_identity_hash(bvm_obj_t *obj);
+
+#if BVM_GC_COMPACTION_ENABLE
+
+/** The number of arrays that have been given an identity hash and are kept in a side table */
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_object_hash_count;
+
+void bvm_object_hash_freed(void *ptr);
+void bvm_object_hash_forward(bvm_obj_t *(*forward)(bvm_obj_t *));
+void bvm_object_hash_release();
+
+/** Forget the identity hash of the array at \c p (if it has one) as its memory is freed */
+#define BVM_OBJECT_HASH_FREED(p) {																\
+	if (bvm_gl_object_hash_count > 0) bvm_object_hash_freed(p);									\
+}
+
+#endif
+#endif
+
 #endif /*BVM_OBJECT_H_*/
@@ -31,4 +31,9 @@
 
 int bvm_pd_console_out(const char* msg, ...);
 
+#if BVM_CONSOLE_BUFFER_ENABLE
+void bvm_pd_console_write(const char *data, size_t length);
+void bvm_pd_console_flush();
+#endif
+
 #endif /*BVM_PD_CONSOLE_H_*/
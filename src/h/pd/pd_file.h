@@ -196,4 +196,25 @@ int bvm_pd_file_truncate(void *handle, size_t size);
  */
 int bvm_pd_file_exists(const char *filename);
 
+#if BVM_FILE_MAP_ENABLE
+
+/**
+ * Map the first \c size bytes of an open file into memory for reading.  The mapping must stay valid until it is
+ * unmapped, even if the file is closed.  It is only read, never written.
+ *
+ * Platforms that cannot map files return \c NULL - the VM then reads the file instead.
+ *
+ * @return the address of the mapping, or \c NULL if the file could not be mapped.
+ */
+void *bvm_pd_file_map(void *handle, size_t size);
+
+/**
+ * Unmap a mapping made by #bvm_pd_file_map.
+ *
+ * @return #BVM_ERR if an error occurred
+ */
+int bvm_pd_file_unmap(void *address, size_t size);
+
+#endif
+
 #endif /*BVM_PD_FILE_H_*/
@@ -45,4 +45,47 @@ void *bvm_pd_memory_alloc(size_t size);
  */
 void bvm_pd_memory_free(void *mem);
 
+#if BVM_COMPRESSED_REFS_ENABLE
+
+/**
+ * Allocate memory from the platform for a heap region.  All of the memory must lie below 4gb, so that the address
+ * of an object in it can be held as a 32 bit compressed reference (see #BVM_COMPRESSED_REFS_ENABLE).  Provided by
+ * the host platform rather than ANSI C.
+ *
+ * @param size the size, in bytes, of the memory to allocate.
+ * @return a void* to the allocated memory or \c NULL if the platform was unable to allocate it below 4gb.
+ */
+void *bvm_pd_memory_heap_alloc(size_t size);
+
+/**
+ * Return memory allocated with #bvm_pd_memory_heap_alloc() back to the underlying platform.
+ *
+ * @param mem a handle to memory provided by #bvm_pd_memory_heap_alloc().
+ * @param size the size, in bytes, it was allocated with.
+ */
+void bvm_pd_memory_heap_free(void *mem, size_t size);
+
+#endif
+
+#if BVM_JIT_ENABLE
+
+/**
+ * Allocate memory from the platform that machine code may be both written to and run from.  Used for the JIT code
+ * cache.  Provided by the host platform rather than ANSI C.
+ *
+ * @param size the size, in bytes, of the memory to allocate.
+ * @return a void* to the allocated memory or \c NULL if the platform was unable to allocate it.
+ */
+void *bvm_pd_memory_exec_alloc(size_t size);
+
+/**
+ * Return memory allocated with #bvm_pd_memory_exec_alloc() back to the underlying platform.
+ *
+ * @param mem a handle to memory provided by #bvm_pd_memory_exec_alloc().
+ * @param size the size, in bytes, it was allocated with.
+ */
+void bvm_pd_memory_exec_free(void *mem, size_t size);
+
+#endif
+
 #endif /*BVM_PD_MEMORY_H_*/
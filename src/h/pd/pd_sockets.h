@@ -36,6 +36,32 @@
 #define BVM_SOCKET_ERROR -1
 #define BVM_SOCKET_CONNECT_ERROR -2
 
+/** Returned by #bvm_pd_socket_recv and #bvm_pd_socket_write for a non-blocking socket that has nothing waiting to be
+ * read, or no room for anything to be written */
+#define BVM_SOCKET_WOULD_BLOCK -3
+
+/** Readiness for a socket read (or for a server socket accept) */
+#define BVM_SOCKET_POLL_READ 1
+
+/** Readiness for a socket write */
+#define BVM_SOCKET_POLL_WRITE 2
+
+/**
+ * A socket and the readiness to test it for with #bvm_pd_socket_poll.
+ */
+typedef struct _bvmsocketpollstruct {
+
+	/** The socket to test */
+	bvm_int32_t fd;
+
+	/** The readiness sought - a combination of #BVM_SOCKET_POLL_READ and #BVM_SOCKET_POLL_WRITE */
+	bvm_uint8_t events;
+
+	/** Set by #bvm_pd_socket_poll to the readiness found, zero if none */
+	bvm_uint8_t ready;
+
+} bvm_pd_socket_poll_t;
+
 /**
  * Returns the IP address of a given host name.
  *
@@ -69,6 +95,20 @@ bvm_int32_t bvm_pd_socket_open(const char *hostname, bvm_int32_t  port);
  */
 bvm_int32_t bvm_pd_socket_read(bvm_int32_t fd, char *buf, bvm_int32_t len);
 
+/**
+ * Reads whatever bytes are waiting on a socket, up to a given number.  Blocks only if no bytes at all
+ * are waiting, so after #bvm_pd_socket_poll has reported a socket ready for reading this does not block.  A
+ * non-blocking socket (see #bvm_pd_socket_set_nonblocking) never blocks.
+ *
+ * @param fd the socket to read from.
+ * @param buf the address to read data into.
+ * @param len the most bytes to read.
+ *
+ * @return the number of bytes read, 0 (zero) if the connection has been gracefully closed,
+ * #BVM_SOCKET_WOULD_BLOCK if the socket is non-blocking and nothing is waiting, or #BVM_SOCKET_ERROR on error.
+ */
+bvm_int32_t bvm_pd_socket_recv(bvm_int32_t fd, char *buf, bvm_int32_t len);
+
 /**
  * Reports if data is waiting to be read on the socket.  The socket interrogation will timeout
  * after \c timeout milliseconds.  To never timeout, specify a timeout
@@ -82,18 +122,42 @@ bvm_int32_t bvm_pd_socket_read(bvm_int32_t fd, char *buf, bvm_int32_t len);
  */
 bvm_int32_t bvm_pd_socket_available(bvm_int32_t fd, bvm_int32_t timeout);
 
+/**
+ * Tests a number of sockets at once for readiness.  Each socket's \c ready member is set to
+ * the readiness found for it.  Waits at most \c timeout milliseconds for any socket to become ready.  A timeout
+ * of 0 (zero) does not wait at all, and a negative timeout waits until one is ready.
+ *
+ * @param polls the sockets to test.
+ * @param count the number of sockets in \c polls.
+ * @param timeout the time, in milliseconds, to wait for readiness.
+ *
+ * @return the number of ready sockets, or #BVM_SOCKET_ERROR for any error.
+ */
+bvm_int32_t bvm_pd_socket_poll(bvm_pd_socket_poll_t *polls, bvm_uint32_t count, bvm_int32_t timeout);
+
 /**
  * Perform a blocking write of data to a socket.  Function does not return until all data has been
- * written to the socket.
+ * written to the socket.  A non-blocking socket (see #bvm_pd_socket_set_nonblocking) writes only what there is
+ * room for.
  *
  * @param fd the socket to write to
  * @param buf the source address to write data from
  * @param len the number of byte to write
  *
- * @return 0 (zero), or #BVM_SOCKET_ERROR for any error.
+ * @return the number of bytes written (less than \c len only for a non-blocking socket), #BVM_SOCKET_WOULD_BLOCK if
+ * the socket is non-blocking and there is no room to write anything, or #BVM_SOCKET_ERROR for any error.
  */
 bvm_int32_t bvm_pd_socket_write(bvm_int32_t fd, const char *src, bvm_int32_t len);
 
+/**
+ * Make a socket non-blocking, so that #bvm_pd_socket_recv and #bvm_pd_socket_write return
+ * #BVM_SOCKET_WOULD_BLOCK rather than wait.  Sockets are blocking when opened or accepted.
+ *
+ * @param fd the socket.
+ * @return 0 (zero) on success, or #BVM_SOCKET_ERROR for any error.
+ */
+bvm_int32_t bvm_pd_socket_set_nonblocking(bvm_int32_t fd);
+
 /**
  * Close a socket.
  *
@@ -39,4 +39,115 @@ void bvm_pd_system_exit(int code);
  */
 bvm_int64_t bvm_pd_system_time();
 
+/**
+ * Suspend the VM in the OS for (about) the given number of milliseconds.  Called by the VM when no thread is
+ * runnable and all are waiting for a timeout.  A platform may return early.
+ */
+void bvm_pd_system_sleep(bvm_uint32_t millis);
+
+#if BVM_PROFILER_PERF_ENABLE
+
+/**
+ * Returns the id of the OS process the VM is running in.
+ */
+bvm_uint32_t bvm_pd_system_process_id();
+
+#endif
+
+#if (BVM_PROFILER_STARTUP_TRACE_ENABLE || BVM_PROFILER_MONITOR_CONTENTION_ENABLE || BVM_VM_SLICE_ENABLE || \
+	 BVM_THREAD_ACCOUNTING_ENABLE)
+
+/**
+ * Returns a count of microseconds from an arbitrary start that only ever moves forward - for timing short intervals.
+ * It may wrap, so only differences between readings taken no more than an hour or so apart mean anything.
+ */
+bvm_uint32_t bvm_pd_system_time_micros();
+
+#endif
+
+#if BVM_THREAD_TIMER_PREEMPTION_ENABLE
+
+/**
+ * Start a periodic timer that calls \c tick every \c millis milliseconds while the VM is executing.  \c tick may
+ * be called asynchronously (from a signal handler or another OS thread) at any point, so all it may do is set a flag.
+ */
+void bvm_pd_system_timer_start(bvm_uint32_t millis, void (*tick)(void));
+
+/**
+ * Stop the timer started by #bvm_pd_system_timer_start.
+ */
+void bvm_pd_system_timer_stop();
+
+#endif
+
+#if BVM_EXEC_IMPLICIT_NULL_CHECKS_ENABLE
+
+/**
+ * Have a memory fault on the first page of memory (a null dereference) call \c trap.  \c trap does not return if
+ * the fault was one the VM expected - it throws a \c NullPointerException.  If it does return the fault is a real
+ * crash, and the platform should let it take its default course.
+ *
+ * @return #BVM_TRUE if the fault handler was installed, #BVM_FALSE otherwise.
+ */
+bvm_bool_t bvm_pd_system_null_trap_start(void (*trap)(void));
+
+/**
+ * Remove the fault handler installed by #bvm_pd_system_null_trap_start.
+ */
+void bvm_pd_system_null_trap_stop();
+
+#endif
+
+#if (BVM_VM_ISOLATES_ENABLE || BVM_CLAZZ_PREFETCH_ENABLE || BVM_GC_PARALLEL_MARK_ENABLE || BVM_GC_CONCURRENT_SWEEP_ENABLE || \
+		BVM_FILE_ASYNC_ENABLE)
+
+/**
+ * Start an OS thread that calls \c run with \c data and then ends.
+ *
+ * @return an opaque handle to the thread for #bvm_pd_system_thread_join, or \c NULL if a thread could not be started.
+ */
+void *bvm_pd_system_thread_start(void (*run)(void *), void *data);
+
+/**
+ * Wait for an OS thread started by #bvm_pd_system_thread_start to end, and release it.
+ */
+void bvm_pd_system_thread_join(void *thread);
+
+#endif
+
+#if (BVM_CLAZZ_PREFETCH_ENABLE || BVM_GC_PARALLEL_MARK_ENABLE || BVM_GC_CONCURRENT_SWEEP_ENABLE || BVM_FILE_ASYNC_ENABLE)
+
+/**
+ * Create a lock that OS threads may hold one at a time.
+ *
+ * @return an opaque handle to the lock, or \c NULL if a lock could not be created.
+ */
+void *bvm_pd_system_lock_create();
+
+/**
+ * Take a lock created by #bvm_pd_system_lock_create, waiting for another OS thread to let go of it.
+ */
+void bvm_pd_system_lock(void *lock);
+
+/**
+ * Let go of a lock taken by #bvm_pd_system_lock.
+ */
+void bvm_pd_system_unlock(void *lock);
+
+/**
+ * Release a lock created by #bvm_pd_system_lock_create.  It must not be held.
+ */
+void bvm_pd_system_lock_destroy(void *lock);
+
+#if (BVM_GC_PARALLEL_MARK_ENABLE || BVM_GC_CONCURRENT_SWEEP_ENABLE)
+
+/**
+ * Let other OS threads run before the calling one carries on - called by a thread that is waiting on another.
+ */
+void bvm_pd_system_thread_yield();
+
+#endif
+
+#endif
+
 #endif /*BVM_PD_SYSTEM_H_*/
@@ -29,8 +29,11 @@
 
 */
 
-extern bvm_clazz_t **bvm_gl_clazz_pool;
-extern int bvm_gl_clazz_pool_bucketcount;
+extern BVM_VM_LOCAL bvm_clazz_t **bvm_gl_clazz_pool;
+extern BVM_VM_LOCAL int bvm_gl_clazz_pool_bucketcount;
+#if BVM_POOL_RESIZE_ENABLE
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_clazz_pool_count;
+#endif
 
 bvm_clazz_t *bvm_clazz_pool_get(bvm_classloader_obj_t *loader, bvm_utfstring_t *clazzname);
 bvm_clazz_t *bvm_get_clazz_pool_c(bvm_classloader_obj_t *loader, char *clazzname);
@@ -30,10 +30,14 @@
 */
 
 /* a pool of utfstrings.  An array of bvm_utfstring_t pointers */
-extern bvm_internstring_obj_t **bvm_gl_internstring_pool;
-extern int bvm_gl_internstring_pool_bucketcount;
+extern BVM_VM_LOCAL bvm_internstring_obj_t **bvm_gl_internstring_pool;
+extern BVM_VM_LOCAL int bvm_gl_internstring_pool_bucketcount;
+#if BVM_POOL_RESIZE_ENABLE
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_internstring_pool_count;
+#endif
 
 bvm_internstring_obj_t *bvm_internstring_pool_get(bvm_utfstring_t *str, bvm_bool_t add_if_missing);
+bvm_internstring_obj_t *bvm_internstring_pool_get_chars(const bvm_uint16_t *chars, bvm_int32_t len, bvm_uint32_t hash);
 bvm_internstring_obj_t *bvm_internstring_pool_add(bvm_utfstring_t *str);
 
 #endif /*BVM_INTERNSTRING_POOL_H_*/
@@ -46,6 +46,25 @@ typedef struct _bvmnativemethoddescstruct {
 	/** The native method function pointer */
 	bvm_native_method_t method;
 
+	/** Whether the native method is a 'leaf' native - one that never throws, allocates, blocks, or inspects its
+	 * own stack frame and so can be called without a frame being pushed for it. */
+	bvm_bool_t is_leaf;
+
+#if BVM_NATIVE_REPLACEMENT_ENABLE
+	/** Whether the native method replaces a method that has bytecode in its class - see
+	 * #bvm_native_method_pool_register_replacement. */
+	bvm_bool_t is_replacement;
+#endif
+
+#if BVM_AOT_ENABLE
+	/** For a method translated to C ahead of time, its translation, otherwise \c NULL - see
+	 * #bvm_native_method_pool_register_aot. */
+	bvm_aot_method_t aot_method;
+
+	/** the hash of the bytecode \c aot_method was translated from */
+	bvm_uint32_t aot_hash;
+#endif
+
 	/** pointer to the next native method descriptor in the same hash bucket as this one */
 	struct _bvmnativemethoddescstruct *next;
 
@@ -53,10 +72,20 @@ typedef struct _bvmnativemethoddescstruct {
 
 
 /* a pool of utfstrings.  An array of bvm_utfstring_t pointers */
-extern bvm_native_method_desc_t **bvm_gl_native_method_pool;
-extern int bvm_gl_native_method_pool_bucketcount;
+extern BVM_VM_LOCAL bvm_native_method_desc_t **bvm_gl_native_method_pool;
+extern BVM_VM_LOCAL int bvm_gl_native_method_pool_bucketcount;
+#if BVM_POOL_RESIZE_ENABLE
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_native_method_pool_count;
+#endif
 
 bvm_native_method_desc_t *bvm_native_method_pool_get(bvm_utfstring_t *classname, bvm_utfstring_t *name, bvm_utfstring_t *desc);
 void bvm_native_method_pool_register(char *clazzname, char *methodname, char *methoddesc, bvm_native_method_t method);
+void bvm_native_method_pool_register_leaf(char *clazzname, char *methodname, char *methoddesc, bvm_native_method_t method);
+#if BVM_NATIVE_REPLACEMENT_ENABLE
+void bvm_native_method_pool_register_replacement(char *clazzname, char *methodname, char *methoddesc, bvm_native_method_t method);
+#endif
+#if BVM_AOT_ENABLE
+void bvm_native_method_pool_register_aot(char *clazzname, char *methodname, char *methoddesc, bvm_aot_method_t method, bvm_uint32_t hash);
+#endif
 
 #endif /*BVM_NATIVEMETHOD_POOL_H_*/
@@ -30,8 +30,11 @@
 */
 
 /* a pool of utfstrings.  An array of bvm_utfstring_t pointers */
-extern bvm_utfstring_t **bvm_gl_utfstring_pool;
-extern int bvm_gl_utfstring_pool_bucketcount;
+extern BVM_VM_LOCAL bvm_utfstring_t **bvm_gl_utfstring_pool;
+extern BVM_VM_LOCAL int bvm_gl_utfstring_pool_bucketcount;
+#if BVM_POOL_RESIZE_ENABLE
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_utfstring_pool_count;
+#endif
 
 bvm_utfstring_t *bvm_utfstring_pool_get(bvm_utfstring_t *str, bvm_bool_t add_if_missing);
 bvm_utfstring_t *bvm_utfstring_pool_get_c(const char *str, bvm_bool_t add_if_missing);
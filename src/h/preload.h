@@ -0,0 +1,45 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#ifndef BVM_PRELOAD_H_
+#define BVM_PRELOAD_H_
+
+/**
+  @file
+
+  Constants/Macros/Functions/Types for class preloading.
+
+  @author Greg McCreath
+  @since 0.0.10
+
+*/
+
+#if BVM_CLAZZ_PRELOAD_ENABLE
+
+extern BVM_VM_LOCAL char *bvm_gl_preload_filename;
+extern BVM_VM_LOCAL char *bvm_gl_preload_write_filename;
+
+bvm_bool_t bvm_preload_load(const char *filename);
+bvm_filebuffer_t *bvm_preload_buffer_file(char *jarname, char *pathname);
+void bvm_preload_record(char *jarname, char *pathname);
+bvm_bool_t bvm_preload_write(const char *filename);
+void bvm_preload_release();
+
+#endif
+
+#endif /*BVM_PRELOAD_H_*/
@@ -0,0 +1,254 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#ifndef BVM_PROFILER_H_
+#define BVM_PROFILER_H_
+
+/**
+  @file
+
+  Constants/Macros/Functions/Types for the sampling profiler, the per-method counters, the opcode histogram, the
+  allocation sites, the monitor contention sites, the startup trace and the native profiler integration.
+
+  @author Greg McCreath
+  @since 0.0.10
+
+*/
+
+#if BVM_PROFILER_ENABLE
+
+extern BVM_VM_LOCAL bvm_bool_t bvm_gl_profiler_enabled;
+extern BVM_VM_LOCAL char *bvm_gl_profiler_filename;
+
+void bvm_profiler_start();
+void bvm_profiler_stop();
+void bvm_profiler_reset();
+void bvm_profiler_release();
+void bvm_profiler_tick();
+bvm_bool_t bvm_profiler_dump_to_file(const char *filename);
+
+#endif
+
+#if BVM_PROFILER_METHOD_COUNTERS_ENABLE
+
+extern BVM_VM_LOCAL char *bvm_gl_profiler_method_counts_filename;
+
+void bvm_profiler_method_time();
+void bvm_profiler_method_counts_reset();
+bvm_bool_t bvm_profiler_method_counts_dump_to_file(const char *filename);
+
+/** Count an invocation of method \c m */
+#define BVM_PROFILER_COUNT_INVOCATION(m) ((m)->counter_invocations++)
+
+/** Count a bytecode dispatched in method \c m */
+#define BVM_PROFILER_COUNT_BYTECODE(m) ((m)->counter_bytecodes++)
+
+/** Count an allocation against the current method - there is none while the VM boots */
+#define BVM_PROFILER_COUNT_ALLOCATION() ( (bvm_gl_rx_method != NULL) ? (void) bvm_gl_rx_method->counter_allocations++ : (void) 0 )
+
+/** Charge the time since the last method switch to the current method */
+#define BVM_PROFILER_COUNT_TIME() bvm_profiler_method_time()
+
+#else
+#define BVM_PROFILER_COUNT_INVOCATION(m) ((void) 0)
+#define BVM_PROFILER_COUNT_BYTECODE(m) ((void) 0)
+#define BVM_PROFILER_COUNT_ALLOCATION() ((void) 0)
+#define BVM_PROFILER_COUNT_TIME() ((void) 0)
+#endif
+
+#if BVM_PROFILER_OPCODE_HISTOGRAM_ENABLE
+
+extern BVM_VM_LOCAL char *bvm_gl_profiler_opcodes_filename;
+extern BVM_VM_LOCAL bvm_native_ulong_t bvm_gl_profiler_opcode_counts[256];
+extern BVM_VM_LOCAL bvm_native_ulong_t bvm_gl_profiler_opcode_pair_counts[256 * 256];
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_profiler_opcode_previous;
+
+bvm_bool_t bvm_profiler_opcodes_dump_to_file(const char *filename);
+
+/** Count the dispatch of opcode \c op, and of it following the opcode dispatched before it */
+#define BVM_PROFILER_COUNT_OPCODE(op) {																\
+	bvm_uint32_t profiler_op = (op);																	\
+	bvm_gl_profiler_opcode_counts[profiler_op]++;														\
+	bvm_gl_profiler_opcode_pair_counts[(bvm_gl_profiler_opcode_previous << 8) | profiler_op]++;			\
+	bvm_gl_profiler_opcode_previous = profiler_op;														\
+}
+
+#else
+#define BVM_PROFILER_COUNT_OPCODE(op) {}
+#endif
+
+#if BVM_PROFILER_ALLOCATION_SITES_ENABLE
+
+extern BVM_VM_LOCAL char *bvm_gl_profiler_allocsites_filename;
+extern BVM_VM_LOCAL bvm_int32_t bvm_gl_profiler_allocation_countdown;
+
+void bvm_profiler_allocation_sample(void *ptr, size_t size, int alloc_type);
+bvm_bool_t bvm_profiler_allocsites_dump_to_file(const char *filename);
+void bvm_profiler_allocsites_release();
+
+/** Count \c s bytes allocated at \c p as alloc type \c t, taking a sample if it is time to */
+#define BVM_PROFILER_SAMPLE_ALLOCATION(p, s, t) {												\
+	if ( (bvm_gl_profiler_allocation_countdown -= (bvm_int32_t) (s)) <= 0)						\
+		bvm_profiler_allocation_sample((p), (s), (t));											\
+}
+
+#if BVM_HEAP_DUMP_ENABLE
+
+/** A call back for #bvm_profiler_allocsites_visit given the serial number and name of a site, and the line of its pc
+ * (\c -1 if not known, \c -3 for a native method) */
+typedef void (*bvm_profiler_site_callback_t)(bvm_uint32_t serial, const char *text, bvm_int32_t line);
+
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_profiler_allocation_object_count;
+
+void bvm_profiler_allocation_freed(void *ptr);
+void bvm_profiler_allocation_forward(bvm_obj_t *(*forward)(bvm_obj_t *));
+bvm_uint32_t bvm_profiler_allocation_site_serial(void *ptr);
+void bvm_profiler_allocsites_visit(bvm_profiler_site_callback_t callback);
+
+/** Forget the site of the sampled object at \c p (if it is one) as its memory is freed */
+#define BVM_PROFILER_ALLOCATION_FREED(p) {														\
+	if (bvm_gl_profiler_allocation_object_count > 0) bvm_profiler_allocation_freed(p);			\
+}
+
+#endif
+
+#else
+#define BVM_PROFILER_SAMPLE_ALLOCATION(p, s, t) {}
+#endif
+
+#if !(BVM_PROFILER_ALLOCATION_SITES_ENABLE && BVM_HEAP_DUMP_ENABLE)
+#define BVM_PROFILER_ALLOCATION_FREED(p) {}
+#endif
+
+#if BVM_PROFILER_MONITOR_CONTENTION_ENABLE
+
+extern BVM_VM_LOCAL char *bvm_gl_profiler_contention_filename;
+
+void bvm_profiler_contention_blocked(bvm_obj_t *obj, bvm_vmthread_t *vmthread);
+void bvm_profiler_contention_unblocked(bvm_vmthread_t *vmthread);
+void bvm_profiler_contention_wait(bvm_obj_t *obj);
+void bvm_profiler_contention_notify(bvm_obj_t *obj);
+void bvm_profiler_contention_reset();
+bvm_bool_t bvm_profiler_contention_dump_to_file(const char *filename);
+void bvm_profiler_contention_release();
+
+/** Count thread \c t blocking for the monitor of object \c o */
+#define BVM_PROFILER_CONTENTION_BLOCKED(o, t) bvm_profiler_contention_blocked((o), (t))
+
+/** Charge the time thread \c t was blocked for a monitor, if it was */
+#define BVM_PROFILER_CONTENTION_UNBLOCKED(t) {													\
+	if ((t)->contention_site != NULL) bvm_profiler_contention_unblocked(t);						\
+}
+
+/** Count a wait on the monitor of object \c o */
+#define BVM_PROFILER_CONTENTION_WAIT(o) bvm_profiler_contention_wait(o)
+
+/** Count a notify of the monitor of object \c o */
+#define BVM_PROFILER_CONTENTION_NOTIFY(o) bvm_profiler_contention_notify(o)
+
+#else
+#define BVM_PROFILER_CONTENTION_BLOCKED(o, t) {}
+#define BVM_PROFILER_CONTENTION_UNBLOCKED(t) {}
+#define BVM_PROFILER_CONTENTION_WAIT(o) {}
+#define BVM_PROFILER_CONTENTION_NOTIFY(o) {}
+#endif
+
+#if BVM_PROFILER_STARTUP_TRACE_ENABLE
+
+extern BVM_VM_LOCAL char *bvm_gl_profiler_startup_filename;
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_profiler_startup_origin;
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_profiler_startup_inflate_micros;
+
+void bvm_profiler_startup_event(const char *category, const char *name, bvm_uint32_t start, const char *args);
+void bvm_profiler_startup_load_event(bvm_clazz_t *clazz, bvm_uint32_t start, bvm_uint32_t read_micros,
+									 bvm_uint32_t inflate_micros, bvm_int32_t bytes);
+void bvm_profiler_startup_clinit_begin(bvm_clazz_t *clazz);
+void bvm_profiler_startup_clinit_end(bvm_clazz_t *clazz);
+bvm_bool_t bvm_profiler_startup_dump_to_file(const char *filename);
+void bvm_profiler_startup_release();
+
+/** Is the startup being traced? */
+#define BVM_PROFILER_STARTUP_TRACING() (bvm_gl_profiler_startup_filename != NULL)
+
+/** Set \c v to the time now if the startup is being traced */
+#define BVM_PROFILER_STARTUP_MARK(v) ((v) = BVM_PROFILER_STARTUP_TRACING() ? bvm_pd_system_time_micros() : 0)
+
+/** Trace the VM initialisation phase \c name that began at the mark \c v */
+#define BVM_PROFILER_STARTUP_PHASE(v, name) ( BVM_PROFILER_STARTUP_TRACING() ? bvm_profiler_startup_event("phase", (name), (v), NULL) : (void) 0 )
+
+#else
+#define BVM_PROFILER_STARTUP_MARK(v) ((void) 0)
+#define BVM_PROFILER_STARTUP_PHASE(v, name) ((void) 0)
+#endif
+
+#if BVM_PROFILER_PERF_ENABLE
+
+/** The version of the #bvm_perf_descriptor_t layout - changed whenever a member is added or changed */
+#define BVM_PERF_DESCRIPTOR_VERSION 1
+
+/**
+ * What a tool reading the memory of the VM process needs to know to find the method each thread is running and walk
+ * its Java frames.  All offsets are in bytes, except the frame offsets, which are in cells from the locals of a frame.
+ */
+typedef struct _bvmperfdescriptorstruct {
+
+	/** "BVMPERF" and a nul - so the descriptor can be checked once found */
+	char magic[8];
+
+	/** the #BVM_PERF_DESCRIPTOR_VERSION of the layout */
+	bvm_uint32_t version;
+
+	/** the size of a #bvm_cell_t */
+	bvm_uint32_t cell_size;
+
+	/** the address of the #bvm_method_t pointer of the running method */
+	void *current_method;
+
+	/** the address of the #bvm_cell_t pointer to the locals of the running frame */
+	void *current_locals;
+
+	/** the cell offset from a frame's locals of the method of the frame below it (see #BVM_FRAME_METHOD_OFFSET) */
+	bvm_int32_t frame_method_offset;
+
+	/** the cell offset from a frame's locals of the locals of the frame below it (see #BVM_FRAME_LOCALS_OFFSET) */
+	bvm_int32_t frame_locals_offset;
+
+	/** the offsets of the name, signature and clazz of a #bvm_method_t */
+	bvm_uint32_t method_name_offset;
+	bvm_uint32_t method_signature_offset;
+	bvm_uint32_t method_clazz_offset;
+
+	/** the offset of the name of a #bvm_clazz_t */
+	bvm_uint32_t clazz_name_offset;
+
+	/** the offsets of the length and the data pointer of a #bvm_utfstring_t */
+	bvm_uint32_t utfstring_length_offset;
+	bvm_uint32_t utfstring_data_offset;
+
+} bvm_perf_descriptor_t;
+
+extern bvm_perf_descriptor_t bvm_perf_descriptor;
+extern BVM_VM_LOCAL bvm_bool_t bvm_gl_profiler_perf_map_enabled;
+
+void bvm_profiler_perf_init();
+void bvm_profiler_perf_map_code(bvm_method_t *method, void *code, size_t size);
+void bvm_profiler_perf_release();
+
+#endif
+
+#endif /*BVM_PROFILER_H_*/
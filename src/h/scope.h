@@ -0,0 +1,107 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#ifndef BVM_SCOPE_H_
+#define BVM_SCOPE_H_
+
+/**
+  @file
+
+  Constants/Macros/Functions/Types for scoped memory.
+
+  @author Greg McCreath
+  @since 0.0.10
+
+*/
+
+#if BVM_SCOPED_MEMORY_ENABLE
+
+/**
+ * A scoped memory.  The arena of a scope follows this structure in the same #BVM_ALLOC_TYPE_STATIC allocation.  The
+ * objects in the arena are laid out as in-use chunks, from #start up to #top, so each may be treated as a heap object.
+ */
+typedef struct _bvmscopestruct {
+
+	/** The first byte of the arena */
+	bvm_uint8_t *start;
+
+	/** The next free byte of the arena */
+	bvm_uint8_t *top;
+
+	/** The byte after the end of the arena */
+	bvm_uint8_t *end;
+
+	/** The thread in the scope, or \c NULL if the scope has not been entered */
+	struct _bvmthreadstruct *owner;
+
+	/** The scope #owner was in when it entered this one, or \c NULL if it was in none */
+	struct _bvmscopestruct *outer;
+
+	/** The next scope in #bvm_gl_scopes_entered */
+	struct _bvmscopestruct *next;
+
+} bvm_scope_t;
+
+/**
+ * A Java \c babe.lang.ScopedMemory object.
+ */
+typedef struct _bvmscopedmemoryobjstruct {
+
+	/** standard structure for any object */
+	BVM_COMMON_OBJ_INFO
+
+	/** The scope, or \c NULL once it has been released.  An \c int field to Java, so not a reference to the GC. */
+	bvm_scope_t *scope;
+
+} bvm_scoped_memory_obj_t;
+
+extern BVM_VM_LOCAL bvm_scope_t *bvm_gl_scopes_entered;
+
+/**
+ * Determine if the objects the current thread creates are allocated from a scope - see #bvm_scope_suspend.
+ */
+#define BVM_SCOPE_IsAllocating() \
+	( (bvm_gl_thread_current->scope != NULL) && (bvm_gl_thread_current->scope_suspended == 0) )
+
+/**
+ * Determine if storing a reference \c v into an object, array or clazz \c h would let a scoped object outlive its
+ * scope.  Cheap when no thread is in a scope.
+ *
+ * @param h - the object, array, or clazz that the reference is stored into.
+ * @param v - the reference being stored.  May be \c NULL.
+ */
+#define BVM_SCOPE_IsEscape(h, v) ( (bvm_gl_scopes_entered != NULL) && ((v) != NULL) && bvm_scope_is_escape((h), (v)) )
+
+bvm_scope_t *bvm_scope_create(bvm_uint32_t size);
+void bvm_scope_release(bvm_scope_t *scope);
+void bvm_scope_enter(bvm_scope_t *scope);
+void bvm_scope_exit(bvm_scope_t *scope);
+void bvm_scope_exit_all(struct _bvmthreadstruct *vmthread);
+void bvm_scope_suspend();
+void bvm_scope_resume();
+bvm_bool_t bvm_scope_is_escape(void *holder, void *value);
+
+bvm_obj_t *bvm_scope_alloc_object(bvm_instance_clazz_t *clazz);
+bvm_jarray_obj_t *bvm_scope_alloc_array_primitive(bvm_uint32_t length, bvm_jtype_t type);
+bvm_instance_array_obj_t *bvm_scope_alloc_array_reference(bvm_uint32_t length, bvm_clazz_t *component_clazz);
+bvm_instance_array_obj_t *bvm_scope_alloc_array_multi(bvm_array_clazz_t *clazz, int dimensions, bvm_native_long_t lengths[]);
+bvm_obj_t *bvm_scope_clone(bvm_obj_t *obj);
+
+#endif
+
+#endif /*BVM_SCOPE_H_*/
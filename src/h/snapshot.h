@@ -0,0 +1,51 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#ifndef BVM_SNAPSHOT_H_
+#define BVM_SNAPSHOT_H_
+
+/**
+  @file
+
+  Constants/Macros/Functions/Types for VM snapshots.
+
+  @author Greg McCreath
+  @since 0.0.10
+
+*/
+
+#if BVM_VM_SNAPSHOT_ENABLE
+
+/** The first four bytes of a snapshot file - "BVMS" */
+#define BVM_VM_SNAPSHOT_MAGIC		0x42564D53
+
+/** The version of the snapshot file format.  A snapshot of another version is not used. */
+#define BVM_VM_SNAPSHOT_VERSION		2
+
+extern BVM_VM_LOCAL char *bvm_gl_snapshot_filename;
+extern BVM_VM_LOCAL char *bvm_gl_snapshot_write_filename;
+
+void bvm_snapshot_mark(int optc, char *optv[], int ac, char *av[]);
+void bvm_snapshot_ready();
+void bvm_snapshot_map_pointer(void *slot);
+void bvm_snapshot_map_data(void *ptr);
+bvm_bool_t bvm_snapshot_restore(const char *filename, int optc, char *optv[], int ac, char *av[]);
+
+#endif
+
+#endif /*BVM_SNAPSHOT_H_*/
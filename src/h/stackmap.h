@@ -0,0 +1,84 @@
+/*******************************************************************
+*
+* Copyright 2022 Montera Pty Ltd
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+*******************************************************************/
+
+#ifndef BVM_STACKMAP_H_
+#define BVM_STACKMAP_H_
+
+/**
+  @file
+
+  Constants/Macros/Functions/Types for the reference maps of method call sites.
+
+  @author Greg McCreath
+  @since 0.0.10
+
+*/
+
+#if BVM_GC_STACK_MAPS_ENABLE
+
+/**
+ * The reference map of one call site in a method.
+ */
+typedef struct _bvmstackmapentrystruct {
+
+	/** the bytecode offset of the invoke instruction */
+	bvm_uint16_t pc_index;
+
+	/** the operand stack depth of the frame while the call is made - the depth before the invoke less its
+	 * arguments */
+	bvm_uint16_t depth;
+
+} bvm_stackmap_entry_t;
+
+/**
+ * The reference maps of the call sites of a method.  Each entry has \c width bytes of bits, one bit for each
+ * local and then one for each operand stack cell up to the entry depth, set if the cell holds a reference.  A map with
+ * no entries is kept for a method whose maps could not be worked out, so it is not tried again.
+ */
+typedef struct _bvmstackmapstruct {
+
+	/** the next map in the list of all maps */
+	struct _bvmstackmapstruct *next;
+
+	/** the previous map in the list of all maps */
+	struct _bvmstackmapstruct *prev;
+
+	/** the number of entries, in order of \c pc_index */
+	bvm_uint16_t count;
+
+	/** the number of bytes of bits in each entry */
+	bvm_uint16_t width;
+
+	/** the entries */
+	bvm_stackmap_entry_t *entries;
+
+	/** the bits of the entries, \c width bytes for each */
+	bvm_uint8_t *bits;
+
+} bvm_stackmap_t;
+
+/** Is cell \c i of a frame marked as a reference in the bits of a map entry? */
+#define BVM_STACKMAP_IsRef(b, i)	( ((b)[(i) >> 3] & (1 << ((i) & 7))) != 0 )
+
+bvm_uint8_t *bvm_stackmap_get(bvm_method_t *method, bvm_uint32_t pc_index, bvm_uint32_t depth);
+void bvm_stackmap_free(bvm_method_t *method);
+void bvm_stackmap_release();
+
+#endif
+
+#endif /*BVM_STACKMAP_H_*/
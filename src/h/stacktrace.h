@@ -49,6 +49,24 @@ typedef struct _bvmstackbacktracesegmentstruct {
 
 } bvm_stack_backtrace_frameinfo_t;
 
+#if BVM_STACKTRACE_LAZY_ENABLE
+
+/**
+ * The compact form of a single stack frame recorded in a backtrace.  The names and line number
+ * of the frame are resolved from the method and pc only when the stack trace is required.
+ */
+typedef struct _bvmstackbacktracelocationstruct {
+
+	/** The method that was executing at the frame */
+	bvm_method_t *method;
+
+	/** The pc within the method where the frame is at */
+	bvm_uint8_t *pc;
+
+} bvm_stack_backtrace_location_t;
+
+#endif
+
 /**
  * A holder of stack frame information used by exception to generate a stack trace using the
  * \c Thread.printStackTrace() method.
@@ -58,9 +76,15 @@ struct _bvmstackbacktracestruct {
 	/** the number of frames described in #frames */
 	bvm_int32_t depth;
 
+#if BVM_STACKTRACE_LAZY_ENABLE
+	/** An array of #bvm_stack_backtrace_location_t - one for each frame that was on the stack when
+	 * the exception occurred */
+	bvm_stack_backtrace_location_t frames[1];
+#else
 	/** An array of #bvm_stack_backtrace_frameinfo_t - one for each frame that was on the stack when
 	 * the exception occurred */
 	bvm_stack_backtrace_frameinfo_t frames[1];
+#endif
 };
 
 /**
@@ -90,6 +114,8 @@ typedef struct _bvmstackframelementstruct {
 } bvm_stack_frame_element_obj_t;
 
 void bvm_stacktrace_populate_backtrace(bvm_throwable_obj_t *throwable_obj);
+void bvm_stacktrace_exclude_clazz(char *clazz_name);
+bvm_bool_t bvm_stacktrace_is_excluded(bvm_utfstring_t *clazz_name);
 void bvm_stacktrace_populate(bvm_throwable_obj_t *throwable_obj);
 
 #if BVM_CONSOLE_ENABLE
@@ -33,6 +33,10 @@ void bvm_string_print_to_console(bvm_string_obj_t *string, char *message);
 bvm_string_obj_t *bvm_string_create_from_utfstring(bvm_utfstring_t *str, bvm_bool_t intern);
 bvm_string_obj_t *bvm_string_create_from_cstring(const char *data);
 bvm_string_obj_t *bvm_string_create_from_unicode(const bvm_uint16_t *unicode, bvm_int32_t offset, bvm_int32_t len);
+bvm_string_obj_t *bvm_string_concat(const bvm_cell_t values[], const bvm_uint8_t types[], bvm_uint32_t count);
 char *bvm_string_to_cstring(bvm_string_obj_t *string);
+bvm_int32_t bvm_string_hash_chars(const bvm_uint16_t *data, bvm_int32_t len);
+bvm_int32_t bvm_string_hash_code(bvm_string_obj_t *string);
+bvm_bool_t bvm_string_equals(bvm_string_obj_t *string, bvm_obj_t *obj);
 
 #endif /*BVM_STRING_H_*/
@@ -36,6 +36,13 @@ typedef struct _bvmdeventcontextstruct bvmd_eventcontext_t;
 
 #endif
 
+#if BVM_THREAD_ACCOUNTING_ENABLE
+
+/** The number of buckets in a thread wait histogram - the last is for waits longer than all the others */
+#define BVM_THREAD_WAIT_BUCKETS 10
+
+#endif
+
 /**
  * A Java \c java.lang.Thread object.
  */
@@ -117,6 +124,11 @@ typedef struct _bvmthreadstruct {
 	/** The method register - the current executing method */
 	bvm_method_t *rx_method;
 
+#if BVM_DEBUGGER_ENABLE
+	/** The frame count register - the number of frames on the thread stack */
+	bvm_uint32_t rx_depth;
+#endif
+
 	/** The number of bytecodes to execute for this thread before a thread switch occurs. */
 	bvm_uint32_t timeslice;
 
@@ -127,9 +139,62 @@ typedef struct _bvmthreadstruct {
 	/** When put into a WAITING state, this is the current lock depth here */
 	bvm_uint16_t lock_depth;
 
+#if BVM_THIN_LOCK_ENABLE
+	/** The owner id this thread records in the lock word of objects it thin-locks.  Zero if the thread
+	 * cannot thin-lock and always uses monitors. */
+	bvm_uint32_t lock_id;
+#endif
+
 	/** When in the timed callback list, this is the time to wake up */
 	bvm_int64_t time_to_awake;
 
+	/** One more than this thread's position in #bvm_gl_thread_timers, or zero if it is not in it */
+	bvm_uint32_t timer_index;
+
+#if BVM_THREAD_PRIORITY_QUEUES_ENABLE
+	/** The priority of the runnable queue this thread is in, or zero if it is not runnable */
+	bvm_uint8_t run_level;
+#endif
+
+#if BVM_THREAD_PRIORITY_INHERITANCE_ENABLE
+	/** The highest priority of the threads blocked for monitors this thread owns, if higher than its own, otherwise
+	 * zero */
+	bvm_uint8_t inherited_level;
+
+	/** The monitor whose lock queue this thread is in, or \c NULL if it is in none */
+	struct _bvmmonitorstruct *blocked_on;
+#endif
+
+#if BVM_SOCKETS_ENABLE
+	/** One more than this thread's position in #bvm_gl_thread_io_threads, or zero if it is not parked on a socket */
+	bvm_uint32_t io_index;
+#endif
+
+#if BVM_FILE_ASYNC_ENABLE
+	/** The file read or write this thread was parked on by #bvm_thread_wait_for_file, until the native that
+	 * finishes it takes it.  \c NULL if there is none. */
+	bvm_file_async_t *file_async;
+#endif
+
+#if BVM_SCOPED_MEMORY_ENABLE
+	/** The scope this thread allocates from - the one it entered last - or \c NULL if it is in none */
+	struct _bvmscopestruct *scope;
+
+	/** The number of clazz initialisations in progress that were started in a scope - see #bvm_scope_suspend */
+	bvm_uint32_t scope_suspended;
+#endif
+
+#if BVM_THREAD_TASKS_ENABLE
+	/** Set if the thread was started as a \c babe.lang.Task - its VM thread may be pooled when it ends */
+	bvm_bool_t is_task;
+
+	/** Set while the thread is blocked in #bvm_thread_task_yield */
+	bvm_bool_t is_yielded;
+
+	/** Set if the thread was resumed while not yielded - its next yield returns straight away */
+	bvm_bool_t resume_pending;
+#endif
+
 	/** Interruption flag as per the JVMS */
 	bvm_bool_t is_interrupted;
 
@@ -151,9 +216,53 @@ typedef struct _bvmthreadstruct {
 	 * in one queue at a time (lock or wait).  \c NULL if in no queue. */
 	struct _bvmthreadstruct *next_in_queue;
 
+	/** The previous thread in whichever monitor queue this thread is in, if any.  For the head of a
+	 * queue this is the tail of the queue.  \c NULL if in no queue. */
+	struct _bvmthreadstruct *prev_in_queue;
+
+#if BVM_PROFILER_MONITOR_CONTENTION_ENABLE
+	/** The monitor contention site this thread is blocked at, or \c NULL if it is not blocked for a monitor */
+	void *contention_site;
+
+	/** When this thread blocked at #contention_site, on the platform microsecond clock */
+	bvm_uint32_t contention_start;
+#endif
+
+#if BVM_THREAD_ACCOUNTING_ENABLE
+	/** The microseconds this thread has run for */
+	bvm_native_ulong_t cpu_micros;
+
+	/** The bytecodes this thread has executed, as counted down by its timeslice - so translated and compiled code
+	 * counts its branches, and with #BVM_THREAD_TIMER_PREEMPTION_ENABLE timer ticks are counted instead */
+	bvm_native_ulong_t bytecodes;
+
+	/** The microseconds this thread has spent runnable but waiting to run */
+	bvm_native_ulong_t wait_micros;
+
+	/** The number of times this thread waited to run for each bucket of the wait histogram.  Not cumulative. */
+	bvm_uint32_t waits[BVM_THREAD_WAIT_BUCKETS];
+
+	/** When this thread became runnable, on the platform microsecond clock, if #is_waiting is set */
+	bvm_uint32_t waiting_since;
+
+	/** Set while this thread is runnable but not running */
+	bvm_bool_t is_waiting;
+#endif
+
+#if BVM_THREAD_MONITOR_SPIN_LIMIT > 0
+	/** The number of times in a row this thread has been woken to compete for a released monitor.  Reset
+	 * when the thread acquires a monitor. */
+	bvm_uint32_t monitor_spins;
+#endif
+
 	/** the found location (if any) of a thrown exception */
 	bvm_exception_location_data_t exception_location;
 
+#if BVM_NATIVE_ACCESS_CONTEXT_CACHE_ENABLE
+	/** The access control context last built from this thread's stack, or \c NULL */
+	bvm_accesscontrolcontext_obj_t *access_context;
+#endif
+
 #if BVM_DEBUGGER_ENABLE
 
 	/** The number of times the debugger has suspended this thread */
@@ -177,7 +286,7 @@ typedef struct _bvmthreadstruct {
 	struct {
 
 		/** the stack depth at the time */
-		bvm_uint16_t stack_depth;
+		bvm_uint32_t stack_depth;
 
 		/** the executing method at the time */
 		bvm_method_t *method;
@@ -223,22 +332,75 @@ typedef struct _bvmmonitorstruct {
 	/** if the monitor is in use */
 	bvm_bool_t in_use;
 
-	/** Next entry in unused monitor cache, if any. (\c NULL if none)*/
+	/** Next entry in the list of all monitors, if any. (\c NULL if none)*/
 	struct _bvmmonitorstruct *next;
 
+	/** Next in-use monitor in the same monitor hash bucket, or next entry in the unused monitor
+	 * free list, if any. (\c NULL if none)*/
+	struct _bvmmonitorstruct *next_in_bucket;
+
 } bvm_monitor_t;
 
-extern bvm_vmthread_t *bvm_gl_threads;
+extern BVM_VM_LOCAL bvm_vmthread_t *bvm_gl_threads;
+
+extern BVM_VM_LOCAL bvm_vmthread_t *bvm_gl_thread_current;
+
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_thread_nondaemon_count;
+
+extern BVM_VM_LOCAL bvm_int32_t bvm_gl_thread_timeslice_counter;
+
+#if BVM_THREAD_ACCOUNTING_ENABLE
+
+extern BVM_VM_LOCAL bvm_int32_t bvm_gl_thread_timeslice_start;
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_thread_run_start;
+extern const bvm_uint32_t bvm_gl_thread_wait_bounds[BVM_THREAD_WAIT_BUCKETS - 1];
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_thread_waits[BVM_THREAD_WAIT_BUCKETS];
+extern BVM_VM_LOCAL bvm_native_ulong_t bvm_gl_thread_wait_micros;
+
+/** Count what the current thread has executed of its timeslice before the timeslice counter is changed */
+#define BVM_THREAD_ACCOUNT_TIMESLICE() bvm_thread_account_timeslice()
+
+#else
+
+#define BVM_THREAD_ACCOUNT_TIMESLICE() ((void) 0)
+
+#endif
+
+#if BVM_THREAD_TIMER_PREEMPTION_ENABLE
+
+extern BVM_VM_LOCAL volatile bvm_bool_t bvm_gl_thread_switch_requested;
+
+/** Cause a thread switch at the next point the interpreter looks for one */
+#define BVM_THREAD_REQUEST_SWITCH() { BVM_THREAD_ACCOUNT_TIMESLICE(); bvm_gl_thread_timeslice_counter = 0; bvm_gl_thread_switch_requested = BVM_TRUE; }
 
-extern bvm_vmthread_t *bvm_gl_thread_current;
+#else
 
-extern bvm_uint32_t bvm_gl_thread_nondaemon_count;
+/** Cause a thread switch before the next bytecode is executed */
+#define BVM_THREAD_REQUEST_SWITCH() { BVM_THREAD_ACCOUNT_TIMESLICE(); bvm_gl_thread_timeslice_counter = 0; }
 
-extern bvm_int32_t bvm_gl_thread_timeslice_counter;
+#endif
+
+extern BVM_VM_LOCAL bvm_monitor_t *bvm_gl_thread_monitor_list;
 
-extern bvm_monitor_t *bvm_gl_thread_monitor_list;
+extern BVM_VM_LOCAL bvm_vmthread_t **bvm_gl_thread_timers;
 
-extern bvm_uint32_t bvm_gl_thread_active_count;
+#if BVM_SOCKETS_ENABLE
+extern BVM_VM_LOCAL struct _bvmsocketpollstruct *bvm_gl_thread_io_polls;
+extern BVM_VM_LOCAL bvm_vmthread_t **bvm_gl_thread_io_threads;
+#endif
+
+#if (BVM_THREAD_STACK_POOL_SIZE > 0)
+extern BVM_VM_LOCAL bvm_stacksegment_t *bvm_gl_thread_stack_pool;
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_thread_stack_pool_count;
+#endif
+
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_thread_active_count;
+
+#if BVM_THREAD_TASKS_ENABLE
+extern BVM_VM_LOCAL bvm_vmthread_t *bvm_gl_thread_task_pool;
+extern BVM_VM_LOCAL bvm_vmthread_t *bvm_gl_thread_task_retired;
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_thread_task_pool_count;
+#endif
 
 /**
  * A structure passed to a #bvm_stack_visit_callback_t while traversing a thread's stack.  The information contained in
@@ -302,12 +464,41 @@ void bvm_thread_interrupt(bvm_vmthread_t *vmthread);
 bvm_uint32_t bvm_thread_get_next_id();
 bvm_bool_t bvm_thread_is_alive(bvm_vmthread_t *vmthread);
 void bvm_thread_sleep(bvm_int64_t wait_time);
+
+#if BVM_THREAD_TASKS_ENABLE
+bvm_vmthread_t *bvm_thread_create_task(bvm_thread_obj_t *thread_obj);
+void bvm_thread_task_yield();
+void bvm_thread_task_resume(bvm_vmthread_t *vmthread);
+#endif
+
+#if BVM_THREAD_ACCOUNTING_ENABLE
+void bvm_thread_account_timeslice();
+void bvm_thread_account_run();
+bvm_native_ulong_t bvm_thread_cpu_micros(bvm_vmthread_t *vmthread);
+bvm_native_ulong_t bvm_thread_bytecodes(bvm_vmthread_t *vmthread);
+#endif
+
+#if BVM_SOCKETS_ENABLE
+void bvm_thread_wait_for_socket(bvm_int32_t fd, bvm_uint8_t events, bvm_int64_t timeout);
+#endif
+
+#if BVM_FILE_ASYNC_ENABLE
+void bvm_thread_wait_for_file(bvm_file_async_t *async);
+#endif
 bvm_obj_t *bvm_thread_terminated_callback(bvm_cell_t *res1, bvm_cell_t *res2, bvm_bool_t is_exception, void *data);
 bvm_stacksegment_t *bvm_thread_create_stack(bvm_uint32_t height);
+bvm_bool_t bvm_thread_pool_stack(bvm_stacksegment_t *stack);
 void bvm_thread_push_exceptionhandler(bvm_throwable_obj_t *throwable);
 void bvm_thread_store_registers(bvm_vmthread_t *vmthread);
 void bvm_thread_load_registers(bvm_vmthread_t *vmthread);
 bvm_monitor_t *get_monitor_for_obj(bvm_obj_t *obj);
+void bvm_thread_monitor_rehash();
+bvm_monitor_t *bvm_thread_monitor_inflate(bvm_obj_t *obj);
+bvm_bool_t bvm_thread_monitor_is_owner(bvm_obj_t *obj, bvm_vmthread_t *vmthread);
+
+#if BVM_VM_SNAPSHOT_ENABLE
+void bvm_thread_snapshot_map();
+#endif
 
 #if BVM_DEBUGGER_ENABLE
 
@@ -318,6 +509,7 @@ void bvmd_thread_resume(bvm_vmthread_t *thread);
 
 void bvmd_thread_suspend_all();
 void bvmd_thread_resume_all(bvm_bool_t force, bvm_bool_t clear_parked);
+void bvmd_thread_inflate_thin_locks();
 
 #endif
 
@@ -46,23 +46,23 @@ typedef struct _bvmexceptionstackframe {
 } bvm_exception_frame_t;
 
 /* handle to top of exceptions frame stack */
-extern bvm_exception_frame_t *bvm_gl_exception_stack;
+extern BVM_VM_LOCAL bvm_exception_frame_t *bvm_gl_exception_stack;
 
 /**
  * A handle to a jmp_buf created at VM startup - used to cause a jump to a specific place
  * on a #BVM_VM_EXIT.
  */
-void* bvm_vm_exit_env;
+extern BVM_VM_LOCAL void* bvm_vm_exit_env;
 
 /**
  * On a #BVM_VM_EXIT, an exit code may be specified.  It is held here afterwards.
  */
-int bvm_gl_vm_exit_code;
+extern BVM_VM_LOCAL int bvm_gl_vm_exit_code;
 
 /**
  * On a #BVM_VM_EXIT, an exit message may be specified.  It is held here afterwards.
  */
-char *bvm_gl_vm_exit_msg;
+extern BVM_VM_LOCAL char *bvm_gl_vm_exit_msg;
 
 #define BVM_TRY                                                     	\
     {                                                           	\
@@ -126,4 +126,8 @@ void bvm_throw_exception(const char* exception_clazz_name, const char *msg);
 bvm_throwable_obj_t *bvm_create_exception_c(const char* exception_clazz_name, const char *msg);
 bvm_throwable_obj_t *bvm_create_exception(bvm_clazz_t *clazz, const char* msg);
 
+#if BVM_VM_INSTANCES_ENABLE
+void bvm_init_exception_stack();
+#endif
+
 #endif /*BVM_TRYCATCH_H_*/
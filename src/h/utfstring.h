@@ -46,6 +46,10 @@ typedef struct _bvmutfstringstruct {
 	/** The length of the utf8 chars - does not include the null-terminator character */
 	bvm_uint16_t length;
 
+	/** The #bvm_calchash hash of the chars, set when the string is added to the utf string pool - zero if not
+	 * known.  Use #BVM_UTFSTRING_HASH to get the hash of any utfstring. */
+	bvm_uint32_t hash;
+
 	/** the encoded chars - plus a null-terminator*/
 	bvm_uint8_t *data;
 
@@ -54,6 +58,12 @@ typedef struct _bvmutfstringstruct {
 
 } bvm_utfstring_t ;
 
+/**
+ * The hash of a utfstring - its cached hash if it has one, otherwise calculated from its chars.  A utfstring that is
+ * not pooled must have a \c hash of zero (or its correct hash) - its chars may be changed.
+ */
+#define BVM_UTFSTRING_HASH(s) ( ((s)->hash != 0) ? (s)->hash : bvm_calchash((s)->data, (s)->length) )
+
 
 
 void bvm_str_replace_char(char *name, int len, char oldchar, char newchar);
@@ -65,6 +75,8 @@ bvm_uint32_t bvm_str_utf8_length_from_unicode(bvm_uint16_t *str, bvm_uint32_t of
 bvm_uint32_t bvm_str_unicode_length_from_utf8(bvm_uint8_t *utf8, bvm_uint32_t offset, bvm_uint32_t len);
 void bvm_str_encode_unicode_to_utf8(bvm_uint16_t *chars, bvm_uint32_t offset, bvm_uint32_t length, bvm_int8_t *buf);
 void bvm_str_decode_utf8_to_unicode(bvm_uint8_t *bytes, bvm_uint32_t offset, bvm_uint32_t length, bvm_uint16_t *chars);
+bvm_int32_t bvm_str_jchar_index_of(const bvm_uint16_t *chars, bvm_int32_t len, bvm_uint16_t ch);
+bvm_int32_t bvm_str_jchar_last_index_of(const bvm_uint16_t *chars, bvm_int32_t len, bvm_uint16_t ch);
 bvm_utfstring_t bvm_str_wrap_utfstring(char *buf);
 void bvm_str_itoa(bvm_int32_t value, char* str, int base);
 char *bvm_str_utfstring_to_cstring(bvm_utfstring_t *str);
@@ -45,6 +45,7 @@ extern const char *BVM_ERR_ILLEGAL_ACCESS_EXCEPTION;
 extern const char *BVM_ERR_ILLEGAL_THREAD_STATE_EXCEPTION;
 extern const char *BVM_ERR_ILLEGAL_MONITOR_STATE_EXCEPTION;
 extern const char *BVM_ERR_ILLEGAL_ARGUMENT_EXCEPTION;
+extern const char *BVM_ERR_ILLEGAL_STATE_EXCEPTION;
 extern const char *BVM_ERR_INTERRUPTED_EXCEPTION;
 extern const char *BVM_ERR_INCOMPATIBLE_CLASS_CHANGE_ERROR;
 extern const char *BVM_ERR_INDEX_OUT_OF_BOUNDS_EXCEPTION;
@@ -58,6 +59,7 @@ extern const char *BVM_ERR_NO_CLASS_DEF_FOUND_ERROR;
 extern const char *BVM_ERR_NO_SUCH_FIELD_ERROR;
 extern const char *BVM_ERR_NO_SUCH_METHOD_ERROR;
 extern const char *BVM_ERR_NULL_POINTER_EXCEPTION;
+extern const char *BVM_ERR_NUMBER_FORMAT_EXCEPTION;
 extern const char *BVM_ERR_RUNTIME_EXCEPTION;
 extern const char *BVM_ERR_THROWABLE;
 extern const char *BVM_ERR_ERROR;
@@ -71,6 +73,9 @@ extern const char *BVM_ERR_EXCEPTION_IN_INITIALIZER_ERROR;
 extern const char *BVM_ERR_UNSUPPORTED_OPERATION_EXCEPTION;
 extern const char *BVM_ERR_IO_EXCEPTION;
 extern const char *BVM_ERR_FILE_NOT_FOUND_EXCEPTION;
+extern const char *BVM_ERR_BUFFER_OVERFLOW_EXCEPTION;
+extern const char *BVM_ERR_BUFFER_UNDERFLOW_EXCEPTION;
+extern const char *BVM_ERR_READ_ONLY_BUFFER_EXCEPTION;
 
 #if (BVM_CONSOLE_ENABLE || BVM_DEBUGGER_ENABLE)
 
@@ -81,20 +86,20 @@ extern const char *BVM_VM_COPYRIGHT;
 
 #endif
 
-extern bvm_bool_t bvm_gl_vm_is_initialised;
-extern bvm_uint32_t bvm_gl_stack_height;
+extern BVM_VM_LOCAL bvm_bool_t bvm_gl_vm_is_initialised;
+extern BVM_VM_LOCAL bvm_uint32_t bvm_gl_stack_height;
 
-extern char *bvm_gl_user_classpath;
-extern char *bvm_gl_boot_classpath;
+extern BVM_VM_LOCAL char *bvm_gl_user_classpath;
+extern BVM_VM_LOCAL char *bvm_gl_boot_classpath;
 
 /* an array of char* that points to the path elements of the class path held
  * in #bvm_gl_boot_classpath. */
-extern char *bvm_gl_boot_classpath_segments[];
-extern char *bvm_gl_user_classpath_segments[];
+extern BVM_VM_LOCAL char *bvm_gl_boot_classpath_segments[];
+extern BVM_VM_LOCAL char *bvm_gl_user_classpath_segments[];
 
-extern bvm_bool_t bvm_gl_assertions_enabled;
+extern BVM_VM_LOCAL bvm_bool_t bvm_gl_assertions_enabled;
 
-extern char *bvm_gl_home_path;
+extern BVM_VM_LOCAL char *bvm_gl_home_path;
 
 /* BVM_MAX and BVM_MIN values for INT */
 #define BVM_MAX_INT           ((bvm_int32_t)0x7FFFFFFF)
@@ -138,10 +143,33 @@ enum BVM_FATAL_ERRS {
 	BVM_FATAL_ERR_INCORRECT_CELL_SIZE = 131,					    /* incorrect type size */
 	BVM_FATAL_ERR_INFLATE_FAILED = 132,					            /* jar inflation failed */
 	BVM_FATAL_ERR_INFLATE_NOT_ENABLED = 133,					    /* jar inflation not enabled */
-	BVM_FATAL_ERR_UNKNOWN_COMPRESSION_METHOD = 133				    /* unknown compression method used in jar */
+	BVM_FATAL_ERR_UNKNOWN_COMPRESSION_METHOD = 133,				    /* unknown compression method used in jar */
+	BVM_FATAL_ERR_NULL_TRAP_NOT_INSTALLED = 134					    /* the platform could not trap null dereferences */
 };
 
 int bvm_main(int argc, char *argv[]);
+void bvm_vm_init(int *argc, char **argv[]);
+
+#if BVM_VM_SLICE_ENABLE
+
+/** What a VM run in slices is left doing at the end of a slice */
+typedef enum {
+	BVM_VM_SLICE_RUNNABLE = 0,	/* threads are ready to run - run another slice soon */
+	BVM_VM_SLICE_IDLE = 1,		/* every thread is waiting - the host may wait on its own events first */
+	BVM_VM_SLICE_ENDED = 2		/* the VM has ended - shut it down with bvm_vm_slice_end() */
+} bvm_vm_slice_state_t;
+
+bvm_vm_slice_state_t bvm_vm_slice_start(int argc, char *argv[]);
+bvm_vm_slice_state_t bvm_vm_slice_run(bvm_uint32_t max_bytecodes, bvm_uint32_t max_micros);
+int bvm_vm_slice_end();
+#endif
+
+#if BVM_VM_ISOLATES_ENABLE
+int bvm_vm_isolate_start(int argc, char *argv[]);
+bvm_bool_t bvm_vm_isolate_is_valid(int id);
+bvm_bool_t bvm_vm_isolate_is_alive(int id);
+int bvm_vm_isolate_join(int id);
+#endif
 
 #if BVM_CONSOLE_ENABLE
 void bvm_show_version_and_copyright();
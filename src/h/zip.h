@@ -31,5 +31,25 @@
 
 bvm_filebuffer_t *bvm_zip_buffer_file_from_jar(char *jarname, char *filename);
 
+#if BVM_JAR_DIRECTORY_INDEX_ENABLE
+bvm_bool_t bvm_zip_for_each_file(char *jarname, void (*callback)(bvm_uint8_t *, bvm_uint32_t, void *), void *data);
+#endif
+
+#if BVM_CLAZZ_PRELOAD_ENABLE
+bvm_bool_t bvm_zip_read_files(char *jarname, char *pathnames[], bvm_uint32_t count,
+							  void (*callback)(bvm_uint32_t, bvm_uint8_t *, bvm_uint32_t, void *), void *data);
+#endif
+
+#if BVM_CLAZZ_PREFETCH_ENABLE
+bvm_bool_t bvm_zip_is_mapped(char *jarname);
+void *bvm_zip_prepare_read_files(char *jarnames[], char *pathnames[], bvm_uint32_t count);
+void bvm_zip_read_prepared_files(void *reads, bvm_bool_t (*wanted)(bvm_uint32_t, void *),
+								 void (*callback)(bvm_uint32_t, bvm_uint8_t *, bvm_uint32_t, void *), void *data);
+#endif
+
+#if BVM_VM_SNAPSHOT_ENABLE
+void bvm_zip_close_jars();
+#endif
+
 #endif
 
@@ -32,7 +32,83 @@
 
 #if BVM_CONSOLE_ENABLE
 /* TODO - what to do about buffer overrun here? */
-static char console_buf[512];
+static BVM_VM_LOCAL char console_buf[512];
+#endif
+
+#if BVM_CONSOLE_ENABLE && BVM_CONSOLE_BUFFER_ENABLE
+
+/* output written by bvm_pd_console_write and not yet given to stdout */
+static BVM_VM_LOCAL char console_pending[BVM_CONSOLE_BUFFER_SIZE];
+static BVM_VM_LOCAL size_t console_pending_count = 0;
+
+/* the time the oldest pending output was written */
+static BVM_VM_LOCAL bvm_int64_t console_pending_time;
+
+/**
+ * Writes the pending console output to stdout.
+ */
+void bvm_pd_console_flush() {
+
+	if (console_pending_count == 0) return;
+
+	fwrite(console_pending, 1, console_pending_count, stdout);
+	fflush(stdout);
+
+	console_pending_count = 0;
+}
+
+/**
+ * Writes the pending console output to stdout if it has been waiting for longer than #BVM_CONSOLE_FLUSH_INTERVAL
+ * milliseconds.
+ */
+static void console_flush_if_due() {
+
+	bvm_int64_t waited;
+	bvm_int64_t interval;
+
+	if (console_pending_count == 0) return;
+
+	waited = bvm_pd_system_time();
+	BVM_INT64_decrease(waited, console_pending_time);
+	BVM_INT64_uint32_to_int64(interval, BVM_CONSOLE_FLUSH_INTERVAL);
+
+	if (!BVM_INT64_compare_lt(waited, interval)) bvm_pd_console_flush();
+}
+
+/**
+ * Writes bytes to the console through the console buffer.  The buffer is written out if the bytes hold a newline,
+ * if it fills, or if earlier output has been waiting for longer than #BVM_CONSOLE_FLUSH_INTERVAL milliseconds.  A
+ * write of at least #BVM_CONSOLE_BUFFER_SIZE bytes goes straight to stdout after the pending output.
+ *
+ * @param data the bytes to write
+ * @param length the number of bytes to write
+ */
+void bvm_pd_console_write(const char *data, size_t length) {
+
+	if (length == 0) return;
+
+	if (length >= BVM_CONSOLE_BUFFER_SIZE) {
+		bvm_pd_console_flush();
+		fwrite(data, 1, length, stdout);
+		fflush(stdout);
+		return;
+	}
+
+	if (length > BVM_CONSOLE_BUFFER_SIZE - console_pending_count)
+		bvm_pd_console_flush();
+
+	if (console_pending_count == 0)
+		console_pending_time = bvm_pd_system_time();
+
+	memcpy(&console_pending[console_pending_count], data, length);
+	console_pending_count += length;
+
+	if (memchr(data, '\n', length) != NULL)
+		bvm_pd_console_flush();
+	else
+		console_flush_if_due();
+}
+
 #endif
 
 int bvm_pd_console_out(const char* msg, ...) {
@@ -45,6 +121,11 @@ int bvm_pd_console_out(const char* msg, ...) {
 
 	fp = stdout;
 
+#if BVM_CONSOLE_BUFFER_ENABLE
+	/* buffered output goes first so it keeps its order with the message */
+	bvm_pd_console_flush();
+#endif
+
     res = vsprintf(console_buf, msg, vlist);
 
 	fprintf(fp, "%s", console_buf);
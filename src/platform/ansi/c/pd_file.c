@@ -30,6 +30,10 @@
 
 #if BVM_ANSI_FILE_ENABLE
 
+#if BVM_FILE_MAP_ENABLE && (defined(BVM_PLATFORM_LINUX) || defined(BVM_PLATFORM_OSX))
+#include <sys/mman.h>
+#endif
+
 void *bvm_pd_file_open(const char *filename, int flags) {
 
 	/* default as read only, all creation modes are ignored.  The file must exist.  */
@@ -144,4 +148,34 @@ int bvm_pd_file_exists(const char *filename) {
 	return (handle != NULL);
 }
 
+#if BVM_FILE_MAP_ENABLE
+
+#if (defined(BVM_PLATFORM_LINUX) || defined(BVM_PLATFORM_OSX))
+
+void *bvm_pd_file_map(void *handle, size_t size) {
+
+	void *address = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno( (FILE *) handle), 0);
+
+	return (address == MAP_FAILED) ? NULL : address;
+}
+
+int bvm_pd_file_unmap(void *address, size_t size) {
+	return (munmap(address, size) == 0) ? BVM_OK : BVM_ERR;
+}
+
+#else
+
+void *bvm_pd_file_map(void *handle, size_t size) {
+	/* mapping not supported on ANSI C */
+	return NULL;
+}
+
+int bvm_pd_file_unmap(void *address, size_t size) {
+	return BVM_OK;
+}
+
+#endif
+
+#endif
+
 #endif
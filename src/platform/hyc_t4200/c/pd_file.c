@@ -152,4 +152,17 @@ int bvm_pd_file_exists(const char *filename) {
 	return (handle != NULL);
 }
 
+#if BVM_FILE_MAP_ENABLE
+
+void *bvm_pd_file_map(void *handle, size_t size) {
+	/* mapping not supported */
+	return NULL;
+}
+
+int bvm_pd_file_unmap(void *address, size_t size) {
+	return BVM_OK;
+}
+
+#endif
+
 #endif
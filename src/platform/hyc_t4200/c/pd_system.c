@@ -32,4 +32,12 @@ bvm_int64_t bvm_pd_system_time() {
     return (bvm_int64_t) HYC_GetStartTicks();
 }
 
+/**
+ * No OS sleep is used on this device - we just watch the ticks go by.
+ */
+void bvm_pd_system_sleep(bvm_uint32_t millis) {
+    bvm_int64_t until = bvm_pd_system_time() + millis;
+    while (bvm_pd_system_time() < until);
+}
+
 #endif
@@ -32,6 +32,27 @@
 
 #include <sys/time.h>
 
+#if (BVM_THREAD_TIMER_PREEMPTION_ENABLE || BVM_EXEC_IMPLICIT_NULL_CHECKS_ENABLE)
+#include <signal.h>
+#endif
+
+#if (BVM_VM_ISOLATES_ENABLE || BVM_CLAZZ_PREFETCH_ENABLE || BVM_GC_PARALLEL_MARK_ENABLE || BVM_GC_CONCURRENT_SWEEP_ENABLE || \
+		BVM_FILE_ASYNC_ENABLE)
+#include <pthread.h>
+#endif
+
+#if (BVM_GC_PARALLEL_MARK_ENABLE || BVM_GC_CONCURRENT_SWEEP_ENABLE)
+#include <sched.h>
+#endif
+
+#if (BVM_JIT_ENABLE || BVM_COMPRESSED_REFS_ENABLE)
+#include <sys/mman.h>
+#endif
+
+#if BVM_PROFILER_PERF_ENABLE
+#include <unistd.h>
+#endif
+
 bvm_int64_t bvm_pd_system_time() {
 
 	/*
@@ -65,9 +86,252 @@ bvm_int64_t bvm_pd_system_time() {
 	return  result;
 }
 
+#if BVM_PROFILER_PERF_ENABLE
+
+bvm_uint32_t bvm_pd_system_process_id() {
+	return (bvm_uint32_t) getpid();
+}
+
+#endif
+
+#if (BVM_PROFILER_STARTUP_TRACE_ENABLE || BVM_PROFILER_MONITOR_CONTENTION_ENABLE || BVM_VM_SLICE_ENABLE || \
+	 BVM_THREAD_ACCOUNTING_ENABLE)
+
+bvm_uint32_t bvm_pd_system_time_micros() {
+
+	struct timespec time_spec;
+
+	clock_gettime(CLOCK_MONOTONIC, &time_spec);
+
+	/* wraps - only differences are used */
+	return (bvm_uint32_t) time_spec.tv_sec * 1000000 + (bvm_uint32_t) (time_spec.tv_nsec / 1000);
+}
+
+#endif
+
+void bvm_pd_system_sleep(bvm_uint32_t millis) {
+
+	struct timespec time_spec;
+
+	time_spec.tv_sec = millis / 1000;
+	time_spec.tv_nsec = (long) (millis % 1000) * 1000000L;
+
+	/* an interrupting signal just returns early */
+	nanosleep(&time_spec, NULL);
+}
+
 void bvm_pd_system_exit(int code) {
 	exit(code);
 }
 
+#if BVM_THREAD_TIMER_PREEMPTION_ENABLE
+
+/* the VM function the timer calls */
+static void (*pd_timer_tick)(void) = NULL;
+
+static void pd_timer_handler(int signum) {
+	UNUSED(signum);
+	pd_timer_tick();
+}
+
+/**
+ * A process virtual-time timer - it only runs while the VM is executing, so an idle VM is not woken, and the
+ * signal does not interrupt the VM's own sleeps and waits.
+ */
+void bvm_pd_system_timer_start(bvm_uint32_t millis, void (*tick)(void)) {
+
+	struct sigaction action;
+	struct itimerval interval;
+
+	pd_timer_tick = tick;
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = pd_timer_handler;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGVTALRM, &action, NULL);
+
+	interval.it_interval.tv_sec = millis / 1000;
+	interval.it_interval.tv_usec = (millis % 1000) * 1000;
+	interval.it_value = interval.it_interval;
+	setitimer(ITIMER_VIRTUAL, &interval, NULL);
+}
+
+void bvm_pd_system_timer_stop() {
+
+	struct itimerval interval;
+
+	memset(&interval, 0, sizeof(interval));
+	setitimer(ITIMER_VIRTUAL, &interval, NULL);
+}
+
+#endif
+
+#if BVM_EXEC_IMPLICIT_NULL_CHECKS_ENABLE
+
+/* the VM function a null dereference fault calls */
+static void (*pd_null_trap)(void) = NULL;
+
+static void pd_null_trap_handler(int signum, siginfo_t *info, void *context) {
+	UNUSED(context);
+
+	/* a fault on the first page is a null dereference - the VM throws from there if it was expecting it */
+	if ((size_t) info->si_addr < 4096) pd_null_trap();
+
+	/* not the VM's - fault again, this time with the default action */
+	signal(signum, SIG_DFL);
+}
+
+/**
+ * SIGSEGV (and SIGBUS, which some hosts raise instead) while the VM is executing.  SA_NODEFER leaves the signal
+ * unblocked, as the VM leaves the handler by a longjmp that does not restore the signal mask.
+ */
+bvm_bool_t bvm_pd_system_null_trap_start(void (*trap)(void)) {
+
+	struct sigaction action;
+
+	pd_null_trap = trap;
+
+	memset(&action, 0, sizeof(action));
+	action.sa_sigaction = pd_null_trap_handler;
+	action.sa_flags = SA_SIGINFO | SA_NODEFER;
+	sigemptyset(&action.sa_mask);
+
+	return (sigaction(SIGSEGV, &action, NULL) == 0) && (sigaction(SIGBUS, &action, NULL) == 0);
+}
+
+void bvm_pd_system_null_trap_stop() {
+	signal(SIGSEGV, SIG_DFL);
+	signal(SIGBUS, SIG_DFL);
+}
+
 #endif
 
+#if (BVM_VM_ISOLATES_ENABLE || BVM_CLAZZ_PREFETCH_ENABLE || BVM_GC_PARALLEL_MARK_ENABLE || BVM_GC_CONCURRENT_SWEEP_ENABLE || \
+		BVM_FILE_ASYNC_ENABLE)
+
+/* what a started thread is to run */
+typedef struct {
+	pthread_t thread;
+	void (*run)(void *);
+	void *data;
+} pd_thread_t;
+
+static void *pd_thread_run(void *arg) {
+	pd_thread_t *pd_thread = arg;
+	pd_thread->run(pd_thread->data);
+	return NULL;
+}
+
+void *bvm_pd_system_thread_start(void (*run)(void *), void *data) {
+
+	pd_thread_t *pd_thread = malloc(sizeof(pd_thread_t));
+
+	if (pd_thread == NULL) return NULL;
+
+	pd_thread->run = run;
+	pd_thread->data = data;
+
+	if (pthread_create(&pd_thread->thread, NULL, pd_thread_run, pd_thread) != 0) {
+		free(pd_thread);
+		return NULL;
+	}
+
+	return pd_thread;
+}
+
+void bvm_pd_system_thread_join(void *thread) {
+
+	pd_thread_t *pd_thread = thread;
+
+	pthread_join(pd_thread->thread, NULL);
+	free(pd_thread);
+}
+
+#endif
+
+#if (BVM_CLAZZ_PREFETCH_ENABLE || BVM_GC_PARALLEL_MARK_ENABLE || BVM_GC_CONCURRENT_SWEEP_ENABLE || BVM_FILE_ASYNC_ENABLE)
+
+void *bvm_pd_system_lock_create() {
+
+	pthread_mutex_t *mutex = malloc(sizeof(pthread_mutex_t));
+
+	if (mutex == NULL) return NULL;
+
+	if (pthread_mutex_init(mutex, NULL) != 0) {
+		free(mutex);
+		return NULL;
+	}
+
+	return mutex;
+}
+
+void bvm_pd_system_lock(void *lock) {
+	pthread_mutex_lock(lock);
+}
+
+void bvm_pd_system_unlock(void *lock) {
+	pthread_mutex_unlock(lock);
+}
+
+void bvm_pd_system_lock_destroy(void *lock) {
+	pthread_mutex_destroy(lock);
+	free(lock);
+}
+
+#if (BVM_GC_PARALLEL_MARK_ENABLE || BVM_GC_CONCURRENT_SWEEP_ENABLE)
+
+void bvm_pd_system_thread_yield() {
+	sched_yield();
+}
+
+#endif
+
+#endif
+
+#if BVM_COMPRESSED_REFS_ENABLE
+
+/** Where to ask for heap memory on hosts that have no \c MAP_32BIT - the kernel takes it as a hint only */
+#define PD_HEAP_ADDRESS_HINT ((void *) 0x40000000UL)
+
+void *bvm_pd_memory_heap_alloc(size_t size) {
+
+#ifdef MAP_32BIT
+	void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+#else
+	void *mem = mmap(PD_HEAP_ADDRESS_HINT, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#endif
+
+	if (mem == MAP_FAILED) return NULL;
+
+	/* a hint need not be taken - memory that is not wholly below 4gb is no use */
+	if ( ((bvm_native_ulong_t) mem + size - 1) > 0xFFFFFFFFUL) {
+		munmap(mem, size);
+		return NULL;
+	}
+
+	return mem;
+}
+
+void bvm_pd_memory_heap_free(void *mem, size_t size) {
+	munmap(mem, size);
+}
+
+#endif
+
+#if BVM_JIT_ENABLE
+
+void *bvm_pd_memory_exec_alloc(size_t size) {
+
+	void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	return (mem == MAP_FAILED) ? NULL : mem;
+}
+
+void bvm_pd_memory_exec_free(void *mem, size_t size) {
+	munmap(mem, size);
+}
+
+#endif
+
+#endif
@@ -36,12 +36,35 @@
 #define BVM_EXIT_ON_UNCAUGHT_EXCEPTION 1
 
 #define BVM_DEBUGGER_ENABLE 1
+#ifndef BVM_THREAD_ACCOUNTING_ENABLE
+#define BVM_THREAD_ACCOUNTING_ENABLE 1
+#endif
 
 // float support requires native 64 - so set them both when using float
 #define BVM_FLOAT_ENABLE 1
 #define BVM_NATIVE_INT64_ENABLE 1
 //#define BVM_32BIT_ENABLE 1
 
+/* storage class for VM state when BVM_VM_INSTANCES_ENABLE is set */
+#define BVM_PD_THREAD_LOCAL __thread
+
+/* atomically store n at p if it still holds o - true if it did.  For the collector's parallel marking. */
+#define BVM_PD_ATOMIC_CAS(p, o, n) __sync_bool_compare_and_swap((p), (o), (n))
+
+/* storage class for VM state when BVM_VM_SNAPSHOT_ENABLE is set - the linker gives the bounds of the section, and of
+ * the executable image it is part of */
+#define BVM_PD_VM_STATE __attribute__((section("bvm_vm_state")))
+
+extern char __start_bvm_vm_state[];
+extern char __stop_bvm_vm_state[];
+extern char __executable_start[];
+extern char _end[];
+
+#define BVM_PD_VM_STATE_START	((void *) __start_bvm_vm_state)
+#define BVM_PD_VM_STATE_END		((void *) __stop_bvm_vm_state)
+#define BVM_PD_IMAGE_START		((void *) __executable_start)
+#define BVM_PD_IMAGE_END		((void *) _end)
+
 typedef unsigned char bvm_uint8_t;
 typedef signed char bvm_int8_t;
 typedef unsigned short bvm_uint16_t;
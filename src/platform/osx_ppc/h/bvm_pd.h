@@ -50,6 +50,12 @@ typedef double bvm_double_t;
 #define BVM_PLATFORM_PATH_SEPARATOR 	':'
 #define BVM_PLATFORM_FILE_SEPARATOR 	'/'
 
+/* storage class for VM state when BVM_VM_INSTANCES_ENABLE is set */
+#define BVM_PD_THREAD_LOCAL __thread
+
+/* atomically store n at p if it still holds o - true if it did.  For the collector's parallel marking. */
+#define BVM_PD_ATOMIC_CAS(p, o, n) __sync_bool_compare_and_swap((p), (o), (n))
+
 /* if using floats, make the int64 native */
 #if BVM_FLOAT_ENABLE
 typedef long long bvm_int64_t;
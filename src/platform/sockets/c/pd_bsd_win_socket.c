@@ -46,6 +46,9 @@ WSADATA wsdata;
 /* winsock has no socklen_t type, so we make one .. */
 typedef int socklen_t;
 
+/* the last socket call would have blocked */
+#define PD_SOCKET_WOULD_BLOCK() (WSAGetLastError() == WSAEWOULDBLOCK)
+
 #endif
 
 #ifdef BVM_PLATFORM_LINUX
@@ -56,10 +59,17 @@ typedef int socklen_t;
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <netdb.h>  /* TODO - this right for gethostbyname ? */
+#include <poll.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <errno.h>
 
 /* linux/unix has no closesocket, so we make one .. */
 #define closesocket close
 
+/* the last socket call would have blocked */
+#define PD_SOCKET_WOULD_BLOCK() ( (errno == EWOULDBLOCK) || (errno == EAGAIN) )
+
 #endif
 
 /**
@@ -173,6 +183,23 @@ bvm_int32_t bvm_pd_socket_read(bvm_int32_t fd, char *buf, bvm_int32_t len) {
 	return len;
 }
 
+/**
+ * Reads whatever bytes are waiting on a socket, up to a given number.  Blocks only if no bytes at all
+ * are waiting and the socket is blocking.
+ *
+ * @param fd the socket to read from.
+ * @param buf the address to read data into.
+ * @param len the most bytes to read.
+ *
+ * @return the number of bytes read, 0 (zero) if the connection has been gracefully closed,
+ * #BVM_SOCKET_WOULD_BLOCK if a non-blocking socket has nothing waiting, or #BVM_SOCKET_ERROR on error.
+ */
+bvm_int32_t bvm_pd_socket_recv(bvm_int32_t fd, char *buf, bvm_int32_t len) {
+	bvm_int32_t nbytes = recv(fd, buf, len, 0);
+	if (nbytes < 0) return PD_SOCKET_WOULD_BLOCK() ? BVM_SOCKET_WOULD_BLOCK : BVM_SOCKET_ERROR;
+	return nbytes;
+}
+
 /**
  * Reports if data is waiting to be read on the socket.  The socket interrogation will timeout
  * after \c timeout milliseconds.  To never timeout, specify a timeout
@@ -191,6 +218,12 @@ bvm_int32_t bvm_pd_socket_available(bvm_int32_t fd, bvm_int32_t timeout) {
 	struct timeval *tvp = NULL; /* for a default, will mean 'wait forever' */
 	bvm_int32_t result;
 
+#ifdef BVM_PLATFORM_LINUX
+	/* a descriptor past the end of an fd_set cannot be selected on */
+	if (fd >= FD_SETSIZE)
+		return BVM_SOCKET_ERROR;
+#endif
+
 	FD_ZERO(&rset);
 	FD_SET((unsigned int) fd, &rset);
 
@@ -216,20 +249,161 @@ bvm_int32_t bvm_pd_socket_available(bvm_int32_t fd, bvm_int32_t timeout) {
 	return result;
 }
 
+#ifdef BVM_PLATFORM_LINUX
+
+/** The \c pollfd structures handed to \c poll by #bvm_pd_socket_poll, grown as needed and kept for the next call */
+static struct pollfd *pd_socket_pollfds = NULL;
+
+/** The number of \c pollfd structures #pd_socket_pollfds has room for */
+static bvm_uint32_t pd_socket_pollfds_size = 0;
+
+/**
+ * Tests a number of sockets at once for readiness using a single \c poll.  Each socket's \c ready member
+ * is set to the readiness found for it.  Unlike \c select, \c poll has no limit on the value of a socket
+ * descriptor.  A socket in error or hung up is reported ready for whatever was sought, so that its thread finds
+ * out with its own I/O.
+ *
+ * Unlike #bvm_pd_socket_available, a zero timeout really is zero - it is used at each thread
+ * switch so must not wait.
+ *
+ * @param polls the sockets to test.
+ * @param count the number of sockets in \c polls.
+ * @param timeout the time, in milliseconds, to wait for readiness.  Negative waits forever.
+ *
+ * @return the number of ready sockets, or #BVM_SOCKET_ERROR for any error (including a socket that is not open).
+ */
+bvm_int32_t bvm_pd_socket_poll(bvm_pd_socket_poll_t *polls, bvm_uint32_t count, bvm_int32_t timeout) {
+
+	bvm_int32_t result = 0;
+	bvm_uint32_t i;
+
+	if (count > pd_socket_pollfds_size) {
+		struct pollfd *pollfds = realloc(pd_socket_pollfds, count * sizeof(struct pollfd));
+		if (pollfds == NULL) return BVM_SOCKET_ERROR;
+		pd_socket_pollfds = pollfds;
+		pd_socket_pollfds_size = count;
+	}
+
+	for (i = 0; i < count; i++) {
+		pd_socket_pollfds[i].fd = polls[i].fd;
+		pd_socket_pollfds[i].events = 0;
+		pd_socket_pollfds[i].revents = 0;
+		if (polls[i].events & BVM_SOCKET_POLL_READ) pd_socket_pollfds[i].events |= POLLIN;
+		if (polls[i].events & BVM_SOCKET_POLL_WRITE) pd_socket_pollfds[i].events |= POLLOUT;
+	}
+
+	if (poll(pd_socket_pollfds, count, (timeout < 0) ? -1 : timeout) < 0)
+		return BVM_SOCKET_ERROR;
+
+	for (i = 0; i < count; i++) {
+		short revents = pd_socket_pollfds[i].revents;
+		polls[i].ready = 0;
+		if (revents & POLLNVAL) return BVM_SOCKET_ERROR;
+		if (revents & (POLLERR | POLLHUP)) polls[i].ready = polls[i].events;
+		if (revents & POLLIN) polls[i].ready |= (polls[i].events & BVM_SOCKET_POLL_READ);
+		if (revents & POLLOUT) polls[i].ready |= (polls[i].events & BVM_SOCKET_POLL_WRITE);
+		if (polls[i].ready != 0) result++;
+	}
+
+	return result;
+}
+
+#else
+
+/**
+ * Tests a number of sockets at once for readiness using a single \c select.  Each socket's \c ready member
+ * is set to the readiness found for it.  A winsock \c fd_set holds at most \c FD_SETSIZE sockets, so more than
+ * that cannot be tested and is an error.
+ *
+ * Unlike #bvm_pd_socket_available, a zero timeout really is zero - it is used at each thread
+ * switch so must not wait.
+ *
+ * @param polls the sockets to test.
+ * @param count the number of sockets in \c polls.
+ * @param timeout the time, in milliseconds, to wait for readiness.  Negative waits forever.
+ *
+ * @return the number of ready sockets, or #BVM_SOCKET_ERROR for any error.
+ */
+bvm_int32_t bvm_pd_socket_poll(bvm_pd_socket_poll_t *polls, bvm_uint32_t count, bvm_int32_t timeout) {
+
+	fd_set rset, wset;
+	struct timeval tv = {0,0};
+	struct timeval *tvp = NULL; /* for a default, will mean 'wait forever' */
+	bvm_int32_t maxfd = 0;
+	bvm_int32_t result = 0;
+	bvm_uint32_t i;
+
+	if (count > FD_SETSIZE)
+		return BVM_SOCKET_ERROR;
+
+	FD_ZERO(&rset);
+	FD_ZERO(&wset);
+
+	for (i = 0; i < count; i++) {
+		if (polls[i].events & BVM_SOCKET_POLL_READ) FD_SET((unsigned int) polls[i].fd, &rset);
+		if (polls[i].events & BVM_SOCKET_POLL_WRITE) FD_SET((unsigned int) polls[i].fd, &wset);
+		if (polls[i].fd > maxfd) maxfd = polls[i].fd;
+	}
+
+	if (timeout >= 0) {
+		tv.tv_sec  = timeout / 1000;
+		tv.tv_usec = (timeout % 1000) * 1000;
+		tvp = &tv;
+	}
+
+	if (select(maxfd+1, &rset, &wset, NULL, tvp) < 0)
+		return BVM_SOCKET_ERROR;
+
+	for (i = 0; i < count; i++) {
+		polls[i].ready = 0;
+		if ( (polls[i].events & BVM_SOCKET_POLL_READ) && FD_ISSET(polls[i].fd, &rset) ) polls[i].ready |= BVM_SOCKET_POLL_READ;
+		if ( (polls[i].events & BVM_SOCKET_POLL_WRITE) && FD_ISSET(polls[i].fd, &wset) ) polls[i].ready |= BVM_SOCKET_POLL_WRITE;
+		if (polls[i].ready != 0) result++;
+	}
+
+	return result;
+}
+
+#endif
+
 /**
  * Perform a blocking write of data to a socket.  Function does not return until all data has been
- * written to the socket.
+ * written to the socket - unless the socket is non-blocking, when only what there is room for is written.
  *
  * @param fd the socket to write to
  * @param buf the source address to write data from
  * @param len the number of byte to write
  *
- * @return number of bytes written (which should always be the same as \c len), or
- * #BVM_SOCKET_ERROR for any error.
+ * @return number of bytes written (which should always be the same as \c len for a blocking socket),
+ * #BVM_SOCKET_WOULD_BLOCK if a non-blocking socket has no room, or #BVM_SOCKET_ERROR for any error.
  */
 bvm_int32_t bvm_pd_socket_write(bvm_int32_t fd, const char *src, bvm_int32_t len) {
 	bvm_int32_t result = send(fd, src, len, 0);
-	return (result < 0) ? BVM_SOCKET_ERROR : result;
+	if (result < 0) return PD_SOCKET_WOULD_BLOCK() ? BVM_SOCKET_WOULD_BLOCK : BVM_SOCKET_ERROR;
+	return result;
+}
+
+/**
+ * Make a socket non-blocking - \c O_NONBLOCK for BSD sockets, \c FIONBIO for winsock.
+ *
+ * @param fd the socket.
+ * @return 0 (zero) on success, or #BVM_SOCKET_ERROR for any error.
+ */
+bvm_int32_t bvm_pd_socket_set_nonblocking(bvm_int32_t fd) {
+
+#ifdef BVM_PLATFORM_WINDOWS
+	u_long mode = 1;
+
+	if (ioctlsocket(fd, FIONBIO, &mode) != 0)
+		return BVM_SOCKET_ERROR;
+#else
+	int flags = fcntl(fd, F_GETFL, 0);
+
+	if ( (flags < 0) || (fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) )
+		return BVM_SOCKET_ERROR;
+#endif
+
+	return BVM_SOCKET_OK;
 }
 
 /**
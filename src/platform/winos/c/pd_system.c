@@ -77,8 +77,224 @@ bvm_int64_t bvm_pd_system_time() {
 	return (BVM_INT64_div(now_time, time_nano));
 }
 
+#if BVM_PROFILER_PERF_ENABLE
+
+bvm_uint32_t bvm_pd_system_process_id() {
+	return (bvm_uint32_t) GetCurrentProcessId();
+}
+
+#endif
+
+#if (BVM_PROFILER_STARTUP_TRACE_ENABLE || BVM_PROFILER_MONITOR_CONTENTION_ENABLE || BVM_VM_SLICE_ENABLE || \
+	 BVM_THREAD_ACCOUNTING_ENABLE)
+
+bvm_uint32_t bvm_pd_system_time_micros() {
+
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+
+	if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+
+	QueryPerformanceCounter(&counter);
+
+	/* wraps - only differences are used */
+	return (bvm_uint32_t) ((counter.QuadPart / frequency.QuadPart) * 1000000 +
+						   ((counter.QuadPart % frequency.QuadPart) * 1000000) / frequency.QuadPart);
+}
+
+#endif
+
+void bvm_pd_system_sleep(bvm_uint32_t millis) {
+	Sleep(millis);
+}
+
 void bvm_pd_system_exit(int code) {
 	exit(code);
 }
 
+#if BVM_THREAD_TIMER_PREEMPTION_ENABLE
+
+/* the VM function the timer calls */
+static void (*pd_timer_tick)(void) = NULL;
+
+static HANDLE pd_timer = NULL;
+
+static VOID CALLBACK pd_timer_callback(PVOID param, BOOLEAN fired) {
+	UNUSED(param);
+	UNUSED(fired);
+	pd_timer_tick();
+}
+
+/**
+ * A timer-queue timer - its callback runs on a pool thread so all it does is the VM's tick.
+ */
+void bvm_pd_system_timer_start(bvm_uint32_t millis, void (*tick)(void)) {
+	pd_timer_tick = tick;
+	CreateTimerQueueTimer(&pd_timer, NULL, pd_timer_callback, NULL, millis, millis, WT_EXECUTEDEFAULT);
+}
+
+void bvm_pd_system_timer_stop() {
+	if (pd_timer != NULL) {
+		DeleteTimerQueueTimer(NULL, pd_timer, NULL);
+		pd_timer = NULL;
+	}
+}
+
+#endif
+
+#if BVM_EXEC_IMPLICIT_NULL_CHECKS_ENABLE
+
+/* the VM function a null dereference fault calls */
+static void (*pd_null_trap)(void) = NULL;
+
+static PVOID pd_null_trap_handle = NULL;
+
+static LONG CALLBACK pd_null_trap_handler(PEXCEPTION_POINTERS info) {
+
+	PEXCEPTION_RECORD record = info->ExceptionRecord;
+
+	/* a read or write fault on the first page is a null dereference - the VM throws from there if it was expecting
+	 * it */
+	if ( (record->ExceptionCode == EXCEPTION_ACCESS_VIOLATION) && (record->ExceptionInformation[1] < 4096) )
+		pd_null_trap();
+
+	return EXCEPTION_CONTINUE_SEARCH;
+}
+
+/**
+ * A vectored exception handler - called for the fault before any SEH frames are searched.
+ */
+bvm_bool_t bvm_pd_system_null_trap_start(void (*trap)(void)) {
+	pd_null_trap = trap;
+	pd_null_trap_handle = AddVectoredExceptionHandler(1, pd_null_trap_handler);
+	return (pd_null_trap_handle != NULL);
+}
+
+void bvm_pd_system_null_trap_stop() {
+	if (pd_null_trap_handle != NULL) {
+		RemoveVectoredExceptionHandler(pd_null_trap_handle);
+		pd_null_trap_handle = NULL;
+	}
+}
+
+#endif
+
+#if (BVM_VM_ISOLATES_ENABLE || BVM_CLAZZ_PREFETCH_ENABLE || BVM_GC_PARALLEL_MARK_ENABLE || BVM_GC_CONCURRENT_SWEEP_ENABLE || \
+		BVM_FILE_ASYNC_ENABLE)
+
+/* what a started thread is to run */
+typedef struct {
+	HANDLE thread;
+	void (*run)(void *);
+	void *data;
+} pd_thread_t;
+
+static DWORD WINAPI pd_thread_run(LPVOID arg) {
+	pd_thread_t *pd_thread = arg;
+	pd_thread->run(pd_thread->data);
+	return 0;
+}
+
+void *bvm_pd_system_thread_start(void (*run)(void *), void *data) {
+
+	pd_thread_t *pd_thread = malloc(sizeof(pd_thread_t));
+
+	if (pd_thread == NULL) return NULL;
+
+	pd_thread->run = run;
+	pd_thread->data = data;
+	pd_thread->thread = CreateThread(NULL, 0, pd_thread_run, pd_thread, 0, NULL);
+
+	if (pd_thread->thread == NULL) {
+		free(pd_thread);
+		return NULL;
+	}
+
+	return pd_thread;
+}
+
+void bvm_pd_system_thread_join(void *thread) {
+
+	pd_thread_t *pd_thread = thread;
+
+	WaitForSingleObject(pd_thread->thread, INFINITE);
+	CloseHandle(pd_thread->thread);
+	free(pd_thread);
+}
+
+#endif
+
+#if (BVM_CLAZZ_PREFETCH_ENABLE || BVM_GC_PARALLEL_MARK_ENABLE || BVM_GC_CONCURRENT_SWEEP_ENABLE || BVM_FILE_ASYNC_ENABLE)
+
+void *bvm_pd_system_lock_create() {
+
+	CRITICAL_SECTION *section = malloc(sizeof(CRITICAL_SECTION));
+
+	if (section == NULL) return NULL;
+
+	InitializeCriticalSection(section);
+
+	return section;
+}
+
+void bvm_pd_system_lock(void *lock) {
+	EnterCriticalSection(lock);
+}
+
+void bvm_pd_system_unlock(void *lock) {
+	LeaveCriticalSection(lock);
+}
+
+void bvm_pd_system_lock_destroy(void *lock) {
+	DeleteCriticalSection(lock);
+	free(lock);
+}
+
+#if (BVM_GC_PARALLEL_MARK_ENABLE || BVM_GC_CONCURRENT_SWEEP_ENABLE)
+
+void bvm_pd_system_thread_yield() {
+	SwitchToThread();
+}
+
+#endif
+
+#endif
+
+#if BVM_COMPRESSED_REFS_ENABLE
+
+/** The lowest address and the address step tried for heap memory */
+#define PD_HEAP_ADDRESS_LOW		0x10000000UL
+#define PD_HEAP_ADDRESS_STEP	0x01000000UL
+
+void *bvm_pd_memory_heap_alloc(size_t size) {
+
+	bvm_native_ulong_t address;
+
+	/* Windows has no 'below 4gb' flag - try addresses from low up until one is free for the whole size */
+	for (address = PD_HEAP_ADDRESS_LOW; address + size - 1 <= 0xFFFFFFFFUL; address += PD_HEAP_ADDRESS_STEP) {
+		void *mem = VirtualAlloc((void *) address, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+		if (mem != NULL) return mem;
+	}
+
+	return NULL;
+}
+
+void bvm_pd_memory_heap_free(void *mem, size_t size) {
+	VirtualFree(mem, 0, MEM_RELEASE);
+}
+
+#endif
+
+#if BVM_JIT_ENABLE
+
+void *bvm_pd_memory_exec_alloc(size_t size) {
+	return VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+}
+
+void bvm_pd_memory_exec_free(void *mem, size_t size) {
+	VirtualFree(mem, 0, MEM_RELEASE);
+}
+
+#endif
+
 #endif
@@ -50,6 +50,9 @@ typedef signed long long bvm_native_long_t;
 
 #define BVM_DEBUGGER_ENABLE 1
 #define BVM_SOCKETS_ENABLE 1
+#ifndef BVM_THREAD_ACCOUNTING_ENABLE
+#define BVM_THREAD_ACCOUNTING_ENABLE 1
+#endif
 
 #define BVM_DEBUG_HEAP_GC_ON_ALLOC 0
 #define BVM_EXIT_ON_UNCAUGHT_EXCEPTION 1
@@ -60,6 +63,13 @@ typedef signed long long bvm_native_long_t;
 #define BVM_FLOAT_ENABLE 1
 #define BVM_NATIVE_INT64_ENABLE 1
 
+/* storage class for VM state when BVM_VM_INSTANCES_ENABLE is set */
+#define BVM_PD_THREAD_LOCAL __declspec(thread)
+
+/* atomically store n at p if it still holds o - true if it did.  For the collector's parallel marking.  The port is
+ * built with mingw, which has the gcc builtins. */
+#define BVM_PD_ATOMIC_CAS(p, o, n) __sync_bool_compare_and_swap((p), (o), (n))
+
 /**
  *  if winos, make sure it is not bloated.  Might only have been needed for winsock1 and #include of <windows.h>
  */